@@ -19,6 +19,8 @@
 #include <vw/BundleAdjustment/ModelBase.h>
 #include <boost/foreach.hpp>
 
+#include <vector>
+
 namespace vw {
 namespace ba {
 
@@ -89,6 +91,20 @@ namespace ba {
     double threshold() const { return m_sigma; }
   };
 
+  // The weights that scale residuals of the given norms so that their
+  // squared norms are the robust costs, sqrt(cost(norm))/norm, and 1
+  // for residuals of zero.  For the adjusters to weight all their
+  // residuals in one flat loop that the cost inlines into.
+  template <class RobustCostT>
+  inline void robust_weights( RobustCostT& cost_func,
+                              std::vector<double> const& norms,
+                              std::vector<double>& weights ) {
+    weights.resize( norms.size() );
+    for ( size_t k = 0; k < norms.size(); k++ ) {
+      const double norm = norms[k];
+      weights[k] = norm > 0 ? sqrt( cost_func( norm ) ) / norm : 1;
+    }
+  }
 
   // CHOLEKSY MATH FUNCTIONS
   //--------------------------------------------------------
@@ -228,6 +244,7 @@ namespace ba {
 
     bool m_use_camera_constraint;
     bool m_use_gcp_constraint;
+    size_t m_num_threads;
 
   public:
     // Constructor
@@ -237,7 +254,7 @@ namespace ba {
                 bool use_gcp_constraint=true ) :
     m_model(model), m_robust_cost_func(robust_cost_func),
       m_use_camera_constraint(use_camera_constraint),
-      m_use_gcp_constraint(use_gcp_constraint) {
+      m_use_gcp_constraint(use_gcp_constraint), m_num_threads(1) {
 
       m_iterations = 0;
       m_control_net = m_model.control_network();
@@ -321,6 +338,13 @@ namespace ba {
     bool camera_constraint() const { return m_use_camera_constraint; }
     bool gcp_constraint() const { return m_use_gcp_constraint; }
 
+    // The number of threads the adjuster evaluates the model on, or
+    // zero for the default number of threads.  With more than one the
+    // model is called from several threads at once, so it must be safe
+    // to.  Only AdjustSparse uses more than one.
+    size_t num_threads() const { return m_num_threads; }
+    void set_num_threads(size_t threads) { m_num_threads = threads; }
+
     // Additional Information
     int iterations() const { return m_iterations; }
     RobustCostT costfunction() const { return m_robust_cost_func; }
@@ -14,6 +14,7 @@
 
 // Vision Workbench
 #include <vw/BundleAdjustment/AdjustBase.h>
+#include <vw/BundleAdjustment/CameraRelation.h>
 #include <vw/Math/MatrixSparseSkyline.h>
 
 // Boost
@@ -14,15 +14,23 @@
 
 // Vision Workbench
 #include <vw/Math/MatrixSparseSkyline.h>
+#include <vw/Math/ConjugateGradient.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/BundleAdjustment/AdjustBase.h>
-#include <vw/BundleAdjustment/CameraRelation.h>
+#include <vw/BundleAdjustment/CompactControlNetwork.h>
+#include <vw/BundleAdjustment/ReducedCameraSolver.h>
 
 // Boost
 #include <boost/numeric/ublas/matrix_sparse.hpp>
 #include <boost/numeric/ublas/vector_sparse.hpp>
 #include <boost/numeric/ublas/io.hpp>
 #include <boost/version.hpp>
+
+// Standard
+#include <algorithm>
+
 #if BOOST_VERSION<=103200
 // Mapped matrix doesn't exist in 1.32, but Sparse Matrix does
 //
@@ -51,11 +59,11 @@ namespace ba {
     typedef Vector<double,BundleAdjustModelT::point_params_n> vector_point;
 
     math::MatrixSparseSkyline<double> m_S;
-    std::vector<size_t> m_ideal_ordering;
-    Vector<size_t> m_ideal_skyline;
-    bool m_found_ideal_ordering;
-    CameraRelationNetwork<JFeature> m_crn;
-    typedef CameraNode<JFeature>::iterator crn_iter;
+    boost::shared_ptr<ReducedCameraSolver> m_solver;
+    size_t m_cg_max_iterations;
+    double m_cg_tolerance;
+    CompactControlNetwork m_cnet;
+    std::vector<std::vector<size_t> > m_pattern;
 
     // Reused structures
     std::vector< matrix_camera_camera > U;
@@ -63,6 +71,197 @@ namespace ba {
     std::vector< vector_camera > epsilon_a;
     std::vector< vector_point > epsilon_b;
 
+    // Each measure's W and Y, and its terms of V and epsilon_b, which
+    // are summed into V and epsilon_b by point once every camera is
+    // done.  Measures are indexed as in m_cnet.
+    std::vector< matrix_camera_point > m_measure_W, m_measure_Y;
+    std::vector< matrix_point_point > m_measure_V;
+    std::vector< vector_point > m_measure_epsilon_b;
+
+    // Each measure's residual, unweighted, at the parameters in
+    // m_residual_a and m_residual_b, and the residuals of the step
+    // being tried.  The residuals of an accepted step are those of the
+    // next update, unless the model moved its parameters.
+    std::vector< Vector2 > m_residual, m_trial_residual;
+    std::vector< double > m_norm, m_weight;
+    std::vector< vector_camera > m_residual_a, m_trial_a;
+    std::vector< vector_point > m_residual_b, m_trial_b;
+    bool m_residual_valid;
+
+    // Computes the residuals of the measures of the cameras [begin,
+    // end) at the trial parameters.
+    double trial_residual_cameras( size_t begin, size_t end ) {
+      for ( size_t j = begin; j < end; j++ )
+        for ( size_t k = m_cnet.camera_begin(j); k < m_cnet.camera_end(j); k++ ) {
+          size_t i = m_cnet.point_id(k);
+          m_trial_residual[k] = Vector2();
+          try {
+            m_trial_residual[k] = m_cnet.pixel(k) - this->m_model(i,j,m_trial_a[j],m_trial_b[i]);
+          } catch (const camera::PixelToRayErr& e) {}
+        }
+      return 0;
+    }
+
+    // Evaluates the measures of the cameras [begin, end): their
+    // Jacobians, the cameras' terms of U and epsilon_a, W, and each
+    // measure's terms of V and epsilon_b, from the weighted residuals.
+    // Returns their part of the error.  Nothing another block of
+    // cameras writes is touched, so blocks can be evaluated at once.
+    double accumulate_cameras( size_t begin, size_t end ) {
+      double error_total = 0; // assume this is r^T\Sigma^{-1}r
+      for ( size_t j = begin; j < end; j++ ) {
+        for ( size_t k = m_cnet.camera_begin(j); k < m_cnet.camera_end(j); k++ ) {
+          size_t i = m_cnet.point_id(k);
+
+          matrix_2_camera A =
+            this->m_model.A_jacobian( i, j,
+                                      this->m_model.A_parameters(j),
+                                      this->m_model.B_parameters(i) );
+          matrix_2_point B =
+            this->m_model.B_jacobian( i, j,
+                                      this->m_model.A_parameters(j),
+                                      this->m_model.B_parameters(i) );
+
+          // Apply robust cost function weighting
+          Vector2 error = m_residual[k] * m_weight[k];
+
+          Matrix2x2 inverse_cov;
+          Vector2 pixel_sigma = m_cnet.sigma(k);
+          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
+          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
+          error_total += .5 * transpose(error) *
+            inverse_cov * error;
+
+          // Storing intermediate values
+          U[j] += transpose(A) * inverse_cov * A;
+          m_measure_V[k] = transpose(B) * inverse_cov * B;
+          epsilon_a[j] += transpose(A) * inverse_cov * error;
+          m_measure_epsilon_b[k] = transpose(B) * inverse_cov * error;
+          m_measure_W[k] = transpose(A) * inverse_cov * B;
+        }
+      }
+      return error_total;
+    }
+
+    // S x, without forming S: U_j x_j, less the sum over the points i
+    // of camera j of Y_ij times the sum over the cameras k seeing i of
+    // W_ik^T x_k.
+    Vector<double> schur_product( Vector<double> const& x ) {
+      const size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+      std::vector< vector_point > t( this->m_model.num_points() );
+      for ( size_t k = 0; k < m_cnet.num_measures(); k++ )
+        t[m_cnet.point_id(k)] += transpose( m_measure_W[k] ) *
+          subvector( x, m_cnet.camera_id(k)*num_cam_params, num_cam_params );
+      Vector<double> y( x.size() );
+      for ( size_t j = 0; j < m_cnet.num_cameras(); j++ ) {
+        vector_camera y_j = U[j] * subvector( x, j*num_cam_params, num_cam_params );
+        for ( size_t k = m_cnet.camera_begin(j); k < m_cnet.camera_end(j); k++ )
+          y_j -= m_measure_Y[k] * t[m_cnet.point_id(k)];
+        subvector( y, j*num_cam_params, num_cam_params ) = y_j;
+      }
+      return y;
+    }
+
+    class SchurProduct {
+      AdjustSparse& m_adjust;
+    public:
+      SchurProduct( AdjustSparse& adjust ) : m_adjust(adjust) {}
+      Vector<double> operator()( Vector<double> const& x ) const { return m_adjust.schur_product( x ); }
+    };
+
+    // Multiplies by the inverses of the diagonal blocks of S.
+    class BlockJacobiPreconditioner {
+      std::vector< matrix_camera_camera > m_inverse;
+    public:
+      BlockJacobiPreconditioner( std::vector< matrix_camera_camera > const& inverse ) : m_inverse(inverse) {}
+      Vector<double> operator()( Vector<double> const& r ) const {
+        const size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+        Vector<double> z( r.size() );
+        for ( size_t j = 0; j < m_inverse.size(); j++ )
+          subvector( z, j*num_cam_params, num_cam_params ) =
+            m_inverse[j] * subvector( r, j*num_cam_params, num_cam_params );
+        return z;
+      }
+    };
+
+    // Solves S delta_a = e by preconditioned conjugate gradients.
+    Vector<double> solve_conjugate_gradient( Vector<double> const& e ) {
+      std::vector< matrix_camera_camera > inverse( m_cnet.num_cameras() );
+      for ( size_t j = 0; j < m_cnet.num_cameras(); j++ ) {
+        matrix_camera_camera S_jj = U[j];
+        for ( size_t k = m_cnet.camera_begin(j); k < m_cnet.camera_end(j); k++ )
+          S_jj -= m_measure_Y[k]*transpose(m_measure_W[k]);
+        Matrix<double> S_temp = S_jj;
+        if ( chol_inverse( S_temp ) )
+          inverse[j] = transpose(S_temp)*S_temp;
+        else
+          inverse[j].set_identity();
+      }
+      Vector<double> delta_a( e.size() );
+      math::preconditioned_conjugate_gradient( SchurProduct( *this ), BlockJacobiPreconditioner( inverse ),
+                                               e, delta_a, m_cg_max_iterations, m_cg_tolerance );
+      return delta_a;
+    }
+
+    typedef double (AdjustSparse::*camera_block_func)( size_t, size_t );
+
+    class CameraBlockTask : public Task, private boost::noncopyable {
+      AdjustSparse& m_adjust;
+      camera_block_func m_func;
+      size_t m_begin, m_end;
+      double& m_error;
+    public:
+      CameraBlockTask( AdjustSparse& adjust, camera_block_func func,
+                       size_t begin, size_t end, double& error ) :
+        m_adjust(adjust), m_func(func), m_begin(begin), m_end(end), m_error(error) {}
+      void operator()() { m_error = (m_adjust.*m_func)( m_begin, m_end ); }
+    };
+
+    // Runs func over all the cameras, in blocks of a few to each
+    // thread, and returns the sum of what it returns.
+    double for_camera_blocks( camera_block_func func ) {
+      const size_t threads = this->m_num_threads ? this->m_num_threads
+                                                 : vw_settings().default_num_threads();
+      if ( threads <= 1 )
+        return (this->*func)( 0, m_cnet.num_cameras() );
+
+      const size_t block = m_cnet.num_cameras() / (4*threads) + 1;
+      std::vector<double> block_errors( (m_cnet.num_cameras() + block - 1) / block );
+      FifoWorkQueue queue( threads );
+      for ( size_t b = 0; b < block_errors.size(); b++ ) {
+        boost::shared_ptr<Task> task( new CameraBlockTask( *this, func, b*block,
+                                                           std::min( (b+1)*block, m_cnet.num_cameras() ),
+                                                           block_errors[b] ) );
+        queue.add_task( task );
+      }
+      queue.join_all();
+      double total = 0;
+      BOOST_FOREACH( double block_error, block_errors )
+        total += block_error;
+      return total;
+    }
+
+    // Weights the residuals in one pass over them.
+    void weigh_residuals( std::vector< Vector2 > const& residuals ) {
+      m_norm.resize( residuals.size() );
+      for ( size_t k = 0; k < residuals.size(); k++ )
+        m_norm[k] = norm_2( residuals[k] );
+      robust_weights( this->m_robust_cost_func, m_norm, m_weight );
+    }
+
+    // Whether the model's parameters are still those of m_residual.
+    bool residuals_current() const {
+      if ( !m_residual_valid )
+        return false;
+      for ( size_t j = 0; j < m_residual_a.size(); j++ )
+        if ( m_residual_a[j] != this->m_model.A_parameters(j) )
+          return false;
+      for ( size_t i = 0; i < m_residual_b.size(); i++ )
+        if ( m_residual_b[i] != this->m_model.B_parameters(i) )
+          return false;
+      return true;
+    }
+
   public:
 
     AdjustSparse( BundleAdjustModelT & model,
@@ -76,12 +275,56 @@ namespace ba {
       V_inverse( this->m_model.num_points() ),
       epsilon_a( this->m_model.num_cameras() ), epsilon_b( this->m_model.num_points() ) {
       vw_out(DebugMessage,"ba") << "Constructed Sparse Bundle Adjuster.\n";
-      m_crn.read_controlnetwork( *(this->m_control_net).get() );
-      m_found_ideal_ordering = false;
+      m_cnet.read_controlnetwork( *(this->m_control_net).get() );
+
+      // Cameras j and k > j share a block of S if they see a point in common
+      m_pattern.resize( m_cnet.num_cameras() );
+      for ( size_t i = 0; i < m_cnet.num_points(); i++ )
+        for ( size_t n = m_cnet.point_begin(i); n < m_cnet.point_end(i); n++ )
+          for ( size_t l = n+1; l < m_cnet.point_end(i); l++ ) {
+            size_t j = m_cnet.camera_id( m_cnet.point_measure(n) ),
+              k = m_cnet.camera_id( m_cnet.point_measure(l) );
+            if ( k != j )
+              m_pattern[j].push_back( k );
+          }
+      BOOST_FOREACH( std::vector<size_t>& cameras, m_pattern ) {
+        std::sort( cameras.begin(), cameras.end() );
+        cameras.erase( std::unique( cameras.begin(), cameras.end() ), cameras.end() );
+      }
+      set_linear_solver( boost::shared_ptr<ReducedCameraSolver>( new SkylineLDLSolver() ) );
+      m_cg_max_iterations = 0;
+      m_cg_tolerance = 1e-6;
+
+      m_measure_W.resize( m_cnet.num_measures() );
+      m_measure_Y.resize( m_cnet.num_measures() );
+      m_measure_V.resize( m_cnet.num_measures() );
+      m_measure_epsilon_b.resize( m_cnet.num_measures() );
+      m_residual.resize( m_cnet.num_measures() );
+      m_trial_residual.resize( m_cnet.num_measures() );
+      m_residual_valid = false;
     }
 
     math::MatrixSparseSkyline<double> S() const { return m_S; }
 
+    // Sets the solver of the reduced camera system, which is a
+    // SkylineLDLSolver unless set.
+    void set_linear_solver( boost::shared_ptr<ReducedCameraSolver> solver ) {
+      solver->analyze( BundleAdjustModelT::camera_params_n, m_pattern );
+      m_solver = solver;
+    }
+    boost::shared_ptr<ReducedCameraSolver> linear_solver() const { return m_solver; }
+
+    // Solves the reduced camera system inexactly instead, by block
+    // Jacobi preconditioned conjugate gradients, multiplying through
+    // the point blocks so that S is never formed.  This is for networks
+    // too large to form or factor S.  Each update stops after
+    // max_iterations, or once the residual is tolerance times e.  Zero
+    // iterations goes back to the linear solver.  S() is left empty.
+    void set_conjugate_gradient( size_t max_iterations, double tolerance = 1e-6 ) {
+      m_cg_max_iterations = max_iterations;
+      m_cg_tolerance = tolerance;
+    }
+
     // Covariance Calculator
     // ___________________________________________________________
     // This routine inverts a sparse matrix S, and prints the individual
@@ -139,48 +382,31 @@ namespace ba {
       // matrices A & B, as well as the error matrix and the W
       // matrix.
       time.reset(new Timer("Solve for Image Error, Jacobian, U, V, and W:", DebugMessage, "ba"));
-      double error_total = 0; // assume this is r^T\Sigma^{-1}r
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        BOOST_FOREACH( boost::shared_ptr<JFeature> measure, m_crn[j] ) {
-          size_t i = measure->m_point_id;
-
-          matrix_2_camera A =
-            this->m_model.A_jacobian( i, j,
-                                      this->m_model.A_parameters(j),
-                                      this->m_model.B_parameters(i) );
-          matrix_2_point B =
-            this->m_model.B_jacobian( i, j,
-                                      this->m_model.A_parameters(j),
-                                      this->m_model.B_parameters(i) );
-
-          // Apply robust cost function weighting
-          Vector2 error;
-          try {
-            error = measure->m_location -
-              this->m_model(i,j,this->m_model.A_parameters(j),
-                            this->m_model.B_parameters(i) );
-          } catch (const camera::PixelToRayErr& e) {}
-
-          if ( error != Vector2() ) {
-            double mag = norm_2(error);
-            double weight = sqrt(this->m_robust_cost_func(mag)) / mag;
-            error *= weight;
-          }
+      // The residuals are those of the last step taken, unless the
+      // parameters have been moved since.
+      if ( !residuals_current() ) {
+        m_trial_a.resize( this->m_model.num_cameras() );
+        m_trial_b.resize( this->m_model.num_points() );
+        for ( size_t j = 0; j < m_trial_a.size(); j++ )
+          m_trial_a[j] = this->m_model.A_parameters(j);
+        for ( size_t i = 0; i < m_trial_b.size(); i++ )
+          m_trial_b[i] = this->m_model.B_parameters(i);
+        for_camera_blocks( &AdjustSparse::trial_residual_cameras );
+        m_residual.swap( m_trial_residual );
+        m_residual_a = m_trial_a;
+        m_residual_b = m_trial_b;
+        m_residual_valid = true;
+      }
+      weigh_residuals( m_residual );
 
-          Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = measure->m_scale;
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
-          error_total += .5 * transpose(error) *
-            inverse_cov * error;
+      // The cameras are evaluated in blocks, a few to each thread.
+      double error_total = // assume this is r^T\Sigma^{-1}r
+        for_camera_blocks( &AdjustSparse::accumulate_cameras );
 
-          // Storing intermediate values
-          U[j] += transpose(A) * inverse_cov * A;
-          V[i] += transpose(B) * inverse_cov * B;
-          epsilon_a[j] += transpose(A) * inverse_cov * error;
-          epsilon_b[i] += transpose(B) * inverse_cov * error;
-          measure->m_w = transpose(A) * inverse_cov * B;
-        }
+      // Summing the point terms in camera order, as one thread would.
+      for ( size_t k = 0; k < m_cnet.num_measures(); k++ ) {
+        V[m_cnet.point_id(k)] += m_measure_V[k];
+        epsilon_b[m_cnet.point_id(k)] += m_measure_epsilon_b[k];
       }
       time.reset();
 
@@ -201,7 +427,7 @@ namespace ba {
       // Points (GCPs), not for 3D tie points.
       if (this->m_use_gcp_constraint)
         for ( size_t i = 0; i < V.size(); ++i )
-          if ((*this->m_control_net)[i].type() == ControlPoint::GroundControlPoint) {
+          if ( m_cnet.point_type(i) == ControlPoint::GroundControlPoint ) {
             matrix_point_point inverse_cov;
             inverse_cov = this->m_model.B_inverse_covariance(i);
             V[i] += inverse_cov;
@@ -269,103 +495,83 @@ namespace ba {
       }
 
       // Compute Y and finish constructing e.
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
+      for ( size_t j = 0; j < m_cnet.num_cameras(); j++ ) {
+        for ( size_t k = m_cnet.camera_begin(j); k < m_cnet.camera_end(j); k++ ) {
           // Compute the blocks of Y
-          (**fiter).m_y = (**fiter).m_w * V_inverse[(**fiter).m_point_id];
+          m_measure_Y[k] = m_measure_W[k] * V_inverse[m_cnet.point_id(k)];
           // Flatten the block structure to compute 'e'
-          subvector(e, j*num_cam_params, num_cam_params) -= (**fiter).m_y
-            * epsilon_b[ (**fiter).m_point_id ];
+          subvector(e, j*num_cam_params, num_cam_params) -= m_measure_Y[k]
+            * epsilon_b[ m_cnet.point_id(k) ];
         }
       }
 
       time.reset();
 
       // --- BUILD SPARSE, SOLVE A'S UPDATE STEP -------------------------
-      time.reset(new Timer("Build Sparse", DebugMessage, "ba"));
-
-      // The S matrix is a m x m block matrix with blocks that are
-      // camera_params_n x camera_params_n in size.  It has a sparse
-      // skyline structure, which makes it more efficient to solve
-      // through L*D*L^T decomposition and forward/back substitution
-      // below.
-      math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
-                                          this->m_model.num_cameras()*num_cam_params);
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        { // Filling in diagonal
-          matrix_camera_camera S_jj;
-
-          // Iterate across all features seen by the camera
-          for ( crn_iter fiter = m_crn[j].begin();
-                fiter != m_crn[j].end(); fiter++ ) {
-            S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
-          }
-
-          // Augmenting Diagonal
-          S_jj += U[j];
-
-          // Loading into sparse matrix
-          size_t offset = j * num_cam_params;
-          for ( size_t aa = 0; aa < num_cam_params; aa++ ) {
-            for ( size_t bb = aa; bb < num_cam_params; bb++ ) {
-              S( offset+bb, offset+aa ) = S_jj(aa,bb);  // Transposing
+      Vector<double> delta_a;
+      if ( m_cg_max_iterations ) {
+        time.reset(new Timer("Solve Delta A by PCG", DebugMessage, "ba"));
+        delta_a = solve_conjugate_gradient( e );
+      } else {
+        time.reset(new Timer("Build Sparse", DebugMessage, "ba"));
+
+        // The S matrix is a m x m block matrix with blocks that are
+        // camera_params_n x camera_params_n in size.  It has a sparse
+        // skyline structure, which makes it more efficient to solve
+        // through L*D*L^T decomposition and forward/back substitution
+        // below.
+        math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
+                                            this->m_model.num_cameras()*num_cam_params);
+        for ( size_t j = 0; j < m_cnet.num_cameras(); j++ ) {
+          { // Filling in diagonal
+            matrix_camera_camera S_jj;
+
+            // Iterate across all features seen by the camera
+            for ( size_t k = m_cnet.camera_begin(j); k < m_cnet.camera_end(j); k++ )
+              S_jj -= m_measure_Y[k]*transpose(m_measure_W[k]);
+
+            // Augmenting Diagonal
+            S_jj += U[j];
+
+            // Loading into sparse matrix
+            size_t offset = j * num_cam_params;
+            for ( size_t aa = 0; aa < num_cam_params; aa++ ) {
+              for ( size_t bb = aa; bb < num_cam_params; bb++ ) {
+                S( offset+bb, offset+aa ) = S_jj(aa,bb);  // Transposing
+              }
             }
           }
-        }
 
-        // Filling in off diagonal
-        for ( size_t k = j+1; k < m_crn.size(); k++ ) {
-          typedef boost::weak_ptr<JFeature> w_ptr;
-          typedef boost::shared_ptr<JFeature> f_ptr;
-          typedef std::multimap< size_t, f_ptr >::iterator mm_iterator;
-          std::pair< mm_iterator, mm_iterator > feature_range;
-          feature_range = m_crn[j].map.equal_range( k );
-
-          // Iterating through all features in camera j that have
-          // connections to camera k.
-          matrix_camera_camera S_jk;
-          bool found = false;
-          for ( mm_iterator f_j_iter = feature_range.first;
-                f_j_iter != feature_range.second; f_j_iter++ ) {
-            w_ptr f_k = (*f_j_iter).second->m_map[k];
-            found = true;
-            S_jk -= (*f_j_iter).second->m_y *
-              transpose( f_k.lock()->m_w );
+          // Filling in off diagonal, the blocks of the cameras in
+          // m_pattern[j], through the other measures of each point
+          // camera j sees.
+          std::vector< matrix_camera_camera > S_jk( m_pattern[j].size() );
+          for ( size_t k = m_cnet.camera_begin(j); k < m_cnet.camera_end(j); k++ ) {
+            size_t i = m_cnet.point_id(k);
+            for ( size_t n = m_cnet.point_begin(i); n < m_cnet.point_end(i); n++ ) {
+              size_t l = m_cnet.point_measure(n);
+              if ( m_cnet.camera_id(l) <= j )
+                continue;
+              size_t block = std::lower_bound( m_pattern[j].begin(), m_pattern[j].end(),
+                                               m_cnet.camera_id(l) ) - m_pattern[j].begin();
+              S_jk[block] -= m_measure_Y[k] * transpose( m_measure_W[l] );
+            }
           }
 
           // Loading into sparse matrix
           // - if it seems we are loading in oddly, it's because the sparse
           //   matrix is row major.
-          if ( found ) {
-            submatrix( S, k*num_cam_params, j*num_cam_params,
-                       num_cam_params, num_cam_params ) = transpose(S_jk);
-          }
+          for ( size_t block = 0; block < m_pattern[j].size(); block++ )
+            submatrix( S, m_pattern[j][block]*num_cam_params, j*num_cam_params,
+                       num_cam_params, num_cam_params ) = transpose(S_jk[block]);
         }
-      }
 
-      m_S = S; // S is modified in sparse solve. Keeping a copy.
-      time.reset();
-
-      // Computing ideal ordering
-      if (!m_found_ideal_ordering) {
-        time.reset(new Timer("Solving Cuthill-Mckee", DebugMessage, "ba"));
-        m_ideal_ordering = cuthill_mckee_ordering(S,num_cam_params);
-        math::MatrixReorganize<math::MatrixSparseSkyline<double> > mod_S( S, m_ideal_ordering );
-        m_ideal_skyline = solve_for_skyline(mod_S);
-
-        m_found_ideal_ordering = true;
+        m_S = S; // S is modified in sparse solve. Keeping a copy.
         time.reset();
-      }
 
-      time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
-
-      // Compute the LDL^T decomposition and solve using sparse methods.
-      math::MatrixReorganize<math::MatrixSparseSkyline<double> > modified_S( S, m_ideal_ordering );
-      Vector<double> delta_a = sparse_solve( modified_S,
-                                             reorganize(e, m_ideal_ordering),
-                                             m_ideal_skyline );
-      delta_a = reorganize(delta_a, modified_S.inverse());
+        time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
+        delta_a = m_solver->solve( S, e );
+      }
       BOOST_FOREACH( double& e, delta_a )
         if ( std::isnan( e ) ) e = 0;
       time.reset();
@@ -380,13 +586,9 @@ namespace ba {
 
         // Building right half, sum( WijT * delta_aj )
         std::vector< vector_point > right_delta_b( this->m_model.num_points() );
-        for ( size_t j = 0; j < m_crn.size(); j++ ) {
-          for ( crn_iter fiter = m_crn[j].begin();
-                fiter != m_crn[j].end(); fiter++ ) {
-            right_delta_b[ (**fiter).m_point_id ] += transpose( (**fiter).m_w ) *
-              subvector( delta_a, j*num_cam_params, num_cam_params );
-          }
-        }
+        for ( size_t k = 0; k < m_cnet.num_measures(); k++ )
+          right_delta_b[ m_cnet.point_id(k) ] += transpose( m_measure_W[k] ) *
+            subvector( delta_a, m_cnet.camera_id(k)*num_cam_params, num_cam_params );
 
         // Solving for delta b
         for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
@@ -414,28 +616,25 @@ namespace ba {
       // Compute the update error vector and predicted change
       // -------------------------------
       time.reset(new Timer("Solve for Updated Error", DebugMessage, "ba"));
-      double new_error_total = 0;
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
-          // Compute error vector
-          vector_camera new_a = this->m_model.A_parameters(j) +
-            subvector( delta_a, num_cam_params*j, num_cam_params );
-          vector_point new_b = this->m_model.B_parameters((**fiter).m_point_id) +
-            subvector( delta_b, num_pt_params*(**fiter).m_point_id, num_pt_params );
+      m_trial_a.resize( this->m_model.num_cameras() );
+      m_trial_b.resize( this->m_model.num_points() );
+      for ( size_t j = 0; j < m_trial_a.size(); j++ )
+        m_trial_a[j] = this->m_model.A_parameters(j) +
+          subvector( delta_a, num_cam_params*j, num_cam_params );
+      for ( size_t i = 0; i < m_trial_b.size(); i++ )
+        m_trial_b[i] = this->m_model.B_parameters(i) +
+          subvector( delta_b, num_pt_params*i, num_pt_params );
+      for_camera_blocks( &AdjustSparse::trial_residual_cameras );
+      weigh_residuals( m_trial_residual );
 
+      double new_error_total = 0;
+      for ( size_t j = 0; j < m_cnet.num_cameras(); j++ ) {
+        for ( size_t k = m_cnet.camera_begin(j); k < m_cnet.camera_end(j); k++ ) {
           // Apply robust cost function weighting
-          Vector2 error;
-          try {
-            error = (**fiter).m_location -
-              this->m_model((**fiter).m_point_id,j,new_a,new_b);
-          } catch (const camera::PixelToRayErr& e) {}
-          double mag = norm_2( error );
-          double weight = sqrt( this->m_robust_cost_func(mag)) / mag;
-          error *= weight;
+          Vector2 error = m_trial_residual[k] * m_weight[k];
 
           Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = (**fiter).m_scale;
+          Vector2 pixel_sigma = m_cnet.sigma(k);
           inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
           inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
 
@@ -460,8 +659,7 @@ namespace ba {
       // GCP Error
       if ( this->m_use_gcp_constraint )
         for ( size_t i = 0; i < V.size(); ++i )
-          if ( (*this->m_control_net)[i].type() ==
-               ControlPoint::GroundControlPoint) {
+          if ( m_cnet.point_type(i) == ControlPoint::GroundControlPoint ) {
 
             vector_point new_b = this->m_model.B_parameters(i) +
               subvector( delta_b, num_pt_params*i, num_pt_params );
@@ -490,11 +688,12 @@ namespace ba {
 
         time.reset(new Timer("Setting Parameters",DebugMessage,"ba"));
         for (size_t j = 0; j < this->m_model.num_cameras(); ++j)
-          this->m_model.set_A_parameters(j, this->m_model.A_parameters(j) +
-                                         subvector(delta_a, num_cam_params*j,num_cam_params));
+          this->m_model.set_A_parameters(j, m_trial_a[j]);
         for (size_t i = 0; i < this->m_model.num_points(); ++i)
-          this->m_model.set_B_parameters(i, this->m_model.B_parameters(i) +
-                                         subvector(delta_b, num_pt_params*i,num_pt_params));
+          this->m_model.set_B_parameters(i, m_trial_b[i]);
+        m_residual.swap( m_trial_residual );
+        m_residual_a.swap( m_trial_a );
+        m_residual_b.swap( m_trial_b );
         time.reset();
 
         if ( this->m_control == 0 ) {
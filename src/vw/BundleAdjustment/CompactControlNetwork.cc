@@ -0,0 +1,83 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file CompactControlNetwork.cc
+///
+
+#include <vw/BundleAdjustment/CompactControlNetwork.h>
+
+#include <boost/foreach.hpp>
+
+namespace vw {
+namespace ba {
+
+  void CompactControlNetwork::read_controlnetwork( ControlNetwork const& cnet ) {
+    // Counting the measures of each camera
+    size_t cameras = 0, measures = 0;
+    BOOST_FOREACH( ControlPoint const& cp, cnet )
+      BOOST_FOREACH( ControlMeasure const& cm, cp ) {
+        if ( cm.image_id() >= cameras )
+          cameras = cm.image_id() + 1;
+        measures++;
+      }
+    m_camera_offsets.assign( cameras + 1, 0 );
+    BOOST_FOREACH( ControlPoint const& cp, cnet )
+      BOOST_FOREACH( ControlMeasure const& cm, cp )
+        m_camera_offsets[cm.image_id() + 1]++;
+    for ( size_t j = 0; j < cameras; j++ )
+      m_camera_offsets[j+1] += m_camera_offsets[j];
+
+    // Placing them, in point order within each camera
+    m_point_id.resize( measures );
+    m_camera_id.resize( measures );
+    m_pixel.resize( measures );
+    m_sigma.resize( measures );
+    m_position.resize( cnet.size() );
+    m_point_sigma.resize( cnet.size() );
+    m_point_type.resize( cnet.size() );
+    m_point_offsets.assign( cnet.size() + 1, 0 );
+    std::vector<size_t> next( m_camera_offsets.begin(), m_camera_offsets.end() - 1 );
+    for ( size_t i = 0; i < cnet.size(); i++ ) {
+      BOOST_FOREACH( ControlMeasure const& cm, cnet[i] ) {
+        size_t k = next[cm.image_id()]++;
+        m_point_id[k] = i;
+        m_camera_id[k] = cm.image_id();
+        m_pixel[k] = cm.position();
+        m_sigma[k] = cm.sigma();
+      }
+      m_position[i] = cnet[i].position();
+      m_point_sigma[i] = cnet[i].sigma();
+      m_point_type[i] = cnet[i].type();
+      m_point_offsets[i+1] = m_point_offsets[i] + cnet[i].size();
+    }
+
+    // Listing the measures of each point, in camera order
+    m_point_measures.resize( measures );
+    next.assign( m_point_offsets.begin(), m_point_offsets.end() - 1 );
+    for ( size_t k = 0; k < measures; k++ )
+      m_point_measures[next[m_point_id[k]]++] = k;
+  }
+
+  void CompactControlNetwork::write_controlnetwork( ControlNetwork& cnet ) const {
+    cnet.clear();
+    cnet.reserve( num_points() );
+    for ( size_t i = 0; i < num_points(); i++ ) {
+      ControlPoint cp( point_type(i) );
+      cp.set_position( position(i) );
+      cp.set_sigma( point_sigma(i) );
+      cp.reserve( point_end(i) - point_begin(i) );
+      for ( size_t n = point_begin(i); n < point_end(i); n++ ) {
+        size_t k = point_measure(n);
+        cp.add_measure( ControlMeasure( m_pixel[k][0], m_pixel[k][1],
+                                        m_sigma[k][0], m_sigma[k][1],
+                                        m_camera_id[k] ) );
+      }
+      cnet.add_control_point( cp );
+    }
+  }
+
+}} // namespace vw::ba
@@ -0,0 +1,81 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file CompactControlNetwork.h
+///
+/// The measures of a control network in flat arrays, for walking
+/// quickly through networks too large to hold as ControlPoints.
+///
+/// The measures are sorted by camera, so that those of camera j are
+/// [camera_begin(j), camera_end(j)), and within a camera by point.
+/// Each measure keeps only its point, camera, pixel and sigma.  The
+/// measures of point i are listed by index, in camera order, from
+/// point_begin(i) to point_end(i).  Points keep their position, sigma
+/// and type.  Everything else a ControlNetwork records (serials,
+/// dates, descriptions, ignore flags) is dropped.
+
+#ifndef __VW_BUNDLEADJUSTMENT_COMPACT_CONTROL_NETWORK_H__
+#define __VW_BUNDLEADJUSTMENT_COMPACT_CONTROL_NETWORK_H__
+
+#include <vw/Math/Vector.h>
+#include <vw/BundleAdjustment/ControlNetwork.h>
+
+#include <vector>
+
+namespace vw {
+namespace ba {
+
+  class CompactControlNetwork {
+    // Measures, by camera
+    std::vector<size_t> m_camera_offsets;
+    std::vector<uint32> m_point_id, m_camera_id;
+    std::vector<Vector2f> m_pixel, m_sigma;
+
+    // Points
+    std::vector<size_t> m_point_offsets, m_point_measures;
+    std::vector<Vector3> m_position, m_point_sigma;
+    std::vector<uint8> m_point_type;
+
+  public:
+    CompactControlNetwork() : m_camera_offsets(1,0), m_point_offsets(1,0) {}
+    explicit CompactControlNetwork( ControlNetwork const& cnet ) { read_controlnetwork( cnet ); }
+
+    /// Conversion.  Writing replaces the points of cnet, with a
+    /// measure of camera j having image id j.
+    void read_controlnetwork( ControlNetwork const& cnet );
+    void write_controlnetwork( ControlNetwork& cnet ) const;
+
+    size_t num_cameras() const { return m_camera_offsets.size() - 1; }
+    size_t num_points() const { return m_point_offsets.size() - 1; }
+    size_t num_measures() const { return m_point_id.size(); }
+
+    /// The measures of camera j
+    size_t camera_begin( size_t j ) const { return m_camera_offsets[j]; }
+    size_t camera_end( size_t j ) const { return m_camera_offsets[j+1]; }
+
+    /// The measures of point i, by the index of the measure
+    size_t point_begin( size_t i ) const { return m_point_offsets[i]; }
+    size_t point_end( size_t i ) const { return m_point_offsets[i+1]; }
+    size_t point_measure( size_t n ) const { return m_point_measures[n]; }
+
+    /// Measure k
+    size_t point_id( size_t k ) const { return m_point_id[k]; }
+    size_t camera_id( size_t k ) const { return m_camera_id[k]; }
+    Vector2f const& pixel( size_t k ) const { return m_pixel[k]; }
+    Vector2f const& sigma( size_t k ) const { return m_sigma[k]; }
+
+    /// Point i
+    Vector3 const& position( size_t i ) const { return m_position[i]; }
+    Vector3 const& point_sigma( size_t i ) const { return m_point_sigma[i]; }
+    ControlPoint::ControlPointType point_type( size_t i ) const {
+      return ControlPoint::ControlPointType( m_point_type[i] );
+    }
+  };
+
+}} // namespace vw::ba
+
+#endif // __VW_BUNDLEADJUSTMENT_COMPACT_CONTROL_NETWORK_H__
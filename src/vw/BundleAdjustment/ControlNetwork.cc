@@ -9,8 +9,17 @@
 ///
 
 #include <vw/BundleAdjustment/ControlNetwork.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/FileIO/MappedFile.h>
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <streambuf>
 
 // Time Headers
 #include <boost/thread/xtime.hpp>
@@ -40,9 +49,44 @@ inline std::string isis_style_time_string() {
   return time;
 }
 
+namespace {
+
+  // Chunked binary control networks start with this string.
+  const char chunked_magic[] = "VWCNET2";
+
+  // Reads bytes in memory as a stream.
+  class MemoryStreamBuf : public std::streambuf {
+  public:
+    MemoryStreamBuf( const char* begin, const char* end ) {
+      setg( const_cast<char*>(begin), const_cast<char*>(begin), const_cast<char*>(end) );
+    }
+    size_t position() const { return gptr() - eback(); }
+  };
+
+  // Reads the points of one chunk in place.
+  class ReadChunkTask : public vw::Task, private boost::noncopyable {
+    const char *m_begin, *m_end;
+    vw::ba::ControlPoint* m_points;
+    size_t m_count;
+  public:
+    ReadChunkTask( const char* begin, const char* end,
+                   vw::ba::ControlPoint* points, size_t count ) :
+      m_begin(begin), m_end(end), m_points(points), m_count(count) {}
+    void operator()() {
+      MemoryStreamBuf buffer( m_begin, m_end );
+      std::istream f( &buffer );
+      for ( size_t p = 0; p < m_count; p++ )
+        m_points[p].read_binary( f );
+    }
+  };
+
+}
+
 namespace vw {
 namespace ba {
 
+  const uint32 ControlNetwork::points_per_chunk;
+
   ////////////////////////////
   // Control Measure        //
   ////////////////////////////
@@ -559,33 +603,40 @@ namespace ba {
     filename += ".cnet";
 
     // Opening file
-    std::ofstream f( filename.c_str() );
+    std::ofstream f( filename.c_str(), std::ios::binary );
 
     // Writing out the strings first
-    f << m_targetName << char(0) << m_networkId << char(0)
+    f << chunked_magic << char(0)
+      << m_targetName << char(0) << m_networkId << char(0)
       << m_created << char(0) << m_modified << char(0)
       << m_description << char(0) << m_userName << char(0);
     // Writing the binary data
     f.write((char*)&(m_type), sizeof(m_type));
-    int size = m_control_points.size();
+    uint64 size = m_control_points.size();
     f.write((char*)&(size), sizeof(size));
-    // Rolling through the control points
-    BOOST_FOREACH( ControlPoint const& cp, m_control_points )
-      cp.write_binary( f );
+
+    // Rolling through the control points a chunk at a time
+    for ( size_t first = 0; first < m_control_points.size(); first += points_per_chunk ) {
+      uint32 count = std::min( size_t(points_per_chunk), m_control_points.size() - first );
+      std::ostringstream chunk( std::ios::binary );
+      for ( size_t p = first; p < first + count; p++ )
+        m_control_points[p].write_binary( chunk );
+      std::string const& data = chunk.str();
+      uint64 bytes = data.size();
+      f.write((char*)&(bytes), sizeof(bytes));
+      f.write((char*)&(count), sizeof(count));
+      f.write( data.data(), bytes );
+    }
 
     f.close();
   }
 
-  /// Reading a compressed binary style control network
-  void ControlNetwork::read_binary( std::string const& filename ) {
-
-    // Opening file
-    std::ifstream f( filename.c_str() );
-    if ( !f.is_open() )
-      vw_throw( IOErr() << "Failed to open \"" << filename << "\" as a Control Network." );
-
+  bool ControlNetwork::read_binary_header( std::istream& f ) {
     // Reading in the strings first
     std::getline( f, m_targetName, '\0' );
+    bool chunked = m_targetName == chunked_magic;
+    if ( chunked )
+      std::getline( f, m_targetName, '\0' );
     std::getline( f, m_networkId, '\0' );
     std::getline( f, m_created, '\0' );
     std::getline( f, m_modified, '\0' );
@@ -594,16 +645,90 @@ namespace ba {
 
     // Reading in the binary data
     f.read((char*)&(m_type), sizeof(m_type));
-    int size;
-    f.read((char*)&(size), sizeof(size));
+    size_t size;
+    if ( chunked ) {
+      uint64 points;
+      f.read((char*)&(points), sizeof(points));
+      size = points;
+    } else {
+      int points;
+      f.read((char*)&(points), sizeof(points));
+      size = points;
+    }
+    if ( !f )
+      vw_throw( IOErr() << "Control Network header is truncated." );
 
     // Clearing anything left in this control network
     m_control_points.clear();
-    m_control_points.reserve( size );
+    m_control_points.resize( size );
+    return chunked;
+  }
 
-    // Reading in all the control points
-    for ( int p = 0; p < size; p++ )
-      m_control_points.push_back( ControlPoint( f, FmtBinary ) );
+  /// Reading a compressed binary style control network
+  void ControlNetwork::read_binary( std::string const& filename, bool memory_map ) {
+
+    if ( memory_map && MappedFile::supported() ) {
+      boost::scoped_ptr<MappedFile> file;
+      try {
+        file.reset( new MappedFile( filename ) );
+      } catch ( const ArgumentErr& ) {
+        vw_throw( IOErr() << "Failed to open \"" << filename << "\" as a Control Network." );
+      }
+      const char* data = (const char*)file->data();
+      MemoryStreamBuf buffer( data, data + file->size() );
+      std::istream f( &buffer );
+      if ( !read_binary_header( f ) ) {
+        BOOST_FOREACH( ControlPoint& cp, m_control_points )
+          cp.read_binary( f );
+        return;
+      }
+
+      // Finding the chunks, then reading them all at once
+      const size_t threads = vw_settings().default_num_threads();
+      FifoWorkQueue queue( threads > 0 ? threads : 1 );
+      size_t offset = buffer.position(), first = 0;
+      while ( first < m_control_points.size() ) {
+        uint64 bytes;
+        uint32 count;
+        VW_ASSERT( offset + sizeof(bytes) + sizeof(count) <= file->size(),
+                   IOErr() << "Control Network \"" << filename << "\" is truncated." );
+        std::memcpy( &bytes, data + offset, sizeof(bytes) );
+        std::memcpy( &count, data + offset + sizeof(bytes), sizeof(count) );
+        offset += sizeof(bytes) + sizeof(count);
+        VW_ASSERT( offset + bytes <= file->size() && first + count <= m_control_points.size(),
+                   IOErr() << "Control Network \"" << filename << "\" is truncated." );
+        boost::shared_ptr<Task> task( new ReadChunkTask( data + offset, data + offset + bytes,
+                                                         &m_control_points[first], count ) );
+        queue.add_task( task );
+        offset += bytes;
+        first += count;
+      }
+      queue.join_all();
+      return;
+    }
+
+    // Opening file
+    std::ifstream f( filename.c_str(), std::ios::binary );
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << filename << "\" as a Control Network." );
+
+    // Reading in all the control points, skipping the chunk headers
+    if ( read_binary_header( f ) ) {
+      for ( size_t first = 0; first < m_control_points.size(); ) {
+        uint64 bytes;
+        uint32 count;
+        f.read((char*)&(bytes), sizeof(bytes));
+        f.read((char*)&(count), sizeof(count));
+        if ( !f || first + count > m_control_points.size() )
+          vw_throw( IOErr() << "Control Network \"" << filename << "\" is truncated." );
+        for ( size_t p = first; p < first + count; p++ )
+          m_control_points[p].read_binary( f );
+        first += count;
+      }
+    } else {
+      BOOST_FOREACH( ControlPoint& cp, m_control_points )
+        cp.read_binary( f );
+    }
 
     f.close();
   }
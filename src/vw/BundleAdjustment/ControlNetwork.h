@@ -396,11 +396,23 @@ namespace ba {
     size_t find_measure(ControlMeasure const& query);
 
     /// File I/O
-    void read_binary( std::string const& filename );
+    ///
+    /// write_binary writes the points in chunks of points_per_chunk,
+    /// each one preceded by its size in bytes and its number of points,
+    /// holding no more than a chunk in memory.  read_binary reads those
+    /// files, and the unchunked ones written before them, point by
+    /// point into place.  With memory_map it maps the file instead and
+    /// reads the chunks of a chunked file on several threads.
+    static const uint32 points_per_chunk = 4096;
+    void read_binary( std::string const& filename, bool memory_map = false );
     void read_isis( std::string const& filename );
     void write_binary( std::string filename ) const;
     void write_isis( std::string filename );
 
+  private:
+    // Reads the strings and type, and returns whether the points that
+    // follow are chunked.
+    bool read_binary_header( std::istream& f );
   };
 
   std::ostream& operator<<( std::ostream& os, ControlNetwork const& cnet);
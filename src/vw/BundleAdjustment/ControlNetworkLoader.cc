@@ -6,25 +6,30 @@
 
 
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Stereo/StereoModel.h>
 
 using namespace vw;
 using namespace vw::ba;
 
 #include <boost/filesystem/fstream.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+#include <boost/unordered_map.hpp>
 
-namespace fs = boost::filesystem;
+#include <set>
 
-struct ContainsEqualIP {
-  ip::InterestPoint& m_compare;
-  ContainsEqualIP( ip::InterestPoint& comp ) : m_compare(comp) {}
+namespace fs = boost::filesystem;
 
-  bool operator()( boost::shared_ptr<IPFeature> in ) {
-    if (  m_compare.x == in->m_ip.x &&
-          m_compare.y == in->m_ip.y )
-      return true;
-    return false;
-  }
+// The matches of a pair of images, read on their own thread
+struct MatchFile {
+  std::string filename;
+  size_t image1, image2;
+  std::vector<ip::InterestPoint> ip1, ip2;
+  MatchFile( std::string const& file, size_t i1, size_t i2 ) :
+    filename(file), image1(i1), image2(i2) {}
 };
 
 // Utility for checking that the point is BA safe
@@ -82,29 +87,100 @@ void vw::ba::triangulate_control_point( ControlPoint& cp,
   }
 }
 
+// Reads a match file, without descriptors and with safe scales
+class ReadMatchTask : public Task, private boost::noncopyable {
+  MatchFile& m_match;
+public:
+  ReadMatchTask( MatchFile& match ) : m_match(match) {}
+  void operator()() {
+    ip::read_binary_match_file( m_match.filename, m_match.ip1, m_match.ip2 );
+    std::for_each( m_match.ip1.begin(), m_match.ip1.end(), ip::remove_descriptor );
+    std::for_each( m_match.ip2.begin(), m_match.ip2.end(), ip::remove_descriptor );
+    std::for_each( m_match.ip1.begin(), m_match.ip1.end(), safe_measurement );
+    std::for_each( m_match.ip2.begin(), m_match.ip2.end(), safe_measurement );
+  }
+};
+
+// A measure is identified by its image and location
+typedef boost::tuple<size_t, float, float> MeasureKey;
+struct MeasureKeyHash {
+  size_t operator()( MeasureKey const& key ) const {
+    size_t seed = 0;
+    boost::hash_combine( seed, key.get<0>() );
+    boost::hash_combine( seed, key.get<1>() );
+    boost::hash_combine( seed, key.get<2>() );
+    return seed;
+  }
+};
+
+// Union-find of measures into tracks
+class TrackSet {
+  std::vector<size_t> m_parent;
+public:
+  void add() { m_parent.push_back( m_parent.size() ); }
+  size_t find( size_t m ) {
+    size_t root = m;
+    while ( m_parent[root] != root )
+      root = m_parent[root];
+    while ( m_parent[m] != root ) {
+      size_t next = m_parent[m];
+      m_parent[m] = root;
+      m = next;
+    }
+    return root;
+  }
+  void join( size_t a, size_t b ) {
+    a = find( a );
+    b = find( b );
+    if ( a != b )
+      m_parent[std::max(a,b)] = std::min(a,b);
+  }
+};
+
+// Triangulates the control points [begin, end) of a network.
+class TriangulateTask : public Task, private boost::noncopyable {
+  ba::ControlNetwork& m_cnet;
+  size_t m_begin, m_end;
+  std::vector<boost::shared_ptr<camera::CameraModel> > const& m_camera_models;
+  double m_min_angle;
+  TerminalProgressCallback& m_progress;
+  Mutex& m_progress_mutex;
+public:
+  TriangulateTask( ba::ControlNetwork& cnet, size_t begin, size_t end,
+                   std::vector<boost::shared_ptr<camera::CameraModel> > const& camera_models,
+                   double min_angle, TerminalProgressCallback& progress, Mutex& progress_mutex ) :
+    m_cnet(cnet), m_begin(begin), m_end(end), m_camera_models(camera_models),
+    m_min_angle(min_angle), m_progress(progress), m_progress_mutex(progress_mutex) {}
+
+  void operator()() {
+    for ( size_t i = m_begin; i < m_end; i++ )
+      ba::triangulate_control_point( m_cnet[i], m_camera_models, m_min_angle );
+    Mutex::Lock lock( m_progress_mutex );
+    m_progress.report_incremental_progress( double(m_end - m_begin) / double(m_cnet.size()) );
+  }
+};
+
 void vw::ba::build_control_network( ba::ControlNetwork& cnet,
                                      std::vector<boost::shared_ptr<camera::CameraModel> > const& camera_models,
                                      std::vector<std::string> const& image_files,
                                      size_t min_matches,
                                      std::vector<std::string> const& directories ) {
   cnet.clear();
+  const size_t threads = std::max( size_t( vw_settings().default_num_threads() ), size_t(1) );
 
   // We can't guarantee that image_files is sorted, so we make a
   // std::map to give ourselves a sorted list and access to a binary
   // search.
   std::map<std::string,size_t> image_prefix_map;
   size_t count = 0;
-  ba::CameraRelationNetwork<ba::IPFeature> crn;
   BOOST_FOREACH( std::string const& file, image_files ) {
     fs::path file_path(file);
     image_prefix_map[file_path.replace_extension().string()] = count;
-    crn.add_node( ba::CameraNode<ba::IPFeature>( count,
-                                                 file_path.stem() ) );
     count++;
   }
 
   // Searching through the directories available to us.
-  size_t num_load_rejected = 0, num_loaded = 0;
+  std::vector<boost::shared_ptr<MatchFile> > match_files;
   BOOST_FOREACH( std::string const& directory, directories ) {
     vw_out(VerboseDebugMessage,"ba") << "\tOpening directory \""
                                      << directory << "\".\n";
@@ -130,73 +206,121 @@ void vw::ba::build_control_network( ba::ControlNetwork& cnet,
       if ( it1 == image_prefix_map.end() ||
            it2 == image_prefix_map.end() ) continue;
 
-      // Actually read in the file as it seems we've found something correct
-      std::vector<ip::InterestPoint> ip1, ip2;
-      ip::read_binary_match_file( obj->string(), ip1, ip2 );
-      if ( ip1.size() < min_matches ) {
-        vw_out(VerboseDebugMessage,"ba") << "\t" << obj->string() << "    "
-                                         << it1->second << " <-> " << it2->second << " : "
-                                         << ip1.size() << " matches. [rejected]\n";
-        num_load_rejected += ip1.size();
-      } else {
-        vw_out(VerboseDebugMessage,"ba") << "\t" << obj->string() << "    "
-                                         << it1->second << " <-> " << it2->second << " : "
-                                         << ip1.size() << " matches.\n";
-        num_loaded += ip1.size();
-
-        // Remove descriptors from interest points and correct scale
-        std::for_each( ip1.begin(), ip1.end(), ip::remove_descriptor );
-        std::for_each( ip2.begin(), ip2.end(), ip::remove_descriptor );
-        std::for_each( ip1.begin(), ip1.end(), safe_measurement );
-        std::for_each( ip2.begin(), ip2.end(), safe_measurement );
-
-        typedef boost::shared_ptr< ba::IPFeature > f_ptr;
-        typedef std::list< f_ptr >::iterator f_itr;
-
-        // Checking to see if features already exist, adding if they
-        // don't, then linking them.
-        for ( size_t k = 0; k < ip1.size(); k++ ) {
-          f_itr ipfeature1 = std::find_if( crn[it1->second].begin(),
-                                           crn[it1->second].end(),
-                                           ContainsEqualIP( ip1[k] ) );
-          f_itr ipfeature2 = std::find_if( crn[it2->second].begin(),
-                                           crn[it2->second].end(),
-                                           ContainsEqualIP( ip2[k] ) );
-          if ( ipfeature1 == crn[it1->second].end() ) {
-            crn[it1->second].relations.push_front( f_ptr( new ba::IPFeature( ip1[k], it1->second ) ) );
-            ipfeature1 = crn[it1->second].begin();
-          }
-          if ( ipfeature2 == crn[it2->second].end() ) {
-            crn[it2->second].relations.push_front( f_ptr( new ba::IPFeature( ip2[k], it2->second ) ) );
-            ipfeature2 = crn[it2->second].begin();
-          }
+      match_files.push_back( boost::shared_ptr<MatchFile>( new MatchFile( obj->string(), it1->second,
+                                                                          it2->second ) ) );
+    }
+  } // end search through directories
+
+  // Actually read in the files as it seems we've found something correct
+  {
+    FifoWorkQueue queue( threads );
+    BOOST_FOREACH( boost::shared_ptr<MatchFile> const& match, match_files )
+      queue.add_task( boost::shared_ptr<Task>( new ReadMatchTask( *match ) ) );
+    queue.join_all();
+  }
+
+  // Joining the measures that match into tracks, in the order of the
+  // match files.  Measures of an image are the same if they're at the
+  // same place, and keep the scale they were first read with.
+  size_t num_load_rejected = 0, num_loaded = 0;
+  std::vector<ip::InterestPoint> measures;
+  std::vector<size_t> measure_image;
+  boost::unordered_map<MeasureKey, size_t, MeasureKeyHash> measure_index;
+  TrackSet tracks;
+  BOOST_FOREACH( boost::shared_ptr<MatchFile> const& match, match_files ) {
+    if ( match->ip1.size() < min_matches ) {
+      vw_out(VerboseDebugMessage,"ba") << "\t" << match->filename << "    "
+                                       << match->image1 << " <-> " << match->image2 << " : "
+                                       << match->ip1.size() << " matches. [rejected]\n";
+      num_load_rejected += match->ip1.size();
+    } else {
+      vw_out(VerboseDebugMessage,"ba") << "\t" << match->filename << "    "
+                                       << match->image1 << " <-> " << match->image2 << " : "
+                                       << match->ip1.size() << " matches.\n";
+      num_loaded += match->ip1.size();
 
-          // Doubly linking
-          (*ipfeature1)->connection( *ipfeature2, false );
-          (*ipfeature2)->connection( *ipfeature1, false );
+      for ( size_t k = 0; k < match->ip1.size(); k++ ) {
+        size_t ids[2];
+        for ( size_t side = 0; side < 2; side++ ) {
+          ip::InterestPoint const& ip = side ? match->ip2[k] : match->ip1[k];
+          size_t image = side ? match->image2 : match->image1;
+          std::pair<boost::unordered_map<MeasureKey, size_t, MeasureKeyHash>::iterator, bool> it =
+            measure_index.insert( std::make_pair( MeasureKey( image, ip.x, ip.y ), measures.size() ) );
+          if ( it.second ) {
+            measures.push_back( ip );
+            measure_image.push_back( image );
+            tracks.add();
+          }
+          ids[side] = it.first->second;
         }
+        tracks.join( ids[0], ids[1] );
       }
     }
-  } // end search through directories
+    // Done with this file
+    match->ip1.clear();
+    match->ip2.clear();
+  }
   if ( num_load_rejected != 0 ) {
     vw_out(WarningMessage,"ba") << "\tDidn't load " << num_load_rejected
                                 << " matches due to inadequacy.\n";
     vw_out(WarningMessage,"ba") << "\tLoaded " << num_loaded << " matches.\n";
   }
 
-  // Building control network
-  crn.write_controlnetwork( cnet );
+  // Building control network, a control point to each track.  Tracks
+  // that see an image twice are spiral errors, and are dropped.
+  {
+    std::vector<size_t> track_point( measures.size(), size_t(-1) );
+    std::vector<std::vector<size_t> > point_measures;
+    for ( size_t m = 0; m < measures.size(); m++ ) {
+      size_t& point = track_point[tracks.find( m )];
+      if ( point == size_t(-1) ) {
+        point = point_measures.size();
+        point_measures.push_back( std::vector<size_t>() );
+      }
+      point_measures[point].push_back( m );
+    }
+
+    int spiral_error_count = 0;
+    cnet.reserve( point_measures.size() );
+    BOOST_FOREACH( std::vector<size_t> const& track, point_measures ) {
+      ControlPoint cpoint( ControlPoint::TiePoint );
+      std::set<size_t> images;
+      BOOST_FOREACH( size_t m, track ) {
+        if ( !images.insert( measure_image[m] ).second )
+          break;
+        cpoint.add_measure( ControlMeasure( measures[m].x, measures[m].y,
+                                            measures[m].scale, measures[m].scale,
+                                            measure_image[m] ) );
+      }
+      if ( cpoint.size() != track.size() ) {
+        spiral_error_count++;
+        continue;
+      }
+      cnet.add_control_point( cpoint );
+    }
+    if ( spiral_error_count != 0 )
+      vw_out(WarningMessage,"ba") << "\t"
+                                  << spiral_error_count
+                                  << " control points removed due to spiral errors.\n";
+    VW_ASSERT( cnet.size() != 0,
+               Aborted() << "Failed to load any points, Control Network empty\n" );
+  }
 
-  // Triangulating Positions
+  // Triangulating Positions, a block of points to each task
   {
     TerminalProgressCallback progress("ba", "Triangulating:");
     progress.report_progress(0);
-    double inc_prog = 1.0/double(cnet.size());
+    Mutex progress_mutex;
     double min_angle = 5.0*M_PI/180.0;
-    BOOST_FOREACH( ba::ControlPoint& cpoint, cnet ) {
-      progress.report_incremental_progress(inc_prog );
-      ba::triangulate_control_point( cpoint, camera_models, min_angle );
+    const size_t block = cnet.size() / (4*threads) + 1;
+    FifoWorkQueue queue( threads );
+    for ( size_t first = 0; first < cnet.size(); first += block ) {
+      boost::shared_ptr<Task> task( new TriangulateTask( cnet, first, std::min( first + block, cnet.size() ),
+                                                         camera_models, min_angle,
+                                                         progress, progress_mutex ) );
+      queue.add_task( task );
     }
+    queue.join_all();
     progress.report_finished();
   }
 }
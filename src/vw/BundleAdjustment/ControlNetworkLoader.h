@@ -22,7 +22,9 @@ namespace ba {
   // Builds a control network using given camera models and original
   // image names. This function uses Boost::FS to then find match files
   // that would have been created by 'ipmatch' by searching the entire
-  // permutation of the image_files vector.
+  // permutation of the image_files vector. The control points are
+  // triangulated on vw_settings().default_num_threads() threads, so
+  // the camera models must be safe to use from several at once.
   void build_control_network( ControlNetwork& cnet,
                                std::vector<boost::shared_ptr<camera::CameraModel> > const& camera_models,
                                std::vector<std::string> const& image_files,
@@ -19,6 +19,7 @@
 // Vision Workbench
 #include <vw/Math/Matrix.h>
 #include <vw/Math/Vector.h>
+#include <vw/Math/Dual.h>
 #include <vw/BundleAdjustment/ControlNetwork.h>
 #include <vw/Core/Log.h>
 #include <vw/Camera/CameraModel.h>
@@ -30,6 +31,12 @@ namespace vw {
 namespace ba {
 
   // CRTP Base class for Bundle Adjustment functors.
+  //
+  // The Jacobians are approximated by finite differences, which
+  // evaluate the model 1+CameraParamsN and 1+PointParamsN times.  A
+  // model that knows its Jacobians analytically defines A_jacobian and
+  // B_jacobian itself, with these signatures, and the adjusters call
+  // those instead.  AutoDiffModelBase below derives them exactly.
   //---------------------------------------------------------
   template <class ImplT, size_t CameraParamsN, size_t PointParamsN>
   class ModelBase {
@@ -157,6 +164,75 @@ namespace ba {
     }
   };
 
+  // CRTP Base class for models whose projection is written once as a
+  // template on the scalar type:
+  //
+  //   template <class T>
+  //   Vector<T,2> project( size_t i, size_t j,
+  //                        Vector<T,CameraParamsN> const& a_j,
+  //                        Vector<T,PointParamsN> const& b_i ) const;
+  //
+  // operator() evaluates it on doubles.  A_jacobian and B_jacobian
+  // evaluate it once each on math::Dual numbers, which gives the exact
+  // Jacobians in place of finite differences.  The projection may
+  // throw PixelToRayErr, when the Jacobian is zero as in ModelBase.
+  //---------------------------------------------------------
+  template <class ImplT, size_t CameraParamsN, size_t PointParamsN>
+  class AutoDiffModelBase : public ModelBase<ImplT, CameraParamsN, PointParamsN> {
+    typedef ModelBase<ImplT, CameraParamsN, PointParamsN> base_type;
+  public:
+    Vector2 operator() ( size_t i, size_t j,
+                         Vector<double,CameraParamsN> const& a_j,
+                         Vector<double,PointParamsN> const& b_i ) const {
+      return this->impl().template project<double>( i, j, a_j, b_i );
+    }
+
+    inline Matrix<double, 2, CameraParamsN> A_jacobian ( size_t i, size_t j,
+                                                         Vector<double, CameraParamsN> const& a_j,
+                                                         Vector<double, PointParamsN> const& b_i ) const {
+      typedef math::Dual<CameraParamsN> dual_type;
+      Vector<dual_type, CameraParamsN> a;
+      Vector<dual_type, PointParamsN> b;
+      for ( size_t n = 0; n < CameraParamsN; ++n )
+        a(n) = dual_type( a_j(n), n );
+      for ( size_t n = 0; n < PointParamsN; ++n )
+        b(n) = dual_type( b_i(n) );
+      return jacobian<CameraParamsN>( i, j, a, b );
+    }
+
+    inline Matrix<double, 2, PointParamsN> B_jacobian ( size_t i, size_t j,
+                                                        Vector<double, CameraParamsN> const& a_j,
+                                                        Vector<double, PointParamsN> const& b_i ) const {
+      typedef math::Dual<PointParamsN> dual_type;
+      Vector<dual_type, CameraParamsN> a;
+      Vector<dual_type, PointParamsN> b;
+      for ( size_t n = 0; n < CameraParamsN; ++n )
+        a(n) = dual_type( a_j(n) );
+      for ( size_t n = 0; n < PointParamsN; ++n )
+        b(n) = dual_type( b_i(n), n );
+      return jacobian<PointParamsN>( i, j, a, b );
+    }
+
+  private:
+    template <size_t ParamsN>
+    Matrix<double, 2, ParamsN> jacobian( size_t i, size_t j,
+                                         Vector<math::Dual<ParamsN>, CameraParamsN> const& a,
+                                         Vector<math::Dual<ParamsN>, PointParamsN> const& b ) const {
+      Matrix<double, 2, ParamsN> J;
+      Vector<math::Dual<ParamsN>, 2> h;
+      try {
+        h = this->impl().template project<math::Dual<ParamsN> >( i, j, a, b );
+      } catch (const camera::PixelToRayErr& e) {
+        // Unable to project this point into the camera, so abort!
+        return J;
+      }
+      for ( size_t r = 0; r < 2; ++r )
+        for ( size_t n = 0; n < ParamsN; ++n )
+          J(r,n) = h(r).derivative(n);
+      return J;
+    }
+  };
+
 }} // namespace vw::ba
 
 #endif//__VW_BUNDLEADJUSTMENT_MODEL_BASE_H__
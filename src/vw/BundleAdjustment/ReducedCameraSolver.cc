@@ -0,0 +1,87 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file ReducedCameraSolver.cc
+///
+
+#include <vw/BundleAdjustment/ReducedCameraSolver.h>
+#include <vw/Core/Debugging.h>
+
+#include <limits>
+
+namespace vw {
+namespace ba {
+
+  void SkylineLDLSolver::analyze( size_t block_size,
+                                  std::vector<std::vector<size_t> > const& /*lower_pattern*/ ) {
+    m_block_size = block_size;
+    m_found_ordering = false;
+  }
+
+  Vector<double> SkylineLDLSolver::solve( math::MatrixSparseSkyline<double>& S,
+                                          Vector<double> const& e ) {
+    // Computing ideal ordering
+    if ( !m_found_ordering ) {
+      Timer time("Solving Cuthill-Mckee", DebugMessage, "ba");
+      m_ordering = math::cuthill_mckee_ordering( S, m_block_size );
+      math::MatrixReorganize<math::MatrixSparseSkyline<double> > mod_S( S, m_ordering );
+      m_skyline = math::solve_for_skyline( mod_S );
+      m_found_ordering = true;
+    }
+
+    // Compute the LDL^T decomposition and solve using sparse methods.
+    math::MatrixReorganize<math::MatrixSparseSkyline<double> > modified_S( S, m_ordering );
+    Vector<double> x = math::sparse_solve( modified_S,
+                                           math::reorganize( e, m_ordering ),
+                                           m_skyline );
+    return math::reorganize( x, modified_S.inverse() );
+  }
+
+  void SupernodalCholeskySolver::analyze( size_t block_size,
+                                          std::vector<std::vector<size_t> > const& lower_pattern ) {
+    Timer time("Supernodal analysis", DebugMessage, "ba");
+    m_pattern = lower_pattern;
+    m_factor.analyze( block_size, lower_pattern );
+    size_t blocks = m_factor.num_blocks();
+    for ( size_t j = 0; j < m_pattern.size(); j++ )
+      blocks += m_pattern[j].size();
+    vw_out(DebugMessage,"ba") << "-> " << m_factor.num_supernodes() << " supernodes, "
+                              << m_factor.factor_blocks() << " blocks in the factor of "
+                              << blocks << ".\n";
+  }
+
+  Vector<double> SupernodalCholeskySolver::solve( math::MatrixSparseSkyline<double>& S,
+                                                  Vector<double> const& e ) {
+    math::MatrixSparseSkyline<double> const& s = S;
+    const size_t n = m_factor.block_size();
+    Matrix<double> block( n, n );
+    m_factor.clear();
+    for ( size_t j = 0; j < m_pattern.size(); j++ ) {
+      for ( size_t r = 0; r < n; r++ )
+        for ( size_t c = 0; c <= r; c++ )
+          block(r,c) = s( j*n + r, j*n + c );
+      m_factor.set_block( j, j, block );
+      for ( size_t k = 0; k < m_pattern[j].size(); k++ ) {
+        size_t i = m_pattern[j][k];
+        for ( size_t r = 0; r < n; r++ )
+          for ( size_t c = 0; c < n; c++ )
+            block(r,c) = s( i*n + r, j*n + c );
+        m_factor.set_block( i, j, block );
+      }
+    }
+
+    if ( !m_factor.factor() ) {
+      vw_out(WarningMessage,"ba") << "Reduced camera system is not positive definite.\n";
+      Vector<double> x( e.size() );
+      for ( size_t i = 0; i < x.size(); i++ )
+        x[i] = std::numeric_limits<double>::quiet_NaN();
+      return x;
+    }
+    return m_factor.solve( e );
+  }
+
+}} // namespace vw::ba
@@ -0,0 +1,80 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file ReducedCameraSolver.h
+///
+/// Linear solvers for the reduced camera system of sparse bundle
+/// adjustment, S * delta_a = e, where S is the Schur complement of the
+/// points in the normal equations.  S is made of square blocks, one
+/// row and column of them for each camera, and the block of two
+/// cameras is nonzero only if they see a point in common.
+
+#ifndef __VW_BUNDLEADJUSTMENT_REDUCED_CAMERA_SOLVER_H__
+#define __VW_BUNDLEADJUSTMENT_REDUCED_CAMERA_SOLVER_H__
+
+#include <vw/Math/Vector.h>
+#include <vw/Math/MatrixSparseSkyline.h>
+#include <vw/Math/SparseBlockCholesky.h>
+
+#include <vector>
+
+namespace vw {
+namespace ba {
+
+  class ReducedCameraSolver {
+  public:
+    virtual ~ReducedCameraSolver() {}
+
+    /// Called before the first solve with the size of the blocks and,
+    /// for each camera j, the cameras after it that it shares points
+    /// with.  The pattern is the same in every solve that follows.
+    virtual void analyze( size_t block_size,
+                          std::vector<std::vector<size_t> > const& lower_pattern ) = 0;
+
+    /// Solves S x = e.  S holds the lower triangle of the system and
+    /// may be overwritten.
+    virtual Vector<double> solve( math::MatrixSparseSkyline<double>& S,
+                                  Vector<double> const& e ) = 0;
+  };
+
+  /// L*D*L^T decomposition of S in place, after a Cuthill-McKee
+  /// reordering that narrows its skyline.  The ordering is found from
+  /// the first S solved.
+  class SkylineLDLSolver : public ReducedCameraSolver {
+    size_t m_block_size;
+    std::vector<size_t> m_ordering;
+    Vector<size_t> m_skyline;
+    bool m_found_ordering;
+  public:
+    SkylineLDLSolver() : m_block_size(1), m_found_ordering(false) {}
+
+    virtual void analyze( size_t block_size,
+                          std::vector<std::vector<size_t> > const& lower_pattern );
+    virtual Vector<double> solve( math::MatrixSparseSkyline<double>& S,
+                                  Vector<double> const& e );
+  };
+
+  /// Supernodal Cholesky factorization of S, after a minimum degree
+  /// ordering of the cameras.  The ordering and the pattern of the
+  /// factor are worked out once from the pattern analyzed, and each
+  /// solve only copies the values in and factors them.  Fills in much
+  /// less than the skyline does on loosely connected networks.
+  class SupernodalCholeskySolver : public ReducedCameraSolver {
+    math::SparseBlockCholesky m_factor;
+    std::vector<std::vector<size_t> > m_pattern;
+  public:
+    virtual void analyze( size_t block_size,
+                          std::vector<std::vector<size_t> > const& lower_pattern );
+
+    /// Returns NaNs if S is not positive definite.
+    virtual Vector<double> solve( math::MatrixSparseSkyline<double>& S,
+                                  Vector<double> const& e );
+  };
+
+}} // namespace vw::ba
+
+#endif // __VW_BUNDLEADJUSTMENT_REDUCED_CAMERA_SOLVER_H__
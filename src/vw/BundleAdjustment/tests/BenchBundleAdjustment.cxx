@@ -0,0 +1,307 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// BenchBundleAdjustment.cxx
+//
+// End-to-end benchmarks for the sparse bundle adjusters, on a
+// synthetic aerial survey: a grid of downward looking pinhole cameras
+// over a rolling surface, with noisy (and some grossly wrong) pixel
+// measures, and cameras and tie points moved away from the truth.  A
+// few ground control points hold the network in place.  Run by "make
+// benchmark", not by "make check".  Each stage prints a CSV line: its
+// name, the seconds it took to build the adjuster and iterate to
+// convergence, the resident set high-water mark during the stage in
+// megabytes, the iterations, the RMS reprojection error of the
+// measures that are not outliers in pixels, and the mean errors of the
+// camera centers and the tie points.
+//
+//   BenchBundleAdjustment [--cameras <n>] [--points <n>] [--gcps <n>]
+//                         [--noise <pixels>] [--outliers <fraction>]
+//                         [--iterations <n>] [--threads <n>] [--filter <substring>]
+
+#include <vw/Core/Stopwatch.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/EulerAngles.h>
+#include <vw/Camera/PinholeModel.h>
+#include <vw/BundleAdjustment/AdjustSparse.h>
+#include <vw/BundleAdjustment/AdjustRobustSparse.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <sys/resource.h>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+
+using namespace vw;
+using namespace vw::camera;
+using namespace vw::ba;
+
+namespace {
+
+  struct Options {
+    int32 cameras, points, gcps, iterations, threads;
+    double noise, outliers;
+    std::string filter;
+    Options() : cameras(16), points(2000), gcps(10), iterations(20), threads(1),
+                noise(0.5), outliers(0.02) {}
+  };
+
+  // The same model as the unit tests: each camera is adjusted by a
+  // translation and a rotation, given as Euler angles.
+  class BenchModel : public ModelBase<BenchModel, 6, 3> {
+    typedef Vector<double, 6> camera_vector_t;
+    typedef Vector<double, 3> point_vector_t;
+
+    std::vector<boost::shared_ptr<PinholeModel> > m_cameras;
+    boost::shared_ptr<ControlNetwork> m_cnet;
+    std::vector<camera_vector_t> a;
+    std::vector<point_vector_t> b, b_target;
+    size_t m_num_pixel_observations;
+
+  public:
+    BenchModel( std::vector<boost::shared_ptr<PinholeModel> > const& cameras,
+                boost::shared_ptr<ControlNetwork> network )
+      : m_cameras(cameras), m_cnet(network), a(cameras.size()), m_num_pixel_observations(0) {
+      for( size_t i = 0; i < m_cnet->size(); ++i ) {
+        m_num_pixel_observations += (*m_cnet)[i].size();
+        b.push_back( (*m_cnet)[i].position() );
+      }
+      b_target = b;
+    }
+
+    Vector2 operator()( size_t /*i*/, size_t j, camera_vector_t const& a_j, point_vector_t const& b_i ) const {
+      AdjustedCameraModel cam( m_cameras[j], subvector(a_j,0,3),
+                               math::euler_to_quaternion(a_j[3],a_j[4],a_j[5],"xyz") );
+      return cam.point_to_pixel( b_i );
+    }
+
+    Matrix<double,6,6> A_inverse_covariance( size_t /*j*/ ) {
+      Matrix<double,6,6> result;
+      result.set_identity();
+      return result;
+    }
+    // Ground control points are known to a tenth of a unit.
+    Matrix<double,3,3> B_inverse_covariance( size_t /*i*/ ) {
+      Matrix<double,3,3> result;
+      result.set_identity();
+      return result * 100;
+    }
+
+    size_t num_cameras() const { return a.size(); }
+    size_t num_points() const { return b.size(); }
+    camera_vector_t A_parameters( size_t j ) const { return a[j]; }
+    point_vector_t B_parameters( size_t i ) const { return b[i]; }
+    camera_vector_t A_target( size_t /*j*/ ) const { return camera_vector_t(); }
+    point_vector_t B_target( size_t i ) const { return b_target[i]; }
+    size_t num_pixel_observations() const { return m_num_pixel_observations; }
+    void set_A_parameters( size_t j, camera_vector_t const& a_j ) { a[j] = a_j; }
+    void set_B_parameters( size_t i, point_vector_t const& b_i ) { b[i] = b_i; }
+    boost::shared_ptr<ControlNetwork> control_network() { return m_cnet; }
+  };
+
+  // The truth, and the network as it is handed to the adjusters.
+  struct Survey {
+    std::vector<Vector3> true_centers, true_points;
+    std::vector<boost::shared_ptr<PinholeModel> > cameras;
+    boost::shared_ptr<ControlNetwork> cnet;
+    std::vector<std::vector<bool> > outlier;  // per point, per measure
+  };
+
+  double surface( double x, double y ) {
+    return 2 * std::sin( x * 0.1 ) * std::cos( y * 0.07 );
+  }
+
+  Survey make_survey( Options const& opt ) {
+    typedef boost::mt19937 gen_type;
+    gen_type gen( 42 );
+    boost::variate_generator<gen_type&, boost::normal_distribution<> > normal( gen, boost::normal_distribution<>() );
+    boost::variate_generator<gen_type&, boost::uniform_real<> > uniform( gen, boost::uniform_real<>() );
+
+    // The cameras fly at a height of 50 in rows 15 apart, each seeing
+    // about 50x50 of the ground, so that neighbours overlap by two
+    // thirds.
+    Survey survey;
+    const double height = 50, spacing = 15, focal = 1000, size = 1000;
+    int32 columns = int32( std::ceil( std::sqrt( double( opt.cameras ) ) ) );
+    int32 rows = ( opt.cameras + columns - 1 ) / columns;
+    for( int32 c = 0; c < opt.cameras; ++c ) {
+      Vector3 center( ( c % columns - ( columns - 1 ) / 2.0 ) * spacing,
+                      ( c / columns - ( rows - 1 ) / 2.0 ) * spacing, height );
+      Matrix<double,3,3> pose = math::euler_to_rotation_matrix( M_PI + 0.01 * normal(), 0.01 * normal(),
+                                                                0.01 * normal(), "xyz" );
+      survey.true_centers.push_back( center );
+      survey.cameras.push_back( boost::shared_ptr<PinholeModel>(
+        new PinholeModel( center, pose, focal, focal, size / 2, size / 2 ) ) );
+    }
+
+    // Points are kept if at least two cameras see them.
+    survey.cnet.reset( new ControlNetwork( "Benchmark" ) );
+    BBox2 image( 0, 0, size, size );
+    double half_x = ( columns - 1 ) * spacing / 2 + 20, half_y = ( rows - 1 ) * spacing / 2 + 20;
+    int32 attempts = 0;
+    while( int32( survey.true_points.size() ) < opt.points && attempts++ < 100 * opt.points ) {
+      double x = ( 2 * uniform() - 1 ) * half_x, y = ( 2 * uniform() - 1 ) * half_y;
+      Vector3 position( x, y, surface( x, y ) );
+      bool gcp = int32( survey.true_points.size() ) < opt.gcps;
+      ControlPoint cpoint( gcp ? ControlPoint::GroundControlPoint : ControlPoint::TiePoint );
+      std::vector<bool> outlier;
+      for( size_t j = 0; j < survey.cameras.size(); ++j ) {
+        Vector2 pixel = survey.cameras[j]->point_to_pixel( position );
+        if( !image.contains( pixel ) )
+          continue;
+        bool bad = uniform() < opt.outliers;
+        pixel += bad ? Vector2( 50 * ( 2 * uniform() - 1 ), 50 * ( 2 * uniform() - 1 ) )
+                     : Vector2( opt.noise * normal(), opt.noise * normal() );
+        cpoint.add_measure( ControlMeasure( pixel[0], pixel[1], 1, 1, j ) );
+        outlier.push_back( bad );
+      }
+      if( cpoint.size() < 2 )
+        continue;
+      survey.true_points.push_back( position );
+      survey.outlier.push_back( outlier );
+      if( gcp ) {
+        cpoint.set_position( position );
+        cpoint.set_sigma( Vector3( 0.1, 0.1, 0.1 ) );
+      } else {
+        cpoint.set_position( position + Vector3( normal(), normal(), normal() ) );
+        cpoint.set_sigma( Vector3( 1, 1, 1 ) );
+      }
+      survey.cnet->add_control_point( cpoint );
+    }
+
+    // The cameras start a unit or so from where they are.
+    for( size_t j = 0; j < survey.cameras.size(); ++j )
+      survey.cameras[j]->set_camera_center( survey.true_centers[j] + Vector3( normal(), normal(), normal() ) );
+    return survey;
+  }
+
+  // The resident set high-water mark, in megabytes.  On Linux it can
+  // be reset between stages; elsewhere it is that of the whole run.
+  void reset_rss_peak() {
+    std::ofstream clear_refs( "/proc/self/clear_refs" );
+    clear_refs << "5";
+  }
+
+  double rss_peak_mb() {
+    std::ifstream status( "/proc/self/status" );
+    std::string line;
+    while( std::getline( status, line ) )
+      if( line.compare( 0, 6, "VmHWM:" ) == 0 )
+        return std::atof( line.c_str() + 6 ) / 1024;
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+#if defined(__APPLE__)
+    return usage.ru_maxrss / ( 1024.0 * 1024.0 );
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+  }
+
+  template <template <class, class> class AdjusterT, class CostT>
+  void run( Options const& opt, std::string const& name, Survey const& survey, CostT const& cost ) {
+    if( !opt.filter.empty() && name.find( opt.filter ) == std::string::npos )
+      return;
+
+    // Each stage starts from the same corrupted network.
+    std::vector<boost::shared_ptr<PinholeModel> > cameras;
+    for( size_t j = 0; j < survey.cameras.size(); ++j )
+      cameras.push_back( boost::shared_ptr<PinholeModel>( new PinholeModel( *survey.cameras[j] ) ) );
+    boost::shared_ptr<ControlNetwork> cnet( new ControlNetwork( *survey.cnet ) );
+    BenchModel model( cameras, cnet );
+
+    reset_rss_peak();
+    uint64 start = Stopwatch::microtime();
+    int32 iterations;
+    {
+      AdjusterT<BenchModel, CostT> adjuster( model, cost, false, true );
+      adjuster.set_num_threads( opt.threads );
+      double abs_tol = 1e10, rel_tol = 1e10;
+      while( adjuster.iterations() < opt.iterations && abs_tol > 1e-3 && rel_tol > 1e-3 )
+        if( !adjuster.update( abs_tol, rel_tol ) )
+          break;
+      iterations = adjuster.iterations();
+    }
+    double seconds = ( Stopwatch::microtime() - start ) * 1e-6;
+    double rss_peak = rss_peak_mb();
+
+    double reprojection = 0, camera_error = 0, point_error = 0;
+    size_t inliers = 0, tie_points = 0;
+    for( size_t i = 0; i < cnet->size(); ++i ) {
+      ControlPoint const& cpoint = (*cnet)[i];
+      for( size_t m = 0; m < cpoint.size(); ++m ) {
+        if( survey.outlier[i][m] )
+          continue;
+        size_t j = cpoint[m].image_id();
+        reprojection += norm_2_sqr( model( i, j, model.A_parameters(j), model.B_parameters(i) )
+                                    - cpoint[m].position() );
+        inliers++;
+      }
+      if( cpoint.type() == ControlPoint::TiePoint ) {
+        point_error += norm_2( model.B_parameters(i) - survey.true_points[i] );
+        tie_points++;
+      }
+    }
+    for( size_t j = 0; j < cameras.size(); ++j )
+      camera_error += norm_2( cameras[j]->camera_center() + subvector( model.A_parameters(j), 0, 3 )
+                              - survey.true_centers[j] );
+
+    std::cout << name << "," << seconds << "," << rss_peak << "," << iterations << ","
+              << ( inliers ? std::sqrt( reprojection / inliers ) : 0 ) << ","
+              << camera_error / cameras.size() << ","
+              << ( tie_points ? point_error / tie_points : 0 ) << std::endl;
+  }
+}
+
+int main( int argc, char *argv[] ) {
+  Options opt;
+  for( int i = 1; i < argc; ++i ) {
+    if( std::strcmp( argv[i], "--cameras" ) == 0 && i+1 < argc )
+      opt.cameras = std::atoi( argv[++i] );
+    else if( std::strcmp( argv[i], "--points" ) == 0 && i+1 < argc )
+      opt.points = std::atoi( argv[++i] );
+    else if( std::strcmp( argv[i], "--gcps" ) == 0 && i+1 < argc )
+      opt.gcps = std::atoi( argv[++i] );
+    else if( std::strcmp( argv[i], "--noise" ) == 0 && i+1 < argc )
+      opt.noise = std::atof( argv[++i] );
+    else if( std::strcmp( argv[i], "--outliers" ) == 0 && i+1 < argc )
+      opt.outliers = std::atof( argv[++i] );
+    else if( std::strcmp( argv[i], "--iterations" ) == 0 && i+1 < argc )
+      opt.iterations = std::atoi( argv[++i] );
+    else if( std::strcmp( argv[i], "--threads" ) == 0 && i+1 < argc )
+      opt.threads = std::atoi( argv[++i] );
+    else if( std::strcmp( argv[i], "--filter" ) == 0 && i+1 < argc )
+      opt.filter = argv[++i];
+    else {
+      std::cerr << "Usage: " << argv[0] << " [--cameras <n>] [--points <n>] [--gcps <n>]\n"
+                << "         [--noise <pixels>] [--outliers <fraction>]\n"
+                << "         [--iterations <n>] [--threads <n>] [--filter <substring>]" << std::endl;
+      return 1;
+    }
+  }
+  if( opt.cameras < 2 || opt.points < 1 || opt.gcps < 0 || opt.iterations < 1 || opt.threads < 1 ) {
+    std::cerr << "Bad options: there must be at least two cameras, a point, "
+              << "an iteration and a thread." << std::endl;
+    return 1;
+  }
+
+  Survey survey = make_survey( opt );
+
+  std::cout << "stage,seconds,rss_peak_mb,iterations,reprojection_rms,camera_error,point_error" << std::endl;
+  run<AdjustSparse>( opt, "sparse/l2", survey, L2Error() );
+  run<AdjustSparse>( opt, "sparse/cauchy", survey, CauchyError( 2 ) );
+  run<AdjustRobustSparse>( opt, "robust_sparse/l2", survey, L2Error() );
+  run<AdjustRobustSparse>( opt, "robust_sparse/cauchy", survey, CauchyError( 2 ) );
+
+  return 0;
+}
@@ -306,6 +306,86 @@ TEST_F( ComparisonTest, Ref_VS_Sparse ) {
                         1e-3 );
 }
 
+TEST_F( ComparisonTest, Sparse_VS_ThreadedSparse ) {
+  std::vector<Vector<double> > single_solution;
+  std::vector<Vector<double> > threaded_solution;
+
+  for ( size_t threads = 1; threads <= 3; threads += 2 ) {
+    TestBAModel model( cameras, cnet );
+    AdjustSparse< TestBAModel, L2Error > adjuster( model, L2Error(), false, false);
+    adjuster.set_num_threads( threads );
+
+    // Running BA
+    double abs_tol = 1e10, rel_tol = 1e10;
+    for ( unsigned i = 0; i < 10; i++ )
+      adjuster.update(abs_tol,rel_tol);
+
+    // Storing result
+    for ( uint32 i = 0; i < 5; i++ )
+      ( threads == 1 ? single_solution : threaded_solution ).push_back( model.A_parameters(i) );
+  }
+
+  // Comparison
+  for ( uint32 i = 0; i < 5; i++ )
+    EXPECT_VECTOR_NEAR( single_solution[i],
+                        threaded_solution[i],
+                        1e-6 );
+}
+
+TEST_F( ComparisonTest, Skyline_VS_Supernodal ) {
+  std::vector<Vector<double> > skyline_solution;
+  std::vector<Vector<double> > supernodal_solution;
+
+  for ( int supernodal = 0; supernodal < 2; supernodal++ ) {
+    TestBAModel model( cameras, cnet );
+    AdjustSparse< TestBAModel, L2Error > adjuster( model, L2Error(), false, false);
+    if ( supernodal )
+      adjuster.set_linear_solver( boost::shared_ptr<ReducedCameraSolver>( new SupernodalCholeskySolver() ) );
+
+    // Running BA
+    double abs_tol = 1e10, rel_tol = 1e10;
+    for ( unsigned i = 0; i < 10; i++ )
+      adjuster.update(abs_tol,rel_tol);
+
+    // Storing result
+    for ( uint32 i = 0; i < 5; i++ )
+      ( supernodal ? supernodal_solution : skyline_solution ).push_back( model.A_parameters(i) );
+  }
+
+  // Comparison
+  for ( uint32 i = 0; i < 5; i++ )
+    EXPECT_VECTOR_NEAR( skyline_solution[i],
+                        supernodal_solution[i],
+                        1e-6 );
+}
+
+TEST_F( ComparisonTest, Sparse_VS_ConjugateGradient ) {
+  std::vector<Vector<double> > direct_solution;
+  std::vector<Vector<double> > cg_solution;
+
+  for ( int cg = 0; cg < 2; cg++ ) {
+    TestBAModel model( cameras, cnet );
+    AdjustSparse< TestBAModel, L2Error > adjuster( model, L2Error(), false, false);
+    if ( cg )
+      adjuster.set_conjugate_gradient( 100, 1e-12 );
+
+    // Running BA
+    double abs_tol = 1e10, rel_tol = 1e10;
+    for ( unsigned i = 0; i < 10; i++ )
+      adjuster.update(abs_tol,rel_tol);
+
+    // Storing result
+    for ( uint32 i = 0; i < 5; i++ )
+      ( cg ? cg_solution : direct_solution ).push_back( model.A_parameters(i) );
+  }
+
+  // Comparison
+  for ( uint32 i = 0; i < 5; i++ )
+    EXPECT_VECTOR_NEAR( direct_solution[i],
+                        cg_solution[i],
+                        1e-4 );
+}
+
 // For whatever reason .. RobustRef and RobustSparse diverge
 // quickly. This is probably do to unwise application of floats or
 // arithmetic ordering.
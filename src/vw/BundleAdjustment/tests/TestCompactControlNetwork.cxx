@@ -0,0 +1,84 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+
+#include <vw/BundleAdjustment/CompactControlNetwork.h>
+
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::ba;
+
+TEST( CompactControlNetwork, Conversion ) {
+
+  ControlNetwork cnet( "TestCNET" );
+
+  // Point i is seen by cameras 3-i to 3, in reverse
+  for ( uint32 i = 0; i < 4; i++ ) {
+    ControlPoint cpoint( i == 0 ? ControlPoint::GroundControlPoint :
+                         ControlPoint::TiePoint );
+    cpoint.set_position( Vector3( i, 2*i, 3*i ) );
+    cpoint.set_sigma( Vector3( 1, 1, i ) );
+    for ( uint32 j = 0; j < i+1; j++ )
+      cpoint.add_measure( ControlMeasure( 10*i+j, 20, 1, 2, 3-j ) );
+    cnet.add_control_point( cpoint );
+  }
+
+  CompactControlNetwork compact( cnet );
+  ASSERT_EQ( 4u, compact.num_cameras() );
+  ASSERT_EQ( 4u, compact.num_points() );
+  ASSERT_EQ( 10u, compact.num_measures() );
+
+  // Camera 3 sees every point, camera 0 only the last
+  EXPECT_EQ( 4u, compact.camera_end(3) - compact.camera_begin(3) );
+  EXPECT_EQ( 1u, compact.camera_end(0) - compact.camera_begin(0) );
+  for ( size_t j = 0; j < 4; j++ )
+    for ( size_t k = compact.camera_begin(j); k < compact.camera_end(j); k++ ) {
+      EXPECT_EQ( j, compact.camera_id(k) );
+      if ( k > compact.camera_begin(j) )
+        EXPECT_LT( compact.point_id(k-1), compact.point_id(k) );
+      EXPECT_VECTOR_DOUBLE_EQ( Vector2f( 10*compact.point_id(k) + 3-j, 20 ),
+                               compact.pixel(k) );
+      EXPECT_VECTOR_DOUBLE_EQ( Vector2f( 1, 2 ), compact.sigma(k) );
+    }
+
+  // Each point lists its measures in camera order
+  for ( size_t i = 0; i < 4; i++ ) {
+    ASSERT_EQ( i+1, compact.point_end(i) - compact.point_begin(i) );
+    for ( size_t n = compact.point_begin(i); n < compact.point_end(i); n++ ) {
+      EXPECT_EQ( i, compact.point_id( compact.point_measure(n) ) );
+      EXPECT_EQ( 3-i + n-compact.point_begin(i), compact.camera_id( compact.point_measure(n) ) );
+    }
+    EXPECT_VECTOR_DOUBLE_EQ( cnet[i].position(), compact.position(i) );
+    EXPECT_VECTOR_DOUBLE_EQ( cnet[i].sigma(), compact.point_sigma(i) );
+    EXPECT_EQ( cnet[i].type(), compact.point_type(i) );
+  }
+
+  // And back, with each point's measures in camera order
+  ControlNetwork result( "Result" );
+  compact.write_controlnetwork( result );
+  ASSERT_EQ( cnet.size(), result.size() );
+  for ( size_t i = 0; i < cnet.size(); i++ ) {
+    ASSERT_EQ( cnet[i].size(), result[i].size() );
+    EXPECT_EQ( cnet[i].type(), result[i].type() );
+    EXPECT_VECTOR_DOUBLE_EQ( cnet[i].position(), result[i].position() );
+    for ( size_t m = 0; m < cnet[i].size(); m++ ) {
+      ControlMeasure const& original = cnet[i][cnet[i].size()-1-m];
+      EXPECT_EQ( original.image_id(), result[i][m].image_id() );
+      EXPECT_VECTOR_DOUBLE_EQ( original.position(), result[i][m].position() );
+      EXPECT_VECTOR_DOUBLE_EQ( original.sigma(), result[i][m].sigma() );
+    }
+  }
+}
+
+TEST( CompactControlNetwork, Empty ) {
+  CompactControlNetwork compact;
+  EXPECT_EQ( 0u, compact.num_cameras() );
+  EXPECT_EQ( 0u, compact.num_points() );
+  EXPECT_EQ( 0u, compact.num_measures() );
+}
@@ -9,11 +9,45 @@
 
 #include <sstream>
 #include <vw/BundleAdjustment/ControlNetwork.h>
+#include <boost/foreach.hpp>
 
 #include <test/Helpers.h>
 
 using namespace vw;
 using namespace vw::ba;
+using namespace vw::test;
+
+// A network of more than one chunk, with measures that differ
+static ControlNetwork make_network( size_t points ) {
+  ControlNetwork cnet( "TestCNET" );
+  for ( uint32 i = 0; i < points; i++ ) {
+    ControlPoint cpoint( i % 2 ? ControlPoint::TiePoint : ControlPoint::GroundControlPoint );
+    cpoint.set_position( Vector3( i, 1, 2 ) );
+    cpoint.set_id( "point" );
+    for ( uint32 j = 0; j < i % 3 + 1; j++ ) {
+      ControlMeasure cm( i, j, 1, 2, j );
+      cm.set_serial( "serial" );
+      cpoint.add_measure( cm );
+    }
+    cnet.add_control_point( cpoint );
+  }
+  return cnet;
+}
+
+static void expect_equal( ControlNetwork const& expected, ControlNetwork const& actual ) {
+  ASSERT_EQ( expected.size(), actual.size() );
+  for ( size_t i = 0; i < expected.size(); i++ ) {
+    ASSERT_EQ( expected[i].size(), actual[i].size() );
+    EXPECT_EQ( expected[i].type(), actual[i].type() );
+    EXPECT_EQ( expected[i].id(), actual[i].id() );
+    EXPECT_VECTOR_DOUBLE_EQ( expected[i].position(), actual[i].position() );
+    for ( size_t m = 0; m < expected[i].size(); m++ ) {
+      EXPECT_EQ( expected[i][m].image_id(), actual[i][m].image_id() );
+      EXPECT_EQ( expected[i][m].serial(), actual[i][m].serial() );
+      EXPECT_VECTOR_DOUBLE_EQ( expected[i][m].position(), actual[i][m].position() );
+    }
+  }
+}
 
 TEST( ControlNetwork, Construction ) {
 
@@ -77,3 +111,43 @@ TEST( ControlNetwork, Construction ) {
   cnet.clear();
   ASSERT_EQ( cnet.size(), 0u );
 }
+
+TEST( ControlNetwork, Binary ) {
+  ControlNetwork cnet = make_network( 2*ControlNetwork::points_per_chunk + 10 );
+  UnlinkName file( "chunked.cnet" );
+  cnet.write_binary( file );
+
+  ControlNetwork streamed( "streamed" );
+  streamed.read_binary( file );
+  expect_equal( cnet, streamed );
+
+  ControlNetwork mapped( "mapped" );
+  mapped.read_binary( file, true );
+  expect_equal( cnet, mapped );
+
+  EXPECT_THROW( mapped.read_binary( "nonexistent.cnet", true ), IOErr );
+}
+
+TEST( ControlNetwork, BinaryUnchunked ) {
+  // Networks written before the points were chunked are still read
+  ControlNetwork cnet = make_network( 10 );
+  UnlinkName file( "unchunked.cnet" );
+  {
+    std::ofstream f( file.c_str(), std::ios::binary );
+    f << "Unknown" << char(0) << "Null" << char(0) << "Null" << char(0)
+      << "Null" << char(0) << "Null" << char(0) << "VW" << char(0);
+    f.write( (char*)&cnet.m_type, sizeof(cnet.m_type) );
+    int size = cnet.size();
+    f.write( (char*)&size, sizeof(size) );
+    BOOST_FOREACH( ControlPoint const& cp, cnet )
+      cp.write_binary( f );
+  }
+
+  ControlNetwork streamed( "streamed" );
+  streamed.read_binary( file );
+  expect_equal( cnet, streamed );
+
+  ControlNetwork mapped( "mapped" );
+  mapped.read_binary( file, true );
+  expect_equal( cnet, mapped );
+}
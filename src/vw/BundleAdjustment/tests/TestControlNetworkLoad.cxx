@@ -9,6 +9,8 @@
 
 #include <sstream>
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
+#include <vw/Camera/PinholeModel.h>
+#include <vw/InterestPoint/InterestData.h>
 
 #include <test/Helpers.h>
 
@@ -67,3 +69,45 @@ TEST( ControlNetworkLoad, LoadingGCPNET ) {
   ASSERT_EQ( 2u, net.size() );
   EXPECT_EQ( ControlPoint::GroundControlPoint, net[1].type() );
 }
+
+static ip::InterestPoint project( camera::CameraModel const& camera, Vector3 const& point ) {
+  Vector2 pixel = camera.point_to_pixel( point );
+  return ip::InterestPoint( pixel[0], pixel[1] );
+}
+
+TEST( ControlNetworkLoad, BuildControlNetwork ) {
+  std::vector<std::string> image_names;
+  std::vector<boost::shared_ptr<camera::CameraModel> > cameras;
+  for ( int j = 0; j < 3; j++ ) {
+    image_names.push_back( std::string("cnetload") + char('a'+j) + ".tif" );
+    cameras.push_back( boost::shared_ptr<camera::CameraModel>(
+      new camera::PinholeModel( Vector3(j-1,0,0), math::identity_matrix<3>(),
+                                500, 500, 250, 250 ) ) );
+  }
+
+  // P is seen by all three images, through two match files.  Q is
+  // matched around the images back to a different place in the first,
+  // so it is a spiral error.
+  Vector3 P(0.2,0.1,10), Q(-0.3,0.2,12), R(-0.3,0.25,12);
+  std::vector<ip::InterestPoint> ab1, ab2, bc1, bc2, ca1, ca2;
+  ab1.push_back( project( *cameras[0], P ) ); ab2.push_back( project( *cameras[1], P ) );
+  bc1.push_back( project( *cameras[1], P ) ); bc2.push_back( project( *cameras[2], P ) );
+  ab1.push_back( project( *cameras[0], Q ) ); ab2.push_back( project( *cameras[1], Q ) );
+  bc1.push_back( project( *cameras[1], Q ) ); bc2.push_back( project( *cameras[2], Q ) );
+  ca1.push_back( project( *cameras[2], Q ) ); ca2.push_back( project( *cameras[0], R ) );
+  UnlinkName ab("cnetloada__cnetloadb.match"), bc("cnetloadb__cnetloadc.match"),
+    ca("cnetloadc__cnetloada.match");
+  ip::write_binary_match_file( ab, ab1, ab2 );
+  ip::write_binary_match_file( bc, bc1, bc2 );
+  ip::write_binary_match_file( ca, ca1, ca2 );
+
+  ControlNetwork cnet("built");
+  build_control_network( cnet, cameras, image_names, 1,
+                         std::vector<std::string>(1,TEST_OBJDIR) );
+  ASSERT_EQ( 1u, cnet.size() );
+  ASSERT_EQ( 3u, cnet[0].size() );
+  for ( size_t m = 0; m < 3; m++ )
+    EXPECT_VECTOR_NEAR( cameras[cnet[0][m].image_id()]->point_to_pixel(P),
+                        cnet[0][m].position(), 1e-3 );
+  EXPECT_VECTOR_NEAR( P, cnet[0].position(), 1e-3 );
+}
@@ -0,0 +1,69 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+
+#include <vw/BundleAdjustment/ModelBase.h>
+
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::ba;
+
+// A pinhole camera at a_j(0..2), rotated by the euler angles
+// a_j(3..5), looking at the point b_i.
+template <class T>
+Vector<T,2> pinhole_project( Vector<T,6> const& a_j, Vector<T,3> const& b_i ) {
+  Vector<T,3> p = b_i - subvector( a_j, 0, 3 );
+  Vector<T,3> q;
+  for ( size_t k = 0; k < 3; k++ ) {
+    size_t u = k == 2 ? 0 : k + 1, v = k == 0 ? 2 : k - 1;
+    T c = cos( a_j(3+k) ), s = sin( a_j(3+k) );
+    q(u) = c * p(u) - s * p(v);
+    q(v) = s * p(u) + c * p(v);
+    q(k) = p(k);
+    p = q;
+  }
+  Vector<T,2> result;
+  result(0) = 500 * p(0) / p(2);
+  result(1) = 500 * p(1) / p(2);
+  return result;
+}
+
+struct AutoModel : public AutoDiffModelBase<AutoModel, 6, 3> {
+  template <class T>
+  Vector<T,2> project( size_t /*i*/, size_t /*j*/,
+                       Vector<T,6> const& a_j, Vector<T,3> const& b_i ) const {
+    return pinhole_project( a_j, b_i );
+  }
+};
+
+struct NumericModel : public ModelBase<NumericModel, 6, 3> {
+  Vector2 operator() ( size_t /*i*/, size_t /*j*/,
+                       Vector<double,6> const& a_j, Vector<double,3> const& b_i ) const {
+    return pinhole_project( a_j, b_i );
+  }
+};
+
+TEST( ModelBase, AutoDiff ) {
+  Vector<double,6> a;
+  subvector( a, 0, 3 ) = Vector3( 0.1, -0.2, -5 );
+  subvector( a, 3, 3 ) = Vector3( 0.05, -0.1, 0.2 );
+  Vector<double,3> b( 0.5, 0.3, 4 );
+  AutoModel automatic;
+  NumericModel numeric;
+
+  EXPECT_VECTOR_NEAR( numeric( 0, 0, a, b ), automatic( 0, 0, a, b ), 1e-12 );
+  EXPECT_MATRIX_NEAR( numeric.A_jacobian( 0, 0, a, b ),
+                      automatic.A_jacobian( 0, 0, a, b ), 1e-2 );
+  EXPECT_MATRIX_NEAR( numeric.B_jacobian( 0, 0, a, b ),
+                      automatic.B_jacobian( 0, 0, a, b ), 1e-2 );
+
+  // Moving the point along its ray doesn't change its projection.
+  Vector<double,3> ray = b - subvector( a, 0, 3 );
+  EXPECT_VECTOR_NEAR( Vector2(), automatic.B_jacobian( 0, 0, a, b ) * ray, 1e-9 );
+}
@@ -0,0 +1,165 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Camera/BayerFilter.h>
+
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define VW_FAST_DEMOSAIC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+  using namespace vw;
+  using namespace vw::camera;
+
+#if VW_FAST_DEMOSAIC_SSE2
+
+  // ---------------------------------------------------------------
+  // SSE2: every row is converted to float32 once, into a ring of the
+  // five rows the filters span, and four pixels are computed at a
+  // time.  Each is computed both as a green and as a red or blue
+  // sample, and the right one picked by a mask that is the same for
+  // every group of four in a row.  The sums are exact in float32 for
+  // 8 and 16 bit samples, so the results are those of the generic
+  // version.
+  // ---------------------------------------------------------------
+
+  template <class ChannelT>
+  struct DemosaicOutput {
+    // Clamped and rounded, ready to narrow.
+    typedef int32 type;
+    static inline void store( type* dst, __m128 v ) {
+      static const __m128 lo = _mm_set1_ps( float(boost::integer_traits<ChannelT>::const_min) );
+      static const __m128 hi = _mm_set1_ps( float(boost::integer_traits<ChannelT>::const_max) );
+      v = _mm_add_ps( _mm_min_ps( _mm_max_ps( v, lo ), hi ), _mm_set1_ps( 0.5f ) );
+      _mm_storeu_si128( (__m128i*)dst, _mm_cvttps_epi32( v ) );
+    }
+  };
+
+  template <>
+  struct DemosaicOutput<float32> {
+    typedef float32 type;
+    static inline void store( type* dst, __m128 v ) { _mm_storeu_ps( dst, v ); }
+  };
+
+  inline __m128 select( __m128 mask, __m128 a, __m128 b ) {
+    return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+  }
+
+  template <class ChannelT>
+  void demosaic_sse2( ChannelT const* src, ssize_t src_stride, PixelRGB<ChannelT>* dst, ssize_t dst_stride,
+                      int32 cols, int32 rows, BayerPattern pattern, DemosaicMethod method ) {
+    typedef typename DemosaicOutput<ChannelT>::type out_type;
+
+    // Rows of the ring have two samples of margin on each side, and
+    // room for a last group of four that runs past the block.
+    const int32 groups = ( cols + 3 ) / 4;
+    const int32 width = groups * 4 + 4;
+    std::vector<float32> ring_buffer( 5 * width, 0.0f );
+    std::vector<out_type> out_buffer( 3 * groups * 4 );
+    float32* ring[5];
+    out_type *out_r = &out_buffer[0], *out_g = out_r + groups * 4, *out_b = out_g + groups * 4;
+
+    for( int32 k = 0; k < 4; ++k ) {
+      ChannelT const* s = src + ( k - 2 ) * src_stride - 2;
+      float32* r = &ring_buffer[k * width];
+      for( int32 x = 0; x < cols + 4; ++x )
+        r[x] = float32( s[x] );
+    }
+
+    const __m128 half = _mm_set1_ps( 0.5f ), quarter = _mm_set1_ps( 0.25f ), eighth = _mm_set1_ps( 0.125f );
+    const __m128 two = _mm_set1_ps( 2.0f ), four = _mm_set1_ps( 4.0f ), five = _mm_set1_ps( 5.0f );
+    const __m128 six = _mm_set1_ps( 6.0f ), one_half = _mm_set1_ps( 1.5f );
+    const bool malvar = method == DEMOSAIC_MALVAR;
+
+    for( int32 y = 0; y < rows; ++y ) {
+      // Bring in row y+2, over the one that is no longer needed.
+      {
+        float32* r = &ring_buffer[( ( y + 4 ) % 5 ) * width];
+        ChannelT const* s = src + ( y + 2 ) * src_stride - 2;
+        for( int32 x = 0; x < cols + 4; ++x )
+          r[x] = float32( s[x] );
+      }
+      for( int32 k = 0; k < 5; ++k )
+        ring[k] = &ring_buffer[( ( y + k ) % 5 ) * width] + 2;
+
+      BayerPattern row_pattern = bayer_pattern_at( pattern, 0, y );
+      const bool red_row = row_pattern == BAYER_RGGB || row_pattern == BAYER_GRBG;
+      const bool green_first = row_pattern == BAYER_GRBG || row_pattern == BAYER_GBRG;
+      const __m128 green = _mm_castsi128_ps( green_first ? _mm_set_epi32( 0, -1, 0, -1 ) : _mm_set_epi32( -1, 0, -1, 0 ) );
+
+      float32 const *n2 = ring[0], *n1 = ring[1], *r0 = ring[2], *s1 = ring[3], *s2 = ring[4];
+      for( int32 g = 0; g < groups; ++g ) {
+        const int32 x = g * 4;
+        __m128 c = _mm_loadu_ps( r0 + x );
+        __m128 hor = _mm_add_ps( _mm_loadu_ps( r0 + x - 1 ), _mm_loadu_ps( r0 + x + 1 ) );
+        __m128 ver = _mm_add_ps( _mm_loadu_ps( n1 + x ), _mm_loadu_ps( s1 + x ) );
+        __m128 diag = _mm_add_ps( _mm_add_ps( _mm_loadu_ps( n1 + x - 1 ), _mm_loadu_ps( n1 + x + 1 ) ),
+                                  _mm_add_ps( _mm_loadu_ps( s1 + x - 1 ), _mm_loadu_ps( s1 + x + 1 ) ) );
+        __m128 hg, vg, gnon, opp;
+        if( malvar ) {
+          __m128 hor2 = _mm_add_ps( _mm_loadu_ps( r0 + x - 2 ), _mm_loadu_ps( r0 + x + 2 ) );
+          __m128 ver2 = _mm_add_ps( _mm_loadu_ps( n2 + x ), _mm_loadu_ps( s2 + x ) );
+          __m128 both2 = _mm_add_ps( hor2, ver2 );
+          hg = _mm_mul_ps( _mm_add_ps( _mm_sub_ps( _mm_add_ps( _mm_mul_ps( c, five ), _mm_mul_ps( hor, four ) ), hor2 ),
+                                       _mm_sub_ps( _mm_mul_ps( ver2, half ), diag ) ), eighth );
+          vg = _mm_mul_ps( _mm_add_ps( _mm_sub_ps( _mm_add_ps( _mm_mul_ps( c, five ), _mm_mul_ps( ver, four ) ), ver2 ),
+                                       _mm_sub_ps( _mm_mul_ps( hor2, half ), diag ) ), eighth );
+          gnon = _mm_mul_ps( _mm_sub_ps( _mm_add_ps( _mm_mul_ps( c, four ), _mm_mul_ps( _mm_add_ps( ver, hor ), two ) ),
+                                         both2 ), eighth );
+          opp = _mm_mul_ps( _mm_sub_ps( _mm_add_ps( _mm_mul_ps( c, six ), _mm_mul_ps( diag, two ) ),
+                                        _mm_mul_ps( both2, one_half ) ), eighth );
+        } else {
+          hg = _mm_mul_ps( hor, half );
+          vg = _mm_mul_ps( ver, half );
+          gnon = _mm_mul_ps( _mm_add_ps( ver, hor ), quarter );
+          opp = _mm_mul_ps( diag, quarter );
+        }
+        __m128 p = select( green, hg, c );
+        __m128 q = select( green, vg, opp );
+        DemosaicOutput<ChannelT>::store( out_r + x, red_row ? p : q );
+        DemosaicOutput<ChannelT>::store( out_g + x, select( green, c, gnon ) );
+        DemosaicOutput<ChannelT>::store( out_b + x, red_row ? q : p );
+      }
+
+      PixelRGB<ChannelT>* d = dst + y * dst_stride;
+      for( int32 x = 0; x < cols; ++x )
+        d[x] = PixelRGB<ChannelT>( ChannelT( out_r[x] ), ChannelT( out_g[x] ), ChannelT( out_b[x] ) );
+    }
+  }
+
+#endif // VW_FAST_DEMOSAIC_SSE2
+
+  template <class ChannelT>
+  inline void demosaic_fast( ChannelT const* src, ssize_t src_stride, PixelRGB<ChannelT>* dst, ssize_t dst_stride,
+                             int32 cols, int32 rows, BayerPattern pattern, DemosaicMethod method ) {
+#if VW_FAST_DEMOSAIC_SSE2
+    demosaic_sse2( src, src_stride, dst, dst_stride, cols, rows, pattern, method );
+#else
+    demosaic_block_generic( src, src_stride, dst, dst_stride, cols, rows, pattern, method );
+#endif
+  }
+
+} // namespace
+
+void vw::camera::demosaic_block( uint8 const* src, ssize_t src_stride, PixelRGB<uint8>* dst, ssize_t dst_stride,
+                                 int32 cols, int32 rows, BayerPattern pattern, DemosaicMethod method ) {
+  demosaic_fast( src, src_stride, dst, dst_stride, cols, rows, pattern, method );
+}
+
+void vw::camera::demosaic_block( uint16 const* src, ssize_t src_stride, PixelRGB<uint16>* dst, ssize_t dst_stride,
+                                 int32 cols, int32 rows, BayerPattern pattern, DemosaicMethod method ) {
+  demosaic_fast( src, src_stride, dst, dst_stride, cols, rows, pattern, method );
+}
+
+void vw::camera::demosaic_block( float32 const* src, ssize_t src_stride, PixelRGB<float32>* dst, ssize_t dst_stride,
+                                 int32 cols, int32 rows, BayerPattern pattern, DemosaicMethod method ) {
+  demosaic_fast( src, src_stride, dst, dst_stride, cols, rows, pattern, method );
+}
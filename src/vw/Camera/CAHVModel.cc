@@ -78,6 +78,27 @@ namespace camera {
     return vec;
   }
 
+  void CAHVModel::points_to_pixels(std::vector<Vector3> const& points,
+                                   std::vector<Vector2>& pixels) const {
+    pixels.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+      Vector3 vec = points[i] - C;
+      double dDot = dot_prod(vec, A);
+      pixels[i] = Vector2( dot_prod(vec, H) / dDot,
+                           dot_prod(vec, V) / dDot );
+    }
+  }
+
+  void CAHVModel::pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                    std::vector<Vector3>& vectors) const {
+    // The handedness of the system is the same for every pixel
+    const double sign = dot_prod(cross_prod(V, H), A) < 0.0 ? -1.0 : 1.0;
+    vectors.resize(pixels.size());
+    for (size_t i = 0; i < pixels.size(); ++i)
+      vectors[i] = sign * normalize(cross_prod(V - pixels[i].y() * A,
+                                               H - pixels[i].x() * A));
+  }
+
   // --------------------------------------------------
   //                 Private Methods
   // --------------------------------------------------
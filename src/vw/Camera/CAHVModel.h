@@ -149,6 +149,10 @@ namespace camera {
     virtual Vector2 point_to_pixel(Vector3 const& point) const;
     virtual Vector3 pixel_to_vector (Vector2 const& pix) const;
     virtual Vector3 camera_center(Vector2 const& /*pix*/ = Vector2() ) const { return C; };
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>& pixels) const;
+    virtual void pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                   std::vector<Vector3>& vectors) const;
 
     /// Write CAHV model to file
     void write(std::string const& filename);
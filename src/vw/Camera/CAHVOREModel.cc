@@ -121,13 +121,15 @@ void vw::camera::CAHVOREModel::write(std::string const& filename) {
 
 vw::Vector3 CAHVOREModel::pixel_to_vector(vw::Vector2 const& pix) const {
   // Based on JPL's cmod_cahvore_2d_to_3d
-  Vector3 result;
 
   // Calculate initial terms
   Vector3 w3 = cross_prod(V - pix[1]*A,
                           H - pix[0]*A);
-  Vector3 rp = (1/dot_prod(A,cross_prod(V,H))) * w3;
+  return ray_to_vector( (1/dot_prod(A,cross_prod(V,H))) * w3 );
+}
 
+vw::Vector3 CAHVOREModel::ray_to_vector(vw::Vector3 const& rp) const {
+  Vector3 result;
   double zetap = dot_prod(rp,O);
   Vector3 lambdap3 = rp - zetap*O;
   double lambdap = norm_2(lambdap3);
@@ -253,6 +255,33 @@ Vector2 CAHVOREModel::point_to_pixel(vw::Vector3 const& point) const {
                   dot_prod(rp,V) / alpha );
 }
 
+void CAHVOREModel::points_to_pixels(std::vector<Vector3> const& points,
+                                    std::vector<Vector2>& pixels) const {
+  pixels.resize(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    try {
+      pixels[i] = CAHVOREModel::point_to_pixel(points[i]);
+    } catch (const PointToPixelErr& /*e*/) {
+      pixels[i] = Vector2(HUGE_VAL, HUGE_VAL);
+    }
+  }
+}
+
+void CAHVOREModel::pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                     std::vector<Vector3>& vectors) const {
+  // The scale of the linear ray is the same for every pixel
+  const double scale = 1/dot_prod(A,cross_prod(V,H));
+  vectors.resize(pixels.size());
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    try {
+      vectors[i] = ray_to_vector( scale * cross_prod(V - pixels[i][1]*A,
+                                                     H - pixels[i][0]*A) );
+    } catch (const PixelToRayErr& /*e*/) {
+      vectors[i] = Vector3();
+    }
+  }
+}
+
 CAHVModel camera::linearize_camera( CAHVOREModel const& camera_model,
                                     Vector2i const& cahvore_image_size,
                                     Vector2i const& cahv_image_size ) {
@@ -65,6 +65,10 @@ namespace camera {
     virtual Vector2 point_to_pixel(Vector3 const& point) const;
     virtual Vector3 pixel_to_vector(Vector2 const& pix) const;
     virtual Vector3 camera_center(Vector2 const& /*pix*/ = Vector2() ) const { return C; };
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>& pixels) const;
+    virtual void pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                   std::vector<Vector3>& vectors) const;
 
     /// Write CAHVORE model to file.
     void write(std::string const& filename);
@@ -82,6 +86,10 @@ namespace camera {
     double    P; // We don't have T as it is redundant information
   private:
     bool check_line( std::istream& istream, char letter );
+
+    // The pointing vector of rp, the ray through a pixel in the linear
+    // (CAHV) part of the model, scaled by 1/(A.(VxH))
+    Vector3 ray_to_vector( Vector3 const& rp ) const;
   };
 
   // Function to "map" the CAHVORE parameters into CAHV:
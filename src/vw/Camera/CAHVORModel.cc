@@ -281,6 +281,10 @@ Vector3 camera::CAHVORModel::pixel_to_vector(Vector2 const& pix) const {
   if (dot_prod(cross_prod(V,H), A) < 0)
     rr = -1.0 * rr;
 
+  return remove_distortion(rr);
+}
+
+Vector3 camera::CAHVORModel::remove_distortion(Vector3 const& rr) const {
   // Remove the radial lens distortion.  Preliminary values of
   // omega, lambda, and tau are computed from the rr vector
   // including distortion, in order to obtain the coefficients of
@@ -322,6 +326,16 @@ Vector3 camera::CAHVORModel::pixel_to_vector(Vector2 const& pix) const {
   return normalize(rr - (1 - u)*lambda);
 }
 
+void camera::CAHVORModel::pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                            std::vector<Vector3>& vectors) const {
+  // The vector directions are checked once for all pixels
+  const double sgn = dot_prod(cross_prod(V,H), A) < 0 ? -1.0 : 1.0;
+  vectors.resize(pixels.size());
+  for (size_t i = 0; i < pixels.size(); ++i)
+    vectors[i] = remove_distortion(sgn * normalize(cross_prod(V - pixels[i].y() * A,
+                                                              H - pixels[i].x() * A)));
+}
+
 
 // vector_to_pixel with partial_derivatives
 Vector2 camera::CAHVORModel::point_to_pixel(Vector3 const& point,
@@ -421,6 +435,13 @@ Vector2 camera::CAHVORModel::point_to_pixel(Vector3 const& point) const {
                   dot_prod(pp_c,V) / alpha );
 }
 
+void camera::CAHVORModel::points_to_pixels(std::vector<Vector3> const& points,
+                                           std::vector<Vector2>& pixels) const {
+  pixels.resize(points.size());
+  for (size_t i = 0; i < points.size(); ++i)
+    pixels[i] = CAHVORModel::point_to_pixel(points[i]);
+}
+
 // linearize_camera
 //
 // Takes CAHVOR camera --> CAHV camera
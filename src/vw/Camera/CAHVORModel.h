@@ -52,6 +52,10 @@ namespace camera {
     virtual Vector2 point_to_pixel(Vector3 const& point) const;
     virtual Vector3 pixel_to_vector(Vector2 const& pix) const;
     virtual Vector3 camera_center(Vector2 const& /*pix*/ = Vector2() ) const { return C; };
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>& pixels) const;
+    virtual void pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                   std::vector<Vector3>& vectors) const;
 
     // Overloaded versions also return partial derviatives in a Matrix.
     Vector2 point_to_pixel(Vector3 const& point, Matrix<double> &partial_derivatives) const;
@@ -73,6 +77,10 @@ namespace camera {
     Vector3   V;
     Vector3   O;
     Vector3   R;
+  private:
+    // Removes the radial distortion from rr, the unit ray through a
+    // pixel in the linear (CAHV) part of the model
+    Vector3 remove_distortion(Vector3 const& rr) const;
   };
 
   /// Function to "map" the CAHVOR parameters into CAHV parameters:
@@ -10,6 +10,48 @@
 using namespace vw;
 using namespace vw::camera;
 
+void CameraModel::points_to_pixels(std::vector<Vector3> const& points,
+                                   std::vector<Vector2>& pixels) const {
+  pixels.resize(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    try {
+      pixels[i] = this->point_to_pixel(points[i]);
+    } catch (const PointToPixelErr& /*e*/) {
+      pixels[i] = Vector2(HUGE_VAL, HUGE_VAL);
+    }
+  }
+}
+
+void CameraModel::pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                    std::vector<Vector3>& vectors) const {
+  vectors.resize(pixels.size());
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    try {
+      vectors[i] = this->pixel_to_vector(pixels[i]);
+    } catch (const PixelToRayErr& /*e*/) {
+      vectors[i] = Vector3();
+    }
+  }
+}
+
+void CameraModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                 std::vector<Vector3>& centers,
+                                 std::vector<Vector3>& directions) const {
+  this->pixels_to_vectors(pixels, directions);
+  centers.resize(pixels.size());
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    if (directions[i] == Vector3()) {
+      centers[i] = Vector3();
+      continue;
+    }
+    try {
+      centers[i] = this->camera_center(pixels[i]);
+    } catch (const PixelToRayErr& /*e*/) {
+      centers[i] = directions[i] = Vector3();
+    }
+  }
+}
+
 Vector3 AdjustedCameraModel::axis_angle_rotation() const {
   Quat quat = this->rotation();
   return quat.axis_angle();
@@ -34,6 +76,35 @@ Vector3 AdjustedCameraModel::camera_center(Vector2 const& pix) const {
   return m_camera->camera_center(pix) + m_translation;
 }
 
+void AdjustedCameraModel::points_to_pixels(std::vector<Vector3> const& points,
+                                           std::vector<Vector2>& pixels) const {
+  Vector3 center = m_camera->camera_center(Vector2(0,0));
+  std::vector<Vector3> new_points(points.size());
+  for (size_t i = 0; i < points.size(); ++i)
+    new_points[i] = m_rotation_inverse.rotate(points[i]-center-m_translation) + center;
+  m_camera->points_to_pixels(new_points, pixels);
+}
+
+void AdjustedCameraModel::pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                            std::vector<Vector3>& vectors) const {
+  m_camera->pixels_to_vectors(pixels, vectors);
+  for (size_t i = 0; i < pixels.size(); ++i)
+    if (vectors[i] != Vector3())
+      vectors[i] = m_rotation.rotate(vectors[i]);
+}
+
+void AdjustedCameraModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                         std::vector<Vector3>& centers,
+                                         std::vector<Vector3>& directions) const {
+  m_camera->pixels_to_rays(pixels, centers, directions);
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    if (directions[i] == Vector3())
+      continue;
+    directions[i] = m_rotation.rotate(directions[i]);
+    centers[i] += m_translation;
+  }
+}
+
 Quat AdjustedCameraModel::camera_pose(Vector2 const& pix) const {
   return m_rotation*m_camera->camera_pose(pix);
 }
@@ -14,6 +14,7 @@
 #define __VW_CAMERA_CAMERAMODEL_H__
 
 #include <fstream>
+#include <vector>
 #include <vw/Math/Quaternion.h>
 
 namespace vw {
@@ -72,6 +73,34 @@ namespace camera {
     /// intersection in a stereo vision algorithm).
     virtual Vector3 camera_center(Vector2 const& pix) const = 0;
 
+    /// Projects many points at once, as point_to_pixel() would each of
+    /// them.  A point that cannot be imaged gets the pixel
+    /// (HUGE_VAL,HUGE_VAL) instead of a PointToPixelErr.  The default
+    /// loops over point_to_pixel(); camera models override it to work
+    /// out the parts of the projection common to all points only once.
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>& pixels) const;
+
+    /// Finds the pointing vectors through many pixels at once, as
+    /// pixel_to_vector() would for each of them.  A pixel with no ray
+    /// gets a zero vector instead of a PixelToRayErr.  As with
+    /// points_to_pixels(), the default loops and camera models may
+    /// override it.
+    virtual void pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                   std::vector<Vector3>& vectors) const;
+
+    /// Finds the rays through many pixels at once: the camera center
+    /// and pointing vector of each pixel, as camera_center() and
+    /// pixel_to_vector() would return them.  A pixel with no ray gets
+    /// a zero pointing vector instead of a PixelToRayErr.  The default
+    /// finds the pointing vectors with pixels_to_vectors().  Camera
+    /// models whose rays depend on costly per-line state, such as the
+    /// pose of a linescan camera, can override this to compute that
+    /// state once for each line.
+    virtual void pixels_to_rays(std::vector<Vector2> const& pixels,
+                                std::vector<Vector3>& centers,
+                                std::vector<Vector3>& directions) const;
+
     /// Subclasses must define a method that return the camera type as a string.
     virtual std::string type() const = 0;
 
@@ -132,6 +161,13 @@ namespace camera {
     virtual Vector2 point_to_pixel (Vector3 const&) const;
     virtual Vector3 pixel_to_vector (Vector2 const&) const;
     virtual Vector3 camera_center (Vector2 const&) const;
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>& pixels) const;
+    virtual void pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                   std::vector<Vector3>& vectors) const;
+    virtual void pixels_to_rays(std::vector<Vector2> const& pixels,
+                                std::vector<Vector3>& centers,
+                                std::vector<Vector3>& directions) const;
     virtual Quat camera_pose(Vector2 const&) const;
 
     void write(std::string const&);
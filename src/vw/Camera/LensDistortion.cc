@@ -8,6 +8,8 @@
 #include <vw/Camera/LensDistortion.h>
 #include <vw/Camera/PinholeModel.h>
 #include <vw/Math/LevenbergMarquardt.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 
 using namespace vw;
 
@@ -141,6 +143,83 @@ vw::camera::AdjustableTsaiLensDistortion::distorted_coordinates(const camera::Pi
   return elem_prod(result+Vector2(m_distortion[m_distortion.size()-1]*result.y(),0),focal)+offset;
 }
 
+// Undistortion Map --------------------------------------------
+
+// Fills the table rows of an undistortion map in [row_begin,row_end), or,
+// once they are all filled, measures the interpolation error at the
+// centres of the cells below grid rows [row_begin,row_end).
+class UndistortionMapTask : public Task, private boost::noncopyable {
+  camera::PinholeModel const& m_cam;
+  camera::LensDistortion const& m_distort;
+  camera::UndistortionMap const& m_map;
+  std::vector<Vector2>& m_table;
+  Vector2 m_origin;
+  double m_spacing;
+  int32 m_cols, m_row_begin, m_row_end;
+  bool m_check;
+  double& m_error;
+public:
+  UndistortionMapTask( camera::PinholeModel const& cam, camera::LensDistortion const& distort,
+                       camera::UndistortionMap const& map, std::vector<Vector2>& table,
+                       Vector2 const& origin, double spacing, int32 cols,
+                       int32 row_begin, int32 row_end, bool check, double& error ) :
+    m_cam(cam), m_distort(distort), m_map(map), m_table(table), m_origin(origin),
+    m_spacing(spacing), m_cols(cols), m_row_begin(row_begin), m_row_end(row_end),
+    m_check(check), m_error(error) {}
+
+  void operator()() {
+    double pitch = m_cam.pixel_pitch();
+    for ( int32 r = m_row_begin; r < m_row_end; r++ ) {
+      if ( !m_check ) {
+        for ( int32 c = 0; c < m_cols + 2; c++ )
+          m_table[r*(m_cols+2) + c] =
+            m_distort.undistorted_coordinates( m_cam, (m_origin + m_spacing*Vector2(c-1,r-1))*pitch );
+        continue;
+      }
+      for ( int32 c = 0; c + 1 < m_cols; c++ ) {
+        Vector2 pix = m_origin + m_spacing*Vector2(c+0.5,r+0.5);
+        double error = norm_2( m_map( pix ) - m_distort.undistorted_coordinates( m_cam, pix*pitch ) );
+        m_error = std::max( m_error, error / pitch );
+      }
+    }
+  }
+};
+
+vw::camera::UndistortionMap::UndistortionMap( camera::PinholeModel const& cam,
+                                              boost::shared_ptr<const LensDistortion> const& distortion,
+                                              BBox2i const& region, double spacing ) :
+  m_distortion(distortion), m_focal_length(cam.focal_length()), m_point_offset(cam.point_offset()),
+  m_pixel_pitch(cam.pixel_pitch()), m_origin(region.min()), m_spacing(spacing), m_max_error(0) {
+  VW_ASSERT( spacing > 0 && !region.empty(),
+             ArgumentErr() << "UndistortionMap: requires a positive spacing and a nonempty region." );
+  m_cols = std::max( int32( ceil( region.width() / spacing ) ), 1 ) + 1;
+  m_rows = std::max( int32( ceil( region.height() / spacing ) ), 1 ) + 1;
+  m_stride = m_cols + 2;
+  m_table.resize( m_stride * ( m_rows + 2 ) );
+
+  // The table is filled first, then the cell centres checked against it
+  const int32 threads = std::max( int32(vw_settings().default_num_threads()), 1 );
+  for ( int pass = 0; pass < 2; pass++ ) {
+    const int32 rows = pass ? m_rows - 1 : m_rows + 2;
+    const int32 block = rows / (4*threads) + 1;
+    std::vector<double> errors( rows / block + 1, 0 );
+    FifoWorkQueue queue( threads );
+    for ( int32 r = 0, b = 0; r < rows; r += block, b++ ) {
+      boost::shared_ptr<Task> task( new UndistortionMapTask( cam, *distortion, *this, m_table, m_origin,
+                                                             m_spacing, m_cols, r, std::min( r + block, rows ),
+                                                             pass == 1, errors[b] ) );
+      queue.add_task( task );
+    }
+    queue.join_all();
+    m_max_error = *std::max_element( errors.begin(), errors.end() );
+  }
+}
+
+bool vw::camera::UndistortionMap::valid_for( camera::PinholeModel const& cam ) const {
+  return cam.lens_distortion() == m_distortion.get() && cam.pixel_pitch() == m_pixel_pitch &&
+    cam.focal_length() == m_focal_length && cam.point_offset() == m_point_offset;
+}
+
 std::ostream& vw::camera::operator<<(std::ostream & os,
                                      const camera::LensDistortion& ld) {
   ld.write(os);
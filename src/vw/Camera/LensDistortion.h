@@ -35,8 +35,11 @@
 #define __VW_CAMERA_LENSDISTORTION_H__
 
 #include <vw/Math/Vector.h>
+#include <vw/Math/BBox.h>
 #include <boost/shared_ptr.hpp>
+#include <algorithm>
 #include <string>
+#include <vector>
 
 namespace vw {
 namespace camera {
@@ -219,6 +222,78 @@ namespace camera {
     }
   };
 
+  /// Undistortion Map
+  ///
+  /// Undistorting a pixel for most models means solving for it with
+  /// Levenberg-Marquardt.  This instead samples undistorted_coordinates()
+  /// once at the nodes of a regular grid over a region of pixels, and
+  /// interpolates pixels bicubically between them.  The interpolation error is
+  /// measured at the centre of every cell when the map is built and is
+  /// reported by max_error(), in pixels.
+  ///
+  /// The map is built for the camera's intrinsics, pixel pitch and
+  /// distortion model at that time; valid_for() tells whether a camera
+  /// still matches them.
+  class UndistortionMap {
+    boost::shared_ptr<const LensDistortion> m_distortion;
+    Vector2 m_focal_length, m_point_offset;
+    double m_pixel_pitch;
+    Vector2 m_origin;
+    double m_spacing;
+    int32 m_cols, m_rows, m_stride;
+    std::vector<Vector2> m_table;
+    double m_max_error;
+
+    static void catmull_rom_weights( double t, double w[4] ) {
+      double t2 = t*t, t3 = t2*t;
+      w[0] = 0.5*( -t3 + 2*t2 - t );
+      w[1] = 0.5*( 3*t3 - 5*t2 + 2 );
+      w[2] = 0.5*( -3*t3 + 4*t2 + t );
+      w[3] = 0.5*( t3 - t2 );
+    }
+
+  public:
+    /// Samples distortion over region with nodes spacing pixels apart.
+    /// The table is filled across the default number of threads.
+    UndistortionMap( PinholeModel const& camera,
+                     boost::shared_ptr<const LensDistortion> const& distortion,
+                     BBox2i const& region, double spacing );
+
+    /// Whether camera has the intrinsics and distortion the map was built for
+    bool valid_for( PinholeModel const& camera ) const;
+
+    /// Whether pix lies inside the grid
+    bool contains( Vector2 const& pix ) const {
+      double x = ( pix[0] - m_origin[0] ) / m_spacing, y = ( pix[1] - m_origin[1] ) / m_spacing;
+      return x >= 0 && y >= 0 && x <= m_cols - 1 && y <= m_rows - 1;
+    }
+
+    /// The undistorted coordinates of pixel pix, in the units of
+    /// undistorted_coordinates() (pixels times the pixel pitch), by
+    /// Catmull-Rom interpolation of the sixteen nearest nodes.  pix must
+    /// be inside the grid.
+    Vector2 operator()( Vector2 const& pix ) const {
+      double x = ( pix[0] - m_origin[0] ) / m_spacing, y = ( pix[1] - m_origin[1] ) / m_spacing;
+      int32 c = std::min( int32(x), m_cols - 2 ), r = std::min( int32(y), m_rows - 2 );
+      double wx[4], wy[4];
+      catmull_rom_weights( x - c, wx );
+      catmull_rom_weights( y - r, wy );
+      // The table has a border of one node around the grid
+      Vector2 const* p = &m_table[r*m_stride + c];
+      double u = 0, v = 0;
+      for ( int32 j = 0; j < 4; j++, p += m_stride ) {
+        double pu = wx[0]*p[0][0] + wx[1]*p[1][0] + wx[2]*p[2][0] + wx[3]*p[3][0];
+        double pv = wx[0]*p[0][1] + wx[1]*p[1][1] + wx[2]*p[2][1] + wx[3]*p[3][1];
+        u += wy[j]*pu;
+        v += wy[j]*pv;
+      }
+      return Vector2( u, v );
+    }
+
+    double spacing() const { return m_spacing; }
+    double max_error() const { return m_max_error; }
+  };
+
 }} // namespace vw::camera
 
 #endif // __VW_CAMERA_LENSDISTORTION_H__
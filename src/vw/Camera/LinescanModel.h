@@ -16,6 +16,9 @@
 #include <vw/Math/Quaternion.h>
 #include <vw/Camera/CameraModel.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace vw {
 namespace camera {
 
@@ -37,6 +40,41 @@ namespace camera {
     Vector3 m_pointing_vec;
     Vector3 m_u_vec;
 
+    // The plane seen by each scanline, as its unit normal and offset in
+    // world coordinates, so point_to_pixel() can find a point's line
+    // without evaluating the position and pose functions.
+    std::vector<Vector3> m_line_normals;
+    std::vector<double> m_line_offsets;
+
+    // The v pixel need not be an integer in every case, therefore we
+    // need to linearly interpolate line times that fall in between
+    // pixels.  Half a line past either end is extrapolated from the
+    // nearest interval.
+    double line_time(double v) const {
+      if (m_line_times.size() < 2)
+        return m_line_times[0];
+      int y = std::min(std::max(int(floor(v)), 0), int(m_line_times.size()) - 2);
+      double normy = v - y;
+      return double( m_line_times[y] + (m_line_times[y+1] - m_line_times[y]) * normy );
+    }
+
+    // Signed distance of point from the plane seen at time t
+    double plane_distance(Vector3 const& point, double t) const {
+      Vector3 normal = transpose(m_pose_func(t).rotation_matrix()) *
+        normalize(cross_prod(m_u_vec, m_pointing_vec));
+      return dot_prod(normal, point - m_position_func(t));
+    }
+
+    void build_line_planes() {
+      m_line_normals.resize(m_line_times.size());
+      m_line_offsets.resize(m_line_times.size());
+      Vector3 normal = normalize(cross_prod(m_u_vec, m_pointing_vec));
+      for (size_t i = 0; i < m_line_times.size(); ++i) {
+        m_line_normals[i] = transpose(m_pose_func(m_line_times[i]).rotation_matrix()) * normal;
+        m_line_offsets[i] = dot_prod(m_line_normals[i], m_position_func(m_line_times[i]));
+      }
+    }
+
   public:
     //------------------------------------------------------------------
     // Constructors / Destructors
@@ -74,6 +112,7 @@ namespace camera {
 
       m_pointing_vec = normalize(pointing_vec);
       m_u_vec = normalize(u_vec);
+      build_line_planes();
     }
 
     /// This version of the constructor assumes that the line
@@ -108,6 +147,7 @@ namespace camera {
 
       m_pointing_vec = normalize(pointing_vec);
       m_u_vec = normalize(u_vec);
+      build_line_planes();
     }
 
     virtual ~LinescanModel() {}
@@ -116,9 +156,55 @@ namespace camera {
     //------------------------------------------------------------------
     // Interface
     //------------------------------------------------------------------
-    virtual Vector2 point_to_pixel(Vector3 const& /*point*/) const {
-      vw_throw( vw::NoImplErr() << "LinescanModel::point_to_pixel is not yet implemented." );
-      return Vector2(); // never reached
+    /// Finds the scanline whose view plane contains the point, then
+    /// the sample along it.  The line is bracketed by bisecting the
+    /// table of per-line planes, which needs no pose or position
+    /// evaluations, and then refined with a few secant (Illinois) steps
+    /// on the exact plane distance between the two lines.  Points not
+    /// seen between the first and last lines, or behind the camera,
+    /// throw a PointToPixelErr.
+    virtual Vector2 point_to_pixel(Vector3 const& point) const {
+      int lo = 0, hi = int(m_line_normals.size()) - 1;
+      double f_lo = dot_prod(m_line_normals[lo], point) - m_line_offsets[lo];
+      double f_hi = dot_prod(m_line_normals[hi], point) - m_line_offsets[hi];
+      if ((f_lo > 0 && f_hi > 0) || (f_lo < 0 && f_hi < 0))
+        vw_throw( PointToPixelErr() << "LinescanModel: point " << point << " is not seen by any scanline." );
+      while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        double f_mid = dot_prod(m_line_normals[mid], point) - m_line_offsets[mid];
+        if ((f_mid > 0) == (f_lo > 0) && f_mid != 0) {
+          lo = mid; f_lo = f_mid;
+        } else {
+          hi = mid; f_hi = f_mid;
+        }
+      }
+
+      double v_lo = lo, v_hi = hi, v = lo;
+      int side = 0;
+      for (int i = 0; i < 20 && f_lo != f_hi; ++i) {
+        v = (v_lo*f_hi - v_hi*f_lo) / (f_hi - f_lo);
+        double f = plane_distance(point, line_time(v));
+        if (fabs(f) < 1e-12 || v_hi - v_lo < 1e-9)
+          break;
+        if ((f > 0) == (f_lo > 0)) {
+          v_lo = v; f_lo = f;
+          if (side == -1) f_hi /= 2;
+          side = -1;
+        } else {
+          v_hi = v; f_hi = f;
+          if (side == 1) f_lo /= 2;
+          side = 1;
+        }
+      }
+
+      // The sample is where the point falls along the scanline
+      double t = line_time(v);
+      Vector3 p_cam = m_pose_func(t).rotation_matrix() * (point - m_position_func(t));
+      double depth = dot_prod(p_cam, m_pointing_vec);
+      if (depth <= 0)
+        vw_throw( PointToPixelErr() << "LinescanModel: point " << point << " is behind the camera." );
+      double u = m_focal_length * dot_prod(p_cam, m_u_vec) / depth / m_across_scan_pixel_size - m_sample_offset;
+      return Vector2(u, v);
     }
 
     /// Given a pixel in image coordinates, what is the pointing
@@ -143,13 +229,7 @@ namespace camera {
       // The position and veloctiy are not actually needed, since we are
       // purely interested in returning the direction of the ray at this
       // point and not its origin.
-      //
-      // The v pixel need not be an integer in every case, therefore
-      // we need to linearly interpolate line times that fall in
-      // between pixels.
-      int y = int(floor(pix[1]));
-      double normy = pix[1] - y;
-      double approx_line_time = double( m_line_times[y] + (m_line_times[y+1] - m_line_times[y]) * normy );
+      double approx_line_time = line_time(v);
 
       Quaternion<double> pose = m_pose_func(approx_line_time);
       Matrix<double,3,3> rotation_matrix = transpose(pose.rotation_matrix());
@@ -171,16 +251,77 @@ namespace camera {
       if (int(round(pix[1])) < 0 || int(round(pix[1])) >= int(m_line_times.size()))
         vw_throw( PixelToRayErr() << "LinescanModel: requested pixel " << pix << " is not on a valid scanline." );
 
-      // The v pixel need not be an integer in every case, therefore
-      // we need to linearly interpolate line times that fall in
-      // between pixels.
-      int y = int(floor(pix[1]));
-      double normy = pix[1] - y;
-      double approx_line_time = double( m_line_times[y] + (m_line_times[y+1] - m_line_times[y]) * normy );
+      double approx_line_time = line_time(pix[1]);
 
       return m_position_func(approx_line_time);
     }
 
+    /// The rays of many pixels at once.  The pose and position are
+    /// found once for each run of pixels on the same line, rather than
+    /// twice for every pixel.
+    virtual void pixels_to_rays(std::vector<Vector2> const& pixels,
+                                std::vector<Vector3>& centers,
+                                std::vector<Vector3>& directions) const {
+      centers.resize(pixels.size());
+      directions.resize(pixels.size());
+
+      bool have_line = false, valid_line = false;
+      double line_v = 0;
+      Matrix<double,3,3> rotation_matrix;
+      Vector3 position;
+      for (size_t i = 0; i < pixels.size(); ++i) {
+        double u = pixels[i][0], v = pixels[i][1];
+        if (!have_line || v != line_v) {
+          have_line = true;
+          line_v = v;
+          valid_line = int(round(v)) >= 0 && int(round(v)) < int(m_line_times.size());
+          if (valid_line) {
+            double approx_line_time = line_time(v);
+            rotation_matrix = transpose(m_pose_func(approx_line_time).rotation_matrix());
+            position = m_position_func(approx_line_time);
+          }
+        }
+        if (!valid_line) {
+          centers[i] = directions[i] = Vector3();
+          continue;
+        }
+
+        double pixel_pos_u = (u + m_sample_offset) * m_across_scan_pixel_size;
+        Vector<double, 3> pixel_direction = pixel_pos_u * m_u_vec + m_focal_length * m_pointing_vec;
+        directions[i] = normalize(rotation_matrix * pixel_direction);
+        centers[i] = position;
+      }
+    }
+
+    /// The pointing vectors of many pixels at once, finding the pose
+    /// once for each run of pixels on the same line.
+    virtual void pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                   std::vector<Vector3>& vectors) const {
+      vectors.resize(pixels.size());
+
+      bool have_line = false, valid_line = false;
+      double line_v = 0;
+      Matrix<double,3,3> rotation_matrix;
+      for (size_t i = 0; i < pixels.size(); ++i) {
+        double u = pixels[i][0], v = pixels[i][1];
+        if (!have_line || v != line_v) {
+          have_line = true;
+          line_v = v;
+          valid_line = int(round(v)) >= 0 && int(round(v)) < int(m_line_times.size());
+          if (valid_line)
+            rotation_matrix = transpose(m_pose_func(line_time(v)).rotation_matrix());
+        }
+        if (!valid_line) {
+          vectors[i] = Vector3();
+          continue;
+        }
+
+        double pixel_pos_u = (u + m_sample_offset) * m_across_scan_pixel_size;
+        Vector<double, 3> pixel_direction = pixel_pos_u * m_u_vec + m_focal_length * m_pointing_vec;
+        vectors[i] = normalize(rotation_matrix * pixel_direction);
+      }
+    }
+
     /// Returns the pose (as a quaternion) of the camera for a given
     /// pixel.
     virtual Quaternion<double> camera_pose(Vector2 const& pix) const {
@@ -188,12 +329,7 @@ namespace camera {
       if (int(round(pix[1])) < 0 || int(round(pix[1])) >= int(m_line_times.size()))
         vw_throw( PixelToRayErr() << "LinescanModel::camera_pose(): requested pixel " << pix << " is not on a valid scanline." );
 
-      // The v pixel need not be an integer in every case, therefore
-      // we need to linearly interpolate line times that fall in
-      // between pixels.
-      int y = int(floor(pix[1]));
-      double normy = pix[1] - y;
-      double approx_line_time = double( m_line_times[y] + (m_line_times[y+1] - m_line_times[y]) * normy );
+      double approx_line_time = line_time(pix[1]);
 
       return m_pose_func(approx_line_time);
     }
@@ -219,7 +355,7 @@ namespace camera {
     virtual void set_along_scan_pixel_size(double val) { m_along_scan_pixel_size = val; }
     virtual void set_across_scan_pixel_size(double val) {m_across_scan_pixel_size = val; }
     virtual void set_focal_length(double val) {m_focal_length = val; }
-    virtual void set_line_times(std::vector<double> val) { m_line_times = val; }
+    virtual void set_line_times(std::vector<double> val) { m_line_times = val; build_line_planes(); }
   };
 
   /// Output stream method for printing a summary of the linear
@@ -297,7 +297,7 @@ bool camera::PinholeModel::projection_valid(Vector3 const& point) const {
 
 Vector3 camera::PinholeModel::pixel_to_vector (Vector2 const& pix) const {
   // Apply the inverse lens distortion model
-  Vector2 undistorted_pix = m_distortion->undistorted_coordinates(*this, pix*m_pixel_pitch);
+  Vector2 undistorted_pix = undistort( pix, has_undistortion_map() );
 
   // Compute the direction of the ray emanating from the camera center.
   Vector3 p(0,0,1);
@@ -305,6 +305,44 @@ Vector3 camera::PinholeModel::pixel_to_vector (Vector2 const& pix) const {
   return normalize( m_inv_camera_transform * p);
 }
 
+void camera::PinholeModel::points_to_pixels( std::vector<Vector3> const& points,
+                                             std::vector<Vector2>& pixels ) const {
+  const bool distorted = !dynamic_cast<const NullLensDistortion*>( m_distortion.get() );
+  pixels.resize( points.size() );
+  for ( size_t i = 0; i < points.size(); i++ ) {
+    Vector3 p = m_camera_matrix * Vector4( points[i][0], points[i][1], points[i][2], 1 );
+    Vector2 pixel( p[0] / p[2], p[1] / p[2] );
+    pixels[i] = distorted ? m_distortion->distorted_coordinates(*this, pixel)/m_pixel_pitch
+                          : pixel/m_pixel_pitch;
+  }
+}
+
+void camera::PinholeModel::pixels_to_vectors( std::vector<Vector2> const& pixels,
+                                              std::vector<Vector3>& vectors ) const {
+  const bool use_map = has_undistortion_map();
+  vectors.resize( pixels.size() );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    Vector2 undistorted_pix = undistort( pixels[i], use_map );
+    vectors[i] = normalize( m_inv_camera_transform *
+                            Vector3( undistorted_pix[0], undistorted_pix[1], 1 ) );
+  }
+}
+
+bool camera::PinholeModel::build_undistortion_map( BBox2i const& region, double tolerance,
+                                                   double spacing ) {
+  m_undistortion_map.reset();
+  while ( spacing >= 1 ) {
+    boost::shared_ptr<UndistortionMap> map( new UndistortionMap( *this, m_distortion, region, spacing ) );
+    if ( map->max_error() <= tolerance ) {
+      m_undistortion_map = map;
+      return true;
+    }
+    // The interpolation error falls with the fourth power of the spacing
+    spacing = std::min( spacing / 2, 0.8 * spacing * pow( tolerance / map->max_error(), 0.25 ) );
+  }
+  return false;
+}
+
 void camera::PinholeModel::intrinsic_parameters(double& f_u, double& f_v,
                                                 double& c_u, double& c_v) const {
   f_u = m_fu;  f_v = m_fv;  c_u = m_cu;  c_v = m_cv;
@@ -102,6 +102,15 @@ namespace camera {
 
     // Cached values for pixel_to_vector
     Matrix<double,3,3> m_inv_camera_transform;
+    boost::shared_ptr<const UndistortionMap> m_undistortion_map;
+
+    // The undistorted coordinates of pix, from the undistortion map
+    // when use_map is set and the map covers pix.
+    Vector2 undistort( Vector2 const& pix, bool use_map ) const {
+      if ( use_map && m_undistortion_map->contains(pix) )
+        return (*m_undistortion_map)(pix);
+      return m_distortion->undistorted_coordinates(*this, pix*m_pixel_pitch);
+    }
 
   public:
     //------------------------------------------------------------------
@@ -249,6 +258,13 @@ namespace camera {
     //  through the position of the pixel 'pix' on the image plane.
     virtual Vector3 pixel_to_vector (Vector2 const& pix) const;
 
+    // Batched point_to_pixel() and pixel_to_vector(), which check the
+    // lens distortion and undistortion map once for the whole batch.
+    virtual void points_to_pixels( std::vector<Vector3> const& points,
+                                   std::vector<Vector2>& pixels ) const;
+    virtual void pixels_to_vectors( std::vector<Vector2> const& pixels,
+                                    std::vector<Vector3>& vectors ) const;
+
     virtual Vector3 camera_center(Vector2 const& /*pix*/ = Vector2() ) const {
       return m_camera_center;
     };
@@ -300,6 +316,20 @@ namespace camera {
       m_distortion = distortion.copy();
     }
 
+    // Precompute the undistortion of the pixels in region on a grid,
+    // which pixel_to_vector() then interpolates instead of solving for
+    // each pixel. The grid starts at spacing pixels and is refined
+    // until the interpolation error is at most tolerance pixels; if
+    // that is not reached above a spacing of one pixel, no map is kept
+    // and false is returned. The map is ignored once the intrinsics,
+    // pixel pitch or lens distortion change.
+    bool build_undistortion_map( BBox2i const& region, double tolerance = 1e-3,
+                                 double spacing = 16 );
+    void clear_undistortion_map() { m_undistortion_map.reset(); }
+    bool has_undistortion_map() const {
+      return m_undistortion_map && m_undistortion_map->valid_for(*this);
+    }
+
     //  f_u and f_v :  focal length in horiz and vert. pixel units
     //  c_u and c_v :  principal point in pixel units
     void intrinsic_parameters(double& f_u, double& f_v,
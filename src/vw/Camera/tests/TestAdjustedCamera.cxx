@@ -89,3 +89,32 @@ TEST( AdjustedCameraModel, AdjustedConstruct ) {
     acos(dot_prod(Vector3(0,0,1),inverse(center_pose).rotate(adjcam2.pixel_to_vector(center_pixel))));
   EXPECT_LT( angle_from_z, 0.5 );
 }
+
+TEST( AdjustedCameraModel, PixelsToRays ) {
+  Matrix<double,3,3> pose = math::euler_to_rotation_matrix(1.3,2.0,-.7,"xyz");
+  boost::shared_ptr<CameraModel> pinhole(
+      new PinholeModel( Vector3(0,0,0), pose, 500,500, 500,500,
+                        NullLensDistortion()) );
+  AdjustedCameraModel adjcam( pinhole, Vector3(1,0,0),
+                              math::euler_to_quaternion(0.1,-0.2,0.3,"xyz") );
+
+  std::vector<Vector2> pixels;
+  pixels.push_back( Vector2(750,750) );
+  pixels.push_back( Vector2(55,677) );
+  std::vector<Vector3> centers, directions;
+  adjcam.pixels_to_rays( pixels, centers, directions );
+  ASSERT_EQ( 2u, directions.size() );
+  for ( size_t i = 0; i < pixels.size(); ++i ) {
+    EXPECT_VECTOR_NEAR( adjcam.camera_center(pixels[i]), centers[i], 1e-12 );
+    EXPECT_VECTOR_NEAR( adjcam.pixel_to_vector(pixels[i]), directions[i], 1e-12 );
+  }
+
+  std::vector<Vector3> points;
+  for ( size_t i = 0; i < pixels.size(); ++i )
+    points.push_back( centers[i] + 10*directions[i] );
+  std::vector<Vector2> projected;
+  adjcam.points_to_pixels( points, projected );
+  ASSERT_EQ( 2u, projected.size() );
+  for ( size_t i = 0; i < pixels.size(); ++i )
+    EXPECT_VECTOR_NEAR( pixels[i], projected[i], 1e-8 );
+}
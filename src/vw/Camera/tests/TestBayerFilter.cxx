@@ -0,0 +1,112 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+
+#include <vw/Camera/BayerFilter.h>
+#include <vw/Image/BlockRasterize.h>
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::camera;
+
+namespace {
+
+  // A mosaic of a smooth color image, with noise, in the given pattern.
+  template <class ChannelT>
+  ImageView<PixelGray<ChannelT> > mosaic( int32 cols, int32 rows, BayerPattern pattern, double scale ) {
+    ImageView<PixelGray<ChannelT> > image( cols, rows );
+    for( int32 j = 0; j < rows; ++j )
+      for( int32 i = 0; i < cols; ++i ) {
+        BayerPattern p = bayer_pattern_at( pattern, i, j );
+        double v;
+        if( p == BAYER_GRBG || p == BAYER_GBRG ) v = 0.5 + 0.3 * std::sin( i * 0.2 + j * 0.1 );
+        else if( p == BAYER_RGGB )               v = 0.4 + 0.3 * std::cos( i * 0.15 );
+        else                                     v = 0.6 + 0.3 * std::sin( j * 0.25 );
+        v += 0.1 * ( ( i * 7 + j * 13 ) % 5 ) / 5.0;
+        image(i,j) = ChannelT( v * scale );
+      }
+    return image;
+  }
+
+  template <class ChannelT>
+  ImageView<PixelRGB<ChannelT> > generic( ImageView<PixelGray<ChannelT> > const& image,
+                                          BayerPattern pattern, DemosaicMethod method ) {
+    ImageView<PixelGray<ChannelT> > src = edge_extend( image, BBox2i( -2, -2, image.cols() + 4, image.rows() + 4 ),
+                                                       ReflectEdgeExtension() );
+    ImageView<PixelRGB<ChannelT> > result( image.cols(), image.rows() );
+    demosaic_block_generic( &src(0,0).v() + 2 * src.cols() + 2, src.cols(), &result(0,0), result.cols(),
+                            result.cols(), result.rows(), pattern, method );
+    return result;
+  }
+
+  template <class ChannelT>
+  void check_matches_generic( double scale ) {
+    for( int32 pattern = 0; pattern < 4; ++pattern )
+      for( int32 method = 0; method < 2; ++method ) {
+        ImageView<PixelGray<ChannelT> > image = mosaic<ChannelT>( 37, 23, BayerPattern(pattern), scale );
+        ImageView<PixelRGB<ChannelT> > fast = bayer_demosaic( image, BayerPattern(pattern), DemosaicMethod(method) );
+        ImageView<PixelRGB<ChannelT> > slow = generic( image, BayerPattern(pattern), DemosaicMethod(method) );
+        for( int32 j = 0; j < image.rows(); ++j )
+          for( int32 i = 0; i < image.cols(); ++i )
+            for( int32 c = 0; c < 3; ++c )
+              ASSERT_EQ( slow(i,j)[c], fast(i,j)[c] ) << "pattern " << pattern << " method " << method
+                                                       << " at " << i << "," << j;
+      }
+  }
+}
+
+TEST( BayerFilter, PatternAt ) {
+  EXPECT_EQ( BAYER_RGGB, bayer_pattern_at( BAYER_RGGB, 0, 0 ) );
+  EXPECT_EQ( BAYER_GRBG, bayer_pattern_at( BAYER_RGGB, 1, 0 ) );
+  EXPECT_EQ( BAYER_GBRG, bayer_pattern_at( BAYER_RGGB, 0, 1 ) );
+  EXPECT_EQ( BAYER_BGGR, bayer_pattern_at( BAYER_RGGB, 3, 5 ) );
+  EXPECT_EQ( BAYER_RGGB, bayer_pattern_at( BAYER_BGGR, -1, 1 ) );
+}
+
+TEST( BayerFilter, ConstantColor ) {
+  // A uniform color must come back exactly, whatever the pattern.
+  for( int32 pattern = 0; pattern < 4; ++pattern )
+    for( int32 method = 0; method < 2; ++method ) {
+      ImageView<PixelGray<uint8> > image( 10, 9 );
+      for( int32 j = 0; j < image.rows(); ++j )
+        for( int32 i = 0; i < image.cols(); ++i ) {
+          BayerPattern p = bayer_pattern_at( BayerPattern(pattern), i, j );
+          image(i,j) = p == BAYER_RGGB ? 200 : p == BAYER_BGGR ? 30 : 100;
+        }
+      ImageView<PixelRGB<uint8> > rgb = bayer_demosaic( image, BayerPattern(pattern), DemosaicMethod(method) );
+      for( int32 j = 0; j < rgb.rows(); ++j )
+        for( int32 i = 0; i < rgb.cols(); ++i )
+          ASSERT_EQ( PixelRGB<uint8>( 200, 100, 30 ), rgb(i,j) ) << i << "," << j;
+    }
+}
+
+TEST( BayerFilter, MatchesGeneric ) {
+  check_matches_generic<uint8>( 255 );
+  check_matches_generic<uint16>( 65535 );
+}
+
+TEST( BayerFilter, Float ) {
+  ImageView<PixelGray<float32> > image = mosaic<float32>( 21, 14, BAYER_GBRG, 1.0 );
+  ImageView<PixelRGB<float32> > fast = bayer_demosaic( image, BAYER_GBRG, DEMOSAIC_MALVAR );
+  ImageView<PixelRGB<float32> > slow = generic( image, BAYER_GBRG, DEMOSAIC_MALVAR );
+  for( int32 j = 0; j < image.rows(); ++j )
+    for( int32 i = 0; i < image.cols(); ++i )
+      EXPECT_PIXEL_NEAR( slow(i,j), fast(i,j), 1e-5 );
+}
+
+TEST( BayerFilter, Blocks ) {
+  // Rasterizing in blocks, with odd offsets, gives the same image.
+  ImageView<PixelGray<uint16> > image = mosaic<uint16>( 50, 41, BAYER_GRBG, 4095 );
+  ImageView<PixelRGB<uint16> > whole = bayer_demosaic( image, BAYER_GRBG, DEMOSAIC_MALVAR );
+  ImageView<PixelRGB<uint16> > blocks = block_rasterize( bayer_demosaic( image, BAYER_GRBG, DEMOSAIC_MALVAR ),
+                                                         Vector2i( 13, 7 ), 1 );
+  for( int32 j = 0; j < image.rows(); ++j )
+    for( int32 i = 0; i < image.cols(); ++i )
+      ASSERT_EQ( whole(i,j), blocks(i,j) ) << i << "," << j;
+  EXPECT_EQ( whole(17,9), bayer_demosaic( image, BAYER_GRBG, DEMOSAIC_MALVAR )(17,9) );
+}
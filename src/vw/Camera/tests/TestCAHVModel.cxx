@@ -175,3 +175,29 @@ TEST( CAHVModel, ForwardReverse ) {
     }
   }
 }
+
+TEST( CAHVModel, Batch ) {
+  CAHVModel cam(Vector3(0.606583,-0.036214,-0.234717),
+                Vector3(0.708256,-0.0113108,0.705866),
+                Vector3(365.881,275.126,361.931),
+                Vector3(173.589,-3.95587,550.402));
+  std::vector<Vector2> pixels;
+  std::vector<Vector3> points;
+  for ( uint32 i = 100; i < 901; i += 200 )
+    for ( uint32 j = 100; j < 901; j += 200 ) {
+      pixels.push_back( Vector2(i,j) );
+      points.push_back( cam.C + 30*cam.pixel_to_vector( pixels.back() ) );
+    }
+
+  std::vector<Vector3> vectors;
+  std::vector<Vector2> projected;
+  cam.pixels_to_vectors( pixels, vectors );
+  cam.points_to_pixels( points, projected );
+  ASSERT_EQ( pixels.size(), vectors.size() );
+  ASSERT_EQ( points.size(), projected.size() );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    EXPECT_VECTOR_NEAR( cam.pixel_to_vector( pixels[i] ), vectors[i], 1e-12 );
+    EXPECT_VECTOR_NEAR( cam.point_to_pixel( points[i] ), projected[i], 1e-9 );
+    EXPECT_VECTOR_NEAR( pixels[i], projected[i], 1e-2 );
+  }
+}
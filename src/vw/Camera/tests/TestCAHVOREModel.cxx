@@ -84,3 +84,33 @@ TEST( CAHVOREModel, Linearize ) {
   EXPECT_VECTOR_NEAR(Vector3(177.463,13.6499,548.543),
                      cahv.V, 1e-2);
 }
+
+TEST( CAHVOREModel, Batch ) {
+  CAHVOREModel cam(Vector3(0.606185,-0.043367,-0.234891),
+                   Vector3(0.712013,0.037316,0.701174),
+                   Vector3(353.341,474.873,350.82),
+                   Vector3(44.0102,16.904,683.916),
+                   Vector3(0.712953,0.038186,0.700171),
+                   Vector3(3e-06,-0.013032,-0.00754),
+                   Vector3(0.000942,0.00228,0.001613),
+                   3, 0.37 );
+  std::vector<Vector2> pixels;
+  std::vector<Vector3> points;
+  for ( uint32 i = 100; i < 901; i += 200 )
+    for ( uint32 j = 100; j < 901; j += 200 ) {
+      pixels.push_back( Vector2(i,j) );
+      points.push_back( cam.C + 30*cam.pixel_to_vector( pixels.back() ) );
+    }
+
+  std::vector<Vector3> vectors;
+  std::vector<Vector2> projected;
+  cam.pixels_to_vectors( pixels, vectors );
+  cam.points_to_pixels( points, projected );
+  ASSERT_EQ( pixels.size(), vectors.size() );
+  ASSERT_EQ( points.size(), projected.size() );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    EXPECT_VECTOR_NEAR( cam.pixel_to_vector( pixels[i] ), vectors[i], 1e-12 );
+    EXPECT_VECTOR_NEAR( cam.point_to_pixel( points[i] ), projected[i], 1e-9 );
+    EXPECT_VECTOR_NEAR( pixels[i], projected[i], 3e-2 );
+  }
+}
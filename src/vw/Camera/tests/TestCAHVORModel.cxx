@@ -166,3 +166,31 @@ TEST( CAHVORModel, ForwardReverse) {
     }
   }
 }
+
+TEST( CAHVORModel, Batch ) {
+  CAHVORModel cam(Vector3(0.491222,-0.0717236,-1.24143),
+                  Vector3(0.921657,-0.230518,0.312107),
+                  Vector3(757.076,1071.6,160.227),
+                  Vector3(91.7479,-27.7504,1319.48),
+                  Vector3(0.920759,-0.206185,0.331197),
+                  Vector3(0.00096,-0.002183,0.018547));
+  std::vector<Vector2> pixels;
+  std::vector<Vector3> points;
+  for ( uint32 i = 100; i < 901; i += 200 )
+    for ( uint32 j = 100; j < 901; j += 200 ) {
+      pixels.push_back( Vector2(i,j) );
+      points.push_back( cam.C + 30*cam.pixel_to_vector( pixels.back() ) );
+    }
+
+  std::vector<Vector3> vectors;
+  std::vector<Vector2> projected;
+  cam.pixels_to_vectors( pixels, vectors );
+  cam.points_to_pixels( points, projected );
+  ASSERT_EQ( pixels.size(), vectors.size() );
+  ASSERT_EQ( points.size(), projected.size() );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    EXPECT_VECTOR_NEAR( cam.pixel_to_vector( pixels[i] ), vectors[i], 1e-12 );
+    EXPECT_VECTOR_NEAR( cam.point_to_pixel( points[i] ), projected[i], 1e-9 );
+    EXPECT_VECTOR_NEAR( pixels[i], projected[i], 1e-2 );
+  }
+}
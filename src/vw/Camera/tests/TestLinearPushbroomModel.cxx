@@ -68,3 +68,67 @@ TEST( LinearPushbroom, PixelToVector ) {
     acos(dot_prod(Vector3(0,0,1),inverse(center_pose).rotate(cam.pixel_to_vector(center_pixel))));
   EXPECT_LT( angle_from_z, 0.5 );
 }
+
+TEST( LinearPushbroom, PointToPixel ) {
+  LinearPushbroomModel cam(10.0, 1000, 1024, -512, 1.0, 0.01, 0.01,
+                           Vector3(0,0,1), Vector3(0,1,0),
+                           Quaternion<double>(0,0,0,1),
+                           Vector3(0,0,1), Vector3(1,0,0));
+
+  for ( double v = 0; v < 1000; v += 111.3 )
+    for ( double u = 0; u < 1024; u += 97.7 ) {
+      Vector2 pixel(u,v);
+      Vector3 point = cam.camera_center(pixel) + 25*cam.pixel_to_vector(pixel);
+      EXPECT_VECTOR_NEAR( pixel, cam.point_to_pixel(point), 1e-6 );
+    }
+
+  // Before the first line, and behind the camera
+  EXPECT_THROW( cam.point_to_pixel( Vector3(-5,0,10) ), PointToPixelErr );
+  EXPECT_THROW( cam.point_to_pixel( Vector3(5,0,-10) ), PointToPixelErr );
+}
+
+TEST( LinearPushbroom, PixelsToRays ) {
+  LinearPushbroomModel cam(10.0, 1000, 1024, -512, 1.0, 0.01, 0.01,
+                           Vector3(0,0,1), Vector3(0,1,0),
+                           Quaternion<double>(0,0,0,1),
+                           Vector3(0,0,1), Vector3(1,0,0));
+
+  // Runs of pixels on one line, a fractional line, and two pixels off
+  // the image.
+  std::vector<Vector2> pixels;
+  pixels.push_back( Vector2(0,0) );
+  pixels.push_back( Vector2(512,0) );
+  pixels.push_back( Vector2(100,512.25) );
+  pixels.push_back( Vector2(200,512.25) );
+  pixels.push_back( Vector2(10,-3) );
+  pixels.push_back( Vector2(10,1200) );
+  pixels.push_back( Vector2(300,700) );
+
+  std::vector<Vector3> centers, directions;
+  cam.pixels_to_rays( pixels, centers, directions );
+  ASSERT_EQ( pixels.size(), centers.size() );
+  ASSERT_EQ( pixels.size(), directions.size() );
+  for ( size_t i = 0; i < pixels.size(); ++i ) {
+    if ( i == 4 || i == 5 ) {
+      EXPECT_VECTOR_DOUBLE_EQ( directions[i], Vector3() );
+      EXPECT_THROW( cam.pixel_to_vector(pixels[i]), PixelToRayErr );
+      continue;
+    }
+    EXPECT_VECTOR_DOUBLE_EQ( directions[i], cam.pixel_to_vector(pixels[i]) );
+    EXPECT_VECTOR_DOUBLE_EQ( centers[i], cam.camera_center(pixels[i]) );
+  }
+
+  std::vector<Vector3> vectors;
+  cam.pixels_to_vectors( pixels, vectors );
+  ASSERT_EQ( pixels.size(), vectors.size() );
+  for ( size_t i = 0; i < pixels.size(); ++i )
+    EXPECT_VECTOR_DOUBLE_EQ( directions[i], vectors[i] );
+
+  // The generic version gives the same rays.
+  std::vector<Vector3> generic_centers, generic_directions;
+  cam.CameraModel::pixels_to_rays( pixels, generic_centers, generic_directions );
+  for ( size_t i = 0; i < pixels.size(); ++i ) {
+    EXPECT_VECTOR_DOUBLE_EQ( directions[i], generic_directions[i] );
+    EXPECT_VECTOR_DOUBLE_EQ( centers[i], generic_centers[i] );
+  }
+}
@@ -302,6 +302,59 @@ TEST_F( PinholeTest, AdjustableTsaiDistortion ) {
   readback_test( file );
 }
 
+TEST_F( PinholeTest, UndistortionMap ) {
+  pinhole.set_lens_distortion(
+    TsaiLensDistortion(Vector4(-0.2796604335308075,
+                               0.1031486615538597,
+                               -0.0007824968779459596,
+                               0.0009675505571067333) ) );
+#if defined(VW_HAVE_PKG_LAPACK) && VW_HAVE_PKG_LAPACK==1
+  std::vector<Vector2> pixels;
+  std::vector<Vector3> exact;
+  for ( unsigned x = 10; x < 1030; x += 80 )
+    for ( unsigned y = 10; y < 770; y += 80 ) {
+      pixels.push_back( Vector2(x+0.3,y+0.7) );
+      exact.push_back( pinhole.pixel_to_vector( pixels.back() ) );
+    }
+
+  EXPECT_FALSE( pinhole.has_undistortion_map() );
+  ASSERT_TRUE( pinhole.build_undistortion_map( BBox2i(0,0,1038,776), 1e-3 ) );
+  EXPECT_TRUE( pinhole.has_undistortion_map() );
+  projection_test(2e-3);
+
+  std::vector<Vector3> batch;
+  pinhole.pixels_to_vectors( pixels, batch );
+  ASSERT_EQ( pixels.size(), batch.size() );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    EXPECT_VECTOR_NEAR( exact[i], batch[i], 1e-5 );
+    EXPECT_VECTOR_DOUBLE_EQ( pinhole.pixel_to_vector( pixels[i] ), batch[i] );
+  }
+
+  std::vector<Vector3> points;
+  for ( size_t i = 0; i < pixels.size(); i++ )
+    points.push_back( pinhole.camera_center() + 10*exact[i] );
+  std::vector<Vector2> projected;
+  pinhole.points_to_pixels( points, projected );
+  ASSERT_EQ( points.size(), projected.size() );
+  for ( size_t i = 0; i < points.size(); i++ ) {
+    EXPECT_VECTOR_DOUBLE_EQ( pinhole.point_to_pixel( points[i] ), projected[i] );
+    EXPECT_VECTOR_NEAR( pixels[i], projected[i], 1e-4 );
+  }
+
+  // Pixels off the grid are still solved for
+  EXPECT_VECTOR_NEAR( pinhole.point_to_pixel( pinhole.pixel_to_vector(Vector2(1100,800)) +
+                                              pinhole.camera_center() ),
+                      Vector2(1100,800), 1e-4 );
+
+  // Moving the camera keeps the map; changing intrinsics drops it
+  pinhole.set_camera_center( Vector3(1,2,3) );
+  EXPECT_TRUE( pinhole.has_undistortion_map() );
+  pinhole.set_focal_length( Vector2(600,600) );
+  EXPECT_FALSE( pinhole.has_undistortion_map() );
+  projection_test(1e-4);
+#endif
+}
+
 TEST_F( PinholeTest, OldFormatReadTest ) {
   UnlinkName filename("monkey.tsai");
   std::ofstream filestream( filename.c_str() );
@@ -6,6 +6,10 @@
 
 
 #include <vw/Cartography/CameraBBox.h>
+#include <vw/Core/Settings.h>
+
+#include <iomanip>
+#include <sstream>
 
 using namespace vw;
 
@@ -58,28 +62,66 @@ BBox2 cartography::camera_bbox( cartography::GeoReference const& georef,
        camera_llr[0] > 90 )
     center_on_zero = false;
 
-  int32 step_amount = (2*cols+2*rows)/100;
-  detail::CameraDatumBBoxHelper functor( georef, camera_model,
-                                         center_on_zero );
-
-  // Running the edges
-  bresenham_apply( BresenhamLine(0,0,cols,0),
-                   step_amount, functor );
-  functor.last_valid = false;
-  bresenham_apply( BresenhamLine(cols-1,0,cols-1,rows),
-                   step_amount, functor );
-  functor.last_valid = false;
-  bresenham_apply( BresenhamLine(cols-1,rows-1,0,rows-1),
-                   step_amount, functor );
-  functor.last_valid = false;
-  bresenham_apply( BresenhamLine(0,rows-1,0,0),
-                   step_amount, functor );
-  functor.last_valid = false;
-
-  // Running once through the center
-  bresenham_apply( BresenhamLine(0,0,cols,rows),
-                   step_amount, functor );
-
-  scale = functor.scale/double(step_amount);
-  return functor.box;
+  detail::CameraDatumBBoxSampler sampler( georef, camera_model,
+                                          center_on_zero );
+  return detail::adaptive_camera_bbox( sampler, cols, rows, scale,
+                                       vw_settings().default_num_threads() );
+}
+
+// The georeference as a key for CameraBBoxCache, at full precision
+static std::string georef_key( cartography::GeoReference const& georef ) {
+  std::ostringstream key;
+  key << std::setprecision(17) << georef.overall_proj4_str() << "|"
+      << georef.datum().semi_major_axis() << "|" << georef.datum().semi_minor_axis() << "|"
+      << georef.pixel_interpretation();
+  Matrix3x3 transform = georef.transform();
+  for ( size_t i = 0; i < 9; i++ )
+    key << "|" << transform(i/3,i%3);
+  return key.str();
+}
+
+BBox2 cartography::CameraBBoxCache::camera_bbox( cartography::GeoReference const& georef,
+                                                 boost::shared_ptr<camera::CameraModel> camera_model,
+                                                 int32 cols, int32 rows, float &scale ) {
+  std::string key = georef_key( georef );
+  {
+    Mutex::Lock lock( m_mutex );
+    for ( size_t i = 0; i < m_entries.size(); ) {
+      if ( m_entries[i].camera.expired() ) {
+        m_entries[i] = m_entries.back();
+        m_entries.pop_back();
+        continue;
+      }
+      Entry const& entry = m_entries[i];
+      if ( entry.camera.lock() == camera_model && entry.cols == cols &&
+           entry.rows == rows && entry.georef == key ) {
+        scale = entry.scale;
+        return entry.box;
+      }
+      i++;
+    }
+  }
+
+  // Walking the camera without holding the lock, so other cameras can
+  // be looked up meanwhile
+  Entry entry;
+  entry.camera = camera_model;
+  entry.georef = key;
+  entry.cols = cols;
+  entry.rows = rows;
+  entry.box = cartography::camera_bbox( georef, camera_model, cols, rows, entry.scale );
+  scale = entry.scale;
+  Mutex::Lock lock( m_mutex );
+  m_entries.push_back( entry );
+  return entry.box;
+}
+
+void cartography::CameraBBoxCache::clear() {
+  Mutex::Lock lock( m_mutex );
+  m_entries.clear();
+}
+
+size_t cartography::CameraBBoxCache::size() {
+  Mutex::Lock lock( m_mutex );
+  return m_entries.size();
 }
@@ -19,8 +19,13 @@
 #include <vw/Cartography/SimplePointImageManipulation.h>
 #include <vw/Cartography/GeoReference.h>
 #include <vw/Cartography/detail/BresenhamLine.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <limits>
+#include <vector>
 
 namespace vw {
 namespace cartography {
@@ -84,124 +89,186 @@ namespace cartography {
 
   namespace detail {
 
-    template <class FunctionT>
-    void bresenham_apply( BresenhamLine line, size_t step,
-                          FunctionT& f ) {
-      while ( line.is_good() ) {
-        f( *line );
-        for ( size_t i = 0; i < step; i++ )
-          ++line;
-      }
-    }
+    // A pixel on an image edge and where it lands in the georeference
+    struct CameraBBoxSample {
+      Vector2 pixel, point;
+      bool valid;
+    };
 
-    class CameraDatumBBoxHelper {
+    // Intersects pixels with the datum
+    class CameraDatumBBoxSampler {
       GeoReference m_georef;
       boost::shared_ptr<camera::CameraModel> m_camera;
       double m_z_scale;
-      Vector2 m_last_intersect;
+      bool m_center_on_zero;
 
     public:
-      bool last_valid, center_on_zero;
-      BBox2 box;
-      double scale;
-
-      CameraDatumBBoxHelper( GeoReference const& georef,
-                             boost::shared_ptr<camera::CameraModel> camera,
-                             bool center=false) : m_georef(georef), m_camera(camera), last_valid(false), center_on_zero(center), scale( std::numeric_limits<double>::max() ) {
+      CameraDatumBBoxSampler( GeoReference const& georef,
+                              boost::shared_ptr<camera::CameraModel> camera,
+                              bool center=false ) : m_georef(georef), m_camera(camera), m_center_on_zero(center) {
         m_z_scale = m_georef.datum().semi_major_axis() / m_georef.datum().semi_minor_axis();
       }
 
-      void operator() ( Vector2 pixel ) {
-        bool test_intersect;
-        Vector2 geospatial_point =
-          geospatial_intersect( pixel, m_georef, m_camera,
-                                m_z_scale, test_intersect );
-        if ( !test_intersect ) {
-          last_valid = false;
-          return;
-        }
-
-        if ( center_on_zero && geospatial_point[0] > 180 )
-          geospatial_point[0] -= 360.0;
-
-        if ( last_valid ) {
-          double current_scale =
-            norm_2( geospatial_point - m_last_intersect );
-          if ( current_scale < scale )
-            scale = current_scale;
-        }
-        m_last_intersect = geospatial_point;
-        box.grow( geospatial_point );
-        last_valid = true;
+      CameraBBoxSample operator() ( Vector2 const& pixel ) const {
+        CameraBBoxSample sample;
+        sample.pixel = pixel;
+        sample.point = geospatial_intersect( pixel, m_georef, m_camera,
+                                             m_z_scale, sample.valid );
+        if ( sample.valid && m_center_on_zero && sample.point[0] > 180 )
+          sample.point[0] -= 360.0;
+        return sample;
       }
     };
 
+    // Intersects pixels with the datum, then refines the intersection
+    // against a DEM
     template <class DEMImageT>
-    class CameraDEMBBoxHelper {
+    class CameraDEMBBoxSampler {
       GeoReference m_georef;
       boost::shared_ptr<camera::CameraModel> m_camera;
       DEMImageT m_dem;
       double m_z_scale;
-      Vector2 m_last_intersect;
+      bool m_center_on_zero;
 
     public:
-      bool last_valid, center_on_zero;
-      BBox2 box;
-      double scale;
-
-      CameraDEMBBoxHelper( ImageViewBase<DEMImageT> const& dem_image,
-                           GeoReference const& georef,
-                           boost::shared_ptr<camera::CameraModel> camera,
-                           bool center=false ) : m_georef(georef), m_camera(camera), m_dem(dem_image.impl()), last_valid(false), center_on_zero(center), scale( std::numeric_limits<double>::max() ) {
+      CameraDEMBBoxSampler( ImageViewBase<DEMImageT> const& dem_image,
+                            GeoReference const& georef,
+                            boost::shared_ptr<camera::CameraModel> camera,
+                            bool center=false ) : m_georef(georef), m_camera(camera), m_dem(dem_image.impl()), m_center_on_zero(center) {
         m_z_scale = m_georef.datum().semi_major_axis() / m_georef.datum().semi_minor_axis();
       }
 
-      void operator() ( Vector2 pixel ) {
-        bool test_intersect;
-        Vector2 geospatial_point =
-          geospatial_intersect( pixel, m_georef, m_camera,
-                                m_z_scale, test_intersect );
-        if ( !test_intersect ) {
-          last_valid = false;
-          return;
-        }
+      CameraBBoxSample operator() ( Vector2 const& pixel ) const {
+        CameraBBoxSample sample;
+        sample.pixel = pixel;
+        sample.point = geospatial_intersect( pixel, m_georef, m_camera,
+                                             m_z_scale, sample.valid );
+        if ( !sample.valid )
+          return sample;
 
         // Refining with more accurate intersection
         DEMIntersectionLMA<DEMImageT> model( m_dem, m_georef, m_camera );
         int status = 0;
-        geospatial_point = math::levenberg_marquardt( model, geospatial_point,
-                                                      pixel, status );
+        sample.point = math::levenberg_marquardt( model, sample.point,
+                                                  pixel, status );
         if ( status < 0 ) {
-          last_valid = false;
-          return;
+          sample.valid = false;
+          return sample;
         }
 
-        if ( center_on_zero && geospatial_point[0] > 180 )
-          geospatial_point[0] -= 360.0;
-        else if ( center_on_zero && geospatial_point[0] < -180 )
-          geospatial_point[0] += 360.0;
-        else if ( !center_on_zero && geospatial_point[0] < 0 )
-          geospatial_point[0] += 360.0;
-        else if ( !center_on_zero && geospatial_point[0] > 360 )
-          geospatial_point[0] -= 360.0;
-
-        if ( last_valid ) {
-          double current_scale =
-            norm_2( geospatial_point - m_last_intersect );
-          if ( current_scale < scale )
-            scale = current_scale;
+        Vector2& point = sample.point;
+        if ( m_center_on_zero && point[0] > 180 )
+          point[0] -= 360.0;
+        else if ( m_center_on_zero && point[0] < -180 )
+          point[0] += 360.0;
+        else if ( !m_center_on_zero && point[0] < 0 )
+          point[0] += 360.0;
+        else if ( !m_center_on_zero && point[0] > 360 )
+          point[0] -= 360.0;
+        return sample;
+      }
+    };
+
+    // Samples between a and b, in order, where the footprint bends away
+    // from the straight line between them or crosses out of the datum.
+    // Spans are not split below two pixels.
+    template <class SampleFuncT>
+    void refine_camera_bbox_walk( SampleFuncT const& sample_func,
+                                  CameraBBoxSample const& a, CameraBBoxSample const& b,
+                                  std::vector<CameraBBoxSample>& samples ) {
+      if ( norm_2( b.pixel - a.pixel ) <= 2 )
+        return;
+      CameraBBoxSample mid = sample_func( ( a.pixel + b.pixel ) / 2 );
+      bool refine;
+      if ( a.valid && b.valid && mid.valid )
+        refine = norm_2( mid.point - ( a.point + b.point ) / 2 ) > 0.01 * norm_2( b.point - a.point );
+      else
+        refine = a.valid || b.valid || mid.valid;
+      if ( refine )
+        refine_camera_bbox_walk( sample_func, a, mid, samples );
+      samples.push_back( mid );
+      if ( refine )
+        refine_camera_bbox_walk( sample_func, mid, b, samples );
+    }
+
+    // Walks the image from begin to end in 16 even steps, refining each
+    template <class SampleFuncT>
+    class CameraBBoxWalkTask : public Task, private boost::noncopyable {
+      SampleFuncT const& m_sample_func;
+      Vector2 m_begin, m_end;
+      std::vector<CameraBBoxSample>& m_samples;
+
+    public:
+      CameraBBoxWalkTask( SampleFuncT const& sample_func, Vector2 const& begin,
+                          Vector2 const& end, std::vector<CameraBBoxSample>& samples ) :
+        m_sample_func(sample_func), m_begin(begin), m_end(end), m_samples(samples) {}
+
+      void operator()() {
+        const int32 steps = 16;
+        CameraBBoxSample last = m_sample_func( m_begin );
+        m_samples.push_back( last );
+        for ( int32 i = 1; i <= steps; i++ ) {
+          CameraBBoxSample next = m_sample_func( m_begin + ( m_end - m_begin ) * double(i) / steps );
+          refine_camera_bbox_walk( m_sample_func, last, next, m_samples );
+          m_samples.push_back( next );
+          last = next;
         }
-        m_last_intersect = geospatial_point;
-        box.grow( geospatial_point );
-        last_valid = true;
       }
     };
+
+    // Walks the four edges of the image and its diagonal, each on its
+    // own thread when num_threads is more than one, and returns the
+    // bounding box of the valid samples.  scale is the smallest change
+    // in georeference units per pixel between neighbouring samples.
+    template <class SampleFuncT>
+    BBox2 adaptive_camera_bbox( SampleFuncT const& sample_func, int32 cols, int32 rows,
+                                float& scale, int32 num_threads ) {
+      Vector2 corners[4] = { Vector2(0,0), Vector2(cols-1,0),
+                             Vector2(cols-1,rows-1), Vector2(0,rows-1) };
+      std::vector<CameraBBoxSample> samples[5];
+      std::vector<boost::shared_ptr<Task> > tasks;
+      for ( int32 i = 0; i < 4; i++ )
+        tasks.push_back( boost::shared_ptr<Task>( new CameraBBoxWalkTask<SampleFuncT>(
+          sample_func, corners[i], corners[(i+1)%4], samples[i] ) ) );
+      tasks.push_back( boost::shared_ptr<Task>( new CameraBBoxWalkTask<SampleFuncT>(
+        sample_func, corners[0], corners[2], samples[4] ) ) );
+
+      if ( num_threads > 1 ) {
+        FifoWorkQueue queue( num_threads );
+        for ( size_t i = 0; i < tasks.size(); i++ )
+          queue.add_task( tasks[i] );
+        queue.join_all();
+      } else {
+        for ( size_t i = 0; i < tasks.size(); i++ )
+          (*tasks[i])();
+      }
+
+      BBox2 box;
+      double min_scale = std::numeric_limits<double>::max();
+      for ( int32 i = 0; i < 5; i++ )
+        for ( size_t j = 0; j < samples[i].size(); j++ ) {
+          CameraBBoxSample const& sample = samples[i][j];
+          if ( !sample.valid )
+            continue;
+          box.grow( sample.point );
+          if ( j > 0 && samples[i][j-1].valid ) {
+            double pixels = norm_2( sample.pixel - samples[i][j-1].pixel );
+            if ( pixels > 0 )
+              min_scale = std::min( min_scale,
+                                    norm_2( sample.point - samples[i][j-1].point ) / pixels );
+          }
+        }
+      scale = min_scale;
+      return box;
+    }
   }
 
   // Functions for Users
   //////////////////////////////////////////////////////
 
-  // Simple Intersection interfaces
+  // Simple Intersection interfaces. The image edges and diagonal are
+  // intersected with the datum across the default number of threads,
+  // sampling more finely where the footprint curves.
   BBox2 camera_bbox( GeoReference const& georef,
                      boost::shared_ptr<vw::camera::CameraModel> camera_model,
                      int32 cols, int32 rows, float &scale );
@@ -213,6 +280,36 @@ namespace cartography {
     return camera_bbox( georef, camera_model, cols, rows, scale );
   }
 
+  /// Remembers the datum camera_bbox() of each camera, georeference
+  /// and image size, so tools that ask for the same footprint again
+  /// only walk the camera once.  Entries are dropped when their camera
+  /// is destroyed; a camera that is modified in place should be
+  /// followed by clear().
+  class CameraBBoxCache : private boost::noncopyable {
+    struct Entry {
+      boost::weak_ptr<camera::CameraModel> camera;
+      std::string georef;
+      int32 cols, rows;
+      BBox2 box;
+      float scale;
+    };
+    std::vector<Entry> m_entries;
+    Mutex m_mutex;
+
+  public:
+    BBox2 camera_bbox( GeoReference const& georef,
+                       boost::shared_ptr<vw::camera::CameraModel> camera_model,
+                       int32 cols, int32 rows, float &scale );
+    BBox2 camera_bbox( GeoReference const& georef,
+                       boost::shared_ptr<vw::camera::CameraModel> camera_model,
+                       int32 cols, int32 rows ) {
+      float scale;
+      return camera_bbox( georef, camera_model, cols, rows, scale );
+    }
+    void clear();
+    size_t size();
+  };
+
   // Intersections that take in account DEM topography
   template< class DEMImageT >
   BBox2 camera_bbox( ImageViewBase<DEMImageT> const& dem_image,
@@ -228,30 +325,11 @@ namespace cartography {
          camera_llr[0] > 90 )
       center_on_zero = false;
 
-    int32 step_amount = (2*cols+2*rows)/100;
-    detail::CameraDEMBBoxHelper<DEMImageT> functor( dem_image, georef, camera_model,
-                                                    center_on_zero );
-
-    // Running the edges
-    bresenham_apply( BresenhamLine(0,0,cols,0),
-                     step_amount, functor );
-    functor.last_valid = false;
-    bresenham_apply( BresenhamLine(cols-1,0,cols-1,rows),
-                     step_amount, functor );
-    functor.last_valid = false;
-    bresenham_apply( BresenhamLine(cols-1,rows-1,0,rows-1),
-                     step_amount, functor );
-    functor.last_valid = false;
-    bresenham_apply( BresenhamLine(0,rows-1,0,0),
-                     step_amount, functor );
-    functor.last_valid = false;
-
-    // Running once through the center
-    bresenham_apply( BresenhamLine(0,0,cols,rows),
-                     step_amount, functor );
-
-    scale = functor.scale/double(step_amount);
-    return functor.box;
+    // DEM views are not generally safe to read from several threads,
+    // so the edges are walked in turn.
+    detail::CameraDEMBBoxSampler<DEMImageT> sampler( dem_image, georef, camera_model,
+                                                     center_on_zero );
+    return detail::adaptive_camera_bbox( sampler, cols, rows, scale, 1 );
   }
 
   template< class DEMImageT >
@@ -8,6 +8,13 @@
 #include <vw/Cartography/Datum.h>
 #include <vw/Math/Functions.h>
 
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define VW_DATUM_SSE2 1
+#include <emmintrin.h>
+#endif
+
 #if defined(VW_HAVE_PKG_PROTOBUF) && VW_HAVE_PKG_PROTOBUF==1
 #include <vw/Cartography/DatumDesc.pb.h>
 #endif
@@ -229,85 +236,300 @@ vw::Matrix3x3 vw::cartography::Datum::ecef_to_ned_matrix( vw::Vector3 const& p)
 }
 
 
-vw::Vector3 vw::cartography::Datum::geodetic_to_cartesian( vw::Vector3 const& p ) const {
-  double a = m_semi_major_axis;
-  double b = m_semi_minor_axis;
-  double a2 = a * a;
-  double b2 = b * b;
-  double e2 = (a2 - b2) / a2;
+namespace {
+
+  // sin() and cos() by the fdlibm polynomials, after reducing x by
+  // multiples of pi/2 to [-pi/4,pi/4].  They are within an ulp or two of
+  // the libm results, so positions on an Earth-sized body agree to a few
+  // nanometers.  The reduction is only accurate for |x| < max_sincos_arg.
+  const double max_sincos_arg = 1.0e5;
+  const double two_over_pi = 6.36619772367581382433e-01;
+  const double pio2_1  = 1.57079632673412561417e+00; // first 33 bits of pi/2
+  const double pio2_1t = 6.07710050650619224932e-11; // pi/2 - pio2_1
+
+  const double S1 = -1.66666666666666324348e-01, S2 =  8.33333333332248946124e-03,
+               S3 = -1.98412698298579493134e-04, S4 =  2.75573137070700676789e-06,
+               S5 = -2.50507602534068634195e-08, S6 =  1.58969099521155010221e-10;
+  const double C1 =  4.16666666666666019037e-02, C2 = -1.38888888888741095749e-03,
+               C3 =  2.48015872894767294178e-05, C4 = -2.75573143513906633035e-07,
+               C5 =  2.08757232129817482790e-09, C6 = -1.13596475577881948265e-11;
+
+  // The datum's constants, worked out once per batch
+  struct Ellipsoid {
+    double a, b, a2, e2, e4, offset;
+    Ellipsoid( double a_, double b_, double offset_ ) :
+      a(a_), b(b_), a2(a_*a_), e2((a_*a_ - b_*b_) / (a_*a_)), e4(e2*e2), offset(offset_) {}
+  };
+
+#if VW_DATUM_SSE2
+
+  inline __m128d poly_sse2( __m128d z, double c0, double c1, double c2, double c3, double c4, double c5 ) {
+    __m128d r = _mm_set1_pd( c5 );
+    r = _mm_add_pd( _mm_mul_pd( r, z ), _mm_set1_pd( c4 ) );
+    r = _mm_add_pd( _mm_mul_pd( r, z ), _mm_set1_pd( c3 ) );
+    r = _mm_add_pd( _mm_mul_pd( r, z ), _mm_set1_pd( c2 ) );
+    r = _mm_add_pd( _mm_mul_pd( r, z ), _mm_set1_pd( c1 ) );
+    return _mm_add_pd( _mm_mul_pd( r, z ), _mm_set1_pd( c0 ) );
+  }
 
-  double lat = p.y();
-  if ( lat < -90 ) lat = -90;
-  if ( lat > 90 ) lat = 90;
+  inline void sincos_sse2( __m128d x, __m128d& s, __m128d& c ) {
+    __m128i ji = _mm_cvtpd_epi32( _mm_mul_pd( x, _mm_set1_pd( two_over_pi ) ) );
+    __m128d j = _mm_cvtepi32_pd( ji );
+    __m128d y = _mm_sub_pd( _mm_sub_pd( x, _mm_mul_pd( j, _mm_set1_pd( pio2_1 ) ) ),
+                            _mm_mul_pd( j, _mm_set1_pd( pio2_1t ) ) );
+    __m128d z = _mm_mul_pd( y, y );
+    __m128d sy = _mm_add_pd( y, _mm_mul_pd( _mm_mul_pd( y, z ), poly_sse2( z, S1, S2, S3, S4, S5, S6 ) ) );
+    __m128d cy = _mm_add_pd( _mm_sub_pd( _mm_set1_pd( 1.0 ), _mm_mul_pd( _mm_set1_pd( 0.5 ), z ) ),
+                             _mm_mul_pd( _mm_mul_pd( z, z ), poly_sse2( z, C1, C2, C3, C4, C5, C6 ) ) );
+
+    // The quadrant, j mod 4, picks and negates the results.
+    __m128i q = _mm_shuffle_epi32( ji, _MM_SHUFFLE(1,1,0,0) );
+    __m128i one = _mm_set1_epi32( 1 ), two = _mm_set1_epi32( 2 );
+    __m128d swap = _mm_castsi128_pd( _mm_cmpeq_epi32( _mm_and_si128( q, one ), one ) );
+    __m128d sin_neg = _mm_castsi128_pd( _mm_cmpeq_epi32( _mm_and_si128( q, two ), two ) );
+    __m128d cos_neg = _mm_castsi128_pd( _mm_cmpeq_epi32( _mm_and_si128( _mm_add_epi32( q, one ), two ), two ) );
+    __m128d sign = _mm_set1_pd( -0.0 );
+    s = _mm_or_pd( _mm_and_pd( swap, cy ), _mm_andnot_pd( swap, sy ) );
+    c = _mm_or_pd( _mm_and_pd( swap, sy ), _mm_andnot_pd( swap, cy ) );
+    s = _mm_xor_pd( s, _mm_and_pd( sin_neg, sign ) );
+    c = _mm_xor_pd( c, _mm_and_pd( cos_neg, sign ) );
+  }
 
-  double rlon = (p.x() + m_meridian_offset) * (M_PI/180);
-  double rlat = lat * (M_PI/180);
-  double slat = sin( rlat );
-  double clat = cos( rlat );
-  double slon = sin( rlon );
-  double clon = cos( rlon );
-  double radius = a / sqrt(1.0-e2*slat*slat);
+  // Two points.  Longitudes too large for sincos_sse2() go through libm.
+  inline void geodetic_to_cartesian_sse2( Ellipsoid const& e, __m128d lon, __m128d lat, __m128d alt,
+                                          __m128d& x, __m128d& y, __m128d& z ) {
+    __m128d d2r = _mm_set1_pd( M_PI/180 );
+    lat = _mm_min_pd( _mm_max_pd( lat, _mm_set1_pd( -90.0 ) ), _mm_set1_pd( 90.0 ) );
+    __m128d rlon = _mm_mul_pd( _mm_add_pd( lon, _mm_set1_pd( e.offset ) ), d2r );
+    __m128d rlat = _mm_mul_pd( lat, d2r );
+    __m128d slat, clat, slon, clon;
+    sincos_sse2( rlat, slat, clat );
+    __m128d abs_rlon = _mm_andnot_pd( _mm_set1_pd( -0.0 ), rlon );
+    sincos_sse2( rlon, slon, clon );
+    if ( int big = _mm_movemask_pd( _mm_cmpgt_pd( abs_rlon, _mm_set1_pd( max_sincos_arg ) ) ) ) {
+      double r[2], sv[2], cv[2];
+      _mm_storeu_pd( r, rlon );
+      _mm_storeu_pd( sv, slon );
+      _mm_storeu_pd( cv, clon );
+      for ( int k = 0; k < 2; ++k )
+        if ( big & (1 << k) ) {
+          sv[k] = sin( r[k] );
+          cv[k] = cos( r[k] );
+        }
+      slon = _mm_loadu_pd( sv );
+      clon = _mm_loadu_pd( cv );
+    }
+    __m128d radius = _mm_div_pd( _mm_set1_pd( e.a ),
+                                 _mm_sqrt_pd( _mm_sub_pd( _mm_set1_pd( 1.0 ),
+                                                          _mm_mul_pd( _mm_set1_pd( e.e2 ), _mm_mul_pd( slat, slat ) ) ) ) );
+    __m128d rc = _mm_mul_pd( _mm_add_pd( radius, alt ), clat );
+    x = _mm_mul_pd( rc, clon );
+    y = _mm_mul_pd( rc, slon );
+    z = _mm_mul_pd( _mm_add_pd( _mm_mul_pd( radius, _mm_set1_pd( 1 - e.e2 ) ), alt ), slat );
+  }
 
-  return Vector3( (radius+p.z()) * clat * clon,
-                  (radius+p.z()) * clat * slon,
-                  (radius*(1-e2)+p.z()) * slat );
-}
+#else // VW_DATUM_SSE2
 
+  inline double poly( double z, double c0, double c1, double c2, double c3, double c4, double c5 ) {
+    return c0 + z*(c1 + z*(c2 + z*(c3 + z*(c4 + z*c5))));
+  }
 
-// This function is based heavily on the similar
-// Proj.4 function pj_Convert_Geocentric_To_Geodetic.
-vw::Vector3 vw::cartography::Datum::cartesian_to_geodetic( vw::Vector3 const& p ) const {
-  double a = m_semi_major_axis;
-  double b = m_semi_minor_axis;
-  double a2 = a * a;
-  double b2 = b * b;
-  double e2 = (a2 - b2) / a2;
+  inline void poly_sincos( double x, double& s, double& c ) {
+    if ( fabs(x) > max_sincos_arg ) {
+      s = sin( x );
+      c = cos( x );
+      return;
+    }
+    double j = floor( x * two_over_pi + 0.5 );
+    double y = ( x - j*pio2_1 ) - j*pio2_1t;
+    double z = y*y;
+    double sy = y + y*z*poly( z, S1, S2, S3, S4, S5, S6 );
+    double cy = 1.0 - 0.5*z + z*z*poly( z, C1, C2, C3, C4, C5, C6 );
+    switch ( int(j) & 3 ) {
+    case 0:  s =  sy; c =  cy; break;
+    case 1:  s =  cy; c = -sy; break;
+    case 2:  s = -sy; c = -cy; break;
+    default: s = -cy; c =  sy; break;
+    }
+  }
 
-  static const double epsilon = 1.0e-12;
-  static const double epsilon2 = epsilon*epsilon;
-  static const int maxiter = 30;
+#endif // VW_DATUM_SSE2
+
+  // This is the approach of the Proj.4 function
+  // pj_Convert_Geocentric_To_Geodetic.  It is only needed within a few
+  // hundredths of the semi-major axis of the center, where the closed
+  // form below breaks down.
+  void cartesian_to_geodetic_iterative( Ellipsoid const& e, double x, double y, double z,
+                                        double& lat, double& alt ) {
+    static const double epsilon = 1.0e-12;
+    static const double epsilon2 = epsilon*epsilon;
+    static const int maxiter = 30;
+
+    double normxy = sqrt(x*x+y*y);       // distance between semi-minor axis and location
+    double normp = sqrt(x*x+y*y+z*z);    // distance between center and location
+
+    // The following iterative algorithm was developped by
+    // "Institut fur Erdmessung", University of Hannover, July 1988.
+    // Internet: www.ife.uni-hannover.de
+    double cgcl = normxy/normp;     // cos of geocentric latitude
+    double sgcl = z/normp;          // sin of geocentric latitude
+    double rx = 1.0/sqrt(1.0-e.e2*(2.0-e.e2)*cgcl*cgcl);
+    double clat = cgcl*(1.0-e.e2)*rx; // cos of geodetic latitude estimate
+    double slat = sgcl*rx;            // sin of geodetic latitude estimate
+
+    // loop to find lat (in quadrature) until |lat[i]-lat[i-1]|<epsilon, roughly
+    alt = 0.0;
+    for( int i=0; i<maxiter; ++i ) {
+      double ri = e.a/sqrt(1.0-e.e2*slat*slat); // radius at estimated location
+      alt = normxy*clat+z*slat-ri*(1.0-e.e2*slat*slat);
+      double rk = e.e2*ri/(ri+alt);
+      rx = 1.0/sqrt(1.0-rk*(2.0-rk)*cgcl*cgcl);
+      double new_clat = cgcl*(1.0-rk)*rx;
+      double new_slat = sgcl*rx;
+      // sin(lat[i]-lat[i-1]) ~= lat[i]-lat[i-1]
+      double sdlat = new_slat*clat-new_clat*slat;
+      clat = new_clat;
+      slat = new_slat;
+      if( sdlat*sdlat < epsilon2 ) break;
+    }
+    lat = atan(slat/fabs(clat))/(M_PI/180);
+  }
 
-  double normxy = sqrt(p.x()*p.x()+p.y()*p.y()); // distance between semi-minor axis and location
-  double normp = norm_2(p);                      // distance between center and location
+  // Vermeille's closed form, from "Direct transformation from
+  // geocentric coordinates to geodetic coordinates", Journal of Geodesy
+  // 76 (2002).  It is exact away from the center, and agrees with the
+  // iteration to well under a nanometer.
+  inline void cartesian_to_geodetic_point( Ellipsoid const& e, double x, double y, double z,
+                                           double& lon, double& lat, double& alt ) {
+    static const double epsilon = 1.0e-12;
+
+    double normxy2 = x*x + y*y;
+    double normxy = sqrt( normxy2 );
+
+    // compute the longitude
+    lon = 0.0;
+    if ( normxy/e.a < epsilon ) {
+      // special case for the origin
+      if ( sqrt( normxy2 + z*z )/e.a < epsilon ) {
+        lat = 90;
+        alt = -e.b;
+        return;
+      }
+    } else {
+      lon = atan2( y, x ) / (M_PI/180);
+    }
+    lon -= e.offset;
 
-  double lon=0.0, alt=0.0;
+    if ( e.e2 == 0 ) {
+      lat = atan2( z, normxy ) / (M_PI/180);
+      alt = sqrt( normxy2 + z*z ) - e.a;
+      return;
+    }
 
-  // compute the longitude
-  if ( normxy/a < epsilon ) {
-    // special case for the origin
-    if ( normp/a < epsilon ) {
-      return Vector3(0,90,-b);
+    double p = normxy2 / e.a2;
+    double q = (1 - e.e2) / e.a2 * z*z;
+    double r = (p + q - e.e4) / 6;
+    if ( r <= 0 ) {
+      cartesian_to_geodetic_iterative( e, x, y, z, lat, alt );
+      return;
     }
+    double s = e.e4 * p * q / (4 * r*r*r);
+    double t = vw::math::cbrt( 1 + s + sqrt( s * (2 + s) ) );
+    double u = r * (1 + t + 1/t);
+    double v = sqrt( u*u + e.e4 * q );
+    double w = e.e2 * (u + v - q) / (2 * v);
+    double k = sqrt( u + v + w*w ) - w;
+    double d = k * normxy / (k + e.e2);
+    double h = sqrt( d*d + z*z );
+    lat = 2 * atan( z / (d + h) ) / (M_PI/180);
+    alt = (k + e.e2 - 1) / k * h;
+  }
+
+  // Points are converted through arrays of coordinates this long
+  const size_t batch_size = 256;
+
+} // namespace
+
+void vw::cartography::Datum::geodetic_to_cartesian( size_t n, double const* lon, double const* lat, double const* alt,
+                                                    double* x, double* y, double* z ) const {
+  Ellipsoid e( m_semi_major_axis, m_semi_minor_axis, m_meridian_offset );
+#if VW_DATUM_SSE2
+  size_t i = 0;
+  for ( ; i + 2 <= n; i += 2 ) {
+    __m128d xv, yv, zv;
+    geodetic_to_cartesian_sse2( e, _mm_loadu_pd( lon+i ), _mm_loadu_pd( lat+i ), _mm_loadu_pd( alt+i ), xv, yv, zv );
+    _mm_storeu_pd( x+i, xv );
+    _mm_storeu_pd( y+i, yv );
+    _mm_storeu_pd( z+i, zv );
+  }
+  // The last point goes through the same code, so that the result for
+  // a point does not depend on where it is in the array.
+  if ( i < n ) {
+    __m128d xv, yv, zv;
+    geodetic_to_cartesian_sse2( e, _mm_set_sd( lon[i] ), _mm_set_sd( lat[i] ), _mm_set_sd( alt[i] ), xv, yv, zv );
+    _mm_store_sd( x+i, xv );
+    _mm_store_sd( y+i, yv );
+    _mm_store_sd( z+i, zv );
   }
-  else {
-    lon = atan2(p.y(),p.x()) / (M_PI/180);
+#else
+  for ( size_t i = 0; i < n; ++i ) {
+    double rlat = std::min( std::max( lat[i], -90.0 ), 90.0 ) * (M_PI/180);
+    double rlon = ( lon[i] + e.offset ) * (M_PI/180);
+    double slat, clat, slon, clon;
+    poly_sincos( rlat, slat, clat );
+    poly_sincos( rlon, slon, clon );
+    double radius = e.a / sqrt( 1.0 - e.e2*slat*slat );
+    double h = alt[i];
+    x[i] = (radius + h) * clat * clon;
+    y[i] = (radius + h) * clat * slon;
+    z[i] = (radius * (1 - e.e2) + h) * slat;
   }
+#endif
+}
 
-  // The following iterative algorithm was developped by
-  // "Institut fur Erdmessung", University of Hannover, July 1988.
-  // Internet: www.ife.uni-hannover.de
-  double cgcl = normxy/normp;     // cos of geocentric latitude
-  double sgcl = p.z()/normp;      // sin of geocentric latitude
-  double rx = 1.0/sqrt(1.0-e2*(2.0-e2)*cgcl*cgcl);
-  double clat = cgcl*(1.0-e2)*rx; // cos of geodetic latitude estimate
-  double slat = sgcl*rx;          // sin of geodetic latitude estimate
-
-  // loop to find lat (in quadrature) until |lat[i]-lat[i-1]|<epsilon, roughly
-  for( int i=0; i<maxiter; ++i ) {
-    double ri = a/sqrt(1.0-e2*slat*slat); // radius at estimated location
-    alt = normxy*clat+p.z()*slat-ri*(1.0-e2*slat*slat);
-    double rk = e2*ri/(ri+alt);
-    rx = 1.0/sqrt(1.0-rk*(2.0-rk)*cgcl*cgcl);
-    double new_clat = cgcl*(1.0-rk)*rx;
-    double new_slat = sgcl*rx;
-    // sin(lat[i]-lat[i-1]) ~= lat[i]-lat[i-1]
-    double sdlat = new_slat*clat-new_clat*slat;
-    clat = new_clat;
-    slat = new_slat;
-    if( sdlat*sdlat < epsilon2 ) break;
+void vw::cartography::Datum::cartesian_to_geodetic( size_t n, double const* x, double const* y, double const* z,
+                                                    double* lon, double* lat, double* alt ) const {
+  Ellipsoid e( m_semi_major_axis, m_semi_minor_axis, m_meridian_offset );
+  for ( size_t i = 0; i < n; ++i ) {
+    double px = x[i], py = y[i], pz = z[i];
+    cartesian_to_geodetic_point( e, px, py, pz, lon[i], lat[i], alt[i] );
   }
+}
 
-  return Vector3( lon - m_meridian_offset, atan(slat/fabs(clat))/(M_PI/180), alt );
+void vw::cartography::Datum::geodetic_to_cartesian( std::vector<Vector3> const& llh, std::vector<Vector3>& xyz ) const {
+  xyz.resize( llh.size() );
+  double in[3][batch_size], out[3][batch_size];
+  for ( size_t begin = 0; begin < llh.size(); begin += batch_size ) {
+    size_t n = std::min( batch_size, llh.size() - begin );
+    for ( size_t i = 0; i < n; ++i )
+      for ( size_t c = 0; c < 3; ++c )
+        in[c][i] = llh[begin+i][c];
+    geodetic_to_cartesian( n, in[0], in[1], in[2], out[0], out[1], out[2] );
+    for ( size_t i = 0; i < n; ++i )
+      xyz[begin+i] = Vector3( out[0][i], out[1][i], out[2][i] );
+  }
+}
+
+void vw::cartography::Datum::cartesian_to_geodetic( std::vector<Vector3> const& xyz, std::vector<Vector3>& llh ) const {
+  llh.resize( xyz.size() );
+  Ellipsoid e( m_semi_major_axis, m_semi_minor_axis, m_meridian_offset );
+  for ( size_t i = 0; i < xyz.size(); ++i ) {
+    Vector3 p = xyz[i];
+    cartesian_to_geodetic_point( e, p[0], p[1], p[2], llh[i][0], llh[i][1], llh[i][2] );
+  }
+}
+
+vw::Vector3 vw::cartography::Datum::geodetic_to_cartesian( vw::Vector3 const& p ) const {
+  Vector3 result;
+  geodetic_to_cartesian( 1, &p[0], &p[1], &p[2], &result[0], &result[1], &result[2] );
+  return result;
+}
+
+vw::Vector3 vw::cartography::Datum::cartesian_to_geodetic( vw::Vector3 const& p ) const {
+  Ellipsoid e( m_semi_major_axis, m_semi_minor_axis, m_meridian_offset );
+  Vector3 result;
+  cartesian_to_geodetic_point( e, p[0], p[1], p[2], result[0], result[1], result[2] );
+  return result;
 }
 
 std::ostream& vw::cartography::operator<<( std::ostream& os, vw::cartography::Datum const& datum ) {
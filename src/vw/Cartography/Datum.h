@@ -10,6 +10,7 @@
 
 #include <string>
 #include <ostream>
+#include <vector>
 #include <cmath>
 
 #include <vw/Math/Vector.h>
@@ -130,6 +131,25 @@ namespace cartography {
     Matrix3x3 ecef_to_ned_matrix( Vector3 const& p) const;
 
     Vector3 cartesian_to_geodetic( Vector3 const& p ) const;
+
+    /// Converts n points from geodetic (lon, lat, alt) to cartesian
+    /// coordinates, given as separate arrays of each coordinate.  The
+    /// output arrays may be the input arrays.  Two points at a time go
+    /// through SSE2, with polynomial sines and cosines that are within
+    /// an ulp or two of libm's, i.e. a few nanometers on Earth.  The
+    /// single point version gives exactly the same results.
+    void geodetic_to_cartesian( size_t n, double const* lon, double const* lat, double const* alt,
+                                double* x, double* y, double* z ) const;
+
+    /// Converts n points from cartesian to geodetic coordinates, in
+    /// closed form (Vermeille 2002) except near the center of the
+    /// body.  The output arrays may be the input arrays.
+    void cartesian_to_geodetic( size_t n, double const* x, double const* y, double const* z,
+                                double* lon, double* lat, double* alt ) const;
+
+    /// The same for arrays of points.  The output may be the input.
+    void geodetic_to_cartesian( std::vector<Vector3> const& llh, std::vector<Vector3>& xyz ) const;
+    void cartesian_to_geodetic( std::vector<Vector3> const& xyz, std::vector<Vector3>& llh ) const;
   };
 
   std::ostream& operator<<(std::ostream& os, const Datum& datum);
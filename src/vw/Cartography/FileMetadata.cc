@@ -0,0 +1,213 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Cartography/FileMetadata.h>
+#include <vw/FileIO/DiskImageResource.h>
+#include <vw/FileIO/TemporaryFile.h>
+#include <vw/Core/Log.h>
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/convenience.hpp>
+namespace fs = boost::filesystem;
+
+namespace {
+
+  using namespace vw;
+  using namespace vw::cartography;
+
+  const char* const CACHE_MAGIC = "VWMETA";
+  const int CACHE_VERSION = 1;
+
+  // What identifies the version of a file that an entry describes.
+  struct FileKey {
+    std::string path;
+    int64 mtime;
+    uint64 size;
+  };
+
+  bool file_key( std::string const& filename, FileKey& key ) {
+    try {
+      fs::path path = fs::system_complete( fs::path( filename ) );
+      key.path = path.string();
+      key.mtime = int64( fs::last_write_time( path ) );
+      key.size = uint64( fs::file_size( path ) );
+      return true;
+    } catch( fs::filesystem_error const& ) {
+      return false;
+    }
+  }
+
+  // A stable name for the entry of a path: its 64-bit FNV-1a hash.
+  std::string entry_filename( std::string const& cache_dir, std::string const& path ) {
+    uint64 hash = 14695981039346656037ULL;
+    for( size_t i = 0; i < path.size(); ++i ) {
+      hash ^= uint8( path[i] );
+      hash *= 1099511628211ULL;
+    }
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash << ".vwmeta";
+    return (fs::path( cache_dir ) / name.str()).string();
+  }
+
+  void write_entry( std::ostream& out, FileKey const& key, FileMetadata const& meta ) {
+    out << std::setprecision(17);
+    out << CACHE_MAGIC << " " << CACHE_VERSION << "\n"
+        << key.path << "\n"
+        << key.mtime << " " << key.size << "\n"
+        << meta.format.cols << " " << meta.format.rows << " " << meta.format.planes << " "
+        << int(meta.format.pixel_format) << " " << int(meta.format.channel_type) << " "
+        << meta.format.premultiplied << "\n"
+        << meta.has_georef << "\n";
+    if( !meta.has_georef )
+      return;
+
+    Datum const& datum = meta.georef.datum();
+    out << datum.name() << "\n"
+        << datum.spheroid_name() << "\n"
+        << datum.meridian_name() << "\n"
+        << datum.semi_major_axis() << " " << datum.semi_minor_axis() << " "
+        << datum.meridian_offset() << " " << datum.geocentric() << "\n"
+        << datum.proj4_str() << "\n"
+        << int(meta.georef.pixel_interpretation()) << "\n";
+    Matrix3x3 const& transform = meta.georef.transform();
+    for( int32 i = 0; i < 3; ++i )
+      for( int32 j = 0; j < 3; ++j )
+        out << transform(i,j) << ( i == 2 && j == 2 ? "\n" : " " );
+    out << meta.georef.proj4_str() << "\n";
+  }
+
+  // Reads an entry, which must describe exactly the given version of
+  // the file.
+  bool read_entry( std::istream& in, FileKey const& key, FileMetadata& meta ) {
+    std::string magic, path, line;
+    int version;
+    in >> magic >> version;
+    in.ignore( 1 );
+    if( !in || magic != CACHE_MAGIC || version != CACHE_VERSION )
+      return false;
+    std::getline( in, path );
+    int64 mtime;
+    uint64 size;
+    in >> mtime >> size;
+    if( !in || path != key.path || mtime != key.mtime || size != key.size )
+      return false;
+
+    int pixel_format, channel_type;
+    in >> meta.format.cols >> meta.format.rows >> meta.format.planes
+       >> pixel_format >> channel_type >> meta.format.premultiplied
+       >> meta.has_georef;
+    in.ignore( 1 );
+    meta.format.pixel_format = PixelFormatEnum( pixel_format );
+    meta.format.channel_type = ChannelTypeEnum( channel_type );
+    if( !in )
+      return false;
+    if( !meta.has_georef )
+      return true;
+
+    std::string name, spheroid_name, meridian_name, datum_proj4, proj4;
+    double semi_major, semi_minor, meridian_offset;
+    bool geocentric;
+    int pixel_interpretation;
+    Matrix3x3 transform;
+    std::getline( in, name );
+    std::getline( in, spheroid_name );
+    std::getline( in, meridian_name );
+    in >> semi_major >> semi_minor >> meridian_offset >> geocentric;
+    in.ignore( 1 );
+    std::getline( in, datum_proj4 );
+    in >> pixel_interpretation;
+    for( int32 i = 0; i < 3; ++i )
+      for( int32 j = 0; j < 3; ++j )
+        in >> transform(i,j);
+    in.ignore( 1 );
+    std::getline( in, proj4 );
+    if( !in )
+      return false;
+
+    Datum datum( name, spheroid_name, meridian_name, semi_major, semi_minor, meridian_offset );
+    datum.set_geocentric( geocentric );
+    datum.proj4_str() = datum_proj4;
+    meta.georef = GeoReference( datum, transform,
+                                GeoReference::PixelInterpretation( pixel_interpretation ) );
+    meta.georef.set_proj4_projection_str( proj4 );
+    return true;
+  }
+
+  bool read_cached( std::string const& cache_dir, FileKey const& key, FileMetadata& meta ) {
+    std::ifstream in( entry_filename( cache_dir, key.path ).c_str() );
+    if( !in )
+      return false;
+    try {
+      return read_entry( in, key, meta );
+    } catch( std::exception const& e ) {
+      VW_OUT(DebugMessage, "cartography") << "Ignoring bad metadata cache entry for "
+                                          << key.path << ": " << e.what() << "\n";
+      return false;
+    }
+  }
+
+  // Writes the entry under a temporary name and renames it into
+  // place, so that jobs sharing the cache never see half an entry.
+  void write_cached( std::string const& cache_dir, FileKey const& key, FileMetadata const& meta ) {
+    try {
+      fs::create_directories( fs::path( cache_dir ) );
+      TemporaryFile tmp( cache_dir, false, "tmp", ".vwmeta" );
+      write_entry( tmp, key, meta );
+      tmp.flush();
+      if( !tmp ) {
+        fs::remove( tmp.filename() );
+        vw_throw( IOErr() << "write failed" );
+      }
+      fs::rename( tmp.filename(), entry_filename( cache_dir, key.path ) );
+    } catch( std::exception const& e ) {
+      VW_OUT(WarningMessage, "cartography") << "Could not cache the metadata of " << key.path
+                                            << " in " << cache_dir << ": " << e.what() << "\n";
+    }
+  }
+
+} // namespace
+
+std::vector<vw::cartography::FileMetadata>
+vw::cartography::read_file_metadata( std::vector<std::string> const& filenames,
+                                     int32 concurrency, std::string const& cache_dir ) {
+  std::vector<FileMetadata> result( filenames.size() );
+  std::vector<FileKey> keys( filenames.size() );
+  std::vector<bool> have_key( filenames.size(), false );
+
+  // Take what the cache has, and open the rest.
+  std::vector<std::string> missing;
+  std::vector<size_t> missing_index;
+  for( size_t i = 0; i < filenames.size(); ++i ) {
+    result[i].filename = filenames[i];
+    if( !cache_dir.empty() ) {
+      have_key[i] = file_key( filenames[i], keys[i] );
+      if( have_key[i] && read_cached( cache_dir, keys[i], result[i] ) )
+        continue;
+    }
+    missing.push_back( filenames[i] );
+    missing_index.push_back( i );
+  }
+  if( !cache_dir.empty() )
+    VW_OUT(DebugMessage, "cartography") << "Metadata cache " << cache_dir << ": "
+                                        << filenames.size() - missing.size() << " of "
+                                        << filenames.size() << " files found.\n";
+
+  std::vector<boost::shared_ptr<DiskImageResource> > resources =
+    DiskImageResource::open( missing, concurrency );
+  for( size_t i = 0; i < missing.size(); ++i ) {
+    FileMetadata& meta = result[missing_index[i]];
+    meta.format = resources[i]->format();
+    meta.has_georef = read_georeference( meta.georef, *resources[i] );
+    if( !cache_dir.empty() && have_key[missing_index[i]] )
+      write_cached( cache_dir, keys[missing_index[i]], meta );
+  }
+  return result;
+}
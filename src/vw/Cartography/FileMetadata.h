@@ -0,0 +1,57 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file FileMetadata.h
+///
+/// Reads the format and georeferencing of many image files at once,
+/// for tools that must look at all of their inputs before they read
+/// any pixels.  The files are opened from several threads, and what
+/// was read from each one may be kept in a cache directory, so that a
+/// rerun over files that haven't changed doesn't parse them again.
+///
+#ifndef __VW_CARTOGRAPHY_FILEMETADATA_H__
+#define __VW_CARTOGRAPHY_FILEMETADATA_H__
+
+#include <string>
+#include <vector>
+
+#include <vw/Image/ImageResource.h>
+#include <vw/Cartography/GeoReference.h>
+
+namespace vw {
+namespace cartography {
+
+  /// What read_file_metadata() found out about one file.
+  struct FileMetadata {
+    std::string filename;
+    ImageFormat format;
+    /// Whether the file is georeferenced.  If it isn't, georef is
+    /// the default georeference.
+    bool has_georef;
+    GeoReference georef;
+
+    FileMetadata() : has_georef(false) {}
+  };
+
+  /// Reads the format and georeference of each of the files, opening
+  /// up to concurrency of them at once (as DiskImageResource::open()
+  /// does for a list of files).
+  ///
+  /// If cache_dir is not empty, the metadata of each file is also
+  /// kept in that directory, in an entry keyed by the file's absolute
+  /// path, modification time and size.  A file whose entry still
+  /// matches isn't opened at all.  The directory is created if need
+  /// be, and a cache that can't be read or written is only reported
+  /// in the log.  The cache keeps the same parts of a georeference as
+  /// GeoReference::build_desc() does.
+  std::vector<FileMetadata> read_file_metadata( std::vector<std::string> const& filenames,
+                                                int32 concurrency = 0,
+                                                std::string const& cache_dir = "" );
+
+}} // namespace vw::cartography
+
+#endif // __VW_CARTOGRAPHY_FILEMETADATA_H__
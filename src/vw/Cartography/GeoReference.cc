@@ -63,6 +63,38 @@ namespace cartography {
 
   void GeoReference::init_proj() {
     m_proj_context = boost::shared_ptr<ProjContext>(new ProjContext(overall_proj4_str()));
+
+    // Plate carree maps x = x0 + scale_x*(lon-lon0) and y = y0 +
+    // scale_y*(lat-lat0), so two forward projections through Proj.4
+    // give us its coefficients, whatever units and datum it uses.
+    m_is_plate_carree = false;
+    PJconsts* pj = m_proj_context->proj_ptr();
+    if ( !m_is_projected || pj->geoc ) return;
+    bool eqc = false;
+    for ( paralist* p = pj->params; p; p = p->next )
+      if ( std::string(p->param) == "proj=eqc" )
+        eqc = true;
+    if ( !eqc ) return;
+
+    static const double STEP = 0.5;
+    LP unprojected;
+    unprojected.u = pj->lam0;
+    unprojected.v = pj->phi0;
+    XY origin = pj_fwd(unprojected, pj);
+    CHECK_PROJ_ERROR;
+    unprojected.u += STEP;
+    unprojected.v += pj->phi0 > 0 ? -STEP : STEP;
+    XY step = pj_fwd(unprojected, pj);
+    CHECK_PROJ_ERROR;
+
+    m_plate_carree.lam0 = pj->lam0;
+    m_plate_carree.phi0 = pj->phi0;
+    m_plate_carree.x0 = origin.u;
+    m_plate_carree.y0 = origin.v;
+    m_plate_carree.scale_x = (step.u - origin.u) / STEP;
+    m_plate_carree.scale_y = (step.v - origin.v) / (unprojected.v - pj->phi0);
+    m_plate_carree.over = pj->over;
+    m_is_plate_carree = true;
   }
 
   /// Construct a default georeference.  This georeference will use
@@ -382,31 +414,26 @@ namespace cartography {
   }
 
 
-  /// For a point in the projected space, compute the position of
-  /// that point in unprojected (Geographic) coordinates (lat,lon).
-  Vector2 GeoReference::point_to_lonlat(Vector2 loc) const {
-    if ( ! m_is_projected ) return loc;
+  // This value is proj's internal limit
+  static const double LATITUDE_BOUND = HALFPI-(1e-10)-std::numeric_limits<double>::epsilon();
 
+  // The bodies of point_to_lonlat and lonlat_to_point for a proper
+  // projection, shared with the batch versions below.
+  static inline Vector2 proj_point_to_lonlat(PJconsts* pj, Vector2 const& loc) {
     XY projected;
     LP unprojected;
 
     projected.u = loc[0];
     projected.v = loc[1];
 
-    unprojected = pj_inv(projected, m_proj_context->proj_ptr());
+    unprojected = pj_inv(projected, pj);
     CHECK_PROJ_ERROR;
 
     // Convert from radians to degrees.
     return Vector2(unprojected.u * RAD_TO_DEG, unprojected.v * RAD_TO_DEG);
   }
 
-  /// Given a position in geographic coordinates (lat,lon), compute
-  /// the location in the projected coordinate system.
-  Vector2 GeoReference::lonlat_to_point(Vector2 lon_lat) const {
-    if ( ! m_is_projected ) return lon_lat;
-    // This value is proj's internal limit
-    static const double BOUND = HALFPI-(1e-10)-std::numeric_limits<double>::epsilon();
-
+  static inline Vector2 proj_lonlat_to_point(PJconsts* pj, Vector2 const& lon_lat) {
     XY projected;
     LP unprojected;
 
@@ -418,15 +445,118 @@ namespace cartography {
     // we get edge pixels that extend slightly beyond that range (probably due
     // to pixel as area vs point) and cause Proj.4 to fail. We use HALFPI
     // rather than other incantations for pi/2 because that's what proj.4 uses.
-    if(unprojected.v > BOUND)        unprojected.v = BOUND;
-    else if(unprojected.v < -BOUND) unprojected.v = -BOUND;
+    if(unprojected.v > LATITUDE_BOUND)        unprojected.v = LATITUDE_BOUND;
+    else if(unprojected.v < -LATITUDE_BOUND) unprojected.v = -LATITUDE_BOUND;
 
-    projected = pj_fwd(unprojected, m_proj_context->proj_ptr());
+    projected = pj_fwd(unprojected, pj);
     CHECK_PROJ_ERROR;
 
     return Vector2(projected.u, projected.v);
   }
 
+  // Plate carree in closed form, following what pj_inv and pj_fwd do
+  // with the longitude and latitude.
+  inline Vector2 GeoReference::plate_carree_to_lonlat(Vector2 const& loc) const {
+    PlateCarree const& pc = m_plate_carree;
+    double lam = (loc[0] - pc.x0) / pc.scale_x + pc.lam0;
+    double phi = (loc[1] - pc.y0) / pc.scale_y + pc.phi0;
+    if ( !pc.over ) lam = adjlon(lam);
+    return Vector2(lam * RAD_TO_DEG, phi * RAD_TO_DEG);
+  }
+
+  inline Vector2 GeoReference::lonlat_to_plate_carree(Vector2 const& lon_lat) const {
+    PlateCarree const& pc = m_plate_carree;
+    double lam = lon_lat[0] * DEG_TO_RAD;
+    double phi = lon_lat[1] * DEG_TO_RAD;
+    if ( fabs(lam) > 10 )
+      vw_throw(ProjectionErr() << "Proj.4 error: latitude or longitude exceeded limits");
+    if(phi > LATITUDE_BOUND)        phi = LATITUDE_BOUND;
+    else if(phi < -LATITUDE_BOUND) phi = -LATITUDE_BOUND;
+    lam -= pc.lam0;
+    if ( !pc.over ) lam = adjlon(lam);
+    return Vector2(pc.x0 + pc.scale_x * lam, pc.y0 + pc.scale_y * (phi - pc.phi0));
+  }
+
+  /// For a point in the projected space, compute the position of
+  /// that point in unprojected (Geographic) coordinates (lat,lon).
+  Vector2 GeoReference::point_to_lonlat(Vector2 loc) const {
+    if ( ! m_is_projected ) return loc;
+    if ( m_is_plate_carree ) return plate_carree_to_lonlat(loc);
+    return proj_point_to_lonlat(m_proj_context->proj_ptr(), loc);
+  }
+
+  /// Given a position in geographic coordinates (lat,lon), compute
+  /// the location in the projected coordinate system.
+  Vector2 GeoReference::lonlat_to_point(Vector2 lon_lat) const {
+    if ( ! m_is_projected ) return lon_lat;
+    if ( m_is_plate_carree ) return lonlat_to_plate_carree(lon_lat);
+    return proj_lonlat_to_point(m_proj_context->proj_ptr(), lon_lat);
+  }
+
+  // Applies a homogeneous 2D transform to each point.
+  static void apply_transform(Matrix3x3 const& M, std::vector<Vector2> const& in,
+                              std::vector<Vector2>& out) {
+    out.resize( in.size() );
+    for ( size_t i = 0; i < in.size(); i++ ) {
+      Vector2 const p = in[i];
+      double denom = p[0] * M(2,0) + p[1] * M(2,1) + M(2,2);
+      out[i] = Vector2( (p[0] * M(0,0) + p[1] * M(0,1) + M(0,2)) / denom,
+                        (p[0] * M(1,0) + p[1] * M(1,1) + M(1,2)) / denom );
+    }
+  }
+
+  void GeoReference::pixels_to_points(std::vector<Vector2> const& pixels,
+                                      std::vector<Vector2>& points) const {
+    apply_transform( vw_native_transform(), pixels, points );
+  }
+
+  void GeoReference::points_to_pixels(std::vector<Vector2> const& points,
+                                      std::vector<Vector2>& pixels) const {
+    apply_transform( vw_native_inverse_transform(), points, pixels );
+  }
+
+  void GeoReference::points_to_lonlats(std::vector<Vector2> const& points,
+                                       std::vector<Vector2>& lonlats) const {
+    if ( &lonlats != &points )
+      lonlats = points;
+    if ( ! m_is_projected ) return;
+    if ( m_is_plate_carree ) {
+      for ( size_t i = 0; i < lonlats.size(); i++ )
+        lonlats[i] = plate_carree_to_lonlat(lonlats[i]);
+      return;
+    }
+    PJconsts* pj = m_proj_context->proj_ptr();
+    for ( size_t i = 0; i < lonlats.size(); i++ )
+      lonlats[i] = proj_point_to_lonlat(pj, lonlats[i]);
+  }
+
+  void GeoReference::lonlats_to_points(std::vector<Vector2> const& lonlats,
+                                       std::vector<Vector2>& points) const {
+    if ( &points != &lonlats )
+      points = lonlats;
+    if ( ! m_is_projected ) return;
+    if ( m_is_plate_carree ) {
+      for ( size_t i = 0; i < points.size(); i++ )
+        points[i] = lonlat_to_plate_carree(points[i]);
+      return;
+    }
+    PJconsts* pj = m_proj_context->proj_ptr();
+    for ( size_t i = 0; i < points.size(); i++ )
+      points[i] = proj_lonlat_to_point(pj, points[i]);
+  }
+
+  void GeoReference::pixels_to_lonlats(std::vector<Vector2> const& pixels,
+                                       std::vector<Vector2>& lonlats) const {
+    pixels_to_points( pixels, lonlats );
+    points_to_lonlats( lonlats, lonlats );
+  }
+
+  void GeoReference::lonlats_to_pixels(std::vector<Vector2> const& lonlats,
+                                       std::vector<Vector2>& pixels) const {
+    lonlats_to_points( lonlats, pixels );
+    points_to_pixels( pixels, pixels );
+  }
+
   /************** Functions for class ProjContext *******************/
   char** ProjContext::split_proj4_string(std::string const& proj4_str, int &num_strings) {
     std::vector<std::string> arg_strings;
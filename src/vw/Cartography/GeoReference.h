@@ -17,6 +17,8 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <vector>
+
 #if defined(VW_HAVE_PKG_PROTOBUF) && VW_HAVE_PKG_PROTOBUF==1
 #include <vw/Cartography/GeoReferenceDesc.pb.h>
 #endif
@@ -67,7 +69,16 @@ namespace cartography {
     boost::shared_ptr<ProjContext> m_proj_context;
     bool m_is_projected;
 
+    // A plate carree (+proj=eqc) projection is affine in lon/lat, so
+    // init_proj() reads its coefficients back out of the Proj.4
+    // context and the conversions below skip Proj.4 altogether.
+    struct PlateCarree { double lam0, phi0, x0, y0, scale_x, scale_y; bool over; };
+    bool m_is_plate_carree;
+    PlateCarree m_plate_carree;
+
     void init_proj();
+    Vector2 plate_carree_to_lonlat(Vector2 const& loc) const;
+    Vector2 lonlat_to_plate_carree(Vector2 const& lon_lat) const;
 
     /// This method returns a version of the affine transform
     /// compatible with the VW standard notion that (0,0) is the
@@ -177,6 +188,18 @@ namespace cartography {
     /// the location in the projected coordinate system.
     virtual Vector2 lonlat_to_point(Vector2 lon_lat) const;
 
+    /// Batch versions of the conversions above.  Each converts a whole
+    /// array through the one Proj.4 context (or in closed form, for
+    /// unprojected and plate carree georeferences) without a virtual
+    /// call per point.  The output may be the same vector as the
+    /// input.
+    void pixels_to_points(std::vector<Vector2> const& pixels, std::vector<Vector2>& points) const;
+    void points_to_pixels(std::vector<Vector2> const& points, std::vector<Vector2>& pixels) const;
+    void points_to_lonlats(std::vector<Vector2> const& points, std::vector<Vector2>& lonlats) const;
+    void lonlats_to_points(std::vector<Vector2> const& lonlats, std::vector<Vector2>& points) const;
+    void pixels_to_lonlats(std::vector<Vector2> const& pixels, std::vector<Vector2>& lonlats) const;
+    void lonlats_to_pixels(std::vector<Vector2> const& lonlats, std::vector<Vector2>& pixels) const;
+
     /// For a bbox in pixel coordinates, find what that bbox covers
     /// in lonlat 
     virtual BBox2 pixel_to_lonlat_bbox(BBox2i pixel_bbox) const {
@@ -253,6 +276,20 @@ namespace cartography {
     write_image( *r, image, progress_callback );
   }
 
+  /// Like write_georeferenced_image, but rasterizes the image block by
+  /// block on several threads with block_write_image.
+  template <class ImageT>
+  void block_write_georeferenced_image( std::string const& filename,
+                                        ImageViewBase<ImageT> const& image,
+                                        GeoReference const& georef,
+                                        ProgressCallback const& progress_callback = ProgressCallback::dummy_instance() ) {
+    vw_out(InfoMessage, "fileio") << "\tSaving image: " << filename << "\t";
+    boost::scoped_ptr<DiskImageResource> r(DiskImageResource::create( filename, image.format() ));
+    vw_out(InfoMessage, "fileio") << r->cols() << "x" << r->rows() << "x" << r->planes() << "  " << r->channels() << " channel(s)\n";
+    write_georeference( *r, georef );
+    block_write_image( *r, image, progress_callback );
+  }
+
   /// The following namespace contains functions that return GeoReferences
   /// for certain well-known output styles, such as KML (and related
   /// functions involved in doing so).
@@ -19,7 +19,8 @@ namespace cartography {
 
   // Constructor
   GeoTransform::GeoTransform(GeoReference const& src_georef, GeoReference const& dst_georef) :
-    m_src_georef(src_georef), m_dst_georef(dst_georef) {
+    m_src_georef(src_georef), m_dst_georef(dst_georef),
+    m_affine(math::identity_matrix<2>(), Vector2()) {
     const std::string src_datum = m_src_georef.datum().proj4_str();
     const std::string dst_datum = m_dst_georef.datum().proj4_str();
 
@@ -56,15 +57,35 @@ namespace cartography {
       m_dst_datum = boost::shared_ptr<ProjContext>(new ProjContext(ss_dst.str()));
       CHECK_PROJ_INIT_ERROR(ss_dst.str().c_str());
     }
+
+    // With the same projection and datum, and affine georeference
+    // transforms, the map from source to destination pixels is affine
+    // too, and three points determine it.
+    Matrix3x3 src_transform = m_src_georef.transform(), dst_transform = m_dst_georef.transform();
+    m_is_affine = m_skip_map_projection && m_skip_datum_conversion &&
+      src_transform(2,0) == 0 && src_transform(2,1) == 0 && src_transform(2,2) == 1 &&
+      dst_transform(2,0) == 0 && dst_transform(2,1) == 0 && dst_transform(2,2) == 1;
+    if (m_is_affine) {
+      Vector2 origin = m_dst_georef.point_to_pixel(m_src_georef.pixel_to_point(Vector2(0,0)));
+      Vector2 x_axis = m_dst_georef.point_to_pixel(m_src_georef.pixel_to_point(Vector2(1,0))) - origin;
+      Vector2 y_axis = m_dst_georef.point_to_pixel(m_src_georef.pixel_to_point(Vector2(0,1))) - origin;
+      Matrix2x2 linear;
+      select_col(linear,0) = x_axis;
+      select_col(linear,1) = y_axis;
+      m_affine = AffineTransform(linear, origin);
+    }
+
     // Because GeoTransform is typically very slow, we default to a tolerance
-    // of 0.1 pixels to allow ourselves to be approximated.
-    set_tolerance( 0.1 );
+    // of 0.1 pixels to allow ourselves to be approximated.  An affine
+    // transform is already as cheap as its approximation.
+    set_tolerance( m_is_affine ? 0.0 : 0.1 );
   }
 
-  // Performs a forward or reverse datum conversion.
+  // Performs a forward or reverse datum conversion.  Proj.4 latlong
+  // contexts work in radians.
   Vector2 GeoTransform::datum_convert(Vector2 const& v, bool forward) const {
-    double x = v[0];
-    double y = v[1];
+    double x = v[0] * DEG_TO_RAD;
+    double y = v[1] * DEG_TO_RAD;
     double z = 0;
 
     if(forward)
@@ -73,11 +94,51 @@ namespace cartography {
       pj_transform(m_dst_datum->proj_ptr(), m_src_datum->proj_ptr(), 1, 0, &x, &y, &z);
     CHECK_PROJ_ERROR;
 
-    return Vector2(x, y);
+    return Vector2(x * RAD_TO_DEG, y * RAD_TO_DEG);
+  }
+
+  void GeoTransform::datum_convert(std::vector<Vector2>& v, bool forward) const {
+    if ( v.empty() ) return;
+    std::vector<double> z( v.size(), 0 );
+    for ( size_t i = 0; i < v.size(); i++ )
+      v[i] *= DEG_TO_RAD;
+
+    // The points are stored as consecutive (x,y) pairs, so x and y
+    // are each two doubles apart.
+    if(forward)
+      pj_transform(m_src_datum->proj_ptr(), m_dst_datum->proj_ptr(), long(v.size()), 2, &v[0][0], &v[0][1], &z[0]);
+    else
+      pj_transform(m_dst_datum->proj_ptr(), m_src_datum->proj_ptr(), long(v.size()), 2, &v[0][0], &v[0][1], &z[0]);
+    CHECK_PROJ_ERROR;
+
+    for ( size_t i = 0; i < v.size(); i++ )
+      v[i] *= RAD_TO_DEG;
+  }
+
+  void GeoTransform::reverse_row( Vector2 const& start, int32 n, Vector2* result ) const {
+    if (m_is_affine) {
+      m_affine.reverse_row( start, n, result );
+      return;
+    }
+    std::vector<Vector2> points( n );
+    for ( int32 i = 0; i < n; ++i )
+      points[i] = Vector2( start.x()+i, start.y() );
+    if (m_skip_map_projection) {
+      m_dst_georef.pixels_to_points(points, points);
+      m_src_georef.points_to_pixels(points, points);
+    } else {
+      m_dst_georef.pixels_to_lonlats(points, points);
+      if (!m_skip_datum_conversion)
+        datum_convert(points, false);
+      m_src_georef.lonlats_to_pixels(points, points);
+    }
+    std::copy( points.begin(), points.end(), result );
   }
 
   BBox2i GeoTransform::forward_bbox( BBox2i const& bbox ) const {
     BBox2 r = TransformHelper<GeoTransform,ContinuousFunction,ContinuousFunction>::forward_bbox(bbox);
+    if (m_is_affine)
+      return grow_bbox_to_int(r);
     BresenhamLine l1( bbox.min(), bbox.max() );
     while ( l1.is_good() ) {
       try {
@@ -99,6 +160,8 @@ namespace cartography {
 
   BBox2i GeoTransform::reverse_bbox( BBox2i const& bbox ) const {
     BBox2 r = TransformHelper<GeoTransform,ContinuousFunction,ContinuousFunction>::reverse_bbox(bbox);
+    if (m_is_affine)
+      return grow_bbox_to_int(r);
     BresenhamLine l1( bbox.min(), bbox.max() );
     while ( l1.is_good() ) {
       try {
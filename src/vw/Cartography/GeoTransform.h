@@ -10,6 +10,7 @@
 
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <vw/Math/Vector.h>
 #include <vw/Image/Transform.h>
@@ -27,11 +28,22 @@ namespace cartography {
     bool m_skip_map_projection;
     bool m_skip_datum_conversion;
 
+    // When the georefs share a projection and datum and differ only in
+    // their affine transforms, the whole mapping collapses to this one
+    // affine transform from source to destination pixels.
+    bool m_is_affine;
+    AffineTransform m_affine;
+
     /* Converts between datums. The parameter 'forward' specifies whether
      * we convert forward (true) or reverse (false).
     */
     Vector2 datum_convert(Vector2 const& v, bool forward) const;
 
+    /* Converts a whole array of points between datums, in place, in a
+     * single call to Proj.4.
+    */
+    void datum_convert(std::vector<Vector2>& v, bool forward) const;
+
   public:
     /// Normal constructor
     GeoTransform(GeoReference const& src_georef, GeoReference const& dst_georef);
@@ -40,6 +52,8 @@ namespace cartography {
     /// georeference frame, this routine computes the corresponding
     /// pixel from an image in the source georeference frame.
     Vector2 reverse(Vector2 const& v) const {
+      if (m_is_affine)
+        return m_affine.reverse(v);
       if (m_skip_map_projection)
         return m_src_georef.point_to_pixel(m_dst_georef.pixel_to_point(v));
       if(m_skip_datum_conversion)
@@ -49,10 +63,16 @@ namespace cartography {
       return m_src_georef.lonlat_to_pixel(dst_lonlat);
     }
 
+    /// Applies reverse() to a row of n pixels, converting the whole
+    /// row at once with the batch methods of GeoReference.
+    void reverse_row( Vector2 const& start, int32 n, Vector2* result ) const;
+
     /// Given a pixel coordinate of an image in a source
     /// georeference frame, this routine computes the corresponding
     /// pixel the destination (transformed) image.
     Vector2 forward(Vector2 const& v) const {
+      if (m_is_affine)
+        return m_affine.forward(v);
       if (m_skip_map_projection)
         return m_dst_georef.point_to_pixel(m_src_georef.pixel_to_point(v));
       if(m_skip_datum_conversion)
@@ -62,6 +82,14 @@ namespace cartography {
       return m_dst_georef.lonlat_to_pixel(src_lonlat);
     }
 
+    /// True if the transform reduces to an affine map between pixels.
+    bool is_affine() const { return m_is_affine; }
+
+    // An affine map is convex, so its bounding boxes only need the
+    // corners.
+    FunctionType forward_type() const { return m_is_affine ? ConvexFunction : ContinuousFunction; }
+    FunctionType reverse_type() const { return m_is_affine ? ConvexFunction : ContinuousFunction; }
+
     // We override forward_bbox so it understands to check if the image
     // crosses the poles or not.
     BBox2i forward_bbox( BBox2i const& bbox ) const;
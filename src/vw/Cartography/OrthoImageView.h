@@ -9,12 +9,18 @@
 #define __VW_CARTOGRAPHY_ORTHOIMAGEVIEW_H__
 
 #include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/Interpolation.h>
+#include <vw/Image/Transform.h>
 #include <vw/Cartography/GeoReference.h>
 #include <vw/Camera/CameraModel.h>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/math/special_functions/fpclassify.hpp>
+
+#include <vector>
 
 namespace vw {
 namespace cartography {
@@ -25,6 +31,12 @@ namespace cartography {
   /// This image view assumes the dimensions and georeferencing of the
   /// Terrain image (i.e. the DTM), but it assumes the pixel type of
   /// the camera image.
+  ///
+  /// Rasterizing a block projects the whole block through the camera
+  /// at once, then reads the part of the camera image it sees into a
+  /// local buffer and interpolates from that.  Blocks are independent,
+  /// so rasterize it with block_rasterize or block_write_image to
+  /// spread them over threads.
   template <class TerrainImageT, class CameraImageT, class InterpT, class EdgeT>
   class OrthoImageView : public ImageViewBase<OrthoImageView<TerrainImageT, CameraImageT, InterpT, EdgeT> > {
 
@@ -40,17 +52,21 @@ namespace cartography {
 
     // Provide safe interaction with DEMs that are scalar or compound
     template <class PixelT>
-    typename boost::enable_if< IsScalar<PixelT>, double >::type
-    inline Helper( offset_type x, offset_type y ) const {
-      return m_terrain(x,y);
+    static inline typename boost::enable_if< IsScalar<PixelT>, double >::type
+    Helper( PixelT const& px ) {
+      return px;
     }
 
     template <class PixelT>
-    typename boost::enable_if< IsCompound<PixelT>, double>::type
-    inline Helper( offset_type x, offset_type y ) const {
-      return m_terrain(x,y)[0];
+    static inline typename boost::enable_if< IsCompound<PixelT>, double>::type
+    Helper( PixelT const& px ) {
+      return px[0];
     }
 
+    // Camera buffers larger than this many pixels are not worth
+    // holding; the block reads the camera image directly instead.
+    static const int64 max_buffer_pixels = 1 << 22;
+
   public:
     typedef typename CameraImageT::pixel_type pixel_type;
     typedef const pixel_type result_type;
@@ -95,7 +111,7 @@ namespace cartography {
       //    converts from altitude to planetary radius.
       // 3. Convert to cartesian (xyz) coordinates.
       Vector2 lon_lat( m_georef.pixel_to_lonlat(Vector2(i,j)) );
-      Vector3 xyz = m_georef.datum().geodetic_to_cartesian( Vector3( lon_lat.x(), lon_lat.y(), Helper<typename TerrainImageT::pixel_type>(i,j) ) );
+      Vector3 xyz = m_georef.datum().geodetic_to_cartesian( Vector3( lon_lat.x(), lon_lat.y(), Helper( m_terrain(i,j) ) ) );
 
       // Now we can image the point using the camera model and return
       // the resulting pixel from the camera image.
@@ -110,7 +126,82 @@ namespace cartography {
                                 m_georef, m_camera_image_ref,
                                 m_camera_model, m_interp_func, m_edge_func);
     }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    template <class DestT> void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      typedef typename TerrainImageT::pixel_type TerrainPixelT;
+      typedef typename DestT::pixel_type DestPixelT;
+      typedef typename DestT::pixel_accessor DestAccT;
+      VW_ASSERT( int(dest.cols())==bbox.width() && int(dest.rows())==bbox.height() && dest.planes()==planes(),
+                 ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+
+      // Project every valid DEM pixel of the block into the camera.
+      ImageView<TerrainPixelT> terrain = crop( m_terrain, bbox );
+      std::vector<Vector2> lonlats;
+      std::vector<int32> offsets;
+      for ( int32 j = 0; j < bbox.height(); ++j )
+        for ( int32 i = 0; i < bbox.width(); ++i )
+          if ( !is_transparent( terrain(i,j) ) ) {
+            lonlats.push_back( Vector2( bbox.min().x()+i, bbox.min().y()+j ) );
+            offsets.push_back( j*bbox.width()+i );
+          }
+      m_georef.pixels_to_lonlats( lonlats, lonlats );
+      std::vector<Vector3> points( lonlats.size() );
+      for ( size_t k = 0; k < points.size(); ++k )
+        points[k] = Vector3( lonlats[k].x(), lonlats[k].y(), Helper( terrain.data()[offsets[k]] ) );
+      m_georef.datum().geodetic_to_cartesian( points, points );
+      std::vector<Vector2> pixels;
+      m_camera_model->points_to_pixels( points, pixels );
+
+      // The camera image the block sees, with room for the
+      // interpolation kernel.  Beyond one kernel width of the image
+      // it is edge extension, which is left to m_camera_image.
+      BBox2 seen;
+      for ( size_t k = 0; k < pixels.size(); ++k )
+        if ( boost::math::isfinite( pixels[k].x() ) && boost::math::isfinite( pixels[k].y() ) )
+          seen.grow( pixels[k] );
+      int32 const pb = InterpT::pixel_buffer + 1;
+      BBox2i footprint;
+      if ( !seen.empty() ) {
+        footprint = grow_bbox_to_int( seen );
+        footprint.expand( pb );
+        footprint.crop( BBox2i( -pb, -pb, m_camera_image_ref.cols() + 2*pb, m_camera_image_ref.rows() + 2*pb ) );
+      }
+      bool buffered = !footprint.empty() &&
+        int64(footprint.width()) * footprint.height() <= max_buffer_pixels;
+      ImageView<typename CameraImageT::pixel_type> buffer;
+      if ( buffered )
+        buffer = crop( edge_extend( m_camera_image_ref, m_edge_func ), footprint );
+      InterpolationView<EdgeExtensionView<ImageView<typename CameraImageT::pixel_type>, ConstantEdgeExtension>, InterpT>
+        local = interpolate( buffer, m_interp_func, ConstantEdgeExtension() );
+      BBox2 interior;
+      if ( buffered )
+        interior = BBox2( footprint.min().x() + pb, footprint.min().y() + pb,
+                          footprint.width() - 2*pb, footprint.height() - 2*pb );
+
+      // Missing DEM pixels stay empty.
+      DestAccT dplane = dest.origin();
+      for ( int32 p = 0; p < planes(); ++p ) {
+        DestAccT drow = dplane;
+        size_t k = 0;
+        for ( int32 j = 0; j < bbox.height(); ++j ) {
+          DestAccT dcol = drow;
+          for ( int32 i = 0; i < bbox.width(); ++i ) {
+            if ( k < pixels.size() && offsets[k] == j*bbox.width()+i ) {
+              Vector2 const& pix = pixels[k++];
+              if ( buffered && pix.x() >= interior.min().x() && pix.x() <= interior.max().x() &&
+                   pix.y() >= interior.min().y() && pix.y() <= interior.max().y() )
+                *dcol = DestPixelT( local( pix.x() - footprint.min().x(), pix.y() - footprint.min().y(), p ) );
+              else
+                *dcol = DestPixelT( m_camera_image( pix.x(), pix.y(), p ) );
+            } else {
+              *dcol = DestPixelT( result_type() );
+            }
+            dcol.next_col();
+          }
+          drow.next_row();
+        }
+        dplane.next_plane();
+      }
+    }
     /// \endcond
   };
 
@@ -9,10 +9,15 @@
 #define __VW_CARTOGRAPHY_POINTIMAGEMANIPLULATION_H__
 
 #include <vw/Math/Vector.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
 #include <vw/Image/PerPixelViews.h>
 #include <vw/Image/UtilityViews.h>
 #include <vw/Cartography/GeoReference.h>
 
+#include <vector>
+
 // This include is here to keep compat (the contents of that header used to be
 // here, and was split up to break the Camera<=>Cartography circular dep).
 #include <vw/Cartography/SimplePointImageManipulation.h>
@@ -42,6 +47,18 @@ namespace cartography {
       return T(lon_lat(0), lon_lat(1),
                p(2)+m_src.datum().radius(lon_lat(0), lon_lat(1))-m_dst.datum().radius(lon_lat(0), lon_lat(1)));
     }
+
+    /// Every point is converted.
+    template <class T>
+    bool skip(T const& /*p*/) const { return false; }
+
+    /// Converts a whole array of points at once, in place.
+    void operator()(std::vector<Vector2>& xy, std::vector<double>& z) const {
+      m_src.points_to_lonlats(xy, xy);
+      m_dst.lonlats_to_points(xy, xy);
+      for (size_t i = 0; i < xy.size(); ++i)
+        z[i] += m_src.datum().radius(xy[i][0], xy[i][1]) - m_dst.datum().radius(xy[i][0], xy[i][1]);
+    }
   };
 
   // This version of the functor assumes that the point inputs are
@@ -63,6 +80,120 @@ namespace cartography {
       return T(lon_lat(0), lon_lat(1),
                m_forward ? p(2) - offset : p(2) + offset);
     }
+
+    /// Zero points are left as they are.
+    template <class T>
+    bool skip(T const& p) const { return p == T(); }
+
+    /// Converts a whole array of points at once, in place.
+    void operator()(std::vector<Vector2>& xy, std::vector<double>& z) const {
+      m_dst.lonlats_to_points(xy, xy);
+      for (size_t i = 0; i < xy.size(); ++i) {
+        double offset = m_dst.datum().radius(xy[i][0], xy[i][1]);
+        z[i] = m_forward ? z[i] - offset : z[i] + offset;
+      }
+    }
+  };
+
+  /// Converts geodetic (lon, lat, alt) points to cartesian ones on a
+  /// datum, or back when forward = false.
+  class GeodeticPointFunctor : public UnaryReturnSameType {
+    Datum m_datum;
+    bool m_forward;
+
+  public:
+    GeodeticPointFunctor(Datum const& datum, bool forward = true) : m_datum(datum), m_forward(forward) {}
+
+    template <class T>
+    T operator()(T const& p) const {
+      Vector3 result = m_forward ? m_datum.geodetic_to_cartesian(Vector3(p))
+                                 : m_datum.cartesian_to_geodetic(Vector3(p));
+      return T(result);
+    }
+
+    /// Zero points are left as they are.
+    template <class T>
+    bool skip(T const& p) const { return p == T(); }
+
+    /// Converts a whole array of points at once, in place.
+    void operator()(std::vector<Vector2>& xy, std::vector<double>& z) const {
+      if (xy.empty()) return;
+      std::vector<double> x(xy.size()), y(xy.size());
+      for (size_t i = 0; i < xy.size(); ++i) {
+        x[i] = xy[i][0];
+        y[i] = xy[i][1];
+      }
+      if (m_forward)
+        m_datum.geodetic_to_cartesian(xy.size(), &x[0], &y[0], &z[0], &x[0], &y[0], &z[0]);
+      else
+        m_datum.cartesian_to_geodetic(xy.size(), &x[0], &y[0], &z[0], &x[0], &y[0], &z[0]);
+      for (size_t i = 0; i < xy.size(); ++i)
+        xy[i] = Vector2(x[i], y[i]);
+    }
+  };
+
+  /// An image of points converted by one of the functors above.  It is
+  /// a per-pixel view, but rasterizing a block gathers the block's
+  /// points and converts them in one batch, which is much cheaper for
+  /// projected georeferences.  Blocks are independent, so
+  /// block_rasterize and block_write_image convert them in parallel.
+  ///
+  /// The pixels may be masked; invalid pixels, and those the functor
+  /// skips, are passed through untouched.
+  template <class ImageT, class FuncT>
+  class PointBatchView : public ImageViewBase<PointBatchView<ImageT, FuncT> > {
+    ImageT m_image;
+    FuncT m_func;
+
+  public:
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<PointBatchView> pixel_accessor;
+
+    PointBatchView(ImageT const& image, FuncT const& func) : m_image(image), m_func(func) {}
+
+    inline int32 cols() const { return m_image.cols(); }
+    inline int32 rows() const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+    inline result_type operator()(int32 i, int32 j, int32 /*p*/=0) const {
+      result_type px = m_image(i,j);
+      if (is_valid(px) && !m_func.skip(remove_mask(px)))
+        remove_mask(px) = m_func(remove_mask(px));
+      return px;
+    }
+
+    /// \cond INTERNAL
+    typedef PointBatchView<typename ImageT::prerasterize_type, FuncT> prerasterize_type;
+    inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+      return prerasterize_type(m_image.prerasterize(bbox), m_func);
+    }
+    template <class DestT> void rasterize(DestT const& dest, BBox2i const& bbox) const {
+      ImageView<pixel_type> block = crop(m_image, bbox);
+      std::vector<pixel_type*> pixels;
+      pixels.reserve(block.cols() * block.rows());
+      for (int32 j = 0; j < block.rows(); ++j)
+        for (int32 i = 0; i < block.cols(); ++i)
+          if (is_valid(block(i,j)) && !m_func.skip(remove_mask(block(i,j))))
+            pixels.push_back(&block(i,j));
+
+      std::vector<Vector2> xy(pixels.size());
+      std::vector<double> z(pixels.size());
+      for (size_t k = 0; k < pixels.size(); ++k) {
+        xy[k] = subvector(remove_mask(*pixels[k]), 0, 2);
+        z[k] = remove_mask(*pixels[k])[2];
+      }
+      m_func(xy, z);
+      for (size_t k = 0; k < pixels.size(); ++k) {
+        remove_mask(*pixels[k])[0] = xy[k][0];
+        remove_mask(*pixels[k])[1] = xy[k][1];
+        remove_mask(*pixels[k])[2] = z[k];
+      }
+      block.rasterize(dest, BBox2i(0, 0, bbox.width(), bbox.height()));
+    }
+    /// \endcond
   };
 
   template <class PixelT>
@@ -83,6 +214,65 @@ namespace cartography {
       }
   };
 
+  /// The point image of a DEM, as (lon, lat, alt) in RealT.  Missing
+  /// DEM pixels give zero points.  Rasterizing a block converts each
+  /// row of pixel locations to lon/lat in one batch.  Points in float
+  /// are half the size, and are enough where the coordinates need not
+  /// be better than a few parts in 10^7.
+  template <class ImageT, class RealT = double>
+  class DemToPointImageView : public ImageViewBase<DemToPointImageView<ImageT, RealT> > {
+    ImageT m_dem;
+    GeoReference m_georef;
+
+  public:
+    typedef Vector<RealT,3> pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<DemToPointImageView> pixel_accessor;
+
+    DemToPointImageView(ImageT const& dem, GeoReference const& georef) : m_dem(dem), m_georef(georef) {}
+
+    inline int32 cols() const { return m_dem.cols(); }
+    inline int32 rows() const { return m_dem.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+    inline result_type operator()(int32 i, int32 j, int32 /*p*/=0) const {
+      typename ImageT::pixel_type alt = m_dem(i,j);
+      if (is_transparent(alt))
+        return result_type();
+      Vector2 lonlat = m_georef.pixel_to_lonlat(Vector2(i,j));
+      Vector3 result(lonlat[0], lonlat[1], 0);
+      result.z() = alt;
+      return result;
+    }
+
+    /// \cond INTERNAL
+    typedef DemToPointImageView<typename ImageT::prerasterize_type, RealT> prerasterize_type;
+    inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+      return prerasterize_type(m_dem.prerasterize(bbox), m_georef);
+    }
+    template <class DestT> void rasterize(DestT const& dest, BBox2i const& bbox) const {
+      ImageView<typename ImageT::pixel_type> dem = crop(m_dem, bbox);
+      ImageView<pixel_type> block(bbox.width(), bbox.height());
+      std::vector<Vector2> lonlats(bbox.width());
+      for (int32 j = 0; j < bbox.height(); ++j) {
+        for (int32 i = 0; i < bbox.width(); ++i)
+          lonlats[i] = Vector2(bbox.min().x()+i, bbox.min().y()+j);
+        m_georef.pixels_to_lonlats(lonlats, lonlats);
+        for (int32 i = 0; i < bbox.width(); ++i) {
+          if (is_transparent(dem(i,j)))
+            continue;
+          Vector3 result(lonlats[i][0], lonlats[i][1], 0);
+          result.z() = dem(i,j);
+          block(i,j) = result;
+        }
+      }
+      block.rasterize(dest, BBox2i(0, 0, bbox.width(), bbox.height()));
+    }
+    /// \endcond
+  };
+
   /// Takes an ImageView of Vector<ElemT,3> in some source projected space
   /// with (lon,lat,alt) or (x,y,alt) and returns an ImageView of
   /// vectors that are in the destination projection.
@@ -97,27 +287,49 @@ namespace cartography {
   /// the notion of horizontal (x) and vertical (y) coordinates in an
   /// image.
   template <class ImageT>
-  UnaryPerPixelView<ImageT, ReprojectPointFunctor>
+  PointBatchView<ImageT, ReprojectPointFunctor>
   inline reproject_point_image( ImageViewBase<ImageT> const& image, GeoReference const& src_georef, GeoReference const& dst_georef) {
-    return UnaryPerPixelView<ImageT,ReprojectPointFunctor>( image.impl(), ReprojectPointFunctor(src_georef, dst_georef) );
+    return PointBatchView<ImageT,ReprojectPointFunctor>( image.impl(), ReprojectPointFunctor(src_georef, dst_georef) );
   }
 
   // This variant, which only accepts a destination projection,
   // assumes that the source points are [lon, lat, radius] values.
   template <class ImageT>
-  UnaryPerPixelView<ImageT, ProjectPointFunctor>
+  PointBatchView<ImageT, ProjectPointFunctor>
   inline project_point_image( ImageViewBase<ImageT> const& image, GeoReference const& dst_georef, bool forward=true) {
-    return UnaryPerPixelView<ImageT,ProjectPointFunctor>( image.impl(), ProjectPointFunctor(dst_georef, forward) );
+    return PointBatchView<ImageT,ProjectPointFunctor>( image.impl(), ProjectPointFunctor(dst_georef, forward) );
+  }
+
+  /// Takes an ImageView of geodetic (lon, lat, alt) points, such as
+  /// dem_to_point_image() gives, and returns one of the cartesian
+  /// points on the datum.  Each block is converted in one batch.  Zero
+  /// points, the DEM's missing pixels, are left as zero.
+  template <class ImageT>
+  PointBatchView<ImageT, GeodeticPointFunctor>
+  inline geodetic_to_cartesian( ImageViewBase<ImageT> const& image, Datum const& datum ) {
+    return PointBatchView<ImageT, GeodeticPointFunctor>( image.impl(), GeodeticPointFunctor(datum) );
+  }
+
+  /// The reverse of geodetic_to_cartesian().
+  template <class ImageT>
+  PointBatchView<ImageT, GeodeticPointFunctor>
+  inline cartesian_to_geodetic( ImageViewBase<ImageT> const& image, Datum const& datum ) {
+    return PointBatchView<ImageT, GeodeticPointFunctor>( image.impl(), GeodeticPointFunctor(datum, false) );
   }
 
   // This utility function converts a DEM to a point image
   template <class ImageT>
-  BinaryPerPixelView<PerPixelIndexView<VectorIndexFunctor>, ImageT, DemToPointImageFunctor<typename ImageT::pixel_type> >
+  DemToPointImageView<ImageT>
+  inline dem_to_point_image(ImageViewBase<ImageT> const& dem, GeoReference georef) {
+    return DemToPointImageView<ImageT>(dem.impl(), georef);
+  }
+
+  // The same, with points of the given precision, as in
+  // dem_to_point_image<float>(dem, georef).
+  template <class RealT, class ImageT>
+  DemToPointImageView<ImageT, RealT>
   inline dem_to_point_image(ImageViewBase<ImageT> const& dem, GeoReference georef) {
-    typedef DemToPointImageFunctor<typename ImageT::pixel_type> func_type;
-    typedef BinaryPerPixelView<PerPixelIndexView<VectorIndexFunctor>, ImageT, func_type> result_type;
-    func_type func(georef);
-    return result_type(pixel_index_view(dem), dem.impl(), func);
+    return DemToPointImageView<ImageT, RealT>(dem.impl(), georef);
   }
 }} // namespace vw::cartography
 
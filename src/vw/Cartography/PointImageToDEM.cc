@@ -0,0 +1,110 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Cartography/PointImageToDEM.h>
+
+#include <algorithm>
+#include <cmath>
+
+void vw::cartography::detail::points_to_dem_pixels( GeoReference const& georef, double center,
+                                                    std::vector<Vector3>& points ) {
+  georef.datum().cartesian_to_geodetic( points, points );
+
+  // Longitudes come back in [-180,180], which is the wrong half of the
+  // world for a DEM in [0,360].
+  std::vector<Vector2> pixels( points.size() );
+  for ( size_t k = 0; k < points.size(); ++k ) {
+    double lon = points[k][0];
+    lon -= 360 * std::floor( ( lon - center + 180 ) / 360 );
+    pixels[k] = Vector2( lon, points[k][1] );
+  }
+  georef.lonlats_to_pixels( pixels, pixels );
+  for ( size_t k = 0; k < points.size(); ++k ) {
+    points[k][0] = pixels[k][0];
+    points[k][1] = pixels[k][1];
+  }
+}
+
+double vw::cartography::detail::dem_grid_reach( DEMGridMethod method, double radius ) {
+  return method == DEM_GRID_WEIGHTED ? radius : 0.5;
+}
+
+vw::cartography::detail::DEMGridBlock::DEMGridBlock( BBox2i const& bbox, DEMGridMethod method, double radius )
+  : m_bbox(bbox), m_method(method), m_radius(radius) {
+  if ( m_method != DEM_GRID_MEDIAN ) {
+    m_sum.resize( size_t(bbox.width()) * bbox.height(), 0.0 );
+    m_weight.resize( size_t(bbox.width()) * bbox.height(), 0.0 );
+  }
+}
+
+void vw::cartography::detail::DEMGridBlock::add( std::vector<Vector3> const& points ) {
+  double cols = m_bbox.width(), rows = m_bbox.height();
+  for ( size_t k = 0; k < points.size(); ++k ) {
+    double x = points[k][0] - m_bbox.min().x();
+    double y = points[k][1] - m_bbox.min().y();
+    double z = points[k][2];
+    // This also skips NaNs, from points the georeference cannot project.
+    if ( !( x == x && y == y && z == z ) )
+      continue;
+
+    if ( m_method != DEM_GRID_WEIGHTED ) {
+      if ( x < -0.5 || y < -0.5 || x >= cols - 0.5 || y >= rows - 0.5 )
+        continue;
+      size_t index = size_t( std::floor( y + 0.5 ) ) * m_bbox.width() + size_t( std::floor( x + 0.5 ) );
+      if ( m_method == DEM_GRID_MEAN ) {
+        m_sum[index] += z;
+        m_weight[index] += 1;
+      } else {
+        m_values.push_back( std::make_pair( int32(index), float(z) ) );
+      }
+      continue;
+    }
+
+    // A Gaussian with a standard deviation of half the radius
+    if ( x + m_radius < 0 || y + m_radius < 0 || x - m_radius > cols - 1 || y - m_radius > rows - 1 )
+      continue;
+    int32 i0 = int32( std::max( 0.0, std::ceil( x - m_radius ) ) );
+    int32 i1 = int32( std::min( cols - 1, std::floor( x + m_radius ) ) );
+    int32 j0 = int32( std::max( 0.0, std::ceil( y - m_radius ) ) );
+    int32 j1 = int32( std::min( rows - 1, std::floor( y + m_radius ) ) );
+    double r2 = m_radius * m_radius;
+    for ( int32 j = j0; j <= j1; ++j )
+      for ( int32 i = i0; i <= i1; ++i ) {
+        double d2 = ( i - x ) * ( i - x ) + ( j - y ) * ( j - y );
+        if ( d2 > r2 )
+          continue;
+        double w = std::exp( -2 * d2 / r2 );
+        size_t index = size_t(j) * m_bbox.width() + i;
+        m_sum[index] += w * z;
+        m_weight[index] += w;
+      }
+  }
+}
+
+void vw::cartography::detail::DEMGridBlock::result( ImageView<PixelMask<float> > const& dest ) {
+  int32 cols = m_bbox.width();
+  for ( int32 j = 0; j < dest.rows(); ++j )
+    for ( int32 i = 0; i < dest.cols(); ++i )
+      dest(i,j) = PixelMask<float>();
+
+  if ( m_method != DEM_GRID_MEDIAN ) {
+    for ( size_t index = 0; index < m_sum.size(); ++index )
+      if ( m_weight[index] > 0 )
+        dest( int32( index % cols ), int32( index / cols ) ) = PixelMask<float>( float( m_sum[index] / m_weight[index] ) );
+    return;
+  }
+
+  std::sort( m_values.begin(), m_values.end() );
+  for ( size_t begin = 0, end; begin < m_values.size(); begin = end ) {
+    int32 index = m_values[begin].first;
+    for ( end = begin + 1; end < m_values.size() && m_values[end].first == index; ++end ) {}
+    size_t n = end - begin, mid = begin + n / 2;
+    float median = ( n % 2 ) ? m_values[mid].second
+                             : ( m_values[mid-1].second + m_values[mid].second ) / 2;
+    dest( index % cols, index / cols ) = PixelMask<float>( median );
+  }
+}
@@ -0,0 +1,262 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file PointImageToDEM.h
+///
+/// Grids a point image, such as that of a StereoView, into a DEM in a
+/// given georeference: the reverse of dem_to_point_image().
+///
+/// The points are cartesian (x,y,z), and are converted to heights above
+/// the georeference's datum.  Zero points, and invalid ones in a masked
+/// image, are missing and are left out.  DEM pixels that no point
+/// reaches are invalid.
+///
+/// When the view is built, a pre-pass converts the point image a block
+/// at a time, in parallel, and keeps only the bounding box each block
+/// of points covers in the DEM.  Rasterizing a block of the DEM then
+/// reads and grids just the blocks of points whose boxes overlap it, so
+/// memory use is bounded by the DEM block size and the density of the
+/// points, not the size of the cloud.  DEM blocks are independent, so
+/// block_write_image() grids them in parallel.  Each block of points is
+/// converted again for every DEM block it overlaps, so DEM blocks much
+/// smaller than the footprints of the point blocks waste work.
+///
+#ifndef __VW_CARTOGRAPHY_POINTIMAGETODEM_H__
+#define __VW_CARTOGRAPHY_POINTIMAGETODEM_H__
+
+#include <vector>
+#include <utility>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/BBox.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Cartography/GeoReference.h>
+
+namespace vw {
+namespace cartography {
+
+  /// How the heights of the points are combined into a DEM pixel
+  enum DEMGridMethod {
+    /// The mean height of the points in the pixel
+    DEM_GRID_MEAN,
+    /// The median height of the points in the pixel
+    DEM_GRID_MEDIAN,
+    /// The mean height of the points within the search radius of the
+    /// pixel center, weighted by a Gaussian of their distance from it
+    /// with a standard deviation of half the radius
+    DEM_GRID_WEIGHTED
+  };
+
+  /// \cond INTERNAL
+  namespace detail {
+
+    /// Converts cartesian points to (column, row, height) in the pixels
+    /// of a georeference, in place.  Longitudes are taken to within 180
+    /// degrees of center.
+    void points_to_dem_pixels( GeoReference const& georef, double center, std::vector<Vector3>& points );
+
+    /// How far, in pixels, a point reaches to the pixel centers it is
+    /// gridded into.
+    double dem_grid_reach( DEMGridMethod method, double radius );
+
+    /// Grids (column, row, height) points into one block of a DEM.
+    class DEMGridBlock {
+      BBox2i m_bbox;
+      DEMGridMethod m_method;
+      double m_radius;
+      std::vector<double> m_sum, m_weight;
+      std::vector<std::pair<int32, float> > m_values;
+
+    public:
+      DEMGridBlock( BBox2i const& bbox, DEMGridMethod method, double radius );
+
+      /// Adds points.  Those that do not reach the block are ignored.
+      void add( std::vector<Vector3> const& points );
+
+      /// Writes the DEM block.
+      void result( ImageView<PixelMask<float> > const& dest );
+    };
+
+    /// The valid, non-zero points of a block of a point image
+    template <class ImageT>
+    void gather_points( ImageT const& image, BBox2i const& bbox, std::vector<Vector3>& points ) {
+      typedef typename ImageT::pixel_type pixel_type;
+      typedef typename UnmaskedPixelType<pixel_type>::type point_type;
+      ImageView<pixel_type> block = crop( image, bbox );
+      points.clear();
+      for ( int32 j = 0; j < block.rows(); ++j )
+        for ( int32 i = 0; i < block.cols(); ++i ) {
+          pixel_type const& px = block(i,j);
+          if ( is_valid(px) && remove_mask(px) != point_type() )
+            points.push_back( Vector3( remove_mask(px) ) );
+        }
+    }
+
+    // Finds the box a block of points covers in the DEM
+    template <class ImageT>
+    class DEMGridIndexTask : public Task {
+      ImageT const& m_points;
+      GeoReference const& m_georef;
+      double m_center;
+      BBox2i m_block;
+      double m_reach;
+      BBox2& m_bbox;
+
+    public:
+      DEMGridIndexTask( ImageT const& points, GeoReference const& georef, double center,
+                        BBox2i const& block, double reach, BBox2& bbox ) :
+        m_points(points), m_georef(georef), m_center(center), m_block(block), m_reach(reach), m_bbox(bbox) {}
+
+      virtual void operator()() {
+        std::vector<Vector3> points;
+        gather_points( m_points, m_block, points );
+        points_to_dem_pixels( m_georef, m_center, points );
+        BBox2 bbox;
+        for ( size_t k = 0; k < points.size(); ++k )
+          if ( points[k] == points[k] ) // not NaN
+            bbox.grow( subvector( points[k], 0, 2 ) );
+        if ( !points.empty() )
+          bbox.expand( m_reach );
+        m_bbox = bbox;
+      }
+    };
+
+  } // namespace detail
+  /// \endcond
+
+  /// A DEM gridded from a point image.  See point_image_to_dem().
+  template <class ImageT>
+  class PointImageToDEMView : public ImageViewBase<PointImageToDEMView<ImageT> > {
+
+    // The blocks of the point image, and the boxes their points
+    // cover in the DEM, expanded by the reach of the gridding.  The
+    // boxes of blocks with no points are empty.
+    struct Index {
+      std::vector<BBox2i> blocks;
+      std::vector<BBox2> bboxes;
+    };
+
+    ImageT m_points;
+    GeoReference m_georef;
+    int32 m_cols, m_rows;
+    DEMGridMethod m_method;
+    double m_radius;
+    double m_center;
+    boost::shared_ptr<Index> m_index;
+
+  public:
+    typedef PixelMask<float> pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<PointImageToDEMView> pixel_accessor;
+
+    /// Indexes the point image in blocks of block_size pixels on
+    /// num_threads threads (by default, the number in vw_settings()).
+    PointImageToDEMView( ImageT const& points, GeoReference const& georef, int32 cols, int32 rows,
+                         DEMGridMethod method, double radius, int32 block_size = 256, int num_threads = 0 ) :
+      m_points(points), m_georef(georef), m_cols(cols), m_rows(rows), m_method(method),
+      m_radius(radius), m_index(new Index) {
+      VW_ASSERT( method != DEM_GRID_WEIGHTED || radius > 0,
+                 ArgumentErr() << "PointImageToDEMView: The search radius must be positive." );
+      VW_ASSERT( block_size > 0, ArgumentErr() << "PointImageToDEMView: The block size must be positive." );
+      if ( num_threads <= 0 )
+        num_threads = vw_settings().default_num_threads();
+      m_center = m_georef.pixel_to_lonlat( Vector2( cols, rows ) / 2 ).x();
+
+      for ( int32 j = 0; j < points.rows(); j += block_size )
+        for ( int32 i = 0; i < points.cols(); i += block_size ) {
+          BBox2i block( i, j, block_size, block_size );
+          block.crop( BBox2i( 0, 0, points.cols(), points.rows() ) );
+          m_index->blocks.push_back( block );
+        }
+      m_index->bboxes.resize( m_index->blocks.size() );
+
+      double reach = detail::dem_grid_reach( m_method, m_radius );
+      FifoWorkQueue queue( num_threads );
+      for ( size_t k = 0; k < m_index->blocks.size(); ++k )
+        queue.add_task( boost::shared_ptr<Task>(
+          new detail::DEMGridIndexTask<ImageT>( m_points, m_georef, m_center, m_index->blocks[k],
+                                               reach, m_index->bboxes[k] ) ) );
+      queue.join_all();
+    }
+
+    inline int32 cols() const { return m_cols; }
+    inline int32 rows() const { return m_rows; }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+    /// Grids a single pixel.  Rasterize blocks instead wherever possible.
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      ImageView<pixel_type> dest( 1, 1 );
+      rasterize( dest, BBox2i( i, j, 1, 1 ) );
+      return dest(0,0);
+    }
+
+    /// The box in DEM pixels that all of the points reach, which may
+    /// extend beyond the DEM.  It is empty if there are no points.
+    BBox2 pixel_bbox() const {
+      BBox2 bbox;
+      for ( size_t k = 0; k < m_index->bboxes.size(); ++k )
+        if ( !m_index->bboxes[k].empty() )
+          bbox.grow( m_index->bboxes[k] );
+      return bbox;
+    }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> dest( bbox.width(), bbox.height() );
+      rasterize( dest, bbox );
+      return prerasterize_type( dest, BBox2i( -bbox.min().x(), -bbox.min().y(), cols(), rows() ) );
+    }
+
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      ImageView<pixel_type> result( bbox.width(), bbox.height() );
+      rasterize( result, bbox );
+      result.rasterize( dest, BBox2i( 0, 0, bbox.width(), bbox.height() ) );
+    }
+
+    void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const {
+      VW_ASSERT( dest.cols() == bbox.width() && dest.rows() == bbox.height(),
+                 ArgumentErr() << "PointImageToDEMView: The destination is the wrong size." );
+      detail::DEMGridBlock grid( bbox, m_method, m_radius );
+      BBox2 area( Vector2( bbox.min() ) - Vector2( 1, 1 ), Vector2( bbox.max() ) + Vector2( 1, 1 ) );
+      std::vector<Vector3> points;
+      for ( size_t k = 0; k < m_index->blocks.size(); ++k ) {
+        if ( m_index->bboxes[k].empty() || !m_index->bboxes[k].intersects( area ) )
+          continue;
+        detail::gather_points( m_points, m_index->blocks[k], points );
+        detail::points_to_dem_pixels( m_georef, m_center, points );
+        grid.add( points );
+      }
+      grid.result( dest );
+    }
+    /// \endcond
+  };
+
+  /// Grids a point image of cartesian points into a DEM of cols x rows
+  /// pixels in georef, with heights above its datum.  radius is the
+  /// search radius in pixels of DEM_GRID_WEIGHTED; the other methods
+  /// take the points within each pixel.  The point image is indexed,
+  /// which reads all of it, when this is called.
+  template <class ImageT>
+  PointImageToDEMView<ImageT>
+  inline point_image_to_dem( ImageViewBase<ImageT> const& points, GeoReference const& georef,
+                             int32 cols, int32 rows, DEMGridMethod method = DEM_GRID_MEAN,
+                             double radius = 1.0 ) {
+    return PointImageToDEMView<ImageT>( points.impl(), georef, cols, rows, method, radius );
+  }
+
+}} // namespace vw::cartography
+
+#endif // __VW_CARTOGRAPHY_POINTIMAGETODEM_H__
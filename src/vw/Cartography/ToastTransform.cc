@@ -7,6 +7,8 @@
 
 #include <vw/Cartography/ToastTransform.h>
 
+#include <vector>
+
 
 // A helper function to convert a point on the unit sphere to
 // a lon/lat vector.
@@ -38,43 +40,78 @@ vw::Vector3 vw::cartography::ToastTransform::lonlat_to_unitvec(vw::Vector2 const
 // iteratively down to roughly the level of one pixel
 // at the requested resolution; then linearly interpolates
 // within the terminal triangle.
-vw::Vector3 vw::cartography::ToastTransform::octant_point_to_unitvec(double x, double y) const {
+vw::Vector3 vw::cartography::ToastTransform::octant_point_to_unitvec(double x, double y, OctantPath* path) const {
   Vector3 c1(0,0,1), c2(1,0,0), c3(0,1,0);
   double epsilon = 1.0/m_resolution;
+  int32 level = 0;
+  bool on_path = true;
   while( epsilon < 1.0 ) {
+    uint8 child;
     if( x < 0.5 ) {
       if( y < 0.5 ) {
         if( y < 0.5 - x ) {
+          child = 0;
           x = 2*x;
           y = 2*y;
-          c2 = normalize(c1 + c2);
-          c3 = normalize(c3 + c1);
         }
         else {
+          child = 1;
           x = 1-2*x;
           y = 1-2*y;
-          Vector3 c12 = normalize(c1 + c2);
-          Vector3 c31 = normalize(c3 + c1);
-          c1 = normalize(c2 + c3);
-          c2 = c31;
-          c3 = c12;
         }
       }
       else {
+        child = 2;
         x = 2*x;
         y = 2*y-1;
-        c2 = normalize(c2 + c3);
-        c1 = normalize(c3 + c1);
       }
     }
     else {
+      child = 3;
       x = 2*x-1;
       y = 2*y;
-      c1 = normalize(c1 + c2);
-      c3 = normalize(c2 + c3);
     }
+
+    on_path = on_path && path && level < path->depth && path->child[level] == child;
+    if( on_path ) {
+      c1 = path->corners[level][0];
+      c2 = path->corners[level][1];
+      c3 = path->corners[level][2];
+    }
+    else {
+      switch( child ) {
+      case 0:
+        c2 = normalize(c1 + c2);
+        c3 = normalize(c3 + c1);
+        break;
+      case 1: {
+        Vector3 c12 = normalize(c1 + c2);
+        Vector3 c31 = normalize(c3 + c1);
+        c1 = normalize(c2 + c3);
+        c2 = c31;
+        c3 = c12;
+        break;
+      }
+      case 2:
+        c2 = normalize(c2 + c3);
+        c1 = normalize(c3 + c1);
+        break;
+      default:
+        c1 = normalize(c1 + c2);
+        c3 = normalize(c2 + c3);
+        break;
+      }
+      if( path ) {
+        path->child[level] = child;
+        path->corners[level][0] = c1;
+        path->corners[level][1] = c2;
+        path->corners[level][2] = c3;
+      }
+    }
+    ++level;
     epsilon *= 2;
   }
+  if( path ) path->depth = level;
   return normalize(c1 + x*(c2-c1) + y*(c3-c1));
 }
 
@@ -211,9 +248,9 @@ vw::Vector2 vw::cartography::ToastTransform::forward(vw::Vector2 const& point) c
 }
 
 
-// Back-projects a pixel location in the TOAST image space into a
-// pixel location in the projected source image space.
-vw::Vector2 vw::cartography::ToastTransform::reverse(vw::Vector2 const& point) const {
+// Back-projects a pixel location in the TOAST image space onto a
+// lon/lat location.
+vw::Vector2 vw::cartography::ToastTransform::reverse_lonlat(vw::Vector2 const& point, OctantPath* path) const {
   // There is a fundamental eight-fold symmetry to the TOAST
   // projection which we exploit here.  We first determine which
   // top-level triangle (i.e. which octant) the requested point lies
@@ -226,23 +263,23 @@ vw::Vector2 vw::cartography::ToastTransform::reverse(vw::Vector2 const& point) c
     if( y < 0.5 ) {
       // Lower left: 0 to 90E
       if( y < 0.5 - x ) {
-        Vector2 lonlat = octant_point_to_lonlat(2*x, 2*y);
-        return m_georef.lonlat_to_pixel(Vector2(90-lonlat.x(), -lonlat.y()));
+        Vector2 lonlat = octant_point_to_lonlat(2*x, 2*y, path);
+        return Vector2(90-lonlat.x(), -lonlat.y());
       }
       else {
-        Vector2 lonlat = octant_point_to_lonlat(1-2*x, 1-2*y);
-        return m_georef.lonlat_to_pixel(Vector2(lonlat.x(), lonlat.y()));
+        Vector2 lonlat = octant_point_to_lonlat(1-2*x, 1-2*y, path);
+        return lonlat;
       }
     }
     else {
       // Upper left: 0 to 90W
       if( y > 0.5 + x ) {
-        Vector2 lonlat = octant_point_to_lonlat(2*x, 2-2*y);
-        return m_georef.lonlat_to_pixel(Vector2(-90+lonlat.x(), -lonlat.y()));
+        Vector2 lonlat = octant_point_to_lonlat(2*x, 2-2*y, path);
+        return Vector2(-90+lonlat.x(), -lonlat.y());
       }
       else {
-        Vector2 lonlat = octant_point_to_lonlat(1-2*x,2*y-1);
-        return m_georef.lonlat_to_pixel(Vector2(-lonlat.x(), lonlat.y()));
+        Vector2 lonlat = octant_point_to_lonlat(1-2*x,2*y-1, path);
+        return Vector2(-lonlat.x(), lonlat.y());
       }
     }
   }
@@ -250,29 +287,48 @@ vw::Vector2 vw::cartography::ToastTransform::reverse(vw::Vector2 const& point) c
     // Lower right: 90E to 180
     if( y < 0.5 ) {
       if( y < x - 0.5 ) {
-        Vector2 lonlat = octant_point_to_lonlat(2-2*x, 2*y);
-        return m_georef.lonlat_to_pixel(Vector2(90+lonlat.x(), -lonlat.y()));
+        Vector2 lonlat = octant_point_to_lonlat(2-2*x, 2*y, path);
+        return Vector2(90+lonlat.x(), -lonlat.y());
       }
       else {
-        Vector2 lonlat = octant_point_to_lonlat(2*x-1, 1-2*y);
-        return m_georef.lonlat_to_pixel(Vector2(180-lonlat.x(), lonlat.y()));
+        Vector2 lonlat = octant_point_to_lonlat(2*x-1, 1-2*y, path);
+        return Vector2(180-lonlat.x(), lonlat.y());
       }
     }
     else {
       // Upper right: 90W to 180
       if( y > 1.5 - x ) {
-        Vector2 lonlat = octant_point_to_lonlat(2-2*x, 2-2*y);
-        return m_georef.lonlat_to_pixel(Vector2(-90-lonlat.x(), -lonlat.y()));
+        Vector2 lonlat = octant_point_to_lonlat(2-2*x, 2-2*y, path);
+        return Vector2(-90-lonlat.x(), -lonlat.y());
       }
       else {
-        Vector2 lonlat = octant_point_to_lonlat(2*x-1, 2*y-1);
-        return m_georef.lonlat_to_pixel(Vector2(-180+lonlat.x(), lonlat.y()));
+        Vector2 lonlat = octant_point_to_lonlat(2*x-1, 2*y-1, path);
+        return Vector2(-180+lonlat.x(), lonlat.y());
       }
     }
   }
 }
 
 
+// Back-projects a pixel location in the TOAST image space into a
+// pixel location in the projected source image space.
+vw::Vector2 vw::cartography::ToastTransform::reverse(vw::Vector2 const& point) const {
+  return m_georef.lonlat_to_pixel(reverse_lonlat(point, 0));
+}
+
+
+// Neighbouring points of a row mostly share their path down the
+// subdivision, so only the last few levels are recomputed per point.
+void vw::cartography::ToastTransform::reverse_row( vw::Vector2 const& start, vw::int32 n, vw::Vector2* result ) const {
+  OctantPath path;
+  std::vector<Vector2> lonlats( n );
+  for( int32 i=0; i<n; ++i )
+    lonlats[i] = reverse_lonlat( Vector2( start.x()+i, start.y() ), &path );
+  m_georef.lonlats_to_pixels( lonlats, lonlats );
+  std::copy( lonlats.begin(), lonlats.end(), result );
+}
+
+
 // We override forward_bbox so it understands to check if the image
 // crosses the poles or not.
 vw::BBox2i vw::cartography::ToastTransform::forward_bbox( vw::BBox2i const& bbox ) const {
@@ -54,13 +54,10 @@
 //
 // The TOAST transform is not cheap, and we work around that by using
 // the lookup-table-based approximation capabilities of TransformView.
-// We could get back some precision, and possibly make things even
-// faster, by exploiting the fact that the first many iterations will
-// be identical for nearby points.  We typically compute the reverse
-// transform for a large number of nearby points at a time.  We could
-// either cache the stack used in the most recent calculation, or
-// directly expose a the ability to reverse-transform a block of
-// points at a time.
+// We also exploit the fact that the first many iterations will be
+// identical for nearby points: reverse_row() keeps the stack of
+// triangles used for the previous point of the row, and only
+// subdivides again below the level where the next point leaves it.
 
 #include <vw/Math/Vector.h>
 #include <vw/Math/BBox.h>
@@ -83,19 +80,34 @@ namespace cartography {
     // unit sphere.
     Vector3 lonlat_to_unitvec(Vector2 const& lonlat) const;
 
+    // The triangles visited by the last call to
+    // octant_point_to_unitvec(): the child taken at each level of
+    // subdivision and the corners it ended up with.  The first depth
+    // levels are valid.
+    struct OctantPath {
+      int32 depth;
+      uint8 child[32];
+      Vector3 corners[32][3];
+      OctantPath() : depth(0) {}
+    };
+
     // Maps the unit right triangle onto the first octant of the unit
-    // sphere.
-    Vector3 octant_point_to_unitvec(double x, double y) const;
+    // sphere, reusing the subdivision in path (if given) for as long
+    // as the point follows it.
+    Vector3 octant_point_to_unitvec(double x, double y, OctantPath* path) const;
 
     // Maps the first octant of the unit sphere onto the unit right
     // triangle.
     Vector2 octant_unitvec_to_point(Vector3 const& vec) const;
 
     // Convert a normalized point located in octant 0 to lon/lat in degrees
-    inline Vector2 octant_point_to_lonlat(double x, double y) const {
-      return unitvec_to_lonlat(octant_point_to_unitvec(x, y));
+    inline Vector2 octant_point_to_lonlat(double x, double y, OctantPath* path) const {
+      return unitvec_to_lonlat(octant_point_to_unitvec(x, y, path));
     }
 
+    // The lon/lat that reverse() looks up in the source georeference.
+    Vector2 reverse_lonlat(Vector2 const& point, OctantPath* path) const;
+
     // Convert a lon/lat point located in octant 0 to a normalized point
     inline Vector2 octant_lonlat_to_point(double lon, double lat) const {
       return octant_unitvec_to_point(lonlat_to_unitvec(Vector2(lon,lat)));
@@ -117,6 +129,10 @@ namespace cartography {
     virtual Vector2 forward( Vector2 const& point ) const;
     virtual Vector2 reverse( Vector2 const& point ) const;
 
+    // Reverse-transforms a row of points, sharing the subdivision of
+    // the octant between neighbouring points.
+    virtual void reverse_row( Vector2 const& start, int32 n, Vector2* result ) const;
+
     virtual BBox2i forward_bbox( BBox2i const& bbox ) const;
 
     // We override reverse_bbox so it understands to check if the image crosses
@@ -59,6 +59,29 @@ TEST_F( CameraBBoxTest, CameraBBoxDatum ) {
   EXPECT_NEAR( scale, (95-86.)/sqrt(4096*4096*2), 1e-3 ); // Cam is rotated
 }
 
+TEST_F( CameraBBoxTest, CameraBBoxCache ) {
+  float scale, cached_scale;
+  BBox2 image_bbox = camera_bbox( moon, apollo, 4096, 4096, scale );
+
+  CameraBBoxCache cache;
+  EXPECT_EQ( image_bbox, cache.camera_bbox( moon, apollo, 4096, 4096, cached_scale ) );
+  EXPECT_EQ( scale, cached_scale );
+  EXPECT_EQ( image_bbox, cache.camera_bbox( moon, apollo, 4096, 4096, cached_scale ) );
+  EXPECT_EQ( 1u, cache.size() );
+  cache.camera_bbox( moon, apollo, 2048, 2048 );
+  EXPECT_EQ( 2u, cache.size() );
+
+  // Entries go with their camera
+  boost::shared_ptr<CameraModel> copy( new PinholeModel( TEST_SRCDIR"/apollo.pinhole" ) );
+  EXPECT_EQ( image_bbox, cache.camera_bbox( moon, copy, 4096, 4096 ) );
+  EXPECT_EQ( 3u, cache.size() );
+  copy.reset();
+  cache.camera_bbox( moon, apollo, 4096, 4096 );
+  EXPECT_EQ( 2u, cache.size() );
+  cache.clear();
+  EXPECT_EQ( 0u, cache.size() );
+}
+
 TEST_F( CameraBBoxTest, CameraBBoxDEM ) {
   ImageView<float> DEM(20,20); // DEM covering lat {10,-10} long {80,100}
   for ( uint32 i = 0; i < 20; i++ )
@@ -75,4 +98,29 @@ TEST_F( CameraBBoxTest, CameraBBoxDEM ) {
   EXPECT_VECTOR_NEAR( image_bbox.max(), Vector2(94,6), 2 );
 }
 
+// A footprint that bends along the left and right edges and is cut off
+// past column 700, walked without a camera
+struct CurvedFootprint {
+  cartography::detail::CameraBBoxSample operator()( Vector2 const& pixel ) const {
+    cartography::detail::CameraBBoxSample sample;
+    sample.pixel = pixel;
+    sample.point = Vector2( pixel[0] + 0.001*pixel[1]*pixel[1], pixel[1] );
+    sample.valid = pixel[0] < 700;
+    return sample;
+  }
+};
+
+TEST( CameraBBox, AdaptiveWalk ) {
+  float scale;
+  BBox2 box = cartography::detail::adaptive_camera_bbox( CurvedFootprint(), 1000, 1000, scale, 4 );
+  EXPECT_VECTOR_NEAR( Vector2(0,0), box.min(), 1e-8 );
+  EXPECT_NEAR( 700 + 0.001*999*999, box.max()[0], 3 );
+  EXPECT_NEAR( 999, box.max()[1], 1e-8 );
+  EXPECT_NEAR( 1, scale, 1e-2 );
+
+  float serial_scale;
+  EXPECT_EQ( box, cartography::detail::adaptive_camera_bbox( CurvedFootprint(), 1000, 1000, serial_scale, 1 ) );
+  EXPECT_EQ( scale, serial_scale );
+}
+
 #endif
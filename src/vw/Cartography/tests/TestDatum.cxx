@@ -27,3 +27,61 @@ TEST( Datum, DatumDesc ) {
   EXPECT_EQ(datum.build_desc().DebugString(), datum2.build_desc().DebugString());
 }
 #endif
+
+TEST( Datum, GeodeticToCartesian ) {
+  Datum datum("WGS84");
+  double a = datum.semi_major_axis(), b = datum.semi_minor_axis();
+  EXPECT_VECTOR_NEAR( Vector3(a, 0, 0), datum.geodetic_to_cartesian( Vector3(0, 0, 0) ), 1e-8 );
+  EXPECT_VECTOR_NEAR( Vector3(0, a + 10, 0), datum.geodetic_to_cartesian( Vector3(90, 0, 10) ), 1e-8 );
+  EXPECT_VECTOR_NEAR( Vector3(-a, 0, 0), datum.geodetic_to_cartesian( Vector3(-180, 0, 0) ), 1e-8 );
+  EXPECT_VECTOR_NEAR( Vector3(0, 0, -b), datum.geodetic_to_cartesian( Vector3(33, -90, 0) ), 1e-8 );
+
+  // Against the libm formula
+  for ( int i = 0; i < 200; i++ ) {
+    double lon = -400 + 4.1*i, lat = -90 + 0.9*i, alt = 50*i - 3000;
+    double e2 = (a*a - b*b) / (a*a);
+    double rlon = lon * M_PI/180, rlat = lat * M_PI/180;
+    double n = a / sqrt(1 - e2*sin(rlat)*sin(rlat));
+    Vector3 expected( (n+alt)*cos(rlat)*cos(rlon), (n+alt)*cos(rlat)*sin(rlon), (n*(1-e2)+alt)*sin(rlat) );
+    EXPECT_VECTOR_NEAR( expected, datum.geodetic_to_cartesian( Vector3(lon, lat, alt) ), 1e-8 );
+  }
+}
+
+TEST( Datum, CartesianToGeodetic ) {
+  const char* names[] = { "WGS84", "D_MOON" };
+  for ( int d = 0; d < 2; d++ ) {
+    Datum datum(names[d]);
+    for ( int i = 0; i < 200; i++ ) {
+      Vector3 lla( -179 + 1.7*i, -89.5 + 0.9*i, 80*i - 5000 );
+      EXPECT_VECTOR_NEAR( lla, datum.cartesian_to_geodetic( datum.geodetic_to_cartesian( lla ) ), 1e-8 );
+    }
+    // The poles, and the center
+    EXPECT_VECTOR_NEAR( Vector3(0, 90, 100), datum.cartesian_to_geodetic( Vector3(0, 0, datum.semi_minor_axis() + 100) ), 1e-8 );
+    EXPECT_VECTOR_NEAR( Vector3(0, -90, 0), datum.cartesian_to_geodetic( Vector3(0, 0, -datum.semi_minor_axis()) ), 1e-8 );
+    EXPECT_VECTOR_NEAR( Vector3(0, 90, -datum.semi_minor_axis()), datum.cartesian_to_geodetic( Vector3() ), 1e-8 );
+  }
+}
+
+TEST( Datum, Arrays ) {
+  Datum datum("WGS84");
+  datum.meridian_offset() = 10;
+  std::vector<Vector3> lla;
+  for ( int i = 0; i < 37; i++ )
+    lla.push_back( Vector3( 10*i - 180, 5*i - 90, 100*i ) );
+  lla[5] = Vector3( 1e7, 3, 0 );
+
+  // The same results as point by point, in place or not
+  std::vector<Vector3> xyz, back;
+  datum.geodetic_to_cartesian( lla, xyz );
+  datum.cartesian_to_geodetic( xyz, back );
+  std::vector<Vector3> in_place( lla );
+  datum.geodetic_to_cartesian( in_place, in_place );
+  for ( size_t i = 0; i < lla.size(); i++ ) {
+    EXPECT_VECTOR_DOUBLE_EQ( datum.geodetic_to_cartesian( lla[i] ), xyz[i] );
+    EXPECT_VECTOR_DOUBLE_EQ( xyz[i], in_place[i] );
+    EXPECT_VECTOR_DOUBLE_EQ( datum.cartesian_to_geodetic( xyz[i] ), back[i] );
+  }
+  datum.cartesian_to_geodetic( in_place, in_place );
+  for ( size_t i = 0; i < lla.size(); i++ )
+    EXPECT_VECTOR_DOUBLE_EQ( back[i], in_place[i] );
+}
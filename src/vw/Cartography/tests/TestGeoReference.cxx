@@ -173,6 +173,69 @@ TEST( GeoReference, BasicProjections ) {
   EXPECT_VECTOR_NEAR( loc, Vector2(7000,3000), 1e-7 );
 }
 
+TEST( GeoReference, PlateCarree ) {
+  GeoReference georef;
+  georef.set_pixel_interpretation(GeoReferenceBase::PixelAsPoint);
+  Datum d = georef.datum();
+  d.set_semi_minor_axis(d.semi_major_axis());
+  georef.set_datum(d);
+  georef.set_equirectangular(10, 20, 30, 1000, -2000);
+
+  // Plate carree is evaluated in closed form, so check it against the
+  // projection's own definition.
+  double meters_per_degree = d.semi_major_axis() * M_PI/180.0;
+  Vector2 lon_lat(25, 15);
+  Vector2 loc( 1000 + (25-20)*cos(30*M_PI/180)*meters_per_degree,
+               -2000 + (15-10)*meters_per_degree );
+  EXPECT_VECTOR_NEAR( georef.lonlat_to_point(lon_lat), loc, 1e-6 );
+  EXPECT_VECTOR_NEAR( georef.point_to_lonlat(loc), lon_lat, 1e-10 );
+
+  // Longitudes wrap around the central meridian, as with Proj.4
+  EXPECT_VECTOR_NEAR( georef.lonlat_to_point(lon_lat + Vector2(360,0)), loc, 1e-6 );
+  EXPECT_NEAR( georef.point_to_lonlat(georef.lonlat_to_point(Vector2(199,0)))[0], -161, 1e-10 );
+}
+
+TEST( GeoReference, BatchConversions ) {
+  Matrix3x3 transform = math::identity_matrix<3>();
+  transform(0,0) = 1000; transform(1,1) = -1000;
+  transform(0,2) = 400000; transform(1,2) = 5000000;
+
+  std::vector<Vector2> pixels;
+  for ( int i = 0; i < 10; i++ )
+    pixels.push_back( Vector2( 37*i, 11*i+3 ) );
+
+  for ( int p = 0; p < 3; p++ ) {
+    GeoReference georef;
+    if ( p == 1 ) {
+      georef.set_UTM(13);
+      georef.set_transform(transform);
+    } else if ( p == 2 ) {
+      georef.set_equirectangular(0, 0, 40);
+      georef.set_transform(transform);
+    }
+
+    std::vector<Vector2> points, lonlats, back;
+    georef.pixels_to_points( pixels, points );
+    georef.points_to_lonlats( points, lonlats );
+    georef.lonlats_to_points( lonlats, back );
+    ASSERT_EQ( pixels.size(), back.size() );
+    for ( size_t i = 0; i < pixels.size(); i++ ) {
+      EXPECT_VECTOR_DOUBLE_EQ( georef.pixel_to_point(pixels[i]), points[i] );
+      EXPECT_VECTOR_DOUBLE_EQ( georef.point_to_lonlat(points[i]), lonlats[i] );
+      EXPECT_VECTOR_DOUBLE_EQ( georef.lonlat_to_point(lonlats[i]), back[i] );
+    }
+
+    // In place
+    std::vector<Vector2> v( pixels );
+    georef.pixels_to_lonlats( v, v );
+    for ( size_t i = 0; i < pixels.size(); i++ )
+      EXPECT_VECTOR_DOUBLE_EQ( georef.pixel_to_lonlat(pixels[i]), v[i] );
+    georef.lonlats_to_pixels( v, v );
+    for ( size_t i = 0; i < pixels.size(); i++ )
+      EXPECT_VECTOR_NEAR( pixels[i], v[i], 1e-6 );
+  }
+}
+
 TEST( GeoReference, UTM_to_LonLat ) {
   std::vector<Vector2> ll(5), utm(5), px(5);
 
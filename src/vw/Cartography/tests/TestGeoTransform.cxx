@@ -97,3 +97,67 @@ TEST( GeoTransform, StereographicSingularity ) {
   EXPECT_NO_THROW( output = geotx.forward_bbox(input) );
   EXPECT_NEAR( 0, output.min()[1], 2 );
 }
+
+TEST( GeoTransform, ReverseRow ) {
+  GeoReference ll_georef, utm_georef, nad_georef;
+  Matrix3x3 transform = math::identity_matrix<3>();
+  transform(0,0) = 1e-3; transform(1,1) = -1e-3;
+  transform(0,2) = -105.5; transform(1,2) = 40.5;
+  ll_georef.set_transform(transform);
+  nad_georef.set_well_known_geogcs("NAD27");
+  nad_georef.set_transform(transform);
+
+  transform = math::identity_matrix<3>();
+  transform(0,0) = 100; transform(1,1) = -100;
+  transform(0,2) = 450000; transform(1,2) = 4480000;
+  utm_georef.set_transform(transform);
+  utm_georef.set_UTM(13);
+
+  // Same projection, a different projection, and a different datum
+  GeoTransform txs[3] = { GeoTransform(ll_georef, ll_georef),
+                          GeoTransform(utm_georef, ll_georef),
+                          GeoTransform(nad_georef, ll_georef) };
+  std::vector<Vector2> row(20);
+  for ( int t = 0; t < 3; t++ ) {
+    txs[t].reverse_row( Vector2(3,7), 20, &row[0] );
+    for ( int i = 0; i < 20; i++ )
+      EXPECT_VECTOR_NEAR( txs[t].reverse( Vector2(3+i,7) ), row[i], 1e-8 );
+  }
+}
+
+TEST( GeoTransform, AffineShortcut ) {
+  GeoReference src_georef, dst_georef;
+  src_georef.set_UTM(13);
+  dst_georef.set_UTM(13);
+
+  Matrix3x3 transform = math::identity_matrix<3>();
+  transform(0,0) = 30; transform(1,1) = -30;
+  transform(0,2) = 450000; transform(1,2) = 4480000;
+  src_georef.set_transform(transform);
+  transform(0,0) = 90; transform(1,1) = -90;
+  transform(0,2) = 449000; transform(1,2) = 4481000;
+  dst_georef.set_transform(transform);
+
+  GeoTransform geotx(src_georef, dst_georef);
+  ASSERT_TRUE( geotx.is_affine() );
+  EXPECT_EQ( 0.0, geotx.tolerance() );
+
+  Vector2 pix(123,456);
+  EXPECT_VECTOR_NEAR( geotx.forward(pix),
+                      dst_georef.point_to_pixel(src_georef.pixel_to_point(pix)), 1e-8 );
+  EXPECT_VECTOR_NEAR( geotx.reverse(pix),
+                      src_georef.point_to_pixel(dst_georef.pixel_to_point(pix)), 1e-8 );
+
+  std::vector<Vector2> row(10);
+  geotx.reverse_row( pix, 10, &row[0] );
+  for ( int i = 0; i < 10; i++ )
+    EXPECT_VECTOR_NEAR( geotx.reverse( pix + Vector2(i,0) ), row[i], 1e-8 );
+
+  BBox2i bbox = geotx.forward_bbox( BBox2i(0,0,300,300) );
+  EXPECT_NEAR( 100, bbox.width(), 2 );
+  EXPECT_NEAR( 100, bbox.height(), 2 );
+
+  // A different projection needs the full conversion
+  dst_georef.set_UTM(14);
+  EXPECT_FALSE( GeoTransform(src_georef, dst_georef).is_affine() );
+}
@@ -14,6 +14,7 @@
 #include <vw/Cartography/SimplePointImageManipulation.h>
 #include <vw/Camera/PinholeModel.h>
 #include <vw/Image/Transform.h>
+#include <vw/Image/BlockRasterize.h>
 
 // Must have protobuf to be able to read camera
 #if defined(VW_HAVE_PKG_PROTOBUF) && VW_HAVE_PKG_PROTOBUF==1 && defined(VW_HAVE_PKG_CAMERA) && VW_HAVE_PKG_CAMERA==1
@@ -136,6 +137,21 @@ TEST_F( OrthoImageTest, OrthoImageRun ) {
 }
 
 
+TEST_F( OrthoImageTest, BlockRasterize ) {
+  // Blocks read the camera image through a local buffer, which must not
+  // change the result.
+  OrthoImageView<ImageView<float>,TestPatternView<PixelGray<uint8> >,
+    BicubicInterpolation, ZeroEdgeExtension>
+  ortho = orthoproject( DEM, moon, test_pattern_view(PixelGray<uint8>(),5725,5725),
+                        apollo, BicubicInterpolation(), ZeroEdgeExtension() );
+  ImageView<PixelGray<uint8> > blocks = block_rasterize( ortho, Vector2i(7,9), 2 );
+  ASSERT_EQ( ortho.cols(), blocks.cols() );
+  ASSERT_EQ( ortho.rows(), blocks.rows() );
+  for ( int32 j = 0; j < ortho.rows(); j++ )
+    for ( int32 i = 0; i < ortho.cols(); i++ )
+      EXPECT_EQ( ortho(i,j), blocks(i,j) );
+}
+
 TEST_F( OrthoImageTest, OrthoTraits ) {
   OrthoImageView<ImageView<float>,TestPatternView<PixelGray<uint8> >,
     BicubicInterpolation, ZeroEdgeExtension>
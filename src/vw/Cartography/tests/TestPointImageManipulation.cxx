@@ -38,3 +38,74 @@ TEST( PointImageManip, XYZ_to_LonLat ) {
   EXPECT_VECTOR_NEAR( xyz, xyz2, 1e-2 );
 }
 
+
+TEST( PointImageManip, DemToPointImage ) {
+  GeoReference georef;
+  Matrix3x3 transform = math::identity_matrix<3>();
+  transform(0,0) = 0.25; transform(1,1) = -0.25;
+  transform(0,2) = -120; transform(1,2) = 40;
+  georef.set_transform(transform);
+
+  ImageView<PixelMask<float> > dem(11,7);
+  for ( int32 j = 0; j < dem.rows(); j++ )
+    for ( int32 i = 0; i < dem.cols(); i++ )
+      dem(i,j) = PixelMask<float>( 100*i - 7*j );
+  dem(3,2).invalidate();
+
+  // Blocks convert a row at a time; that must match the pixels
+  DemToPointImageView<ImageView<PixelMask<float> > > points = dem_to_point_image( dem, georef );
+  ImageView<Vector3> rasterized = points;
+  ImageView<Vector3f> single = dem_to_point_image<float>( dem, georef );
+  for ( int32 j = 0; j < dem.rows(); j++ )
+    for ( int32 i = 0; i < dem.cols(); i++ ) {
+      EXPECT_VECTOR_DOUBLE_EQ( points(i,j), rasterized(i,j) );
+      EXPECT_VECTOR_NEAR( Vector3(single(i,j)), rasterized(i,j), 1e-4 );
+    }
+  EXPECT_VECTOR_DOUBLE_EQ( Vector3(), rasterized(3,2) );
+  EXPECT_VECTOR_NEAR( Vector3(-120 + 5*0.25 + 0.125, 40 - 4*0.25 - 0.125, 500 - 28),
+                      rasterized(5,4), 1e-10 );
+}
+
+TEST( PointImageManip, ReprojectPointImage ) {
+  GeoReference src, dst;
+  dst.set_equirectangular( 0, 0, 30 );
+
+  ImageView<PixelMask<Vector3> > lla(9,5);
+  for ( int32 j = 0; j < lla.rows(); j++ )
+    for ( int32 i = 0; i < lla.cols(); i++ )
+      lla(i,j) = PixelMask<Vector3>( Vector3( 10+i, 20-j, 100*j ) );
+  lla(2,2).invalidate();
+
+  ImageView<PixelMask<Vector3> > reprojected = reproject_point_image( lla, src, dst );
+  ImageView<PixelMask<Vector3> > projected = project_point_image( lla, dst );
+  ReprojectPointFunctor reproject( src, dst );
+  ProjectPointFunctor project( dst );
+  for ( int32 j = 0; j < lla.rows(); j++ )
+    for ( int32 i = 0; i < lla.cols(); i++ ) {
+      ASSERT_EQ( is_valid(lla(i,j)), is_valid(reprojected(i,j)) );
+      ASSERT_EQ( is_valid(lla(i,j)), is_valid(projected(i,j)) );
+      if ( !is_valid(lla(i,j)) ) continue;
+      EXPECT_VECTOR_NEAR( reproject(lla(i,j).child()), reprojected(i,j).child(), 1e-6 );
+      EXPECT_VECTOR_NEAR( project(lla(i,j).child()), projected(i,j).child(), 1e-6 );
+    }
+}
+
+TEST( PointImageManip, GeodeticToCartesian ) {
+  Datum datum("WGS84");
+  ImageView<Vector3> lla(7,5);
+  for ( int32 j = 0; j < lla.rows(); j++ )
+    for ( int32 i = 0; i < lla.cols(); i++ )
+      lla(i,j) = Vector3( -170 + 50*i, 80 - 40*j, 1000*i - 300*j );
+  lla(4,1) = Vector3();
+
+  ImageView<Vector3> xyz = geodetic_to_cartesian( lla, datum );
+  ImageView<Vector3> back = cartesian_to_geodetic( xyz, datum );
+  for ( int32 j = 0; j < lla.rows(); j++ )
+    for ( int32 i = 0; i < lla.cols(); i++ ) {
+      if ( i == 4 && j == 1 ) continue;
+      EXPECT_VECTOR_DOUBLE_EQ( datum.geodetic_to_cartesian( lla(i,j) ), xyz(i,j) );
+      EXPECT_VECTOR_NEAR( lla(i,j), back(i,j), 1e-8 );
+    }
+  EXPECT_VECTOR_DOUBLE_EQ( Vector3(), xyz(4,1) );
+  EXPECT_VECTOR_DOUBLE_EQ( Vector3(), back(4,1) );
+}
@@ -0,0 +1,94 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+
+#include <limits>
+
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Cartography/PointImageManipulation.h>
+#include <vw/Cartography/PointImageToDEM.h>
+
+using namespace vw;
+using namespace vw::cartography;
+using namespace vw::test;
+
+TEST( PointImageToDEM, GridBlock ) {
+  std::vector<Vector3> points;
+  points.push_back( Vector3( 1.2, 0.9, 10 ) );
+  points.push_back( Vector3( 0.8, 1.4, 20 ) );
+  points.push_back( Vector3( 1.0, 1.0, 60 ) );
+  points.push_back( Vector3( 3.1, 2.0, 5 ) );
+  points.push_back( Vector3( 7.0, 2.0, 5 ) );  // outside the block
+  points.push_back( Vector3( std::numeric_limits<double>::quiet_NaN(), 1, 5 ) );
+
+  BBox2i bbox( 0, 0, 4, 3 );
+  ImageView<PixelMask<float> > dem( 4, 3 );
+
+  cartography::detail::DEMGridBlock mean( bbox, DEM_GRID_MEAN, 1 );
+  mean.add( points );
+  mean.result( dem );
+  EXPECT_FLOAT_EQ( 30, dem(1,1).child() );
+  EXPECT_FLOAT_EQ( 5, dem(3,2).child() );
+  EXPECT_FALSE( is_valid( dem(0,0) ) );
+  EXPECT_FALSE( is_valid( dem(2,2) ) );
+
+  cartography::detail::DEMGridBlock median( bbox, DEM_GRID_MEDIAN, 1 );
+  median.add( points );
+  median.result( dem );
+  EXPECT_FLOAT_EQ( 20, dem(1,1).child() );
+  EXPECT_FLOAT_EQ( 5, dem(3,2).child() );
+  EXPECT_FALSE( is_valid( dem(2,1) ) );
+
+  // A single point gives its own height everywhere it reaches
+  cartography::detail::DEMGridBlock weighted( bbox, DEM_GRID_WEIGHTED, 1.5 );
+  weighted.add( std::vector<Vector3>( 1, Vector3( 1, 1, 7 ) ) );
+  weighted.result( dem );
+  EXPECT_FLOAT_EQ( 7, dem(0,0).child() );
+  EXPECT_FLOAT_EQ( 7, dem(2,1).child() );
+  EXPECT_FALSE( is_valid( dem(3,1) ) );
+}
+
+TEST( PointImageToDEM, RoundTrip ) {
+  GeoReference georef;
+  Matrix3x3 transform = math::identity_matrix<3>();
+  transform(0,0) = 0.25; transform(1,1) = -0.25;
+  transform(0,2) = 170; transform(1,2) = 40;
+  georef.set_transform(transform);
+
+  // The DEM crosses 180 degrees, where the longitudes of the points
+  // wrap around.
+  ImageView<PixelMask<float> > dem(57,31);
+  for ( int32 j = 0; j < dem.rows(); j++ )
+    for ( int32 i = 0; i < dem.cols(); i++ )
+      dem(i,j) = PixelMask<float>( 100*i - 7*j );
+  dem(3,2).invalidate();
+
+  ImageView<Vector3> points = geodetic_to_cartesian( dem_to_point_image( dem, georef ), georef.datum() );
+  PointImageToDEMView<ImageView<Vector3> > view( points, georef, dem.cols(), dem.rows(),
+                                                 DEM_GRID_MEAN, 1, 16, 2 );
+  EXPECT_VECTOR_NEAR( Vector2(-0.5,-0.5), view.pixel_bbox().min(), 1e-6 );
+  EXPECT_VECTOR_NEAR( Vector2(56.5,30.5), view.pixel_bbox().max(), 1e-6 );
+
+  ImageView<PixelMask<float> > result = block_rasterize( view, Vector2i( 20, 12 ), 2 );
+  for ( int32 j = 0; j < dem.rows(); j++ )
+    for ( int32 i = 0; i < dem.cols(); i++ ) {
+      ASSERT_EQ( is_valid( dem(i,j) ), is_valid( result(i,j) ) ) << i << "," << j;
+      if ( is_valid( dem(i,j) ) )
+        EXPECT_NEAR( dem(i,j).child(), result(i,j).child(), 1e-3 );
+    }
+  EXPECT_EQ( result(20,10), view(20,10) );
+
+  // A DEM that is offset from the points only has the pixels they reach
+  GeoReference shifted( georef );
+  transform(0,2) -= 10 * 0.25;
+  shifted.set_transform( transform );
+  ImageView<PixelMask<float> > partial = point_image_to_dem( points, shifted, 20, 20, DEM_GRID_MEDIAN );
+  EXPECT_FALSE( is_valid( partial(9,5) ) );
+  EXPECT_NEAR( dem(5,5).child(), partial(15,5).child(), 1e-3 );
+}
@@ -283,6 +283,17 @@ TEST_F( ToastTransformTest, RandomForwardReverse ) {
   }
 }
 
+TEST_F( ToastTransformTest, ReverseRow ) {
+  // Rows share their subdivision between points, which must give
+  // exactly the per-point answer, across octant boundaries too.
+  std::vector<Vector2> row( toast_resolution );
+  for ( int32 y = 0; y < toast_resolution; y += 127 ) {
+    txform.reverse_row( Vector2(0,y), toast_resolution, &row[0] );
+    for ( int32 x = 0; x < toast_resolution; x++ )
+      EXPECT_VECTOR_DOUBLE_EQ( txform.reverse( Vector2(x,y) ), row[x] );
+  }
+}
+
 TEST_F( ToastTransformTest, BasicBBoxCheck ) {
   // Just make sure that forward_bbox and reverse_bbox behave
 
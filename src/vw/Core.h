@@ -18,6 +18,7 @@
 #include <vw/Core/Log.h>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/TypeDeduction.h>
+#include <vw/Core/Float16.h>
 #include <vw/Core/CompoundTypes.h>
 #include <vw/Core/Functors.h>
 #include <vw/Core/Cache.h>
@@ -0,0 +1,200 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Core/BufferPool.h>
+#include <vw/Core/Numa.h>
+
+#include <cstdlib>
+
+namespace {
+  inline void*& next_buffer( void* buffer ) {
+    return *static_cast<void**>( buffer );
+  }
+}
+
+vw::BufferPool::FreeLists::FreeLists() : m_bytes(0) {
+  for( size_t i = 0; i < NUM_CLASSES; ++i )
+    m_heads[i] = 0;
+}
+
+// The original heap pointer is kept just in front of the aligned one.
+void* vw::BufferPool::system_allocate( size_t bytes ) {
+  void* raw = std::malloc( bytes + ALIGNMENT );
+  if( ! raw )
+    return 0;
+  size_t addr = reinterpret_cast<size_t>( raw ) + sizeof(void*);
+  void* ptr = reinterpret_cast<void*>( (addr + ALIGNMENT - 1) & ~(ALIGNMENT - 1) );
+  static_cast<void**>( ptr )[-1] = raw;
+  return ptr;
+}
+
+// A thread bound to a NUMA node places a new buffer in its memory.
+void* vw::BufferPool::local_allocate( size_t bytes ) {
+  void* ptr = system_allocate( bytes );
+  if( ptr && vw_numa_thread_node() >= 0 )
+    vw_numa_first_touch( ptr, bytes );
+  return ptr;
+}
+
+void vw::BufferPool::system_free( void* ptr ) {
+  std::free( static_cast<void**>( ptr )[-1] );
+}
+
+void vw::BufferPool::free_lists( FreeLists& lists ) {
+  for( size_t i = 0; i < NUM_CLASSES; ++i ) {
+    while( void* buffer = lists.m_heads[i] ) {
+      lists.m_heads[i] = next_buffer( buffer );
+      system_free( buffer );
+    }
+  }
+  lists.m_bytes = 0;
+}
+
+size_t vw::BufferPool::size_class( size_t bytes ) {
+  if( bytes <= ALIGNMENT )
+    return 0;
+  // Four classes per power of two: with 2^k < bytes <= 2^(k+1), the
+  // class sizes are 5, 6, 7 and 8 times 2^(k-2).
+  size_t n = bytes - 1, k = 0;
+  while( n >> (k+1) ) ++k;
+  size_t j = (n >> (k-2)) - 4;
+  return 1 + (k-6)*4 + j;
+}
+
+size_t vw::BufferPool::class_size( size_t size_class ) {
+  if( size_class == 0 )
+    return ALIGNMENT;
+  size_t k = 6 + (size_class-1) / 4, j = (size_class-1) % 4;
+  return (5 + j) << (k-2);
+}
+
+void vw::BufferPool::release_thread_cache( ThreadCache* cache ) {
+  BufferPool& pool = *cache->m_pool;
+  FreeLists& lists = cache->m_lists;
+  {
+    Mutex::Lock lock(pool.m_mutex);
+    FreeLists& shared = pool.shared_lists();
+    for( size_t i = 0; i < NUM_CLASSES; ++i ) {
+      size_t size = class_size( i );
+      while( lists.m_heads[i] && shared.m_bytes + size <= pool.m_max_cached ) {
+        void* buffer = lists.m_heads[i];
+        lists.m_heads[i] = next_buffer( buffer );
+        next_buffer( buffer ) = shared.m_heads[i];
+        shared.m_heads[i] = buffer;
+        shared.m_bytes += size;
+      }
+    }
+  }
+  free_lists( lists );
+  delete cache;
+}
+
+vw::BufferPool::ThreadCache& vw::BufferPool::thread_cache() {
+  ThreadCache* cache = m_thread_cache.get();
+  if( ! cache ) {
+    cache = new ThreadCache( this );
+    m_thread_cache.reset( cache );
+  }
+  return *cache;
+}
+
+// The calling thread's shared lists.  Only call this with m_mutex held.
+vw::BufferPool::FreeLists& vw::BufferPool::shared_lists() {
+  return m_shared[ vw_numa_thread_node() + 1 ];
+}
+
+vw::BufferPool::BufferPool( size_t max_cached )
+  : m_max_cached(max_cached), m_shared( vw_numa_num_nodes() + 1 ),
+    m_thread_cache(release_thread_cache) {}
+
+vw::BufferPool::~BufferPool() {
+  m_thread_cache.reset();
+  for( size_t i = 0; i < m_shared.size(); ++i )
+    free_lists( m_shared[i] );
+}
+
+void* vw::BufferPool::allocate( size_t bytes ) {
+  if( bytes > MAX_POOLED_SIZE )
+    return local_allocate( bytes );
+
+  // Always round up, so that deallocate() can pool the buffer even if
+  // pooling is turned on in between.
+  size_t c = size_class( bytes );
+  if( m_max_cached == 0 )
+    return local_allocate( class_size( c ) );
+  FreeLists& lists = thread_cache().m_lists;
+  if( void* buffer = lists.m_heads[c] ) {
+    lists.m_heads[c] = next_buffer( buffer );
+    lists.m_bytes -= class_size( c );
+    return buffer;
+  }
+  {
+    Mutex::Lock lock(m_mutex);
+    FreeLists& shared = shared_lists();
+    if( void* buffer = shared.m_heads[c] ) {
+      shared.m_heads[c] = next_buffer( buffer );
+      shared.m_bytes -= class_size( c );
+      return buffer;
+    }
+  }
+  return local_allocate( class_size( c ) );
+}
+
+void vw::BufferPool::deallocate( void* ptr, size_t bytes ) {
+  if( ! ptr )
+    return;
+  if( bytes > MAX_POOLED_SIZE || m_max_cached == 0 ) {
+    system_free( ptr );
+    return;
+  }
+
+  size_t c = size_class( bytes ), size = class_size( c );
+  FreeLists& lists = thread_cache().m_lists;
+  if( lists.m_bytes + size <= m_max_cached ) {
+    next_buffer( ptr ) = lists.m_heads[c];
+    lists.m_heads[c] = ptr;
+    lists.m_bytes += size;
+    return;
+  }
+  {
+    Mutex::Lock lock(m_mutex);
+    FreeLists& shared = shared_lists();
+    if( shared.m_bytes + size <= m_max_cached ) {
+      next_buffer( ptr ) = shared.m_heads[c];
+      shared.m_heads[c] = ptr;
+      shared.m_bytes += size;
+      return;
+    }
+  }
+  system_free( ptr );
+}
+
+void vw::BufferPool::set_max_cached( size_t bytes ) {
+  Mutex::Lock lock(m_mutex);
+  m_max_cached = bytes;
+}
+
+size_t vw::BufferPool::thread_cached() const {
+  ThreadCache* cache = m_thread_cache.get();
+  return cache ? cache->m_lists.m_bytes : 0;
+}
+
+size_t vw::BufferPool::shared_cached() const {
+  Mutex::Lock lock(m_mutex);
+  size_t bytes = 0;
+  for( size_t i = 0; i < m_shared.size(); ++i )
+    bytes += m_shared[i].m_bytes;
+  return bytes;
+}
+
+void vw::BufferPool::trim() {
+  if( ThreadCache* cache = m_thread_cache.get() )
+    free_lists( cache->m_lists );
+  Mutex::Lock lock(m_mutex);
+  for( size_t i = 0; i < m_shared.size(); ++i )
+    free_lists( m_shared[i] );
+}
@@ -0,0 +1,119 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Core/BufferPool.h
+///
+/// A pool of aligned memory buffers, used for ImageView pixel data.
+///
+/// Block processing allocates and frees buffers of the same few sizes
+/// over and over again.  The pool rounds every request up to a size
+/// class (four classes per power of two, so at most 25% is wasted) and
+/// keeps freed buffers on per-thread free lists, so most allocations
+/// never touch the heap or take a lock.  A thread whose own free lists
+/// are full hands buffers to a shared list, which other threads draw
+/// from before they go to the heap; this covers buffers that are
+/// allocated by one thread and freed by another.
+///
+/// Threads bound to a NUMA node (see Core/Numa.h) share a list with
+/// the other threads on their node only, and touch the buffers they
+/// get from the heap before anyone else can, so that every buffer such
+/// a thread gets is in its node's memory.
+///
+/// Every buffer is aligned to BufferPool::ALIGNMENT bytes.  Buffers
+/// larger than BufferPool::MAX_POOLED_SIZE are not pooled.  How much a
+/// thread may keep on its free lists is set by
+/// vw_settings().buffer_pool_size(); 0 turns pooling off.
+///
+#ifndef __VW_CORE_BUFFERPOOL_H__
+#define __VW_CORE_BUFFERPOOL_H__
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/System.h>
+#include <vw/Core/Thread.h>
+
+namespace vw {
+
+  /// A pool of aligned buffers with per-thread free lists.  You should
+  /// normally use the global instance returned by vw_buffer_pool().
+  /// Any other instance must outlive every thread that used it.
+  class BufferPool : private boost::noncopyable {
+  public:
+    /// The alignment of every buffer, in bytes.
+    static const size_t ALIGNMENT = 64;
+    /// Larger buffers go straight to the heap.
+    static const size_t MAX_POOLED_SIZE = size_t(1) << 26;
+    /// The number of size classes.
+    static const size_t NUM_CLASSES = 81;
+
+  private:
+    // The free lists are intrusive: each free buffer starts with a
+    // pointer to the next one.
+    struct FreeLists {
+      void* m_heads[NUM_CLASSES];
+      size_t m_bytes;
+      FreeLists();
+    };
+
+    struct ThreadCache {
+      BufferPool* m_pool;
+      FreeLists m_lists;
+      ThreadCache( BufferPool* pool ) : m_pool(pool) {}
+    };
+
+    size_t m_max_cached;   // Read without a lock
+    mutable Mutex m_mutex; // Protects m_shared
+    // The shared lists of unbound threads, then of each NUMA node
+    std::vector<FreeLists> m_shared;
+    boost::thread_specific_ptr<ThreadCache> m_thread_cache;
+
+    ThreadCache& thread_cache();
+    FreeLists& shared_lists();
+    static void release_thread_cache( ThreadCache* cache );
+    static void free_lists( FreeLists& lists );
+    static void* system_allocate( size_t bytes );
+    static void* local_allocate( size_t bytes );
+    static void system_free( void* ptr );
+
+  public:
+    BufferPool( size_t max_cached = size_t(64) << 20 );
+    ~BufferPool();
+
+    /// Returns an ALIGNMENT-aligned buffer of at least the given size,
+    /// or 0 if the memory could not be allocated.
+    void* allocate( size_t bytes );
+
+    /// Returns a buffer to the pool.  The size must be the one it was
+    /// allocated with.
+    void deallocate( void* ptr, size_t bytes );
+
+    /// The number of bytes each thread (and the shared list) may keep
+    /// on its free lists.  0 turns pooling off.
+    void set_max_cached( size_t bytes );
+    size_t max_cached() const { return m_max_cached; }
+
+    /// The bytes on the calling thread's free lists, and on the shared
+    /// free lists of every node.
+    size_t thread_cached() const;
+    size_t shared_cached() const;
+
+    /// Frees the calling thread's free lists and the shared ones.
+    void trim();
+
+    /// The size class of a buffer of the given size, and the size of
+    /// the buffers in a class.  Only valid up to MAX_POOLED_SIZE.
+    static size_t size_class( size_t bytes );
+    static size_t class_size( size_t size_class );
+  };
+
+} // namespace vw
+
+#endif // __VW_CORE_BUFFERPOOL_H__
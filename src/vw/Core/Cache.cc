@@ -11,66 +11,286 @@
 ///
 #include <vw/Core/Cache.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/MemoryGovernor.h>
 
-void vw::Cache::allocate( size_t size ) {
-  while( m_size+size > m_max_size ) {
-    if( ! m_last_valid ) {
+#include <vw/config.h>
+
+#include <iomanip>
+#include <algorithm>
+#include <cstdio>
+
+#ifdef VW_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+const size_t vw::CacheStats::HISTOGRAM_BUCKETS;
+
+vw::CacheStats::TypeStats& vw::CacheStats::TypeStats::operator+=( TypeStats const& other ) {
+  lines += other.lines;
+  hits += other.hits;
+  misses += other.misses;
+  evictions += other.evictions;
+  bytes_generated += other.bytes_generated;
+  generate_microseconds += other.generate_microseconds;
+  regenerate_microseconds += other.regenerate_microseconds;
+  spills += other.spills;
+  reloads += other.reloads;
+  reload_microseconds += other.reload_microseconds;
+  return *this;
+}
+
+namespace {
+  void report_type( std::ostream& out, vw::CacheStats::TypeStats const& t ) {
+    out << t.lines << " lines, " << t.hits << " hits, " << t.misses << " misses, "
+        << t.evictions << " evictions, " << t.bytes_generated << " bytes generated in "
+        << double(t.generate_microseconds) / 1e6 << " s (+"
+        << double(t.regenerate_microseconds) / 1e6 << " s regenerating)";
+    if( t.spills || t.reloads )
+      out << ", " << t.spills << " spilled, " << t.reloads << " reloaded in "
+          << double(t.reload_microseconds) / 1e6 << " s";
+  }
+}
+
+std::string vw::CacheStats::report() const {
+  std::ostringstream out;
+  out << "Cache: " << size << " / " << max_size << " bytes used, "
+      << bytes_in_flight << " bytes being generated, hit rate "
+      << std::setprecision(3) << 100.0 * hit_rate() << "%" << std::setprecision(6) << std::endl;
+  if( max_spill_size )
+    out << "  Spilled to disk: " << spill_size << " / " << max_spill_size << " bytes" << std::endl;
+  out << "  All types: ";
+  report_type( out, total );
+  out << std::endl;
+  for( std::map<std::string, TypeStats>::const_iterator i = types.begin(); i != types.end(); ++i ) {
+    out << "  " << i->first << ": ";
+    report_type( out, i->second );
+    out << std::endl;
+  }
+  out << "  Evicted lines by number of accesses:";
+  for( size_t i = 0; i < eviction_histogram.size(); ++i )
+    if( eviction_histogram[i] )
+      out << " " << (uint64(1) << i) << (i + 1 == eviction_histogram.size() ? "+" : "") << ":" << eviction_histogram[i];
+  out << std::endl;
+  return out.str();
+}
+
+vw::Cache::Shard& vw::Cache::next_shard() {
+  Mutex::Lock lock(m_mutex);
+  Shard& shard = *m_shards[m_next_shard];
+  m_next_shard = (m_next_shard + 1) % m_shards.size();
+  return shard;
+}
+
+void vw::Cache::set_num_shards( uint32 num_shards ) {
+  VW_ASSERT( num_shards > 0, ArgumentErr() << "Cache must have at least one shard." );
+  Mutex::Lock lock(m_mutex);
+  for( size_t i = 0; i < m_shards.size(); ++i )
+    VW_ASSERT( !m_shards[i]->m_first_valid && !m_shards[i]->m_first_invalid,
+               LogicErr() << "Cannot change the number of shards of a cache that is in use." );
+  m_shards.clear();
+  for( uint32 i = 0; i < num_shards; ++i )
+    m_shards.push_back( boost::shared_ptr<Shard>( new Shard() ) );
+  m_next_shard = 0;
+}
+
+void vw::Cache::set_eviction_policy( EvictionPolicy policy ) {
+  Mutex::Lock lock(m_mutex);
+  for( size_t i = 0; i < m_shards.size(); ++i )
+    VW_ASSERT( !m_shards[i]->m_first_valid && !m_shards[i]->m_first_invalid,
+               LogicErr() << "Cannot change the eviction policy of a cache that is in use." );
+  m_policy = policy;
+}
+
+// Set the GDSF rank of a valid line.
+void vw::Cache::rank( CacheLineBase *line, double rank ) {
+  unrank( line );
+  line->m_rank = line->m_shard.m_ranks.insert( std::make_pair( rank, line ) );
+  line->m_ranked = true;
+}
+
+void vw::Cache::unrank( CacheLineBase *line ) {
+  if( ! line->m_ranked ) return;
+  line->m_shard.m_ranks.erase( line->m_rank );
+  line->m_ranked = false;
+}
+
+// Count an eviction in the line's shard, which the caller has locked.
+void vw::Cache::record_eviction( CacheLineBase *line, vw::uint32 accesses ) {
+  Shard& s = line->m_shard;
+  s.m_evictions++;
+  if( line->m_type_stats )
+    line->m_type_stats->evictions++;
+  size_t bucket = 0;
+  while( accesses > 1 && bucket + 1 < s.m_eviction_histogram.size() ) {
+    accesses >>= 1;
+    bucket++;
+  }
+  s.m_eviction_histogram[bucket]++;
+}
+
+// Evict the lowest-priority line of a shard that no other thread is
+// holding.  The caller must hold the shard's lock.  Returns false if
+// the shard has nothing to evict; busy is set if that is only because
+// its lines are in use.
+bool vw::Cache::evict_from( Shard& shard, bool& busy ) {
+  if( m_policy == GDSF_EVICTION ) {
+    for( RankMap::iterator i = shard.m_ranks.begin(); i != shard.m_ranks.end(); ++i ) {
+      double rank = i->first;
+      CacheLineBase *line = i->second;
+      vw::uint32 accesses = line->m_frequency;
+      // On success this erases i, so it must not be touched afterwards.
+      if( line->try_invalidate() ) {
+        if( rank > shard.m_inflation )
+          shard.m_inflation = rank;
+        record_eviction( line, accesses );
+        return true;
+      }
+      busy = true;
+    }
+    return false;
+  }
+
+  for( CacheLineBase *line = shard.m_last_valid; line; line = line->m_prev ) {
+    vw::uint32 accesses = line->m_frequency;
+    if( line->try_invalidate() ) {
+      record_eviction( line, accesses );
+      return true;
+    }
+    busy = true;
+  }
+  return false;
+}
+
+// Called with the lock of the allocating line's shard held.  Other
+// shards are only try-locked, so two threads allocating in different
+// shards can never wait on each other here.
+void vw::Cache::allocate( size_t size, Shard& shard ) {
+  while( true ) {
+    {
+      Mutex::Lock lock(m_mutex);
+      if( m_size+size <= m_max_size && vw_memory_governor().cache_may_grow(size) ) {
+        m_size += size;
+        vw_memory_governor().cache_allocated(size);
+        VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache allocated " << size << " bytes (" << m_size << " / " << m_max_size << " used)" << "\n"; )
+        return;
+      }
+    }
+
+    bool busy = false;
+    if( evict_from( shard, busy ) )
+      continue;
+
+    bool evicted = false;
+    for( size_t i = 0; i < m_shards.size() && !evicted; ++i ) {
+      Shard& other = *m_shards[i];
+      if( &other == &shard )
+        continue;
+      if( ! other.m_mutex.try_lock() ) {
+        busy = true;
+        continue;
+      }
+      evicted = evict_from( other, busy );
+      other.m_mutex.unlock();
+    }
+    if( evicted )
+      continue;
+
+    // If some line could not be evicted only because it was in use,
+    // briefly going over the budget is preferable to waiting for it.
+    Mutex::Lock lock(m_mutex);
+    if( ! busy ) {
       VW_OUT(WarningMessage, "console") << "Warning: Cached object (" << size << ") larger than requested maximum cache size (" << m_max_size << "). Current Size = " << m_size << "\n";
       VW_OUT(WarningMessage, "cache") << "Warning: Cached object (" << size << ") larger than requested maximum cache size (" << m_max_size << "). Current Size = " << m_size << "\n";
-      break;
     }
-    m_last_valid->invalidate();
-    m_evictions++;
+    m_size += size;
+    vw_memory_governor().cache_allocated(size);
+    VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache allocated " << size << " bytes (" << m_size << " / " << m_max_size << " used)" << "\n"; )
+    return;
   }
-  m_size += size;
-  VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache allocated " << size << " bytes (" << m_size << " / " << m_max_size << " used)" << "\n"; )
 }
 
-void vw::Cache::resize( size_t size ) {
+// Evict lines until at most size bytes are in use.  Returns false if
+// that was not possible because some lines were in use.
+bool vw::Cache::evict_to( size_t size ) {
+  bool busy = false;
+  for( size_t i = 0; i < m_shards.size(); ++i ) {
+    Shard& shard = *m_shards[i];
+    Mutex::Lock shard_lock(shard.m_mutex);
+    while( true ) {
+      {
+        Mutex::Lock lock(m_mutex);
+        if( m_size <= size ) return true;
+      }
+      if( ! evict_from( shard, busy ) ) break;
+    }
+  }
   Mutex::Lock lock(m_mutex);
-  m_max_size = size;
-  while( m_size > m_max_size ) {
-    VW_ASSERT( m_last_valid, LogicErr() << "Cache is empty but has nonzero size!" );
-    m_last_valid->invalidate();
+  VW_ASSERT( busy || m_size <= size, LogicErr() << "Cache is empty but has nonzero size!" );
+  return m_size <= size;
+}
+
+void vw::Cache::resize( size_t size ) {
+  {
+    Mutex::Lock lock(m_mutex);
+    m_max_size = size;
   }
+  evict_to( size );
+}
+
+void vw::Cache::trim( size_t size ) {
+  evict_to( size );
 }
 
 void vw::Cache::deallocate( size_t size ) {
+  Mutex::Lock lock(m_mutex);
   m_size -= size;
+  vw_memory_governor().cache_deallocated(size);
   VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache deallocated " << size << " bytes (" << m_size << " / " << m_max_size << " used)" << "\n"; )
 }
 
 // Move the cache line to the top of the valid list.
 void vw::Cache::validate( CacheLineBase *line ) {
-  if( line == m_first_valid ) return;
-  if( line == m_last_valid ) m_last_valid = line->m_prev;
-  if( line == m_first_invalid ) m_first_invalid = line->m_next;
+  Shard& s = line->m_shard;
+  line->m_frequency++;
+  if( m_policy == GDSF_EVICTION ) {
+    double size = line->m_size ? double(line->m_size) : 1.0;
+    double cost = double(line->m_cost + 1);
+    rank( line, s.m_inflation + line->m_frequency * cost / size );
+  }
+  if( line == s.m_first_valid ) return;
+  if( line == s.m_last_valid ) s.m_last_valid = line->m_prev;
+  if( line == s.m_first_invalid ) s.m_first_invalid = line->m_next;
   if( line->m_next ) line->m_next->m_prev = line->m_prev;
   if( line->m_prev ) line->m_prev->m_next = line->m_next;
-  line->m_next = m_first_valid;
+  line->m_next = s.m_first_valid;
   line->m_prev = 0;
-  if( m_first_valid ) m_first_valid->m_prev = line;
-  m_first_valid = line;
-  if( ! m_last_valid ) m_last_valid = line;
+  if( s.m_first_valid ) s.m_first_valid->m_prev = line;
+  s.m_first_valid = line;
+  if( ! s.m_last_valid ) s.m_last_valid = line;
 }
 
 // Move the cache line to the top of the invalid list.
 void vw::Cache::invalidate( CacheLineBase *line ) {
-  if( line == m_first_valid ) m_first_valid = line->m_next;
-  if( line == m_last_valid ) m_last_valid = line->m_prev;
+  Shard& s = line->m_shard;
+  unrank( line );
+  line->m_frequency = 0;
+  if( line == s.m_first_valid ) s.m_first_valid = line->m_next;
+  if( line == s.m_last_valid ) s.m_last_valid = line->m_prev;
   if( line->m_next ) line->m_next->m_prev = line->m_prev;
   if( line->m_prev ) line->m_prev->m_next = line->m_next;
-  line->m_next = m_first_invalid;
+  line->m_next = s.m_first_invalid;
   line->m_prev = 0;
-  if( m_first_invalid ) m_first_invalid->m_prev = line;
-  m_first_invalid = line;
+  if( s.m_first_invalid ) s.m_first_invalid->m_prev = line;
+  s.m_first_invalid = line;
 }
 
 // Remove the cache line from the cache lists.
 void vw::Cache::remove( CacheLineBase *line ) {
-  if( line == m_first_valid ) m_first_valid = line->m_next;
-  if( line == m_last_valid ) m_last_valid = line->m_prev;
-  if( line == m_first_invalid ) m_first_invalid = line->m_next;
+  Shard& s = line->m_shard;
+  unrank( line );
+  if( line == s.m_first_valid ) s.m_first_valid = line->m_next;
+  if( line == s.m_last_valid ) s.m_last_valid = line->m_prev;
+  if( line == s.m_first_invalid ) s.m_first_invalid = line->m_next;
   if( line->m_next ) line->m_next->m_prev = line->m_prev;
   if( line->m_prev ) line->m_prev->m_next = line->m_next;
   line->m_next = line->m_prev = 0;
@@ -78,13 +298,148 @@ void vw::Cache::remove( CacheLineBase *line ) {
 
 // Move the cache line to the bottom of the valid list.
 void vw::Cache::deprioritize( CacheLineBase *line ) {
-  if( line == m_last_valid ) return;
-  if( line == m_first_valid ) m_first_valid = line->m_next;
+  Shard& s = line->m_shard;
+  if( m_policy == GDSF_EVICTION )
+    rank( line, -1.0 );
+  if( line == s.m_last_valid ) return;
+  if( line == s.m_first_valid ) s.m_first_valid = line->m_next;
   if( line->m_next ) line->m_next->m_prev = line->m_prev;
   if( line->m_prev ) line->m_prev->m_next = line->m_next;
-  line->m_prev = m_last_valid;
+  line->m_prev = s.m_last_valid;
   line->m_next = 0;
-  m_last_valid->m_next = line;
-  m_last_valid = line;
+  s.m_last_valid->m_next = line;
+  s.m_last_valid = line;
+}
+
+vw::uint64 vw::Cache::hits() const {
+  uint64 total = 0;
+  for( size_t i = 0; i < m_shards.size(); ++i )
+    total += m_shards[i]->m_hits;
+  return total;
+}
+
+vw::uint64 vw::Cache::misses() const {
+  uint64 total = 0;
+  for( size_t i = 0; i < m_shards.size(); ++i )
+    total += m_shards[i]->m_misses;
+  return total;
+}
+
+vw::uint64 vw::Cache::evictions() const {
+  uint64 total = 0;
+  for( size_t i = 0; i < m_shards.size(); ++i )
+    total += m_shards[i]->m_evictions;
+  return total;
+}
+
+void vw::Cache::clear_stats() {
+  for( size_t i = 0; i < m_shards.size(); ++i ) {
+    Shard& s = *m_shards[i];
+    Mutex::Lock shard_lock(s.m_mutex);
+    s.m_hits = s.m_misses = s.m_evictions = 0;
+    // Keep the line counts, which describe the current state
+    for( std::map<const char*, TypeStats>::iterator t = s.m_types.begin(); t != s.m_types.end(); ++t ) {
+      TypeStats cleared;
+      cleared.lines = t->second.lines;
+      t->second = cleared;
+    }
+    std::fill( s.m_eviction_histogram.begin(), s.m_eviction_histogram.end(), 0 );
+  }
+}
+
+vw::CacheStats vw::Cache::stats() const {
+  CacheStats result;
+  for( size_t i = 0; i < m_shards.size(); ++i ) {
+    Shard& s = *m_shards[i];
+    Mutex::Lock shard_lock(s.m_mutex);
+    for( std::map<const char*, TypeStats>::const_iterator t = s.m_types.begin(); t != s.m_types.end(); ++t ) {
+      result.types[t->first] += t->second;
+      result.total += t->second;
+    }
+    for( size_t b = 0; b < s.m_eviction_histogram.size(); ++b )
+      result.eviction_histogram[b] += s.m_eviction_histogram[b];
+    result.bytes_in_flight += s.m_in_flight;
+  }
+  Mutex::Lock lock(m_mutex);
+  result.size = m_size;
+  result.max_size = m_max_size;
+  result.spill_size = m_spill_size;
+  result.max_spill_size = m_max_spill_size;
+  return result;
+}
+
+void vw::Cache::set_stats_log_period( double seconds ) {
+  Mutex::Lock lock(m_mutex);
+  m_log_period = seconds;
+  m_last_log_time = Stopwatch::microtime();
 }
 
+// Called without any cache lock held, since stats() takes them all.
+void vw::Cache::log_stats_if_due() {
+  {
+    Mutex::Lock lock(m_mutex);
+    if( m_log_period <= 0 )
+      return;
+    uint64 now = Stopwatch::microtime();
+    if( double(now - m_last_log_time) < m_log_period * 1e6 )
+      return;
+    m_last_log_time = now;
+  }
+  VW_OUT(InfoMessage, "cache") << stats().report();
+}
+
+void vw::Cache::set_spill( std::string const& directory, size_t max_size ) {
+  Mutex::Lock lock(m_mutex);
+  m_spill_directory = directory;
+  m_max_spill_size = max_size;
+}
+
+size_t vw::Cache::max_spill_size() const {
+  Mutex::Lock lock(m_mutex);
+  return m_max_spill_size;
+}
+
+// The expected time to read back a spilled line.  The caller must
+// hold m_mutex.
+double vw::Cache::reload_microseconds( size_t size ) const {
+  return double(size) / m_spill_bandwidth * 1e6;
+}
+
+// Returns the name of the file to spill the line to, with its size
+// counted against the spill budget, or an empty string if the line
+// should not be spilled.
+std::string vw::Cache::reserve_spill( CacheLineBase const* line ) {
+  Mutex::Lock lock(m_mutex);
+  if( m_max_spill_size == 0 || m_spill_size + line->m_size > m_max_spill_size )
+    return std::string();
+  if( double(line->m_cost) <= reload_microseconds( line->m_size ) )
+    return std::string();
+  m_spill_size += line->m_size;
+#ifdef VW_HAVE_UNISTD_H
+  long pid = long(::getpid());
+#else
+  long pid = 0;
+#endif
+  std::ostringstream filename;
+  filename << m_spill_directory << "/vw_cache_" << pid << "_" << this << "_" << m_spill_count++ << ".spill";
+  return filename.str();
+}
+
+void vw::Cache::release_spill( size_t size, std::string const& filename ) {
+  std::remove( filename.c_str() );
+  Mutex::Lock lock(m_mutex);
+  m_spill_size -= size;
+}
+
+bool vw::Cache::reload_pays_off( CacheLineBase const* line ) const {
+  Mutex::Lock lock(m_mutex);
+  return double(line->m_cost) > reload_microseconds( line->m_size );
+}
+
+// Track the read bandwidth of the spill directory, weighted towards
+// recent reads.
+void vw::Cache::record_reload( size_t size, uint64 microseconds ) {
+  double bandwidth = double(size) * 1e6 / double(std::max( microseconds, uint64(1) ));
+  Mutex::Lock lock(m_mutex);
+  m_spill_bandwidth = 0.75 * m_spill_bandwidth + 0.25 * bandwidth;
+}
@@ -32,14 +32,59 @@
 ///  The entire Handle<GeneratorT> class
 ///
 /// No other functions are guaranteed to be thread-safe.  There are
-/// two levels of synchronization: one lock per cache to protect the
-/// cache data structure itself, and one lock per cache line to
+/// two levels of synchronization: one lock per cache shard to protect
+/// the cache data structure itself, and one lock per cache line to
 /// protect the m_value pointer and synchronize the (potentially very
 /// expensive) generation operation.  However, the lock on the cache
 /// line ends just before the generate() method is called on the
 /// m_value object itself, so that object is responsible for its own
 /// thread safety.
 ///
+/// By default a cache has a single shard, i.e. one LRU list and one
+/// lock, which gives exact LRU ordering.  A cache may instead be split
+/// into several shards (see set_num_shards()), each with its own LRU
+/// list and lock.  Cache lines are assigned to shards round-robin, so
+/// threads touching different lines rarely contend on the same lock.
+/// The byte budget stays global: when it is exceeded, a line is
+/// evicted from the allocating shard first and otherwise from any
+/// other shard whose lock is free.  The system cache shard count is
+/// controlled by vw_settings().system_cache_shards().
+///
+/// The line to evict is chosen by the cache's eviction policy.  The
+/// default, LRU_EVICTION, evicts the least recently used line.
+/// GDSF_EVICTION (Greedy-Dual-Size-Frequency) ranks each line by
+///   L + frequency * cost / size
+/// where cost is the time the line took to generate the first time,
+/// frequency is the number of accesses since it was last generated,
+/// and L is a per-shard value that rises to the rank of each evicted
+/// line so that lines which stop being used eventually age out.  Lines
+/// which are expensive to regenerate therefore stay resident longer
+/// than cheap ones of the same size.  The system cache policy is
+/// controlled by vw_settings().system_cache_policy().
+///
+/// Cache::stats() returns a snapshot of the cache counters, broken
+/// down by generator type, along with a histogram of how often the
+/// evicted lines had been used.  The snapshot can also be written to
+/// the "cache" log namespace periodically (see set_stats_log_period()
+/// and vw_settings().system_cache_log_period()), which helps to pick
+/// the system cache size for a given job.
+///
+/// Every cache reports its allocations to vw_memory_governor(), which
+/// can make a cache evict lines before it reaches its own maximum size
+/// when transient image buffers push the process over its memory
+/// limit (see Core/MemoryGovernor.h).
+///
+/// A cache may also be given a second, on-disk tier (see set_spill()).
+/// A line that is evicted is then first written to a file in the
+/// spill directory, if its value type supports it (see CacheSpill
+/// below), there is room for it, and it took longer to generate than
+/// it is expected to take to read back.  The next access to the line
+/// reads the file instead of regenerating the value.  The file is
+/// kept until the line is destroyed, so a line that is evicted again
+/// is not written twice.  Lines are spilled by the evicting thread.
+/// The system cache spills to vw_settings().tmp_directory(), up to
+/// vw_settings().system_cache_spill_size() bytes.
+///
 /// Note also that the valid() function is only useful as a heuristic:
 /// there is no guarantee that the cache line won't be invalidated
 /// between when the function checks the state and when you examine
@@ -60,8 +105,13 @@
 #include <vw/Core/System.h>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
 #include <typeinfo>
 #include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
 
 namespace vw {
 namespace core {
@@ -86,30 +136,128 @@ namespace detail {
 
 namespace vw {
 
+  /// Lets a Cache spill values of type T to disk (see
+  /// Cache::set_spill()).  A specialization for a spillable type sets
+  /// value to true and provides
+  ///   static void write( std::ostream& stream, T const& value );
+  ///   static boost::shared_ptr<T> read( std::istream& stream );
+  /// where read() returns a null pointer if the stream does not hold
+  /// what write() wrote.
+  template <class T>
+  struct CacheSpill {
+    static const bool value = false;
+    static void write( std::ostream& /*stream*/, T const& /*value*/ ) {}
+    static boost::shared_ptr<T> read( std::istream& /*stream*/ ) { return boost::shared_ptr<T>(); }
+  };
+
+  /// A snapshot of the statistics of a Cache, see Cache::stats().
+  struct CacheStats {
+    /// Counters for the cache lines of one generator type.
+    struct TypeStats {
+      uint64 lines;                   // Lines currently attached to the cache
+      uint64 hits, misses, evictions;
+      uint64 bytes_generated;         // Summed over every (re)generation
+      uint64 generate_microseconds;   // Spent generating lines the first time
+      uint64 regenerate_microseconds; // Spent regenerating evicted lines
+      uint64 spills, reloads;         // Lines written to and read from disk
+      uint64 reload_microseconds;     // Spent reading spilled lines back
+      TypeStats() : lines(0), hits(0), misses(0), evictions(0), bytes_generated(0),
+                    generate_microseconds(0), regenerate_microseconds(0),
+                    spills(0), reloads(0), reload_microseconds(0) {}
+      TypeStats& operator+=( TypeStats const& other );
+    };
+
+    /// The number of buckets in the eviction histogram.
+    static const size_t HISTOGRAM_BUCKETS = 16;
+
+    TypeStats total;
+    size_t size, max_size;  // Bytes allocated and allowed
+    size_t bytes_in_flight; // Bytes of the lines being generated right now
+    size_t spill_size, max_spill_size; // Bytes spilled to disk and allowed
+
+    /// Keyed by the typeid() name of the generator type.
+    std::map<std::string, TypeStats> types;
+
+    /// Bucket i counts the evicted lines that had been accessed
+    /// between 2^i and 2^(i+1)-1 times since they were last generated.
+    /// The last bucket also counts everything above it.
+    std::vector<uint64> eviction_histogram;
+
+    CacheStats() : size(0), max_size(0), bytes_in_flight(0), spill_size(0), max_spill_size(0),
+                   eviction_histogram(HISTOGRAM_BUCKETS, 0) {}
+
+    double hit_rate() const {
+      return total.hits + total.misses ? double(total.hits) / double(total.hits + total.misses) : 0.0;
+    }
+
+    /// A human-readable multi-line summary.
+    std::string report() const;
+  };
+
   // Cache contains a list of pointers to CacheLine CacheLine is
   // virtual and contains {generator,object,valid} Handle contains a
   // shared pointer to CacheLine
 
-  // An LRU-based regeneratable-data cache
+  // A regeneratable-data cache with LRU or cost-aware eviction
   class Cache {
+  public:
+    enum EvictionPolicy {
+      LRU_EVICTION,
+      GDSF_EVICTION
+    };
+
+  private:
+    class CacheLineBase;
+    typedef std::multimap<double, CacheLineBase*> RankMap;
+    typedef CacheStats::TypeStats TypeStats;
+
+    // An independent LRU list.  The shard's mutex protects the list
+    // pointers, the GDSF ranks and statistics counters of the shard.
+    struct Shard : private boost::noncopyable {
+      CacheLineBase *m_first_valid, *m_last_valid, *m_first_invalid;
+      RankMap m_ranks;   // Valid lines by GDSF rank (GDSF_EVICTION only)
+      double m_inflation; // The GDSF "L" value
+      Mutex m_mutex;
+      vw::uint64 m_hits, m_misses, m_evictions;
+      std::map<const char*, TypeStats> m_types; // Keyed by typeid() name
+      std::vector<vw::uint64> m_eviction_histogram;
+      size_t m_in_flight;
+      Shard() : m_first_valid(0), m_last_valid(0), m_first_invalid(0),
+                m_inflation(0), m_hits(0), m_misses(0), m_evictions(0),
+                m_eviction_histogram(CacheStats::HISTOGRAM_BUCKETS, 0), m_in_flight(0) {}
+    };
 
     // The abstract base class for all cache line objects.
     class CacheLineBase {
       Cache& m_cache;
+      Shard& m_shard;
       CacheLineBase *m_prev, *m_next;
       const size_t m_size;
+      vw::uint64 m_cost;      // Microseconds taken by the first generation
+      vw::uint32 m_frequency; // Accesses since the last generation
+      RankMap::iterator m_rank;
+      bool m_ranked;
+      TypeStats *m_type_stats; // In m_shard, set by the derived class
       friend class Cache;
     protected:
       Cache& cache() const { return m_cache; }
-      inline void allocate() { m_cache.allocate(m_size); }
+      Shard& shard() const { return m_shard; }
+      Mutex& cache_mutex() const { return m_shard.m_mutex; }
+      void set_cost( vw::uint64 microseconds ) { m_cost = microseconds; }
+      TypeStats& type_stats() const { return *m_type_stats; }
+      void set_type( const char *name ) { m_type_stats = &m_shard.m_types[name]; }
+      inline void allocate() { m_cache.allocate(m_size, m_shard); }
       inline void deallocate() { m_cache.deallocate(m_size); }
       inline void validate() { m_cache.validate(this); }
       inline void remove() { m_cache.remove( this ); }
       inline void deprioritize() { m_cache.deprioritize(this); }
     public:
-      CacheLineBase( Cache& cache, size_t size ) : m_cache(cache), m_prev(0), m_next(0), m_size(size) {}
+      CacheLineBase( Cache& cache, size_t size )
+        : m_cache(cache), m_shard(cache.next_shard()), m_prev(0), m_next(0), m_size(size),
+          m_cost(0), m_frequency(0), m_ranked(false), m_type_stats(0) {}
       virtual ~CacheLineBase() {}
       virtual inline void invalidate() { m_cache.invalidate(this); }
+      virtual bool try_invalidate() = 0;
       virtual size_t size() const { return m_size; }
     };
     friend class CacheLineBase;
@@ -118,23 +266,71 @@ namespace vw {
     template <class GeneratorT>
     class CacheLine : public CacheLineBase {
       GeneratorT m_generator;
-      typedef typename boost::shared_ptr<typename core::detail::GenValue<GeneratorT>::type> value_type;
+      typedef typename core::detail::GenValue<GeneratorT>::type element_type;
+      typedef typename boost::shared_ptr<element_type> value_type;
       value_type m_value;
       Mutex m_mutex; // Mutex for m_value and generation of this cache line
       unsigned m_generation_count;
+      std::string m_spill_file; // Holds a copy of the value, if not empty
+
+      // Writes the value to a spill file, if the cache has room for it
+      // and reading it back should be faster than regenerating it.
+      // Called with this line and its shard locked, as it is evicted.
+      void spill() {
+        if( ! CacheSpill<element_type>::value || ! m_spill_file.empty() ) return;
+        std::string filename = cache().reserve_spill( this );
+        if( filename.empty() ) return;
+        std::ofstream file( filename.c_str(), std::ios::binary );
+        CacheSpill<element_type>::write( file, *m_value );
+        file.close();
+        if( file.fail() ) {
+          VW_OUT(WarningMessage, "cache") << "Warning: Could not spill cache line to " << filename << "\n";
+          cache().release_spill( size(), filename );
+          return;
+        }
+        VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache spilled CacheLine " << info() << " to " << filename << "\n"; )
+        m_spill_file = filename;
+        type_stats().spills++;
+      }
+
+      // Reads the value back from its spill file.  The file is dropped
+      // if it can't be read, or if regenerating the value has become
+      // the cheaper of the two.
+      bool reload( uint64& elapsed ) {
+        if( cache().reload_pays_off( this ) ) {
+          uint64 start = Stopwatch::microtime();
+          std::ifstream file( m_spill_file.c_str(), std::ios::binary );
+          m_value = CacheSpill<element_type>::read( file );
+          elapsed = Stopwatch::microtime() - start;
+          if( m_value ) {
+            VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache reloaded CacheLine " << info() << " from " << m_spill_file << "\n"; )
+            cache().record_reload( size(), elapsed );
+            return true;
+          }
+          VW_OUT(WarningMessage, "cache") << "Warning: Could not reload cache line from " << m_spill_file << "\n";
+        }
+        cache().release_spill( size(), m_spill_file );
+        m_spill_file.clear();
+        return false;
+      }
 
     public:
       CacheLine( Cache& cache, GeneratorT const& generator )
         : CacheLineBase(cache,core::detail::pointerish(generator)->size()), m_generator(generator), m_generation_count(0)
       {
         VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache creating CacheLine " << info() << "\n"; )
-        Mutex::Lock cache_lock(cache.m_mutex);
+        Mutex::Lock cache_lock(cache_mutex());
+        set_type( typeid(GeneratorT).name() );
+        type_stats().lines++;
         CacheLineBase::invalidate();
       }
 
       virtual ~CacheLine() {
-        Mutex::Lock cache_lock(cache().m_mutex);
+        Mutex::Lock cache_lock(cache_mutex());
         invalidate();
+        if( ! m_spill_file.empty() )
+          cache().release_spill( size(), m_spill_file );
+        type_stats().lines--;
         VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache destroying CacheLine " << info() << "\n"; )
         remove();
       }
@@ -148,6 +344,22 @@ namespace vw {
         m_value.reset();
       }
 
+      // Like invalidate(), but gives up instead of waiting when another
+      // thread holds this line.  The cache uses this for eviction, since
+      // the other thread may itself be waiting for the cache lock.
+      virtual bool try_invalidate() {
+        if( ! m_mutex.try_lock() ) return false;
+        if( m_value ) {
+          VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache invalidating CacheLine " << info() << "\n"; );
+          spill();
+          CacheLineBase::invalidate();
+          CacheLineBase::deallocate();
+          m_value.reset();
+        }
+        m_mutex.unlock();
+        return true;
+      }
+
       std::string info() {
         std::ostringstream oss;
         oss << typeid(this).name() << " " << this
@@ -155,30 +367,56 @@ namespace vw {
         return oss.str();
       }
 
-      value_type const& value() {
-        bool hit = true;
+      value_type value() {
+        bool hit = true, reloaded = false;
+        uint64 elapsed = 0;
         Mutex::Lock line_lock(m_mutex);
         if( !m_value ) {
-          m_generation_count++;
           hit = false;
-          VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache generating CacheLine " << info() << "\n"; )
           {
-            Mutex::Lock cache_lock(cache().m_mutex);
+            Mutex::Lock cache_lock(cache_mutex());
             CacheLineBase::allocate();
+            shard().m_in_flight += size();
+          }
+          if( ! m_spill_file.empty() )
+            reloaded = reload( elapsed );
+          if( ! reloaded ) {
+            m_generation_count++;
+            VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache generating CacheLine " << info() << "\n"; )
+            ScopedWatch sw((std::string("Cache ")
+                            + (m_generation_count == 1 ? "generating " : "regenerating ")
+                            + typeid(this).name()).c_str());
+            uint64 start = Stopwatch::microtime();
+            m_value = core::detail::pointerish(m_generator)->generate();
+            elapsed = Stopwatch::microtime() - start;
+            if (m_generation_count == 1)
+              set_cost( elapsed );
           }
-          ScopedWatch sw((std::string("Cache ")
-                          + (m_generation_count == 1 ? "generating " : "regenerating ")
-                          + typeid(this).name()).c_str());
-          m_value = core::detail::pointerish(m_generator)->generate();
         }
         {
-          Mutex::Lock cache_lock(cache().m_mutex);
+          Mutex::Lock cache_lock(cache_mutex());
           CacheLineBase::validate();
-          if (hit)
-            cache().m_hits++;
-          else
-            cache().m_misses++;
+          if (hit) {
+            shard().m_hits++;
+            type_stats().hits++;
+          } else {
+            shard().m_misses++;
+            shard().m_in_flight -= size();
+            type_stats().misses++;
+            if (reloaded) {
+              type_stats().reloads++;
+              type_stats().reload_microseconds += elapsed;
+            } else {
+              type_stats().bytes_generated += size();
+              if (m_generation_count == 1)
+                type_stats().generate_microseconds += elapsed;
+              else
+                type_stats().regenerate_microseconds += elapsed;
+            }
+          }
         }
+        if (!hit)
+          cache().log_stats_if_due();
         return m_value;
       }
 
@@ -187,27 +425,59 @@ namespace vw {
         return (bool)m_value;
       }
 
+      // Never waits: a line that another thread holds is about to be
+      // valid, or was just used.
+      bool needs_generation() {
+        if( ! m_mutex.try_lock() ) return false;
+        bool result = ! m_value;
+        m_mutex.unlock();
+        return result;
+      }
+
       void deprioritize() {
         Mutex::Lock line_lock(m_mutex);
         if( m_value ) {
-          Mutex::Lock cache_lock(cache().m_mutex);
+          Mutex::Lock cache_lock(cache_mutex());
           CacheLineBase::deprioritize();
         }
       }
     };
 
 
-    CacheLineBase *m_first_valid, *m_last_valid, *m_first_invalid;
+    std::vector<boost::shared_ptr<Shard> > m_shards;
+    size_t m_next_shard;
     size_t m_size, m_max_size;
-    Mutex m_mutex;
-    vw::uint64 m_hits, m_misses, m_evictions;
-
-    void allocate( size_t size );
+    mutable Mutex m_mutex; // Protects m_size, m_max_size, and m_next_shard
+
+    EvictionPolicy m_policy;
+
+    double m_log_period;    // Seconds between stats log dumps, or 0
+    uint64 m_last_log_time; // Protected by m_mutex, like m_size
+
+    // The spill tier, also protected by m_mutex
+    std::string m_spill_directory;
+    size_t m_spill_size, m_max_spill_size;
+    double m_spill_bandwidth; // Estimated bytes per second read back
+    uint64 m_spill_count;     // For unique file names
+
+    Shard& next_shard();
+    void rank( CacheLineBase *line, double rank );
+    void unrank( CacheLineBase *line );
+    void record_eviction( CacheLineBase *line, vw::uint32 accesses );
+    bool evict_from( Shard& shard, bool& busy );
+    bool evict_to( size_t size );
+    void allocate( size_t size, Shard& shard );
     void deallocate( size_t size );
     void validate( CacheLineBase *line );
     void invalidate( CacheLineBase *line );
     void remove( CacheLineBase *line );
     void deprioritize( CacheLineBase *line );
+    void log_stats_if_due();
+    double reload_microseconds( size_t size ) const;
+    std::string reserve_spill( CacheLineBase const* line );
+    void release_spill( size_t size, std::string const& filename );
+    bool reload_pays_off( CacheLineBase const* line ) const;
+    void record_reload( size_t size, uint64 microseconds );
 
   public:
 
@@ -236,6 +506,13 @@ namespace vw {
         VW_ASSERT( m_line_ptr, NullPtrErr() << "Invalid cache handle!" );
         return m_line_ptr->valid();
       }
+      /// True if the line is invalid and no other thread is busy with
+      /// it.  Unlike valid(), this never waits for a line that is
+      /// being generated.
+      bool needs_generation() const {
+        VW_ASSERT( m_line_ptr, NullPtrErr() << "Invalid cache handle!" );
+        return m_line_ptr->needs_generation();
+      }
       size_t size() const {
         VW_ASSERT( m_line_ptr, NullPtrErr() << "Invalid cache handle!" );
         return m_line_ptr->size();
@@ -250,10 +527,12 @@ namespace vw {
       }
     };
 
-    Cache( size_t max_size ) :
-      m_first_valid(0), m_last_valid(0), m_first_invalid(0),
-      m_size(0), m_max_size(max_size),
-      m_hits(0), m_misses(0), m_evictions(0) {}
+    Cache( size_t max_size, uint32 num_shards = 1, EvictionPolicy policy = LRU_EVICTION ) :
+      m_next_shard(0), m_size(0), m_max_size(max_size), m_policy(policy),
+      m_log_period(0), m_last_log_time(0),
+      m_spill_size(0), m_max_spill_size(0), m_spill_bandwidth(100e6), m_spill_count(0) {
+      set_num_shards( num_shards );
+    }
 
     template <class GeneratorT>
     Handle<GeneratorT> insert( GeneratorT const& generator ) {
@@ -265,13 +544,45 @@ namespace vw {
     void resize( size_t size );
     size_t max_size() { return m_max_size; }
 
-    uint64 hits() const { return m_hits; }
-    uint64 misses() const { return m_misses; }
-    uint64 evictions() const {return m_evictions; }
-    void clear_stats() {
-      Mutex::Lock cache_lock(m_mutex);
-      m_hits = m_misses = m_evictions = 0;
-    }
+    /// Evicts lines until at most the given number of bytes are in
+    /// use, without changing the maximum size.  Lines that other
+    /// threads are using are skipped, so this is best-effort.
+    void trim( size_t size );
+
+    /// Changes the number of independent LRU lists in the cache.  This
+    /// may only be called while no cache lines are attached to the
+    /// cache, and is not thread-safe.
+    void set_num_shards( uint32 num_shards );
+    uint32 num_shards() const { return uint32(m_shards.size()); }
+
+    /// Changes how the cache picks lines to evict.  This may only be
+    /// called while no cache lines are attached to the cache, and is
+    /// not thread-safe.
+    void set_eviction_policy( EvictionPolicy policy );
+    EvictionPolicy eviction_policy() const { return m_policy; }
+
+    uint64 hits() const;
+    uint64 misses() const;
+    uint64 evictions() const;
+    void clear_stats();
+
+    /// Returns a snapshot of the cache statistics.  The shards are
+    /// visited one at a time, so while other threads use the cache the
+    /// snapshot is only approximately consistent.
+    CacheStats stats() const;
+
+    /// Writes stats().report() to the "cache" log namespace at
+    /// InfoMessage level at most once every given number of seconds.
+    /// The period is checked each time a cache line is generated.  A
+    /// period of zero, the default, turns this off.
+    void set_stats_log_period( double seconds );
+
+    /// Lets the cache spill the lines it evicts to files in the given
+    /// directory, which must exist, up to max_size bytes in all.  A
+    /// max_size of zero, the default, turns spilling off.  Lines that
+    /// were already spilled stay on disk.
+    void set_spill( std::string const& directory, size_t max_size );
+    size_t max_spill_size() const;
   };
 } // namespace vw
 
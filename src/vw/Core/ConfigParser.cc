@@ -91,12 +91,38 @@ void vw::parse_config(std::basic_istream<char>& stream,
         settings.set_default_num_threads(boost::lexical_cast<uint32>(o.value[0]));
       else if (o.string_key == "general.system_cache_size")
         settings.set_system_cache_size(boost::lexical_cast<size_t>(o.value[0]));
+      else if (o.string_key == "general.system_cache_shards")
+        settings.set_system_cache_shards(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.system_cache_policy")
+        settings.set_system_cache_policy(o.value[0]);
+      else if (o.string_key == "general.system_cache_log_period")
+        settings.set_system_cache_log_period(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.system_cache_spill_size")
+        settings.set_system_cache_spill_size(boost::lexical_cast<size_t>(o.value[0]));
+      else if (o.string_key == "general.memory_limit")
+        settings.set_memory_limit(boost::lexical_cast<size_t>(o.value[0]));
+      else if (o.string_key == "general.buffer_pool_size")
+        settings.set_buffer_pool_size(boost::lexical_cast<size_t>(o.value[0]));
+      else if (o.string_key == "general.numa_aware")
+        settings.set_numa_aware(boost::lexical_cast<bool>(o.value[0]));
       else if (o.string_key == "general.default_tile_size")
         settings.set_default_tile_size(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.concurrent_file_reads")
+        settings.set_concurrent_file_reads(boost::lexical_cast<bool>(o.value[0]));
+      else if (o.string_key == "general.io_queue_depth")
+        settings.set_io_queue_depth(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.hdf_chunk_cache_size")
+        settings.set_hdf_chunk_cache_size(boost::lexical_cast<uint32>(o.value[0]));
       else if (o.string_key == "general.write_pool_size")
         settings.set_write_pool_size(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.write_pool_memory")
+        settings.set_write_pool_memory(boost::lexical_cast<size_t>(o.value[0]));
       else if (o.string_key == "general.tmp_directory")
         settings.set_tmp_directory(o.value[0]);
+      else if (o.string_key == "general.trace_file")
+        settings.set_trace_file(o.value[0]);
+      else if (o.string_key == "general.trace_summary")
+        settings.set_trace_summary(boost::lexical_cast<bool>(o.value[0]));
       else if (o.string_key.compare(0, 8, "logfile ") == 0) {
         size_t sep = o.string_key.find_last_of('.');
         assert(sep != std::string::npos);
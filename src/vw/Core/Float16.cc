@@ -0,0 +1,67 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Core/Float16.h>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace vw {
+
+  void float16_to_float32( float16 const* src, float32* dst, size_t count ) {
+    size_t i = 0;
+#if defined(__F16C__)
+    for( ; i+8 <= count; i+=8 ) {
+      __m128i half = _mm_loadu_si128( reinterpret_cast<__m128i const*>(src+i) );
+      _mm256_storeu_ps( dst+i, _mm256_cvtph_ps( half ) );
+    }
+#elif defined(__SSE2__)
+    // The scalar conversion four at a time, with the denormals
+    // renormalized by a float subtraction and the infinities and NaNs
+    // given the full float exponent.
+    const __m128i mask_nosign = _mm_set1_epi32( 0x7fff );
+    const __m128i shifted_exp = _mm_set1_epi32( 0x7c00 << 13 );
+    const __m128i exp_adjust = _mm_set1_epi32( (127 - 15) << 23 );
+    const __m128i infnan_adjust = _mm_set1_epi32( (128 - 16) << 23 );
+    const __m128i denorm_adjust = _mm_set1_epi32( 1 << 23 );
+    const __m128 magic = _mm_castsi128_ps( _mm_set1_epi32( 113 << 23 ) );
+    const __m128i zero = _mm_setzero_si128();
+    for( ; i+4 <= count; i+=4 ) {
+      __m128i half = _mm_loadl_epi64( reinterpret_cast<__m128i const*>(src+i) );
+      half = _mm_unpacklo_epi16( half, zero );
+      __m128i bits = _mm_slli_epi32( _mm_and_si128( half, mask_nosign ), 13 );
+      __m128i exp = _mm_and_si128( bits, shifted_exp );
+      bits = _mm_add_epi32( bits, exp_adjust );
+      __m128i is_infnan = _mm_cmpeq_epi32( exp, shifted_exp );
+      __m128i is_denorm = _mm_cmpeq_epi32( exp, zero );
+      bits = _mm_add_epi32( bits, _mm_and_si128( is_infnan, infnan_adjust ) );
+      __m128i denorm = _mm_castps_si128( _mm_sub_ps( _mm_castsi128_ps( _mm_add_epi32( bits, denorm_adjust ) ), magic ) );
+      bits = _mm_or_si128( _mm_and_si128( is_denorm, denorm ), _mm_andnot_si128( is_denorm, bits ) );
+      bits = _mm_or_si128( bits, _mm_slli_epi32( _mm_andnot_si128( mask_nosign, half ), 16 ) );
+      _mm_storeu_ps( dst+i, _mm_castsi128_ps( bits ) );
+    }
+#endif
+    for( ; i<count; ++i )
+      dst[i] = src[i];
+  }
+
+  void float32_to_float16( float32 const* src, float16* dst, size_t count ) {
+    size_t i = 0;
+#if defined(__F16C__)
+    for( ; i+8 <= count; i+=8 ) {
+      __m128i half = _mm256_cvtps_ph( _mm256_loadu_ps( src+i ), _MM_FROUND_TO_NEAREST_INT );
+      _mm_storeu_si128( reinterpret_cast<__m128i*>(dst+i), half );
+    }
+#endif
+    for( ; i<count; ++i )
+      dst[i] = src[i];
+  }
+
+} // namespace vw
@@ -0,0 +1,183 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Float16.h
+///
+/// A 16-bit IEEE 754 half-precision floating-point channel type.
+///
+/// float16 has an 11-bit significand (about three decimal digits) and
+/// a range of 6e-8 to 65504, which is enough for many intermediate
+/// products, such as disparities, DEM tiles and orthoimages, at half
+/// the memory, I/O and cache traffic of float32.  Values are stored
+/// as half precision and converted to float for arithmetic: a float16
+/// converts to float implicitly, and is constructed from any
+/// arithmetic type, rounding to the nearest half-precision value.
+///
+/// The bulk conversions between arrays of float16 and float32 below
+/// use the F16C instructions when VW is built for them, and SSE2 for
+/// the conversion to float32 otherwise.
+///
+#ifndef __VW_CORE_FLOAT16_H__
+#define __VW_CORE_FLOAT16_H__
+
+#include <cstring>
+#include <limits>
+
+#include <boost/utility/enable_if.hpp>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/TypeDeduction.h>
+
+namespace vw {
+
+  /// \cond INTERNAL
+  // The scalar conversions, rounding to nearest even.  Denormals,
+  // infinities and NaNs are kept.
+  inline float32 half_bits_to_float( uint16 half ) {
+    const uint32 shifted_exp = 0x7c00 << 13;
+    uint32 bits = uint32(half & 0x7fff) << 13;
+    uint32 exp = bits & shifted_exp;
+    bits += (127 - 15) << 23;
+    if( exp == shifted_exp ) {
+      // Infinity or NaN
+      bits += (128 - 16) << 23;
+    } else if( exp == 0 ) {
+      // Zero or denormal: renormalize through float arithmetic
+      const uint32 magic_bits = 113 << 23;
+      float32 magic, value;
+      bits += 1 << 23;
+      std::memcpy( &magic, &magic_bits, sizeof(magic) );
+      std::memcpy( &value, &bits, sizeof(value) );
+      value -= magic;
+      std::memcpy( &bits, &value, sizeof(bits) );
+    }
+    bits |= uint32(half & 0x8000) << 16;
+    float32 result;
+    std::memcpy( &result, &bits, sizeof(result) );
+    return result;
+  }
+
+  inline uint16 float_to_half_bits( float32 value ) {
+    uint32 bits;
+    std::memcpy( &bits, &value, sizeof(bits) );
+    uint32 sign = bits & 0x80000000u;
+    bits ^= sign;
+    uint16 half;
+    if( bits >= 0x47800000u ) {
+      // Too large for half precision, infinity or NaN
+      half = ( bits > 0x7f800000u ) ? 0x7e00 : 0x7c00;
+    } else if( bits < 0x38800000u ) {
+      // Zero or denormal: let float addition do the rounding
+      const uint32 magic_bits = 0x3f000000u;
+      float32 magic, scaled;
+      std::memcpy( &magic, &magic_bits, sizeof(magic) );
+      std::memcpy( &scaled, &bits, sizeof(scaled) );
+      scaled += magic;
+      std::memcpy( &bits, &scaled, sizeof(bits) );
+      half = uint16( bits - magic_bits );
+    } else {
+      uint32 mant_odd = (bits >> 13) & 1;
+      bits += ( uint32(15 - 127) << 23 ) + 0xfff;
+      bits += mant_odd;
+      half = uint16( bits >> 13 );
+    }
+    return uint16( half | (sign >> 16) );
+  }
+  /// \endcond
+
+  /// A half-precision floating-point number.
+  class float16 {
+    uint16 m_bits;
+  public:
+    float16() : m_bits(0) {}
+
+    template <class T>
+    float16( T value, typename boost::enable_if<boost::is_arithmetic<T> >::type* = 0 )
+      : m_bits( float_to_half_bits( float32(value) ) ) {}
+
+    /// The number with the given IEEE 754 half-precision bits.
+    static float16 from_bits( uint16 bits ) {
+      float16 result;
+      result.m_bits = bits;
+      return result;
+    }
+
+    /// The IEEE 754 half-precision bits of the number.
+    uint16 bits() const { return m_bits; }
+
+    operator float32() const { return half_bits_to_float( m_bits ); }
+
+    float16& operator+=( float32 value ) { return *this = float32(*this) + value; }
+    float16& operator-=( float32 value ) { return *this = float32(*this) - value; }
+    float16& operator*=( float32 value ) { return *this = float32(*this) * value; }
+    float16& operator/=( float32 value ) { return *this = float32(*this) / value; }
+  };
+
+  /// float16 is a floating-point scalar, and accumulates in float32.
+  template <> struct IsScalar<float16> : public true_type {};
+  template <> struct IsFloatingPoint<float16> : public true_type {};
+  template <> struct AccumulatorType<float16> { typedef float32 type; };
+  template <> struct FloatType<float16> { typedef float32 type; };
+
+  /// \cond INTERNAL
+  // Operations mixing float16 with integers give float16, and with
+  // float32 or float64 give the wider type.
+  namespace core { namespace detail {
+    template <>
+    struct TypeDeductionIndex<float16> {
+      typedef boost::mpl::int_<1350> type;
+      BOOST_STATIC_CONSTANT(unsigned, value = type::value);
+    };
+  }}
+  /// \endcond
+
+  /// Converts count float16 values to float32.
+  void float16_to_float32( float16 const* src, float32* dst, size_t count );
+
+  /// Converts count float32 values to float16, rounding to nearest.
+  void float32_to_float16( float32 const* src, float16* dst, size_t count );
+
+} // namespace vw
+
+namespace std {
+  template <>
+  class numeric_limits<vw::float16> {
+  public:
+    static const bool is_specialized = true;
+    static vw::float16 min() { return vw::float16::from_bits(0x0400); }
+    static vw::float16 max() { return vw::float16::from_bits(0x7bff); }
+    static const int digits = 11;
+    static const int digits10 = 3;
+    static const bool is_signed = true;
+    static const bool is_integer = false;
+    static const bool is_exact = false;
+    static const int radix = 2;
+    static vw::float16 epsilon() { return vw::float16::from_bits(0x1400); }
+    static vw::float16 round_error() { return vw::float16::from_bits(0x3800); }
+    static const int min_exponent = -13;
+    static const int min_exponent10 = -4;
+    static const int max_exponent = 16;
+    static const int max_exponent10 = 4;
+    static const bool has_infinity = true;
+    static const bool has_quiet_NaN = true;
+    static const bool has_signaling_NaN = true;
+    static const float_denorm_style has_denorm = denorm_present;
+    static const bool has_denorm_loss = false;
+    static vw::float16 infinity() { return vw::float16::from_bits(0x7c00); }
+    static vw::float16 quiet_NaN() { return vw::float16::from_bits(0x7e00); }
+    static vw::float16 signaling_NaN() { return vw::float16::from_bits(0x7d00); }
+    static vw::float16 denorm_min() { return vw::float16::from_bits(0x0001); }
+    static const bool is_iec559 = true;
+    static const bool is_bounded = true;
+    static const bool is_modulo = false;
+    static const bool traps = false;
+    static const bool tinyness_before = false;
+    static const float_round_style round_style = round_to_nearest;
+  };
+}
+
+#endif // __VW_CORE_FLOAT16_H__
@@ -83,6 +83,11 @@ namespace vw {
   template <class T> struct IsScalar<std::complex<T> > : public true_type {};
   template <class T> struct IsScalar<const T> : public IsScalar<T> {};
 
+  /// Whether a type is a floating-point type: the built-in ones, and
+  /// float16 (see Float16.h).
+  template <class T> struct IsFloatingPoint : public boost::is_floating_point<T> {};
+  template <class T> struct IsFloatingPoint<const T> : public IsFloatingPoint<T> {};
+
 
   /// It is often useful to know what the lowest, highest, and
   /// smallest possible value is for various scalar types (both
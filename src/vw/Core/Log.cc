@@ -6,6 +6,7 @@
 
 
 #include <vector>
+#include <limits>
 
 #include <vw/Core/Log.h>
 #include <vw/Core/Exception.h>
@@ -47,6 +48,17 @@ current_posix_time_string()
 
 namespace {
   static vw::null_ostream g_null_ostream;
+
+  vw::RunOnce serial_once = VW_RUNONCE_INIT;
+  vw::Mutex* serial_mutex;
+  void init_serial_mutex() { serial_mutex = new vw::Mutex(); }
+}
+
+vw::uint64 vw::log_buffer_serial() {
+  static uint64 serial = 0;
+  serial_once.run( init_serial_mutex );
+  Mutex::Lock lock(*serial_mutex);
+  return ++serial;
 }
 
 // ---------------------------------------------------
@@ -76,11 +88,13 @@ vw::LogInstance::LogInstance(std::string const& log_filename, bool prepend_infos
   *m_log_ostream_ptr << "\n\n" << "Vision Workbench log started at " << current_posix_time_string() << ".\n\n";
 
   m_log_stream.set_stream(*m_log_ostream_ptr);
+  m_log_stream.set_asynchronous(true);
 }
 
-vw::LogInstance::LogInstance(std::ostream& log_ostream, bool prepend_infostamp) : m_log_stream(log_ostream),
-                                                                                  m_log_ostream_ptr(NULL),
-                                                                                  m_prepend_infostamp(prepend_infostamp) {}
+vw::LogInstance::LogInstance(std::ostream& log_ostream, bool prepend_infostamp, bool asynchronous)
+  : m_log_stream(log_ostream), m_log_ostream_ptr(NULL), m_prepend_infostamp(prepend_infostamp) {
+  m_log_stream.set_asynchronous(asynchronous);
+}
 
 std::ostream& vw::LogInstance::operator() (int log_level, std::string const& log_namespace) {
   if (m_rule_set(log_level, log_namespace)) {
@@ -103,35 +117,41 @@ std::ostream& vw::Log::operator() (int log_level, std::string const& log_namespa
   // Reload the rulesets if it has.
   vw_settings().reload_config();
 
-  {
-    Mutex::Lock multi_ostreams_lock(m_multi_ostreams_mutex);
-
-    // Check to see if we have an ostream defined yet for this thread.
-    if(m_multi_ostreams.find( Thread::id() ) == m_multi_ostreams.end())
-      m_multi_ostreams[ Thread::id() ] = boost::shared_ptr<multi_ostream>(new multi_ostream);
+  // Check to see if we have an ostream defined yet for this thread.
+  multi_ostream* stream = m_multi_ostreams.get();
+  if ( !stream ) {
+    stream = new multi_ostream;
+    m_multi_ostreams.reset( stream );
+  }
 
-    boost::shared_ptr<multi_ostream>& stream = m_multi_ostreams[ Thread::id() ];
+  // Reset and add the console log output...
+  stream->clear();
+  stream->add(m_console_log->operator()(log_level, log_namespace));
 
-    // Reset and add the console log output...
-    stream->clear();
-    stream->add(m_console_log->operator()(log_level, log_namespace));
+  // ... and the rest of the active log streams.
+  std::vector<boost::shared_ptr<LogInstance> >::iterator iter = m_logs.begin();
+  for (;iter != m_logs.end(); ++iter)
+    stream->add((*iter)->operator()(log_level,log_namespace));
 
-    // ... and the rest of the active log streams.
-    std::vector<boost::shared_ptr<LogInstance> >::iterator iter = m_logs.begin();
-    for (;iter != m_logs.end(); ++iter)
-      stream->add((*iter)->operator()(log_level,log_namespace));
+  return *stream;
+}
 
-    return *stream;
-  }
+void vw::Log::flush() {
+  Mutex::Lock lock(m_system_log_mutex);
+  m_console_log->flush();
+  BOOST_FOREACH( boost::shared_ptr<LogInstance> const& log_instance, m_logs )
+    log_instance->flush();
 }
 
 bool vw::Log::is_enabled( int log_level,
                           std::string const& log_namespace ) {
   // Early exit option before iterating through m_logs
-  if ( m_console_log->rule_set()(log_level, log_namespace) )
+  LogRuleSet& console_rules = m_console_log->rule_set();
+  if ( log_level <= console_rules.max_level() && console_rules(log_level, log_namespace) )
     return true;
-  BOOST_FOREACH( boost::shared_ptr<LogInstance> log_instance, m_logs ) {
-    if ( log_instance->rule_set()(log_level, log_namespace) )
+  BOOST_FOREACH( boost::shared_ptr<LogInstance> const& log_instance, m_logs ) {
+    LogRuleSet& rules = log_instance->rule_set();
+    if ( log_level <= rules.max_level() && rules(log_level, log_namespace) )
       return true;
   }
   return false;
@@ -139,15 +159,17 @@ bool vw::Log::is_enabled( int log_level,
 
 vw::LogRuleSet::LogRuleSet( LogRuleSet const& copy_log) {
   m_rules = copy_log.m_rules;
+  m_max_level = copy_log.m_max_level;
 }
 
 vw::LogRuleSet& vw::LogRuleSet::operator=( LogRuleSet const& copy_log) {
   m_rules = copy_log.m_rules;
+  m_max_level = copy_log.m_max_level;
   return *this;
 }
 
-
-vw::LogRuleSet::LogRuleSet() { }
+// Without rules, operator() passes InfoMessage at most.
+vw::LogRuleSet::LogRuleSet() : m_max_level(vw::InfoMessage) { }
 vw::LogRuleSet::~LogRuleSet() { }
 
 void vw::LogRuleSet::add_rule(int log_level, std::string const& log_namespace) {
@@ -161,11 +183,17 @@ void vw::LogRuleSet::add_rule(int log_level, std::string const& log_namespace) {
 
   Mutex::Lock lock(m_mutex);
   m_rules.push_front(rule_type(log_level, boost::to_lower_copy(log_namespace)));
+  // An EveryMessage rule passes every level, however large.
+  if (log_level == vw::EveryMessage)
+    m_max_level = std::numeric_limits<int>::max();
+  else
+    m_max_level = std::max(m_max_level, log_level);
 }
 
 void vw::LogRuleSet::clear() {
   Mutex::Lock lock(m_mutex);
   m_rules.clear();
+  m_max_level = vw::InfoMessage;
 }
 
 namespace {
@@ -30,6 +30,7 @@
 // Boost Headers
 #include <boost/algorithm/string.hpp>
 #include <boost/numeric/conversion/cast.hpp>
+#include <boost/thread/tss.hpp>
 
 // STD Headers
 #include <string>
@@ -180,6 +181,10 @@ namespace vw {
   typedef MultiOutputStream<char> multi_ostream;
 
 
+  // A number that tells one PerThreadBufferedStreamBuf from any
+  // other created during the run, even at the same address.
+  uint64 log_buffer_serial();
+
   // In order to create our own C++ streams compatible ostream object,
   // we must first define a subclass of basic_streambuf<>, which
   // handles stream output on a character by character basis.  This is
@@ -191,79 +196,175 @@ namespace vw {
 
     typedef typename std::basic_streambuf<CharT, traits>::int_type int_type;
 
-    // Characters are buffered is vectors until a newline appears at
-    // the end of a line of input or flush() is called.  These vectors
-    // are indexed in a std::map by thread id.
-    //
-    // TODO: This map could grow quite large if a program spawns (and
-    // logs to) many, many threads.  We should think carefully about
-    // cleaning up this map structure from time to time.
+    // Characters are buffered in a vector of the writing thread's own
+    // until a newline appears at the end of a line of input or flush()
+    // is called, so buffering them takes no lock.  A thread's buffer
+    // goes away with the thread.  The serial number tells the buffers
+    // of this streambuf from any left behind by an earlier one at the
+    // same address.
     typedef std::vector<CharT> buffer_type;
-    typedef std::map<vw::uint64, buffer_type> lookup_table_type;
-    lookup_table_type m_buffers;
+    struct ThreadBuffer {
+      uint64 serial;
+      buffer_type buffer;
+    };
+    boost::thread_specific_ptr<ThreadBuffer> m_buffers;
+    const uint64 m_serial;
 
     std::basic_streambuf<CharT, traits>* m_out;
     Mutex m_mutex;
 
+    // In asynchronous mode finished lines are queued, and a writer
+    // thread writes them to m_out, so the threads that log never wait
+    // on the output.  All of these are guarded by m_mutex.
+    bool m_async, m_stop, m_writing;
+    std::vector<buffer_type> m_queue;
+    Condition m_queued_event, m_drained_event;
+    boost::shared_ptr<Thread> m_writer;
+
+    class Writer {
+      PerThreadBufferedStreamBuf *m_buf;
+    public:
+      Writer( PerThreadBufferedStreamBuf *buf ) : m_buf(buf) {}
+      void operator()() { m_buf->write_queued(); }
+    };
+
+    buffer_type& buffer() {
+      ThreadBuffer *buf = m_buffers.get();
+      if ( !buf || buf->serial != m_serial ) {
+        buf = new ThreadBuffer;
+        buf->serial = m_serial;
+        m_buffers.reset(buf);
+      }
+      return buf->buffer;
+    }
+
     // This method is called when a single character is fed to the
     // streambuf.  In practice, characters are fed in batches using
     // xputn() below.
     virtual int_type overflow(int_type c) {
-      Mutex::Lock lock(m_mutex);
-      buffer_type& buffer = m_buffers[ Thread::id() ];
+      buffer_type& buf = buffer();
 
       if(!traits::eq_int_type(c, traits::eof())) {
-        buffer.push_back(static_cast<CharT>(c));
+        buf.push_back(static_cast<CharT>(c));
       }
 
       // If the last character is a newline or cairrage return, then
       // we force a call to sync().
       if ( c == '\n' || c == '\r' )
-        locked_sync(buffer);
+        emit(buf);
       return traits::not_eof(c);
     }
 
     virtual std::streamsize xsputn(const CharT* s, std::streamsize num) {
-      Mutex::Lock lock(m_mutex);
-      buffer_type& buffer = m_buffers[ Thread::id() ];
+      buffer_type& buf = buffer();
 
-      std::copy(s, s + num, std::back_inserter<buffer_type>( buffer ));
+      std::copy(s, s + num, std::back_inserter<buffer_type>( buf ));
 
       // This is a bit of a hack that forces a sync whenever the
       // character string *ends* with a newline, thereby flushing the
       // buffer and printing a line to the log file.
-      if ( buffer.size() > 0 ) {
-        size_t last_char_position = buffer.size()-1;
+      if ( buf.size() > 0 ) {
+        size_t last_char_position = buf.size()-1;
 
-        if ( buffer[last_char_position] == '\n' ||
-             buffer[last_char_position] == '\r' )
-          locked_sync(buffer);
+        if ( buf[last_char_position] == '\n' ||
+             buf[last_char_position] == '\r' )
+          emit(buf);
       }
       return num;
     }
 
-    // You must call this with the lock already held!
-    int locked_sync(buffer_type& buffer) {
-      if(!buffer.empty() && m_out ) {
-        m_out->sputn(&buffer[0], boost::numeric_cast<std::streamsize>(buffer.size()));
+    // Hands a thread's buffered characters on to the output: queues
+    // them for the writer thread, or writes them right away.  They
+    // stay buffered while there is no output.
+    void emit(buffer_type& buf) {
+      if ( buf.empty() )
+        return;
+      Mutex::Lock lock(m_mutex);
+      if ( !m_out )
+        return;
+      if ( m_async ) {
+        m_queue.push_back( buffer_type() );
+        m_queue.back().swap( buf );
+        m_queued_event.notify_all();
+      } else {
+        m_out->sputn(&buf[0], boost::numeric_cast<std::streamsize>(buf.size()));
         m_out->pubsync();
-        buffer.clear();
+        buf.clear();
       }
-      return 0;
     }
 
-    virtual int sync() {
+    // The writer thread's loop.  The lines are written without the
+    // lock, so logging threads can queue more meanwhile.
+    void write_queued() {
+      std::vector<buffer_type> lines;
       Mutex::Lock lock(m_mutex);
-      if (m_buffers.count(Thread::id()))
-        return locked_sync(m_buffers[ Thread::id() ]);
+      while ( true ) {
+        while ( m_queue.empty() && !m_stop )
+          m_queued_event.wait(lock);
+        if ( m_queue.empty() )
+          break;
+        lines.swap(m_queue);
+        m_writing = true;
+        std::basic_streambuf<CharT, traits>* out = m_out;
+        lock.unlock();
+        for ( size_t i = 0; i < lines.size(); ++i )
+          out->sputn(&lines[i][0], boost::numeric_cast<std::streamsize>(lines[i].size()));
+        out->pubsync();
+        lines.clear();
+        lock.lock();
+        m_writing = false;
+        m_drained_event.notify_all();
+      }
+    }
+
+    // You must call this with the lock already held!
+    void locked_drain(Mutex::Lock& lock) {
+      while ( m_writing || !m_queue.empty() )
+        m_drained_event.wait(lock);
+    }
+
+    virtual int sync() {
+      emit(buffer());
       return 0;
     }
 
   public:
-    PerThreadBufferedStreamBuf() : m_buffers(), m_out(NULL) {}
-    ~PerThreadBufferedStreamBuf() { sync(); }
+    PerThreadBufferedStreamBuf()
+      : m_serial(log_buffer_serial()), m_out(NULL),
+        m_async(false), m_stop(false), m_writing(false) {}
+    ~PerThreadBufferedStreamBuf() { sync(); set_asynchronous(false); }
 
-    void init(std::basic_streambuf<CharT,traits>* out) { m_out = out; }
+    void init(std::basic_streambuf<CharT,traits>* out) {
+      Mutex::Lock lock(m_mutex);
+      locked_drain(lock);
+      m_out = out;
+    }
+
+    /// In asynchronous mode, lines are written by a thread of the
+    /// streambuf's own, after the call that finished them returns.
+    void set_asynchronous(bool async) {
+      Mutex::Lock lock(m_mutex);
+      if ( async == m_async )
+        return;
+      if ( async ) {
+        m_stop = false;
+        m_writer.reset( new Thread( Writer(this) ) );
+      } else {
+        m_stop = true;
+        m_queued_event.notify_all();
+        lock.unlock();
+        m_writer->join();
+        lock.lock();
+        m_writer.reset();
+      }
+      m_async = async;
+    }
+
+    /// Waits until every line queued so far has been written.
+    void drain() {
+      Mutex::Lock lock(m_mutex);
+      locked_drain(lock);
+    }
   };
 
   // The order with which the base classes are initialized in
@@ -309,6 +410,14 @@ namespace vw {
       PerThreadBufferedStreamBufInit<CharT,traits>::buf()->init(out.rdbuf());
     }
 
+    void set_asynchronous(bool async) {
+      PerThreadBufferedStreamBufInit<CharT,traits>::buf()->set_asynchronous(async);
+    }
+
+    void drain() {
+      PerThreadBufferedStreamBufInit<CharT,traits>::buf()->drain();
+    }
+
   };
 
   /// \endcond
@@ -327,6 +436,7 @@ namespace vw {
     typedef std::pair<int, std::string> rule_type;
     typedef std::list<rule_type> rules_type;
     rules_type m_rules;
+    int m_max_level;
     Mutex m_mutex;
 
     // Help functions
@@ -350,6 +460,12 @@ namespace vw {
     // You can overload this method from a subclass to change the
     // behavior of the LogRuleSet.
     virtual bool operator() (int log_level, std::string const& log_namespace);
+
+    // The least urgent level operator() passes for any namespace,
+    // which lets the log turn away less urgent messages without
+    // taking the lock or looking at the namespace.  A subclass whose
+    // operator() passes more than the rules do must overload this too.
+    virtual int max_level() const { return m_max_level; }
   };
 
 
@@ -366,13 +482,14 @@ namespace vw {
   public:
 
     // Initialize a log from a filename.  A new internal ofstream is
-    // created to stream log messages to disk.
+    // created to stream log messages to disk.  The log is
+    // asynchronous, see set_asynchronous().
     LogInstance(std::string const& log_filename, bool prepend_infostamp = true);
 
     // Initialize a log using an already open stream.  Warning: The
     // log stores the stream by reference, so you MUST delete the log
     // object _before_ closing and de-allocating the stream.
-    LogInstance(std::ostream& log_ostream, bool prepend_infostamp = true);
+    LogInstance(std::ostream& log_ostream, bool prepend_infostamp = true, bool asynchronous = false);
 
     ~LogInstance() {
       m_log_stream.set_stream(std::cout);
@@ -387,6 +504,14 @@ namespace vw {
 
     /// Access the rule set for this log object.
     LogRuleSet& rule_set() { return m_rule_set; }
+
+    /// An asynchronous log writes each line from a thread of its own
+    /// some time after the line is finished, so logging threads never
+    /// wait on the stream.  Call flush() before reading the stream.
+    void set_asynchronous(bool async) { m_log_stream.set_asynchronous(async); }
+
+    /// Waits until the lines finished so far are written.
+    void flush() { m_log_stream.drain(); }
   };
 
 
@@ -410,20 +535,12 @@ namespace vw {
 
     // Member variables
     Mutex m_system_log_mutex;
-    Mutex m_multi_ostreams_mutex;
 
     // The multi_ostream creates a single stream that delegates to its
     // child streams. We store one multi_ostream per thread, since
     // each thread will have a different set of output streams it is
-    // currently accessing.
-    //
-    // TODO: Rather than manage this as a simple map (which will grow
-    // quite large and hurt performance if there are many threads), we
-    // should really use some sort of cache of shared_ptr's to
-    // ostreams here.  The tricky thing is that once we return the
-    // ostream, we don't know how long the thread will use it before
-    // it can be safely de-allocated.
-    std::map<vw::uint64, boost::shared_ptr<multi_ostream> > m_multi_ostreams;
+    // currently accessing.  A thread's stream goes away with it.
+    boost::thread_specific_ptr<multi_ostream> m_multi_ostreams;
 
   public:
 
@@ -477,11 +594,15 @@ namespace vw {
       m_console_log->rule_set() = rule_set;
     }
 
+    /// Wait until every asynchronous log has written the lines
+    /// finished so far.  This is done at exit.
+    void flush();
+
     /// A mostly non-locking check to determine if this Log object has any
     /// stream that is open for a requested log level and namespace.
     ///
-    /// LogRuleSets still lock on access of their operator().
-    /// We're also using shared_ptr, which lock on access.
+    /// Levels no LogRuleSet passes are turned away without a lock;
+    /// otherwise LogRuleSets still lock on access of their operator().
     bool is_enabled( int log_level = vw::InfoMessage,
                      std::string const& log_namespace="console" );
   };
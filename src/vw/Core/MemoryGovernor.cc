@@ -0,0 +1,127 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Core/MemoryGovernor.h>
+#include <vw/Core/Cache.h>
+#include <vw/Core/Stopwatch.h>
+
+#include <sstream>
+#include <algorithm>
+
+// Called with m_mutex held.
+void vw::MemoryGovernor::update_peaks() {
+  m_stats.peak_transient = std::max( m_stats.peak_transient, m_stats.transient );
+  m_stats.peak_cache = std::max( m_stats.peak_cache, m_stats.cache );
+  m_stats.peak_total = std::max( m_stats.peak_total, m_stats.transient + m_stats.cache );
+}
+
+void vw::MemoryGovernor::set_limit( size_t bytes ) {
+  Mutex::Lock lock(m_mutex);
+  m_stats.limit = bytes;
+  update_enabled();
+  m_release_event.notify_all();
+}
+
+size_t vw::MemoryGovernor::limit() const {
+  Mutex::Lock lock(m_mutex);
+  return m_stats.limit;
+}
+
+void vw::MemoryGovernor::set_tracking( bool tracking ) {
+  Mutex::Lock lock(m_mutex);
+  m_tracking = tracking;
+  update_enabled();
+}
+
+void vw::MemoryGovernor::set_max_wait( uint32 milliseconds ) {
+  Mutex::Lock lock(m_mutex);
+  m_max_wait_ms = milliseconds;
+}
+
+size_t vw::MemoryGovernor::reserve( size_t bytes ) {
+  if( ! m_enabled || bytes == 0 )
+    return 0;
+
+  size_t target;
+  {
+    Mutex::Lock lock(m_mutex);
+    m_stats.transient += bytes;
+    update_peaks();
+    if( m_stats.limit == 0 || m_stats.transient + m_stats.cache <= m_stats.limit )
+      return bytes;
+    target = m_stats.limit > m_stats.transient ? m_stats.limit - m_stats.transient : 0;
+  }
+
+  // The caches call back into the governor, so its lock must not be
+  // held here.
+  vw_system_cache().trim( target );
+
+  Mutex::Lock lock(m_mutex);
+  if( m_stats.limit == 0 || m_stats.transient + m_stats.cache <= m_stats.limit )
+    return bytes;
+
+  if( m_max_wait_ms ) {
+    m_stats.waits++;
+    uint64 deadline = Stopwatch::microtime() + uint64(m_max_wait_ms) * 1000;
+    while( m_stats.limit && m_stats.transient + m_stats.cache > m_stats.limit ) {
+      uint64 now = Stopwatch::microtime();
+      if( now >= deadline )
+        break;
+      m_release_event.timed_wait( lock, (unsigned long)((deadline - now + 999) / 1000) );
+    }
+  }
+  if( m_stats.limit && m_stats.transient + m_stats.cache > m_stats.limit )
+    m_stats.overruns++;
+  return bytes;
+}
+
+void vw::MemoryGovernor::release( size_t bytes ) {
+  if( bytes == 0 )
+    return;
+  Mutex::Lock lock(m_mutex);
+  m_stats.transient -= bytes;
+  m_release_event.notify_all();
+}
+
+void vw::MemoryGovernor::cache_allocated( size_t bytes ) {
+  Mutex::Lock lock(m_mutex);
+  m_stats.cache += bytes;
+  update_peaks();
+}
+
+void vw::MemoryGovernor::cache_deallocated( size_t bytes ) {
+  Mutex::Lock lock(m_mutex);
+  m_stats.cache -= bytes;
+  m_release_event.notify_all();
+}
+
+bool vw::MemoryGovernor::cache_may_grow( size_t bytes ) const {
+  Mutex::Lock lock(m_mutex);
+  return m_stats.limit == 0 || m_stats.transient + m_stats.cache + bytes <= m_stats.limit;
+}
+
+vw::MemoryStats vw::MemoryGovernor::stats() const {
+  Mutex::Lock lock(m_mutex);
+  return m_stats;
+}
+
+void vw::MemoryGovernor::reset_peaks() {
+  Mutex::Lock lock(m_mutex);
+  m_stats.peak_transient = m_stats.transient;
+  m_stats.peak_cache = m_stats.cache;
+  m_stats.peak_total = m_stats.transient + m_stats.cache;
+}
+
+std::string vw::MemoryGovernor::report() const {
+  MemoryStats s = stats();
+  std::ostringstream out;
+  out << "Memory: " << s.transient << " bytes transient (peak " << s.peak_transient << "), "
+      << s.cache << " bytes cached (peak " << s.peak_cache << "), peak total " << s.peak_total;
+  if( s.limit )
+    out << " of " << s.limit << " allowed, " << s.waits << " waits, " << s.overruns << " overruns";
+  return out.str();
+}
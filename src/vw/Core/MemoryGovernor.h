@@ -0,0 +1,115 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Core/MemoryGovernor.h
+///
+/// A process-wide accounting of the memory held by caches and by
+/// transient image buffers, with an optional overall limit.
+///
+/// Every vw::Cache reports the bytes it allocates and frees.  When the
+/// governor is enabled, every ImageView buffer is also reserved before
+/// it is allocated and released when it is freed.  With a limit set
+/// (vw_settings().memory_limit(), in bytes), the governor enforces it
+/// in two ways:
+///
+///  - A cache that would push the total over the limit evicts lines
+///    instead of growing, even if it is under its own maximum size.
+///  - A transient reservation that pushes the total over the limit
+///    first trims the system cache.  If that is not enough and a
+///    maximum wait is set (see set_max_wait()), the reserving thread
+///    then blocks until other buffers are released or the wait times
+///    out.  The reservation always succeeds in the end, so a single
+///    buffer larger than the limit cannot deadlock the program.
+///
+/// The governor keeps the high-water marks of the transient, cache and
+/// total footprints, see stats() and report().
+///
+#ifndef __VW_CORE_MEMORYGOVERNOR_H__
+#define __VW_CORE_MEMORYGOVERNOR_H__
+
+#include <string>
+
+#include <boost/noncopyable.hpp>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/System.h>
+#include <vw/Core/Thread.h>
+
+namespace vw {
+
+  /// A snapshot of the state of a MemoryGovernor, in bytes.
+  struct MemoryStats {
+    size_t limit;     // 0 if there is no limit
+    size_t transient, cache;
+    size_t peak_transient, peak_cache, peak_total;
+    uint64 waits;     // Reservations that had to wait for memory
+    uint64 overruns;  // Reservations granted over the limit
+    MemoryStats() : limit(0), transient(0), cache(0), peak_transient(0),
+                    peak_cache(0), peak_total(0), waits(0), overruns(0) {}
+  };
+
+  /// Tracks the memory footprint of caches and image buffers.  You
+  /// should normally use the global instance returned by
+  /// vw_memory_governor().
+  class MemoryGovernor : private boost::noncopyable {
+    mutable Mutex m_mutex;
+    Condition m_release_event;
+    MemoryStats m_stats;
+    uint32 m_max_wait_ms;
+    bool m_tracking;
+    bool m_enabled;
+
+    void update_peaks();
+    void update_enabled() { m_enabled = m_tracking || m_stats.limit != 0; }
+
+  public:
+    MemoryGovernor() : m_max_wait_ms(0), m_tracking(false), m_enabled(false) {}
+
+    /// True if transient buffers are being accounted for.  This is
+    /// read without a lock, so changes take effect shortly, not
+    /// instantly.
+    bool enabled() const { return m_enabled; }
+
+    /// Sets the overall limit in bytes.  0 means no limit.
+    void set_limit( size_t bytes );
+    size_t limit() const;
+
+    /// Account for transient buffers even without a limit, so that
+    /// their high-water mark is known.
+    void set_tracking( bool tracking );
+
+    /// How long a reservation may block waiting for memory once the
+    /// system cache cannot shrink any further.  The default of 0
+    /// never blocks.
+    void set_max_wait( uint32 milliseconds );
+
+    /// Reserve memory for a transient buffer.  Returns the number of
+    /// bytes accounted for, which must be handed back to release(), or
+    /// 0 if the governor is disabled.
+    size_t reserve( size_t bytes );
+    void release( size_t bytes );
+
+    /// Called by vw::Cache as it allocates and frees cache lines.
+    void cache_allocated( size_t bytes );
+    void cache_deallocated( size_t bytes );
+
+    /// Whether a cache may grow by the given number of bytes without
+    /// going over the limit.
+    bool cache_may_grow( size_t bytes ) const;
+
+    MemoryStats stats() const;
+
+    /// Resets the high-water marks to the current footprint.
+    void reset_peaks();
+
+    /// A one-line summary of stats().
+    std::string report() const;
+  };
+
+} // namespace vw
+
+#endif // __VW_CORE_MEMORYGOVERNOR_H__
@@ -0,0 +1,128 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Core/Numa.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/Log.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <boost/thread/tss.hpp>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+  // The CPUs of each node, indexed by node number.
+  std::vector<std::vector<int> > *numa_node_cpus = 0;
+  vw::RunOnce numa_once = VW_RUNONCE_INIT;
+
+  // Parses a list like "0-3,8,10-11", as the kernel writes them.
+  std::vector<int> parse_list( std::string const& text ) {
+    std::vector<int> result;
+    std::istringstream stream( text );
+    std::string range;
+    while( std::getline( stream, range, ',' ) ) {
+      int first, last;
+      char dash;
+      std::istringstream r( range );
+      if( !(r >> first) )
+        continue;
+      if( !(r >> dash >> last) || dash != '-' )
+        last = first;
+      for( int i = first; i <= last; ++i )
+        result.push_back( i );
+    }
+    return result;
+  }
+
+  std::string read_line( std::string const& filename ) {
+    std::ifstream file( filename.c_str() );
+    std::string line;
+    std::getline( file, line );
+    return line;
+  }
+
+  void init_numa() {
+    numa_node_cpus = new std::vector<std::vector<int> >();
+#if defined(__linux__)
+    std::vector<int> nodes = parse_list( read_line( "/sys/devices/system/node/online" ) );
+    for( size_t i = 0; i < nodes.size(); ++i ) {
+      std::ostringstream filename;
+      filename << "/sys/devices/system/node/node" << nodes[i] << "/cpulist";
+      if( int(numa_node_cpus->size()) <= nodes[i] )
+        numa_node_cpus->resize( nodes[i] + 1 );
+      (*numa_node_cpus)[nodes[i]] = parse_list( read_line( filename.str() ) );
+    }
+#endif
+    if( numa_node_cpus->empty() )
+      numa_node_cpus->resize( 1 );
+  }
+
+  // Construct-on-first-use, for the same reason as in Thread.cc.
+  typedef boost::thread_specific_ptr<int> node_ptr_t;
+  node_ptr_t& thread_node_ptr() {
+    static node_ptr_t* ptr = new node_ptr_t();
+    return *ptr;
+  }
+}
+
+int vw::vw_numa_num_nodes() {
+  numa_once.run( init_numa );
+  return int(numa_node_cpus->size());
+}
+
+std::vector<int> const& vw::vw_numa_node_cpus( int node ) {
+  numa_once.run( init_numa );
+  VW_ASSERT( node >= 0 && node < int(numa_node_cpus->size()),
+             ArgumentErr() << "There is no NUMA node " << node << "." );
+  return (*numa_node_cpus)[node];
+}
+
+bool vw::vw_numa_bind_thread( int node ) {
+  std::vector<int> const& cpus = vw_numa_node_cpus( node );
+  if( cpus.empty() )
+    return false;
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  for( size_t i = 0; i < cpus.size(); ++i )
+    if( cpus[i] < CPU_SETSIZE )
+      CPU_SET( cpus[i], &set );
+  if( pthread_setaffinity_np( pthread_self(), sizeof(set), &set ) != 0 ) {
+    VW_OUT(DebugMessage, "thread") << "Could not bind thread to NUMA node " << node << "\n";
+    return false;
+  }
+  thread_node_ptr().reset( new int(node) );
+  return true;
+#else
+  return false;
+#endif
+}
+
+int vw::vw_numa_thread_node() {
+  int* node = thread_node_ptr().get();
+  return node ? *node : -1;
+}
+
+void vw::vw_numa_first_touch( void* ptr, size_t bytes ) {
+#if defined(__linux__)
+  static const size_t page = size_t( sysconf( _SC_PAGESIZE ) );
+#else
+  static const size_t page = 4096;
+#endif
+  volatile char* p = static_cast<volatile char*>( ptr );
+  for( size_t i = 0; i < bytes; i += page )
+    p[i] = 0;
+}
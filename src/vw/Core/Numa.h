@@ -0,0 +1,50 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Core/Numa.h
+///
+/// Finding the NUMA nodes (sockets) of the machine, and keeping a
+/// thread and the memory it allocates on one of them.
+///
+/// Memory is placed on the node of the thread that first writes each
+/// page, so a buffer that is allocated and filled by a thread bound to
+/// a node stays local to it.  The thread pool binds its workers when
+/// vw_settings().numa_aware() is set, and the buffer pool then hands
+/// each of them buffers from its own node.
+///
+/// The topology is read from /sys on Linux.  Elsewhere the machine is
+/// taken to have one node, and binding does nothing.
+///
+#ifndef __VW_CORE_NUMA_H__
+#define __VW_CORE_NUMA_H__
+
+#include <vector>
+#include <cstddef>
+
+namespace vw {
+
+  /// The number of NUMA nodes of this machine, at least 1.
+  int vw_numa_num_nodes();
+
+  /// The CPUs of a NUMA node.  Empty if they are not known.
+  std::vector<int> const& vw_numa_node_cpus( int node );
+
+  /// Binds the calling thread to the CPUs of a NUMA node.  Returns
+  /// false, leaving the thread unbound, if that is not possible here.
+  bool vw_numa_bind_thread( int node );
+
+  /// The NUMA node the calling thread was bound to, or -1.
+  int vw_numa_thread_node();
+
+  /// Writes to every page of a newly allocated buffer, so that its
+  /// memory is placed on the calling thread's node now, before another
+  /// thread can touch it first.
+  void vw_numa_first_touch( void* ptr, size_t bytes );
+
+} // namespace vw
+
+#endif // __VW_CORE_NUMA_H__
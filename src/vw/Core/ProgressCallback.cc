@@ -7,6 +7,7 @@
 
 #include <iomanip>
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Stopwatch.h>
 
 namespace {
   vw::NullProgressCallback g_dummy_progress_callback_instance;
@@ -16,6 +17,80 @@ const vw::ProgressCallback &vw::ProgressCallback::dummy_instance() {
   return g_dummy_progress_callback_instance;
 }
 
+// ---------------------------------------------------
+// AtomicProgressCallback
+// ---------------------------------------------------
+
+// Progress is counted in 2^-40ths: fine enough that rounding each of
+// millions of ticks adds up to well under a millionth, and coarse
+// enough to count to millions.
+vw::int64 vw::AtomicProgressCallback::to_ticks( double progress ) {
+  return static_cast<int64>( floor( progress * double(int64(1) << 40) + 0.5 ) );
+}
+
+vw::AtomicProgressCallback::AtomicProgressCallback( const ProgressCallback &parent, double min_step,
+                                                    uint32 min_interval_ms )
+  : m_parent(parent), m_min_step(to_ticks(min_step)), m_min_interval(uint64(min_interval_ms)*1000),
+    m_ticks(to_ticks(parent.progress())), m_reported_ticks(m_ticks), m_reported_time(0),
+    m_abort(parent.abort_requested()) {}
+
+void vw::AtomicProgressCallback::report_to_parent( int64 ticks, bool force ) const {
+  if ( !force ) {
+    int64 moved = ticks - m_reported_ticks;
+    if ( moved < m_min_step && -moved < m_min_step )
+      return;
+    if ( Stopwatch::microtime() - m_reported_time < m_min_interval )
+      return;
+    // Someone else is passing it on already.
+    if ( !m_mutex.try_lock() )
+      return;
+  } else {
+    m_mutex.lock();
+  }
+  try {
+    ticks = m_ticks;
+    m_parent.report_progress( double(ticks) / double(int64(1) << 40) );
+    m_reported_ticks = ticks;
+    m_reported_time = Stopwatch::microtime();
+    if ( m_parent.abort_requested() )
+      m_abort = true;
+  } catch (...) {
+    m_mutex.unlock();
+    throw;
+  }
+  m_mutex.unlock();
+}
+
+void vw::AtomicProgressCallback::report_progress(double progress) const {
+  int64 ticks = to_ticks(progress);
+  __sync_lock_test_and_set( &m_ticks, ticks );
+  report_to_parent( ticks, false );
+}
+
+void vw::AtomicProgressCallback::report_incremental_progress(double incremental_progress) const {
+  report_to_parent( __sync_add_and_fetch( &m_ticks, to_ticks(incremental_progress) ), false );
+}
+
+void vw::AtomicProgressCallback::report_aborted(std::string why) const {
+  m_parent.report_aborted(why);
+}
+
+void vw::AtomicProgressCallback::report_finished() const {
+  __sync_lock_test_and_set( &m_ticks, to_ticks(1.0) );
+  Mutex::Lock lock(m_mutex);
+  m_reported_ticks = m_ticks;
+  m_parent.report_finished();
+}
+
+void vw::AtomicProgressCallback::request_abort() const {
+  m_abort = true;
+  m_parent.request_abort();
+}
+
+double vw::AtomicProgressCallback::progress() const {
+  return double(m_ticks) / double(int64(1) << 40);
+}
+
 // Deprecrated Progress Bar
 vw::TerminalProgressCallback::TerminalProgressCallback( MessageLevel level, std::string pre_progress_text, uint32_t precision) : m_level(level), m_namespace(".progress"), m_pre_progress_text(pre_progress_text), m_last_reported_progress(-1), m_precision(precision), m_step(std::pow(10., -(int32_t(precision)+2))) {
   boost::replace_all(m_pre_progress_text,"\t","        ");
@@ -19,6 +19,7 @@
 #include <vw/Core/Exception.h>
 #include <vw/Core/Thread.h>
 #include <vw/Core/Features.h>
+#include <vw/Core/FundamentalTypes.h>
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -131,6 +132,53 @@ namespace vw {
   };
 
 
+  /// Collects the progress of a job reported from many threads at
+  /// once, such as one tick per block of a large write, without the
+  /// threads contending for a lock.  Progress is kept in an atomic
+  /// fixed-point counter, and is passed on to the parent (say, a
+  /// TerminalProgressCallback) only once it has moved by min_step and
+  /// min_interval_ms have passed since it last was, by whichever
+  /// thread gets there first; the others go on without waiting.
+  /// Finishing and aborting are passed on right away.
+  class AtomicProgressCallback : public ProgressCallback {
+    const ProgressCallback &m_parent;
+    const int64 m_min_step;
+    const uint64 m_min_interval;
+    mutable volatile int64 m_ticks;
+    mutable volatile int64 m_reported_ticks;
+    mutable volatile uint64 m_reported_time;
+    mutable volatile bool m_abort;
+
+    static int64 to_ticks( double progress );
+
+    // Passes the progress on to the parent if it is due, or always if
+    // force is set.
+    void report_to_parent( int64 ticks, bool force ) const;
+
+  public:
+    AtomicProgressCallback( const ProgressCallback &parent, double min_step = 0.001,
+                            uint32 min_interval_ms = 100 );
+    virtual ~AtomicProgressCallback() {}
+
+    virtual void report_progress(double progress) const;
+    virtual void report_incremental_progress(double incremental_progress) const;
+    virtual void report_aborted(std::string why="") const;
+    virtual void report_finished() const;
+
+    // The abort flag is polled from the parent whenever progress is
+    // passed on, so checking it takes no lock either.
+    virtual bool abort_requested() const { return m_abort; }
+    virtual void request_abort() const;
+
+    virtual double progress() const;
+
+    /// Passes the current progress on to the parent now.
+    void flush() const { report_to_parent( m_ticks, true ); }
+
+    const ProgressCallback& parent() const { return m_parent; }
+  };
+
+
   /// A progress monitor that prints a progress bar on STDOUT.
   class TerminalProgressCallback : public ProgressCallback {
     MessageLevel m_level;
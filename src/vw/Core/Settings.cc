@@ -12,6 +12,9 @@
 #include <vw/Core/Cache.h>
 #include <vw/Core/Settings.h>
 #include <vw/Core/ConfigParser.h>
+#include <vw/Core/Trace.h>
+#include <vw/Core/MemoryGovernor.h>
+#include <vw/Core/BufferPool.h>
 
 // Boost headers
 #include <boost/bind.hpp>
@@ -88,6 +91,7 @@ void Settings::reload_config() {
       m_rc_last_modification = mtime;
 
       // if it throws, let it bubble up.
+      ScopedStartupTrace trace("Settings::parse_config_file");
       parse_config_file(m_rc_filename.c_str(), *this);
     }
   }
@@ -123,6 +127,11 @@ void Settings::set_rc_filename(std::string filename, bool parse_now) {
     reload_config();
 }
 
+std::string Settings::rc_filename() {
+  RecursiveMutex::Lock file_lock(m_rc_file_mutex);
+  return m_rc_filename;
+}
+
 void Settings::set_rc_poll_period(float period) {
 
   // limit the scope of the lock
@@ -169,9 +178,22 @@ namespace {
 Settings::Settings()
   : _VW_SET1(default_num_threads, VW_NUM_THREADS),
     _VW_SET1(system_cache_size, size_t(VW_CACHE_SIZE) * 1024 * 1024),
+    _VW_SET1(system_cache_shards, 1),
+    _VW_SET1(system_cache_policy, "lru"),
+    _VW_SET1(system_cache_log_period, 0),
+    _VW_SET1(system_cache_spill_size, 0),
+    _VW_SET1(memory_limit, 0),
+    _VW_SET1(buffer_pool_size, size_t(64) * 1024 * 1024),
     _VW_SET1(write_pool_size, 21), // 21 threads is about 252MB of back data for RGB f32 1024x1024 blocks
+    _VW_SET1(write_pool_memory, size_t(256) * 1024 * 1024),
+    _VW_SET1(numa_aware, false),
     _VW_SET1(default_tile_size, 256),
+    _VW_SET1(concurrent_file_reads, false),
+    _VW_SET1(io_queue_depth, 4),
+    _VW_SET1(hdf_chunk_cache_size, 0),
     _VW_SET1(tmp_directory, default_tmp_dir()),
+    _VW_SET1(trace_file, ""),
+    _VW_SET1(trace_summary, false),
     m_rc_poll_period(5.0f)
 {
   set_rc_filename(default_vwrc(), false);
@@ -193,8 +215,21 @@ Settings::Settings()
 
 GETSET(default_num_threads, uint32, ;);
 GETSET(system_cache_size, size_t, vw_system_cache().resize(x););
+GETSET(system_cache_shards, uint32, ;);
+GETSET(system_cache_policy, std::string, ;);
+GETSET(system_cache_log_period, uint32, vw_system_cache().set_stats_log_period(x););
+GETSET(system_cache_spill_size, size_t, vw_system_cache().set_spill(tmp_directory(), x););
+GETSET(memory_limit, size_t, vw_memory_governor().set_limit(x););
+GETSET(buffer_pool_size, size_t, vw_buffer_pool().set_max_cached(x););
 GETSET(write_pool_size, uint32, ;);
+GETSET(write_pool_memory, size_t, ;);
+GETSET(numa_aware, bool, ;);
 GETSET(default_tile_size, uint32, ;);
+GETSET(concurrent_file_reads, bool, ;);
+GETSET(io_queue_depth, uint32, ;);
+GETSET(hdf_chunk_cache_size, uint32, ;);
 GETSET(tmp_directory, std::string, ;);
+GETSET(trace_file, std::string, vw_tracer().set_output_file(x););
+GETSET(trace_summary, bool, vw_tracer().set_summary(x););
 
 } // namespace vw
@@ -53,17 +53,81 @@ namespace vw {
     // all BlockRasterizeView<>'s, including DiskImageView<>'s.
     VW_DECLARE_SETTING(system_cache_size, size_t);
 
+    // The number of independent LRU lists (each with its own lock) the
+    // system cache is split into. More shards reduce lock contention
+    // between threads at the cost of only approximate LRU ordering. This
+    // takes effect when the system cache is first used.
+    VW_DECLARE_SETTING(system_cache_shards, uint32);
+
+    // The eviction policy of the system cache: "lru" (least recently
+    // used) or "gdsf" (keeps lines that were expensive to generate
+    // longer). This takes effect when the system cache is first used.
+    VW_DECLARE_SETTING(system_cache_policy, std::string);
+
+    // If nonzero, the system cache statistics are written to the
+    // "cache" log namespace at most once every this many seconds.
+    VW_DECLARE_SETTING(system_cache_log_period, uint32);
+
+    // The limit (in bytes) on the lines the system cache may spill to
+    // files in tmp_directory when it evicts them, to be read back
+    // instead of regenerated. 0 turns spilling off.
+    VW_DECLARE_SETTING(system_cache_spill_size, size_t);
+
+    // The limit (in bytes) on the memory held by caches and image
+    // buffers together, enforced by vw_memory_governor(). 0 means no limit.
+    VW_DECLARE_SETTING(memory_limit, size_t);
+
+    // The bytes of freed image buffers each thread may keep for reuse,
+    // see vw_buffer_pool(). 0 turns buffer pooling off.
+    VW_DECLARE_SETTING(buffer_pool_size, size_t);
+
     // Write cache is only used in block writing. This is the number of threads
     // that can be blocked on IO before the code stops creating more jobs (to
     // let the writes catch up).
     VW_DECLARE_SETTING(write_pool_size, uint32);
 
-    // The default tile size (in pixels) used for block processing ops.
+    // The limit (in bytes) on the memory held by the blocks waiting
+    // to be written during block writing, which holds back rasterizing
+    // as write_pool_size does. 0 means no limit.
+    VW_DECLARE_SETTING(write_pool_memory, size_t);
+
+    // If true, the workers of vw_thread_pool() are bound to the NUMA
+    // nodes of the machine, and image buffers are kept on the node of
+    // the worker that allocates them. This takes effect when the
+    // thread pool is first used.
+    VW_DECLARE_SETTING(numa_aware, bool);
+
+    // The default tile size (in pixels) used for block processing ops. This
+    // is also the access size BlockRasterizeView shapes its default blocks for.
     VW_DECLARE_SETTING(default_tile_size, uint32);
 
+    // If true, disk image resources that support it read blocks from
+    // several threads at once, each through a read-only file handle of
+    // its own, instead of one block at a time.
+    VW_DECLARE_SETTING(concurrent_file_reads, bool);
+
+    // The number of blocks of a file that may be read in the
+    // background at once, ahead of the blocks being processed. This
+    // is also the number of threads in vw_io_thread_pool(), which is
+    // set when that pool is first used. 0 turns reading ahead off.
+    VW_DECLARE_SETTING(io_queue_depth, uint32);
+
+    // The number of chunks of each chunked HDF dataset that are kept
+    // decoded in memory while it is read. 0 keeps a row of chunks
+    // across the dataset, which is what reads in raster order need.
+    VW_DECLARE_SETTING(hdf_chunk_cache_size, uint32);
+
     // The directory used to store temporary files.
     VW_DECLARE_SETTING(tmp_directory, std::string);
 
+    // If set, per-block trace events are recorded (see Core/Trace.h)
+    // and written to this file as Chrome trace JSON at exit.
+    VW_DECLARE_SETTING(trace_file, std::string);
+
+    // If true, per-block trace events are recorded and a summary
+    // table is logged at exit.
+    VW_DECLARE_SETTING(trace_summary, bool);
+
 #undef VW_DECLARE_SETTING
 
     // Member variables assoc. with periodically polling the log
@@ -87,6 +151,9 @@ namespace vw {
     /// Change the rc filename (default: ~/.vwrc)
     void set_rc_filename(std::string filename, bool parse_now = true);
 
+    /// The rc filename, or an empty string if there is none.
+    std::string rc_filename();
+
     /// Change the rc file poll period.  (default: 5 seconds)
     /// Note -- this sets the *minimum* poll time for the file.  The
     /// actual file is only polled when a setting is requested.
@@ -6,10 +6,15 @@
 
 
 #include <vw/Core/System.h>
+#include <vw/Core/BufferPool.h>
 #include <vw/Core/Cache.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/MemoryGovernor.h>
 #include <vw/Core/Settings.h>
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/Trace.h>
+
+#include <cstdlib>
 
 namespace {
   vw::RunOnce settings_once      = VW_RUNONCE_INIT;
@@ -17,17 +22,31 @@ namespace {
   vw::RunOnce stopwatch_set_once = VW_RUNONCE_INIT;
   vw::RunOnce system_cache_once  = VW_RUNONCE_INIT;
   vw::RunOnce log_once           = VW_RUNONCE_INIT;
+  vw::RunOnce tracer_once        = VW_RUNONCE_INIT;
+  vw::RunOnce governor_once      = VW_RUNONCE_INIT;
+  vw::RunOnce buffer_pool_once   = VW_RUNONCE_INIT;
 
   vw::Settings     *settings_ptr      = 0;
   vw::StopwatchSet *stopwatch_set_ptr = 0;
   vw::Cache        *system_cache_ptr  = 0;
   vw::Log          *log_ptr           = 0;
+  vw::Tracer       *tracer_ptr        = 0;
+  vw::MemoryGovernor *governor_ptr    = 0;
+  vw::BufferPool   *buffer_pool_ptr   = 0;
 
   void init_settings() {
+    vw::ScopedStartupTrace trace("vw_settings");
     settings_ptr = new vw::Settings();
   }
 
   void resize_cache() {
+    vw::uint32 shards = settings_ptr->system_cache_shards();
+    if (shards > 0 && system_cache_ptr->num_shards() != shards)
+      system_cache_ptr->set_num_shards(shards);
+    if (settings_ptr->system_cache_policy() == "gdsf")
+      system_cache_ptr->set_eviction_policy(vw::Cache::GDSF_EVICTION);
+    system_cache_ptr->set_stats_log_period(settings_ptr->system_cache_log_period());
+    system_cache_ptr->set_spill(settings_ptr->tmp_directory(), settings_ptr->system_cache_spill_size());
     if (system_cache_ptr->max_size() == 0)
       system_cache_ptr->resize(settings_ptr->system_cache_size());
   }
@@ -40,8 +59,31 @@ namespace {
     stopwatch_set_ptr = new vw::StopwatchSet();
   }
 
+  void flush_log() {
+    log_ptr->flush();
+  }
+
   void init_log() {
+    vw::ScopedStartupTrace trace("vw_log");
     log_ptr = new vw::Log();
+    std::atexit( flush_log );
+  }
+
+  void init_governor() {
+    governor_ptr = new vw::MemoryGovernor();
+  }
+
+  void init_buffer_pool() {
+    buffer_pool_ptr = new vw::BufferPool();
+  }
+
+  void flush_tracer() {
+    tracer_ptr->flush();
+  }
+
+  void init_tracer() {
+    tracer_ptr = new vw::Tracer();
+    std::atexit( flush_tracer );
   }
 }
 
@@ -68,3 +110,18 @@ vw::Log &vw::vw_log() {
   log_once.run( init_log );
   return *log_ptr;
 }
+
+vw::Tracer &vw::vw_tracer() {
+  tracer_once.run( init_tracer );
+  return *tracer_ptr;
+}
+
+vw::MemoryGovernor &vw::vw_memory_governor() {
+  governor_once.run( init_governor );
+  return *governor_ptr;
+}
+
+vw::BufferPool &vw::vw_buffer_pool() {
+  buffer_pool_once.run( init_buffer_pool );
+  return *buffer_pool_ptr;
+}
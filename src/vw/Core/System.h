@@ -13,10 +13,13 @@
 
 namespace vw {
 
+  class BufferPool;
   class Cache;
   class Log;
+  class MemoryGovernor;
   class Settings;
   class StopwatchSet;
+  class Tracer;
 
   // This cache is used by default for all new BlockImageView<>'s such as
   // DiskImageView<>.
@@ -32,6 +35,17 @@ namespace vw {
 
   // Global instance of StopwatchSet
   StopwatchSet& vw_stopwatch_set();
+
+  // Global instance of MemoryGovernor, which accounts for the memory held
+  // by caches and image buffers
+  MemoryGovernor& vw_memory_governor();
+
+  // Global instance of BufferPool, which ImageView allocates its pixel
+  // buffers from
+  BufferPool& vw_buffer_pool();
+
+  // Global instance of Tracer, which records the per-block trace events
+  Tracer& vw_tracer();
 }
 
 #endif
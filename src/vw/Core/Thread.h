@@ -88,6 +88,7 @@ namespace vw {
     inline Mutex() {}
 
     void lock()          { boost::shared_mutex::lock(); }
+    bool try_lock()      { return boost::shared_mutex::try_lock(); }
     void lock_shared()   { boost::shared_mutex::lock_shared(); }
     void unlock()        { boost::shared_mutex::unlock(); }
     void unlock_shared() { boost::shared_mutex::unlock_shared(); }
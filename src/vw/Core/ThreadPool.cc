@@ -0,0 +1,228 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Core/ThreadPool.h>
+#include <vw/Core/Numa.h>
+
+#include <algorithm>
+
+namespace vw {
+namespace thread {
+
+  // Identifies the WorkStealingQueue worker (if any) that the current
+  // thread belongs to.
+  struct PoolWorkerId {
+    const WorkStealingQueue *queue;
+    size_t index;
+    PoolWorkerId(const WorkStealingQueue *q, size_t i) : queue(q), index(i) {}
+  };
+
+  // Construct-on-first-use, for the same reason as in Thread.cc.
+  typedef boost::thread_specific_ptr<PoolWorkerId> worker_ptr_t;
+  static worker_ptr_t& vw_pool_worker_ptr() {
+    static worker_ptr_t* ptr = new worker_ptr_t();
+    return *ptr;
+  }
+
+}} // namespace vw::thread
+
+vw::WorkStealingQueue::WorkStealingQueue(int num_threads, bool numa_aware)
+  : WorkQueue(num_threads), m_queued(0), m_pending(0), m_running(0),
+    m_next_worker(0), m_stopping(false) {
+  VW_ASSERT( num_threads > 0, ArgumentErr() << "WorkStealingQueue needs at least one thread." );
+
+  // On a machine with one node there is nothing to gain by binding.
+  int nodes = numa_aware ? vw_numa_num_nodes() : 1;
+  for (int i = 0; i < num_threads; ++i) {
+    boost::shared_ptr<Worker> w(new Worker());
+    w->m_node = nodes > 1 ? int(int64(i) * nodes / num_threads) : -1;
+    m_workers.push_back(w);
+  }
+
+  // Each worker steals from the next workers around the ring, those on
+  // its own node first.
+  for (int i = 0; i < num_threads; ++i) {
+    Worker& w = *m_workers[i];
+    for (int pass = 0; pass < 2; ++pass)
+      for (int j = 1; j < num_threads; ++j) {
+        size_t victim = (i + j) % num_threads;
+        if ((m_workers[victim]->m_node == w.m_node) == (pass == 0))
+          w.m_victims.push_back(victim);
+      }
+  }
+
+  for (int i = 0; i < num_threads; ++i)
+    m_threads.push_back(boost::shared_ptr<Thread>(new Thread(WorkerLoop(*this, i))));
+}
+
+vw::WorkStealingQueue::~WorkStealingQueue() {
+  join_all();
+  {
+    Mutex::Lock lock(m_state_mutex);
+    m_stopping = true;
+    m_work_event.notify_all();
+  }
+  for (size_t i = 0; i < m_threads.size(); ++i)
+    m_threads[i]->join();
+}
+
+int vw::WorkStealingQueue::current_worker() const {
+  thread::PoolWorkerId *id = thread::vw_pool_worker_ptr().get();
+  if (id && id->queue == this)
+    return int(id->index);
+  return -1;
+}
+
+size_t vw::WorkStealingQueue::size() {
+  Mutex::Lock lock(m_state_mutex);
+  return m_queued;
+}
+
+void vw::WorkStealingQueue::add_task(boost::shared_ptr<Task> task) {
+  int self = current_worker();
+  if (self >= 0) {
+    Worker& w = *m_workers[self];
+    Mutex::Lock lock(w.m_mutex);
+    w.m_tasks.push_front(task);
+  }
+
+  Mutex::Lock lock(m_state_mutex);
+  if (self < 0) {
+    Worker& w = *m_workers[m_next_worker];
+    m_next_worker = (m_next_worker + 1) % m_workers.size();
+    Mutex::Lock worker_lock(w.m_mutex);
+    w.m_tasks.push_back(task);
+  }
+  m_queued++;
+  m_pending++;
+  m_work_event.notify_one();
+}
+
+boost::shared_ptr<vw::Task> vw::WorkStealingQueue::take_task(size_t worker) {
+  boost::shared_ptr<Task> task;
+  {
+    Worker& w = *m_workers[worker];
+    Mutex::Lock lock(w.m_mutex);
+    if (!w.m_tasks.empty()) {
+      task = w.m_tasks.front();
+      w.m_tasks.pop_front();
+    }
+  }
+  std::vector<size_t> const& victims = m_workers[worker]->m_victims;
+  for (size_t i = 0; !task && i < victims.size(); ++i) {
+    Worker& victim = *m_workers[victims[i]];
+    Mutex::Lock lock(victim.m_mutex);
+    if (!victim.m_tasks.empty()) {
+      task = victim.m_tasks.back();
+      victim.m_tasks.pop_back();
+    }
+  }
+  if (task) {
+    Mutex::Lock lock(m_state_mutex);
+    m_queued--;
+  }
+  return task;
+}
+
+void vw::WorkStealingQueue::run_task(boost::shared_ptr<Task> const& task) {
+  {
+    Mutex::Lock lock(m_state_mutex);
+    m_running++;
+  }
+  (*task)();
+  task->signal_finished();
+
+  Mutex::Lock lock(m_state_mutex);
+  m_running--;
+  if (--m_pending == 0)
+    m_idle_event.notify_all();
+}
+
+void vw::WorkStealingQueue::worker_loop(size_t worker) {
+  thread::vw_pool_worker_ptr().reset(new thread::PoolWorkerId(this, worker));
+  VW_OUT(DebugMessage, "thread") << "WorkStealingQueue: starting worker thread " << worker << "\n";
+  if (m_workers[worker]->m_node >= 0)
+    vw_numa_bind_thread(m_workers[worker]->m_node);
+
+  while (true) {
+    boost::shared_ptr<Task> task = take_task(worker);
+    if (task) {
+      run_task(task);
+      continue;
+    }
+
+    Mutex::Lock lock(m_state_mutex);
+    if (m_stopping)
+      break;
+    // A task counted in m_queued may still be on its way into a
+    // deque, so only sleep when there is really nothing to take.
+    if (m_queued == 0)
+      m_work_event.wait(lock);
+  }
+  VW_OUT(DebugMessage, "thread") << "WorkStealingQueue: terminating worker thread " << worker << "\n";
+}
+
+void vw::WorkStealingQueue::wait(boost::shared_ptr<Task> const& task) {
+  int self = current_worker();
+  if (self < 0) {
+    task->join();
+    return;
+  }
+  while (!task->is_finished()) {
+    boost::shared_ptr<Task> other = take_task(self);
+    if (other)
+      run_task(other);
+    else
+      task->timed_join(1);
+  }
+}
+
+boost::shared_ptr<vw::Task> vw::WorkStealingQueue::get_next_task() {
+  return take_task(0);
+}
+
+int vw::WorkStealingQueue::active_threads() {
+  Mutex::Lock lock(m_state_mutex);
+  return int(m_running);
+}
+
+void vw::WorkStealingQueue::join_all() {
+  VW_ASSERT( current_worker() < 0,
+             LogicErr() << "WorkStealingQueue::join_all() called from one of its own tasks." );
+  Mutex::Lock lock(m_state_mutex);
+  while (m_pending != 0)
+    m_idle_event.wait(lock);
+}
+
+namespace {
+  vw::RunOnce thread_pool_once = VW_RUNONCE_INIT;
+  vw::WorkStealingQueue *thread_pool_ptr = 0;
+
+  void init_thread_pool() {
+    thread_pool_ptr = new vw::WorkStealingQueue(vw::vw_settings().default_num_threads(),
+                                                vw::vw_settings().numa_aware());
+  }
+}
+
+vw::WorkStealingQueue& vw::vw_thread_pool() {
+  thread_pool_once.run( init_thread_pool );
+  return *thread_pool_ptr;
+}
+
+namespace {
+  vw::RunOnce io_thread_pool_once = VW_RUNONCE_INIT;
+  vw::FifoWorkQueue *io_thread_pool_ptr = 0;
+
+  void init_io_thread_pool() {
+    io_thread_pool_ptr = new vw::FifoWorkQueue(std::max(1, int(vw::vw_settings().io_queue_depth())));
+  }
+}
+
+vw::FifoWorkQueue& vw::vw_io_thread_pool() {
+  io_thread_pool_once.run( init_io_thread_pool );
+  return *io_thread_pool_ptr;
+}
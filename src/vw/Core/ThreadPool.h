@@ -15,6 +15,7 @@
 
 #include <vector>
 #include <list>
+#include <deque>
 
 #include <vw/Core/Settings.h>
 #include <vw/Core/Thread.h>
@@ -51,6 +52,14 @@ namespace vw {
         m_finished_event.wait(lock);
       }
     }
+    // Wait at most the given time for the task to finish. Returns
+    // true if it did.
+    bool timed_join(unsigned long milliseconds) {
+      Mutex::Lock lock(m_task_mutex);
+      if (!m_finished)
+        m_finished_event.timed_wait(lock, milliseconds);
+      return m_finished;
+    }
     void signal_finished() {
       Mutex::Lock lock(m_task_mutex);
       m_finished = true;
@@ -183,13 +192,13 @@ namespace vw {
 
     /// Return the max number threads that can run concurrently at any
     /// given time using this threadpool.
-    int active_threads() {
+    virtual int active_threads() {
       Mutex::Lock lock(m_queue_mutex);
       return m_active_workers;
     }
 
     // Join all currently running threads and wait for the task pool to be empty.
-    void join_all() {
+    virtual void join_all() {
       bool finished = false;
 
       // Wait for the threads to clean up the threadpool state and exit.
@@ -295,6 +304,102 @@ namespace vw {
     }
   };
 
+  /// A pool of persistent worker threads with one task deque per
+  /// worker.  Tasks added from outside the pool are spread over the
+  /// workers round-robin; tasks added by a running task go to the front
+  /// of its own worker's deque, so related work stays on one core.  An
+  /// idle worker first drains its own deque from the front and then
+  /// steals from the back of the other workers' deques.
+  ///
+  /// Tasks may spawn subtasks and wait() on them.  A worker waiting on a
+  /// subtask keeps executing queued tasks until the subtask finishes,
+  /// so nesting cannot starve the pool of threads and deadlock it.
+  ///
+  /// Unlike the other work queues, threads are created once, in the
+  /// constructor, and live until the queue is destroyed.
+  ///
+  /// A NUMA-aware queue splits its workers evenly over the NUMA nodes
+  /// of the machine and binds each to its node (see Core/Numa.h).  An
+  /// idle worker then steals from the other workers on its own node
+  /// before it steals across nodes, so a task mostly runs where its
+  /// parent allocated its memory.
+  class WorkStealingQueue : public WorkQueue {
+
+    struct Worker {
+      Mutex m_mutex;
+      std::deque<boost::shared_ptr<Task> > m_tasks;
+      int m_node;                  // -1 when the worker is not bound
+      std::vector<size_t> m_victims; // The order to steal in
+    };
+
+    class WorkerLoop {
+      WorkStealingQueue &m_queue;
+      size_t m_index;
+    public:
+      WorkerLoop(WorkStealingQueue& queue, size_t index) : m_queue(queue), m_index(index) {}
+      void operator()() { m_queue.worker_loop(m_index); }
+    };
+    friend class WorkerLoop;
+
+    std::vector<boost::shared_ptr<Worker> > m_workers;
+    std::vector<boost::shared_ptr<Thread> > m_threads;
+
+    Mutex m_state_mutex;    // Protects the counters below
+    Condition m_work_event; // A task was queued, or the pool is stopping
+    Condition m_idle_event; // The last pending task finished
+    size_t m_queued, m_pending, m_running, m_next_worker;
+    bool m_stopping;
+
+    // Returns the index of the calling thread's worker in this pool,
+    // or -1 if the caller is not one of this pool's workers.
+    int current_worker() const;
+
+    boost::shared_ptr<Task> take_task(size_t worker);
+    void run_task(boost::shared_ptr<Task> const& task);
+    void worker_loop(size_t worker);
+
+  public:
+    WorkStealingQueue(int num_threads = vw_settings().default_num_threads(), bool numa_aware = false);
+    virtual ~WorkStealingQueue();
+
+    /// The NUMA node a worker is assigned to, or -1 if the queue is
+    /// not NUMA-aware or the machine has one node.
+    int worker_node(size_t worker) const { return m_workers[worker]->m_node; }
+
+    /// The number of tasks queued but not yet started.
+    size_t size();
+
+    // Add a task that is being tracked by a shared pointer.
+    void add_task(boost::shared_ptr<Task> task);
+
+    /// Wait for a task added to this queue to finish.  When called from
+    /// a task running in this queue, the calling worker runs other
+    /// queued tasks in the meantime.
+    void wait(boost::shared_ptr<Task> const& task);
+
+    /// Steals any queued task.  Provided for the WorkQueue interface;
+    /// the workers do not need it.
+    virtual boost::shared_ptr<Task> get_next_task();
+
+    /// The number of tasks currently executing.
+    virtual int active_threads();
+
+    /// Wait until every task added so far has finished.  This must not
+    /// be called from a task running in this queue; use wait() there.
+    virtual void join_all();
+  };
+
+  /// The process-wide WorkStealingQueue, created on first use with
+  /// vw_settings().default_num_threads() workers, and NUMA-aware if
+  /// vw_settings().numa_aware() is set.
+  WorkStealingQueue& vw_thread_pool();
+
+  /// The process-wide queue for tasks that mostly wait on reading
+  /// files, created on first use with vw_settings().io_queue_depth()
+  /// workers.  Keeping them apart from vw_thread_pool() lets reads go
+  /// on while every compute thread is busy.
+  FifoWorkQueue& vw_io_thread_pool();
+
 } // namespace vw
 
 #endif // __VW_CORE_THREADPOOL_H__
@@ -7,7 +7,10 @@
 
 /// \file Core/Queue.h
 ///
-/// A thread-safe queue. Uses a condition variable to avoid busy-waiting.
+/// Thread-safe queues. ThreadQueue is an unbounded queue behind one
+/// lock. BoundedThreadQueue is a fixed-capacity ring buffer that
+/// producers and consumers use without taking a lock; both use a
+/// condition variable to avoid busy-waiting.
 ///
 
 #ifndef __VW_CORE_QUEUE_H__
@@ -16,8 +19,14 @@
 #include <boost/bind.hpp>
 
 #include <queue>
+#include <vector>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/Thread.h>
+#include <vw/Core/Stopwatch.h>
+
+#if !defined(__GNUC__)
+#error "BoundedThreadQueue needs the GCC __sync atomic builtins."
+#endif
 
 namespace vw {
 
@@ -87,6 +96,19 @@ class ThreadQueue : private boost::noncopyable {
       return true;
     }
 
+    // Pop up to max_count messages without waiting, appending them to
+    // data. Returns the number popped.
+    size_t pop_batch(std::vector<T>& data, size_t max_count) {
+      Mutex::Lock lock(m_mutex);
+      size_t count = 0;
+      while (count < max_count && !m_queue.empty()) {
+        data.push_back(m_queue.front());
+        m_queue.pop();
+        ++count;
+      }
+      return count;
+    }
+
     void flush() {
       Mutex::Lock lock(m_mutex);
       while (!m_queue.empty()) {
@@ -95,6 +117,220 @@ class ThreadQueue : private boost::noncopyable {
     }
 };
 
+// A bounded multi-producer multi-consumer queue with the interface of
+// ThreadQueue. Messages live in a ring of cells, each with a sequence
+// number that tells producers and consumers whose turn it is, so
+// neither side takes a lock while the queue is neither empty nor full.
+// The lock and condition variables are only used to put threads to
+// sleep: a consumer when the queue is empty, and a producer in push()
+// when it is full.
+template<typename T>
+class BoundedThreadQueue : private boost::noncopyable {
+  private:
+    struct Cell {
+      volatile size_t m_sequence;
+      T m_data;
+    };
+
+    // Keep the two positions on their own cache lines, so producers and
+    // consumers do not invalidate each other's.
+    char m_pad0[64];
+    volatile size_t m_enqueue_pos;
+    char m_pad1[64];
+    volatile size_t m_dequeue_pos;
+    char m_pad2[64];
+
+    std::vector<Cell> m_cells;
+    size_t m_mask;
+
+    volatile size_t m_pop_waiters, m_push_waiters;
+    Mutex m_mutex;
+    Condition m_pop_cond, m_push_cond;
+
+    void wake(volatile size_t& waiters, Condition& cond, bool all = false) {
+      // Orders our cell update before the read of the waiter count; the
+      // sleeping side does the reverse under the lock.
+      __sync_synchronize();
+      if (waiters) {
+        Mutex::Lock lock(m_mutex);
+        if (all)
+          cond.notify_all();
+        else
+          cond.notify_one();
+      }
+    }
+
+    bool enqueue(T const& data) {
+      size_t pos = m_enqueue_pos;
+      Cell* cell;
+      while (true) {
+        cell = &m_cells[pos & m_mask];
+        size_t seq = cell->m_sequence;
+        __sync_synchronize();
+        ssize_t diff = ssize_t(seq) - ssize_t(pos);
+        if (diff == 0) {
+          if (__sync_bool_compare_and_swap(&m_enqueue_pos, pos, pos+1))
+            break;
+          pos = m_enqueue_pos;
+        }
+        else if (diff < 0)
+          return false; // Full
+        else
+          pos = m_enqueue_pos;
+      }
+      cell->m_data = data;
+      __sync_synchronize();
+      cell->m_sequence = pos + 1;
+      return true;
+    }
+
+    bool dequeue(T& data) {
+      size_t pos = m_dequeue_pos;
+      Cell* cell;
+      while (true) {
+        cell = &m_cells[pos & m_mask];
+        size_t seq = cell->m_sequence;
+        __sync_synchronize();
+        ssize_t diff = ssize_t(seq) - ssize_t(pos+1);
+        if (diff == 0) {
+          if (__sync_bool_compare_and_swap(&m_dequeue_pos, pos, pos+1))
+            break;
+          pos = m_dequeue_pos;
+        }
+        else if (diff < 0)
+          return false; // Empty
+        else
+          pos = m_dequeue_pos;
+      }
+      data = cell->m_data;
+      cell->m_data = T();
+      __sync_synchronize();
+      cell->m_sequence = pos + m_mask + 1;
+      return true;
+    }
+
+  public:
+    // The capacity is rounded up to a power of two.
+    BoundedThreadQueue(size_t capacity = 1024)
+      : m_enqueue_pos(0), m_dequeue_pos(0), m_pop_waiters(0), m_push_waiters(0) {
+      size_t size = 2;
+      while (size < capacity)
+        size *= 2;
+      m_cells.resize(size);
+      m_mask = size - 1;
+      for (size_t i = 0; i < size; ++i)
+        m_cells[i].m_sequence = i;
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    // Try to push something on, return indicates success
+    bool try_push(T const& data) {
+      if (!enqueue(data))
+        return false;
+      wake(m_pop_waiters, m_pop_cond);
+      return true;
+    }
+
+    // Push, waiting for room if the queue is full
+    void push(T const& data) {
+      while (!try_push(data)) {
+        Mutex::Lock lock(m_mutex);
+        __sync_fetch_and_add(&m_push_waiters, 1);
+        if (enqueue(data)) {
+          __sync_fetch_and_sub(&m_push_waiters, 1);
+          lock.unlock();
+          wake(m_pop_waiters, m_pop_cond);
+          return;
+        }
+        m_push_cond.wait(lock);
+        __sync_fetch_and_sub(&m_push_waiters, 1);
+      }
+    }
+
+    // Returns the number of messages waiting in the queue. This is
+    // only a snapshot while other threads use the queue.
+    size_t size() const {
+      size_t dequeue_pos = m_dequeue_pos;
+      size_t enqueue_pos = m_enqueue_pos;
+      return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+    }
+
+    bool empty() const {
+      return size() == 0;
+    }
+
+    // Try to pop something off, return indicates success
+    bool try_pop(T& data) {
+      if (!dequeue(data))
+        return false;
+      wake(m_push_waiters, m_push_cond);
+      return true;
+    }
+
+    // Wait for data forever
+    void wait_pop(T& data) {
+      while (!try_pop(data)) {
+        Mutex::Lock lock(m_mutex);
+        __sync_fetch_and_add(&m_pop_waiters, 1);
+        bool popped = dequeue(data);
+        if (!popped)
+          m_pop_cond.wait(lock);
+        __sync_fetch_and_sub(&m_pop_waiters, 1);
+        if (popped) {
+          lock.unlock();
+          wake(m_push_waiters, m_push_cond);
+          return;
+        }
+      }
+    }
+
+    // Wait for data with a timeout (in ms)
+    bool timed_wait_pop(T& data, unsigned long duration) {
+      uint64 deadline = Stopwatch::microtime() + uint64(duration) * 1000;
+      while (!try_pop(data)) {
+        uint64 now = Stopwatch::microtime();
+        if (now >= deadline)
+          return false;
+        Mutex::Lock lock(m_mutex);
+        __sync_fetch_and_add(&m_pop_waiters, 1);
+        bool popped = dequeue(data);
+        if (!popped)
+          m_pop_cond.timed_wait(lock, (unsigned long)((deadline - now + 999) / 1000));
+        __sync_fetch_and_sub(&m_pop_waiters, 1);
+        if (popped) {
+          lock.unlock();
+          wake(m_push_waiters, m_push_cond);
+          return true;
+        }
+      }
+      return true;
+    }
+
+    // Pop up to max_count messages without waiting, appending them to
+    // data. Returns the number popped.
+    size_t pop_batch(std::vector<T>& data, size_t max_count) {
+      size_t count = 0;
+      T item;
+      while (count < max_count && dequeue(item)) {
+        data.push_back(item);
+        ++count;
+      }
+      if (count)
+        wake(m_push_waiters, m_push_cond, true);
+      return count;
+    }
+
+    void flush() {
+      T item;
+      size_t count = 0;
+      while (dequeue(item))
+        ++count;
+      if (count)
+        wake(m_push_waiters, m_push_cond, true);
+    }
+};
+
 } // namespace vw
 
 
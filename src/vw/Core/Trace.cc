@@ -0,0 +1,263 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Core/Trace.h>
+#include <vw/Core/Log.h>
+
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
+namespace vw {
+namespace trace {
+
+  // Every Tracer gets a serial number, so a thread's cached buffer is
+  // never mistaken for one of another tracer at the same address.
+  static Mutex& serial_mutex() {
+    static Mutex* m = new Mutex();
+    return *m;
+  }
+  static uint64 next_serial = 0;
+
+  // Construct-on-first-use, for the same reason as in Thread.cc.
+  typedef boost::thread_specific_ptr<std::pair<uint64, void*> > slot_ptr_t;
+  static slot_ptr_t& thread_slot() {
+    static slot_ptr_t* ptr = new slot_ptr_t();
+    return *ptr;
+  }
+
+  static std::string demangle( const char *name ) {
+#ifdef __GNUC__
+    int status = 0;
+    char *result = abi::__cxa_demangle( name, 0, 0, &status );
+    if( status == 0 && result ) {
+      std::string demangled( result );
+      std::free( result );
+      return demangled;
+    }
+#endif
+    return name;
+  }
+
+  static std::string event_name( TraceEvent const& event ) {
+    if( ! event.type )
+      return event.stage;
+    return std::string(event.stage) + " " + demangle(event.type);
+  }
+
+  static void write_json_string( std::ostream& out, std::string const& s ) {
+    out << '"';
+    for( size_t i = 0; i < s.size(); ++i ) {
+      if( s[i] == '"' || s[i] == '\\' ) out << '\\';
+      out << s[i];
+    }
+    out << '"';
+  }
+
+  // The startup events are kept apart from any Tracer, so that they
+  // can be recorded before vw_tracer() exists.
+  static Mutex& startup_mutex() {
+    static Mutex* m = new Mutex();
+    return *m;
+  }
+  static std::vector<TraceEvent>& startup_events() {
+    static std::vector<TraceEvent>* events = new std::vector<TraceEvent>();
+    return *events;
+  }
+
+  struct StageTotals {
+    uint64 count, elapsed, max_elapsed, bytes, hits, misses;
+    StageTotals() : count(0), elapsed(0), max_elapsed(0), bytes(0), hits(0), misses(0) {}
+  };
+
+  typedef std::pair<std::string, StageTotals> StageEntry;
+
+  static bool stage_elapsed_gt( StageEntry const& a, StageEntry const& b ) {
+    return a.second.elapsed > b.second.elapsed;
+  }
+
+}} // namespace vw::trace
+
+void vw::record_startup_trace( TraceEvent const& event ) {
+  Mutex::Lock lock(trace::startup_mutex());
+  trace::startup_events().push_back( event );
+}
+
+std::vector<vw::TraceEvent> vw::startup_trace_events() {
+  Mutex::Lock lock(trace::startup_mutex());
+  return trace::startup_events();
+}
+
+vw::Tracer::Buffer& vw::Tracer::thread_buffer() {
+  std::pair<uint64, void*> *slot = trace::thread_slot().get();
+  if( slot && slot->first == m_serial )
+    return *static_cast<Buffer*>( slot->second );
+
+  boost::shared_ptr<Buffer> buffer( new Buffer() );
+  {
+    Mutex::Lock lock(m_mutex);
+    m_buffers.push_back( buffer );
+  }
+  trace::thread_slot().reset( new std::pair<uint64, void*>( m_serial, buffer.get() ) );
+  return *buffer;
+}
+
+vw::Tracer::Tracer() : m_summary(false), m_enabled(false) {
+  Mutex::Lock lock(trace::serial_mutex());
+  m_serial = trace::next_serial++;
+}
+
+void vw::Tracer::update_enabled() {
+  m_enabled = m_summary || !m_output_file.empty();
+}
+
+void vw::Tracer::set_output_file( std::string const& filename ) {
+  Mutex::Lock lock(m_mutex);
+  m_output_file = filename;
+  update_enabled();
+}
+
+std::string vw::Tracer::output_file() const {
+  Mutex::Lock lock(m_mutex);
+  return m_output_file;
+}
+
+void vw::Tracer::set_summary( bool summary ) {
+  Mutex::Lock lock(m_mutex);
+  m_summary = summary;
+  update_enabled();
+}
+
+bool vw::Tracer::summary() const {
+  Mutex::Lock lock(m_mutex);
+  return m_summary;
+}
+
+void vw::Tracer::record( TraceEvent const& event ) {
+  Buffer& buffer = thread_buffer();
+  Mutex::Lock lock(buffer.m_mutex);
+  buffer.m_events.push_back( event );
+}
+
+std::vector<vw::TraceEvent> vw::Tracer::events() const {
+  std::vector<TraceEvent> result;
+  Mutex::Lock lock(m_mutex);
+  for( size_t i = 0; i < m_buffers.size(); ++i ) {
+    Mutex::Lock buffer_lock(m_buffers[i]->m_mutex);
+    result.insert( result.end(), m_buffers[i]->m_events.begin(), m_buffers[i]->m_events.end() );
+  }
+  return result;
+}
+
+void vw::Tracer::clear() {
+  Mutex::Lock lock(m_mutex);
+  for( size_t i = 0; i < m_buffers.size(); ++i ) {
+    Mutex::Lock buffer_lock(m_buffers[i]->m_mutex);
+    m_buffers[i]->m_events.clear();
+  }
+}
+
+std::string vw::Tracer::report() const {
+  std::vector<TraceEvent> all = events();
+
+  std::map<std::string, trace::StageTotals> stages;
+  for( size_t i = 0; i < all.size(); ++i ) {
+    trace::StageTotals& t = stages[trace::event_name(all[i])];
+    t.count++;
+    t.elapsed += all[i].duration;
+    t.max_elapsed = std::max( t.max_elapsed, all[i].duration );
+    t.bytes += all[i].bytes;
+    if( all[i].cache == TRACE_CACHE_HIT ) t.hits++;
+    if( all[i].cache == TRACE_CACHE_MISS ) t.misses++;
+  }
+
+  std::vector<trace::StageEntry> sorted( stages.begin(), stages.end() );
+  std::sort( sorted.begin(), sorted.end(), trace::stage_elapsed_gt );
+
+  std::ostringstream out;
+  out << "Trace summary (" << all.size() << " events, inclusive seconds):" << std::endl;
+  for( size_t i = 0; i < sorted.size(); ++i ) {
+    trace::StageTotals const& t = sorted[i].second;
+    out << std::setw(12) << double(t.elapsed) / 1e6
+        << " (avg " << double(t.elapsed) / 1e6 / double(t.count) << " x " << t.count
+        << ", max " << double(t.max_elapsed) / 1e6 << ")";
+    if( t.bytes )
+      out << " " << t.bytes << " bytes";
+    if( t.hits || t.misses )
+      out << " cache " << t.hits << " hits / " << t.misses << " misses";
+    out << ": " << sorted[i].first << std::endl;
+  }
+
+  std::vector<TraceEvent> startup = startup_trace_events();
+  if( ! startup.empty() ) {
+    std::map<std::string, trace::StageTotals> steps;
+    uint64 total = 0;
+    for( size_t i = 0; i < startup.size(); ++i ) {
+      trace::StageTotals& t = steps[startup[i].stage];
+      t.count++;
+      t.elapsed += startup[i].duration;
+      total += startup[i].duration;
+    }
+    std::vector<trace::StageEntry> sorted_steps( steps.begin(), steps.end() );
+    std::sort( sorted_steps.begin(), sorted_steps.end(), trace::stage_elapsed_gt );
+
+    out << "Startup (" << double(total) / 1e6 << " seconds):" << std::endl;
+    for( size_t i = 0; i < sorted_steps.size(); ++i ) {
+      trace::StageTotals const& t = sorted_steps[i].second;
+      out << std::setw(12) << double(t.elapsed) / 1e6 << " (x " << t.count << ")"
+          << ": " << sorted_steps[i].first << std::endl;
+    }
+  }
+  return out.str();
+}
+
+void vw::Tracer::write_chrome_trace( std::ostream& out ) const {
+  std::vector<TraceEvent> all = events();
+  std::vector<TraceEvent> startup = startup_trace_events();
+  all.insert( all.end(), startup.begin(), startup.end() );
+
+  uint64 origin = 0;
+  for( size_t i = 0; i < all.size(); ++i )
+    if( i == 0 || all[i].start < origin )
+      origin = all[i].start;
+
+  out << "{\"traceEvents\":[";
+  for( size_t i = 0; i < all.size(); ++i ) {
+    TraceEvent const& e = all[i];
+    out << (i ? ",\n" : "\n") << "{\"name\":";
+    trace::write_json_string( out, trace::event_name(e) );
+    out << ",\"cat\":";
+    trace::write_json_string( out, e.stage );
+    out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.thread
+        << ",\"ts\":" << e.start - origin << ",\"dur\":" << e.duration
+        << ",\"args\":{\"bytes\":" << e.bytes;
+    if( e.cache != TRACE_CACHE_NONE )
+      out << ",\"cache\":\"" << (e.cache == TRACE_CACHE_HIT ? "hit" : "miss") << "\"";
+    out << "}}";
+  }
+  out << "\n]}\n";
+}
+
+void vw::Tracer::flush() const {
+  std::string filename = output_file();
+  if( ! filename.empty() ) {
+    std::ofstream out( filename.c_str() );
+    if( out )
+      write_chrome_trace( out );
+    else
+      vw_out(WarningMessage) << "Could not write trace file \"" << filename << "\"." << std::endl;
+  }
+  if( summary() )
+    vw_out() << report();
+}
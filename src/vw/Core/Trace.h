@@ -0,0 +1,191 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Core/Trace.h
+///
+/// Low-overhead per-block instrumentation of the image pipeline.
+///
+/// The block-level hot paths (BlockRasterizeView, ThreadedBlockWriter
+/// and the DiskImageResource drivers) open a ScopedTrace around each
+/// block they process.  When tracing is disabled, which is the
+/// default, this costs one flag check.  When it is enabled, each
+/// thread appends a TraceEvent (stage, view type, start time,
+/// duration, bytes and cache hit/miss) to a buffer of its own, so
+/// threads never contend with each other while recording.
+///
+/// Tracing is turned on through vw_settings():
+///
+///   trace_file     Write every event as Chrome trace JSON (viewable
+///                  in chrome://tracing) to this file at process exit.
+///   trace_summary  Log a table of per-stage totals at process exit.
+///
+/// Either can also be set in ~/.vwrc as general.trace_file and
+/// general.trace_summary.  Stage times are inclusive: a view's time
+/// includes the time spent rasterizing its children.
+///
+/// One-time initialization, such as parsing ~/.vwrc or setting up
+/// GDAL, is timed by ScopedStartupTrace whether or not tracing is
+/// enabled, and makes up the startup section of the report.
+///
+#ifndef __VW_CORE_TRACE_H__
+#define __VW_CORE_TRACE_H__
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <typeinfo>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/System.h>
+#include <vw/Core/Thread.h>
+
+namespace vw {
+
+  /// Whether a traced block was served from a cache.
+  enum TraceCacheResult {
+    TRACE_CACHE_NONE,
+    TRACE_CACHE_HIT,
+    TRACE_CACHE_MISS
+  };
+
+  /// One timed block of work.  The strings are not copied, so they
+  /// must be literals or typeid() names.
+  struct TraceEvent {
+    const char *stage;  // e.g. "BlockRasterizeView::rasterize"
+    const char *type;   // typeid() name of the view involved, or 0
+    uint64 thread;      // Thread::id() of the recording thread
+    uint64 start;       // Stopwatch::microtime() at the start
+    uint64 duration;    // in microseconds
+    uint64 bytes;
+    TraceCacheResult cache;
+  };
+
+  /// Collects TraceEvents from all threads.  You should normally use
+  /// the global instance returned by vw_tracer().
+  class Tracer : private boost::noncopyable {
+    struct Buffer {
+      Mutex m_mutex; // Only contended while the events are exported
+      std::vector<TraceEvent> m_events;
+    };
+
+    uint64 m_serial;
+    mutable Mutex m_mutex; // Protects everything below
+    std::vector<boost::shared_ptr<Buffer> > m_buffers;
+    std::string m_output_file;
+    bool m_summary;
+    bool m_enabled;
+
+    Buffer& thread_buffer();
+    void update_enabled();
+
+  public:
+    Tracer();
+
+    /// True if events are being recorded.  This is read without a
+    /// lock, so enabling tracing takes effect shortly, not instantly.
+    bool enabled() const { return m_enabled; }
+
+    /// Record events and write them as Chrome trace JSON to the given
+    /// file at process exit.  An empty filename turns this off.
+    void set_output_file( std::string const& filename );
+    std::string output_file() const;
+
+    /// Record events and log a per-stage summary at process exit.
+    void set_summary( bool summary );
+    bool summary() const;
+
+    /// Add an event to the calling thread's buffer.
+    void record( TraceEvent const& event );
+
+    /// Returns a copy of the events recorded so far by all threads.
+    std::vector<TraceEvent> events() const;
+
+    /// Discards all recorded events.
+    void clear();
+
+    /// A table of count, time, bytes and cache hits/misses per stage
+    /// and view type, sorted by total time, followed by the time spent
+    /// in each startup step.
+    std::string report() const;
+
+    /// Writes all recorded events in the Chrome trace event format.
+    void write_chrome_trace( std::ostream& out ) const;
+
+    /// Writes the outputs that are turned on.  This is called
+    /// automatically at exit for the global tracer.
+    void flush() const;
+  };
+
+  /// Times the enclosing scope and records it with vw_tracer(), if
+  /// tracing is enabled when the scope is entered.
+  class ScopedTrace : private boost::noncopyable {
+    TraceEvent m_event;
+    bool m_active;
+  public:
+    ScopedTrace( const char *stage, const char *type = 0, uint64 bytes = 0,
+                 TraceCacheResult cache = TRACE_CACHE_NONE )
+      : m_active( vw_tracer().enabled() ) {
+      if( ! m_active ) return;
+      m_event.stage = stage;
+      m_event.type = type;
+      m_event.bytes = bytes;
+      m_event.cache = cache;
+      m_event.start = Stopwatch::microtime();
+    }
+
+    ~ScopedTrace() {
+      if( ! m_active ) return;
+      m_event.duration = Stopwatch::microtime() - m_event.start;
+      m_event.thread = Thread::id();
+      vw_tracer().record( m_event );
+    }
+
+    /// Whether this scope is being recorded.  Use this to skip work
+    /// that only serves the trace.
+    bool active() const { return m_active; }
+
+    void set_bytes( uint64 bytes ) { m_event.bytes = bytes; }
+    void set_cache( TraceCacheResult cache ) { m_event.cache = cache; }
+  };
+
+  /// The startup steps timed so far by all threads, in the order they
+  /// finished.
+  std::vector<TraceEvent> startup_trace_events();
+
+  /// \cond INTERNAL
+  void record_startup_trace( TraceEvent const& event );
+  /// \endcond
+
+  /// Times a one-time initialization step for the startup section of
+  /// Tracer::report().  There are only a few such steps, so they are
+  /// always recorded.  This uses neither vw_settings() nor
+  /// vw_tracer(), so it can time their own initialization.
+  class ScopedStartupTrace : private boost::noncopyable {
+    TraceEvent m_event;
+  public:
+    ScopedStartupTrace( const char *stage ) {
+      m_event.stage = stage;
+      m_event.type = 0;
+      m_event.bytes = 0;
+      m_event.cache = TRACE_CACHE_NONE;
+      m_event.start = Stopwatch::microtime();
+    }
+
+    ~ScopedStartupTrace() {
+      m_event.duration = Stopwatch::microtime() - m_event.start;
+      m_event.thread = Thread::id();
+      record_startup_trace( m_event );
+    }
+  };
+
+} // namespace vw
+
+#endif // __VW_CORE_TRACE_H__
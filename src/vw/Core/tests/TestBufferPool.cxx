@@ -0,0 +1,122 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <vw/Core/BufferPool.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <cstring>
+
+using namespace vw;
+
+namespace {
+  bool aligned( void* ptr ) {
+    return reinterpret_cast<size_t>( ptr ) % BufferPool::ALIGNMENT == 0;
+  }
+
+  class ChurnTask : public Task {
+    BufferPool& m_pool;
+  public:
+    ChurnTask( BufferPool& pool ) : m_pool(pool) {}
+    virtual void operator()() {
+      for( size_t i = 0; i < 1000; ++i ) {
+        size_t bytes = 1 + (i * 7919) % 100000;
+        char* ptr = static_cast<char*>( m_pool.allocate( bytes ) );
+        memset( ptr, 1, bytes );
+        m_pool.deallocate( ptr, bytes );
+      }
+    }
+  };
+}
+
+TEST(BufferPool, SizeClasses) {
+  EXPECT_EQ( 0u, BufferPool::size_class( 1 ) );
+  EXPECT_EQ( 0u, BufferPool::size_class( 64 ) );
+  EXPECT_EQ( 80u, BufferPool::class_size( BufferPool::size_class( 65 ) ) );
+  EXPECT_EQ( 128u, BufferPool::class_size( BufferPool::size_class( 128 ) ) );
+  EXPECT_EQ( 160u, BufferPool::class_size( BufferPool::size_class( 129 ) ) );
+  EXPECT_EQ( BufferPool::NUM_CLASSES - 1, BufferPool::size_class( BufferPool::MAX_POOLED_SIZE ) );
+
+  for( size_t bytes = 1; bytes < 100000; bytes += 37 ) {
+    size_t size = BufferPool::class_size( BufferPool::size_class( bytes ) );
+    EXPECT_GE( size, bytes );
+    EXPECT_LE( size, std::max( size_t(64), bytes + bytes / 4 ) );
+  }
+}
+
+TEST(BufferPool, Reuse) {
+  BufferPool pool( 1 << 20 );
+  void* a = pool.allocate( 1000 );
+  ASSERT_TRUE( a != 0 );
+  EXPECT_TRUE( aligned( a ) );
+  pool.deallocate( a, 1000 );
+  EXPECT_EQ( 1024u, pool.thread_cached() );
+
+  // Anything in the same size class gets the same buffer back.
+  void* b = pool.allocate( 1020 );
+  EXPECT_EQ( a, b );
+  EXPECT_EQ( 0u, pool.thread_cached() );
+  pool.deallocate( b, 1020 );
+
+  pool.trim();
+  EXPECT_EQ( 0u, pool.thread_cached() );
+}
+
+TEST(BufferPool, Overflow) {
+  // The thread keeps one buffer, the shared list the second, and the
+  // third goes back to the heap.
+  BufferPool pool( 1024 );
+  void* a = pool.allocate( 1024 );
+  void* b = pool.allocate( 1024 );
+  void* c = pool.allocate( 1024 );
+  pool.deallocate( a, 1024 );
+  pool.deallocate( b, 1024 );
+  pool.deallocate( c, 1024 );
+  EXPECT_EQ( 1024u, pool.thread_cached() );
+  EXPECT_EQ( 1024u, pool.shared_cached() );
+
+  EXPECT_EQ( a, pool.allocate( 1024 ) );
+  EXPECT_EQ( b, pool.allocate( 1024 ) );
+  pool.deallocate( a, 1024 );
+  pool.deallocate( b, 1024 );
+}
+
+TEST(BufferPool, Unpooled) {
+  BufferPool pool( 0 );
+  void* a = pool.allocate( 1000 );
+  EXPECT_TRUE( aligned( a ) );
+  pool.deallocate( a, 1000 );
+  EXPECT_EQ( 0u, pool.thread_cached() + pool.shared_cached() );
+
+  // Buffers larger than the largest class are never pooled.
+  pool.set_max_cached( BufferPool::MAX_POOLED_SIZE * 4 );
+  void* big = pool.allocate( BufferPool::MAX_POOLED_SIZE + 1 );
+  EXPECT_TRUE( aligned( big ) );
+  pool.deallocate( big, BufferPool::MAX_POOLED_SIZE + 1 );
+  EXPECT_EQ( 0u, pool.thread_cached() + pool.shared_cached() );
+}
+
+TEST(BufferPool, Threads) {
+  BufferPool pool( 1 << 20 );
+  {
+    FifoWorkQueue queue( 4 );
+    for( int i = 0; i < 8; ++i )
+      queue.add_task( boost::shared_ptr<Task>( new ChurnTask( pool ) ) );
+    queue.join_all();
+  }
+  // The workers' free lists move to the shared list as they exit.
+  EXPECT_EQ( 0u, pool.thread_cached() );
+  EXPECT_LE( pool.shared_cached(), size_t(1) << 20 );
+  pool.trim();
+  EXPECT_EQ( 0u, pool.shared_cached() );
+}
+
+TEST(BufferPool, Settings) {
+  vw_settings().set_buffer_pool_size( 12345 );
+  EXPECT_EQ( 12345u, vw_buffer_pool().max_cached() );
+}
@@ -224,3 +224,292 @@ TEST(Cache, Stats) {
   EXPECT_EQ(0u, cache.misses());
   EXPECT_EQ(0u, cache.evictions());
 }
+
+TEST(Cache, Sharded) {
+  typedef Cache::Handle<BlockGenerator> handle_t;
+
+  // Four shards, but the byte budget is still global: 3 items
+  vw::Cache cache(3*sizeof(handle_t::value_type), 4);
+  EXPECT_EQ(4u, cache.num_shards());
+
+  std::vector<handle_t> h;
+  for (uint8 i = 0; i < 8; ++i)
+    h.push_back(cache.insert(BlockGenerator(1, i)));
+
+  for (uint8 i = 0; i < 8; ++i)
+    EXPECT_EQ(i, *h[i]);
+
+  int valid = 0;
+  for (size_t i = 0; i < h.size(); ++i)
+    if (h[i].valid())
+      valid++;
+  EXPECT_EQ(3, valid);
+
+  EXPECT_EQ(0u, cache.hits());
+  EXPECT_EQ(8u, cache.misses());
+  EXPECT_EQ(5u, cache.evictions());
+
+  // The most recently generated line must have survived
+  EXPECT_TRUE(h[7].valid());
+  EXPECT_EQ(7, *h[7]);
+  EXPECT_EQ(1u, cache.hits());
+
+  cache.resize(sizeof(handle_t::value_type));
+  valid = 0;
+  for (size_t i = 0; i < h.size(); ++i)
+    if (h[i].valid())
+      valid++;
+  EXPECT_EQ(1, valid);
+
+  cache.clear_stats();
+  EXPECT_EQ(0u, cache.hits());
+  EXPECT_EQ(0u, cache.misses());
+  EXPECT_EQ(0u, cache.evictions());
+}
+
+TEST(Cache, ShardedReshard) {
+  vw::Cache cache(sizeof(vw::uint8));
+  EXPECT_EQ(1u, cache.num_shards());
+  cache.set_num_shards(8);
+  EXPECT_EQ(8u, cache.num_shards());
+
+  Cache::Handle<BlockGenerator> h = cache.insert(BlockGenerator(1, 3));
+  EXPECT_THROW(cache.set_num_shards(2), LogicErr);
+  h.reset();
+  cache.set_num_shards(2);
+  EXPECT_EQ(2u, cache.num_shards());
+}
+
+namespace {
+  class CacheHammer {
+    std::vector<Cache::Handle<BlockGenerator> >& m_handles;
+    int m_offset;
+  public:
+    CacheHammer(std::vector<Cache::Handle<BlockGenerator> >& handles, int offset)
+      : m_handles(handles), m_offset(offset) {}
+    void operator()() {
+      for (int i = 0; i < 2000; ++i) {
+        size_t idx = (i * 7 + m_offset) % m_handles.size();
+        boost::shared_ptr<vw::uint8> value = m_handles[idx];
+        if (*value != idx)
+          vw_throw(LogicErr() << "Wrong cache value");
+      }
+    }
+  };
+}
+
+TEST(Cache, ShardedThreaded) {
+  typedef Cache::Handle<BlockGenerator> handle_t;
+  vw::Cache cache(10*sizeof(handle_t::value_type), 8);
+
+  std::vector<handle_t> h;
+  for (uint8 i = 0; i < 32; ++i)
+    h.push_back(cache.insert(BlockGenerator(1, i)));
+
+  std::vector<boost::shared_ptr<Thread> > threads;
+  for (int i = 0; i < 8; ++i)
+    threads.push_back(boost::shared_ptr<Thread>(new Thread(CacheHammer(h, i))));
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i]->join();
+
+  EXPECT_EQ(8u*2000u, cache.hits() + cache.misses());
+}
+
+// A BlockGenerator that takes a while to generate its block.
+class SlowBlockGenerator : public BlockGenerator {
+public:
+  SlowBlockGenerator(int dimension, vw::uint8 fill_value = 0) :
+    BlockGenerator(dimension, fill_value) {}
+
+  boost::shared_ptr< value_type > generate() const {
+    Thread::sleep_ms(20);
+    return BlockGenerator::generate();
+  }
+};
+
+TEST(Cache, GDSF) {
+  typedef Cache::Handle<BlockGenerator> cheap_t;
+  typedef Cache::Handle<SlowBlockGenerator> slow_t;
+
+  // Cache can hold 2 items
+  vw::Cache cache(2*sizeof(cheap_t::value_type), 1, Cache::GDSF_EVICTION);
+  EXPECT_EQ(Cache::GDSF_EVICTION, cache.eviction_policy());
+
+  slow_t slow = cache.insert(SlowBlockGenerator(1, 100));
+  std::vector<cheap_t> cheap;
+  for (uint8 i = 0; i < 5; ++i)
+    cheap.push_back(cache.insert(BlockGenerator(1, i)));
+
+  EXPECT_EQ(100, *slow);
+  for (uint8 i = 0; i < 5; ++i) {
+    EXPECT_EQ(i, *cheap[i]);
+    // Under LRU the slow line would have been evicted by now
+    EXPECT_TRUE(slow.valid());
+  }
+  EXPECT_EQ(4u, cache.evictions());
+
+  // A deprioritized line goes first regardless of its cost
+  slow.deprioritize();
+  EXPECT_EQ(0, *cheap[0]);
+  EXPECT_FALSE(slow.valid());
+  EXPECT_TRUE(cheap[0].valid());
+  EXPECT_TRUE(cheap[4].valid());
+}
+
+TEST(Cache, LRUEvictsExpensive) {
+  typedef Cache::Handle<BlockGenerator> cheap_t;
+  typedef Cache::Handle<SlowBlockGenerator> slow_t;
+
+  vw::Cache cache(2*sizeof(cheap_t::value_type));
+  EXPECT_EQ(Cache::LRU_EVICTION, cache.eviction_policy());
+
+  slow_t  slow = cache.insert(SlowBlockGenerator(1, 100));
+  cheap_t a = cache.insert(BlockGenerator(1, 0));
+  cheap_t b = cache.insert(BlockGenerator(1, 1));
+
+  EXPECT_EQ(100, *slow);
+  EXPECT_EQ(0, *a);
+  EXPECT_EQ(1, *b);
+  EXPECT_FALSE(slow.valid());
+
+  EXPECT_THROW(cache.set_eviction_policy(Cache::GDSF_EVICTION), LogicErr);
+}
+
+TEST(Cache, StatsSnapshot) {
+  typedef Cache::Handle<BlockGenerator> cheap_t;
+  typedef Cache::Handle<SlowBlockGenerator> slow_t;
+
+  vw::Cache cache(2*sizeof(cheap_t::value_type), 2);
+
+  slow_t  slow = cache.insert(SlowBlockGenerator(1, 100));
+  cheap_t a = cache.insert(BlockGenerator(1, 0));
+  cheap_t b = cache.insert(BlockGenerator(1, 1));
+
+  EXPECT_EQ(100, *slow);
+  EXPECT_EQ(100, *slow);
+  EXPECT_EQ(0, *a);
+  EXPECT_EQ(1, *b);  // Evicts slow, which was used twice
+  EXPECT_EQ(0, *a);
+  EXPECT_EQ(100, *slow); // Evicts b, used once
+
+  CacheStats stats = cache.stats();
+  EXPECT_EQ(3u, stats.total.lines);
+  EXPECT_EQ(2u, stats.total.hits);
+  EXPECT_EQ(4u, stats.total.misses);
+  EXPECT_EQ(2u, stats.total.evictions);
+  EXPECT_EQ(4u, stats.total.bytes_generated);
+  EXPECT_EQ(2u, stats.size);
+  EXPECT_EQ(2u, stats.max_size);
+  EXPECT_EQ(0u, stats.bytes_in_flight);
+  EXPECT_NEAR(2.0/6.0, stats.hit_rate(), 1e-6);
+
+  ASSERT_EQ(2u, stats.types.size());
+  CacheStats::TypeStats const& s = stats.types[typeid(SlowBlockGenerator).name()];
+  CacheStats::TypeStats const& c = stats.types[typeid(BlockGenerator).name()];
+  EXPECT_EQ(1u, s.lines);
+  EXPECT_EQ(1u, s.hits);
+  EXPECT_EQ(2u, s.misses);
+  EXPECT_EQ(1u, s.evictions);
+  EXPECT_LT(0u, s.generate_microseconds);
+  EXPECT_LT(0u, s.regenerate_microseconds);
+  EXPECT_EQ(2u, c.lines);
+  EXPECT_EQ(1u, c.evictions);
+  EXPECT_EQ(0u, c.regenerate_microseconds);
+
+  ASSERT_EQ(CacheStats::HISTOGRAM_BUCKETS, stats.eviction_histogram.size());
+  EXPECT_EQ(1u, stats.eviction_histogram[0]);
+  EXPECT_EQ(1u, stats.eviction_histogram[1]);
+
+  EXPECT_NE(std::string::npos, stats.report().find("hit rate"));
+
+  cache.clear_stats();
+  stats = cache.stats();
+  EXPECT_EQ(3u, stats.total.lines);
+  EXPECT_EQ(0u, stats.total.hits + stats.total.misses + stats.total.evictions);
+  EXPECT_EQ(0u, stats.eviction_histogram[1]);
+
+  b.reset();
+  EXPECT_EQ(2u, cache.stats().total.lines);
+}
+
+// A slow generator of a value that the cache knows how to spill.
+struct SpillValue {
+  int32 value;
+  SpillValue( int32 v ) : value(v) {}
+};
+
+namespace vw {
+  template <>
+  struct CacheSpill<SpillValue> {
+    static const bool value = true;
+    static void write( std::ostream& stream, SpillValue const& v ) {
+      stream.write( reinterpret_cast<const char*>(&v.value), sizeof(v.value) );
+    }
+    static boost::shared_ptr<SpillValue> read( std::istream& stream ) {
+      int32 v;
+      if( ! stream.read( reinterpret_cast<char*>(&v), sizeof(v) ) )
+        return boost::shared_ptr<SpillValue>();
+      return boost::shared_ptr<SpillValue>( new SpillValue(v) );
+    }
+  };
+}
+
+class SpillGenerator {
+  int32 m_value;
+  int m_sleep_ms;
+public:
+  typedef SpillValue value_type;
+  SpillGenerator( int32 value, int sleep_ms ) : m_value(value), m_sleep_ms(sleep_ms) {}
+  size_t size() const { return 1; }
+  boost::shared_ptr<value_type> generate() const {
+    if( m_sleep_ms ) Thread::sleep_ms( m_sleep_ms );
+    return boost::shared_ptr<value_type>( new value_type(m_value) );
+  }
+};
+
+TEST(Cache, Spill) {
+  typedef Cache::Handle<SpillGenerator> handle_t;
+
+  vw::Cache cache(1);
+  cache.set_spill( TEST_OBJDIR, 1 );
+  EXPECT_EQ(1u, cache.max_spill_size());
+
+  handle_t slow = cache.insert(SpillGenerator(7, 20));
+  handle_t other = cache.insert(SpillGenerator(8, 20));
+  handle_t cheap = cache.insert(SpillGenerator(9, 0));
+
+  EXPECT_EQ(7, slow->value);
+  EXPECT_EQ(8, other->value); // Spills slow, which fills the spill tier
+  EXPECT_EQ(1u, cache.stats().spill_size);
+  EXPECT_EQ(7, slow->value);  // Reloads slow, and drops other
+  EXPECT_EQ(9, cheap->value); // Keeps slow on disk without writing it again
+  EXPECT_EQ(7, slow->value);
+
+  CacheStats stats = cache.stats();
+  EXPECT_EQ(1u, stats.total.spills);
+  EXPECT_EQ(2u, stats.total.reloads);
+  EXPECT_EQ(5u, stats.total.misses);
+  EXPECT_EQ(1u, stats.spill_size);
+  EXPECT_NE(std::string::npos, stats.report().find("Spilled to disk"));
+
+  // Other was not spilled, since the tier was full, so it is regenerated
+  EXPECT_EQ(8, other->value);
+  EXPECT_LT(0u, cache.stats().types[typeid(SpillGenerator).name()].regenerate_microseconds);
+
+  // Destroying a spilled line removes its file
+  slow.reset();
+  EXPECT_EQ(0u, cache.stats().spill_size);
+}
+
+TEST(Cache, SpillOff) {
+  typedef Cache::Handle<SpillGenerator> handle_t;
+
+  vw::Cache cache(1);
+  handle_t a = cache.insert(SpillGenerator(1, 20));
+  handle_t b = cache.insert(SpillGenerator(2, 20));
+  EXPECT_EQ(1, a->value);
+  EXPECT_EQ(2, b->value);
+  EXPECT_EQ(1, a->value);
+  EXPECT_EQ(0u, cache.stats().total.spills);
+  EXPECT_EQ(0u, cache.stats().total.reloads);
+}
@@ -0,0 +1,104 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+
+#include <vw/Core/Float16.h>
+#include <cmath>
+#include <vector>
+
+using namespace vw;
+
+TEST(Float16, Exact) {
+  EXPECT_EQ( 0.0f, float32(float16()) );
+  EXPECT_EQ( 1.0f, float32(float16(1)) );
+  EXPECT_EQ( -2.5f, float32(float16(-2.5)) );
+  EXPECT_EQ( 65504.0f, float32(float16(65504.0f)) );
+  EXPECT_EQ( 0x3c00, float16(1.0f).bits() );
+  EXPECT_EQ( 0xc000, float16(-2.0f).bits() );
+
+  // Every finite half converts to float and back unchanged
+  for ( uint32 bits = 0; bits < 0x10000; ++bits ) {
+    if ( (bits & 0x7c00) == 0x7c00 ) continue;
+    float16 h = float16::from_bits( uint16(bits) );
+    ASSERT_EQ( bits, float16( float32(h) ).bits() );
+  }
+}
+
+TEST(Float16, Rounding) {
+  // 2049 is halfway between 2048 and 2050, and rounds to even
+  EXPECT_EQ( 2048.0f, float32(float16(2049.0f)) );
+  EXPECT_EQ( 2052.0f, float32(float16(2051.0f)) );
+  EXPECT_EQ( 2050.0f, float32(float16(2049.5f)) );
+  EXPECT_EQ( 1.0f + 1.0f/1024, float32(float16(1.0f + 1.4f/1024)) );
+
+  // Denormals, and underflow to zero
+  float16 denorm_min = std::numeric_limits<float16>::denorm_min();
+  EXPECT_EQ( std::ldexp(1.0f,-24), float32(denorm_min) );
+  EXPECT_EQ( 0x0001, float16( std::ldexp(1.0f,-24) ).bits() );
+  EXPECT_EQ( 0x0003, float16( 3*std::ldexp(1.0f,-24) ).bits() );
+  EXPECT_EQ( 0x0000, float16( std::ldexp(1.0f,-26) ).bits() );
+  EXPECT_EQ( 0x8000, float16( -std::ldexp(1.0f,-26) ).bits() );
+}
+
+TEST(Float16, Special) {
+  float32 inf = std::numeric_limits<float32>::infinity();
+  EXPECT_EQ( 0x7c00, float16(inf).bits() );
+  EXPECT_EQ( 0xfc00, float16(-inf).bits() );
+  EXPECT_EQ( 0x7c00, float16(1e6f).bits() );
+  EXPECT_EQ( 0x7c00, float16(65520.0f).bits() );
+  EXPECT_EQ( inf, float32(std::numeric_limits<float16>::infinity()) );
+  float32 nan = float32(std::numeric_limits<float16>::quiet_NaN());
+  EXPECT_NE( nan, nan );
+  float16 h_nan( std::numeric_limits<float32>::quiet_NaN() );
+  EXPECT_NE( float32(h_nan), float32(h_nan) );
+}
+
+TEST(Float16, Limits) {
+  EXPECT_TRUE( std::numeric_limits<float16>::is_specialized );
+  EXPECT_EQ( 65504.0f, float32(std::numeric_limits<float16>::max()) );
+  EXPECT_EQ( std::ldexp(1.0f,-14), float32(std::numeric_limits<float16>::min()) );
+  EXPECT_EQ( std::ldexp(1.0f,-10), float32(std::numeric_limits<float16>::epsilon()) );
+  EXPECT_TRUE( IsScalar<float16>::value );
+  EXPECT_TRUE( IsFloatingPoint<float16>::value );
+  EXPECT_TRUE( IsFloatingPoint<float32>::value );
+  EXPECT_FALSE( IsFloatingPoint<int32>::value );
+}
+
+TEST(Float16, Arithmetic) {
+  float16 h = 1.5f;
+  h += 2;
+  EXPECT_EQ( 3.5f, float32(h) );
+  h *= 2;
+  EXPECT_EQ( 7.0f, float32(h) );
+  h -= 0.5;
+  h /= 2;
+  EXPECT_EQ( 3.25f, float32(h) );
+  EXPECT_EQ( 4.25f, h + 1 );
+}
+
+TEST(Float16, Bulk) {
+  // Bulk conversions agree with the scalar ones, including the tails
+  std::vector<float16> half( 0x10000 + 5 );
+  for ( size_t i = 0; i < half.size(); ++i )
+    half[i] = float16::from_bits( uint16(i) );
+  std::vector<float32> full( half.size() );
+  float16_to_float32( &half[0], &full[0], half.size() );
+  for ( size_t i = 0; i < half.size(); ++i ) {
+    float32 expected = half[i];
+    if ( expected != expected ) ASSERT_NE( full[i], full[i] );
+    else ASSERT_EQ( expected, full[i] ) << "bits " << i;
+  }
+
+  std::vector<float32> values( 1003 );
+  for ( size_t i = 0; i < values.size(); ++i )
+    values[i] = std::ldexp( float32(i) - 500.3f, int(i%41) - 30 );
+  std::vector<float16> packed( values.size() );
+  float32_to_float16( &values[0], &packed[0], values.size() );
+  for ( size_t i = 0; i < values.size(); ++i )
+    ASSERT_EQ( float16(values[i]).bits(), packed[i].bits() ) << values[i];
+}
@@ -140,6 +140,25 @@ TEST(Log, RuleSet) {
   EXPECT_TRUE( all(v, "any.all"));
 }
 
+TEST(Log, RuleSetMaxLevel) {
+  LogRuleSet rs;
+  EXPECT_EQ( InfoMessage, rs.max_level() );
+  rs.add_rule(ErrorMessage, "quiet");
+  EXPECT_EQ( InfoMessage, rs.max_level() );
+  rs.add_rule(DebugMessage, "image");
+  EXPECT_EQ( DebugMessage, rs.max_level() );
+  EXPECT_FALSE( rs(rs.max_level()+1, "image") );
+
+  LogRuleSet copy(rs);
+  EXPECT_EQ( DebugMessage, copy.max_level() );
+  copy.add_rule(EveryMessage, "every");
+  EXPECT_TRUE( copy(copy.max_level(), "every") );
+  EXPECT_TRUE( copy(VerboseDebugMessage+1, "every") );
+
+  copy.clear();
+  EXPECT_EQ( InfoMessage, copy.max_level() );
+}
+
 TEST(Log, RuleSetIllegal) {
   LogRuleSet rs;
   EXPECT_THROW(rs.add_rule(VerboseDebugMessage, "*.foo.*"), vw::ArgumentErr);
@@ -218,6 +237,57 @@ TEST(Log, MultiThreadLog) {
   EXPECT_FALSE(rd);
 }
 
+TEST(Log, AsynchronousLog) {
+  std::ostringstream stream;
+  {
+    LogInstance log(stream, false, true);
+    log.rule_set().add_rule(EveryMessage, "log test");
+
+    typedef boost::shared_ptr<TestLogTask> TheTask;
+    typedef boost::shared_ptr<Thread>  TheThread;
+    std::vector<std::pair<TheTask, TheThread> > threads(20);
+    for (size_t i = 0; i < threads.size(); ++i) {
+      TheTask task( new TestLogTask(log,"log test") );
+      threads[i] = std::make_pair(task, TheThread( new Thread(task) ));
+    }
+    Thread::sleep_ms(100);
+    for (size_t i = 0; i < threads.size(); ++i)
+      threads[i].first->kill();
+    for (size_t i = 0; i < threads.size(); ++i)
+      threads[i].second->join();
+
+    // Whole lines only, until the stream is flushed
+    log(InfoMessage,"log test") << "Partial";
+    log.flush();
+    EXPECT_EQ( '\n', stream.str()[stream.str().size()-1] );
+    log(InfoMessage,"log test") << std::flush;
+    log.flush();
+    EXPECT_TRUE( boost::ends_with(stream.str(), "\nPartial") );
+  }
+
+  std::istringstream rd(stream.str());
+  std::string typ;
+  int id;
+  std::map<int, std::string> status;
+  while (rd >> typ && rd >> id) {
+    if (typ == "Start") {
+      EXPECT_FALSE(status.count(id));
+      status[id] = "Start";
+    }
+    else if (typ == "Tick") {
+      ASSERT_TRUE(status.count(id));
+      EXPECT_EQ( "Start", status[id] );
+    }
+    else if (typ == "Stop") {
+      ASSERT_TRUE(status.count(id));
+      status[id] = "Stop";
+    }
+    else if (typ != "Partial")
+      FAIL() << "Unknown message [" << typ << "]";
+  }
+  EXPECT_EQ( 20u, status.size() );
+}
+
 TEST(Log, SystemLog) {
 
   const std::string
@@ -257,12 +327,12 @@ TEST(Log, SystemLog) {
   EXPECT_EQ(s2, lines[1]);
   // Technically, 2 and 3 can arrive in any order, but in practice, it's the order the rules were added
   EXPECT_EQ(s3, lines[2]);
-  EXPECT_EQ(s3, lines[3].substr(35)); // remove log prefix
+  EXPECT_EQ(s3, lines[3].substr(lines[3].find("] : ")+4)); // remove log prefix
   EXPECT_EQ(s4, lines[4]);
   EXPECT_EQ("", lines[5]);
 
   ASSERT_EQ(2u, lines2.size());
-  EXPECT_EQ(s3, lines2[0].substr(35)); // remove log prefix
+  EXPECT_EQ(s3, lines2[0].substr(lines2[0].find("] : ")+4)); // remove log prefix
   EXPECT_EQ("", lines2[1]);
 }
 
@@ -309,6 +379,52 @@ TEST(Log, HiresProgressCallback) {
   EXPECT_THROW(TerminalProgressCallback("monkey","monkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkey"), ArgumentErr );
 }
 
+struct CountingProgressCallback : public ProgressCallback {
+  mutable int m_reports;
+  CountingProgressCallback() : m_reports(0) {}
+  virtual void report_progress(double progress) const {
+    Mutex::Lock lock(m_mutex);
+    m_progress = progress;
+    ++m_reports;
+  }
+};
+
+struct TickTask {
+  ProgressCallback const& m_progress;
+  int m_ticks;
+  double m_tick;
+  TickTask(ProgressCallback const& progress, int ticks, double tick) : m_progress(progress), m_ticks(ticks), m_tick(tick) {}
+  void operator()() {
+    for (int i = 0; i < m_ticks; ++i)
+      m_progress.report_incremental_progress(m_tick);
+  }
+};
+
+TEST(Log, AtomicProgressCallback) {
+  CountingProgressCallback parent;
+  AtomicProgressCallback pc(parent, 0.01, 0);
+
+  const int num_threads = 8, ticks = 10000;
+  std::vector<boost::shared_ptr<Thread> > threads;
+  for (int i = 0; i < num_threads; ++i)
+    threads.push_back(boost::shared_ptr<Thread>(new Thread(TickTask(pc, ticks, 1.0/(num_threads*ticks)))));
+  for (int i = 0; i < num_threads; ++i)
+    threads[i]->join();
+
+  EXPECT_NEAR( 1.0, pc.progress(), 1e-6 );
+  // Each report moved the parent by at least min_step
+  EXPECT_GT( parent.m_reports, 0 );
+  EXPECT_LE( parent.m_reports, 100 );
+
+  pc.flush();
+  EXPECT_NEAR( 1.0, parent.progress(), 1e-6 );
+
+  EXPECT_FALSE( pc.abort_requested() );
+  pc.request_abort();
+  EXPECT_TRUE( pc.abort_requested() );
+  EXPECT_TRUE( parent.abort_requested() );
+}
+
 TEST(Log, ProgressHide) {
 
   std::ostringstream sstr;
@@ -0,0 +1,106 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <vw/Core/MemoryGovernor.h>
+#include <vw/Core/Cache.h>
+#include <vw/Core/Settings.h>
+
+#include <boost/shared_array.hpp>
+
+using namespace vw;
+
+namespace {
+  // Generates 1-byte blocks of the given size.
+  class ByteGenerator {
+    size_t m_size;
+  public:
+    typedef vw::uint8 value_type;
+    ByteGenerator( size_t size ) : m_size(size) {}
+    size_t size() const { return m_size; }
+    boost::shared_ptr<value_type> generate() const {
+      return boost::shared_ptr<value_type>( new value_type[m_size], boost::checked_array_deleter<value_type>() );
+    }
+  };
+}
+
+TEST(MemoryGovernor, Disabled) {
+  MemoryGovernor governor;
+  EXPECT_FALSE( governor.enabled() );
+  EXPECT_EQ( 0u, governor.reserve( 100 ) );
+  EXPECT_EQ( 0u, governor.stats().transient );
+}
+
+TEST(MemoryGovernor, Peaks) {
+  MemoryGovernor governor;
+  governor.set_tracking( true );
+  ASSERT_TRUE( governor.enabled() );
+
+  size_t a = governor.reserve( 100 );
+  size_t b = governor.reserve( 50 );
+  EXPECT_EQ( 100u, a );
+  EXPECT_EQ( 50u, b );
+  governor.cache_allocated( 30 );
+  governor.release( a );
+
+  MemoryStats stats = governor.stats();
+  EXPECT_EQ( 50u, stats.transient );
+  EXPECT_EQ( 30u, stats.cache );
+  EXPECT_EQ( 150u, stats.peak_transient );
+  EXPECT_EQ( 30u, stats.peak_cache );
+  EXPECT_EQ( 180u, stats.peak_total );
+
+  governor.reset_peaks();
+  EXPECT_EQ( 80u, governor.stats().peak_total );
+  governor.release( b );
+  governor.cache_deallocated( 30 );
+  EXPECT_EQ( 0u, governor.stats().transient + governor.stats().cache );
+}
+
+TEST(MemoryGovernor, Overrun) {
+  MemoryGovernor governor;
+  governor.set_limit( 100 );
+  governor.set_max_wait( 10 );
+
+  size_t a = governor.reserve( 80 );
+  EXPECT_EQ( 0u, governor.stats().overruns );
+  // Nothing else will release memory, so this wait times out and the
+  // reservation is granted anyway.
+  size_t b = governor.reserve( 80 );
+  EXPECT_EQ( 80u, b );
+  MemoryStats stats = governor.stats();
+  EXPECT_EQ( 1u, stats.waits );
+  EXPECT_EQ( 1u, stats.overruns );
+  EXPECT_EQ( 160u, stats.peak_total );
+  governor.release( a );
+  governor.release( b );
+}
+
+TEST(MemoryGovernor, CacheLimit) {
+  // The cache alone would hold all four lines; the governor's limit
+  // only leaves room for two of them.
+  Cache cache( 4000 );
+  std::vector<Cache::Handle<ByteGenerator> > handles;
+  for( int i = 0; i < 4; ++i )
+    handles.push_back( cache.insert( ByteGenerator( 1000 ) ) );
+
+  vw_settings().set_memory_limit( 2000 );
+  EXPECT_EQ( 2000u, vw_memory_governor().limit() );
+  for( int i = 0; i < 4; ++i )
+    *handles[i];
+  EXPECT_EQ( 2000u, cache.stats().size );
+  EXPECT_EQ( 2u, cache.stats().total.evictions );
+  EXPECT_EQ( 2000u, vw_memory_governor().stats().cache );
+
+  cache.trim( 1000 );
+  EXPECT_EQ( 1000u, cache.stats().size );
+  EXPECT_EQ( 1000u, vw_memory_governor().stats().cache );
+
+  vw_settings().set_memory_limit( 0 );
+  cache.trim( 0 );
+  EXPECT_EQ( 0u, vw_memory_governor().stats().cache );
+}
@@ -8,6 +8,7 @@
 #include <gtest/gtest.h>
 
 #include <vw/Core/ThreadPool.h>
+#include <vw/Core/Numa.h>
 
 #include <iostream>
 
@@ -212,3 +213,118 @@ TEST(ThreadPool, OrderedWorkQueue) {
 
   queue.join_all();
 }
+
+class CountTask : public Task, private boost::noncopyable {
+  Mutex& m_mutex;
+  int& m_count;
+public:
+  CountTask(Mutex& mutex, int& count) : m_mutex(mutex), m_count(count) {}
+  void operator()() {
+    Mutex::Lock lock(m_mutex);
+    m_count++;
+  }
+};
+
+TEST(ThreadPool, WorkStealingQueue) {
+  Mutex mutex;
+  int count = 0;
+
+  WorkStealingQueue queue(4);
+  EXPECT_EQ( 4, queue.max_threads() );
+  for (int i = 0; i < 1000; ++i)
+    queue.add_task(boost::shared_ptr<Task>(new CountTask(mutex, count)));
+  queue.join_all();
+
+  EXPECT_EQ( 1000, count );
+  EXPECT_EQ( 0u, queue.size() );
+  EXPECT_EQ( 0, queue.active_threads() );
+}
+
+// A task that recursively splits itself into two subtasks and waits
+// for them, like a nested rasterization would.
+class SplitTask : public Task, private boost::noncopyable {
+  WorkStealingQueue& m_queue;
+  int m_depth;
+  Mutex& m_mutex;
+  int& m_leaves;
+public:
+  SplitTask(WorkStealingQueue& queue, int depth, Mutex& mutex, int& leaves)
+    : m_queue(queue), m_depth(depth), m_mutex(mutex), m_leaves(leaves) {}
+  void operator()() {
+    if (m_depth == 0) {
+      Mutex::Lock lock(m_mutex);
+      m_leaves++;
+      return;
+    }
+    boost::shared_ptr<Task> a(new SplitTask(m_queue, m_depth-1, m_mutex, m_leaves));
+    boost::shared_ptr<Task> b(new SplitTask(m_queue, m_depth-1, m_mutex, m_leaves));
+    m_queue.add_task(a);
+    m_queue.add_task(b);
+    m_queue.wait(a);
+    m_queue.wait(b);
+  }
+};
+
+TEST(ThreadPool, WorkStealingNested) {
+  Mutex mutex;
+  int leaves = 0;
+
+  // Far more waiting tasks than threads: this deadlocks unless waiting
+  // workers help out.
+  WorkStealingQueue queue(2);
+  boost::shared_ptr<Task> root(new SplitTask(queue, 8, mutex, leaves));
+  queue.add_task(root);
+  queue.wait(root);
+  queue.join_all();
+
+  EXPECT_EQ( 256, leaves );
+  EXPECT_TRUE( root->is_finished() );
+}
+
+// Records the NUMA node of the worker that runs it.
+class NodeTask : public Task, private boost::noncopyable {
+public:
+  int m_node;
+  NodeTask() : m_node(-2) {}
+  void operator()() { m_node = vw_numa_thread_node(); }
+};
+
+TEST(ThreadPool, WorkStealingNuma) {
+  int nodes = vw_numa_num_nodes();
+  ASSERT_GE( nodes, 1 );
+
+  WorkStealingQueue queue(4, true);
+  for (size_t i = 0; i < 4; ++i) {
+    if (nodes == 1)
+      EXPECT_EQ( -1, queue.worker_node(i) );
+    else {
+      EXPECT_GE( queue.worker_node(i), 0 );
+      EXPECT_LT( queue.worker_node(i), nodes );
+    }
+  }
+
+  std::vector<boost::shared_ptr<NodeTask> > tasks;
+  for (int i = 0; i < 100; ++i) {
+    tasks.push_back(boost::shared_ptr<NodeTask>(new NodeTask()));
+    queue.add_task(tasks.back());
+  }
+  queue.join_all();
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    EXPECT_GE( tasks[i]->m_node, -1 );
+    EXPECT_LT( tasks[i]->m_node, nodes );
+  }
+
+  // The test thread itself is never bound.
+  EXPECT_EQ( -1, vw_numa_thread_node() );
+}
+
+TEST(ThreadPool, SystemThreadPool) {
+  Mutex mutex;
+  int count = 0;
+  WorkStealingQueue& queue = vw_thread_pool();
+  EXPECT_EQ( &queue, &vw_thread_pool() );
+  boost::shared_ptr<Task> task(new CountTask(mutex, count));
+  queue.add_task(task);
+  queue.wait(task);
+  EXPECT_EQ( 1, count );
+}
@@ -73,3 +73,104 @@ TEST(ThreadQueue, Threaded) {
     EXPECT_EQ(10u, ret[i]);
   }
 }
+
+TEST(ThreadQueue, PopBatch) {
+  ThreadQueue<uint32> q;
+  for (uint32 i = 0; i < 10; ++i)
+    q.push(i);
+
+  std::vector<uint32> batch;
+  EXPECT_EQ(4u, q.pop_batch(batch, 4));
+  EXPECT_EQ(6u, q.pop_batch(batch, 100));
+  EXPECT_EQ(0u, q.pop_batch(batch, 100));
+  ASSERT_EQ(10u, batch.size());
+  for (uint32 i = 0; i < 10; ++i)
+    EXPECT_EQ(i, batch[i]);
+}
+
+TEST(BoundedThreadQueue, Basic) {
+  BoundedThreadQueue<uint32> q(5);
+  EXPECT_EQ(8u, q.capacity());
+  ASSERT_TRUE(q.empty());
+
+  for (uint32 i = 0; i < 8; ++i)
+    EXPECT_TRUE(q.try_push(i));
+  EXPECT_FALSE(q.try_push(8));
+  EXPECT_EQ(8u, q.size());
+
+  uint32 pop;
+  EXPECT_TRUE(q.timed_wait_pop(pop, 0));
+  EXPECT_EQ(0u, pop);
+
+  std::vector<uint32> batch;
+  EXPECT_EQ(3u, q.pop_batch(batch, 3));
+  EXPECT_EQ(3u, batch[2]);
+
+  // The ring wraps around.
+  for (uint32 i = 8; i < 12; ++i)
+    q.push(i);
+  for (uint32 i = 4; i < 12; ++i) {
+    q.wait_pop(pop);
+    EXPECT_EQ(i, pop);
+  }
+  EXPECT_FALSE(q.timed_wait_pop(pop, 10));
+
+  q.push(1);
+  q.flush();
+  EXPECT_TRUE(q.empty());
+}
+
+namespace {
+  class BoundedPushTask {
+      BoundedThreadQueue<uint32>& m_queue;
+      uint32 m_count, m_value;
+    public:
+      BoundedPushTask(BoundedThreadQueue<uint32>& q, uint32 count, uint32 value) : m_queue(q), m_count(count), m_value(value) {}
+      void operator()() {
+        for (uint32 i = 0; i < m_count; ++i)
+          m_queue.push(m_value);
+      }
+  };
+
+  class BoundedPopTask {
+      BoundedThreadQueue<uint32>& m_queue;
+      uint32 m_count;
+    public:
+      std::vector<uint32> m_seen;
+      BoundedPopTask(BoundedThreadQueue<uint32>& q, uint32 count, uint32 values) : m_queue(q), m_count(count), m_seen(values) {}
+      void operator()() {
+        uint32 value;
+        for (uint32 i = 0; i < m_count; ++i) {
+          m_queue.wait_pop(value);
+          m_seen[value]++;
+        }
+      }
+  };
+}
+
+TEST(BoundedThreadQueue, Threaded) {
+  // A small ring, so that producers and consumers both have to wait.
+  BoundedThreadQueue<uint32> q(4);
+  const uint32 producers = 8, consumers = 4, count = 1000;
+
+  std::vector<boost::shared_ptr<BoundedPopTask> > pop_tasks;
+  std::vector<boost::shared_ptr<Thread> > threads;
+  for (uint32 i = 0; i < consumers; ++i) {
+    pop_tasks.push_back(boost::shared_ptr<BoundedPopTask>(new BoundedPopTask(q, producers*count/consumers, producers)));
+    threads.push_back(boost::shared_ptr<Thread>(new Thread(pop_tasks.back())));
+  }
+  for (uint32 i = 0; i < producers; ++i) {
+    boost::shared_ptr<BoundedPushTask> task(new BoundedPushTask(q, count, i));
+    threads.push_back(boost::shared_ptr<Thread>(new Thread(task)));
+  }
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i]->join();
+
+  EXPECT_TRUE(q.empty());
+  for (uint32 v = 0; v < producers; ++v) {
+    uint32 total = 0;
+    for (uint32 i = 0; i < consumers; ++i)
+      total += pop_tasks[i]->m_seen[v];
+    EXPECT_EQ(count, total);
+  }
+}
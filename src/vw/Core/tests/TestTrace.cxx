@@ -0,0 +1,130 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+#include <vw/Core/Trace.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+#include <test/Helpers.h>
+
+using namespace vw;
+
+namespace {
+  TraceEvent make_event( const char *stage, uint64 duration, uint64 bytes, TraceCacheResult cache ) {
+    TraceEvent e;
+    e.stage = stage;
+    e.type = typeid(int).name();
+    e.thread = Thread::id();
+    e.start = 100;
+    e.duration = duration;
+    e.bytes = bytes;
+    e.cache = cache;
+    return e;
+  }
+
+  class RecordTask : public Task {
+    Tracer& m_tracer;
+  public:
+    RecordTask( Tracer& tracer ) : m_tracer(tracer) {}
+    virtual void operator()() {
+      for( int i = 0; i < 100; ++i )
+        m_tracer.record( make_event( "task", 1, 0, TRACE_CACHE_NONE ) );
+    }
+  };
+}
+
+TEST(Trace, Enable) {
+  Tracer tracer;
+  EXPECT_FALSE( tracer.enabled() );
+  tracer.set_summary( true );
+  EXPECT_TRUE( tracer.enabled() );
+  tracer.set_summary( false );
+  tracer.set_output_file( "trace.json" );
+  EXPECT_TRUE( tracer.enabled() );
+  tracer.set_output_file( "" );
+  EXPECT_FALSE( tracer.enabled() );
+}
+
+TEST(Trace, Settings) {
+  EXPECT_FALSE( vw_tracer().enabled() );
+  vw_settings().set_trace_summary( true );
+  EXPECT_TRUE( vw_tracer().summary() );
+  {
+    ScopedTrace trace( "Settings" );
+    EXPECT_TRUE( trace.active() );
+  }
+  EXPECT_EQ( 1u, vw_tracer().events().size() );
+  vw_settings().set_trace_summary( false );
+  vw_tracer().clear();
+  {
+    ScopedTrace trace( "Settings" );
+    EXPECT_FALSE( trace.active() );
+  }
+  EXPECT_EQ( 0u, vw_tracer().events().size() );
+}
+
+TEST(Trace, Threads) {
+  Tracer tracer;
+  FifoWorkQueue queue(4);
+  for( int i = 0; i < 8; ++i )
+    queue.add_task( boost::shared_ptr<Task>( new RecordTask( tracer ) ) );
+  queue.join_all();
+  EXPECT_EQ( 800u, tracer.events().size() );
+  tracer.clear();
+  EXPECT_EQ( 0u, tracer.events().size() );
+}
+
+TEST(Trace, Report) {
+  Tracer tracer;
+  tracer.record( make_event( "slow", 3000000, 10, TRACE_CACHE_MISS ) );
+  tracer.record( make_event( "slow", 1000000, 10, TRACE_CACHE_HIT ) );
+  tracer.record( make_event( "fast", 1000, 0, TRACE_CACHE_NONE ) );
+
+  std::string report = tracer.report();
+  size_t slow = report.find( "slow" ), fast = report.find( "fast" );
+  ASSERT_NE( std::string::npos, slow );
+  ASSERT_NE( std::string::npos, fast );
+  EXPECT_LT( slow, fast );
+  EXPECT_NE( std::string::npos, report.find( "x 2" ) );
+  EXPECT_NE( std::string::npos, report.find( "20 bytes" ) );
+  EXPECT_NE( std::string::npos, report.find( "1 hits / 1 misses" ) );
+}
+
+TEST(Trace, ChromeTrace) {
+  Tracer tracer;
+  tracer.record( make_event( "stage", 5, 42, TRACE_CACHE_HIT ) );
+
+  std::ostringstream out;
+  tracer.write_chrome_trace( out );
+  std::string json = out.str();
+  EXPECT_EQ( 0u, json.find( "{\"traceEvents\":[" ) );
+  EXPECT_NE( std::string::npos, json.find( "\"cat\":\"stage\"" ) );
+  EXPECT_NE( std::string::npos, json.find( "\"ph\":\"X\"" ) );
+  EXPECT_NE( std::string::npos, json.find( "\"ts\":0,\"dur\":5" ) );
+  EXPECT_NE( std::string::npos, json.find( "\"bytes\":42" ) );
+  EXPECT_NE( std::string::npos, json.find( "\"cache\":\"hit\"" ) );
+}
+
+TEST(Trace, Startup) {
+  size_t before = startup_trace_events().size();
+  {
+    ScopedStartupTrace trace( "TestTrace::startup_step" );
+  }
+  std::vector<TraceEvent> startup = startup_trace_events();
+  ASSERT_EQ( before + 1, startup.size() );
+  EXPECT_STREQ( "TestTrace::startup_step", startup.back().stage );
+
+  // Recorded without tracing, and reported by every tracer
+  Tracer tracer;
+  EXPECT_EQ( 0u, tracer.events().size() );
+  std::string report = tracer.report();
+  size_t section = report.find( "Startup (" );
+  ASSERT_NE( std::string::npos, section );
+  EXPECT_LT( section, report.find( "TestTrace::startup_step" ) );
+}
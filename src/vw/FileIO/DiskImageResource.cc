@@ -23,14 +23,19 @@
 #include <map>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/convenience.hpp>
+#include <boost/scoped_ptr.hpp>
 namespace fs = boost::filesystem;
 
 // For RunOnce
 #include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Core/Trace.h>
 
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/FileIO/DiskImageResourcePDS.h>
 #include <vw/FileIO/DiskImageResourcePBM.h>
+#include <vw/FileIO/DiskImageResourceRaw.h>
+#include <vw/FileIO/DiskImageResourceVWT.h>
 
 #if defined(VW_HAVE_PKG_PNG) && VW_HAVE_PKG_PNG==1
 #include <vw/FileIO/DiskImageResourcePNG.h>
@@ -56,19 +61,29 @@ namespace fs = boost::filesystem;
 
 #include <vw/FileIO/DiskImageResource_internal.h>
 
-static void register_default_file_types_impl();
 namespace {
   typedef std::map<std::string,vw::DiskImageResource::construct_open_func> OpenMapType;
   typedef std::map<std::string,vw::DiskImageResource::construct_create_func> CreateMapType;
   OpenMapType *open_map = 0;
   CreateMapType *create_map = 0;
-
-  // This extra class helps to ensure that register_file_type() is only run once.
-  vw::RunOnce rdft_once = VW_RUNONCE_INIT;
-  void register_default_file_types_internal() {
-    rdft_once.run( register_default_file_types_impl );
+  // The extensions whose driver has been decided, whether or not one
+  // was found.  This includes every extension registered explicitly,
+  // so that a default never replaces it.
+  std::set<std::string> *resolved_set = 0;
+  vw::Mutex *registry_mutex = 0;
+
+  vw::RunOnce registry_once = VW_RUNONCE_INIT;
+  void init_registry() {
+    open_map = new OpenMapType();
+    create_map = new CreateMapType();
+    resolved_set = new std::set<std::string>();
+    registry_mutex = new vw::Mutex();
   }
 
+  // The extensions that have a default driver
+  const char* default_extensions[] = { ".img", ".pds", ".lbl", ".png", ".jpg", ".jpeg", ".jp2", ".j2k",
+                                       ".tif", ".tiff", ".exr", ".pbm", ".pgm", ".ppm", ".vwr", ".vwt" };
+
   // this one avoids calling the registration function, so it can be called
   // from INSIDE the registration function.
   void register_file_type_internal( std::string const& extension,
@@ -80,6 +95,44 @@ namespace {
     (*open_map)[extension]   = open_func;
     (*create_map)[extension] = create_func;
   }
+
+  void register_default_file_type( std::string const& extension );
+
+  // Registers the default driver for an extension the first time it
+  // is looked up, so that a tool only pays for the drivers it uses.
+  // In particular, GDAL is only initialized once an extension it may
+  // handle is looked up.  The registry lock must be held.
+  void resolve_file_type_locked( std::string const& extension ) {
+    if( resolved_set->count( extension ) ) return;
+    resolved_set->insert( extension );
+    vw::ScopedStartupTrace trace( "DiskImageResource::resolve_file_type" );
+    register_default_file_type( extension );
+  }
+
+  void resolve_default_file_types_locked() {
+    for( size_t i = 0; i < sizeof(default_extensions) / sizeof(default_extensions[0]); ++i )
+      resolve_file_type_locked( default_extensions[i] );
+  }
+
+  bool find_open_func( std::string const& extension, vw::DiskImageResource::construct_open_func& func ) {
+    registry_once.run( init_registry );
+    vw::Mutex::Lock lock( *registry_mutex );
+    resolve_file_type_locked( extension );
+    OpenMapType::const_iterator i = open_map->find( extension );
+    if( i == open_map->end() ) return false;
+    func = i->second;
+    return true;
+  }
+
+  bool find_create_func( std::string const& extension, vw::DiskImageResource::construct_create_func& func ) {
+    registry_once.run( init_registry );
+    vw::Mutex::Lock lock( *registry_mutex );
+    resolve_file_type_locked( extension );
+    CreateMapType::const_iterator i = create_map->find( extension );
+    if( i == create_map->end() ) return false;
+    func = i->second;
+    return true;
+  }
 }
 
 bool vw::DiskImageResource::default_rescale = true;
@@ -97,13 +150,19 @@ namespace vw {
 
 void foreach_ext(std::string const& prefix, ExtTestFunction const& callback, std::set<std::string> const& exclude)
 {
-  OpenMapType::const_iterator oi;
-  register_default_file_types_internal();
+  std::vector<std::string> extensions;
+  {
+    registry_once.run( init_registry );
+    Mutex::Lock lock( *registry_mutex );
+    resolve_default_file_types_locked();
+    for (OpenMapType::const_iterator oi = open_map->begin(); oi != open_map->end(); ++oi)
+      extensions.push_back(oi->first);
+  }
 
-  for (oi = open_map->begin(); oi != open_map->end(); ++oi)
+  for (size_t i = 0; i < extensions.size(); ++i)
   {
-    if (exclude.find(oi->first.substr(1)) == exclude.end())
-      callback(prefix + oi->first);
+    if (exclude.find(extensions[i].substr(1)) == exclude.end())
+      callback(prefix + extensions[i]);
   }
 }
 
@@ -114,106 +173,104 @@ void vw::DiskImageResource::register_file_type( std::string const& extension,
                                                 vw::DiskImageResource::construct_open_func open_func,
                                                 vw::DiskImageResource::construct_create_func create_func )
 {
-  register_default_file_types_internal();
+  registry_once.run( init_registry );
+  Mutex::Lock lock( *registry_mutex );
 
-  // Add the file to the list
-  register_file_type_internal(boost::to_lower_copy(extension), disk_image_resource_type, open_func, create_func);
+  // Add the file to the list, in place of any default
+  std::string ext = boost::to_lower_copy(extension);
+  resolved_set->insert(ext);
+  register_file_type_internal(ext, disk_image_resource_type, open_func, create_func);
 }
 
-static void register_default_file_types_impl() {
-
-  if( ! open_map ) open_map = new OpenMapType();
-  if( ! create_map ) create_map = new CreateMapType();
+namespace {
+void register_default_file_type( std::string const& ext ) {
 
 // Let's cut the verbosity of this func just a bit.
-#define REGISTER(ext, driver) register_file_type_internal( ext, vw::DiskImageResource ## driver::type_static(), &vw::DiskImageResource ## driver::construct_open, &vw::DiskImageResource ## driver::construct_create );
+#define REGISTER(driver) { register_file_type_internal( ext, vw::DiskImageResource ## driver::type_static(), &vw::DiskImageResource ## driver::construct_open, &vw::DiskImageResource ## driver::construct_create ); return; }
 
-  // Give GDAL precedence in reading PDS images when this is supported.
+  if (ext == ".img" || ext == ".pds" || ext == ".lbl") {
+    // Give GDAL precedence in reading PDS images when this is supported.
 #if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
-  if (vw::DiskImageResourceGDAL::gdal_has_support(".img") &&
-      vw::DiskImageResourceGDAL::gdal_has_support(".pds") &&
-      vw::DiskImageResourceGDAL::gdal_has_support(".lbl")) {
-
-    REGISTER(".img", GDAL)
-    REGISTER(".pds", GDAL)
-    REGISTER(".lbl", GDAL)
-  } else {
+    if (vw::DiskImageResourceGDAL::gdal_has_support(".img") &&
+        vw::DiskImageResourceGDAL::gdal_has_support(".pds") &&
+        vw::DiskImageResourceGDAL::gdal_has_support(".lbl"))
+      REGISTER(GDAL)
 #endif
-  REGISTER(".img", PDS)
-  REGISTER(".pds", PDS)
-  REGISTER(".lbl", PDS)
-#if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
+    REGISTER(PDS)
   }
-#endif
 
+  if (ext == ".png") {
 #if defined(VW_HAVE_PKG_PNG) && VW_HAVE_PKG_PNG==1
-  REGISTER(".png", PNG)
+    REGISTER(PNG)
 #elif defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
-  if (vw::DiskImageResourceGDAL::gdal_has_support(".png"))
-    REGISTER(".png", GDAL)
-  else
+    if (vw::DiskImageResourceGDAL::gdal_has_support(".png"))
+      REGISTER(GDAL)
     vw::vw_throw(vw::IOErr() << "GDAL does not have PNG support.");
 #endif
+    return;
+  }
 
+  if (ext == ".jpg" || ext == ".jpeg") {
 #if defined(VW_HAVE_PKG_JPEG) && VW_HAVE_PKG_JPEG==1
-  REGISTER(".jpg", JPEG)
-  REGISTER(".jpeg", JPEG)
+    REGISTER(JPEG)
 #elif defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
-  if (vw::DiskImageResourceGDAL::gdal_has_support(".jpg"))
-    REGISTER(".jpg", GDAL)
-  if (vw::DiskImageResourceGDAL::gdal_has_support(".jpeg"))
-    REGISTER(".jpeg", GDAL)
+    if (vw::DiskImageResourceGDAL::gdal_has_support(ext))
+      REGISTER(GDAL)
 #endif
+    return;
+  }
 
+  if (ext == ".jp2" || ext == ".j2k") {
 #if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
-  if (vw::DiskImageResourceGDAL::gdal_has_support(".jp2"))
-    REGISTER(".jp2", GDAL)
-  if (vw::DiskImageResourceGDAL::gdal_has_support(".j2k"))
-    REGISTER(".j2k", GDAL)
+    if (vw::DiskImageResourceGDAL::gdal_has_support(ext))
+      REGISTER(GDAL)
 #endif
+    return;
+  }
 
-// This is a little hackish but it makes it so libtiff acts as a proper fallback
+  // This is a little hackish but it makes it so libtiff acts as a proper fallback
+  if (ext == ".tif" || ext == ".tiff") {
 #if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
-  if (vw::DiskImageResourceGDAL::gdal_has_support(".tif") && vw::DiskImageResourceGDAL::gdal_has_support(".tiff")) {
-    REGISTER(".tif", GDAL)
-    REGISTER(".tiff", GDAL)
-  } else {
+    if (vw::DiskImageResourceGDAL::gdal_has_support(".tif") && vw::DiskImageResourceGDAL::gdal_has_support(".tiff"))
+      REGISTER(GDAL)
 #endif
 #if defined(VW_HAVE_PKG_TIFF) && VW_HAVE_PKG_TIFF==1
-    REGISTER(".tif", TIFF)
-    REGISTER(".tiff", TIFF)
+    REGISTER(TIFF)
 #endif
-#if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
+    return;
   }
-#endif
 
 #if defined(VW_HAVE_PKG_OPENEXR) && VW_HAVE_PKG_OPENEXR==1
-  REGISTER(".exr", OpenEXR)
+  if (ext == ".exr")
+    REGISTER(OpenEXR)
 #endif
 
   // Filetypes that are always supported
-  REGISTER(".pbm", PBM)
-  REGISTER(".pgm", PBM)
-  REGISTER(".ppm", PBM)
+  if (ext == ".pbm" || ext == ".pgm" || ext == ".ppm")
+    REGISTER(PBM)
+  if (ext == ".vwr")
+    REGISTER(Raw)
+  if (ext == ".vwt")
+    REGISTER(VWT)
 #undef REGISTER
 }
+}
 
 // Kill this function eventually.. it's marked as deprecated now.
 void vw::DiskImageResource::register_default_file_types() {
-  register_default_file_types_internal();
+  registry_once.run( init_registry );
+  Mutex::Lock lock( *registry_mutex );
+  resolve_default_file_types_locked();
 }
 
 vw::DiskImageResource* vw::DiskImageResource::open( std::string const& filename ) {
-  register_default_file_types_internal();
   std::string extension = boost::to_lower_copy(fs::extension(filename));
 
-  if( open_map ) {
-    OpenMapType::iterator i = open_map->find( extension );
-    if( i != open_map->end() ) {
-      DiskImageResource* rsrc = i->second( filename );
-      VW_OUT(DebugMessage,"fileio") << "Produce DiskImageResource of type: " << rsrc->type() << "\n";
-      return rsrc;
-    }
+  construct_open_func open_func;
+  if( find_open_func( extension, open_func ) ) {
+    DiskImageResource* rsrc = open_func( filename );
+    VW_OUT(DebugMessage,"fileio") << "Produce DiskImageResource of type: " << rsrc->type() << "\n";
+    return rsrc;
   }
 
   // GDAL has support for many useful file formats, and we fall back
@@ -230,15 +287,74 @@ vw::DiskImageResource* vw::DiskImageResource::open( std::string const& filename
   return 0; // never reached
 }
 
+namespace {
+  // Opens one file of a batch, keeping the error rather than letting
+  // it escape the worker thread.
+  class OpenTask : public vw::Task {
+    std::string const& m_filename;
+    boost::shared_ptr<vw::DiskImageResource>& m_resource;
+    std::string& m_error;
+  public:
+    OpenTask( std::string const& filename, boost::shared_ptr<vw::DiskImageResource>& resource, std::string& error )
+      : m_filename(filename), m_resource(resource), m_error(error) {}
+    virtual void operator()() {
+      try {
+        m_resource.reset( vw::DiskImageResource::open( m_filename ) );
+      } catch( std::exception const& e ) {
+        m_error = e.what();
+      }
+    }
+  };
+}
+
+std::vector<boost::shared_ptr<vw::DiskImageResource> >
+vw::DiskImageResource::open( std::vector<std::string> const& filenames, int32 concurrency ) {
+  std::vector<boost::shared_ptr<DiskImageResource> > resources( filenames.size() );
+  std::vector<std::string> errors( filenames.size() );
+
+  if( concurrency <= 0 )
+    concurrency = vw_settings().default_num_threads();
+  if( size_t(concurrency) > filenames.size() )
+    concurrency = int32( filenames.size() );
+
+  if( concurrency > 0 ) {
+    FifoWorkQueue queue( concurrency );
+    for( size_t i = 0; i < filenames.size(); ++i )
+      queue.add_task( boost::shared_ptr<Task>( new OpenTask( filenames[i], resources[i], errors[i] ) ) );
+    queue.join_all();
+  }
+
+  for( size_t i = 0; i < filenames.size(); ++i )
+    if( !resources[i] )
+      vw_throw( IOErr() << "DiskImageResource: Failed to open " << filenames[i] << ": " << errors[i] );
+  return resources;
+}
+
+/// Reopens an existing file for writing, by way of the driver that
+/// opens it for reading.
+vw::DiskImageResource* vw::DiskImageResource::resume( std::string const& filename ) {
+  std::string type;
+  {
+    boost::scoped_ptr<DiskImageResource> existing( open( filename ) );
+    type = existing->type();
+  }
+  if( type == DiskImageResourceVWT::type_static() )
+    return DiskImageResourceVWT::construct_resume( filename );
+#if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
+  if( type == DiskImageResourceGDAL::type_static() )
+    return DiskImageResourceGDAL::construct_resume( filename );
+#endif
+  vw_throw( NoImplErr() << "DiskImageResource: Cannot resume writing " << filename << ": "
+            << type << " files cannot be reopened for writing." );
+  return 0; // never reached
+}
+
 /// Returns a disk image resource with the given filename.  The file
 /// type is determined by the value in 'type'.
 vw::DiskImageResource* vw::DiskImageResource::create( std::string const& filename, ImageFormat const& format, std::string const& type ) {
-  register_default_file_types_internal();
-  if( create_map ) {
-    CreateMapType::iterator i = create_map->find( boost::to_lower_copy(type) );
-    if( i != create_map->end() )
-      return i->second( filename, format );
-  }
+  construct_create_func create_func;
+  if( find_create_func( boost::to_lower_copy(type), create_func ) )
+    return create_func( filename, format );
   vw_throw( NoImplErr() << "Unsupported file type \"" << type << "\" for filename: " << filename );
   return 0; // never reached
 }
@@ -246,12 +362,9 @@ vw::DiskImageResource* vw::DiskImageResource::create( std::string const& filenam
 /// Returns a disk image resource with the given filename.  The file
 /// type is determined by the extension of the filename.
 vw::DiskImageResource* vw::DiskImageResource::create( std::string const& filename, ImageFormat const& format ) {
-  register_default_file_types_internal();
-  if( create_map ) {
-    CreateMapType::iterator i = create_map->find( boost::to_lower_copy(fs::extension( filename )) );
-    if( i != create_map->end() )
-      return i->second( filename, format );
-  }
+  construct_create_func create_func;
+  if( find_create_func( boost::to_lower_copy(fs::extension( filename )), create_func ) )
+    return create_func( filename, format );
   vw_throw( NoImplErr() << "Unsupported file format: " << filename );
   return 0; // never reached
 }
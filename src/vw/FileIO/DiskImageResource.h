@@ -14,9 +14,11 @@
 
 #include <set>
 #include <string>
+#include <vector>
 #include <boost/type_traits.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/format.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include <vw/Core/Features.h>
 #include <vw/Core/Log.h>
@@ -24,6 +26,7 @@
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageIO.h>
+#include <vw/Image/BlockWriteJournal.h>
 #include <vw/Image/Manipulation.h>
 
 
@@ -58,6 +61,15 @@ namespace vw {
     /// you're finished with it!
     static DiskImageResource* open( std::string const& filename );
 
+    /// Opens each of the files as open() does, from up to concurrency
+    /// threads at once (vw_settings().default_num_threads() if it is
+    /// not positive), which hides the latency of slow file systems
+    /// when a job opens many files.  If any of the files fails to
+    /// open, an IOErr naming the first of them is thrown once the
+    /// others are done.
+    static std::vector<boost::shared_ptr<DiskImageResource> >
+    open( std::vector<std::string> const& filenames, int32 concurrency = 0 );
+
     /// Create a new DiskImageResource of the appropriate type
     /// pointing to a newly-created empty file on disk.
     ///
@@ -71,6 +83,12 @@ namespace vw {
     static DiskImageResource* create( std::string const& filename, ImageFormat const& format );
     static DiskImageResource* create( std::string const& filename, ImageFormat const& format, std::string const& type );
 
+    /// Reopen an existing file for writing, keeping what it holds, so
+    /// that an interrupted block_write_image() can write the blocks
+    /// it was missing.  Only .vwt files and files read through GDAL
+    /// can be reopened this way; others throw a NoImplErr.
+    static DiskImageResource* resume( std::string const& filename );
+
     typedef DiskImageResource* (*construct_open_func)( std::string const& filename );
 
     typedef DiskImageResource* (*construct_create_func)( std::string const& filename,
@@ -81,13 +99,12 @@ namespace vw {
                                     construct_open_func open_func,
                                     construct_create_func create_func );
 
-    /// This method is called automatically the first time you read or
-    /// write a file, however in some situations you may want to
-    /// register the default file types _before_ registering your own
-    /// file types so that you can override the default FileIO drivers.
-    //
-    /// This function is called automatically when you call register_file_type
-    /// the first time, so you don't need to call it manually anymore.
+    /// Registers the default driver of every extension now.  Each
+    /// default is otherwise registered the first time its extension
+    /// is used, so that tools do not pay to set up drivers, GDAL's in
+    /// particular, that they never use.  A default never replaces a
+    /// driver registered by register_file_type(), so you don't need
+    /// to call this first anymore.
     static void register_default_file_types() VW_DEPRECATED;
 
     // Specify whether values should be rescaled when converting
@@ -169,6 +186,56 @@ namespace vw {
     }
   }
 
+  /// Write an image view to disk in blocks, in a way that survives the
+  /// job being killed part way through.  The blocks are recorded as
+  /// they are written in a journal beside the file, named by adding
+  /// ".journal" to the filename.  If the journal shows that an earlier
+  /// write of the same image, with the same parameters, was cut
+  /// short, the file is reopened and only the blocks it is missing
+  /// are written.  The parameters should describe whatever else the
+  /// pixels depend on, such as the job's options, so that a changed
+  /// job starts over.  The journal is removed once the file is
+  /// complete.  Only files whose resources can be checkpointed (.vwt
+  /// files and tiled GeoTIFFs) are resumed; others are written afresh
+  /// every time.
+  template <class ImageT>
+  void resumable_write_image( const std::string &filename, ImageViewBase<ImageT> const& out_image,
+                              const std::string &parameters = std::string(),
+                              const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) {
+    BlockWriteJournal journal( filename + ".journal", parameters );
+    ImageFormat format = out_image.format();
+
+    boost::scoped_ptr<DiskImageResource> r;
+    if( journal.has_progress() ) {
+      try {
+        r.reset( DiskImageResource::resume( filename ) );
+      } catch( const Exception& e ) {
+        VW_OUT(DebugMessage, "fileio") << "resumable_write_image: " << e.what() << "\n";
+      }
+      if( r && ( r->cols() != int32(format.cols) || r->rows() != int32(format.rows) ||
+                 r->planes() * r->channels() != int32(format.planes * num_channels(format.pixel_format)) ||
+                 !r->has_checkpoint() ) )
+        r.reset();
+      if( r )
+        VW_OUT(InfoMessage, "fileio") << "\tResuming image: " << filename << "\n";
+    }
+    if( !r ) {
+      // The blocks the journal holds are not in a new file.
+      journal.clear();
+      VW_OUT(InfoMessage, "fileio") << "\tSaving image: " << filename << "\n";
+      r.reset( DiskImageResource::create( filename, format ) );
+    }
+
+    if( r->has_checkpoint() ) {
+      block_write_image( *r, out_image, journal, progress_callback );
+      r->flush();
+      journal.clear();
+    } else {
+      block_write_image( *r, out_image, progress_callback );
+      r->flush();
+    }
+  }
+
   /// Write a std::vector of image views.  Supply a filename with an
   /// asterisk ('*') and, each image in the vector will be saved as
   /// a seperate file on disk with the asterisk will be replaced with
@@ -23,12 +23,16 @@
 
 #include <vw/FileIO/DiskImageResourceGDAL.h>
 #include <vw/FileIO/GdalIO.h>
+#include <vw/FileIO/ReadHandlePool.h>
 
 #include <list>
 #include <vw/Core/Exception.h>
+#include <vw/Core/Trace.h>
 #include <vw/Core/Thread.h>
+#include <vw/Core/Settings.h>
 #include <vw/Image/PixelTypes.h>
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
 #include <boost/filesystem/convenience.hpp>
 #include <boost/foreach.hpp>
 namespace fs = boost::filesystem;
@@ -52,6 +56,23 @@ namespace {
     if (x)
       ::GDALClose(x);
   }
+
+  // The datasets of the concurrent read pool are opened and closed
+  // under the global lock, but read without it.
+  void GDALCloseLocked( GDALDataset* x ) {
+    vw::Mutex::Lock lock(d::gdal());
+    GDALCloseNullOk( (GDALDatasetH)x );
+  }
+  boost::shared_ptr<GDALDataset> GDALOpenReadHandle( std::string const& filename ) {
+    GDALDataset* dataset;
+    {
+      vw::Mutex::Lock lock(d::gdal());
+      dataset = (GDALDataset*)GDALOpen(filename.c_str(), GA_ReadOnly);
+    }
+    if( !dataset )
+      vw_throw( vw::IOErr() << "GDAL: Failed to reopen " << filename << " for reading." );
+    return boost::shared_ptr<GDALDataset>( dataset, GDALCloseLocked );
+  }
 }
 
 namespace vw {
@@ -191,6 +212,8 @@ namespace vw {
 
   DiskImageResourceGDAL::~DiskImageResourceGDAL() {
     flush();
+    // The pooled datasets take the lock themselves as they close.
+    m_read_pool.reset();
     // Ensure that the read dataset gets destroyed while we're holding
     // the global lock.  (In the unlikely event that the user has
     // retained a reference to it, it's alredy their responsibility to
@@ -308,6 +331,30 @@ namespace vw {
     }
 
     m_blocksize = default_block_size();
+
+    if( vw_settings().concurrent_file_reads() )
+      m_read_pool.reset( new d::ReadHandlePool<GDALDataset>( boost::bind( &GDALOpenReadHandle, filename ) ) );
+  }
+
+  /// Swap the read-only dataset for one open for update.
+  void DiskImageResourceGDAL::resume()
+  {
+    VW_ASSERT( m_read_dataset_ptr, LogicErr() << "DiskImageResourceGDAL: " << m_filename << " is not open." );
+    VW_ASSERT( m_palette.empty(), NoImplErr() << "DiskImageResourceGDAL: Cannot write the palette-based " << m_filename << "." );
+    // The pooled datasets take the lock themselves as they close.
+    m_read_pool.reset();
+
+    Mutex::Lock lock(d::gdal());
+    m_read_dataset_ptr.reset();
+    m_write_dataset_ptr.reset((GDALDataset*)GDALOpen(m_filename.c_str(), GA_Update), GDALCloseNullOk);
+    if( !m_write_dataset_ptr )
+      vw_throw( IOErr() << "GDAL: Failed to reopen " << m_filename << " for writing." );
+
+    // Strips span the whole width of the image, and tiles don't.
+    int xsize, ysize;
+    m_write_dataset_ptr->GetRasterBand(1)->GetBlockSize(&xsize, &ysize);
+    m_random_block_write = std::string( m_write_dataset_ptr->GetDriver()->GetDescription() ) == "GTiff"
+      && xsize != cols();
   }
 
   /// Bind the resource to a file for writing.
@@ -327,6 +374,10 @@ namespace vw {
     // structure for this DiskImageResource
     m_filename = filename;
     m_format = format;
+    // GDAL has no half-precision type, so float16 images are written
+    // as float32.
+    if( m_format.channel_type == VW_CHANNEL_FLOAT16 )
+      m_format.channel_type = VW_CHANNEL_FLOAT32;
     m_blocksize = block_size;
     m_options = user_options;
 
@@ -379,6 +430,12 @@ namespace vw {
     BOOST_FOREACH( Options::value_type const& i, m_options )
       options = CSLSetNameValue( options, i.first.c_str(), i.second.c_str() );
 
+    // GDAL writes the tiles of a tiled GeoTIFF wherever they fall in
+    // the file, so they may come in any order.
+    const char* tiled = CSLFetchNameValue( options, "TILED" );
+    m_random_block_write = std::string( driver->GetDescription() ) == "GTiff"
+      && tiled && CSLTestBoolean( tiled );
+
     GDALDataType gdal_pix_fmt = vw_channel_id_to_gdal_pix_fmt::value(m_format.channel_type);
 
     m_write_dataset_ptr.reset(
@@ -417,8 +474,24 @@ namespace vw {
   /// Read the disk image into the given buffer.
   void DiskImageResourceGDAL::read( ImageBuffer const& dest, BBox2i const& bbox ) const
   {
+    read_reduced( dest, bbox, 0 );
+  }
+
+  /// Read a region of the image reduced by 2^level.  GDAL reads the
+  /// full-resolution window into the smaller buffer, from the best
+  /// of the file's overviews when it has them.
+  void DiskImageResourceGDAL::read_reduced( ImageBuffer const& dest, BBox2i const& bbox, int32 level ) const
+  {
+    ScopedTrace trace( "DiskImageResourceGDAL::read", 0, dest.format.byte_size() );
     VW_ASSERT( channels() == 1 || planes()==1,
                LogicErr() << "DiskImageResourceGDAL: cannot read an image that has both multiple channels and multiple planes." );
+    VW_ASSERT( level >= 0 && level < 31,
+               ArgumentErr() << "DiskImageResourceGDAL: invalid level " << level << "." );
+
+    int32 factor = 1 << level;
+    BBox2i window( bbox.min().x() * factor, bbox.min().y() * factor,
+                   bbox.width() * factor, bbox.height() * factor );
+    window.crop( BBox2i( 0, 0, cols(), rows() ) );
 
     ImageFormat src_fmt = m_format;
     src_fmt.cols = bbox.width();
@@ -427,42 +500,98 @@ namespace vw {
     boost::scoped_array<uint8> src_data(new uint8[src_fmt.byte_size()]);
     ImageBuffer src(src_fmt, src_data.get());
 
-    {
+    if( has_concurrent_read() ) {
+      d::ReadHandlePool<GDALDataset>::Handle dataset( *m_read_pool );
+      read_dataset( dataset.get(), src, window );
+    }
+    else {
       Mutex::Lock lock(d::gdal());
+      read_dataset( get_dataset_ptr().get(), src, window );
+    }
 
-      boost::shared_ptr<GDALDataset> dataset = get_dataset_ptr();
-
-      if( m_palette.empty() ) {
-        for ( int32 p = 0; p < planes(); ++p ) {
-          for ( int32 c = 0; c < channels(); ++c ) {
-            // Only one of channels() or planes() will be nonzero.
-            GDALRasterBand  *band = dataset->GetRasterBand(c+p+1);
-            GDALDataType gdal_pix_fmt = vw_channel_id_to_gdal_pix_fmt::value(channel_type());
-            band->RasterIO( GF_Read, bbox.min().x(), bbox.min().y(), bbox.width(), bbox.height(),
-                            (uint8*)src(0,0,p) + channel_size(src.format.channel_type)*c,
-                            src.format.cols, src.format.rows, gdal_pix_fmt, src.cstride, src.rstride );
-          }
-        }
-      }
-      else { // palette conversion
-        GDALRasterBand  *band = dataset->GetRasterBand(1);
-        uint8 *index_data = new uint8[bbox.width() * bbox.height()];
-        band->RasterIO( GF_Read, bbox.min().x(), bbox.min().y(), bbox.width(), bbox.height(),
-                        index_data, bbox.width(), bbox.height(), GDT_Byte, 1, bbox.width() );
-        PixelRGBA<uint8> *rgba_data = (PixelRGBA<uint8>*) src.data;
-        for( int i=0; i<bbox.width()*bbox.height(); ++i )
-          rgba_data[i] = m_palette[index_data[i]];
-        delete [] index_data;
-      }
+    // Masked pixels are marked from the nodata value as they are filled.
+    double nodata;
+    if( is_masked_format( dest.format.pixel_format ) && m_palette.empty() && nodata_read_ok( nodata ) )
+      convert_nodata( dest, src, nodata, m_rescale );
+    else
+      convert( dest, src, m_rescale );
+  }
+
+  bool DiskImageResourceGDAL::all_nodata( BBox2i const& bbox ) const
+  {
+#if GDAL_VERSION_NUM >= 2020000
+    if( !has_nodata_read() )
+      return false;
+    // Blocks that a sparse file never stored read back as nodata.
+    Mutex::Lock lock(d::gdal());
+    boost::shared_ptr<GDALDataset> dataset = get_dataset_ptr();
+    for( int i = 1; i <= dataset->GetRasterCount(); ++i ) {
+      int status = dataset->GetRasterBand(i)->GetDataCoverageStatus( bbox.min().x(), bbox.min().y(),
+                                                                      bbox.width(), bbox.height() );
+      if( status != GDAL_DATA_COVERAGE_STATUS_EMPTY )
+        return false;
     }
+    return true;
+#else
+    (void)bbox;
+    return false;
+#endif
+  }
 
-    convert( dest, src, m_rescale );
+  int32 DiskImageResourceGDAL::overview_levels() const
+  {
+    Mutex::Lock lock(d::gdal());
+    GDALRasterBand *band = get_dataset_ptr()->GetRasterBand(1);
+    // Count the overviews that halve the image once more each, as
+    // GDAL builds them.
+    int32 levels = 0;
+    for( int i = 0; i < band->GetOverviewCount() && levels < 30; ++i ) {
+      int32 factor = 2 << levels;
+      GDALRasterBand *overview = band->GetOverview(i);
+      if( !overview ||
+          overview->GetXSize() != (cols()+factor-1)/factor ||
+          overview->GetYSize() != (rows()+factor-1)/factor )
+        break;
+      ++levels;
+    }
+    return levels;
   }
 
 
+  // Read a window of the dataset into the native-format buffer, which
+  // may be smaller than the window.  The caller holds the global
+  // lock, or a dataset no other thread uses.
+  void DiskImageResourceGDAL::read_dataset( GDALDataset* dataset, ImageBuffer const& src, BBox2i const& bbox ) const
+  {
+    if( m_palette.empty() ) {
+      for ( int32 p = 0; p < planes(); ++p ) {
+        for ( int32 c = 0; c < channels(); ++c ) {
+          // Only one of channels() or planes() will be nonzero.
+          GDALRasterBand  *band = dataset->GetRasterBand(c+p+1);
+          GDALDataType gdal_pix_fmt = vw_channel_id_to_gdal_pix_fmt::value(channel_type());
+          band->RasterIO( GF_Read, bbox.min().x(), bbox.min().y(), bbox.width(), bbox.height(),
+                          (uint8*)src(0,0,p) + channel_size(src.format.channel_type)*c,
+                          src.format.cols, src.format.rows, gdal_pix_fmt, src.cstride, src.rstride );
+        }
+      }
+    }
+    else { // palette conversion
+      GDALRasterBand  *band = dataset->GetRasterBand(1);
+      int32 size = src.format.cols * src.format.rows;
+      uint8 *index_data = new uint8[size];
+      band->RasterIO( GF_Read, bbox.min().x(), bbox.min().y(), bbox.width(), bbox.height(),
+                      index_data, src.format.cols, src.format.rows, GDT_Byte, 1, src.format.cols );
+      PixelRGBA<uint8> *rgba_data = (PixelRGBA<uint8>*) src.data;
+      for( int i=0; i<size; ++i )
+        rgba_data[i] = m_palette[index_data[i]];
+      delete [] index_data;
+    }
+  }
+
   // Write the given buffer into the disk image.
   void DiskImageResourceGDAL::write( ImageBuffer const& src, BBox2i const& bbox )
   {
+    ScopedTrace trace( "DiskImageResourceGDAL::write", 0, src.format.byte_size() );
     ImageFormat dst_fmt = m_format;
     dst_fmt.cols = bbox.width();
     dst_fmt.rows = bbox.height();
@@ -507,13 +636,36 @@ namespace vw {
     return m_blocksize;
   }
 
+  bool DiskImageResourceGDAL::has_concurrent_read() const {
+    return m_read_pool && !m_write_dataset_ptr;
+  }
+
+  void DiskImageResourceGDAL::set_overview_levels( int32 levels ) {
+    VW_ASSERT( levels >= 0 && levels < 31,
+               ArgumentErr() << "DiskImageResourceGDAL: invalid number of overview levels " << levels << "." );
+    m_overview_levels = levels;
+  }
+
   void DiskImageResourceGDAL::flush() {
     if (m_write_dataset_ptr) {
       Mutex::Lock lock(d::gdal());
+      if( m_overview_levels > 0 ) {
+        std::vector<int> factors( m_overview_levels );
+        for( int32 i = 0; i < m_overview_levels; ++i )
+          factors[i] = 2 << i;
+        if( m_write_dataset_ptr->BuildOverviews( "AVERAGE", m_overview_levels, &factors[0], 0, NULL, NULL, NULL ) != CE_None )
+          vw_throw( IOErr() << "DiskImageResourceGDAL: Failed to build overviews for " << m_filename << "." );
+      }
       m_write_dataset_ptr.reset();
     }
   }
 
+  void DiskImageResourceGDAL::checkpoint() {
+    VW_ASSERT( m_write_dataset_ptr, LogicErr() << "DiskImageResourceGDAL: " << m_filename << " is not open for writing." );
+    Mutex::Lock lock(d::gdal());
+    m_write_dataset_ptr->FlushCache();
+  }
+
   // Provide read access to the file's metadata
   char **DiskImageResourceGDAL::get_metadata() const {
     boost::shared_ptr<GDALDataset> dataset = get_dataset_ptr();
@@ -548,6 +700,18 @@ namespace vw {
     return new DiskImageResourceGDAL( filename, format );
   }
 
+  // A FileIO hook to reopen a file for writing the rest of it
+  vw::DiskImageResource* DiskImageResourceGDAL::construct_resume( std::string const& filename ) {
+    DiskImageResourceGDAL* resource = new DiskImageResourceGDAL( filename );
+    try {
+      resource->resume();
+    } catch( ... ) {
+      delete resource;
+      throw;
+    }
+    return resource;
+  }
+
 
 } // namespace vw
 
@@ -41,6 +41,10 @@
 class GDALDataset;
 namespace vw {
   class Mutex;
+namespace fileio {
+namespace detail {
+  template <class HandleT> class ReadHandlePool;
+}}
 }
 
 namespace vw {
@@ -52,7 +56,7 @@ namespace vw {
     typedef std::map<std::string,std::string> Options;
 
     DiskImageResourceGDAL( std::string const& filename )
-      : DiskImageResource( filename )
+      : DiskImageResource( filename ), m_random_block_write( false ), m_overview_levels( 0 )
     {
       open( filename );
     }
@@ -60,7 +64,7 @@ namespace vw {
     DiskImageResourceGDAL( std::string const& filename,
                            ImageFormat const& format,
                            Vector2i block_size = Vector2i(-1,-1) )
-      : DiskImageResource( filename )
+      : DiskImageResource( filename ), m_random_block_write( false ), m_overview_levels( 0 )
     {
       create( filename, format, block_size );
     }
@@ -69,7 +73,7 @@ namespace vw {
                            ImageFormat const& format,
                            Vector2i block_size,
                            Options const& options )
-      : DiskImageResource( filename )
+      : DiskImageResource( filename ), m_random_block_write( false ), m_overview_levels( 0 )
     {
       create( filename, format, block_size, options );
     }
@@ -86,6 +90,16 @@ namespace vw {
     virtual void read( ImageBuffer const& dest, BBox2i const& bbox ) const;
     virtual void write( ImageBuffer const& dest, BBox2i const& bbox );
 
+    /// Reduced reads come from the file's overviews where it has
+    /// them, and are decimated by GDAL where it doesn't.
+    virtual int32 overview_levels() const;
+    virtual void read_reduced( ImageBuffer const& dest, BBox2i const& bbox, int32 level ) const;
+
+    /// Build the given number of overview levels, each half the size
+    /// of the one before, from the written image when it is flushed.
+    /// Only formats GDAL can build overviews for support this.
+    void set_overview_levels( int32 levels );
+
     virtual bool has_block_read()   const {return true;}
     virtual bool has_block_write()  const {return true;}
     virtual bool has_nodata_read()  const;
@@ -95,15 +109,37 @@ namespace vw {
     virtual void set_block_write_size(const Vector2i&);
     virtual Vector2i block_read_size() const;
 
+    /// Files opened for reading while vw_settings().concurrent_file_reads()
+    /// is set are read from several threads at once, each through a
+    /// read-only dataset of its own, without taking the global lock.
+    virtual bool has_concurrent_read() const;
+
+    /// Tiled GeoTIFFs take their tiles in any order.
+    virtual bool has_random_block_write() const { return m_write_dataset_ptr && m_random_block_write; }
+
     virtual void set_nodata_write(double);
     virtual double nodata_read() const;
 
+    /// Regions of a sparse file that hold no stored blocks, as GDAL
+    /// 2.2 and later can tell.
+    virtual bool all_nodata( BBox2i const& bbox ) const;
+
     virtual void flush();
 
+    /// Tiled GeoTIFFs being written can have their blocks flushed to
+    /// the file while it stays open.
+    virtual bool has_checkpoint() const { return has_random_block_write(); }
+    virtual void checkpoint();
+
     // Ask GDAL if it's compiled with support for this file
     static bool gdal_has_support(std::string const& filename);
 
     void open( std::string const& filename );
+
+    /// Reopen the file this resource was opened from for update, so
+    /// that an interrupted write can write the blocks it was missing.
+    void resume();
+
     void create( std::string const& filename,
                  ImageFormat const& format,
                  Vector2i block_size,
@@ -129,6 +165,8 @@ namespace vw {
     static DiskImageResource* construct_create( std::string const& filename,
                                                 ImageFormat const& format );
 
+    static DiskImageResource* construct_resume( std::string const& filename );
+
     // These functions return pointers to internal data.  They exist
     // to allow users to access underlying special-purpose GDAL
     // features, but they should be used with caution.  Unlike the
@@ -147,13 +185,17 @@ namespace vw {
   private:
     void initialize_write_resource_locked();
     Vector2i default_block_size();
+    void read_dataset( GDALDataset* dataset, ImageBuffer const& src, BBox2i const& bbox ) const;
 
     std::string m_filename;
     boost::shared_ptr<GDALDataset> m_write_dataset_ptr;
     std::vector<PixelRGBA<uint8> > m_palette;
     Vector2i m_blocksize;
     Options m_options;
+    bool m_random_block_write;
+    int32 m_overview_levels;
     boost::shared_ptr<GDALDataset> m_read_dataset_ptr;
+    boost::shared_ptr<fileio::detail::ReadHandlePool<GDALDataset> > m_read_pool;
   };
 
   void UnloadGDAL();
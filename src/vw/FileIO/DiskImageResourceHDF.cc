@@ -22,6 +22,8 @@
 #pragma warning(disable:4996)
 #endif
 
+#include <map>
+
 #include <mfhdf.h>
 
 #ifndef H4_MAX_VAR_DIMS
@@ -33,7 +35,9 @@
 #endif
 
 #include <vw/Core/Exception.h>
+#include <vw/Core/Trace.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/Settings.h>
 
 #include <vw/FileIO/DiskImageResourceHDF.h>
 
@@ -77,12 +81,19 @@ public:
   struct PlaneInfo {
     ::int32 sds;
     ::int32 band;
+    ::int32 sds_id;
   };
 
   DiskImageResourceHDF &resource;
   ::int32 sd_id;
   std::vector<SDSInfo> sds_info;
   std::vector<PlaneInfo> plane_info;
+  // The selected datasets, which stay open between reads so that
+  // their chunk caches do too, by SDS index.
+  std::map< ::int32, ::int32 > open_sds;
+  // The chunk size of the first selected plane, or zero if it isn't
+  // chunked.
+  Vector2i chunk_size;
 
   DiskImageResourceInfoHDF( std::string const& filename, DiskImageResourceHDF& resource  ) : resource(resource), sd_id(FAIL) {
 
@@ -149,9 +160,44 @@ public:
   }
 
   ~DiskImageResourceInfoHDF() {
+    close_sds();
     if( sd_id != FAIL ) SDend( sd_id );
   }
 
+  void close_sds() {
+    for( std::map< ::int32, ::int32 >::const_iterator i = open_sds.begin(); i != open_sds.end(); ++i )
+      SDendaccess( i->second );
+    open_sds.clear();
+  }
+
+  // Opens the dataset for reading.  If it is chunked, this sizes its
+  // chunk cache and returns the chunk size.
+  ::int32 open_sds_for_read( ::int32 sds, Vector2i& sds_chunk_size ) {
+    sds_chunk_size = Vector2i();
+    ::int32 id = SDselect( sd_id, sds );
+    if( id == FAIL ) vw_throw( IOErr() << "Unable to select SDS in HDF file \"" << resource.filename() << "\"!" );
+    HDF_CHUNK_DEF chunk_def;
+    ::int32 flags;
+    if( SDgetchunkinfo( id, &chunk_def, &flags ) == FAIL || !(flags & HDF_CHUNK) )
+      return id;
+
+    ::int32 rank = sds_info[sds].rank;
+    sds_chunk_size = Vector2i( chunk_def.chunk_lengths[rank-1], chunk_def.chunk_lengths[rank-2] );
+    ::int32 max_cache = vw_settings().hdf_chunk_cache_size();
+    if( max_cache == 0 ) {
+      // A row of chunks across the dataset, and across its bands.
+      max_cache = ( sds_info[sds].dim_sizes[rank-1] + sds_chunk_size.x() - 1 ) / sds_chunk_size.x();
+      if( rank == 3 )
+        max_cache *= ( sds_info[sds].dim_sizes[0] + chunk_def.chunk_lengths[0] - 1 ) / chunk_def.chunk_lengths[0];
+    }
+    if( SDsetchunkcache( id, max_cache, 0 ) == FAIL )
+      VW_OUT(WarningMessage, "fileio") << "Unable to set the chunk cache of SDS \"" << sds_info[sds].name
+                                       << "\" in HDF file \"" << resource.filename() << "\"." << std::endl;
+    VW_OUT(VerboseDebugMessage, "fileio") << "SDS \"" << sds_info[sds].name << "\": " << sds_chunk_size.x() << "x"
+                                          << sds_chunk_size.y() << " chunks, caching " << max_cache << std::endl;
+    return id;
+  }
+
   vw::DiskImageResourceHDF::sds_iterator sds_begin() const {
     return sds_info.begin();
   }
@@ -212,6 +258,17 @@ public:
     new_format.rows = rows;
     new_format.planes = sds_planes.size();
     new_format.pixel_format = VW_PIXEL_SCALAR;
+    close_sds();
+    chunk_size = Vector2i();
+    for( unsigned plane=0; plane<new_plane_info.size(); ++plane ) {
+      ::int32 sds = new_plane_info[plane].sds;
+      if( open_sds.find( sds ) == open_sds.end() ) {
+        Vector2i sds_chunk_size;
+        open_sds[sds] = open_sds_for_read( sds, sds_chunk_size );
+        if( plane == 0 ) chunk_size = sds_chunk_size;
+      }
+      new_plane_info[plane].sds_id = open_sds[sds];
+    }
     plane_info = new_plane_info;
     VW_OUT(VerboseDebugMessage, "fileio") << "Configured resource: " << new_format.cols << "x" << new_format.rows << "x" << new_format.planes << std::endl;
     return new_format;
@@ -250,10 +307,7 @@ public:
     dstbuf.pstride = dstbuf.rstride * bbox.height();
     // For each requested plane...
     for( uint32 p=0; p<uint32(dstbuf.format.planes); ++p ) {
-      // Select the SDS
-      ::int32 sds_id = SDselect( sd_id, plane_info[p].sds );
-      if( sds_id == FAIL ) vw_throw( IOErr() << "Unable to select SDS in HDF file \"" << resource.filename() << "\"!" );
-
+      ::int32 sds_id = plane_info[p].sds_id;
       if( sds_info[plane_info[p].sds].rank == 2 ) {
         ::int32 start[2] = { bbox.min().y(), bbox.min().x() };
         ::int32 edges[2] = { bbox.height(), bbox.width() };
@@ -267,8 +321,6 @@ public:
           vw_throw( IOErr() << "Unable to read data from HDF file \"" << resource.filename() << "\"!" );
       }
       else vw_throw( IOErr() << "Invalid SDS rank in HDF file \"" << resource.filename() << "\"!" );
-
-      SDendaccess( sds_id );
     }
   }
 
@@ -559,11 +611,22 @@ vw::DiskImageResource* vw::DiskImageResourceHDF::construct_open( std::string con
 }
 
 void vw::DiskImageResourceHDF::read( ImageBuffer const& dstbuf, BBox2i const& bbox ) const {
+  ScopedTrace trace( "DiskImageResourceHDF::read", 0, dstbuf.format.byte_size() );
   ImageBuffer srcbuf;
   m_info->read( srcbuf, bbox );
   convert( dstbuf, srcbuf, m_rescale );
 }
 
+bool vw::DiskImageResourceHDF::has_block_read() const {
+  return m_info->chunk_size != Vector2i();
+}
+
+vw::Vector2i vw::DiskImageResourceHDF::block_read_size() const {
+  if( !has_block_read() )
+    return DiskImageResource::block_read_size();
+  return m_info->chunk_size;
+}
+
 vw::DiskImageResourceHDF::sds_iterator vw::DiskImageResourceHDF::sds_begin() const {
   return m_info->sds_begin();
 }
@@ -56,9 +56,14 @@ namespace vw {
 
     virtual bool has_block_write()  const {return false;}
     virtual bool has_nodata_write() const {return false;}
-    virtual bool has_block_read()   const {return false;}
     virtual bool has_nodata_read()  const {return false;}
 
+    /// Chunked datasets are read in blocks of their chunks.  The
+    /// chunks are those of the first selected plane.  HDF4 can't be
+    /// read from several threads at once, so reads stay serialized.
+    virtual bool has_block_read() const;
+    virtual Vector2i block_read_size() const;
+
     // The HDF-specific interface:
 
     struct SDSInfo {
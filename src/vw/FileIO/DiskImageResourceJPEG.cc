@@ -19,6 +19,7 @@
 
 #include <vw/FileIO/DiskImageResourceJPEG.h>
 #include <vw/Core/Exception.h>
+#include <vw/Core/Trace.h>
 
 #include <vector>
 #include <boost/scoped_array.hpp>
@@ -182,6 +183,8 @@ DiskImageResourceJPEG::~DiskImageResourceJPEG() {
 void DiskImageResourceJPEG::flush()
 {
 
+  // An image left unfinished is abandoned.
+  m_compress_ctx.reset();
   if (m_file_ptr) {
     fclose((FILE*)m_file_ptr);
     m_file_ptr = NULL;
@@ -261,6 +264,7 @@ void DiskImageResourceJPEG::create( std::string const& filename,
 */
 void DiskImageResourceJPEG::read( ImageBuffer const& dest, BBox2i const& bbox) const
 {
+  ScopedTrace trace( "DiskImageResourceJPEG::read", 0, dest.format.byte_size() );
   VW_ASSERT( int(dest.format.cols)==bbox.width() && int(dest.format.rows)==bbox.height(),
              ArgumentErr() << "DiskImageResourceJPEG (read) Error: Destination buffer has wrong dimensions!" );
 
@@ -327,70 +331,104 @@ void DiskImageResourceJPEG::read_reset() const {
   ctx = boost::shared_ptr<DiskImageResourceJPEG::vw_jpeg_decompress_context>(new DiskImageResourceJPEG::vw_jpeg_decompress_context(const_cast<DiskImageResourceJPEG*>(this)));
 }
 
-// Write the given buffer into the disk image.
-void DiskImageResourceJPEG::write( ImageBuffer const& src, BBox2i const& bbox )
+/* The compression state of a file being written, kept from one write
+ * to the next so that the image can be written a strip of rows at a
+ * time.
+*/
+class DiskImageResourceJPEG::vw_jpeg_compress_context
 {
-  VW_ASSERT( bbox.width()==int(cols()) && bbox.height()==int(rows()),
-             NoImplErr() << "DiskImageResourceJPEG does not support partial writes." );
-  VW_ASSERT( src.format.cols==uint32(cols()) && src.format.rows==uint32(rows()),
-             IOErr() << "Buffer has wrong dimensions in JPEG write." );
+  jpeg_error_mgr jerr;
 
-  // Set up the JPEG data structures
+public:
   jpeg_compress_struct cinfo;
-  jpeg_error_mgr jerr;
+  int row_stride;
 
-  cinfo.err = jpeg_std_error(&jerr);
-  jerr.error_exit = &vw_jpeg_error_exit;
+  vw_jpeg_compress_context(DiskImageResourceJPEG *outer)
+  {
+    // Set up the JPEG data structures
+    cinfo.err = jpeg_std_error(&jerr);
+    jerr.error_exit = &vw_jpeg_error_exit;
 
-  jpeg_create_compress(&cinfo);
-  jpeg_stdio_dest(&cinfo, (FILE*)m_file_ptr);
+    jpeg_create_compress(&cinfo);
+    jpeg_stdio_dest(&cinfo, (FILE*)outer->m_file_ptr);
 
-  cinfo.image_width = m_format.cols;
-  cinfo.image_height = m_format.rows;
+    cinfo.image_width = outer->m_format.cols;
+    cinfo.image_height = outer->m_format.rows;
 
-  switch (m_format.pixel_format)
-  {
-    case VW_PIXEL_SCALAR:
-      cinfo.input_components = m_format.planes;
-      cinfo.in_color_space = JCS_UNKNOWN;
-      break;
-    case VW_PIXEL_GRAY:
-      cinfo.input_components = 1;
-      cinfo.in_color_space = JCS_GRAYSCALE;
-      break;
-    case VW_PIXEL_RGB:
-      cinfo.input_components = 3;
-      cinfo.in_color_space = JCS_RGB;
-      break;
-    default:
-      vw_throw( IOErr() << "DiskImageResourceJPEG: Unsupported pixel type (" << m_format.pixel_format << ")." );
-      break;
+    switch (outer->m_format.pixel_format)
+    {
+      case VW_PIXEL_SCALAR:
+        cinfo.input_components = outer->m_format.planes;
+        cinfo.in_color_space = JCS_UNKNOWN;
+        break;
+      case VW_PIXEL_GRAY:
+        cinfo.input_components = 1;
+        cinfo.in_color_space = JCS_GRAYSCALE;
+        break;
+      case VW_PIXEL_RGB:
+        cinfo.input_components = 3;
+        cinfo.in_color_space = JCS_RGB;
+        break;
+      default:
+        jpeg_destroy_compress(&cinfo);
+        vw_throw( IOErr() << "DiskImageResourceJPEG: Unsupported pixel type (" << outer->m_format.pixel_format << ")." );
+        break;
+    }
+
+    // Set up the default values for the header and set the compression
+    // quality
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, (int)(100*outer->m_quality), TRUE); // limit to baseline-JPEG values
+
+    jpeg_start_compress(&cinfo, TRUE);
+    row_stride = cinfo.image_width*cinfo.input_components;
   }
 
-  // Set up the default values for the header and set the compression
-  // quality
-  jpeg_set_defaults(&cinfo);
-  jpeg_set_quality(&cinfo, (int)(100*m_quality), TRUE); // limit to baseline-JPEG values
+  ~vw_jpeg_compress_context() {
+    jpeg_destroy_compress(&cinfo);
+  }
+};
+
+// Write the given buffer into the disk image, after the rows written
+// so far.  The image is finished with its last row.
+void DiskImageResourceJPEG::write( ImageBuffer const& src, BBox2i const& bbox )
+{
+  ScopedTrace trace( "DiskImageResourceJPEG::write", 0, src.format.byte_size() );
+  const int next_row = m_compress_ctx ? int(m_compress_ctx->cinfo.next_scanline) : 0;
+  VW_ASSERT( bbox.width()==int(cols()) && bbox.min().y()==next_row && bbox.max().y()<=int(rows()),
+             NoImplErr() << "DiskImageResourceJPEG only supports writes of whole rows, from the top down." );
+  VW_ASSERT( src.format.cols==uint32(bbox.width()) && src.format.rows==uint32(bbox.height()),
+             IOErr() << "Buffer has wrong dimensions in JPEG write." );
+
+  if (!m_compress_ctx)
+    m_compress_ctx.reset( new vw_jpeg_compress_context(this) );
+  jpeg_compress_struct& cinfo = m_compress_ctx->cinfo;
 
   // Set up the image buffer and convert the data into this buffer
-  boost::scoped_array<uint8> buf( new uint8[cinfo.image_width*cinfo.input_components*cinfo.image_height] );
-  ImageBuffer dst(m_format, buf.get());
+  ImageFormat strip_format = m_format;
+  strip_format.rows = bbox.height();
+  boost::scoped_array<uint8> buf( new uint8[size_t(m_compress_ctx->row_stride)*bbox.height()] );
+  ImageBuffer dst(strip_format, buf.get());
 
   convert( dst, src, m_rescale );
 
-  jpeg_start_compress(&cinfo, TRUE);
-  int row_stride = cinfo.image_width*cinfo.input_components;
-
   // Write the image data to disk.
   JSAMPROW row_pointer[1];
-  while (cinfo.next_scanline < cinfo.image_height) {
-    row_pointer[0] = &(((uint8*)dst.data)[cinfo.next_scanline * row_stride]);
+  for (int row = 0; row < bbox.height(); ++row) {
+    row_pointer[0] = &(((uint8*)dst.data)[row * m_compress_ctx->row_stride]);
     jpeg_write_scanlines(&cinfo, row_pointer, 1);
   }
 
   // Clean up
-  jpeg_finish_compress(&cinfo);
-  jpeg_destroy_compress(&cinfo);
+  if (cinfo.next_scanline == cinfo.image_height) {
+    jpeg_finish_compress(&cinfo);
+    m_compress_ctx.reset();
+  }
+}
+
+bool DiskImageResourceJPEG::has_sequential_write() const {
+  // Files opened for reading have a decompress context.
+  return m_file_ptr && !ctx;
 }
 
 // A FileIO hook to open a file for reading
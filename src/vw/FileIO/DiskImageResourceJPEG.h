@@ -102,10 +102,15 @@ namespace vw {
     virtual bool has_block_read()   const {return false;}
     virtual bool has_nodata_read()  const {return false;}
 
+    /// Files being created are written a strip of rows at a time.
+    virtual bool has_sequential_write() const;
+
   private:
     // Forward declare an abstraction class that contains jpeg stuff.
     class vw_jpeg_decompress_context;
     friend class vw_jpeg_decompress_context;
+    class vw_jpeg_compress_context;
+    friend class vw_jpeg_compress_context;
 
     std::string m_filename;
     float m_quality;
@@ -127,6 +132,11 @@ namespace vw {
     */
     mutable boost::shared_ptr<vw_jpeg_decompress_context> ctx;
 
+    /* The compression context of the image being written, from its
+     * first write until its last row is written.
+    */
+    boost::shared_ptr<vw_jpeg_compress_context> m_compress_ctx;
+
     /* Resets the decompression context and current point in the file to
      * the beginning.
     */
@@ -27,9 +27,11 @@
 #include <ImfMatrixAttribute.h>
 #include <ImfArray.h>
 #include <ImfLineOrder.h>
-#include <ImfChannelList.h>
+#include <ImfThreading.h>
 
 #include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Trace.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/Statistics.h>
 #include <vw/FileIO/DiskImageResourceOpenEXR.h>
@@ -66,8 +68,19 @@ namespace {
 
   }
 
+  // OpenEXR decodes and encodes the tiles or scanlines of one read or
+  // write in parallel on a thread pool of its own, sized here to the
+  // threads VW would use.
+  static void set_openexr_thread_count() {
+    int threads = vw::vw_settings().default_num_threads();
+    if (Imf::globalThreadCount() != threads)
+      Imf::setGlobalThreadCount(threads);
+  }
+
 }
 
+bool vw::DiskImageResourceOpenEXR::default_half_float = false;
+
 
 // The destructor is here, despite being so brief, because deleting
 // an object safely requires knowing its full type.
@@ -78,11 +91,16 @@ vw::DiskImageResourceOpenEXR::~DiskImageResourceOpenEXR() {
     else
       delete reinterpret_cast<Imf::InputFile*>(m_input_file_ptr);
   }
+  close_output();
+}
+
+void vw::DiskImageResourceOpenEXR::close_output() {
   if (m_output_file_ptr) {
     if (m_tiled)
       delete reinterpret_cast<Imf::TiledOutputFile*>(m_output_file_ptr);
     else
       delete reinterpret_cast<Imf::OutputFile*>(m_output_file_ptr);
+    m_output_file_ptr = 0;
   }
 }
 
@@ -108,6 +126,7 @@ void vw::DiskImageResourceOpenEXR::open( std::string const& filename )
     if (m_input_file_ptr)
       vw_throw( IOErr() << "Disk image resources do not yet support reuse." );
 
+    set_openexr_thread_count();
     m_input_file_ptr = new Imf::InputFile(filename.c_str());
 
     // Check to see if the file is tiled.  If it does, close the descriptor and reopen as a tiled file.
@@ -155,24 +174,19 @@ void vw::DiskImageResourceOpenEXR::open( std::string const& filename )
 
 
 void vw::DiskImageResourceOpenEXR::set_tiled_write(int32 tile_width, int32 tile_height, bool random_tile_order) {
+  // Close and reopen the file
+  close_output();
   m_tiled = true;
+  m_random_tile_order = random_tile_order;
   m_block_size = Vector2i(tile_width, tile_height);
 
-  // Close and reopen the file
-  if (m_output_file_ptr) {
-    if (m_tiled)
-      delete reinterpret_cast<Imf::TiledOutputFile*>(m_output_file_ptr);
-    else
-      delete reinterpret_cast<Imf::OutputFile*>(m_output_file_ptr);
-  }
-
   try {
     // Create the file header with the appropriate number of
     // channels.  Label the channels in order starting with "Channel 0".
     Imf::Header header (m_format.cols,m_format.rows);
     for ( uint32 nn = 0; nn < m_format.planes; nn++) {
       m_labels[nn] = openexr_channel_string_of_pixel_type(m_format.pixel_format, nn);
-      header.channels().insert (m_labels[nn].c_str(), Imf::Channel (Imf::FLOAT));
+      header.channels().insert (m_labels[nn].c_str(), Imf::Channel (m_half_float ? Imf::HALF : Imf::FLOAT));
     }
 
     header.setTileDescription(Imf::TileDescription (m_block_size[0], m_block_size[1], Imf::ONE_LEVEL));
@@ -197,29 +211,33 @@ void vw::DiskImageResourceOpenEXR::set_block_write_size(Vector2i const& block_si
   set_tiled_write(block_size[0], block_size[1]);
 }
 
+void vw::DiskImageResourceOpenEXR::set_half_float(bool half_float) {
+  if (!m_output_file_ptr) {
+    vw_throw(NoImplErr() << "DiskImageResourceOpenEXR: set_half_float() not meaningful for reading!");
+  }
+  m_half_float = half_float;
+  if (m_tiled)
+    set_tiled_write(m_block_size[0], m_block_size[1], m_random_tile_order);
+  else
+    set_scanline_write(m_block_size[1]);
+}
+
 void vw::DiskImageResourceOpenEXR::set_scanline_write(int32 scanlines_per_block) {
+  // Close and reopen the file
+  close_output();
   m_tiled = false;
   m_block_size = Vector2i(m_format.cols,scanlines_per_block);
 
-  // Close and reopen the file
-  if (m_output_file_ptr) {
-    if (m_tiled)
-      delete reinterpret_cast<Imf::TiledOutputFile*>(m_output_file_ptr);
-    else
-      delete reinterpret_cast<Imf::OutputFile*>(m_output_file_ptr);
-  }
-
   try {
     // Create the file header with the appropriate number of
     // channels.  Label the channels in order starting with "Channel 0".
     Imf::Header header (m_format.cols,m_format.rows);
     for ( size_t nn = 0; nn < m_format.planes; nn++) {
       m_labels[nn] = openexr_channel_string_of_pixel_type(m_format.pixel_format, nn);
-      header.channels().insert (m_labels[nn].c_str(), Imf::Channel (Imf::FLOAT));
+      header.channels().insert (m_labels[nn].c_str(), Imf::Channel (m_half_float ? Imf::HALF : Imf::FLOAT));
     }
     header.lineOrder() = Imf::INCREASING_Y;
 
-    m_block_size = Vector2i(m_format.cols,m_openexr_rows_per_block);
     m_output_file_ptr = new Imf::OutputFile(m_filename.c_str(), header);
 
   } catch (const Iex::BaseExc& e) {
@@ -242,6 +260,7 @@ void vw::DiskImageResourceOpenEXR::create( std::string const& filename,
 
   // Open the EXR file and set up the header information
   m_labels.resize(m_format.planes);
+  set_openexr_thread_count();
 
   // By default, write out the image as a tiled image.
   this->set_tiled_write(vw_settings().default_tile_size(),vw_settings().default_tile_size());
@@ -250,6 +269,7 @@ void vw::DiskImageResourceOpenEXR::create( std::string const& filename,
 // Read the disk image into the given buffer.
 void vw::DiskImageResourceOpenEXR::read( ImageBuffer const& dest, BBox2i const& bbox ) const
 {
+  ScopedTrace trace( "DiskImageResourceOpenEXR::read", 0, dest.format.byte_size() );
   VW_OUT(VerboseDebugMessage, "fileio") << "DiskImageResourceOpenEXR: Reading OpenEXR Block " << bbox << "\n";
 
   if (!m_input_file_ptr)
@@ -338,6 +358,7 @@ void vw::DiskImageResourceOpenEXR::read( ImageBuffer const& dest, BBox2i const&
 // Write the given buffer into the disk image.
 void vw::DiskImageResourceOpenEXR::write( ImageBuffer const& src, BBox2i const& bbox )
 {
+  ScopedTrace trace( "DiskImageResourceOpenEXR::write", 0, src.format.byte_size() );
   VW_OUT(VerboseDebugMessage, "fileio") << "DiskImageResourceOpenEXR: Writing OpenEXR Block " << bbox << "\n";
 
   if (!m_output_file_ptr)
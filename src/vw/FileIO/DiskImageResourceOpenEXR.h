@@ -31,6 +31,9 @@ namespace vw {
     {
       m_input_file_ptr = 0;
       m_output_file_ptr = 0;
+      m_tiled = false;
+      m_random_tile_order = false;
+      m_half_float = default_half_float;
       open( filename );
     }
 
@@ -40,6 +43,9 @@ namespace vw {
     {
       m_input_file_ptr = 0;
       m_output_file_ptr = 0;
+      m_tiled = false;
+      m_random_tile_order = false;
+      m_half_float = default_half_float;
       create( filename, format );
     }
 
@@ -74,8 +80,20 @@ namespace vw {
     virtual Vector2i block_write_size() const;
     virtual void set_block_write_size(const Vector2i&);
 
+    /// Store the channels of the file being written as 16-bit half
+    /// floats rather than 32-bit floats, which halves its size at the
+    /// cost of precision.  This must be set before any pixels are
+    /// written.
+    void set_half_float(bool half_float);
+
+    /// Set whether files created from now on store half floats.
+    static void set_default_half_float(bool half_float) { default_half_float = half_float; }
+
   private:
     const static int m_openexr_rows_per_block = 10;
+    static bool default_half_float;
+
+    void close_output();
 
     std::string m_filename;
     Vector2i m_block_size;
@@ -83,6 +101,8 @@ namespace vw {
     void* m_input_file_ptr;
     void* m_output_file_ptr;
     bool m_tiled;
+    bool m_random_tile_order;
+    bool m_half_float;
   };
 
 } // namespace vw
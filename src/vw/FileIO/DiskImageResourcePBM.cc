@@ -25,6 +25,7 @@
 using namespace boost;
 
 #include <vw/Core/Exception.h>
+#include <vw/Core/Trace.h>
 #include <vw/Core/Debugging.h>
 #include <vw/FileIO/DiskImageResourcePBM.h>
 
@@ -142,6 +143,7 @@ void DiskImageResourcePBM::open( std::string const& filename ) {
 
 // Read the disk image into the given buffer.
 void DiskImageResourcePBM::read( ImageBuffer const& dest, BBox2i const& bbox )  const {
+  ScopedTrace trace( "DiskImageResourcePBM::read", 0, dest.format.byte_size() );
 
   VW_ASSERT( bbox.width()==int(cols()) && bbox.height()==int(rows()),
              NoImplErr() << "DiskImageResourcePBM does not support partial reads." );
@@ -264,6 +266,7 @@ void DiskImageResourcePBM::create( std::string const& filename,
 // Write the given buffer into the disk image.
 void DiskImageResourcePBM::write( ImageBuffer const& src,
                                   BBox2i const& bbox ) {
+  ScopedTrace trace( "DiskImageResourcePBM::write", 0, src.format.byte_size() );
   VW_ASSERT( bbox.width()==int(cols()) && bbox.height()==int(rows()),
              NoImplErr() << "DiskImageResourcePBM does not support partial writes." );
   VW_ASSERT( src.format.cols==uint32(cols()) && src.format.rows==uint32(rows()),
@@ -15,6 +15,7 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
 
 #include <cstring> // For memset()
 
@@ -22,8 +23,12 @@
 using namespace boost;
 
 #include <vw/Core/Exception.h>
+#include <vw/Core/Trace.h>
 #include <vw/Core/Debugging.h>
 #include <vw/FileIO/DiskImageResourcePDS.h>
+#include <vw/FileIO/MappedFile.h>
+
+#include <boost/scoped_array.hpp>
 
 
 static bool cpu_is_big_endian() {
@@ -189,6 +194,7 @@ void vw::DiskImageResourcePDS::open( std::string const& filename ) {
       m_image_data_offset = record_size * (atol(value.c_str()) - 1);
     }
   } else {
+    m_pds_data_filename = DiskImageResource::m_filename;
     keys.clear();
     keys.push_back("LABEL_RECORDS");
     if( query( keys, value ) ) {
@@ -238,6 +244,114 @@ void vw::DiskImageResourcePDS::open( std::string const& filename ) {
     << "Opening PDS Image\n"
     << "\tImage Dimensions: " << m_format.cols << "x" << m_format.rows << "x" << m_format.planes << "\n"
     << "\tImage Format: " << m_format.channel_type << "   " << m_format.pixel_format << "\n";
+
+  map_image_data();
+}
+
+// Map the image data into memory when its layout lets blocks of it be
+// described in place: sample interleaved, or band sequential with a
+// plane per band.  Other images are read whole by read().
+void vw::DiskImageResourcePDS::map_image_data() {
+  m_mapping.reset();
+  if( !MappedFile::supported() ||
+      ( m_band_storage == BAND_SEQUENTIAL && m_format.pixel_format != VW_PIXEL_SCALAR ) )
+    return;
+
+  // As in read(), the case of the data filename may differ from the
+  // one in the ^IMAGE tag.
+  std::string names[3] = { m_pds_data_filename,
+                           boost::to_lower_copy(m_pds_data_filename),
+                           boost::to_upper_copy(m_pds_data_filename) };
+  for( int i = 0; i < 3 && !m_mapping; ++i ) {
+    try {
+      m_mapping.reset( new MappedFile( names[i] ) );
+    } catch ( const ArgumentErr& ) {}
+  }
+  if( !m_mapping ) return;
+
+  size_t bytes = size_t(m_format.cols) * m_format.rows * m_format.planes
+    * num_channels(m_format.pixel_format) * channel_size(m_format.channel_type);
+  if( m_mapping->size() < m_image_data_offset + bytes ) {
+    VW_OUT(DebugMessage, "fileio") << "PDS image data in \"" << m_mapping->filename()
+                                   << "\" is truncated; not mapping it.\n";
+    m_mapping.reset();
+  }
+}
+
+vw::Vector2i vw::DiskImageResourcePDS::block_read_size() const {
+  // The data is stored in rows, so whole rows are the cheapest to read.
+  if( m_mapping )
+    return Vector2i( cols(), std::min( rows(), std::max( 1, 256*256 / std::max( 1, cols() ) ) ) );
+  return Vector2i( cols(), rows() );
+}
+
+// Read a block of the image straight from the mapped data.
+void vw::DiskImageResourcePDS::read_mapped( ImageBuffer const& dest, BBox2i const& bbox ) const
+{
+  VW_ASSERT( bbox.min().x() >= 0 && bbox.min().y() >= 0 && bbox.max().x() <= cols() && bbox.max().y() <= rows(),
+             ArgumentErr() << "DiskImageResourcePDS: " << bbox << " is outside the image." );
+
+  ImageFormat fmt = m_format;
+  ImageBuffer src( fmt, const_cast<uint8*>( m_mapping->data() ) + m_image_data_offset );
+  src.data = (uint8*)src.data + bbox.min().x() * src.cstride + bbox.min().y() * src.rstride;
+  src.format.cols = bbox.width();
+  src.format.rows = bbox.height();
+
+  // Swap 16-bit data from the other byte order into a copy of the block.
+  boost::scoped_array<uint8> swapped;
+  if( channel_size(m_format.channel_type) == 2 && cpu_is_big_endian() != m_file_is_msb_first ) {
+    ImageFormat block_fmt = src.format;
+    ImageBuffer block( block_fmt, 0 );
+    swapped.reset( new uint8[block_fmt.byte_size()] );
+    block.data = swapped.get();
+    size_t row_bytes = block.rstride;
+    for( int32 p = 0; p < int32(src.format.planes); ++p ) {
+      for( int32 y = 0; y < bbox.height(); ++y ) {
+        uint8 const* in = (uint8 const*)src.data + p * src.pstride + y * src.rstride;
+        uint8* out = swapped.get() + p * block.pstride + y * block.rstride;
+        for( size_t i = 0; i < row_bytes; i += 2 ) {
+          out[i] = in[i+1];
+          out[i+1] = in[i];
+        }
+      }
+    }
+    src = block;
+  }
+
+  convert( dest, src, m_rescale );
+  if ( m_invalid_as_alpha )
+    apply_invalid_as_alpha( dest, src );
+}
+
+// Make the pixels below the valid minimum transparent.
+void vw::DiskImageResourcePDS::apply_invalid_as_alpha( ImageBuffer const& dest, ImageBuffer const& src ) const
+{
+  // We checked earlier that the source format is as we
+  // expect.  Now we sanity-check the destination.
+  if( dest.format.planes == 1 &&
+      ( dest.format.pixel_format == VW_PIXEL_GRAYA ||
+        dest.format.pixel_format == VW_PIXEL_RGBA ) ) {
+    int dst_bpp = num_channels(dest.format.pixel_format) * channel_size(dest.format.channel_type);
+    std::string valid_minimum_str;
+    if ( query( "VALID_MINIMUM", valid_minimum_str ) ) {
+      int16 valid_minimum = atoi(valid_minimum_str.c_str());
+      uint8* src_row = (uint8*)src.data;
+      uint8* dst_row = (uint8*)dest.data;
+      for( uint32 y=0; y<src.format.rows; ++y ) {
+        uint8* src_data = src_row;
+        uint8* dst_data = dst_row;
+        for( uint32 x=0; x<src.format.cols; ++x ) {
+          if( *((int16*)src_data) < valid_minimum ) {
+            std::memset( dst_data, 0, dst_bpp );
+          }
+          src_data += src.cstride;
+          dst_data += dest.cstride;
+        }
+        src_row += src.rstride;
+        dst_row += dest.rstride;
+      }
+    }
+  }
 }
 
 /// Bind the resource to a file for writing.
@@ -250,6 +364,14 @@ void vw::DiskImageResourcePDS::create( std::string const& /*filename*/,
 /// Read the disk image into the given buffer.
 void vw::DiskImageResourcePDS::read( ImageBuffer const& dest, BBox2i const& bbox ) const
 {
+  ScopedTrace trace( "DiskImageResourcePDS::read", 0, dest.format.byte_size() );
+  VW_ASSERT( int(dest.format.cols)==bbox.width() && int(dest.format.rows)==bbox.height(),
+             IOErr() << "Buffer has wrong dimensions in PDS read." );
+  if( m_mapping ) {
+    read_mapped( dest, bbox );
+    return;
+  }
+
   VW_ASSERT( bbox.width()==int(cols()) && bbox.height()==int(rows()),
              NoImplErr() << "DiskImageResourcePDS does not support partial reads." );
   VW_ASSERT( dest.format.cols==uint32(cols()) && dest.format.rows==uint32(rows()),
@@ -336,34 +458,8 @@ void vw::DiskImageResourcePDS::read( ImageBuffer const& dest, BBox2i const& bbox
   src.pstride = bytes_per_pixel * m_format.cols * m_format.rows;
   convert( dest, src, m_rescale );
 
-  if ( m_invalid_as_alpha ) {
-    // We checked earlier that the source format is as we
-    // expect.  Now we sanity-check the destination.
-    if( dest.format.planes == 1 &&
-        ( dest.format.pixel_format == VW_PIXEL_GRAYA ||
-          dest.format.pixel_format == VW_PIXEL_RGBA ) ) {
-      int dst_bpp = num_channels(dest.format.pixel_format) * channel_size(dest.format.channel_type);
-      std::string valid_minimum_str;
-      if ( query( "VALID_MINIMUM", valid_minimum_str ) ) {
-        int16 valid_minimum = atoi(valid_minimum_str.c_str());
-        uint8* src_row = (uint8*)src.data;
-        uint8* dst_row = (uint8*)dest.data;
-        for( uint32 y=0; y<m_format.rows; ++y ) {
-          uint8* src_data = src_row;
-          uint8* dst_data = dst_row;
-          for( uint32 x=0; x<m_format.cols; ++x ) {
-            if( *((int16*)src_data) < valid_minimum ) {
-              std::memset( dst_data, 0, dst_bpp );
-            }
-            src_data += src.cstride;
-            dst_data += dest.cstride;
-          }
-          src_row += src.rstride;
-          dst_row += dest.rstride;
-        }
-      }
-    }
-  }
+  if ( m_invalid_as_alpha )
+    apply_invalid_as_alpha( dest, src );
 
   delete[] image_data;
   image_file.close();
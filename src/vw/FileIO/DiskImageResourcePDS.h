@@ -19,8 +19,12 @@
 
 #include <vw/FileIO/DiskImageResource.h>
 
+#include <boost/shared_ptr.hpp>
+
 namespace vw {
 
+  class MappedFile;
+
   class DiskImageResourcePDS : public DiskImageResource {
   public:
 
@@ -123,11 +127,19 @@ namespace vw {
 
     virtual bool has_block_write()  const {return false;}
     virtual bool has_nodata_write() const {return false;}
-    virtual bool has_block_read()   const {return false;}
     virtual bool has_nodata_read()  const {return false;}
 
+    /// Images whose data can be mapped into memory support block
+    /// reads, including from several threads at once.
+    virtual bool has_block_read()   const {return bool(m_mapping);}
+    virtual bool has_concurrent_read() const {return bool(m_mapping);}
+    virtual Vector2i block_read_size() const;
+
   private:
     void parse_pds_header(std::vector<std::string> const& header);
+    void map_image_data();
+    void read_mapped( ImageBuffer const& dest, BBox2i const& bbox ) const;
+    void apply_invalid_as_alpha( ImageBuffer const& dest, ImageBuffer const& src ) const;
     PixelFormatEnum planes_to_pixel_format(int32 planes) const;
     std::map<std::string, std::string> m_header_entries;
     int m_image_data_offset;
@@ -135,6 +147,7 @@ namespace vw {
     bool m_invalid_as_alpha;
     bool m_file_is_msb_first;
     std::string m_pds_data_filename;
+    boost::shared_ptr<MappedFile> m_mapping;
     enum { BAND_SEQUENTIAL, SAMPLE_INTERLEAVED, LINE_INTERLEAVED } m_band_storage;
   };
 
@@ -21,6 +21,7 @@
 #include <vw/FileIO/DiskImageResourcePNG.h>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/Exception.h>
+#include <vw/Core/Trace.h>
 #include <vw/Image/Manipulation.h>
 
 #include <png.h>
@@ -370,9 +371,12 @@ struct DiskImageResourcePNG::vw_png_write_context:
   public DiskImageResourcePNG::vw_png_context
 {
   png_context_t ctx;
+  bool interlaced;
+  int32 next_row;
 
   vw_png_write_context(DiskImageResourcePNG *outer, const DiskImageResourcePNG::Options &options):
-    vw_png_context(outer), ctx(outer->m_filename.c_str(), png_context_t::PNG_WRITE)
+    vw_png_context(outer), ctx(outer->m_filename.c_str(), png_context_t::PNG_WRITE),
+    interlaced(options.using_interlace), next_row(0)
   {
     // Set some needed values.
     int width     = outer->m_format.cols;
@@ -461,17 +465,24 @@ struct DiskImageResourcePNG::vw_png_write_context:
 
   }
 
-  // Writes the given ImageBuffer (with the same dimensions as m_format)
-  // to the file. Closing happens when the context is destroyed.
-  void write(const ImageBuffer &buf) const
+  // Writes the rows of the given ImageBuffer (as wide as m_format) to
+  // the file after the rows written so far, and ends the image after
+  // its last row.  An interlaced image must be written in one go.
+  // Closing happens when the context is destroyed.
+  void write(const ImageBuffer &buf)
   {
-    boost::scoped_array<png_bytep> row_pointers( new png_bytep[outer->m_format.rows] );
+    boost::scoped_array<png_bytep> row_pointers( new png_bytep[buf.format.rows] );
 
-    for(size_t i=0; i < outer->m_format.rows; i++)
+    for(size_t i=0; i < buf.format.rows; i++)
       row_pointers[i] = reinterpret_cast<uint8*>(buf.data) + i * cstride * outer->m_format.cols;
 
-    png_write_image(ctx.ptr, row_pointers.get());
-    png_write_end(ctx.ptr, ctx.info);
+    if (interlaced)
+      png_write_image(ctx.ptr, row_pointers.get());
+    else
+      png_write_rows(ctx.ptr, row_pointers.get(), buf.format.rows);
+    next_row += buf.format.rows;
+    if (next_row == int32(outer->m_format.rows))
+      png_write_end(ctx.ptr, ctx.info);
   }
 
 private:
@@ -544,6 +555,7 @@ void DiskImageResourcePNG::open( std::string const& /*filename*/ ) {
 
 void DiskImageResourcePNG::read( ImageBuffer const& dest, BBox2i const& bbox ) const
 {
+  ScopedTrace trace( "DiskImageResourcePNG::read", 0, dest.format.byte_size() );
   vw_png_read_context *ctx = dynamic_cast<vw_png_read_context *>(m_ctx.get());
   const int start_line = bbox.min().y();
   const int end_line = bbox.max().y();
@@ -656,11 +668,17 @@ void DiskImageResourcePNG::create( std::string const& filename, ImageFormat cons
 
 void DiskImageResourcePNG::write( ImageBuffer const& src, BBox2i const& bbox )
 {
+  ScopedTrace trace( "DiskImageResourcePNG::write", 0, src.format.byte_size() );
   vw_png_write_context *ctx = dynamic_cast<vw_png_write_context *>( m_ctx.get() );
 
-  VW_ASSERT( bbox.width()==int(cols()) && bbox.height()==int(rows()),
-             NoImplErr() << "DiskImageResourcePNG does not support partial writes." );
-  VW_ASSERT( src.format.cols==uint32(cols()) && src.format.rows==uint32(rows()),
+  VW_ASSERT( ctx, IOErr() << "DiskImageResourcePNG: The file was not opened for writing." );
+  if (ctx->interlaced)
+    VW_ASSERT( bbox.width()==int(cols()) && bbox.height()==int(rows()),
+               NoImplErr() << "DiskImageResourcePNG does not support partial writes of interlaced images." );
+  else
+    VW_ASSERT( bbox.width()==int(cols()) && bbox.min().y()==ctx->next_row && bbox.max().y()<=int(rows()),
+               NoImplErr() << "DiskImageResourcePNG only supports writes of whole rows, from the top down." );
+  VW_ASSERT( src.format.cols==uint32(bbox.width()) && src.format.rows==uint32(bbox.height()),
              ArgumentErr() << "DiskImageResourcePNG: Buffer has wrong dimensions in PNG write." );
 
   // Set up the image buffer and convert the data into this buffer.
@@ -685,3 +703,9 @@ void DiskImageResourcePNG::write( ImageBuffer const& src, BBox2i const& bbox )
   // Write.
   ctx->write(dst);
 }
+
+bool DiskImageResourcePNG::has_sequential_write() const
+{
+  vw_png_write_context *ctx = dynamic_cast<vw_png_write_context *>( m_ctx.get() );
+  return ctx && !ctx->interlaced;
+}
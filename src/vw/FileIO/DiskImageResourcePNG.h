@@ -112,6 +112,10 @@ namespace vw {
     virtual bool has_block_write()  const {return false;}
     virtual bool has_nodata_write() const {return false;}
     virtual bool has_block_read()   const {return true;}
+
+    /// Files created without interlacing are written a strip of rows
+    /// at a time.
+    virtual bool has_sequential_write() const;
     virtual bool has_nodata_read()  const {return false;}
 
     virtual Vector2i block_read_size() const { return m_block_size; }
@@ -0,0 +1,271 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceRaw.cc
+///
+/// Provides support for the Vision Workbench raw image format.
+///
+
+#ifdef _MSC_VER
+#pragma warning(disable:4244)
+#pragma warning(disable:4267)
+#pragma warning(disable:4996)
+#endif
+
+#include <sstream>
+#include <algorithm>
+
+#include <boost/scoped_array.hpp>
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Trace.h>
+#include <vw/Core/Settings.h>
+#include <vw/FileIO/DiskImageResourceRaw.h>
+#include <vw/FileIO/MappedFile.h>
+
+using namespace vw;
+
+namespace {
+  // The pixel data starts on a page boundary.
+  const size_t RAW_DATA_OFFSET = 4096;
+  const int RAW_VERSION = 1;
+
+  bool cpu_is_msb_first() {
+    uint16 one = 1;
+    return *reinterpret_cast<uint8*>(&one) == 0;
+  }
+}
+
+DiskImageResourceRaw::DiskImageResourceRaw( std::string const& filename )
+  : DiskImageResource( filename ), m_tiles_per_row( 0 )
+{
+  open( filename );
+}
+
+DiskImageResourceRaw::DiskImageResourceRaw( std::string const& filename,
+                                            ImageFormat const& format,
+                                            Vector2i tile_size )
+  : DiskImageResource( filename ), m_tiles_per_row( 0 )
+{
+  create( filename, format, tile_size );
+}
+
+DiskImageResourceRaw::~DiskImageResourceRaw() {
+  flush();
+}
+
+size_t DiskImageResourceRaw::tile_bytes() const {
+  return size_t(channel_size(m_format.channel_type)) * num_channels(m_format.pixel_format)
+    * m_tile_size.x() * m_tile_size.y() * m_format.planes;
+}
+
+size_t DiskImageResourceRaw::tile_offset( int32 tile_x, int32 tile_y ) const {
+  return RAW_DATA_OFFSET + (size_t(tile_y) * m_tiles_per_row + tile_x) * tile_bytes();
+}
+
+// A buffer in the native format over one whole tile.
+ImageBuffer DiskImageResourceRaw::tile_buffer( uint8* data ) const {
+  ImageFormat fmt = m_format;
+  fmt.cols = m_tile_size.x();
+  fmt.rows = m_tile_size.y();
+  return ImageBuffer( fmt, data );
+}
+
+/// Bind the resource to a file for reading, and map it.
+void DiskImageResourceRaw::open( std::string const& filename ) {
+  m_mapping.reset( new MappedFile( filename ) );
+  if( m_mapping->size() < RAW_DATA_OFFSET )
+    vw_throw( ArgumentErr() << "DiskImageResourceRaw: \"" << filename << "\" is too short to be a raw image." );
+
+  std::istringstream header( std::string( (char const*)m_mapping->data(), RAW_DATA_OFFSET ) );
+  std::string magic, key;
+  int version = 0;
+  header >> magic >> version;
+  if( magic != "VWRAW" )
+    vw_throw( ArgumentErr() << "DiskImageResourceRaw: \"" << filename << "\" is not a raw image." );
+  if( version != RAW_VERSION )
+    vw_throw( IOErr() << "DiskImageResourceRaw: \"" << filename << "\" has unsupported version " << version << "." );
+
+  int32 pixel_format = 0, channel_type = 0, msb_first = -1;
+  m_format.cols = m_format.rows = m_format.planes = 0;
+  m_tile_size = Vector2i();
+  while( header >> key && key != "end" ) {
+    if( key == "cols" )              header >> m_format.cols;
+    else if( key == "rows" )         header >> m_format.rows;
+    else if( key == "planes" )       header >> m_format.planes;
+    else if( key == "pixel_format" ) header >> pixel_format;
+    else if( key == "channel_type" ) header >> channel_type;
+    else if( key == "tile_cols" )    header >> m_tile_size.x();
+    else if( key == "tile_rows" )    header >> m_tile_size.y();
+    else if( key == "msb_first" )    header >> msb_first;
+    else vw_throw( IOErr() << "DiskImageResourceRaw: \"" << filename << "\" has unknown header field \"" << key << "\"." );
+  }
+  if( key != "end" || m_format.planes <= 0 || m_tile_size.x() <= 0 || m_tile_size.y() <= 0 || msb_first < 0 )
+    vw_throw( IOErr() << "DiskImageResourceRaw: \"" << filename << "\" has a malformed header." );
+  m_format.pixel_format = PixelFormatEnum( pixel_format );
+  m_format.channel_type = ChannelTypeEnum( channel_type );
+  if( num_channels_nothrow( m_format.pixel_format ) == 0 || channel_size_nothrow( m_format.channel_type ) == 0 )
+    vw_throw( IOErr() << "DiskImageResourceRaw: \"" << filename << "\" has an unsupported pixel type." );
+
+  // The data is used in place, so it must be in the native byte order.
+  if( bool(msb_first) != cpu_is_msb_first() && channel_size( m_format.channel_type ) > 1 )
+    vw_throw( IOErr() << "DiskImageResourceRaw: \"" << filename << "\" was written in the other byte order." );
+
+  m_tiles_per_row = (m_format.cols + m_tile_size.x() - 1) / m_tile_size.x();
+  int32 tile_rows = (m_format.rows + m_tile_size.y() - 1) / m_tile_size.y();
+  if( m_mapping->size() < tile_offset( 0, tile_rows ) )
+    vw_throw( IOErr() << "DiskImageResourceRaw: \"" << filename << "\" is truncated." );
+}
+
+/// Bind the resource to a file for writing.
+void DiskImageResourceRaw::create( std::string const& filename,
+                                   ImageFormat const& format,
+                                   Vector2i tile_size )
+{
+  if( num_channels_nothrow( format.pixel_format ) == 0 || channel_size_nothrow( format.channel_type ) == 0 )
+    vw_throw( ArgumentErr() << "DiskImageResourceRaw: Unsupported pixel type." );
+
+  m_format = format;
+  m_mapping.reset();
+  m_tile_size = tile_size;
+  if( m_tile_size.x() <= 0 || m_tile_size.y() <= 0 ) {
+    int32 tile = vw_settings().default_tile_size();
+    m_tile_size = Vector2i( std::min( tile, int32(m_format.cols) ), std::min( tile, int32(m_format.rows) ) );
+  }
+  m_tile_size = Vector2i( std::max( m_tile_size.x(), 1 ), std::max( m_tile_size.y(), 1 ) );
+  m_tiles_per_row = (m_format.cols + m_tile_size.x() - 1) / m_tile_size.x();
+  int32 tile_rows = (m_format.rows + m_tile_size.y() - 1) / m_tile_size.y();
+
+  std::ostringstream header;
+  header << "VWRAW " << RAW_VERSION << "\n"
+         << "cols " << m_format.cols << "\n"
+         << "rows " << m_format.rows << "\n"
+         << "planes " << m_format.planes << "\n"
+         << "pixel_format " << int32(m_format.pixel_format) << "\n"
+         << "channel_type " << int32(m_format.channel_type) << "\n"
+         << "tile_cols " << m_tile_size.x() << "\n"
+         << "tile_rows " << m_tile_size.y() << "\n"
+         << "msb_first " << int32(cpu_is_msb_first()) << "\n"
+         << "end\n";
+  std::string text = header.str();
+  text.resize( RAW_DATA_OFFSET, '\n' );
+
+  m_write_stream.reset( new std::fstream( filename.c_str(), std::ios::out | std::ios::trunc | std::ios::binary ) );
+  if( !*m_write_stream )
+    vw_throw( ArgumentErr() << "DiskImageResourceRaw: Failed to create \"" << filename << "\"." );
+  m_write_stream->exceptions( std::ios::failbit | std::ios::badbit );
+  m_write_stream->write( text.data(), text.size() );
+
+  // Extend the file to its full size, leaving the tiles that are
+  // never written as zeros.
+  size_t end = tile_offset( 0, tile_rows );
+  if( end > RAW_DATA_OFFSET ) {
+    m_write_stream->seekp( end - 1 );
+    m_write_stream->put( 0 );
+  }
+}
+
+bool DiskImageResourceRaw::has_mapped_buffer( BBox2i const& bbox ) const {
+  if( !m_mapping || bbox.empty() ) return false;
+  if( bbox.min().x() < 0 || bbox.min().y() < 0 || bbox.max().x() > cols() || bbox.max().y() > rows() )
+    return false;
+  return bbox.min().x() / m_tile_size.x() == (bbox.max().x() - 1) / m_tile_size.x()
+    && bbox.min().y() / m_tile_size.y() == (bbox.max().y() - 1) / m_tile_size.y();
+}
+
+ImageBuffer DiskImageResourceRaw::mapped_buffer( BBox2i const& bbox ) const {
+  VW_ASSERT( has_mapped_buffer( bbox ),
+             ArgumentErr() << "DiskImageResourceRaw: " << bbox << " does not lie within one mapped tile." );
+  int32 tile_x = bbox.min().x() / m_tile_size.x(), tile_y = bbox.min().y() / m_tile_size.y();
+  ImageBuffer buffer = tile_buffer( const_cast<uint8*>( m_mapping->data() ) + tile_offset( tile_x, tile_y ) );
+  buffer.data = (uint8*)buffer.data + (bbox.min().x() - tile_x * m_tile_size.x()) * buffer.cstride
+    + (bbox.min().y() - tile_y * m_tile_size.y()) * buffer.rstride;
+  buffer.format.cols = bbox.width();
+  buffer.format.rows = bbox.height();
+  return buffer;
+}
+
+/// Read the disk image into the given buffer, straight from the mapping.
+void DiskImageResourceRaw::read( ImageBuffer const& dest, BBox2i const& bbox ) const
+{
+  ScopedTrace trace( "DiskImageResourceRaw::read", 0, dest.format.byte_size() );
+  VW_ASSERT( m_mapping, LogicErr() << "DiskImageResourceRaw: \"" << m_filename << "\" is not open for reading." );
+  VW_ASSERT( int(dest.format.cols)==bbox.width() && int(dest.format.rows)==bbox.height(),
+             ArgumentErr() << "DiskImageResourceRaw (read) Error: Destination buffer has wrong dimensions!" );
+  VW_ASSERT( bbox.min().x() >= 0 && bbox.min().y() >= 0 && bbox.max().x() <= cols() && bbox.max().y() <= rows(),
+             ArgumentErr() << "DiskImageResourceRaw (read) Error: " << bbox << " is outside the image." );
+
+  for( int32 ty = bbox.min().y() / m_tile_size.y(); ty * m_tile_size.y() < bbox.max().y(); ++ty ) {
+    for( int32 tx = bbox.min().x() / m_tile_size.x(); tx * m_tile_size.x() < bbox.max().x(); ++tx ) {
+      BBox2i tile( tx * m_tile_size.x(), ty * m_tile_size.y(), m_tile_size.x(), m_tile_size.y() );
+      tile.crop( bbox );
+      ImageBuffer src = mapped_buffer( tile );
+      ImageBuffer dst = dest;
+      dst.data = (uint8*)dest.data + (tile.min().x() - bbox.min().x()) * dest.cstride
+        + (tile.min().y() - bbox.min().y()) * dest.rstride;
+      dst.format.cols = tile.width();
+      dst.format.rows = tile.height();
+      convert( dst, src, m_rescale );
+    }
+  }
+}
+
+// Write the given buffer into the disk image, a tile row at a time.
+void DiskImageResourceRaw::write( ImageBuffer const& src, BBox2i const& bbox )
+{
+  ScopedTrace trace( "DiskImageResourceRaw::write", 0, src.format.byte_size() );
+  VW_ASSERT( m_write_stream, LogicErr() << "DiskImageResourceRaw: \"" << m_filename << "\" is not open for writing." );
+  VW_ASSERT( int(src.format.cols)==bbox.width() && int(src.format.rows)==bbox.height(),
+             ArgumentErr() << "DiskImageResourceRaw (write) Error: Source buffer has wrong dimensions!" );
+
+  ImageBuffer native = tile_buffer( 0 );
+  boost::scoped_array<uint8> row_data( new uint8[native.rstride] );
+
+  for( int32 ty = bbox.min().y() / m_tile_size.y(); ty * m_tile_size.y() < bbox.max().y(); ++ty ) {
+    for( int32 tx = bbox.min().x() / m_tile_size.x(); tx * m_tile_size.x() < bbox.max().x(); ++tx ) {
+      BBox2i tile( tx * m_tile_size.x(), ty * m_tile_size.y(), m_tile_size.x(), m_tile_size.y() );
+      tile.crop( bbox );
+      ImageBuffer dst = native;
+      dst.data = row_data.get();
+      dst.format.cols = tile.width();
+      dst.format.rows = 1;
+      dst.format.planes = 1;
+      for( int32 p = 0; p < m_format.planes; ++p ) {
+        for( int32 y = tile.min().y(); y < tile.max().y(); ++y ) {
+          ImageBuffer row = src;
+          row.data = (uint8*)src.data + (tile.min().x() - bbox.min().x()) * src.cstride
+            + (y - bbox.min().y()) * src.rstride + p * src.pstride;
+          row.format.cols = tile.width();
+          row.format.rows = 1;
+          row.format.planes = 1;
+          convert( dst, row, m_rescale );
+
+          size_t offset = tile_offset( tx, ty ) + p * native.pstride
+            + (y - ty * m_tile_size.y()) * native.rstride + (tile.min().x() - tx * m_tile_size.x()) * native.cstride;
+          m_write_stream->seekp( offset );
+          m_write_stream->write( (char const*)row_data.get(), tile.width() * native.cstride );
+        }
+      }
+    }
+  }
+}
+
+void DiskImageResourceRaw::flush() {
+  if( m_write_stream )
+    m_write_stream->flush();
+}
+
+// A FileIO hook to open a file for reading
+DiskImageResource* DiskImageResourceRaw::construct_open( std::string const& filename ) {
+  return new DiskImageResourceRaw( filename );
+}
+
+// A FileIO hook to open a file for writing
+DiskImageResource* DiskImageResourceRaw::construct_create( std::string const& filename,
+                                                           ImageFormat const& format ) {
+  return new DiskImageResourceRaw( filename, format );
+}
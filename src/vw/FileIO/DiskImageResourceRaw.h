@@ -0,0 +1,118 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceRaw.h
+///
+/// Provides support for the Vision Workbench raw image format (.vwr),
+/// uncompressed tiles of pixels in the native byte order, read
+/// through a memory mapping of the file.
+///
+/// The file starts with a short text header, which is padded to the
+/// data offset of 4096 bytes:
+///
+///   VWRAW 1
+///   cols <cols>
+///   rows <rows>
+///   planes <planes>
+///   pixel_format <PixelFormatEnum value>
+///   channel_type <ChannelTypeEnum value>
+///   tile_cols <tile cols>
+///   tile_rows <tile rows>
+///   msb_first <0 or 1>
+///   end
+///
+/// The tiles follow in row-major order.  Each tile is stored whole,
+/// even at the right and bottom edges of the image, one plane after
+/// another, with rows of tile_cols pixels.  A tile as large as the
+/// image makes a plain raw image.
+///
+/// Reads copy straight from the mapping with no system calls, and
+/// may come from several threads at once.  A block that lies within
+/// one tile can also be used in place: mapped_buffer() returns an
+/// ImageBuffer that aliases the mapped file.
+///
+#ifndef __VW_FILEIO_DISKIMAGERESOUCERAW_H__
+#define __VW_FILEIO_DISKIMAGERESOUCERAW_H__
+
+#include <string>
+#include <fstream>
+
+#include <vw/FileIO/DiskImageResource.h>
+
+#include <boost/shared_ptr.hpp>
+
+namespace vw {
+
+  class MappedFile;
+
+  class DiskImageResourceRaw : public DiskImageResource {
+  public:
+
+    DiskImageResourceRaw( std::string const& filename );
+
+    /// Creates a file with tiles of the given size, or of the
+    /// default tile size if it is not positive.
+    DiskImageResourceRaw( std::string const& filename,
+                          ImageFormat const& format,
+                          Vector2i tile_size = Vector2i(-1,-1) );
+
+    virtual ~DiskImageResourceRaw();
+
+    /// Returns the type of disk image resource.
+    static std::string type_static() { return "Raw"; }
+
+    /// Returns the type of disk image resource.
+    virtual std::string type() { return type_static(); }
+
+    virtual void read( ImageBuffer const& dest, BBox2i const& bbox ) const;
+    virtual void write( ImageBuffer const& src, BBox2i const& bbox );
+    virtual void flush();
+
+    virtual bool has_block_write()  const {return true;}
+    virtual bool has_nodata_write() const {return false;}
+    virtual bool has_block_read()   const {return true;}
+    virtual bool has_nodata_read()  const {return false;}
+    virtual bool has_concurrent_read() const { return bool(m_mapping); }
+    virtual bool has_random_block_write() const { return bool(m_write_stream); }
+
+    virtual Vector2i block_read_size() const { return m_tile_size; }
+    virtual Vector2i block_write_size() const { return m_tile_size; }
+
+    /// Whether bbox lies within a single tile of a file opened for
+    /// reading, so that mapped_buffer() can describe it.
+    bool has_mapped_buffer( BBox2i const& bbox ) const;
+
+    /// Returns a buffer in the native format that aliases the mapped
+    /// file over bbox, which must lie within a single tile.  The
+    /// buffer is read-only, and valid for the life of the resource.
+    ImageBuffer mapped_buffer( BBox2i const& bbox ) const;
+
+    void open( std::string const& filename );
+
+    void create( std::string const& filename,
+                 ImageFormat const& format,
+                 Vector2i tile_size = Vector2i(-1,-1) );
+
+    static DiskImageResource* construct_open( std::string const& filename );
+
+    static DiskImageResource* construct_create( std::string const& filename,
+                                                ImageFormat const& format );
+
+  private:
+    size_t tile_bytes() const;
+    size_t tile_offset( int32 tile_x, int32 tile_y ) const;
+    ImageBuffer tile_buffer( uint8* data ) const;
+
+    Vector2i m_tile_size;
+    int32 m_tiles_per_row;
+    boost::shared_ptr<MappedFile> m_mapping;
+    boost::shared_ptr<std::fstream> m_write_stream;
+  };
+
+} // namespace vw
+
+#endif // __VW_FILEIO_DISKIMAGERESOUCERAW_H__
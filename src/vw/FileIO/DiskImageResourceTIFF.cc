@@ -21,8 +21,14 @@
 #include <tiffio.h>
 
 #include <vw/Core/Exception.h>
+#include <vw/Core/Trace.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/Settings.h>
 #include <vw/FileIO/DiskImageResourceTIFF.h>
+#include <vw/FileIO/ReadHandlePool.h>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/bind.hpp>
 
 #ifndef VW_ERROR_BUFFER_SIZE
 #define VW_ERROR_BUFFER_SIZE 2048
@@ -40,12 +46,22 @@ namespace vw {
     std::string filename;
     int current_line;
     bool striped;
+    // Set when the file was created for writing.
+    bool writing;
+    // Set when the file is opened for concurrent reads.
+    boost::scoped_ptr<fileio::detail::ReadHandlePool<TIFF> > read_pool;
 
-    DiskImageResourceInfoTIFF() : tif(0), block_size(), current_line(0) {}
+    DiskImageResourceInfoTIFF() : tif(0), block_size(), current_line(0), writing(false) {}
     ~DiskImageResourceInfoTIFF() {
       close();
     }
 
+    static boost::shared_ptr<TIFF> open_read_handle( std::string const& filename ) {
+      TIFF *handle = TIFFOpen(filename.c_str(), "r");
+      if( !handle ) vw_throw( vw::IOErr() << "DiskImageResourceTIFF: Failed to open \"" << filename << "\" for reading!" );
+      return boost::shared_ptr<TIFF>( handle, TIFFClose );
+    }
+
     void reopen_read() {
       close();
       tif = TIFFOpen(filename.c_str(), "r");
@@ -111,6 +127,16 @@ vw::Vector2i vw::DiskImageResourceTIFF::block_read_size() const {
   return m_info->block_size;
 }
 
+bool vw::DiskImageResourceTIFF::has_sequential_write() const {
+  // Each write() goes through every plane, so strips of an image of
+  // separate planes would reach libtiff out of order.
+  return m_info->writing && m_info->tif && m_format.planes == 1;
+}
+
+bool vw::DiskImageResourceTIFF::has_concurrent_read() const {
+  return bool(m_info->read_pool);
+}
+
 /// Bind the resource to a file for reading.  Confirm that we can open
 /// the file and that it has a sane pixel format.
 void vw::DiskImageResourceTIFF::open( std::string const& filename ) {
@@ -212,6 +238,12 @@ void vw::DiskImageResourceTIFF::open( std::string const& filename ) {
   }
 
   TIFFClose(tif);
+
+  if( vw_settings().concurrent_file_reads() )
+    m_info->read_pool.reset( new fileio::detail::ReadHandlePool<TIFF>(
+      boost::bind( &DiskImageResourceInfoTIFF::open_read_handle, filename ) ) );
+  else
+    m_info->read_pool.reset();
 }
 
 /// Bind the resource to a file for writing.
@@ -290,41 +322,49 @@ void vw::DiskImageResourceTIFF::create( std::string const& filename,
   m_info->block_size = Vector2i(cols(),rows_per_strip);
 
   m_info->tif = tif;
+  m_info->writing = true;
 }
 
 /// Read the disk image into the given buffer.
 void vw::DiskImageResourceTIFF::read( ImageBuffer const& dest, BBox2i const& bbox ) const
 {
+  ScopedTrace trace( "DiskImageResourceTIFF::read", 0, dest.format.byte_size() );
   VW_ASSERT( int(dest.format.cols)==bbox.width() && int(dest.format.rows)==bbox.height(),
              ArgumentErr() << "DiskImageResourceTIFF (read) Error: Destination buffer has wrong dimensions!" );
 
-  // Only support sequential reading on striped TIFFs right now.
-  if( !m_info || !(m_info->tif) || !(m_info->striped) || (m_info->striped && m_info->current_line > bbox.min().y()) )
+  // Concurrent reads each use a handle of their own from the pool.
+  // Otherwise, only support sequential reading on striped TIFFs right now.
+  bool concurrent = has_concurrent_read();
+  boost::scoped_ptr<fileio::detail::ReadHandlePool<TIFF>::Handle> handle;
+  if( concurrent )
+    handle.reset( new fileio::detail::ReadHandlePool<TIFF>::Handle( *m_info->read_pool ) );
+  else if( !m_info || !(m_info->tif) || !(m_info->striped) || (m_info->striped && m_info->current_line > bbox.min().y()) )
     m_info->reopen_read();
+  TIFF *tif = concurrent ? handle->get() : m_info->tif;
 
   uint16 config = 0, bpsample = 0, nsamples = 0, photometric = 0;
-  check_retval(TIFFGetField(m_info->tif, TIFFTAG_PLANARCONFIG, &config), 0);
-  check_retval(TIFFGetField(m_info->tif, TIFFTAG_BITSPERSAMPLE, &bpsample), 0);
-  check_retval(TIFFGetField(m_info->tif, TIFFTAG_SAMPLESPERPIXEL, &nsamples), 0);
-  check_retval(TIFFGetField(m_info->tif, TIFFTAG_PHOTOMETRIC, &photometric), 0);
+  check_retval(TIFFGetField(tif, TIFFTAG_PLANARCONFIG, &config), 0);
+  check_retval(TIFFGetField(tif, TIFFTAG_BITSPERSAMPLE, &bpsample), 0);
+  check_retval(TIFFGetField(tif, TIFFTAG_SAMPLESPERPIXEL, &nsamples), 0);
+  check_retval(TIFFGetField(tif, TIFFTAG_PHOTOMETRIC, &photometric), 0);
 
   bool is_planar = (config == PLANARCONFIG_SEPARATE) && (m_format.pixel_format != VW_PIXEL_SCALAR);
-  bool is_tiled = TIFFIsTiled(m_info->tif);
-  m_info->striped = !is_tiled;
+  bool is_tiled = TIFFIsTiled(tif);
+  if( !concurrent ) m_info->striped = !is_tiled;
 
   // Compute the tile or strip geometry
   uint32 block_cols, block_rows, block_size, blocks_per_row, blocks_per_plane;
   if( is_tiled ) {
-    check_retval(TIFFGetField(m_info->tif, TIFFTAG_TILEWIDTH, &block_cols), 0);
-    check_retval(TIFFGetField(m_info->tif, TIFFTAG_TILELENGTH, &block_rows), 0);
-    block_size = TIFFTileSize(m_info->tif);
+    check_retval(TIFFGetField(tif, TIFFTAG_TILEWIDTH, &block_cols), 0);
+    check_retval(TIFFGetField(tif, TIFFTAG_TILELENGTH, &block_rows), 0);
+    block_size = TIFFTileSize(tif);
     blocks_per_row = (cols()-1) / block_cols + 1;
     blocks_per_plane = blocks_per_row * ( (rows()-1) / block_rows + 1 );
   }
   else {
     block_cols = cols();
-    check_retval(TIFFGetField( m_info->tif, TIFFTAG_ROWSPERSTRIP, &block_rows ), 0);
-    block_size = TIFFStripSize(m_info->tif);
+    check_retval(TIFFGetField( tif, TIFFTAG_ROWSPERSTRIP, &block_rows ), 0);
+    block_size = TIFFStripSize(tif);
     blocks_per_row = 1;
     blocks_per_plane = (rows()-1) / block_rows + 1;
   }
@@ -348,7 +388,7 @@ void vw::DiskImageResourceTIFF::read( ImageBuffer const& dest, BBox2i const& bbo
     buf = _TIFFmalloc( block_cols*block_rows*6 );
     if( !buf ) vw_throw( vw::IOErr() << "DiskImageResourceTIFF: Failed to malloc!" );
 
-    check_retval(TIFFGetField( m_info->tif, TIFFTAG_COLORMAP, &red_table, &green_table, &blue_table ), 0);
+    check_retval(TIFFGetField( tif, TIFFTAG_COLORMAP, &red_table, &green_table, &blue_table ), 0);
   }
 
   // Set up the source and destination image buffers
@@ -371,8 +411,8 @@ void vw::DiskImageResourceTIFF::read( ImageBuffer const& dest, BBox2i const& bbo
       if( is_planar ) {
         // At the moment we make an extra copy here to spoof plane contiguity
         for( int i=0; i<nsamples; ++i ) {
-          if( is_tiled ) check_retval(TIFFReadEncodedTile( m_info->tif, block_id+i*blocks_per_plane, plane_buf, (tsize_t) -1 ), -1);
-          else check_retval(TIFFReadEncodedStrip( m_info->tif, block_id+i*blocks_per_plane, plane_buf, (tsize_t) -1 ), 0);
+          if( is_tiled ) check_retval(TIFFReadEncodedTile( tif, block_id+i*blocks_per_plane, plane_buf, (tsize_t) -1 ), -1);
+          else check_retval(TIFFReadEncodedStrip( tif, block_id+i*blocks_per_plane, plane_buf, (tsize_t) -1 ), 0);
           // Oh man, this is horrible!
           switch(bpsample/8) {
           case 1:
@@ -402,8 +442,8 @@ void vw::DiskImageResourceTIFF::read( ImageBuffer const& dest, BBox2i const& bbo
         }
       }
       else if( photometric == PHOTOMETRIC_PALETTE ) {
-        if( is_tiled ) check_retval(TIFFReadEncodedTile( m_info->tif, block_id, palette_buf, (tsize_t) -1 ), -1);
-        else check_retval(TIFFReadEncodedStrip( m_info->tif, block_id, palette_buf, (tsize_t) -1 ), 0);
+        if( is_tiled ) check_retval(TIFFReadEncodedTile( tif, block_id, palette_buf, (tsize_t) -1 ), -1);
+        else check_retval(TIFFReadEncodedStrip( tif, block_id, palette_buf, (tsize_t) -1 ), 0);
         if( photometric == PHOTOMETRIC_PALETTE ) {
           for( int y=data_top; y<data_bottom; ++y ) {
             for( int x=data_left; x<data_right; ++x ) {
@@ -418,10 +458,10 @@ void vw::DiskImageResourceTIFF::read( ImageBuffer const& dest, BBox2i const& bbo
       }
       else {
         if( is_tiled )  {
-          check_retval(TIFFReadEncodedTile( m_info->tif, block_id, buf, (tsize_t) -1 ), -1);
+          check_retval(TIFFReadEncodedTile( tif, block_id, buf, (tsize_t) -1 ), -1);
         } else {
-          check_retval(TIFFReadEncodedStrip( m_info->tif, block_id, buf, (tsize_t) -1 ), -1);
-          m_info->current_line++;
+          check_retval(TIFFReadEncodedStrip( tif, block_id, buf, (tsize_t) -1 ), -1);
+          if( !concurrent ) m_info->current_line++;
         }
       }
 
@@ -439,12 +479,13 @@ void vw::DiskImageResourceTIFF::read( ImageBuffer const& dest, BBox2i const& bbo
   if( plane_buf ) _TIFFfree(plane_buf);
   if( palette_buf ) _TIFFfree(palette_buf);
   // Sorry .. this keeps us from incrementally reading
-  m_info->close();
+  if( !concurrent ) m_info->close();
 }
 
 // Write the given buffer into the disk image.
 void vw::DiskImageResourceTIFF::write( ImageBuffer const& src, BBox2i const& bbox )
 {
+  ScopedTrace trace( "DiskImageResourceTIFF::write", 0, src.format.byte_size() );
   VW_ASSERT(bbox.width() == m_format.cols,
             ArgumentErr() << "DiskImageResourceTIFF: bounding box must be the same width as image.\n");
 
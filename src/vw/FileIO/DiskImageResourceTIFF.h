@@ -44,6 +44,15 @@ namespace vw {
 
     virtual Vector2i block_read_size() const;
 
+    /// Files of one plane being created are written a strip of rows at
+    /// a time, as write() already allows.
+    virtual bool has_sequential_write() const;
+
+    /// Files opened for reading while vw_settings().concurrent_file_reads()
+    /// is set are read from several threads at once, each through a
+    /// libtiff handle of its own.
+    virtual bool has_concurrent_read() const;
+
     virtual void read( ImageBuffer const& buf, BBox2i const& bbox ) const;
 
     virtual void write( ImageBuffer const& dest, BBox2i const& bbox );
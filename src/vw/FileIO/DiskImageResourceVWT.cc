@@ -0,0 +1,548 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceVWT.cc
+///
+/// Provides support for the Vision Workbench tile container format.
+///
+
+#ifdef _MSC_VER
+#pragma warning(disable:4244)
+#pragma warning(disable:4267)
+#pragma warning(disable:4996)
+#endif
+
+#include <vw/config.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <boost/scoped_array.hpp>
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Debugging.h>
+#include <vw/Core/Trace.h>
+#include <vw/Core/Settings.h>
+#include <vw/FileIO/DiskImageResourceVWT.h>
+#include <vw/FileIO/MappedFile.h>
+
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+#include <zlib.h>
+#endif
+
+#ifndef WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+using namespace vw;
+
+namespace {
+  const char VWT_MAGIC[8] = { 'V','W','T','I','L','E','S','\0' };
+  const uint32 VWT_VERSION = 1;
+  const size_t VWT_HEADER_SIZE = 128;
+
+  // The header, as it is laid out at the start of the file.
+  struct Header {
+    char magic[8];
+    uint32 version, msb_first;
+    int32 cols, rows, planes, pixel_format, channel_type;
+    int32 tile_cols, tile_rows, compression, has_nodata, reserved;
+    double nodata;
+    uint64 index_offset, index_tiles;
+  };
+
+  bool cpu_is_msb_first() {
+    uint16 one = 1;
+    return *reinterpret_cast<uint8*>(&one) == 0;
+  }
+
+  // A block of tiles, each converted to the native format and
+  // compressed on its own.
+  struct EncodedTiles : public EncodedBlock {
+    struct Tile {
+      size_t index;
+      std::vector<uint8> data;
+    };
+    std::vector<Tile> tiles;
+
+    EncodedTiles( BBox2i const& bbox ) : EncodedBlock( bbox ) {}
+    virtual size_t size() const {
+      size_t bytes = 0;
+      for( size_t i = 0; i < tiles.size(); ++i )
+        bytes += tiles[i].data.size();
+      return bytes;
+    }
+  };
+
+  // Write all of the given bytes at an offset in the file, from any
+  // thread.
+  void write_at( int fd, std::string const& filename, uint8 const* data, size_t size, uint64 offset ) {
+#ifdef WIN32
+    vw_throw( NoImplErr() << "DiskImageResourceVWT: Writing is not supported on this platform." );
+#else
+    while( size > 0 ) {
+      ssize_t count = ::pwrite( fd, data, size, off_t(offset) );
+      if( count < 0 && errno == EINTR ) continue;
+      if( count <= 0 )
+        vw_throw( IOErr() << "DiskImageResourceVWT: Failed to write \"" << filename << "\": " << std::strerror(errno) );
+      data += count;
+      size -= count;
+      offset += count;
+    }
+#endif
+  }
+}
+
+DiskImageResourceVWT::DiskImageResourceVWT( std::string const& filename )
+  : DiskImageResource( filename ), m_tiles_per_row( 0 ), m_tiles_per_col( 0 ),
+    m_compression( COMPRESSION_NONE ), m_has_nodata( false ), m_nodata( 0 ),
+    m_fd( -1 ), m_end( 0 ), m_dirty( false )
+{
+  open( filename );
+}
+
+DiskImageResourceVWT::DiskImageResourceVWT( std::string const& filename,
+                                            ImageFormat const& format,
+                                            Vector2i tile_size,
+                                            Compression compression )
+  : DiskImageResource( filename ), m_tiles_per_row( 0 ), m_tiles_per_col( 0 ),
+    m_compression( COMPRESSION_NONE ), m_has_nodata( false ), m_nodata( 0 ),
+    m_fd( -1 ), m_end( 0 ), m_dirty( false )
+{
+  create( filename, format, tile_size, compression );
+}
+
+DiskImageResourceVWT::~DiskImageResourceVWT() {
+  try {
+    flush();
+  } catch ( const Exception& e ) {
+    VW_OUT(ErrorMessage, "fileio") << "DiskImageResourceVWT: " << e.what() << "\n";
+  }
+#ifndef WIN32
+  if( m_fd >= 0 )
+    ::close( m_fd );
+#endif
+}
+
+DiskImageResourceVWT::Compression DiskImageResourceVWT::default_compression() {
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+  return COMPRESSION_DEFLATE;
+#else
+  return COMPRESSION_NONE;
+#endif
+}
+
+size_t DiskImageResourceVWT::tile_bytes() const {
+  return size_t(channel_size(m_format.channel_type)) * num_channels(m_format.pixel_format)
+    * m_tile_size.x() * m_tile_size.y() * m_format.planes;
+}
+
+// A buffer in the native format over one whole tile.
+ImageBuffer DiskImageResourceVWT::tile_buffer( uint8* data ) const {
+  ImageFormat fmt = m_format;
+  fmt.cols = m_tile_size.x();
+  fmt.rows = m_tile_size.y();
+  return ImageBuffer( fmt, data );
+}
+
+// Fill a whole tile with the nodata value, or with zeros.
+void DiskImageResourceVWT::fill_nodata( uint8* data ) const {
+  size_t bytes = tile_bytes();
+  if( !m_has_nodata || m_nodata == 0 ) {
+    std::memset( data, 0, bytes );
+    return;
+  }
+
+  // Convert one pixel of nodata to the native format, then repeat it.
+  size_t channels = num_channels( m_format.pixel_format );
+  std::vector<double> value( channels, m_nodata );
+  ImageFormat fmt = m_format;
+  fmt.cols = fmt.rows = fmt.planes = 1;
+  ImageBuffer dst( fmt, data );
+  fmt.channel_type = VW_CHANNEL_FLOAT64;
+  ImageBuffer src( fmt, &value[0] );
+  convert( dst, src, false );
+  for( size_t i = dst.cstride; i < bytes; i += dst.cstride )
+    std::memcpy( data + i, data, dst.cstride );
+}
+
+/// Bind the resource to a file for reading, and map it.
+void DiskImageResourceVWT::open( std::string const& filename ) {
+  m_mapping.reset( new MappedFile( filename ) );
+  Header header;
+  if( m_mapping->size() < VWT_HEADER_SIZE )
+    vw_throw( ArgumentErr() << "DiskImageResourceVWT: \"" << filename << "\" is too short to be a tile container." );
+  std::memcpy( &header, m_mapping->data(), sizeof(header) );
+  if( std::memcmp( header.magic, VWT_MAGIC, sizeof(VWT_MAGIC) ) != 0 )
+    vw_throw( ArgumentErr() << "DiskImageResourceVWT: \"" << filename << "\" is not a tile container." );
+
+  // The header and the index are binary, so every field would need
+  // swapping.
+  if( bool(header.msb_first) != cpu_is_msb_first() )
+    vw_throw( IOErr() << "DiskImageResourceVWT: \"" << filename << "\" was written in the other byte order." );
+  if( header.version != VWT_VERSION )
+    vw_throw( IOErr() << "DiskImageResourceVWT: \"" << filename << "\" has unsupported version " << header.version << "." );
+
+  m_format.cols = header.cols;
+  m_format.rows = header.rows;
+  m_format.planes = header.planes;
+  m_format.pixel_format = PixelFormatEnum( header.pixel_format );
+  m_format.channel_type = ChannelTypeEnum( header.channel_type );
+  if( m_format.cols <= 0 || m_format.rows <= 0 || m_format.planes <= 0 ||
+      header.tile_cols <= 0 || header.tile_rows <= 0 )
+    vw_throw( IOErr() << "DiskImageResourceVWT: \"" << filename << "\" has a malformed header." );
+  if( num_channels_nothrow( m_format.pixel_format ) == 0 || channel_size_nothrow( m_format.channel_type ) == 0 )
+    vw_throw( IOErr() << "DiskImageResourceVWT: \"" << filename << "\" has an unsupported pixel type." );
+
+  m_compression = Compression( header.compression );
+  if( m_compression != COMPRESSION_NONE && m_compression != COMPRESSION_DEFLATE )
+    vw_throw( IOErr() << "DiskImageResourceVWT: \"" << filename << "\" has unknown compression " << header.compression << "." );
+#if !defined(VW_HAVE_PKG_Z) || VW_HAVE_PKG_Z!=1
+  if( m_compression == COMPRESSION_DEFLATE )
+    vw_throw( NoImplErr() << "DiskImageResourceVWT: \"" << filename << "\" is deflated, which needs zlib." );
+#endif
+  m_has_nodata = header.has_nodata != 0;
+  m_nodata = header.nodata;
+
+  m_tile_size = Vector2i( header.tile_cols, header.tile_rows );
+  m_tiles_per_row = (m_format.cols + m_tile_size.x() - 1) / m_tile_size.x();
+  m_tiles_per_col = (m_format.rows + m_tile_size.y() - 1) / m_tile_size.y();
+
+  // The index is only written once all of the tiles are.
+  uint64 tiles = uint64(m_tiles_per_row) * m_tiles_per_col;
+  if( header.index_offset == 0 )
+    vw_throw( IOErr() << "DiskImageResourceVWT: \"" << filename << "\" was never finished." );
+  if( header.index_tiles != tiles ||
+      header.index_offset + tiles * sizeof(TileEntry) > m_mapping->size() )
+    vw_throw( IOErr() << "DiskImageResourceVWT: \"" << filename << "\" has a malformed tile index." );
+  m_index.resize( tiles );
+  std::memcpy( &m_index[0], m_mapping->data() + header.index_offset, tiles * sizeof(TileEntry) );
+  for( size_t i = 0; i < m_index.size(); ++i ) {
+    if( m_index[i].size != 0 &&
+        ( m_index[i].offset < VWT_HEADER_SIZE || m_index[i].offset + m_index[i].size > m_mapping->size() ) )
+      vw_throw( IOErr() << "DiskImageResourceVWT: \"" << filename << "\" is truncated." );
+  }
+}
+
+/// Bind the resource to a file for writing.
+void DiskImageResourceVWT::create( std::string const& filename,
+                                   ImageFormat const& format,
+                                   Vector2i tile_size,
+                                   Compression compression )
+{
+  if( num_channels_nothrow( format.pixel_format ) == 0 || channel_size_nothrow( format.channel_type ) == 0 )
+    vw_throw( ArgumentErr() << "DiskImageResourceVWT: Unsupported pixel type." );
+#if !defined(VW_HAVE_PKG_Z) || VW_HAVE_PKG_Z!=1
+  if( compression == COMPRESSION_DEFLATE )
+    vw_throw( NoImplErr() << "DiskImageResourceVWT: Deflate compression needs zlib." );
+#endif
+
+  m_format = format;
+  m_compression = compression;
+  m_mapping.reset();
+  m_tile_size = tile_size;
+  if( m_tile_size.x() <= 0 || m_tile_size.y() <= 0 ) {
+    int32 tile = vw_settings().default_tile_size();
+    m_tile_size = Vector2i( std::min( tile, int32(m_format.cols) ), std::min( tile, int32(m_format.rows) ) );
+  }
+  m_tile_size = Vector2i( std::max( m_tile_size.x(), 1 ), std::max( m_tile_size.y(), 1 ) );
+  m_tiles_per_row = (m_format.cols + m_tile_size.x() - 1) / m_tile_size.x();
+  m_tiles_per_col = (m_format.rows + m_tile_size.y() - 1) / m_tile_size.y();
+  m_index.assign( size_t(m_tiles_per_row) * m_tiles_per_col, TileEntry() );
+
+#ifdef WIN32
+  vw_throw( NoImplErr() << "DiskImageResourceVWT: Writing is not supported on this platform." );
+#else
+  m_fd = ::open( filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666 );
+  if( m_fd < 0 )
+    vw_throw( ArgumentErr() << "DiskImageResourceVWT: Failed to create \"" << filename << "\": " << std::strerror(errno) );
+#endif
+
+  // Until the index is written the header marks the file unfinished.
+  m_end = VWT_HEADER_SIZE;
+  m_dirty = true;
+  write_header( 0 );
+}
+
+/// Reopen the file for writing more tiles after its end.
+void DiskImageResourceVWT::resume() {
+  VW_ASSERT( m_mapping, LogicErr() << "DiskImageResourceVWT: \"" << m_filename << "\" is not open." );
+#ifdef WIN32
+  vw_throw( NoImplErr() << "DiskImageResourceVWT: Writing is not supported on this platform." );
+#else
+  m_fd = ::open( m_filename.c_str(), O_RDWR );
+  if( m_fd < 0 )
+    vw_throw( ArgumentErr() << "DiskImageResourceVWT: Failed to reopen \"" << m_filename << "\": " << std::strerror(errno) );
+  off_t end = ::lseek( m_fd, 0, SEEK_END );
+  if( end < 0 )
+    vw_throw( IOErr() << "DiskImageResourceVWT: Failed to reopen \"" << m_filename << "\": " << std::strerror(errno) );
+  m_end = uint64( end );
+#endif
+  m_mapping.reset();
+  m_dirty = false;
+}
+
+// Write the header, pointing to the index at the given offset, or
+// marking the file unfinished if it is zero.
+void DiskImageResourceVWT::write_header( uint64 index_offset ) {
+  std::vector<uint8> bytes( VWT_HEADER_SIZE, 0 );
+  Header header;
+  std::memset( &header, 0, sizeof(header) );
+  std::memcpy( header.magic, VWT_MAGIC, sizeof(VWT_MAGIC) );
+  header.version = VWT_VERSION;
+  header.msb_first = cpu_is_msb_first();
+  header.cols = m_format.cols;
+  header.rows = m_format.rows;
+  header.planes = m_format.planes;
+  header.pixel_format = m_format.pixel_format;
+  header.channel_type = m_format.channel_type;
+  header.tile_cols = m_tile_size.x();
+  header.tile_rows = m_tile_size.y();
+  header.compression = m_compression;
+  header.has_nodata = m_has_nodata;
+  header.nodata = m_nodata;
+  if( index_offset ) {
+    header.index_offset = index_offset;
+    header.index_tiles = m_index.size();
+  }
+  std::memcpy( &bytes[0], &header, sizeof(header) );
+  write_at( m_fd, m_filename, &bytes[0], bytes.size(), 0 );
+}
+
+// Reserve a range of the file for one writer.
+uint64 DiskImageResourceVWT::reserve( uint64 size ) {
+  Mutex::Lock lock( m_end_mutex );
+  uint64 offset = m_end;
+  m_end += size;
+  m_dirty = true;
+  return offset;
+}
+
+// Returns the pixels of one whole tile in the native format, either
+// straight from the mapping or decompressed into scratch, which holds
+// tile_bytes().
+uint8 const* DiskImageResourceVWT::tile_data( int32 tile_x, int32 tile_y, uint8* scratch ) const {
+  TileEntry const& entry = m_index[ size_t(tile_y) * m_tiles_per_row + tile_x ];
+  if( entry.size == 0 ) {
+    fill_nodata( scratch );
+    return scratch;
+  }
+
+  uint8 const* data = m_mapping->data() + entry.offset;
+  if( m_compression == COMPRESSION_NONE ) {
+    if( entry.size != tile_bytes() )
+      vw_throw( IOErr() << "DiskImageResourceVWT: \"" << m_filename << "\" has a tile of the wrong size." );
+    return data;
+  }
+
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+  uLongf size = tile_bytes();
+  if( ::uncompress( scratch, &size, data, entry.size ) != Z_OK || size != tile_bytes() )
+    vw_throw( IOErr() << "DiskImageResourceVWT: \"" << m_filename << "\" has a corrupt tile at "
+              << tile_x << "," << tile_y << "." );
+#endif
+  return scratch;
+}
+
+/// Read the disk image into the given buffer, a tile at a time.
+void DiskImageResourceVWT::read( ImageBuffer const& dest, BBox2i const& bbox ) const
+{
+  ScopedTrace trace( "DiskImageResourceVWT::read", 0, dest.format.byte_size() );
+  VW_ASSERT( m_mapping, LogicErr() << "DiskImageResourceVWT: \"" << m_filename << "\" is not open for reading." );
+  VW_ASSERT( int(dest.format.cols)==bbox.width() && int(dest.format.rows)==bbox.height(),
+             ArgumentErr() << "DiskImageResourceVWT (read) Error: Destination buffer has wrong dimensions!" );
+  VW_ASSERT( bbox.min().x() >= 0 && bbox.min().y() >= 0 && bbox.max().x() <= cols() && bbox.max().y() <= rows(),
+             ArgumentErr() << "DiskImageResourceVWT (read) Error: " << bbox << " is outside the image." );
+
+  boost::scoped_array<uint8> scratch( new uint8[tile_bytes()] );
+  for( int32 ty = bbox.min().y() / m_tile_size.y(); ty * m_tile_size.y() < bbox.max().y(); ++ty ) {
+    for( int32 tx = bbox.min().x() / m_tile_size.x(); tx * m_tile_size.x() < bbox.max().x(); ++tx ) {
+      BBox2i tile( tx * m_tile_size.x(), ty * m_tile_size.y(), m_tile_size.x(), m_tile_size.y() );
+      tile.crop( bbox );
+      ImageBuffer src = tile_buffer( const_cast<uint8*>( tile_data( tx, ty, scratch.get() ) ) );
+      src.data = (uint8*)src.data + (tile.min().x() - tx * m_tile_size.x()) * src.cstride
+        + (tile.min().y() - ty * m_tile_size.y()) * src.rstride;
+      src.format.cols = tile.width();
+      src.format.rows = tile.height();
+      ImageBuffer dst = dest;
+      dst.data = (uint8*)dest.data + (tile.min().x() - bbox.min().x()) * dest.cstride
+        + (tile.min().y() - bbox.min().y()) * dest.rstride;
+      dst.format.cols = tile.width();
+      dst.format.rows = tile.height();
+      if( m_has_nodata )
+        convert_nodata( dst, src, m_nodata, m_rescale );
+      else
+        convert( dst, src, m_rescale );
+    }
+  }
+}
+
+// The tiles that were never written read back as nodata.
+bool DiskImageResourceVWT::all_nodata( BBox2i const& bbox ) const
+{
+  if( !m_mapping || !m_has_nodata || bbox.empty() )
+    return false;
+  BBox2i region = bbox;
+  region.crop( BBox2i( 0, 0, cols(), rows() ) );
+  if( region.empty() )
+    return false;
+  for( int32 ty = region.min().y() / m_tile_size.y(); ty * m_tile_size.y() < region.max().y(); ++ty )
+    for( int32 tx = region.min().x() / m_tile_size.x(); tx * m_tile_size.x() < region.max().x(); ++tx )
+      if( m_index[ size_t(ty) * m_tiles_per_row + tx ].size != 0 )
+        return false;
+  return true;
+}
+
+// Convert and compress the tiles that the given buffer covers.
+boost::shared_ptr<EncodedBlock> DiskImageResourceVWT::encode( ImageBuffer const& src, BBox2i const& bbox ) const
+{
+  ScopedTrace trace( "DiskImageResourceVWT::encode", 0, src.format.byte_size() );
+  VW_ASSERT( int(src.format.cols)==bbox.width() && int(src.format.rows)==bbox.height(),
+             ArgumentErr() << "DiskImageResourceVWT (write) Error: Source buffer has wrong dimensions!" );
+  VW_ASSERT( bbox.min().x() >= 0 && bbox.min().y() >= 0 && bbox.max().x() <= cols() && bbox.max().y() <= rows(),
+             ArgumentErr() << "DiskImageResourceVWT (write) Error: " << bbox << " is outside the image." );
+
+  boost::shared_ptr<EncodedTiles> block( new EncodedTiles( bbox ) );
+  size_t bytes = tile_bytes();
+  boost::scoped_array<uint8> data( new uint8[bytes] );
+  for( int32 ty = bbox.min().y() / m_tile_size.y(); ty * m_tile_size.y() < bbox.max().y(); ++ty ) {
+    for( int32 tx = bbox.min().x() / m_tile_size.x(); tx * m_tile_size.x() < bbox.max().x(); ++tx ) {
+      BBox2i tile( tx * m_tile_size.x(), ty * m_tile_size.y(), m_tile_size.x(), m_tile_size.y() );
+      tile.crop( BBox2i( 0, 0, cols(), rows() ) );
+      if( !bbox.contains( tile ) )
+        vw_throw( ArgumentErr() << "DiskImageResourceVWT (write) Error: " << bbox
+                  << " does not cover the tile at " << tile << "." );
+
+      // The part of the tile outside the image is left as zeros.
+      if( tile.width() != m_tile_size.x() || tile.height() != m_tile_size.y() )
+        std::memset( data.get(), 0, bytes );
+      ImageBuffer dst = tile_buffer( data.get() );
+      dst.format.cols = tile.width();
+      dst.format.rows = tile.height();
+      ImageBuffer region = src;
+      region.data = (uint8*)src.data + (tile.min().x() - bbox.min().x()) * src.cstride
+        + (tile.min().y() - bbox.min().y()) * src.rstride;
+      region.format.cols = tile.width();
+      region.format.rows = tile.height();
+      convert( dst, region, m_rescale );
+
+      block->tiles.push_back( EncodedTiles::Tile() );
+      EncodedTiles::Tile& encoded = block->tiles.back();
+      encoded.index = size_t(ty) * m_tiles_per_row + tx;
+      if( m_compression == COMPRESSION_DEFLATE ) {
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+        uLongf size = ::compressBound( bytes );
+        encoded.data.resize( size );
+        if( ::compress2( &encoded.data[0], &size, data.get(), bytes, Z_BEST_SPEED ) != Z_OK )
+          vw_throw( IOErr() << "DiskImageResourceVWT: Failed to compress a tile of \"" << m_filename << "\"." );
+        encoded.data.resize( size );
+#endif
+      }
+      else {
+        encoded.data.assign( data.get(), data.get() + bytes );
+      }
+    }
+  }
+  return block;
+}
+
+// Write each encoded tile to a range of the file of its own.
+void DiskImageResourceVWT::write_encoded( EncodedBlock const& block )
+{
+  VW_ASSERT( m_fd >= 0, LogicErr() << "DiskImageResourceVWT: \"" << m_filename << "\" is not open for writing." );
+  EncodedTiles const* tiles = dynamic_cast<EncodedTiles const*>( &block );
+  VW_ASSERT( tiles, ArgumentErr() << "DiskImageResourceVWT: The block was not encoded by a DiskImageResourceVWT." );
+
+  uint64 offset = reserve( tiles->size() );
+  for( size_t i = 0; i < tiles->tiles.size(); ++i ) {
+    EncodedTiles::Tile const& tile = tiles->tiles[i];
+    TileEntry entry;
+    entry.offset = offset;
+    entry.size = tile.data.size();
+    if( entry.size )
+      write_at( m_fd, m_filename, &tile.data[0], entry.size, offset );
+    offset += entry.size;
+
+    // Each writer has its tiles, and so their entries, to itself,
+    // but a flush may be copying the index at the same time.
+    Mutex::Lock lock( m_end_mutex );
+    m_index[ tile.index ] = entry;
+    m_dirty = true;
+  }
+}
+
+// Write the given buffer into the disk image, a tile at a time.
+void DiskImageResourceVWT::write( ImageBuffer const& src, BBox2i const& bbox )
+{
+  ScopedTrace trace( "DiskImageResourceVWT::write", 0, src.format.byte_size() );
+  VW_ASSERT( m_fd >= 0, LogicErr() << "DiskImageResourceVWT: \"" << m_filename << "\" is not open for writing." );
+  write_encoded( *encode( src, bbox ) );
+}
+
+// Append the index and point the header to it.  The index is written
+// again if more tiles are written after a flush.
+void DiskImageResourceVWT::flush() {
+  if( m_fd < 0 ) return;
+  Mutex::Lock lock( m_end_mutex );
+  if( !m_dirty ) return;
+
+  uint64 offset = m_end;
+  size_t bytes = m_index.size() * sizeof(TileEntry);
+  write_at( m_fd, m_filename, reinterpret_cast<uint8 const*>( &m_index[0] ), bytes, offset );
+  m_end += bytes;
+  m_dirty = false;
+  write_header( offset );
+}
+
+// Make the index written by flush() durable, so that the tiles it
+// points to survive a crash.
+void DiskImageResourceVWT::checkpoint() {
+  VW_ASSERT( m_fd >= 0, LogicErr() << "DiskImageResourceVWT: \"" << m_filename << "\" is not open for writing." );
+  flush();
+#ifndef WIN32
+  if( ::fsync( m_fd ) != 0 )
+    vw_throw( IOErr() << "DiskImageResourceVWT: Failed to sync \"" << m_filename << "\": " << std::strerror(errno) );
+#endif
+}
+
+double DiskImageResourceVWT::nodata_read() const {
+  if( !m_has_nodata )
+    vw_throw( NoImplErr() << "DiskImageResourceVWT: \"" << m_filename << "\" has no nodata value." );
+  return m_nodata;
+}
+
+void DiskImageResourceVWT::set_nodata_write( double value ) {
+  Mutex::Lock lock( m_end_mutex );
+  m_has_nodata = true;
+  m_nodata = value;
+  m_dirty = true;
+}
+
+// A FileIO hook to open a file for reading
+DiskImageResource* DiskImageResourceVWT::construct_open( std::string const& filename ) {
+  return new DiskImageResourceVWT( filename );
+}
+
+// A FileIO hook to open a file for writing
+DiskImageResource* DiskImageResourceVWT::construct_create( std::string const& filename,
+                                                           ImageFormat const& format ) {
+  return new DiskImageResourceVWT( filename, format );
+}
+
+// A FileIO hook to reopen a file for writing more tiles
+DiskImageResource* DiskImageResourceVWT::construct_resume( std::string const& filename ) {
+  DiskImageResourceVWT* resource = new DiskImageResourceVWT( filename );
+  try {
+    resource->resume();
+  } catch( ... ) {
+    delete resource;
+    throw;
+  }
+  return resource;
+}
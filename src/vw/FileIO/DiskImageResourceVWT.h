@@ -0,0 +1,165 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceVWT.h
+///
+/// Provides support for the Vision Workbench tile container format
+/// (.vwt), meant for intermediate products that are written by one
+/// stage and read back by the next.
+///
+/// The file holds fixed-size tiles of pixels in the native byte
+/// order, each compressed on its own, behind a fixed-size binary
+/// header with the image format, tile size, compression and nodata
+/// value.  The tiles are appended in whatever order they are written,
+/// and an index of their offsets and sizes follows them at the end of
+/// the file, pointed to from the header.  A tile that was never
+/// written reads back as nodata, or as zeros if there is no nodata
+/// value.
+///
+/// Each tile is converted and compressed by the thread that writes
+/// it, and then written to a range of the file reserved for it alone,
+/// so blocks of different tiles may be written from several threads
+/// at once.  Reads decompress from a memory mapping of the file, and
+/// may also come from several threads at once.
+///
+#ifndef __VW_FILEIO_DISKIMAGERESOUCEVWT_H__
+#define __VW_FILEIO_DISKIMAGERESOUCEVWT_H__
+
+#include <string>
+#include <vector>
+
+#include <vw/Core/Thread.h>
+#include <vw/FileIO/DiskImageResource.h>
+
+#include <boost/shared_ptr.hpp>
+
+namespace vw {
+
+  class MappedFile;
+
+  class DiskImageResourceVWT : public DiskImageResource {
+  public:
+
+    /// The ways a tile may be compressed.  Deflate needs zlib.
+    enum Compression {
+      COMPRESSION_NONE = 0,
+      COMPRESSION_DEFLATE = 1
+    };
+
+    DiskImageResourceVWT( std::string const& filename );
+
+    /// Creates a file with tiles of the given size, or of the
+    /// default tile size if it is not positive.  By default the tiles
+    /// are deflated when zlib is available.
+    DiskImageResourceVWT( std::string const& filename,
+                          ImageFormat const& format,
+                          Vector2i tile_size = Vector2i(-1,-1),
+                          Compression compression = default_compression() );
+
+    virtual ~DiskImageResourceVWT();
+
+    /// Returns the type of disk image resource.
+    static std::string type_static() { return "VWT"; }
+
+    /// Returns the type of disk image resource.
+    virtual std::string type() { return type_static(); }
+
+    /// Read a block of the image.  The block may span tiles.
+    virtual void read( ImageBuffer const& dest, BBox2i const& bbox ) const;
+
+    /// Write a block of the image.  The block must cover each of the
+    /// tiles it touches, as clipped to the image, and blocks written
+    /// at the same time must not share tiles.
+    virtual void write( ImageBuffer const& src, BBox2i const& bbox );
+
+    /// Convert and compress a block for write_encoded().  The block
+    /// must cover the tiles it touches, as for write().
+    virtual boost::shared_ptr<EncodedBlock> encode( ImageBuffer const& src, BBox2i const& bbox ) const;
+
+    /// Write a block made by encode().
+    virtual void write_encoded( EncodedBlock const& block );
+
+    /// Write the tile index, which makes the file readable.
+    virtual void flush();
+
+    /// Write the tile index and sync the file, keeping it open for
+    /// more tiles.
+    virtual void checkpoint();
+
+    virtual bool has_block_write()  const {return true;}
+    virtual bool has_nodata_write() const {return true;}
+    virtual bool has_block_read()   const {return true;}
+    virtual bool has_nodata_read()  const {return m_has_nodata;}
+    virtual bool has_concurrent_read()  const { return bool(m_mapping); }
+    virtual bool has_concurrent_write() const { return m_fd >= 0; }
+    virtual bool has_block_encode()     const { return m_fd >= 0; }
+    virtual bool has_random_block_write() const { return m_fd >= 0; }
+    virtual bool has_checkpoint()       const { return m_fd >= 0; }
+
+    virtual Vector2i block_read_size() const { return m_tile_size; }
+    virtual Vector2i block_write_size() const { return m_tile_size; }
+
+    virtual double nodata_read() const;
+    virtual bool all_nodata( BBox2i const& bbox ) const;
+    virtual void set_nodata_write( double value );
+
+    Compression compression() const { return m_compression; }
+
+    void open( std::string const& filename );
+
+    void create( std::string const& filename,
+                 ImageFormat const& format,
+                 Vector2i tile_size = Vector2i(-1,-1),
+                 Compression compression = default_compression() );
+
+    /// Reopen the file this resource was opened from for writing,
+    /// keeping the tiles it has, so an interrupted write can write
+    /// the rest.  Tiles written again replace the old ones.
+    void resume();
+
+    static Compression default_compression();
+
+    static DiskImageResource* construct_open( std::string const& filename );
+
+    static DiskImageResource* construct_create( std::string const& filename,
+                                                ImageFormat const& format );
+
+    static DiskImageResource* construct_resume( std::string const& filename );
+
+  private:
+    struct TileEntry {
+      uint64 offset, size;
+      TileEntry() : offset(0), size(0) {}
+    };
+
+    size_t tile_bytes() const;
+    ImageBuffer tile_buffer( uint8* data ) const;
+    void fill_nodata( uint8* data ) const;
+    uint8 const* tile_data( int32 tile_x, int32 tile_y, uint8* scratch ) const;
+    uint64 reserve( uint64 size );
+    void write_header( uint64 index_offset );
+
+    Vector2i m_tile_size;
+    int32 m_tiles_per_row, m_tiles_per_col;
+    Compression m_compression;
+    bool m_has_nodata;
+    double m_nodata;
+    std::vector<TileEntry> m_index;
+
+    // Reading
+    boost::shared_ptr<MappedFile> m_mapping;
+
+    // Writing
+    int m_fd;
+    Mutex m_end_mutex;
+    uint64 m_end;
+    bool m_dirty;
+  };
+
+} // namespace vw
+
+#endif // __VW_FILEIO_DISKIMAGERESOUCEVWT_H__
@@ -21,10 +21,58 @@
 
 #include <boost/filesystem/operations.hpp>
 #include <string>
+#include <algorithm>
 #include <map>
 
 namespace vw {
 
+  /// \cond INTERNAL
+  namespace fileio {
+  namespace detail {
+    // Presents one reduced-resolution level of a resource as a
+    // resource of its own.
+    class ReducedImageResource : public SrcImageResource {
+      boost::shared_ptr<SrcImageResource> m_rsrc;
+      int32 m_level;
+    public:
+      ReducedImageResource( boost::shared_ptr<SrcImageResource> rsrc, int32 level )
+        : m_rsrc( rsrc ), m_level( level ) {
+        VW_ASSERT( level >= 0 && level < 31, ArgumentErr() << "DiskImageView: invalid overview level " << level << "." );
+      }
+
+      virtual ImageFormat format() const {
+        ImageFormat fmt = m_rsrc->format();
+        int32 factor = 1 << m_level;
+        fmt.cols = (fmt.cols + factor - 1) / factor;
+        fmt.rows = (fmt.rows + factor - 1) / factor;
+        return fmt;
+      }
+
+      virtual void read( ImageBuffer const& buf, BBox2i const& bbox ) const {
+        m_rsrc->read_reduced( buf, bbox, m_level );
+      }
+
+      virtual bool has_block_read() const { return m_rsrc->has_block_read(); }
+      virtual Vector2i block_read_size() const {
+        if( !m_rsrc->has_block_read() )
+          return Vector2i( cols(), rows() );
+        return Vector2i( std::min( m_rsrc->block_read_size().x(), cols() ),
+                         std::min( m_rsrc->block_read_size().y(), rows() ) );
+      }
+      virtual bool has_concurrent_read() const { return m_rsrc->has_concurrent_read(); }
+      virtual bool has_nodata_read() const { return m_rsrc->has_nodata_read(); }
+      virtual double nodata_read() const { return m_rsrc->nodata_read(); }
+      virtual bool all_nodata( BBox2i const& bbox ) const {
+        int32 factor = 1 << m_level;
+        BBox2i window( bbox.min().x() * factor, bbox.min().y() * factor,
+                       bbox.width() * factor, bbox.height() * factor );
+        window.crop( BBox2i( 0, 0, m_rsrc->cols(), m_rsrc->rows() ) );
+        return m_rsrc->all_nodata( window );
+      }
+    };
+  }} // namespace fileio::detail
+  /// \endcond
+
   /// A view of an image on disk.
   template <class PixelT>
   class DiskImageView : public ImageViewBase<DiskImageView<PixelT> >
@@ -36,6 +84,10 @@ namespace vw {
     boost::shared_ptr<DiskImageResource> m_rsrc;
     impl_type m_impl;
 
+    // Constructs a view of a reduced-resolution level of the resource.
+    DiskImageView( boost::shared_ptr<DiskImageResource> resource, boost::shared_ptr<SrcImageResource> level, Cache* cache )
+      : m_rsrc( resource ), m_impl( level, level->block_read_size(), 1, cache ) {}
+
   public:
     typedef typename impl_type::pixel_type pixel_type;
     typedef typename impl_type::result_type result_type;
@@ -76,8 +128,41 @@ namespace vw {
     prerasterize_type prerasterize( BBox2i const& bbox ) const { return m_impl.prerasterize( bbox ); }
     template <class DestT> void rasterize( DestT const& dest, BBox2i const& bbox ) const { m_impl.rasterize( dest, bbox ); }
 
+    /// Starts reading the blocks of the given region in the background.
+    void prefetch( BBox2i const& bbox ) const { m_impl.prefetch( bbox ); }
+
     std::string filename() const { return m_rsrc->filename(); }
 
+    friend class SparseImageCheck<DiskImageView>;
+
+    /// Returns the number of reduced-resolution levels the file
+    /// stores, which overview() reads without touching the full image.
+    int32 overview_levels() const { return m_rsrc->overview_levels(); }
+
+    /// Returns a view of the image reduced by 2^level in each
+    /// direction (rounded up) and read through the given cache.  The
+    /// pixels come from the file's own overviews where it has them,
+    /// and otherwise every 2^level-th pixel of the full image.
+    DiskImageView overview( int32 level, Cache* cache = &vw_system_cache() ) const {
+      boost::shared_ptr<SrcImageResource> reduced( new fileio::detail::ReducedImageResource( m_rsrc, level ) );
+      return DiskImageView( m_rsrc, reduced, cache );
+    }
+
+  };
+
+  template <class PixelT>
+  class SparseImageCheck<DiskImageView<PixelT> > {
+    DiskImageView<PixelT> const& m_view;
+  public:
+    SparseImageCheck( DiskImageView<PixelT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const { return sparse_check( m_view.m_impl, bbox ); }
+  };
+
+  template <class PixelT>
+  struct ImagePrefetch<DiskImageView<PixelT> > {
+    static void prefetch( DiskImageView<PixelT> const& image, BBox2i const& bbox ) {
+      image.prefetch( bbox );
+    }
   };
 
 
@@ -8,6 +8,7 @@
 #include <vw/FileIO/GdalIO.h>
 #include <vw/Core/Exception.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/Trace.h>
 
 static void CPL_STDCALL gdal_error_handler(CPLErr eErrClass, int nError, const char *pszErrorMsg) {
   vw::MessageLevel lvl;
@@ -43,6 +44,7 @@ namespace {
   vw::Mutex* _gdal_mutex;
 
   void init_gdal() {
+    vw::ScopedStartupTrace trace("GdalIO::init_gdal");
     CPLPushErrorHandler(gdal_error_handler);
     // If we run out of handles, GDALs error out. If you have more than 400
     // open, you probably have a bug.
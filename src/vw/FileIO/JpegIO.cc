@@ -37,6 +37,7 @@ void JpegIO::init_base(jpeg_error_mgr** mgr) {
 // Decompress
 ////////////////////////////////////////////////////////////////////////////////
 JpegIODecompress::JpegIODecompress()
+  : m_scale_denom(1)
 {
   init_base(&m_ctx.err);
   jpeg_create_decompress(&m_ctx);
@@ -51,22 +52,39 @@ bool JpegIODecompress::ready() const {
 }
 
 void JpegIODecompress::read(uint8* buffer, size_t bufsize) {
+  read(buffer, bufsize, line_bytes());
+}
+
+void JpegIODecompress::read(uint8* buffer, size_t bufsize, size_t rstride) {
   VW_ASSERT(this->ready(), LogicErr() << "Cannot reread from a JpegIO reader");
+  VW_ASSERT(rstride >= line_bytes(), LogicErr() << "Line stride is too small");
 
   jpeg_start_decompress(&m_ctx);
-  size_t skip = line_bytes();
-  VW_ASSERT(bufsize >= m_ctx.output_height * skip, LogicErr() << "Buffer is too small");
+  VW_ASSERT(m_ctx.output_height == 0 || bufsize >= (m_ctx.output_height-1) * rstride + line_bytes(),
+            LogicErr() << "Buffer is too small");
 
   while (m_ctx.output_scanline < m_ctx.output_height) {
     jpeg_read_scanlines(&m_ctx, &buffer, 1);
-    buffer += skip;
+    buffer += rstride;
   }
   jpeg_finish_decompress(&m_ctx);
 }
 
+void JpegIODecompress::set_reduction(int level) {
+  VW_ASSERT(level >= 0 && level <= 3, ArgumentErr() << "JpegIO: Can only reduce by up to 2^3, not 2^" << level);
+  m_scale_denom = 1 << level;
+}
+
+void JpegIODecompress::reset() {
+  jpeg_abort_decompress(&m_ctx);
+  m_ctx.output_scanline = 0;
+}
+
 void JpegIODecompress::open() {
   bind();
   jpeg_read_header(&m_ctx, TRUE);
+  m_ctx.scale_num = 1;
+  m_ctx.scale_denom = m_scale_denom;
   jpeg_calc_output_dimensions(&m_ctx);
 
   m_fmt.cols = m_ctx.output_width;
@@ -244,7 +262,13 @@ void jpeg_ptr_src(j_decompress_ptr cinfo, const uint8* data, size_t size) {
   VW_ASSERT(data, ArgumentErr() << "jpeg_ptr_src: Expected a non-null data ptr");
   VW_ASSERT(size, ArgumentErr() << "jpeg_ptr_src: Expected a non-zero size");
 
-  ptr_src_mgr *src = reinterpret_cast<ptr_src_mgr*>(
+  // A context that is reused for several buffers keeps the manager it
+  // allocated for the first one, as libjpeg's own sources do.
+  ptr_src_mgr *src;
+  if (cinfo->src && cinfo->src->init_source == &ptr_src_mgr::init_source)
+    src = reinterpret_cast<ptr_src_mgr*>(cinfo->src);
+  else
+    src = reinterpret_cast<ptr_src_mgr*>(
       (*cinfo->mem->alloc_small)(reinterpret_cast<j_common_ptr>(cinfo), JPOOL_PERMANENT, sizeof(ptr_src_mgr)));
 
   src->pub.init_source       = &ptr_src_mgr::init_source;
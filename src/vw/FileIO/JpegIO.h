@@ -37,6 +37,7 @@ class JpegIO {
 class JpegIODecompress : public JpegIO, public ScanlineReadBackend {
   protected:
     jpeg_decompress_struct m_ctx;
+    int m_scale_denom;
   public:
     JpegIODecompress();
     virtual ~JpegIODecompress();
@@ -44,6 +45,17 @@ class JpegIODecompress : public JpegIO, public ScanlineReadBackend {
     void open();
     bool ready() const;
     void read(uint8* data, size_t bufsize);
+    // Like read(), but with rstride bytes from the start of one line
+    // to the start of the next.
+    void read(uint8* data, size_t bufsize, size_t rstride);
+
+    // Decode at 1/2^level of the full size (level 0 to 3), rounded up,
+    // using libjpeg's DCT scaling. Takes effect at the next open().
+    void set_reduction(int level);
+
+    // Abandon the current image, so that the context can be bound to
+    // another one and opened again.
+    void reset();
 };
 
 class JpegIOCompress : public JpegIO, public ScanlineWriteBackend {
@@ -0,0 +1,77 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/FileIO/MappedFile.h>
+#include <vw/Core/Exception.h>
+#include <vw/config.h>
+
+#include <cerrno>
+#include <cstring>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+bool vw::MappedFile::supported() {
+#ifdef WIN32
+  return false;
+#else
+  return true;
+#endif
+}
+
+#ifdef WIN32
+
+vw::MappedFile::MappedFile( std::string const& filename )
+  : m_filename( filename ), m_data( 0 ), m_size( 0 )
+{
+  vw_throw( NoImplErr() << "MappedFile: memory mapping is not supported on this platform." );
+}
+
+vw::MappedFile::~MappedFile() {}
+
+#else
+
+vw::MappedFile::MappedFile( std::string const& filename )
+  : m_filename( filename ), m_data( 0 ), m_size( 0 )
+{
+  int fd = ::open( filename.c_str(), O_RDONLY );
+  if( fd < 0 )
+    vw_throw( ArgumentErr() << "MappedFile: Failed to open \"" << filename << "\": " << std::strerror(errno) );
+
+  struct stat info;
+  if( ::fstat( fd, &info ) != 0 ) {
+    int err = errno;
+    ::close( fd );
+    vw_throw( IOErr() << "MappedFile: Failed to stat \"" << filename << "\": " << std::strerror(err) );
+  }
+  m_size = info.st_size;
+
+  // An empty file has nothing to map.
+  if( m_size > 0 ) {
+    void* data = ::mmap( 0, m_size, PROT_READ, MAP_SHARED, fd, 0 );
+    if( data == MAP_FAILED ) {
+      int err = errno;
+      ::close( fd );
+      vw_throw( IOErr() << "MappedFile: Failed to map \"" << filename << "\": " << std::strerror(err) );
+    }
+    m_data = static_cast<uint8 const*>( data );
+  }
+
+  // The mapping stays valid after the descriptor is closed.
+  ::close( fd );
+}
+
+vw::MappedFile::~MappedFile() {
+  if( m_data )
+    ::munmap( const_cast<uint8*>( m_data ), m_size );
+}
+
+#endif
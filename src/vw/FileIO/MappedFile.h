@@ -0,0 +1,50 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file MappedFile.h
+///
+/// A read-only memory mapping of a whole file, for the disk image
+/// resources that read uncompressed pixel data.  Reading from the
+/// mapping costs no system calls once the pages are resident, and the
+/// operating system shares those pages between all of the threads and
+/// processes that read the file.
+///
+#ifndef __VW_FILEIO_MAPPEDFILE_H__
+#define __VW_FILEIO_MAPPEDFILE_H__
+
+#include <string>
+
+#include <vw/Core/FundamentalTypes.h>
+
+#include <boost/noncopyable.hpp>
+
+namespace vw {
+
+  class MappedFile : private boost::noncopyable {
+    std::string m_filename;
+    uint8 const* m_data;
+    size_t m_size;
+  public:
+    /// Maps the whole of an existing file for reading.  Throws an
+    /// ArgumentErr if the file cannot be opened, and an IOErr if it
+    /// cannot be mapped.
+    MappedFile( std::string const& filename );
+    ~MappedFile();
+
+    std::string const& filename() const { return m_filename; }
+
+    /// The mapped bytes of the file.
+    uint8 const* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    /// Whether memory mapping is supported on this platform.
+    static bool supported();
+  };
+
+} // namespace vw
+
+#endif // __VW_FILEIO_MAPPEDFILE_H__
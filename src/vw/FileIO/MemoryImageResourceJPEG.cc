@@ -9,66 +9,130 @@
 #include <vw/FileIO/JpegIO.h>
 #include <vw/Core/Debugging.h>
 
+#include <boost/scoped_array.hpp>
+#include <boost/thread/tss.hpp>
+
 namespace vw {
 
-class SrcMemoryImageResourceJPEG::Data : public fileio::detail::JpegIODecompress {
-    boost::shared_array<const uint8> m_data;
+namespace {
+
+// A libjpeg context that decodes one memory buffer after another.
+class MemoryJpegDecoder : public fileio::detail::JpegIODecompress {
+    const uint8* m_data;
     size_t m_len;
   protected:
-    virtual void bind() { fileio::detail::jpeg_ptr_src(&m_ctx, m_data.get(), m_len); }
+    virtual void bind() { fileio::detail::jpeg_ptr_src(&m_ctx, m_data, m_len); }
   public:
-    Data* rewind() const VW_WARN_UNUSED {std::auto_ptr<Data> r(new Data(m_data, m_len)); r->open(); return r.release();}
-    Data(boost::shared_array<const uint8> buffer, size_t len) : m_data(buffer), m_len(len) {
-      VW_ASSERT(buffer, ArgumentErr() << VW_CURRENT_FUNCTION << ": buffer must be non-null");
-      VW_ASSERT(len,    ArgumentErr() << VW_CURRENT_FUNCTION << ": len must be non-zero");
+    MemoryJpegDecoder() : m_data(0), m_len(0) {}
+
+    // Read the header of an image at 1/2^level of its full size.  The
+    // buffer must outlive the decoding.
+    void open(const uint8* data, size_t len, int level) {
+      reset();
+      m_data = data;
+      m_len = len;
+      set_reduction(level);
+      JpegIODecompress::open();
     }
-};
-
-SrcMemoryImageResourceJPEG::SrcMemoryImageResourceJPEG(boost::shared_array<const uint8> buffer, size_t len)
-  : m_data(new Data(buffer, len)) {
-    m_data->open();
-}
 
-void SrcMemoryImageResourceJPEG::read( ImageBuffer const& dst, BBox2i const& bbox_ ) const {
-  size_t width = bbox_.width(), height = bbox_.height(), planes = dst.format.planes;
-  VW_ASSERT( dst.format.cols == width && dst.format.rows == height,
-             ArgumentErr() << VW_CURRENT_FUNCTION << ": Destination buffer has wrong dimensions!" );
-  VW_ASSERT( dst.format.cols == size_t(cols()) && dst.format.rows == size_t(rows()),
-             ArgumentErr() << VW_CURRENT_FUNCTION << ": Partial reads are not supported");
+    virtual ScanlineReadBackend* rewind() const {
+      vw_throw(NoImplErr() << "MemoryJpegDecoder: reopen the decoder instead of rewinding it");
+      return 0; // never reached
+    }
+};
 
-  if (!m_data->ready())
-    m_data.reset(m_data->rewind());
+boost::thread_specific_ptr<MemoryJpegDecoder> thread_decoder_ptr;
 
-  // shared rather than scoped so we get a deleter.
-  boost::shared_array<uint8> buf;
+MemoryJpegDecoder& thread_decoder() {
+  if (!thread_decoder_ptr.get())
+    thread_decoder_ptr.reset(new MemoryJpegDecoder());
+  return *thread_decoder_ptr;
+}
 
-  // no conversion necessary?
-  bool simple = m_data->fmt().simple_convert(dst.format);
+// libjpeg destroys a context when it reports an error, so a decoder
+// that fails is thrown away.
+void discard_thread_decoder() {
+  thread_decoder_ptr.reset();
+}
 
-  size_t bufsize = m_data->line_bytes() * height * planes;
+} // namespace
 
-  // If we don't need to convert, we read directly into the dst buffer (using a
-  // noop_deleter, so the destructor doesn't try to delete it)
-  if (simple)
-    buf.reset( reinterpret_cast<uint8*>(const_cast<void*>(dst.data)), NOP() );
-  else
-    buf.reset( new uint8[bufsize] );
+SrcMemoryImageResourceJPEG::SrcMemoryImageResourceJPEG(boost::shared_array<const uint8> buffer, size_t len)
+  : m_buffer(buffer), m_len(len) {
+  VW_ASSERT(buffer, ArgumentErr() << VW_CURRENT_FUNCTION << ": buffer must be non-null");
+  VW_ASSERT(len,    ArgumentErr() << VW_CURRENT_FUNCTION << ": len must be non-zero");
+  try {
+    MemoryJpegDecoder& decoder = thread_decoder();
+    decoder.open(m_buffer.get(), m_len, 0);
+    m_fmt = decoder.fmt();
+    decoder.reset();
+  } catch (...) {
+    discard_thread_decoder();
+    throw;
+  }
+}
 
-  m_data->read(buf.get(), bufsize);
+void SrcMemoryImageResourceJPEG::read( ImageBuffer const& dst, BBox2i const& bbox ) const {
+  read_reduced(dst, bbox, 0);
+}
 
-  if (simple)
+void SrcMemoryImageResourceJPEG::read_reduced( ImageBuffer const& dst, BBox2i const& bbox, int32 level ) const {
+  // Beyond what libjpeg can reduce, stride over the smallest level.
+  if (level > 3) {
+    ImageFormat fmt = m_fmt;
+    fmt.cols = (fmt.cols + 7) / 8;
+    fmt.rows = (fmt.rows + 7) / 8;
+    boost::scoped_array<uint8> data( new uint8[fmt.byte_size()] );
+    ImageBuffer src( fmt, data.get() );
+    read_reduced(src, BBox2i(0, 0, fmt.cols, fmt.rows), 3);
+
+    ssize_t factor = 1 << (level - 3);
+    VW_ASSERT( bbox.min().x() >= 0 && bbox.min().y() >= 0 &&
+               (bbox.max().x()-1) * factor < fmt.cols && (bbox.max().y()-1) * factor < fmt.rows,
+               ArgumentErr() << VW_CURRENT_FUNCTION << ": bbox exceeds the reduced image." );
+    src.data = reinterpret_cast<uint8*>(src.data) + factor * (bbox.min().x() * src.cstride + bbox.min().y() * src.rstride);
+    src.format.cols = bbox.width();
+    src.format.rows = bbox.height();
+    src.cstride *= factor;
+    src.rstride *= factor;
+    convert(dst, src, true);
     return;
+  }
+  VW_ASSERT( level >= 0, ArgumentErr() << VW_CURRENT_FUNCTION << ": invalid level " << level );
+  VW_ASSERT( dst.format.cols == size_t(bbox.width()) && dst.format.rows == size_t(bbox.height()),
+             ArgumentErr() << VW_CURRENT_FUNCTION << ": Destination buffer has wrong dimensions!" );
+  VW_ASSERT( bbox.min().x() == 0 && bbox.min().y() == 0,
+             ArgumentErr() << VW_CURRENT_FUNCTION << ": Partial reads are not supported");
 
-  ImageFormat src_fmt(m_data->fmt());
-  src_fmt.rows = height;
-  src_fmt.cols = width;
+  try {
+    MemoryJpegDecoder& decoder = thread_decoder();
+    decoder.open(m_buffer.get(), m_len, level);
+    ImageFormat src_fmt(decoder.fmt());
+    VW_ASSERT( dst.format.cols == src_fmt.cols && dst.format.rows == src_fmt.rows,
+               ArgumentErr() << VW_CURRENT_FUNCTION << ": Partial reads are not supported");
+
+    // Decode straight into the destination when no conversion is needed.
+    if (src_fmt.simple_convert(dst.format) && dst.format.planes == src_fmt.planes &&
+        dst.cstride == ssize_t(decoder.chan_bytes()) && dst.rstride >= ssize_t(decoder.line_bytes())) {
+      size_t bufsize = (src_fmt.rows - 1) * dst.rstride + decoder.line_bytes();
+      decoder.read(reinterpret_cast<uint8*>(dst.data), bufsize, dst.rstride);
+      return;
+    }
 
-  ImageBuffer src(src_fmt, buf.get());
-  convert(dst, src, true);
+    size_t bufsize = decoder.line_bytes() * src_fmt.rows * src_fmt.planes;
+    boost::scoped_array<uint8> buf( new uint8[bufsize] );
+    decoder.read(buf.get(), bufsize);
+
+    ImageBuffer src(src_fmt, buf.get());
+    convert(dst, src, true);
+  } catch (...) {
+    discard_thread_decoder();
+    throw;
+  }
 }
 
 ImageFormat SrcMemoryImageResourceJPEG::format() const {
-  return m_data->fmt();
+  return m_fmt;
 }
 
 class DstMemoryImageResourceJPEG::Data : public fileio::detail::JpegIOCompress {
@@ -118,7 +182,7 @@ void DstMemoryImageResourceJPEG::write( ImageBuffer const& src, BBox2i const& bb
     convert(dst, src, true);
   }
 
-  m_data->write(buf.get(), bufsize, width, height, planes);
+  m_data->write(buf.get(), bufsize, height, width, planes);
 }
 
 const uint8* DstMemoryImageResourceJPEG::data() const {
@@ -13,19 +13,34 @@
 
 namespace vw {
 
+  /// Decodes a JPEG held in memory.  The resource holds no libjpeg
+  /// state of its own: each thread decodes through a libjpeg context
+  /// of its own that is kept from one image to the next, so opening
+  /// and reading many small tiles doesn't set up libjpeg each time,
+  /// and one resource may be read from several threads at once.
   class SrcMemoryImageResourceJPEG : public SrcMemoryImageResource, private boost::noncopyable {
-      struct Data;
-      mutable boost::shared_ptr<Data> m_data;
+      boost::shared_array<const uint8> m_buffer;
+      size_t m_len;
+      ImageFormat m_fmt;
 
     public:
       SrcMemoryImageResourceJPEG(boost::shared_array<const uint8> buffer, size_t len);
 
+      /// Decode the image.  The decoder writes straight into the
+      /// buffer when it has the image's own format.
       virtual void read( ImageBuffer const& buf, BBox2i const& bbox ) const;
 
+      /// Levels 1 to 3 are decoded at 1/2, 1/4 or 1/8 of the full size
+      /// with libjpeg's DCT scaling, which costs much less than
+      /// decoding the whole image.
+      virtual int32 overview_levels() const { return 3; }
+      virtual void read_reduced( ImageBuffer const& buf, BBox2i const& bbox, int32 level ) const;
+
       virtual ImageFormat format() const;
 
       virtual bool has_block_read() const  {return false;}
       virtual bool has_nodata_read() const {return false;}
+      virtual bool has_concurrent_read() const {return true;}
   };
 
   class DstMemoryImageResourceJPEG : public DstMemoryImageResource {
@@ -9,6 +9,8 @@
 #include <vw/FileIO/PngIO.h>
 #include <vw/Core/Debugging.h>
 
+#include <boost/scoped_array.hpp>
+
 namespace vw {
 
 class SrcMemoryImageResourcePNG::Data : public fileio::detail::PngIODecompress {
@@ -47,30 +49,20 @@ void SrcMemoryImageResourcePNG::read( ImageBuffer const& dst, BBox2i const& bbox
   if (!m_data->ready())
     m_data.reset(m_data->rewind());
 
-  // shared rather than scoped so we get a deleter.
-  boost::shared_array<uint8> buf;
+  ImageFormat src_fmt(m_data->fmt());
 
-  // no conversion necessary?
-  bool simple = m_data->fmt().simple_convert(dst.format);
+  // Decode straight into the destination when no conversion is needed.
+  if (src_fmt.simple_convert(dst.format) && dst.format.planes == src_fmt.planes &&
+      dst.cstride == ssize_t(m_data->chan_bytes()) && dst.rstride >= ssize_t(m_data->line_bytes())) {
+    size_t bufsize = (height - 1) * dst.rstride + m_data->line_bytes();
+    m_data->read(reinterpret_cast<uint8*>(dst.data), bufsize, dst.rstride);
+    return;
+  }
 
   size_t bufsize = m_data->line_bytes() * height * planes;
-
-  // If we don't need to convert, we read directly into the dst buffer (using a
-  // noop_deleter, so the destructor doesn't try to delete it)
-  if (simple)
-    buf.reset( reinterpret_cast<uint8*>(const_cast<void*>(dst.data)), NOP() );
-  else
-    buf.reset( new uint8[bufsize] );
-
+  boost::scoped_array<uint8> buf( new uint8[bufsize] );
   m_data->read(buf.get(), bufsize);
 
-  if (simple)
-    return;
-
-  ImageFormat src_fmt(m_data->fmt());
-  src_fmt.rows = height;
-  src_fmt.cols = width;
-
   ImageBuffer src(src_fmt, buf.get());
   convert(dst, src, true);
 }
@@ -137,7 +129,7 @@ void DstMemoryImageResourcePNG::write( ImageBuffer const& src, BBox2i const& bbo
     convert(dst, src, true);
   }
 
-  m_data->write(buf.get(), bufsize, width, height, planes);
+  m_data->write(buf.get(), bufsize, height, width, planes);
 }
 
 const uint8* DstMemoryImageResourcePNG::data() const {
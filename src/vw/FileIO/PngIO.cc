@@ -38,14 +38,18 @@ bool PngIODecompress::ready() const {
 }
 
 void PngIODecompress::read(uint8* buffer, size_t bufsize) {
-  VW_ASSERT(this->ready(), LogicErr() << "PngIO: Cannot reread");
+  read(buffer, bufsize, line_bytes());
+}
 
-  size_t skip = line_bytes();
-  VW_ASSERT(bufsize >= m_fmt.rows * skip, LogicErr() << "Buffer is too small");
+void PngIODecompress::read(uint8* buffer, size_t bufsize, size_t rstride) {
+  VW_ASSERT(this->ready(), LogicErr() << "PngIO: Cannot reread");
+  VW_ASSERT(rstride >= line_bytes(), LogicErr() << "Line stride is too small");
+  VW_ASSERT(m_fmt.rows == 0 || bufsize >= (m_fmt.rows-1) * rstride + line_bytes(),
+            LogicErr() << "Buffer is too small");
 
   boost::scoped_array<png_bytep> rows( new png_bytep[m_fmt.rows] );
   for(size_t i=0; i < m_fmt.rows; ++i)
-    rows[i] = reinterpret_cast<png_bytep>(buffer + i * m_rstride);
+    rows[i] = reinterpret_cast<png_bytep>(buffer + i * rstride);
 
   m_read = true;
   png_read_image(m_ctx, rows.get());
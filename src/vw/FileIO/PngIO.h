@@ -40,6 +40,9 @@ class PngIODecompress : public PngIO, public ScanlineReadBackend {
     void open();
     bool ready() const;
     void read(uint8* data, size_t bufsize);
+    // Like read(), but with rstride bytes from the start of one line
+    // to the start of the next.
+    void read(uint8* data, size_t bufsize, size_t rstride);
 };
 
 class PngIOCompress : public PngIO, public ScanlineWriteBackend {
@@ -0,0 +1,90 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file ReadHandlePool.h
+///
+/// A pool of read-only file handles, used by the disk image resources
+/// that support concurrent reads.  Each reader checks out a handle of
+/// its own, opening a new one only when all of the handles opened so
+/// far are in use, so a file read from N threads at once ends up with
+/// N handles that are reused for the life of the resource.  Only the
+/// pool itself is locked, and only while a handle is taken or returned.
+///
+#ifndef __VW_FILEIO_READHANDLEPOOL_H__
+#define __VW_FILEIO_READHANDLEPOOL_H__
+
+#include <vector>
+
+#include <vw/Core/Thread.h>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace vw {
+namespace fileio {
+namespace detail {
+
+  template <class HandleT>
+  class ReadHandlePool : private boost::noncopyable {
+  public:
+    typedef boost::shared_ptr<HandleT> handle_type;
+    typedef boost::function<handle_type ()> open_type;
+
+  private:
+    open_type m_open;
+    Mutex m_mutex;
+    std::vector<handle_type> m_idle;
+
+  public:
+    /// The open function returns a new handle, or throws.  It is
+    /// called without the pool locked.
+    ReadHandlePool( open_type const& open ) : m_open(open) {}
+
+    /// Checks out a handle for the lifetime of the object, returning
+    /// it to the pool when done.
+    class Handle : private boost::noncopyable {
+      ReadHandlePool& m_pool;
+      handle_type m_handle;
+    public:
+      Handle( ReadHandlePool& pool ) : m_pool(pool), m_handle(pool.take()) {}
+      ~Handle() { m_pool.give(m_handle); }
+      HandleT* operator->() const { return m_handle.get(); }
+      HandleT* get() const { return m_handle.get(); }
+    };
+
+    /// Closes all of the idle handles.
+    void clear() {
+      std::vector<handle_type> idle;
+      {
+        Mutex::Lock lock(m_mutex);
+        idle.swap(m_idle);
+      }
+    }
+
+  private:
+    handle_type take() {
+      {
+        Mutex::Lock lock(m_mutex);
+        if( !m_idle.empty() ) {
+          handle_type handle = m_idle.back();
+          m_idle.pop_back();
+          return handle;
+        }
+      }
+      return m_open();
+    }
+
+    void give( handle_type const& handle ) {
+      Mutex::Lock lock(m_mutex);
+      m_idle.push_back(handle);
+    }
+  };
+
+}}} // namespace vw::fileio::detail
+
+#endif // __VW_FILEIO_READHANDLEPOOL_H__
@@ -9,6 +9,7 @@
 #include <gtest/gtest.h>
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/FileIO/DiskImageView.h>
+#include <vw/Core/Settings.h>
 #include <test/Helpers.h>
 
 #include <boost/scoped_ptr.hpp>
@@ -53,3 +54,24 @@ TEST( BlockFileIO, TIF_Post_Crop ) {
   ImageView<PixelRGB<uint8> > result = crop(div,100,100,100,100);
   write_image(fn2, result );
 }
+
+#if (defined(VW_HAVE_PKG_TIFF) && VW_HAVE_PKG_TIFF==1) || (defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1)
+TEST( BlockFileIO, TIF_Concurrent_Read ) {
+  UnlinkName fn("concurrent.mural.tif");
+
+  ImageView<PixelRGB<uint8> > image;
+  ASSERT_NO_THROW( read_image( image, TEST_SRCDIR"/mural.png" ) );
+  write_image( fn, image );
+
+  bool concurrent = vw_settings().concurrent_file_reads();
+  vw_settings().set_concurrent_file_reads( true );
+  boost::shared_ptr<DiskImageResource> rsrc( DiskImageResource::open( fn ) );
+  vw_settings().set_concurrent_file_reads( concurrent );
+  EXPECT_TRUE( rsrc->has_concurrent_read() );
+
+  // Read small blocks from many threads at once.
+  ImageView<PixelRGB<uint8> > result =
+    block_rasterize( ImageResourceView<PixelRGB<uint8> >( rsrc ), Vector2i(32,32), 8 );
+  EXPECT_VW_EQ( image, result );
+}
+#endif
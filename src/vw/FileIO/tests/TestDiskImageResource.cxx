@@ -7,6 +7,7 @@
 
 // TestDiskImageResource.h
 #include <gtest/gtest.h>
+#include <boost/bind.hpp>
 #include <vw/FileIO.h>
 #include <vw/FileIO/DiskImageResource_internal.h>
 #include <vw/Image/PixelTypes.h>
@@ -323,6 +324,10 @@ TEST( DiskImageResource, NonExistentFiles ) {
                vw::ArgumentErr);
   EXPECT_THROW(r.reset(DiskImageResourcePBM::construct_open("nonfile.pgm")),
                vw::ArgumentErr);
+  EXPECT_THROW(r.reset(DiskImageResourceRaw::construct_open("nonfile.vwr")),
+               vw::ArgumentErr);
+  EXPECT_THROW(r.reset(DiskImageResourceVWT::construct_open("nonfile.vwt")),
+               vw::ArgumentErr);
 }
 
 TEST( DiskImageResource, WrongFiles ) {
@@ -353,4 +358,388 @@ TEST( DiskImageResource, WrongFiles ) {
                vw::ArgumentErr);
   EXPECT_THROW(r.reset(DiskImageResourcePBM::construct_open("rgb2x2.tif")),
                vw::ArgumentErr);
+  EXPECT_THROW(r.reset(DiskImageResourceRaw::construct_open("rgb2x2.tif")),
+               vw::ArgumentErr);
+  EXPECT_THROW(r.reset(DiskImageResourceVWT::construct_open("rgb2x2.tif")),
+               vw::ArgumentErr);
+}
+
+TEST( DiskImageResource, RawTiles ) {
+  UnlinkName fn("tiles.vwr");
+  ImageView<float> image(37,23,2);
+  for( int32 p=0; p<image.planes(); ++p )
+    for( int32 j=0; j<image.rows(); ++j )
+      for( int32 i=0; i<image.cols(); ++i )
+        image(i,j,p) = i + 100*j + 10000*p;
+
+  {
+    DiskImageResourceRaw rsrc( fn, image.format(), Vector2i(8,16) );
+    EXPECT_EQ( Vector2i(8,16), rsrc.block_write_size() );
+    write_image( rsrc, image );
+  }
+
+  DiskImageResourceRaw rsrc( fn );
+  EXPECT_EQ( Vector2i(8,16), rsrc.block_read_size() );
+  EXPECT_TRUE( rsrc.has_concurrent_read() );
+  ASSERT_EQ( 37, rsrc.cols() );
+  ASSERT_EQ( 23, rsrc.rows() );
+  ASSERT_EQ( 2, rsrc.planes() );
+
+  ImageView<float> result;
+  read_image( result, rsrc );
+  EXPECT_VW_EQ( image, result );
+
+  // A block that spans tiles, converted as it is read.
+  ImageView<double> block(20,12,2);
+  rsrc.read( block.buffer(), BBox2i(5,10,20,12) );
+  for( int32 p=0; p<2; ++p )
+    for( int32 j=0; j<12; ++j )
+      for( int32 i=0; i<20; ++i )
+        EXPECT_EQ( image(i+5,j+10,p), block(i,j,p) );
+
+  // A block within one tile can be used in place.
+  EXPECT_FALSE( rsrc.has_mapped_buffer( BBox2i(5,10,20,12) ) );
+  EXPECT_TRUE( rsrc.has_mapped_buffer( BBox2i(33,16,4,7) ) );
+  ImageBuffer mapped = rsrc.mapped_buffer( BBox2i(33,16,4,7) );
+  EXPECT_EQ( 4, mapped.cols() );
+  EXPECT_EQ( 7, mapped.rows() );
+  float const* pixel = (float const*)( (uint8 const*)mapped.data + 2*mapped.rstride + mapped.cstride + mapped.pstride );
+  EXPECT_EQ( image(34,18,1), *pixel );
+}
+
+TEST( DiskImageResource, VWTTiles ) {
+  UnlinkName fn("tiles.vwt");
+  ImageView<float> image(37,23,2);
+  for( int32 p=0; p<image.planes(); ++p )
+    for( int32 j=0; j<image.rows(); ++j )
+      for( int32 i=0; i<image.cols(); ++i )
+        image(i,j,p) = i + 100*j + 10000*p;
+
+  {
+    // The tiles are written from several threads at once.
+    DiskImageResourceVWT rsrc( fn, image.format(), Vector2i(8,16) );
+    EXPECT_EQ( Vector2i(8,16), rsrc.block_write_size() );
+    EXPECT_TRUE( rsrc.has_concurrent_write() );
+    block_write_image( rsrc, image );
+  }
+
+  DiskImageResourceVWT rsrc( fn );
+  EXPECT_EQ( Vector2i(8,16), rsrc.block_read_size() );
+  EXPECT_EQ( DiskImageResourceVWT::default_compression(), rsrc.compression() );
+  EXPECT_TRUE( rsrc.has_concurrent_read() );
+  EXPECT_FALSE( rsrc.has_nodata_read() );
+  ASSERT_EQ( 37, rsrc.cols() );
+  ASSERT_EQ( 23, rsrc.rows() );
+  ASSERT_EQ( 2, rsrc.planes() );
+
+  ImageView<float> result;
+  read_image( result, rsrc );
+  EXPECT_VW_EQ( image, result );
+
+  // A block that spans tiles, converted as it is read.
+  ImageView<double> block(20,12,2);
+  rsrc.read( block.buffer(), BBox2i(5,10,20,12) );
+  for( int32 p=0; p<2; ++p )
+    for( int32 j=0; j<12; ++j )
+      for( int32 i=0; i<20; ++i )
+        EXPECT_EQ( image(i+5,j+10,p), block(i,j,p) );
+}
+
+TEST( DiskImageResource, VWTNodata ) {
+  UnlinkName fn("nodata.vwt");
+  ImageView<PixelRGB<int16> > image(20,10);
+  for( int32 j=0; j<image.rows(); ++j )
+    for( int32 i=0; i<image.cols(); ++i )
+      image(i,j) = PixelRGB<int16>( i, j, i*j );
+
+  {
+    DiskImageResourceVWT rsrc( fn, image.format(), Vector2i(16,8),
+                               DiskImageResourceVWT::COMPRESSION_NONE );
+    rsrc.set_nodata_write( -5 );
+
+    // Only the bottom right tile, clipped to the image, is written.
+    ImageView<PixelRGB<int16> > tile = crop( image, BBox2i(16,8,4,2) );
+    rsrc.write( tile.buffer(), BBox2i(16,8,4,2) );
+
+    // A block must cover the tiles it touches.
+    EXPECT_THROW( rsrc.write( tile.buffer(), BBox2i(4,4,4,2) ), ArgumentErr );
+  }
+
+  DiskImageResourceVWT rsrc( fn );
+  EXPECT_EQ( DiskImageResourceVWT::COMPRESSION_NONE, rsrc.compression() );
+  ASSERT_TRUE( rsrc.has_nodata_read() );
+  EXPECT_EQ( -5, rsrc.nodata_read() );
+
+  ImageView<PixelRGB<int16> > result;
+  read_image( result, rsrc );
+  ASSERT_EQ( 20, result.cols() );
+  ASSERT_EQ( 10, result.rows() );
+  for( int32 j=0; j<result.rows(); ++j )
+    for( int32 i=0; i<result.cols(); ++i ) {
+      if( i >= 16 && j >= 8 )
+        EXPECT_PIXEL_EQ( image(i,j), result(i,j) );
+      else
+        EXPECT_PIXEL_EQ( PixelRGB<int16>(-5,-5,-5), result(i,j) );
+    }
+}
+
+TEST( DiskImageResource, VWTMaskedRead ) {
+  UnlinkName fn("masked.vwt");
+  ImageView<float> image(20,10);
+  for( int32 j=0; j<image.rows(); ++j )
+    for( int32 i=0; i<image.cols(); ++i )
+      image(i,j) = float( i + 100*j );
+  image(17,9) = -9999;
+
+  {
+    DiskImageResourceVWT rsrc( fn, image.format(), Vector2i(16,8),
+                               DiskImageResourceVWT::COMPRESSION_NONE );
+    rsrc.set_nodata_write( -9999 );
+    ImageView<float> tile = crop( image, BBox2i(16,8,4,2) );
+    rsrc.write( tile.buffer(), BBox2i(16,8,4,2) );
+  }
+
+  // Nodata pixels, stored or not, read as invalid.
+  DiskImageView<PixelMask<float> > view( fn );
+  ImageView<PixelMask<float> > result = view;
+  for( int32 j=0; j<result.rows(); ++j )
+    for( int32 i=0; i<result.cols(); ++i ) {
+      if( i >= 16 && j >= 8 && !( i == 17 && j == 9 ) ) {
+        EXPECT_TRUE( is_valid( result(i,j) ) ) << i << "," << j;
+        EXPECT_EQ( image(i,j), result(i,j).child() );
+      }
+      else
+        EXPECT_FALSE( is_valid( result(i,j) ) ) << i << "," << j;
+    }
+
+  // Only the stored tile holds anything.
+  EXPECT_FALSE( sparse_check( view, BBox2i(0,0,16,8) ) );
+  EXPECT_FALSE( sparse_check( view, BBox2i(0,0,16,10) ) );
+  EXPECT_TRUE( sparse_check( view, BBox2i(10,5,8,4) ) );
+  EXPECT_FALSE( sparse_check( view, BBox2i(20,0,4,4) ) );
+
+  // The reduced image knows the same.
+  EXPECT_FALSE( sparse_check( view.overview(1), BBox2i(0,0,8,4) ) );
+  EXPECT_TRUE( sparse_check( view.overview(1), BBox2i(8,4,2,1) ) );
+
+  // Unmasked views aren't empty anywhere: their nodata is a value.
+  DiskImageView<float> plain( fn );
+  EXPECT_TRUE( sparse_check( plain, BBox2i(0,0,16,8) ) );
+}
+
+TEST( DiskImageResource, VWTResume ) {
+  UnlinkName fn("resume.vwt");
+  UnlinkName journal_fn("resume.vwt.journal");
+  ImageView<float> image(37,23), changed(37,23);
+  for( int32 j=0; j<image.rows(); ++j )
+    for( int32 i=0; i<image.cols(); ++i ) {
+      image(i,j) = float( i + 100*j );
+      changed(i,j) = -image(i,j);
+    }
+
+  {
+    // The first run checkpoints after every block.
+    DiskImageResourceVWT rsrc( fn, image.format(), Vector2i(8,8) );
+    EXPECT_TRUE( rsrc.has_checkpoint() );
+    BlockWriteJournal journal( journal_fn, "run", 0 );
+    block_write_image( rsrc, image, journal );
+  }
+
+  // Cut the journal short, in the middle of a line, as if the run had
+  // been killed.
+  std::vector<string> lines;
+  {
+    std::ifstream in( journal_fn.c_str() );
+    string line;
+    while( std::getline( in, line ) ) lines.push_back( line );
+  }
+  ASSERT_EQ( 2u + 5*3, lines.size() );
+  std::set<int> kept;
+  {
+    std::ofstream out( journal_fn.c_str(), std::ios::trunc );
+    out << lines[0] << "\n" << lines[1] << "\n";
+    for( size_t i = 2; i < 7; ++i ) {
+      out << lines[i] << "\n";
+      kept.insert( atoi( lines[i].c_str() ) );
+    }
+    out << lines[7].substr( 0, 1 );
+  }
+  EXPECT_FALSE( BlockWriteJournal( journal_fn, "other" ).has_progress() );
+  EXPECT_TRUE( BlockWriteJournal( journal_fn, "run" ).has_progress() );
+
+  // Running again writes only the blocks the journal doesn't hold,
+  // and removes the journal once the image is complete.
+  resumable_write_image( fn, changed, "run" );
+  EXPECT_FALSE( std::ifstream( journal_fn.c_str() ).good() );
+
+  ImageView<float> result;
+  read_image( result, fn );
+  ASSERT_EQ( 37, result.cols() );
+  ASSERT_EQ( 23, result.rows() );
+  for( int32 j=0; j<result.rows(); ++j )
+    for( int32 i=0; i<result.cols(); ++i ) {
+      int block = (j/8)*5 + i/8;
+      EXPECT_EQ( kept.count(block) ? image(i,j) : changed(i,j), result(i,j) ) << i << "," << j;
+    }
+
+  // With no journal the image is written afresh.
+  resumable_write_image( fn, image, "run" );
+  read_image( result, fn );
+  EXPECT_VW_EQ( image, result );
+}
+
+TEST( DiskImageResource, OpenMany ) {
+  std::vector<boost::shared_ptr<UnlinkName> > names;
+  std::vector<string> filenames;
+  for( int32 i = 0; i < 5; ++i ) {
+    std::ostringstream fn;
+    fn << "open" << i << ".vwr";
+    names.push_back( boost::shared_ptr<UnlinkName>( new UnlinkName( fn.str() ) ) );
+    filenames.push_back( *names.back() );
+    write_image( filenames.back(), ImageView<float>( 3+i, 2 ) );
+  }
+
+  // The resources come back in the order of the files.
+  std::vector<boost::shared_ptr<DiskImageResource> > resources =
+    DiskImageResource::open( filenames, 3 );
+  ASSERT_EQ( filenames.size(), resources.size() );
+  for( int32 i = 0; i < 5; ++i ) {
+    ASSERT_TRUE( resources[i] );
+    EXPECT_EQ( 3+i, resources[i]->cols() );
+  }
+
+  // One file that can't be opened fails the whole batch.
+  filenames.insert( filenames.begin() + 2, "nonfile.vwr" );
+  EXPECT_THROW( DiskImageResource::open( filenames ), IOErr );
+}
+
+#if defined(VW_HAVE_PKG_PNG) && VW_HAVE_PKG_PNG==1
+TEST( DiskImageResource, SequentialWritePNG ) {
+  // An image several strips tall is streamed through in strips.
+  uint32 tile_size = vw_settings().default_tile_size();
+  vw_settings().set_default_tile_size( 16 );
+
+  ImageView<PixelGray<uint8> > image( 13, 50 ), result;
+  for( int32 j = 0; j < image.rows(); ++j )
+    for( int32 i = 0; i < image.cols(); ++i )
+      image(i,j) = uint8( 7*i + 3*j );
+
+  for( int32 threaded = 0; threaded < 2; ++threaded ) {
+    UnlinkName fn("sequential.png");
+    {
+      DiskImageResourcePNG resource( fn, image.format() );
+      EXPECT_TRUE( resource.has_sequential_write() );
+      if( threaded ) block_write_image( resource, image );
+      else write_image( resource, image );
+    }
+    read_image( result, fn );
+    ASSERT_EQ( image.cols(), result.cols() );
+    ASSERT_EQ( image.rows(), result.rows() );
+    EXPECT_SEQ_EQ( image, result );
+  }
+
+  // Strips must come from the top down.
+  {
+    UnlinkName fn("sequential.png");
+    DiskImageResourcePNG resource( fn, image.format() );
+    ImageView<PixelGray<uint8> > strip = crop( image, 0, 16, 13, 16 );
+    EXPECT_THROW( resource.write( strip.buffer(), BBox2i(0,16,13,16) ), NoImplErr );
+  }
+
+  // Interlaced images are still written whole.
+  {
+    UnlinkName fn("interlaced.png");
+    DiskImageResourcePNG::Options options;
+    options.using_interlace = true;
+    DiskImageResourcePNG resource( fn, image.format(), options );
+    EXPECT_FALSE( resource.has_sequential_write() );
+  }
+
+  vw_settings().set_default_tile_size( tile_size );
+}
+#endif
+
+#if defined(VW_HAVE_PKG_JPEG) && VW_HAVE_PKG_JPEG==1
+TEST( DiskImageResource, SequentialWriteJPEG ) {
+  uint32 tile_size = vw_settings().default_tile_size();
+  vw_settings().set_default_tile_size( 16 );
+
+  ImageView<PixelRGB<uint8> > image( 21, 50 );
+  for( int32 j = 0; j < image.rows(); ++j )
+    for( int32 i = 0; i < image.cols(); ++i )
+      image(i,j) = PixelRGB<uint8>( uint8(7*i), uint8(3*j), uint8(i+j) );
+
+  // Streaming the image through in strips encodes it just as writing
+  // it at once does.
+  UnlinkName whole_fn("whole.jpg"), strips_fn("strips.jpg");
+  {
+    DiskImageResourceJPEG resource( whole_fn, image.format() );
+    resource.write( image.buffer(), BBox2i(0,0,image.cols(),image.rows()) );
+  }
+  {
+    DiskImageResourceJPEG resource( strips_fn, image.format() );
+    EXPECT_TRUE( resource.has_sequential_write() );
+    block_write_image( resource, image );
+  }
+  ImageView<PixelRGB<uint8> > whole, strips;
+  read_image( whole, whole_fn );
+  read_image( strips, strips_fn );
+  ASSERT_EQ( image.rows(), strips.rows() );
+  EXPECT_SEQ_EQ( whole, strips );
+
+  {
+    DiskImageResourceJPEG resource( whole_fn );
+    EXPECT_FALSE( resource.has_sequential_write() );
+  }
+
+  vw_settings().set_default_tile_size( tile_size );
+}
+#endif
+
+#if defined(VW_HAVE_PKG_OPENEXR) && VW_HAVE_PKG_OPENEXR==1
+TEST( DiskImageResource, OpenEXRTiledHalf ) {
+  ImageView<float32> image( 40, 30 ), result;
+  for( int32 j = 0; j < image.rows(); ++j )
+    for( int32 i = 0; i < image.cols(); ++i )
+      image(i,j) = float32( i ) + 0.25f * float32( j % 4 );
+
+  for( int32 half = 0; half < 2; ++half ) {
+    UnlinkName fn("tiled.exr");
+    {
+      DiskImageResourceOpenEXR resource( fn, image.format() );
+      resource.set_block_write_size( Vector2i(16,16) );
+      if( half ) resource.set_half_float( true );
+      EXPECT_VECTOR_EQ( Vector2i(16,16), resource.block_write_size() );
+      block_write_image( resource, image );
+    }
+    DiskImageResourceOpenEXR resource( fn );
+    EXPECT_VECTOR_EQ( Vector2i(16,16), resource.block_read_size() );
+    read_image( result, resource );
+    ASSERT_EQ( image.cols(), result.cols() );
+    ASSERT_EQ( image.rows(), result.rows() );
+    // These values are exact in half floats too.
+    EXPECT_SEQ_EQ( image, result );
+  }
+}
+#endif
+
+static void collect_extension( std::set<std::string>* names, std::string const& name ) {
+  names->insert( name );
+}
+
+TEST( DiskImageResource, RegisterFileType ) {
+  DiskImageResource::register_file_type( ".VWTestPBM", DiskImageResourcePBM::type_static(),
+                                         &DiskImageResourcePBM::construct_open,
+                                         &DiskImageResourcePBM::construct_create );
+  ImageView<PixelGray<uint8> > image( 3, 2 );
+  UnlinkName fn( "registered.vwtestpbm" );
+  boost::scoped_ptr<DiskImageResource> r( DiskImageResource::create( fn, image.format() ) );
+  EXPECT_EQ( DiskImageResourcePBM::type_static(), r->type() );
+
+  // Listing the extensions registers all of the defaults too
+  std::set<std::string> names;
+  foreach_ext( "x", boost::bind( &collect_extension, &names, _1 ) );
+  EXPECT_EQ( 1u, names.count( "x.vwtestpbm" ) );
+  EXPECT_EQ( 1u, names.count( "x.vwt" ) );
+  EXPECT_EQ( 1u, names.count( "x.pgm" ) );
 }
@@ -12,8 +12,13 @@
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageMath.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/FileIO/DiskImageResourceRaw.h>
+
+#include <test/Helpers.h>
 
 using namespace vw;
+using namespace vw::test;
 
 #if defined(VW_HAVE_PKG_PNG) && VW_HAVE_PKG_PNG==1
 TEST( DiskImageView, Construction ) {
@@ -94,3 +99,35 @@ TEST( DiskCacheImageView, Construction ) {
 
 }
 #endif
+
+TEST( DiskImageView, Overview ) {
+  ImageView<float> image( 37, 22 );
+  for( int32 j = 0; j < image.rows(); ++j )
+    for( int32 i = 0; i < image.cols(); ++i )
+      image(i,j) = float( i + 100*j );
+
+  UnlinkName fn( "overview.vwr" );
+  {
+    DiskImageResourceRaw resource( fn, image.format() );
+    write_image( resource, image );
+  }
+
+  // A raw file has no overviews of its own, so the reduced levels
+  // keep every 2^level-th pixel.
+  DiskImageView<float> view( fn );
+  EXPECT_EQ( 0, view.overview_levels() );
+  for( int32 level = 0; level < 4; ++level ) {
+    DiskImageView<float> reduced = view.overview( level );
+    EXPECT_EQ( view.filename(), reduced.filename() );
+    ImageView<float> expected = subsample( image, 1 << level );
+    ASSERT_EQ( expected.cols(), reduced.cols() ) << "level " << level;
+    ASSERT_EQ( expected.rows(), reduced.rows() ) << "level " << level;
+    EXPECT_VW_EQ( expected, ImageView<float>( reduced ) );
+
+    // Reading part of a level.
+    DiskImageResourceRaw resource( fn );
+    ImageView<float> part( 3, 2 );
+    resource.read_reduced( part.buffer(), BBox2i( 1, 1, 3, 2 ), level );
+    EXPECT_VW_EQ( ImageView<float>( crop( expected, 1, 1, 3, 2 ) ), part );
+  }
+}
@@ -109,6 +109,56 @@ TEST_P(MemoryImageResourceTest, BasicWriteRead) {
   EXPECT_SEQ_NEAR(src, img1, 6);
 }
 
+TEST_P(MemoryImageResourceTest, ReadIntoCrop) {
+  vector<uint8> raw;
+  slurp(GetParam(), raw);
+
+  boost::scoped_ptr<SrcMemoryImageResource> r(SrcMemoryImageResource::open(fs::extension(GetParam()), &*raw.begin(), raw.size()));
+  if (r->format().pixel_format != VW_PIXEL_RGB || r->format().channel_type != VW_CHANNEL_UINT8)
+    return;
+
+  ImageView<PixelRGB<uint8> > whole;
+  read_image(whole, *r);
+
+  // Decoding into part of a larger image leaves the rest alone.
+  ImageView<PixelRGB<uint8> > big(r->cols() + 3, r->rows() + 2);
+  fill(big, PixelRGB<uint8>(7,7,7));
+  BBox2i bbox(2, 1, r->cols(), r->rows());
+  r->read(big.buffer().cropped(bbox), BBox2i(0, 0, r->cols(), r->rows()));
+  EXPECT_SEQ_EQ(whole, crop(big, bbox));
+  EXPECT_EQ(PixelRGB<uint8>(7,7,7), big(0,0));
+  EXPECT_EQ(PixelRGB<uint8>(7,7,7), big(big.cols()-1, big.rows()-1));
+}
+
+#if defined(VW_HAVE_PKG_JPEG) && VW_HAVE_PKG_JPEG==1
+TEST(MemoryImageResourceJPEG, Reduced) {
+  const int32 COLS = 64, ROWS = 40;
+  ImageView<PixelGray<uint8> > src(COLS, ROWS);
+  for (int32 row = 0; row < ROWS; ++row)
+    for (int32 col = 0; col < COLS; ++col)
+      src(col, row) = uint8(2 * col + row);
+
+  boost::scoped_ptr<DstMemoryImageResource> dst(DstMemoryImageResource::create("jpg", src.format()));
+  write_image(*dst, src);
+  boost::scoped_ptr<SrcImageResource> r(SrcMemoryImageResource::open("jpg", dst->data(), dst->size()));
+  EXPECT_EQ(3, r->overview_levels());
+
+  // Each level is close to the average of the pixels it covers.
+  for (int32 level = 1; level <= 4; ++level) {
+    int32 factor = 1 << level;
+    int32 cols = (COLS + factor - 1) / factor, rows = (ROWS + factor - 1) / factor;
+    ImageView<PixelGray<float> > reduced(cols, rows);
+    r->read_reduced(reduced.buffer(), BBox2i(0, 0, cols, rows), level);
+    for (int32 row = 0; row < rows; ++row)
+      for (int32 col = 0; col < cols; ++col) {
+        // Beyond 2^3, every other pixel of the 2^3 level is kept.
+        float offset = (std::min(factor, 8) - 1) * 1.5f;
+        EXPECT_NEAR((2 * col + row) * factor + offset, 255 * reduced(col, row).v(), 4) << level;
+      }
+  }
+}
+#endif
+
 vector<string> test_paths() {
   vector<string> v;
 #if defined(VW_HAVE_PKG_JPEG) && VW_HAVE_PKG_JPEG==1
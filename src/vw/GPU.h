@@ -21,6 +21,7 @@
 #include <vw/GPU/Manipulation.h>
 #include <vw/GPU/Statistics.h>
 #include <vw/GPU/Transform.h>
+#include <vw/GPU/Offload.h>
 
 
 #endif // __VW_IMAGE_H__
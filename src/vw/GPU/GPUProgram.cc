@@ -13,6 +13,8 @@
   *
   */
 
+ #include <cstdio>
+ #include <cstring>
  #include <fstream>
  #include <iostream>
 
@@ -50,12 +52,26 @@ namespace vw { namespace GPU {
   //#    GLSL - Program
   //########################################################################
 
-  bool GPUProgram_GLSL::Link(GPUVertexShader_GLSL& vertex, GPUFragmentShader_GLSL& fragment) {
+  // Program binaries need GLEW's entry points; without them the disk
+  // cache quietly stays empty.
+#if defined(GL_ARB_get_program_binary) && defined(GLEW_ARB_get_program_binary)
+  static bool program_binary_supported() { return GLEW_ARB_get_program_binary; }
+#else
+  static bool program_binary_supported() { return false; }
+#endif
+
+  static const char program_binary_magic[8] = { 'V', 'W', 'G', 'P', 'U', 'B', 'I', 'N' };
+
+  bool GPUProgram_GLSL::Link(GPUVertexShader_GLSL& vertex, GPUFragmentShader_GLSL& fragment, bool retrievable) {
     program = glCreateProgramObjectARB();
     if(vertex.is_compiled())
       glAttachObjectARB(program, vertex.get_shader());
     if(fragment.is_compiled())
       glAttachObjectARB(program, fragment.get_shader());
+#if defined(GL_ARB_get_program_binary) && defined(GLEW_ARB_get_program_binary)
+    if(retrievable && program_binary_supported())
+      glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
     glLinkProgramARB(program);
     GLsizei errorStringLength;
     GLint isCompiled;
@@ -69,6 +85,76 @@ namespace vw { namespace GPU {
     return true;
   }
 
+  bool GPUProgram_GLSL::load_binary_file(const string& path) {
+    if(!program_binary_supported())
+      return false;
+#if defined(GL_ARB_get_program_binary) && defined(GLEW_ARB_get_program_binary)
+    std::ifstream inFile(path.c_str(), std::ios::binary);
+    if(!inFile)
+      return false;
+    char magic[sizeof(program_binary_magic)];
+    GLenum format;
+    GLint length;
+    inFile.read(magic, sizeof(magic));
+    inFile.read((char*) &format, sizeof(format));
+    inFile.read((char*) &length, sizeof(length));
+    if(!inFile || memcmp(magic, program_binary_magic, sizeof(magic)) != 0 || length <= 0)
+      return false;
+    vector<char> binary(length);
+    inFile.read(&binary[0], length);
+    if(!inFile)
+      return false;
+
+    if(program)
+      glDeleteObjectARB(program);
+    program = glCreateProgramObjectARB();
+    glProgramBinary(program, format, &binary[0], length);
+    // A binary from another driver version fails to link, and the
+    // caller compiles from source instead
+    GLint isLinked;
+    glGetObjectParameterivARB(program, GL_OBJECT_LINK_STATUS_ARB, &isLinked);
+    if(!isLinked) {
+      glDeleteObjectARB(program);
+      program = 0;
+      return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  bool GPUProgram_GLSL::save_binary_file(const string& path) {
+    if(!program || !program_binary_supported())
+      return false;
+#if defined(GL_ARB_get_program_binary) && defined(GLEW_ARB_get_program_binary)
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0)
+      return false;
+    vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(program, length, &length, &format, &binary[0]);
+    // Written under a temporary name and renamed into place, so that
+    // processes sharing the cache never load a partial file
+    string tempPath = path + ".tmp";
+    {
+      std::ofstream outFile(tempPath.c_str(), std::ios::binary);
+      if(!outFile)
+        return false;
+      outFile.write(program_binary_magic, sizeof(program_binary_magic));
+      outFile.write((const char*) &format, sizeof(format));
+      outFile.write((const char*) &length, sizeof(length));
+      outFile.write(&binary[0], length);
+      if(!outFile)
+        return false;
+    }
+    return rename(tempPath.c_str(), path.c_str()) == 0;
+#else
+    return false;
+#endif
+  }
+
   //########################################################################
   //#    GLSL - Vertex Shader
   //########################################################################
@@ -314,28 +400,74 @@ namespace vw { namespace GPU {
 
   typedef pair<pair<string, string>, pair<vector<int>, vector<int> > > GPUProgramKey;
 
+  // The disk cache file for a program: named by a hash (64 bit FNV-1a)
+  // of its specialized sources and of the GL driver that builds it.
+  static string glsl_program_cache_path(const string& vertexString, const string& fragmentString) {
+    uint64 hash = 14695981039346656037ULL;
+    const GLubyte* driverStrings[] = { glGetString(GL_VENDOR), glGetString(GL_RENDERER), glGetString(GL_VERSION) };
+    vector<string> parts;
+    for(unsigned i=0; i < 3; i++)
+      parts.push_back(driverStrings[i] ? (const char*) driverStrings[i] : "");
+    parts.push_back(vertexString);
+    parts.push_back(fragmentString);
+    for(unsigned i=0; i < parts.size(); i++) {
+      // Hash the terminating null too, so the parts cannot run together
+      for(unsigned j=0; j <= parts[i].size(); j++) {
+        hash ^= (unsigned char) parts[i].c_str()[j];
+        hash *= 1099511628211ULL;
+      }
+    }
+    char name[64];
+    sprintf(name, "glsl_%016llx.cache", (unsigned long long) hash);
+    return shader_assembly_cache_path + name;
+  }
+
   GPUProgram_GLSL* create_gpu_program_glsl_string(const string& fragmentString, const vector<int>& fragmentAttributes,
                                                   const string& vertexString, const vector<int>& vertexAttributes)
   {
     shaderCompilationStatus = SHADER_COMPILATION_STATUS_SUCCESS_FILE;
     static char charBuffer1[32];
     static char charBuffer2[32];
+    // Specialize Strings
+    string vertReplacedString;
+    const string* vertSourceString = &vertexString;
+    if(!vertexString.empty() && vertexAttributes.size()) {
+      TokenReplacer tr;
+      for(unsigned i=0; i < vertexAttributes.size(); i++) {
+        sprintf(charBuffer1, "%i", i+1);
+        sprintf(charBuffer2, "%i", vertexAttributes[i]);
+        tr.AddVariable(charBuffer1, charBuffer2);
+      }
+      tr.Replace(vertexString, vertReplacedString);
+      vertSourceString = &vertReplacedString;
+    }
+    string fragReplacedString;
+    const string* fragSourceString = &fragmentString;
+    if(!fragmentString.empty() && fragmentAttributes.size()) {
+      TokenReplacer tr;
+      for(unsigned i=0; i < fragmentAttributes.size(); i++) {
+        sprintf(charBuffer1, "%i", i+1);
+        sprintf(charBuffer2, "%i", fragmentAttributes[i]);
+        tr.AddVariable(charBuffer1, charBuffer2);
+      }
+      tr.Replace(fragmentString, fragReplacedString);
+      fragSourceString = &fragReplacedString;
+    }
+    // Disk Cache - Try the binary linked by an earlier run
+    string cacheFilePath;
+    if(shader_assembly_cache_enabled && program_binary_supported()) {
+      cacheFilePath = glsl_program_cache_path(*vertSourceString, *fragSourceString);
+      GPUProgram_GLSL* program = new GPUProgram_GLSL;
+      if(program->load_binary_file(cacheFilePath)) {
+        shaderCompilationStatus = SHADER_COMPILATION_STATUS_SUCCESS_CACHE;
+        return program;
+      }
+      delete program;
+    }
     // Vertex
     GPUVertexShader_GLSL vertexShader;
     if(!vertexString.empty()) {
-      string vertReplacedString;
-      const string* sourceString = &vertexString;
-      if(vertexAttributes.size()) {
-        TokenReplacer tr;
-        for(unsigned i=0; i < vertexAttributes.size(); i++) {
-          sprintf(charBuffer1, "%i", i+1);
-          sprintf(charBuffer2, "%i", vertexAttributes[i]);
-          tr.AddVariable(charBuffer1, charBuffer2);
-        }
-        tr.Replace(vertexString, vertReplacedString);
-        sourceString = &vertReplacedString;
-      }
-      if(!vertexShader.compile(*sourceString)) {
+      if(!vertexShader.compile(*vertSourceString)) {
         shaderCompilationStatus = SHADER_COMPILATION_STATUS_ERROR_COMPILE;
         throw(Exception("GPUProgram creation failed."));
       }
@@ -343,31 +475,20 @@ namespace vw { namespace GPU {
     // Fragment
     GPUFragmentShader_GLSL fragmentShader;
     if(!fragmentString.empty()) {
-      string fragReplacedString;
-      const string* sourceString = &fragmentString;
-      if(fragmentAttributes.size()) {
-        TokenReplacer tr;
-        string variable;
-        for(unsigned i=0; i < fragmentAttributes.size(); i++) {
-          sprintf(charBuffer1, "%i", i+1);
-          sprintf(charBuffer2, "%i", fragmentAttributes[i]);
-          tr.AddVariable(charBuffer1, charBuffer2);
-        }
-        tr.Replace(fragmentString, fragReplacedString);
-        sourceString = &fragReplacedString;
-      }
-      if(!fragmentShader.compile(*sourceString)) {
+      if(!fragmentShader.compile(*fragSourceString)) {
         shaderCompilationStatus = SHADER_COMPILATION_STATUS_ERROR_COMPILE;
         throw(Exception("GPUProgram creation failed."));
       }
     }
     // Program
     GPUProgram_GLSL* program = new GPUProgram_GLSL;
-    if(!program->Link(vertexShader, fragmentShader)) {
+    if(!program->Link(vertexShader, fragmentShader, !cacheFilePath.empty())) {
       shaderCompilationStatus = SHADER_COMPILATION_STATUS_ERROR_LINK;
       delete program;
       throw(Exception("GPUProgram creation failed."));
     }
+    if(!cacheFilePath.empty())
+      program->save_binary_file(cacheFilePath);
     return program;
   }
 
@@ -542,9 +663,11 @@ namespace vw { namespace GPU {
           fragAssemblyFilePath += charBuffer1;
         }
         fragAssemblyFilePath += ".cache";
-        if(fragmentShader->load_compiled_file(fragAssemblyFilePath.c_str())) {
+        fragmentShader.reset(new GPUShader_CG);
+        if(fragmentShader->load_compiled_file(fragAssemblyFilePath.c_str()))
           fragComplete = true;
-        }
+        else
+          fragmentShader.reset(NULL);
       }
       // If necessary, read source string from file
       if(!fragComplete) {
@@ -600,10 +723,8 @@ namespace vw { namespace GPU {
         shaderCompilationStatus = SHADER_COMPILATION_STATUS_ERROR_COMPILE;
         fail = true;
       }
-      if(shader_assembly_cache_enabled) {
-        if(fragmentShader->save_compiled_file(fragAssemblyFilePath.c_str())) {
-        }
-      }
+      if(!fail && shader_assembly_cache_enabled)
+        fragmentShader->save_compiled_file(fragAssemblyFilePath.c_str());
     }
 
     if(fail)
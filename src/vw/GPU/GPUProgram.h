@@ -103,7 +103,12 @@ namespace vw { namespace GPU {
     GLhandleARB program;
     int bound_texture_count;
   public:
-    bool Link(GPUVertexShader_GLSL& vertex, GPUFragmentShader_GLSL& fragment);
+    bool Link(GPUVertexShader_GLSL& vertex, GPUFragmentShader_GLSL& fragment, bool retrievable = false);
+    // The linked program as a driver binary (GL_ARB_get_program_binary),
+    // to skip compiling and linking in later runs.  Both return false
+    // if the driver does not support it, or rejects the binary.
+    bool load_binary_file(const std::string& path);
+    bool save_binary_file(const std::string& path);
     // INLINE
     GPUProgram_GLSL() { program = 0; bound_texture_count = 0; }
     ~GPUProgram_GLSL() { if(program) glDeleteObjectARB(program); }
@@ -36,7 +36,7 @@ namespace GPU {
    template <>
  struct TraitsForInterpT<NearestPixelInterpolation> {
    static const char* ShaderString() {
-     static const char* string = "Interpolation/interpolation-nearest-pixel";
+     static const char* string = "Interp/interpolation-nearest-pixel";
      return string;
    }
    static const int quality = 1;
@@ -46,7 +46,7 @@ namespace GPU {
    template <>
  struct TraitsForInterpT<BilinearInterpolation> {
    static const char* ShaderString() {
-     static const char* string = "Interpolation/interpolation-bilinear";
+     static const char* string = "Interp/interpolation-bilinear";
      return string;
    }
    static const int quality = 2;
@@ -55,7 +55,7 @@ namespace GPU {
    template <>
  struct TraitsForInterpT<BicubicInterpolation> {
    static const char* ShaderString() {
-     static const char* string = "Interpolation/interpolation-bicubic";
+     static const char* string = "Interp/interpolation-bicubic";
      return string;
    }
    static const int quality = 3;
@@ -0,0 +1,32 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/GPU/Offload.h>
+
+namespace vw { namespace GPU {
+
+  boost::shared_ptr<GPUImageBase> offload_kernel(std::vector<float> const& kernel, size_t center) {
+    if(kernel.empty())
+      return boost::shared_ptr<GPUImageBase>(new GPUImageBase(0, 1, GPU_RED, GPU_FLOAT32));
+    // Pad the kernel with zeros, in front if its origin is left of the
+    // middle and behind if it is right of it, until the origin is the
+    // middle tap.
+    int front = std::max(int(kernel.size()) - 2*int(center) - 1, 0);
+    std::vector<float> padded(2*(center + front) + 1, 0.0f);
+    std::copy(kernel.begin(), kernel.end(), padded.begin() + front);
+    return boost::shared_ptr<GPUImageBase>(new GPUImageBase(padded.size(), 1, GPU_RED, GPU_FLOAT32,
+                                                            GPU_RED, GPU_FLOAT32, &padded[0]));
+  }
+
+  int32 offload_max_texture_size() {
+    static GLint size = 0;
+    if(!size)
+      glGetIntegerv(GL_MAX_RECTANGLE_TEXTURE_SIZE_ARB, &size);
+    return size;
+  }
+
+} } // namespaces GPU, vw
@@ -0,0 +1,367 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Offload.h
+///
+/// Runs CPU image views on the GPU where it knows how to.
+///
+/// gpu_offload(view) wraps a view without changing what it computes.
+/// When the wrapped view is a TransformView with an affine transform
+/// (translate, resample, linear, affine or rotate) or a
+/// SeparableConvolutionView, of float pixels with one, three or four
+/// channels, rasterizing it on the thread that called gpu_init() splits
+/// the region into blocks; for each, the source region is rasterized
+/// and edge extended on the CPU, uploaded, transformed or convolved
+/// on the GPU, and read back.  The sources are prepared on
+/// vw_thread_pool() a few blocks ahead, and each block is read back
+/// only once the next has been handed to the GPU, so the transfers
+/// and the CPU work overlap the GPU's.
+///
+/// Anything else, including rasterizing from other threads (as
+/// block_write_image() does), is passed through to the view itself,
+/// so it is always safe to wrap a view.  Results match the CPU up to
+/// float rounding.
+
+#ifndef __VW_GPU_OFFLOAD_H__
+#define __VW_GPU_OFFLOAD_H__
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/type_traits/is_convertible.hpp>
+#include <boost/type_traits/is_same.hpp>
+
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Interpolation.h>
+#include <vw/Image/Transform.h>
+#include <vw/Image/Convolution.h>
+
+#include <vw/GPU/Setup.h>
+#include <vw/GPU/GPUImage.h>
+#include <vw/GPU/Filter.h>
+
+namespace vw { namespace GPU {
+
+  /// The pixel types the GPU module can hold in a texture.
+  template <class PixelT>
+  struct IsOffloadPixel {
+    static const bool value =
+      boost::is_same<typename PixelChannelType<PixelT>::type, float>::value &&
+      ( PixelNumChannels<PixelT>::value == 1 ||
+        PixelNumChannels<PixelT>::value == 3 ||
+        PixelNumChannels<PixelT>::value == 4 );
+  };
+
+  /// Transforms whose reverse mapping is affine, which is all the GPU
+  /// homography can do exactly.
+  template <class TransformT> struct IsAffineTransform : public false_type {};
+  template <> struct IsAffineTransform<ResampleTransform> : public true_type {};
+  template <> struct IsAffineTransform<TranslateTransform> : public true_type {};
+  template <> struct IsAffineTransform<LinearTransform> : public true_type {};
+  template <> struct IsAffineTransform<AffineTransform> : public true_type {};
+  template <> struct IsAffineTransform<RotateTransform> : public true_type {};
+
+  /// The interpolations with a GPU shader that matches the CPU, and
+  /// the shift that makes it match: the nearest pixel shader takes the
+  /// floor of the coordinate where NearestPixelInterpolation rounds it.
+  template <class InterpT> struct OffloadInterpolation {
+    static const bool supported = false;
+    static double shift() { return 0; }
+  };
+  template <> struct OffloadInterpolation<BilinearInterpolation> {
+    static const bool supported = true;
+    static double shift() { return 0; }
+  };
+  template <> struct OffloadInterpolation<BicubicInterpolation> {
+    static const bool supported = true;
+    static double shift() { return 0; }
+  };
+  template <> struct OffloadInterpolation<NearestPixelInterpolation> {
+    static const bool supported = true;
+    static double shift() { return 0.5; }
+  };
+
+  /// A 1D kernel, as a texture for the convolution shaders, which put
+  /// the origin at the middle tap.  An empty kernel gives an empty
+  /// texture, which the shaders skip.
+  boost::shared_ptr<GPUImageBase> offload_kernel(std::vector<float> const& kernel, size_t center);
+
+  /// The largest texture the GL context can hold on a side.
+  int32 offload_max_texture_size();
+
+  // ---------------------------------------------------------------------
+  // OffloadOp
+  // ---------------------------------------------------------------------
+
+  /// How the blocks of a view are computed on the GPU.  For a block
+  /// bbox, prepare() rasterizes source_bbox(bbox) of the view's source
+  /// on the CPU (on any thread), and run() computes the block from it
+  /// on the GPU (on the GL thread), returning a texture that holds the
+  /// block at offset.  The default handles no view at all.
+  template <class ViewT>
+  class OffloadOp {
+  public:
+    typedef typename ViewT::pixel_type pixel_type;
+    static const bool supported = false;
+    OffloadOp( ViewT const& /*view*/ ) {}
+    bool accepts() const { return false; }
+    BBox2i source_bbox( BBox2i const& bbox ) const { return bbox; }
+    void prepare( BBox2i const& /*src_bbox*/, ImageView<pixel_type>& /*source*/ ) const {}
+    GPUImageBase run( GPUImageBase const& source, BBox2i const& /*src_bbox*/,
+                      BBox2i const& /*bbox*/, Vector2i& /*offset*/ ) const { return source; }
+  };
+
+  // The source is the edge extended child of the interpolation, so any
+  // edge extension works; the GPU applies the reverse mapping, moved
+  // to the block and its source, as a homography.
+  template <class ImageT, class EdgeT, class InterpT, class TransformT>
+  class OffloadOp<TransformView<InterpolationView<EdgeExtensionView<ImageT, EdgeT>, InterpT>, TransformT> > {
+    typedef TransformView<InterpolationView<EdgeExtensionView<ImageT, EdgeT>, InterpT>, TransformT> view_type;
+    view_type m_view;
+  public:
+    typedef typename view_type::pixel_type pixel_type;
+    static const bool supported = IsOffloadPixel<pixel_type>::value &&
+      IsAffineTransform<TransformT>::value && OffloadInterpolation<InterpT>::supported;
+
+    OffloadOp( view_type const& view ) : m_view( view ) {}
+
+    bool accepts() const { return true; }
+
+    BBox2i source_bbox( BBox2i const& bbox ) const {
+      BBox2i src_bbox = m_view.transform().reverse_bbox( bbox );
+      src_bbox.expand( InterpT::pixel_buffer );
+      return src_bbox;
+    }
+
+    void prepare( BBox2i const& src_bbox, ImageView<pixel_type>& source ) const {
+      source = vw::crop( m_view.child().child(), src_bbox );
+    }
+
+    GPUImageBase run( GPUImageBase const& source, BBox2i const& src_bbox,
+                      BBox2i const& bbox, Vector2i& offset ) const {
+      TransformT const& tx = m_view.transform();
+      Vector2 origin = tx.reverse( Vector2( bbox.min() ) );
+      Vector2 dx = tx.reverse( Vector2( bbox.min() ) + Vector2(1,0) ) - origin;
+      Vector2 dy = tx.reverse( Vector2( bbox.min() ) + Vector2(0,1) ) - origin;
+      double shift = OffloadInterpolation<InterpT>::shift();
+      Matrix<float> homography(3, 3);
+      homography.set_identity();
+      homography(0,0) = dx.x(); homography(0,1) = dy.x();
+      homography(0,2) = origin.x() - src_bbox.min().x() + shift;
+      homography(1,0) = dx.y(); homography(1,1) = dy.y();
+      homography(1,2) = origin.y() - src_bbox.min().y() + shift;
+      GPUImageBase result = source;
+      result.apply_homography( homography, InterpT(), ConstantEdgeExtension(), bbox.width(), bbox.height() );
+      result.rasterize_homography();
+      offset = Vector2i();
+      return result;
+    }
+  };
+
+  // The source is the edge extended child, as the CPU convolves it.
+  // The kernel textures are made on first use, on the GL thread.
+  template <class ImageT, class KernelT, class EdgeT>
+  class OffloadOp<SeparableConvolutionView<ImageT, KernelT, EdgeT> > {
+    typedef SeparableConvolutionView<ImageT, KernelT, EdgeT> view_type;
+    view_type m_view;
+    mutable boost::shared_ptr<GPUImageBase> m_i_kernel, m_j_kernel;
+  public:
+    typedef typename view_type::pixel_type pixel_type;
+    static const bool supported = IsOffloadPixel<pixel_type>::value &&
+      boost::is_convertible<KernelT, float>::value;
+
+    OffloadOp( view_type const& view ) : m_view( view ) {}
+
+    bool accepts() const { return !m_view.i_kernel().empty() || !m_view.j_kernel().empty(); }
+
+    BBox2i source_bbox( BBox2i const& bbox ) const { return m_view.source_bbox( bbox ); }
+
+    void prepare( BBox2i const& src_bbox, ImageView<pixel_type>& source ) const {
+      source = edge_extend( m_view.child(), src_bbox, m_view.edge() );
+    }
+
+    GPUImageBase run( GPUImageBase const& source, BBox2i const& src_bbox,
+                      BBox2i const& bbox, Vector2i& offset ) const {
+      if( !m_i_kernel ) {
+        m_i_kernel = offload_kernel( std::vector<float>( m_view.i_kernel().begin(), m_view.i_kernel().end() ),
+                                     m_view.i_center() );
+        m_j_kernel = offload_kernel( std::vector<float>( m_view.j_kernel().begin(), m_view.j_kernel().end() ),
+                                     m_view.j_center() );
+      }
+      offset = bbox.min() - src_bbox.min();
+      return seperable_convolution_filter( source, *m_i_kernel, *m_j_kernel );
+    }
+  };
+
+  // ---------------------------------------------------------------------
+  // GPUOffloadView
+  // ---------------------------------------------------------------------
+
+  template <class ViewT>
+  class GPUOffloadView : public ImageViewBase<GPUOffloadView<ViewT> > {
+    typedef OffloadOp<ViewT> op_type;
+    ViewT m_view;
+    int32 m_block_size;
+
+    // Rasterizes the source of one block on the thread pool.  A pool
+    // task must not throw, so on an error the source is left empty and
+    // the GL thread meets the error again when it prepares the block
+    // itself.
+    class PrepareTask : public Task {
+      op_type const& m_op;
+      BBox2i m_src_bbox;
+    public:
+      ImageView<typename ViewT::pixel_type> source;
+      PrepareTask( op_type const& op, BBox2i const& src_bbox ) : m_op( op ), m_src_bbox( src_bbox ) {}
+      virtual void operator()() {
+        try {
+          m_op.prepare( m_src_bbox, source );
+        }
+        catch( const Exception& e ) {
+          VW_OUT(DebugMessage, "gpu") << "GPUOffloadView: preparing a block failed: " << e.what() << "\n";
+          source.reset();
+        }
+      }
+    };
+
+  public:
+    typedef typename ViewT::pixel_type pixel_type;
+    typedef typename ViewT::result_type result_type;
+    typedef ProceduralPixelAccessor<GPUOffloadView> pixel_accessor;
+
+    GPUOffloadView( ViewT const& view, int32 block_size ) : m_view( view ), m_block_size( block_size ) {
+      VW_ASSERT( block_size > 0, ArgumentErr() << "GPUOffloadView: the block size must be positive." );
+    }
+
+    inline int32 cols() const { return m_view.cols(); }
+    inline int32 rows() const { return m_view.rows(); }
+    inline int32 planes() const { return m_view.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+    inline result_type operator()( int32 i, int32 j, int32 p=0 ) const { return m_view( i, j, p ); }
+
+    ViewT const& child() const { return m_view; }
+    int32 block_size() const { return m_block_size; }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> buf( bbox.width(), bbox.height(), planes() );
+      rasterize( buf, bbox );
+      return prerasterize_type( buf, BBox2i( -bbox.min().x(), -bbox.min().y(), cols(), rows() ) );
+    }
+
+    template <class DestT>
+    void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      offload( dest, bbox, boost::mpl::integral_c<bool, op_type::supported>() );
+    }
+
+    template <class DestT>
+    void offload( DestT const& dest, BBox2i const& bbox, false_type ) const {
+      m_view.rasterize( dest, bbox );
+    }
+
+    template <class DestT>
+    void offload( DestT const& dest, BBox2i const& bbox, true_type ) const {
+      op_type op( m_view );
+      if( !op.accepts() || planes() != 1 || !gpu_is_context_thread() ) {
+        m_view.rasterize( dest, bbox );
+        return;
+      }
+
+      std::vector<BBox2i> blocks;
+      for( int32 y = bbox.min().y(); y < bbox.max().y(); y += m_block_size )
+        for( int32 x = bbox.min().x(); x < bbox.max().x(); x += m_block_size )
+          blocks.push_back( BBox2i( x, y, std::min( m_block_size, bbox.max().x()-x ),
+                                    std::min( m_block_size, bbox.max().y()-y ) ) );
+
+      // Blocks whose source does not fit in a texture are done on the
+      // CPU, by the view itself.
+      const int32 max_size = offload_max_texture_size();
+      std::vector<BBox2i> src_bboxes( blocks.size() );
+      std::vector<bool> offload( blocks.size() );
+      for( size_t i = 0; i < blocks.size(); ++i ) {
+        src_bboxes[i] = op.source_bbox( blocks[i] );
+        offload[i] = !src_bboxes[i].empty() && src_bboxes[i].width() <= max_size && src_bboxes[i].height() <= max_size;
+      }
+
+      WorkStealingQueue& pool = vw_thread_pool();
+      const size_t ahead = pool.max_threads() + 1;
+      std::vector<boost::shared_ptr<PrepareTask> > tasks( blocks.size() );
+      size_t next_task = 0;
+
+      // The tasks refer to op, so they must all be done before we leave
+      // this scope, even if a block throws.
+      try {
+        GPUImageBase pending;
+        Vector2i pending_offset;
+        size_t pending_block = blocks.size();
+        for( size_t i = 0; i <= blocks.size(); ++i ) {
+          for( ; next_task < blocks.size() && next_task < i + ahead; ++next_task ) {
+            if( !offload[next_task] ) continue;
+            tasks[next_task].reset( new PrepareTask( op, src_bboxes[next_task] ) );
+            pool.add_task( tasks[next_task] );
+          }
+
+          // Hand block i to the GPU before reading back the one before it.
+          GPUImageBase result;
+          Vector2i offset;
+          if( i < blocks.size() ) {
+            if( offload[i] ) {
+              pool.wait( tasks[i] );
+              ImageView<pixel_type> source = tasks[i]->source;
+              tasks[i].reset();
+              if( source.cols() == 0 )
+                op.prepare( src_bboxes[i], source );
+              GPUImage<pixel_type> source_tex( source );
+              result = op.run( source_tex, src_bboxes[i], blocks[i], offset );
+            }
+            else {
+              m_view.rasterize( vw::crop( dest, blocks[i] - bbox.min() ), blocks[i] );
+            }
+          }
+
+          if( pending_block < blocks.size() ) {
+            BBox2i const& block = blocks[pending_block];
+            ImageView<pixel_type> buf( block.width(), block.height() );
+            pending.read( pending_offset.x(), pending_offset.y(), block.width(), block.height(),
+                          GPUImage<pixel_type>::get_format_for_pixelt(),
+                          GPUImage<pixel_type>::get_cpu_type_for_pixelt(), &buf(0,0) );
+            buf.rasterize( vw::crop( dest, block - bbox.min() ), BBox2i( 0, 0, block.width(), block.height() ) );
+            pending.reset();
+            pending_block = blocks.size();
+          }
+          if( i < blocks.size() && offload[i] ) {
+            pending = result;
+            pending_offset = offset;
+            pending_block = i;
+          }
+        }
+      } catch (...) {
+        for( size_t i = 0; i < tasks.size(); ++i )
+          if( tasks[i] ) pool.wait( tasks[i] );
+        throw;
+      }
+    }
+    /// \endcond
+  };
+
+  /// Wraps a view so that its blocks are computed on the GPU where the
+  /// GPU module supports the operation, in blocks of block_size
+  /// pixels on a side.  See Offload.h.
+  template <class ViewT>
+  GPUOffloadView<ViewT> gpu_offload( ImageViewBase<ViewT> const& view, int32 block_size = 1024 ) {
+    return GPUOffloadView<ViewT>( view.impl(), block_size );
+  }
+
+}} // namespace vw::GPU
+
+#endif // __VW_GPU_OFFLOAD_H__
@@ -8,6 +8,7 @@
 #include <vw/GPU/Setup.h>
 #include <vw/GPU/GPUProgram.h>
 #include <vw/GPU/TexAlloc.h>
+#include <vw/Core/Thread.h>
 
 using std::string;
 
@@ -23,6 +24,8 @@ namespace vw { namespace GPU {
   bool loggingEnabled;
 
   ShaderLanguageChoiceEnum shaderLanguageChoice = SHADER_LANGUAGE_CHOICE_GLSL;
+  bool contextThreadSet = false;
+  vw::uint64 contextThread;
 
   // gpu_init
 
@@ -83,6 +86,12 @@ namespace vw { namespace GPU {
     glGenFramebuffersEXT(1, &g_framebuffer);
     gpu_log("Success\n");
 
+    contextThread = Thread::id();
+    contextThreadSet = true;
+  }
+
+  bool gpu_is_context_thread() {
+    return contextThreadSet && Thread::id() == contextThread;
   }
 
   // gpu_cleanup
@@ -104,8 +113,10 @@ namespace vw { namespace GPU {
   }
 
   void set_shader_assembly_cache_path(const string& path) {
-    shader_assembly_cache_enabled = true;
+    shader_assembly_cache_enabled = !path.empty();
     shader_assembly_cache_path = path;
+    if(!path.empty() && path[path.size() - 1] != '/')
+      shader_assembly_cache_path += '/';
   }
 
   void set_gpu_memory_recycling(bool value) {
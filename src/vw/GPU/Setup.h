@@ -30,6 +30,10 @@ extern bool loggingEnabled;
 
  void gpu_cleanup();
 
+ // Whether the calling thread is the one gpu_init() set the GL context
+ // up on, which is the only one that can use it.
+ bool gpu_is_context_thread();
+
 // Settings
 
 
@@ -58,10 +62,18 @@ extern bool loggingEnabled;
 
  void set_shader_language_choice(ShaderLanguageChoiceEnum choice);
 
+ // Whether released textures are pooled for reuse (on by default); see
+ // TexAlloc for the pool limit and residency accounting.
  void set_gpu_memory_recycling(bool value);
 
  void set_shader_base_path(const std::string& path);
 
+ // Caches compiled shaders in the directory at path, which must
+ // exist, across runs: Cg fragment assembly, and GLSL program binaries
+ // where the driver supports GL_ARB_get_program_binary.  The cached
+ // GLSL binaries are keyed by their source and the GL driver, so the
+ // directory can be shared between machines and driver versions.  An
+ // empty path turns the cache off.
  void set_shader_assembly_cache_path(const std::string& path);
 
 // Logging
@@ -5,6 +5,10 @@
 // __END_LICENSE__
 
 
+#include <algorithm>
+
+#include <boost/tuple/tuple.hpp>
+
 #include <vw/GPU/TexAlloc.h>
 
 namespace vw { namespace GPU {
@@ -14,10 +18,17 @@ namespace vw { namespace GPU {
   //############################################################
 
   bool TexAlloc::isInit = false;
-  list<TexObj*> TexAlloc::texRecycleList;
+  TexAlloc::PoolList TexAlloc::texRecycleList;
+  std::multimap<TexAlloc::PoolKey, TexAlloc::PoolList::iterator> TexAlloc::texRecycleMap;
   int TexAlloc::allocatedCount = 0;
   int TexAlloc::allocatedSize = 0;
-  bool TexAlloc::recylingEnabled = false;
+  int TexAlloc::pooledCount = 0;
+  int TexAlloc::pooledSize = 0;
+  int TexAlloc::peakAllocatedSize = 0;
+  int TexAlloc::poolSizeLimit = 256 * 1024 * 1024;
+  int TexAlloc::poolHits = 0;
+  int TexAlloc::poolMisses = 0;
+  bool TexAlloc::recylingEnabled = true;
   std::map<pair<Tex_Format, Tex_Type>, pair<Tex_Format, Tex_Type> > TexAlloc::textureSubstitutesMap;
 
   //#############################################################
@@ -36,33 +47,34 @@ namespace vw { namespace GPU {
     Tex_Format realFormat = format;
     Tex_Type realType = type;
     get_texture_substitution(format, type, realFormat, realType);
-    // Try to find it in recycling if enabled...
+    // Try to find it in the pool if enabled...
     TexObj* texObj = NULL;
     if(recylingEnabled) {
-      TexObj* bestTex = NULL;
-      TexObj* cTex;
-      std::list<TexObj*>::iterator iter;
-      for(iter = texRecycleList.begin(); iter != texRecycleList.end(); iter++) {
-        cTex = *iter;
-        if(cTex->format() == realFormat && cTex->type() == realType && cTex->width() == w && cTex->height() == h)
-          bestTex = cTex;
-      }
-      if(bestTex) {
-        texRecycleList.remove(bestTex);
-        texObj = bestTex;
+      PoolKey key(pair<Tex_Format, Tex_Type>(realFormat, realType), pair<int, int>(w, h));
+      std::multimap<PoolKey, PoolList::iterator>::iterator iter = texRecycleMap.find(key);
+      if(iter != texRecycleMap.end()) {
+        texObj = *(iter->second);
+        texRecycleList.erase(iter->second);
+        texRecycleMap.erase(iter);
+        pooledCount--;
+        pooledSize -= texObj->MemorySize();
+        poolHits++;
         if(gpu_log_enabled()) {
-          sprintf(buffer, "+++ Creating Texture: { %s, %s, (%i x %i) } - RECYCLED from (%i x %i)    (Total Allocated: %.2fMB)\n",
-                  TexFormatToString(format), TexTypeToString(type), w, h, bestTex->width(), bestTex->height(),
-                  allocatedSize/1000000.0);
+          sprintf(buffer, "+++ Creating Texture: { %s, %s, (%i x %i) } - RECYCLED    (Total Allocated: %.2fMB, Pooled: %.2fMB)\n",
+                  TexFormatToString(format), TexTypeToString(type), w, h,
+                  allocatedSize/1000000.0, pooledSize/1000000.0);
           gpu_log(buffer);
         }
       }
+      else
+        poolMisses++;
     }
     // if necessary, create new TexObj
     if(!texObj) {
       texObj = new TexObj(w, h, realFormat, realType);
       allocatedCount++;
       allocatedSize += texObj->MemorySize();
+      peakAllocatedSize = std::max(peakAllocatedSize, allocatedSize);
 
       if(gpu_log_enabled()) {
         if(format != realFormat || type != realType)
@@ -81,40 +93,27 @@ namespace vw { namespace GPU {
 
   void
   TexAlloc::release(TexObj* texObj) {
-    if(recylingEnabled) {
-      texRecycleList.push_back(texObj);
+    if(recylingEnabled && texObj->MemorySize() <= poolSizeLimit) {
+      // Make room for it first, so the pool never goes over its limit
+      trim_pool(poolSizeLimit - texObj->MemorySize());
+      PoolList::iterator pos = texRecycleList.insert(texRecycleList.end(), texObj);
+      texRecycleMap.insert(std::make_pair(pool_key(texObj), pos));
+      pooledCount++;
+      pooledSize += texObj->MemorySize();
       if(gpu_log_enabled()) {
-        sprintf(buffer, "--- Recycling Texture: { %s, %s, (%i x %i) }    (Total Allocated %.2fMB)\n",
-                TexFormatToString(texObj->format()), TexTypeToString(texObj->type()), texObj->width(), texObj->height(), allocatedSize/1000000.0);
+        sprintf(buffer, "--- Recycling Texture: { %s, %s, (%i x %i) }    (Total Allocated %.2fMB, Pooled: %.2fMB)\n",
+                TexFormatToString(texObj->format()), TexTypeToString(texObj->type()), texObj->width(), texObj->height(),
+                allocatedSize/1000000.0, pooledSize/1000000.0);
         gpu_log(buffer);
       }
     }
     else {
-      allocatedCount--;
-      allocatedSize -= texObj->MemorySize();
-      if(gpu_log_enabled()) {
-        sprintf(buffer, "--- Deleting Texture: { %s, %s, (%i x %i) }    (Total Allocated %.2fMB)\n",
-                TexFormatToString(texObj->format()), TexTypeToString(texObj->type()), texObj->width(), texObj->height(), allocatedSize/1000000.0);
-        gpu_log(buffer);
-      }
-      delete texObj;
+      delete_texture(texObj);
     }
   }
 
   void TexAlloc::clear_recycled() {
-    std::list<TexObj*>::iterator iter;
-    for(iter = texRecycleList.begin(); iter != texRecycleList.end(); iter++) {
-      TexObj* texObj = *iter;
-      allocatedCount--;
-      allocatedSize -= texObj->MemorySize();
-      if(gpu_log_enabled()) {
-        sprintf(buffer, "--- Deleting Texture: { %s, %s, (%i x %i) }    (Total Allocated %.2fMB)\n",
-                TexFormatToString(texObj->format()), TexTypeToString(texObj->type()), texObj->width(), texObj->height(), allocatedSize/1000000.0);
-        gpu_log(buffer);
-      }
-      delete *iter;
-    }
-    texRecycleList.clear();
+    trim_pool(0);
   }
 
   void TexAlloc::generate_texture_substitutions(bool verbose) {
@@ -212,6 +211,44 @@ namespace vw { namespace GPU {
   //               TexAlloc: Class Functions - Private
   //###############################################################
 
+  TexAlloc::PoolKey
+  TexAlloc::pool_key(TexObj* texObj) {
+    return PoolKey(pair<Tex_Format, Tex_Type>(texObj->format(), texObj->type()),
+                   pair<int, int>(texObj->width(), texObj->height()));
+  }
+
+  void
+  TexAlloc::delete_texture(TexObj* texObj) {
+    allocatedCount--;
+    allocatedSize -= texObj->MemorySize();
+    if(gpu_log_enabled()) {
+      sprintf(buffer, "--- Deleting Texture: { %s, %s, (%i x %i) }    (Total Allocated %.2fMB)\n",
+              TexFormatToString(texObj->format()), TexTypeToString(texObj->type()), texObj->width(), texObj->height(), allocatedSize/1000000.0);
+      gpu_log(buffer);
+    }
+    delete texObj;
+  }
+
+  // Deletes the idle textures, oldest first, until the pool holds at
+  // most limit bytes.
+  void
+  TexAlloc::trim_pool(int limit) {
+    while(!texRecycleList.empty() && pooledSize > limit) {
+      TexObj* texObj = texRecycleList.front();
+      std::multimap<PoolKey, PoolList::iterator>::iterator iter, end;
+      for(boost::tie(iter, end) = texRecycleMap.equal_range(pool_key(texObj)); iter != end; iter++) {
+        if(iter->second == texRecycleList.begin()) {
+          texRecycleMap.erase(iter);
+          break;
+        }
+      }
+      texRecycleList.pop_front();
+      pooledCount--;
+      pooledSize -= texObj->MemorySize();
+      delete_texture(texObj);
+    }
+  }
+
   void
   TexAlloc::initialize_texalloc() {
     generate_texture_substitutions();
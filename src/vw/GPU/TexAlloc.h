@@ -16,18 +16,42 @@
 namespace vw {
 namespace GPU {
 
+  /// Allocates the textures behind the GPUImages.  When recycling is
+  /// on, as it is by default, released textures go into a pool, from
+  /// which later allocations of the same format, type and size are
+  /// served instead of creating a new texture.  The pool holds at most
+  /// get_pool_size_limit() bytes; past that, the textures that have
+  /// been idle the longest are deleted.
+  ///
+  /// A pooled texture is only reused for the exact size it was made
+  /// at: the shaders rely on the GL clamping at the texture edge for
+  /// their edge extension, so handing out a larger texture would
+  /// change the results along the image borders.
   class TexAlloc {
 
+    typedef std::pair<std::pair<Tex_Format, Tex_Type>, std::pair<int, int> > PoolKey;
+    typedef std::list<TexObj*> PoolList;
+
     // Class Variables
     static bool isInit;
-    static std::list<TexObj*> texRecycleList;
+    static PoolList texRecycleList;                     // idle textures, oldest first
+    static std::multimap<PoolKey, PoolList::iterator> texRecycleMap;
     static int allocatedCount;
     static int allocatedSize;
+    static int pooledCount;
+    static int pooledSize;
+    static int peakAllocatedSize;
+    static int poolSizeLimit;
+    static int poolHits;
+    static int poolMisses;
     static bool recylingEnabled;
     static std::map<std::pair<Tex_Format, Tex_Type>, std::pair<Tex_Format, Tex_Type> > textureSubstitutesMap;
 
     // Class Functions - Private
     static void initialize_texalloc();
+    static PoolKey pool_key(TexObj* texObj);
+    static void delete_texture(TexObj* texObj);
+    static void trim_pool(int limit);
 
   public:
 
@@ -43,6 +67,20 @@ namespace GPU {
     static int get_allocated_count() { return allocatedCount; }
     static int get_allocated_size() { return allocatedSize; }
 
+    /// Residency accounting: the textures held idle in the pool, and
+    /// those handed out and not yet released.
+    static int get_pooled_count() { return pooledCount; }
+    static int get_pooled_size() { return pooledSize; }
+    static int get_in_use_count() { return allocatedCount - pooledCount; }
+    static int get_in_use_size() { return allocatedSize - pooledSize; }
+    static int get_peak_allocated_size() { return peakAllocatedSize; }
+    static int get_pool_hits() { return poolHits; }
+    static int get_pool_misses() { return poolMisses; }
+
+    /// The most bytes of idle textures the pool keeps.
+    static int get_pool_size_limit() { return poolSizeLimit; }
+    static void set_pool_size_limit(int bytes) { poolSizeLimit = bytes; trim_pool(poolSizeLimit); }
+
   private:
   };
 
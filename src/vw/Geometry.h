@@ -16,6 +16,7 @@
 #include <vw/Geometry/Box.h>
 #include <vw/Geometry/Sphere.h>
 #include <vw/Geometry/SpatialTree.h>
+#include <vw/Geometry/PackedSpatialTree.h>
 #include <vw/Geometry/PointListIO.h>
 #include <vw/Geometry/ATrans.h>
 #include <vw/Geometry/Frame.h>
@@ -37,6 +37,7 @@ namespace vw
       }
 
       friend class FrameStore;
+      friend class FrameSnapshot;
     };
   }
 }
@@ -20,6 +20,117 @@ namespace vw
 
     FrameHandle const FrameStore::NULL_HANDLE = FrameHandle(NULL);
 
+    FrameSnapshot::FrameSnapshot(vector<FrameTreeNode *> const& root_nodes)
+    {
+      vector<FrameTreeNode *>::const_iterator first, last = root_nodes.end();
+      for (first = root_nodes.begin(); first != last; ++first) {
+        add(*first, -1);
+      }
+    }
+
+    void
+    FrameSnapshot::add(FrameTreeNode * node, int parent)
+    {
+      // Parents come before their children, so theirs are done already.
+      Node n;
+      n.node = node;
+      n.parent = parent;
+      n.name = node->data().name();
+      n.local = node->data().transform();
+      if (parent < 0) {
+        n.root = int(m_nodes.size());
+        n.to_root = vw::identity_matrix(4);
+      }
+      else {
+        n.root = m_nodes[parent].root;
+        n.to_root = m_nodes[parent].to_root * n.local;
+      }
+      n.from_root = inverse(n.to_root);
+
+      int i = int(m_nodes.size());
+      m_nodes.push_back(n);
+      m_index[node] = i;
+
+      FrameTreeNode::NodeVector children = node->children();
+      FrameTreeNode::NodeVector::const_iterator first, last = children.end();
+      for (first = children.begin(); first != last; ++first) {
+        add(*first, i);
+      }
+    }
+
+    int
+    FrameSnapshot::index(FrameHandle frame) const
+    {
+      VW_ASSERT (frame.node != NULL,
+                 vw::LogicErr() << "NULL handle not allowed as parameter.");
+
+      boost::unordered_map<FrameTreeNode const *, int>::const_iterator i = m_index.find(frame.node);
+      if (i == m_index.end())
+        vw_throw(vw::LogicErr() << "Frame not member of FrameSnapshot.");
+      return i->second;
+    }
+
+    bool
+    FrameSnapshot::is_member(FrameHandle frame) const
+    {
+      return m_index.find(frame.node) != m_index.end();
+    }
+
+    std::string const&
+    FrameSnapshot::name(FrameHandle frame) const
+    {
+      return m_nodes[index(frame)].name;
+    }
+
+    FrameHandle
+    FrameSnapshot::parent(FrameHandle frame) const
+    {
+      int p = m_nodes[index(frame)].parent;
+      return (p < 0)? FrameStore::NULL_HANDLE : FrameHandle(m_nodes[p].node);
+    }
+
+    FrameHandle
+    FrameSnapshot::root(FrameHandle frame) const
+    {
+      return m_nodes[m_nodes[index(frame)].root].node;
+    }
+
+    FrameSnapshot::Transform const&
+    FrameSnapshot::transform(FrameHandle frame) const
+    {
+      return m_nodes[index(frame)].local;
+    }
+
+    FrameSnapshot::Transform
+    FrameSnapshot::get_transform(FrameHandle frame, FrameHandle source) const
+    {
+      VW_ASSERT (source.node != NULL,
+                 vw::LogicErr() << "NULL handle not allowed as frame parameter.");
+
+      Node const& s = m_nodes[index(source)];
+      if (frame.node == NULL)
+        return s.local;
+      if (frame.node == source.node)
+        return vw::identity_matrix(4);
+
+      Node const& f = m_nodes[index(frame)];
+      if (f.root != s.root)
+        return vw::identity_matrix(4);
+      return f.from_root * s.to_root;
+    }
+
+    FrameSnapshot::Transform
+    FrameSnapshot::get_transform_of(FrameHandle frame, FrameHandle source, Transform const& loc) const
+    {
+      return get_transform(frame, source) * loc;
+    }
+
+    Vector3
+    FrameSnapshot::get_position_of(FrameHandle frame, FrameHandle source, Vector3 const& loc) const
+    {
+      return get_transform(frame, source) * loc;
+    }
+
     FrameStore::~FrameStore() throw()
     {
       // delete all frames
@@ -285,6 +396,7 @@ namespace vw
         m_root_nodes.push_back(node);
 
       node->set_parent(parent.node);
+      invalidate_snapshot();
 
       n.release();
     }
@@ -319,6 +431,7 @@ namespace vw
           // we deleted only one node
         }
       }
+      invalidate_snapshot();
     }
 
     void
@@ -349,6 +462,7 @@ namespace vw
       if (parent.node == 0) {
         m_root_nodes.push_back(frame.node);
       }
+      invalidate_snapshot();
     }
 
     bool
@@ -426,6 +540,7 @@ namespace vw
                  vw::LogicErr() << "NULL handle not allowed as parameter.");
 
       vw::geometry::set_transform(frame.node, wrt_frame.node, update);
+      invalidate_snapshot();
     }
 
     void
@@ -437,6 +552,7 @@ namespace vw
                  vw::LogicErr() << "NULL handle not allowed as parameter.");
 
       vw::geometry::set_transform(frame.node, NULL, update);
+      invalidate_snapshot();
     }
 
     bool
@@ -449,6 +565,8 @@ namespace vw
     bool
     FrameStore::merge_tree(FrameTreeNode * tree, FrameHandle start_frame)
     {
+      RecursiveMutex::Lock lock(m_mutex);
+
       VW_ASSERT (!is_member(tree),
                  vw::LogicErr() << "Merged tree must not yet be member of the FrameStore.");
 
@@ -458,6 +576,7 @@ namespace vw
                    vw::LogicErr() << "Tree root node does not match start node.");
         vw::geometry::merge_frame_trees(tree, start_frame.node);
         tree->recursive_delete();
+        invalidate_snapshot();
         return true;
       }
 
@@ -467,12 +586,14 @@ namespace vw
         if ((*first)->data().name() == tree->data().name()) {
           vw::geometry::merge_frame_trees(*first, tree);
           tree->recursive_delete();
+          invalidate_snapshot();
           return true;
         }
       }
 
       // just add the tree to the forest
       m_root_nodes.push_back(tree);
+      invalidate_snapshot();
       return false;
     }
 
@@ -501,6 +622,31 @@ namespace vw
       for (first = frames.begin(); first != last; ++first, ++trans) {
         first->node->data().set_transform(*trans);
       }
+      invalidate_snapshot();
+    }
+
+    boost::shared_ptr<FrameSnapshot const>
+    FrameStore::snapshot() const
+    {
+      // Readers share the current snapshot without locking; only the
+      // first of them after a change takes the lock to make a new one.
+      boost::shared_ptr<FrameSnapshot const> snap = boost::atomic_load(&m_snapshot);
+      if (snap)
+        return snap;
+
+      RecursiveMutex::Lock lock(m_mutex);
+      snap = m_snapshot;
+      if (!snap) {
+        snap.reset(new FrameSnapshot(m_root_nodes));
+        boost::atomic_store(&m_snapshot, snap);
+      }
+      return snap;
+    }
+
+    void
+    FrameStore::invalidate_snapshot()
+    {
+      boost::atomic_store(&m_snapshot, boost::shared_ptr<FrameSnapshot const>());
     }
 
     bool
@@ -13,6 +13,9 @@
 #include <vw/Geometry/FrameTreeNode.h>
 #include <vw/Core/Thread.h>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
 
 namespace vw
 {
@@ -21,6 +24,83 @@ namespace geometry
   // forward declaration
   class FrameStore;
 
+  /**
+   * @brief Immutable copy of the frame trees of a FrameStore.
+   *
+   * Snapshots are taken by FrameStore::snapshot() and never change
+   * afterwards, so any number of threads can query one at the same
+   * time without locking.  The transform of every frame relative to its
+   * root frame is composed when the snapshot is taken, which makes
+   * get_transform() between any two frames a single product instead of
+   * a walk up the tree.
+   *
+   * A snapshot only uses frame handles as keys, and never touches the
+   * frames themselves, so it stays usable after the FrameStore changes
+   * and still answers as of the time it was taken.  Frames added
+   * afterwards are not members, and querying them, or a NULL handle,
+   * throws @vw::LogicErr.
+   */
+  class FrameSnapshot {
+  public:
+    typedef Frame::Transform Transform;
+
+    //! Test if the frame was in the FrameStore when the snapshot was taken.
+    bool is_member(FrameHandle frame) const;
+
+    //! The number of frames in the snapshot.
+    size_t size() const { return m_nodes.size(); }
+
+    //! Name of frame.
+    std::string const& name(FrameHandle frame) const;
+
+    //! Return the parent frame, or the NULL-handle if root frame.
+    FrameHandle parent(FrameHandle frame) const;
+
+    //! Return root node of specified frame.
+    FrameHandle root(FrameHandle frame) const;
+
+    //! Transform of frame relative to its parent.
+    Transform const& transform(FrameHandle frame) const;
+
+    /**
+     * Return the transform of @source expressed relative to @frame, as
+     * FrameStore::get_transform() does.  Frames in different trees
+     * give the identity.
+     */
+    Transform get_transform(FrameHandle frame, FrameHandle source) const;
+
+    /**
+     * Return the transform @loc, which is expressed relative to @source
+     * with respect to @frame.
+     */
+    Transform get_transform_of(FrameHandle frame, FrameHandle source, Transform const& loc) const;
+
+    /**
+     * Return the position @loc, which is expressed relative to @source
+     * with respect to @frame.
+     */
+    Vector3 get_position_of(FrameHandle frame, FrameHandle source, Vector3 const& loc) const;
+
+  private:
+    friend class FrameStore;
+
+    struct Node {
+      FrameTreeNode * node;
+      int parent;
+      int root;
+      std::string name;
+      /** Transform relative to the parent, and relative to the root and back. */
+      Transform local, to_root, from_root;
+    };
+
+    FrameSnapshot(std::vector<FrameTreeNode *> const& root_nodes);
+    void add(FrameTreeNode * node, int parent);
+    int index(FrameHandle frame) const;
+
+    std::vector<Node> m_nodes;
+    boost::unordered_map<FrameTreeNode const *, int> m_index;
+  };
+
     /**
      * @brief Thread-safe coordinate-frame tree class.
      * The FrameStore class implements a thread-safe interface to a
@@ -326,6 +406,15 @@ namespace geometry
       void get_frame_transforms(FrameHandleVector const& handles, TransformVector& transforms) const;
       void set_frame_transforms(FrameHandleVector const& handles, TransformVector const& transforms);
 
+      /**
+       * Return a snapshot of all frames, which can be queried from any
+       * number of threads without taking the FrameStore's lock.  The
+       * snapshot is taken at the first call after the frames change and
+       * shared until they change again, so readers that call this
+       * before each batch of queries only pay for it once per update.
+       */
+      boost::shared_ptr<FrameSnapshot const> snapshot() const;
+
       /**
        * A static instance to a NULL handle, for reference.
        */
@@ -335,6 +424,8 @@ namespace geometry
       void assert_unique(std::string const& name, FrameTreeNode * parent) const;
       /** Test if the frame belongs to this FrameStore instance. */
       bool is_member(FrameTreeNode * node) const throw();
+      /** Drop the current snapshot after the frames change.  Call with m_mutex held. */
+      void invalidate_snapshot();
 
       /** Vector of FrameTreeNode pointers. */
       typedef std::vector<FrameTreeNode *> FrameTreeNodeVector;
@@ -343,6 +434,8 @@ namespace geometry
       mutable RecursiveMutex m_mutex;
       /** The vector of root nodes. */
       FrameTreeNodeVector m_root_nodes;
+      /** The current snapshot, or NULL if the frames have changed since. */
+      mutable boost::shared_ptr<FrameSnapshot const> m_snapshot;
     };
   }
 }
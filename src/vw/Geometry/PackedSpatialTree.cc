@@ -0,0 +1,225 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Geometry/PackedSpatialTree.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+  using namespace vw;
+  using namespace vw::geometry;
+
+  // The Morton code of a point quantized to bits bits per dimension:
+  // the bits of its coordinates, interleaved from the most significant
+  // down, as many as fit in 64 bits.
+  uint64 morton_code(std::vector<uint32> const& cell, uint32 bits) {
+    uint64 code = 0;
+    size_t num_bits = 0;
+    for (uint32 b = bits; b-- > 0; ) {
+      for (size_t d = 0; d < cell.size() && num_bits < 64; ++d, ++num_bits)
+        code = (code << 1) | ((cell[d] >> b) & 1);
+    }
+    return code;
+  }
+
+  // Grows bounds (min then max, dim each) to hold other.
+  void grow_bounds(double* bounds, double const* other, size_t dim) {
+    for (size_t i = 0; i < dim; ++i) {
+      bounds[i] = std::min(bounds[i], other[i]);
+      bounds[dim+i] = std::max(bounds[dim+i], other[dim+i]);
+    }
+  }
+
+  class OverlapPairsTask : public Task {
+    PackedSpatialTree const& m_tree;
+    size_t m_begin, m_end;
+    std::vector<PackedSpatialTree::PrimitivePair>& m_overlaps;
+  public:
+    OverlapPairsTask(PackedSpatialTree const& tree, size_t begin, size_t end,
+                     std::vector<PackedSpatialTree::PrimitivePair>& overlaps)
+      : m_tree(tree), m_begin(begin), m_end(end), m_overlaps(overlaps) {}
+    void operator()() { m_tree.overlap_pairs(m_begin, m_end, m_overlaps); }
+  };
+
+  struct PrimitiveCollector {
+    std::vector<GeomPrimitive*>& m_prims;
+    PrimitiveCollector(std::vector<GeomPrimitive*>& prims) : m_prims(prims) {}
+    void operator()(GeomPrimitive* prim) { m_prims.push_back(prim); }
+  };
+
+  // Collects the primitives after index that overlap the one at index.
+  struct OverlapCollector {
+    std::vector<GeomPrimitive*> const& m_prims;
+    size_t m_index;
+    std::vector<PackedSpatialTree::PrimitivePair>& m_overlaps;
+    OverlapCollector(std::vector<GeomPrimitive*> const& prims, size_t index,
+                     std::vector<PackedSpatialTree::PrimitivePair>& overlaps)
+      : m_prims(prims), m_index(index), m_overlaps(overlaps) {}
+    void operator()(size_t i) {
+      if (i > m_index && m_prims[i]->intersects(m_prims[m_index]))
+        m_overlaps.push_back(std::make_pair(m_prims[m_index], m_prims[i]));
+    }
+  };
+
+}
+
+namespace vw {
+namespace geometry {
+
+  PackedSpatialTree::BoxQuery::BoxQuery(BBoxT const& box) : m_bounds(2*box.min().size()) {
+    const size_t dim = box.min().size();
+    for (size_t i = 0; i < dim; ++i) {
+      m_bounds[i] = box.min()[i];
+      m_bounds[dim+i] = box.max()[i];
+    }
+  }
+
+  PackedSpatialTree::PackedSpatialTree(std::vector<GeomPrimitive*> const& prims, size_t node_size)
+    : m_dim(0), m_num_leaves(0) {
+    VW_ASSERT( node_size >= 2, ArgumentErr() << "PackedSpatialTree: node size must be at least 2." );
+    if (prims.empty())
+      return;
+
+    m_dim = prims[0]->bounding_box().min().size();
+    VW_ASSERT( m_dim > 0, ArgumentErr() << "PackedSpatialTree: primitives must have non-empty bounding boxes." );
+    const size_t stride = 2*m_dim;
+    const size_t num_prims = prims.size();
+
+    // The bounds of the primitives, and of their centers
+    std::vector<double> bounds(stride*num_prims);
+    std::vector<double> center_min(m_dim, std::numeric_limits<double>::max());
+    std::vector<double> center_max(m_dim, -std::numeric_limits<double>::max());
+    for (size_t p = 0; p < num_prims; ++p) {
+      BBoxT const& box = prims[p]->bounding_box();
+      VW_ASSERT( box.min().size() == m_dim,
+                 ArgumentErr() << "PackedSpatialTree: primitives must all have the same dimension." );
+      for (size_t i = 0; i < m_dim; ++i) {
+        bounds[stride*p+i] = box.min()[i];
+        bounds[stride*p+m_dim+i] = box.max()[i];
+        double center = 0.5*(box.min()[i] + box.max()[i]);
+        center_min[i] = std::min(center_min[i], center);
+        center_max[i] = std::max(center_max[i], center);
+      }
+    }
+
+    // Sort the primitives along the Morton curve through their centers
+    const uint32 bits = uint32(std::max(size_t(1), std::min(size_t(21), 64/m_dim)));
+    const double cells = double((uint64(1) << bits) - 1);
+    std::vector<std::pair<uint64, uint32> > order(num_prims);
+    std::vector<uint32> cell(m_dim);
+    for (size_t p = 0; p < num_prims; ++p) {
+      for (size_t i = 0; i < m_dim; ++i) {
+        double extent = center_max[i] - center_min[i];
+        double center = 0.5*(bounds[stride*p+i] + bounds[stride*p+m_dim+i]);
+        cell[i] = extent > 0 ? uint32((center - center_min[i]) / extent * cells) : 0;
+      }
+      order[p] = std::make_pair(morton_code(cell, bits), uint32(p));
+    }
+    std::sort(order.begin(), order.end());
+
+    m_prims.resize(num_prims);
+    m_prim_bounds.resize(stride*num_prims);
+    for (size_t p = 0; p < num_prims; ++p) {
+      m_prims[p] = prims[order[p].second];
+      std::copy(&bounds[stride*order[p].second], &bounds[stride*order[p].second] + stride,
+                &m_prim_bounds[stride*p]);
+    }
+
+    // Pack the leaves over the sorted primitives, then each level over
+    // the one below it, up to a single root, which ends up last
+    size_t level_begin = 0, level_end = 0, num_children = num_prims;
+    bool leaves = true;
+    do {
+      level_begin = m_node_first.size();
+      for (size_t first = 0; first < num_children; first += node_size) {
+        size_t count = std::min(node_size, num_children - first);
+        size_t child = (leaves ? 0 : level_end) + first;
+        double const* child_bounds = leaves ? &m_prim_bounds[stride*child] : &m_node_bounds[stride*child];
+        size_t node = m_node_first.size();
+        m_node_first.push_back(uint32(child));
+        m_node_count.push_back(uint32(count));
+        std::vector<double> node_bounds(child_bounds, child_bounds + stride);
+        m_node_bounds.insert(m_node_bounds.end(), node_bounds.begin(), node_bounds.end());
+        for (size_t c = 1; c < count; ++c) {
+          child_bounds = leaves ? &m_prim_bounds[stride*(child+c)] : &m_node_bounds[stride*(child+c)];
+          grow_bounds(&m_node_bounds[stride*node], child_bounds, m_dim);
+        }
+      }
+      if (leaves)
+        m_num_leaves = m_node_first.size();
+      leaves = false;
+      num_children = m_node_first.size() - level_begin;
+      level_end = level_begin;
+    } while (num_children > 1);
+  }
+
+  PackedSpatialTree::BBoxT
+  PackedSpatialTree::bounding_box() const {
+    if (m_prims.empty())
+      return BBoxT();
+    const size_t root = m_node_first.size() - 1;
+    VectorT min(m_dim), max(m_dim);
+    for (size_t i = 0; i < m_dim; ++i) {
+      min[i] = m_node_bounds[2*m_dim*root+i];
+      max[i] = m_node_bounds[2*m_dim*root+m_dim+i];
+    }
+    return BBoxT(min, max);
+  }
+
+  void
+  PackedSpatialTree::intersects(BBoxT const& box, std::vector<GeomPrimitive*>& prims) const {
+    PrimitiveCollector collector(prims);
+    intersects(box, collector);
+  }
+
+  void
+  PackedSpatialTree::contains(VectorT const& point, std::vector<GeomPrimitive*>& prims) const {
+    PrimitiveCollector collector(prims);
+    contains(point, collector);
+  }
+
+  void
+  PackedSpatialTree::overlap_pairs(size_t begin, size_t end, std::vector<PrimitivePair>& overlaps) const {
+    const size_t stride = 2*m_dim;
+    for (size_t p = begin; p < end && p < m_prims.size(); ++p) {
+      BoxQuery query(&m_prim_bounds[stride*p], m_dim);
+      OverlapCollector collector(m_prims, p, overlaps);
+      search(query, collector);
+    }
+  }
+
+  void
+  PackedSpatialTree::overlap_pairs(std::vector<PrimitivePair>& overlaps, int num_threads) const {
+    if (num_threads <= 0)
+      num_threads = vw_settings().default_num_threads();
+
+    // A few chunks per thread, as the primitives in dense areas have
+    // more overlaps to check than the others
+    const size_t num_chunks = std::min(m_prims.size(), size_t(num_threads)*4);
+    if (num_threads == 1 || num_chunks <= 1) {
+      overlap_pairs(0, m_prims.size(), overlaps);
+      return;
+    }
+
+    const size_t chunk_size = (m_prims.size() + num_chunks - 1) / num_chunks;
+    std::vector<std::vector<PrimitivePair> > chunk_overlaps(num_chunks);
+    FifoWorkQueue queue(num_threads);
+    for (size_t c = 0; c < num_chunks; ++c)
+      queue.add_task(boost::shared_ptr<Task>(new OverlapPairsTask(*this, c*chunk_size, (c+1)*chunk_size,
+                                                                  chunk_overlaps[c])));
+    queue.join_all();
+
+    for (size_t c = 0; c < num_chunks; ++c)
+      overlaps.insert(overlaps.end(), chunk_overlaps[c].begin(), chunk_overlaps[c].end());
+  }
+
+}} // namespace vw::geometry
@@ -0,0 +1,169 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file PackedSpatialTree.h
+///
+/// A read-only spatial index over a fixed set of GeomPrimitives, for
+/// indexing many footprints (images of a mosaic, camera footprints)
+/// that are all known up front.
+///
+/// Unlike SpatialTree, which is built one primitive at a time into a
+/// tree of separately allocated nodes, the PackedSpatialTree is built
+/// in one pass: the primitives are sorted along a Morton (Z-order)
+/// curve through their centers and packed bottom-up into an R-tree
+/// with node_size entries per node.  The nodes and the primitive
+/// bounding boxes are stored in flat arrays, and queries hand each
+/// result to a callback instead of building a list.
+
+#ifndef __VW_GEOMETRY_PACKED_SPATIAL_TREE_H__
+#define __VW_GEOMETRY_PACKED_SPATIAL_TREE_H__
+
+#include <utility>
+#include <vector>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/BBox.h>
+#include <vw/Geometry/SpatialTree.h>
+
+namespace vw {
+namespace geometry {
+
+  class PackedSpatialTree {
+  public:
+    typedef BBox<double> BBoxT;
+    typedef Vector<double> VectorT;
+    typedef std::pair<GeomPrimitive*, GeomPrimitive*> PrimitivePair;
+
+    /// Builds the tree over prims, which must all have bounding boxes
+    /// of the same dimension.  The tree does not own the primitives.
+    PackedSpatialTree(std::vector<GeomPrimitive*> const& prims, size_t node_size = 16);
+
+    size_t size() const { return m_prims.size(); }
+    size_t dim() const { return m_dim; }
+    BBoxT bounding_box() const;
+
+    /// Calls func(prim) for each primitive whose bounding box
+    /// intersects box.
+    template <class FuncT>
+    void intersects(BBoxT const& box, FuncT& func) const {
+      BoxQuery query(box);
+      PrimitiveVisitor<FuncT> visitor(m_prims, func);
+      search(query, visitor);
+    }
+
+    /// Calls func(prim) for each primitive that contains point.
+    template <class FuncT>
+    void contains(VectorT const& point, FuncT& func) const {
+      PointQuery query(point);
+      ContainsVisitor<FuncT> visitor(m_prims, point, func);
+      search(query, visitor);
+    }
+
+    void intersects(BBoxT const& box, std::vector<GeomPrimitive*>& prims) const;
+    void contains(VectorT const& point, std::vector<GeomPrimitive*>& prims) const;
+
+    /// Finds every pair of primitives that intersect each other, each
+    /// pair once.  The primitives are split between num_threads
+    /// threads (vw_settings().default_num_threads() if 0); the pairs
+    /// come out in the same order however many threads are used.
+    void overlap_pairs(std::vector<PrimitivePair>& overlaps, int num_threads = 0) const;
+
+    /// The pairs in overlap_pairs() that involve the primitives at
+    /// [begin, end) in the packed order.
+    void overlap_pairs(size_t begin, size_t end, std::vector<PrimitivePair>& overlaps) const;
+
+  private:
+    size_t m_dim;
+    std::vector<GeomPrimitive*> m_prims;    // in packed order
+    std::vector<double> m_prim_bounds;      // min then max, m_dim each, per primitive
+    std::vector<double> m_node_bounds;      // the same per node
+    std::vector<uint32> m_node_first;       // first child node, or primitive for a leaf
+    std::vector<uint32> m_node_count;
+    size_t m_num_leaves;                    // the leaves are the first nodes
+
+    class BoxQuery {
+      std::vector<double> m_bounds;
+    public:
+      BoxQuery(BBoxT const& box);
+      BoxQuery(double const* bounds, size_t dim) : m_bounds(bounds, bounds + 2*dim) {}
+      bool operator()(double const* bounds) const {
+        const size_t dim = m_bounds.size()/2;
+        for (size_t i = 0; i < dim; ++i)
+          if (bounds[i] >= m_bounds[dim+i] || bounds[dim+i] <= m_bounds[i])
+            return false;
+        return dim != 0;
+      }
+    };
+
+    class PointQuery {
+      VectorT const& m_point;
+    public:
+      PointQuery(VectorT const& point) : m_point(point) {}
+      bool operator()(double const* bounds) const {
+        const size_t dim = m_point.size();
+        for (size_t i = 0; i < dim; ++i)
+          if (m_point[i] < bounds[i] || m_point[i] >= bounds[dim+i])
+            return false;
+        return dim != 0;
+      }
+    };
+
+    template <class FuncT>
+    class PrimitiveVisitor {
+      std::vector<GeomPrimitive*> const& m_prims;
+      FuncT& m_func;
+    public:
+      PrimitiveVisitor(std::vector<GeomPrimitive*> const& prims, FuncT& func) : m_prims(prims), m_func(func) {}
+      void operator()(size_t i) { m_func(m_prims[i]); }
+    };
+
+    template <class FuncT>
+    class ContainsVisitor {
+      std::vector<GeomPrimitive*> const& m_prims;
+      VectorT const& m_point;
+      FuncT& m_func;
+    public:
+      ContainsVisitor(std::vector<GeomPrimitive*> const& prims, VectorT const& point, FuncT& func)
+        : m_prims(prims), m_point(point), m_func(func) {}
+      void operator()(size_t i) {
+        if (m_prims[i]->contains(m_point))
+          m_func(m_prims[i]);
+      }
+    };
+
+    // Calls visitor(i) for the packed index i of each primitive whose
+    // bounding box passes query, in packed order.
+    template <class QueryT, class VisitorT>
+    void search(QueryT const& query, VisitorT& visitor) const {
+      if (m_prims.empty())
+        return;
+      const size_t stride = 2*m_dim;
+      std::vector<uint32> stack;
+      stack.reserve(64);
+      stack.push_back(uint32(m_node_first.size() - 1));
+      while (!stack.empty()) {
+        uint32 node = stack.back();
+        stack.pop_back();
+        if (!query(&m_node_bounds[stride*node]))
+          continue;
+        uint32 first = m_node_first[node], last = first + m_node_count[node];
+        if (node < m_num_leaves) {
+          for (uint32 i = first; i < last; ++i)
+            if (query(&m_prim_bounds[stride*i]))
+              visitor(i);
+        } else {
+          for (uint32 i = last; i-- > first; )
+            stack.push_back(i);
+        }
+      }
+    }
+  };
+
+}} // namespace vw::geometry
+
+#endif // __VW_GEOMETRY_PACKED_SPATIAL_TREE_H__
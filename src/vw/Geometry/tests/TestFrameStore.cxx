@@ -0,0 +1,72 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <vw/Geometry/FrameStore.h>
+#include <vw/Math/EulerAngles.h>
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::geometry;
+using namespace vw::test;
+
+namespace {
+  ATrans3 trans(double x, double y, double z, double angle) {
+    return ATrans3(Vector3(x, y, z), math::euler_to_rotation_matrix(angle, 0.5 * angle, 0, "zyx"));
+  }
+
+  void expect_near(ATrans3 const& a, ATrans3 const& b) {
+    EXPECT_VECTOR_NEAR(a.translation(), b.translation(), 1e-10);
+    EXPECT_MATRIX_NEAR(a.rotation(), b.rotation(), 1e-12);
+  }
+}
+
+TEST(FrameStore, Snapshot) {
+  FrameStore store;
+  FrameHandle world = store.add("world", FrameStore::NULL_HANDLE, trans(5, 0, 0, 0.1));
+  FrameHandle robot = store.add("robot", world, trans(1, 2, 3, 0.3));
+  FrameHandle arm = store.add("arm", robot, trans(0, 0.5, 0, -0.7));
+  FrameHandle camera = store.add("camera", arm, trans(0.1, 0, 0.2, 1.1));
+  FrameHandle tower = store.add("tower", world, trans(-4, 1, 0, 0.9));
+  FrameHandle other = store.add("other", FrameStore::NULL_HANDLE, trans(1, 1, 1, 0.2));
+
+  boost::shared_ptr<FrameSnapshot const> snap = store.snapshot();
+  EXPECT_EQ(6u, snap->size());
+  EXPECT_EQ(snap, store.snapshot());
+  EXPECT_EQ("arm", snap->name(arm));
+  EXPECT_TRUE(snap->parent(robot) == world);
+  EXPECT_TRUE(snap->parent(world) == FrameStore::NULL_HANDLE);
+  EXPECT_TRUE(snap->root(camera) == world);
+
+  FrameHandle frames[] = { world, robot, arm, camera, tower, other };
+  for (int i = 0; i < 6; ++i) {
+    for (int j = 0; j < 6; ++j)
+      expect_near(store.get_transform(frames[i], frames[j]), snap->get_transform(frames[i], frames[j]));
+    expect_near(store.get_transform(FrameStore::NULL_HANDLE, frames[i]),
+                snap->get_transform(FrameStore::NULL_HANDLE, frames[i]));
+  }
+  EXPECT_VECTOR_NEAR(store.get_position_of(tower, camera, Vector3(1, 2, 3)),
+                     snap->get_position_of(tower, camera, Vector3(1, 2, 3)), 1e-10);
+
+  // Changes make a new snapshot, and leave the old one as it was.
+  ATrans3 before = snap->get_transform(tower, camera);
+  store.set_transform_rel(arm, trans(0, 0, 1, 0.2));
+  boost::shared_ptr<FrameSnapshot const> snap2 = store.snapshot();
+  EXPECT_NE(snap, snap2);
+  expect_near(before, snap->get_transform(tower, camera));
+  expect_near(store.get_transform(tower, camera), snap2->get_transform(tower, camera));
+
+  FrameHandle lens = store.add("lens", camera, trans(0, 0, 0.01, 0));
+  store.del(tower);
+  boost::shared_ptr<FrameSnapshot const> snap3 = store.snapshot();
+  EXPECT_FALSE(snap->is_member(lens));
+  EXPECT_THROW(snap->get_transform(lens, camera), LogicErr);
+  EXPECT_TRUE(snap->is_member(tower));
+  EXPECT_EQ("tower", snap->name(tower));
+  EXPECT_FALSE(snap3->is_member(tower));
+  expect_near(store.get_transform(world, lens), snap3->get_transform(world, lens));
+}
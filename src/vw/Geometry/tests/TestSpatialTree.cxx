@@ -9,11 +9,14 @@
 #include <test/Helpers.h>
 
 #include <vw/Geometry/SpatialTree.h>
+#include <vw/Geometry/PackedSpatialTree.h>
 #include <vw/Math/Vector.h>
 #include <vw/Math/BBox.h>
 #include <vw/Core.h>
 #include <boost/foreach.hpp>
 #include <sstream>
+#include <set>
+#include <boost/random/linear_congruential.hpp>
 
 using namespace vw;
 using namespace vw::geometry;
@@ -231,3 +234,80 @@ TEST( SpatialTreeTest, Intersect ) {
   EXPECT_EQ( 9, results.size() );
 
 }
+
+struct CountPrimitives {
+  size_t count;
+  CountPrimitives() : count(0) {}
+  void operator()(GeomPrimitive*) { count++; }
+};
+
+TEST( PackedSpatialTreeTest, Intersect ) {
+
+  std::list<TestGeomPrimitive> owner;
+  std::vector<GeomPrimitive*> prims;
+  for ( size_t i = 0; i < 100; i++ ) {
+    for ( size_t j = 0; j < 100; j++ ) {
+      owner.push_back(TestGeomPrimitive());
+      owner.back().min() = Vector2i(i,j)*256;
+      owner.back().max() = owner.back().min() + Vector2i(256,256);
+      prims.push_back(&owner.back());
+    }
+  }
+  PackedSpatialTree test(prims);
+  EXPECT_EQ( 10000u, test.size() );
+  EXPECT_VECTOR_DOUBLE_EQ( Vector2(0,0), test.bounding_box().min() );
+  EXPECT_VECTOR_DOUBLE_EQ( Vector2(25600,25600), test.bounding_box().max() );
+
+  {
+    std::vector<GeomPrimitive*> results;
+    test.contains( Vector2(1152,1152), results );
+    ASSERT_EQ( 1u, results.size() );
+    EXPECT_TRUE( results[0]->bounding_box().contains(Vector2(1152,1152)) );
+    results.clear();
+    test.contains( Vector2(-1,5), results );
+    EXPECT_EQ( 0u, results.size() );
+  }
+
+  std::vector<GeomPrimitive*> results;
+  test.intersects( BBox2(128,128,512,512), results );
+  EXPECT_EQ( 9u, results.size() );
+
+  CountPrimitives count;
+  test.intersects( BBox2(128,128,512,512), count );
+  EXPECT_EQ( 9u, count.count );
+}
+
+TEST( PackedSpatialTreeTest, OverlapPairs ) {
+
+  // Random boxes, checked against the pointer-based tree
+  boost::rand48 gen(10);
+  std::list<TestGeomPrimitive> owner;
+  std::vector<GeomPrimitive*> prims;
+  SpatialTree tree(BBox2(0,0,1024,1024));
+  for ( size_t i = 0; i < 500; i++ ) {
+    owner.push_back(TestGeomPrimitive());
+    owner.back().grow( Vector2(gen() % 1000, gen() % 1000) );
+    owner.back().grow( owner.back().min() + Vector2(1 + gen() % 50, 1 + gen() % 50) );
+    prims.push_back(&owner.back());
+    tree.add(&owner.back());
+  }
+
+  std::list<std::pair<GeomPrimitive*, GeomPrimitive*> > truth;
+  tree.overlap_pairs(truth);
+  std::set<std::pair<GeomPrimitive*, GeomPrimitive*> > truth_set;
+  typedef std::pair<GeomPrimitive*, GeomPrimitive*> pair_type;
+  BOOST_FOREACH( pair_type const& p, truth )
+    truth_set.insert( std::make_pair(std::min(p.first, p.second), std::max(p.first, p.second)) );
+
+  PackedSpatialTree test(prims, 4);
+  std::vector<pair_type> overlaps, threaded_overlaps;
+  test.overlap_pairs(overlaps, 1);
+  test.overlap_pairs(threaded_overlaps, 4);
+  EXPECT_EQ( overlaps, threaded_overlaps );
+
+  std::set<pair_type> overlap_set;
+  BOOST_FOREACH( pair_type const& p, overlaps )
+    overlap_set.insert( std::make_pair(std::min(p.first, p.second), std::max(p.first, p.second)) );
+  EXPECT_EQ( overlaps.size(), overlap_set.size() );
+  EXPECT_TRUE( truth_set == overlap_set );
+}
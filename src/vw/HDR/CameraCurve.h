@@ -19,14 +19,22 @@
 #include <vw/Math/Matrix.h>
 #include <vw/Math/Vector.h>
 
+#include <boost/random/linear_congruential.hpp>
+
 // Number of LDR intensity pairs to sample
 const int VW_HDR_DEFAULT_NUM_PIXEL_SAMPLES = 300;
 
+// Seed of the pixel sampling, so that the estimated curves are the same
+// from run to run
+const unsigned VW_HDR_DEFAULT_SAMPLE_SEED = 0;
+
 namespace vw {
 namespace hdr {
   namespace detail {
-    inline uint32 dice(uint32 max_) {
-      return static_cast<uint32>(max_ * (double(rand()) / double(RAND_MAX)));
+    /// A value in [0, max_).  Each sampling run draws from its own
+    /// generator, so runs on different threads don't interfere.
+    inline uint32 dice(boost::rand48& gen, uint32 max_) {
+      return static_cast<uint32>(max_ * (double(gen() - (gen.min)()) / (double((gen.max)() - (gen.min)()) + 1.0)));
     }
   }
 
@@ -80,7 +88,8 @@ namespace hdr {
   Matrix<typename PixelChannelType<typename ViewT::pixel_type>::type> generate_ldr_intensity_pairs(std::vector<ViewT> const &images,
                                                                                                    std::vector<double> const &brightness_values,
                                                                                                    int num_pairs, uint32 channel,
-                                                                                                   int kernel_size = 1) {
+                                                                                                   int kernel_size = 1,
+                                                                                                   uint32 seed = VW_HDR_DEFAULT_SAMPLE_SEED) {
 
     typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
     uint32 n_channels = PixelNumChannels<typename ViewT::pixel_type>::value;
@@ -93,18 +102,18 @@ namespace hdr {
     int height = images[0].impl().rows();
     int width = images[0].impl().cols();
 
-    srand(time(0)); // Initialize random number generator
+    boost::rand48 gen(seed);
     int i = 0;
     while (i < num_pairs) {
       // Generate random indices for two images
-      int rand_x = detail::dice(width);
-      int rand_y = detail::dice(height);
+      int rand_x = detail::dice(gen, width);
+      int rand_y = detail::dice(gen, height);
 
       // Pick two distinct images to sample from
-      int id1 = detail::dice(images.size());
+      int id1 = detail::dice(gen, images.size());
       int id2;
       while (true) {
-        id2 = detail::dice(images.size());
+        id2 = detail::dice(gen, images.size());
         if (id1 != id2) break;
       }
 
@@ -139,7 +148,8 @@ namespace hdr {
   Matrix<typename PixelChannelType<typename ViewT::pixel_type>::type> sample_ldr_images(std::vector<ViewT> const &images,
                                                                                         std::vector<double> const &/*brightness_values*/,
                                                                                         int num_pairs, int channel,
-                                                                                        int kernel_size = 1) {
+                                                                                        int kernel_size = 1,
+                                                                                        uint32 seed = VW_HDR_DEFAULT_SAMPLE_SEED) {
 
     typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
     uint32 n_channels = PixelNumChannels<typename ViewT::pixel_type>::value;
@@ -152,12 +162,12 @@ namespace hdr {
     int height = images[0].impl().rows();
     int width = images[0].impl().cols();
 
-    srand(time(0)); // Initialize random number generator
+    boost::rand48 gen(seed);
     int i = 0;
     while (i < num_pairs) {
       // Generate random indices for two images
-      int rand_x = detail::dice(width);
-      int rand_y = detail::dice(height);
+      int rand_x = detail::dice(gen, width);
+      int rand_y = detail::dice(gen, height);
 
       for (unsigned j = 0; j < images.size(); ++j)
         pair_list(i,j) = sample_image(images[j].impl(), rand_x, rand_y, channel, kernel_size);
@@ -218,6 +228,27 @@ namespace hdr {
       return exp(val1 + (val2-val1) * frac);
     }
 
+    // Returns the luminance values for n pixel values of one channel,
+    // as the function above does for each of them.
+    void operator() (double const* pixel_vals, double* luminances, size_t n, size_t channel) const {
+      if (channel >= m_lookup_tables.size())
+        vw_throw(ArgumentErr() << "CameraCurveFn: unknown lookup table.");
+
+      Vector<double> const& table = m_lookup_tables[channel];
+      const double scale = double(table.size()-1);
+      const int64 last = int64(table.size()) - 1;
+      for (size_t i = 0; i < n; ++i) {
+        double scaled_pixel_val = pixel_vals[i]*scale;
+        double idx1 = floor(scaled_pixel_val);
+        int64 i1 = int64(idx1), i2 = int64(ceil(scaled_pixel_val));
+        if (i1 < 0 || i2 > last)
+          vw_throw(ArgumentErr() << "CameraCurveFn: pixel value out of range.");
+        double val1 = table[i1];
+        double val2 = table[i2];
+        luminances[i] = exp(val1 + (val2-val1) * (scaled_pixel_val - idx1));
+      }
+    }
+
     template <class PixelT>
     typename CompoundChannelCast<PixelT, double>::type operator() (PixelT pixel_val) const {
       typedef typename CompoundChannelCast<PixelT, double>::type pixel_type;
@@ -257,18 +288,21 @@ namespace hdr {
   ///
   /// sample_region_size is given in units of pixels, and it
   /// determines the size of the neighborhood that is averaged when
-  /// picking corresponding points samples between LDR images.
+  /// picking corresponding points samples between LDR images.  The
+  /// samples are drawn from a generator seeded with seed, so the same
+  /// images give the same curves.
   template <class ViewT>
   CameraCurveFn camera_curves(std::vector<ViewT> const &images,
                               std::vector<double> brightness_values,
-                              int sample_region_size = 1) {
+                              int sample_region_size = 1,
+                              uint32 seed = VW_HDR_DEFAULT_SAMPLE_SEED) {
 
     int32 n_channels = PixelNumChannels<typename ViewT::pixel_type>::value;
 
     // Sample each image channel
     std::vector<vw::Matrix<double> > pixels(n_channels);
     for ( int32 i = 0; i < n_channels; ++i ) {
-      pixels[i] = sample_ldr_images(images, brightness_values, VW_HDR_DEFAULT_NUM_PIXEL_SAMPLES, i, sample_region_size);
+      pixels[i] = sample_ldr_images(images, brightness_values, VW_HDR_DEFAULT_NUM_PIXEL_SAMPLES, i, sample_region_size, seed + i);
     }
 
     // Compute camera response curve for each channel.
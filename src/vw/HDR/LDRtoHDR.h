@@ -24,7 +24,9 @@
 #ifndef __VW_HDR_LDRTOHDR_H__
 #define __VW_HDR_LDRTOHDR_H__
 
+#include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/HDR/CameraCurve.h>
 
 #include <vector>
@@ -133,15 +135,47 @@ namespace hdr {
     }
 
     /// \COND INTERNAL
-    typedef HighDynamicRangeView<SrcPixelT> prerasterize_type;
+    // Merges a whole block at a time: each bracket is read once per
+    // block, and the curves are looked up one channel of the block at a
+    // time, rather than pixel by pixel through the brackets' views.
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      const size_t num_channels = CompoundNumChannels<SrcPixelT>::value;
+      if (num_channels != m_curves.num_channels())
+        vw_throw(ArgumentErr() << "HighDynamicRangeView: pixel does not have the same number of channels as there are curves.");
 
-      // Rasterize each of the individual LDR images if necessary.
-      std::vector<ImageViewRef<SrcPixelT> > m_prerast_views(m_views.size());
-      for (unsigned i = 0; i < m_views.size(); ++i)
-        m_prerast_views[i] = m_views[i].prerasterize(bbox);
+      const size_t num_pixels = size_t(bbox.width()) * size_t(bbox.height());
+      ImageView<pixel_type> hdr(bbox.width(), bbox.height());
+      std::vector<double> weight_sums(num_pixels, 0.0), weights(num_pixels);
+      std::vector<double> pixel_vals(num_pixels), luminances(num_pixels);
 
-      return prerasterize_type( m_prerast_views, m_curves, m_brightness_vals );
+      for ( unsigned c = 0; c < m_views.size(); ++c ) {
+        ImageView<SrcPixelT> ldr = crop( m_views[c], bbox );
+        SrcPixelT const* src = &(ldr(0,0));
+        pixel_type* dst = &(hdr(0,0));
+
+        // The same gaussian weighting as operator() above.
+        for ( size_t k = 0; k < num_pixels; ++k ) {
+          PixelGray<double> gray(src[k]);
+          weights[k] = exp(-pow((gray-0.5),2)/(0.07));
+          weight_sums[k] += weights[k];
+        }
+
+        for ( size_t ch = 0; ch < num_channels; ++ch ) {
+          for ( size_t k = 0; k < num_pixels; ++k )
+            pixel_vals[k] = double(src[k][ch]);
+          m_curves( &pixel_vals[0], &luminances[0], num_pixels, ch );
+          for ( size_t k = 0; k < num_pixels; ++k )
+            dst[k][ch] += weights[k] * m_brightness_vals[c] * luminances[k];
+        }
+      }
+
+      // Divide by sum of weights
+      pixel_type* dst = &(hdr(0,0));
+      for ( size_t k = 0; k < num_pixels; ++k )
+        dst[k] /= weight_sums[k];
+
+      return crop( hdr, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
     /// \endcond
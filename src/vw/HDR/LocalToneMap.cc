@@ -11,8 +11,13 @@
 #include <vw/Image/ImageMath.h>
 #include <vw/Image/Filter.h>
 #include <vw/Image/Algorithms.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/EdgeExtension.h>
 #include <vw/Core/Functors.h>
+#include <vw/Core/Settings.h>
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <iostream>
 
@@ -24,40 +29,6 @@ using namespace vw::hdr;
 // ********************************************************************
 const unsigned ASH_MAX_KERNEL = 10;
 
-ImageView<double> ashikhmin_world_adaptation_luminance(ImageView<double> L_w, double threshold) {
-  typedef ImageView<double> Map;
-
-  std::vector<Map> L_w_blur(ASH_MAX_KERNEL * 2);
-  std::vector<Map> V(ASH_MAX_KERNEL);
-
-  vw_out() << "Computing L_w_blur\n";
-  for ( unsigned s = 1; s <= ASH_MAX_KERNEL * 2; ++s ) {
-    if ((s < ASH_MAX_KERNEL) || (s % 2 == 0)) {
-      vw_out() << "L_w_blur[" << (s) << "]\n";
-      L_w_blur[s-1] = gaussian_filter(L_w, 1.0, 1.0, s, s);
-    }
-  }
-
-  vw_out() << "Computing Vs\n";
-  for ( unsigned s = 1; s <= ASH_MAX_KERNEL; ++s ) {
-    V[s-1] = abs((L_w_blur[s-1] - L_w_blur[2*s - 1]) / (L_w_blur[s-1] + 0.0001));
-  }
-
-  vw_out() << "Computing L_wa\n";
-  Map L_wa(L_w.cols(), L_w.rows());
-  for ( int32 x = 0; x < L_wa.cols(); ++x ) {
-    for ( int32 y = 0; y < L_wa.rows(); ++y ) {
-      unsigned s_t = 1;
-      while ((s_t < ASH_MAX_KERNEL) && (V[s_t - 1](x,y) <= threshold)) {
-        ++s_t;
-      }
-      L_wa(x,y) = L_w_blur[s_t - 1](x,y);
-    }
-  }
-
-  return L_wa;
-}
-
 struct AshikhminCompressiveFunctor : ReturnFixedType<double> {
 private:
   double C_L_wmin, k;
@@ -66,8 +37,6 @@ public:
   AshikhminCompressiveFunctor(double L_wmin, double L_wmax, double L_dmax = 1.0) {
     C_L_wmin = C(L_wmin);
     k = L_dmax / (C(L_wmax) - C_L_wmin);
-    vw_out() << "C(L_wmin) = " << C_L_wmin << "\n";
-    vw_out() << "k = " << k << "\n";
   }
 
   double C(double L) const {
@@ -77,33 +46,86 @@ public:
     return (32.0693 + log10(L/7.2444) / 0.0556);
   }
 
+  double C_min() const { return C_L_wmin; }
+  double scale() const { return k; }
+
   double operator() (double L_wa) const {
     return k * (C(L_wa) - C_L_wmin);
   }
 };
 
-ImageView<PixelRGB<double> > vw::hdr::ashikhmin_tone_map(ImageView<PixelRGB<double> > hdr_image, double threshold) {
-  ImageView<PixelGray<double> > gray = hdr_image;
-  ImageView<double> L_w = channels_to_planes(gray);
-  //  write_image("lw.jpg", L_w);
-  ImageView<PixelRGB<double> > out_image = copy(hdr_image) / L_w;
-
-  // Compute world adaptation luminance
-  ImageView<double> L_wa = ashikhmin_world_adaptation_luminance(L_w, threshold);
-  //  write_image("lwa.jpg", L_wa);
+static ImageView<double> luminance(ImageView<PixelRGB<double> > const& image) {
+  ImageView<PixelGray<double> > gray = image;
+  return channels_to_planes(gray);
+}
 
-  // Compute display luminances
+vw::hdr::AshikhminToneMapView::AshikhminToneMapView(ImageViewRef<PixelRGB<double> > const& hdr_image, double threshold)
+  : m_image(hdr_image), m_threshold(threshold), m_L_wmin(0), m_L_wmax(0) {
   vw_out() << "Computing L_wmin and L_wmax\n";
-  double L_wmin, L_wmax;
-  min_max_channel_values(L_w, L_wmin, L_wmax);
-  vw_out() << "Computing F(L_wa)\n";
-  AshikhminCompressiveFunctor F(L_wmin, L_wmax);
-  ImageView<double> F_L_wa = per_pixel_filter(L_wa, F);
-  //  write_image("flwa.jpg", F_L_wa);
+  const int32 tile = vw_settings().default_tile_size();
+  bool first = true;
+  for ( int32 y = 0; y < rows(); y += tile ) {
+    ImageView<double> L_w = luminance(crop(m_image, BBox2i(0, y, cols(), std::min(tile, rows() - y))));
+    double L_min, L_max;
+    min_max_channel_values(L_w, L_min, L_max);
+    if (first || L_min < m_L_wmin) m_L_wmin = L_min;
+    if (first || L_max > m_L_wmax) m_L_wmax = L_max;
+    first = false;
+  }
+
+  AshikhminCompressiveFunctor F(m_L_wmin, m_L_wmax);
+  vw_out() << "C(L_wmin) = " << F.C_min() << "\n";
+  vw_out() << "k = " << F.scale() << "\n";
+}
+
+ImageView<PixelRGB<double> > vw::hdr::AshikhminToneMapView::tone_map_block(BBox2i const& bbox) const {
+  typedef ImageView<double> Map;
+
+  // The block with room for the widest blur kernel around it.  The
+  // margin is edge extended as the blurs of the whole image would be.
+  const int32 margin = ASH_MAX_KERNEL + 1;
+  BBox2i padded = bbox;
+  padded.expand(margin);
+  ImageView<PixelRGB<double> > hdr = crop(edge_extend(m_image, ConstantEdgeExtension()), padded);
+  Map L_w = luminance(hdr);
+  BBox2i inner(margin, margin, bbox.width(), bbox.height());
+
+  std::vector<Map> L_w_blur(ASH_MAX_KERNEL * 2);
+  for ( unsigned s = 1; s <= ASH_MAX_KERNEL * 2; ++s ) {
+    if ((s < ASH_MAX_KERNEL) || (s % 2 == 0))
+      L_w_blur[s-1] = crop(gaussian_filter(L_w, 1.0, 1.0, s, s), inner);
+  }
+
+  // Pick the world adaptation luminance L_wa at each pixel, the blur at
+  // the smallest scale whose contrast V exceeds the threshold, and
+  // compress it to the display luminance L_d.
+  AshikhminCompressiveFunctor F(m_L_wmin, m_L_wmax);
+  ImageView<PixelRGB<double> > out_image(bbox.width(), bbox.height());
+  for ( int32 y = 0; y < out_image.rows(); ++y ) {
+    for ( int32 x = 0; x < out_image.cols(); ++x ) {
+      unsigned s_t = 1;
+      while ((s_t < ASH_MAX_KERNEL) &&
+             (fabs((L_w_blur[s_t-1](x,y) - L_w_blur[2*s_t - 1](x,y)) / (L_w_blur[s_t-1](x,y) + 0.0001)) <= m_threshold)) {
+        ++s_t;
+      }
+      double L_wa = L_w_blur[s_t - 1](x,y);
+      double L_w_xy = L_w(x + margin, y + margin);
+      double L_d = F(L_wa) * L_w_xy / L_wa;
+
+      // Recombine luminance values into color image
+      out_image(x,y) = hdr(x + margin, y + margin) / L_w_xy * L_d;
+    }
+  }
+  return out_image;
+}
+
+ImageView<PixelRGB<double> > vw::hdr::ashikhmin_tone_map(ImageView<PixelRGB<double> > hdr_image, double threshold) {
+  AshikhminToneMapView tone_mapped(hdr_image, threshold);
+
   vw_out() << "Computing display luminances\n";
-  ImageView<double> L_d = F_L_wa * L_w / L_wa;
-  //  write_image("ld.jpg", L_d);
+  const int32 tile = vw_settings().default_tile_size();
+  ImageView<PixelRGB<double> > out_image =
+    block_rasterize(tone_mapped, Vector2i(tile, tile), vw_settings().default_num_threads());
 
-  // Recombine luminance values into color image
-  return normalize(out_image * L_d);
+  return normalize(out_image);
 }
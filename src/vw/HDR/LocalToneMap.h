@@ -12,15 +12,67 @@
 ///
 /// This file implements the following tone mapping operators.
 ///
+/// - The Ashikhmin operator (ashikhmin_tone_map, AshikhminToneMapView)
 ///
 #ifndef __VW_HDR_LOCALTONEMAP_H__
 #define __VW_HDR_LOCALTONEMAP_H__
 
 #include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelAccessors.h>
 
 namespace vw {
 namespace hdr {
 
+  /// The Ashikhmin operator, before the final normalization, computed
+  /// one block at a time.
+  ///
+  /// A block blurs only its own pixels, with the margin the widest blur
+  /// kernel needs, picks the adaptation scale and compresses each pixel
+  /// as it goes, and keeps no full-size intermediate.  Blocks are
+  /// independent, so rasterize it with block_rasterize or
+  /// block_write_image to tonemap large images in bounded memory on
+  /// several threads.  Only the luminance range is computed up front,
+  /// in one pass over the image.
+  class AshikhminToneMapView : public ImageViewBase<AshikhminToneMapView> {
+    ImageViewRef<PixelRGB<double> > m_image;
+    double m_threshold, m_L_wmin, m_L_wmax;
+
+  public:
+    typedef PixelRGB<double> pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<AshikhminToneMapView> pixel_accessor;
+
+    AshikhminToneMapView(ImageViewRef<PixelRGB<double> > const& hdr_image, double threshold = 0.5);
+
+    inline int32 cols() const { return m_image.cols(); }
+    inline int32 rows() const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      return tone_map_block(BBox2i(i, j, 1, 1))(0, 0);
+    }
+
+    /// The tonemapped pixels of bbox.
+    ImageView<pixel_type> tone_map_block(BBox2i const& bbox) const;
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      return crop( tone_map_block(bbox), -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+    }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+    /// \endcond
+  };
+
+  /// The Ashikhmin operator, normalized to [0,1].  The image is
+  /// tonemapped block by block on vw_settings().default_num_threads()
+  /// threads.
   ImageView<PixelRGB<double> > ashikhmin_tone_map(ImageView<PixelRGB<double> > hdr_image,
                                                   double threshold = 0.5);
 
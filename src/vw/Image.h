@@ -23,6 +23,7 @@
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/MaskViews.h>
+#include <vw/Image/PackedMaskView.h>
 #include <vw/Image/PerPixelViews.h>
 #include <vw/Image/PerPixelAccessorViews.h>
 #include <vw/Image/UtilityViews.h>
@@ -41,6 +42,7 @@
 #include <vw/Image/BlockProcessor.h>
 #include <vw/Image/BlockRasterize.h>
 #include <vw/Image/Statistics.h>
+#include <vw/Image/SummedAreaTable.h>
 #include <vw/Image/Palette.h>
 #include <vw/Image/SparseImageCheck.h>
 
@@ -12,11 +12,17 @@
 #ifndef __VW_IMAGE_ALGORITHMS_H__
 #define __VW_IMAGE_ALGORITHMS_H__
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
 #include <vw/Image/ImageView.h>
 #include <vw/Image/PerPixelViews.h>
 #include <vw/Image/Statistics.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/EdgeExtension.h>
+#include <vw/Math/DisjointSet.h>
 
 /// Used in blobindex
 #include <boost/graph/adjacency_list.hpp>
@@ -381,6 +387,258 @@ namespace vw {
     return result;
   }
 
+  /// A view of the grassfire image of an image, with the same values
+  /// as grassfire(), that is computed one tile at a time so that
+  /// neither the image nor the result need ever be in memory at once.
+  ///
+  /// The Manhattan distance is separable: the distance image is the
+  /// one-dimensional distance along each row of the one-dimensional
+  /// distances along each column.  A tile therefore only needs to know,
+  /// for each of its columns, how far it is to the nearest zero above
+  /// and below it, and for each of its rows, the smallest distance
+  /// coming in from the left and from the right.  The constructor
+  /// finds these in two passes over the image, processing the tiles
+  /// in parallel, and keeps only them: two values per column for each
+  /// row of tiles and two per row for each column of tiles.
+  /// Rasterizing a region then reads only the tiles of the image that
+  /// it touches.  Wrap the view in block_cache() if the same tiles
+  /// will be rasterized repeatedly.
+  ///
+  /// Tiles of the image are rasterized from several threads at once,
+  /// so the image must be safe to rasterize that way; pass threads=1
+  /// otherwise.
+  template <class ImageT>
+  class GrassfireView : public ImageViewBase<GrassfireView<ImageT> > {
+    typedef typename ImageT::pixel_type source_type;
+
+    // The tile boundary values, shared between copies of the view.
+    struct Boundaries {
+      int32 tile, bands, strips;
+      // up[k*cols+x]: the distance from the first row of band k up to
+      // the nearest zero above it in column x; down[k*cols+x]: from the
+      // last row of band k down to the nearest zero below it.  Outside
+      // the image counts as zero.
+      std::vector<int32> up, down;
+      // left[s*rows+y]: the smallest distance at the first column of
+      // strip s coming from the columns to its left; right[s*rows+y]:
+      // at the last column of strip s, from the columns to its right.
+      std::vector<int32> left, right;
+    };
+
+    ImageT m_image;
+    boost::shared_ptr<Boundaries> m_bounds;
+
+    BBox2i tile_bbox( int32 band, int32 strip ) const {
+      BBox2i bbox( strip*m_bounds->tile, band*m_bounds->tile, m_bounds->tile, m_bounds->tile );
+      bbox.crop( BBox2i( 0, 0, cols(), rows() ) );
+      return bbox;
+    }
+
+    // Computes the column distances of a tile, given the distances to
+    // the nearest zeros above and below it.
+    void column_distances( BBox2i const& bbox, int32 const* up, int32 const* down, ImageView<int32>& dist ) const {
+      ImageView<source_type> src = crop( m_image, bbox );
+      int32 w = bbox.width(), h = bbox.height();
+      source_type const zero = source_type();
+      dist.set_size( w, h );
+      for( int32 x=0; x<w; ++x )
+        dist(x,0) = ( src(x,0)==zero ) ? 0 : up[x];
+      for( int32 y=1; y<h; ++y )
+        for( int32 x=0; x<w; ++x )
+          dist(x,y) = ( src(x,y)==zero ) ? 0 : dist(x,y-1) + 1;
+      for( int32 x=0; x<w; ++x )
+        dist(x,h-1) = std::min( dist(x,h-1), down[x] );
+      for( int32 y=h-2; y>=0; --y )
+        for( int32 x=0; x<w; ++x )
+          dist(x,y) = std::min( dist(x,y), dist(x,y+1) + 1 );
+    }
+
+    // Pass one: the first and last zero row of each column of a tile,
+    // relative to the tile, or -1 if there are none.
+    class ZeroRowsFunc {
+      GrassfireView const& m_view;
+      std::vector<int32> &m_first, &m_last;
+    public:
+      ZeroRowsFunc( GrassfireView const& view, std::vector<int32>& first, std::vector<int32>& last )
+        : m_view(view), m_first(first), m_last(last) {}
+
+      void operator()( BBox2i const& bbox ) const {
+        ImageView<source_type> src = crop( m_view.m_image, bbox );
+        source_type const zero = source_type();
+        size_t base = size_t(bbox.min().y() / m_view.m_bounds->tile) * m_view.cols() + bbox.min().x();
+        for( int32 x=0; x<src.cols(); ++x ) {
+          int32 first = -1, last = -1;
+          for( int32 y=0; y<src.rows(); ++y ) {
+            if( src(x,y) == zero ) {
+              if( first < 0 ) first = y;
+              last = y;
+            }
+          }
+          m_first[base+x] = first;
+          m_last[base+x] = last;
+        }
+      }
+    };
+
+    // Pass two: the smallest distance each row of a tile contributes
+    // just past its right edge and just before its left edge.
+    class RowMinimaFunc {
+      GrassfireView const& m_view;
+      std::vector<int32> &m_to_right, &m_to_left;
+    public:
+      RowMinimaFunc( GrassfireView const& view, std::vector<int32>& to_right, std::vector<int32>& to_left )
+        : m_view(view), m_to_right(to_right), m_to_left(to_left) {}
+
+      void operator()( BBox2i const& bbox ) const {
+        Boundaries const& b = *m_view.m_bounds;
+        int32 cols = m_view.cols();
+        size_t band = bbox.min().y() / b.tile, strip = bbox.min().x() / b.tile;
+        ImageView<int32> dist;
+        m_view.column_distances( bbox, &b.up[band*cols+bbox.min().x()], &b.down[band*cols+bbox.min().x()], dist );
+        int32 w = bbox.width();
+        size_t base = strip * m_view.rows() + bbox.min().y();
+        for( int32 y=0; y<dist.rows(); ++y ) {
+          int32 to_right = std::numeric_limits<int32>::max(), to_left = std::numeric_limits<int32>::max();
+          for( int32 x=0; x<w; ++x ) {
+            to_right = std::min( to_right, dist(x,y) + (w-x) );
+            to_left = std::min( to_left, dist(x,y) + (x+1) );
+          }
+          m_to_right[base+y] = to_right;
+          m_to_left[base+y] = to_left;
+        }
+      }
+    };
+
+  public:
+    typedef int32 pixel_type;
+    typedef int32 result_type;
+    typedef ProceduralPixelAccessor<GrassfireView> pixel_accessor;
+
+    /// Computes the tile boundary values, using tiles of the given size
+    /// (the default tile size if 0) and the given number of threads
+    /// (the default number if 0).
+    GrassfireView( ImageT const& image, int32 tile_size = 0, int32 threads = 0 )
+      : m_image(image), m_bounds( new Boundaries )
+    {
+      Boundaries& b = *m_bounds;
+      b.tile = tile_size ? tile_size : vw_settings().default_tile_size();
+      VW_ASSERT( b.tile > 0, ArgumentErr() << "GrassfireView: tile size must be positive." );
+      int32 cols = image.cols(), rows = image.rows();
+      b.bands = (rows + b.tile - 1) / b.tile;
+      b.strips = (cols + b.tile - 1) / b.tile;
+      if( cols == 0 || rows == 0 ) return;
+      BBox2i bbox( 0, 0, cols, rows );
+      Vector2i block_size( b.tile, b.tile );
+
+      // The nearest zeros above and below each band follow from the
+      // zero rows of the bands above and below it.
+      std::vector<int32> first( size_t(b.bands)*cols ), last( size_t(b.bands)*cols );
+      {
+        BlockProcessor<ZeroRowsFunc> process( ZeroRowsFunc( *this, first, last ), block_size, threads );
+        process( bbox );
+      }
+      b.up.resize( size_t(b.bands)*cols );
+      b.down.resize( size_t(b.bands)*cols );
+      for( int32 x=0; x<cols; ++x ) {
+        int32 zero_row = -1;
+        for( int32 k=0; k<b.bands; ++k ) {
+          b.up[size_t(k)*cols+x] = k*b.tile - zero_row;
+          if( last[size_t(k)*cols+x] >= 0 ) zero_row = k*b.tile + last[size_t(k)*cols+x];
+        }
+        zero_row = rows;
+        for( int32 k=b.bands-1; k>=0; --k ) {
+          int32 end = std::min( (k+1)*b.tile, rows );
+          b.down[size_t(k)*cols+x] = zero_row - (end-1);
+          if( first[size_t(k)*cols+x] >= 0 ) zero_row = k*b.tile + first[size_t(k)*cols+x];
+        }
+      }
+
+      // Likewise the distances coming in from either side of each
+      // strip follow from the row minima of the strips beside it.
+      std::vector<int32> to_right( size_t(b.strips)*rows ), to_left( size_t(b.strips)*rows );
+      {
+        BlockProcessor<RowMinimaFunc> process( RowMinimaFunc( *this, to_right, to_left ), block_size, threads );
+        process( bbox );
+      }
+      b.left.resize( size_t(b.strips)*rows );
+      b.right.resize( size_t(b.strips)*rows );
+      for( int32 y=0; y<rows; ++y ) {
+        int32 from_left = 1;
+        for( int32 s=0; s<b.strips; ++s ) {
+          b.left[size_t(s)*rows+y] = from_left;
+          int32 w = std::min( (s+1)*b.tile, cols ) - s*b.tile;
+          from_left = std::min( from_left + w, to_right[size_t(s)*rows+y] );
+        }
+        int32 from_right = 1;
+        for( int32 s=b.strips-1; s>=0; --s ) {
+          b.right[size_t(s)*rows+y] = from_right;
+          int32 w = std::min( (s+1)*b.tile, cols ) - s*b.tile;
+          from_right = std::min( from_right + w, to_left[size_t(s)*rows+y] );
+        }
+      }
+    }
+
+    inline int32 cols() const { return m_image.cols(); }
+    inline int32 rows() const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    /// The size of the tiles the view is computed in.
+    int32 tile_size() const { return m_bounds->tile; }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+
+    inline result_type operator()( int32 x, int32 y, int32 p=0 ) const {
+      ImageView<int32> pixel( 1, 1 );
+      rasterize( pixel, BBox2i(x,y,1,1) );
+      return pixel(0,0,p);
+    }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> dest( bbox.width(), bbox.height() );
+      rasterize( dest, bbox );
+      return CropView<ImageView<pixel_type> >( dest, BBox2i(-bbox.min().x(),-bbox.min().y(),cols(),rows()) );
+    }
+
+    template <class DestT>
+    void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      VW_ASSERT( BBox2i(0,0,cols(),rows()).contains( bbox ),
+                 ArgumentErr() << "GrassfireView: bounding box " << bbox << " is outside the image." );
+      if( bbox.empty() ) return;
+      Boundaries const& b = *m_bounds;
+      ImageView<int32> dist;
+      for( int32 band = bbox.min().y() / b.tile; band*b.tile < bbox.max().y(); ++band ) {
+        for( int32 strip = bbox.min().x() / b.tile; strip*b.tile < bbox.max().x(); ++strip ) {
+          BBox2i tile = tile_bbox( band, strip );
+          column_distances( tile, &b.up[size_t(band)*cols()+tile.min().x()],
+                            &b.down[size_t(band)*cols()+tile.min().x()], dist );
+          int32 w = tile.width();
+          for( int32 y=0; y<tile.height(); ++y ) {
+            int32* row = &dist(0,y);
+            int32 d = b.left[size_t(strip)*rows()+tile.min().y()+y] - 1;
+            for( int32 x=0; x<w; ++x )
+              row[x] = d = std::min( d+1, row[x] );
+            d = b.right[size_t(strip)*rows()+tile.min().y()+y] - 1;
+            for( int32 x=w-1; x>=0; --x )
+              row[x] = d = std::min( d+1, row[x] );
+          }
+          BBox2i section = tile;
+          section.crop( bbox );
+          crop( dist, section - tile.min() ).rasterize( crop( dest, section - bbox.min() ),
+                                                        BBox2i(0,0,section.width(),section.height()) );
+        }
+      }
+    }
+    /// \endcond
+  };
+
+  /// Returns a GrassfireView of an image.
+  template <class ImageT>
+  GrassfireView<ImageT> block_grassfire( ImageViewBase<ImageT> const& image, int32 tile_size = 0, int32 threads = 0 ) {
+    return GrassfireView<ImageT>( image.impl(), tile_size, threads );
+  }
+
   // *******************************************************************
   // bounding_box()
   // *******************************************************************
@@ -735,6 +993,206 @@ namespace vw {
     return result;
   }
 
+  // ********************************************************************
+  // blob_statistics()
+  // ********************************************************************
+
+  /// The size and extent of one blob found by blob_statistics().
+  struct BlobStatistics {
+    uint64 area;     ///< The number of pixels in the blob
+    BBox2i bbox;     ///< The bounding box of the blob
+    Vector2i first;  ///< The first pixel of the blob in raster order
+    BlobStatistics() : area(0) {}
+  };
+
+  /// \cond INTERNAL
+  // The blobs of one tile, and the blob each pixel on its edges
+  // belongs to (-1 for invalid pixels).
+  struct BlobTile {
+    std::vector<BlobStatistics> blobs;
+    std::vector<int32> top, bottom, left, right;
+  };
+
+  // Labels the 8-connected blobs of valid pixels of each tile with a
+  // local union-find.
+  template <class SourceT>
+  class BlobTileFunc {
+    SourceT const& m_src;
+    std::vector<BlobTile>& m_tiles;
+    int32 m_tile, m_strips;
+
+    static int32 root( std::vector<int32>& parent, int32 l ) {
+      while( parent[l] != l ) l = parent[l] = parent[parent[l]];
+      return l;
+    }
+    static int32 join( std::vector<int32>& parent, int32 a, int32 b ) {
+      a = root( parent, a );
+      if( b < 0 ) return a;
+      b = root( parent, b );
+      if( a < b ) std::swap( a, b );
+      parent[a] = b;
+      return b;
+    }
+  public:
+    BlobTileFunc( SourceT const& src, std::vector<BlobTile>& tiles, int32 tile, int32 strips )
+      : m_src(src), m_tiles(tiles), m_tile(tile), m_strips(strips) {}
+
+    void operator()( BBox2i const& bbox ) const {
+      ImageView<typename SourceT::pixel_type> block = crop( m_src, bbox );
+      int32 w = block.cols(), h = block.rows();
+      std::vector<int32> label( size_t(w)*h, -1 ), parent;
+      for( int32 y=0; y<h; ++y ) {
+        int32 *row = &label[size_t(y)*w], *above = y ? row - w : 0;
+        for( int32 x=0; x<w; ++x ) {
+          if( ! is_valid( block(x,y) ) ) continue;
+          int32 l = -1;
+          int32 neighbors[4] = { x ? row[x-1] : -1,
+                                 ( above && x ) ? above[x-1] : -1,
+                                 above ? above[x] : -1,
+                                 ( above && x+1<w ) ? above[x+1] : -1 };
+          for( int32 n=0; n<4; ++n )
+            if( neighbors[n] >= 0 ) l = join( parent, neighbors[n], l );
+          if( l < 0 ) {
+            l = int32( parent.size() );
+            parent.push_back( l );
+          }
+          row[x] = l;
+        }
+      }
+
+      // Number the roots in order, which is raster order of the
+      // blobs' first pixels.
+      BlobTile& tile = m_tiles[size_t(bbox.min().y()/m_tile)*m_strips + bbox.min().x()/m_tile];
+      std::vector<int32> index( parent.size(), -1 );
+      for( size_t l=0; l<parent.size(); ++l ) {
+        int32 r = root( parent, int32(l) );
+        if( index[r] < 0 ) {
+          index[r] = int32( tile.blobs.size() );
+          tile.blobs.push_back( BlobStatistics() );
+        }
+        index[l] = index[r];
+      }
+      for( int32 y=0; y<h; ++y ) {
+        int32* row = &label[size_t(y)*w];
+        for( int32 x=0; x<w; ++x ) {
+          if( row[x] < 0 ) continue;
+          row[x] = index[row[x]];
+          BlobStatistics& blob = tile.blobs[row[x]];
+          Vector2i pos = bbox.min() + Vector2i(x,y);
+          if( blob.area == 0 ) {
+            blob.first = pos;
+            blob.bbox = BBox2i( pos, pos + Vector2i(1,1) );
+          }
+          else blob.bbox.grow( BBox2i( pos, pos + Vector2i(1,1) ) );
+          ++blob.area;
+        }
+      }
+      tile.top.assign( label.begin(), label.begin() + w );
+      tile.bottom.assign( label.end() - w, label.end() );
+      tile.left.resize( h );
+      tile.right.resize( h );
+      for( int32 y=0; y<h; ++y ) {
+        tile.left[y] = label[size_t(y)*w];
+        tile.right[y] = label[size_t(y)*w + w-1];
+      }
+    }
+  };
+
+  // Joins two tile blobs, given the offsets of their tiles' blobs in
+  // the disjoint set, unless either pixel is invalid.
+  inline void join_blobs( math::DisjointSet<size_t>& sets, std::vector<math::DisjointSet<size_t>::Elem> const& elems,
+                          size_t offset_a, int32 a, size_t offset_b, int32 b ) {
+    if( a < 0 || b < 0 ) return;
+    sets.combine( sets.find( elems[offset_a+a] ), sets.find( elems[offset_b+b] ) );
+  }
+
+  inline bool blob_first_less( BlobStatistics const& a, BlobStatistics const& b ) {
+    return a.first.y() < b.first.y() || ( a.first.y() == b.first.y() && a.first.x() < b.first.x() );
+  }
+  /// \endcond
+
+  /// Finds the 8-connected blobs of valid pixels of an image, like
+  /// blob_index(), and returns the area and bounding box of each, in
+  /// the raster order of their first pixels.  No label image is
+  /// made: the image is processed in tiles of the given size (the
+  /// default tile size if 0), in parallel using the given number of
+  /// threads (the default number if 0), and only the labels along the
+  /// tile edges are kept to join the blobs of neighboring tiles.
+  /// Tiles are rasterized from several threads at once, so the image
+  /// must be safe to rasterize that way; pass threads=1 otherwise.
+  template <class SourceT>
+  std::vector<BlobStatistics> blob_statistics( ImageViewBase<SourceT> const& src,
+                                               int32 tile_size = 0, int32 threads = 0 ) {
+    if ( src.impl().planes() > 1 )
+      vw_throw( NoImplErr() << "Blob statistics currently only works with 2D images." );
+    int32 tile = tile_size ? tile_size : vw_settings().default_tile_size();
+    VW_ASSERT( tile > 0, ArgumentErr() << "blob_statistics: tile size must be positive." );
+    int32 cols = src.impl().cols(), rows = src.impl().rows();
+    std::vector<BlobStatistics> result;
+    if( cols == 0 || rows == 0 ) return result;
+    int32 strips = (cols + tile - 1) / tile, bands = (rows + tile - 1) / tile;
+
+    std::vector<BlobTile> tiles( size_t(strips)*bands );
+    BlobTileFunc<SourceT> func( src.impl(), tiles, tile, strips );
+    BlockProcessor<BlobTileFunc<SourceT> > process( func, Vector2i(tile,tile), threads );
+    process( BBox2i(0,0,cols,rows) );
+
+    // Join the blobs that touch across tile edges and corners.
+    typedef math::DisjointSet<size_t> SetT;
+    SetT sets;
+    std::vector<SetT::Elem> elems;
+    std::vector<size_t> offset( tiles.size() );
+    for( size_t t=0; t<tiles.size(); ++t ) {
+      offset[t] = elems.size();
+      for( size_t b=0; b<tiles[t].blobs.size(); ++b )
+        elems.push_back( sets.insert( elems.size() ) );
+    }
+    for( int32 k=0; k<bands; ++k ) {
+      for( int32 s=0; s<strips; ++s ) {
+        size_t t = size_t(k)*strips + s;
+        BlobTile const& tl = tiles[t];
+        if( s+1 < strips ) {
+          BlobTile const& tr = tiles[t+1];
+          int32 h = int32( tl.right.size() );
+          for( int32 y=0; y<h; ++y )
+            for( int32 dy=-1; dy<=1; ++dy )
+              if( y+dy >= 0 && y+dy < h ) join_blobs( sets, elems, offset[t], tl.right[y], offset[t+1], tr.left[y+dy] );
+        }
+        if( k+1 < bands ) {
+          BlobTile const& tb = tiles[t+strips];
+          int32 w = int32( tl.bottom.size() );
+          for( int32 x=0; x<w; ++x )
+            for( int32 dx=-1; dx<=1; ++dx )
+              if( x+dx >= 0 && x+dx < w ) join_blobs( sets, elems, offset[t], tl.bottom[x], offset[t+strips], tb.top[x+dx] );
+          if( s+1 < strips )
+            join_blobs( sets, elems, offset[t], tl.bottom.back(), offset[t+strips+1], tiles[t+strips+1].top.front() );
+          if( s > 0 )
+            join_blobs( sets, elems, offset[t], tl.bottom.front(), offset[t+strips-1], tiles[t+strips-1].top.back() );
+        }
+      }
+    }
+
+    // Merge the statistics of each set of joined blobs.
+    std::vector<int64> index( elems.size(), -1 );
+    for( size_t t=0; t<tiles.size(); ++t ) {
+      for( size_t b=0; b<tiles[t].blobs.size(); ++b ) {
+        size_t r = sets.find( elems[offset[t]+b] )->elem;
+        BlobStatistics const& blob = tiles[t].blobs[b];
+        if( index[r] < 0 ) {
+          index[r] = int64( result.size() );
+          result.push_back( blob );
+          continue;
+        }
+        BlobStatistics& merged = result[index[r]];
+        merged.area += blob.area;
+        merged.bbox.grow( blob.bbox );
+        if( blob_first_less( blob, merged ) ) merged.first = blob.first;
+      }
+    }
+    std::sort( result.begin(), result.end(), blob_first_less );
+    return result;
+  }
+
   // ******************************************************************
   // MeanFillTransparent
   // ******************************************************************
@@ -0,0 +1,63 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Image/AsyncRead.h>
+#include <vw/Core/ThreadPool.h>
+
+namespace vw {
+
+  class AsyncRead::ReadTask : public Task {
+    boost::shared_ptr<SrcImageResource> m_resource;
+    ImageBuffer m_buf;
+    BBox2i m_bbox;
+    boost::shared_ptr<Mutex> m_mutex;
+    std::string m_error;
+    bool m_failed;
+  public:
+    ReadTask( boost::shared_ptr<SrcImageResource> const& resource, ImageBuffer const& buf,
+              BBox2i const& bbox, boost::shared_ptr<Mutex> const& mutex )
+      : m_resource(resource), m_buf(buf), m_bbox(bbox), m_mutex(mutex), m_failed(false) {}
+
+    virtual void operator()() {
+      // A pool task must not throw, so the error is kept for wait().
+      try {
+        if( m_mutex ) {
+          Mutex::Lock lock( *m_mutex );
+          m_resource->read( m_buf, m_bbox );
+        }
+        else m_resource->read( m_buf, m_bbox );
+      }
+      catch( const std::exception& e ) {
+        m_error = e.what();
+        m_failed = true;
+      }
+    }
+
+    // Only meaningful once the task has finished.
+    bool failed() const { return m_failed; }
+    std::string const& error() const { return m_error; }
+  };
+
+} // namespace vw
+
+vw::AsyncRead::AsyncRead( boost::shared_ptr<SrcImageResource> const& resource,
+                          ImageBuffer const& buf, BBox2i const& bbox,
+                          boost::shared_ptr<Mutex> const& mutex )
+  : m_task( new ReadTask( resource, buf, bbox, mutex ) ) {
+  vw_io_thread_pool().add_task( m_task );
+}
+
+bool vw::AsyncRead::done() const {
+  return !m_task || m_task->is_finished();
+}
+
+void vw::AsyncRead::wait() const {
+  if( !m_task ) return;
+  m_task->join();
+  if( m_task->failed() )
+    vw_throw( IOErr() << "AsyncRead: " << m_task->error() );
+}
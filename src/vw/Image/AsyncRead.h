@@ -0,0 +1,53 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file AsyncRead.h
+///
+/// Reads of image resources that run in the background on
+/// vw_io_thread_pool(), so that the thread that will need the pixels
+/// can go on computing while they are read.
+///
+#ifndef __VW_IMAGE_ASYNCREAD_H__
+#define __VW_IMAGE_ASYNCREAD_H__
+
+#include <vw/Core/Thread.h>
+#include <vw/Image/ImageResource.h>
+
+#include <boost/shared_ptr.hpp>
+
+namespace vw {
+
+  /// A read of a region of a resource, submitted when the AsyncRead
+  /// is constructed and completed by wait().  Copies refer to the same
+  /// read.  The buffer must stay valid until the read is done, so a
+  /// read that was submitted must be waited for before its buffer is
+  /// freed.
+  class AsyncRead {
+    class ReadTask;
+    boost::shared_ptr<ReadTask> m_task;
+  public:
+    /// A read of nothing, which is already done.
+    AsyncRead() {}
+
+    /// Submits a read of the given region of the resource into the
+    /// buffer.  If a mutex is given, the read holds it, for resources
+    /// that can't be read from several threads at once.
+    AsyncRead( boost::shared_ptr<SrcImageResource> const& resource,
+               ImageBuffer const& buf, BBox2i const& bbox,
+               boost::shared_ptr<Mutex> const& mutex = boost::shared_ptr<Mutex>() );
+
+    /// Has the read finished, successfully or not?
+    bool done() const;
+
+    /// Waits for the read to finish.  Throws an IOErr with the
+    /// message of the error if the read failed.
+    void wait() const;
+  };
+
+} // namespace vw
+
+#endif // __VW_IMAGE_ASYNCREAD_H__
@@ -13,7 +13,14 @@
 /// processing threads.  You can then call the block processor,
 /// passing it an arbitrarily large bounding box.  It will chop that
 /// bounding box up into blocks and call the callback function on
-/// each block, spawning as many child threads as you request.
+/// each block, using as many threads as you request.
+///
+/// The threads are not created here: the blocks are processed by the
+/// calling thread together with tasks submitted to the process-wide
+/// vw_thread_pool().  Nested block processors (e.g. a BlockRasterizeView
+/// whose child is itself block-rasterized) therefore share one bounded
+/// set of threads instead of multiplying them, and no threads are
+/// created or joined per call.
 ///
 /// Strictly speaking, this doesn't need to be in the Image module.
 /// However, it was designed for large image processing, it depends
@@ -25,6 +32,7 @@
 
 #include <vw/Core/Settings.h>
 #include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Math/BBox.h>
 
 namespace vw {
@@ -120,6 +128,14 @@ namespace vw {
       Info &info;
     };
 
+    // Runs a BlockThread in the thread pool.
+    class BlockTask : public Task {
+      BlockThread m_block_thread;
+    public:
+      BlockTask( typename BlockThread::Info &info ) : m_block_thread( info ) {}
+      virtual void operator()() { m_block_thread(); }
+    };
+
     inline void operator()( BBox2i bbox ) const {
       typename BlockThread::Info info( m_func, bbox, m_block_size );
 
@@ -130,19 +146,29 @@ namespace vw {
         return bt();
       }
 
-      std::vector<boost::shared_ptr<BlockThread> > generators;
-      std::vector<boost::shared_ptr<Thread> > threads;
-
-      for( int i=0; i<m_num_threads; ++i ) {
-        boost::shared_ptr<BlockThread> generator( new BlockThread( info ) );
-        generators.push_back( generator );
-        boost::shared_ptr<Thread> thread( new Thread( generator ) );
-        threads.push_back( thread );
+      // The calling thread works on blocks too, so only the remaining
+      // share goes to the pool.  Tasks that only start after all the
+      // blocks have been claimed return immediately.
+      WorkStealingQueue& pool = vw_thread_pool();
+      std::vector<boost::shared_ptr<Task> > tasks;
+      for( int i=1; i<m_num_threads; ++i ) {
+        boost::shared_ptr<Task> task( new BlockTask( info ) );
+        tasks.push_back( task );
+        pool.add_task( task );
       }
 
-      for( int i=0; i<m_num_threads; ++i ) {
-        threads[i]->join();
+      // The tasks refer to info, so they must all be done before we
+      // leave this scope, even if a block throws.
+      try {
+        BlockThread bt( info );
+        bt();
+      } catch (...) {
+        for( size_t i=0; i<tasks.size(); ++i )
+          pool.wait( tasks[i] );
+        throw;
       }
+      for( size_t i=0; i<tasks.size(); ++i )
+        pool.wait( tasks[i] );
     }
 
   };
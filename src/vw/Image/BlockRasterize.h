@@ -18,6 +18,7 @@
 #define __VW_IMAGE_BLOCKRASTERIZE_H__
 
 #include <vw/Core/Cache.h>
+#include <vw/Core/Trace.h>
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/PixelAccessors.h>
 #include <vw/Image/Manipulation.h>
@@ -25,6 +26,52 @@
 
 namespace vw {
 
+  /// Picks the block size of a BlockRasterizeView that was not given
+  /// one, for an image of the given size whose pixels (over all planes)
+  /// take pixel_bytes each.  Blocks are kept to about 2MB.
+  ///
+  /// A child that is tiled (see NativeBlockSize) gets blocks made of
+  /// whole tiles, at least consumer_tile on a side, since reading part
+  /// of a tile costs as much as reading all of it.  A child stored in
+  /// full-width strips gets full-width blocks of whole strips.
+  /// Otherwise the block shape is chosen by the bytes that must be
+  /// generated to serve one consumer_tile x consumer_tile request:
+  /// full-width strips, as long as that costs no more than square
+  /// tiles (e.g. for narrow images), else square tiles.
+  inline Vector2i default_block_size( int32 cols, int32 rows, int32 pixel_bytes,
+                                      Vector2i const& native, int32 consumer_tile ) {
+    const int64 budget = 2*1024*1024; // 2 megabytes
+    if( consumer_tile < 1 ) consumer_tile = 1;
+
+    if( native.x() > 0 && native.y() > 0 && native.x() < cols ) {
+      Vector2i size( native.x() * std::max( 1, consumer_tile / native.x() ),
+                     native.y() * std::max( 1, consumer_tile / native.y() ) );
+      while( int64(size.x()) * size.y() * pixel_bytes > budget && size.x() > native.x() && size.y() > native.y() ) {
+        size.x() -= native.x();
+        size.y() -= native.y();
+      }
+      return Vector2i( std::min( size.x(), cols ), std::min( size.y(), rows ) );
+    }
+
+    int64 row_bytes = int64(cols) * pixel_bytes;
+    int32 strip_rows = int32( std::max( int64(1), std::min( int64(rows), budget / row_bytes ) ) );
+    if( native.x() >= cols && native.y() > 0 && native.y() < rows ) {
+      strip_rows = std::max( native.y(), strip_rows - strip_rows % native.y() );
+      return Vector2i( cols, std::min( strip_rows, rows ) );
+    }
+
+    int32 side = consumer_tile;
+    while( side > 1 && int64(side) * side * pixel_bytes > budget )
+      side /= 2;
+    int32 tile_rows = std::min( consumer_tile, rows ), tile_cols = std::min( consumer_tile, cols );
+    int64 strip_cost = int64( (tile_rows - 1) / strip_rows + 1 ) * strip_rows * row_bytes;
+    int64 square_cost = int64( (tile_rows - 1) / side + 1 ) * ( (tile_cols - 1) / side + 1 )
+                        * std::min( side, rows ) * std::min( side, cols ) * pixel_bytes;
+    if( strip_cost <= square_cost )
+      return Vector2i( cols, strip_rows );
+    return Vector2i( std::min( side, cols ), std::min( side, rows ) );
+  }
+
   /// A wrapper view that rasterizes its child in blocks.
   template <class ImageT>
   class BlockRasterizeView : public ImageViewBase<BlockRasterizeView<ImageT> > {
@@ -63,6 +110,8 @@ namespace vw {
       else return (*m_child)(x,y,p);
     }
 
+    Vector2i const& block_size() const { return m_block_size; }
+
     ImageT& child() { return *m_child; }
     ImageT const& child() const { return *m_child; }
 
@@ -73,11 +122,28 @@ namespace vw {
       return CropView<ImageView<pixel_type> >( buf, BBox2i(-bbox.min().x(),-bbox.min().y(),cols(),rows()) );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const {
-      RasterizeFunctor<DestT> rasterizer( *this, dest, bbox.min() );
+      RasterizeFunctor<DestT> rasterizer( *this, dest, bbox );
       BlockProcessor<RasterizeFunctor<DestT> > process( rasterizer, m_block_size, m_num_threads );
       process(bbox);
     }
 
+    /// Queues the generation of every cache block that intersects the
+    /// given region and is not already cached on vw_thread_pool(), or
+    /// on vw_io_thread_pool() if the child is IsIOBound, and returns
+    /// immediately.  Does nothing without a cache.  The cache must
+    /// outlive the queued tasks.
+    void prefetch( BBox2i bbox ) const {
+      if( ! m_cache_ptr ) return;
+      bbox.crop( BBox2i(0,0,cols(),rows()) );
+      if( bbox.empty() ) return;
+      for( int32 iy=bbox.min().y()/m_block_size.y(); iy<=(bbox.max().y()-1)/m_block_size.y(); ++iy ) {
+        for( int32 ix=bbox.min().x()/m_block_size.x(); ix<=(bbox.max().x()-1)/m_block_size.x(); ++ix ) {
+          if( block(ix,iy).needs_generation() )
+            queue_prefetch( block(ix,iy) );
+        }
+      }
+    }
+
   private:
     // These function objects are spawned to rasterize the child image.
     // One functor is created per child thread, and they are called
@@ -87,14 +153,17 @@ namespace vw {
     class RasterizeFunctor {
       BlockRasterizeView const& m_view;
       DestT const& m_dest;
+      BBox2i m_region;
       Vector2i m_offset;
     public:
-      RasterizeFunctor( BlockRasterizeView const& view, DestT const& dest, Vector2i const& offset )
-        : m_view(view), m_dest(dest), m_offset(offset) {}
+      RasterizeFunctor( BlockRasterizeView const& view, DestT const& dest, BBox2i const& region )
+        : m_view(view), m_dest(dest), m_region(region), m_offset(region.min()) {}
       void operator()( BBox2i const& bbox ) const {
 #if VW_DEBUG_LEVEL > 1
         VW_OUT(VerboseDebugMessage, "image") << "BlockRasterizeView::RasterizeFunctor( " << bbox << " )" << std::endl;
 #endif
+        ScopedTrace trace( "BlockRasterizeView::rasterize", typeid(ImageT).name(),
+                           uint64(bbox.width()) * bbox.height() * m_view.planes() * sizeof(pixel_type) );
         if( m_view.m_cache_ptr ) {
           int32 ix=bbox.min().x()/m_view.m_block_size.x(), iy=bbox.min().y()/m_view.m_block_size.y();
 #if VW_DEBUG_LEVEL > 1
@@ -103,6 +172,12 @@ namespace vw {
             vw_throw(LogicErr() << "BlockRasterizeView::RasterizeFunctor: bbox spans more than one cache block!");
           }
 #endif
+          // As with any valid() check, the block could still be
+          // evicted before it is used, so this is only a good guess.
+          if( trace.active() )
+            trace.set_cache( m_view.block(ix,iy).valid() ? TRACE_CACHE_HIT : TRACE_CACHE_MISS );
+          if( IsIOBound<ImageT>::value )
+            m_view.read_ahead( m_region, ix, iy );
           m_view.block(ix,iy)->rasterize( crop( m_dest, bbox-m_offset ), bbox-Vector2i(ix*m_view.m_block_size.x(),iy*m_view.m_block_size.y()) );
         }
         else m_view.child().rasterize( crop( m_dest, bbox-m_offset ), bbox );
@@ -128,23 +203,60 @@ namespace vw {
       }
 
       boost::shared_ptr<ImageView<pixel_type> > generate() const {
+        ScopedTrace trace( "BlockRasterizeView::generate", typeid(ImageT).name(), size() );
         boost::shared_ptr<ImageView<pixel_type> > ptr( new ImageView<pixel_type>( m_bbox.width(), m_bbox.height(), m_child->planes() ) );
         m_child->rasterize( *ptr, m_bbox );
         return ptr;
       }
     };
 
+    // Generates one cache block in the background.
+    class PrefetchTask : public Task {
+      Cache::Handle<BlockGenerator> m_handle;
+    public:
+      PrefetchTask( Cache::Handle<BlockGenerator> const& handle ) : m_handle( handle ) {}
+      virtual void operator()() {
+        // A pool task must not throw.  An error here will be met again
+        // when the block is actually read.
+        try {
+          if( m_handle.needs_generation() )
+            boost::shared_ptr<ImageView<pixel_type> > value = m_handle;
+        }
+        catch( const Exception& e ) {
+          VW_OUT(DebugMessage, "image") << "BlockRasterizeView: prefetch failed: " << e.what() << "\n";
+        }
+      }
+    };
+
+    void queue_prefetch( Cache::Handle<BlockGenerator> const& handle ) const {
+      boost::shared_ptr<Task> task( new PrefetchTask( handle ) );
+      if( IsIOBound<ImageT>::value ) vw_io_thread_pool().add_task( task );
+      else vw_thread_pool().add_task( task );
+    }
+
+    // Prefetches the block of the region that BlockProcessor will
+    // take io_queue_depth() blocks after the given one, so that its
+    // read overlaps with the work on the blocks before it.  The first
+    // block of the region prefetches all of the blocks up to that one.
+    void read_ahead( BBox2i const& region, int32 ix, int32 iy ) const {
+      int32 depth = vw_settings().io_queue_depth();
+      if( depth < 1 ) return;
+      int32 minix = region.min().x()/m_block_size.x(), miniy = region.min().y()/m_block_size.y();
+      int32 row = (region.max().x()-1)/m_block_size.x() - minix + 1;
+      int32 count = row * ( (region.max().y()-1)/m_block_size.y() - miniy + 1 );
+      int32 index = (ix-minix) + (iy-miniy)*row;
+      for( int32 i = ( index == 0 ? 1 : depth ); i <= depth && index+i < count; ++i ) {
+        Cache::Handle<BlockGenerator>& handle = block( minix + (index+i)%row, miniy + (index+i)/row );
+        if( handle.needs_generation() )
+          queue_prefetch( handle );
+      }
+    }
+
     void initialize() {
       if( m_block_size.x() <= 0 || m_block_size.y() <= 0 ) {
-        const int32 default_blocksize = 2*1024*1024; // 2 megabytes
-        // XXX Should the default block configuration be different for
-        // very wide images?  Either way we will guess wrong some of
-        // the time, so advanced users will have to know what they're
-        // doing in any case.
-        int32 block_rows = default_blocksize / (planes()*cols()*int32(sizeof(pixel_type)));
-        if( block_rows < 1 ) block_rows = 1;
-        else if( block_rows > rows() ) block_rows = rows();
-        m_block_size = Vector2i( cols(), block_rows );
+        m_block_size = default_block_size( cols(), rows(), planes()*int32(sizeof(pixel_type)),
+                                           NativeBlockSize<ImageT>::value( *m_child ),
+                                           vw_settings().default_tile_size() );
       }
       if( m_cache_ptr ) {
         m_table_width = (cols()-1) / m_block_size.x() + 1;
@@ -180,6 +292,28 @@ namespace vw {
     boost::shared_ptr<std::vector<Cache::Handle<BlockGenerator> > > m_block_table;
   };
 
+  template <class ImageT>
+  struct NativeBlockSize<BlockRasterizeView<ImageT> > {
+    static Vector2i value( BlockRasterizeView<ImageT> const& image ) {
+      return image.block_size();
+    }
+  };
+
+  template <class ImageT>
+  struct ImagePrefetch<BlockRasterizeView<ImageT> > {
+    static void prefetch( BlockRasterizeView<ImageT> const& image, BBox2i const& bbox ) {
+      image.prefetch( bbox );
+    }
+  };
+
+  template <class ImageT>
+  class SparseImageCheck<BlockRasterizeView<ImageT> > {
+    BlockRasterizeView<ImageT> m_view;
+  public:
+    SparseImageCheck( BlockRasterizeView<ImageT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const { return SparseImageCheck<ImageT>(m_view.child())( bbox ); }
+  };
+
   template <class ImageT>
   inline BlockRasterizeView<ImageT> block_rasterize( ImageViewBase<ImageT> const& image, Vector2i const& block_size, int num_threads = 0 ) {
     return BlockRasterizeView<ImageT>( image.impl(), block_size, num_threads );
@@ -0,0 +1,110 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Image/BlockWriteJournal.h>
+#include <vw/Core/Debugging.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Stopwatch.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+  // The journal is line-based, so the descriptions must fit on a line.
+  std::string one_line( std::string text ) {
+    for( size_t i = 0; i < text.size(); ++i )
+      if( text[i] == '\n' || text[i] == '\r' ) text[i] = ' ';
+    return text;
+  }
+}
+
+namespace vw {
+
+  // The file holds the parameters, then the job, then the index of
+  // each block written, one to a line.  A line left unfinished by a
+  // crash is ignored.
+  BlockWriteJournal::BlockWriteJournal( std::string const& filename, std::string const& parameters, double period )
+    : m_filename( filename ), m_parameters( one_line( parameters ) ), m_matched( false ),
+      m_period( period ), m_last_checkpoint( Stopwatch::microtime() )
+  {
+    std::ifstream file( filename.c_str() );
+    std::string parameters_line;
+    if( !std::getline( file, parameters_line ) || !std::getline( file, m_job ) || file.eof() )
+      return;
+    if( parameters_line != m_parameters ) {
+      VW_OUT(DebugMessage, "image") << "BlockWriteJournal: " << filename << " is for other parameters.\n";
+      return;
+    }
+    m_matched = true;
+    std::string line;
+    while( std::getline( file, line ) && !file.eof() ) {
+      char* end;
+      long index = std::strtol( line.c_str(), &end, 10 );
+      if( end != line.c_str() && *end == '\0' )
+        m_done.insert( int32(index) );
+    }
+  }
+
+  void BlockWriteJournal::start( std::string const& job ) {
+    Mutex::Lock lock( m_mutex );
+    if( !m_matched || one_line( job ) != m_job ) {
+      m_done.clear();
+      m_job = one_line( job );
+    }
+    m_matched = true;
+    m_pending.clear();
+
+    // Rewrite the file with just the blocks that still count.
+    m_file.close();
+    m_file.clear();
+    m_file.open( m_filename.c_str(), std::ios::out | std::ios::trunc );
+    if( !m_file )
+      vw_throw( IOErr() << "BlockWriteJournal: Failed to write " << m_filename << "." );
+    m_file << m_parameters << "\n" << m_job << "\n";
+    for( std::set<int32>::const_iterator i = m_done.begin(); i != m_done.end(); ++i )
+      m_file << *i << "\n";
+    m_file.flush();
+    m_last_checkpoint = Stopwatch::microtime();
+  }
+
+  // Checkpoint the resource, then record the blocks it made durable.
+  void BlockWriteJournal::commit_locked( DstImageResource& resource ) {
+    VW_ASSERT( m_file.is_open(), LogicErr() << "BlockWriteJournal: The journal was not started." );
+    resource.checkpoint();
+    for( size_t i = 0; i < m_pending.size(); ++i ) {
+      m_done.insert( m_pending[i] );
+      m_file << m_pending[i] << "\n";
+    }
+    m_file.flush();
+    if( !m_file )
+      vw_throw( IOErr() << "BlockWriteJournal: Failed to write " << m_filename << "." );
+    m_pending.clear();
+    m_last_checkpoint = Stopwatch::microtime();
+  }
+
+  void BlockWriteJournal::record( int32 index, DstImageResource& resource ) {
+    Mutex::Lock lock( m_mutex );
+    m_pending.push_back( index );
+    if( double( Stopwatch::microtime() - m_last_checkpoint ) >= m_period * 1e6 )
+      commit_locked( resource );
+  }
+
+  void BlockWriteJournal::checkpoint( DstImageResource& resource ) {
+    Mutex::Lock lock( m_mutex );
+    commit_locked( resource );
+  }
+
+  void BlockWriteJournal::clear() {
+    Mutex::Lock lock( m_mutex );
+    m_file.close();
+    std::remove( m_filename.c_str() );
+    m_done.clear();
+    m_pending.clear();
+    m_matched = false;
+  }
+
+} // namespace vw
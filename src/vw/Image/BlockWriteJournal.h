@@ -0,0 +1,87 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file BlockWriteJournal.h
+///
+/// A record, kept in a small text file beside the output, of the
+/// blocks a block_write_image() has written, so that a long job that
+/// is killed part way through can be run again and write only the
+/// blocks that are missing.
+///
+/// The journal only records a block once the resource has been
+/// checkpointed after writing it, so every block it lists is really
+/// in the output.  Checkpoints are taken at most once per period, so
+/// an interrupted job loses at most that much work.
+///
+#ifndef __VW_IMAGE_BLOCKWRITEJOURNAL_H__
+#define __VW_IMAGE_BLOCKWRITEJOURNAL_H__
+
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <vw/Core/Thread.h>
+#include <vw/Image/ImageResource.h>
+
+#include <boost/noncopyable.hpp>
+
+namespace vw {
+
+  class BlockWriteJournal : private boost::noncopyable {
+    std::string m_filename, m_parameters, m_job;
+    bool m_matched;
+    std::set<int32> m_done;
+    std::vector<int32> m_pending;
+    std::ofstream m_file;
+    double m_period;
+    uint64 m_last_checkpoint;
+    Mutex m_mutex;
+
+    void commit_locked( DstImageResource& resource );
+
+  public:
+    /// Reads the journal in the given file, if there is one.  The
+    /// parameters describe whatever else the pixels depend on, such
+    /// as the options of the job: a journal left with different
+    /// parameters is ignored.  The resource is checkpointed at most
+    /// once every period seconds.
+    BlockWriteJournal( std::string const& filename, std::string const& parameters = std::string(),
+                       double period = 60.0 );
+
+    std::string const& filename() const { return m_filename; }
+
+    /// Does the file hold blocks from an earlier run with the same
+    /// parameters?
+    bool has_progress() const { return m_matched && !m_done.empty(); }
+
+    /// Begins recording a job, which block_write_image() describes by
+    /// the image's size and type and its blocks.  The blocks already
+    /// recorded are kept if the job is the one they were written for,
+    /// and forgotten if not.
+    void start( std::string const& job );
+
+    /// Was the block with the given index written by an earlier run?
+    bool done( int32 index ) const { return m_done.count( index ) != 0; }
+    size_t num_done() const { return m_done.size(); }
+
+    /// Notes that a block has been written to the resource, which is
+    /// checkpointed and the block recorded once the period is up.
+    /// This may be called from several threads at once.
+    void record( int32 index, DstImageResource& resource );
+
+    /// Checkpoints the resource and records every block written so
+    /// far.
+    void checkpoint( DstImageResource& resource );
+
+    /// Removes the journal, once the image is complete.
+    void clear();
+  };
+
+} // namespace vw
+
+#endif // __VW_IMAGE_BLOCKWRITEJOURNAL_H__
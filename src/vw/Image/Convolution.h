@@ -21,6 +21,7 @@
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/PixelMask.h>
+#include <vw/Image/FastConvolution.h>
 
 namespace vw {
 
@@ -140,11 +141,20 @@ namespace vw {
       }
     }
 
+    ImageT const& child() const { return m_image; }
+    EdgeT const& edge() const { return m_edge; }
+
+    /// Returns the region of the edge-extended child image that the
+    /// given region of the view depends on.
+    BBox2i source_bbox( BBox2i const& bbox ) const {
+      int32 ci = (m_kernel.cols()-1-m_ci), cj = (m_kernel.rows()-1-m_cj);
+      return BBox2i( bbox.min().x() - ci, bbox.min().y() - cj,
+                     bbox.width() + (m_kernel.cols()-1), bbox.height() + (m_kernel.rows()-1) );
+    }
+
     typedef ConvolutionView<CropView<ImageView<typename ImageT::pixel_type> >, KernelT, NoEdgeExtension> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i bbox ) const {
-      int32 ci = (m_kernel.cols()-1-m_ci), cj = (m_kernel.rows()-1-m_cj);
-      BBox2i src_bbox( bbox.min().x() - ci, bbox.min().y() - cj,
-                       bbox.width() + (m_kernel.cols()-1), bbox.height() + (m_kernel.rows()-1) );
+      BBox2i src_bbox = source_bbox( bbox );
       ImageView<typename ImageT::pixel_type> src = edge_extend( m_image, src_bbox, m_edge );
       return prerasterize_type( crop( src, -src_bbox.min().x(), -src_bbox.min().y(), m_image.cols(), m_image.rows() ),
                                 m_kernel.child(), m_ci, m_cj, NoEdgeExtension() );
@@ -233,6 +243,26 @@ namespace vw {
       }
     }
 
+    ImageT const& child() const { return m_image; }
+    EdgeT const& edge() const { return m_edge; }
+
+    /// The x and y kernels, either of which may be empty, and the
+    /// positions of their origins.
+    std::vector<KernelT> const& i_kernel() const { return m_i_kernel; }
+    std::vector<KernelT> const& j_kernel() const { return m_j_kernel; }
+    size_t i_center() const { return m_ci; }
+    size_t j_center() const { return m_cj; }
+
+    /// Returns the region of the edge-extended child image that the
+    /// given region of the view depends on.
+    BBox2i source_bbox( BBox2i const& bbox ) const {
+      size_t ni = m_i_kernel.size(), nj = m_j_kernel.size();
+      BBox2i child_bbox = bbox;
+      child_bbox.min() -= Vector2i( int32(ni?(ni-m_ci-1):0), int32(nj?(nj-m_cj-1):0) );
+      child_bbox.max() += Vector2i( int32(ni?m_ci:0), int32(nj?m_cj:0) );
+      return child_bbox;
+    }
+
     /// \cond INTERNAL
 
     // The separable convolution view knows that it is fastest to
@@ -260,11 +290,12 @@ namespace vw {
       if( ni==0 && nj==0 ) {
         return edge_extend(m_image,m_edge).rasterize(dest,bbox);
       }
-      BBox2i child_bbox = bbox;
-      child_bbox.min() -= Vector2i( int32(ni?(ni-m_ci-1):0), int32(nj?(nj-m_cj-1):0) );
-      child_bbox.max() += Vector2i( int32(ni?m_ci:0), int32(nj?m_cj:0) );
+      BBox2i child_bbox = source_bbox( bbox );
       ImageView<typename ImageT::pixel_type> src_buf = edge_extend(m_image,child_bbox,m_edge);
-      if( ni>0 && nj>0 ) {
+      if( HasFastConvolution<pixel_type,KernelT>::value ) {
+        convolve_fast( src_buf, dest, typename HasFastConvolution<pixel_type,KernelT>::type() );
+      }
+      else if( ni>0 && nj>0 ) {
         ImageView<pixel_type> work( bbox.width(), child_bbox.height(), planes() );
         convolve_1d( src_buf, work, m_i_kernel );
         src_buf.reset(); // Free up some memory
@@ -278,6 +309,55 @@ namespace vw {
       }
     }
 
+    // The vectorized path works on contiguous buffers, so other
+    // destinations get a temporary one.
+    template <class DestT>
+    void convolve_fast( ImageView<pixel_type> const& src, DestT const& dest, true_type ) const {
+      ImageView<pixel_type> result( dest.cols(), dest.rows(), dest.planes() );
+      convolve_fast( src, result, true_type() );
+      result.rasterize( dest, BBox2i(0,0,dest.cols(),dest.rows()) );
+    }
+
+    // Both passes go through correlate_taps(), the vertical one with a
+    // tap stride of one row, so neither needs the transpose.  The
+    // intermediate image has the same pixel type as in convolve_1d(),
+    // so the results are the same.
+    void convolve_fast( ImageView<pixel_type> const& src, ImageView<pixel_type> const& dest, true_type ) const {
+      typedef typename CompoundChannelType<pixel_type>::type channel_type;
+      const ssize_t channels = CompoundNumChannels<pixel_type>::value;
+      const size_t ni = m_i_kernel.size(), nj = m_j_kernel.size();
+      const size_t row_size = size_t(dest.cols()) * channels;
+      std::vector<float> i_kernel( m_i_kernel.rbegin(), m_i_kernel.rend() );
+      std::vector<float> j_kernel( m_j_kernel.rbegin(), m_j_kernel.rend() );
+
+      ImageView<pixel_type> work;
+      channel_type const* vsrc = reinterpret_cast<channel_type const*>( src.data() );
+      if( ni>0 ) {
+        channel_type const* hsrc = vsrc;
+        channel_type* hdest;
+        if( nj>0 ) {
+          work.set_size( dest.cols(), src.rows(), src.planes() );
+          hdest = reinterpret_cast<channel_type*>( work.data() );
+          vsrc = hdest;
+        }
+        else hdest = reinterpret_cast<channel_type*>( dest.data() );
+        const size_t src_row_size = size_t(src.cols()) * channels;
+        for( int32 r=0; r<src.rows()*src.planes(); ++r )
+          correlate_taps( hsrc + r*src_row_size, channels, hdest + r*row_size, row_size, &i_kernel[0], ni );
+      }
+      if( nj>0 ) {
+        channel_type* vdest = reinterpret_cast<channel_type*>( dest.data() );
+        const int32 src_rows = dest.rows() + int32(nj) - 1;
+        for( int32 p=0; p<dest.planes(); ++p )
+          for( int32 y=0; y<dest.rows(); ++y )
+            correlate_taps( vsrc + (p*src_rows + y)*row_size, ssize_t(row_size),
+                            vdest + (p*dest.rows() + y)*row_size, row_size, &j_kernel[0], nj );
+      }
+    }
+
+    template <class DestT>
+    void convolve_fast( ImageView<pixel_type> const&, DestT const&, false_type ) const {}
+
     template <class SrcT, class DestT>
     void convolve_1d( SrcT const& src, DestT const& dest, std::vector<KernelT> const& kernel ) const {
       typedef typename SrcT::pixel_accessor SrcAccessT;
@@ -311,6 +391,32 @@ namespace vw {
     /// \endcond
   };
 
+  /// \cond INTERNAL
+  // A convolution is empty wherever the edge-extended child is empty
+  // over the whole support of the kernel.
+  template <class ImageT, class KernelT, class EdgeT>
+  class SparseImageCheck<ConvolutionView<ImageT,KernelT,EdgeT> > {
+    ConvolutionView<ImageT,KernelT,EdgeT> m_view;
+  public:
+    SparseImageCheck( ConvolutionView<ImageT,KernelT,EdgeT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      if( bbox.empty() ) return false;
+      return sparse_check( edge_extend( m_view.child(), m_view.edge() ), m_view.source_bbox( bbox ) );
+    }
+  };
+
+  template <class ImageT, class KernelT, class EdgeT>
+  class SparseImageCheck<SeparableConvolutionView<ImageT,KernelT,EdgeT> > {
+    SeparableConvolutionView<ImageT,KernelT,EdgeT> m_view;
+  public:
+    SparseImageCheck( SeparableConvolutionView<ImageT,KernelT,EdgeT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      if( bbox.empty() ) return false;
+      return sparse_check( edge_extend( m_view.child(), m_view.edge() ), m_view.source_bbox( bbox ) );
+    }
+  };
+  /// \endcond
+
 } // namespace vw
 
 #endif // __VW_IMAGE_CONVOLUTION_H__
@@ -29,6 +29,7 @@
 #include <boost/type_traits.hpp>
 
 #include <vw/Image/ImageViewBase.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/PixelAccessors.h>
 #include <vw/Image/SparseImageCheck.h>
 #include <vw/Core/Log.h>
@@ -362,6 +363,8 @@ namespace vw {
 
     ImageT const& child() const { return m_image; }
     ExtensionT const& func() const { return m_extension_func; }
+    /// The position in the child image of this view's origin.
+    Vector2i offset() const { return Vector2i( m_xoffset, m_yoffset ); }
     BBox2i source_bbox( BBox2i const& bbox ) const {
       return m_extension_func.source_bbox( m_image, bbox + Vector2i( m_xoffset, m_yoffset ) );
     }
@@ -374,12 +377,40 @@ namespace vw {
       VW_OUT(VerboseDebugMessage, "image") << "EdgeExtensionView: prerasterizing child view with bbox " << src_bbox << ".\n";
       return prerasterize_type(m_image.prerasterize(src_bbox), m_xoffset, m_yoffset, m_cols, m_rows, m_extension_func );
     }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    /// The part of the given region of this view that lies inside
+    /// the child image, where every edge extension mode simply
+    /// returns the child's pixels.
+    BBox2i interior( BBox2i const& bbox ) const {
+      BBox2i result = bbox;
+      result.crop( BBox2i( -m_xoffset, -m_yoffset, m_image.cols(), m_image.rows() ) );
+      return result;
+    }
+
+    // The interior of the region is rasterized by the child itself,
+    // and only the strips around it go through the edge extension
+    // mode, a pixel at a time.
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const {
+      BBox2i inner = interior( bbox );
+      if( inner.empty() ) {
+        vw::rasterize( prerasterize(bbox), dest, bbox );
+        return;
+      }
+      prerasterize_type src = prerasterize( bbox );
+      src.child().rasterize( crop( dest, inner - bbox.min() ), inner + offset() );
+      BBox2i strips[4] = {
+        BBox2i( bbox.min().x(), bbox.min().y(), bbox.width(), inner.min().y() - bbox.min().y() ),
+        BBox2i( bbox.min().x(), inner.max().y(), bbox.width(), bbox.max().y() - inner.max().y() ),
+        BBox2i( bbox.min().x(), inner.min().y(), inner.min().x() - bbox.min().x(), inner.height() ),
+        BBox2i( inner.max().x(), inner.min().y(), bbox.max().x() - inner.max().x(), inner.height() ) };
+      for( int32 i=0; i<4; ++i )
+        if( ! strips[i].empty() )
+          vw::rasterize( src, crop( dest, strips[i] - bbox.min() ), strips[i] );
+    }
   };
 
   template <class ImageT, class ExtensionT>
   class SparseImageCheck<EdgeExtensionView<ImageT, ExtensionT> > {
-    EdgeExtensionView<ImageT, ExtensionT> const& m_view;
+    EdgeExtensionView<ImageT, ExtensionT> m_view;
   public:
     SparseImageCheck(EdgeExtensionView<ImageT, ExtensionT> const& view)
       : m_view(view) {}
@@ -388,6 +419,21 @@ namespace vw {
     }
   };
 
+  // Outside its child, a view extended with a value has that value.
+  template <class ImageT, class PixelT>
+  class SparseImageCheck<EdgeExtensionView<ImageT, ValueEdgeExtension<PixelT> > > {
+    EdgeExtensionView<ImageT, ValueEdgeExtension<PixelT> > m_view;
+  public:
+    SparseImageCheck(EdgeExtensionView<ImageT, ValueEdgeExtension<PixelT> > const& view)
+      : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      if( bbox.empty() ) return false;
+      BBox2i child_bbox( 0, 0, m_view.child().cols(), m_view.child().rows() );
+      if( ! is_empty_pixel( m_view.func().m_pix ) && ! child_bbox.contains( bbox + m_view.offset() ) ) return true;
+      return SparseImageCheck<ImageT>(m_view.child())( m_view.source_bbox( bbox ) );
+    }
+  };
+
 
   // *******************************************************************
   // General-purpose edge extension functions
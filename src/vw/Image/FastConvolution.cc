@@ -0,0 +1,276 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Image/FastConvolution.h>
+
+#include <boost/integer_traits.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define VW_FAST_CONVOLUTION_SSE2 1
+#include <emmintrin.h>
+#include <cpuid.h>
+// Functions compiled for AVX with the target attribute need GCC 4.9
+#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define VW_FAST_CONVOLUTION_AVX 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace {
+
+  using vw::uint8;
+  using vw::uint16;
+
+  // The generic loop, also used for the tails of the vector loops.
+  template <class ChannelT>
+  inline ChannelT clamp_channel( float value ) {
+    if( value > float(boost::integer_traits<ChannelT>::max()) ) return boost::integer_traits<ChannelT>::max();
+    if( value < float(boost::integer_traits<ChannelT>::min()) ) return boost::integer_traits<ChannelT>::min();
+    return ChannelT( value );
+  }
+
+  template <>
+  inline float clamp_channel<float>( float value ) { return value; }
+
+  template <class ChannelT>
+  void correlate_scalar( ChannelT const* src, ssize_t tap_stride, ChannelT* dest, size_t begin, size_t end,
+                         float const* kernel, size_t kernel_size ) {
+    for( size_t i=begin; i<end; ++i ) {
+      float result = 0;
+      ChannelT const* s = src + i;
+      for( size_t k=0; k<kernel_size; ++k, s+=tap_stride )
+        result += kernel[k] * float(*s);
+      dest[i] = clamp_channel<ChannelT>( result );
+    }
+  }
+
+#if VW_FAST_CONVOLUTION_SSE2
+
+  // ---------------------------------------------------------------
+  // SSE2: 16 channel values per iteration
+  // ---------------------------------------------------------------
+
+  inline void load16( float const* s, __m128 v[4] ) {
+    v[0] = _mm_loadu_ps( s );
+    v[1] = _mm_loadu_ps( s+4 );
+    v[2] = _mm_loadu_ps( s+8 );
+    v[3] = _mm_loadu_ps( s+12 );
+  }
+
+  inline void load16( uint8 const* s, __m128 v[4] ) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i b = _mm_loadu_si128( (__m128i const*)s );
+    __m128i lo = _mm_unpacklo_epi8( b, zero ), hi = _mm_unpackhi_epi8( b, zero );
+    v[0] = _mm_cvtepi32_ps( _mm_unpacklo_epi16( lo, zero ) );
+    v[1] = _mm_cvtepi32_ps( _mm_unpackhi_epi16( lo, zero ) );
+    v[2] = _mm_cvtepi32_ps( _mm_unpacklo_epi16( hi, zero ) );
+    v[3] = _mm_cvtepi32_ps( _mm_unpackhi_epi16( hi, zero ) );
+  }
+
+  inline void load16( uint16 const* s, __m128 v[4] ) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i a = _mm_loadu_si128( (__m128i const*)s ), b = _mm_loadu_si128( (__m128i const*)(s+8) );
+    v[0] = _mm_cvtepi32_ps( _mm_unpacklo_epi16( a, zero ) );
+    v[1] = _mm_cvtepi32_ps( _mm_unpackhi_epi16( a, zero ) );
+    v[2] = _mm_cvtepi32_ps( _mm_unpacklo_epi16( b, zero ) );
+    v[3] = _mm_cvtepi32_ps( _mm_unpackhi_epi16( b, zero ) );
+  }
+
+  inline void store16( float* d, __m128 const v[4] ) {
+    _mm_storeu_ps( d, v[0] );
+    _mm_storeu_ps( d+4, v[1] );
+    _mm_storeu_ps( d+8, v[2] );
+    _mm_storeu_ps( d+12, v[3] );
+  }
+
+  // Clamped first, so the saturating packs below are exact and the
+  // conversion truncates just like the scalar cast.
+  inline __m128i clamp_truncate( __m128 v, float max ) {
+    v = _mm_min_ps( _mm_max_ps( v, _mm_setzero_ps() ), _mm_set1_ps( max ) );
+    return _mm_cvttps_epi32( v );
+  }
+
+  inline void store16( uint8* d, __m128 const v[4] ) {
+    __m128i lo = _mm_packs_epi32( clamp_truncate( v[0], 255 ), clamp_truncate( v[1], 255 ) );
+    __m128i hi = _mm_packs_epi32( clamp_truncate( v[2], 255 ), clamp_truncate( v[3], 255 ) );
+    _mm_storeu_si128( (__m128i*)d, _mm_packus_epi16( lo, hi ) );
+  }
+
+  // SSE2 has no unsigned 32-to-16 bit pack, so shift into the signed
+  // range, pack, and shift back.
+  inline __m128i pack_u16( __m128i a, __m128i b ) {
+    __m128i bias = _mm_set1_epi32( 32768 );
+    __m128i packed = _mm_packs_epi32( _mm_sub_epi32( a, bias ), _mm_sub_epi32( b, bias ) );
+    return _mm_xor_si128( packed, _mm_set1_epi16( short(0x8000) ) );
+  }
+
+  inline void store16( uint16* d, __m128 const v[4] ) {
+    _mm_storeu_si128( (__m128i*)d, pack_u16( clamp_truncate( v[0], 65535 ), clamp_truncate( v[1], 65535 ) ) );
+    _mm_storeu_si128( (__m128i*)(d+8), pack_u16( clamp_truncate( v[2], 65535 ), clamp_truncate( v[3], 65535 ) ) );
+  }
+
+  template <class ChannelT>
+  void correlate_sse2( ChannelT const* src, ssize_t tap_stride, ChannelT* dest, size_t n,
+                       float const* kernel, size_t kernel_size ) {
+    size_t i = 0;
+    for( ; i+16<=n; i+=16 ) {
+      __m128 acc[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+      ChannelT const* s = src + i;
+      for( size_t k=0; k<kernel_size; ++k, s+=tap_stride ) {
+        __m128 kv = _mm_set1_ps( kernel[k] ), v[4];
+        load16( s, v );
+        for( int j=0; j<4; ++j )
+          acc[j] = _mm_add_ps( acc[j], _mm_mul_ps( kv, v[j] ) );
+      }
+      store16( dest + i, acc );
+    }
+    correlate_scalar( src, tap_stride, dest, i, n, kernel, kernel_size );
+  }
+
+#if VW_FAST_CONVOLUTION_AVX
+
+  // ---------------------------------------------------------------
+  // AVX: 16 channel values per iteration, in two 8-wide registers.
+  // No FMA, so the rounding matches the scalar loop.
+  // ---------------------------------------------------------------
+
+#define VW_AVX __attribute__((target("avx")))
+
+  VW_AVX inline void load16_avx( float const* s, __m256 v[2] ) {
+    v[0] = _mm256_loadu_ps( s );
+    v[1] = _mm256_loadu_ps( s+8 );
+  }
+
+  VW_AVX inline void load16_avx( uint8 const* s, __m256 v[2] ) {
+    __m128i b = _mm_loadu_si128( (__m128i const*)s );
+    __m128i q0 = _mm_cvtepu8_epi32( b ), q1 = _mm_cvtepu8_epi32( _mm_srli_si128( b, 4 ) );
+    __m128i q2 = _mm_cvtepu8_epi32( _mm_srli_si128( b, 8 ) ), q3 = _mm_cvtepu8_epi32( _mm_srli_si128( b, 12 ) );
+    v[0] = _mm256_cvtepi32_ps( _mm256_insertf128_si256( _mm256_castsi128_si256( q0 ), q1, 1 ) );
+    v[1] = _mm256_cvtepi32_ps( _mm256_insertf128_si256( _mm256_castsi128_si256( q2 ), q3, 1 ) );
+  }
+
+  VW_AVX inline void load16_avx( uint16 const* s, __m256 v[2] ) {
+    __m128i a = _mm_loadu_si128( (__m128i const*)s ), b = _mm_loadu_si128( (__m128i const*)(s+8) );
+    __m128i q0 = _mm_cvtepu16_epi32( a ), q1 = _mm_cvtepu16_epi32( _mm_srli_si128( a, 8 ) );
+    __m128i q2 = _mm_cvtepu16_epi32( b ), q3 = _mm_cvtepu16_epi32( _mm_srli_si128( b, 8 ) );
+    v[0] = _mm256_cvtepi32_ps( _mm256_insertf128_si256( _mm256_castsi128_si256( q0 ), q1, 1 ) );
+    v[1] = _mm256_cvtepi32_ps( _mm256_insertf128_si256( _mm256_castsi128_si256( q2 ), q3, 1 ) );
+  }
+
+  VW_AVX inline void store16_avx( float* d, __m256 const v[2] ) {
+    _mm256_storeu_ps( d, v[0] );
+    _mm256_storeu_ps( d+8, v[1] );
+  }
+
+  VW_AVX inline __m256i clamp_truncate_avx( __m256 v, float max ) {
+    v = _mm256_min_ps( _mm256_max_ps( v, _mm256_setzero_ps() ), _mm256_set1_ps( max ) );
+    return _mm256_cvttps_epi32( v );
+  }
+
+  VW_AVX inline void store16_avx( uint8* d, __m256 const v[2] ) {
+    __m256i a = clamp_truncate_avx( v[0], 255 ), b = clamp_truncate_avx( v[1], 255 );
+    __m128i lo = _mm_packus_epi32( _mm256_castsi256_si128( a ), _mm256_extractf128_si256( a, 1 ) );
+    __m128i hi = _mm_packus_epi32( _mm256_castsi256_si128( b ), _mm256_extractf128_si256( b, 1 ) );
+    _mm_storeu_si128( (__m128i*)d, _mm_packus_epi16( lo, hi ) );
+  }
+
+  VW_AVX inline void store16_avx( uint16* d, __m256 const v[2] ) {
+    __m256i a = clamp_truncate_avx( v[0], 65535 ), b = clamp_truncate_avx( v[1], 65535 );
+    _mm_storeu_si128( (__m128i*)d, _mm_packus_epi32( _mm256_castsi256_si128( a ), _mm256_extractf128_si256( a, 1 ) ) );
+    _mm_storeu_si128( (__m128i*)(d+8), _mm_packus_epi32( _mm256_castsi256_si128( b ), _mm256_extractf128_si256( b, 1 ) ) );
+  }
+
+  template <class ChannelT>
+  VW_AVX void correlate_avx( ChannelT const* src, ssize_t tap_stride, ChannelT* dest, size_t n,
+                             float const* kernel, size_t kernel_size ) {
+    size_t i = 0;
+    for( ; i+16<=n; i+=16 ) {
+      __m256 acc[2] = { _mm256_setzero_ps(), _mm256_setzero_ps() };
+      ChannelT const* s = src + i;
+      for( size_t k=0; k<kernel_size; ++k, s+=tap_stride ) {
+        __m256 kv = _mm256_set1_ps( kernel[k] ), v[2];
+        load16_avx( s, v );
+        acc[0] = _mm256_add_ps( acc[0], _mm256_mul_ps( kv, v[0] ) );
+        acc[1] = _mm256_add_ps( acc[1], _mm256_mul_ps( kv, v[1] ) );
+      }
+      store16_avx( dest + i, acc );
+    }
+    correlate_scalar( src, tap_stride, dest, i, n, kernel, kernel_size );
+  }
+
+#undef VW_AVX
+
+  // AVX needs both the CPU and the OS, which must save the YMM
+  // registers on a context switch.
+  bool cpu_has_avx() {
+    unsigned eax, ebx, ecx, edx;
+    if( ! __get_cpuid( 1, &eax, &ebx, &ecx, &edx ) ) return false;
+    const unsigned osxsave = 1u << 27, avx = 1u << 28;
+    if( (ecx & (osxsave | avx)) != (osxsave | avx) ) return false;
+    unsigned xcr0_lo, xcr0_hi;
+    __asm__ volatile( "xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0) );
+    return (xcr0_lo & 6) == 6;
+  }
+
+#endif // VW_FAST_CONVOLUTION_AVX
+#endif // VW_FAST_CONVOLUTION_SSE2
+
+  enum Isa { ISA_NONE, ISA_SSE2, ISA_AVX };
+
+  Isa detect_isa() {
+#if VW_FAST_CONVOLUTION_AVX
+    if( cpu_has_avx() ) return ISA_AVX;
+#endif
+#if VW_FAST_CONVOLUTION_SSE2
+    return ISA_SSE2;
+#else
+    return ISA_NONE;
+#endif
+  }
+
+  // A function-local static is not thread-safe to initialize in C++03,
+  // but every thread computes the same value, so a race is harmless.
+  Isa isa() {
+    static Isa result = detect_isa();
+    return result;
+  }
+
+  template <class ChannelT>
+  inline void correlate( ChannelT const* src, ssize_t tap_stride, ChannelT* dest, size_t n,
+                         float const* kernel, size_t kernel_size ) {
+    switch( isa() ) {
+#if VW_FAST_CONVOLUTION_AVX
+    case ISA_AVX:  correlate_avx( src, tap_stride, dest, n, kernel, kernel_size ); return;
+#endif
+#if VW_FAST_CONVOLUTION_SSE2
+    case ISA_SSE2: correlate_sse2( src, tap_stride, dest, n, kernel, kernel_size ); return;
+#endif
+    default:       correlate_scalar( src, tap_stride, dest, 0, n, kernel, kernel_size ); return;
+    }
+  }
+
+} // namespace
+
+void vw::correlate_taps( float const* src, ssize_t tap_stride, float* dest, size_t n, float const* kernel, size_t kernel_size ) {
+  correlate( src, tap_stride, dest, n, kernel, kernel_size );
+}
+
+void vw::correlate_taps( uint8 const* src, ssize_t tap_stride, uint8* dest, size_t n, float const* kernel, size_t kernel_size ) {
+  correlate( src, tap_stride, dest, n, kernel, kernel_size );
+}
+
+void vw::correlate_taps( uint16 const* src, ssize_t tap_stride, uint16* dest, size_t n, float const* kernel, size_t kernel_size ) {
+  correlate( src, tap_stride, dest, n, kernel, kernel_size );
+}
+
+const char* vw::fast_convolution_isa() {
+  switch( isa() ) {
+  case ISA_AVX:  return "avx";
+  case ISA_SSE2: return "sse2";
+  default:       return "none";
+  }
+}
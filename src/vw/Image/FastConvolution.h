@@ -0,0 +1,56 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file FastConvolution.h
+///
+/// Vectorized inner loops for SeparableConvolutionView.
+///
+/// Both passes of a separable convolution over a contiguous buffer can
+/// be written as a one-dimensional correlation of a run of channel
+/// values with a fixed distance between taps: the number of channels
+/// for the horizontal pass, and the length of a row for the vertical
+/// one.  The correlate_taps() functions do this with SSE2 or AVX when
+/// the CPU has them, chosen at run time, and with a plain loop
+/// otherwise.  They sum the taps in the same order and precision as
+/// the generic loop in Convolution.h, and clamp and truncate integer
+/// results the same way, so both give the same answer.
+///
+/// Which pixel and kernel types take this path is decided at compile
+/// time by the HasFastConvolution trait.
+///
+#ifndef __VW_IMAGE_FASTCONVOLUTION_H__
+#define __VW_IMAGE_FASTCONVOLUTION_H__
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Image/PixelTypes.h>
+
+namespace vw {
+
+  /// Indicates whether SeparableConvolutionView can use the vectorized
+  /// correlate_taps() for the given pixel type and kernel type.
+  template <class PixelT, class KernelT>
+  struct HasFastConvolution : public false_type {};
+
+  template <> struct HasFastConvolution<float, float> : public true_type {};
+  template <> struct HasFastConvolution<uint8, float> : public true_type {};
+  template <> struct HasFastConvolution<uint16, float> : public true_type {};
+  template <class ChannelT> struct HasFastConvolution<PixelGray<ChannelT>, float> : public HasFastConvolution<ChannelT, float> {};
+  template <class ChannelT> struct HasFastConvolution<PixelRGB<ChannelT>, float> : public HasFastConvolution<ChannelT, float> {};
+
+  /// Sets dest[i] = sum over k of kernel[k] * src[i + k*tap_stride], for
+  /// i from 0 to n-1.
+  void correlate_taps( float const* src, ssize_t tap_stride, float* dest, size_t n, float const* kernel, size_t kernel_size );
+  void correlate_taps( uint8 const* src, ssize_t tap_stride, uint8* dest, size_t n, float const* kernel, size_t kernel_size );
+  void correlate_taps( uint16 const* src, ssize_t tap_stride, uint16* dest, size_t n, float const* kernel, size_t kernel_size );
+
+  /// The instruction set correlate_taps() uses on this machine: "avx",
+  /// "sse2" or "none".
+  const char* fast_convolution_isa();
+
+} // namespace vw
+
+#endif // __VW_IMAGE_FASTCONVOLUTION_H__
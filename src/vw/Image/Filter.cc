@@ -14,3 +14,21 @@
 #pragma warning(disable:4267)
 #pragma warning(disable:4996)
 #endif
+
+#include <cmath>
+
+#include <vw/Image/Filter.h>
+
+// q approximates the filter's scale parameter as a function of sigma;
+// below 2.5 the linear fit is replaced by the paper's square-root fit.
+void vw::generate_recursive_gaussian_coefficients( double coeffs[4], double sigma ) {
+  VW_ASSERT( sigma >= 0.5, ArgumentErr() << "generate_recursive_gaussian_coefficients: sigma must be at least 0.5." );
+  double q = ( sigma >= 2.5 ) ? 0.98711*sigma - 0.96330
+                              : 3.97156 - 4.14554*std::sqrt( 1 - 0.26891*sigma );
+  double q2 = q*q, q3 = q2*q;
+  double b0 = 1.57825 + 2.44413*q + 1.4281*q2 + 0.422205*q3;
+  coeffs[1] = ( 2.44413*q + 2.85619*q2 + 1.26661*q3 ) / b0;
+  coeffs[2] = -( 1.4281*q2 + 1.26661*q3 ) / b0;
+  coeffs[3] = 0.422205*q3 / b0;
+  coeffs[0] = 1 - ( coeffs[1] + coeffs[2] + coeffs[3] );
+}
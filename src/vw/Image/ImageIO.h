@@ -13,10 +13,16 @@
 #ifndef __VW_IMAGE_IMAGEIO_H__
 #define __VW_IMAGE_IMAGEIO_H__
 
+#include <algorithm>
+#include <sstream>
+
 #include <vw/Core/ProgressCallback.h>
 #include <vw/Core/ThreadPool.h>
+#include <vw/Core/Trace.h>
+#include <vw/Image/BlockWriteJournal.h>
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/SparseImageCheck.h>
 
 namespace vw {
 
@@ -131,37 +137,141 @@ namespace vw {
     }
   };
 
+  // Bounds the bytes of memory held by the blocks that have been
+  // admitted to a ThreadedBlockWriter but not yet written, as a
+  // CountingSemaphore bounds their number.  A block is always admitted
+  // when nothing is held, so a block larger than the limit still gets
+  // written.  A limit of 0 means no limit.
+  class MemorySemaphore {
+    Condition m_condition;
+    Mutex m_mutex;
+    uint64 m_max, m_held;
+
+  public:
+    MemorySemaphore( uint64 max ) : m_max(max), m_held(0) {}
+
+    // Waits until the given bytes can be held.
+    void wait( uint64 bytes ) {
+      Mutex::Lock lock(m_mutex);
+      while ( m_max && m_held && m_held + bytes > m_max ) {
+        m_condition.wait(lock);
+      }
+      m_held += bytes;
+    }
+
+    // Call when the given bytes are no longer held.
+    void notify( uint64 bytes ) {
+      {
+        Mutex::Lock lock(m_mutex);
+        m_held -= std::min( bytes, m_held );
+      }
+      m_condition.notify_all();
+    }
+
+    uint64 held() {
+      Mutex::Lock lock(m_mutex);
+      return m_held;
+    }
+  };
+
+  /// \cond INTERNAL
+  // The blocks the writers below cut an image into: the resource's own
+  // blocks, strips of rows for a resource that can take them one after
+  // another, or else the whole image at once.
+  inline Vector2i write_block_size( DstImageResource const& resource, int32 cols, int32 rows ) {
+    if (resource.has_block_write())
+      return resource.block_write_size();
+    if (resource.has_sequential_write())
+      return Vector2i(cols, std::max<int32>(1, vw_settings().default_tile_size()));
+    return Vector2i(cols, rows);
+  }
+
+  // A block of empty pixels, written in place of the blocks of a view
+  // that sparse_check() reports to be empty.
+  template <class PixelT>
+  ImageView<PixelT> empty_image_block( BBox2i const& bbox, int32 planes ) {
+    ImageView<PixelT> block( bbox.width(), bbox.height(), planes );
+    std::fill( block.data(), block.data() + size_t(block.cols())*block.rows()*block.planes(), PixelT() );
+    return block;
+  }
+  /// \endcond
+
   // This task generator manages the rasterizing and writing of images to disk.
   //
-  // Only one thread can be writing to the ImageResource at any given
-  // time, however several threads can be rasterizing simultaneously.
+  // Blocks go through a pipeline of up to three stages.  Several
+  // threads rasterize blocks at once.  If the resource can encode
+  // blocks apart from writing them (has_block_encode()), the same
+  // threads then encode them, so conversion and compression run in
+  // parallel too.  Finally the blocks are written one at a time, in
+  // order.  If the resource has_random_block_write(), each block is
+  // instead written as soon as it is ready, so a slow block holds up
+  // none of the others, and if it has_concurrent_write(), each block
+  // is written by the thread that rasterized it.
+  //
+  // Rasterization runs in the shared vw_thread_pool(), so blocks that
+  // are themselves block-rasterized do not add threads of their own.
+  // The blocks waiting to be written may hold at most write_pool_memory
+  // bytes, and number at most write_pool_size.  These limits are
+  // enforced when a block is added rather than inside the task, so
+  // pool threads never sit waiting on writes.
   //
   class ThreadedBlockWriter : private boost::noncopyable {
 
-    boost::shared_ptr<FifoWorkQueue> m_rasterize_work_queue;
+    std::vector<boost::shared_ptr<Task> > m_rasterize_tasks;
     boost::shared_ptr<OrderedWorkQueue> m_write_work_queue;
+    boost::shared_ptr<FifoWorkQueue> m_unordered_write_work_queue;
     CountingSemaphore m_write_queue_limit;
+    MemorySemaphore m_write_memory_limit;
+    BlockWriteJournal* m_journal;
 
-    // ----------------------------- TASK TYPES (2) --------------------------
+    // ----------------------------- TASK TYPES (3) --------------------------
 
     template <class PixelT>
     class WriteBlockTask : public Task {
+      ThreadedBlockWriter& m_parent;
       DstImageResource& m_resource;
       ImageView<PixelT> m_image_block;
       BBox2i m_bbox;
-      int m_idx;
-      CountingSemaphore& m_write_finish_event;
+      int m_idx, m_block;
+      uint64 m_bytes;
 
     public:
-      WriteBlockTask(DstImageResource& resource, ImageView<PixelT> const& image_block,
-                     BBox2i bbox, int idx, CountingSemaphore& write_finish_event) :
-      m_resource(resource), m_image_block(image_block), m_bbox(bbox), m_idx(idx), m_write_finish_event(write_finish_event) {}
+      WriteBlockTask(ThreadedBlockWriter& parent, DstImageResource& resource, ImageView<PixelT> const& image_block,
+                     BBox2i bbox, int idx, int block, uint64 bytes) :
+      m_parent(parent), m_resource(resource), m_image_block(image_block), m_bbox(bbox), m_idx(idx), m_block(block), m_bytes(bytes) {}
 
       virtual ~WriteBlockTask() {}
       virtual void operator() () {
         VW_OUT(DebugMessage, "image") << "Writing block " << m_idx << " at " << m_bbox << "\n";
+        ScopedTrace trace( "ThreadedBlockWriter::write", typeid(PixelT).name(),
+                           uint64(m_image_block.cols()) * m_image_block.rows() * m_image_block.planes() * sizeof(PixelT) );
         m_resource.write( m_image_block.buffer(), m_bbox );
-        m_write_finish_event.notify();
+        m_image_block.reset();
+        m_parent.block_written(m_resource, m_block, m_bytes);
+      }
+    };
+
+    // -----------------------------
+
+    class WriteEncodedBlockTask : public Task {
+      ThreadedBlockWriter& m_parent;
+      DstImageResource& m_resource;
+      boost::shared_ptr<EncodedBlock> m_block;
+      int m_idx, m_block_index;
+      uint64 m_bytes;
+
+    public:
+      WriteEncodedBlockTask(ThreadedBlockWriter& parent, DstImageResource& resource,
+                            boost::shared_ptr<EncodedBlock> const& block, int idx, int block_index, uint64 bytes) :
+      m_parent(parent), m_resource(resource), m_block(block), m_idx(idx), m_block_index(block_index), m_bytes(bytes) {}
+
+      virtual ~WriteEncodedBlockTask() {}
+      virtual void operator() () {
+        VW_OUT(DebugMessage, "image") << "Writing encoded block " << m_idx << " at " << m_block->bbox << "\n";
+        ScopedTrace trace( "ThreadedBlockWriter::write_encoded", 0, m_block->size() );
+        m_resource.write_encoded( *m_block );
+        m_block.reset();
+        m_parent.block_written(m_resource, m_block_index, m_bytes);
       }
     };
 
@@ -173,124 +283,245 @@ namespace vw {
       DstImageResource& m_resource;
       ViewT const& m_image;
       BBox2i m_bbox;
-      int m_index;
+      int m_index, m_block;
       int m_total_num_blocks;
+      uint64 m_bytes;
       SubProgressCallback m_progress_callback;
-      CountingSemaphore& m_write_finish_event;
 
     public:
       RasterizeBlockTask(ThreadedBlockWriter &parent, DstImageResource& resource,
                          ImageViewBase<ViewT> const& image, BBox2i const& bbox,
-                         int index, int total_num_blocks,
-                         CountingSemaphore& write_finish_event,
+                         int index, int block, int total_num_blocks, uint64 bytes,
                          const ProgressCallback &progress_callback = ProgressCallback::dummy_instance()) :
-      m_parent(parent), m_resource(resource), m_image(image.impl()), m_bbox(bbox), m_index(index),
-        m_progress_callback(progress_callback,0.0,1.0/float(total_num_blocks)), m_write_finish_event(write_finish_event) {}
+      m_parent(parent), m_resource(resource), m_image(image.impl()), m_bbox(bbox), m_index(index), m_block(block), m_bytes(bytes),
+        m_progress_callback(progress_callback,0.0,1.0/float(total_num_blocks)) {}
 
       virtual ~RasterizeBlockTask() {}
       virtual void operator()() {
-
-        m_write_finish_event.wait(m_index);
-
         VW_OUT(DebugMessage, "image") << "Rasterizing block " << m_index << " at " << m_bbox << "\n";
-        // Rasterize the block
-        ImageView<typename ViewT::pixel_type> image_block( crop(m_image, m_bbox) );
+        // Rasterize the block, unless the view knows it to be empty.
+        ImageView<typename ViewT::pixel_type> image_block;
+        if( ! sparse_check( m_image, m_bbox ) ) {
+          image_block = empty_image_block<typename ViewT::pixel_type>( m_bbox, m_image.planes() );
+        }
+        else {
+          ScopedTrace trace( "ThreadedBlockWriter::rasterize", typeid(ViewT).name(),
+                             uint64(m_bbox.width()) * m_bbox.height() * m_image.planes() * sizeof(typename ViewT::pixel_type) );
+          image_block = crop(m_image, m_bbox);
+        }
 
         // Report progress
         m_progress_callback.report_incremental_progress(1.0);
 
-        // With rasterization complete, we queue up a request to write this block to disk.
-        boost::shared_ptr<Task> write_task ( new WriteBlockTask<typename ViewT::pixel_type>( m_resource, image_block, m_bbox, m_index, m_write_finish_event ) );
+        // With rasterization complete, we write this block to disk
+        // here if the resource can take several writes at once.
+        if( m_resource.has_concurrent_write() ) {
+          WriteBlockTask<typename ViewT::pixel_type>( m_parent, m_resource, image_block, m_bbox, m_index, m_block, m_bytes )();
+          return;
+        }
+
+        // Otherwise we encode it here if the resource can, releasing
+        // the memory that encoding saves, and queue up a request to
+        // write it.
+        boost::shared_ptr<Task> write_task;
+        if( m_resource.has_block_encode() ) {
+          boost::shared_ptr<EncodedBlock> block;
+          {
+            ScopedTrace trace( "ThreadedBlockWriter::encode", typeid(typename ViewT::pixel_type).name(),
+                               uint64(image_block.cols()) * image_block.rows() * image_block.planes() * sizeof(typename ViewT::pixel_type) );
+            block = m_resource.encode( image_block.buffer(), m_bbox );
+          }
+          image_block.reset();
+          uint64 encoded = std::min<uint64>( block->size(), m_bytes );
+          m_parent.m_write_memory_limit.notify( m_bytes - encoded );
+          write_task.reset( new WriteEncodedBlockTask( m_parent, m_resource, block, m_index, m_block, encoded ) );
+        }
+        else {
+          write_task.reset( new WriteBlockTask<typename ViewT::pixel_type>( m_parent, m_resource, image_block, m_bbox, m_index, m_block, m_bytes ) );
+        }
 
-        m_parent.add_write_task(write_task, m_index);
+        m_parent.add_write_task(write_task, m_index, !m_resource.has_random_block_write());
       }
     };
 
     // -----------------------------
 
-    void add_write_task(boost::shared_ptr<Task> task, int index) { m_write_work_queue->add_task(task, index); }
-    void add_rasterize_task(boost::shared_ptr<Task> task) { m_rasterize_work_queue->add_task(task); }
+    void add_write_task(boost::shared_ptr<Task> task, int index, bool ordered) {
+      if (ordered)
+        m_write_work_queue->add_task(task, index);
+      else
+        m_unordered_write_work_queue->add_task(task);
+    }
+    void add_rasterize_task(boost::shared_ptr<Task> task) {
+      m_rasterize_tasks.push_back(task);
+      vw_thread_pool().add_task(task);
+    }
+    void block_written(DstImageResource& resource, int block, uint64 bytes) {
+      if (m_journal)
+        m_journal->record(block, resource);
+      m_write_memory_limit.notify(bytes);
+      m_write_queue_limit.notify();
+    }
 
   public:
-    ThreadedBlockWriter() : m_write_queue_limit(vw_settings().write_pool_size()) {
-      m_rasterize_work_queue = boost::shared_ptr<FifoWorkQueue>( new FifoWorkQueue() );
+    // Blocks are recorded in the journal, if one is given, as they are
+    // written.
+    ThreadedBlockWriter( BlockWriteJournal* journal = 0 ) :
+      m_write_queue_limit(vw_settings().write_pool_size()),
+      m_write_memory_limit(vw_settings().write_pool_memory()), m_journal(journal) {
       m_write_work_queue = boost::shared_ptr<OrderedWorkQueue>( new OrderedWorkQueue(1) );
+      m_unordered_write_work_queue = boost::shared_ptr<FifoWorkQueue>( new FifoWorkQueue(1) );
     }
 
     // Add a block to be rasterized.  You can optionally supply an
     // index, which will indicate the order in which this block should
-    // be written to disk.
+    // be written to disk.  Blocks until the block is allowed to get
+    // that far ahead of the writes, and until the blocks waiting to be
+    // written leave room for it in memory.  The indices must count up
+    // from zero, so when some blocks are skipped the journal is told
+    // the block's place in the whole image separately.
     template <class ViewT>
     void add_block(DstImageResource& resource, ImageViewBase<ViewT> const& image, BBox2i const& bbox, int index, int total_num_blocks,
-                   const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) {
-      boost::shared_ptr<Task> task( new RasterizeBlockTask<ViewT>(*this, resource, image, bbox, index, total_num_blocks, m_write_queue_limit, progress_callback) );
+                   const ProgressCallback &progress_callback = ProgressCallback::dummy_instance(), int block = -1 ) {
+      uint64 bytes = uint64(bbox.width()) * bbox.height() * image.impl().planes() * sizeof(typename ViewT::pixel_type);
+      m_write_queue_limit.wait(index);
+      m_write_memory_limit.wait(bytes);
+      boost::shared_ptr<Task> task( new RasterizeBlockTask<ViewT>(*this, resource, image, bbox, index, block < 0 ? index : block,
+                                                                  total_num_blocks, bytes, progress_callback) );
       this->add_rasterize_task(task);
     }
 
     void process_blocks() {
-      m_rasterize_work_queue->join_all();
+      for (size_t i = 0; i < m_rasterize_tasks.size(); ++i)
+        vw_thread_pool().wait(m_rasterize_tasks[i]);
+      m_rasterize_tasks.clear();
       m_write_work_queue->join_all();
+      m_unordered_write_work_queue->join_all();
     }
   };
 
 
-  template <class ImageT>
-  void block_write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
-                          const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) {
-
-    VW_ASSERT( image.impl().cols() != 0 && image.impl().rows() != 0 && image.impl().planes() != 0,
-               ArgumentErr() << "write_image: cannot write an empty image to a resource" );
-
-    // Set the progress meter to zero.
-    progress_callback.report_progress(0);
-    if (progress_callback.abort_requested())
-      vw_throw( Aborted() << "Aborted by ProgressCallback" );
-
-    const int32 rows = boost::numeric_cast<int32>(image.impl().rows());
-    const int32 cols = boost::numeric_cast<int32>(image.impl().cols());
-
-    // Write the image to disk in blocks.  We may need to revisit
-    // the order in which these blocks are rasterized, but for now
-    // it rasterizes blocks from left to right, then top to bottom.
-    Vector2i block_size(cols, rows);
-    if (resource.has_block_write())
-      block_size = resource.block_write_size();
-
-    size_t total_num_blocks = ((rows-1)/block_size.y()+1) * ((cols-1)/block_size.x()+1);
-    VW_OUT(DebugMessage,"image") << "block_write_image: writing " << total_num_blocks << " blocks.\n";
-
-    // Early out for easy case
-    if (total_num_blocks == 1) {
-      ImageView<typename ImageT::pixel_type> image_block = image.impl();
-      resource.write( image_block.buffer(), BBox2i(0,0,image_block.cols(),image_block.rows()) );
-    } else {
-      // Set up the threaded block writer object, which will manage rasterizing
-      // and writing images to disk one block (and one thread) at a time.
-      ThreadedBlockWriter block_writer;
-
-      for (int32 j = 0; j < rows; j+= block_size.y()) {
-        for (int32 i = 0; i < cols; i+= block_size.x()) {
-          VW_OUT(DebugMessage, "image") << "ImageIO scheduling block at [" << i << " " << j << "]/[" << rows << " " << cols << "] blocksize = " << block_size.x() << " x " <<  block_size.y() << "\n";
-
-          // Rasterize and save this image block
-          BBox2i current_bbox(Vector2i(i,j),
-                              Vector2i(std::min<int32>(i+block_size.x(),cols),
-                                       std::min<int32>(j+block_size.y(),rows)));
-
-          // Rasterize this image block by scheduling it with the block_writer.
-          int col_blocks = int( ceil(float(cols)/float(block_size.x())) );
-          int i_block_index = int(i/block_size.x());
-          int j_block_index = int(j/block_size.y());
-          int index = j_block_index*col_blocks+i_block_index;
+  /// \cond INTERNAL
+  namespace detail {
+    // Writes the image in blocks, skipping and recording blocks in the
+    // journal if there is one.
+    template <class ImageT>
+    void block_write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
+                            BlockWriteJournal* journal, const ProgressCallback &progress_callback ) {
+
+      VW_ASSERT( image.impl().cols() != 0 && image.impl().rows() != 0 && image.impl().planes() != 0,
+                 ArgumentErr() << "write_image: cannot write an empty image to a resource" );
+
+      // Set the progress meter to zero.
+      progress_callback.report_progress(0);
+      if (progress_callback.abort_requested())
+        vw_throw( Aborted() << "Aborted by ProgressCallback" );
+
+      const int32 rows = boost::numeric_cast<int32>(image.impl().rows());
+      const int32 cols = boost::numeric_cast<int32>(image.impl().cols());
+
+      // Write the image to disk in blocks.  We may need to revisit
+      // the order in which these blocks are rasterized, but for now
+      // it rasterizes blocks from left to right, then top to bottom.
+      Vector2i block_size = write_block_size(resource, cols, rows);
+
+      size_t total_num_blocks = ((rows-1)/block_size.y()+1) * ((cols-1)/block_size.x()+1);
+      VW_OUT(DebugMessage,"image") << "block_write_image: writing " << total_num_blocks << " blocks.\n";
+
+      // The blocks a journal holds only count for the same image cut
+      // into the same blocks.
+      if (journal) {
+        ImageFormat format = image.format();
+        std::ostringstream job;
+        job << format.cols << " " << format.rows << " " << format.planes << " "
+            << pixel_format_name(format.pixel_format) << " " << channel_type_name(format.channel_type) << " "
+            << block_size.x() << " " << block_size.y();
+        journal->start(job.str());
+        if (journal->num_done())
+          VW_OUT(InfoMessage,"image") << "block_write_image: resuming with " << journal->num_done() << " of "
+                                      << total_num_blocks << " blocks already written.\n";
+      }
 
-          block_writer.add_block(resource, image, current_bbox, index, total_num_blocks, progress_callback );
+      // Early out for easy case
+      if (total_num_blocks == 1) {
+        if (!journal || !journal->done(0)) {
+          BBox2i bbox(0,0,cols,rows);
+          ImageView<typename ImageT::pixel_type> image_block;
+          if (sparse_check(image.impl(), bbox))
+            image_block = image.impl();
+          else
+            image_block = empty_image_block<typename ImageT::pixel_type>(bbox, image.impl().planes());
+          resource.write( image_block.buffer(), BBox2i(0,0,image_block.cols(),image_block.rows()) );
+          if (journal) {
+            journal->record(0, resource);
+            journal->checkpoint(resource);
+          }
+        }
+      } else {
+        // Set up the threaded block writer object, which will manage rasterizing
+        // and writing images to disk one block (and one thread) at a time.
+        ThreadedBlockWriter block_writer(journal);
+        AtomicProgressCallback block_progress( progress_callback );
+        int col_blocks = int( ceil(float(cols)/float(block_size.x())) );
+        int scheduled = 0;
+
+        for (int32 j = 0; j < rows; j+= block_size.y()) {
+          // Let a cache-backed source start on the next row of blocks
+          // while this one is rasterized and written.
+          prefetch(image, BBox2i(0, j+block_size.y(), cols, block_size.y()));
+          for (int32 i = 0; i < cols; i+= block_size.x()) {
+            VW_OUT(DebugMessage, "image") << "ImageIO scheduling block at [" << i << " " << j << "]/[" << rows << " " << cols << "] blocksize = " << block_size.x() << " x " <<  block_size.y() << "\n";
+
+            // Rasterize and save this image block
+            BBox2i current_bbox(Vector2i(i,j),
+                                Vector2i(std::min<int32>(i+block_size.x(),cols),
+                                         std::min<int32>(j+block_size.y(),rows)));
+
+            // Rasterize this image block by scheduling it with the
+            // block_writer, unless an earlier run already wrote it.
+            int i_block_index = int(i/block_size.x());
+            int j_block_index = int(j/block_size.y());
+            int index = j_block_index*col_blocks+i_block_index;
+            if (journal && journal->done(index)) {
+              block_progress.report_incremental_progress(1.0/float(total_num_blocks));
+              continue;
+            }
+
+            block_writer.add_block(resource, image, current_bbox, scheduled++, total_num_blocks, block_progress, index );
+          }
         }
-      }
 
-      // Start the threaded block writer and wait for all tasks to finish.
-      block_writer.process_blocks();
+        // Start the threaded block writer and wait for all tasks to finish.
+        block_writer.process_blocks();
+        block_progress.flush();
+        if (journal)
+          journal->checkpoint(resource);
+      }
+      progress_callback.report_finished();
     }
-    progress_callback.report_finished();
+  }
+  /// \endcond
+
+  template <class ImageT>
+  void block_write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
+                          const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) {
+    detail::block_write_image( resource, image, 0, progress_callback );
+  }
+
+  /// Writes the image in blocks as above, recording each block in the
+  /// journal as it is written, and skipping the blocks the journal
+  /// says an interrupted earlier run of the same job already wrote.
+  /// The resource must be the file that run was writing, reopened for
+  /// writing, and must support checkpoints.  The journal is left in
+  /// place when the image is complete; clear() it once the resource
+  /// is flushed.
+  template <class ImageT>
+  void block_write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
+                          BlockWriteJournal& journal,
+                          const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) {
+    VW_ASSERT( resource.has_checkpoint(),
+               NoImplErr() << "block_write_image: the resource cannot be checkpointed, so its writes cannot be journaled." );
+    detail::block_write_image( resource, image, &journal, progress_callback );
   }
 
   template <class ImageT>
@@ -311,16 +542,19 @@ namespace vw {
     // Write the image to disk in blocks.  We may need to revisit
     // the order in which these blocks are rasterized, but for now
     // it rasterizes blocks from left to right, then top to bottom.
-    Vector2i block_size(cols, rows);
-    if (resource.has_block_write())
-      block_size = resource.block_write_size();
+    Vector2i block_size = write_block_size(resource, cols, rows);
 
     size_t total_num_blocks = ((rows-1)/block_size.y()+1) * ((cols-1)/block_size.x()+1);
     VW_OUT(DebugMessage,"image") << "write_image: writing " << total_num_blocks << " blocks.\n";
 
     // Early out for easy case
     if (total_num_blocks == 1) {
-      ImageView<typename ImageT::pixel_type> image_block = image.impl();
+      BBox2i bbox(0,0,cols,rows);
+      ImageView<typename ImageT::pixel_type> image_block;
+      if (sparse_check(image.impl(), bbox))
+        image_block = image.impl();
+      else
+        image_block = empty_image_block<typename ImageT::pixel_type>(bbox, image.impl().planes());
       resource.write( image_block.buffer(), BBox2i(0,0,image_block.cols(),image_block.rows()) );
     } else {
       for (int32 j = 0; j < rows; j+= block_size.y()) {
@@ -336,8 +570,12 @@ namespace vw {
           float processed_col_blocks = float(i/block_size.x());
           progress_callback.report_progress((processed_row_blocks + processed_col_blocks) / static_cast<float>(total_num_blocks));
 
-          // Rasterize this image block
-          ImageView<typename ImageT::pixel_type> image_block( crop(image.impl(), current_bbox) );
+          // Rasterize this image block, unless the view knows it to be empty
+          ImageView<typename ImageT::pixel_type> image_block;
+          if (sparse_check(image.impl(), current_bbox))
+            image_block = crop(image.impl(), current_bbox);
+          else
+            image_block = empty_image_block<typename ImageT::pixel_type>(current_bbox, image.impl().planes());
           ImageBuffer buf = image_block.buffer();
           resource.write( buf, current_bbox );
 
@@ -17,8 +17,10 @@
 #endif
 
 #include <map>
+#include <cstring>
 
 #include <boost/integer_traits.hpp>
+#include <boost/scoped_array.hpp>
 
 #include <vw/Core/Debugging.h>
 #include <vw/Image/PixelTypes.h>
@@ -43,9 +45,12 @@ void channel_convert_uint8_to_uint16( uint8* src, uint16* dest ) {
   *dest = uint16( *src ) * (65535/255);
 }
 
+// The product is formed in FloatType<DestT>, since float16 cannot
+// hold the larger integer maxima.
 template <class SrcT, class DestT>
 void channel_convert_int_to_float( SrcT* src, DestT* dest ) {
-  *dest = DestT(*src) * (DestT(1.0)/boost::integer_traits<SrcT>::const_max);
+  typedef typename FloatType<DestT>::type float_type;
+  *dest = DestT( float_type(*src) * (float_type(1.0)/boost::integer_traits<SrcT>::const_max) );
 }
 
 template <class SrcT, class DestT>
@@ -184,6 +189,118 @@ ChannelConvertMapEntry _conv_f64u64( &channel_convert_cast<double,uint64>, &chan
 ChannelConvertMapEntry _conv_f64f32( &channel_convert_cast<double,float>  );
 ChannelConvertMapEntry _conv_f64f64( &channel_convert_cast<double,double> );
 
+ChannelConvertMapEntry _conv_i8f16 ( &channel_convert_cast<int8,float16>, &channel_convert_int_to_float<int8,float16>   );
+ChannelConvertMapEntry _conv_u8f16 ( &channel_convert_cast<uint8,float16>, &channel_convert_int_to_float<uint8,float16>  );
+ChannelConvertMapEntry _conv_i16f16( &channel_convert_cast<int16,float16>, &channel_convert_int_to_float<int16,float16>  );
+ChannelConvertMapEntry _conv_u16f16( &channel_convert_cast<uint16,float16>, &channel_convert_int_to_float<uint16,float16> );
+ChannelConvertMapEntry _conv_i32f16( &channel_convert_cast<int32,float16>, &channel_convert_int_to_float<int32,float16>  );
+ChannelConvertMapEntry _conv_u32f16( &channel_convert_cast<uint32,float16>, &channel_convert_int_to_float<uint32,float16> );
+ChannelConvertMapEntry _conv_i64f16( &channel_convert_cast<int64,float16>, &channel_convert_int_to_float<int64,float16>  );
+ChannelConvertMapEntry _conv_u64f16( &channel_convert_cast<uint64,float16>, &channel_convert_int_to_float<uint64,float16> );
+ChannelConvertMapEntry _conv_f16i8 ( &channel_convert_cast<float16,int8>, &channel_convert_float_to_int<float16,int8>   );
+ChannelConvertMapEntry _conv_f16u8 ( &channel_convert_cast<float16,uint8>, &channel_convert_float_to_int<float16,uint8>  );
+ChannelConvertMapEntry _conv_f16i16( &channel_convert_cast<float16,int16>, &channel_convert_float_to_int<float16,int16>  );
+ChannelConvertMapEntry _conv_f16u16( &channel_convert_cast<float16,uint16>, &channel_convert_float_to_int<float16,uint16> );
+ChannelConvertMapEntry _conv_f16i32( &channel_convert_cast<float16,int32>, &channel_convert_float_to_int<float16,int32>  );
+ChannelConvertMapEntry _conv_f16u32( &channel_convert_cast<float16,uint32>, &channel_convert_float_to_int<float16,uint32> );
+ChannelConvertMapEntry _conv_f16i64( &channel_convert_cast<float16,int64>, &channel_convert_float_to_int<float16,int64>  );
+ChannelConvertMapEntry _conv_f16u64( &channel_convert_cast<float16,uint64>, &channel_convert_float_to_int<float16,uint64> );
+ChannelConvertMapEntry _conv_f16f16( &channel_convert_cast<float16,float16> );
+ChannelConvertMapEntry _conv_f16f32( &channel_convert_cast<float16,float>   );
+ChannelConvertMapEntry _conv_f16f64( &channel_convert_cast<float16,double>  );
+ChannelConvertMapEntry _conv_f32f16( &channel_convert_cast<float,float16>   );
+ChannelConvertMapEntry _conv_f64f16( &channel_convert_cast<double,float16>  );
+
+// Channel Convert Run:
+//   Converts a run of channels of the same pixel format at once.  The
+//   channel conversion is a template argument, so that the compiler
+//   can inline it and vectorize the loop.  These cover the channel
+//   types most images are stored and processed in.
+typedef void (*channel_convert_run_func)(void* src, void* dest, int32 len);
+
+template <class SrcT, class DestT, void (*FuncT)(SrcT*,DestT*)>
+void channel_convert_run( SrcT* src, DestT* dest, int32 len ) {
+  for( int32 i=0; i<len; ++i ) FuncT( src+i, dest+i );
+}
+
+std::map<std::pair<ChannelTypeEnum,ChannelTypeEnum>,channel_convert_run_func> *channel_convert_run_map = 0, *channel_convert_run_rescale_map = 0;
+
+template <class SrcT, class DstT, void (*FuncT)(SrcT*,DstT*), void (*RescaleFuncT)(SrcT*,DstT*)>
+class ChannelConvertRunMapEntry {
+public:
+  ChannelConvertRunMapEntry() {
+    if( !channel_convert_run_map )
+      channel_convert_run_map = new std::map<std::pair<ChannelTypeEnum,ChannelTypeEnum>,channel_convert_run_func>();
+    if( !channel_convert_run_rescale_map )
+      channel_convert_run_rescale_map = new std::map<std::pair<ChannelTypeEnum,ChannelTypeEnum>,channel_convert_run_func>();
+    std::pair<ChannelTypeEnum,ChannelTypeEnum> key( ChannelTypeID<SrcT>::value, ChannelTypeID<DstT>::value );
+    void (*func)(SrcT*,DstT*,int32) = &channel_convert_run<SrcT,DstT,FuncT>;
+    void (*rescale_func)(SrcT*,DstT*,int32) = &channel_convert_run<SrcT,DstT,RescaleFuncT>;
+    channel_convert_run_map->operator[]( key ) = (channel_convert_run_func)func;
+    channel_convert_run_rescale_map->operator[]( key ) = (channel_convert_run_func)rescale_func;
+  }
+};
+
+#define VW_CONVERT_RUN(name,SrcT,DstT,RescaleFunc) \
+  ChannelConvertRunMapEntry<SrcT,DstT,&channel_convert_cast<SrcT,DstT>,RescaleFunc> _run_##name
+
+VW_CONVERT_RUN( u8u8,   uint8,  uint8,  (&channel_convert_cast<uint8,uint8>) );
+VW_CONVERT_RUN( u8u16,  uint8,  uint16, &channel_convert_uint8_to_uint16 );
+VW_CONVERT_RUN( u8i16,  uint8,  int16,  (&channel_convert_cast<uint8,int16>) );
+VW_CONVERT_RUN( u8f32,  uint8,  float,  (&channel_convert_int_to_float<uint8,float>) );
+VW_CONVERT_RUN( u8f64,  uint8,  double, (&channel_convert_int_to_float<uint8,double>) );
+VW_CONVERT_RUN( u16u8,  uint16, uint8,  &channel_convert_uint16_to_uint8 );
+VW_CONVERT_RUN( u16u16, uint16, uint16, (&channel_convert_cast<uint16,uint16>) );
+VW_CONVERT_RUN( u16i16, uint16, int16,  (&channel_convert_cast<uint16,int16>) );
+VW_CONVERT_RUN( u16f32, uint16, float,  (&channel_convert_int_to_float<uint16,float>) );
+VW_CONVERT_RUN( u16f64, uint16, double, (&channel_convert_int_to_float<uint16,double>) );
+VW_CONVERT_RUN( i16u8,  int16,  uint8,  (&channel_convert_cast<int16,uint8>) );
+VW_CONVERT_RUN( i16u16, int16,  uint16, (&channel_convert_cast<int16,uint16>) );
+VW_CONVERT_RUN( i16i16, int16,  int16,  (&channel_convert_cast<int16,int16>) );
+VW_CONVERT_RUN( i16f32, int16,  float,  (&channel_convert_int_to_float<int16,float>) );
+VW_CONVERT_RUN( i16f64, int16,  double, (&channel_convert_int_to_float<int16,double>) );
+VW_CONVERT_RUN( f32u8,  float,  uint8,  (&channel_convert_float_to_int<float,uint8>) );
+VW_CONVERT_RUN( f32u16, float,  uint16, (&channel_convert_float_to_int<float,uint16>) );
+VW_CONVERT_RUN( f32i16, float,  int16,  (&channel_convert_float_to_int<float,int16>) );
+VW_CONVERT_RUN( f32f32, float,  float,  (&channel_convert_cast<float,float>) );
+VW_CONVERT_RUN( f32f64, float,  double, (&channel_convert_cast<float,double>) );
+VW_CONVERT_RUN( f64u8,  double, uint8,  (&channel_convert_float_to_int<double,uint8>) );
+VW_CONVERT_RUN( f64u16, double, uint16, (&channel_convert_float_to_int<double,uint16>) );
+VW_CONVERT_RUN( f64i16, double, int16,  (&channel_convert_float_to_int<double,int16>) );
+VW_CONVERT_RUN( f64f32, double, float,  (&channel_convert_cast<double,float>) );
+VW_CONVERT_RUN( f64f64, double, double, (&channel_convert_cast<double,double>) );
+
+VW_CONVERT_RUN( u8f16,  uint8,  float16, (&channel_convert_int_to_float<uint8,float16>) );
+VW_CONVERT_RUN( u16f16, uint16, float16, (&channel_convert_int_to_float<uint16,float16>) );
+VW_CONVERT_RUN( f16u8,  float16, uint8,  (&channel_convert_float_to_int<float16,uint8>) );
+VW_CONVERT_RUN( f16u16, float16, uint16, (&channel_convert_float_to_int<float16,uint16>) );
+VW_CONVERT_RUN( f16f16, float16, float16, (&channel_convert_cast<float16,float16>) );
+VW_CONVERT_RUN( f16f64, float16, double, (&channel_convert_cast<float16,double>) );
+VW_CONVERT_RUN( f64f16, double, float16, (&channel_convert_cast<double,float16>) );
+
+#undef VW_CONVERT_RUN
+
+// Half-precision runs to and from float32 use the bulk conversions,
+// which are vectorized by hand.  Rescaling is the identity for both.
+template <class SrcT, class DstT, void (*FuncT)(SrcT const*,DstT*,size_t)>
+void channel_convert_bulk_run( SrcT* src, DstT* dest, int32 len ) {
+  FuncT( src, dest, len );
+}
+
+template <class SrcT, class DstT, void (*FuncT)(SrcT const*,DstT*,size_t)>
+class ChannelConvertBulkRunMapEntry {
+public:
+  ChannelConvertBulkRunMapEntry() {
+    std::pair<ChannelTypeEnum,ChannelTypeEnum> key( ChannelTypeID<SrcT>::value, ChannelTypeID<DstT>::value );
+    void (*func)(SrcT*,DstT*,int32) = &channel_convert_bulk_run<SrcT,DstT,FuncT>;
+    channel_convert_run_map->operator[]( key ) = (channel_convert_run_func)func;
+    channel_convert_run_rescale_map->operator[]( key ) = (channel_convert_run_func)func;
+  }
+};
+
+ChannelConvertBulkRunMapEntry<float16,float32,&float16_to_float32> _run_f16f32;
+ChannelConvertBulkRunMapEntry<float32,float16,&float32_to_float16> _run_f32f16;
+
 // Channel Set Max:
 //   Assigns a channel the maximum value
 typedef void (*channel_set_max_func)(void* dest);
@@ -219,6 +336,7 @@ ChannelSetMaxMapEntry _setmax_i32( &channel_set_max_int<int32> );
 ChannelSetMaxMapEntry _setmax_u32( &channel_set_max_int<uint32> );
 ChannelSetMaxMapEntry _setmax_i64( &channel_set_max_int<int64> );
 ChannelSetMaxMapEntry _setmax_u64( &channel_set_max_int<uint64> );
+ChannelSetMaxMapEntry _setmax_f16( &channel_set_max_float<float16> );
 ChannelSetMaxMapEntry _setmax_f32( &channel_set_max_float<float> );
 ChannelSetMaxMapEntry _setmax_f64( &channel_set_max_float<double> );
 
@@ -254,6 +372,7 @@ ChannelAverageMapEntry _average_i32( &channel_average<int32> );
 ChannelAverageMapEntry _average_u32( &channel_average<uint32> );
 ChannelAverageMapEntry _average_i64( &channel_average<int64> );
 ChannelAverageMapEntry _average_u64( &channel_average<uint64> );
+ChannelAverageMapEntry _average_f16( &channel_average<float16> );
 ChannelAverageMapEntry _average_f32( &channel_average<float> );
 ChannelAverageMapEntry _average_f64( &channel_average<double> );
 
@@ -296,6 +415,7 @@ ChannelPremultiplyMapEntry _premultiply_i32( &channel_premultiply_int<int32> );
 ChannelPremultiplyMapEntry _premultiply_u32( &channel_premultiply_int<uint32> );
 ChannelPremultiplyMapEntry _premultiply_i64( &channel_premultiply_int<int64> );
 ChannelPremultiplyMapEntry _premultiply_u64( &channel_premultiply_int<uint64> );
+ChannelPremultiplyMapEntry _premultiply_f16( &channel_premultiply_float<float16> );
 ChannelPremultiplyMapEntry _premultiply_f32( &channel_premultiply_float<float> );
 ChannelPremultiplyMapEntry _premultiply_f64( &channel_premultiply_float<double> );
 
@@ -338,13 +458,105 @@ ChannelUnpremultiplyMapEntry _unpremultiply_i32( &channel_unpremultiply_int<int3
 ChannelUnpremultiplyMapEntry _unpremultiply_u32( &channel_unpremultiply_int<uint32> );
 ChannelUnpremultiplyMapEntry _unpremultiply_i64( &channel_unpremultiply_int<int64> );
 ChannelUnpremultiplyMapEntry _unpremultiply_u64( &channel_unpremultiply_int<uint64> );
+ChannelUnpremultiplyMapEntry _unpremultiply_f16( &channel_unpremultiply_float<float16> );
 ChannelUnpremultiplyMapEntry _unpremultiply_f32( &channel_unpremultiply_float<float> );
 ChannelUnpremultiplyMapEntry _unpremultiply_f64( &channel_unpremultiply_float<double> );
 
+// Nodata Test:
+//   Does every one of a number of channels equal the nodata value?
+template <class SrcT>
+bool channels_are_nodata( uint8 const* src, int32 len, double nodata ) {
+  for( int32 i=0; i<len; ++i ) {
+    double value = double( ((SrcT const*)src)[i] );
+    if( !( value == nodata || ( value != value && nodata != nodata ) ) )
+      return false;
+  }
+  return true;
+}
+
+typedef bool (*channels_are_nodata_func)( uint8 const* src, int32 len, double nodata );
+
+static channels_are_nodata_func channels_are_nodata_for( ChannelTypeEnum type ) {
+  switch( type ) {
+  case VW_CHANNEL_INT8:    return &channels_are_nodata<int8>;
+  case VW_CHANNEL_UINT8:   return &channels_are_nodata<uint8>;
+  case VW_CHANNEL_INT16:   return &channels_are_nodata<int16>;
+  case VW_CHANNEL_UINT16:  return &channels_are_nodata<uint16>;
+  case VW_CHANNEL_INT32:   return &channels_are_nodata<int32>;
+  case VW_CHANNEL_UINT32:  return &channels_are_nodata<uint32>;
+  case VW_CHANNEL_INT64:   return &channels_are_nodata<int64>;
+  case VW_CHANNEL_UINT64:  return &channels_are_nodata<uint64>;
+  case VW_CHANNEL_FLOAT16: return &channels_are_nodata<float16>;
+  case VW_CHANNEL_FLOAT32: return &channels_are_nodata<float32>;
+  case VW_CHANNEL_FLOAT64: return &channels_are_nodata<float64>;
+  default:
+    vw_throw( NoImplErr() << "Unsupported channel type for a nodata test (" << type << ")!" );
+  }
+}
+
+// Can masked destination pixels be filled from these source pixels,
+// which lack only the valid channel?
+static bool converts_to_masked( ImageBuffer const& dst, ImageBuffer const& src ) {
+  return is_masked_format( dst.format.pixel_format ) && !is_masked_format( src.format.pixel_format )
+    && num_channels_nothrow( src.format.pixel_format ) + 1 == num_channels_nothrow( dst.format.pixel_format );
+}
+
+// Fills masked destination pixels: the values as convert() would,
+// and then the valid channel, from the nodata value if there is one.
+static void convert_to_masked( ImageBuffer const& dst, ImageBuffer const& src, double const* nodata, bool rescale ) {
+  ImageBuffer values = dst;
+  values.format.pixel_format = src.format.pixel_format;
+  convert( values, src, rescale );
+
+  int32 src_channels = num_channels( src.format.pixel_format );
+  size_t dst_chstride = channel_size( dst.format.channel_type );
+  size_t valid_offset = src_channels * dst_chstride;
+  channel_set_max_func max_func = channel_set_max_map->operator[]( dst.format.channel_type );
+  if( !max_func )
+    vw_throw( NoImplErr() << "Unsupported channel type in convert (" << dst.format.channel_type << ")!" );
+  channels_are_nodata_func nodata_func = nodata ? channels_are_nodata_for( src.format.channel_type ) : 0;
+
+  uint8 *src_ptr_p = (uint8*)src.data;
+  uint8 *dst_ptr_p = (uint8*)dst.data;
+  for( uint32 p=0; p<src.format.planes; ++p ) {
+    uint8 *src_ptr_r = src_ptr_p;
+    uint8 *dst_ptr_r = dst_ptr_p;
+    for( uint32 r=0; r<src.format.rows; ++r ) {
+      uint8 *src_ptr_c = src_ptr_r;
+      uint8 *dst_ptr_c = dst_ptr_r + valid_offset;
+      for( uint32 c=0; c<src.format.cols; ++c ) {
+        if( nodata_func && nodata_func( src_ptr_c, src_channels, *nodata ) )
+          memset( dst_ptr_c, 0, dst_chstride );
+        else
+          max_func( dst_ptr_c );
+        src_ptr_c += src.cstride;
+        dst_ptr_c += dst.cstride;
+      }
+      src_ptr_r += src.rstride;
+      dst_ptr_r += dst.rstride;
+    }
+    src_ptr_p += src.pstride;
+    dst_ptr_p += dst.pstride;
+  }
+}
+
+void vw::convert_nodata( ImageBuffer const& dst, ImageBuffer const& src, double nodata, bool rescale ) {
+  VW_ASSERT( dst.format.cols==src.format.cols && dst.format.rows==src.format.rows,
+             ArgumentErr() << "Destination buffer has wrong size." );
+  if( converts_to_masked( dst, src ) )
+    convert_to_masked( dst, src, &nodata, rescale );
+  else
+    convert( dst, src, rescale );
+}
+
 void vw::convert( ImageBuffer const& dst, ImageBuffer const& src, bool rescale ) {
   VW_ASSERT( dst.format.cols==src.format.cols && dst.format.rows==src.format.rows,
              ArgumentErr() << "Destination buffer has wrong size." );
 
+  // Masked pixels filled from pixels without the mask are all valid.
+  if( converts_to_masked( dst, src ) )
+    return convert_to_masked( dst, src, 0, rescale );
+
   // We only support a few special conversions, and the general case where
   // the source and destination formats are the same.  Below we assume that
   // we're doing a supported conversion, so we check first.
@@ -432,6 +644,48 @@ void vw::convert( ImageBuffer const& dst, ImageBuffer const& src, bool rescale )
   if( !conv_func || !max_func || !avg_func || !unpremultiply_src_func || !premultiply_dst_func || !premultiply_src_func )
     vw_throw( NoImplErr() << "Unsupported channel type combination in convert (" << src.format.channel_type << ", " << dst.format.channel_type << ")!" );
 
+  // Conversions that keep the channels as they are go a run of
+  // channels at a time, a whole row at once where the pixels of a row
+  // are packed together in both buffers.
+  if( src_channels == dst_channels && !unpremultiply_src && !premultiply_src && !premultiply_dst ) {
+    std::map<std::pair<ChannelTypeEnum,ChannelTypeEnum>,channel_convert_run_func>& run_map =
+      rescale ? *channel_convert_run_rescale_map : *channel_convert_run_map;
+    std::map<std::pair<ChannelTypeEnum,ChannelTypeEnum>,channel_convert_run_func>::const_iterator run =
+      run_map.find( std::make_pair(src.format.channel_type,dst.format.channel_type) );
+    if( run != run_map.end() ) {
+      channel_convert_run_func run_func = run->second;
+      bool packed = src.cstride == ssize_t(src_channels*src_chstride) && dst.cstride == ssize_t(dst_channels*dst_chstride);
+      bool copy = packed && src.format.channel_type == dst.format.channel_type;
+      int32 row_length = int32(src.format.cols * src_channels);
+      uint8 *src_ptr_p = (uint8*)src.data;
+      uint8 *dst_ptr_p = (uint8*)dst.data;
+      for( uint32 p=0; p<src.format.planes; ++p ) {
+        uint8 *src_ptr_r = src_ptr_p;
+        uint8 *dst_ptr_r = dst_ptr_p;
+        for( uint32 r=0; r<src.format.rows; ++r ) {
+          if( copy )
+            memcpy( dst_ptr_r, src_ptr_r, row_length*src_chstride );
+          else if( packed )
+            run_func( src_ptr_r, dst_ptr_r, row_length );
+          else {
+            uint8 *src_ptr_c = src_ptr_r;
+            uint8 *dst_ptr_c = dst_ptr_r;
+            for( uint32 c=0; c<src.format.cols; ++c ) {
+              run_func( src_ptr_c, dst_ptr_c, int32(src_channels) );
+              src_ptr_c += src.cstride;
+              dst_ptr_c += dst.cstride;
+            }
+          }
+          src_ptr_r += src.rstride;
+          dst_ptr_r += dst.rstride;
+        }
+        src_ptr_p += src.pstride;
+        dst_ptr_p += dst.pstride;
+      }
+      return;
+    }
+  }
+
   int32 max_channels = std::max( src_channels, dst_channels );
 
   boost::scoped_array<uint8> src_buf(new uint8[max_channels*src_chstride]);
@@ -527,6 +781,39 @@ ImageFormat SrcImageResource::format() const {
   return fmt;
 }
 
+void SrcImageResource::read_reduced( ImageBuffer const& buf, BBox2i const& bbox, int32 level ) const {
+  VW_ASSERT( level >= 0 && level < 31, ArgumentErr() << "SrcImageResource::read_reduced(): invalid level " << level << "." );
+  if( level == 0 ) {
+    this->read( buf, bbox );
+    return;
+  }
+
+  // Read just the full-resolution pixels that span the samples, or
+  // the whole image if the resource can't read part of it, and then
+  // stride over them.
+  int32 factor = 1 << level;
+  BBox2i span( bbox.min().x() * factor, bbox.min().y() * factor,
+               (bbox.width()-1) * factor + 1, (bbox.height()-1) * factor + 1 );
+  VW_ASSERT( bbox.min().x() >= 0 && bbox.min().y() >= 0 &&
+             span.max().x() <= cols() && span.max().y() <= rows(),
+             ArgumentErr() << "SrcImageResource::read_reduced(): bbox exceeds the reduced image." );
+  BBox2i full = has_block_read() ? span : BBox2i( 0, 0, cols(), rows() );
+
+  ImageFormat fmt = format();
+  fmt.cols = full.width();
+  fmt.rows = full.height();
+  boost::scoped_array<uint8> data( new uint8[fmt.byte_size()] );
+  ImageBuffer src( fmt, data.get() );
+  this->read( src, full );
+
+  src = src.cropped( span - full.min() );
+  src.format.cols = bbox.width();
+  src.format.rows = bbox.height();
+  src.cstride *= factor;
+  src.rstride *= factor;
+  convert( buf, src );
+}
+
 boost::shared_array<const uint8> SrcImageResource::native_ptr() const {
   boost::shared_array<const uint8> data(new uint8[native_size()]);
   this->read(ImageBuffer(format(), const_cast<uint8*>(data.get())), BBox2i(0,0,cols(),rows()));
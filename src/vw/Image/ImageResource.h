@@ -17,6 +17,9 @@
 
 #include <vw/Image/PixelTypeInfo.h>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/shared_array.hpp>
+
 namespace vw {
 
   // Forward declaration
@@ -25,8 +28,16 @@ namespace vw {
 
   /// Copies image pixel data from the source buffer to the destination
   /// buffer, converting the pixel format and channel type as required.
+  /// Masked (PixelMask) destination pixels may be filled from source
+  /// pixels without the mask, which are then all valid.
   void convert( ImageBuffer const& dst, ImageBuffer const& src, bool rescale=false );
 
+  /// Copies as convert() does, except that when masked destination
+  /// pixels are filled from source pixels without the mask, the source
+  /// pixels whose channels all equal nodata become invalid.  This lets
+  /// a resource with a nodata value fill a masked view in one pass.
+  void convert_nodata( ImageBuffer const& dst, ImageBuffer const& src, double nodata, bool rescale=false );
+
 
   /// Describes the format of an image, i.e. its dimensions, pixel
   /// structure, and channel type.
@@ -105,6 +116,22 @@ namespace vw {
       /// Returns the preferred block size/alignment for partial reads.
       virtual Vector2i block_read_size() const { return Vector2i(cols(),rows()); }
 
+      /// Can read() be called from several threads at once?  Views of
+      /// the resource only serialize their reads when it can't.
+      virtual bool has_concurrent_read() const { return false; }
+
+      /// Returns the number of reduced-resolution levels (overviews)
+      /// the resource stores alongside the full image.  Level N is
+      /// the image reduced by 2^N in each direction, rounded up.
+      virtual int32 overview_levels() const { return 0; }
+
+      /// Read a region of the image reduced by 2^level in each
+      /// direction into the given buffer.  The bbox is in the pixels
+      /// of the reduced image.  Resources with overviews read them
+      /// where they can; the default reads the full image and keeps
+      /// every 2^level-th pixel.
+      virtual void read_reduced( ImageBuffer const& buf, BBox2i const& bbox, int32 level ) const;
+
       // Does this resource have a nodata value?
       // If you override this to true, you must implement the other nodata_read functions
       virtual bool has_nodata_read() const = 0;
@@ -114,6 +141,12 @@ namespace vw {
         vw_throw(NoImplErr() << "This ImageResource does not support nodata_read().");
       }
 
+      /// Does the resource know, without reading any pixels, that every
+      /// pixel of the region is nodata?  Masked views of the resource
+      /// report such regions as empty to sparse_check(), so that the
+      /// consumers of the view can skip them.
+      virtual bool all_nodata( BBox2i const& /*bbox*/ ) const { return false; }
+
       /// Return a pointer to the data in the same format as format(). This
       /// might cause a copy, depending on implementation. The shared_ptr will
       /// handle cleanup.
@@ -121,6 +154,20 @@ namespace vw {
       virtual size_t native_size() const;
   };
 
+  /// A block that a resource has encoded (converted to the native
+  /// format, and perhaps compressed) but not yet written.  Resources
+  /// that encode blocks derive their own kind of block from it.
+  class EncodedBlock {
+    public:
+      BBox2i bbox;
+
+      EncodedBlock( BBox2i const& bbox ) : bbox(bbox) {}
+      virtual ~EncodedBlock() {}
+
+      /// The bytes of memory held by the encoded block.
+      virtual size_t size() const = 0;
+  };
+
   // A write-only image resource
   class DstImageResource {
     public:
@@ -143,6 +190,39 @@ namespace vw {
         vw_throw(NoImplErr() << "This ImageResource does not support block writes");
       }
 
+      /// Can write() be called from several threads at once, for
+      /// blocks that don't overlap?  Block writers only serialize
+      /// their writes when it can't.
+      virtual bool has_concurrent_write() const { return false; }
+
+      /// Can blocks be written in any order, rather than only in
+      /// raster order?  Block writers then write each block as soon as
+      /// it is ready, one at a time.
+      virtual bool has_random_block_write() const { return false; }
+
+      /// Can a resource without block writes take the image as
+      /// full-width strips of rows, written one after another from the
+      /// top down, rather than all at once?  Writers then stream the
+      /// image through in strips of default_tile_size() rows, so that
+      /// only a few strips are held in memory however tall it is.
+      virtual bool has_sequential_write() const { return false; }
+
+      /// Can blocks be encoded apart from being written?  Block
+      /// writers then encode blocks in parallel, and only write the
+      /// encoded blocks one at a time, in order.
+      virtual bool has_block_encode() const { return false; }
+
+      /// Encode a block for write_encoded().  This may be called from
+      /// several threads at once, and while a block is written.
+      virtual boost::shared_ptr<EncodedBlock> encode( ImageBuffer const& /*buf*/, BBox2i const& /*bbox*/ ) const {
+        vw_throw(NoImplErr() << "This ImageResource does not support block encoding");
+      }
+
+      /// Write a block made by encode().
+      virtual void write_encoded( EncodedBlock const& /*block*/ ) {
+        vw_throw(NoImplErr() << "This ImageResource does not support block encoding");
+      }
+
       // Does this resource have an output nodata value?
       // If you override this to true, you must implement the other nodata_write functions
       virtual bool has_nodata_write() const = 0;
@@ -154,6 +234,18 @@ namespace vw {
 
       /// Force any changes to be written to the resource.
       virtual void flush() = 0;
+
+      /// Can the blocks written so far be made durable while more are
+      /// still to come?  A journaled block_write_image() then needs
+      /// only write the blocks an interrupted run did not.
+      virtual bool has_checkpoint() const { return false; }
+
+      /// Make the blocks already written durable, and the resource
+      /// readable with them in place, leaving it open for writing.
+      /// This may be called while other blocks are being written.
+      virtual void checkpoint() {
+        vw_throw(NoImplErr() << "This ImageResource does not support checkpoint().");
+      }
   };
 
   // A read-write image resource
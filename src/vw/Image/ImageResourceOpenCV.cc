@@ -12,26 +12,8 @@
 #include <vw/Core/Debugging.h>
 #include <opencv/cxcore.h>
 
-namespace {
-  cv::Rect makeRect(const vw::BBox2i& bbox) {
-    return cv::Rect(bbox.min().x(), bbox.min().y(), bbox.width(), bbox.height());
-  }
-}
-
 namespace vw {
 
-bool ImageResourceOpenCV::contiguous_roi(const BBox2i& bbox) const {
-  // if the opencv data is contiguous, do it the easy way. It's contiguous if:
-  //  1) The data is from a single row (opencv guarantees this, only rows can have gaps), or
-  //  2) Rows are contiguous (isContinuous) and the roi spans all columns
-  if (bbox.height() == 1)
-    return true;
-
-  return m_matrix->isContinuous()
-         && bbox.min().x() == 0
-         && uint32(bbox.width()) == m_format.cols;
-}
-
 ImageFormat ImageResourceOpenCV::identify() const {
   ImageFormat fmt;
   fmt.cols = m_matrix->cols;
@@ -72,30 +54,26 @@ ImageResourceOpenCV::ImageResourceOpenCV(boost::shared_ptr<cv::Mat> matrix)
   m_format = identify();
 }
 
+ImageBuffer ImageResourceOpenCV::roi_buffer(const BBox2i& bbox) const {
+  // Point the buffer straight at the matrix with its own strides, so
+  // that rows need not be contiguous and nothing is copied.
+  ImageBuffer buf(m_format, 0);
+  buf.format.cols = bbox.width();
+  buf.format.rows = bbox.height();
+  buf.data    = m_matrix->ptr(bbox.min().y()) + bbox.min().x() * m_matrix->elemSize();
+  buf.cstride = m_matrix->elemSize();
+  buf.rstride = m_matrix->step;
+  buf.pstride = buf.rstride * bbox.height();
+  return buf;
+}
+
 void ImageResourceOpenCV::read( ImageBuffer const& dst_buf, BBox2i const& bbox ) const {
   VW_ASSERT(dst_buf.format.cols == uint32(bbox.width()) && dst_buf.format.rows == uint32(bbox.height()),
       LogicErr()    << VW_CURRENT_FUNCTION << ": Destination buffer has wrong dimensions!" );
   VW_ASSERT(bbox.min().x() >= 0 && bbox.min().y() >= 0 && uint32(bbox.max().x()) <= m_format.cols && uint32(bbox.max().y()) <= m_format.rows,
       ArgumentErr() << VW_CURRENT_FUNCTION << ": Bounding box must be inside matrix.");
 
-  ImageFormat src_format = m_format;
-  src_format.rows = bbox.height();
-  src_format.cols = bbox.width();
-
-  // make sure we don't accidentially delete our matrix
-  boost::shared_ptr<cv::Mat> src_matrix = m_matrix;
-  Vector2i origin = bbox.min();
-
-  if (!contiguous_roi(bbox)) {
-    src_matrix.reset(new cv::Mat());
-    // copyTo handles resizing
-    m_matrix->operator()(makeRect(bbox)).copyTo(*src_matrix);
-    VW_ASSERT(src_matrix->isContinuous(), LogicErr() << "copied matrix is still not continuous!");
-    origin = Vector2i(0,0);
-  }
-
-  const ImageBuffer src_buf(src_format, src_matrix->ptr(origin.y()));
-  convert(dst_buf, src_buf, false);
+  convert(dst_buf, roi_buffer(bbox), false);
 }
 
 void ImageResourceOpenCV::write( ImageBuffer const& src_buf, BBox2i const& bbox ) {
@@ -104,27 +82,7 @@ void ImageResourceOpenCV::write( ImageBuffer const& src_buf, BBox2i const& bbox
   VW_ASSERT(bbox.min().x() >= 0 && bbox.min().y() >= 0 && uint32(bbox.max().x()) <= m_format.cols && uint32(bbox.max().y()) <= m_format.rows,
       ArgumentErr() << VW_CURRENT_FUNCTION << ": Bounding box must be inside matrix.");
 
-  ImageFormat dst_format = m_format;
-  dst_format.rows = bbox.height();
-  dst_format.cols = bbox.width();
-
-  if (contiguous_roi(bbox)) {
-    ImageBuffer dst_buf(dst_format, m_matrix->ptr(bbox.min().y()));
-    convert(dst_buf, src_buf, false);
-  } else {
-    // Set up a buffer that's actually backed by an opencv matrix
-    ImageBuffer tmp_buf(dst_format, 0);
-    cv::Mat tmp_mat(bbox.width(), bbox.height(), m_matrix->type());
-    VW_ASSERT(tmp_mat.isContinuous(), LogicErr() << "tmp matrix is still not continuous!");
-    tmp_buf.data = tmp_mat.ptr();
-
-    // perform conversion as usual
-    convert(tmp_buf, src_buf, false);
-
-    // copy the newly-converted data to the necessary roi
-    cv::Mat submatrix(*m_matrix, makeRect(bbox));
-    tmp_mat.copyTo(submatrix);
-  }
+  convert(roi_buffer(bbox), src_buf, false);
 }
 
 } // namespace vw
@@ -27,8 +27,8 @@ class ImageResourceOpenCV : public ImageResource {
     boost::shared_ptr<cv::Mat> m_matrix;
 
   protected:
-    // is the given bbox roi stored contiguously in memory?
-    bool contiguous_roi(const BBox2i& bbox) const;
+    // a buffer over the given bbox of the matrix, in place
+    ImageBuffer roi_buffer(const BBox2i& bbox) const;
     // identify the current matrix type
     ImageFormat identify() const;
 
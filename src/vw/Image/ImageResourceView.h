@@ -18,8 +18,10 @@
 #include <vw/Core/Cache.h>
 #include <vw/Core/Thread.h>
 #include <vw/Image/ImageViewBase.h>
+#include <vw/Image/PixelMask.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/ImageIO.h>
+#include <vw/Image/AsyncRead.h>
 
 namespace vw {
 
@@ -64,7 +66,7 @@ namespace vw {
 
     /// Returns the pixel at the given position in the given plane.
     result_type operator()( int32 x, int32 y, int32 plane=0 ) const {
-      Mutex::Lock lock(*m_rsrc_mutex);
+      ResourceLock lock( *this );
 #if VW_DEBUG_LEVEL > 1
       VW_OUT(VerboseDebugMessage, "image") << "ImageResourceView rasterizing pixel (" << x << "," << y << ")" << std::endl;
 #endif
@@ -85,14 +87,33 @@ namespace vw {
       return CropView<ImageView<PixelT> >( buf, BBox2i(-bbox.min().x(),-bbox.min().y(),cols(),rows()) );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const {
-      Mutex::Lock lock(*m_rsrc_mutex);
+      ResourceLock lock( *this );
 #if VW_DEBUG_LEVEL > 1
       VW_OUT(VerboseDebugMessage, "image") << "ImageResourceView rasterizing bbox " << bbox << std::endl;
 #endif
       read_image( dest, *m_rsrc, bbox );
     }
 
+    /// Submits a read of the given region of the resource into the
+    /// buffer on vw_io_thread_pool(), see AsyncRead.
+    AsyncRead read_async( ImageBuffer const& buf, BBox2i const& bbox ) const {
+      return AsyncRead( m_rsrc, buf, bbox,
+                        m_rsrc->has_concurrent_read() ? boost::shared_ptr<Mutex>() : m_rsrc_mutex );
+    }
+
   private:
+    // Holds the resource mutex, unless the resource can be read from
+    // several threads at once.
+    class ResourceLock : private boost::noncopyable {
+      Mutex* m_mutex;
+    public:
+      ResourceLock( ImageResourceView const& view )
+        : m_mutex( view.m_rsrc->has_concurrent_read() ? 0 : view.m_rsrc_mutex.get() ) {
+        if( m_mutex ) m_mutex->lock();
+      }
+      ~ResourceLock() { if( m_mutex ) m_mutex->unlock(); }
+    };
+
     void initialize() {
       // If the user has requested a multi-channel pixel type, but the
       // file is a multi-plane, scalar-pixel file, we force a single-plane
@@ -114,6 +135,38 @@ namespace vw {
     boost::shared_ptr<Mutex> m_rsrc_mutex;
   };
 
+  /// A resource that reads the whole image at once has no blocks.
+  template <class PixelT>
+  struct NativeBlockSize<ImageResourceView<PixelT> > {
+    static Vector2i value( ImageResourceView<PixelT> const& image ) {
+      Vector2i size = image.resource()->block_read_size();
+      if( size == Vector2i(image.cols(),image.rows()) ) return Vector2i();
+      return size;
+    }
+  };
+
+  template <class PixelT>
+  struct IsIOBound<ImageResourceView<PixelT> > : public true_type {};
+
+  /// Regions of a masked view that the resource knows hold only
+  /// nodata would read back as invalid pixels, so they count as empty.
+  template <class PixelT>
+  class SparseImageCheck<ImageResourceView<PixelT> > {
+    ImageResourceView<PixelT> const& m_view;
+  public:
+    SparseImageCheck( ImageResourceView<PixelT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      BBox2i image( 0, 0, m_view.cols(), m_view.rows() );
+      if( !bbox.intersects( image ) )
+        return false;
+      if( !IsMasked<PixelT>::value )
+        return true;
+      BBox2i region = bbox;
+      region.crop( image );
+      return !m_view.resource()->all_nodata( region );
+    }
+  };
+
 } // namespace vw
 
 #endif // __VW_IMAGE_IMAGERESOURCEVIEW_H__
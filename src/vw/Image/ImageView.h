@@ -13,16 +13,39 @@
 #define __VW_IMAGE_IMAGEVIEW_H__
 
 #include <cstring> // For memset()
+#include <new>
+#include <istream>
+#include <ostream>
 
 #include <boost/smart_ptr.hpp>
 #include <boost/type_traits.hpp>
 
+#include <vw/Core/BufferPool.h>
+#include <vw/Core/MemoryGovernor.h>
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/PixelAccessors.h>
 
 namespace vw {
 
+namespace detail {
+  /// Destroys an ImageView's pixels, returns their buffer to
+  /// vw_buffer_pool() and the bytes it reserved to vw_memory_governor().
+  template <class PixelT>
+  class ImageViewDeleter {
+    size_t m_size, m_reserved;
+  public:
+    ImageViewDeleter( size_t size, size_t reserved ) : m_size(size), m_reserved(reserved) {}
+    void operator()( PixelT *data ) const {
+      if( ! boost::has_trivial_destructor<PixelT>::value )
+        for( size_t i = 0; i < m_size; ++i )
+          data[i].~PixelT();
+      vw_buffer_pool().deallocate( data, m_size * sizeof(PixelT) );
+      vw_memory_governor().release( m_reserved );
+    }
+  };
+}
+
   /// The standard image container for in-memory image data.
   ///
   /// This class represents an image stored in memory or, more
@@ -86,6 +109,15 @@ namespace vw {
       set_size( cols, rows, planes );
     }
 
+    /// Constructs an image over memory allocated elsewhere, without
+    /// copying it.  The memory must hold planes*rows*cols pixels laid
+    /// out as set_size() would lay them out, and is released by data's
+    /// deleter once the last view sharing it is gone.  Resizing the
+    /// view drops it in favor of newly allocated memory.
+    ImageView( boost::shared_array<PixelT> const& data, int32 cols, int32 rows, int32 planes=1 )
+      : m_data(data), m_cols(cols), m_rows(rows), m_planes(planes), m_origin(data.get()),
+        m_cstride(1), m_rstride(cols), m_pstride(ssize_t(rows)*cols) {}
+
     /// Constructs an image view and rasterizes the given view into it.
     template <class ViewT>
     ImageView( ViewT const& view )
@@ -183,13 +215,22 @@ namespace vw {
       if( size==0 )
         m_data.reset();
       else {
-        boost::shared_array<PixelT> data( new (std::nothrow) PixelT[size] );
-        if (!data) {
+        // Drop our reference to the old buffer first, so that its memory
+        // is back with the governor before we reserve the new one.
+        m_data.reset();
+        size_t reserved = vw_memory_governor().reserve( size * sizeof(PixelT) );
+        PixelT *ptr = static_cast<PixelT*>( vw_buffer_pool().allocate( size * sizeof(PixelT) ) );
+        if (!ptr) {
+          vw_memory_governor().release( reserved );
           // print it and throw it for the benefit of OSX, which doesn't print the exception what() on terminate()
           VW_OUT(ErrorMessage)   << "Cannot allocate enough memory for a " << cols << "x" << rows << "x" << planes << " image: too many bytes!" << std::endl;
           vw_throw(ArgumentErr() << "Cannot allocate enough memory for a " << cols << "x" << rows << "x" << planes << " image: too many bytes!");
         }
-        m_data = data;
+        // Default-initialize the pixels, just as new[] would.
+        if( ! boost::has_trivial_constructor<PixelT>::value )
+          for( size_t i = 0; i < size; ++i )
+            new( ptr + i ) PixelT;
+        m_data = boost::shared_array<PixelT>( ptr, detail::ImageViewDeleter<PixelT>( size, reserved ) );
       }
 
       m_cols = cols;
@@ -282,6 +323,67 @@ namespace vw {
   template <class PixelT>
   struct IsMultiplyAccessible<ImageView<PixelT> > : public true_type {};
 
+  /// Specifies that ImageView rows can be copied as blocks of memory.
+  template <class PixelT>
+  struct HasContiguousRows<ImageView<PixelT> > : public true_type {};
+
+  template <class T> struct CacheSpill;
+
+  /// Lets a Cache spill ImageView cache lines to disk (see
+  /// Core/Cache.h), as their dimensions followed by their pixels.
+  template <class PixelT>
+  struct CacheSpill<ImageView<PixelT> > {
+    static const bool value = boost::has_trivial_destructor<PixelT>::value;
+
+    static void write( std::ostream& stream, ImageView<PixelT> const& image ) {
+      int32 dims[3] = { image.cols(), image.rows(), image.planes() };
+      stream.write( reinterpret_cast<const char*>(dims), sizeof(dims) );
+      stream.write( reinterpret_cast<const char*>(image.data()),
+                    std::streamsize(sizeof(PixelT)) * dims[0] * dims[1] * dims[2] );
+    }
+
+    static boost::shared_ptr<ImageView<PixelT> > read( std::istream& stream ) {
+      int32 dims[3];
+      if( ! stream.read( reinterpret_cast<char*>(dims), sizeof(dims) ) || dims[0] < 0 || dims[1] < 0 || dims[2] < 0 )
+        return boost::shared_ptr<ImageView<PixelT> >();
+      boost::shared_ptr<ImageView<PixelT> > image( new ImageView<PixelT>( dims[0], dims[1], dims[2] ) );
+      if( ! stream.read( reinterpret_cast<char*>(image->data()),
+                         std::streamsize(sizeof(PixelT)) * dims[0] * dims[1] * dims[2] ) )
+        return boost::shared_ptr<ImageView<PixelT> >();
+      return image;
+    }
+  };
+
+  /// Rows of an ImageView are contiguous in memory.
+  template <class PixelT>
+  class RowEvaluator<ImageView<PixelT> > : public true_type {
+    PixelT* m_row;
+  public:
+    RowEvaluator( ImageView<PixelT> const& image, int32 col, int32 row, int32 plane )
+      : m_row( image.data() + ((ssize_t(plane)*image.rows() + row)*image.cols() + col) ) {}
+    inline PixelT& operator[]( int32 i ) const { return m_row[i]; }
+  };
+
+  /// \cond INTERNAL
+  // Writes the rows through plain pointers, which lets the compiler
+  // vectorize the loop when the pixel operations allow it.
+  template <class SrcT, class PixelT>
+  inline void rasterize_rows( SrcT const& src, ImageView<PixelT> const& dest, BBox2i const& bbox ) {
+    VW_ASSERT( int(dest.cols())==bbox.width() && int(dest.rows())==bbox.height() && dest.planes()==src.planes(),
+               ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+    PixelT* drow = dest.data();
+    for( int32 plane=0; plane<src.planes(); ++plane ) {
+      for( int32 row=0; row<bbox.height(); ++row ) {
+        RowEvaluator<SrcT> srow( src, bbox.min().x(), bbox.min().y()+row, plane );
+        const int32 cols = bbox.width();
+        for( int32 col=0; col<cols; ++col )
+          drow[col] = PixelT(srow[col]);
+        drow += cols;
+      }
+    }
+  }
+  /// \endcond
+
 } // namespace vw
 
 #endif // __VW_IMAGE_IMAGEVIEW_H__
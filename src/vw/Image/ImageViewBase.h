@@ -20,7 +20,10 @@
 #ifndef __VW_IMAGE_IMAGEVIEWBASE_H__
 #define __VW_IMAGE_IMAGEVIEWBASE_H__
 
+#include <algorithm>
+
 #include <boost/type_traits.hpp>
+#include <boost/mpl/and.hpp>
 #include <boost/utility/enable_if.hpp>
 
 #include <vw/Core/ProgressCallback.h>
@@ -116,6 +119,50 @@ namespace vw {
   template <class ImplT>
   struct IsMultiplyAccessible : public false_type {};
 
+  /// The block size a view produces most efficiently, such as the
+  /// tiles of the file behind it, or zero if it has no preference.
+  template <class ImplT>
+  struct NativeBlockSize {
+    static Vector2i value( ImplT const& /*image*/ ) { return Vector2i(); }
+  };
+
+  /// Indicates whether rasterizing a view mostly waits on reading a
+  /// file rather than computing, as for a view of an image resource.
+  /// Cached blocks of such views are read ahead on vw_io_thread_pool().
+  template <class ImplT>
+  struct IsIOBound : public false_type {};
+
+  /// Starts generating a region of a view in the background, so that
+  /// rasterizing it later finds the data ready.  Views that are backed
+  /// by a cache specialize this; for all others it does nothing.
+  template <class ImplT>
+  struct ImagePrefetch {
+    static void prefetch( ImplT const& /*image*/, BBox2i const& /*bbox*/ ) {}
+  };
+
+  /// A helper function to prefetch a region of any view.
+  template <class ImplT>
+  inline void prefetch( ImageViewBase<ImplT> const& image, BBox2i const& bbox ) {
+    ImagePrefetch<ImplT>::prefetch( image.impl(), bbox );
+  }
+
+  /// Computes the pixels of one row of a view straight from pointers
+  /// into the ImageViews it is built from, without going through pixel
+  /// accessors.  Views for which this is possible specialize it with a
+  /// true value, a constructor taking the view and the position of the
+  /// first pixel of the row, and an operator[] taking the offset along
+  /// the row.  The per-pixel views use it to rasterize a whole chain of
+  /// per-pixel operations over ImageViews in a single loop per row.
+  template <class ImplT>
+  struct RowEvaluator : public false_type {};
+
+  /// Indicates that every row of every plane of a view is stored as a
+  /// run of pixels in memory, so that &view(col,row,plane) points to
+  /// the rest of the row.  Rasterizing between two such views of the
+  /// same pixel type copies whole rows instead of single pixels.
+  template <class ImplT>
+  struct HasContiguousRows : public false_type {};
+
 
   // *******************************************************************
   // Pixel iteration functions
@@ -243,14 +290,27 @@ namespace vw {
   // The master rasterization function
   // *******************************************************************
 
-  /// This function is called by image views that do not have special
-  /// optimized rasterization methods.  The user can also call it
-  /// explicitly when pixel-by-pixel rasterization is preferred to
-  /// the default optimized rasterization behavior.  This can be
-  /// useful in some cases, such as when the views are heavily
-  /// subsampled.
+  /// \cond INTERNAL
   template <class SrcT, class DestT>
-  inline void rasterize( SrcT const& src, DestT const& dest, BBox2i bbox ) {
+  struct CanCopyRows : public boost::mpl::if_< boost::mpl::and_< HasContiguousRows<SrcT>, HasContiguousRows<DestT>,
+                                                                 boost::is_same<typename SrcT::pixel_type, typename DestT::pixel_type> >,
+                                               true_type, false_type >::type {};
+
+  template <class SrcT, class DestT>
+  inline void rasterize_( SrcT const& src, DestT const& dest, BBox2i const& bbox, true_type ) {
+    VW_ASSERT( int(dest.cols())==bbox.width() && int(dest.rows())==bbox.height() && dest.planes()==src.planes(),
+               ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+    if( bbox.width() <= 0 ) return;
+    for( int32 plane=0; plane<src.planes(); ++plane ) {
+      for( int32 row=0; row<bbox.height(); ++row ) {
+        typename SrcT::pixel_type const* srow = &src( bbox.min().x(), bbox.min().y()+row, plane );
+        std::copy( srow, srow+bbox.width(), &dest( 0, row, plane ) );
+      }
+    }
+  }
+
+  template <class SrcT, class DestT>
+  inline void rasterize_( SrcT const& src, DestT const& dest, BBox2i const& bbox, false_type ) {
     typedef typename DestT::pixel_type DestPixelT;
     typedef typename SrcT::pixel_accessor SrcAccT;
     typedef typename DestT::pixel_accessor DestAccT;
@@ -276,6 +336,20 @@ namespace vw {
       dplane.next_plane();
     }
   }
+  /// \endcond
+
+  /// This function is called by image views that do not have special
+  /// optimized rasterization methods.  The user can also call it
+  /// explicitly when pixel-by-pixel rasterization is preferred to
+  /// the default optimized rasterization behavior.  This can be
+  /// useful in some cases, such as when the views are heavily
+  /// subsampled.
+  /// When both views store their rows contiguously and share a pixel
+  /// type (see HasContiguousRows), whole rows are copied at once.
+  template <class SrcT, class DestT>
+  inline void rasterize( SrcT const& src, DestT const& dest, BBox2i bbox ) {
+    rasterize_( src, dest, bbox, typename CanCopyRows<SrcT,DestT>::type() );
+  }
 
   /// A convenience overload to rasterize the entire source.
   template <class SrcT, class DestT>
@@ -283,6 +357,51 @@ namespace vw {
     rasterize( src, dest, BBox2i(0,0,src.cols(),src.rows()) );
   }
 
+  /// \cond INTERNAL
+  // Rasterizes a view for which RowEvaluator is specialized, one row
+  // at a time.  ImageView destinations get a tighter overload.
+  template <class SrcT, class DestT>
+  inline void rasterize_rows( SrcT const& src, DestT const& dest, BBox2i const& bbox ) {
+    typedef typename DestT::pixel_type DestPixelT;
+    typedef typename DestT::pixel_accessor DestAccT;
+    VW_ASSERT( int(dest.cols())==bbox.width() && int(dest.rows())==bbox.height() && dest.planes()==src.planes(),
+               ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+    DestAccT dplane = dest.origin();
+    for( int32 plane=0; plane<src.planes(); ++plane ) {
+      DestAccT drow = dplane;
+      for( int32 row=0; row<bbox.height(); ++row ) {
+        RowEvaluator<SrcT> srow( src, bbox.min().x(), bbox.min().y()+row, plane );
+        DestAccT dcol = drow;
+        for( int32 col=0; col<bbox.width(); ++col ) {
+          *dcol = DestPixelT(srow[col]);
+          dcol.next_col();
+        }
+        drow.next_row();
+      }
+      dplane.next_plane();
+    }
+  }
+
+  // Rasterizes a per-pixel view after prerasterization, one row at a
+  // time if its whole expression can be evaluated that way.
+  template <class SrcT, class DestT>
+  inline void rasterize_fused( SrcT const& src, DestT const& dest, BBox2i const& bbox, true_type ) {
+    rasterize_rows( src, dest, bbox );
+  }
+
+  template <class SrcT, class DestT>
+  inline void rasterize_fused( SrcT const& src, DestT const& dest, BBox2i const& bbox, false_type ) {
+    vw::rasterize( src, dest, bbox );
+  }
+
+  // Straight copies are left to rasterize().
+  template <class SrcT, class DestT>
+  inline void rasterize_fused( SrcT const& src, DestT const& dest, BBox2i const& bbox ) {
+    rasterize_fused( src, dest, bbox, typename boost::mpl::if_< CanCopyRows<SrcT,DestT>, false_type,
+                                                                typename RowEvaluator<SrcT>::type >::type() );
+  }
+  /// \endcond
+
   /// A specialization for resizable destination views.
   ///
   /// This function resizes the destination view prior to
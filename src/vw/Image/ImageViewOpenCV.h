@@ -0,0 +1,197 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file ImageViewOpenCV.h
+///
+/// Shares pixels between ImageViews and OpenCV matrices without copying
+/// them, so that OpenCV functions can be mixed into view pipelines.
+///
+/// A pixel type and a matrix type have the same layout when the channel
+/// types agree and the pixel has as many channels as the matrix, e.g.
+/// PixelRGB<uint8> and CV_8UC3 or float32 and CV_32FC1 (see
+/// OpenCVType).  Only the layout is checked: OpenCV keeps color images
+/// in BGR order, and an RGB view of one has its red and blue swapped.
+///
+///  - opencv_image_view() makes an ImageView over a matrix's pixels.
+///  - opencv_mat() makes a matrix header over an ImageView's pixels.
+///  - opencv_filter() applies an OpenCV function to a view a block at a
+///    time, e.g. to each block of block_rasterize() or
+///    block_write_image(), with both the source and destination blocks
+///    shared with OpenCV rather than copied.
+///
+#ifndef __VW_IMAGE_IMAGEVIEWOPENCV_H__
+#define __VW_IMAGE_IMAGEVIEWOPENCV_H__
+
+#include <boost/shared_array.hpp>
+
+#include <opencv/cxcore.h>
+
+#include <vw/Core/Exception.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelTypeInfo.h>
+
+namespace vw {
+
+  /// \cond INTERNAL
+  namespace detail {
+
+    template <class ChannelT> struct OpenCVDepth {};
+    template <> struct OpenCVDepth<uint8>   { static const int value = CV_8U; };
+    template <> struct OpenCVDepth<int8>    { static const int value = CV_8S; };
+    template <> struct OpenCVDepth<uint16>  { static const int value = CV_16U; };
+    template <> struct OpenCVDepth<int16>   { static const int value = CV_16S; };
+    template <> struct OpenCVDepth<int32>   { static const int value = CV_32S; };
+    template <> struct OpenCVDepth<float32> { static const int value = CV_32F; };
+    template <> struct OpenCVDepth<float64> { static const int value = CV_64F; };
+
+    // Keeps a matrix's pixels alive for as long as an ImageView shares
+    // them.
+    class OpenCVMatHolder {
+      cv::Mat m_matrix;
+    public:
+      OpenCVMatHolder( cv::Mat const& matrix ) : m_matrix(matrix) {}
+      template <class T> void operator()( T* ) { m_matrix.release(); }
+    };
+
+  } // namespace detail
+  /// \endcond
+
+  /// The OpenCV matrix type, e.g. CV_8UC3, with the layout of PixelT.
+  template <class PixelT>
+  struct OpenCVType {
+    static const int value = CV_MAKETYPE( detail::OpenCVDepth<typename CompoundChannelType<PixelT>::type>::value,
+                                          CompoundNumChannels<PixelT>::value );
+  };
+
+  /// Whether a matrix has the layout of PixelT.
+  template <class PixelT>
+  inline bool opencv_layout_matches( cv::Mat const& matrix ) {
+    return matrix.dims == 2 && matrix.type() == OpenCVType<PixelT>::value;
+  }
+
+  /// An ImageView over the pixels of a matrix with the layout of
+  /// PixelT.  The view shares the pixels, and keeps them alive if the
+  /// matrix owns them.  Matrices whose rows are not contiguous, such as
+  /// those of a region of a larger matrix, are copied first, since an
+  /// ImageView's rows must be.
+  template <class PixelT>
+  ImageView<PixelT> opencv_image_view( cv::Mat const& matrix ) {
+    VW_ASSERT( opencv_layout_matches<PixelT>( matrix ),
+               ArgumentErr() << "opencv_image_view: The matrix type " << matrix.type()
+                             << " does not match the pixel type " << int( OpenCVType<PixelT>::value ) << "." );
+    cv::Mat shared = matrix.isContinuous() ? matrix : matrix.clone();
+    PixelT* data = reinterpret_cast<PixelT*>( shared.data );
+    return ImageView<PixelT>( boost::shared_array<PixelT>( data, detail::OpenCVMatHolder( shared ) ),
+                              shared.cols, shared.rows );
+  }
+
+  /// A matrix header over the pixels of a single-plane ImageView.  The
+  /// matrix does not own the pixels, so the view, or another sharing
+  /// them, must outlive it.
+  template <class PixelT>
+  cv::Mat opencv_mat( ImageView<PixelT> const& image ) {
+    VW_ASSERT( image.planes() == 1, ArgumentErr() << "opencv_mat: The image must have a single plane." );
+    return cv::Mat( image.rows(), image.cols(), OpenCVType<PixelT>::value, image.data() );
+  }
+
+  /// A view of an OpenCV function of another view.  See opencv_filter().
+  template <class ImageT, class PixelT, class FuncT>
+  class OpenCVFilterView : public ImageViewBase<OpenCVFilterView<ImageT, PixelT, FuncT> > {
+    ImageT m_image;
+    FuncT m_func;
+    int32 m_halo;
+
+  public:
+    typedef PixelT pixel_type;
+    typedef PixelT result_type;
+    typedef ProceduralPixelAccessor<OpenCVFilterView> pixel_accessor;
+
+    OpenCVFilterView( ImageT const& image, FuncT const& func, int32 halo )
+      : m_image(image), m_func(func), m_halo(halo) {
+      VW_ASSERT( image.planes() == 1, ArgumentErr() << "OpenCVFilterView: The image must have a single plane." );
+      VW_ASSERT( halo >= 0, ArgumentErr() << "OpenCVFilterView: The halo must not be negative." );
+    }
+
+    inline int32 cols() const { return m_image.cols(); }
+    inline int32 rows() const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+    /// Filters a single pixel.  Rasterize blocks instead wherever possible.
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      ImageView<pixel_type> dest( 1, 1 );
+      rasterize( dest, BBox2i( i, j, 1, 1 ) );
+      return dest(0,0);
+    }
+
+    ImageT const& child() const { return m_image; }
+    FuncT const& func() const { return m_func; }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> dest( bbox.width(), bbox.height() );
+      rasterize( dest, bbox );
+      return prerasterize_type( dest, BBox2i( -bbox.min().x(), -bbox.min().y(), cols(), rows() ) );
+    }
+
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      ImageView<pixel_type> result( bbox.width(), bbox.height() );
+      rasterize( result, bbox );
+      result.rasterize( dest, BBox2i( 0, 0, bbox.width(), bbox.height() ) );
+    }
+
+    void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const {
+      VW_ASSERT( dest.cols() == bbox.width() && dest.rows() == bbox.height() && dest.planes() == 1,
+                 ArgumentErr() << "OpenCVFilterView: The destination is the wrong size." );
+      if ( bbox.empty() ) return;
+
+      // The source block is a region of a matrix with the halo around
+      // it, which OpenCV's filters read instead of extending the edges
+      // of the block themselves.
+      BBox2i area = bbox;
+      area.expand( m_halo );
+      ImageView<typename ImageT::pixel_type> src = crop( edge_extend( m_image, ConstantEdgeExtension() ), area );
+      cv::Mat src_mat = opencv_mat( src )( cv::Rect( m_halo, m_halo, bbox.width(), bbox.height() ) );
+      cv::Mat dest_mat = opencv_mat( dest );
+      m_func( src_mat, dest_mat );
+      VW_ASSERT( dest_mat.data == reinterpret_cast<uchar*>( dest.data() ),
+                 LogicErr() << "OpenCVFilterView: The function must write into the destination matrix, "
+                            << "which has type " << int( OpenCVType<pixel_type>::value ) << ", not replace it." );
+    }
+    /// \endcond
+  };
+
+  /// Applies an OpenCV function to an image a block at a time, giving
+  /// pixels of type PixelT.  func is called as func(src, dest), with
+  /// cv::Mat const& src over a block of the image and cv::Mat& dest
+  /// over the same block of the result, which it must fill in place
+  /// without reallocating.  src is a region of a matrix that extends
+  /// halo pixels beyond it on every side, extended at the edges of the
+  /// image by ConstantEdgeExtension, so that a filter with a kernel of
+  /// radius up to halo sees the same pixels in every block.  For
+  /// example,
+  ///
+  ///   struct Blur {
+  ///     void operator()( cv::Mat const& src, cv::Mat& dest ) const {
+  ///       cv::GaussianBlur( src, dest, cv::Size(7,7), 2.0 );
+  ///     }
+  ///   };
+  ///   ImageView<float32> result = block_rasterize( opencv_filter<float32>( image, Blur(), 3 ), Vector2i(256,256), 4 );
+  template <class PixelT, class ImageT, class FuncT>
+  OpenCVFilterView<ImageT, PixelT, FuncT>
+  inline opencv_filter( ImageViewBase<ImageT> const& image, FuncT const& func, int32 halo = 0 ) {
+    return OpenCVFilterView<ImageT, PixelT, FuncT>( image.impl(), func, halo );
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_IMAGEVIEWOPENCV_H__
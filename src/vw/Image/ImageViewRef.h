@@ -72,34 +72,81 @@ namespace vw {
     }
     virtual pixel_type operator*() const { return *m_iter; }
   };
+
+  // Where the pixels of a view are in memory, for views whose pixels
+  // are stored there with fixed strides.  Otherwise origin is null.
+  template <class PixelT>
+  struct ImageViewRefMemory {
+    PixelT const* origin;
+    ssize_t cstride, rstride, pstride;
+    ImageViewRefMemory() : origin(0), cstride(0), rstride(0), pstride(0) {}
+  };
+
+  template <class PixelT, class ViewT, class IterT>
+  inline ImageViewRefMemory<PixelT> view_memory( ViewT const& /*view*/, IterT const& /*origin*/ ) {
+    return ImageViewRefMemory<PixelT>();
+  }
+
+  // Reads the strides off the accessor, stepping only within the view
+  // so as to satisfy the bounds checks.
+  template <class PixelT, class ViewT>
+  inline ImageViewRefMemory<PixelT> view_memory( ViewT const& view, MemoryStridingPixelAccessor<PixelT> const& origin ) {
+    ImageViewRefMemory<PixelT> memory;
+    if( view.cols() == 0 || view.rows() == 0 || view.planes() == 0 )
+      return memory;
+    memory.origin = &(*origin);
+    memory.cstride = ( view.cols() > 1 ) ? &(*origin.next_col_copy()) - memory.origin : 1;
+    memory.rstride = ( view.rows() > 1 ) ? &(*origin.next_row_copy()) - memory.origin : memory.cstride * view.cols();
+    memory.pstride = ( view.planes() > 1 ) ? &(*origin.next_plane_copy()) - memory.origin : memory.rstride * view.rows();
+    return memory;
+  }
   /// \endcond
 
   /// A special virtualized accessor adaptor.
   ///
   /// This accessor adaptor is used by the \ref vw::ImageViewRef class.
+  /// For views whose pixels are in memory it steps a pointer, without
+  /// any virtual calls.
   template <class PixelT>
   class ImageViewRefAccessor {
   private:
+    PixelT const* m_ptr;
+    ssize_t m_cstride, m_rstride, m_pstride;
     boost::scoped_ptr< ImageViewRefAccessorBase<PixelT> > m_iter;
   public:
     typedef PixelT pixel_type;
     typedef PixelT result_type;
     typedef ssize_t offset_type;
 
-    template <class IterT> ImageViewRefAccessor( IterT const& iter ) : m_iter( new ImageViewRefAccessorImpl<IterT>(iter) ) {}
+    template <class IterT> ImageViewRefAccessor( IterT const& iter )
+      : m_ptr(0), m_cstride(0), m_rstride(0), m_pstride(0),
+        m_iter( new ImageViewRefAccessorImpl<IterT>(iter) ) {}
+    ImageViewRefAccessor( ImageViewRefMemory<PixelT> const& memory )
+      : m_ptr(memory.origin), m_cstride(memory.cstride), m_rstride(memory.rstride), m_pstride(memory.pstride) {}
     ~ImageViewRefAccessor() {}
 
-    ImageViewRefAccessor( ImageViewRefAccessor const& other ) : m_iter( other.m_iter->copy() ) {}
-    ImageViewRefAccessor& operator=( ImageViewRefAccessor const& other ) { m_iter = other.m_iter->copy(); }
-
-    inline ImageViewRefAccessor& next_col() { m_iter->next_col(); return *this; }
-    inline ImageViewRefAccessor& prev_col() { m_iter->prev_col(); return *this; }
-    inline ImageViewRefAccessor& next_row() { m_iter->next_row(); return *this; }
-    inline ImageViewRefAccessor& prev_row() { m_iter->prev_row(); return *this; }
-    inline ImageViewRefAccessor& next_plane() { m_iter->next_plane(); return *this; }
-    inline ImageViewRefAccessor& prev_plane() { m_iter->prev_plane(); return *this; }
-    inline ImageViewRefAccessor& advance( ssize_t di, ssize_t dj, ssize_t dp=0 ) { m_iter->advance(di,dj,dp=0); return *this; }
-    inline pixel_type operator*() const { return *(*m_iter); }
+    ImageViewRefAccessor( ImageViewRefAccessor const& other )
+      : m_ptr(other.m_ptr), m_cstride(other.m_cstride), m_rstride(other.m_rstride), m_pstride(other.m_pstride),
+        m_iter( other.m_iter ? other.m_iter->copy() : 0 ) {}
+    ImageViewRefAccessor& operator=( ImageViewRefAccessor const& other ) {
+      m_ptr = other.m_ptr;
+      m_cstride = other.m_cstride; m_rstride = other.m_rstride; m_pstride = other.m_pstride;
+      m_iter.reset( other.m_iter ? other.m_iter->copy() : 0 );
+      return *this;
+    }
+
+    inline ImageViewRefAccessor& next_col() { if( m_ptr ) m_ptr += m_cstride; else m_iter->next_col(); return *this; }
+    inline ImageViewRefAccessor& prev_col() { if( m_ptr ) m_ptr -= m_cstride; else m_iter->prev_col(); return *this; }
+    inline ImageViewRefAccessor& next_row() { if( m_ptr ) m_ptr += m_rstride; else m_iter->next_row(); return *this; }
+    inline ImageViewRefAccessor& prev_row() { if( m_ptr ) m_ptr -= m_rstride; else m_iter->prev_row(); return *this; }
+    inline ImageViewRefAccessor& next_plane() { if( m_ptr ) m_ptr += m_pstride; else m_iter->next_plane(); return *this; }
+    inline ImageViewRefAccessor& prev_plane() { if( m_ptr ) m_ptr -= m_pstride; else m_iter->prev_plane(); return *this; }
+    inline ImageViewRefAccessor& advance( ssize_t di, ssize_t dj, ssize_t dp=0 ) {
+      if( m_ptr ) m_ptr += di*m_cstride + dj*m_rstride + dp*m_pstride;
+      else m_iter->advance(di,dj,dp);
+      return *this;
+    }
+    inline pixel_type operator*() const { return m_ptr ? *m_ptr : *(*m_iter); }
   };
 
 
@@ -119,9 +166,11 @@ namespace vw {
     virtual pixel_type operator()( int32 i, int32 j ) const = 0;
     virtual pixel_type operator()( int32 i, int32 j, int32 p ) const = 0;
     virtual pixel_accessor origin() const = 0;
+    virtual ImageViewRefMemory<PixelT> memory() const = 0;
 
     virtual bool sparse_check( BBox2i const& bbox ) const = 0;
     virtual void rasterize( ImageView<pixel_type> const& dest, BBox2i bbox ) const = 0;
+    virtual void prefetch( BBox2i const& bbox ) const = 0;
   };
 
   // ImageViewRef class implementation
@@ -142,9 +191,11 @@ namespace vw {
     virtual pixel_type operator()( int32 i, int32 j ) const { return m_view(i,j); }
     virtual pixel_type operator()( int32 i, int32 j, int32 p ) const { return m_view(i,j,p); }
     virtual pixel_accessor origin() const { return m_view.origin(); }
+    virtual ImageViewRefMemory<pixel_type> memory() const { return view_memory<pixel_type>( m_view, m_view.origin() ); }
 
     virtual bool sparse_check( BBox2i const& bbox ) const { return vw::sparse_check( m_view, bbox ); }
     virtual void rasterize( ImageView<pixel_type> const& dest, BBox2i bbox ) const { m_view.rasterize( dest, bbox ); }
+    virtual void prefetch( BBox2i const& bbox ) const { vw::prefetch( m_view, bbox ); }
 
     ViewT const& child() const { return m_view; }
   };
@@ -157,10 +208,15 @@ namespace vw {
   /// with the given pixel type.  The purpose of this class is to
   /// hide the full type of a view behind a veil of abstraction,
   /// making things like run-time polymorphic behavior possible.
-  /// The inevitable cost of this flexibility is one virtual
-  /// function call per method invocation.  In many cases there
-  /// are additional costs associated with not being able to
-  /// perform template-based optimizations at compile time.
+  /// The cost of this flexibility is one virtual function call per
+  /// method invocation: rasterizing makes one call per block, but
+  /// reading single pixels of a procedural view makes one call per
+  /// pixel.  Views whose pixels are in memory (ImageViews and crops
+  /// of them) are instead read through a pointer, with no virtual
+  /// calls at all, and their rows are available through row_ptr().
+  /// In many cases there are additional costs associated with not
+  /// being able to perform template-based optimizations at compile
+  /// time.
   ///
   /// Like any C++ reference, you bind an ImageViewRef to a view
   /// using a constructor and future operations act on the bound
@@ -171,6 +227,7 @@ namespace vw {
   class ImageViewRef : public ImageViewBase<ImageViewRef<PixelT> > {
   private:
     boost::shared_ptr< ImageViewRefBase<PixelT> > m_view;
+    ImageViewRefMemory<PixelT> m_memory;
   public:
     typedef PixelT pixel_type;
     typedef PixelT result_type;
@@ -181,23 +238,47 @@ namespace vw {
     // any arguments, which makes it suitable for use in situations
     // where creation and assignment must happen as seperate steps,
     // such as in STL containers.
-    ImageViewRef() : m_view( new ImageViewRefImpl<ImageView<PixelT> >(ImageView<PixelT>()) ) {}
+    ImageViewRef() : m_view( new ImageViewRefImpl<ImageView<PixelT> >(ImageView<PixelT>()) ), m_memory( m_view->memory() ) {}
 
     // Assignment constructor creates an ImageViewRef from another
     // ImageView.
-    template <class ViewT> ImageViewRef( ImageViewBase<ViewT> const& view ) : m_view( new ImageViewRefImpl<ViewT>(view) ) {}
+    template <class ViewT> ImageViewRef( ImageViewBase<ViewT> const& view ) : m_view( new ImageViewRefImpl<ViewT>(view) ), m_memory( m_view->memory() ) {}
     ~ImageViewRef() {}
 
-    template <class ViewT> void reset( ImageViewBase<ViewT> const& view ) { m_view.reset( new ImageViewRefImpl<ViewT>(view) ); }
+    template <class ViewT> void reset( ImageViewBase<ViewT> const& view ) {
+      m_view.reset( new ImageViewRefImpl<ViewT>(view) );
+      m_memory = m_view->memory();
+    }
 
     inline int32 cols() const { return m_view->cols(); }
     inline int32 rows() const { return m_view->rows(); }
     inline int32 planes() const { return m_view->planes(); }
-    inline pixel_type operator()( int32 i, int32 j ) const { return m_view->operator()(i,j); }
-    inline pixel_type operator()( int32 i, int32 j, int32 p ) const { return m_view->operator()(i,j,p); }
-    inline pixel_accessor origin() const { return m_view->origin(); }
+    inline pixel_type operator()( int32 i, int32 j ) const {
+      if( m_memory.origin ) return m_memory.origin[i*m_memory.cstride + j*m_memory.rstride];
+      return m_view->operator()(i,j);
+    }
+    inline pixel_type operator()( int32 i, int32 j, int32 p ) const {
+      if( m_memory.origin ) return m_memory.origin[i*m_memory.cstride + j*m_memory.rstride + p*m_memory.pstride];
+      return m_view->operator()(i,j,p);
+    }
+    inline pixel_accessor origin() const {
+      if( m_memory.origin ) return pixel_accessor( m_memory );
+      return m_view->origin();
+    }
+
+    /// Are the pixels of the view in memory, with each row of each
+    /// plane stored contiguously?
+    inline bool contiguous() const { return m_memory.origin && m_memory.cstride == 1; }
+
+    /// Points to the first pixel of the given row of a contiguous()
+    /// view, which the rest of the row follows.
+    inline PixelT const* row_ptr( int32 j, int32 p = 0 ) const {
+      VW_ASSERT( contiguous(), LogicErr() << "ImageViewRef::row_ptr: the view is not contiguous." );
+      return m_memory.origin + j*m_memory.rstride + p*m_memory.pstride;
+    }
 
     inline bool sparse_check( BBox2i const& bbox ) const { return m_view->sparse_check(bbox); }
+    inline void prefetch( BBox2i const& bbox ) const { m_view->prefetch(bbox); }
 
     /// \cond INTERNAL
     typedef CropView<ImageView<PixelT> > prerasterize_type;
@@ -226,6 +307,13 @@ namespace vw {
     /// \endcond
   };
 
+  template <class PixelT>
+  struct ImagePrefetch<ImageViewRef<PixelT> > {
+    static void prefetch( ImageViewRef<PixelT> const& image, BBox2i const& bbox ) {
+      image.prefetch( bbox );
+    }
+  };
+
   template <class PixelT>
   class SparseImageCheck<ImageViewRef<PixelT> > {
     ImageViewRef<PixelT> const& image;
@@ -25,6 +25,7 @@
 #include <vw/Image/ImageView.h>
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
 #include <vw/Image/SparseImageCheck.h>
 
 namespace vw {
@@ -272,9 +273,46 @@ namespace vw {
   struct IsFloatingPointIndexable<InterpolationView<ImageT, InterpT> > : public true_type {};
   /// \endcond
 
+  /// Samples a floating-point indexable view at a row of points, for
+  /// one plane, storing the results in result[0] through result[n-1].
+  /// TransformView uses this to interpolate a whole output row at a
+  /// time.  The generic version simply calls the view for each point.
+  template <class ViewT>
+  struct InterpolateRow {
+    static void interpolate( ViewT const& view, Vector2 const* points, int32 n, int32 plane,
+                             typename ViewT::pixel_type* result ) {
+      for( int32 i=0; i<n; ++i )
+        result[i] = view( points[i][0], points[i][1], plane );
+    }
+  };
+
+  // Points whose whole interpolation footprint lies inside the image
+  // are interpolated straight from the child view, skipping the edge
+  // extension.  Every edge extension mode returns the child's own
+  // pixels inside the image, so the results are the same.
+  template <class ImageT, class EdgeT, class InterpT>
+  struct InterpolateRow<InterpolationView<EdgeExtensionView<ImageT, EdgeT>, InterpT> > {
+    typedef InterpolationView<EdgeExtensionView<ImageT, EdgeT>, InterpT> view_type;
+    static void interpolate( view_type const& view, Vector2 const* points, int32 n, int32 plane,
+                             typename view_type::pixel_type* result ) {
+      ImageT const& image = view.child().child();
+      Vector2i offset = view.child().offset();
+      typename InterpT::template Interpolator<ImageT>::type interp = InterpT::interpolator( image );
+      int32 const pb = InterpT::pixel_buffer;
+      for( int32 i=0; i<n; ++i ) {
+        double x = points[i][0] + offset.x(), y = points[i][1] + offset.y();
+        int32 ix = math::impl::_floor(x), iy = math::impl::_floor(y);
+        if( ix >= pb-1 && iy >= pb-1 && ix+pb < image.cols() && iy+pb < image.rows() )
+          result[i] = interp( image, x, y, plane );
+        else
+          result[i] = view( points[i][0], points[i][1], plane );
+      }
+    }
+  };
+
   template <class ImageT, class InterpT>
   class SparseImageCheck<InterpolationView<ImageT, InterpT> > {
-    InterpolationView<ImageT, InterpT> const& m_view;
+    InterpolationView<ImageT, InterpT> m_view;
   public:
     SparseImageCheck(InterpolationView<ImageT, InterpT> const& view)
       : m_view(view) {}
@@ -434,6 +472,181 @@ namespace vw {
 
 } // namespace vw
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+namespace vw {
+
+  // SSE versions of bilinear and bicubic interpolation for the pixel
+  // types our transform and subpixel code use most.  They do the same
+  // arithmetic in the same order as the generic versions above, only
+  // several channels (or, for one-channel pixels, several rows) at a
+  // time, so the results are identical.  Bilinear interpolation works
+  // in float and bicubic in double, as above.
+
+  // The value channels of a pixel, and whether it is valid.  A masked
+  // pixel is interpolated as its child, and the result is valid only
+  // if every pixel that went into it is valid.
+  template <class PixelT>
+  struct InterpolationSSEPixel {
+    static const int32 channels = CompoundNumChannels<PixelT>::value;
+    static bool valid( PixelT const& /*pixel*/ ) { return true; }
+    template <class ResultT> static void set_valid( ResultT& /*result*/, bool /*valid*/ ) {}
+  };
+
+  template <class ChildT>
+  struct InterpolationSSEPixel<PixelMask<ChildT> > {
+    static const int32 channels = CompoundNumChannels<ChildT>::value;
+    static bool valid( PixelMask<ChildT> const& pixel ) { return pixel.valid(); }
+    template <class ResultT> static void set_valid( ResultT& result, bool valid ) {
+      if( valid ) result.validate();
+      else result.invalidate();
+    }
+  };
+
+  template <class ViewT, class PixelT>
+  struct BilinearInterpolationSSE : InterpolationBase {
+    typedef InterpolationSSEPixel<PixelT> info;
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    typedef typename CompoundChannelCast<PixelT,float>::type result_type;
+
+    static inline __m128 load( PixelT const& pixel ) {
+      float v[4] = { 0, 0, 0, 0 };
+      for( int32 c=0; c<info::channels; ++c )
+        v[c] = float( compound_select_channel<channel_type const&>( pixel, c ) );
+      return _mm_loadu_ps( v );
+    }
+
+    PixelT operator()( const ViewT &view, double i, double j, int32 p ) const {
+      int32 x = math::impl::_floor(i), y = math::impl::_floor(j);
+      float normx = float(i)-float(x), normy = float(j)-float(y);
+
+      typename ViewT::pixel_accessor acc = view.origin().advance(x,y,p);
+      PixelT p00 = *acc;  acc.next_col();
+      PixelT p10 = *acc;  acc.advance(-1,1);
+      PixelT p01 = *acc;  acc.next_col();
+      PixelT p11 = *acc;
+
+      __m128 wx0 = _mm_set1_ps( 1-normx ), wx1 = _mm_set1_ps( normx );
+      float out[4];
+      if( info::channels == 1 ) {
+        // Both rows at once.
+        __m128 a = _mm_set_ps( 0, 0, float(compound_select_channel<channel_type const&>(p01,0)),
+                                     float(compound_select_channel<channel_type const&>(p00,0)) );
+        __m128 b = _mm_set_ps( 0, 0, float(compound_select_channel<channel_type const&>(p11,0)),
+                                     float(compound_select_channel<channel_type const&>(p10,0)) );
+        _mm_storeu_ps( out, _mm_add_ps( _mm_mul_ps( a, wx0 ), _mm_mul_ps( b, wx1 ) ) );
+        out[0] = out[0]*(1-normy) + out[1]*normy;
+      }
+      else {
+        __m128 top = _mm_add_ps( _mm_mul_ps( load(p00), wx0 ), _mm_mul_ps( load(p10), wx1 ) );
+        __m128 bottom = _mm_add_ps( _mm_mul_ps( load(p01), wx0 ), _mm_mul_ps( load(p11), wx1 ) );
+        top = _mm_mul_ps( top, _mm_set1_ps( 1-normy ) );
+        _mm_storeu_ps( out, _mm_add_ps( top, _mm_mul_ps( bottom, _mm_set1_ps( normy ) ) ) );
+      }
+
+      result_type result;
+      for( int32 c=0; c<info::channels; ++c )
+        compound_select_channel<float&>( result, c ) = out[c];
+      info::set_valid( result, info::valid(p00) && info::valid(p10) && info::valid(p01) && info::valid(p11) );
+      return channel_cast_round_if_int<channel_type>(result);
+    }
+  };
+
+  template <class ViewT, class PixelT>
+  struct BicubicInterpolationSSE {
+    typedef InterpolationSSEPixel<PixelT> info;
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    typedef typename CompoundChannelCast<PixelT,double>::type result_type;
+
+    PixelT operator()( const ViewT &view, double i, double j, int32 p ) const {
+      int32 x = math::impl::_floor(i), y = math::impl::_floor(j);
+      double normx = i-x, normy = j-y;
+
+      double s[4], t[4];
+      s[0] = ((2-normx)*normx-1)*normx;      t[0] = ((2-normy)*normy-1)*normy;
+      s[1] = (3*normx-5)*normx*normx+2;      t[1] = (3*normy-5)*normy*normy+2;
+      s[2] = ((4-3*normx)*normx+1)*normx;    t[2] = ((4-3*normy)*normy+1)*normy;
+      s[3] = (normx-1)*normx*normx;          t[3] = (normy-1)*normy*normy;
+
+      // Load the 4x4 neighborhood, one channel per double.
+      double v[4][4][info::channels];
+      bool valid = true;
+      typename ViewT::pixel_accessor acc = view.origin().advance(x-1,y-1,p);
+      for( int32 r=0; r<4; ++r ) {
+        for( int32 k=0; k<4; ++k ) {
+          PixelT pixel = *acc;
+          valid = valid && info::valid(pixel);
+          for( int32 c=0; c<info::channels; ++c )
+            v[r][k][c] = compound_select_channel<channel_type const&>( pixel, c );
+          acc.next_col();
+        }
+        acc.advance(-4,1);
+      }
+
+      double out[4];
+      if( info::channels == 1 ) {
+        // Two rows at a time.
+        double rows[4];
+        for( int32 r=0; r<4; r+=2 ) {
+          __m128d row = _mm_mul_pd( _mm_set1_pd(s[0]), _mm_set_pd( v[r+1][0][0], v[r][0][0] ) );
+          for( int32 k=1; k<4; ++k )
+            row = _mm_add_pd( row, _mm_mul_pd( _mm_set1_pd(s[k]), _mm_set_pd( v[r+1][k][0], v[r][k][0] ) ) );
+          _mm_storeu_pd( rows+r, row );
+        }
+        out[0] = t[0]*rows[0];
+        for( int32 r=1; r<4; ++r ) out[0] += t[r]*rows[r];
+      }
+      else {
+        // Two channels at a time.
+        for( int32 c=0; c<info::channels; c+=2 ) {
+          __m128d result;
+          for( int32 r=0; r<4; ++r ) {
+            __m128d row = _mm_mul_pd( _mm_set1_pd(s[0]), load( v[r][0], c ) );
+            for( int32 k=1; k<4; ++k )
+              row = _mm_add_pd( row, _mm_mul_pd( _mm_set1_pd(s[k]), load( v[r][k], c ) ) );
+            row = _mm_mul_pd( _mm_set1_pd(t[r]), row );
+            result = r ? _mm_add_pd( result, row ) : row;
+          }
+          _mm_storeu_pd( out+c, result );
+        }
+      }
+
+      result_type result;
+      for( int32 c=0; c<info::channels; ++c )
+        compound_select_channel<double&>( result, c ) = out[c];
+      result *= 0.25;
+      info::set_valid( result, valid );
+      return channel_cast_round_and_clamp_if_int<channel_type>( result );
+    }
+
+  private:
+    static inline __m128d load( double const* channels, int32 c ) {
+      return _mm_set_pd( c+1 < info::channels ? channels[c+1] : 0.0, channels[c] );
+    }
+  };
+
+#define VW_INTERPOLATION_SSE(PIXELT)                                    \
+  template <class ViewT>                                                \
+  struct BilinearInterpolationImpl<ViewT, PIXELT > : BilinearInterpolationSSE<ViewT, PIXELT > {}; \
+  template <class ViewT>                                                \
+  struct BicubicInterpolationImpl<ViewT, PIXELT > : BicubicInterpolationSSE<ViewT, PIXELT > {}
+
+  VW_INTERPOLATION_SSE( float );
+  VW_INTERPOLATION_SSE( uint16 );
+  VW_INTERPOLATION_SSE( PixelGray<float> );
+  VW_INTERPOLATION_SSE( PixelGray<uint16> );
+  VW_INTERPOLATION_SSE( PixelRGB<float> );
+  VW_INTERPOLATION_SSE( Vector2f );
+  VW_INTERPOLATION_SSE( PixelMask<PixelGray<float> > );
+  VW_INTERPOLATION_SSE( PixelMask<Vector2f> );
+
+#undef VW_INTERPOLATION_SSE
+
+} // namespace vw
+
+#endif // __SSE2__
+
 #endif // VW_ENABLE_SSE
 
 #endif // __VW_IMAGE_INTERPOLATION_H__
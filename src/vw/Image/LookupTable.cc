@@ -0,0 +1,122 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Image/LookupTable.h>
+
+// Functions compiled for AVX2 with the target attribute need GCC 4.9
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define VW_LOOKUP_TABLE_AVX2 1
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+
+namespace {
+
+  using vw::uint8;
+  using vw::uint16;
+  using vw::uint32;
+
+  template <class IndexT>
+  void gather_scalar( IndexT const* src, size_t begin, size_t end, uint32 const* table, uint32* dest ) {
+    for( size_t i = begin; i < end; ++i )
+      dest[i] = table[src[i]];
+  }
+
+#if VW_LOOKUP_TABLE_AVX2
+
+  // ---------------------------------------------------------------
+  // AVX2: 16 entries per iteration, in two 8-wide gathers.
+  // ---------------------------------------------------------------
+
+#define VW_AVX2 __attribute__((target("avx2")))
+
+  VW_AVX2 inline void load16_avx2( uint8 const* s, __m256i v[2] ) {
+    __m128i b = _mm_loadu_si128( (__m128i const*)s );
+    v[0] = _mm256_cvtepu8_epi32( b );
+    v[1] = _mm256_cvtepu8_epi32( _mm_srli_si128( b, 8 ) );
+  }
+
+  VW_AVX2 inline void load16_avx2( uint16 const* s, __m256i v[2] ) {
+    v[0] = _mm256_cvtepu16_epi32( _mm_loadu_si128( (__m128i const*)s ) );
+    v[1] = _mm256_cvtepu16_epi32( _mm_loadu_si128( (__m128i const*)(s+8) ) );
+  }
+
+  template <class IndexT>
+  VW_AVX2 void gather_avx2( IndexT const* src, size_t n, uint32 const* table, uint32* dest ) {
+    int const* base = reinterpret_cast<int const*>( table );
+    size_t i = 0;
+    for( ; i+16<=n; i+=16 ) {
+      __m256i index[2];
+      load16_avx2( src + i, index );
+      _mm256_storeu_si256( (__m256i*)(dest + i),     _mm256_i32gather_epi32( base, index[0], 4 ) );
+      _mm256_storeu_si256( (__m256i*)(dest + i + 8), _mm256_i32gather_epi32( base, index[1], 4 ) );
+    }
+    gather_scalar( src, i, n, table, dest );
+  }
+
+#undef VW_AVX2
+
+  // AVX2 needs the CPU to have it and the OS to save the YMM registers
+  // on a context switch.
+  bool cpu_has_avx2() {
+    unsigned eax, ebx, ecx, edx;
+    if( ! __get_cpuid( 1, &eax, &ebx, &ecx, &edx ) ) return false;
+    const unsigned osxsave = 1u << 27, avx = 1u << 28;
+    if( (ecx & (osxsave | avx)) != (osxsave | avx) ) return false;
+    unsigned xcr0_lo, xcr0_hi;
+    __asm__ volatile( "xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0) );
+    if( (xcr0_lo & 6) != 6 ) return false;
+    if( __get_cpuid_max( 0, 0 ) < 7 ) return false;
+    __cpuid_count( 7, 0, eax, ebx, ecx, edx );
+    return ( ebx & (1u << 5) ) != 0;
+  }
+
+#endif // VW_LOOKUP_TABLE_AVX2
+
+  enum Isa { ISA_NONE, ISA_AVX2 };
+
+  Isa detect_isa() {
+#if VW_LOOKUP_TABLE_AVX2
+    if( cpu_has_avx2() ) return ISA_AVX2;
+#endif
+    return ISA_NONE;
+  }
+
+  // A function-local static is not thread-safe to initialize in C++03,
+  // but every thread computes the same value, so a race is harmless.
+  Isa isa() {
+    static Isa result = detect_isa();
+    return result;
+  }
+
+  template <class IndexT>
+  inline void gather( IndexT const* src, size_t n, uint32 const* table, uint32* dest ) {
+    switch( isa() ) {
+#if VW_LOOKUP_TABLE_AVX2
+    case ISA_AVX2: gather_avx2( src, n, table, dest ); return;
+#endif
+    default:       gather_scalar( src, 0, n, table, dest ); return;
+    }
+  }
+
+} // namespace
+
+void vw::lookup_table_gather( uint8 const* src, size_t n, uint32 const* table, uint32* dest ) {
+  gather( src, n, table, dest );
+}
+
+void vw::lookup_table_gather( uint16 const* src, size_t n, uint32 const* table, uint32* dest ) {
+  gather( src, n, table, dest );
+}
+
+const char* vw::lookup_table_isa() {
+  switch( isa() ) {
+  case ISA_AVX2: return "avx2";
+  default:       return "none";
+  }
+}
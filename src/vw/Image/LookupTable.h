@@ -0,0 +1,237 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file LookupTable.h
+///
+/// Lookup tables for per-pixel functions of 8 and 16 bit images.
+///
+/// A function of a single channel pixel with an 8 or 16 bit integer
+/// channel has at most 65536 distinct results, so for large images it
+/// is cheaper to compute them all once, into a LookupTable, and then
+/// index the table with each pixel.  per_pixel_lookup() does this for
+/// any per-pixel functor, e.g. a color map of a DEM or the functors of
+/// normalize() and remap_pixel_value(), and apply_lookup_table() does
+/// it with a table built by hand.
+///
+/// Masked pixels (PixelMask) look up their child's value, and those
+/// that are invalid give the table's invalid_value() instead.  When
+/// the input is not masked and the results are 32 bits wide, as for
+/// float32 or PixelMask<PixelRGB<uint8> >, whole blocks are looked up
+/// by lookup_table_gather(), which uses the AVX2 gather instructions
+/// when the CPU has them.
+///
+#ifndef __VW_IMAGE_LOOKUPTABLE_H__
+#define __VW_IMAGE_LOOKUPTABLE_H__
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_integral.hpp>
+#include <boost/type_traits/make_unsigned.hpp>
+#include <boost/utility/result_of.hpp>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/CompoundTypes.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
+
+namespace vw {
+
+  /// Sets dest[i] = table[src[i]] for i from 0 to n-1, with 32 bit
+  /// table entries.
+  void lookup_table_gather( uint8 const* src, size_t n, uint32 const* table, uint32* dest );
+  void lookup_table_gather( uint16 const* src, size_t n, uint32 const* table, uint32* dest );
+
+  /// The instruction set lookup_table_gather() uses on this machine:
+  /// "avx2" or "none".
+  const char* lookup_table_isa();
+
+  /// The results of a function for every value of an 8 or 16 bit
+  /// integer type.  Copies share the table until one of them is
+  /// changed.
+  template <class InT, class OutT>
+  class LookupTable {
+    BOOST_STATIC_ASSERT( boost::is_integral<InT>::value && sizeof(InT) <= 2 );
+
+  public:
+    typedef InT input_type;
+    typedef OutT result_type;
+    /// Signed values are stored in the order of their bit patterns, so
+    /// that both kinds index the table the same way.
+    typedef typename boost::make_unsigned<InT>::type index_type;
+    static const size_t table_size = size_t(1) << ( 8 * sizeof(InT) );
+
+  private:
+    boost::shared_ptr<std::vector<OutT> > m_table;
+    OutT m_invalid;
+
+    void make_unique() {
+      if( ! m_table.unique() )
+        m_table.reset( new std::vector<OutT>( *m_table ) );
+    }
+
+  public:
+    /// A table of default-constructed results.
+    LookupTable() : m_table( new std::vector<OutT>( table_size ) ), m_invalid() {}
+
+    /// A table of func(v) for every v.  invalid is the result for
+    /// invalid masked pixels.
+    template <class FuncT>
+    explicit LookupTable( FuncT const& func, OutT const& invalid = OutT() )
+      : m_table( new std::vector<OutT>() ), m_invalid(invalid) {
+      m_table->reserve( table_size );
+      for( size_t i = 0; i < table_size; ++i )
+        m_table->push_back( func( InT( index_type(i) ) ) );
+    }
+
+    inline OutT const& operator()( InT value ) const { return (*m_table)[index_type(value)]; }
+
+    /// Changes the result for one value.
+    void set( InT value, OutT const& result ) {
+      make_unique();
+      (*m_table)[index_type(value)] = result;
+    }
+
+    OutT const& invalid_value() const { return m_invalid; }
+    void set_invalid_value( OutT const& invalid ) { m_invalid = invalid; }
+
+    /// The table, indexed by index_type(value).
+    OutT const* data() const { return &(*m_table)[0]; }
+  };
+
+  /// \cond INTERNAL
+  namespace detail {
+
+    // Applies a functor of pixels to channel values.
+    template <class PixelT, class FuncT>
+    class LookupPixelFunc {
+      FuncT m_func;
+    public:
+      typedef typename boost::result_of<FuncT(PixelT)>::type result_type;
+      LookupPixelFunc( FuncT const& func ) : m_func(func) {}
+      template <class ChannelT>
+      result_type operator()( ChannelT value ) const {
+        return m_func( PixelT( typename UnmaskedPixelType<PixelT>::type( value ) ) );
+      }
+    };
+
+    // Whether a block can be looked up by lookup_table_gather().
+    template <class PixelT, class OutT>
+    struct HasFastLookup {
+      typedef boost::mpl::integral_c<bool, !IsMasked<PixelT>::value && sizeof(OutT) == 4> type;
+    };
+
+  } // namespace detail
+  /// \endcond
+
+  /// A view of the results of looking up each pixel of a single channel
+  /// 8 or 16 bit image in a table.  See apply_lookup_table().
+  template <class ImageT, class OutT>
+  class LookupView : public ImageViewBase<LookupView<ImageT, OutT> > {
+    typedef typename ImageT::pixel_type src_pixel_type;
+    typedef typename UnmaskedPixelType<src_pixel_type>::type unmasked_type;
+    typedef typename CompoundChannelType<unmasked_type>::type channel_type;
+    BOOST_STATIC_ASSERT( CompoundNumChannels<unmasked_type>::value == 1 );
+
+  public:
+    typedef LookupTable<channel_type, OutT> table_type;
+
+  private:
+    ImageT m_image;
+    table_type m_table;
+
+    inline OutT lookup( src_pixel_type const& pixel ) const {
+      if( ! is_valid( pixel ) ) return m_table.invalid_value();
+      return m_table( compound_select_channel<channel_type const&>( pixel, 0 ) );
+    }
+
+    void lookup_block( ImageView<src_pixel_type> const& src, ImageView<OutT> const& dest, true_type ) const {
+      typedef typename table_type::index_type index_type;
+      lookup_table_gather( reinterpret_cast<index_type const*>( &src(0,0) ), size_t(src.cols()) * src.rows() * src.planes(),
+                           reinterpret_cast<uint32 const*>( m_table.data() ), reinterpret_cast<uint32*>( &dest(0,0) ) );
+    }
+
+    void lookup_block( ImageView<src_pixel_type> const& src, ImageView<OutT> const& dest, false_type ) const {
+      src_pixel_type const* s = &src(0,0);
+      OutT* d = &dest(0,0);
+      for( size_t i = 0, n = size_t(src.cols()) * src.rows() * src.planes(); i < n; ++i )
+        d[i] = lookup( s[i] );
+    }
+
+  public:
+    typedef OutT pixel_type;
+    typedef OutT result_type;
+    typedef ProceduralPixelAccessor<LookupView> pixel_accessor;
+
+    LookupView( ImageT const& image, table_type const& table ) : m_image(image), m_table(table) {}
+
+    inline int32 cols() const { return m_image.cols(); }
+    inline int32 rows() const { return m_image.rows(); }
+    inline int32 planes() const { return m_image.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+    inline result_type operator()( int32 i, int32 j, int32 p = 0 ) const { return lookup( m_image(i,j,p) ); }
+
+    ImageT const& child() const { return m_image; }
+    table_type const& table() const { return m_table; }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> dest( bbox.width(), bbox.height(), planes() );
+      rasterize( dest, bbox );
+      return prerasterize_type( dest, BBox2i( -bbox.min().x(), -bbox.min().y(), cols(), rows() ) );
+    }
+
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      ImageView<pixel_type> result( bbox.width(), bbox.height(), planes() );
+      rasterize( result, bbox );
+      result.rasterize( dest, BBox2i( 0, 0, bbox.width(), bbox.height() ) );
+    }
+
+    void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const {
+      VW_ASSERT( dest.cols() == bbox.width() && dest.rows() == bbox.height() && dest.planes() == planes(),
+                 ArgumentErr() << "LookupView: The destination is the wrong size." );
+      if( bbox.empty() ) return;
+      ImageView<src_pixel_type> src = crop( m_image, bbox );
+      lookup_block( src, dest, typename detail::HasFastLookup<src_pixel_type, OutT>::type() );
+    }
+    /// \endcond
+  };
+
+  /// Looks up each pixel of an image in a table.  The image must have
+  /// a single 8 or 16 bit integer channel, optionally masked.
+  template <class ImageT, class OutT>
+  LookupView<ImageT, OutT>
+  apply_lookup_table( ImageViewBase<ImageT> const& image,
+                      LookupTable<typename CompoundChannelType<typename UnmaskedPixelType<typename ImageT::pixel_type>::type>::type, OutT> const& table ) {
+    return LookupView<ImageT, OutT>( image.impl(), table );
+  }
+
+  /// The same as per_pixel_filter(image, func), but with func computed
+  /// once for every value the pixels can take, rather than once per
+  /// pixel.  The image must have a single 8 or 16 bit integer channel.
+  /// For masked images, func is only applied to valid pixels; invalid
+  /// ones give a default-constructed result, which for masked results
+  /// is an invalid pixel.
+  template <class ImageT, class FuncT>
+  LookupView<ImageT, typename boost::result_of<FuncT(typename ImageT::pixel_type)>::type>
+  per_pixel_lookup( ImageViewBase<ImageT> const& image, FuncT const& func ) {
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef typename boost::result_of<FuncT(pixel_type)>::type result_type;
+    typedef typename CompoundChannelType<typename UnmaskedPixelType<pixel_type>::type>::type channel_type;
+    LookupTable<channel_type, result_type> table( (detail::LookupPixelFunc<pixel_type, FuncT>( func )) );
+    return LookupView<ImageT, result_type>( image.impl(), table );
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_LOOKUPTABLE_H__
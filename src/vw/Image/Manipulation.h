@@ -35,7 +35,14 @@
 #ifndef __VW_IMAGE_MANIPULATION_H__
 #define __VW_IMAGE_MANIPULATION_H__
 
+#include <algorithm>
+
 #include <boost/mpl/logical.hpp>
+#include <boost/type_traits/has_trivial_assign.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <vw/Image/ImageView.h>
 #include <vw/Image/PixelTypes.h>
@@ -84,6 +91,158 @@ namespace vw {
   }
 
 
+  // *******************************************************************
+  // Cache-blocked transposition
+  // *******************************************************************
+
+  /// \cond INTERNAL
+  // The transposed and rotated views below rasterize by transposing
+  // rows of contiguous memory in square tiles that fit in the L1
+  // cache, rather than by walking the child a column at a time.
+
+  // Transposes a square block of lanes x lanes pixels.  The generic
+  // kernel does one pixel; with SSE2, pixels of 1, 2, 4 or 8 bytes that
+  // can be copied bitwise are done a register per row, by log2(lanes)
+  // rounds of interleaving each row with the one lanes/2 below it.
+  template <int SizeV>
+  struct TransposeKernel {
+    static const int32 lanes = 1;
+    template <class PixelT>
+    static inline void apply( PixelT const* src, ssize_t /*src_rstride*/, PixelT* dst, ssize_t /*dst_rstride*/ ) {
+      *dst = *src;
+    }
+  };
+
+#if defined(__SSE2__)
+  template <int SizeV> struct TransposeUnpackSSE2;
+  template <> struct TransposeUnpackSSE2<1> {
+    static inline __m128i lo( __m128i a, __m128i b ) { return _mm_unpacklo_epi8(a,b); }
+    static inline __m128i hi( __m128i a, __m128i b ) { return _mm_unpackhi_epi8(a,b); }
+  };
+  template <> struct TransposeUnpackSSE2<2> {
+    static inline __m128i lo( __m128i a, __m128i b ) { return _mm_unpacklo_epi16(a,b); }
+    static inline __m128i hi( __m128i a, __m128i b ) { return _mm_unpackhi_epi16(a,b); }
+  };
+  template <> struct TransposeUnpackSSE2<4> {
+    static inline __m128i lo( __m128i a, __m128i b ) { return _mm_unpacklo_epi32(a,b); }
+    static inline __m128i hi( __m128i a, __m128i b ) { return _mm_unpackhi_epi32(a,b); }
+  };
+  template <> struct TransposeUnpackSSE2<8> {
+    static inline __m128i lo( __m128i a, __m128i b ) { return _mm_unpacklo_epi64(a,b); }
+    static inline __m128i hi( __m128i a, __m128i b ) { return _mm_unpackhi_epi64(a,b); }
+  };
+
+  template <int SizeV>
+  struct TransposeKernelSSE2 {
+    static const int32 lanes = 16/SizeV;
+    template <class PixelT>
+    static inline void apply( PixelT const* src, ssize_t src_rstride, PixelT* dst, ssize_t dst_rstride ) {
+      typedef TransposeUnpackSSE2<SizeV> unpack;
+      __m128i row[lanes], tmp[lanes];
+      for( int32 i=0; i<lanes; ++i )
+        row[i] = _mm_loadu_si128( reinterpret_cast<__m128i const*>(src + i*src_rstride) );
+      for( int32 n=1; n<lanes; n*=2 ) {
+        for( int32 i=0; i<lanes/2; ++i ) {
+          tmp[2*i]   = unpack::lo( row[i], row[i+lanes/2] );
+          tmp[2*i+1] = unpack::hi( row[i], row[i+lanes/2] );
+        }
+        std::copy( tmp, tmp+lanes, row );
+      }
+      for( int32 i=0; i<lanes; ++i )
+        _mm_storeu_si128( reinterpret_cast<__m128i*>(dst + i*dst_rstride), row[i] );
+    }
+  };
+
+  template <> struct TransposeKernel<1> : public TransposeKernelSSE2<1> {};
+  template <> struct TransposeKernel<2> : public TransposeKernelSSE2<2> {};
+  template <> struct TransposeKernel<4> : public TransposeKernelSSE2<4> {};
+  template <> struct TransposeKernel<8> : public TransposeKernelSSE2<8> {};
+#endif // __SSE2__
+
+  // Writes the transpose of a src_cols x src_rows block of pixels, so
+  // that dst[y*dst_rstride+x] = src[x*src_rstride+y].  The strides may
+  // be negative, to flip the source or destination rows.
+  template <class PixelT>
+  void transpose_pixels( PixelT const* src, ssize_t src_rstride, int32 src_cols, int32 src_rows,
+                         PixelT* dst, ssize_t dst_rstride ) {
+    typedef TransposeKernel<boost::has_trivial_assign<PixelT>::value ? int(sizeof(PixelT)) : 0> kernel;
+    const int32 lanes = kernel::lanes;
+    const int32 tile = (sizeof(PixelT) > 4) ? 32 : 64;
+    for( int32 y0=0; y0<src_cols; y0+=tile ) {
+      const int32 y1 = std::min( y0+tile, src_cols );
+      for( int32 x0=0; x0<src_rows; x0+=tile ) {
+        const int32 x1 = std::min( x0+tile, src_rows );
+        int32 y = y0;
+        if( lanes > 1 ) {
+          for( ; y+lanes<=y1; y+=lanes ) {
+            int32 x = x0;
+            for( ; x+lanes<=x1; x+=lanes )
+              kernel::apply( src + x*src_rstride + y, src_rstride, dst + y*dst_rstride + x, dst_rstride );
+            for( ; x<x1; ++x )
+              for( int32 i=y; i<y+lanes; ++i )
+                dst[i*dst_rstride + x] = src[x*src_rstride + i];
+          }
+        }
+        for( ; y<y1; ++y )
+          for( int32 x=x0; x<x1; ++x )
+            dst[y*dst_rstride + x] = src[x*src_rstride + y];
+      }
+    }
+  }
+
+  // The pixels of a region of an image as rows of contiguous memory.
+  // An ImageView of the same pixel type is read in place; any other
+  // view is rasterized into a buffer first.
+  template <class PixelT>
+  struct TransposeSource {
+    ImageView<PixelT> buffer;
+    PixelT const* origin;
+    ssize_t rstride, pstride;
+    int32 cols, rows, planes;
+
+    template <class ImageT>
+    TransposeSource( ImageT const& image, BBox2i const& bbox )
+      : buffer( bbox.width(), bbox.height(), image.planes() ),
+        cols( bbox.width() ), rows( bbox.height() ), planes( image.planes() ) {
+      image.rasterize( buffer, bbox );
+      origin = buffer.data();
+      rstride = buffer.cols();
+      pstride = rstride*buffer.rows();
+    }
+
+    TransposeSource( ImageView<PixelT> const& image, BBox2i const& bbox )
+      : origin( image.data() + (ssize_t(bbox.min().y())*image.cols() + bbox.min().x()) ),
+        rstride( image.cols() ), pstride( ssize_t(image.cols())*image.rows() ),
+        cols( bbox.width() ), rows( bbox.height() ), planes( image.planes() ) {}
+  };
+
+  // Rasterizes the transpose of the source into dest, reading the
+  // source rows bottom up if flip_src and writing the destination rows
+  // bottom up if flip_dest.
+  template <class PixelT>
+  void rasterize_transpose( TransposeSource<PixelT> const& src, ImageView<PixelT> const& dest,
+                            bool flip_src, bool flip_dest ) {
+    const ssize_t src_rstride = flip_src ? -src.rstride : src.rstride;
+    const ssize_t dst_rstride = flip_dest ? -ssize_t(dest.cols()) : ssize_t(dest.cols());
+    for( int32 p=0; p<src.planes; ++p ) {
+      PixelT const* src_origin = src.origin + p*src.pstride;
+      if( flip_src ) src_origin += (src.rows-1)*src.rstride;
+      PixelT* dst_origin = &dest(0,0,p);
+      if( flip_dest ) dst_origin += (src.cols-1)*ssize_t(dest.cols());
+      transpose_pixels( src_origin, src_rstride, src.cols, src.rows, dst_origin, dst_rstride );
+    }
+  }
+
+  template <class PixelT, class DestT>
+  void rasterize_transpose( TransposeSource<PixelT> const& src, DestT const& dest,
+                            bool flip_src, bool flip_dest ) {
+    ImageView<PixelT> buffer( src.rows, src.cols, src.planes );
+    rasterize_transpose( src, buffer, flip_src, flip_dest );
+    vw::rasterize( buffer, dest, BBox2i(0,0,buffer.cols(),buffer.rows()) );
+  }
+  /// \endcond
+
+
   // *******************************************************************
   // Transpose
   // *******************************************************************
@@ -155,7 +314,11 @@ namespace vw {
       BBox2i child_bbox( bbox.min().y(), bbox.min().x(), bbox.height(), bbox.width() );
       return prerasterize_type( m_child.prerasterize(child_bbox) );
     }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      if( bbox.empty() ) return;
+      BBox2i child_bbox( bbox.min().y(), bbox.min().x(), bbox.height(), bbox.width() );
+      rasterize_transpose( TransposeSource<pixel_type>( m_child, child_bbox ), dest, false, false );
+    }
     /// \endcond
   };
 
@@ -329,7 +492,12 @@ namespace vw {
       BBox2i child_bbox( bbox.min().y(), cols()-bbox.max().x(), bbox.height(), bbox.width() );
       return prerasterize_type( m_child.prerasterize(child_bbox) );
     }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    // Rotating clockwise is transposing the child upside down.
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      if( bbox.empty() ) return;
+      BBox2i child_bbox( bbox.min().y(), cols()-bbox.max().x(), bbox.height(), bbox.width() );
+      rasterize_transpose( TransposeSource<pixel_type>( m_child, child_bbox ), dest, true, false );
+    }
     /// \endcond
   };
 
@@ -416,7 +584,13 @@ namespace vw {
       BBox2i child_bbox( rows()-bbox.max().y(), bbox.min().x(), bbox.height(), bbox.width() );
       return prerasterize_type( m_child.prerasterize(child_bbox) );
     }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    // Rotating counter-clockwise is transposing the child and writing
+    // the result upside down.
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      if( bbox.empty() ) return;
+      BBox2i child_bbox( rows()-bbox.max().y(), bbox.min().x(), bbox.height(), bbox.width() );
+      rasterize_transpose( TransposeSource<pixel_type>( m_child, child_bbox ), dest, false, true );
+    }
     /// \endcond
   };
 
@@ -620,6 +794,9 @@ namespace vw {
     offset_type m_ci, m_cj;
     int32 m_di, m_dj;
 
+    friend class RowEvaluator<CropView>;
+    friend class SparseImageCheck<CropView>;
+
   public:
     typedef typename ImageT::pixel_type pixel_type;
     typedef typename ImageT::result_type result_type;
@@ -666,7 +843,7 @@ namespace vw {
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
       // FIXME Warning: This does not respect floating-point offsets!
-      vw::rasterize( prerasterize(bbox), dest, bbox );
+      vw::rasterize_fused( prerasterize(bbox), dest, bbox );
     }
     /// \endcond
   };
@@ -678,6 +855,18 @@ namespace vw {
 
   template <class ImageT>
   struct IsMultiplyAccessible<CropView<ImageT> > : public IsMultiplyAccessible<ImageT> {};
+
+  template <class ImageT>
+  struct HasContiguousRows<CropView<ImageT> > : public HasContiguousRows<ImageT> {};
+
+  template <class ImageT>
+  class RowEvaluator<CropView<ImageT> > : public RowEvaluator<ImageT>::type {
+    RowEvaluator<ImageT> m_row;
+  public:
+    RowEvaluator( CropView<ImageT> const& view, int32 col, int32 row, int32 plane )
+      : m_row( view.m_child, view.m_ci + col, view.m_cj + row, plane ) {}
+    inline typename CropView<ImageT>::result_type operator[]( int32 i ) const { return m_row[i]; }
+  };
   /// \endcond
 
   /// Crop an image.
@@ -727,6 +916,8 @@ namespace vw {
   class SubsampleView : public ImageViewBase<SubsampleView<ImageT> > {
     ImageT m_child;
     int32 m_xdelta, m_ydelta;
+
+    friend class SparseImageCheck<SubsampleView>;
   public:
     typedef typename ImageT::pixel_type pixel_type;
     typedef typename ImageT::result_type result_type;
@@ -914,6 +1105,8 @@ namespace vw {
     inline pixel_accessor origin() const { return m_child.origin().advance(0,0,m_plane); }
     inline result_type operator()( int32 i, int32 j, int32 p=0 ) const { return m_child(i,j,m_plane+p); }
 
+    ImageT const& child() const { return m_child; }
+
     template <class ViewT>
     SelectPlaneView const& operator=( ImageViewBase<ViewT> const& view ) const {
       view.impl().rasterize( *this, BBox2i(0,0,view.impl().cols(),view.impl().rows()) );
@@ -937,6 +1130,9 @@ namespace vw {
   // View type Traits
   template <class ImageT>
   struct IsMultiplyAccessible<SelectPlaneView<ImageT> > : public IsMultiplyAccessible<ImageT> {};
+
+  template <class ImageT>
+  struct HasContiguousRows<SelectPlaneView<ImageT> > : public HasContiguousRows<ImageT> {};
   /// \endcond
 
   /// Extracts a single plane of a multi-plane image.  This function
@@ -1291,6 +1487,130 @@ namespace vw {
     return UnaryPerPixelView<ImageT,WeightedRGBToGrayFunctor>( image.impl(), func );
   }
 
+
+  // *******************************************************************
+  // Sparsity
+  // *******************************************************************
+
+  /// \cond INTERNAL
+  // Each of these views is empty wherever the region of its child
+  // that it is taken from is.
+  template <class ImageT>
+  class SparseImageCheck<TransposeView<ImageT> > {
+    TransposeView<ImageT> m_view;
+  public:
+    SparseImageCheck( TransposeView<ImageT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      return SparseImageCheck<ImageT>(m_view.child())( BBox2i( bbox.min().y(), bbox.min().x(), bbox.height(), bbox.width() ) );
+    }
+  };
+
+  template <class ImageT>
+  class SparseImageCheck<Rotate180View<ImageT> > {
+    Rotate180View<ImageT> m_view;
+  public:
+    SparseImageCheck( Rotate180View<ImageT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      return SparseImageCheck<ImageT>(m_view.child())( BBox2i( m_view.cols() - bbox.max().x(), m_view.rows() - bbox.max().y(),
+                                                               bbox.width(), bbox.height() ) );
+    }
+  };
+
+  template <class ImageT>
+  class SparseImageCheck<Rotate90CWView<ImageT> > {
+    Rotate90CWView<ImageT> m_view;
+  public:
+    SparseImageCheck( Rotate90CWView<ImageT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      return SparseImageCheck<ImageT>(m_view.child())( BBox2i( bbox.min().y(), m_view.cols() - bbox.max().x(),
+                                                               bbox.height(), bbox.width() ) );
+    }
+  };
+
+  template <class ImageT>
+  class SparseImageCheck<Rotate90CCWView<ImageT> > {
+    Rotate90CCWView<ImageT> m_view;
+  public:
+    SparseImageCheck( Rotate90CCWView<ImageT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      return SparseImageCheck<ImageT>(m_view.child())( BBox2i( m_view.rows() - bbox.max().y(), bbox.min().x(),
+                                                               bbox.height(), bbox.width() ) );
+    }
+  };
+
+  template <class ImageT>
+  class SparseImageCheck<FlipVerticalView<ImageT> > {
+    FlipVerticalView<ImageT> m_view;
+  public:
+    SparseImageCheck( FlipVerticalView<ImageT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      return SparseImageCheck<ImageT>(m_view.child())( BBox2i( bbox.min().x(), m_view.rows() - bbox.max().y(),
+                                                               bbox.width(), bbox.height() ) );
+    }
+  };
+
+  template <class ImageT>
+  class SparseImageCheck<FlipHorizontalView<ImageT> > {
+    FlipHorizontalView<ImageT> m_view;
+  public:
+    SparseImageCheck( FlipHorizontalView<ImageT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      return SparseImageCheck<ImageT>(m_view.child())( BBox2i( m_view.cols() - bbox.max().x(), bbox.min().y(),
+                                                               bbox.width(), bbox.height() ) );
+    }
+  };
+
+  // Floating-point crops interpolate, so they reach one more pixel.
+  template <class ImageT>
+  class SparseImageCheck<CropView<ImageT> > {
+    CropView<ImageT> m_view;
+  public:
+    SparseImageCheck( CropView<ImageT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      BBox2i src_bbox = bbox + Vector2i( int32( std::floor( double(m_view.m_ci) ) ), int32( std::floor( double(m_view.m_cj) ) ) );
+      if( IsFloatingPointIndexable<ImageT>::value ) src_bbox.max() += Vector2i( 1, 1 );
+      return SparseImageCheck<ImageT>(m_view.child())( src_bbox );
+    }
+  };
+
+  template <class ImageT>
+  class SparseImageCheck<SubsampleView<ImageT> > {
+    SubsampleView<ImageT> m_view;
+  public:
+    SparseImageCheck( SubsampleView<ImageT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      if( bbox.empty() ) return false;
+      int32 dx = m_view.m_xdelta, dy = m_view.m_ydelta;
+      return SparseImageCheck<ImageT>(m_view.child())( BBox2i( dx*bbox.min().x(), dy*bbox.min().y(),
+                                                               dx*(bbox.width()-1)+1, dy*(bbox.height()-1)+1 ) );
+    }
+  };
+
+  template <class ImageT>
+  class SparseImageCheck<SelectPlaneView<ImageT> > {
+    SelectPlaneView<ImageT> m_view;
+  public:
+    SparseImageCheck( SelectPlaneView<ImageT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const { return SparseImageCheck<ImageT>(m_view.child())( bbox ); }
+  };
+
+  template <class ImageT>
+  class SparseImageCheck<ChannelsToPlanesView<ImageT> > {
+    ChannelsToPlanesView<ImageT> m_view;
+  public:
+    SparseImageCheck( ChannelsToPlanesView<ImageT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const { return SparseImageCheck<ImageT>(m_view.child())( bbox ); }
+  };
+
+  template <class PixelT, class ImageT>
+  class SparseImageCheck<PlanesToChannelsView<PixelT,ImageT> > {
+    PlanesToChannelsView<PixelT,ImageT> m_view;
+  public:
+    SparseImageCheck( PlanesToChannelsView<PixelT,ImageT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const { return SparseImageCheck<ImageT>(m_view.child())( bbox ); }
+  };
+  /// \endcond
+
 } // namespace vw
 
 #endif // __VW_IMAGE_MANIPULATION_H__
@@ -134,12 +134,14 @@ namespace vw {
   /// marked as "invalid" in the mask is replaced with the constant
   /// pixel value passed in as value.  The value is T() by default.
   ///
+  /// The pixels are returned by value: views such as EdgeMaskView
+  /// return their masked pixels as temporaries.
   template <class PixelT>
-  class ApplyPixelMask : public ReturnFixedType<PixelT const&> {
+  class ApplyPixelMask : public ReturnFixedType<PixelT> {
     PixelT m_nodata_value;
   public:
     ApplyPixelMask( PixelT const& nodata_value ) : m_nodata_value(nodata_value) {}
-    PixelT const& operator()( PixelMask<PixelT> const& value ) const {
+    PixelT operator()( PixelMask<PixelT> const& value ) const {
       return value.valid() ? value.child() : m_nodata_value;
     }
   };
@@ -0,0 +1,289 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file PackedMaskView.h
+///
+/// An image of PixelMask pixels that keeps the valid bits apart from
+/// the values, packed one bit per pixel.
+///
+/// An ImageView<PixelMask<T> > stores a whole channel of validity
+/// with every pixel, so PixelMask<float> doubles the memory of the
+/// image and a PixelMask<Vector2f> disparity takes 12 bytes for one
+/// bit of validity.  A PackedMaskView<T> stores an ImageView<T> of the
+/// values and a bitmask beside it, 64 pixels of a row to a word.  It
+/// also keeps a summary of each block of 64x64 pixels, saying whether
+/// the block is all valid, all invalid or mixed, so that whole empty
+/// or full regions are recognized without looking at their pixels.
+///
+/// Its pixel type is PixelMask<T>, so it can be used wherever a view
+/// of masked pixels is, including with the views in MaskViews.h, and
+/// it is made from one by assignment or pack_mask().  values() gives
+/// the values alone as an ordinary ImageView, sharing their memory.
+///
+/// Pixels are read by value, as they are not stored as PixelMask
+/// objects; they are written with set() or by assigning a whole view.
+/// Like ImageView, copies share their memory.  Reading from several
+/// threads at once is safe, but writing is not, as neighboring pixels
+/// share their words of the mask.
+///
+#ifndef __VW_IMAGE_PACKEDMASKVIEW_H__
+#define __VW_IMAGE_PACKEDMASKVIEW_H__
+
+#include <algorithm>
+
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/PixelAccessors.h>
+#include <vw/Image/SparseImageCheck.h>
+
+namespace vw {
+
+  template <class ChildT>
+  class PackedMaskView : public ImageViewBase<PackedMaskView<ChildT> > {
+  public:
+    typedef PixelMask<ChildT> pixel_type;
+    typedef PixelMask<ChildT> result_type;
+    typedef ProceduralPixelAccessor<PackedMaskView> pixel_accessor;
+
+    /// The validity of a block of pixels.
+    enum BlockStatus { InvalidBlock = 0, MixedBlock = 1, ValidBlock = 2 };
+
+    /// The width and height of the blocks that are summarized.  A
+    /// block is one word of the mask wide.
+    static const int32 block_size = 64;
+
+  private:
+    ImageView<ChildT> m_values;
+    ImageView<uint64> m_mask;
+    ImageView<uint8> m_summary;
+
+    inline uint64 const& word( int32 i, int32 j, int32 p ) const { return m_mask( i/64, j, p ); }
+    inline uint64& word( int32 i, int32 j, int32 p ) { return m_mask( i/64, j, p ); }
+
+    // The bits of the mask words in column w that fall inside the
+    // image, and inside the columns [begin,end) of it.
+    inline uint64 word_bits( int32 w, int32 begin, int32 end ) const {
+      begin = std::max( begin - 64*w, 0 );
+      end = std::min( std::min( end, cols() ) - 64*w, 64 );
+      if( begin >= end ) return 0;
+      uint64 bits = ( end == 64 ) ? ~uint64(0) : ( (uint64(1) << end) - 1 );
+      return bits & ~( (uint64(1) << begin) - 1 );
+    }
+
+    // Recomputes the summary of a block from the mask.
+    void summarize_block( int32 bx, int32 by, int32 p ) {
+      uint64 used = word_bits( bx, 0, cols() ), any = 0, all = used;
+      int32 row_end = std::min( (by+1)*block_size, rows() );
+      for( int32 j=by*block_size; j<row_end; ++j ) {
+        any |= m_mask(bx,j,p);
+        all &= m_mask(bx,j,p);
+      }
+      m_summary(bx,by,p) = ( all == used ) ? ValidBlock : ( any & used ) ? MixedBlock : InvalidBlock;
+    }
+
+    // Recomputes the summary of the blocks that hold the given rows.
+    void summarize_rows( int32 begin, int32 end ) {
+      for( int32 p=0; p<planes(); ++p )
+        for( int32 by=begin/block_size; by*block_size<end; ++by )
+          for( int32 bx=0; bx<m_summary.cols(); ++bx )
+            summarize_block( bx, by, p );
+    }
+
+    // Copies the rows of an image of masked pixels into the rows
+    // starting at row, and summarizes them.
+    void pack_rows( ImageView<pixel_type> const& buf, int32 row ) {
+      for( int32 p=0; p<planes(); ++p ) {
+        for( int32 j=0; j<buf.rows(); ++j ) {
+          pixel_type const* src = &buf(0,j,p);
+          ChildT* dst = &m_values(0,row+j,p);
+          uint64* mask = &m_mask(0,row+j,p);
+          for( int32 w=0; w<m_mask.cols(); ++w ) {
+            int32 end = std::min( 64*(w+1), cols() );
+            uint64 bits = 0;
+            for( int32 i=64*w; i<end; ++i ) {
+              dst[i] = src[i].child();
+              if( is_valid( src[i] ) ) bits |= uint64(1) << (i-64*w);
+            }
+            mask[w] = bits;
+          }
+        }
+      }
+      summarize_rows( row, row+buf.rows() );
+    }
+
+  public:
+    /// Constructs an empty image.
+    PackedMaskView() {}
+
+    /// Constructs an image of the given size, with every pixel
+    /// invalid.
+    PackedMaskView( int32 cols, int32 rows, int32 planes=1 ) {
+      set_size( cols, rows, planes );
+    }
+
+    /// Constructs an image holding a copy of the given view.
+    template <class ViewT>
+    PackedMaskView( ImageViewBase<ViewT> const& view ) {
+      *this = view.impl();
+    }
+
+    /// Packs the given view into this image, resizing it to fit.  The
+    /// view is rasterized a row of blocks at a time.
+    template <class ViewT>
+    PackedMaskView& operator=( ImageViewBase<ViewT> const& view ) {
+      ViewT const& src = view.impl();
+      set_size( src.cols(), src.rows(), src.planes() );
+      ImageView<pixel_type> buf;
+      for( int32 row=0; row<rows(); row+=block_size ) {
+        int32 height = std::min( block_size, rows()-row );
+        buf.set_size( cols(), height, planes() );
+        src.rasterize( buf, BBox2i(0,row,cols(),height) );
+        pack_rows( buf, row );
+      }
+      return *this;
+    }
+
+    inline int32 cols() const { return m_values.cols(); }
+    inline int32 rows() const { return m_values.rows(); }
+    inline int32 planes() const { return m_values.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+    inline result_type operator()( int32 i, int32 j, int32 p=0 ) const {
+      pixel_type result( m_values(i,j,p) );
+      if( ! valid(i,j,p) ) result.invalidate();
+      return result;
+    }
+
+    /// Whether the given pixel is valid.
+    inline bool valid( int32 i, int32 j, int32 p=0 ) const {
+      return ( word(i,j,p) >> (i%64) ) & 1;
+    }
+
+    /// Sets the given pixel, and its validity.
+    void set( int32 i, int32 j, pixel_type const& pixel, int32 p=0 ) {
+      m_values(i,j,p) = pixel.child();
+      if( is_valid(pixel) ) word(i,j,p) |= uint64(1) << (i%64);
+      else word(i,j,p) &= ~( uint64(1) << (i%64) );
+      summarize_block( i/block_size, j/block_size, p );
+    }
+
+    /// Resizes the image, with every pixel invalid, allocating new
+    /// memory if the size has changed.
+    void set_size( int32 cols, int32 rows, int32 planes=1 ) {
+      if( cols==this->cols() && rows==this->rows() && planes==this->planes() ) return;
+      m_values.set_size( cols, rows, planes );
+      // ImageView zeroes new images of fundamental types, which makes
+      // every pixel and block invalid.  The mask may keep its size when
+      // the image does not, so it is always allocated afresh.
+      m_mask.reset();
+      m_mask.set_size( (cols+63)/64, rows, planes );
+      m_summary.reset();
+      m_summary.set_size( (cols+block_size-1)/block_size, (rows+block_size-1)/block_size, planes );
+    }
+
+    /// The values of the pixels without their validity.  The view
+    /// shares the memory of this image.
+    ImageView<ChildT> const& values() const { return m_values; }
+
+    /// The validity of the block at the given block column and row.
+    BlockStatus block_status( int32 bx, int32 by, int32 p=0 ) const {
+      return BlockStatus( m_summary(bx,by,p) );
+    }
+
+    /// The validity of the pixels of the image inside bbox, over all
+    /// planes: InvalidBlock if none of them is valid, ValidBlock if
+    /// all of them are, and MixedBlock otherwise.  Blocks that are
+    /// all valid or all invalid are decided from their summaries.
+    BlockStatus status( BBox2i const& bbox ) const {
+      BBox2i box = bbox;
+      box.crop( BBox2i(0,0,cols(),rows()) );
+      if( box.empty() ) return InvalidBlock;
+      bool any = false, all = true;
+      for( int32 p=0; p<planes(); ++p ) {
+        for( int32 by=box.min().y()/block_size; by*block_size<box.max().y(); ++by ) {
+          for( int32 bx=box.min().x()/block_size; bx*block_size<box.max().x(); ++bx ) {
+            uint8 summary = m_summary(bx,by,p);
+            if( summary == ValidBlock ) { any = true; continue; }
+            if( summary == InvalidBlock ) { all = false; continue; }
+            uint64 used = word_bits( bx, box.min().x(), box.max().x() );
+            int32 row_end = std::min( (by+1)*block_size, box.max().y() );
+            for( int32 j=std::max( by*block_size, box.min().y() ); j<row_end; ++j ) {
+              uint64 bits = m_mask(bx,j,p) & used;
+              if( bits ) any = true;
+              if( bits != used ) all = false;
+            }
+          }
+          if( any && !all ) return MixedBlock;
+        }
+      }
+      return all ? ValidBlock : any ? MixedBlock : InvalidBlock;
+    }
+
+    /// \cond INTERNAL
+    typedef PackedMaskView prerasterize_type;
+    inline prerasterize_type const& prerasterize( BBox2i const& /*bbox*/ ) const { return *this; }
+
+    template <class DestT>
+    inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( *this, dest, bbox );
+    }
+
+    // Unpacks straight into an image of the same pixel type, a word
+    // of the mask at a time.
+    inline void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const {
+      for( int32 p=0; p<planes(); ++p ) {
+        for( int32 j=0; j<bbox.height(); ++j ) {
+          ChildT const* src = &m_values(0,bbox.min().y()+j,p);
+          uint64 const* mask = &m_mask(0,bbox.min().y()+j,p);
+          pixel_type* dst = &dest(0,j,p) - bbox.min().x();
+          for( int32 i=bbox.min().x(); i<bbox.max().x(); ) {
+            int32 w = i/64, end = std::min( 64*(w+1), bbox.max().x() );
+            uint64 bits = mask[w];
+            if( bits == ~uint64(0) ) {
+              for( ; i<end; ++i ) dst[i] = pixel_type( src[i] );
+            } else {
+              for( ; i<end; ++i ) {
+                dst[i] = pixel_type( src[i] );
+                if( ! ( (bits >> (i-64*w)) & 1 ) ) dst[i].invalidate();
+              }
+            }
+          }
+        }
+      }
+    }
+    /// \endcond
+  };
+
+  /// \cond INTERNAL
+  template <class ChildT>
+  struct IsMultiplyAccessible<PackedMaskView<ChildT> > : public true_type {};
+
+  // A block may contain data only if some pixel of it is valid.
+  // Invalid pixels count as empty whatever their values.
+  template <class ChildT>
+  class SparseImageCheck<PackedMaskView<ChildT> > {
+    PackedMaskView<ChildT> m_view;
+  public:
+    SparseImageCheck( PackedMaskView<ChildT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      return m_view.status( bbox ) != PackedMaskView<ChildT>::InvalidBlock;
+    }
+  };
+  /// \endcond
+
+  /// Packs a view of masked pixels into a PackedMaskView.  Pixels of
+  /// an unmasked view are packed as valid.
+  template <class ViewT>
+  PackedMaskView<typename UnmaskedPixelType<typename ViewT::pixel_type>::type>
+  pack_mask( ImageViewBase<ViewT> const& view ) {
+    return PackedMaskView<typename UnmaskedPixelType<typename ViewT::pixel_type>::type>( view );
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_PACKEDMASKVIEW_H__
@@ -19,6 +19,7 @@
 
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/PixelAccessors.h>
+#include <vw/Image/SparseImageCheck.h>
 
 namespace vw {
 
@@ -106,6 +107,9 @@ namespace vw {
     inline pixel_accessor origin() const { return pixel_accessor(m_image.origin(),m_func); }
     inline result_type operator()( int32 i, int32 j, int32 p=0 ) const { return m_func(m_image(i,j,p)); }
 
+    ImageT const& child() const { return m_image; }
+    FuncT const& func() const { return m_func; }
+
     template <class ViewT>
     UnaryPerPixelView& operator=( ImageViewBase<ViewT> const& view ) {
       view.impl().rasterize( *this, BBox2i(0,0,view.impl().cols(),view.impl().rows()) );
@@ -115,7 +119,7 @@ namespace vw {
     /// \cond INTERNAL
     typedef UnaryPerPixelView<typename ImageT::prerasterize_type, FuncT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i bbox ) const { return prerasterize_type( m_image.prerasterize(bbox), m_func ); }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const { vw::rasterize_fused( prerasterize(bbox), dest, bbox ); }
     /// \endcond
   };
 
@@ -126,6 +130,17 @@ namespace vw {
   struct IsMultiplyAccessible<UnaryPerPixelView<ImageT,FuncT> > : boost::is_reference<typename UnaryPerPixelView<ImageT,FuncT>::result_type>::type {};
   /// \endcond
 
+  /// A per-pixel view over views with row access has row access too.
+  template <class ImageT, class FuncT>
+  class RowEvaluator<UnaryPerPixelView<ImageT,FuncT> > : public boost::mpl::integral_c<bool,RowEvaluator<ImageT>::value> {
+    RowEvaluator<ImageT> m_row;
+    FuncT const& m_func;
+  public:
+    RowEvaluator( UnaryPerPixelView<ImageT,FuncT> const& view, int32 col, int32 row, int32 plane )
+      : m_row( view.child(), col, row, plane ), m_func( view.func() ) {}
+    inline typename UnaryPerPixelView<ImageT,FuncT>::result_type operator[]( int32 i ) const { return m_func( m_row[i] ); }
+  };
+
 
   // *******************************************************************
   // BinaryPerPixelView
@@ -196,13 +211,29 @@ namespace vw {
     inline pixel_accessor origin() const { return pixel_accessor(m_image1.origin(),m_image2.origin(),m_func); }
     inline result_type operator()( int32 i, int32 j, int32 p=0 ) const { return m_func(m_image1(i,j,p),m_image2(i,j,p)); }
 
+    Image1T const& child1() const { return m_image1; }
+    Image2T const& child2() const { return m_image2; }
+    FuncT const& func() const { return m_func; }
+
     /// \cond INTERNAL
     typedef BinaryPerPixelView<typename Image1T::prerasterize_type, typename Image2T::prerasterize_type, FuncT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i bbox ) const { return prerasterize_type( m_image1.prerasterize(bbox), m_image2.prerasterize(bbox), m_func ); }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const { vw::rasterize_fused( prerasterize(bbox), dest, bbox ); }
     /// \endcond
   };
 
+  template <class Image1T, class Image2T, class FuncT>
+  class RowEvaluator<BinaryPerPixelView<Image1T,Image2T,FuncT> >
+    : public boost::mpl::integral_c<bool,RowEvaluator<Image1T>::value && RowEvaluator<Image2T>::value> {
+    RowEvaluator<Image1T> m_row1;
+    RowEvaluator<Image2T> m_row2;
+    FuncT const& m_func;
+  public:
+    RowEvaluator( BinaryPerPixelView<Image1T,Image2T,FuncT> const& view, int32 col, int32 row, int32 plane )
+      : m_row1( view.child1(), col, row, plane ), m_row2( view.child2(), col, row, plane ), m_func( view.func() ) {}
+    inline typename BinaryPerPixelView<Image1T,Image2T,FuncT>::result_type operator[]( int32 i ) const { return m_func( m_row1[i], m_row2[i] ); }
+  };
+
   // *******************************************************************
   // TrinaryPerPixelView
   // *******************************************************************
@@ -282,6 +313,11 @@ namespace vw {
     inline pixel_accessor origin() const { return pixel_accessor(m_image1.origin(),m_image2.origin(),m_image3.origin(),m_func); }
     inline result_type operator()( int32 i, int32 j, int32 p=0 ) const { return m_func(m_image1(i,j,p),m_image2(i,j,p),m_image3(i,j,p)); }
 
+    Image1T const& child1() const { return m_image1; }
+    Image2T const& child2() const { return m_image2; }
+    Image3T const& child3() const { return m_image3; }
+    FuncT const& func() const { return m_func; }
+
     /// \cond INTERNAL
     typedef TrinaryPerPixelView<typename Image1T::prerasterize_type, typename Image2T::prerasterize_type, typename Image3T::prerasterize_type, FuncT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i bbox ) const { return prerasterize_type( m_image1.prerasterize(bbox), m_image2.prerasterize(bbox), m_image3.prerasterize(bbox), m_func ); }
@@ -289,6 +325,56 @@ namespace vw {
     /// \endcond
   };
 
+  // *******************************************************************
+  // Sparsity
+  // *******************************************************************
+
+  /// \cond INTERNAL
+  // A per-pixel view is empty where its children are, as long as its
+  // function maps empty pixels to empty ones.  The function is only
+  // tried once the children are known to be empty there, when
+  // rasterizing the block would apply it to empty pixels anyway.
+  template <class ImageT, class FuncT>
+  class SparseImageCheck<UnaryPerPixelView<ImageT,FuncT> > {
+    UnaryPerPixelView<ImageT,FuncT> m_view;
+  public:
+    SparseImageCheck( UnaryPerPixelView<ImageT,FuncT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      typedef typename UnaryPerPixelView<ImageT,FuncT>::pixel_type pixel_type;
+      if( SparseImageCheck<ImageT>(m_view.child())( bbox ) ) return true;
+      return ! is_empty_pixel( pixel_type( m_view.func()( typename ImageT::pixel_type() ) ) );
+    }
+  };
+
+  template <class Image1T, class Image2T, class FuncT>
+  class SparseImageCheck<BinaryPerPixelView<Image1T,Image2T,FuncT> > {
+    BinaryPerPixelView<Image1T,Image2T,FuncT> m_view;
+  public:
+    SparseImageCheck( BinaryPerPixelView<Image1T,Image2T,FuncT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      typedef typename BinaryPerPixelView<Image1T,Image2T,FuncT>::pixel_type pixel_type;
+      if( SparseImageCheck<Image1T>(m_view.child1())( bbox ) ||
+          SparseImageCheck<Image2T>(m_view.child2())( bbox ) ) return true;
+      return ! is_empty_pixel( pixel_type( m_view.func()( typename Image1T::pixel_type(), typename Image2T::pixel_type() ) ) );
+    }
+  };
+
+  template <class Image1T, class Image2T, class Image3T, class FuncT>
+  class SparseImageCheck<TrinaryPerPixelView<Image1T,Image2T,Image3T,FuncT> > {
+    TrinaryPerPixelView<Image1T,Image2T,Image3T,FuncT> m_view;
+  public:
+    SparseImageCheck( TrinaryPerPixelView<Image1T,Image2T,Image3T,FuncT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      typedef typename TrinaryPerPixelView<Image1T,Image2T,Image3T,FuncT>::pixel_type pixel_type;
+      if( SparseImageCheck<Image1T>(m_view.child1())( bbox ) ||
+          SparseImageCheck<Image2T>(m_view.child2())( bbox ) ||
+          SparseImageCheck<Image3T>(m_view.child3())( bbox ) ) return true;
+      return ! is_empty_pixel( pixel_type( m_view.func()( typename Image1T::pixel_type(), typename Image2T::pixel_type(),
+                                                          typename Image3T::pixel_type() ) ) );
+    }
+  };
+  /// \endcond
+
 };
 
 #endif // __VW_IMAGE_PERPIXELVIEWS_H__
@@ -176,6 +176,10 @@ vw::uint32 vw::num_channels( vw::PixelFormatEnum format ) {
   return num;
 }
 
+bool vw::is_masked_format( vw::PixelFormatEnum format ) {
+  return format >= VW_PIXEL_UNKNOWN_MASKED && format <= VW_PIXEL_LAB_MASKED;
+}
+
 const char *vw::pixel_format_name( vw::PixelFormatEnum format ) {
   switch( format ) {
   case VW_PIXEL_SCALAR: return "SCALAR";
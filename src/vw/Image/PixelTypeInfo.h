@@ -19,6 +19,7 @@
 #include <boost/mpl/if.hpp>
 
 #include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Float16.h>
 #include <vw/Core/CompoundTypes.h>
 #include <vw/Core/Functors.h>
 #include <vw/Math/Functions.h>
@@ -197,7 +198,7 @@ namespace vw {
     template <class SourceT>
     inline DestT operator()( SourceT source ) const {
       // Clamping semantics are more reasonable for float->int rescaling.
-      if( boost::is_floating_point<SourceT>::value && ! boost::is_floating_point<DestT>::value) {
+      if( IsFloatingPoint<SourceT>::value && ! IsFloatingPoint<DestT>::value) {
         if( source > ChannelRange<SourceT>::max() ) source = ChannelRange<SourceT>::max();
         else if( source < ChannelRange<SourceT>::min() ) source = ChannelRange<SourceT>::min();
       }
@@ -237,7 +238,7 @@ namespace vw {
   template <class ChannelT, class PixelT>
   typename boost::enable_if< typename IsScalarOrCompound<PixelT>::type, typename CompoundChannelCast<PixelT, ChannelT>::type >::type
   inline channel_cast_clamp_if_int( PixelT pixel ) {
-    typedef typename boost::is_floating_point<ChannelT>::type is_float_type;
+    typedef typename IsFloatingPoint<ChannelT>::type is_float_type;
     typedef typename boost::mpl::if_<is_float_type, ChannelCastFunctor<ChannelT>, ChannelCastClampFunctor<ChannelT> >::type functor_type;
     return compound_apply( functor_type(), pixel );
   }
@@ -263,7 +264,7 @@ namespace vw {
   template <class ChannelT, class PixelT>
   typename boost::enable_if< typename IsScalarOrCompound<PixelT>::type, typename CompoundChannelCast<PixelT, ChannelT>::type >::type
   inline channel_cast_round_if_int( PixelT pixel ) {
-    typedef typename boost::is_floating_point<ChannelT>::type is_float_type;
+    typedef typename IsFloatingPoint<ChannelT>::type is_float_type;
     typedef typename boost::mpl::if_<is_float_type, ChannelCastFunctor<ChannelT>, ChannelCastRoundFunctor<ChannelT> >::type functor_type;
     return compound_apply( functor_type(), pixel );
   }
@@ -291,7 +292,7 @@ namespace vw {
   template <class ChannelT, class PixelT>
   typename boost::enable_if< typename IsScalarOrCompound<PixelT>::type, typename CompoundChannelCast<PixelT, ChannelT>::type >::type
   inline channel_cast_round_and_clamp_if_int( PixelT pixel ) {
-    typedef typename boost::is_floating_point<ChannelT>::type is_float_type;
+    typedef typename IsFloatingPoint<ChannelT>::type is_float_type;
     typedef typename boost::mpl::if_<is_float_type, ChannelCastFunctor<ChannelT>, ChannelCastRoundClampFunctor<ChannelT> >::type functor_type;
     return compound_apply( functor_type(), pixel );
   }
@@ -522,6 +523,7 @@ namespace vw {
   template<> struct PixelFormatID<vw::uint32>  { static const PixelFormatEnum value = VW_PIXEL_SCALAR; };
   template<> struct PixelFormatID<vw::int64>   { static const PixelFormatEnum value = VW_PIXEL_SCALAR; };
   template<> struct PixelFormatID<vw::uint64>  { static const PixelFormatEnum value = VW_PIXEL_SCALAR; };
+  template<> struct PixelFormatID<vw::float16> { static const PixelFormatEnum value = VW_PIXEL_SCALAR; };
   template<> struct PixelFormatID<vw::float32> { static const PixelFormatEnum value = VW_PIXEL_SCALAR; };
   template<> struct PixelFormatID<vw::float64> { static const PixelFormatEnum value = VW_PIXEL_SCALAR; };
   template<> struct PixelFormatID<bool>        { static const PixelFormatEnum value = VW_PIXEL_SCALAR; };
@@ -543,6 +545,7 @@ namespace vw {
   template<> struct PixelFormatID<PixelMask<vw::uint32> >  { static const PixelFormatEnum value = VW_PIXEL_SCALAR_MASKED; };
   template<> struct PixelFormatID<PixelMask<vw::int64> >   { static const PixelFormatEnum value = VW_PIXEL_SCALAR_MASKED; };
   template<> struct PixelFormatID<PixelMask<vw::uint64> >  { static const PixelFormatEnum value = VW_PIXEL_SCALAR_MASKED; };
+  template<> struct PixelFormatID<PixelMask<vw::float16> > { static const PixelFormatEnum value = VW_PIXEL_SCALAR_MASKED; };
   template<> struct PixelFormatID<PixelMask<vw::float32> > { static const PixelFormatEnum value = VW_PIXEL_SCALAR_MASKED; };
   template<> struct PixelFormatID<PixelMask<vw::float64> > { static const PixelFormatEnum value = VW_PIXEL_SCALAR_MASKED; };
   template<> struct PixelFormatID<PixelMask<bool> >        { static const PixelFormatEnum value = VW_PIXEL_SCALAR_MASKED; };
@@ -565,6 +568,7 @@ namespace vw {
   template<> struct ChannelTypeID<vw::uint32>    { static const ChannelTypeEnum value = VW_CHANNEL_UINT32; };
   template<> struct ChannelTypeID<vw::int64>     { static const ChannelTypeEnum value = VW_CHANNEL_INT64; };
   template<> struct ChannelTypeID<vw::uint64>    { static const ChannelTypeEnum value = VW_CHANNEL_UINT64; };
+  template<> struct ChannelTypeID<vw::float16>   { static const ChannelTypeEnum value = VW_CHANNEL_FLOAT16; };
   template<> struct ChannelTypeID<vw::float32>   { static const ChannelTypeEnum value = VW_CHANNEL_FLOAT32; };
   template<> struct ChannelTypeID<vw::float64>   { static const ChannelTypeEnum value = VW_CHANNEL_FLOAT64; };
   template<> struct ChannelTypeID<bool>          { static const ChannelTypeEnum value = VW_CHANNEL_BOOL; };
@@ -578,6 +582,8 @@ namespace vw {
   const char *channel_type_name( ChannelTypeEnum type );
   uint32 num_channels( PixelFormatEnum format );
   uint32 num_channels_nothrow( PixelFormatEnum format );
+  // Is this the format of a PixelMask, whose last channel is the valid flag?
+  bool is_masked_format( PixelFormatEnum format );
   const char *pixel_format_name( PixelFormatEnum format );
   ChannelTypeEnum channel_name_to_enum( const std::string& name );
 
@@ -7,6 +7,22 @@
 
 /// \file SparseImageCheck.h
 ///
+/// Tests whether a block of an image view may contain any data.
+///
+/// SparseImageCheck<ViewT>(view)(bbox) returns false only when every
+/// pixel of the view inside bbox is known to be empty, that is equal
+/// to a default-constructed pixel: transparent, or invalid for masked
+/// pixels.  It may return true for a block that turns out to be empty.
+/// Views that can tell where their data is, such as ImageComposite or
+/// an EdgeExtensionView with zero extension, specialize the check, and
+/// the views built on top of them pass it on to their children over
+/// the region of the child that the block depends on.  Per-pixel views
+/// pass it on when their function maps an empty pixel to an empty one.
+/// Writers such as block_write_image and QuadTreeGenerator use it to
+/// skip rasterizing empty blocks.
+///
+/// The checks hold copies of the views they test, so they can be kept
+/// after the view they were made from is gone.
 ///
 #ifndef __VW_IMAGE_SPARSE_IMAGE_CHECK_H__
 #define __VW_IMAGE_SPARSE_IMAGE_CHECK_H__
@@ -23,7 +39,7 @@ namespace vw {
     BBox2i m_src_bbox;
   public:
     SparseImageCheck(SrcViewT const& source) : m_src_bbox(0,0,source.cols(),source.rows()) {}
-    bool operator() (BBox2i const& bbox) { return bbox.intersects(m_src_bbox); }
+    bool operator() (BBox2i const& bbox) const { return bbox.intersects(m_src_bbox); }
   };
 
   // A helper function to make it easy to test for sparisty.
@@ -32,6 +48,14 @@ namespace vw {
     return SparseImageCheck<ImageT>(image)(bbox);
   }
 
+  /// \cond INTERNAL
+  // Whether a pixel is empty, i.e. equal to a default-constructed one.
+  template <class PixelT>
+  inline bool is_empty_pixel( PixelT const& pixel ) {
+    return pixel == PixelT();
+  }
+  /// \endcond
+
 } // namespace vw
 
 #endif // __VW_IMAGE_SPARSE_IMAGE_CHECK_H__
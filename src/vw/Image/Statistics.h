@@ -19,6 +19,8 @@
 /// - stddev_channel_value
 /// - median_channel_value
 /// - weighted_mean_channel_value
+/// - channel_statistics
+/// - channel_quantiles
 ///
 /// - min_pixel_value
 /// - max_pixel_value
@@ -32,9 +34,18 @@
 #ifndef __VW_IMAGE_STATISTICS_H__
 #define __VW_IMAGE_STATISTICS_H__
 
+#include <cmath>
+#include <limits>
+#include <vector>
+
 #include <boost/type_traits.hpp>
 
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
 #include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/BlockProcessor.h>
 #include <vw/Image/PixelMask.h>
 
 namespace vw {
@@ -151,6 +162,375 @@ namespace vw {
     return accumulator.value();
   }
 
+  /// Accumulates the minimum, maximum, mean, standard deviation and,
+  /// optionally, a histogram of the channel values of the valid pixels
+  /// of an image, as well as the number of valid pixels.
+  /// Accumulators can be merged, so partial results computed in
+  /// parallel can be combined; see channel_statistics().
+  ///
+  /// Each accumulator keeps its sums relative to a shift, which is the
+  /// first value it saw or, after a merge, the combined mean.  This
+  /// keeps the variance accurate for data far from zero, such as the
+  /// elevations in a DEM.
+  class ChannelStatistics {
+    uint64 m_num_samples, m_num_valid_pixels;
+    double m_shift, m_sum, m_sum2;
+    double m_min, m_max;
+    double m_hist_min, m_hist_scale;
+    std::vector<uint64> m_histogram;
+
+  public:
+    /// Accumulates no histogram.
+    ChannelStatistics()
+      : m_num_samples(0), m_num_valid_pixels(0), m_shift(0), m_sum(0), m_sum2(0),
+        m_min(0), m_max(0), m_hist_min(0), m_hist_scale(0) {}
+
+    /// Also accumulates a histogram with num_bins equal bins covering
+    /// [hist_min,hist_max].  Values outside the range are counted in
+    /// the first or last bin, and NaNs in the first.
+    ChannelStatistics( int32 num_bins, double hist_min, double hist_max )
+      : m_num_samples(0), m_num_valid_pixels(0), m_shift(0), m_sum(0), m_sum2(0),
+        m_min(0), m_max(0), m_hist_min(hist_min), m_hist_scale(0), m_histogram(num_bins)
+    {
+      VW_ASSERT( num_bins > 0 && hist_max > hist_min,
+                 ArgumentErr() << "ChannelStatistics: invalid histogram range." );
+      m_hist_scale = num_bins / (hist_max - hist_min);
+    }
+
+    /// Adds a single channel value.
+    void operator()( double value ) {
+      if( m_num_samples == 0 ) {
+        m_shift = m_min = m_max = value;
+      }
+      else {
+        if( value < m_min ) m_min = value;
+        if( m_max < value ) m_max = value;
+      }
+      double d = value - m_shift;
+      m_sum += d;
+      m_sum2 += d*d;
+      ++m_num_samples;
+      if( ! m_histogram.empty() ) {
+        double bin = (value - m_hist_min) * m_hist_scale;
+        size_t last = m_histogram.size() - 1;
+        ++m_histogram[ !(bin > 0) ? 0 : bin >= last ? last : size_t(bin) ];
+      }
+    }
+
+    /// Adds every channel of a pixel, excluding the mask channel, if
+    /// the pixel is valid.
+    template <class PixelT>
+    void add_pixel( PixelT const& pixel ) {
+      if( ! is_valid( pixel ) ) return;
+      typedef typename UnmaskedPixelType<PixelT>::type value_type;
+      typedef typename CompoundChannelType<value_type>::type channel_type;
+      for( size_t c=0; c<CompoundNumChannels<value_type>::value; ++c )
+        (*this)( double( compound_select_channel<channel_type const&>( remove_mask( pixel ), c ) ) );
+      ++m_num_valid_pixels;
+    }
+
+    /// Adds the samples of another accumulator, which must have the
+    /// same histogram bins.
+    void merge( ChannelStatistics const& other ) {
+      VW_ASSERT( m_histogram.size() == other.m_histogram.size(),
+                 ArgumentErr() << "ChannelStatistics: cannot merge different histograms." );
+      if( other.m_num_samples == 0 ) return;
+      if( m_num_samples == 0 ) {
+        *this = other;
+        return;
+      }
+      double n1 = double(m_num_samples), n2 = double(other.m_num_samples), n = n1 + n2;
+      double mean1 = m_shift + m_sum/n1, mean2 = other.m_shift + other.m_sum/n2;
+      double m2 = (m_sum2 - m_sum*m_sum/n1) + (other.m_sum2 - other.m_sum*other.m_sum/n2);
+      double delta = mean2 - mean1;
+      m_shift = mean1 + delta * n2 / n;
+      m_sum = 0;
+      m_sum2 = m2 + delta*delta * n1 * n2 / n;
+      if( other.m_min < m_min ) m_min = other.m_min;
+      if( m_max < other.m_max ) m_max = other.m_max;
+      m_num_samples += other.m_num_samples;
+      m_num_valid_pixels += other.m_num_valid_pixels;
+      for( size_t i=0; i<m_histogram.size(); ++i )
+        m_histogram[i] += other.m_histogram[i];
+    }
+
+    /// The number of channel values and of valid pixels seen.
+    uint64 num_samples() const { return m_num_samples; }
+    uint64 num_valid_pixels() const { return m_num_valid_pixels; }
+
+    double minimum() const {
+      VW_ASSERT( m_num_samples, ArgumentErr() << "ChannelStatistics: no valid samples." );
+      return m_min;
+    }
+
+    double maximum() const {
+      VW_ASSERT( m_num_samples, ArgumentErr() << "ChannelStatistics: no valid samples." );
+      return m_max;
+    }
+
+    double mean() const {
+      VW_ASSERT( m_num_samples, ArgumentErr() << "ChannelStatistics: no valid samples." );
+      return m_shift + m_sum / m_num_samples;
+    }
+
+    /// The total (not sample) standard deviation, as computed by
+    /// stddev_channel_value().
+    double stddev() const {
+      VW_ASSERT( m_num_samples, ArgumentErr() << "ChannelStatistics: no valid samples." );
+      double var = (m_sum2 - m_sum*m_sum/m_num_samples) / m_num_samples;
+      return var > 0 ? std::sqrt( var ) : 0.0;
+    }
+
+    /// The histogram counts, empty if no histogram was requested.
+    std::vector<uint64> const& histogram() const { return m_histogram; }
+  };
+
+  /// \cond INTERNAL
+  // Accumulates each block into its own copy of the (empty) prototype
+  // accumulator, then merges it into the shared result.  AccumT needs
+  // add_pixel() and merge(), like ChannelStatistics.
+  template <class ViewT, class AccumT>
+  class AccumulateBlockFunc {
+    ViewT const& m_view;
+    AccumT const& m_prototype;
+    AccumT& m_result;
+    Mutex& m_mutex;
+  public:
+    AccumulateBlockFunc( ViewT const& view, AccumT const& prototype, AccumT& result, Mutex& mutex )
+      : m_view(view), m_prototype(prototype), m_result(result), m_mutex(mutex) {}
+
+    void operator()( BBox2i const& bbox ) const {
+      typedef typename ViewT::pixel_type pixel_type;
+      ImageView<pixel_type> block = crop( m_view, bbox );
+      AccumT accum = m_prototype;
+      pixel_type const* ptr = block.data();
+      for( size_t i = size_t(block.cols())*block.rows()*block.planes(); i; --i )
+        accum.add_pixel( *ptr++ );
+      Mutex::Lock lock( m_mutex );
+      m_result.merge( accum );
+    }
+  };
+
+  template <class ViewT, class AccumT>
+  AccumT block_accumulate( ViewT const& view, AccumT const& prototype, int32 threads ) {
+    AccumT result = prototype;
+    Mutex mutex;
+    int32 tile = vw_settings().default_tile_size();
+    AccumulateBlockFunc<ViewT,AccumT> func( view, prototype, result, mutex );
+    BlockProcessor<AccumulateBlockFunc<ViewT,AccumT> > process( func, Vector2i(tile,tile), threads );
+    process( BBox2i( 0, 0, view.cols(), view.rows() ) );
+    return result;
+  }
+  /// \endcond
+
+  /// Computes the minimum, maximum, mean, standard deviation, valid
+  /// pixel count and (if the accumulator passed in has one) histogram
+  /// of the channel values of all the valid pixels of an image in a
+  /// single pass.  The image is processed in blocks of the default
+  /// tile size, in parallel using the given number of threads (the
+  /// default number if 0).  Each block is rasterized, so the view
+  /// must be safe to rasterize from several threads at once; pass
+  /// threads=1 otherwise.
+  ///
+  /// The values match those of the separate functions above, except
+  /// for rounding in the mean and standard deviation.
+  template <class ViewT>
+  ChannelStatistics channel_statistics( ImageViewBase<ViewT> const& view,
+                                        ChannelStatistics const& prototype = ChannelStatistics(),
+                                        int32 threads = 0 ) {
+    VW_ASSERT( prototype.num_samples() == 0,
+               ArgumentErr() << "channel_statistics: the accumulator must be empty." );
+    return block_accumulate( view.impl(), prototype, threads );
+  }
+
+  /// A histogram of channel values with equal bins covering
+  /// [minimum,maximum].  Values outside the range are only counted,
+  /// and NaNs are ignored.  Histograms with the same bins can be
+  /// merged.
+  class ChannelHistogram {
+    double m_min, m_max, m_scale;
+    std::vector<uint64> m_bins;
+    uint64 m_below, m_above;
+  public:
+    ChannelHistogram( int32 num_bins, double minimum, double maximum )
+      : m_min(minimum), m_max(maximum), m_scale(0), m_bins(num_bins), m_below(0), m_above(0)
+    {
+      VW_ASSERT( num_bins > 0 && maximum >= minimum,
+                 ArgumentErr() << "ChannelHistogram: invalid histogram range." );
+      if( maximum > minimum ) m_scale = num_bins / (maximum - minimum);
+    }
+
+    /// The bin a value falls in: -1 below the range, num_bins() above.
+    int32 bin( double value ) const {
+      if( value < m_min ) return -1;
+      if( value > m_max ) return num_bins();
+      int32 b = int32( (value - m_min) * m_scale );
+      return b < num_bins() ? b : num_bins() - 1;
+    }
+
+    void operator()( double value ) {
+      if( value != value ) return;
+      int32 b = bin( value );
+      if( b < 0 ) ++m_below;
+      else if( b == num_bins() ) ++m_above;
+      else ++m_bins[b];
+    }
+
+    /// Adds every channel of a pixel, excluding the mask channel, if
+    /// the pixel is valid.
+    template <class PixelT>
+    void add_pixel( PixelT const& pixel ) {
+      if( ! is_valid( pixel ) ) return;
+      typedef typename UnmaskedPixelType<PixelT>::type value_type;
+      typedef typename CompoundChannelType<value_type>::type channel_type;
+      for( size_t c=0; c<CompoundNumChannels<value_type>::value; ++c )
+        (*this)( double( compound_select_channel<channel_type const&>( remove_mask( pixel ), c ) ) );
+    }
+
+    void merge( ChannelHistogram const& other ) {
+      VW_ASSERT( m_bins.size() == other.m_bins.size() && m_min == other.m_min && m_max == other.m_max,
+                 ArgumentErr() << "ChannelHistogram: cannot merge different histograms." );
+      for( size_t i=0; i<m_bins.size(); ++i )
+        m_bins[i] += other.m_bins[i];
+      m_below += other.m_below;
+      m_above += other.m_above;
+    }
+
+    int32 num_bins() const { return int32(m_bins.size()); }
+    double minimum() const { return m_min; }
+    double maximum() const { return m_max; }
+    std::vector<uint64> const& bins() const { return m_bins; }
+    uint64 below() const { return m_below; }
+    uint64 above() const { return m_above; }
+
+    /// The range of values in a bin.
+    double bin_min( int32 b ) const { return m_scale ? m_min + b / m_scale : m_min; }
+    double bin_max( int32 b ) const { return b+1 == num_bins() ? m_max : bin_min( b+1 ); }
+  };
+
+  /// An estimated quantile, together with bounds that the true
+  /// quantile lies between.
+  struct QuantileEstimate {
+    double value, lower, upper;
+  };
+
+  /// \cond INTERNAL
+  // Refines selected bins of a ChannelHistogram.  A value is assigned
+  // to a bin by the parent histogram, exactly as in the pass that
+  // chose the bins, and then to one of the sub-bins of that bin.
+  class QuantileRefinement {
+    ChannelHistogram m_parent;
+    std::vector<int32> m_bins;
+    std::vector<std::vector<uint64> > m_counts;
+  public:
+    QuantileRefinement( ChannelHistogram const& parent, std::vector<int32> const& bins, int32 num_sub_bins )
+      : m_parent( parent ), m_bins( bins ), m_counts( bins.size(), std::vector<uint64>( num_sub_bins ) ) {}
+
+    void operator()( double value ) {
+      if( value != value ) return;
+      int32 b = m_parent.bin( value );
+      for( size_t i=0; i<m_bins.size(); ++i ) {
+        if( m_bins[i] != b ) continue;
+        std::vector<uint64>& counts = m_counts[i];
+        double lo = m_parent.bin_min( b ), hi = m_parent.bin_max( b );
+        double s = hi > lo ? (value - lo) / (hi - lo) * counts.size() : 0;
+        ++counts[ !(s > 0) ? 0 : s >= counts.size() ? counts.size()-1 : size_t(s) ];
+      }
+    }
+
+    template <class PixelT>
+    void add_pixel( PixelT const& pixel ) {
+      if( ! is_valid( pixel ) ) return;
+      typedef typename UnmaskedPixelType<PixelT>::type value_type;
+      typedef typename CompoundChannelType<value_type>::type channel_type;
+      for( size_t c=0; c<CompoundNumChannels<value_type>::value; ++c )
+        (*this)( double( compound_select_channel<channel_type const&>( remove_mask( pixel ), c ) ) );
+    }
+
+    void merge( QuantileRefinement const& other ) {
+      for( size_t i=0; i<m_counts.size(); ++i )
+        for( size_t j=0; j<m_counts[i].size(); ++j )
+          m_counts[i][j] += other.m_counts[i][j];
+    }
+
+    std::vector<uint64> const& counts( size_t i ) const { return m_counts[i]; }
+  };
+
+  // Finds the bin holding the sample of the given rank, and the rank
+  // of the first sample in that bin.
+  inline size_t quantile_bin( std::vector<uint64> const& counts, uint64 rank, uint64& first ) {
+    size_t b = 0;
+    while( b+1 < counts.size() && first + counts[b] <= rank )
+      first += counts[b++];
+    return b;
+  }
+  /// \endcond
+
+  /// Estimates quantiles of the channel values of the valid pixels of
+  /// an image without sorting them.  Each fraction in [0,1] selects
+  /// the value of rank round(fraction*(N-1)) among the N values.
+  ///
+  /// The first pass finds the range of the values, and the second
+  /// counts them in num_bins equal bins.  If refine is set, a third
+  /// pass splits each bin that holds a requested quantile into
+  /// num_bins sub-bins, so the bounds are at most
+  /// (maximum-minimum)/num_bins^2 apart (up to rounding).  Each pass
+  /// is block-parallel, as in channel_statistics().  A subsample
+  /// factor greater than one only looks at every subsample'th pixel
+  /// in each direction; the bounds then hold for the subsampled values.
+  ///
+  /// This function throws an ArgumentErr() exception if the image
+  /// has no valid pixels.
+  template <class ViewT>
+  std::vector<QuantileEstimate>
+  channel_quantiles( ImageViewBase<ViewT> const& view, std::vector<double> const& fractions,
+                     int32 subsample_factor = 1, int32 num_bins = 4096, bool refine = true,
+                     int32 threads = 0 ) {
+    VW_ASSERT( subsample_factor >= 1 && num_bins >= 1,
+               ArgumentErr() << "channel_quantiles: invalid arguments." );
+    SubsampleView<ViewT> samples = subsample( view.impl(), subsample_factor );
+    ChannelStatistics stats = block_accumulate( samples, ChannelStatistics(), threads );
+    ChannelHistogram hist = block_accumulate( samples, ChannelHistogram( num_bins, stats.minimum(), stats.maximum() ), threads );
+    uint64 total = stats.num_samples();
+
+    std::vector<uint64> ranks( fractions.size() ), firsts( fractions.size(), 0 );
+    std::vector<int32> bins( fractions.size() );
+    for( size_t i=0; i<fractions.size(); ++i ) {
+      VW_ASSERT( fractions[i] >= 0 && fractions[i] <= 1,
+                 ArgumentErr() << "channel_quantiles: fractions must be in [0,1]." );
+      ranks[i] = uint64( fractions[i] * (total-1) + 0.5 );
+      bins[i] = int32( quantile_bin( hist.bins(), ranks[i], firsts[i] ) );
+    }
+
+    std::vector<QuantileEstimate> result( fractions.size() );
+    if( refine && hist.maximum() > hist.minimum() ) {
+      QuantileRefinement sub = block_accumulate( samples, QuantileRefinement( hist, bins, num_bins ), threads );
+      for( size_t i=0; i<fractions.size(); ++i ) {
+        std::vector<uint64> const& counts = sub.counts( i );
+        uint64 first = firsts[i];
+        size_t s = quantile_bin( counts, ranks[i], first );
+        double lo = hist.bin_min( bins[i] ), width = (hist.bin_max( bins[i] ) - lo) / counts.size();
+        result[i].lower = lo + s*width;
+        result[i].upper = s+1 == counts.size() ? hist.bin_max( bins[i] ) : lo + (s+1)*width;
+        result[i].value = result[i].lower + (result[i].upper - result[i].lower) * (ranks[i] - first + 0.5) / counts[s];
+      }
+    }
+    else {
+      for( size_t i=0; i<fractions.size(); ++i ) {
+        result[i].lower = hist.bin_min( bins[i] );
+        result[i].upper = hist.bin_max( bins[i] );
+        result[i].value = result[i].lower + (result[i].upper - result[i].lower)
+          * (ranks[i] - firsts[i] + 0.5) / hist.bins()[bins[i]];
+      }
+    }
+    // The extremes are known exactly.
+    for( size_t i=0; i<fractions.size(); ++i ) {
+      if( ranks[i] == 0 ) result[i].value = result[i].lower = result[i].upper = stats.minimum();
+      if( ranks[i] == total-1 ) result[i].value = result[i].lower = result[i].upper = stats.maximum();
+    }
+    return result;
+  }
+
   // PIXEL operations
   //////////////////////////////////
 
@@ -0,0 +1,230 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file SummedAreaTable.h
+///
+/// Summed-area tables (integral images), which give the sum of the
+/// pixels in any rectangle of an image from four lookups.  They are
+/// used for box filters of any size, for the integral-image feature
+/// detectors in InterestPoint, and, with the table of squared pixel
+/// values, for the window means and variances of normalized cross
+/// correlation in Stereo.
+///
+/// A table is built in parallel: horizontal strips of the image are
+/// summed independently by the threads of vw_thread_pool(), and each
+/// strip is then offset by the total of the strips above it.  Integer
+/// pixels are summed in int64 and floating-point pixels in double by
+/// default, so that the sums of large images do not overflow or lose
+/// the small values.
+///
+#ifndef __VW_IMAGE_SUMMEDAREATABLE_H__
+#define __VW_IMAGE_SUMMEDAREATABLE_H__
+
+#include <algorithm>
+
+#include <vw/Core/Settings.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMath.h>
+#include <vw/Image/BlockProcessor.h>
+
+namespace vw {
+
+  /// The type a summed-area table over pixels of the given type uses
+  /// by default: the same kind of pixel, with int64 channels for
+  /// integer pixels and double channels for floating-point ones.
+  template <class PixelT>
+  struct SummedAreaSumType {
+    typedef typename PixelChannelType<PixelT>::type channel_type;
+    typedef typename boost::mpl::if_< boost::is_floating_point<channel_type>, double, int64 >::type sum_channel_type;
+    typedef typename CompoundChannelCast<PixelT, sum_channel_type>::type type;
+  };
+
+  /// A summed-area table of an image, and optionally of its squared
+  /// pixel values.  The tables are one pixel larger than the image in
+  /// each direction: entry (i,j) holds the sum of the pixels (x,y) of
+  /// the image with x < i and y < j, so the first row and column are
+  /// zero.  This is the layout the InterestPoint integral-image code
+  /// expects.  Only the first plane of the image is summed.
+  template <class SumT>
+  class SummedAreaTable {
+    ImageView<SumT> m_sums, m_squares;
+
+    /// \cond INTERNAL
+    // Sums one strip of rows, as if the row above it were zero.
+    template <class ViewT>
+    class StripFunc {
+      ViewT const& m_view;
+      ImageView<SumT> &m_sums, &m_squares;
+      bool m_with_squares;
+    public:
+      StripFunc( ViewT const& view, ImageView<SumT>& sums, ImageView<SumT>& squares, bool with_squares )
+        : m_view(view), m_sums(sums), m_squares(squares), m_with_squares(with_squares) {}
+
+      void operator()( BBox2i const& bbox ) const {
+        typedef typename ViewT::pixel_type pixel_type;
+        typedef typename PixelChannelType<SumT>::type sum_channel_type;
+        ImageView<pixel_type> block = crop( m_view, bbox );
+        int32 cols = block.cols();
+        for( int32 j = 0; j < block.rows(); ++j ) {
+          int32 row = bbox.min().y() + j + 1;
+          SumT const* above = (j == 0) ? 0 : &m_sums( 1, row - 1 );
+          SumT const* above2 = (j == 0 || !m_with_squares) ? 0 : &m_squares( 1, row - 1 );
+          SumT* dest = &m_sums( 1, row );
+          SumT* dest2 = m_with_squares ? &m_squares( 1, row ) : 0;
+          SumT run = SumT(), run2 = SumT();
+          pixel_type const* src = &block( 0, j );
+          for( int32 i = 0; i < cols; ++i ) {
+            SumT value = channel_cast<sum_channel_type>( src[i] );
+            run += value;
+            dest[i] = above ? SumT( run + above[i] ) : run;
+            if( m_with_squares ) {
+              run2 += value * value;
+              dest2[i] = above2 ? SumT( run2 + above2[i] ) : run2;
+            }
+          }
+        }
+      }
+    };
+
+    // Adds the last row of the strip above to every row of a strip
+    // but its last one, which has been done already.
+    class OffsetFunc {
+      ImageView<SumT>& m_table;
+    public:
+      OffsetFunc( ImageView<SumT>& table ) : m_table(table) {}
+
+      void operator()( BBox2i const& bbox ) const {
+        if( bbox.min().y() == 0 ) return;
+        int32 cols = m_table.cols() - 1;
+        SumT const* carry = &m_table( 1, bbox.min().y() );
+        for( int32 row = bbox.min().y() + 1; row < bbox.max().y(); ++row ) {
+          SumT* dest = &m_table( 1, row );
+          for( int32 i = 0; i < cols; ++i )
+            dest[i] += carry[i];
+        }
+      }
+    };
+
+    // Offsets the last row of each strip, top to bottom.
+    static void carry_strips( ImageView<SumT>& table, int32 strip_rows ) {
+      int32 cols = table.cols() - 1;
+      for( int32 row = 2*strip_rows; row < table.rows(); row += strip_rows ) {
+        SumT const* carry = &table( 1, row - strip_rows );
+        SumT* dest = &table( 1, row );
+        for( int32 i = 0; i < cols; ++i )
+          dest[i] += carry[i];
+      }
+      int32 last = table.rows() - 1;
+      if( last % strip_rows != 0 && last > strip_rows ) {
+        SumT const* carry = &table( 1, last - last % strip_rows );
+        SumT* dest = &table( 1, last );
+        for( int32 i = 0; i < cols; ++i )
+          dest[i] += carry[i];
+      }
+    }
+    /// \endcond
+
+  public:
+    typedef SumT sum_type;
+
+    SummedAreaTable() {}
+
+    /// Builds the table of an image, and of its squared pixel values if
+    /// requested, using the given number of threads (the default number
+    /// if 0).  Strips of the image are rasterized from several threads
+    /// at once, so the view must be safe to rasterize that way; pass
+    /// threads=1 otherwise.
+    template <class ViewT>
+    SummedAreaTable( ImageViewBase<ViewT> const& view, bool with_squares = false, int32 threads = 0 ) {
+      ViewT const& image = view.impl();
+      int32 cols = image.cols(), rows = image.rows();
+      m_sums.set_size( cols + 1, rows + 1 );
+      if( with_squares ) m_squares.set_size( cols + 1, rows + 1 );
+      for( int32 i = 0; i <= cols; ++i ) {
+        m_sums( i, 0 ) = SumT();
+        if( with_squares ) m_squares( i, 0 ) = SumT();
+      }
+      for( int32 j = 1; j <= rows; ++j ) {
+        m_sums( 0, j ) = SumT();
+        if( with_squares ) m_squares( 0, j ) = SumT();
+      }
+      if( cols == 0 || rows == 0 ) return;
+
+      // Strips of at least a tile's worth of pixels keep the carry
+      // pass small next to the summing itself.
+      if( threads == 0 ) threads = vw_settings().default_num_threads();
+      int32 tile = vw_settings().default_tile_size();
+      int32 min_rows = std::max( 1, int32( (int64(tile) * tile + cols - 1) / cols ) );
+      int32 strip_rows = std::max( min_rows, (rows + threads - 1) / threads );
+
+      StripFunc<ViewT> strip_func( image, m_sums, m_squares, with_squares );
+      if( strip_rows >= rows ) {
+        strip_func( BBox2i( 0, 0, cols, rows ) );
+        return;
+      }
+      BBox2i bbox( 0, 0, cols, rows );
+      Vector2i strip_size( cols, strip_rows );
+      BlockProcessor<StripFunc<ViewT> > sum_strips( strip_func, strip_size, threads );
+      sum_strips( bbox );
+
+      // Strip k covers table rows k*strip_rows+1 through (k+1)*strip_rows.
+      carry_strips( m_sums, strip_rows );
+      BlockProcessor<OffsetFunc> offset_sums( OffsetFunc( m_sums ), strip_size, threads );
+      offset_sums( bbox );
+      if( with_squares ) {
+        carry_strips( m_squares, strip_rows );
+        BlockProcessor<OffsetFunc> offset_squares( OffsetFunc( m_squares ), strip_size, threads );
+        offset_squares( bbox );
+      }
+    }
+
+    /// The size of the image the table was built from.
+    int32 cols() const { return m_sums.cols() ? m_sums.cols() - 1 : 0; }
+    int32 rows() const { return m_sums.rows() ? m_sums.rows() - 1 : 0; }
+
+    bool has_squares() const { return m_squares.cols() != 0; }
+
+    /// The tables themselves, one pixel larger than the image in each
+    /// direction.
+    ImageView<SumT> const& sums() const { return m_sums; }
+    ImageView<SumT> const& squares() const {
+      VW_ASSERT( has_squares(), LogicErr() << "SummedAreaTable: the table of squares was not built." );
+      return m_squares;
+    }
+
+    /// The sum of the pixels of the image inside a box, which must lie
+    /// within the image.
+    SumT sum( BBox2i const& bbox ) const { return box_sum( m_sums, bbox ); }
+
+    /// The sum of the squared pixels of the image inside a box.
+    SumT sum_squares( BBox2i const& bbox ) const { return box_sum( squares(), bbox ); }
+
+    /// Looks up the sum inside a box in a table of this layout.
+    static SumT box_sum( ImageView<SumT> const& table, BBox2i const& bbox ) {
+      VW_DEBUG_ASSERT( bbox.min().x() >= 0 && bbox.min().y() >= 0 &&
+                       bbox.max().x() < table.cols() && bbox.max().y() < table.rows(),
+                       ArgumentErr() << "SummedAreaTable: box " << bbox << " is outside the image." );
+      SumT result = table( bbox.max().x(), bbox.max().y() );
+      result -= table( bbox.min().x(), bbox.max().y() );
+      result -= table( bbox.max().x(), bbox.min().y() );
+      result += table( bbox.min().x(), bbox.min().y() );
+      return result;
+    }
+  };
+
+  /// Builds the summed-area table of an image using the default sum
+  /// type for its pixels.  \see SummedAreaTable
+  template <class ViewT>
+  SummedAreaTable<typename SummedAreaSumType<typename ViewT::pixel_type>::type>
+  summed_area_table( ImageViewBase<ViewT> const& view, bool with_squares = false, int32 threads = 0 ) {
+    return SummedAreaTable<typename SummedAreaSumType<typename ViewT::pixel_type>::type>( view, with_squares, threads );
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_SUMMEDAREATABLE_H__
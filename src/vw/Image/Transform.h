@@ -14,6 +14,9 @@
 #ifndef __VW_IMAGE_TRANSFORM_H__
 #define __VW_IMAGE_TRANSFORM_H__
 
+#include <algorithm>
+#include <vector>
+
 // Vision Workbench
 #include <vw/Core/Features.h>
 #include <vw/Core/Log.h>
@@ -65,6 +68,16 @@ namespace vw {
     /// image back to coordinates in the original image.
     virtual Vector2 reverse( Vector2 const& /*point*/ ) const { vw_throw( NoImplErr() << "reverse() is not implemented for this transform." ); return Vector2(); }
 
+    /// This applies the reverse transformation to a row of n pixels
+    /// starting at the given point, storing the results in result[0]
+    /// through result[n-1].  TransformView uses this to transform one
+    /// output row at a time; transforms that can step along a row
+    /// more cheaply than calling reverse() for each point override it.
+    virtual void reverse_row( Vector2 const& start, int32 n, Vector2* result ) const {
+      for( int32 i=0; i<n; ++i )
+        result[i] = reverse( Vector2( start.x()+i, start.y() ) );
+    }
+
     /// Specifies the properties of the forward mapping function.
     virtual FunctionType forward_type() const { return DiscontinuousFunction; }
 
@@ -100,6 +113,12 @@ namespace vw {
     inline ImplT& impl() { return static_cast<ImplT&>(*this); }
     inline ImplT const& impl() const { return static_cast<ImplT const&>(*this); }
 
+    void reverse_row( Vector2 const& start, int32 n, Vector2* result ) const {
+      ImplT const& txform = impl();
+      for( int32 i=0; i<n; ++i )
+        result[i] = txform.reverse( Vector2( start.x()+i, start.y() ) );
+    }
+
     BBox2i forward_bbox( BBox2i const& bbox ) const {
       ImplT const& txform = impl();
       BBox2 transformed_bbox;
@@ -193,6 +212,12 @@ namespace vw {
       return Vector2( p(0) / m_xfactor, p(1) / m_yfactor );
     }
 
+    void reverse_row( Vector2 const& start, int32 n, Vector2* result ) const {
+      double y = start.y() / m_yfactor;
+      for( int32 i=0; i<n; ++i )
+        result[i] = Vector2( (start.x()+i) / m_xfactor, y );
+    }
+
     inline Vector2 forward( Vector2 const& p ) const {
       return Vector2( p(0) * m_xfactor, p(1) * m_yfactor );
     }
@@ -212,6 +237,12 @@ namespace vw {
       return Vector2( p(0) - m_xtrans, p(1) - m_ytrans );
     }
 
+    void reverse_row( Vector2 const& start, int32 n, Vector2* result ) const {
+      double x = start.x() - m_xtrans, y = start.y() - m_ytrans;
+      for( int32 i=0; i<n; ++i )
+        result[i] = Vector2( x+i, y );
+    }
+
     inline Vector2 forward(const Vector2 &p) const {
       return Vector2( p(0) + m_xtrans, p(1) + m_ytrans );
     }
@@ -234,6 +265,14 @@ namespace vw {
     inline Vector2 reverse( Vector2 const& p ) const {
       return m_matrix_inverse * p;
     }
+
+    // Each step along the row adds the first column of the inverse.
+    void reverse_row( Vector2 const& start, int32 n, Vector2* result ) const {
+      Vector2 origin = m_matrix_inverse * start;
+      double dx = m_matrix_inverse(0,0), dy = m_matrix_inverse(1,0);
+      for( int32 i=0; i<n; ++i )
+        result[i] = Vector2( origin.x() + i*dx, origin.y() + i*dy );
+    }
   };
 
   /// Affine function (i.e. linear plus translation) image transform functor
@@ -267,6 +306,12 @@ namespace vw {
       return Vector2(m_ai*px+m_bi*py,
                      m_ci*px+m_di*py);
     }
+
+    void reverse_row( Vector2 const& start, int32 n, Vector2* result ) const {
+      Vector2 origin = reverse( start );
+      for( int32 i=0; i<n; ++i )
+        result[i] = Vector2( origin.x() + i*m_ai, origin.y() + i*m_ci );
+    }
   };
 
   /// Rotate image transform functor
@@ -304,6 +349,19 @@ namespace vw {
                       ( m_H_inverse(1,0) * p(0) + m_H_inverse(1,1) * p(1) + m_H_inverse(1,2) ) / w);
     }
 
+    // The homogeneous coordinates are linear along the row, so only
+    // the division is left for each point.
+    void reverse_row( Vector2 const& start, int32 n, Vector2* result ) const {
+      Matrix3x3 const& H = m_H_inverse;
+      double x = H(0,0)*start(0) + H(0,1)*start(1) + H(0,2);
+      double y = H(1,0)*start(0) + H(1,1)*start(1) + H(1,2);
+      double w = H(2,0)*start(0) + H(2,1)*start(1) + H(2,2);
+      for( int32 i=0; i<n; ++i ) {
+        double wi = w + i*H(2,0);
+        result[i] = Vector2( (x + i*H(0,0)) / wi, (y + i*H(1,0)) / wi );
+      }
+    }
+
     inline Vector2 forward(const Vector2 &p) const {
       double w = m_H(2,0) * p(0) + m_H(2,1) * p(1) + m_H(2,2);
       return Vector2( ( m_H(0,0) * p(0) + m_H(0,1) * p(1) + m_H(0,2) ) / w,
@@ -505,89 +563,139 @@ namespace vw {
 
   /// ApproximateTransform image transform functor template.
   ///
-  /// Mimics the behavior of a given transform functor, but attempts to
-  /// build a lookup table to linearly interpolate approimate results
-  /// to the reverse() function for arguments within the given bounding
-  /// box, to within the original transform functor's tolerance.
+  /// Mimics the behavior of a given transform functor, but builds a
+  /// piecewise-bilinear mesh that approximates the reverse() function
+  /// for arguments within the given bounding box, to within the
+  /// original transform functor's tolerance.  TransformView builds one
+  /// of these for each block it rasterizes when the transform has a
+  /// non-zero tolerance, which pays off for transforms such as
+  /// GeoTransform and CameraTransform whose reverse() is expensive.
+  ///
+  /// The mesh is a quadtree.  Each cell is tested by evaluating the
+  /// real transform at the midpoints of its edges and at its center,
+  /// and is split into four if any of them is further than the
+  /// tolerance from the bilinear interpolation of its corners.  The
+  /// tested points become the corners of the new cells, so no
+  /// evaluation is wasted.  Cells smaller than min_cell_size pixels
+  /// that still fail fall back to the real transform.
   template <class TransformT>
   class ApproximateTransform : public TransformT {
-    BBox2i m_bbox;
-    ImageView<Vector2> m_table;
+    struct Cell {
+      Vector2 min, max;
+      Vector2 c00, c10, c01, c11;
+      int32 child; // Index of the first of four children, or -1 for a leaf
+      bool exact;  // Leaf that uses the real transform
+    };
+    std::vector<Cell> m_cells;
+    double m_max_error;
+
+    static Vector2 bilinear( Cell const& cell, Vector2 const& p ) {
+      double u = (p.x() - cell.min.x()) / (cell.max.x() - cell.min.x());
+      double v = (p.y() - cell.min.y()) / (cell.max.y() - cell.min.y());
+      return (cell.c00*(1-u) + cell.c10*u)*(1-v) + (cell.c01*(1-u) + cell.c11*u)*v;
+    }
+
+    void subdivide( size_t index ) {
+      Cell cell = m_cells[index];
+      if( cell.max.x()-cell.min.x() < 2*min_cell_size || cell.max.y()-cell.min.y() < 2*min_cell_size ) {
+        if( ! (test_cell(cell) <= TransformT::tolerance()) )
+          m_cells[index].exact = true;
+        return;
+      }
+      Vector2 mid = (cell.min + cell.max) / 2;
+      Vector2 top = TransformT::reverse( Vector2( mid.x(), cell.min.y() ) );
+      Vector2 bottom = TransformT::reverse( Vector2( mid.x(), cell.max.y() ) );
+      Vector2 left = TransformT::reverse( Vector2( cell.min.x(), mid.y() ) );
+      Vector2 right = TransformT::reverse( Vector2( cell.max.x(), mid.y() ) );
+      Vector2 center = TransformT::reverse( mid );
+      double err = norm_2( center - (cell.c00+cell.c10+cell.c01+cell.c11)/4 );
+      err = std::max( err, norm_2( top - (cell.c00+cell.c10)/2 ) );
+      err = std::max( err, norm_2( bottom - (cell.c01+cell.c11)/2 ) );
+      err = std::max( err, norm_2( left - (cell.c00+cell.c01)/2 ) );
+      err = std::max( err, norm_2( right - (cell.c10+cell.c11)/2 ) );
+      // Written this way so that NaNs force a split.
+      if( err <= TransformT::tolerance() ) {
+        m_max_error = std::max( m_max_error, err );
+        return;
+      }
+
+      size_t first = m_cells.size();
+      m_cells[index].child = int32(first);
+      Cell quad[4] = { cell, cell, cell, cell };
+      quad[0].max = mid;                                 quad[0].c10 = top;  quad[0].c01 = left;  quad[0].c11 = center;
+      quad[1].min.x() = mid.x(); quad[1].max.y() = mid.y(); quad[1].c00 = top;  quad[1].c01 = center; quad[1].c11 = right;
+      quad[2].max.x() = mid.x(); quad[2].min.y() = mid.y(); quad[2].c00 = left; quad[2].c10 = center; quad[2].c11 = bottom;
+      quad[3].min = mid;                                 quad[3].c00 = center; quad[3].c10 = right; quad[3].c01 = bottom;
+      for( int i=0; i<4; ++i ) m_cells.push_back( quad[i] );
+      for( int i=0; i<4; ++i ) subdivide( first+i );
+    }
+
+    // Measures the error at the same points as subdivide(), for cells
+    // too small to split.
+    double test_cell( Cell const& cell ) {
+      Vector2 mid = (cell.min + cell.max) / 2;
+      Vector2 points[5] = { mid, Vector2( mid.x(), cell.min.y() ), Vector2( mid.x(), cell.max.y() ),
+                            Vector2( cell.min.x(), mid.y() ), Vector2( cell.max.x(), mid.y() ) };
+      double err = 0;
+      for( int i=0; i<5; ++i ) {
+        double e = norm_2( TransformT::reverse( points[i] ) - bilinear( cell, points[i] ) );
+        if( ! (e <= err) ) err = e;
+      }
+      if( err <= TransformT::tolerance() ) m_max_error = std::max( m_max_error, err );
+      return err;
+    }
+
+    // Points outside the bounding box use the nearest edge cell.
+    Cell const& find_cell( Vector2 const& p ) const {
+      Cell const* cell = &m_cells[0];
+      while( cell->child >= 0 ) {
+        Vector2 mid = (cell->min + cell->max) / 2;
+        cell = &m_cells[ cell->child + (p.x() >= mid.x() ? 1 : 0) + (p.y() >= mid.y() ? 2 : 0) ];
+      }
+      return *cell;
+    }
+
   public:
+    /// Cells are not split below this size, in pixels.
+    static const int32 min_cell_size = 4;
+
     ApproximateTransform( TransformT const& transform, BBox2i const& bbox )
-      : TransformT( transform ), m_bbox( bbox ), m_table(2,2)
+      : TransformT( transform ), m_max_error( 0 )
     {
-      // Initialize with a simple 2x2 lookup table
-      int32 n=2;
-      m_table(0,0) = TransformT::reverse(bbox.min());
-      m_table(1,0) = TransformT::reverse(Vector2(bbox.max().x(),bbox.min().y()));
-      m_table(0,1) = TransformT::reverse(Vector2(bbox.min().x(),bbox.max().y()));
-      m_table(1,1) = TransformT::reverse(bbox.max());
-
-      // Double the grid density until the worst (squared) approximation error
-      // is less than the allowed (squared) tolerance.
-      double max_sqr_err = 0;
-      double tol_sqr = TransformT::tolerance() * TransformT::tolerance();
-      Vector2 origin = bbox.min(), diag = bbox.size();
-      do {
-        n = 2*n-1;
-        // Fall back for unapproximatably crazy transform functions.
-        if( n>=bbox.width()|| n>=bbox.height() ) {
-          m_table.reset();
-          return;
-        }
-        ImageView<Vector2> prev = m_table;
-        m_table.set_size(n,n);
-        max_sqr_err = 0;
-        for( int y=0; y<n; ++y ) {
-          for( int x=0; x<n; ++x ) {
-            if( (y%2)==0 && (x%2==0) ) {
-              m_table(x,y) = prev(x/2,y/2);
-            }
-            else {
-              Vector2 pos = Vector2(x,y)/(n-1);
-              m_table(x,y) = TransformT::reverse(origin+elem_prod(pos,diag));
-              Vector2 interp;
-              if( (y%2)==0 ) interp = (prev(x/2,y/2) + prev(x/2+1,y/2)) / 2.0;
-              else if( (x%2)==0 ) interp = (prev(x/2,y/2) + prev(x/2,y/2+1)) / 2.0;
-              else interp = (prev(x/2,y/2) + prev(x/2,y/2+1) + prev(x/2+1,y/2) + prev(x/2+1,y/2+1)) / 4.0;
-              double sqr_err = norm_2_sqr( m_table(x,y) - interp );
-              if( sqr_err > max_sqr_err ) max_sqr_err = sqr_err;
-            }
-          }
-        }
-      } while( max_sqr_err > tol_sqr );
+      Cell root;
+      root.min = bbox.min();
+      root.max = bbox.max();
+      root.child = -1;
+      root.exact = bbox.width() <= 0 || bbox.height() <= 0;
+      m_cells.push_back( root );
+      if( root.exact ) return;
+      m_cells[0].c00 = TransformT::reverse(bbox.min());
+      m_cells[0].c10 = TransformT::reverse(Vector2(bbox.max().x(),bbox.min().y()));
+      m_cells[0].c01 = TransformT::reverse(Vector2(bbox.min().x(),bbox.max().y()));
+      m_cells[0].c11 = TransformT::reverse(bbox.max());
+      subdivide( 0 );
     }
 
     inline Vector2 reverse( Vector2 const& p ) const {
-      // Fall back if the function was not approximatable.
-      if( ! m_table ) return TransformT::reverse( p );
-
-      // We re-implement bilinear interpolation by hand here because for
-      // some reason the BilinearInterpolation object is exceptionally
-      // slow for Vector data still.
-      int n = m_table.cols() - 1;
-      double px = n * (p.x() - m_bbox.min().x()) / (m_bbox.max().x() - m_bbox.min().x());
-      double py = n * (p.y() - m_bbox.min().y()) / (m_bbox.max().y() - m_bbox.min().y());
-      int32 ix = math::impl::_floor(px);
-      if( ix < 0 ) ix = 0;
-      if( ix >= n ) ix = n-1;
-      int32 iy = math::impl::_floor(py);
-      if( iy < 0 ) iy = 0;
-      if( iy >= n ) iy = n-1;
-      double normx = px-ix, normy = py-iy;
-
-      Vector2 const& m00 = m_table(ix,  iy);
-      Vector2 const& m10 = m_table(ix+1,iy);
-      Vector2 const& m01 = m_table(ix,  iy+1);
-      Vector2 const& m11 = m_table(ix+1,iy+1);
-
-      return Vector2( (m00.x()*(1-normy)+m01.x()*normy)*(1-normx) +
-                      (m10.x()*(1-normy)+m11.x()*normy)*normx,
-                      (m00.y()*(1-normy)+m01.y()*normy)*(1-normx) +
-                      (m10.y()*(1-normy)+m11.y()*normy)*normx );
+      Cell const& cell = find_cell( p );
+      if( cell.exact ) return TransformT::reverse( p );
+      return bilinear( cell, p );
+    }
+
+    // The base transform's version would skip the mesh.
+    void reverse_row( Vector2 const& start, int32 n, Vector2* result ) const {
+      for( int32 i=0; i<n; ++i )
+        result[i] = reverse( Vector2( start.x()+i, start.y() ) );
     }
 
+    /// The largest error measured while building the mesh, in the
+    /// units of the transform's output.  Cells that fall back to the
+    /// real transform contribute no error.
+    double max_error() const { return m_max_error; }
+
+    /// The number of leaf cells in the mesh.
+    size_t num_cells() const { return (m_cells.size() - 1) / 4 * 3 + 1; }
+
     // Never re-approximate the approximation.
     virtual double tolerance() const { return 0; }
 
@@ -603,6 +711,7 @@ namespace vw {
 
     Vector2 forward( Vector2 const& point ) const { return m_transform->forward( point ); }
     Vector2 reverse( Vector2 const& point ) const { return m_transform->reverse( point ); }
+    void reverse_row( Vector2 const& start, int32 n, Vector2* result ) const { m_transform->reverse_row( start, n, result ); }
     FunctionType forward_type() const { return m_transform->forward_type(); }
     FunctionType reverse_type() const { return m_transform->reverse_type(); }
     BBox2i forward_bbox( BBox2i const& bbox ) const { return m_transform->forward_bbox( bbox ); }
@@ -663,10 +772,38 @@ namespace vw {
       if( m_mapper.tolerance() > 0.0 ) {
         ApproximateTransform<TransformT> approx_transform( m_mapper, bbox );
         TransformView<ImageT, ApproximateTransform<TransformT> > approx_view( m_image, approx_transform, m_width, m_height );
-        vw::rasterize( approx_view.prerasterize(bbox), dest, bbox );
+        approx_view.prerasterize(bbox).rasterize_rows( dest, bbox );
       }
       else {
-        vw::rasterize( prerasterize(bbox), dest, bbox );
+        prerasterize(bbox).rasterize_rows( dest, bbox );
+      }
+    }
+
+    // Rasterizes without prerasterizing first, transforming a whole
+    // row of points at a time and interpolating them in one pass.
+    template <class DestT>
+    void rasterize_rows( DestT const& dest, BBox2i const& bbox ) const {
+      typedef typename DestT::pixel_type DestPixelT;
+      typedef typename DestT::pixel_accessor DestAccT;
+      VW_ASSERT( int(dest.cols())==bbox.width() && int(dest.rows())==bbox.height() && dest.planes()==planes(),
+                 ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+      if( bbox.width() <= 0 ) return;
+      std::vector<Vector2> points( bbox.width() );
+      std::vector<pixel_type> samples( bbox.width() );
+      DestAccT drow = dest.origin();
+      for( int32 row=0; row<bbox.height(); ++row ) {
+        m_mapper.reverse_row( Vector2( bbox.min().x(), bbox.min().y()+row ), bbox.width(), &points[0] );
+        DestAccT dplane = drow;
+        for( int32 plane=0; plane<planes(); ++plane ) {
+          InterpolateRow<ImageT>::interpolate( m_image, &points[0], bbox.width(), plane, &samples[0] );
+          DestAccT dcol = dplane;
+          for( int32 col=0; col<bbox.width(); ++col ) {
+            *dcol = DestPixelT(samples[col]);
+            dcol.next_col();
+          }
+          dplane.next_plane();
+        }
+        drow.next_row();
       }
     }
     /// \endcond
@@ -676,6 +813,19 @@ namespace vw {
   // Type Traits
   template <class ImplT, class TransformT>
   struct IsFloatingPointIndexable<TransformView<ImplT, TransformT> > : public true_type {};
+
+  // A transformed view is empty wherever the region of the child it
+  // maps back to is.
+  template <class ImageT, class TransformT>
+  class SparseImageCheck<TransformView<ImageT, TransformT> > {
+    TransformView<ImageT, TransformT> m_view;
+  public:
+    SparseImageCheck( TransformView<ImageT, TransformT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      if( bbox.empty() ) return false;
+      return SparseImageCheck<ImageT>(m_view.child())( m_view.transform().reverse_bbox( bbox ) );
+    }
+  };
   /// \endcond
 
 
@@ -0,0 +1,181 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// BenchImage.cxx
+//
+// Throughput benchmarks for the image view library, on fixed-size
+// synthetic images.  Run by "make benchmark", not by "make check".
+// Each benchmark prints a CSV line: its name, the pixels it produces
+// per run, the runs timed, the fastest run in seconds, and the
+// megapixels per second of the fastest run.
+//
+//   BenchImage [--filter <substring>] [--min-time <seconds>]
+
+#include <vw/Core/Settings.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/Thread.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Image/PerPixelViews.h>
+#include <vw/Image/PixelMath.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/Interpolation.h>
+#include <vw/Image/Transform.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/ImageResource.h>
+#include <vw/Image/UtilityViews.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+
+using namespace vw;
+
+namespace {
+
+  struct Options {
+    std::string filter;
+    double min_time;
+    Options() : min_time(0.5) {}
+  };
+
+  struct WaveFunctor : ReturnFixedType<float32> {
+    float32 operator()( float32 v ) const { return std::sin( v ) * v; }
+  };
+
+  // Rasterizes a view into an image of the right size.
+  template <class ViewT, class DestT>
+  class Rasterize {
+    ViewT m_view;
+    DestT& m_dest;
+  public:
+    Rasterize( ViewT const& view, DestT& dest ) : m_view(view), m_dest(dest) {}
+    void operator()() const { m_dest = m_view; }
+  };
+
+  template <class ViewT, class DestT>
+  Rasterize<ViewT, DestT> rasterize_into( ImageViewBase<ViewT> const& view, DestT& dest ) {
+    return Rasterize<ViewT, DestT>( view.impl(), dest );
+  }
+
+  class Convert {
+    ImageBuffer m_dst, m_src;
+    bool m_rescale;
+  public:
+    Convert( ImageBuffer const& dst, ImageBuffer const& src, bool rescale )
+      : m_dst(dst), m_src(src), m_rescale(rescale) {}
+    void operator()() const { convert( m_dst, m_src, m_rescale ); }
+  };
+
+  // Times func until it has run at least three times and for at least
+  // opt.min_time seconds, after one untimed run.
+  template <class FuncT>
+  void run( Options const& opt, std::string const& name, int64 pixels, FuncT const& func ) {
+    if( !opt.filter.empty() && name.find( opt.filter ) == std::string::npos )
+      return;
+    func();
+    double best = std::numeric_limits<double>::max(), total = 0;
+    int32 runs = 0;
+    while( runs < 3 || total < opt.min_time ) {
+      uint64 start = Stopwatch::microtime();
+      func();
+      double seconds = ( Stopwatch::microtime() - start ) * 1e-6;
+      best = std::min( best, seconds );
+      total += seconds;
+      runs++;
+    }
+    std::cout << name << "," << pixels << "," << runs << "," << best << ","
+              << ( best > 0 ? pixels / best * 1e-6 : 0 ) << std::endl;
+  }
+
+  // A smooth, non-constant image, so that nothing is optimized away.
+  ImageView<float32> synthetic( int32 cols, int32 rows ) {
+    ImageView<float32> image( cols, rows );
+    for( int32 j = 0; j < rows; ++j )
+      for( int32 i = 0; i < cols; ++i )
+        image(i,j) = float32( std::sin( i * 0.01 ) * std::cos( j * 0.013 ) );
+    return image;
+  }
+}
+
+int main( int argc, char *argv[] ) {
+  Options opt;
+  for( int i = 1; i < argc; ++i ) {
+    if( std::strcmp( argv[i], "--filter" ) == 0 && i+1 < argc )
+      opt.filter = argv[++i];
+    else if( std::strcmp( argv[i], "--min-time" ) == 0 && i+1 < argc )
+      opt.min_time = std::atof( argv[++i] );
+    else {
+      std::cerr << "Usage: " << argv[0] << " [--filter <substring>] [--min-time <seconds>]" << std::endl;
+      return 1;
+    }
+  }
+
+  // The thread pool is sized when it is first used, so it must have
+  // room for the most threads the block rasterization runs with.
+  int32 max_threads = std::max( 4, int32( boost::thread::hardware_concurrency() ) );
+  vw_settings().set_default_num_threads( max_threads );
+
+  const int32 size = 2048;
+  const int64 pixels = int64(size) * size;
+  ImageView<float32> src = synthetic( size, size );
+  ImageView<float32> dest( size, size );
+  ImageView<PixelRGB<float32> > rgb( size, size );
+  fill( rgb, PixelRGB<float32>( 0.2f, 0.5f, 0.8f ) );
+  select_channel( rgb, 0 ) = src;
+  ImageView<PixelRGB<uint8> > rgb8( size, size );
+
+  std::cout << "benchmark,pixels,runs,seconds,mpix_per_s" << std::endl;
+
+  // Per-pixel views
+  run( opt, "per_pixel/math", pixels, rasterize_into( src * 2.0f + 1.0f, dest ) );
+  run( opt, "per_pixel/functor", pixels, rasterize_into( per_pixel_filter( src, WaveFunctor() ), dest ) );
+  run( opt, "per_pixel/channel_cast_rescale_rgb", pixels, rasterize_into( channel_cast_rescale<uint8>( rgb ), rgb8 ) );
+  run( opt, "image_view_ref/math", pixels, rasterize_into( ImageViewRef<float32>( src * 2.0f + 1.0f ), dest ) );
+
+  // Convolution
+  run( opt, "convolution/gaussian_separable", pixels, rasterize_into( gaussian_filter( src, 2.0 ), dest ) );
+  ImageView<float32> kernel( 5, 5 );
+  fill( kernel, 1.0f / 25 );
+  run( opt, "convolution/box_5x5", pixels, rasterize_into( convolution_filter( src, kernel ), dest ) );
+
+  // Interpolation
+  run( opt, "interpolation/bilinear", pixels,
+       rasterize_into( translate( src, 0.5, 0.5, ConstantEdgeExtension(), BilinearInterpolation() ), dest ) );
+  run( opt, "interpolation/bicubic", pixels,
+       rasterize_into( translate( src, 0.5, 0.5, ConstantEdgeExtension(), BicubicInterpolation() ), dest ) );
+
+  // Transforms
+  run( opt, "transform/rotate_bilinear", pixels,
+       rasterize_into( transform( src, RotateTransform( 0.3, Vector2( size/2, size/2 ) ),
+                                  size, size, ZeroEdgeExtension(), BilinearInterpolation() ), dest ) );
+  ImageView<float32> half( size/2, size/2 );
+  run( opt, "transform/resample_half", pixels/4,
+       rasterize_into( resample( src, 0.5, ZeroEdgeExtension(), BilinearInterpolation() ), half ) );
+
+  // Block rasterization of a filter, at several thread counts
+  for( int32 threads = 1; threads <= max_threads; threads *= 2 ) {
+    std::ostringstream name;
+    name << "block_rasterize/gaussian_threads_" << threads;
+    run( opt, name.str(), pixels,
+         rasterize_into( block_rasterize( gaussian_filter( src, 2.0 ), Vector2i( 256, 256 ), threads ), dest ) );
+  }
+
+  // ImageBuffer conversion
+  run( opt, "image_buffer/convert_rgb_float32_to_uint8_rescale", pixels, Convert( rgb8.buffer(), rgb.buffer(), true ) );
+  run( opt, "image_buffer/convert_rgb_uint8_to_float32", pixels, Convert( rgb.buffer(), rgb8.buffer(), false ) );
+  ImageView<PixelGray<uint8> > gray8( size, size );
+  run( opt, "image_buffer/convert_rgb_uint8_to_gray_uint8", pixels, Convert( gray8.buffer(), rgb8.buffer(), false ) );
+
+  return 0;
+}
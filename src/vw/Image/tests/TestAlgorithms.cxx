@@ -137,6 +137,39 @@ TEST( Algorithms, Grassfirealpha ) {
   EXPECT_EQ( 1, g(1,2) );
 }
 
+TEST( Algorithms, GrassfireView ) {
+  ImageView<uint8> im(61,47);
+  fill( im, 1 );
+  for( int32 i=0; i<40; ++i )
+    im( (i*37+11)%61, (i*23+5)%47 ) = 0;
+  fill( crop(im,20,10,15,3), 0 );
+  ImageView<int32> expected = grassfire(im);
+
+  for( int32 tile=1; tile<=64; tile = tile*2+1 ) {
+    GrassfireView<ImageView<uint8> > view = block_grassfire( im, tile, 3 );
+    ASSERT_EQ( im.cols(), view.cols() );
+    ASSERT_EQ( im.rows(), view.rows() );
+    ImageView<int32> result = view;
+    for( int32 y=0; y<im.rows(); ++y )
+      for( int32 x=0; x<im.cols(); ++x )
+        ASSERT_EQ( expected(x,y), result(x,y) ) << "tile " << tile << " at " << x << "," << y;
+
+    ImageView<int32> part = crop( view, 7, 9, 30, 20 );
+    for( int32 y=0; y<part.rows(); ++y )
+      for( int32 x=0; x<part.cols(); ++x )
+        ASSERT_EQ( expected(x+7,y+9), part(x,y) );
+    EXPECT_EQ( expected(33,22), view(33,22) );
+  }
+
+  // With no zeros, this is the distance to the outside.
+  ImageView<uint8> ones(7,2);
+  fill( ones, 1 );
+  ImageView<int32> g = block_grassfire( ones, 3 );
+  for( int32 y=0; y<2; ++y )
+    for( int32 x=0; x<7; ++x )
+      EXPECT_EQ( 1, g(x,y) );
+}
+
 TEST( Algorithms, BoundingBox ) {
   ImageView<PixelT> im(2,5);
   BBox2i b1 = bounding_box(im);
@@ -227,6 +260,45 @@ TEST( Algorithms, BlobIndex ) {
   EXPECT_NE( idx(6,2), idx(1,1) );
 }
 
+TEST( Algorithms, BlobStatistics ) {
+  typedef PixelMask<uint8> MPx;
+  ImageView<MPx> im(53,41);
+  for( int32 y=0; y<im.rows(); ++y )
+    for( int32 x=0; x<im.cols(); ++x )
+      if( (x*x*7 + y*13 + x*y) % 5 == 0 ) im(x,y) = MPx(1);
+  fill( crop(im,3,20,40,1), MPx(2) );
+
+  ImageView<uint32> idx = blob_index( im );
+  uint32 count = max_channel_value( idx );
+  std::vector<uint64> area( count+1, 0 );
+  std::vector<BBox2i> bbox( count+1 );
+  std::vector<Vector2i> first( count+1, Vector2i(-1,-1) );
+  for( int32 y=0; y<im.rows(); ++y )
+    for( int32 x=0; x<im.cols(); ++x ) {
+      uint32 l = idx(x,y);
+      if( l == 0 ) continue;
+      if( area[l]++ == 0 ) first[l] = Vector2i(x,y);
+      bbox[l].grow( Vector2i(x,y) );
+    }
+
+  for( int32 tile=1; tile<=64; tile = tile*2+1 ) {
+    std::vector<BlobStatistics> blobs = blob_statistics( im, tile, 3 );
+    ASSERT_EQ( count, blobs.size() ) << "tile " << tile;
+    for( size_t i=0; i<blobs.size(); ++i ) {
+      uint32 l = idx( blobs[i].first.x(), blobs[i].first.y() );
+      ASSERT_NE( 0u, l );
+      EXPECT_EQ( first[l], blobs[i].first );
+      EXPECT_EQ( area[l], blobs[i].area );
+      EXPECT_EQ( bbox[l].min(), blobs[i].bbox.min() );
+      EXPECT_EQ( bbox[l].max() + Vector2i(1,1), blobs[i].bbox.max() );
+      if( i ) EXPECT_TRUE( blobs[i-1].first.y() < blobs[i].first.y() ||
+                           ( blobs[i-1].first.y() == blobs[i].first.y() && blobs[i-1].first.x() < blobs[i].first.x() ) );
+    }
+  }
+
+  EXPECT_TRUE( blob_statistics( ImageView<MPx>(5,5) ).empty() );
+}
+
 TEST( Algorithms, MeanFillTransparent ) {
   typedef PixelGrayA<uint8> Px8;
   typedef PixelRGBA<float32> PxF;
@@ -8,6 +8,9 @@
 #include <gtest/gtest.h>
 #include <test/Helpers.h>
 #include <vw/Image/BlockRasterize.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/ImageResourceView.h>
+#include <vw/Image/ViewImageResource.h>
 
 using namespace vw;
 using namespace std;
@@ -34,3 +37,103 @@ TEST(BlockRasterize, Basic) {
   img2 = b4;
   EXPECT_RANGE_EQ(img1.begin(), img1.end(), img2.begin(), img2.end());
 }
+
+TEST(BlockRasterize, Nested) {
+  typedef ImageView<uint32> Image;
+  Image img1(16,16), img2;
+  for (int32 j=0; j<img1.rows(); ++j)
+    for (int32 i=0; i<img1.cols(); ++i)
+      img1(i,j) = j*img1.cols()+i;
+
+  // Every level asks for more threads than the pool has; the blocks
+  // still all get rasterized without the levels starving each other.
+  BlockRasterizeView<BlockRasterizeView<BlockRasterizeView<Image> > > b =
+    block_rasterize(block_rasterize(block_rasterize(img1, Vector2i(2,2), 8), Vector2i(4,4), 8), Vector2i(8,8), 8);
+
+  for (int k=0; k<10; ++k) {
+    img2 = b;
+    EXPECT_RANGE_EQ(img1.begin(), img1.end(), img2.begin(), img2.end());
+  }
+}
+
+TEST(BlockRasterize, Prefetch) {
+  typedef ImageView<uint32> Image;
+  Image img1(8,8), img2;
+  for (int32 j=0; j<img1.rows(); ++j)
+    for (int32 i=0; i<img1.cols(); ++i)
+      img1(i,j) = j*img1.cols()+i;
+
+  Cache cache(1024*1024);
+  BlockRasterizeView<Image> b = block_cache(img1, Vector2i(4,4), 1, cache);
+
+  // The top two blocks, through the type-erased interface.
+  ImageViewRef<uint32> ref = b;
+  prefetch(ref, BBox2i(0,0,8,1));
+  vw_thread_pool().join_all();
+  EXPECT_EQ(2u, cache.misses());
+
+  // Prefetching cached blocks again does nothing.
+  prefetch(b, BBox2i(0,0,8,4));
+  vw_thread_pool().join_all();
+  EXPECT_EQ(2u, cache.misses());
+
+  img2 = crop(b, BBox2i(0,0,8,4));
+  EXPECT_EQ(2u, cache.misses());
+  EXPECT_EQ(2u, cache.hits());
+  EXPECT_RANGE_EQ(crop(img1,BBox2i(0,0,8,4)).begin(), crop(img1,BBox2i(0,0,8,4)).end(), img2.begin(), img2.end());
+
+  // Without a cache there is nothing to prefetch into.
+  prefetch(block_rasterize(img1, Vector2i(4,4), 1), BBox2i(0,0,8,8));
+  EXPECT_EQ(2u, cache.misses());
+}
+
+TEST(BlockRasterize, ReadAhead) {
+  typedef ImageView<uint32> Image;
+  Image img1(16,16), img2;
+  for (int32 j=0; j<img1.rows(); ++j)
+    for (int32 i=0; i<img1.cols(); ++i)
+      img1(i,j) = j*img1.cols()+i;
+
+  uint32 depth = vw_settings().io_queue_depth();
+  vw_settings().set_io_queue_depth(2);
+
+  // The blocks of a resource view are read ahead, but only within
+  // the region being rasterized.
+  Cache cache(1024*1024);
+  ImageResourceView<uint32> rsrc(new ViewImageResource(img1));
+  BlockRasterizeView<ImageResourceView<uint32> > b = block_cache(rsrc, Vector2i(4,4), 1, cache);
+  img2 = crop(b, BBox2i(4,4,12,4));
+  vw_io_thread_pool().join_all();
+  EXPECT_EQ(3u, cache.misses());
+  EXPECT_RANGE_EQ(crop(img1,BBox2i(4,4,12,4)).begin(), crop(img1,BBox2i(4,4,12,4)).end(), img2.begin(), img2.end());
+
+  img2 = b;
+  vw_io_thread_pool().join_all();
+  EXPECT_EQ(16u, cache.misses());
+  EXPECT_RANGE_EQ(img1.begin(), img1.end(), img2.begin(), img2.end());
+
+  vw_settings().set_io_queue_depth(depth);
+}
+
+TEST(BlockRasterize, DefaultBlockSize) {
+  // A wide float image is cut into square tiles of the consumer's size.
+  EXPECT_VECTOR_EQ(Vector2i(256,256), default_block_size(10000, 10000, 4, Vector2i(), 256));
+  // Square tiles are kept within the block budget.
+  EXPECT_VECTOR_EQ(Vector2i(512,512), default_block_size(10000, 10000, 8, Vector2i(), 1024));
+  // A narrow image gets full-width blocks no taller than a tile, and
+  // one that fits in a block is not split at all.
+  EXPECT_VECTOR_EQ(Vector2i(200,256), default_block_size(200, 10000, 4, Vector2i(), 256));
+  EXPECT_VECTOR_EQ(Vector2i(100,100), default_block_size(100, 100, 4, Vector2i(), 256));
+  // Tiled children get whole tiles, strip children whole strips.
+  EXPECT_VECTOR_EQ(Vector2i(256,256), default_block_size(10000, 10000, 4, Vector2i(128,128), 256));
+  EXPECT_VECTOR_EQ(Vector2i(512,512), default_block_size(10000, 10000, 4, Vector2i(512,512), 256));
+  EXPECT_VECTOR_EQ(Vector2i(10000,48), default_block_size(10000, 10000, 4, Vector2i(10000,16), 256));
+  // Small images are not padded out.
+  EXPECT_VECTOR_EQ(Vector2i(16,16), default_block_size(16, 16, 4, Vector2i(), 256));
+
+  ImageView<float> img(1000,1000);
+  BlockRasterizeView<ImageView<float> > b(img, Vector2i());
+  EXPECT_VECTOR_EQ(Vector2i(vw_settings().default_tile_size(),vw_settings().default_tile_size()), b.block_size());
+  BlockRasterizeView<BlockRasterizeView<ImageView<float> > > nested(b, Vector2i());
+  EXPECT_VECTOR_EQ(b.block_size(), nested.block_size());
+}
@@ -208,3 +208,50 @@ TEST( Convolution, Prerasterize ) {
   EXPECT_EQ(right_buf(1000,100), 0.0);
   EXPECT_EQ(right_buf(900,100), 1.0);
 }
+
+// The vectorized path must agree with the generic one, which a double
+// kernel forces.  The kernel weights and pixel values are chosen so
+// that both sums are exact; the widths exercise the scalar tails, and
+// the weights both clamping limits.
+template <class PixelT>
+static void test_fast_convolution( int32 cols, int32 rows, bool use_i, bool use_j ) {
+  typedef typename CompoundChannelType<PixelT>::type channel_type;
+  ImageView<PixelT> src( cols, rows );
+  for( int32 y=0; y<rows; ++y )
+    for( int32 x=0; x<cols; ++x )
+      for( int32 c=0; c<int32(CompoundNumChannels<PixelT>::value); ++c )
+        compound_select_channel<channel_type&>( src(x,y), c ) = channel_type( (x*37 + y*101 + c*59) % 256 );
+
+  std::vector<float> ik, jk;
+  if( use_i ) { ik.push_back(0.25); ik.push_back(1.5); ik.push_back(0.5); ik.push_back(-0.75); ik.push_back(0.125); }
+  if( use_j ) { jk.push_back(0.5); jk.push_back(1); jk.push_back(-0.25); }
+  std::vector<double> ikd( ik.begin(), ik.end() ), jkd( jk.begin(), jk.end() );
+
+  ImageView<PixelT> fast = separable_convolution_filter( src, ik, jk );
+  ImageView<PixelT> generic = separable_convolution_filter( src, ikd, jkd );
+  ImageView<PixelT> cropped( cols, rows );
+  BBox2i bbox( 3, 2, cols-5, rows-4 );
+  separable_convolution_filter( src, ik, jk ).rasterize( crop( cropped, bbox ), bbox );
+
+  for( int32 y=0; y<rows; ++y )
+    for( int32 x=0; x<cols; ++x ) {
+      EXPECT_PIXEL_EQ( fast(x,y), generic(x,y) );
+      if( bbox.contains( Vector2i(x,y) ) )
+        EXPECT_PIXEL_EQ( cropped(x,y), generic(x,y) );
+    }
+}
+
+TEST( Convolution, FastSeparable ) {
+  EXPECT_TRUE(( HasFastConvolution<float, float>::value ));
+  EXPECT_TRUE(( HasFastConvolution<PixelRGB<uint8>, float>::value ));
+  EXPECT_FALSE(( HasFastConvolution<float, double>::value ));
+  EXPECT_FALSE(( HasFastConvolution<PixelMask<float>, float>::value ));
+  EXPECT_TRUE( fast_convolution_isa() != 0 );
+
+  test_fast_convolution<float>( 37, 21, true, true );
+  test_fast_convolution<uint8>( 37, 21, true, true );
+  test_fast_convolution<uint16>( 16, 5, true, true );
+  test_fast_convolution<PixelRGB<uint8> >( 29, 13, true, true );
+  test_fast_convolution<PixelGray<float> >( 40, 9, true, false );
+  test_fast_convolution<uint8>( 40, 9, false, true );
+}
@@ -408,6 +408,48 @@ TEST( EdgeExtension, Linear ) {
   EXPECT_BBOX( ee.source_bbox(im,BBox2i(2,3,2,2)), 0,1,2,2 );
 }
 
+// Rasterizing a region must agree with the pixels of the view, whether
+// the region lies inside the child, outside it, or across its edges.
+template <class ViewT>
+static void check_rasterize( ViewT const& view, BBox2i const& bbox ) {
+  ImageView<typename ViewT::pixel_type> result( bbox.width(), bbox.height() );
+  view.rasterize( result, bbox );
+  for( int32 j=0; j<bbox.height(); ++j )
+    for( int32 i=0; i<bbox.width(); ++i )
+      ASSERT_EQ( view(bbox.min().x()+i,bbox.min().y()+j), result(i,j) )
+        << "at " << i << "," << j << " of " << bbox;
+}
+
+template <class ViewT>
+static void check_rasterize( ViewT const& view ) {
+  check_rasterize( view, BBox2i(-3,-2,10,9) );
+  check_rasterize( view, BBox2i(1,1,2,2) );
+  check_rasterize( view, BBox2i(0,0,4,3) );
+  check_rasterize( view, BBox2i(-5,-5,3,2) );
+  check_rasterize( view, BBox2i(6,1,3,2) );
+  check_rasterize( view, BBox2i(2,-2,1,8) );
+  check_rasterize( view, BBox2i(-1,1,7,1) );
+  check_rasterize( view, BBox2i(3,2,2,2) );
+}
+
+TEST( EdgeExtension, Rasterize ) {
+  ImageView<double> im(4,3);
+  for( int32 j=0; j<im.rows(); ++j )
+    for( int32 i=0; i<im.cols(); ++i )
+      im(i,j) = 1 + i + 10*j;
+
+  check_rasterize( edge_extend(im, ZeroEdgeExtension()) );
+  check_rasterize( edge_extend(im, ConstantEdgeExtension()) );
+  check_rasterize( edge_extend(im, PeriodicEdgeExtension()) );
+  check_rasterize( edge_extend(im, CylindricalEdgeExtension()) );
+  check_rasterize( edge_extend(im, ReflectEdgeExtension()) );
+  check_rasterize( edge_extend(im, LinearEdgeExtension()) );
+
+  // An offset view, and a child that is not an ImageView
+  check_rasterize( edge_extend(im, BBox2i(-2,-1,9,6), ConstantEdgeExtension()) );
+  check_rasterize( edge_extend(edge_extend(im, ReflectEdgeExtension()), BBox2i(1,1,2,2), ZeroEdgeExtension()) );
+}
+
 template <class PixelT>
 class FloatingView : public ImageViewBase<FloatingView<PixelT> > {
   int32 m_cols, m_rows, m_planes;
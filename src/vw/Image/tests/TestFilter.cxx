@@ -11,6 +11,7 @@
 #include <vw/Image/Filter.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/PixelTypes.h>
+#include <vw/Image/Algorithms.h>
 
 #include <vector>
 
@@ -245,3 +246,159 @@ TEST( Filter, SepConv22Box ) {
     EXPECT_EQ( dst(1,1), 1 );
   }
 }
+
+TEST( Filter, RecursiveGaussian ) {
+  ImageView<float> src(120,90);
+  for( int32 y=0; y<src.rows(); ++y )
+    for( int32 x=0; x<src.cols(); ++x )
+      src(x,y) = float( (x/10 + y/15) % 2 ) + 0.01f*float(x);
+
+  // The recursive filter approximates the exact kernel, for small and
+  // large sigmas and unequal ones.
+  double sigmas[][2] = { {1.0,1.0}, {2.0,3.5}, {8.0,8.0}, {0.0,5.0} };
+  for( int i=0; i<4; ++i ) {
+    ImageView<float> exact = gaussian_filter( src, sigmas[i][0], sigmas[i][1] );
+    ImageView<float> fast = recursive_gaussian_filter( src, sigmas[i][0], sigmas[i][1] );
+    EXPECT_EQ( fast.cols(), src.cols() );
+    EXPECT_EQ( fast.rows(), src.rows() );
+    double max_err = 0;
+    for( int32 y=0; y<src.rows(); ++y )
+      for( int32 x=0; x<src.cols(); ++x )
+        max_err = std::max( max_err, double(fabs( fast(x,y) - exact(x,y) )) );
+    EXPECT_LT( max_err, 0.05 ) << "sigma " << sigmas[i][0] << "," << sigmas[i][1];
+
+    // Rasterizing a block filters a margin around it, so it agrees with
+    // the whole image up to the tail of the filter beyond the margin.
+    BBox2i bbox( 30, 20, 40, 35 );
+    ImageView<float> block = crop( recursive_gaussian_filter( src, sigmas[i][0], sigmas[i][1] ), bbox );
+    for( int32 y=0; y<bbox.height(); ++y )
+      for( int32 x=0; x<bbox.width(); ++x )
+        EXPECT_NEAR( block(x,y), fast(x+bbox.min().x(),y+bbox.min().y()), 5e-3 );
+  }
+
+  // Constant images stay constant, and a sigma of zero leaves the
+  // image alone.
+  ImageView<PixelRGB<uint8> > rgb(20,20);
+  fill( rgb, PixelRGB<uint8>(10,200,255) );
+  ImageView<PixelRGB<uint8> > rgb_blur = recursive_gaussian_filter( rgb, 30.0 );
+  EXPECT_NEAR( rgb_blur(3,17).r(), 10, 1 );
+  EXPECT_NEAR( rgb_blur(3,17).g(), 200, 1 );
+  EXPECT_NEAR( rgb_blur(3,17).b(), 255, 1 );
+  ImageView<float> same = recursive_gaussian_filter( src, 0.0, 0.0, ZeroEdgeExtension() );
+  EXPECT_EQ( same(7,9), src(7,9) );
+
+  // Single pixels match the rasterized view.
+  ImageView<float> blur = recursive_gaussian_filter( src, 2.0 );
+  EXPECT_NEAR( recursive_gaussian_filter( src, 2.0 )(60,45), blur(60,45), 1e-4 );
+}
+
+// The mean or median of each window of an image, computed directly.
+template <class PixelT>
+static ImageView<PixelT> brute_force_filter( ImageView<PixelT> const& src, int32 size, bool median ) {
+  typedef typename CompoundChannelType<PixelT>::type channel_type;
+  const int32 channels = CompoundNumChannels<PixelT>::value, half = size/2;
+  ImageView<PixelT> result( src.cols(), src.rows() );
+  EdgeExtensionView<ImageView<PixelT>,ConstantEdgeExtension> ext = edge_extend( src, ConstantEdgeExtension() );
+  for( int32 y=0; y<src.rows(); ++y )
+    for( int32 x=0; x<src.cols(); ++x )
+      for( int32 c=0; c<channels; ++c ) {
+        std::vector<double> window;
+        for( int32 k=-half; k<=half; ++k )
+          for( int32 j=-half; j<=half; ++j )
+            window.push_back( double( compound_select_channel<channel_type>( ext(x+j,y+k), c ) ) );
+        double value;
+        if( median ) {
+          std::sort( window.begin(), window.end() );
+          value = window[window.size()/2];
+        }
+        else {
+          value = 0;
+          for( size_t i=0; i<window.size(); ++i ) value += window[i];
+          value /= double(window.size());
+        }
+        compound_select_channel<channel_type&>( result(x,y), c ) = channel_cast_round_and_clamp_if_int<channel_type>( value );
+      }
+  return result;
+}
+
+template <class PixelT>
+static ImageView<PixelT> filter_test_image( int32 cols, int32 rows ) {
+  typedef typename CompoundChannelType<PixelT>::type channel_type;
+  ImageView<PixelT> image( cols, rows );
+  for( int32 y=0; y<rows; ++y )
+    for( int32 x=0; x<cols; ++x )
+      for( int32 c=0; c<CompoundNumChannels<PixelT>::value; ++c )
+        compound_select_channel<channel_type&>( image(x,y), c ) = channel_type( (x*37 + y*101 + x*y*7 + c*53) % 256 );
+  return image;
+}
+
+template <class ViewT, class PixelT>
+static void expect_filter_eq( ImageViewBase<ViewT> const& view, ImageView<PixelT> const& expected, double tol ) {
+  typedef typename CompoundChannelType<PixelT>::type channel_type;
+  ImageView<PixelT> result = view.impl();
+  ASSERT_EQ( expected.cols(), result.cols() );
+  ASSERT_EQ( expected.rows(), result.rows() );
+  for( int32 y=0; y<result.rows(); ++y )
+    for( int32 x=0; x<result.cols(); ++x )
+      for( int32 c=0; c<CompoundNumChannels<PixelT>::value; ++c )
+        ASSERT_NEAR( double( compound_select_channel<channel_type>( expected(x,y), c ) ),
+                     double( compound_select_channel<channel_type>( result(x,y), c ) ), tol ) << "at " << x << "," << y << " channel " << c;
+}
+
+TEST( Filter, MeanFilter ) {
+  ImageView<uint8> gray = filter_test_image<uint8>( 23, 17 );
+  expect_filter_eq( mean_filter<3>( gray ), brute_force_filter( gray, 3, false ), 0 );
+  expect_filter_eq( mean_filter<5>( gray ), brute_force_filter( gray, 5, false ), 0 );
+  expect_filter_eq( mean_filter<7>( gray ), brute_force_filter( gray, 7, false ), 0 );
+  expect_filter_eq( mean_filter( gray, 9 ), brute_force_filter( gray, 9, false ), 0 );
+  expect_filter_eq( mean_filter( gray, 1 ), gray, 0 );
+
+  ImageView<float> flt = channel_cast<float>( filter_test_image<uint8>( 19, 21 ) );
+  expect_filter_eq( mean_filter<5>( flt ), brute_force_filter( flt, 5, false ), 1e-4 );
+  expect_filter_eq( mean_filter( flt, 11 ), brute_force_filter( flt, 11, false ), 1e-4 );
+
+  ImageView<PixelRGB<uint16> > rgb = filter_test_image<PixelRGB<uint16> >( 12, 14 );
+  expect_filter_eq( mean_filter<3>( rgb ), brute_force_filter( rgb, 3, false ), 0 );
+  expect_filter_eq( mean_filter( rgb, 5 ), brute_force_filter( rgb, 5, false ), 0 );
+
+  // Blocks and single pixels agree with the whole image.
+  ImageView<uint8> whole = mean_filter<5>( gray );
+  ImageView<uint8> block = crop( mean_filter<5>( gray ), BBox2i(4,3,9,8) );
+  EXPECT_EQ( whole(6,7), block(2,4) );
+  EXPECT_EQ( whole(11,2), mean_filter( gray, 5 )(11,2) );
+  EXPECT_EQ( whole(0,0), mean_filter<5>( gray, ConstantEdgeExtension() )(0,0) );
+
+  EXPECT_THROW( mean_filter( gray, 4 ), ArgumentErr );
+}
+
+TEST( Filter, MedianFilter ) {
+  ImageView<uint8> gray = filter_test_image<uint8>( 23, 17 );
+  expect_filter_eq( median_filter<3>( gray ), brute_force_filter( gray, 3, true ), 0 );
+  expect_filter_eq( median_filter<5>( gray ), brute_force_filter( gray, 5, true ), 0 );
+  expect_filter_eq( median_filter<7>( gray ), brute_force_filter( gray, 7, true ), 0 );
+  expect_filter_eq( median_filter( gray, 3 ), brute_force_filter( gray, 3, true ), 0 );
+  expect_filter_eq( median_filter( gray, 9 ), brute_force_filter( gray, 9, true ), 0 );
+  expect_filter_eq( median_filter( gray, 1 ), gray, 0 );
+
+  // The histogram path for 8-bit channels, and partial sorting for others.
+  ImageView<PixelRGB<uint8> > rgb = filter_test_image<PixelRGB<uint8> >( 15, 12 );
+  expect_filter_eq( median_filter<3>( rgb ), brute_force_filter( rgb, 3, true ), 0 );
+  expect_filter_eq( median_filter( rgb, 7 ), brute_force_filter( rgb, 7, true ), 0 );
+  ImageView<float> flt = channel_cast<float>( filter_test_image<uint8>( 19, 21 ) );
+  expect_filter_eq( median_filter<3>( flt ), brute_force_filter( flt, 3, true ), 0 );
+  expect_filter_eq( median_filter<5>( flt ), brute_force_filter( flt, 5, true ), 0 );
+  expect_filter_eq( median_filter( flt, 7 ), brute_force_filter( flt, 7, true ), 0 );
+
+  // A single outlier disappears.
+  ImageView<float> flat( 9, 9 );
+  fill( flat, 2.0f );
+  flat(4,4) = 100;
+  EXPECT_EQ( 2.0f, median_filter<3>( flat )(4,4) );
+
+  ImageView<uint8> whole = median_filter( gray, 5 );
+  ImageView<uint8> block = crop( median_filter( gray, 5 ), BBox2i(4,3,9,8) );
+  EXPECT_EQ( whole(6,7), block(2,4) );
+  EXPECT_EQ( whole(11,2), median_filter<5>( gray )(11,2) );
+
+  EXPECT_THROW( median_filter( gray, 0 ), ArgumentErr );
+}
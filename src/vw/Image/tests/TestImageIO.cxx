@@ -0,0 +1,202 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// TestImageIO.h
+#include <gtest/gtest.h>
+
+#include <vw/Core/Thread.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/ImageIO.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/UtilityViews.h>
+
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::test;
+
+// An encoded block that just holds a copy of the pixels.
+struct CopiedBlock : public EncodedBlock {
+  ImageView<float> pixels;
+  CopiedBlock( BBox2i const& bbox ) : EncodedBlock(bbox) {}
+  virtual size_t size() const { return pixels.cols() * pixels.rows() * sizeof(float); }
+};
+
+// A resource that encodes blocks apart from writing them, and keeps
+// track of the order of the writes.
+class EncodingDstResource : public DstImageResource {
+  ImageView<float> m_image;
+  Vector2i m_block_size;
+  bool m_random;
+  mutable Mutex m_mutex;
+public:
+  int encoded;
+  std::vector<BBox2i> written;
+
+  EncodingDstResource( ImageView<float> const& image, Vector2i const& block_size, bool random = false )
+    : m_image(image), m_block_size(block_size), m_random(random), encoded(0) {}
+  size_t written_count() const {
+    Mutex::Lock lock( m_mutex );
+    return written.size();
+  }
+  virtual void write( ImageBuffer const& buf, BBox2i const& bbox ) {
+    write_encoded( *encode( buf, bbox ) );
+  }
+  virtual bool has_block_encode() const { return true; }
+  virtual boost::shared_ptr<EncodedBlock> encode( ImageBuffer const& buf, BBox2i const& bbox ) const {
+    boost::shared_ptr<CopiedBlock> block( new CopiedBlock( bbox ) );
+    block->pixels.set_size( bbox.width(), bbox.height() );
+    convert( block->pixels.buffer(), buf );
+    Mutex::Lock lock( m_mutex );
+    ++const_cast<EncodingDstResource*>( this )->encoded;
+    return block;
+  }
+  virtual void write_encoded( EncodedBlock const& block ) {
+    crop( m_image, block.bbox ) = dynamic_cast<CopiedBlock const&>( block ).pixels;
+    Mutex::Lock lock( m_mutex );
+    written.push_back( block.bbox );
+  }
+  virtual bool has_random_block_write() const { return m_random; }
+  virtual bool has_block_write() const { return true; }
+  virtual Vector2i block_write_size() const { return m_block_size; }
+  virtual bool has_nodata_write() const { return false; }
+  virtual void flush() {}
+};
+
+// Holds up the pixels marked -1 until the resource has written the
+// given number of blocks, or a few seconds have passed.
+class StallFunctor : public ReturnFixedType<float> {
+  EncodingDstResource const* m_resource;
+  size_t m_count;
+public:
+  StallFunctor( EncodingDstResource const* resource, size_t count ) : m_resource(resource), m_count(count) {}
+  float operator()( float value ) const {
+    if( value != -1 ) return value;
+    for( int i = 0; i < 300 && m_resource->written_count() < m_count; ++i )
+      Thread::sleep_ms( 10 );
+    return 0;
+  }
+};
+
+TEST( ImageIO, EncodedBlockWrite ) {
+  ImageView<float> source( 50, 40 );
+  for( int32 j = 0; j < source.rows(); ++j )
+    for( int32 i = 0; i < source.cols(); ++i )
+      source(i,j) = i + 100*j;
+
+  ImageView<float> result( 50, 40 );
+  EncodingDstResource resource( result, Vector2i(16,16) );
+  block_write_image( resource, source );
+
+  // Every block is encoded, and the blocks are written in order.
+  EXPECT_EQ( 12, resource.encoded );
+  ASSERT_EQ( 12u, resource.written.size() );
+  for( size_t i = 0; i < resource.written.size(); ++i )
+    EXPECT_EQ( Vector2i( 16*(i%4), 16*(i/4) ), resource.written[i].min() );
+  EXPECT_VW_EQ( source, result );
+}
+
+TEST( ImageIO, RandomBlockWrite ) {
+  // The other blocks need a thread of their own.
+  if( vw_settings().default_num_threads() < 2 )
+    return;
+
+  ImageView<float> source( 50, 40 );
+  fill( source, 2.0f );
+  source(0,0) = -1;
+
+  // The first block is held up until all of the others are written.
+  ImageView<float> result( 50, 40 );
+  EncodingDstResource resource( result, Vector2i(16,16), true );
+  block_write_image( resource, per_pixel_filter( source, StallFunctor( &resource, 11 ) ) );
+  ASSERT_EQ( 12u, resource.written.size() );
+  EXPECT_EQ( Vector2i(0,0), resource.written.back().min() );
+  EXPECT_EQ( 0, result(0,0) );
+  EXPECT_EQ( 2, result(49,39) );
+}
+
+TEST( ImageIO, EncodedBlockWriteMemoryLimit ) {
+  // A limit smaller than one block still lets the blocks through,
+  // one at a time.
+  size_t limit = vw_settings().write_pool_memory();
+  vw_settings().set_write_pool_memory( 100 );
+
+  ImageView<float> result( 50, 40 );
+  EncodingDstResource resource( result, Vector2i(16,16) );
+  block_write_image( resource, constant_view( 3.0f, 50, 40 ) );
+  EXPECT_EQ( 12u, resource.written.size() );
+  EXPECT_VW_EQ( ImageView<float>( constant_view( 3.0f, 50, 40 ) ), result );
+
+  vw_settings().set_write_pool_memory( limit );
+}
+
+// A resource without block writes that takes strips of rows from the
+// top down, as the PNG and JPEG resources do.
+class SequentialDstResource : public DstImageResource {
+  ImageView<float> m_image;
+public:
+  std::vector<BBox2i> written;
+
+  SequentialDstResource( ImageView<float> const& image ) : m_image(image) {}
+  virtual void write( ImageBuffer const& buf, BBox2i const& bbox ) {
+    int32 next_row = written.empty() ? 0 : written.back().max().y();
+    VW_ASSERT( bbox.width() == m_image.cols() && bbox.min().y() == next_row,
+               NoImplErr() << "SequentialDstResource: out of order write" );
+    ImageView<float> strip( bbox.width(), bbox.height() );
+    convert( strip.buffer(), buf );
+    crop( m_image, bbox ) = strip;
+    written.push_back( bbox );
+  }
+  virtual bool has_block_write() const { return false; }
+  virtual bool has_sequential_write() const { return true; }
+  virtual bool has_nodata_write() const { return false; }
+  virtual void flush() {}
+};
+
+TEST( ImageIO, SequentialWrite ) {
+  uint32 tile_size = vw_settings().default_tile_size();
+  vw_settings().set_default_tile_size( 16 );
+
+  ImageView<float> source( 50, 40 );
+  for( int32 j = 0; j < source.rows(); ++j )
+    for( int32 i = 0; i < source.cols(); ++i )
+      source(i,j) = i + 100*j;
+
+  // Both writers stream a view through in strips, in order.
+  for( int32 threaded = 0; threaded < 2; ++threaded ) {
+    ImageView<float> result( 50, 40 );
+    SequentialDstResource resource( result );
+    if( threaded ) block_write_image( resource, crop( source, 0, 0, 50, 40 ) );
+    else write_image( resource, crop( source, 0, 0, 50, 40 ) );
+    ASSERT_EQ( 3u, resource.written.size() );
+    EXPECT_EQ( BBox2i(0,0,50,16), resource.written[0] );
+    EXPECT_EQ( BBox2i(0,16,50,16), resource.written[1] );
+    EXPECT_EQ( BBox2i(0,32,50,8), resource.written[2] );
+    EXPECT_VW_EQ( source, result );
+  }
+
+  vw_settings().set_default_tile_size( tile_size );
+}
+
+TEST( ImageIO, MemorySemaphore ) {
+  MemorySemaphore semaphore( 100 );
+
+  // A block larger than the limit is admitted when nothing is held.
+  semaphore.wait( 150 );
+  EXPECT_EQ( 150u, semaphore.held() );
+  semaphore.notify( 150 );
+  EXPECT_EQ( 0u, semaphore.held() );
+
+  semaphore.wait( 60 );
+  semaphore.wait( 40 );
+  EXPECT_EQ( 100u, semaphore.held() );
+  semaphore.notify( 60 );
+  semaphore.notify( 40 );
+  EXPECT_EQ( 0u, semaphore.held() );
+}
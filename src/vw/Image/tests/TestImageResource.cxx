@@ -9,8 +9,11 @@
 
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/ImageResourceImpl.h>
+#include <vw/Image/ImageResourceView.h>
+#include <vw/Image/ViewImageResource.h>
 #include <vw/Image/PixelTypeInfo.h>
 #include <vw/Image/PixelTypes.h>
+#include <vw/Image/PixelMask.h>
 
 #include <test/Helpers.h>
 
@@ -29,6 +32,28 @@ namespace fs = boost::filesystem;
 using namespace vw;
 using namespace vw::test;
 
+TEST( ImageResource, AsyncRead ) {
+  ImageView<float> image(20,10);
+  for( int32 j=0; j<image.rows(); ++j )
+    for( int32 i=0; i<image.cols(); ++i )
+      image(i,j) = float(i + 100*j);
+
+  ImageResourceView<float> view( new ViewImageResource( image ) );
+  ImageView<double> block(8,4);
+  AsyncRead read = view.read_async( block.buffer(), BBox2i(5,3,8,4) );
+  read.wait();
+  EXPECT_TRUE( read.done() );
+  for( int32 j=0; j<4; ++j )
+    for( int32 i=0; i<8; ++i )
+      EXPECT_EQ( image(i+5,j+3), block(i,j) );
+
+  // The error of a failed read is raised by wait().
+  AsyncRead bad = view.read_async( block.buffer(), BBox2i(15,3,8,4) );
+  EXPECT_THROW( bad.wait(), IOErr );
+
+  EXPECT_TRUE( AsyncRead().done() );
+}
+
 // This tests whether premultiplication preserves integer data.
 TEST( ImageResource, PreMultiply ) {
   typedef PixelGrayA<uint16> Px;
@@ -63,6 +88,118 @@ TEST( ImageResource, PreMultiply ) {
   EXPECT_RANGE_EQ(buf3_data+0, buf3_data+4, buf1_data+0, buf1_data+4);
 }
 
+// Conversions that keep the pixel format go a row (or a pixel) of
+// channels at a time.
+TEST( ImageResource, ConvertRuns ) {
+  ImageView<PixelRGB<uint16> > src(5,3);
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i )
+      src(i,j) = PixelRGB<uint16>( 257*(i+10*j), 1000*i, 65535 );
+
+  ImageView<PixelRGB<uint8> > cast(5,3), rescaled(5,3);
+  convert( cast.buffer(), src.buffer() );
+  convert( rescaled.buffer(), src.buffer(), true );
+  ImageView<PixelRGB<float> > f(5,3);
+  convert( f.buffer(), src.buffer(), true );
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i ) {
+      EXPECT_EQ( uint8(257*(i+10*j)), cast(i,j)[0] );
+      EXPECT_EQ( i+10*j, rescaled(i,j)[0] );
+      EXPECT_EQ( 255, rescaled(i,j)[2] );
+      EXPECT_FLOAT_EQ( 1000*i/65535.0f, f(i,j)[1] );
+    }
+
+  // Floats are clamped when they are rescaled to integers.
+  f(1,1) = PixelRGB<float>( 2, -1, 0.5 );
+  ImageView<PixelRGB<uint8> > back(5,3);
+  convert( back.buffer(), f.buffer(), true );
+  EXPECT_EQ( PixelRGB<uint8>(255,0,127), back(1,1) );
+
+  // Pixels that aren't packed together.
+  ImageBuffer every_other = src.buffer();
+  every_other.format.cols = 3;
+  every_other.cstride *= 2;
+  ImageView<PixelRGB<uint16> > copy(3,3);
+  convert( copy.buffer(), every_other );
+  for( int32 j=0; j<copy.rows(); ++j )
+    for( int32 i=0; i<copy.cols(); ++i )
+      EXPECT_EQ( src(2*i,j), copy(i,j) );
+}
+
+TEST( ImageResource, ConvertHalf ) {
+  ImageView<PixelRGB<float> > src(11,3);
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i )
+      src(i,j) = PixelRGB<float>( 0.1f*i - j, 1000.0f*i, 0.25f );
+
+  ImageView<PixelRGB<float16> > half(11,3);
+  convert( half.buffer(), src.buffer(), true );
+  ImageView<PixelRGB<float> > back(11,3);
+  convert( back.buffer(), half.buffer(), true );
+  ImageView<PixelRGB<uint8> > bytes(11,3);
+  convert( bytes.buffer(), half.buffer(), true );
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i )
+      for( int32 c=0; c<3; ++c ) {
+        EXPECT_EQ( float16(src(i,j)[c]).bits(), half(i,j)[c].bits() );
+        EXPECT_EQ( float(half(i,j)[c]), back(i,j)[c] );
+        EXPECT_NEAR( src(i,j)[c], back(i,j)[c], std::fabs(src(i,j)[c])/1024 );
+      }
+  EXPECT_EQ( 63, bytes(0,0)[2] );
+  EXPECT_EQ( 255, bytes(1,0)[1] );
+
+  // Gray to RGB goes a channel at a time
+  ImageView<PixelGray<uint16> > gray(2,1);
+  gray(1,0) = 65535;
+  ImageView<PixelRGB<float16> > rgb(2,1);
+  convert( rgb.buffer(), gray.buffer(), true );
+  EXPECT_EQ( 1.0f, float(rgb(1,0)[2]) );
+  EXPECT_EQ( 0.0f, float(rgb(0,0)[0]) );
+}
+
+TEST( ImageResource, ConvertMasked ) {
+  ImageView<int16> src(4,3);
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i )
+      src(i,j) = int16( i + 10*j );
+  src(2,1) = -32768;
+
+  // Without a nodata value every pixel is valid.
+  ImageView<PixelMask<float> > all(4,3);
+  convert( all.buffer(), src.buffer() );
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i ) {
+      EXPECT_TRUE( is_valid( all(i,j) ) );
+      EXPECT_EQ( float( src(i,j) ), all(i,j).child() );
+    }
+
+  // The nodata pixels are invalid, and only those.
+  ImageView<PixelMask<float> > masked(4,3);
+  convert_nodata( masked.buffer(), src.buffer(), -32768 );
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i ) {
+      EXPECT_EQ( !( i == 2 && j == 1 ), is_valid( masked(i,j) ) ) << i << "," << j;
+      EXPECT_EQ( float( src(i,j) ), masked(i,j).child() );
+    }
+
+  // A NaN nodata value matches NaN pixels, of every channel.
+  ImageView<PixelRGB<float> > rgb(3,1);
+  rgb(0,0) = PixelRGB<float>( std::numeric_limits<float>::quiet_NaN() );
+  rgb(1,0) = PixelRGB<float>( 1, std::numeric_limits<float>::quiet_NaN(), 2 );
+  rgb(2,0) = PixelRGB<float>( 1, 2, 3 );
+  ImageView<PixelMask<PixelRGB<uint8> > > rgb_masked(3,1);
+  convert_nodata( rgb_masked.buffer(), rgb.buffer(), std::numeric_limits<double>::quiet_NaN() );
+  EXPECT_FALSE( is_valid( rgb_masked(0,0) ) );
+  EXPECT_TRUE( is_valid( rgb_masked(1,0) ) );
+  EXPECT_TRUE( is_valid( rgb_masked(2,0) ) );
+  EXPECT_EQ( PixelRGB<uint8>(1,2,3), rgb_masked(2,0).child() );
+
+  // Destinations without a mask ignore the nodata value.
+  ImageView<float> plain(4,3);
+  convert_nodata( plain.buffer(), src.buffer(), -32768 );
+  EXPECT_EQ( -32768, plain(2,1) );
+}
+
 class SrcNoopResource : public SrcImageResource {
   private:
     const ImageFormat& m_fmt;
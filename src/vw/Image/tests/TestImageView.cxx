@@ -12,6 +12,9 @@
 #include <vw/Image/ViewImageResource.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/ImageIO.h>
+#include <vw/Core/Cache.h>
+
+#include <sstream>
 
 using namespace vw;
 
@@ -61,6 +64,38 @@ TEST( ImageView, ColsRowsPlanesConstructor ) {
   ASSERT_NE(test_rgba.data(), (PixelRGBA<vw::uint8>*)0);
 }
 
+namespace {
+  struct CountingDeleter {
+    int* m_count;
+    CountingDeleter( int* count ) : m_count(count) {}
+    void operator()( float* ) { ++*m_count; }
+  };
+}
+
+TEST( ImageView, ExternalMemoryConstructor ) {
+  float pixels[2*3*4];
+  for( int i=0; i<2*3*4; ++i ) pixels[i] = float(i);
+  int released = 0;
+  {
+    ImageView<float> test( boost::shared_array<float>( pixels, CountingDeleter(&released) ), 4, 3, 2 );
+    ASSERT_TRUE( test );
+    EXPECT_EQ(test.cols(), 4);
+    EXPECT_EQ(test.rows(), 3);
+    EXPECT_EQ(test.planes(), 2);
+    ASSERT_EQ(test.data(), pixels);
+    EXPECT_EQ(test(1,0,0), 1);
+    EXPECT_EQ(test(0,1,0), 4);
+    EXPECT_EQ(test(3,2,1), 23);
+    test(2,1,1) = -1;
+    EXPECT_EQ(pixels[12+4+2], -1);
+
+    ImageView<float> copy( test );
+    test.reset();
+    EXPECT_EQ(released, 0);
+  }
+  EXPECT_EQ(released, 1);
+}
+
 TEST( ImageView, CopyConstructor ) {
   ImageView<double> test_double(3,4);
   ImageView<double> test2_double( test_double );
@@ -333,3 +368,46 @@ TEST(ImageView, Equality) {
   EXPECT_NE(b,d);
   EXPECT_NE(c,d);
 }
+
+TEST(ImageView, MemoryGovernor) {
+  vw_memory_governor().set_tracking( true );
+  size_t base = vw_memory_governor().stats().transient;
+  {
+    ImageView<float> a(10,10);
+    EXPECT_EQ( base + 400, vw_memory_governor().stats().transient );
+    ImageView<float> b = a;
+    a.set_size(5,5);
+    EXPECT_EQ( base + 500, vw_memory_governor().stats().transient );
+  }
+  EXPECT_EQ( base, vw_memory_governor().stats().transient );
+  vw_memory_governor().set_tracking( false );
+}
+
+TEST(ImageView, Aligned) {
+  ImageView<PixelRGB<float> > a(33,7);
+  EXPECT_EQ( 0u, reinterpret_cast<size_t>( a.data() ) % BufferPool::ALIGNMENT );
+  EXPECT_EQ( PixelRGB<float>(), a(32,6) );
+}
+
+TEST(ImageView, CacheSpill) {
+  ImageView<PixelRGB<uint8> > a(3,2,2);
+  for( int p=0; p<2; ++p )
+    for( int j=0; j<2; ++j )
+      for( int i=0; i<3; ++i )
+        a(i,j,p) = PixelRGB<uint8>( i, j, p );
+
+  typedef CacheSpill<ImageView<PixelRGB<uint8> > > spill_t;
+  ASSERT_TRUE( spill_t::value );
+  std::stringstream stream;
+  spill_t::write( stream, a );
+  boost::shared_ptr<ImageView<PixelRGB<uint8> > > b = spill_t::read( stream );
+  ASSERT_TRUE( b );
+  EXPECT_EQ( 3, b->cols() );
+  EXPECT_EQ( 2, b->rows() );
+  EXPECT_EQ( 2, b->planes() );
+  EXPECT_SEQ_EQ( a, *b );
+
+  // A truncated stream gives nothing
+  std::stringstream truncated( stream.str().substr( 0, 20 ) );
+  EXPECT_FALSE( spill_t::read( truncated ) );
+}
@@ -0,0 +1,107 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+
+#include <vw/config.h>
+
+#if defined(VW_HAVE_PKG_OPENCV) && (VW_HAVE_PKG_OPENCV==1)
+
+#include <vw/Image/ImageViewOpenCV.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypes.h>
+
+#include <test/Helpers.h>
+
+using namespace vw;
+
+namespace {
+
+  // A 3x3 box filter, which reads the halo as OpenCV's filters do
+  struct Blur {
+    void operator()( cv::Mat const& src, cv::Mat& dest ) const {
+      cv::Mat area = src;
+      area.adjustROI( 1, 1, 1, 1 );
+      for ( int j = 0; j < dest.rows; ++j )
+        for ( int i = 0; i < dest.cols; ++i ) {
+          float sum = 0;
+          for ( int dj = 0; dj < 3; ++dj )
+            for ( int di = 0; di < 3; ++di )
+              sum += area.at<float>( j + dj, i + di );
+          dest.at<float>( j, i ) = sum / 9;
+        }
+    }
+  };
+
+  struct Reallocate {
+    void operator()( cv::Mat const& src, cv::Mat& dest ) const {
+      src.convertTo( dest, CV_64F );
+    }
+  };
+
+}
+
+TEST( ImageViewOpenCV, MatToImageView ) {
+  ImageView<PixelRGB<uint8> > image;
+  {
+    cv::Mat matrix( 5, 7, CV_8UC3, cv::Scalar( 1, 2, 3 ) );
+    image = opencv_image_view<PixelRGB<uint8> >( matrix );
+    EXPECT_EQ( reinterpret_cast<uint8*>( image.data() ), matrix.data );
+    matrix.at<cv::Vec3b>( 4, 6 ) = cv::Vec3b( 7, 8, 9 );
+  }
+  // The view keeps the pixels alive
+  ASSERT_EQ( 7, image.cols() );
+  ASSERT_EQ( 5, image.rows() );
+  EXPECT_PIXEL_EQ( PixelRGB<uint8>( 1, 2, 3 ), image(0,0) );
+  EXPECT_PIXEL_EQ( PixelRGB<uint8>( 7, 8, 9 ), image(6,4) );
+
+  // Regions are not contiguous, so they are copied
+  cv::Mat matrix( 6, 6, CV_32F, cv::Scalar( 0 ) );
+  matrix.at<float>( 3, 2 ) = 5;
+  ImageView<float32> region = opencv_image_view<float32>( matrix( cv::Rect( 1, 2, 3, 3 ) ) );
+  EXPECT_EQ( 3, region.cols() );
+  EXPECT_EQ( 5, region(1,1) );
+
+  EXPECT_THROW( opencv_image_view<float64>( matrix ), ArgumentErr );
+  EXPECT_THROW( opencv_image_view<PixelRGB<float32> >( matrix ), ArgumentErr );
+}
+
+TEST( ImageViewOpenCV, ImageViewToMat ) {
+  ImageView<PixelGray<int16> > image( 4, 3 );
+  image(2,1) = -9;
+  cv::Mat matrix = opencv_mat( image );
+  EXPECT_EQ( CV_16SC1, matrix.type() );
+  EXPECT_EQ( -9, matrix.at<int16>( 1, 2 ) );
+  matrix.at<int16>( 2, 3 ) = 11;
+  EXPECT_EQ( 11, image(3,2) );
+}
+
+TEST( ImageViewOpenCV, Filter ) {
+  ImageView<float32> image( 50, 37 );
+  for ( int32 j = 0; j < image.rows(); ++j )
+    for ( int32 i = 0; i < image.cols(); ++i )
+      image(i,j) = float32( ( i * 7 + j * 13 ) % 17 );
+
+  // The blocks see their neighbors through the halo, so they match
+  // the whole image filtered at once.
+  ImageView<float32> whole = opencv_filter<float32>( image, Blur(), 1 );
+  ImageView<float32> blocks = block_rasterize( opencv_filter<float32>( image, Blur(), 1 ), Vector2i( 16, 9 ), 2 );
+  for ( int32 j = 0; j < image.rows(); ++j )
+    for ( int32 i = 0; i < image.cols(); ++i )
+      ASSERT_FLOAT_EQ( whole(i,j), blocks(i,j) ) << i << "," << j;
+  float32 sum = 0;
+  for ( int32 j = 9; j <= 11; ++j )
+    for ( int32 i = 19; i <= 21; ++i )
+      sum += image(i,j);
+  EXPECT_NEAR( sum / 9, whole(20,10), 1e-5 );
+
+  ImageView<float32> dest( 4, 4 );
+  EXPECT_THROW( opencv_filter<float32>( image, Reallocate() ).rasterize( dest, BBox2i( 0, 0, 4, 4 ) ), LogicErr );
+}
+
+#endif
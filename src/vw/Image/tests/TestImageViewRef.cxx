@@ -10,6 +10,7 @@
 
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
+#include <vw/Image/ImageMath.h>
 
 using namespace vw;
 
@@ -63,3 +64,44 @@ TEST( ImageViewRef, Construct ) {
     EXPECT_EQ( *i, (float)(val) );
 }
 
+
+TEST( ImageViewRef, Memory ) {
+  ImageView<float> image(5,4,2);
+  for( int p=0; p<image.planes(); ++p )
+    for( int r=0; r<image.rows(); ++r )
+      for( int c=0; c<image.cols(); ++c )
+        image(c,r,p) = (float)(100*p+10*r+c);
+
+  // A crop of an image is read straight from memory.
+  ImageViewRef<float> ref = crop( image, BBox2i(1,1,3,2) );
+  ASSERT_TRUE( ref.contiguous() );
+  EXPECT_EQ( &image(1,2,1), ref.row_ptr(1,1) );
+  EXPECT_EQ( image(3,2,1), ref(2,1,1) );
+
+  ImageViewRef<float>::pixel_accessor acc = ref.origin();
+  acc.advance(1,1,1);
+  EXPECT_EQ( image(2,2,1), *acc );
+  acc.prev_row().next_col();
+  EXPECT_EQ( image(3,1,1), *acc );
+  ImageViewRef<float>::pixel_accessor acc2 = acc;
+  acc2.prev_plane();
+  EXPECT_EQ( image(3,1,0), *acc2 );
+  acc = acc2;
+  EXPECT_EQ( image(3,1,0), *acc );
+
+  // A procedural view still goes through its own accessor.
+  ImageViewRef<float> sum = image + image;
+  EXPECT_FALSE( sum.contiguous() );
+  EXPECT_EQ( 2*image(4,3,1), sum(4,3,1) );
+  ImageViewRef<float>::pixel_accessor sacc = sum.origin();
+  sacc.advance(4,3,1);
+  EXPECT_EQ( 2*image(4,3,1), *sacc );
+
+  // Even a single pixel can be stepped through.
+  ImageView<float> one(1,1);
+  one(0,0) = 7;
+  ImageViewRef<float> ref1 = one;
+  EXPECT_TRUE( ref1.contiguous() );
+  EXPECT_EQ( 7, *ref1.origin() );
+  EXPECT_FALSE( ImageViewRef<float>().contiguous() );
+}
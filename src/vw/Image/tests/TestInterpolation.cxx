@@ -58,6 +58,61 @@ TEST( Interpolation, Bicubic ) {
   ASSERT_FALSE( bool_trait<IsMultiplyAccessible>( interpolate(im, BicubicInterpolation()) ) );
 }
 
+// PixelRGBA has no specialized interpolator, so it always takes the
+// generic path.  The specialized pixel types must give exactly the same
+// values, and masked results must be invalid exactly when an invalid
+// pixel falls inside the footprint.
+template <class PixelT, class InterpT>
+static void check_specialized_interpolation() {
+  typedef typename CompoundChannelType<PixelT>::type channel_type;
+  const int32 channels = CompoundNumChannels<typename UnmaskedPixelType<PixelT>::type>::value;
+  const bool masked = IsMasked<PixelT>::value;
+  ImageView<PixelRGBA<channel_type> > ref(9,8);
+  ImageView<PixelT> im(9,8);
+  for ( int32 y = 0; y < im.rows(); y++ )
+    for ( int32 x = 0; x < im.cols(); x++ ) {
+      for ( int32 c = 0; c < 4; c++ )
+        ref(x,y)[c] = channel_type( ((x*7 + y*13 + c*5) % 23) * 1.25 );
+      for ( int32 c = 0; c < channels; c++ )
+        compound_select_channel<channel_type&>( im(x,y), c ) = ref(x,y)[c];
+      if ( masked )
+        compound_select_channel<channel_type&>( im(x,y), channels ) = ChannelRange<channel_type>::max();
+    }
+  if ( masked )
+    compound_select_channel<channel_type&>( im(4,3), channels ) = 0;
+
+  typename InterpT::template Interpolator<ImageView<PixelT> >::type interp;
+  typename InterpT::template Interpolator<ImageView<PixelRGBA<channel_type> > >::type ref_interp;
+  const int32 pb = InterpT::pixel_buffer;
+  for ( double j = 1; j < 5; j += 0.37 )
+    for ( double i = 1; i < 6; i += 0.29 ) {
+      PixelT result = interp( im, i, j, 0 );
+      PixelRGBA<channel_type> expected = ref_interp( ref, i, j, 0 );
+      for ( int32 c = 0; c < channels; c++ )
+        EXPECT_EQ( expected[c], compound_select_channel<channel_type const&>( result, c ) );
+      int32 x = int32(floor(i)), y = int32(floor(j));
+      bool touched = x-(pb-1) <= 4 && 4 <= x+pb && y-(pb-1) <= 3 && 3 <= y+pb;
+      EXPECT_EQ( !(masked && touched), is_valid( result ) );
+    }
+}
+
+template <class InterpT>
+static void check_specialized_interpolation() {
+  check_specialized_interpolation<float, InterpT>();
+  check_specialized_interpolation<uint16, InterpT>();
+  check_specialized_interpolation<PixelGray<float>, InterpT>();
+  check_specialized_interpolation<PixelGray<uint16>, InterpT>();
+  check_specialized_interpolation<PixelRGB<float>, InterpT>();
+  check_specialized_interpolation<Vector2f, InterpT>();
+  check_specialized_interpolation<PixelMask<PixelGray<float> >, InterpT>();
+  check_specialized_interpolation<PixelMask<Vector2f>, InterpT>();
+}
+
+TEST( Interpolation, SpecializedPixelTypes ) {
+  check_specialized_interpolation<BilinearInterpolation>();
+  check_specialized_interpolation<BicubicInterpolation>();
+}
+
 TEST( Interpolation, Nearest ) {
   ImageView<double> im(2,3); im(0,0)=1; im(1,0)=2; im(0,1)=3; im(1,1)=4; im(0,2)=5; im(1,2)=6;
   InterpolationView<EdgeExtensionView<ImageView<double>, ConstantEdgeExtension>, NearestPixelInterpolation> im2 = interpolate(im, NearestPixelInterpolation());
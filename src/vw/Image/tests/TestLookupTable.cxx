@@ -0,0 +1,104 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+
+#include <vw/Image/LookupTable.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PerPixelViews.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/PixelTypes.h>
+
+#include <test/Helpers.h>
+
+using namespace vw;
+
+namespace {
+
+  struct Curve : ReturnFixedType<float32> {
+    template <class PixelT>
+    float32 operator()( PixelT const& pixel ) const {
+      return float32( std::sqrt( std::abs( double( compound_select_channel<typename CompoundChannelType<PixelT>::type const&>( pixel, 0 ) ) ) ) );
+    }
+  };
+
+  struct Color : ReturnFixedType<PixelMask<PixelRGB<uint8> > > {
+    PixelMask<PixelRGB<uint8> > operator()( PixelGray<uint16> const& pixel ) const {
+      if( pixel.v() == 0 ) return PixelMask<PixelRGB<uint8> >();
+      return PixelRGB<uint8>( uint8( pixel.v() ), uint8( pixel.v() >> 8 ), 7 );
+    }
+  };
+
+  template <class PixelT>
+  ImageView<PixelT> ramp( int32 cols, int32 rows, int32 step ) {
+    ImageView<PixelT> image( cols, rows );
+    for( int32 j = 0; j < rows; ++j )
+      for( int32 i = 0; i < cols; ++i )
+        image(i,j) = PixelT( typename CompoundChannelType<PixelT>::type( ( i + j * cols ) * step ) );
+    return image;
+  }
+
+  template <class ImageT, class OtherT>
+  void expect_same( ImageViewBase<ImageT> const& a, ImageViewBase<OtherT> const& b ) {
+    ASSERT_EQ( a.impl().cols(), b.impl().cols() );
+    ASSERT_EQ( a.impl().rows(), b.impl().rows() );
+    for( int32 j = 0; j < a.impl().rows(); ++j )
+      for( int32 i = 0; i < a.impl().cols(); ++i )
+        ASSERT_EQ( a.impl()(i,j), b.impl()(i,j) ) << i << "," << j;
+  }
+}
+
+TEST( LookupTable, Table ) {
+  LookupTable<int8, int32> table( (std::negate<int32>()) );
+  EXPECT_EQ( 5, table( -5 ) );
+  EXPECT_EQ( 128, table( -128 ) );
+  EXPECT_EQ( -127, table( 127 ) );
+
+  // Copies share the table until one changes it.
+  LookupTable<int8, int32> copy( table );
+  copy.set( 3, 42 );
+  EXPECT_EQ( 42, copy( 3 ) );
+  EXPECT_EQ( -3, table( 3 ) );
+}
+
+TEST( LookupTable, MatchesPerPixelFilter ) {
+  // Odd sizes exercise the ends of the vector loops.
+  ImageView<PixelGray<uint8> > im8 = ramp<PixelGray<uint8> >( 37, 11, 1 );
+  expect_same( per_pixel_lookup( im8, Curve() ), per_pixel_filter( im8, Curve() ) );
+
+  ImageView<PixelGray<uint16> > im16 = ramp<PixelGray<uint16> >( 61, 23, 47 );
+  expect_same( per_pixel_lookup( im16, Curve() ), per_pixel_filter( im16, Curve() ) );
+  expect_same( per_pixel_lookup( im16, Color() ), per_pixel_filter( im16, Color() ) );
+
+  ImageView<int16> im_s16 = ramp<int16>( 29, 13, -97 );
+  expect_same( per_pixel_lookup( im_s16, Curve() ), per_pixel_filter( im_s16, Curve() ) );
+
+  // A result that is not 32 bits wide
+  expect_same( per_pixel_lookup( im16, RemapPixelFunctor<PixelGray<uint16> >( 47, 9 ) ),
+               remap_pixel_value( im16, 47, 9 ) );
+}
+
+TEST( LookupTable, Masked ) {
+  ImageView<PixelMask<uint8> > image = ramp<PixelMask<uint8> >( 9, 5, 3 );
+  image(2,3).invalidate();
+  LookupTable<uint8, PixelMask<float32> > table( (Curve()) );
+  ImageView<PixelMask<float32> > result = apply_lookup_table( image, table );
+  EXPECT_FALSE( is_valid( result(2,3) ) );
+  EXPECT_TRUE( is_valid( result(3,2) ) );
+  EXPECT_EQ( Curve()( image(3,2).child() ), result(3,2).child() );
+}
+
+TEST( LookupTable, Blocks ) {
+  ImageView<PixelGray<uint16> > image = ramp<PixelGray<uint16> >( 100, 70, 13 );
+  ImageView<float32> whole = per_pixel_lookup( image, Curve() );
+  ImageView<float32> blocks = block_rasterize( per_pixel_lookup( image, Curve() ), Vector2i( 32, 17 ), 2 );
+  expect_same( whole, blocks );
+  EXPECT_EQ( whole(55,40), per_pixel_lookup( image, Curve() )(55,40) );
+}
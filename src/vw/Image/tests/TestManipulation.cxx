@@ -428,6 +428,57 @@ TEST( Manipulation, Rotate90CCW ) {
   ASSERT_TRUE( bool_trait<IsMultiplyAccessible>( rotate_90_ccw(im) ) );
 }
 
+// Checks the blocked rasterization of a transposed or rotated view
+// against its pixels, over the whole view and a crop of it, and into
+// an ImageView or another view.
+template <class ViewT>
+void check_blocked_rasterize( ViewT const& view ) {
+  typedef typename ViewT::pixel_type pixel_type;
+  ImageView<pixel_type> full = view;
+  for ( int p=0; p<view.planes(); ++p )
+    for ( int r=0; r<view.rows(); ++r )
+      for ( int c=0; c<view.cols(); ++c )
+        ASSERT_EQ( full(c,r,p), view(c,r,p) );
+
+  BBox2i bbox( 3, 5, view.cols()-7, view.rows()-6 );
+  ImageView<pixel_type> part( bbox.width(), bbox.height(), view.planes() );
+  view.rasterize( part, bbox );
+  for ( int p=0; p<view.planes(); ++p )
+    for ( int r=0; r<part.rows(); ++r )
+      for ( int c=0; c<part.cols(); ++c )
+        ASSERT_EQ( part(c,r,p), view(c+bbox.min().x(),r+bbox.min().y(),p) );
+
+  ImageView<pixel_type> padded( bbox.width()+2, bbox.height()+2, view.planes() );
+  view.rasterize( crop( padded, BBox2i(1,1,bbox.width(),bbox.height()) ), bbox );
+  for ( int p=0; p<view.planes(); ++p )
+    for ( int r=0; r<part.rows(); ++r )
+      for ( int c=0; c<part.cols(); ++c )
+        ASSERT_EQ( padded(c+1,r+1,p), part(c,r,p) );
+}
+
+template <class PixelT>
+void check_blocked_transpose( int cols, int rows, int planes ) {
+  ImageView<PixelT> im( cols, rows, planes );
+  for ( int p=0; p<planes; ++p )
+    for ( int r=0; r<rows; ++r )
+      for ( int c=0; c<cols; ++c )
+        im(c,r,p) = PixelT( (c*7 + r*13 + p*5) % 101 );
+  check_blocked_rasterize( transpose(im) );
+  check_blocked_rasterize( rotate_90_cw(im) );
+  check_blocked_rasterize( rotate_90_ccw(im) );
+  check_blocked_rasterize( transpose(im + PixelT(1)) );
+  check_blocked_rasterize( rotate_90_cw(im + PixelT(1)) );
+  check_blocked_rasterize( rotate_90_ccw(im + PixelT(1)) );
+}
+
+TEST( Manipulation, BlockedTranspose ) {
+  check_blocked_transpose<uint8>( 131, 77, 2 );
+  check_blocked_transpose<uint16>( 70, 93, 1 );
+  check_blocked_transpose<float>( 67, 150, 1 );
+  check_blocked_transpose<double>( 41, 37, 2 );
+  check_blocked_transpose<PixelRGBA<uint8> >( 66, 70, 1 );
+}
+
 TEST( Manipulation, FlipVertView ) {
   ImageView<double> im(2,3); im(0,0)=1; im(1,0)=2; im(0,1)=3; im(1,1)=4; im(0,2)=5; im(1,2)=6;
   FlipVerticalView<ImageView<double> > rmv(im);
@@ -705,6 +756,45 @@ TEST( Manipulation, CropAssignment ) {
   EXPECT_EQ( 4, dest(2,2) );
 }
 
+TEST( Manipulation, ContiguousRowCopy ) {
+  ImageView<PixelRGB<float> > im(7,5,2);
+  for( int32 p=0; p<im.planes(); ++p )
+    for( int32 j=0; j<im.rows(); ++j )
+      for( int32 i=0; i<im.cols(); ++i )
+        im(i,j,p) = PixelRGB<float>( float(i), float(j), float(p) );
+
+  ASSERT_TRUE( bool_trait<HasContiguousRows>( im ) );
+  ASSERT_TRUE( bool_trait<HasContiguousRows>( crop(im,1,1,3,2) ) );
+  ASSERT_TRUE( bool_trait<HasContiguousRows>( select_plane(im,1) ) );
+  ASSERT_FALSE( bool_trait<HasContiguousRows>( transpose(im) ) );
+  ASSERT_TRUE(( CanCopyRows<CropView<ImageView<PixelRGB<float> > >, ImageView<PixelRGB<float> > >::value ));
+  ASSERT_FALSE(( CanCopyRows<CropView<ImageView<PixelRGB<float> > >, ImageView<PixelRGB<double> > >::value ));
+
+  ImageView<PixelRGB<float> > c = crop(im,2,1,4,3);
+  ASSERT_EQ( 4, c.cols() );
+  ASSERT_EQ( 3, c.rows() );
+  ASSERT_EQ( 2, c.planes() );
+  for( int32 p=0; p<c.planes(); ++p )
+    for( int32 j=0; j<c.rows(); ++j )
+      for( int32 i=0; i<c.cols(); ++i )
+        EXPECT_EQ( im(i+2,j+1,p), c(i,j,p) );
+
+  ImageView<PixelRGB<float> > dest(6,6);
+  fill( dest, PixelRGB<float>(-1,-1,-1) );
+  crop(dest,1,2,3,2) = crop(select_plane(im,1),3,2,3,2);
+  for( int32 j=0; j<dest.rows(); ++j )
+    for( int32 i=0; i<dest.cols(); ++i ) {
+      if( i>=1 && i<4 && j>=2 && j<4 )
+        EXPECT_EQ( im(i+2,j,1), dest(i,j) );
+      else
+        EXPECT_EQ( PixelRGB<float>(-1,-1,-1), dest(i,j) );
+    }
+
+  // Different pixel types still go through the accessor loop.
+  ImageView<PixelRGB<double> > d = crop(im,0,0,2,2);
+  EXPECT_EQ( PixelRGB<double>(1,1,0), d(1,1) );
+}
+
 TEST( Manipulation, SubsampleView ) {
   ImageView<double> im(4,5); im(0,0)=1; im(2,0)=2; im(0,2)=3; im(2,2)=4; im(0,4)=5; im(2,4)=6;
   SubsampleView<ImageView<double> > ssv(im,2,2);
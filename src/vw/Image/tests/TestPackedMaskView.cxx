@@ -0,0 +1,141 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// TestPackedMaskView.h
+#include <gtest/gtest.h>
+
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/MaskViews.h>
+#include <vw/Image/PackedMaskView.h>
+
+using namespace vw;
+
+// A 150x140 image with two planes: the top left block is invalid, the
+// block right of it valid, and the rest a pattern of both.
+static ImageView<PixelMask<float> > masked_image() {
+  ImageView<PixelMask<float> > image( 150, 140, 2 );
+  for ( int p=0; p<image.planes(); ++p )
+    for ( int r=0; r<image.rows(); ++r )
+      for ( int c=0; c<image.cols(); ++c ) {
+        image(c,r,p) = PixelMask<float>( float(c + 1000*r + 100000*p) );
+        if ( c < 64 && r < 64 ) image(c,r,p).invalidate();
+        else if ( c < 128 && r < 64 ) continue;
+        else if ( (c*7 + r*3 + p) % 5 == 0 ) image(c,r,p).invalidate();
+      }
+  return image;
+}
+
+TEST( PackedMaskView, Pack ) {
+  ImageView<PixelMask<float> > image = masked_image();
+  PackedMaskView<float> packed = image;
+  ASSERT_EQ( packed.cols(), image.cols() );
+  ASSERT_EQ( packed.rows(), image.rows() );
+  ASSERT_EQ( packed.planes(), image.planes() );
+  for ( int p=0; p<image.planes(); ++p )
+    for ( int r=0; r<image.rows(); ++r )
+      for ( int c=0; c<image.cols(); ++c ) {
+        ASSERT_EQ( image(c,r,p).child(), packed(c,r,p).child() );
+        ASSERT_EQ( is_valid(image(c,r,p)), is_valid(packed(c,r,p)) );
+        ASSERT_EQ( is_valid(image(c,r,p)), packed.valid(c,r,p) );
+        ASSERT_EQ( image(c,r,p).child(), packed.values()(c,r,p) );
+      }
+
+  // Unpacking into an ImageView, or into another view
+  BBox2i bbox( 3, 50, 140, 31 );
+  ImageView<PixelMask<float> > part = crop( packed, bbox );
+  ImageView<PixelMask<float> > padded( bbox.width()+2, bbox.height()+2, 2 );
+  packed.rasterize( crop( padded, BBox2i(1,1,bbox.width(),bbox.height()) ), bbox );
+  for ( int p=0; p<part.planes(); ++p )
+    for ( int r=0; r<part.rows(); ++r )
+      for ( int c=0; c<part.cols(); ++c ) {
+        EXPECT_EQ( part(c,r,p), image(c+bbox.min().x(),r+bbox.min().y(),p) );
+        EXPECT_EQ( padded(c+1,r+1,p), part(c,r,p) );
+      }
+}
+
+TEST( PackedMaskView, Status ) {
+  PackedMaskView<float> packed = masked_image();
+  typedef PackedMaskView<float> packed_type;
+  EXPECT_EQ( packed.block_status(0,0,0), packed_type::InvalidBlock );
+  EXPECT_EQ( packed.block_status(1,0,1), packed_type::ValidBlock );
+  EXPECT_EQ( packed.block_status(2,0,0), packed_type::MixedBlock );
+  EXPECT_EQ( packed.block_status(0,1,0), packed_type::MixedBlock );
+
+  EXPECT_EQ( packed.status( BBox2i(10,10,40,40) ), packed_type::InvalidBlock );
+  EXPECT_EQ( packed.status( BBox2i(70,10,40,40) ), packed_type::ValidBlock );
+  EXPECT_EQ( packed.status( BBox2i(40,10,40,40) ), packed_type::MixedBlock );
+  EXPECT_EQ( packed.status( BBox2i(200,10,40,40) ), packed_type::InvalidBlock );
+  EXPECT_EQ( packed.status( BBox2i(0,0,150,140) ), packed_type::MixedBlock );
+
+  // Boxes inside mixed blocks are decided from the mask
+  for ( int r=60; r<140; r+=7 )
+    for ( int c=60; c<150; c+=11 ) {
+      BBox2i bbox( c, r, 1 + c%3, 1 + r%2 );
+      bool any = false, all = true;
+      for ( int p=0; p<packed.planes(); ++p )
+        for ( int y=bbox.min().y(); y<bbox.max().y() && y<packed.rows(); ++y )
+          for ( int x=bbox.min().x(); x<bbox.max().x() && x<packed.cols(); ++x ) {
+            any = any || packed.valid(x,y,p);
+            all = all && packed.valid(x,y,p);
+          }
+      EXPECT_EQ( packed.status( bbox ), all ? packed_type::ValidBlock :
+                 any ? packed_type::MixedBlock : packed_type::InvalidBlock );
+    }
+
+  EXPECT_FALSE( sparse_check( packed, BBox2i(0,0,64,64) ) );
+  EXPECT_TRUE( sparse_check( packed, BBox2i(0,0,65,64) ) );
+  EXPECT_FALSE( sparse_check( packed, BBox2i(150,0,64,64) ) );
+}
+
+TEST( PackedMaskView, Set ) {
+  PackedMaskView<float> packed( 100, 70 );
+  typedef PackedMaskView<float> packed_type;
+  EXPECT_EQ( packed.status( BBox2i(0,0,100,70) ), packed_type::InvalidBlock );
+  EXPECT_FALSE( packed.valid(99,69) );
+
+  packed.set( 70, 3, PixelMask<float>(5) );
+  EXPECT_TRUE( packed.valid(70,3) );
+  EXPECT_EQ( packed(70,3), PixelMask<float>(5) );
+  EXPECT_EQ( packed.block_status(1,0), packed_type::MixedBlock );
+  EXPECT_EQ( packed.block_status(0,0), packed_type::InvalidBlock );
+  EXPECT_EQ( packed.status( BBox2i(70,3,1,1) ), packed_type::ValidBlock );
+
+  PixelMask<float> invalid(7);
+  invalid.invalidate();
+  packed.set( 70, 3, invalid );
+  EXPECT_FALSE( packed.valid(70,3) );
+  EXPECT_EQ( packed(70,3).child(), 7 );
+  EXPECT_EQ( packed.block_status(1,0), packed_type::InvalidBlock );
+
+  // The last block of each row covers only the columns in the image
+  for ( int r=64; r<70; ++r )
+    for ( int c=64; c<100; ++c )
+      packed.set( c, r, PixelMask<float>(1) );
+  EXPECT_EQ( packed.block_status(1,1), packed_type::ValidBlock );
+}
+
+TEST( PackedMaskView, MaskViews ) {
+  ImageView<float> image( 70, 20 );
+  for ( int r=0; r<image.rows(); ++r )
+    for ( int c=0; c<image.cols(); ++c )
+      image(c,r) = float( (c+r) % 3 );
+
+  PackedMaskView<float> packed = pack_mask( create_mask( image, 0 ) );
+  PackedMaskView<float> all = pack_mask( image );
+  EXPECT_EQ( all.status( BBox2i(0,0,70,20) ), PackedMaskView<float>::ValidBlock );
+
+  ImageView<float> applied = apply_mask( packed, -1 );
+  ImageView<PixelMask<float> > inverted = invert_mask( packed );
+  for ( int r=0; r<image.rows(); ++r )
+    for ( int c=0; c<image.cols(); ++c ) {
+      EXPECT_EQ( packed.valid(c,r), image(c,r) != 0 );
+      EXPECT_EQ( applied(c,r), image(c,r) != 0 ? image(c,r) : -1 );
+      EXPECT_EQ( is_valid(inverted(c,r)), image(c,r) == 0 );
+    }
+}
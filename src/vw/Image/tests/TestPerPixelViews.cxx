@@ -10,6 +10,7 @@
 
 #include <vw/Image/PerPixelViews.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Core/Functors.h>
 
 using namespace vw;
@@ -259,3 +260,41 @@ TEST( PerPixelView, Binary2 ) {
   ASSERT_FALSE( bool_trait<IsMultiplyAccessible>(ppv) );
   ASSERT_TRUE( bool_trait<IsImageView>(ppv) );
 }
+
+TEST( PerPixelView, RowEvaluation ) {
+  ImageView<float> im1(7,5,2), im2(7,5,2);
+  for( int32 p=0; p<2; ++p )
+    for( int32 j=0; j<5; ++j )
+      for( int32 i=0; i<7; ++i ) {
+        im1(i,j,p) = float(i + 10*j + 100*p);
+        im2(i,j,p) = float(3*i - j);
+      }
+
+  // Chains of per-pixel views over ImageViews and crops of them are
+  // evaluated a row at a time.
+  typedef UnaryPerPixelView<ImageView<float>, ArgNegationFunctor> unary_type;
+  typedef BinaryPerPixelView<unary_type, CropView<ImageView<float> >, ArgArgSumFunctor> binary_type;
+  ASSERT_TRUE( RowEvaluator<ImageView<float> >::value );
+  ASSERT_TRUE( RowEvaluator<unary_type>::value );
+  ASSERT_TRUE( RowEvaluator<binary_type>::value );
+  ASSERT_FALSE(( RowEvaluator<BinaryPerPixelView<unary_type, TransposeView<ImageView<float> >, ArgArgSumFunctor> >::value ));
+
+  binary_type ppv( unary_type( im1 ), CropView<ImageView<float> >( im2, 0, 0, 7, 5 ) );
+  RowEvaluator<binary_type> row( ppv, 2, 3, 1 );
+  EXPECT_EQ( row[0], ppv(2,3,1) );
+  EXPECT_EQ( row[4], ppv(6,3,1) );
+
+  // Both the pointer loop for ImageView destinations and the accessor
+  // loop for others agree with pixel-by-pixel evaluation.
+  BBox2i bbox(1,1,5,3);
+  ImageView<float> dest(5,3,2), big(9,9,2);
+  ppv.rasterize( dest, bbox );
+  CropView<ImageView<float> > crop_dest( big, 2, 4, 5, 3 );
+  ppv.rasterize( crop_dest, bbox );
+  for( int32 p=0; p<2; ++p )
+    for( int32 j=0; j<3; ++j )
+      for( int32 i=0; i<5; ++i ) {
+        EXPECT_EQ( dest(i,j,p), ppv(i+1,j+1,p) );
+        EXPECT_EQ( big(i+2,j+4,p), ppv(i+1,j+1,p) );
+      }
+}
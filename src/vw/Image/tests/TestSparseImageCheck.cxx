@@ -0,0 +1,184 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// TestSparseImageCheck.h
+#include <gtest/gtest.h>
+
+#include <vw/Core/Thread.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/MaskViews.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/Transform.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/ImageIO.h>
+#include <vw/Image/SparseImageCheck.h>
+
+using namespace vw;
+
+// A 16x16 block of ones at (32,32) in an 80x80 image of zeros.
+typedef EdgeExtensionView<ImageView<float>,ZeroEdgeExtension> SparseView;
+static SparseView sparse_image() {
+  ImageView<float> data( 16, 16 );
+  fill( data, 1.0f );
+  return edge_extend( data, -32, -32, 80, 80, ZeroEdgeExtension() );
+}
+
+TEST( SparseImageCheck, Default ) {
+  ImageView<float> image( 10, 10 );
+  EXPECT_TRUE( sparse_check( image, BBox2i(0,0,5,5) ) );
+  EXPECT_TRUE( sparse_check( image, BBox2i(8,8,5,5) ) );
+  EXPECT_FALSE( sparse_check( image, BBox2i(10,0,5,5) ) );
+}
+
+TEST( SparseImageCheck, EdgeExtension ) {
+  SparseView image = sparse_image();
+  EXPECT_FALSE( sparse_check( image, BBox2i(0,0,32,80) ) );
+  EXPECT_TRUE( sparse_check( image, BBox2i(0,0,33,33) ) );
+  EXPECT_FALSE( sparse_check( image, BBox2i(48,48,32,32) ) );
+
+  ImageView<float> data( 16, 16 );
+  EXPECT_TRUE( sparse_check( edge_extend( data, -32, -32, 80, 80, ConstantEdgeExtension() ), BBox2i(0,0,8,8) ) );
+  EXPECT_TRUE( sparse_check( edge_extend( data, -32, -32, 80, 80, ValueEdgeExtension<float>(3) ), BBox2i(0,0,8,8) ) );
+  EXPECT_FALSE( sparse_check( edge_extend( data, -32, -32, 80, 80, ValueEdgeExtension<float>(0) ), BBox2i(0,0,8,8) ) );
+}
+
+TEST( SparseImageCheck, PerPixel ) {
+  SparseView image = sparse_image();
+  BBox2i empty( 0, 0, 16, 16 ), full( 30, 30, 8, 8 );
+
+  EXPECT_FALSE( sparse_check( channel_cast<uint8>( image ), empty ) );
+  EXPECT_TRUE( sparse_check( channel_cast<uint8>( image ), full ) );
+  EXPECT_FALSE( sparse_check( 2 * image, empty ) );
+  EXPECT_FALSE( sparse_check( image * image, empty ) );
+  EXPECT_TRUE( sparse_check( image * image, full ) );
+
+  // Functions that fill in empty pixels make the view dense.
+  EXPECT_TRUE( sparse_check( image + 1, empty ) );
+  ImageView<float> ones( 80, 80 );
+  EXPECT_TRUE( sparse_check( image + ones, empty ) );
+
+  // Masking with a nodata value of zero leaves the empty pixels
+  // invalid, but casting to a masked pixel makes them valid.
+  EXPECT_FALSE( sparse_check( create_mask( image, 0.0f ), empty ) );
+  EXPECT_TRUE( sparse_check( create_mask( image, 5.0f ), empty ) );
+  EXPECT_TRUE( sparse_check( pixel_cast<PixelMask<float> >( image ), empty ) );
+}
+
+TEST( SparseImageCheck, Manipulation ) {
+  SparseView image = sparse_image();
+
+  EXPECT_FALSE( sparse_check( crop( image, 40, 0, 40, 80 ), BBox2i(8,0,32,80) ) );
+  EXPECT_TRUE( sparse_check( crop( image, 40, 0, 40, 80 ), BBox2i(7,32,1,1) ) );
+  EXPECT_FALSE( sparse_check( transpose( crop( image, 0, 40, 80, 40 ) ), BBox2i(8,0,32,80) ) );
+  EXPECT_TRUE( sparse_check( transpose( crop( image, 0, 40, 80, 40 ) ), BBox2i(7,32,1,1) ) );
+  EXPECT_FALSE( sparse_check( flip_vertical( crop( image, 0, 0, 80, 40 ) ), BBox2i(0,8,80,32) ) );
+  EXPECT_TRUE( sparse_check( flip_vertical( crop( image, 0, 0, 80, 40 ) ), BBox2i(32,0,1,1) ) );
+  EXPECT_FALSE( sparse_check( flip_horizontal( crop( image, 0, 0, 40, 80 ) ), BBox2i(8,0,32,80) ) );
+  EXPECT_TRUE( sparse_check( flip_horizontal( crop( image, 0, 0, 40, 80 ) ), BBox2i(0,32,1,1) ) );
+  EXPECT_TRUE( sparse_check( rotate_180( crop( image, 0, 0, 40, 40 ) ), BBox2i(0,0,8,8) ) );
+  EXPECT_FALSE( sparse_check( rotate_180( crop( image, 0, 0, 40, 40 ) ), BBox2i(9,0,31,40) ) );
+  EXPECT_TRUE( sparse_check( rotate_90_cw( crop( image, 0, 0, 40, 40 ) ), BBox2i(0,32,1,1) ) );
+  EXPECT_FALSE( sparse_check( rotate_90_cw( crop( image, 0, 0, 40, 40 ) ), BBox2i(8,0,32,40) ) );
+  EXPECT_TRUE( sparse_check( rotate_90_ccw( crop( image, 0, 0, 40, 40 ) ), BBox2i(32,0,1,1) ) );
+  EXPECT_FALSE( sparse_check( rotate_90_ccw( crop( image, 0, 0, 40, 40 ) ), BBox2i(0,8,40,32) ) );
+
+  EXPECT_FALSE( sparse_check( subsample( image, 4 ), BBox2i(0,0,8,20) ) );
+  EXPECT_TRUE( sparse_check( subsample( image, 4 ), BBox2i(0,0,9,9) ) );
+  EXPECT_FALSE( sparse_check( select_plane( image, 0 ), BBox2i(0,0,10,10) ) );
+  EXPECT_FALSE( sparse_check( block_cache( image, Vector2i(16,16) ), BBox2i(0,0,10,10) ) );
+  EXPECT_TRUE( sparse_check( block_cache( image, Vector2i(16,16) ), BBox2i(40,40,10,10) ) );
+}
+
+TEST( SparseImageCheck, Filters ) {
+  SparseView image = sparse_image();
+
+  // The kernels reach three pixels, so blocks that far from the data
+  // are still empty.
+  std::vector<float> kernel( 7, 1.0f/7 );
+  EXPECT_FALSE( sparse_check( separable_convolution_filter( image, kernel, kernel ), BBox2i(0,0,29,80) ) );
+  EXPECT_TRUE( sparse_check( separable_convolution_filter( image, kernel, kernel ), BBox2i(0,0,30,80) ) );
+  ImageView<float> kernel2d( 7, 7 );
+  fill( kernel2d, 1.0f/49 );
+  EXPECT_FALSE( sparse_check( convolution_filter( image, kernel2d ), BBox2i(51,0,29,80) ) );
+  EXPECT_TRUE( sparse_check( convolution_filter( image, kernel2d ), BBox2i(50,0,30,80) ) );
+  EXPECT_FALSE( sparse_check( mean_filter<7>( image ), BBox2i(0,0,29,80) ) );
+  EXPECT_TRUE( sparse_check( median_filter( image, 7 ), BBox2i(0,0,30,80) ) );
+
+  // The default edge extension repeats the edge of the whole view,
+  // which is empty here.
+  EXPECT_FALSE( sparse_check( gaussian_filter( image, 1.0 ), BBox2i(0,0,20,20) ) );
+}
+
+TEST( SparseImageCheck, Transform ) {
+  SparseView image = sparse_image();
+  EXPECT_FALSE( sparse_check( translate( image, 20, 0, ZeroEdgeExtension() ), BBox2i(0,0,50,80) ) );
+  EXPECT_TRUE( sparse_check( translate( image, 20, 0, ZeroEdgeExtension() ), BBox2i(0,0,54,80) ) );
+  EXPECT_FALSE( sparse_check( resample( image, 0.5, ZeroEdgeExtension() ), BBox2i(0,0,14,40) ) );
+  EXPECT_TRUE( sparse_check( resample( image, 0.5, ZeroEdgeExtension() ), BBox2i(0,0,20,40) ) );
+}
+
+// Counts the pixels it is applied to.
+class CountingFunctor : public ReturnFixedType<float> {
+  int *m_count;
+  Mutex *m_mutex;
+public:
+  CountingFunctor( int *count, Mutex *mutex ) : m_count(count), m_mutex(mutex) {}
+  float operator()( float value ) const {
+    Mutex::Lock lock( *m_mutex );
+    ++*m_count;
+    return value;
+  }
+};
+
+// A resource that writes into an image view.
+class ImageViewDstResource : public DstImageResource {
+  ImageView<float> m_image;
+  Vector2i m_block_size;
+public:
+  ImageViewDstResource( ImageView<float> const& image, Vector2i const& block_size )
+    : m_image(image), m_block_size(block_size) {}
+  virtual void write( ImageBuffer const& buf, BBox2i const& bbox ) {
+    ImageView<float> block( bbox.width(), bbox.height() );
+    convert( block.buffer(), buf );
+    crop( m_image, bbox ) = block;
+  }
+  virtual bool has_block_write() const { return true; }
+  virtual Vector2i block_write_size() const { return m_block_size; }
+  virtual bool has_nodata_write() const { return false; }
+  virtual void flush() {}
+};
+
+TEST( SparseImageCheck, BlockWrite ) {
+  SparseView image = sparse_image();
+  int count = 0;
+  Mutex mutex;
+  UnaryPerPixelView<SparseView,CountingFunctor> view( image, CountingFunctor( &count, &mutex ) );
+
+  ImageView<float> result( 80, 80 );
+  fill( result, 7.0f );
+  ImageViewDstResource resource( result, Vector2i(16,16) );
+  block_write_image( resource, view );
+
+  // Only the one block with data is rasterized, plus one pixel for
+  // each empty block to check that the function keeps it empty.
+  EXPECT_EQ( 16*16 + 24, count );
+  for( int32 y=0; y<80; ++y )
+    for( int32 x=0; x<80; ++x )
+      ASSERT_EQ( image(x,y), result(x,y) ) << "at " << x << "," << y;
+
+  count = 0;
+  fill( result, 7.0f );
+  write_image( resource, view );
+  EXPECT_EQ( 16*16 + 24, count );
+  EXPECT_EQ( 0, result(0,0) );
+  EXPECT_EQ( 1, result(40,40) );
+}
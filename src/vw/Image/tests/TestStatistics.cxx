@@ -6,6 +6,8 @@
 
 
 // Image/tests/TestStatistics.h
+#include <algorithm>
+
 #include <gtest/gtest.h>
 
 #include <vw/Core/Stopwatch.h>
@@ -491,3 +493,108 @@ TEST( Statistics, MedianChannel ) {
   EXPECT_EQ( median_channel_value(image2), 6 );
   ASSERT_TRUE( is_of_type<vw::uint8>( median_channel_value(image2) ) );
 }
+
+TEST( Statistics, ChannelStatistics ) {
+  // Far from zero, like elevations, and bigger than a tile so that
+  // several blocks are merged.
+  ImageView<PixelMask<PixelRGB<float> > > image(700,300);
+  for ( int32 y = 0; y < image.rows(); y++ )
+    for ( int32 x = 0; x < image.cols(); x++ ) {
+      image(x,y) = PixelMask<PixelRGB<float> >( 4000 + (x*7+y*3)%101, 4000 + (x+2*y)%17, 4000 - (x*y)%29 );
+      if ( (x+y) % 5 == 0 )
+        image(x,y).invalidate();
+    }
+
+  ChannelStatistics stats = channel_statistics( image, ChannelStatistics( 10, 3970, 4100 ), 4 );
+  ChannelStatistics serial = channel_statistics( image, ChannelStatistics( 10, 3970, 4100 ), 1 );
+  float min, max;
+  min_max_channel_values( image, min, max );
+  EXPECT_EQ( min, stats.minimum() );
+  EXPECT_EQ( max, stats.maximum() );
+  EXPECT_NEAR( mean_channel_value( image ), stats.mean(), 1e-9 );
+  EXPECT_NEAR( stddev_channel_value( image ), stats.stddev(), 1e-6 );
+  EXPECT_NEAR( serial.stddev(), stats.stddev(), 1e-9 );
+
+  uint64 valid = 0;
+  for ( int32 y = 0; y < image.rows(); y++ )
+    for ( int32 x = 0; x < image.cols(); x++ )
+      if ( is_valid( image(x,y) ) ) valid++;
+  EXPECT_EQ( valid, stats.num_valid_pixels() );
+  EXPECT_EQ( 3*valid, stats.num_samples() );
+
+  ASSERT_EQ( 10u, stats.histogram().size() );
+  uint64 total = 0;
+  for ( size_t i = 0; i < stats.histogram().size(); i++ ) {
+    EXPECT_EQ( serial.histogram()[i], stats.histogram()[i] );
+    total += stats.histogram()[i];
+  }
+  EXPECT_EQ( stats.num_samples(), total );
+
+  // Merging two halves gives the same answer as accumulating it all.
+  ChannelStatistics a, b, all;
+  for ( int32 i = 0; i < 100; i++ ) {
+    ( i < 30 ? a : b )( 1e6 + i*i );
+    all( 1e6 + i*i );
+  }
+  a.merge( b );
+  EXPECT_EQ( all.num_samples(), a.num_samples() );
+  EXPECT_NEAR( all.mean(), a.mean(), 1e-6 );
+  EXPECT_NEAR( all.stddev(), a.stddev(), 1e-6 );
+  EXPECT_EQ( all.minimum(), a.minimum() );
+  EXPECT_EQ( all.maximum(), a.maximum() );
+
+  ASSERT_THROW( ChannelStatistics().mean(), ArgumentErr );
+  ASSERT_THROW( a.merge( ChannelStatistics( 4, 0, 1 ) ), ArgumentErr );
+}
+
+TEST( Statistics, ChannelQuantiles ) {
+  ImageView<PixelMask<float> > image(500,400);
+  std::vector<float> values, subsampled;
+  for ( int32 y = 0; y < image.rows(); y++ )
+    for ( int32 x = 0; x < image.cols(); x++ ) {
+      float v = float( ((x*7919 + y*104729) % 10007) * ((x+y) % 13 + 1) ) / 7;
+      image(x,y) = PixelMask<float>( v );
+      if ( x % 11 == 3 ) {
+        image(x,y).invalidate();
+        continue;
+      }
+      values.push_back( v );
+      if ( x % 3 == 0 && y % 3 == 0 )
+        subsampled.push_back( v );
+    }
+  std::sort( values.begin(), values.end() );
+  std::sort( subsampled.begin(), subsampled.end() );
+  double range = values.back() - values.front();
+
+  std::vector<double> fractions;
+  fractions.push_back( 0 );
+  fractions.push_back( 0.02 );
+  fractions.push_back( 0.5 );
+  fractions.push_back( 0.98 );
+  fractions.push_back( 1 );
+
+  std::vector<QuantileEstimate> coarse = channel_quantiles( image, fractions, 1, 64, false );
+  std::vector<QuantileEstimate> fine = channel_quantiles( image, fractions, 1, 64, true );
+  std::vector<QuantileEstimate> sub = channel_quantiles( image, fractions, 3 );
+  ASSERT_EQ( fractions.size(), fine.size() );
+  for ( size_t i = 0; i < fractions.size(); i++ ) {
+    double exact = values[ size_t( fractions[i] * (values.size()-1) + 0.5 ) ];
+    EXPECT_LE( coarse[i].lower, exact );
+    EXPECT_GE( coarse[i].upper, exact );
+    EXPECT_LE( coarse[i].upper - coarse[i].lower, range/64 * (1+1e-9) );
+    EXPECT_LE( fine[i].lower, exact );
+    EXPECT_GE( fine[i].upper, exact );
+    EXPECT_LE( fine[i].upper - fine[i].lower, range/(64*64) * (1+1e-9) );
+    EXPECT_LE( fine[i].lower, fine[i].value );
+    EXPECT_GE( fine[i].upper, fine[i].value );
+
+    double sub_exact = subsampled[ size_t( fractions[i] * (subsampled.size()-1) + 0.5 ) ];
+    EXPECT_LE( sub[i].lower, sub_exact );
+    EXPECT_GE( sub[i].upper, sub_exact );
+  }
+  EXPECT_EQ( values.front(), fine[0].value );
+  EXPECT_EQ( values.back(), fine[4].value );
+
+  ImageView<PixelMask<float> > empty(3,3);
+  ASSERT_THROW( channel_quantiles( empty, fractions ), ArgumentErr );
+}
@@ -0,0 +1,97 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// Image/tests/TestSummedAreaTable.h
+#include <gtest/gtest.h>
+
+#include <vw/Image/SummedAreaTable.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/Image/ImageView.h>
+
+#include <test/Helpers.h>
+
+using namespace vw;
+
+template <class PixelT>
+static ImageView<PixelT> make_image( int32 cols, int32 rows ) {
+  ImageView<PixelT> image( cols, rows );
+  for( int32 j=0; j<rows; ++j )
+    for( int32 i=0; i<cols; ++i )
+      image(i,j) = PixelT( (i*7 + j*13 + i*j) % 251 );
+  return image;
+}
+
+TEST( SummedAreaTable, Types ) {
+  EXPECT_TRUE(( boost::is_same<SummedAreaSumType<uint8>::type, int64>::value ));
+  EXPECT_TRUE(( boost::is_same<SummedAreaSumType<float>::type, double>::value ));
+  EXPECT_TRUE(( boost::is_same<SummedAreaSumType<PixelRGB<uint16> >::type, PixelRGB<int64> >::value ));
+}
+
+TEST( SummedAreaTable, Sums ) {
+  ImageView<uint8> image = make_image<uint8>( 5, 4 );
+  SummedAreaTable<int64> table = summed_area_table( image, true, 1 );
+  ASSERT_EQ( 5, table.cols() );
+  ASSERT_EQ( 4, table.rows() );
+  ASSERT_EQ( 6, table.sums().cols() );
+  ASSERT_EQ( 5, table.sums().rows() );
+  ASSERT_TRUE( table.has_squares() );
+
+  for( int32 j=0; j<=4; ++j )
+    for( int32 i=0; i<=5; ++i ) {
+      int64 sum = 0, sum2 = 0;
+      for( int32 y=0; y<j; ++y )
+        for( int32 x=0; x<i; ++x ) {
+          sum += image(x,y);
+          sum2 += int64(image(x,y)) * image(x,y);
+        }
+      EXPECT_EQ( sum, table.sums()(i,j) );
+      EXPECT_EQ( sum2, table.squares()(i,j) );
+    }
+
+  EXPECT_EQ( int64(image(2,1)), table.sum( BBox2i(2,1,1,1) ) );
+  EXPECT_EQ( int64(image(1,2)) + image(2,2) + image(1,3) + image(2,3), table.sum( BBox2i(1,2,2,2) ) );
+  EXPECT_EQ( int64(image(4,3))*image(4,3), table.sum_squares( BBox2i(4,3,1,1) ) );
+  EXPECT_EQ( 0, table.sum( BBox2i(3,3,0,0) ) );
+
+  SummedAreaTable<int64> plain( image );
+  EXPECT_FALSE( plain.has_squares() );
+  EXPECT_THROW( plain.squares(), LogicErr );
+}
+
+TEST( SummedAreaTable, Parallel ) {
+  uint32 tile = vw_settings().default_tile_size();
+  vw_settings().set_default_tile_size( 4 );
+
+  ImageView<float> image = make_image<float>( 37, 203 );
+  SummedAreaTable<double> serial( image, true, 1 );
+  for( int32 threads = 2; threads <= 7; ++threads ) {
+    SummedAreaTable<double> parallel( image, true, threads );
+    for( int32 j=0; j<=image.rows(); ++j )
+      for( int32 i=0; i<=image.cols(); ++i ) {
+        ASSERT_EQ( serial.sums()(i,j), parallel.sums()(i,j) ) << threads << " threads at " << i << "," << j;
+        ASSERT_EQ( serial.squares()(i,j), parallel.squares()(i,j) ) << threads << " threads at " << i << "," << j;
+      }
+  }
+
+  ImageView<PixelRGB<uint8> > rgb = make_image<PixelRGB<uint8> >( 9, 50 );
+  SummedAreaTable<PixelRGB<int64> > table = summed_area_table( rgb, false, 3 );
+  PixelRGB<int64> total;
+  for( int32 j=0; j<rgb.rows(); ++j )
+    for( int32 i=0; i<rgb.cols(); ++i )
+      total += channel_cast<int64>( rgb(i,j) );
+  EXPECT_PIXEL_EQ( total, table.sum( BBox2i(0,0,9,50) ) );
+
+  vw_settings().set_default_tile_size( tile );
+}
+
+TEST( SummedAreaTable, Empty ) {
+  ImageView<float> image;
+  SummedAreaTable<double> table( image, true );
+  EXPECT_EQ( 0, table.cols() );
+  EXPECT_EQ( 0, table.rows() );
+  EXPECT_EQ( 0, table.sums()(0,0) );
+}
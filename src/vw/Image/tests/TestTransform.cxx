@@ -148,3 +148,97 @@ TEST( Transform, Compose ) {
   }
 
 }
+
+template <class TransformT>
+static void check_reverse_row( TransformT const& tx ) {
+  Vector2 start(-3.5, 7.25);
+  std::vector<Vector2> row(20);
+  tx.reverse_row( start, row.size(), &row[0] );
+  for ( size_t i = 0; i < row.size(); i++ )
+    EXPECT_VECTOR_NEAR( tx.reverse(start+Vector2(i,0)), row[i], 1e-9 );
+}
+
+TEST( Transform, ReverseRow ) {
+  Matrix2x2 m( 1.5, -0.25, 0.5, 2 );
+  Matrix3x3 h( 1.1, 0.2, 3, -0.1, 0.9, -2, 1e-3, 2e-3, 1 );
+  check_reverse_row( ResampleTransform( 2, 0.5 ) );
+  check_reverse_row( TranslateTransform( 1.5, -2 ) );
+  check_reverse_row( LinearTransform( m ) );
+  check_reverse_row( AffineTransform( m, Vector2(3,-1) ) );
+  check_reverse_row( RotateTransform( M_PI/3, Vector2(2,2) ) );
+  check_reverse_row( HomographyTransform( h ) );
+  check_reverse_row( ApproximateTransform<HomographyTransform>( HomographyTransform( h ), BBox2i(0,0,32,32) ) );
+  check_reverse_row( TransformRef( HomographyTransform( h ) ) );
+  check_reverse_row( TransformRef( compose( TranslateTransform( 1, 2 ), ResampleTransform( 2, 3 ) ) ) );
+}
+
+template <class ViewT>
+static void check_row_rasterize( ImageViewBase<ViewT> const& view ) {
+  ImageView<PixelRGB<float> > result = view.impl();
+  ASSERT_EQ( view.impl().cols(), result.cols() );
+  for ( int32 j = 0; j < result.rows(); j++ )
+    for ( int32 i = 0; i < result.cols(); i++ )
+      for ( int32 c = 0; c < 3; c++ )
+        EXPECT_NEAR( view.impl()(i,j)[c], result(i,j)[c], 1e-4 );
+}
+
+TEST( Transform, RowRasterize ) {
+  ImageView<PixelRGB<float> > im(12,10);
+  for ( int32 j = 0; j < im.rows(); j++ )
+    for ( int32 i = 0; i < im.cols(); i++ )
+      im(i,j) = PixelRGB<float>( i+j, i*j, 3*i-j );
+
+  // Both transforms map part of the output outside the source image,
+  // so the points near the edges take the edge extension path.
+  AffineTransform affine( Matrix2x2( 0.9, 0.2, -0.15, 1.1 ), Vector2(1.3,-0.7) );
+  Matrix3x3 h( 1.05, 0.1, -0.6, -0.05, 0.95, 0.4, 4e-3, -3e-3, 1 );
+  HomographyTransform homography( h );
+
+  check_row_rasterize( transform( im, affine, ConstantEdgeExtension(), BilinearInterpolation() ) );
+  check_row_rasterize( transform( im, affine, ZeroEdgeExtension(), BicubicInterpolation() ) );
+  check_row_rasterize( transform( im, homography, PeriodicEdgeExtension(), BicubicInterpolation() ) );
+  check_row_rasterize( transform( im, homography, ConstantEdgeExtension(), NearestPixelInterpolation() ) );
+  check_row_rasterize( transform( im, TransformRef( homography ), ZeroEdgeExtension(), BilinearInterpolation() ) );
+}
+
+// A smooth but nonlinear transform that counts its evaluations.
+struct CountingTransform : public TransformHelper<CountingTransform,ContinuousFunction,ContinuousFunction> {
+  int32 *m_count;
+  CountingTransform( int32* count ) : m_count(count) {}
+  Vector2 forward( Vector2 const& p ) const { return p; }
+  Vector2 reverse( Vector2 const& p ) const {
+    ++*m_count;
+    return Vector2( p.x() + 3*sin(p.y()/40), p.y() + 1e-3*p.x()*p.x() );
+  }
+};
+
+TEST( Transform, Approximate ) {
+  int32 count = 0;
+  CountingTransform tx( &count );
+  tx.set_tolerance( 0.05 );
+  BBox2i bbox( 10, -20, 256, 200 );
+  ApproximateTransform<CountingTransform> approx( tx, bbox );
+  EXPECT_LE( approx.max_error(), 0.05 );
+  EXPECT_GT( approx.max_error(), 0 );
+  EXPECT_GT( approx.num_cells(), 1u );
+  EXPECT_EQ( 0, approx.tolerance() );
+
+  // The mesh needs far fewer evaluations than there are pixels.
+  int32 built = count;
+  EXPECT_LT( built, bbox.width()*bbox.height()/5 );
+
+  double worst = 0;
+  for ( int32 y = bbox.min().y(); y < bbox.max().y(); y++ )
+    for ( int32 x = bbox.min().x(); x < bbox.max().x(); x++ ) {
+      Vector2 p( x, y );
+      worst = std::max( worst, norm_2( approx.reverse(p) - tx.reverse(p) ) );
+    }
+  EXPECT_LT( worst, 0.1 );
+  EXPECT_EQ( built + bbox.width()*bbox.height(), count );
+
+  // A tolerance that can't be met falls back to the real transform.
+  tx.set_tolerance( 1e-12 );
+  ApproximateTransform<CountingTransform> exact( tx, BBox2i(0,0,20,20) );
+  EXPECT_EQ( 0, exact.max_error() );
+  EXPECT_VECTOR_NEAR( tx.reverse(Vector2(7,11)), exact.reverse(Vector2(7,11)), 1e-12 );
+}
@@ -18,6 +18,7 @@
 #include <vw/InterestPoint/ImageOctave.h>
 #include <vw/InterestPoint/ImageOctaveHistory.h>
 #include <vw/InterestPoint/IntegralImage.h>
+#include <vw/InterestPoint/IntegralScaleSpace.h>
 
 // Operators
 #include <vw/InterestPoint/InterestOperator.h>
@@ -0,0 +1,204 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file BinaryDescriptor.cc
+///
+/// Support for binary descriptors.
+///
+#include <vw/InterestPoint/BinaryDescriptor.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace vw {
+namespace ip {
+
+  void pack_binary_descriptor( Vector<float> const& descriptor, uint64* code ) {
+    const size_t words = binary_code_words( descriptor.size() );
+    std::fill( code, code + words, uint64(0) );
+    for ( size_t i = 0; i < descriptor.size(); ++i )
+      code[i/8] |= uint64( uint8( descriptor[i] ) ) << (8*(i%8));
+  }
+
+  namespace {
+
+    // The 16 bit masks with each number of bits set, up to max_radius.
+    std::vector<std::vector<uint32> > substring_masks( uint32 max_radius ) {
+      std::vector<std::vector<uint32> > masks( max_radius + 1 );
+      for ( uint32 mask = 0; mask < 0x10000; ++mask ) {
+        uint32 bits = popcount( mask );
+        if ( bits <= max_radius )
+          masks[bits].push_back( mask );
+      }
+      return masks;
+    }
+
+    // Keeps the two nearest codes met so far, each code once.
+    inline void consider( int32 j, uint32 distance_j, int32 index[2], uint32 distance[2] ) {
+      if ( j == index[0] || j == index[1] )
+        return;
+      if ( distance_j < distance[0] ) {
+        index[1] = index[0];       distance[1] = distance[0];
+        index[0] = j;              distance[0] = distance_j;
+      } else if ( distance_j < distance[1] ) {
+        index[1] = j;              distance[1] = distance_j;
+      }
+    }
+
+  } // namespace
+
+  MultiIndexHash::MultiIndexHash( std::vector<uint64> const& codes, size_t words, uint32 max_radius )
+    : m_words(words), m_substrings(4*words), m_max_radius(max_radius), m_codes(codes),
+      m_masks(substring_masks(max_radius)), m_offsets(4*words), m_entries(4*words) {
+    VW_ASSERT( words > 0 && codes.size() % words == 0,
+               ArgumentErr() << "MultiIndexHash: codes are not a whole number of words." );
+    VW_ASSERT( max_radius < 16, ArgumentErr() << "MultiIndexHash: radius exceeds the substring length." );
+    const size_t n = size();
+    for ( size_t t = 0; t < m_substrings; ++t ) {
+      // Counting sort of the codes by their t'th substring.
+      std::vector<uint32>& offsets = m_offsets[t];
+      offsets.assign( 0x10001, 0 );
+      for ( size_t i = 0; i < n; ++i )
+        offsets[ substring( code(i), t ) + 1 ]++;
+      for ( size_t k = 0; k < 0x10000; ++k )
+        offsets[k+1] += offsets[k];
+      std::vector<uint32> next( offsets.begin(), offsets.end() - 1 );
+      m_entries[t].resize( n );
+      for ( size_t i = 0; i < n; ++i )
+        m_entries[t][ next[ substring( code(i), t ) ]++ ] = uint32(i);
+    }
+  }
+
+  void MultiIndexHash::find_two_nearest( uint64 const* query, int32 index[2], uint32 distance[2],
+                                         double ratio ) const {
+    index[0] = index[1] = -1;
+    distance[0] = distance[1] = std::numeric_limits<uint32>::max();
+    const size_t n = size();
+
+    for ( uint32 radius = 0; radius <= m_max_radius; ++radius ) {
+      for ( size_t t = 0; t < m_substrings; ++t ) {
+        std::vector<uint32> const& offsets = m_offsets[t];
+        std::vector<uint32> const& entries = m_entries[t];
+        const uint32 key = substring( query, t );
+        for ( size_t k = 0; k < m_masks[radius].size(); ++k ) {
+          const uint32 bucket = key ^ m_masks[radius][k];
+          for ( uint32 e = offsets[bucket]; e < offsets[bucket+1]; ++e )
+            consider( int32(entries[e]), hamming_distance( query, code(entries[e]), m_words ),
+                      index, distance );
+        }
+      }
+
+      // Every code nearer than this has now been met.
+      const uint32 bound = uint32( m_substrings * (radius + 1) );
+      if ( distance[1] < bound )
+        return;
+      if ( ratio > 0 && n >= 2 && distance[0] < bound &&
+           distance[0] < ratio * std::min( distance[1], bound ) ) {
+        if ( distance[1] > bound ) {
+          index[1] = -1;
+          distance[1] = bound;
+        }
+        return;
+      }
+    }
+
+    // Too far for the tables to settle; compare every code.
+    for ( size_t j = 0; j < n; ++j )
+      consider( int32(j), hamming_distance( query, code(j), m_words ), index, distance );
+  }
+
+  namespace {
+
+    // Finds the two nearest reference codes for each of the query codes
+    // [begin, end), every pair compared or through a hash.
+    class HammingSearchTask : public Task, private boost::noncopyable {
+      std::vector<uint64> const& m_query;
+      std::vector<uint64> const& m_reference;
+      MultiIndexHash const* m_hash;
+      size_t m_words;
+      double m_ratio;
+      Matrix<int>& m_indices;
+      Matrix<float>& m_distances;
+      size_t m_begin, m_end;
+    public:
+      HammingSearchTask( std::vector<uint64> const& query, std::vector<uint64> const& reference,
+                         MultiIndexHash const* hash, size_t words, double ratio,
+                         Matrix<int>& indices, Matrix<float>& distances, size_t begin, size_t end ) :
+        m_query(query), m_reference(reference), m_hash(hash), m_words(words), m_ratio(ratio),
+        m_indices(indices), m_distances(distances), m_begin(begin), m_end(end) {}
+
+      void operator()() {
+        const size_t n = m_reference.size() / m_words;
+        for ( size_t i = m_begin; i < m_end; ++i ) {
+          uint64 const* code = &m_query[i * m_words];
+          int32 index[2];
+          uint32 distance[2];
+          if ( m_hash ) {
+            m_hash->find_two_nearest( code, index, distance, m_ratio );
+          } else {
+            index[0] = index[1] = -1;
+            distance[0] = distance[1] = std::numeric_limits<uint32>::max();
+            for ( size_t j = 0; j < n; ++j )
+              consider( int32(j), hamming_distance( code, &m_reference[j * m_words], m_words ),
+                        index, distance );
+          }
+          for ( size_t k = 0; k < 2; ++k ) {
+            m_indices(i,k) = index[k];
+            if ( distance[k] != std::numeric_limits<uint32>::max() )
+              m_distances(i,k) = float( distance[k] );
+          }
+        }
+      }
+    };
+
+  } // namespace
+
+  void find_two_nearest_hamming( std::vector<uint64> const& query, std::vector<uint64> const& reference,
+                                 size_t words, Matrix<int>& indices, Matrix<float>& distances,
+                                 double ratio, uint64 brute_force_limit,
+                                 const ProgressCallback &progress_callback ) {
+    const size_t n_query = words ? query.size() / words : 0;
+    const size_t n_reference = words ? reference.size() / words : 0;
+    indices.set_size( n_query, 2 );
+    distances.set_size( n_query, 2 );
+    for ( size_t i = 0; i < n_query; ++i )
+      for ( size_t k = 0; k < 2; ++k ) {
+        indices(i,k) = -1;
+        distances(i,k) = std::numeric_limits<float>::max();
+      }
+    progress_callback.report_progress(0);
+    if ( n_query == 0 || n_reference == 0 ) {
+      progress_callback.report_finished();
+      return;
+    }
+
+    boost::scoped_ptr<MultiIndexHash> hash;
+    if ( uint64(n_query) * uint64(n_reference) > brute_force_limit ) {
+      hash.reset( new MultiIndexHash( reference, words ) );
+      vw_out(InfoMessage,"interest_point") << "Multi-index hash created for " << n_reference
+                                           << " codes. Searching...\n";
+    }
+
+    const size_t threads = vw_settings().default_num_threads();
+    const size_t block = std::max( size_t(64), n_query / (4*threads) + 1 );
+    FifoWorkQueue queue( threads );
+    for ( size_t begin = 0; begin < n_query; begin += block ) {
+      boost::shared_ptr<Task> task( new HammingSearchTask( query, reference, hash.get(), words, ratio,
+                                                           indices, distances, begin,
+                                                           std::min( begin + block, n_query ) ) );
+      queue.add_task( task );
+    }
+    queue.join_all();
+    progress_callback.report_finished();
+  }
+
+}} // namespace vw::ip
@@ -0,0 +1,137 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file BinaryDescriptor.h
+///
+/// Support for binary descriptors, such as those made by
+/// BRIEFDescriptorGenerator, which are compared by the number of bits
+/// in which they differ.  A binary descriptor is kept in the usual
+/// Vector<float> of an InterestPoint, one byte of the code to each
+/// element, and packed into 64 bit words for matching.
+///
+#ifndef __VW_INTERESTPOINT_BINARYDESCRIPTOR_H__
+#define __VW_INTERESTPOINT_BINARYDESCRIPTOR_H__
+
+#include <vw/Core/ProgressCallback.h>
+#include <vw/Math/Matrix.h>
+#include <vw/InterestPoint/InterestData.h>
+
+#include <vector>
+
+namespace vw {
+namespace ip {
+
+  /// The number of bits set in x.
+  inline uint32 popcount( uint64 x ) {
+#if defined(__GNUC__)
+    return __builtin_popcountll( x );
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return uint32( (x * 0x0101010101010101ULL) >> 56 );
+#endif
+  }
+
+  /// The number of bits in which two codes of the given number of
+  /// words differ.
+  inline uint32 hamming_distance( uint64 const* a, uint64 const* b, size_t words ) {
+    uint32 distance = 0;
+    for ( size_t i = 0; i < words; ++i )
+      distance += popcount( a[i] ^ b[i] );
+    return distance;
+  }
+
+  /// The number of 64 bit words a binary descriptor of the given
+  /// number of elements packs into.
+  inline size_t binary_code_words( size_t descriptor_size ) {
+    return ( descriptor_size + 7 ) / 8;
+  }
+
+  /// Packs a binary descriptor, one byte to each element, into
+  /// binary_code_words(descriptor.size()) words at code.  The bits past
+  /// the end of the descriptor are zero.
+  void pack_binary_descriptor( Vector<float> const& descriptor, uint64* code );
+
+  /// Packs the descriptors of a list of points, one after the other.
+  /// They must all be the same size.  Returns the words per code.
+  template <class IterT>
+  size_t pack_binary_descriptors( IterT begin, IterT end, std::vector<uint64>& codes ) {
+    codes.clear();
+    if ( begin == end )
+      return 0;
+    const size_t size = begin->descriptor.size();
+    const size_t words = binary_code_words( size );
+    codes.resize( words * std::distance( begin, end ) );
+    for ( size_t i = 0; begin != end; ++begin, i += words ) {
+      VW_ASSERT( begin->descriptor.size() == size,
+                 ArgumentErr() << "pack_binary_descriptors: descriptor sizes do not agree." );
+      pack_binary_descriptor( begin->descriptor, &codes[i] );
+    }
+    return words;
+  }
+
+  /// A multi-index hash of binary codes (Norouzi, Punjani and Fleet,
+  /// "Fast Search in Hamming Space with Multi-Index Hashing").  Each
+  /// code is cut into 16 bit substrings, with a table for each
+  /// substring position of the codes having each value there.  Two
+  /// codes that differ in fewer than m*(r+1) bits, for m substrings,
+  /// have some substring within r bits of each other, so the tables
+  /// searched to radius r find every code that near exactly.
+  class MultiIndexHash {
+    size_t m_words, m_substrings;
+    uint32 m_max_radius;
+    std::vector<uint64> m_codes;
+    // The substring masks with each number of bits set.
+    std::vector<std::vector<uint32> > m_masks;
+    // For each substring position, the start in m_entries of the
+    // codes with each of its 65536 values, and the codes themselves.
+    std::vector<std::vector<uint32> > m_offsets, m_entries;
+
+    uint32 substring( uint64 const* code, size_t t ) const {
+      return uint32( code[t/4] >> (16*(t%4)) ) & 0xffff;
+    }
+
+  public:
+    /// Indexes the codes, words 64 bit words each.  The tables are
+    /// searched to max_radius bits per substring before the search
+    /// falls back to comparing every code.
+    MultiIndexHash( std::vector<uint64> const& codes, size_t words, uint32 max_radius = 1 );
+
+    size_t size() const { return m_words ? m_codes.size() / m_words : 0; }
+    size_t words() const { return m_words; }
+    uint64 const* code( size_t i ) const { return &m_codes[i * m_words]; }
+
+    /// Finds the two indexed codes nearest to code, writing their
+    /// indices, or -1 where there are too few codes, and distances.
+    ///
+    /// With ratio above zero the search may stop once the nearest code
+    /// is certain and nearer than ratio times any other could be.
+    /// distance[1] is then only a lower bound on the second distance,
+    /// and index[1] -1 unless a code that near was met, which is all a
+    /// ratio test needs.
+    void find_two_nearest( uint64 const* code, int32 index[2], uint32 distance[2],
+                           double ratio = 0 ) const;
+  };
+
+  /// For each code of query, finds the two codes of reference with the
+  /// fewest differing bits, as find_two_nearest() does for float
+  /// descriptors.  Row i of indices holds their indices, nearest first,
+  /// or -1, and row i of distances their Hamming distances.  ratio is
+  /// passed on to MultiIndexHash::find_two_nearest().
+  ///
+  /// When there are at most brute_force_limit pairs every pair is
+  /// compared, otherwise reference is put in a MultiIndexHash.  The
+  /// queries are spread over the default number of threads either way.
+  void find_two_nearest_hamming( std::vector<uint64> const& query, std::vector<uint64> const& reference,
+                                 size_t words, Matrix<int>& indices, Matrix<float>& distances,
+                                 double ratio = 0, uint64 brute_force_limit = uint64(1) << 22,
+                                 const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() );
+
+}} // namespace vw::ip
+
+#endif // __VW_INTERESTPOINT_BINARYDESCRIPTOR_H__
@@ -11,9 +11,29 @@
 ///
 #include <vw/InterestPoint/Descriptor.h>
 
+#include <map>
+
 namespace vw {
 namespace ip {
 
+  std::vector<std::vector<size_t> >
+  group_points_by_tile( std::vector<InterestPoint const*> const& points, int32 tile_size ) {
+    VW_ASSERT( tile_size > 0, ArgumentErr() << "group_points_by_tile: tile size must be positive." );
+    std::map<std::pair<int32,int32>, size_t> tile_index;
+    std::vector<std::vector<size_t> > tiles;
+    for ( size_t i = 0; i < points.size(); ++i ) {
+      std::pair<int32,int32> key( int32(floor(points[i]->y / tile_size)),
+                                  int32(floor(points[i]->x / tile_size)) );
+      std::map<std::pair<int32,int32>, size_t>::iterator it = tile_index.find( key );
+      if ( it == tile_index.end() ) {
+        it = tile_index.insert( std::make_pair( key, tiles.size() ) ).first;
+        tiles.push_back( std::vector<size_t>() );
+      }
+      tiles[it->second].push_back( i );
+    }
+    return tiles;
+  }
+
   const uint32 SGradDescriptorGenerator::box_strt[5] = {17,15,9,6,0};
   const uint32 SGradDescriptorGenerator::box_size[5] = {2,4,8,10,14};
   const uint32 SGradDescriptorGenerator::box_half[5] = {1,2,4,5,7};
@@ -13,10 +13,13 @@
 #define __VW_INTERESTPOINT_DESCRIPTOR_H__
 
 #include <vw/Core/Debugging.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Transform.h>
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointSet.h>
 #include <vw/InterestPoint/MatrixIO.h>
 #include <vw/InterestPoint/VectorIO.h>
 #include <vw/InterestPoint/IntegralImage.h>
@@ -24,6 +27,60 @@
 namespace vw {
 namespace ip {
 
+  /// Groups points by the tile_size square tile of the image each
+  /// falls in, returning the indices of the points of each tile.
+  std::vector<std::vector<size_t> >
+  group_points_by_tile( std::vector<InterestPoint const*> const& points, int32 tile_size );
+
+  /// \cond INTERNAL
+  // Computes the descriptors of the points of one tile.  The part of
+  // the image their support regions cover is rasterized once, and the
+  // supports are resampled from it.
+  template <class GeneratorT, class ViewT>
+  class DescriptorTileTask : public Task, private boost::noncopyable {
+    GeneratorT& m_generator;
+    ViewT const& m_image;
+    std::vector<InterestPoint const*> const& m_points;
+    std::vector<float*> const& m_descriptors;
+    std::vector<size_t> m_indices;
+
+  public:
+    DescriptorTileTask( GeneratorT& generator, ViewT const& image,
+                        std::vector<InterestPoint const*> const& points,
+                        std::vector<float*> const& descriptors,
+                        std::vector<size_t> const& indices ) :
+      m_generator(generator), m_image(image), m_points(points),
+      m_descriptors(descriptors), m_indices(indices) {}
+
+    void operator()() {
+      // A support pixel is at most half_size*sqrt(2)*scale from the
+      // point, and bilinear interpolation reads one pixel further.
+      float half_size = float(m_generator.support_size() - 1) / 2.0f;
+      BBox2i region;
+      for ( size_t k = 0; k < m_indices.size(); ++k ) {
+        InterestPoint const& pt = *m_points[m_indices[k]];
+        float radius = half_size * float(M_SQRT2) * pt.scale + 2;
+        region.grow( Vector2i( int32(floor(pt.x - radius)), int32(floor(pt.y - radius)) ) );
+        region.grow( Vector2i( int32(ceil(pt.x + radius)) + 1, int32(ceil(pt.y + radius)) + 1 ) );
+      }
+      ImageView<PixelGray<float> > tile =
+        crop( edge_extend( pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(m_image)),
+                           ZeroEdgeExtension() ), region );
+
+      int32 size = m_generator.descriptor_size();
+      ImageView<PixelGray<float> > support;
+      for ( size_t k = 0; k < m_indices.size(); ++k ) {
+        InterestPoint const& pt = *m_points[m_indices[k]];
+        InterestPoint local( pt.x - region.min().x(), pt.y - region.min().y(),
+                             pt.scale, pt.interest, pt.orientation );
+        support = m_generator.get_support( local, tile );
+        float* descriptor = m_descriptors[m_indices[k]];
+        m_generator.compute_descriptor( support, descriptor, descriptor + size );
+      }
+    }
+  };
+  /// \endcond
+
   template <class ImplT>
   class DescriptorGeneratorBase {
 
@@ -37,7 +94,9 @@ namespace ip {
 
     // Given an image and a list of interest points, set the
     // descriptor field of the interest points using the
-    // compute_descriptor() method provided by the subclass.
+    // compute_descriptor() method provided by the subclass.  The
+    // points are described a tile at a time on the default number of
+    // threads, unless the subclass says it is not threaded().
     template <class ViewT>
     void operator() ( ImageViewBase<ViewT> const& image,
                       InterestPointList& points ) {
@@ -45,19 +104,73 @@ namespace ip {
       // Timing
       Timer total("\tTotal elapsed time", DebugMessage, "interest_point");
 
-      for (InterestPointList::iterator i = points.begin(); i != points.end(); ++i) {
+      if ( !impl().threaded() ) {
+        for (InterestPointList::iterator i = points.begin(); i != points.end(); ++i) {
+
+          // First we compute the support region based on the interest point
+          ImageView<PixelGray<float> > support = get_support(*i, pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(image.impl())));
 
-        // First we compute the support region based on the interest point
-        ImageView<PixelGray<float> > support = get_support(*i, pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(image.impl())));
+          // Next, we pass the support region and the interest point to
+          // the descriptor generator ( compute_descriptor() ) supplied
+          // by the subclass.
+          i->descriptor.set_size( impl().descriptor_size() );
+          impl().compute_descriptor( support, i->begin(), i->end() );
+        }
+        return;
+      }
 
-        // Next, we pass the support region and the interest point to
-        // the descriptor generator ( compute_descriptor() ) supplied
-        // by the subclass.
+      std::vector<InterestPoint const*> geometry;
+      std::vector<float*> descriptors;
+      geometry.reserve( points.size() );
+      descriptors.reserve( points.size() );
+      for (InterestPointList::iterator i = points.begin(); i != points.end(); ++i) {
         i->descriptor.set_size( impl().descriptor_size() );
-        impl().compute_descriptor( support, i->begin(), i->end() );
+        geometry.push_back( &*i );
+        descriptors.push_back( i->size() ? &i->descriptor[0] : 0 );
+      }
+      describe_tiles( image.impl(), geometry, descriptors );
+    }
+
+    // The same for an InterestPointSet.  The descriptors are written
+    // straight into the set's descriptor matrix.
+    template <class ViewT>
+    void operator() ( ImageViewBase<ViewT> const& image,
+                      InterestPointSet& points ) {
+
+      // Timing
+      Timer total("\tTotal elapsed time", DebugMessage, "interest_point");
+
+      points.set_descriptor_size( impl().descriptor_size() );
+      std::vector<InterestPoint> geometry;
+      geometry.reserve( points.size() );
+      for (size_t i = 0; i < points.size(); ++i)
+        geometry.push_back( InterestPoint( points.x()[i], points.y()[i], points.scale()[i],
+                                           points.interest()[i], points.orientation()[i] ) );
+
+      if ( !impl().threaded() ) {
+        ImageView<PixelGray<float> > support;
+        for (size_t i = 0; i < points.size(); ++i) {
+          support = get_support(geometry[i], pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(image.impl())));
+          impl().compute_descriptor( support, points.descriptor(i),
+                                     points.descriptor(i) + points.descriptor_size() );
+        }
+        return;
+      }
+
+      std::vector<InterestPoint const*> geometry_ptrs( points.size() );
+      std::vector<float*> descriptors( points.size() );
+      for (size_t i = 0; i < points.size(); ++i) {
+        geometry_ptrs[i] = &geometry[i];
+        descriptors[i] = points.descriptor(i);
       }
+      describe_tiles( image.impl(), geometry_ptrs, descriptors );
     }
 
+    // Whether compute_descriptor() may run on several points at once.
+    // Generators that keep state from one point to the next must
+    // return false, and are then run serially, in order.
+    bool threaded() const { return true; }
+
     // Default suport size ( i.e. descriptor window)
     int support_size() { return 41; }
     // Default descriptor(vector) length
@@ -83,6 +196,25 @@ namespace ip {
                        impl().support_size(), impl().support_size() );
     }
 
+  protected:
+    // Describes the points a tile of the image at a time, one task per
+    // tile, writing each descriptor to the matching pointer.
+    template <class ViewT>
+    void describe_tiles( ViewT const& image,
+                         std::vector<InterestPoint const*> const& points,
+                         std::vector<float*> const& descriptors ) {
+      typedef DescriptorTileTask<ImplT, ViewT> task_type;
+
+      int32 tile_size = vw_settings().default_tile_size();
+      std::vector<std::vector<size_t> > tiles = group_points_by_tile( points, tile_size );
+
+      FifoWorkQueue queue( vw_settings().default_num_threads() );
+      for (size_t i = 0; i < tiles.size(); ++i) {
+        boost::shared_ptr<task_type> task( new task_type( impl(), image, points, descriptors, tiles[i] ) );
+        queue.add_task( task );
+      }
+      queue.join_all();
+    }
   };
 
   /// A basic example descriptor class. The descriptor for an interest
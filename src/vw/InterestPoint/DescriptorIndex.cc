@@ -0,0 +1,187 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DescriptorIndex.cc
+///
+/// A search tree over the descriptors of one image's interest points.
+///
+#include <vw/InterestPoint/DescriptorIndex.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace vw {
+namespace ip {
+
+  namespace {
+    void copy_descriptors( InterestPointSet const& points, Matrix<float>& descriptors ) {
+      const size_t size = points.descriptor_size();
+      descriptors.set_size( points.size(), size );
+      for ( size_t j = 0; j < points.size(); ++j )
+        std::copy( points.descriptor(j), points.descriptor(j) + size, &descriptors(j,0) );
+    }
+  }
+
+#if VW_HAVE_PKG_FLANN
+  namespace {
+
+    typedef math::FLANNTree<flann::L2<float> > TreeType;
+
+    // Queries the rows [begin, end) of the query at once, into buffers
+    // of the task's own.
+    class FLANNSearchTask : public Task, private boost::noncopyable {
+      TreeType& m_tree;
+      InterestPointSet const& m_query;
+      Matrix<int>& m_indices;
+      Matrix<float>& m_distances;
+      size_t m_begin, m_end;
+    public:
+      FLANNSearchTask( TreeType& tree, InterestPointSet const& query,
+                       Matrix<int>& indices, Matrix<float>& distances, size_t begin, size_t end ) :
+        m_tree(tree), m_query(query), m_indices(indices), m_distances(distances),
+        m_begin(begin), m_end(end) {}
+
+      void operator()() {
+        const size_t size = m_query.descriptor_size();
+        Matrix<float> block( m_end - m_begin, size );
+        for ( size_t i = m_begin; i < m_end; ++i )
+          std::copy( m_query.descriptor(i), m_query.descriptor(i) + size, &block(i - m_begin,0) );
+        Matrix<int> indices;
+        Matrix<float> distances;
+        m_tree.knn_search( block, indices, distances, 2 );
+        submatrix( m_indices, m_begin, 0, m_end - m_begin, 2 ) = indices;
+        submatrix( m_distances, m_begin, 0, m_end - m_begin, 2 ) = distances;
+      }
+    };
+
+  } // namespace
+
+  DescriptorIndex::DescriptorIndex( InterestPointSet const& points ) : m_points(points) {
+    if ( m_points.empty() )
+      return;
+    copy_descriptors( m_points, m_descriptors );
+    m_tree.reset( new TreeType( m_descriptors ) );
+    vw_out(InfoMessage,"interest_point") << "FLANN-Tree created for " << size() << " points.\n";
+  }
+
+  DescriptorIndex::DescriptorIndex( InterestPointSet const& points, std::string const& filename )
+    : m_points(points) {
+    if ( m_points.empty() )
+      return;
+    copy_descriptors( m_points, m_descriptors );
+    try {
+      m_tree.reset( new TreeType( m_descriptors, flann::SavedIndexParams( filename ) ) );
+    } catch ( std::exception const& e ) {
+      vw_throw( IOErr() << "DescriptorIndex: cannot read \"" << filename << "\": " << e.what() );
+    }
+    VW_ASSERT( m_tree->size1() == size() && m_tree->size2() == descriptor_size(),
+               IOErr() << "DescriptorIndex: \"" << filename << "\" is the index of other points." );
+  }
+
+  void DescriptorIndex::find_two_nearest( InterestPointSet const& query,
+                                          Matrix<int>& indices, Matrix<float>& distances,
+                                          const ProgressCallback &progress_callback ) const {
+    VW_ASSERT( query.empty() || empty() || query.descriptor_size() == descriptor_size(),
+               ArgumentErr() << "DescriptorIndex: descriptor sizes do not agree." );
+    indices.set_size( query.size(), 2 );
+    distances.set_size( query.size(), 2 );
+    for ( size_t i = 0; i < query.size(); ++i )
+      for ( size_t k = 0; k < 2; ++k ) {
+        indices(i,k) = -1;
+        distances(i,k) = std::numeric_limits<float>::max();
+      }
+    progress_callback.report_progress(0);
+    if ( query.empty() || empty() ) {
+      progress_callback.report_finished();
+      return;
+    }
+
+    if ( size() < 2 ) {
+      // FLANN cannot return more neighbours than it has points.
+      Vector<int> nearest(1);
+      Vector<float> nearest_distance(1);
+      for ( size_t i = 0; i < query.size(); ++i ) {
+        m_tree->knn_search( VectorProxy<float>( descriptor_size(), const_cast<float*>(query.descriptor(i)) ),
+                            nearest, nearest_distance, 1 );
+        indices(i,0) = nearest[0];
+        distances(i,0) = nearest_distance[0];
+      }
+    } else {
+      const size_t threads = vw_settings().default_num_threads();
+      const size_t block = std::max( size_t(64), query.size() / (4*threads) + 1 );
+      FifoWorkQueue queue( threads );
+      for ( size_t begin = 0; begin < query.size(); begin += block ) {
+        boost::shared_ptr<Task> task( new FLANNSearchTask( *m_tree, query, indices, distances, begin,
+                                                           std::min( begin + block, query.size() ) ) );
+        queue.add_task( task );
+      }
+      queue.join_all();
+    }
+    progress_callback.report_finished();
+  }
+
+  bool DescriptorIndex::can_save() { return true; }
+
+  void DescriptorIndex::save( std::string const& filename ) const {
+    VW_ASSERT( m_tree, LogicErr() << "DescriptorIndex: an empty index has no tree to save." );
+    m_tree->save( filename );
+  }
+
+#else // VW_HAVE_PKG_FLANN
+
+  DescriptorIndex::DescriptorIndex( InterestPointSet const& points ) : m_points(points) {
+    if ( m_points.empty() )
+      return;
+    copy_descriptors( m_points, m_descriptors );
+    m_tree.reset( new math::FlatKDTree<float>( m_descriptors ) );
+    vw_out(InfoMessage,"interest_point") << "KD-Tree created for " << size() << " points, of depth " << m_tree->depth() << ".\n";
+  }
+
+  DescriptorIndex::DescriptorIndex( InterestPointSet const& points, std::string const& filename )
+    : m_points(points) {
+    vw_throw( NoImplErr() << "DescriptorIndex: cannot load \"" << filename
+              << "\"; saved indices need FLANN." );
+  }
+
+  void DescriptorIndex::find_two_nearest( InterestPointSet const& query,
+                                          Matrix<int>& indices, Matrix<float>& distances,
+                                          const ProgressCallback &progress_callback ) const {
+    VW_ASSERT( query.empty() || empty() || query.descriptor_size() == descriptor_size(),
+               ArgumentErr() << "DescriptorIndex: descriptor sizes do not agree." );
+    indices.set_size( query.size(), 2 );
+    distances.set_size( query.size(), 2 );
+    for ( size_t i = 0; i < query.size(); ++i )
+      for ( size_t k = 0; k < 2; ++k ) {
+        indices(i,k) = -1;
+        distances(i,k) = std::numeric_limits<float>::max();
+      }
+    progress_callback.report_progress(0);
+    if ( query.empty() || empty() ) {
+      progress_callback.report_finished();
+      return;
+    }
+
+    // The tree spreads the queries across the default number of threads.
+    Matrix<float> queries;
+    copy_descriptors( query, queries );
+    m_tree->knn_search( queries, indices, distances, 2 );
+    progress_callback.report_finished();
+  }
+
+  bool DescriptorIndex::can_save() { return false; }
+
+  void DescriptorIndex::save( std::string const& filename ) const {
+    vw_throw( NoImplErr() << "DescriptorIndex: cannot save \"" << filename
+              << "\"; FlatKDTree indices have no file form." );
+  }
+
+#endif // VW_HAVE_PKG_FLANN
+
+}} // namespace vw::ip
@@ -0,0 +1,94 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DescriptorIndex.h
+///
+/// A search tree over the descriptors of one image's interest points.
+/// Matching an image against several others builds its tree once and
+/// queries it with each of them, rather than building a tree for every
+/// pair.  With FLANN the tree can also be saved beside the interest
+/// point file and loaded again instead of being rebuilt.
+///
+#ifndef __VW_INTERESTPOINT_DESCRIPTORINDEX_H__
+#define __VW_INTERESTPOINT_DESCRIPTORINDEX_H__
+
+#include <vw/Core/ProgressCallback.h>
+#include <vw/Math/Matrix.h>
+#include <vw/InterestPoint/InterestPointSet.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+#if VW_HAVE_PKG_FLANN
+#include <vw/Math/FLANNTree.h>
+#else
+#include <vw/Math/FlatKDTree.h>
+#endif
+
+namespace vw {
+namespace ip {
+
+  /// The squared L2 distance between two descriptors, summed in four
+  /// parts that the compiler can keep in one vector register.
+  inline float squared_distance( float const* a, float const* b, size_t size ) {
+    float sum[4] = { 0, 0, 0, 0 };
+    size_t i = 0;
+    for ( ; i + 4 <= size; i += 4 )
+      for ( size_t k = 0; k < 4; k++ )
+        sum[k] += (a[i+k] - b[i+k])*(a[i+k] - b[i+k]);
+    for ( ; i < size; i++ )
+      sum[0] += (a[i] - b[i])*(a[i] - b[i]);
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+  }
+
+  class DescriptorIndex : private boost::noncopyable {
+    InterestPointSet m_points;
+    // The trees want the rows without their padding.
+    Matrix<float> m_descriptors;
+#if VW_HAVE_PKG_FLANN
+    boost::scoped_ptr<math::FLANNTree<flann::L2<float> > > m_tree;
+#else
+    boost::scoped_ptr<math::FlatKDTree<float> > m_tree;
+#endif
+
+  public:
+    /// Copies the points and builds the tree over their descriptors.
+    explicit DescriptorIndex( InterestPointSet const& points );
+
+    /// Copies the points and loads the tree over them that save()
+    /// wrote.  Throws a NoImplErr if can_save() is false, and an IOErr
+    /// if the file cannot be read.
+    DescriptorIndex( InterestPointSet const& points, std::string const& filename );
+
+    size_t size() const { return m_points.size(); }
+    bool empty() const { return m_points.empty(); }
+    size_t descriptor_size() const { return m_points.descriptor_size(); }
+
+    /// The points indexed, which the indices found refer to.
+    InterestPointSet const& points() const { return m_points; }
+
+    /// Finds the two indexed points nearest to each point of query, as
+    /// find_two_nearest() does.  Several threads may search at once.
+    void find_two_nearest( InterestPointSet const& query,
+                           Matrix<int>& indices, Matrix<float>& distances,
+                           const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+
+    /// Whether the tree can be written to and read from a file, which
+    /// needs FLANN; the FlatKDTree has no file form.
+    static bool can_save();
+
+    /// Writes the tree, without the points, to a file.  Throws a
+    /// NoImplErr if can_save() is false.
+    void save( std::string const& filename ) const;
+  };
+
+}} // namespace vw::ip
+
+#endif // __VW_INTERESTPOINT_DESCRIPTORINDEX_H__
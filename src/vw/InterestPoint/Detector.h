@@ -20,6 +20,7 @@
 #include <vw/Image/Filter.h>
 
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointSet.h>
 #include <vw/InterestPoint/Extrema.h>
 #include <vw/InterestPoint/Localize.h>
 #include <vw/InterestPoint/InterestOperator.h>
@@ -88,16 +89,26 @@ namespace ip {
     InterestPointList& m_interest_point_list;
     Mutex& m_mutex;
     int m_id, m_max_id;
+    size_t m_max_points;
 
   public:
     InterestPointDetectionTask(ViewT const& view, DetectorT& detector, BBox2i bbox,
-                               InterestPointList& ip_list, Mutex &mutex, int id, int max_id ) :
+                               InterestPointList& ip_list, Mutex &mutex, int id, int max_id,
+                               size_t max_points = 0 ) :
       m_view(view), m_detector(detector), m_bbox(bbox),
-      m_interest_point_list(ip_list), m_mutex(mutex), m_id(id), m_max_id(max_id) {}
+      m_interest_point_list(ip_list), m_mutex(mutex), m_id(id), m_max_id(max_id),
+      m_max_points(max_points) {}
 
     void operator()() {
       vw_out(InfoMessage, "interest_point") << "Locating interest points in block " << m_id << "/" << m_max_id << "   [ " << m_bbox << " ]\n";
       InterestPointList new_ip_list = m_detector(crop(pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(m_view.impl())), m_bbox),0);
+
+      // The tile's budget keeps its most interesting points, which
+      // holds it to a threshold of its own rather than one for the
+      // whole image.
+      if (m_max_points > 0)
+        cull_interest_points(new_ip_list, m_max_points);
+
       for (InterestPointList::iterator pt = new_ip_list.begin(); pt != new_ip_list.end(); ++pt) {
         (*pt).x +=  m_bbox.min().x();
         (*pt).ix += m_bbox.min().x();
@@ -118,8 +129,14 @@ namespace ip {
   /// This free function implements a multithreaded interest point
   /// detector.  Threads are spun off to process the image in
   /// 2048x2048 pixel blocks.
+  ///
+  /// With points_per_tile above zero each block keeps only that many
+  /// of its most interesting points, chosen in its own thread before
+  /// they are gathered.  This bounds the points a richly textured part
+  /// of the image can contribute, and spreads them over the image.
   template <class ViewT, class DetectorT>
-  InterestPointList detect_interest_points (ViewT const& view, DetectorT& detector) {
+  InterestPointList detect_interest_points (ViewT const& view, DetectorT& detector,
+                                            size_t points_per_tile = 0) {
     typedef InterestPointDetectionTask<ViewT, DetectorT> task_type;
 
     FifoWorkQueue queue(vw_settings().default_num_threads());
@@ -134,7 +151,7 @@ namespace ip {
     std::vector<BBox2i> bboxes = image_blocks(view.impl(),
                                               tile_size, tile_size);
     for (unsigned i = 0; i < bboxes.size(); ++i) {
-      boost::shared_ptr<task_type> task (new task_type(view, detector, bboxes[i], ip_list, mutex, i+1, bboxes.size() ) );
+      boost::shared_ptr<task_type> task (new task_type(view, detector, bboxes[i], ip_list, mutex, i+1, bboxes.size(), points_per_tile ) );
       queue.add_task(task);
     }
     vw_out(DebugMessage, "interest_point") << "Waiting for threads to terminate.\n";
@@ -144,6 +161,14 @@ namespace ip {
     return ip_list;
   }
 
+  /// The same, with the points returned in an InterestPointSet.
+  template <class ViewT, class DetectorT>
+  void detect_interest_points (ViewT const& view, DetectorT& detector, InterestPointSet& points,
+                               size_t points_per_tile = 0) {
+    InterestPointList ip_list = detect_interest_points( view, detector, points_per_tile );
+    points.assign( ip_list.begin(), ip_list.end() );
+  }
+
   /// Get the orientation of the point at (i0,j0,k0).  This is done by
   /// computing a gaussian weighted average orientations in a region
   /// around the detected point.  This is not the most sophisticated
@@ -258,9 +283,7 @@ namespace ip {
       {
         Timer t("elapsed time", DebugMessage, "interest_point");
         int original_num_points = points.size();
-        points.sort();
-        if ((m_max_points > 0) && (m_max_points < original_num_points))
-           points.resize(m_max_points);
+        cull_interest_points(points, m_max_points > 0 ? m_max_points : 0);
         vw_out(DebugMessage, "interest_point") << "done (removed " << original_num_points - points.size() << " interest points, " << points.size() << " remaining.), ";
       }
 
@@ -450,9 +473,7 @@ namespace ip {
         {
           Timer t("elapsed time", DebugMessage, "interest_point");
           int original_num_points = new_points.size();
-          new_points.sort();
-          if ((m_max_points > 0) && (m_max_points/m_octaves < (int)new_points.size()))
-            new_points.resize(m_max_points/m_octaves);
+          cull_interest_points(new_points, m_max_points > 0 ? std::max(m_max_points/m_octaves, 1) : 0);
           vw_out(DebugMessage, "interest_point") << "done (removed " << original_num_points - new_points.size() << " interest points, " << new_points.size() << " remaining.), ";
         }
 
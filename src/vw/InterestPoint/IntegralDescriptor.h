@@ -17,10 +17,41 @@
 
 #include <vw/InterestPoint/Descriptor.h>
 #include <vw/InterestPoint/IntegralImage.h>
+#include <vw/InterestPoint/IntegralScaleSpace.h>
+
+#include <boost/random/linear_congruential.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
 
 namespace vw {
 namespace ip {
 
+  /// \cond INTERNAL
+  // Computes the descriptors of the points of one tile from an
+  // integral image.
+  template <class GeneratorT, class IntegralT>
+  class IntegralDescriptorTileTask : public Task, private boost::noncopyable {
+    GeneratorT& m_generator;
+    IntegralT const& m_integral;
+    std::vector<InterestPoint*> const& m_points;
+    std::vector<size_t> m_indices;
+
+  public:
+    IntegralDescriptorTileTask( GeneratorT& generator, IntegralT const& integral,
+                                std::vector<InterestPoint*> const& points,
+                                std::vector<size_t> const& indices ) :
+      m_generator(generator), m_integral(integral), m_points(points), m_indices(indices) {}
+
+    void operator()() {
+      for ( size_t k = 0; k < m_indices.size(); ++k ) {
+        InterestPoint& pt = *m_points[m_indices[k]];
+        // Wrapping integral image for interpolation
+        pt.descriptor = m_generator.compute_descriptor( interpolate(m_integral), pt );
+      }
+    }
+  };
+  /// \endcond
+
   template <class ImplT>
   class IntegralDescriptorGeneratorBase {
 
@@ -34,22 +65,51 @@ namespace ip {
 
     // Given an image and a list of interest points, set the
     // descriptor field of the interest points using compute_descriptor()
-    // method.
+    // method.  The integral image is computed once, and the points
+    // are then described a tile at a time on the default number of
+    // threads.
     template <class ViewT>
     void operator() ( ImageViewBase<ViewT> const& image, InterestPointList& points ) {
-
       // Timing
       Timer total("\tTotal elapsed time", DebugMessage, "interest_point");
 
       m_integral = IntegralImage(pixel_cast<double>(channel_cast<double>(image.impl())));
+      describe( m_integral, points );
+    }
 
+    // The same, from the integral image of a scale space the points
+    // were detected in, which is not made again.
+    void operator() ( IntegralScaleSpace const& space, InterestPointList& points ) {
+      Timer total("\tTotal elapsed time", DebugMessage, "interest_point");
+      describe( space.integral(), points );
+    }
+
+    ImageView<double> const& integral() const { return m_integral; }
+
+  protected:
+
+    template <class PixelT>
+    void describe( ImageView<PixelT> const& integral, InterestPointList& points ) {
+      typedef IntegralDescriptorTileTask<ImplT, ImageView<PixelT> > task_type;
+
+      std::vector<InterestPoint*> pts;
+      std::vector<InterestPoint const*> geometry;
+      pts.reserve( points.size() );
+      geometry.reserve( points.size() );
       for (InterestPointList::iterator i = points.begin(); i != points.end(); ++i ) {
+        pts.push_back( &*i );
+        geometry.push_back( &*i );
+      }
+      std::vector<std::vector<size_t> > tiles =
+        group_points_by_tile( geometry, vw_settings().default_tile_size() );
 
-        // Wrapping integral image for interpolation
-        i->descriptor = impl().compute_descriptor( interpolate(m_integral), *i );
+      FifoWorkQueue queue( vw_settings().default_num_threads() );
+      for (size_t i = 0; i < tiles.size(); ++i) {
+        boost::shared_ptr<task_type> task( new task_type( impl(), integral, pts, tiles[i] ) );
+        queue.add_task( task );
       }
+      queue.join_all();
     }
-
   };
 
   // Simple Scaled Gradient Descriptor (v2)
@@ -161,6 +221,64 @@ namespace ip {
 
   };
 
+  // Steered BRIEF Descriptor. This is the binary descriptor of BRIEF
+  // (Calonder et al.) with its tests rotated by the orientation of the
+  // point, as in ORB. Each bit compares the means of two boxes a
+  // Gaussian distance from the point, the boxes and distances scaled
+  // by the point's scale. The 256 bits are kept one byte to an
+  // element, so the descriptors are matched with HammingMetric.
+  struct BRIEFDescriptorGenerator : public IntegralDescriptorGeneratorBase<BRIEFDescriptorGenerator> {
+
+    static const uint32 DESCRIPTOR_BITS = 256;
+
+    // The two box centers of each test, at unit scale.
+    std::vector<Vector4> m_tests;
+    float m_box_size;
+
+    BRIEFDescriptorGenerator( float patch_size = 31, float box_size = 5 ) : m_box_size(box_size) {
+      // A fixed seed, so every generator makes the same tests.
+      boost::rand48 gen(2011);
+      boost::normal_distribution<float> normal( 0, patch_size/5 );
+      boost::variate_generator<boost::rand48&, boost::normal_distribution<float> > sample( gen, normal );
+      const float limit = ( patch_size - box_size ) / 2;
+      m_tests.reserve( DESCRIPTOR_BITS );
+      for ( uint32 i = 0; i < DESCRIPTOR_BITS; i++ ) {
+        Vector4 test;
+        for ( uint32 k = 0; k < 4; k++ )
+          test[k] = std::max( -limit, std::min( limit, sample() ) );
+        m_tests.push_back( test );
+      }
+    }
+
+    template <class ViewT>
+    Vector<float> compute_descriptor ( ImageViewBase<ViewT> const& integral,
+                                       InterestPoint const& ip ) {
+
+      Vector<float> result(DESCRIPTOR_BITS/8);
+
+      float co = cos(ip.orientation);
+      float si = sin(ip.orientation);
+      Matrix2x2 rotate( co, -si, si, co );
+      float half = ip.scale*m_box_size/2;
+
+      for ( uint32 i = 0; i < DESCRIPTOR_BITS; i++ ) {
+        Vector2 a = ip.scale*rotate*subvector(m_tests[i],0,2) + Vector2(ip.x,ip.y);
+        Vector2 b = ip.scale*rotate*subvector(m_tests[i],2,2) + Vector2(ip.x,ip.y);
+        if ( box_sum( integral.impl(), a, half ) < box_sum( integral.impl(), b, half ) )
+          result[i/8] += float( 1 << (i%8) );
+      }
+      return result;
+    }
+
+  private:
+    // The sum of the pixels of a box of the given half size.
+    template <class ViewT>
+    static float box_sum( ViewT const& integral, Vector2 const& center, float half ) {
+      return integral( center.x() + half, center.y() + half ) - integral( center.x() - half, center.y() + half )
+        - integral( center.x() + half, center.y() - half ) + integral( center.x() - half, center.y() - half );
+    }
+  };
+
   // M-SURF Descriptor. This is an implementation of MU-SURF from
   // CenSurE's paper that includes the ability to take in consideration of
   // orientation. This is different from SURF in that samples are weighted
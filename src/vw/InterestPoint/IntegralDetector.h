@@ -16,6 +16,7 @@
 #include <vw/Image/Interpolation.h>
 #include <vw/InterestPoint/Detector.h>
 #include <vw/InterestPoint/IntegralImage.h>
+#include <vw/InterestPoint/IntegralScaleSpace.h>
 #include <deque>
 
 namespace vw {
@@ -114,7 +115,6 @@ namespace ip {
     template <class ViewT>
     InterestPointList process_image(ImageViewBase<ViewT> const& image ) const {
       typedef ImageView<typename PixelChannelType<typename ViewT::pixel_type>::type> ImageT;
-      typedef ImageInterestData<ImageT,InterestT> DataT;
 
       Timer total("\t\tTotal elapsed time", DebugMessage, "interest_point");
 
@@ -129,6 +129,22 @@ namespace ip {
         integral_image= IntegralImage( original_image );
       }
 
+      return process_integral( original_image, integral_image );
+    }
+
+    /// Detect Interest Points in the whole of a scale space, whose
+    /// integral image is then used again by the descriptors.
+    InterestPointList process_image( IntegralScaleSpace const& space ) const {
+      Timer total("\t\tTotal elapsed time", DebugMessage, "interest_point");
+      return process_integral( space.image(), space.integral() );
+    }
+
+  protected:
+
+    template <class ImageT>
+    InterestPointList process_integral( ImageT const& original_image, ImageT const& integral_image ) const {
+      typedef ImageInterestData<ImageT,InterestT> DataT;
+
       // Creating Scales
       std::deque<DataT> interest_data;
       interest_data.push_back( DataT(original_image, integral_image) );
@@ -201,9 +217,7 @@ namespace ip {
         vw_out(DebugMessage, "interest_point") << "\tCulling ...";
         Timer t("elapsed time", DebugMessage, "interest_point");
         int original_num_points = new_points.size();
-        new_points.sort();
-        if (m_max_points < original_num_points)
-          new_points.resize( m_max_points );
+        cull_interest_points( new_points, m_max_points );
         vw_out(DebugMessage, "interest_point") << "     (removed " << original_num_points - new_points.size() << " interest points, " << new_points.size() << " remaining.)\n";
       }
 
@@ -217,8 +231,6 @@ namespace ip {
       return new_points;
     }
 
-  protected:
-
     InterestT m_interest;
     int m_scales, m_max_points;
 
@@ -269,6 +281,16 @@ namespace ip {
   };
 
 
+  /// Detects the interest points of the whole of a scale space at
+  /// once, rather than a tile at a time, so that the scale space's
+  /// integral image can be handed on to the descriptor generator.
+  template <class InterestT>
+  InterestPointList detect_interest_points( IntegralScaleSpace const& space,
+                                            IntegralInterestPointDetector<InterestT>& detector ) {
+    vw_out(DebugMessage, "interest_point") << "Finding interest points in scale space: [ " << space.cols() << " x " << space.rows() << " ]\n";
+    return detector.process_image( space );
+  }
+
 }} // end vw::ip
 
 #endif//__VW_INTERESTPOINT_INTEGRAL_DETECTOR_H__
@@ -0,0 +1,49 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file IntegralScaleSpace.h
+///
+/// The integral image of an image, made once and shared by everything
+/// that works from it: the IntegralInterestPointDetector, its
+/// orientation assignment and the integral descriptor generators.
+/// Each scale of the box filter scale space is a few differences of
+/// the integral image, so only the integral image is kept.
+///
+#ifndef __VW_INTERESTPOINT_INTEGRALSCALESPACE_H__
+#define __VW_INTERESTPOINT_INTEGRALSCALESPACE_H__
+
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/InterestPoint/IntegralImage.h>
+
+namespace vw {
+namespace ip {
+
+  class IntegralScaleSpace {
+    ImageView<float> m_image, m_integral;
+
+  public:
+    /// The image is converted to the grayscale floating point image
+    /// that the detectors work on, as InterestDetectorBase does.
+    template <class ViewT>
+    explicit IntegralScaleSpace( ImageViewBase<ViewT> const& image ) {
+      m_image = pixel_cast<PixelGray<float> >( channel_cast_rescale<float>( image.impl() ) );
+      m_integral = IntegralImage( m_image );
+    }
+
+    int32 cols() const { return m_image.cols(); }
+    int32 rows() const { return m_image.rows(); }
+
+    ImageView<float> const& image() const { return m_image; }
+
+    /// The integral image, with a row and column more than the image.
+    ImageView<float> const& integral() const { return m_integral; }
+  };
+
+}} // namespace vw::ip
+
+#endif // __VW_INTERESTPOINT_INTEGRALSCALESPACE_H__
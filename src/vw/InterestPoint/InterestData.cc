@@ -10,6 +10,8 @@
 /// Basic classes and structures for storing image interest points.
 ///
 #include <fstream>
+#include <algorithm>
+#include <functional>
 #include <vw/InterestPoint/InterestData.h>
 
 namespace vw {
@@ -167,6 +169,34 @@ namespace ip {
   }
 
   /// Helpful functors
+  void cull_interest_points( InterestPointList& points, size_t max_points ) {
+    if ( max_points > 0 && max_points < points.size() ) {
+      // The interest of the last point kept.
+      std::vector<float> interest;
+      interest.reserve( points.size() );
+      for ( InterestPointList::const_iterator i = points.begin(); i != points.end(); ++i )
+        interest.push_back( i->interest );
+      std::nth_element( interest.begin(), interest.begin() + (max_points-1), interest.end(),
+                        std::greater<float>() );
+      const float last = interest[max_points-1];
+      size_t ties = max_points - std::count_if( interest.begin(), interest.end(),
+                                                std::bind2nd( std::greater<float>(), last ) );
+
+      InterestPointList::iterator i = points.begin();
+      while ( i != points.end() ) {
+        if ( i->interest > last ) {
+          ++i;
+        } else if ( i->interest == last && ties > 0 ) {
+          --ties;
+          ++i;
+        } else {
+          i = points.erase( i );
+        }
+      }
+    }
+    points.sort();
+  }
+
   void remove_descriptor( InterestPoint & ip ) { ip.descriptor.set_size(0); }
 
 }} // namespace vw::ip
@@ -120,6 +120,12 @@ namespace ip {
     return return_val;
   }
 
+  /// Keeps the max_points most interesting points, or all of them if
+  /// max_points is zero, sorted in descending order of interest.  The
+  /// points kept are chosen by partial selection, so only they are
+  /// sorted.  Of points tied for the last place, the first are kept.
+  void cull_interest_points( InterestPointList& points, size_t max_points );
+
   /// Helpful functors
   void remove_descriptor( InterestPoint & ip );
 
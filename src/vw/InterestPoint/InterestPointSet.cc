@@ -0,0 +1,336 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file InterestPointSet.cc
+///
+/// A container for large numbers of interest points.
+///
+#include <vw/InterestPoint/InterestPointSet.h>
+
+#include <cstring>
+#include <fstream>
+
+namespace vw {
+namespace ip {
+
+  InterestPointSet::InterestPointSet( size_t descriptor_size )
+    : m_descriptor_size(0), m_stride(0) {
+    set_descriptor_size( descriptor_size );
+  }
+
+  void InterestPointSet::reserve( size_t n ) {
+    m_x.reserve(n); m_y.reserve(n);
+    m_scale.reserve(n); m_orientation.reserve(n); m_interest.reserve(n);
+    m_polarity.reserve(n); m_octave.reserve(n); m_scale_lvl.reserve(n);
+    m_descriptors.reserve( n * m_stride );
+  }
+
+  void InterestPointSet::clear() {
+    m_x.clear(); m_y.clear();
+    m_scale.clear(); m_orientation.clear(); m_interest.clear();
+    m_polarity.clear(); m_octave.clear(); m_scale_lvl.clear();
+    m_descriptors.clear();
+  }
+
+  void InterestPointSet::resize( size_t n ) {
+    m_x.resize(n); m_y.resize(n);
+    m_scale.resize(n); m_orientation.resize(n); m_interest.resize(n);
+    m_polarity.resize(n); m_octave.resize(n); m_scale_lvl.resize(n);
+    m_descriptors.resize( n * m_stride, 0.0f );
+  }
+
+  void InterestPointSet::push_back( InterestPoint const& ip ) {
+    VW_ASSERT( ip.size() == 0 || ip.size() == m_descriptor_size,
+               ArgumentErr() << "InterestPointSet: descriptor has " << ip.size()
+               << " elements, not " << m_descriptor_size << "." );
+    m_x.push_back( ip.x );
+    m_y.push_back( ip.y );
+    m_scale.push_back( ip.scale );
+    m_orientation.push_back( ip.orientation );
+    m_interest.push_back( ip.interest );
+    m_polarity.push_back( ip.polarity );
+    m_octave.push_back( ip.octave );
+    m_scale_lvl.push_back( ip.scale_lvl );
+    m_descriptors.resize( m_descriptors.size() + m_stride, 0.0f );
+    std::copy( ip.begin(), ip.end(), descriptor( size() - 1 ) );
+  }
+
+  InterestPoint InterestPointSet::point( size_t i ) const {
+    InterestPoint ip( m_x[i], m_y[i], m_scale[i], m_interest[i], m_orientation[i],
+                      m_polarity[i] != 0, m_octave[i], m_scale_lvl[i] );
+    ip.descriptor.set_size( m_descriptor_size );
+    std::copy( descriptor(i), descriptor(i) + m_descriptor_size, ip.begin() );
+    return ip;
+  }
+
+  std::vector<InterestPoint> InterestPointSet::points() const {
+    std::vector<InterestPoint> result;
+    result.reserve( size() );
+    for ( size_t i = 0; i < size(); ++i )
+      result.push_back( point(i) );
+    return result;
+  }
+
+  void InterestPointSet::set_descriptor_size( size_t n ) {
+    m_descriptor_size = n;
+    m_stride = ( n + 3 ) / 4 * 4;
+    m_descriptors.assign( size() * m_stride, 0.0f );
+  }
+
+  std::vector<InterestPointSet::DescriptorRow> InterestPointSet::descriptor_rows() const {
+    std::vector<DescriptorRow> rows;
+    rows.reserve( size() );
+    for ( size_t i = 0; i < size(); ++i )
+      rows.push_back( descriptor_row(i) );
+    return rows;
+  }
+
+  // ---------------------------------------------------------------------------
+  //                         Interest point set files
+  // ---------------------------------------------------------------------------
+
+  namespace {
+
+    const char ip_set_magic[8] = { 'V','W','I','P','S','E','T','\0' };
+    const char match_set_magic[8] = { 'V','W','M','A','T','C','H','\0' };
+    const uint32 set_file_version = 1;
+    const uint32 byte_order_mark = 0x01020304;
+
+    // The arrays of an interest point set file, in order.
+    enum { IP_X, IP_Y, IP_SCALE, IP_ORIENTATION, IP_INTEREST, IP_POLARITY,
+           IP_OCTAVE, IP_SCALE_LVL, IP_DESCRIPTORS, IP_ARRAYS };
+
+    struct IPSetHeader {
+      char magic[8];
+      uint32 version, byte_order;
+      uint64 size, descriptor_size, stride;
+      uint64 offsets[IP_ARRAYS];
+    };
+
+    // The arrays of a match set file, in order.
+    enum { MATCH_INDEX1, MATCH_INDEX2, MATCH_X1, MATCH_Y1, MATCH_X2, MATCH_Y2, MATCH_ARRAYS };
+
+    struct MatchSetHeader {
+      char magic[8];
+      uint32 version, byte_order;
+      uint64 size;
+      uint64 offsets[MATCH_ARRAYS];
+    };
+
+    uint64 align16( uint64 offset ) { return ( offset + 15 ) / 16 * 16; }
+
+    // Places arrays of the given sizes after a header, each on a 16
+    // byte boundary, and returns the size of the file.
+    uint64 layout( uint64 header_size, uint64 const* bytes, size_t n, uint64* offsets ) {
+      uint64 end = header_size;
+      for ( size_t i = 0; i < n; ++i ) {
+        offsets[i] = align16( end );
+        end = offsets[i] + bytes[i];
+      }
+      return end;
+    }
+
+    // Writes a header and the arrays at the offsets it gives.
+    template <class HeaderT>
+    void write_arrays( std::string const& filename, HeaderT const& header,
+                       void const* const* arrays, uint64 const* bytes, size_t n ) {
+      std::ofstream f( filename.c_str(), std::ios::binary | std::ios::out );
+      if ( !f.is_open() )
+        vw_throw( IOErr() << "Failed to open \"" << filename << "\" for writing." );
+      f.write( reinterpret_cast<char const*>(&header), sizeof(header) );
+      uint64 position = sizeof(header);
+      static const char padding[16] = { 0 };
+      for ( size_t i = 0; i < n; ++i ) {
+        f.write( padding, std::streamsize( header.offsets[i] - position ) );
+        if ( bytes[i] )
+          f.write( static_cast<char const*>(arrays[i]), std::streamsize( bytes[i] ) );
+        position = header.offsets[i] + bytes[i];
+      }
+      if ( !f )
+        vw_throw( IOErr() << "Failed to write \"" << filename << "\"." );
+    }
+
+    // Checks the header at the start of a mapped file.
+    template <class HeaderT>
+    HeaderT const& check_header( MappedFile const& file, char const* magic ) {
+      if ( file.size() < sizeof(HeaderT) )
+        vw_throw( IOErr() << "\"" << file.filename() << "\" is too short for its header." );
+      HeaderT const& header = *reinterpret_cast<HeaderT const*>( file.data() );
+      if ( std::memcmp( header.magic, magic, 8 ) != 0 )
+        vw_throw( IOErr() << "\"" << file.filename() << "\" is not a " << magic << " file." );
+      if ( header.byte_order != byte_order_mark )
+        vw_throw( IOErr() << "\"" << file.filename() << "\" was written with another byte order." );
+      if ( header.version > set_file_version )
+        vw_throw( IOErr() << "\"" << file.filename() << "\" is version " << header.version
+                  << ", newer than this library reads." );
+      // Counts no file could hold would overflow the array sizes.
+      if ( header.size > file.size() )
+        vw_throw( IOErr() << "\"" << file.filename() << "\" is truncated or corrupt." );
+      return header;
+    }
+
+    // Checks that the arrays a header places lie within the file.
+    void check_arrays( MappedFile const& file, uint64 const* offsets, uint64 const* bytes, size_t n ) {
+      for ( size_t i = 0; i < n; ++i )
+        if ( offsets[i] % 16 != 0 || offsets[i] > file.size() || bytes[i] > file.size() - offsets[i] )
+          vw_throw( IOErr() << "\"" << file.filename() << "\" is truncated or corrupt." );
+    }
+
+    void ip_set_bytes( uint64 size, uint64 stride, uint64* bytes ) {
+      for ( size_t i = IP_X; i <= IP_INTEREST; ++i )
+        bytes[i] = size * sizeof(float);
+      bytes[IP_POLARITY] = size * sizeof(uint8);
+      bytes[IP_OCTAVE] = bytes[IP_SCALE_LVL] = size * sizeof(uint32);
+      bytes[IP_DESCRIPTORS] = size * stride * sizeof(float);
+    }
+
+    void match_set_bytes( uint64 size, uint64* bytes ) {
+      bytes[MATCH_INDEX1] = bytes[MATCH_INDEX2] = size * sizeof(uint64);
+      for ( size_t i = MATCH_X1; i <= MATCH_Y2; ++i )
+        bytes[i] = size * sizeof(float);
+    }
+
+    template <class T>
+    void const* array_data( std::vector<T> const& v ) { return v.empty() ? 0 : &v[0]; }
+
+  } // namespace
+
+  void write_binary_ip_set_file( std::string const& filename, InterestPointSet const& points ) {
+    IPSetHeader header;
+    std::memset( &header, 0, sizeof(header) );
+    std::memcpy( header.magic, ip_set_magic, 8 );
+    header.version = set_file_version;
+    header.byte_order = byte_order_mark;
+    header.size = points.size();
+    header.descriptor_size = points.descriptor_size();
+    header.stride = points.descriptor_stride();
+
+    uint64 bytes[IP_ARRAYS];
+    ip_set_bytes( header.size, header.stride, bytes );
+    layout( sizeof(header), bytes, IP_ARRAYS, header.offsets );
+
+    void const* arrays[IP_ARRAYS] = {
+      array_data( points.x() ), array_data( points.y() ), array_data( points.scale() ),
+      array_data( points.orientation() ), array_data( points.interest() ),
+      array_data( points.polarity() ), array_data( points.octave() ), array_data( points.scale_lvl() ),
+      points.empty() ? 0 : points.descriptor(0) };
+    write_arrays( filename, header, arrays, bytes, IP_ARRAYS );
+  }
+
+  void read_binary_ip_set_file( std::string const& filename, InterestPointSet& points ) {
+    MappedInterestPointSet( filename ).copy_to( points );
+  }
+
+  MappedInterestPointSet::MappedInterestPointSet( std::string const& filename )
+    : m_file( new MappedFile( filename ) ) {
+    IPSetHeader const& header = check_header<IPSetHeader>( *m_file, ip_set_magic );
+    if ( header.descriptor_size > m_file->size() ||
+         header.stride != ( header.descriptor_size + 3 ) / 4 * 4 )
+      vw_throw( IOErr() << "\"" << filename << "\" has a descriptor stride of " << header.stride
+                << " for " << header.descriptor_size << " elements." );
+    uint64 bytes[IP_ARRAYS];
+    ip_set_bytes( header.size, header.stride, bytes );
+    check_arrays( *m_file, header.offsets, bytes, IP_ARRAYS );
+
+    m_size = header.size;
+    m_descriptor_size = header.descriptor_size;
+    m_stride = header.stride;
+    uint8 const* data = m_file->data();
+    m_x = reinterpret_cast<float const*>( data + header.offsets[IP_X] );
+    m_y = reinterpret_cast<float const*>( data + header.offsets[IP_Y] );
+    m_scale = reinterpret_cast<float const*>( data + header.offsets[IP_SCALE] );
+    m_orientation = reinterpret_cast<float const*>( data + header.offsets[IP_ORIENTATION] );
+    m_interest = reinterpret_cast<float const*>( data + header.offsets[IP_INTEREST] );
+    m_polarity = data + header.offsets[IP_POLARITY];
+    m_octave = reinterpret_cast<uint32 const*>( data + header.offsets[IP_OCTAVE] );
+    m_scale_lvl = reinterpret_cast<uint32 const*>( data + header.offsets[IP_SCALE_LVL] );
+    m_descriptors = reinterpret_cast<float const*>( data + header.offsets[IP_DESCRIPTORS] );
+  }
+
+  InterestPoint MappedInterestPointSet::point( size_t i ) const {
+    InterestPoint ip( m_x[i], m_y[i], m_scale[i], m_interest[i], m_orientation[i],
+                      m_polarity[i] != 0, m_octave[i], m_scale_lvl[i] );
+    ip.descriptor.set_size( m_descriptor_size );
+    std::copy( descriptor(i), descriptor(i) + m_descriptor_size, ip.begin() );
+    return ip;
+  }
+
+  void MappedInterestPointSet::copy_to( InterestPointSet& points ) const {
+    points.clear();
+    points.set_descriptor_size( m_descriptor_size );
+    points.resize( m_size );
+    if ( m_size == 0 )
+      return;
+    std::copy( m_x, m_x + m_size, points.x().begin() );
+    std::copy( m_y, m_y + m_size, points.y().begin() );
+    std::copy( m_scale, m_scale + m_size, points.scale().begin() );
+    std::copy( m_orientation, m_orientation + m_size, points.orientation().begin() );
+    std::copy( m_interest, m_interest + m_size, points.interest().begin() );
+    std::copy( m_polarity, m_polarity + m_size, points.polarity().begin() );
+    std::copy( m_octave, m_octave + m_size, points.octave().begin() );
+    std::copy( m_scale_lvl, m_scale_lvl + m_size, points.scale_lvl().begin() );
+    std::copy( m_descriptors, m_descriptors + m_size * m_stride, points.descriptor(0) );
+  }
+
+  void write_binary_match_set_file( std::string const& filename,
+                                    InterestPointSet const& ip1, InterestPointSet const& ip2,
+                                    std::vector<std::pair<size_t,size_t> > const& matches ) {
+    const size_t n = matches.size();
+    std::vector<uint64> index1(n), index2(n);
+    std::vector<float> x1(n), y1(n), x2(n), y2(n);
+    for ( size_t i = 0; i < n; ++i ) {
+      VW_ASSERT( matches[i].first < ip1.size() && matches[i].second < ip2.size(),
+                 ArgumentErr() << "write_binary_match_set_file: match " << i << " is out of range." );
+      index1[i] = matches[i].first;
+      index2[i] = matches[i].second;
+      x1[i] = ip1.x()[matches[i].first];  y1[i] = ip1.y()[matches[i].first];
+      x2[i] = ip2.x()[matches[i].second]; y2[i] = ip2.y()[matches[i].second];
+    }
+
+    MatchSetHeader header;
+    std::memset( &header, 0, sizeof(header) );
+    std::memcpy( header.magic, match_set_magic, 8 );
+    header.version = set_file_version;
+    header.byte_order = byte_order_mark;
+    header.size = n;
+
+    uint64 bytes[MATCH_ARRAYS];
+    match_set_bytes( n, bytes );
+    layout( sizeof(header), bytes, MATCH_ARRAYS, header.offsets );
+    void const* arrays[MATCH_ARRAYS] = {
+      array_data( index1 ), array_data( index2 ),
+      array_data( x1 ), array_data( y1 ), array_data( x2 ), array_data( y2 ) };
+    write_arrays( filename, header, arrays, bytes, MATCH_ARRAYS );
+  }
+
+  void read_binary_match_set_file( std::string const& filename,
+                                   std::vector<std::pair<size_t,size_t> >& matches,
+                                   InterestPointSet& ip1, InterestPointSet& ip2 ) {
+    MappedFile file( filename );
+    MatchSetHeader const& header = check_header<MatchSetHeader>( file, match_set_magic );
+    uint64 bytes[MATCH_ARRAYS];
+    match_set_bytes( header.size, bytes );
+    check_arrays( file, header.offsets, bytes, MATCH_ARRAYS );
+
+    const size_t n = header.size;
+    uint64 const* index1 = reinterpret_cast<uint64 const*>( file.data() + header.offsets[MATCH_INDEX1] );
+    uint64 const* index2 = reinterpret_cast<uint64 const*>( file.data() + header.offsets[MATCH_INDEX2] );
+    float const* position[4];
+    for ( size_t k = 0; k < 4; ++k )
+      position[k] = reinterpret_cast<float const*>( file.data() + header.offsets[MATCH_X1 + k] );
+
+    matches.resize( n );
+    ip1 = InterestPointSet(); ip2 = InterestPointSet();
+    ip1.resize( n ); ip2.resize( n );
+    for ( size_t i = 0; i < n; ++i ) {
+      matches[i] = std::make_pair( size_t( index1[i] ), size_t( index2[i] ) );
+      ip1.x()[i] = position[0][i]; ip1.y()[i] = position[1][i];
+      ip2.x()[i] = position[2][i]; ip2.y()[i] = position[3][i];
+    }
+  }
+
+}} // namespace vw::ip
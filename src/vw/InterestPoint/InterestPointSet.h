@@ -0,0 +1,218 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file InterestPointSet.h
+///
+/// A container for large numbers of interest points.  Each field of
+/// the points is kept in an array of its own, and all the descriptors
+/// in one contiguous matrix, one row per point.  Describing and
+/// matching the points of a set makes no allocation per point, and the
+/// descriptors are read in order from memory.
+///
+#ifndef __VW_INTERESTPOINT_INTERESTPOINTSET_H__
+#define __VW_INTERESTPOINT_INTERESTPOINTSET_H__
+
+#include <vw/InterestPoint/InterestData.h>
+#include <vw/FileIO/MappedFile.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vw {
+namespace ip {
+
+  class InterestPointSet {
+  public:
+
+    /// One row of the descriptor matrix.  It has the begin(), end()
+    /// and operator[] of a descriptor, so a vector of rows can stand in
+    /// for a list of interest points where only the descriptors are
+    /// used (as the records of a math::KDTree, say).
+    class DescriptorRow {
+      float const* m_data;
+      size_t m_size;
+    public:
+      typedef float value_type;
+      typedef float const* const_iterator;
+
+      DescriptorRow() : m_data(0), m_size(0) {}
+      DescriptorRow( float const* data, size_t size ) : m_data(data), m_size(size) {}
+
+      const_iterator begin() const { return m_data; }
+      const_iterator end() const { return m_data + m_size; }
+      size_t size() const { return m_size; }
+      float operator[]( size_t i ) const { return m_data[i]; }
+    };
+
+    explicit InterestPointSet( size_t descriptor_size = 0 );
+
+    /// Copies a list or vector of interest points.  Their descriptors
+    /// must all be the same size, or empty.
+    template <class IterT>
+    InterestPointSet( IterT begin, IterT end ) : m_descriptor_size(0), m_stride(0) {
+      assign( begin, end );
+    }
+
+    template <class IterT>
+    void assign( IterT begin, IterT end ) {
+      clear();
+      if ( begin == end )
+        return;
+      set_descriptor_size( begin->size() );
+      reserve( std::distance( begin, end ) );
+      for ( ; begin != end; ++begin )
+        push_back( *begin );
+    }
+
+    size_t size() const { return m_x.size(); }
+    bool empty() const { return m_x.empty(); }
+    void reserve( size_t n );
+    void clear();
+
+    /// Changes the number of points.  Points added are zero, with zero
+    /// descriptors.
+    void resize( size_t n );
+
+    /// Appends a copy of ip.  Its descriptor must have descriptor_size()
+    /// elements, or none, in which case the point's row is zero.
+    void push_back( InterestPoint const& ip );
+
+    /// A copy of the i'th point in the InterestPoint form.
+    InterestPoint point( size_t i ) const;
+
+    /// Copies of all the points, in order.
+    std::vector<InterestPoint> points() const;
+
+    /// Changes the number of elements in each descriptor.  Every
+    /// descriptor is set to zero.
+    void set_descriptor_size( size_t n );
+    size_t descriptor_size() const { return m_descriptor_size; }
+
+    /// The number of floats from one descriptor row to the next.  The
+    /// rows are padded to a multiple of four floats, so each one
+    /// starts on a 16 byte boundary if the first does.
+    size_t descriptor_stride() const { return m_stride; }
+
+    float* descriptor( size_t i ) { return data() + i * m_stride; }
+    float const* descriptor( size_t i ) const { return data() + i * m_stride; }
+    DescriptorRow descriptor_row( size_t i ) const { return DescriptorRow( descriptor(i), m_descriptor_size ); }
+    std::vector<DescriptorRow> descriptor_rows() const;
+
+    /// The index of the point whose descriptor row this is.
+    size_t index( DescriptorRow const& row ) const {
+      return ( row.begin() - data() ) / m_stride;
+    }
+
+    /// The fields of the points, one array each.  See InterestPoint
+    /// for their meaning.
+    std::vector<float>& x() { return m_x; }
+    std::vector<float> const& x() const { return m_x; }
+    std::vector<float>& y() { return m_y; }
+    std::vector<float> const& y() const { return m_y; }
+    std::vector<float>& scale() { return m_scale; }
+    std::vector<float> const& scale() const { return m_scale; }
+    std::vector<float>& orientation() { return m_orientation; }
+    std::vector<float> const& orientation() const { return m_orientation; }
+    std::vector<float>& interest() { return m_interest; }
+    std::vector<float> const& interest() const { return m_interest; }
+    std::vector<uint8>& polarity() { return m_polarity; }
+    std::vector<uint8> const& polarity() const { return m_polarity; }
+    std::vector<uint32>& octave() { return m_octave; }
+    std::vector<uint32> const& octave() const { return m_octave; }
+    std::vector<uint32>& scale_lvl() { return m_scale_lvl; }
+    std::vector<uint32> const& scale_lvl() const { return m_scale_lvl; }
+
+  private:
+    float* data() { return m_descriptors.empty() ? 0 : &m_descriptors[0]; }
+    float const* data() const { return m_descriptors.empty() ? 0 : &m_descriptors[0]; }
+
+    std::vector<float> m_x, m_y, m_scale, m_orientation, m_interest;
+    std::vector<uint8> m_polarity;
+    std::vector<uint32> m_octave, m_scale_lvl;
+    size_t m_descriptor_size, m_stride;
+    std::vector<float> m_descriptors;
+  };
+
+  /// \name Interest point set files
+  ///
+  /// A versioned file laid out as an InterestPointSet is: a fixed
+  /// header, then each field of the points as one array and the
+  /// padded descriptor rows as one block, every array aligned to 16
+  /// bytes.  The arrays are in the byte order of the machine that wrote
+  /// them, which the header records.  A MappedInterestPointSet reads
+  /// the points straight out of a memory mapping of the file.
+  /// \{
+
+  /// Writes a set to an interest point set file.
+  void write_binary_ip_set_file( std::string const& filename, InterestPointSet const& points );
+
+  /// Reads an interest point set file, copying each array in one go.
+  void read_binary_ip_set_file( std::string const& filename, InterestPointSet& points );
+
+  /// Writes the matches between two sets, each the indices of the
+  /// matched points in ip1 and ip2, along with their positions.
+  void write_binary_match_set_file( std::string const& filename,
+                                    InterestPointSet const& ip1, InterestPointSet const& ip2,
+                                    std::vector<std::pair<size_t,size_t> > const& matches );
+
+  /// Reads a match set file.  ip1 and ip2 receive the matched points,
+  /// one pair to each match as read_binary_match_file gives them, with
+  /// their positions but no descriptors.
+  void read_binary_match_set_file( std::string const& filename,
+                                   std::vector<std::pair<size_t,size_t> >& matches,
+                                   InterestPointSet& ip1, InterestPointSet& ip2 );
+
+  /// An interest point set file mapped into memory.  Opening it checks
+  /// the header and reads nothing else; the arrays are read in place.
+  class MappedInterestPointSet : private boost::noncopyable {
+    boost::shared_ptr<MappedFile> m_file;
+    size_t m_size, m_descriptor_size, m_stride;
+    float const *m_x, *m_y, *m_scale, *m_orientation, *m_interest;
+    uint8 const* m_polarity;
+    uint32 const *m_octave, *m_scale_lvl;
+    float const* m_descriptors;
+
+  public:
+    /// Throws an IOErr if the file is not an interest point set file
+    /// this library can read.
+    explicit MappedInterestPointSet( std::string const& filename );
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    size_t descriptor_size() const { return m_descriptor_size; }
+    size_t descriptor_stride() const { return m_stride; }
+
+    float const* x() const { return m_x; }
+    float const* y() const { return m_y; }
+    float const* scale() const { return m_scale; }
+    float const* orientation() const { return m_orientation; }
+    float const* interest() const { return m_interest; }
+    uint8 const* polarity() const { return m_polarity; }
+    uint32 const* octave() const { return m_octave; }
+    uint32 const* scale_lvl() const { return m_scale_lvl; }
+
+    float const* descriptor( size_t i ) const { return m_descriptors + i * m_stride; }
+    InterestPointSet::DescriptorRow descriptor_row( size_t i ) const {
+      return InterestPointSet::DescriptorRow( descriptor(i), m_descriptor_size );
+    }
+
+    /// A copy of the i'th point in the InterestPoint form.
+    InterestPoint point( size_t i ) const;
+
+    /// Copies the whole file into a set.
+    void copy_to( InterestPointSet& points ) const;
+  };
+
+  /// \}
+
+}} // namespace vw::ip
+
+#endif // __VW_INTERESTPOINT_INTERESTPOINTSET_H__
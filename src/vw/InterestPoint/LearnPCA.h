@@ -13,6 +13,10 @@
 #ifndef __VW_INTERESTPOINT_LEARNPCA_H__
 #define __VW_INTERESTPOINT_LEARNPCA_H__
 
+#include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Math/LinearAlgebra.h>
 #include <vw/Image/ImageMath.h>
 #include <vw/Image/ImageView.h>
@@ -27,22 +31,138 @@
 #define PCA_BASIS_SIZE  20
 #define MAX_POINTS_TO_DRAW 1000
 
+// Accumulates the mean and covariance of a stream of samples without
+// keeping them.  Samples are gathered into blocks, whose scatter
+// matrices are computed as dot products of contiguous rows and then
+// folded into the running totals with the pairwise update of Chan,
+// Golub and LeVeque.  Accumulators filled separately, e.g. one per
+// thread, can be merged.
+class PCAAccumulator {
+
+private:
+  static const int BLOCK_SIZE = 64;
+
+  int m_dim;
+  double m_count;
+  vw::Vector<double> m_mean;
+  // Sum of the outer products of the centered samples; only the upper
+  // triangle is kept up to date.
+  vw::Matrix<double> m_scatter;
+  // Samples not yet folded in, one dimension per row of BLOCK_SIZE.
+  std::vector<double> m_block;
+  int m_block_count;
+
+  // Fold in a block of b samples with the given mean and scatter.
+  void merge_stats(double b, vw::Vector<double> const& mean, vw::Matrix<double> const& scatter) {
+    double n = m_count + b;
+    vw::Vector<double> delta = mean - m_mean;
+    double f = m_count * b / n;
+    for (int i = 0; i < m_dim; i++) {
+      double fi = f * delta(i);
+      for (int j = i; j < m_dim; j++)
+        m_scatter(i, j) += scatter(i, j) + fi * delta(j);
+    }
+    m_mean += delta * (b / n);
+    m_count = n;
+  }
+
+public:
+
+  PCAAccumulator(int dim = 0) { set_dimension(dim); }
+
+  // Starts over with samples of the given dimension.
+  void set_dimension(int dim) {
+    m_dim = dim;
+    m_count = 0;
+    m_mean = vw::Vector<double>(dim);
+    m_scatter = vw::Matrix<double>(dim, dim);
+    m_block.assign(size_t(dim) * BLOCK_SIZE, 0.0);
+    m_block_count = 0;
+  }
+
+  int dimension() const { return m_dim; }
+  double count() const { return m_count + m_block_count; }
+
+  void add(const double* sample) {
+    for (int i = 0; i < m_dim; i++)
+      m_block[size_t(i) * BLOCK_SIZE + m_block_count] = sample[i];
+    if (++m_block_count == BLOCK_SIZE)
+      flush();
+  }
+
+  // Folds the pending block of samples into the totals.
+  void flush() {
+    int b = m_block_count;
+    if (b == 0)
+      return;
+    vw::Vector<double> mean(m_dim);
+    for (int i = 0; i < m_dim; i++) {
+      double* row = &m_block[size_t(i) * BLOCK_SIZE];
+      double sum = 0;
+      for (int k = 0; k < b; k++)
+        sum += row[k];
+      mean(i) = sum / b;
+      for (int k = 0; k < b; k++)
+        row[k] -= mean(i);
+    }
+    vw::Matrix<double> scatter(m_dim, m_dim);
+    for (int i = 0; i < m_dim; i++) {
+      const double* ri = &m_block[size_t(i) * BLOCK_SIZE];
+      for (int j = i; j < m_dim; j++) {
+        const double* rj = &m_block[size_t(j) * BLOCK_SIZE];
+        double sum = 0;
+        for (int k = 0; k < b; k++)
+          sum += ri[k] * rj[k];
+        scatter(i, j) = sum;
+      }
+    }
+    m_block_count = 0;
+    merge_stats(b, mean, scatter);
+  }
+
+  // Adds the samples of another accumulator of the same dimension.
+  void merge(PCAAccumulator const& other) {
+    VW_ASSERT(other.m_dim == m_dim, vw::ArgumentErr() << "PCAAccumulator: Cannot merge samples of different dimensions.");
+    flush();
+    if (other.m_count > 0)
+      merge_stats(other.m_count, other.m_mean, other.m_scatter);
+    std::vector<double> sample(m_dim);
+    for (int k = 0; k < other.m_block_count; k++) {
+      for (int i = 0; i < m_dim; i++)
+        sample[i] = other.m_block[size_t(i) * BLOCK_SIZE + k];
+      add(&sample[0]);
+    }
+  }
+
+  vw::Vector<double> mean() {
+    flush();
+    return m_mean;
+  }
+
+  // The sample covariance, normalized by count() - 1.
+  vw::Matrix<double> covariance() {
+    flush();
+    vw::Matrix<double> cov(m_dim, m_dim);
+    double norm = m_count > 1 ? 1.0 / (m_count - 1) : 0.0;
+    for (int i = 0; i < m_dim; i++)
+      for (int j = i; j < m_dim; j++)
+        cov(i, j) = cov(j, i) = m_scatter(i, j) * norm;
+    return cov;
+  }
+};
+
 // Use DescriptorGeneratorBase::operator() and compute_descriptor methods to
-// help us populate the training data matrix
+// help us accumulate the training data
 // DescriptorGeneratorBase takes care of finding the support region for
 // each interest point
 class LearnPCADataFiller : public vw::ip::DescriptorGeneratorBase<LearnPCADataFiller> {
 
 private:
-  vw::Matrix<double> *data;
-  int column;
+  PCAAccumulator *data;
+  std::vector<double> sample;
 
 public:
-  // *** TODO: Pass by ref without copy?
-  LearnPCADataFiller(vw::Matrix<double>* training_data, unsigned int start_column) {
-    data = training_data;
-    column = start_column;
-  }
+  LearnPCADataFiller(PCAAccumulator* training_data) : data(training_data) {}
 
   template <class ViewT, class IterT>
   void compute_descriptor (vw::ImageViewBase<ViewT> const& support,
@@ -50,28 +170,32 @@ public:
     // This secretly does not create a descriptor
 
     int support_squared = support.impl().cols() * support.impl().rows();
+    sample.resize(support_squared);
 
     double norm_const = 0.0;
-    // Copy support region into training data matrix
+    // Copy the support region into a sample
     int row = 0;
     for (int j = 0; j < support.impl().rows(); j++) {
       for (int i = 0; i < support.impl().cols(); i++) {
-        (*data)(row++, column) = support.impl()(i, j);
-        norm_const += support.impl()(i, j) * support.impl()(i, j);
+        sample[row] = support.impl()(i, j);
+        norm_const += sample[row] * sample[row];
+        row++;
       }
     }
 
-    // Normalize values in column
+    // Normalize the sample
     norm_const = sqrt(norm_const);
     for (int i = 0; i < support_squared; i++) {
-      (*data)(i, column) /= norm_const;
+      sample[i] /= norm_const;
     }
 
-    // Increment column number for next call to compute_descriptor
-    column++;
+    data->add(&sample[0]);
   }
 
   int descriptor_size() { return 0; }
+
+  // The points share one accumulator.
+  bool threaded() const { return false; }
 };
 
 class LearnPCA {
@@ -80,14 +204,29 @@ private:
   std::string basis_filename;
   std::string avg_filename;
 
-  vw::Matrix<double> training_data;
-  unsigned int training_data_size;
+  PCAAccumulator training_data;
+  vw::Mutex training_mutex;
 
   vw::Matrix<float> pca_basis;
   vw::Vector<float> pca_avg;
 
   int support_squared;
 
+  // Adds the interest points of one training image to an accumulator.
+  class ImageTask : public vw::Task {
+    LearnPCA& m_lpca;
+    std::string m_filename;
+  public:
+    ImageTask(LearnPCA& lpca, std::string const& filename) : m_lpca(lpca), m_filename(filename) {}
+    virtual void operator()() {
+      vw::DiskImageView<vw::PixelRGB<vw::uint8> > dimage(m_filename);
+      PCAAccumulator data(m_lpca.support_squared);
+      m_lpca.accumulate(dimage, data);
+      vw::Mutex::Lock lock(m_lpca.training_mutex);
+      m_lpca.training_data.merge(data);
+    }
+  };
+
 public:
 
   static const int DEFAULT_SUPPORT_SIZE = 41;
@@ -97,7 +236,7 @@ public:
     : basis_filename(pcabasis_filename), avg_filename(pcaavg_filename) {
 
     support_squared = DEFAULT_SUPPORT_SIZE * DEFAULT_SUPPORT_SIZE;
-    training_data_size = 0;
+    training_data.set_dimension(support_squared);
   }
 
   template <class T>
@@ -113,7 +252,10 @@ public:
     return ret;
   }
 
-  void processImage(vw::DiskImageView<vw::PixelRGB<vw::uint8> > &dimage) {
+  // Detects the interest points of an image and adds their support
+  // regions to an accumulator.  Safe to call on several images at
+  // once, with separate accumulators.
+  void accumulate(vw::DiskImageView<vw::PixelRGB<vw::uint8> > &dimage, PCAAccumulator& data) {
 
     float log_threshold = 0.01;
     int tile_size = 2048;
@@ -127,65 +269,63 @@ public:
     vw::ImageView<vw::PixelRGB<vw::uint8> > image = dimage;
     while(image.cols() > max_x_dim) {
       image = bin_subsample(image);
-      std::cout << "Reduced image to " << image.cols() << "x" << image.rows() << std::endl;
+      vw::vw_out() << "Reduced " << dimage.filename() << " to " << image.cols() << "x" << image.rows() << std::endl;
     }
     image = vw::gaussian_filter(image, 1);
 
     vw::ip::LogInterestOperator interest_operator(log_threshold);
     vw::ip::ScaledInterestPointDetector<vw::ip::LogInterestOperator> detector(interest_operator);
     //ScaledInterestPointDetector<LogInterestOperator> detector;
-    std::cout << "Running interest point detector on " << dimage.filename() << std::endl;
+    vw::vw_out() << "Running interest point detector on " << dimage.filename() << std::endl;
     ipl = detector(image, tile_size);
     write_point_image("ip_" + dimage.filename(), image, ipl);
 
-    // Resize the training data matrix to accommodate new interest points
-    unsigned int interest_point_index = training_data_size;
-    training_data_size += ipl.size();
-    training_data.set_size(support_squared, training_data_size, true);
+    vw::vw_out() << "Accumulating " << ipl.size() << " interest points from " << dimage.filename() << std::endl;
+    LearnPCADataFiller fill_matrix(&data);
+    fill_matrix(image, ipl);
+  }
 
-    // Populate training data matrix
-    LearnPCADataFiller fill_matrix(&training_data, interest_point_index);
+  void processImage(vw::DiskImageView<vw::PixelRGB<vw::uint8> > &dimage) {
+    accumulate(dimage, training_data);
+    std::cout << "  " << training_data.count() << " total interest points\n" << std::endl;
+  }
 
-    std::cout << "Populating training matrix" << std::endl;
-    std::cout << "  Starting fill at column " << interest_point_index << std::endl;
-    std::cout << "  " << ipl.size() << " interest points" << std::endl;
-    std::cout << "  " << training_data_size << " total interest points\n" << std::endl;
-    fill_matrix(image, ipl);
+  // Processes the training images on num_threads threads (by default,
+  // the number in vw_settings()).  Each image in flight has its own
+  // accumulator, which is merged into the training data when it is
+  // done, so only the samples' statistics are ever kept.
+  void processImages(std::vector<std::string> const& filenames, int num_threads = 0) {
+    if (num_threads <= 0)
+      num_threads = vw::vw_settings().default_num_threads();
+    vw::FifoWorkQueue queue(num_threads);
+    for (size_t i = 0; i < filenames.size(); i++)
+      queue.add_task(boost::shared_ptr<vw::Task>(new ImageTask(*this, filenames[i])));
+    queue.join_all();
+    std::cout << "  " << training_data.count() << " total interest points\n" << std::endl;
   }
 
   void runPCA() {
   std::cout << "Running PCA on training data" << std::endl;
 
-    // Compute average
-    std::cout << "  Computing average" << std::endl;
-    pca_avg.set_size(support_squared);
-    for (int i = 0; i < support_squared; i++) {
-      for (unsigned j = 0; j < training_data.cols(); j++) {
-        pca_avg(i) += training_data(i, j);
-      }
-      pca_avg(i) /= training_data.cols();
-    }
-
-    // Subtract average
-    std::cout << "  Subtracting average" << std::endl;
-    for (int i = 0; i < support_squared; i++) {
-      for (unsigned j = 0; j < training_data.cols(); j++) {
-        training_data(i, j) -= pca_avg(i);
-      }
-    }
+    // The covariance is symmetric, so its singular vectors are its
+    // eigenvectors, and the left singular vectors of the centered
+    // training data.
+    std::cout << "  Computing covariance of " << training_data.count() << " samples" << std::endl;
+    vw::Matrix<double> covariance = training_data.covariance();
+    pca_avg = vw::Vector<float>(training_data.mean());
 
-    // Compute SVD of training data matrix
     std::cout << "  Computing SVD" << std::endl;
-    vw::Matrix<float> U;
-    vw::Vector<float> E;
-    vw::Matrix<float> VT;
-    svd(training_data, U, E, VT);
+    vw::Matrix<double> U;
+    vw::Vector<double> E;
+    vw::Matrix<double> VT;
+    svd(covariance, U, E, VT);
 
+    // Report the singular values of the training data, as before
     assert(E.size() >= PCA_BASIS_SIZE);
     std::cout << "  Top " << PCA_BASIS_SIZE << " singular values from " << E.size()
          << " total singular values" << std::endl;
     for (int i = 0; i < PCA_BASIS_SIZE; i++) {
-      std::cout << "  " << i << ": " << E[i] << std::endl;
+      std::cout << "  " << i << ": " << sqrt(E[i] * (training_data.count() - 1)) << std::endl;
     }
 
     // Take top n eignvectors of U as PCA basis
@@ -9,6 +9,10 @@
 /// Classes and functions for matching image interest points.
 ///
 #include <vw/InterestPoint/Matcher.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <limits>
 
 namespace vw {
 namespace ip {
@@ -36,6 +40,20 @@ namespace ip {
     return dist;
   }
 
+  float
+  HammingMetric::operator()( InterestPoint const& ip1, InterestPoint const& ip2,
+                             float /*maxdist*/ ) const {
+    VW_ASSERT( ip1.descriptor.size() == ip2.descriptor.size(),
+               ArgumentErr() << "HammingMetric: descriptor sizes do not agree." );
+    const size_t words = binary_code_words( ip1.descriptor.size() );
+    std::vector<uint64> code1( words ), code2( words );
+    if ( !words )
+      return 0;
+    pack_binary_descriptor( ip1.descriptor, &code1[0] );
+    pack_binary_descriptor( ip2.descriptor, &code2[0] );
+    return float( hamming_distance( &code1[0], &code2[0], words ) );
+  }
+
   bool ScaleOrientationConstraint::operator()( InterestPoint const& baseline_ip,
                                                InterestPoint const& test_ip ) const {
     double sr = test_ip.scale / baseline_ip.scale;
@@ -65,6 +83,137 @@ namespace ip {
     return false;
   }
 
+  namespace {
+
+    // Finds the two nearest reference rows for each of the rows
+    // [begin, end) of the query.  The arguments are in the order
+    // run_blocks passes them.
+    class BruteForceTask : public Task, private boost::noncopyable {
+      InterestPointSet const& m_query;
+      InterestPointSet const& m_reference;
+      Matrix<int>& m_indices;
+      Matrix<float>& m_distances;
+      size_t m_begin, m_end;
+    public:
+      BruteForceTask( InterestPointSet const& reference, InterestPointSet const& query,
+                      Matrix<int>& indices, Matrix<float>& distances, size_t begin, size_t end ) :
+        m_query(query), m_reference(reference), m_indices(indices), m_distances(distances),
+        m_begin(begin), m_end(end) {}
+
+      void operator()() {
+        const size_t size = m_query.descriptor_size();
+        for ( size_t i = m_begin; i < m_end; ++i ) {
+          float const* descriptor = m_query.descriptor(i);
+          float first = std::numeric_limits<float>::max(), second = first;
+          int first_index = -1, second_index = -1;
+          for ( size_t j = 0; j < m_reference.size(); ++j ) {
+            float dist = squared_distance( descriptor, m_reference.descriptor(j), size );
+            if ( dist < first ) {
+              second = first; second_index = first_index;
+              first = dist; first_index = int(j);
+            } else if ( dist < second ) {
+              second = dist; second_index = int(j);
+            }
+          }
+          m_indices(i,0) = first_index;   m_indices(i,1) = second_index;
+          m_distances(i,0) = first;       m_distances(i,1) = second;
+        }
+      }
+    };
+
+    // Splits the query rows into a few blocks per thread and runs a
+    // task on each.
+    template <class TaskT, class SourceT>
+    void run_blocks( SourceT const& source, InterestPointSet const& query,
+                     Matrix<int>& indices, Matrix<float>& distances ) {
+      const size_t threads = vw_settings().default_num_threads();
+      const size_t block = std::max( size_t(64), query.size() / (4*threads) + 1 );
+      FifoWorkQueue queue( threads );
+      for ( size_t begin = 0; begin < query.size(); begin += block ) {
+        boost::shared_ptr<Task> task( new TaskT( source, query, indices, distances, begin,
+                                                 std::min( begin + block, query.size() ) ) );
+        queue.add_task( task );
+      }
+      queue.join_all();
+    }
+
+    // Keeps the nearest neighbour of each query whose distance is less
+    // than threshold times that of the second nearest, the lowest
+    // ratio first.
+    void ratio_test( Matrix<int> const& indices, Matrix<float> const& distances, double threshold,
+                     std::vector<std::pair<size_t,size_t> >& matches ) {
+      std::vector<std::pair<float,size_t> > ratios;
+      for ( size_t i = 0; i < indices.rows(); ++i )
+        if ( indices(i,1) >= 0 && distances(i,0) < threshold * distances(i,1) )
+          ratios.push_back( std::make_pair( distances(i,0) / distances(i,1), i ) );
+      std::stable_sort( ratios.begin(), ratios.end() );
+      matches.reserve( ratios.size() );
+      for ( size_t k = 0; k < ratios.size(); ++k ) {
+        size_t i = ratios[k].second;
+        matches.push_back( std::make_pair( i, size_t( indices(i,0) ) ) );
+      }
+    }
+
+  } // namespace
+
+  void find_two_nearest( InterestPointSet const& query, InterestPointSet const& reference,
+                         Matrix<int>& indices, Matrix<float>& distances,
+                         uint64 brute_force_limit,
+                         const ProgressCallback &progress_callback ) {
+    VW_ASSERT( query.empty() || reference.empty() ||
+               query.descriptor_size() == reference.descriptor_size(),
+               ArgumentErr() << "find_two_nearest: descriptor sizes do not agree." );
+    indices.set_size( query.size(), 2 );
+    distances.set_size( query.size(), 2 );
+    for ( size_t i = 0; i < query.size(); ++i )
+      for ( size_t k = 0; k < 2; ++k ) {
+        indices(i,k) = -1;
+        distances(i,k) = std::numeric_limits<float>::max();
+      }
+    progress_callback.report_progress(0);
+    if ( query.empty() || reference.empty() ) {
+      progress_callback.report_finished();
+      return;
+    }
+
+    if ( uint64(query.size()) * uint64(reference.size()) <= brute_force_limit ) {
+      vw_out(InfoMessage,"interest_point") << "Comparing all " << query.size() << " x "
+                                           << reference.size() << " pairs of points.\n";
+      run_blocks<BruteForceTask>( reference, query, indices, distances );
+      progress_callback.report_finished();
+      return;
+    }
+
+    DescriptorIndex index( reference );
+    index.find_two_nearest( query, indices, distances, progress_callback );
+  }
+
+  void match_interest_points( InterestPointSet const& ip1, InterestPointSet const& ip2,
+                              std::vector<std::pair<size_t,size_t> >& matches,
+                              double threshold,
+                              const ProgressCallback &progress_callback ) {
+    Timer total("Total elapsed time", DebugMessage, "interest_point");
+
+    matches.clear();
+    Matrix<int> indices;
+    Matrix<float> distances;
+    find_two_nearest( ip1, ip2, indices, distances, default_brute_force_limit(), progress_callback );
+    ratio_test( indices, distances, threshold, matches );
+  }
+
+  void match_interest_points( InterestPointSet const& ip1, DescriptorIndex const& index2,
+                              std::vector<std::pair<size_t,size_t> >& matches,
+                              double threshold,
+                              const ProgressCallback &progress_callback ) {
+    Timer total("Total elapsed time", DebugMessage, "interest_point");
+
+    matches.clear();
+    Matrix<int> indices;
+    Matrix<float> distances;
+    index2.find_two_nearest( ip1, indices, distances, progress_callback );
+    ratio_test( indices, distances, threshold, matches );
+  }
+
   void remove_duplicates(std::vector<InterestPoint>& ip1,
                          std::vector<InterestPoint>& ip2) {
     VW_ASSERT( ip1.size() == ip2.size(),
@@ -16,15 +16,12 @@
 
 #include <vw/Core/Log.h>
 #include <vw/InterestPoint/Descriptor.h>
+#include <vw/InterestPoint/InterestPointSet.h>
+#include <vw/InterestPoint/BinaryDescriptor.h>
+#include <vw/InterestPoint/DescriptorIndex.h>
 #include <vector>
 #include <boost/foreach.hpp>
 
-#if VW_HAVE_PKG_FLANN
-#include <vw/Math/FLANNTree.h>
-#else
-#include <vw/Math/KDTree.h>
-#endif
-
 namespace vw {
 namespace ip {
 
@@ -49,6 +46,14 @@ namespace ip {
                       float maxdist = std::numeric_limits<float>::max()) const;
   };
 
+  /// Hamming distance between binary descriptors, such as those of
+  /// BRIEFDescriptorGenerator: the number of bits in which they
+  /// differ.  See BinaryDescriptor.h.
+  struct HammingMetric {
+    float operator() (InterestPoint const& ip1, InterestPoint const& ip2,
+                      float maxdist = std::numeric_limits<float>::max()) const;
+  };
+
   /// Interest Point Match contraints functors to return a list of
   /// allowed match candidates to an interest point.
   ///
@@ -118,21 +123,73 @@ namespace ip {
   //                         Interest Point Matcher
   // ---------------------------------------------------------------------------
 
+  /// The number of point pairs up to which find_two_nearest() compares
+  /// every pair rather than building a tree.
+  inline uint64 default_brute_force_limit() { return uint64(1) << 22; }
+
+  /// For each point of query, finds the two points of reference whose
+  /// descriptors are nearest by L2 distance.  Row i of indices holds
+  /// their indices, nearest first, or -1 where reference has too few
+  /// points, and row i of distances their squared distances.
+  ///
+  /// When there are at most brute_force_limit pairs of points every
+  /// pair is compared.  Otherwise the queries are made of a
+  /// DescriptorIndex of reference: a FLANN tree or, without FLANN, a
+  /// FlatKDTree, in blocks on the default number of threads.
+  void find_two_nearest( InterestPointSet const& query, InterestPointSet const& reference,
+                         Matrix<int>& indices, Matrix<float>& distances,
+                         uint64 brute_force_limit = default_brute_force_limit(),
+                         const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() );
+
+  /// The matches that pass a ratio test, gathered to be put out the
+  /// most distinct first: the lowest ratio of the nearest distance to
+  /// the second nearest.  RANSAC's guided sampling wants them so.
+  template <class IterT>
+  class RatioOrderedMatches {
+    struct Match {
+      double ratio;
+      IterT ip1, ip2;
+      bool operator<( Match const& other ) const { return ratio < other.ratio; }
+    };
+    std::vector<Match> m_matches;
+  public:
+    void add( double ratio, IterT ip1, IterT ip2 ) {
+      Match match = { ratio, ip1, ip2 };
+      m_matches.push_back( match );
+    }
+
+    template <class MatchListT>
+    void output( MatchListT& matched_ip1, MatchListT& matched_ip2 ) {
+      std::stable_sort( m_matches.begin(), m_matches.end() );
+      for ( size_t k = 0; k < m_matches.size(); ++k ) {
+        matched_ip1.push_back( *m_matches[k].ip1 );
+        matched_ip2.push_back( *m_matches[k].ip2 );
+      }
+    }
+  };
+
   /// Interest point matcher class
   template < class MetricT, class ConstraintT >
   class InterestPointMatcher {
     ConstraintT m_constraint;
     MetricT m_distance_metric;
     double m_threshold;
+    uint64 m_brute_force_limit;
 
   public:
 
     InterestPointMatcher(double threshold = 0.5, MetricT metric = MetricT(), ConstraintT constraint = ConstraintT())
-      : m_constraint(constraint), m_distance_metric(metric), m_threshold(threshold) { }
+      : m_constraint(constraint), m_distance_metric(metric), m_threshold(threshold),
+        m_brute_force_limit(default_brute_force_limit()) { }
+
+    /// The number of point pairs up to which the matcher compares every
+    /// pair rather than building a tree.  See find_two_nearest().
+    void set_brute_force_limit(uint64 pairs) { m_brute_force_limit = pairs; }
+    uint64 brute_force_limit() const { return m_brute_force_limit; }
 
     /// Given two lists of interest points, this routine returns the two lists
     /// of matching interest points based on the Metric and Constraints
-    /// provided by the user.
+    /// provided by the user, the most distinct match first.
     template <class ListT, class MatchListT>
     void operator()( ListT const& ip1, ListT const& ip2,
                      MatchListT& matched_ip1, MatchListT& matched_ip2,
@@ -140,7 +197,7 @@ namespace ip {
                      const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const {
       typedef typename ListT::const_iterator IterT;
 
-      Timer *total = new Timer("Total elapsed time", DebugMessage, "interest_point");
+      Timer total("Total elapsed time", DebugMessage, "interest_point");
 
       matched_ip1.clear(); matched_ip2.clear();
       if (!ip1.size() || !ip2.size()) {
@@ -149,64 +206,45 @@ namespace ip {
         return;
       }
 
-      size_t size = ip1.size();
-      float inc_amt = 1.0f/float(size);
-
-#if VW_HAVE_PKG_FLANN
-      Matrix<float> ip2_matrix( ip2.size(), ip2.begin()->size() );
-      Matrix<float>::iterator ip2_matrix_it = ip2_matrix.begin();
-      BOOST_FOREACH( InterestPoint const& ip, ip2 )
-        ip2_matrix_it = std::copy( ip.begin(), ip.end(), ip2_matrix_it );
-
-      math::FLANNTree<flann::L2<float> > kd( ip2_matrix );
-      vw_out(InfoMessage,"interest_point") << "FLANN-Tree created. Searching...\n";
-
-      Vector<int> indices(2);
-      Vector<float> distances(2);
-#else
-      math::KDTree<ListT> kd(ip2.begin()->size(), ip2);
-      vw_out(InfoMessage,"interest_point") << "KD-Tree created with " << kd.size() << " nodes and depth ranging from " << kd.min_depth() << " to " << kd.max_depth() << ".  Searching...\n";
-#endif
-      progress_callback.report_progress(0);
-
-      BOOST_FOREACH( InterestPoint ip, ip1 ) {
-        if (progress_callback.abort_requested())
-          vw_throw( Aborted() << "Aborted by ProgressCallback" );
-        progress_callback.report_incremental_progress(inc_amt);
-
-        std::vector<InterestPoint> nearest_records(2);
-#if VW_HAVE_PKG_FLANN
-        kd.knn_search( ip.descriptor, indices, distances, 2 );
-        nearest_records[0] = ip2[indices[0]];
-        nearest_records[1] = ip2[indices[1]];
-#else
-        int num_records = kd.m_nearest_neighbors(ip, nearest_records, 2);
-        if (num_records != 2)
+      // The nearest points are found from contiguous copies of the
+      // descriptors.
+      Matrix<int> indices;
+      Matrix<float> distances;
+      find_two_nearest( InterestPointSet( ip1.begin(), ip1.end() ),
+                        InterestPointSet( ip2.begin(), ip2.end() ),
+                        indices, distances, m_brute_force_limit, progress_callback );
+
+      std::vector<IterT> ip2_iters;
+      ip2_iters.reserve( ip2.size() );
+      for ( IterT it = ip2.begin(); it != ip2.end(); ++it )
+        ip2_iters.push_back( it );
+
+      RatioOrderedMatches<IterT> matches;
+      size_t i = 0;
+      for ( IterT ip = ip1.begin(); ip != ip1.end(); ++ip, ++i ) {
+        if ( indices(i,1) < 0 )
           continue; // Ignore if there are no matches
-#endif
+        InterestPoint const& nearest0 = *ip2_iters[indices(i,0)];
+        InterestPoint const& nearest1 = *ip2_iters[indices(i,1)];
 
         bool constraint_satisfied = false;
         if (bidirectional) {
-          if (m_constraint(nearest_records[0], ip) &&
-              m_constraint(ip, nearest_records[0]))
+          if (m_constraint(nearest0, *ip) &&
+              m_constraint(*ip, nearest0))
             constraint_satisfied = true;
         } else {
-          if (m_constraint(nearest_records[0], ip))
+          if (m_constraint(nearest0, *ip))
             constraint_satisfied = true;
         }
         if (constraint_satisfied) {
-          double dist0 = m_distance_metric(nearest_records[0], ip);
-          double dist1 = m_distance_metric(nearest_records[1], ip);
+          double dist0 = m_distance_metric(nearest0, *ip);
+          double dist1 = m_distance_metric(nearest1, *ip);
 
-          if (dist0 < m_threshold * dist1) {
-            matched_ip1.push_back(ip);
-            matched_ip2.push_back(nearest_records[0]);
-          }
+          if (dist0 < m_threshold * dist1)
+            matches.add( dist0 / dist1, ip, ip2_iters[indices(i,0)] );
         }
       }
-
-      progress_callback.report_finished();
-      delete total;
+      matches.output( matched_ip1, matched_ip2 );
     }
   };
 
@@ -215,15 +253,22 @@ namespace ip {
   class InterestPointMatcher<L2NormMetric, NullConstraint> {
     double m_threshold;
     L2NormMetric m_metric;
+    uint64 m_brute_force_limit;
 
   public:
 
     InterestPointMatcher(double threshold = 0.5, L2NormMetric metric = L2NormMetric(), NullConstraint /*constraint*/ = NullConstraint())
-      : m_threshold(threshold), m_metric(metric) { }
+      : m_threshold(threshold), m_metric(metric),
+        m_brute_force_limit(default_brute_force_limit()) { }
+
+    /// The number of point pairs up to which the matcher compares every
+    /// pair rather than building a tree.  See find_two_nearest().
+    void set_brute_force_limit(uint64 pairs) { m_brute_force_limit = pairs; }
+    uint64 brute_force_limit() const { return m_brute_force_limit; }
 
     /// Given two lists of interest points, this routine returns the two lists
     /// of matching interest points based on the Metric and Constraints
-    /// provided by the user.
+    /// provided by the user, the most distinct match first.
     template <class ListT, class MatchListT>
     void operator()( ListT const& ip1, ListT const& ip2,
                      MatchListT& matched_ip1, MatchListT& matched_ip2,
@@ -231,7 +276,7 @@ namespace ip {
                      const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const {
       typedef typename ListT::const_iterator IterT;
 
-      Timer *total = new Timer("Total elapsed time", DebugMessage, "interest_point");
+      Timer total("Total elapsed time", DebugMessage, "interest_point");
 
       matched_ip1.clear(); matched_ip2.clear();
       if (!ip1.size() || !ip2.size()) {
@@ -240,55 +285,100 @@ namespace ip {
         return;
       }
 
-      size_t size = ip1.size();
-      float inc_amt = 1.0f/float(size);
+      // The distances found are the squared L2 distances the metric
+      // would give, so the ratio test is made on them directly.
+      Matrix<int> indices;
+      Matrix<float> distances;
+      find_two_nearest( InterestPointSet( ip1.begin(), ip1.end() ),
+                        InterestPointSet( ip2.begin(), ip2.end() ),
+                        indices, distances, m_brute_force_limit, progress_callback );
+
+      std::vector<IterT> ip2_iters;
+      ip2_iters.reserve( ip2.size() );
+      for ( IterT it = ip2.begin(); it != ip2.end(); ++it )
+        ip2_iters.push_back( it );
+
+      RatioOrderedMatches<IterT> matches;
+      size_t i = 0;
+      for ( IterT ip = ip1.begin(); ip != ip1.end(); ++ip, ++i ) {
+        if ( indices(i,1) < 0 )
+          continue; // Ignore if there are no matches
+        if ( distances(i,0) < m_threshold * distances(i,1) )
+          matches.add( distances(i,0) / distances(i,1), ip, ip2_iters[indices(i,0)] );
+      }
+      matches.output( matched_ip1, matched_ip2 );
+    }
+  };
+
+  // Specialization for binary descriptors, whose nearest codes are
+  // found through a multi-index hash rather than a tree.
+  template <class ConstraintT>
+  class InterestPointMatcher<HammingMetric, ConstraintT> {
+    ConstraintT m_constraint;
+    double m_threshold;
+    uint64 m_brute_force_limit;
 
-#if VW_HAVE_PKG_FLANN
-      Matrix<float> ip2_matrix( ip2.size(), ip2.begin()->size() );
-      Matrix<float>::iterator ip2_matrix_it = ip2_matrix.begin();
-      BOOST_FOREACH( InterestPoint const& ip, ip2 )
-        ip2_matrix_it = std::copy( ip.begin(), ip.end(), ip2_matrix_it );
+  public:
 
-      math::FLANNTree<flann::L2<float> > kd( ip2_matrix );
-      vw_out(InfoMessage,"interest_point") << "FLANN-Tree created. Searching...\n";
+    InterestPointMatcher(double threshold = 0.8, HammingMetric /*metric*/ = HammingMetric(), ConstraintT constraint = ConstraintT())
+      : m_constraint(constraint), m_threshold(threshold),
+        m_brute_force_limit(default_brute_force_limit()) { }
 
-      Vector<int> indices(2);
-      Vector<float> distances(2);
-#else
-      math::KDTree<ListT> kd(ip2.begin()->size(), ip2);
-      vw_out(InfoMessage,"interest_point") << "KD-Tree created with " << kd.size() << " nodes and depth ranging from " << kd.min_depth() << " to " << kd.max_depth() << ".  Searching...\n";
-#endif
-      progress_callback.report_progress(0);
+    /// The number of point pairs up to which the matcher compares every
+    /// pair rather than building a hash.
+    void set_brute_force_limit(uint64 pairs) { m_brute_force_limit = pairs; }
+    uint64 brute_force_limit() const { return m_brute_force_limit; }
 
-      BOOST_FOREACH( InterestPoint ip, ip1 ) {
-        if (progress_callback.abort_requested())
-          vw_throw( Aborted() << "Aborted by ProgressCallback" );
-        progress_callback.report_incremental_progress(inc_amt);
+    /// Given two lists of interest points, this routine returns the two lists
+    /// of matching interest points based on the Metric and Constraints
+    /// provided by the user, the most distinct match first.
+    template <class ListT, class MatchListT>
+    void operator()( ListT const& ip1, ListT const& ip2,
+                     MatchListT& matched_ip1, MatchListT& matched_ip2,
+                     bool bidirectional = false,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const {
+      typedef typename ListT::const_iterator IterT;
 
+      Timer total("Total elapsed time", DebugMessage, "interest_point");
 
-#if VW_HAVE_PKG_FLANN
-        kd.knn_search( ip.descriptor, indices, distances, 2 );
-        if ( distances[0] < m_threshold * distances[1] ) {
-          matched_ip1.push_back(ip);
-          matched_ip2.push_back(ip2[indices[0]]);
-        }
-#else
-        std::vector<InterestPoint> nearest_records(2);
-        int num_records = kd.m_nearest_neighbors(ip, nearest_records, 2);
-        if (num_records != 2)
+      matched_ip1.clear(); matched_ip2.clear();
+      if (!ip1.size() || !ip2.size()) {
+        vw_out(InfoMessage,"interest_point") << "Hamming matcher: no points to match, exiting\n";
+        progress_callback.report_finished();
+        return;
+      }
+
+      std::vector<uint64> codes1, codes2;
+      size_t words = pack_binary_descriptors( ip1.begin(), ip1.end(), codes1 );
+      VW_ASSERT( pack_binary_descriptors( ip2.begin(), ip2.end(), codes2 ) == words,
+                 ArgumentErr() << "InterestPointMatcher: descriptor sizes do not agree." );
+
+      // The second distance may be only a lower bound where the ratio
+      // test is already settled.
+      Matrix<int> indices;
+      Matrix<float> distances;
+      find_two_nearest_hamming( codes1, codes2, words, indices, distances,
+                                m_threshold, m_brute_force_limit, progress_callback );
+
+      std::vector<IterT> ip2_iters;
+      ip2_iters.reserve( ip2.size() );
+      for ( IterT it = ip2.begin(); it != ip2.end(); ++it )
+        ip2_iters.push_back( it );
+
+      RatioOrderedMatches<IterT> matches;
+      size_t i = 0;
+      for ( IterT ip = ip1.begin(); ip != ip1.end(); ++ip, ++i ) {
+        if ( indices(i,0) < 0 || distances(i,1) == std::numeric_limits<float>::max() )
           continue; // Ignore if there are no matches
-        double dist0 = m_metric(nearest_records[0], ip);
-        double dist1 = m_metric(nearest_records[1], ip);
+        InterestPoint const& nearest0 = *ip2_iters[indices(i,0)];
 
-        if (dist0 < m_threshold * dist1) {
-          matched_ip1.push_back(ip);
-          matched_ip2.push_back(nearest_records[0]);
-        }
-#endif
+        bool constraint_satisfied = m_constraint(nearest0, *ip);
+        if (bidirectional)
+          constraint_satisfied = constraint_satisfied && m_constraint(*ip, nearest0);
+        if (constraint_satisfied && distances(i,0) < m_threshold * distances(i,1))
+          matches.add( distances(i,0) / distances(i,1), ip, ip2_iters[indices(i,0)] );
       }
-
-      progress_callback.report_finished();
-      delete total;
+      matches.output( matched_ip1, matched_ip2 );
     }
   };
 
@@ -376,6 +466,25 @@ namespace ip {
   // Convenience Typedefs
   typedef InterestPointMatcher< L2NormMetric, NullConstraint > DefaultMatcher;
   typedef InterestPointMatcher< L2NormMetric, ScaleOrientationConstraint > ConstraintedMatcher;
+  typedef InterestPointMatcher< HammingMetric, NullConstraint > BinaryMatcher;
+
+  /// Matches each point of ip1 to the nearest point of ip2 by the L2
+  /// distance of their descriptors, as DefaultMatcher does, keeping
+  /// the match if its squared distance is less than threshold times
+  /// that of the second nearest.  The matches are returned as pairs of
+  /// indices into ip1 and ip2, so no points are copied, the most
+  /// distinct first (by that ratio) for RANSAC's guided sampling.
+  void match_interest_points( InterestPointSet const& ip1, InterestPointSet const& ip2,
+                              std::vector<std::pair<size_t,size_t> >& matches,
+                              double threshold = 0.5,
+                              const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() );
+
+  /// As above, matching against the points of an index built once for
+  /// ip2 and kept for every image ip2 is matched with.
+  void match_interest_points( InterestPointSet const& ip1, DescriptorIndex const& index2,
+                              std::vector<std::pair<size_t,size_t> >& matches,
+                              double threshold = 0.5,
+                              const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() );
 
   // Matching doesn't constraint a point to being matched to only one
   // other point. Here's a way to remove duplicates and have only
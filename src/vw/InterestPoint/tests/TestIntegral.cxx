@@ -9,6 +9,10 @@
 #include <gtest/gtest.h>
 
 #include <vw/InterestPoint/IntegralImage.h>
+#include <vw/InterestPoint/IntegralScaleSpace.h>
+#include <vw/InterestPoint/IntegralDetector.h>
+#include <vw/InterestPoint/IntegralInterestOperator.h>
+#include <vw/InterestPoint/IntegralDescriptor.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Interpolation.h>
 #include <vw/FileIO/DiskImageResource.h>
@@ -236,3 +240,44 @@ TEST( Integral, InterpolationProof ) {
                              10.5, 10.0, 10 ),
                1e-4 );
 }
+
+TEST( Integral, ScaleSpace ) {
+  // Blobs of a few sizes for the detector to find.
+  ImageView<PixelGray<float> > image(120,110);
+  for ( int32 j = 0; j < image.rows(); j++ )
+    for ( int32 i = 0; i < image.cols(); i++ ) {
+      float value = 0.1 * float((i*7 + j*13) % 17) / 17;
+      for ( int32 b = 0; b < 6; b++ ) {
+        float cx = 20 + 17*b, cy = 25 + 11*b, sigma = 2 + b % 3;
+        value += exp( -((i-cx)*(i-cx) + (j-cy)*(j-cy)) / (2*sigma*sigma) );
+      }
+      image(i,j) = value;
+    }
+
+  IntegralScaleSpace space( image );
+  ASSERT_EQ( image.cols() + 1, space.integral().cols() );
+  ASSERT_EQ( image.rows() + 1, space.integral().rows() );
+
+  IntegralInterestPointDetector<OBALoGInterestOperator> detector( OBALoGInterestOperator(0.0001), 0 );
+  InterestPointList expected = detector.process_image( image );
+  InterestPointList points = detect_interest_points( space, detector );
+  ASSERT_GT( expected.size(), 0u );
+  ASSERT_EQ( expected.size(), points.size() );
+  InterestPointList::iterator ip = points.begin();
+  for ( InterestPointList::iterator e = expected.begin(); e != expected.end(); ++e, ++ip ) {
+    EXPECT_EQ( e->x, ip->x );
+    EXPECT_EQ( e->y, ip->y );
+    EXPECT_EQ( e->orientation, ip->orientation );
+  }
+
+  // The descriptors from the shared integral image are those the
+  // generator makes its own, but for the float sums.
+  SGrad2DescriptorGenerator generator;
+  InterestPointList described = points;
+  generator( image, expected );
+  generator( space, described );
+  ip = described.begin();
+  for ( InterestPointList::iterator e = expected.begin(); e != expected.end(); ++e, ++ip )
+    for ( size_t k = 0; k < e->descriptor.size(); k++ )
+      EXPECT_NEAR( e->descriptor[k], ip->descriptor[k], 1e-3 );
+}
@@ -8,6 +8,7 @@
 #include <gtest/gtest.h>
 #include <test/Helpers.h>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointSet.h>
 
 using namespace vw;
 using namespace vw::ip;
@@ -97,3 +98,151 @@ TEST( InterestData, MATCH_IO_Loop ) {
     ip1iter++; ip2iter++;
   }
 }
+
+TEST( InterestData, CullInterestPoints ) {
+  // Interest 0,3,6,...,57 in a shuffled order, with a tie at the cut.
+  InterestPointList ip;
+  for ( uint32 i = 0; i < 20; i++ )
+    ip.push_back( InterestPoint( i, 0, 1.0, float( (i*7) % 20 * 3 ) ) );
+  ip.push_back( InterestPoint( 100, 0, 1.0, 45 ) );
+
+  InterestPointList culled = ip;
+  cull_interest_points( culled, 5 );
+  ASSERT_EQ( 5u, culled.size() );
+  const float expected[5] = { 57, 54, 51, 48, 45 };
+  size_t k = 0;
+  for ( InterestPointList::const_iterator i = culled.begin(); i != culled.end(); ++i, ++k )
+    EXPECT_EQ( expected[k], i->interest );
+  // Of the two points with interest 45, the first is kept.
+  EXPECT_EQ( 5, culled.back().x );
+
+  // No limit, or one above the size, only sorts.
+  culled = ip;
+  cull_interest_points( culled, 0 );
+  ASSERT_EQ( ip.size(), culled.size() );
+  EXPECT_EQ( 57, culled.front().interest );
+  EXPECT_EQ( 0, culled.back().interest );
+  cull_interest_points( culled, 100 );
+  EXPECT_EQ( ip.size(), culled.size() );
+}
+
+TEST( InterestData, InterestPointSet ) {
+  InterestPointList ip;
+  for ( uint32 i = 0; i < 5; i++ ) {
+    ip.push_back( InterestPoint( 2*i, 2*i+5, 1.0, -float(i), i, i % 2, 5, i ) );
+    ip.back().descriptor = Vector<float,5>(5,6,i,1,2);
+  }
+
+  InterestPointSet set( ip.begin(), ip.end() );
+  ASSERT_EQ( 5u, set.size() );
+  EXPECT_EQ( 5u, set.descriptor_size() );
+  EXPECT_EQ( 8u, set.descriptor_stride() );
+  EXPECT_EQ( set.descriptor(1), set.descriptor(0) + 8 );
+  EXPECT_EQ( 3u, set.index( set.descriptor_row(3) ) );
+
+  std::vector<InterestPoint> result = set.points();
+  InterestPointList::iterator ipiter = ip.begin();
+  for ( uint32 i = 0; i < 5; i++, ipiter++ ) {
+    EXPECT_EQ( ipiter->x, set.x()[i] );
+    EXPECT_EQ( ipiter->y, result[i].y );
+    EXPECT_EQ( ipiter->scale, result[i].scale );
+    EXPECT_EQ( ipiter->ix, result[i].ix );
+    EXPECT_EQ( ipiter->iy, result[i].iy );
+    EXPECT_EQ( ipiter->orientation, result[i].orientation );
+    EXPECT_EQ( ipiter->interest, result[i].interest );
+    EXPECT_EQ( ipiter->polarity, result[i].polarity );
+    EXPECT_EQ( ipiter->octave, result[i].octave );
+    EXPECT_EQ( ipiter->scale_lvl, result[i].scale_lvl );
+    ASSERT_EQ( ipiter->size(), result[i].size() );
+    EXPECT_VECTOR_FLOAT_EQ( ipiter->descriptor, result[i].descriptor );
+    EXPECT_EQ( ipiter->descriptor[2], set.descriptor_row(i)[2] );
+  }
+
+  // Points without a descriptor get a row of zeros.
+  set.push_back( InterestPoint( 1, 2 ) );
+  EXPECT_EQ( 0, set.descriptor(5)[4] );
+  InterestPoint bad(1,2);
+  bad.descriptor = Vector3(1,2,3);
+  EXPECT_THROW( set.push_back( bad ), ArgumentErr );
+
+  set.set_descriptor_size( 2 );
+  EXPECT_EQ( 4u, set.descriptor_stride() );
+  EXPECT_EQ( 0, set.descriptor(0)[0] );
+}
+
+TEST( InterestData, InterestPointSet_IO_Loop ) {
+  InterestPointList ip;
+  for ( uint32 i = 0; i < 7; i++ ) {
+    ip.push_back( InterestPoint( 2*i, 2*i+5, 1.0, -float(i), i, i % 2, 5, i ) );
+    ip.back().descriptor = Vector<float,5>(5,6,i,1,2);
+  }
+  InterestPointSet set( ip.begin(), ip.end() );
+
+  UnlinkName set_file( "monkey.vwips" );
+  write_binary_ip_set_file( set_file, set );
+
+  MappedInterestPointSet mapped( set_file );
+  ASSERT_EQ( set.size(), mapped.size() );
+  EXPECT_EQ( 5u, mapped.descriptor_size() );
+  EXPECT_EQ( 8u, mapped.descriptor_stride() );
+  EXPECT_EQ( 0u, size_t( mapped.descriptor(0) ) % 16 );
+
+  InterestPointSet result;
+  read_binary_ip_set_file( set_file, result );
+  ASSERT_EQ( set.size(), result.size() );
+  for ( size_t i = 0; i < set.size(); i++ ) {
+    InterestPoint expected = set.point(i), a = mapped.point(i), b = result.point(i);
+    EXPECT_EQ( expected.x, a.x );
+    EXPECT_EQ( expected.y, b.y );
+    EXPECT_EQ( expected.scale, a.scale );
+    EXPECT_EQ( expected.orientation, b.orientation );
+    EXPECT_EQ( expected.interest, a.interest );
+    EXPECT_EQ( expected.polarity, b.polarity );
+    EXPECT_EQ( expected.octave, a.octave );
+    EXPECT_EQ( expected.scale_lvl, b.scale_lvl );
+    EXPECT_VECTOR_FLOAT_EQ( expected.descriptor, a.descriptor );
+    EXPECT_VECTOR_FLOAT_EQ( expected.descriptor, b.descriptor );
+  }
+
+  // Sets without points are written too.
+  InterestPointSet empty( 3 );
+  write_binary_ip_set_file( set_file, empty );
+  read_binary_ip_set_file( set_file, result );
+  EXPECT_TRUE( result.empty() );
+  EXPECT_EQ( 3u, result.descriptor_size() );
+
+  // Some other kind of file.
+  UnlinkName vwip_file( "monkey.vwip" );
+  write_binary_ip_file( vwip_file, ip );
+  EXPECT_THROW( read_binary_ip_set_file( vwip_file, result ), IOErr );
+}
+
+TEST( InterestData, MatchSet_IO_Loop ) {
+  InterestPointSet ip1, ip2;
+  for ( uint32 i = 0; i < 6; i++ ) {
+    ip1.push_back( InterestPoint( i, 2*i ) );
+    ip2.push_back( InterestPoint( 10+i, 20+2*i ) );
+  }
+  std::vector<std::pair<size_t,size_t> > matches, result;
+  matches.push_back( std::make_pair( 0, 5 ) );
+  matches.push_back( std::make_pair( 3, 1 ) );
+  matches.push_back( std::make_pair( 4, 4 ) );
+
+  UnlinkName match_file( "monkey.vwmatch" );
+  write_binary_match_set_file( match_file, ip1, ip2, matches );
+  InterestPointSet matched1, matched2;
+  read_binary_match_set_file( match_file, result, matched1, matched2 );
+  ASSERT_EQ( matches.size(), result.size() );
+  ASSERT_EQ( matches.size(), matched1.size() );
+  ASSERT_EQ( matches.size(), matched2.size() );
+  for ( size_t i = 0; i < matches.size(); i++ ) {
+    EXPECT_EQ( matches[i], result[i] );
+    EXPECT_EQ( ip1.x()[matches[i].first], matched1.x()[i] );
+    EXPECT_EQ( ip1.y()[matches[i].first], matched1.y()[i] );
+    EXPECT_EQ( ip2.x()[matches[i].second], matched2.x()[i] );
+    EXPECT_EQ( ip2.y()[matches[i].second], matched2.y()[i] );
+  }
+
+  matches.push_back( std::make_pair( 6, 0 ) );
+  EXPECT_THROW( write_binary_match_set_file( match_file, ip1, ip2, matches ), ArgumentErr );
+}
@@ -0,0 +1,56 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+#include <vw/InterestPoint/LearnPCA.h>
+
+using namespace vw;
+using namespace vw::test;
+
+TEST( LearnPCA, Accumulator ) {
+  // More samples than fit in a block, offset far from zero
+  const int dim = 5, count = 150;
+  Matrix<double> samples( count, dim );
+  for ( int k = 0; k < count; k++ )
+    for ( int i = 0; i < dim; i++ )
+      samples(k,i) = 1000 + ( ( k * ( 7 + 3*i ) + i * i ) % 23 ) * 0.1 + ( i == 2 ? 0.5 * samples(k,0) : 0 );
+
+  Vector<double> mean( dim );
+  for ( int k = 0; k < count; k++ )
+    mean += select_row( samples, k );
+  mean /= count;
+  Matrix<double> cov( dim, dim );
+  for ( int k = 0; k < count; k++ ) {
+    Vector<double> d = select_row( samples, k ) - mean;
+    cov += outer_prod( d, d );
+  }
+  cov /= count - 1;
+
+  PCAAccumulator all( dim );
+  for ( int k = 0; k < count; k++ )
+    all.add( &samples(k,0) );
+  EXPECT_EQ( count, all.count() );
+  EXPECT_VECTOR_NEAR( mean, all.mean(), 1e-9 );
+  EXPECT_MATRIX_NEAR( cov, all.covariance(), 1e-9 );
+
+  // Merging accumulators filled separately, with and without pending
+  // samples, gives the same statistics.
+  int splits[] = { 0, 1, 64, 100, count };
+  for ( int s = 0; s < 5; s++ ) {
+    PCAAccumulator first( dim ), second( dim );
+    for ( int k = 0; k < count; k++ )
+      ( k < splits[s] ? first : second ).add( &samples(k,0) );
+    first.merge( second );
+    EXPECT_EQ( count, first.count() );
+    EXPECT_VECTOR_NEAR( mean, first.mean(), 1e-9 );
+    EXPECT_MATRIX_NEAR( cov, first.covariance(), 1e-9 );
+  }
+
+  PCAAccumulator other( dim + 1 );
+  EXPECT_THROW( all.merge( other ), ArgumentErr );
+}
@@ -10,12 +10,17 @@
 
 #include <vw/InterestPoint/Matcher.h>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/IntegralDescriptor.h>
 #include <test/Helpers.h>
 
 #include <algorithm>
+#include <boost/random/linear_congruential.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
 
 using namespace vw;
 using namespace vw::ip;
+using namespace vw::test;
 
 TEST( Matcher, IPComparison ) {
   std::list<InterestPoint> ip_list;
@@ -104,3 +109,312 @@ TEST( Matcher, Matcher ) {
 }
 
 
+
+TEST( Matcher, InterestPointSet ) {
+  boost::rand48 gen(7);
+  boost::uniform_real<float> dist(0,1);
+  boost::variate_generator<boost::rand48&, boost::uniform_real<float> > random( gen, dist );
+
+  std::vector<InterestPoint> ip1_list, ip2_list;
+  for ( uint32 i = 0; i < 60; i++ ) {
+    InterestPoint ip( i, 2*i );
+    ip.descriptor.set_size( 6 );
+    for ( uint32 k = 0; k < 6; k++ )
+      ip.descriptor[k] = random();
+    ip2_list.push_back( ip );
+    if ( i % 3 == 0 ) {
+      for ( uint32 k = 0; k < 6; k++ )
+        ip.descriptor[k] += 0.01*random();
+      ip1_list.push_back( ip );
+    }
+  }
+
+  std::vector<InterestPoint> matched_ip1, matched_ip2;
+  DefaultMatcher matcher( 0.6 );
+  matcher( ip1_list, ip2_list, matched_ip1, matched_ip2 );
+
+  InterestPointSet ip1( ip1_list.begin(), ip1_list.end() ),
+    ip2( ip2_list.begin(), ip2_list.end() );
+  std::vector<std::pair<size_t,size_t> > matches;
+  match_interest_points( ip1, ip2, matches, 0.6 );
+  ASSERT_EQ( matched_ip1.size(), matches.size() );
+  EXPECT_GT( matches.size(), 15u );
+  for ( size_t i = 0; i < matches.size(); i++ ) {
+    EXPECT_EQ( matched_ip1[i].x, ip1.x()[matches[i].first] );
+    EXPECT_EQ( matched_ip2[i].x, ip2.x()[matches[i].second] );
+    EXPECT_EQ( ip1.x()[matches[i].first], ip2.x()[matches[i].second] );
+  }
+}
+
+TEST( Matcher, FindTwoNearest ) {
+  boost::rand48 gen(3);
+  boost::uniform_real<float> dist(0,1);
+  boost::variate_generator<boost::rand48&, boost::uniform_real<float> > random( gen, dist );
+
+  InterestPointSet query( 7 ), reference( 7 );
+  for ( uint32 i = 0; i < 300; i++ ) {
+    InterestPoint ip( i, i );
+    ip.descriptor.set_size( 7 );
+    for ( uint32 k = 0; k < 7; k++ )
+      ip.descriptor[k] = random();
+    reference.push_back( ip );
+    if ( i % 2 == 0 )
+      query.push_back( ip );
+  }
+
+  // Every pair compared, against the tree.
+  Matrix<int> brute_indices, tree_indices;
+  Matrix<float> brute_distances, tree_distances;
+  find_two_nearest( query, reference, brute_indices, brute_distances, 300*300 );
+  find_two_nearest( query, reference, tree_indices, tree_distances, 0 );
+  ASSERT_EQ( brute_indices.rows(), query.size() );
+  ASSERT_EQ( brute_indices.cols(), 2u );
+  for ( size_t i = 0; i < query.size(); i++ ) {
+    EXPECT_EQ( brute_indices(i,0), int(2*i) );
+    EXPECT_EQ( brute_distances(i,0), 0 );
+    EXPECT_LE( brute_distances(i,0), brute_distances(i,1) );
+    EXPECT_EQ( brute_indices(i,0), tree_indices(i,0) );
+    EXPECT_EQ( brute_indices(i,1), tree_indices(i,1) );
+    EXPECT_NEAR( brute_distances(i,1), tree_distances(i,1), 1e-5 );
+  }
+
+  // Too few reference points for a second neighbour.
+  InterestPointSet single( 7 );
+  single.push_back( reference.point(0) );
+  find_two_nearest( query, single, brute_indices, brute_distances );
+  EXPECT_EQ( brute_indices(0,0), 0 );
+  EXPECT_EQ( brute_indices(0,1), -1 );
+
+  // The matcher finds the same matches either way.
+  std::vector<InterestPoint> ip1_list = query.points(), ip2_list = reference.points();
+  std::vector<InterestPoint> brute_ip1, brute_ip2, tree_ip1, tree_ip2;
+  DefaultMatcher matcher( 0.8 );
+  matcher( ip1_list, ip2_list, brute_ip1, brute_ip2 );
+  matcher.set_brute_force_limit( 0 );
+  matcher( ip1_list, ip2_list, tree_ip1, tree_ip2 );
+  ASSERT_EQ( brute_ip1.size(), tree_ip1.size() );
+  EXPECT_EQ( brute_ip1.size(), query.size() );
+  for ( size_t i = 0; i < brute_ip2.size(); i++ )
+    EXPECT_EQ( brute_ip2[i].x, tree_ip2[i].x );
+}
+
+TEST( Matcher, DescriptorIndex ) {
+  boost::rand48 gen(5);
+  boost::uniform_real<float> dist(0,1);
+  boost::variate_generator<boost::rand48&, boost::uniform_real<float> > random( gen, dist );
+
+  InterestPointSet reference( 9 ), query1( 9 ), query2( 9 );
+  for ( uint32 i = 0; i < 200; i++ ) {
+    InterestPoint ip( i, i );
+    ip.descriptor.set_size( 9 );
+    for ( uint32 k = 0; k < 9; k++ )
+      ip.descriptor[k] = random();
+    reference.push_back( ip );
+    if ( i % 3 == 0 )
+      query1.push_back( ip );
+    else if ( i % 3 == 1 )
+      query2.push_back( ip );
+  }
+
+  // One index answers both queries as a tree built for each would.
+  DescriptorIndex index( reference );
+  EXPECT_EQ( index.size(), reference.size() );
+  InterestPointSet const* queries[2] = { &query1, &query2 };
+  for ( size_t q = 0; q < 2; q++ ) {
+    Matrix<int> tree_indices, index_indices;
+    Matrix<float> tree_distances, index_distances;
+    find_two_nearest( *queries[q], reference, tree_indices, tree_distances, 0 );
+    index.find_two_nearest( *queries[q], index_indices, index_distances );
+    ASSERT_EQ( index_indices.rows(), queries[q]->size() );
+    for ( size_t i = 0; i < queries[q]->size(); i++ ) {
+      EXPECT_EQ( index_indices(i,0), int(3*i + q) );
+      EXPECT_EQ( tree_indices(i,0), index_indices(i,0) );
+      EXPECT_EQ( tree_indices(i,1), index_indices(i,1) );
+      EXPECT_NEAR( tree_distances(i,1), index_distances(i,1), 1e-5 );
+    }
+
+    std::vector<std::pair<size_t,size_t> > set_matches, index_matches;
+    match_interest_points( *queries[q], reference, set_matches, 0.8 );
+    match_interest_points( *queries[q], index, index_matches, 0.8 );
+    EXPECT_EQ( set_matches.size(), index_matches.size() );
+  }
+
+  if ( DescriptorIndex::can_save() ) {
+    UnlinkName index_file( "reference.flann" );
+    index.save( index_file );
+    DescriptorIndex loaded( reference, index_file );
+    Matrix<int> indices, loaded_indices;
+    Matrix<float> distances, loaded_distances;
+    index.find_two_nearest( query1, indices, distances );
+    loaded.find_two_nearest( query1, loaded_indices, loaded_distances );
+    for ( size_t i = 0; i < query1.size(); i++ ) {
+      EXPECT_EQ( indices(i,0), loaded_indices(i,0) );
+      EXPECT_EQ( indices(i,1), loaded_indices(i,1) );
+    }
+  } else {
+    EXPECT_THROW( index.save( "reference.flann" ), NoImplErr );
+  }
+}
+
+TEST( Matcher, DescribeInterestPointSet ) {
+  ImageView<PixelGray<float> > image(60,60);
+  for ( int32 j = 0; j < image.rows(); j++ )
+    for ( int32 i = 0; i < image.cols(); i++ )
+      image(i,j) = float((i*7 + j*13) % 17) / 17;
+
+  InterestPointList ip_list;
+  ip_list.push_back( InterestPoint( 20, 25, 1.0, 1.0, 0.3 ) );
+  ip_list.push_back( InterestPoint( 35.5, 30, 1.5, 1.0, -1.0 ) );
+  InterestPointSet set( ip_list.begin(), ip_list.end() );
+
+  SGradDescriptorGenerator generator;
+  generator( image, ip_list );
+  generator( image, set );
+  ASSERT_EQ( 180u, set.descriptor_size() );
+  std::vector<InterestPoint> described = set.points();
+  InterestPointList::iterator ip = ip_list.begin();
+  for ( size_t i = 0; i < set.size(); i++, ip++ )
+    EXPECT_VECTOR_FLOAT_EQ( ip->descriptor, described[i].descriptor );
+}
+
+class TiledDescriptorTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    image.set_size(300,200);
+    for ( int32 j = 0; j < image.rows(); j++ )
+      for ( int32 i = 0; i < image.cols(); i++ )
+        image(i,j) = float((i*7 + j*13) % 17) / 17 + float(i)/(10*image.cols());
+    // Points in several 64 pixel tiles, some near the edges.
+    for ( uint32 i = 0; i < 40; i++ )
+      ip_list.push_back( InterestPoint( 3 + 7.3*i, 2 + 4.9*i, 1 + 0.05*(i % 7), 1.0, 0.2*i - 3 ) );
+    tile_size = vw_settings().default_tile_size();
+    vw_settings().set_default_tile_size( 64 );
+  }
+
+  virtual void TearDown() {
+    vw_settings().set_default_tile_size( tile_size );
+  }
+
+  // Describes the points one at a time from the whole image, as the
+  // generators did before they were tiled.
+  template <class GeneratorT>
+  void check_tiled( GeneratorT& generator ) {
+    InterestPointList tiled = ip_list;
+    generator( image, tiled );
+    InterestPointList::iterator tiled_ip = tiled.begin();
+    for ( InterestPointList::iterator ip = ip_list.begin(); ip != ip_list.end(); ++ip, ++tiled_ip ) {
+      ImageView<PixelGray<float> > support = generator.get_support( *ip, image );
+      Vector<float> expected( generator.descriptor_size() );
+      generator.compute_descriptor( support, expected.begin(), expected.end() );
+      ASSERT_EQ( expected.size(), tiled_ip->size() );
+      for ( size_t k = 0; k < expected.size(); k++ )
+        EXPECT_NEAR( expected[k], tiled_ip->descriptor[k], 1e-4 );
+    }
+  }
+
+  ImageView<PixelGray<float> > image;
+  InterestPointList ip_list;
+  uint32 tile_size;
+};
+
+TEST_F( TiledDescriptorTest, Patch ) {
+  PatchDescriptorGenerator generator;
+  check_tiled( generator );
+}
+
+TEST_F( TiledDescriptorTest, SGrad ) {
+  SGradDescriptorGenerator generator;
+  check_tiled( generator );
+}
+
+TEST_F( TiledDescriptorTest, SGrad2 ) {
+  SGrad2DescriptorGenerator generator;
+  InterestPointList tiled = ip_list;
+  generator( image, tiled );
+  ImageView<double> integral = IntegralImage( pixel_cast<double>( channel_cast<double>( image ) ) );
+  InterestPointList::iterator tiled_ip = tiled.begin();
+  for ( InterestPointList::iterator ip = ip_list.begin(); ip != ip_list.end(); ++ip, ++tiled_ip )
+    EXPECT_VECTOR_FLOAT_EQ( generator.compute_descriptor( interpolate(integral), *ip ),
+                            tiled_ip->descriptor );
+}
+
+TEST( Matcher, HammingMetric ) {
+  InterestPoint ip1, ip2;
+  ip1.descriptor = Vector3( 255, 0, 3 );
+  ip2.descriptor = Vector3( 15, 0, 1 );
+  HammingMetric metric;
+  EXPECT_EQ( 5, metric( ip1, ip2 ) );
+  EXPECT_EQ( 0, metric( ip1, ip1 ) );
+
+  uint64 code[1];
+  pack_binary_descriptor( ip1.descriptor, code );
+  EXPECT_EQ( uint64(0x0300ff), code[0] );
+  EXPECT_EQ( 10u, popcount( code[0] ) );
+}
+
+TEST( Matcher, MultiIndexHash ) {
+  boost::rand48 gen(5);
+  const size_t words = 4, n = 500;
+  std::vector<uint64> reference( words*n ), query( words*n );
+  for ( size_t i = 0; i < reference.size(); i++ )
+    reference[i] = (uint64(gen()) << 32) ^ uint64(gen());
+  // Each query a few bits from its reference code, or far from all.
+  for ( size_t i = 0; i < n; i++ )
+    for ( size_t w = 0; w < words; w++ ) {
+      query[i*words+w] = reference[i*words+w];
+      if ( i % 5 == 0 )
+        query[i*words+w] = (uint64(gen()) << 32) ^ uint64(gen());
+      else
+        query[i*words+w] ^= uint64(1) << (gen() % 64);
+    }
+
+  Matrix<int> brute_indices, hash_indices;
+  Matrix<float> brute_distances, hash_distances;
+  find_two_nearest_hamming( query, reference, words, brute_indices, brute_distances, 0, n*n );
+  find_two_nearest_hamming( query, reference, words, hash_indices, hash_distances, 0, 0 );
+  for ( size_t i = 0; i < n; i++ ) {
+    if ( i % 5 )
+      EXPECT_EQ( int(i), brute_indices(i,0) );
+    EXPECT_EQ( brute_distances(i,0), hash_distances(i,0) );
+    EXPECT_EQ( brute_distances(i,1), hash_distances(i,1) );
+  }
+
+  // Stopping early leaves the ratio test as it was.
+  find_two_nearest_hamming( query, reference, words, hash_indices, hash_distances, 0.8, 0 );
+  for ( size_t i = 0; i < n; i++ ) {
+    EXPECT_EQ( brute_distances(i,0), hash_distances(i,0) );
+    EXPECT_LE( hash_distances(i,1), brute_distances(i,1) );
+    EXPECT_EQ( brute_distances(i,0) < 0.8*brute_distances(i,1),
+               hash_distances(i,0) < 0.8*hash_distances(i,1) );
+  }
+}
+
+TEST( Matcher, BRIEFDescriptor ) {
+  boost::rand48 gen(11);
+  ImageView<PixelGray<float> > image(120,100), shifted(120,100);
+  for ( int32 j = 0; j < image.rows(); j++ )
+    for ( int32 i = 0; i < image.cols(); i++ )
+      image(i,j) = float(gen() % 1000) / 1000;
+  for ( int32 j = 0; j < shifted.rows(); j++ )
+    for ( int32 i = 0; i < shifted.cols(); i++ )
+      shifted(i,j) = image( (i + 7) % image.cols(), (j + 4) % image.rows() );
+
+  InterestPointList ip1, ip2;
+  for ( uint32 i = 0; i < 30; i++ ) {
+    InterestPoint ip( 30 + 2*i, 25 + i, 1.0 + 0.02*i, 1.0, 0.2*i );
+    ip1.push_back( ip );
+    ip.x -= 7; ip.y -= 4;
+    ip2.push_back( ip );
+  }
+  BRIEFDescriptorGenerator generator;
+  generator( image, ip1 );
+  generator( shifted, ip2 );
+  ASSERT_EQ( 32u, ip1.front().descriptor.size() );
+
+  std::vector<InterestPoint> matched_ip1, matched_ip2;
+  BinaryMatcher matcher;
+  matcher( ip1, ip2, matched_ip1, matched_ip2 );
+  EXPECT_EQ( ip1.size(), matched_ip1.size() );
+  for ( size_t i = 0; i < matched_ip1.size(); i++ )
+    EXPECT_EQ( matched_ip1[i].x - 7, matched_ip2[i].x );
+}
@@ -58,11 +58,18 @@
 /// which may be buggy and certainly is underperforming Armijo
 /// for me at the moment.  I also provide a steepest_descent()
 /// method for comparison to conjugate_gradient().
+///
+/// For linear systems A x = b with A symmetric positive definite
+/// there is also preconditioned_conjugate_gradient(), which needs
+/// only a functor returning the product of A and a vector, so A never
+/// has to be formed, and one applying an approximate inverse of A.
+/// It does stop once the residual is small enough.
 
 #ifndef __VW_MATH_CONJUGATEGRADIENT_H__
 #define __VW_MATH_CONJUGATEGRADIENT_H__
 
 #include <vw/Core/Log.h>
+#include <vw/Math/Vector.h>
 
 #define VW_CONJGRAD_MAX_ITERS_BETWEEN_SPACER_STEPS 20
 
@@ -229,6 +236,47 @@ namespace math{
     return pos;
   }
 
+  /// Solves A x = b for A symmetric positive definite.  op(v) returns
+  /// A v and precond(r) an approximation of A^{-1} r, which must be
+  /// symmetric positive definite too.  x holds the initial guess and
+  /// receives the solution.  Stops after max_iterations or once the
+  /// residual is at most tolerance times b, and returns the number of
+  /// iterations done.
+  template <class OpT, class PrecondT, class VectorT>
+  size_t preconditioned_conjugate_gradient( OpT const& op, PrecondT const& precond,
+                                            VectorT const& b, VectorT& x,
+                                            size_t max_iterations, double tolerance ) {
+    const double threshold = tolerance * norm_2(b);
+    VectorT r = b - op(x);
+    if ( norm_2(r) <= threshold )
+      return 0;
+    VectorT z = precond(r);
+    VectorT p = z;
+    double rz = dot_prod(r,z);
+    size_t i = 0;
+    while ( i < max_iterations ) {
+      VectorT q = op(p);
+      double pq = dot_prod(p,q);
+      if ( !( pq > 0 ) ) {
+        VW_OUT(DebugMessage, "math") << "PCG: operator is not positive definite." << std::endl;
+        break;
+      }
+      double alpha = rz / pq;
+      x += alpha * p;
+      r -= alpha * q;
+      ++i;
+      if ( norm_2(r) <= threshold )
+        break;
+      z = precond(r);
+      double rz_next = dot_prod(r,z);
+      p = z + (rz_next / rz) * p;
+      rz = rz_next;
+    }
+    VW_OUT(DebugMessage, "math") << "PCG: " << i << " iterations, residual "
+                                 << norm_2(r) << std::endl;
+    return i;
+  }
+
 } } // namespace vw::math
 
 #endif // #ifndef __VW_MATH_CONJUGATEGRADIENT_H__
@@ -46,7 +46,7 @@ namespace math {
     typedef ElemNode* Elem;
     typedef ElemNode* Set;
 
-    DisjointSet() {}
+    DisjointSet() : num_elems(0) {}
     ~DisjointSet() {
       typename std::list<ElemNode*>::iterator i;
       for (i = elems.begin(); i != elems.end(); i++)
@@ -0,0 +1,185 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Dual.h
+///
+/// Dual numbers for forward mode automatic differentiation.  A
+/// Dual<N> carries a value along with its derivatives with respect to
+/// N variables.  A function written as a template on its scalar type
+/// and evaluated on Dual<N> arguments, each seeded with its own
+/// variable, returns its value and its exact gradient in one pass:
+///
+///   Dual<2> x( 3.0, 0 ), y( 4.0, 1 );
+///   Dual<2> r = sqrt( x*x + y*y );    // r.value() == 5,
+///                                     // r.derivative(0) == 0.6
+///
+/// The elementary functions are found by argument dependent lookup,
+/// so call them unqualified (sqrt, not std::sqrt) in the template.
+/// Vectors and matrices of Dual<N> work with the usual arithmetic.
+///
+#ifndef __VW_MATH_DUAL_H__
+#define __VW_MATH_DUAL_H__
+
+#include <cmath>
+#include <ostream>
+
+namespace vw {
+namespace math {
+
+  template <size_t N>
+  class Dual {
+    double m_value;
+    double m_derivative[N];
+  public:
+    static const size_t variables = N;
+
+    /// A constant, with no derivatives.
+    Dual( double value = 0 ) : m_value(value) {
+      for ( size_t n = 0; n < N; n++ ) m_derivative[n] = 0;
+    }
+
+    /// The variable number n, at value.
+    Dual( double value, size_t n ) : m_value(value) {
+      for ( size_t k = 0; k < N; k++ ) m_derivative[k] = 0;
+      m_derivative[n] = 1;
+    }
+
+    double value() const { return m_value; }
+    double& value() { return m_value; }
+    double derivative( size_t n ) const { return m_derivative[n]; }
+    double& derivative( size_t n ) { return m_derivative[n]; }
+
+    Dual& operator+=( Dual const& b ) {
+      m_value += b.m_value;
+      for ( size_t n = 0; n < N; n++ ) m_derivative[n] += b.m_derivative[n];
+      return *this;
+    }
+    Dual& operator-=( Dual const& b ) {
+      m_value -= b.m_value;
+      for ( size_t n = 0; n < N; n++ ) m_derivative[n] -= b.m_derivative[n];
+      return *this;
+    }
+    Dual& operator*=( Dual const& b ) {
+      for ( size_t n = 0; n < N; n++ )
+        m_derivative[n] = m_derivative[n] * b.m_value + m_value * b.m_derivative[n];
+      m_value *= b.m_value;
+      return *this;
+    }
+    Dual& operator/=( Dual const& b ) {
+      const double inverse = 1 / b.m_value;
+      m_value *= inverse;
+      for ( size_t n = 0; n < N; n++ )
+        m_derivative[n] = ( m_derivative[n] - m_value * b.m_derivative[n] ) * inverse;
+      return *this;
+    }
+    Dual& operator+=( double b ) { m_value += b; return *this; }
+    Dual& operator-=( double b ) { m_value -= b; return *this; }
+    Dual& operator*=( double b ) {
+      m_value *= b;
+      for ( size_t n = 0; n < N; n++ ) m_derivative[n] *= b;
+      return *this;
+    }
+    Dual& operator/=( double b ) { return *this *= 1 / b; }
+
+    /// The same value, with its derivatives scaled by d.  The chain
+    /// rule for a function whose derivative at value() is d.
+    Dual chain( double value, double d ) const {
+      Dual r( value );
+      for ( size_t n = 0; n < N; n++ ) r.m_derivative[n] = d * m_derivative[n];
+      return r;
+    }
+  };
+
+  template <size_t N> inline Dual<N> operator-( Dual<N> const& a ) { return a.chain( -a.value(), -1 ); }
+  template <size_t N> inline Dual<N> operator+( Dual<N> const& a ) { return a; }
+
+  template <size_t N> inline Dual<N> operator+( Dual<N> a, Dual<N> const& b ) { return a += b; }
+  template <size_t N> inline Dual<N> operator-( Dual<N> a, Dual<N> const& b ) { return a -= b; }
+  template <size_t N> inline Dual<N> operator*( Dual<N> a, Dual<N> const& b ) { return a *= b; }
+  template <size_t N> inline Dual<N> operator/( Dual<N> a, Dual<N> const& b ) { return a /= b; }
+
+  template <size_t N> inline Dual<N> operator+( Dual<N> a, double b ) { return a += b; }
+  template <size_t N> inline Dual<N> operator-( Dual<N> a, double b ) { return a -= b; }
+  template <size_t N> inline Dual<N> operator*( Dual<N> a, double b ) { return a *= b; }
+  template <size_t N> inline Dual<N> operator/( Dual<N> a, double b ) { return a /= b; }
+
+  template <size_t N> inline Dual<N> operator+( double a, Dual<N> b ) { return b += a; }
+  template <size_t N> inline Dual<N> operator-( double a, Dual<N> const& b ) { return (-b) += a; }
+  template <size_t N> inline Dual<N> operator*( double a, Dual<N> b ) { return b *= a; }
+  template <size_t N> inline Dual<N> operator/( double a, Dual<N> const& b ) {
+    return b.chain( a / b.value(), -a / ( b.value() * b.value() ) );
+  }
+
+  // Comparisons are of the values alone.
+#define VW_DUAL_COMPARISON(op)                                                                    \
+  template <size_t N> inline bool operator op( Dual<N> const& a, Dual<N> const& b ) { return a.value() op b.value(); } \
+  template <size_t N> inline bool operator op( Dual<N> const& a, double b ) { return a.value() op b; }              \
+  template <size_t N> inline bool operator op( double a, Dual<N> const& b ) { return a op b.value(); }
+  VW_DUAL_COMPARISON(<)
+  VW_DUAL_COMPARISON(>)
+  VW_DUAL_COMPARISON(<=)
+  VW_DUAL_COMPARISON(>=)
+  VW_DUAL_COMPARISON(==)
+  VW_DUAL_COMPARISON(!=)
+#undef VW_DUAL_COMPARISON
+
+  template <size_t N> inline Dual<N> sqrt( Dual<N> const& a ) {
+    const double r = std::sqrt( a.value() );
+    return a.chain( r, 0.5 / r );
+  }
+  template <size_t N> inline Dual<N> exp( Dual<N> const& a ) {
+    const double r = std::exp( a.value() );
+    return a.chain( r, r );
+  }
+  template <size_t N> inline Dual<N> log( Dual<N> const& a ) {
+    return a.chain( std::log( a.value() ), 1 / a.value() );
+  }
+  template <size_t N> inline Dual<N> pow( Dual<N> const& a, double b ) {
+    const double r = std::pow( a.value(), b - 1 );
+    return a.chain( r * a.value(), b * r );
+  }
+  template <size_t N> inline Dual<N> sin( Dual<N> const& a ) {
+    return a.chain( std::sin( a.value() ), std::cos( a.value() ) );
+  }
+  template <size_t N> inline Dual<N> cos( Dual<N> const& a ) {
+    return a.chain( std::cos( a.value() ), -std::sin( a.value() ) );
+  }
+  template <size_t N> inline Dual<N> tan( Dual<N> const& a ) {
+    const double r = std::tan( a.value() );
+    return a.chain( r, 1 + r*r );
+  }
+  template <size_t N> inline Dual<N> asin( Dual<N> const& a ) {
+    return a.chain( std::asin( a.value() ), 1 / std::sqrt( 1 - a.value()*a.value() ) );
+  }
+  template <size_t N> inline Dual<N> acos( Dual<N> const& a ) {
+    return a.chain( std::acos( a.value() ), -1 / std::sqrt( 1 - a.value()*a.value() ) );
+  }
+  template <size_t N> inline Dual<N> atan( Dual<N> const& a ) {
+    return a.chain( std::atan( a.value() ), 1 / ( 1 + a.value()*a.value() ) );
+  }
+  template <size_t N> inline Dual<N> atan2( Dual<N> const& y, Dual<N> const& x ) {
+    const double inverse = 1 / ( x.value()*x.value() + y.value()*y.value() );
+    Dual<N> r = y.chain( std::atan2( y.value(), x.value() ), x.value() * inverse );
+    r -= x.chain( 0, y.value() * inverse );
+    return r;
+  }
+  template <size_t N> inline Dual<N> fabs( Dual<N> const& a ) {
+    return a.value() < 0 ? -a : a;
+  }
+  template <size_t N> inline Dual<N> abs( Dual<N> const& a ) { return fabs( a ); }
+
+  template <size_t N>
+  inline std::ostream& operator<<( std::ostream& os, Dual<N> const& a ) {
+    os << a.value() << "[";
+    for ( size_t n = 0; n < N; n++ )
+      os << ( n ? "," : "" ) << a.derivative(n);
+    return os << "]";
+  }
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_DUAL_H__
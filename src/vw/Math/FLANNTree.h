@@ -12,6 +12,8 @@
 #include <vw/Math/Matrix.h>
 #include <flann/flann.hpp>
 
+#include <string>
+
 namespace vw {
 namespace math {
 
@@ -34,21 +36,23 @@ namespace math {
     // Multiple query access
     template <class MatrixT>
     void knn_search( MatrixBase<MatrixT> const& query,
-                     Vector<int>& indices,
-                     Vector<distance_type>& dists,
+                     Matrix<int>& indices,
+                     Matrix<distance_type>& dists,
                      size_t knn,
                      flann::SearchParams const& params = flann::SearchParams(128) ) {
       typedef typename MatrixT::value_type element_type;
+      const size_t rows = query.impl().rows();
 
-      if ( indices.size() != knn )
-        indices.set_size( knn );
-      if ( dists.size() != knn )
-        dists.set_size( knn );
+      // One row of knn results per query row.
+      if ( indices.rows() != rows || indices.cols() != knn )
+        indices.set_size( rows, knn );
+      if ( dists.rows() != rows || dists.cols() != knn )
+        dists.set_size( rows, knn );
 
       flann::Matrix<element_type> query_mat( const_cast<element_type*>(query.impl().data()),
-                                             query.impl().rows(), query.impl().cols() );
-      flann::Matrix<int> indice_mat( &indices[0], 1, indices.size() );
-      flann::Matrix<distance_type> dists_mat( &dists[0], 1, dists.size() );
+                                             rows, query.impl().cols() );
+      flann::Matrix<int> indice_mat( indices.data(), rows, knn );
+      flann::Matrix<distance_type> dists_mat( dists.data(), rows, knn );
       m_index.knnSearch( query_mat, indice_mat, dists_mat, knn, params );
     }
 
@@ -75,6 +79,11 @@ namespace math {
 
     size_t size1() const { return m_index.size(); }
     size_t size2() const { return m_index.veclen(); }
+
+    // Writes the index, without the features, to a file.  Passing
+    // flann::SavedIndexParams(filename) to the constructor, with the
+    // same features, reads it back rather than building it again.
+    void save( std::string const& filename ) { m_index.save( filename ); }
   };
 
 }} // end namespace vw::math
@@ -0,0 +1,312 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file FlatKDTree.h
+///
+/// A kd-tree laid out in flat arrays, for finding the nearest
+/// neighbours of many points at once.
+///
+/// The tree is balanced: each node splits its points at the median of
+/// the dimension over which they spread widest, down to leaves of at
+/// most leaf_size points.  The nodes are stored as an implicit binary
+/// heap, the children of node n being 2n+1 and 2n+2, and the points
+/// are copied in leaf order, so that the points of a leaf are read
+/// together.  A search changes nothing in the tree, so several
+/// threads may search it at once, and knn_search() of many queries
+/// spreads them across threads itself.  Subtrees are also built on
+/// several threads.
+///
+/// The interface follows FLANNTree: distances are squared L2, and
+/// neighbours that the tree has too few points to find are given index
+/// -1 and the largest distance.
+///
+#ifndef __VW_MATH_FLATKDTREE_H__
+#define __VW_MATH_FLATKDTREE_H__
+
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/Matrix.h>
+#include <vw/Math/Vector.h>
+
+#include <boost/mpl/if.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/type_traits/is_same.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace vw {
+namespace math {
+
+  template <class KeyT>
+  class FlatKDTree {
+  public:
+    typedef KeyT element_type;
+    typedef typename boost::mpl::if_<boost::is_same<KeyT,float>, float, double>::type distance_type;
+
+  private:
+    struct Node {
+      size_t begin, end;   // The points below the node
+      size_t dimension;    // Of the split, for inner nodes
+      KeyT split;
+    };
+
+    size_t m_dimensions, m_size, m_depth;
+    std::vector<Node> m_nodes;
+    std::vector<KeyT> m_points;  // In leaf order
+    std::vector<size_t> m_index; // The index given of each point
+
+    // Orders points by one key, during construction.
+    class KeyCompare {
+      KeyT const* m_keys;
+      size_t m_dimensions, m_dimension;
+    public:
+      KeyCompare( KeyT const* keys, size_t dimensions, size_t dimension ) :
+        m_keys(keys), m_dimensions(dimensions), m_dimension(dimension) {}
+      bool operator()( size_t a, size_t b ) const {
+        return m_keys[a*m_dimensions+m_dimension] < m_keys[b*m_dimensions+m_dimension];
+      }
+    };
+
+    // Builds the subtree of node n over m_index [begin, end), which is
+    // at the given depth.  Subtrees at parallel_depth are given to the
+    // queue, if there is one.
+    void build( KeyT const* keys, size_t n, size_t begin, size_t end, size_t depth,
+                size_t parallel_depth, FifoWorkQueue* queue ) {
+      if ( queue && depth == parallel_depth ) {
+        boost::shared_ptr<Task> task( new BuildTask( *this, keys, n, begin, end, depth ) );
+        queue->add_task( task );
+        return;
+      }
+
+      Node& node = m_nodes[n];
+      node.begin = begin;
+      node.end = end;
+      node.dimension = 0;
+      node.split = KeyT();
+      if ( depth == m_depth || end - begin < 2 ) {
+        // A leaf, or an empty subtree of one
+        for ( size_t c = 2*n+1; depth < m_depth && c < 2*n+3; c++ )
+          build( keys, c, end, end, depth+1, parallel_depth, 0 );
+        return;
+      }
+
+      // The dimension of widest spread
+      KeyT widest = KeyT();
+      for ( size_t d = 0; d < m_dimensions; d++ ) {
+        KeyT lo = keys[m_index[begin]*m_dimensions+d], hi = lo;
+        for ( size_t i = begin+1; i < end; i++ ) {
+          KeyT key = keys[m_index[i]*m_dimensions+d];
+          lo = std::min( lo, key );
+          hi = std::max( hi, key );
+        }
+        if ( d == 0 || hi - lo > widest ) {
+          widest = hi - lo;
+          node.dimension = d;
+        }
+      }
+
+      size_t mid = begin + (end - begin)/2;
+      std::nth_element( m_index.begin()+begin, m_index.begin()+mid, m_index.begin()+end,
+                        KeyCompare( keys, m_dimensions, node.dimension ) );
+      node.split = keys[m_index[mid]*m_dimensions+node.dimension];
+      build( keys, 2*n+1, begin, mid, depth+1, parallel_depth, queue );
+      build( keys, 2*n+2, mid, end, depth+1, parallel_depth, queue );
+    }
+
+    class BuildTask : public Task, private boost::noncopyable {
+      FlatKDTree& m_tree;
+      KeyT const* m_keys;
+      size_t m_node, m_begin, m_end, m_depth;
+    public:
+      BuildTask( FlatKDTree& tree, KeyT const* keys, size_t node, size_t begin, size_t end, size_t depth ) :
+        m_tree(tree), m_keys(keys), m_node(node), m_begin(begin), m_end(end), m_depth(depth) {}
+      void operator()() { m_tree.build( m_keys, m_node, m_begin, m_end, m_depth, 0, 0 ); }
+    };
+
+    // The squared distance of point i from query, summed in four parts
+    // that the compiler can keep in one vector register.
+    distance_type distance( KeyT const* query, size_t i ) const {
+      KeyT const* point = &m_points[i*m_dimensions];
+      distance_type sum[4] = { 0, 0, 0, 0 };
+      size_t d = 0;
+      for ( ; d + 4 <= m_dimensions; d += 4 )
+        for ( size_t k = 0; k < 4; k++ ) {
+          distance_type diff = distance_type(query[d+k]) - distance_type(point[d+k]);
+          sum[k] += diff*diff;
+        }
+      for ( ; d < m_dimensions; d++ ) {
+        distance_type diff = distance_type(query[d]) - distance_type(point[d]);
+        sum[0] += diff*diff;
+      }
+      return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    }
+
+    // Searches the subtree of node n, keeping the knn nearest found in
+    // order of distance.
+    void search( KeyT const* query, size_t n, size_t depth, size_t knn,
+                 int* indices, distance_type* dists ) const {
+      Node const& node = m_nodes[n];
+      if ( node.begin == node.end )
+        return;
+      if ( depth == m_depth || node.end - node.begin < 2 ) {
+        for ( size_t i = node.begin; i < node.end; i++ ) {
+          distance_type dist = distance( query, i );
+          if ( dist >= dists[knn-1] )
+            continue;
+          size_t k = knn-1;
+          for ( ; k > 0 && dists[k-1] > dist; k-- ) {
+            dists[k] = dists[k-1];
+            indices[k] = indices[k-1];
+          }
+          dists[k] = dist;
+          indices[k] = int(m_index[i]);
+        }
+        return;
+      }
+
+      distance_type offset = distance_type(query[node.dimension]) - distance_type(node.split);
+      size_t near = offset < 0 ? 2*n+1 : 2*n+2;
+      search( query, near, depth+1, knn, indices, dists );
+      if ( offset*offset < dists[knn-1] )
+        search( query, 4*n+3-near, depth+1, knn, indices, dists );
+    }
+
+    template <class MatrixT>
+    class SearchTask : public Task, private boost::noncopyable {
+      FlatKDTree const& m_tree;
+      MatrixT const& m_query;
+      Matrix<int>& m_indices;
+      Matrix<distance_type>& m_dists;
+      size_t m_knn, m_begin, m_end;
+    public:
+      SearchTask( FlatKDTree const& tree, MatrixT const& query, Matrix<int>& indices,
+                  Matrix<distance_type>& dists, size_t knn, size_t begin, size_t end ) :
+        m_tree(tree), m_query(query), m_indices(indices), m_dists(dists),
+        m_knn(knn), m_begin(begin), m_end(end) {}
+      void operator()() {
+        std::vector<KeyT> row( m_tree.size2() );
+        for ( size_t i = m_begin; i < m_end; i++ ) {
+          for ( size_t d = 0; d < row.size(); d++ )
+            row[d] = m_query(i,d);
+          m_tree.knn_search( &row[0], m_knn, &m_indices(i,0), &m_dists(i,0) );
+        }
+      }
+    };
+
+  public:
+    /// Builds the tree over the rows of points, which it copies.
+    template <class MatrixT>
+    explicit FlatKDTree( MatrixBase<MatrixT> const& points, size_t leaf_size = 16,
+                         size_t num_threads = 0 ) :
+      m_dimensions( points.impl().cols() ), m_size( points.impl().rows() ), m_depth(0) {
+      VW_ASSERT( leaf_size > 0, ArgumentErr() << "FlatKDTree: leaf_size must be positive." );
+      while ( m_size > leaf_size && ( (m_size - 1) >> m_depth ) + 1 > leaf_size )
+        m_depth++;
+      m_nodes.resize( (size_t(2) << m_depth) - 1 );
+
+      std::vector<KeyT> keys( m_size*m_dimensions );
+      for ( size_t i = 0; i < m_size; i++ )
+        for ( size_t d = 0; d < m_dimensions; d++ )
+          keys[i*m_dimensions+d] = points.impl()(i,d);
+      m_index.resize( m_size );
+      for ( size_t i = 0; i < m_size; i++ )
+        m_index[i] = i;
+
+      // The top levels are split here, and the subtrees below them,
+      // a few to each thread, at once.
+      const size_t threads = num_threads ? num_threads : vw_settings().default_num_threads();
+      KeyT const* key_data = keys.empty() ? 0 : &keys[0];
+      if ( threads <= 1 || m_size < 4096 ) {
+        build( key_data, 0, 0, m_size, 0, 0, 0 );
+      } else {
+        size_t parallel_depth = 0;
+        while ( (size_t(1) << parallel_depth) < 4*threads && parallel_depth < m_depth )
+          parallel_depth++;
+        FifoWorkQueue queue( threads );
+        build( key_data, 0, 0, m_size, 0, parallel_depth, &queue );
+        queue.join_all();
+      }
+
+      m_points.resize( keys.size() );
+      for ( size_t i = 0; i < m_size; i++ )
+        std::copy( &keys[m_index[i]*m_dimensions], &keys[m_index[i]*m_dimensions] + m_dimensions,
+                   &m_points[i*m_dimensions] );
+    }
+
+    /// Finds the knn points nearest to the query of size2() keys,
+    /// writing their indices and squared distances, nearest first.
+    /// Returns the number found.
+    size_t knn_search( KeyT const* query, size_t knn, int* indices, distance_type* dists ) const {
+      for ( size_t k = 0; k < knn; k++ ) {
+        indices[k] = -1;
+        dists[k] = std::numeric_limits<distance_type>::max();
+      }
+      if ( knn == 0 )
+        return 0;
+      search( query, 0, 0, knn, indices, dists );
+      return std::min( knn, m_size );
+    }
+
+    /// Finds the knn nearest neighbours of each row of query, in
+    /// blocks across num_threads threads (the default number if zero).
+    template <class MatrixT>
+    void knn_search( MatrixBase<MatrixT> const& query,
+                     Matrix<int>& indices,
+                     Matrix<distance_type>& dists,
+                     size_t knn, size_t num_threads = 0 ) const {
+      VW_ASSERT( query.impl().rows() == 0 || query.impl().cols() == m_dimensions,
+                 ArgumentErr() << "FlatKDTree: query has " << query.impl().cols()
+                 << " columns, not " << m_dimensions << "." );
+      const size_t rows = query.impl().rows();
+      indices.set_size( rows, knn );
+      dists.set_size( rows, knn );
+      if ( rows == 0 || knn == 0 )
+        return;
+
+      const size_t threads = num_threads ? num_threads : vw_settings().default_num_threads();
+      if ( threads <= 1 || rows < 64 ) {
+        SearchTask<MatrixT>( *this, query.impl(), indices, dists, knn, 0, rows )();
+        return;
+      }
+      const size_t block = std::max( size_t(64), rows / (4*threads) + 1 );
+      FifoWorkQueue queue( threads );
+      for ( size_t begin = 0; begin < rows; begin += block ) {
+        boost::shared_ptr<Task> task( new SearchTask<MatrixT>( *this, query.impl(), indices, dists, knn,
+                                                               begin, std::min( begin + block, rows ) ) );
+        queue.add_task( task );
+      }
+      queue.join_all();
+    }
+
+    /// Finds the knn nearest neighbours of one query.
+    template <class VectorT>
+    void knn_search( VectorBase<VectorT> const& query,
+                     Vector<int>& indices,
+                     Vector<distance_type>& dists,
+                     size_t knn ) const {
+      VW_ASSERT( query.impl().size() == m_dimensions,
+                 ArgumentErr() << "FlatKDTree: query has " << query.impl().size()
+                 << " keys, not " << m_dimensions << "." );
+      std::vector<KeyT> row( query.impl().begin(), query.impl().end() );
+      indices.set_size( knn );
+      dists.set_size( knn );
+      if ( knn )
+        knn_search( row.empty() ? 0 : &row[0], knn, &indices[0], &dists[0] );
+    }
+
+    size_t size1() const { return m_size; }
+    size_t size2() const { return m_dimensions; }
+
+    /// The depth of the leaves, which is zero for a tree of one leaf.
+    size_t depth() const { return m_depth; }
+  };
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_FLATKDTREE_H__
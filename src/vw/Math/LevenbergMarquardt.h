@@ -19,12 +19,17 @@
 
 // Vision Workbench
 #include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Math/Matrix.h>
 #include <vw/Math/Vector.h>
 #include <vw/Math/LinearAlgebra.h>
 
 // Boost
 #include <boost/concept_check.hpp>
+#include <boost/static_assert.hpp>
+
+#include <vector>
 
 namespace vw {
 namespace math {
@@ -294,6 +299,164 @@ namespace math {
     return x;
   }
 
+  namespace detail {
+
+    template <class ImplT>
+    int levenberg_marquardt_fixed( ImplT const& model,
+                                   typename ImplT::domain_type& x,
+                                   typename ImplT::result_type const& observation,
+                                   double abs_tolerance, double rel_tolerance,
+                                   double max_iterations ) {
+      typedef typename ImplT::domain_type domain_type;
+      typedef typename ImplT::result_type result_type;
+      typedef typename ImplT::jacobian_type jacobian_type;
+      const size_t N = VectorSize<domain_type>::value;
+      BOOST_STATIC_ASSERT( VectorSize<domain_type>::value > 0 );
+      BOOST_STATIC_ASSERT( VectorSize<result_type>::value > 0 );
+
+      int status = optimization::eDidNotConverge;
+      const double Rinv = 10;
+      double lambda = 0.1;
+
+      result_type error = model.difference( observation, model(x) );
+      double norm_start = norm_2(error);
+      bool done = norm_start < abs_tolerance;
+
+      domain_type x_try;
+      Vector<double,N> del_J;
+      Matrix<double,N,N> hessian, hessian_lm;
+      int outer_iter = 0;
+      while (!done) {
+        bool shortCircuit = false;
+        outer_iter++;
+
+        error = model.difference( observation, model(x) );
+        norm_start = norm_2(error);
+
+        jacobian_type J = model.jacobian(x);
+        del_J = -Rinv * (transpose(J) * error);
+        hessian = Rinv * (transpose(J) * J);
+
+        int iterations = 0;
+        double norm_try = norm_start+1.0;
+        while (norm_try > norm_start) {
+          hessian_lm = hessian;
+          for ( size_t i=0; i < N; ++i )
+            hessian_lm(i,i) += hessian_lm(i,i)*lambda + lambda;
+
+          domain_type delta_x = del_J;
+          try {
+            solve_symmetric_nocopy( hessian_lm, delta_x );
+            x_try = x - delta_x;
+            norm_try = norm_2( model.difference( observation, model(x_try) ) );
+          } catch ( const ArgumentErr& ) {
+            norm_try = norm_start+1.0;
+          }
+
+          if (norm_try > norm_start)
+            lambda *= 10;
+
+          ++iterations;
+          if (iterations > 5) {
+            shortCircuit = true;
+            norm_try = norm_start;
+          }
+        }
+
+        if (((norm_start-norm_try)/norm_start) < rel_tolerance) {
+          status = optimization::eConvergedRelTolerance;
+          done = true;
+        }
+        if (norm_try < abs_tolerance) {
+          status = optimization::eConvergedAbsTolerance;
+          done = true;
+        }
+        if (outer_iter >= max_iterations)
+          done = true;
+
+        if (!shortCircuit)
+          x = x_try;
+        lambda /= 10;
+      }
+      return status;
+    }
+
+    template <class ImplT>
+    class LevenbergMarquardtBatchTask : public Task, private boost::noncopyable {
+      std::vector<ImplT> const& m_models;
+      std::vector<typename ImplT::domain_type>& m_x;
+      std::vector<typename ImplT::result_type> const& m_observations;
+      std::vector<int>& m_status;
+      size_t m_begin, m_end;
+      double m_abs_tolerance, m_rel_tolerance, m_max_iterations;
+    public:
+      LevenbergMarquardtBatchTask( std::vector<ImplT> const& models,
+                                   std::vector<typename ImplT::domain_type>& x,
+                                   std::vector<typename ImplT::result_type> const& observations,
+                                   std::vector<int>& status, size_t begin, size_t end,
+                                   double abs_tolerance, double rel_tolerance, double max_iterations ) :
+        m_models(models), m_x(x), m_observations(observations), m_status(status),
+        m_begin(begin), m_end(end), m_abs_tolerance(abs_tolerance),
+        m_rel_tolerance(rel_tolerance), m_max_iterations(max_iterations) {}
+
+      void operator()() {
+        for ( size_t k = m_begin; k < m_end; k++ )
+          m_status[k] = levenberg_marquardt_fixed( m_models[k], m_x[k], m_observations[k],
+                                                   m_abs_tolerance, m_rel_tolerance,
+                                                   m_max_iterations );
+      }
+    };
+  }
+
+  /// Levenberg-Marquardt for many small independent problems, each
+  /// with its own model, seed and observation.  The solution of
+  /// problem k replaces seeds[k], and its status is left in
+  /// status[k].  The problems are solved in blocks across threads (all
+  /// the default number if num_threads is zero); models must be safe
+  /// to evaluate at once.
+  ///
+  /// The model's domain_type and result_type must be fixed-size
+  /// Vector<double,N> and Vector<double,M>, and its jacobian_type
+  /// Matrix<double,M,N>.  Each step is then taken entirely in
+  /// statically-allocated storage, with the small fixed-size products
+  /// and cholesky solve, and with none of the logging of the
+  /// single-problem version above.  Models should provide their own
+  /// jacobian(), as the numerical one of LeastSquaresModelBase
+  /// allocates.  The steps otherwise follow levenberg_marquardt()
+  /// above, except that the update is solved by cholesky
+  /// factorization rather than least squares.
+  template <class ImplT>
+  void levenberg_marquardt_batch( std::vector<ImplT> const& models,
+                                  std::vector<typename ImplT::domain_type>& seeds,
+                                  std::vector<typename ImplT::result_type> const& observations,
+                                  std::vector<int>& status,
+                                  double abs_tolerance = VW_MATH_LM_ABS_TOL,
+                                  double rel_tolerance = VW_MATH_LM_REL_TOL,
+                                  double max_iterations = VW_MATH_LM_MAX_ITER,
+                                  size_t num_threads = 0 ) {
+    VW_ASSERT( models.size() == seeds.size() && models.size() == observations.size(),
+               ArgumentErr() << "levenberg_marquardt_batch: models, seeds and observations differ in number." );
+    status.resize( models.size() );
+
+    const size_t threads = num_threads ? num_threads : vw_settings().default_num_threads();
+    if ( threads <= 1 ) {
+      detail::LevenbergMarquardtBatchTask<ImplT>( models, seeds, observations, status, 0, models.size(),
+                                                  abs_tolerance, rel_tolerance, max_iterations )();
+      return;
+    }
+
+    // A few blocks to each thread
+    const size_t block = models.size() / (4*threads) + 1;
+    FifoWorkQueue queue( threads );
+    for ( size_t begin = 0; begin < models.size(); begin += block ) {
+      boost::shared_ptr<Task> task( new detail::LevenbergMarquardtBatchTask<ImplT>(
+        models, seeds, observations, status, begin, std::min( begin + block, models.size() ),
+        abs_tolerance, rel_tolerance, max_iterations ) );
+      queue.add_task( task );
+    }
+    queue.join_all();
+  }
+
 }} // namespace vw::math
 
 #endif // __VW_OPTIMIZATION_H__
@@ -403,6 +403,41 @@ namespace math {
       vw_throw( ArgumentErr() << "solve_symmetric(): LAPACK driver posv could not solve equation because A is not symmetric positive definite." );
   }
 
+  /// The same for a small fixed-size A, factored here without
+  /// dynamic allocation or a call to LAPACK.  As from posv, the upper
+  /// triangle of A is replaced by the transpose of its lower cholesky
+  /// factor, and the lower triangle is left as it was.
+  template <class ElemT, size_t SizeN>
+  typename boost::enable_if_c< detail::IsSmallSize<SizeN>::value >::type
+  solve_symmetric_nocopy( Matrix<ElemT,SizeN,SizeN> & A, Vector<ElemT,SizeN> & B ) {
+    for ( size_t i=0; i<SizeN; ++i ) {
+      ElemT diag = A(i,i);
+      for ( size_t k=0; k<i; ++k )
+        diag -= A(k,i) * A(k,i);
+      if ( !( diag > ElemT() ) )
+        vw_throw( ArgumentErr() << "solve_symmetric(): could not solve equation because A is not symmetric positive definite." );
+      A(i,i) = std::sqrt( diag );
+      for ( size_t j=i+1; j<SizeN; ++j ) {
+        ElemT sum = A(i,j);
+        for ( size_t k=0; k<i; ++k )
+          sum -= A(k,i) * A(k,j);
+        A(i,j) = sum / A(i,i);
+      }
+    }
+
+    // Forward and back substitution
+    for ( size_t i=0; i<SizeN; ++i ) {
+      for ( size_t k=0; k<i; ++k )
+        B(i) -= A(k,i) * B(k);
+      B(i) /= A(i,i);
+    }
+    for ( size_t i=SizeN; i-- > 0; ) {
+      for ( size_t k=i+1; k<SizeN; ++k )
+        B(i) -= A(i,k) * B(k);
+      B(i) /= A(i,i);
+    }
+  }
+
   /// Solve the equations X'*A'=B' where A is a symmetric positive definite
   /// matrix, B is a matrix.
   ///  This version of this method will modify A and B.  Upon
@@ -438,6 +473,16 @@ namespace math {
     return result;
   }
 
+  /// The same for a small fixed-size A.
+  template <class ElemT, size_t SizeN>
+  typename boost::enable_if_c< detail::IsSmallSize<SizeN>::value, Vector<ElemT,SizeN> >::type
+  solve_symmetric( Matrix<ElemT,SizeN,SizeN> & A, Vector<ElemT,SizeN> & B ) {
+    Matrix<ElemT,SizeN,SizeN> Abuf = A;
+    Vector<ElemT,SizeN> result = B;
+    solve_symmetric_nocopy(Abuf,result);
+    return result;
+  }
+
   /// Solve the equations AX=B where A is a symmetric positive definite
   /// matrix.  This version of this method will not modify A and B.
   /// The result (X is returned as the return value.
@@ -38,6 +38,8 @@
 #include <boost/mpl/if.hpp>
 #include <boost/utility/result_of.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <stack>
 
 #include <vw/Core/Exception.h>
@@ -2055,6 +2057,115 @@ namespace math {
   }
 
 
+  // *******************************************************************
+  // Small fixed-size products.
+  // *******************************************************************
+
+  // Products of statically-sized matrices and vectors of up to six
+  // rows and columns, such as the blocks of bundle adjustment, are
+  // evaluated at once into a statically-allocated result rather than
+  // an element at a time through the expression templates.  The loop
+  // bounds are constants, so the compiler unrolls them.  Because the
+  // result is a temporary, these products are never aliased, even
+  // under no_tmp().
+  namespace detail {
+    template <size_t N> struct IsSmallSize {
+      static const bool value = ( N > 0 && N <= 6 );
+    };
+
+    // The transposed matrix of a MatrixTranspose, if it is small and
+    // fixed-size.
+    template <class MatrixT> struct SmallMatrix {
+      static const bool value = false;
+    };
+    template <class ElemT, size_t RowsN, size_t ColsN> struct SmallMatrix<Matrix<ElemT,RowsN,ColsN> > {
+      static const bool value = IsSmallSize<RowsN>::value && IsSmallSize<ColsN>::value;
+      typedef ElemT value_type;
+      static const size_t rows = RowsN, cols = ColsN;
+    };
+    template <class ElemT, size_t RowsN, size_t ColsN> struct SmallMatrix<const Matrix<ElemT,RowsN,ColsN> >
+      : public SmallMatrix<Matrix<ElemT,RowsN,ColsN> > {};
+  }
+
+  /// Product of two small fixed-size matrices.
+  template <class ElemT, size_t RowsN, size_t InnerN, size_t ColsN>
+  typename boost::enable_if_c< detail::IsSmallSize<RowsN>::value &&
+                               detail::IsSmallSize<InnerN>::value &&
+                               detail::IsSmallSize<ColsN>::value,
+                               Matrix<ElemT,RowsN,ColsN> >::type
+  inline operator*( Matrix<ElemT,RowsN,InnerN> const& m1, Matrix<ElemT,InnerN,ColsN> const& m2 ) {
+    Matrix<ElemT,RowsN,ColsN> result;
+    for ( size_t i=0; i<RowsN; ++i )
+      for ( size_t j=0; j<ColsN; ++j ) {
+        ElemT sum = m1(i,0) * m2(0,j);
+        for ( size_t k=1; k<InnerN; ++k )
+          sum += m1(i,k) * m2(k,j);
+        result(i,j) = sum;
+      }
+    return result;
+  }
+
+  /// Product of a transposed small fixed-size matrix and a matrix.
+  template <class MatrixT, size_t ColsN>
+  typename boost::enable_if_c< detail::SmallMatrix<MatrixT>::value &&
+                               detail::IsSmallSize<ColsN>::value,
+                               Matrix<typename detail::SmallMatrix<MatrixT>::value_type,
+                                      detail::SmallMatrix<MatrixT>::cols, ColsN> >::type
+  inline operator*( MatrixTranspose<MatrixT> const& m1,
+                    Matrix<typename detail::SmallMatrix<MatrixT>::value_type,
+                           detail::SmallMatrix<MatrixT>::rows, ColsN> const& m2 ) {
+    typedef typename detail::SmallMatrix<MatrixT>::value_type value_type;
+    const size_t RowsN = detail::SmallMatrix<MatrixT>::cols, InnerN = detail::SmallMatrix<MatrixT>::rows;
+    MatrixT const& m = m1.child();
+    Matrix<value_type,RowsN,ColsN> result;
+    for ( size_t i=0; i<RowsN; ++i )
+      for ( size_t j=0; j<ColsN; ++j ) {
+        value_type sum = m(0,i) * m2(0,j);
+        for ( size_t k=1; k<InnerN; ++k )
+          sum += m(k,i) * m2(k,j);
+        result(i,j) = sum;
+      }
+    return result;
+  }
+
+  /// Product of a small fixed-size matrix and a vector.
+  template <class ElemT, size_t RowsN, size_t ColsN>
+  typename boost::enable_if_c< detail::IsSmallSize<RowsN>::value &&
+                               detail::IsSmallSize<ColsN>::value,
+                               Vector<ElemT,RowsN> >::type
+  inline operator*( Matrix<ElemT,RowsN,ColsN> const& m, Vector<ElemT,ColsN> const& v ) {
+    Vector<ElemT,RowsN> result;
+    for ( size_t i=0; i<RowsN; ++i ) {
+      ElemT sum = m(i,0) * v(0);
+      for ( size_t k=1; k<ColsN; ++k )
+        sum += m(i,k) * v(k);
+      result(i) = sum;
+    }
+    return result;
+  }
+
+  /// Product of a transposed small fixed-size matrix and a vector.
+  template <class MatrixT>
+  typename boost::enable_if_c< detail::SmallMatrix<MatrixT>::value,
+                               Vector<typename detail::SmallMatrix<MatrixT>::value_type,
+                                      detail::SmallMatrix<MatrixT>::cols> >::type
+  inline operator*( MatrixTranspose<MatrixT> const& m1,
+                    Vector<typename detail::SmallMatrix<MatrixT>::value_type,
+                           detail::SmallMatrix<MatrixT>::rows> const& v ) {
+    typedef typename detail::SmallMatrix<MatrixT>::value_type value_type;
+    const size_t RowsN = detail::SmallMatrix<MatrixT>::cols, InnerN = detail::SmallMatrix<MatrixT>::rows;
+    MatrixT const& m = m1.child();
+    Vector<value_type,RowsN> result;
+    for ( size_t i=0; i<RowsN; ++i ) {
+      value_type sum = m(0,i) * v(0);
+      for ( size_t k=1; k<InnerN; ++k )
+        sum += m(k,i) * v(k);
+      result(i) = sum;
+    }
+    return result;
+  }
+
+
   // *******************************************************************
   // Convenience functions for returning a pre-made identity matrix in
   // one line of code.
@@ -2129,6 +2240,47 @@ namespace math {
     return result;
   }
 
+  /// Inversion of a small fixed-size matrix, by Gauss-Jordan
+  /// elimination with partial pivoting in place of the LU
+  /// decomposition below, needing no dynamic allocation.
+  template <class ElemT, size_t SizeN>
+  typename boost::enable_if_c< detail::IsSmallSize<SizeN>::value, Matrix<ElemT,SizeN,SizeN> >::type
+  inline inverse( Matrix<ElemT,SizeN,SizeN> const& m ) {
+    Matrix<ElemT,SizeN,SizeN> buf = m, inverse;
+    inverse.set_identity();
+
+    for ( size_t i=0; i<SizeN; ++i ) {
+      size_t pivot = i;
+      for ( size_t k=i+1; k<SizeN; ++k )
+        if ( std::abs(buf(k,i)) > std::abs(buf(pivot,i)) )
+          pivot = k;
+      if ( buf(pivot,i) == ElemT() )
+        vw_throw( MathErr() << "Matrix is singular in inverse()" );
+      if ( pivot != i )
+        for ( size_t j=0; j<SizeN; ++j ) {
+          std::swap( buf(i,j), buf(pivot,j) );
+          std::swap( inverse(i,j), inverse(pivot,j) );
+        }
+
+      const ElemT scale = ElemT(1) / buf(i,i);
+      for ( size_t j=0; j<SizeN; ++j ) {
+        buf(i,j) *= scale;
+        inverse(i,j) *= scale;
+      }
+      for ( size_t k=0; k<SizeN; ++k ) {
+        if ( k == i ) continue;
+        const ElemT t = buf(k,i);
+        if ( t == ElemT() ) continue;
+        for ( size_t j=0; j<SizeN; ++j ) {
+          buf(k,j) -= t * buf(i,j);
+          inverse(k,j) -= t * inverse(i,j);
+        }
+      }
+    }
+
+    return inverse;
+  }
+
   /// Matrix inversion
   template <class MatrixT>
   inline Matrix<typename MatrixT::value_type> inverse( MatrixBase<MatrixT> const& m ) {
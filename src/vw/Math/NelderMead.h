@@ -12,14 +12,22 @@
 /// Based on Chapter 13, Section 13.1 of "The Nature of Mathematical
 /// Modelling" by Neal Gershenfeld with some inspiration from
 /// Numerical Recipes.
+///
+/// The objective is evaluated one point at a time, except where a
+/// step needs several independent points: the vertices of the initial
+/// simplex, and those of a shrink.  Given num_threads other than one,
+/// those are evaluated in parallel, so the objective must then be safe
+/// to call concurrently.
 
 #ifndef __VW_MATH_NELDER_MEAD_H__
 #define __VW_MATH_NELDER_MEAD_H__
 
 #include <list>
+#include <vector>
 
 // Vision workbench
 #include <vw/Math/Vector.h>
+#include <vw/Math/ParallelEvaluate.h>
 #include <vw/Core/Exception.h>
 #include <vw/Core/Log.h>
 
@@ -39,6 +47,7 @@ namespace math {
     typedef typename std::list<vertex_type>::iterator vertex_iterator;
 
     FuncT m_func;
+    size_t m_num_threads;
     std::list<vertex_type> m_vertices;
 
     // Insert a new vertex into the list while maintaining the
@@ -74,8 +83,11 @@ namespace math {
 
 
   public:
+    /// The initial vertices are evaluated on num_threads threads (the
+    /// default number if zero), as are those of a shrink.
     template <class ScaleT>
-    Simplex(FuncT const& func, DomainT const seed, ScaleT const& scales) : m_func(func) {
+    Simplex(FuncT const& func, DomainT const seed, ScaleT const& scales, size_t num_threads = 1)
+      : m_func(func), m_num_threads(num_threads) {
 
       VW_ASSERT(scales.size() == seed.size(),
                 ArgumentErr() << "NelderMeadMinimizer: the number of scales does not match the dimensionality of the data in the seed vector.");
@@ -84,13 +96,15 @@ namespace math {
       // other vertices are chosen by picking points in each of the
       // standard unit vector directions.  The distance in each
       // direction is determined by the scale variable.
-      m_vertices.push_front( vertex_type(seed, m_func(seed)) );
-
-      for (unsigned i=0; i < seed.size(); ++i) {
-        DomainT vertex = seed;
-        vertex[i] += scales[i];
-        insert_vertex( vertex_type(vertex, m_func(vertex)) );
-      }
+      std::vector<DomainT> vertices(seed.size() + 1, seed);
+      for (unsigned i=0; i < seed.size(); ++i)
+        vertices[i+1][i] += scales[i];
+
+      std::vector<double> values;
+      parallel_evaluate(m_func, vertices, values, m_num_threads);
+      m_vertices.push_front( vertex_type(vertices[0], values[0]) );
+      for (unsigned i=1; i < vertices.size(); ++i)
+        insert_vertex( vertex_type(vertices[i], values[i]) );
     }
 
     // Print out the current set of simplex vertices along with the
@@ -153,19 +167,23 @@ namespace math {
       // in the simplex (the best point stays in the same
       // place). (shrink all)
       if (new_val > highest_vertex().second) {
-        new_loc = 0.5 * (highest_vtx.first + lowest_vtx.first);
-        new_val = m_func(new_loc);
-
-        vertex_iterator iter = m_vertices.begin();
-        while(iter != m_vertices.end()) {
-          // Omit the last position
-          vertex_iterator next_iter = iter;
-          if (++next_iter != m_vertices.end()) {
-            (*iter).first = 0.5 * ((*iter).first + lowest_vtx.first);
-            (*iter).second = m_func((*iter).first);
+        // The moved vertex first, then the others but the last
+        std::vector<DomainT> locations(1, 0.5 * (highest_vtx.first + lowest_vtx.first));
+        for (vertex_iterator iter = m_vertices.begin(); iter != m_vertices.end(); ++iter)
+          if (&*iter != &lowest_vtx)
+            locations.push_back( 0.5 * ((*iter).first + lowest_vtx.first) );
+
+        std::vector<double> values;
+        parallel_evaluate(m_func, locations, values, m_num_threads);
+        new_loc = locations[0];
+        new_val = values[0];
+
+        size_t k = 1;
+        for (vertex_iterator iter = m_vertices.begin(); iter != m_vertices.end(); ++iter)
+          if (&*iter != &lowest_vtx) {
+            (*iter).first = locations[k];
+            (*iter).second = values[k++];
           }
-          ++iter;
-        }
       }
 
       // Finally, add in the moved vertex back into the simplex.
@@ -179,7 +197,8 @@ namespace math {
   template <class FuncT, class DomainT, class ScaleT>
   DomainT nelder_mead( FuncT const& func, DomainT const& seed, ScaleT const& scale,
                        int &status, bool verbose = false, int restarts = 1,
-                       double tolerance = 1e-16, int max_iterations = 1000) {
+                       double tolerance = 1e-16, int max_iterations = 1000,
+                       size_t num_threads = 1) {
     DomainT result = seed;
     status = optimization::eNelderMeadConvergedRelTolerance;
 
@@ -194,7 +213,7 @@ namespace math {
     int iterations = 0;
     for (int i=0; i < restarts; ++i) {
       iterations = 0;
-      Simplex<FuncT, DomainT> simplex(func, result, scale);
+      Simplex<FuncT, DomainT> simplex(func, result, scale, num_threads);
 
       // Perform simplex updates until tolerance in reached or
       // max_iterations is reached
@@ -221,10 +240,11 @@ namespace math {
 
   template <class FuncT, class DomainT>
     DomainT nelder_mead( FuncT const& func, DomainT const& seed, int &status, bool verbose = false,
-                       int restarts = 1, double tolerance = 1e-16, int max_iterations = 1000) {
+                       int restarts = 1, double tolerance = 1e-16, int max_iterations = 1000,
+                       size_t num_threads = 1) {
     vw::Vector<double> scale(seed.size());
     fill(scale,1.0);
-    return nelder_mead(func, seed, scale, status, verbose, restarts, tolerance, max_iterations);
+    return nelder_mead(func, seed, scale, status, verbose, restarts, tolerance, max_iterations, num_threads);
   }
 
 }} // namespace vw::math
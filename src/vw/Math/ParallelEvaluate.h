@@ -0,0 +1,75 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file ParallelEvaluate.h
+///
+/// Evaluates an objective function at many independent points at once,
+/// for optimizers such as nelder_mead() and
+/// particle_swarm_optimization() whose objectives are expensive.
+///
+#ifndef __VW_MATH_PARALLEL_EVALUATE_H__
+#define __VW_MATH_PARALLEL_EVALUATE_H__
+
+#include <vector>
+#include <algorithm>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+
+namespace vw {
+namespace math {
+
+  namespace detail {
+    template <class FuncT, class DomainT>
+    class EvaluateTask : public Task, private boost::noncopyable {
+      FuncT const& m_func;
+      std::vector<DomainT> const& m_points;
+      std::vector<double>& m_values;
+      size_t m_begin, m_end;
+    public:
+      EvaluateTask( FuncT const& func, std::vector<DomainT> const& points,
+                    std::vector<double>& values, size_t begin, size_t end ) :
+        m_func(func), m_points(points), m_values(values), m_begin(begin), m_end(end) {}
+
+      void operator()() {
+        for ( size_t k = m_begin; k < m_end; k++ )
+          m_values[k] = m_func( m_points[k] );
+      }
+    };
+  }
+
+  /// Evaluates func at each of points into values, on num_threads
+  /// threads (the default number if num_threads is zero).  With more
+  /// than one thread, func is called concurrently and must be safe to
+  /// call that way.
+  /// Each point is its own task, since the objectives worth spreading
+  /// across threads take far longer than queueing one.
+  template <class FuncT, class DomainT>
+  void parallel_evaluate( FuncT const& func, std::vector<DomainT> const& points,
+                          std::vector<double>& values, size_t num_threads ) {
+    values.resize( points.size() );
+    const size_t threads = std::min( num_threads ? num_threads : size_t(vw_settings().default_num_threads()),
+                                     points.size() );
+    if ( threads <= 1 ) {
+      detail::EvaluateTask<FuncT, DomainT>( func, points, values, 0, points.size() )();
+      return;
+    }
+
+    FifoWorkQueue queue( threads );
+    for ( size_t k = 0; k < points.size(); k++ ) {
+      boost::shared_ptr<Task> task( new detail::EvaluateTask<FuncT, DomainT>( func, points, values, k, k+1 ) );
+      queue.add_task( task );
+    }
+    queue.join_all();
+  }
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_PARALLEL_EVALUATE_H__
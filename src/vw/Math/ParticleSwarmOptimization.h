@@ -23,6 +23,12 @@
 ///
 /// A number of arithmetic and other operations have to be defined on DomainT,
 /// thus using vectors vw::Vector<double, n> or vw::Vector<double> is recommended.
+///
+/// By default the particles move one at a time, each seeing the global
+/// minimum found by those before it.  Given num_threads other than one,
+/// the whole swarm moves at once, using the global minimum of the
+/// previous iteration, and the particles are evaluated in parallel, so
+/// the functor must then be safe to call concurrently.
 
 #ifndef __VW_MATH_PARTICLE_SWARM_OPTIMIZATION_H__
 #define __VW_MATH_PARTICLE_SWARM_OPTIMIZATION_H__
@@ -30,6 +36,7 @@
 // Vision Workbench
 #include <vw/Math/Functions.h>
 #include <vw/Math/Vector.h>
+#include <vw/Math/ParallelEvaluate.h>
 #include <vw/Core/Log.h>
 
 namespace vw {
@@ -38,12 +45,17 @@ namespace math {
   DomainT particle_swarm_optimization( FuncT const& func, DomainT const& min, DomainT const& max,
                                        bool verbose = false, int restarts = 1,
                                        unsigned int n_particles = 100,  unsigned int n_iter = 1000,
-                                       double w = 0.9, double c1 = 2, double c2 = 2, double v_max = 4.0)
+                                       double w = 0.9, double c1 = 2, double c2 = 2, double v_max = 4.0,
+                                       size_t num_threads = 1)
   {
     std::vector<DomainT> x;        x.resize(n_particles);         // particles
     std::vector<DomainT> x_hat;    x_hat.resize(n_particles);     // local maxima
     std::vector<double> x_hat_val; x_hat_val.resize(n_particles); // local maxima values
     std::vector<DomainT> v;        v.resize(n_particles);         // velocities
+    std::vector<double> x_val;     x_val.resize(n_particles);     // particle values
+
+    // The particles moved between evaluations
+    const size_t batch = num_threads == 1 ? 1 : x.size();
 
     std::srand(std::time(0)); // seed random number generator
 
@@ -66,16 +78,15 @@ namespace math {
             x_hat[i](j) = x[i](j);
             v[i](j) = 0;
         }
-
-        x_hat_val[i] = func(x_hat[i]);
       }
+      parallel_evaluate(func, x_hat, x_hat_val, num_threads);
 
       if (verbose) VW_OUT(vw::VerboseDebugMessage, "math") << "PSO run " << start+1 << "/" << restarts << " initialized particles" << std::endl;
 
       // search globally minimum particle
       for (unsigned int i = 0; i < x.size(); i++) {
-        if (double d = func(x[i]) < g_hat_val) {
-          g_hat_val = d;
+        if (x_hat_val[i] < g_hat_val) {
+          g_hat_val = x_hat_val[i];
           g_hat = x[i];
         }
       }
@@ -91,38 +102,49 @@ namespace math {
       for (unsigned int iter = 0; iter < n_iter; iter++) {
         if (verbose) VW_OUT(vw::VerboseDebugMessage, "math") << "PSO run " << start << "/" << restarts << " iteration " << iter << "/" << n_iter << std::endl;
 
-        // update all particles
-        for (unsigned int i = 0; i < x.size(); i++) {
-          // initialize random vectors
-          for (unsigned int j = 0; j < r1.size(); j++) {
-            r1(j) = static_cast<double>(rand())/RAND_MAX;
-            r2(j) = static_cast<double>(rand())/RAND_MAX;
+        // update all particles, a batch at a time
+        for (size_t begin = 0; begin < x.size(); begin += batch) {
+          const size_t end = std::min(begin + batch, x.size());
+          for (size_t i = begin; i < end; i++) {
+            // initialize random vectors
+            for (unsigned int j = 0; j < r1.size(); j++) {
+              r1(j) = static_cast<double>(rand())/RAND_MAX;
+              r2(j) = static_cast<double>(rand())/RAND_MAX;
+            }
+
+            // particle position and velocity update
+            x[i] = x[i] + v[i];
+            v[i] = w*v[i] + c1*elem_prod(r1, x_hat[i] - x[i]) + c2*elem_prod(r2, g_hat - x[i]);
+
+            // enforce maximum velocity
+            double norm = vw::math::norm_2_sqr(v[i]);
+            if (norm > v_max*v_max)
+              v[i] /= vw::sqrt(norm);
+
+            if (verbose) VW_OUT(vw::VerboseDebugMessage, "math") << "PSO x = " << x[i] << " with velocity v = " << v[i] << std::endl;
           }
 
-          // particle position and velocity update
-          x[i] = x[i] + v[i];
-          v[i] = w*v[i] + c1*elem_prod(r1, x_hat[i] - x[i]) + c2*elem_prod(r2, g_hat - x[i]);
-
-          // enforce maximum velocity
-          double norm = vw::math::norm_2_sqr(v[i]);
-          if (norm > v_max*v_max)
-            v[i] /= vw::sqrt(norm);
-
-          if (verbose) VW_OUT(vw::VerboseDebugMessage, "math") << "PSO x = " << x[i] << " with velocity v = " << v[i] << std::endl;
-
-          // update local maximum
-          double x_i_val = func(x[i]);
-          if (x_i_val < x_hat_val[i]) {
-            if (verbose) VW_OUT(vw::VerboseDebugMessage, "math") << "PSO run " << start+1 << "/" << restarts << " iteration " << iter << "/" << n_iter << " new local minimum " << x_i_val << std::endl;
-            x_hat[i] = x[i];
-            x_hat_val[i] = x_i_val;
+          if (batch == 1) {
+            x_val[begin] = func(x[begin]);
+          } else {
+            parallel_evaluate(func, x, x_val, num_threads);
           }
 
-          // update global maximum
-          if (x_i_val < g_hat_val) {
-            if (verbose) VW_OUT(vw::VerboseDebugMessage, "math") << "PSO run " << start+1 << "/" << restarts << " iteration " << iter << "/" << n_iter << " new global minimum " << x_i_val << std::endl;
-            g_hat = x[i];
-            g_hat_val = x_i_val;
+          for (size_t i = begin; i < end; i++) {
+            // update local maximum
+            double x_i_val = x_val[i];
+            if (x_i_val < x_hat_val[i]) {
+              if (verbose) VW_OUT(vw::VerboseDebugMessage, "math") << "PSO run " << start+1 << "/" << restarts << " iteration " << iter << "/" << n_iter << " new local minimum " << x_i_val << std::endl;
+              x_hat[i] = x[i];
+              x_hat_val[i] = x_i_val;
+            }
+
+            // update global maximum
+            if (x_i_val < g_hat_val) {
+              if (verbose) VW_OUT(vw::VerboseDebugMessage, "math") << "PSO run " << start+1 << "/" << restarts << " iteration " << iter << "/" << n_iter << " new global minimum " << x_i_val << std::endl;
+              g_hat = x[i];
+              g_hat_val = x_i_val;
+            }
           }
         }
       }
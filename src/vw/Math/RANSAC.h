@@ -39,12 +39,29 @@
 ///    set of points, this routine could compute the 2-norm of the
 ///    error: || p2 - H * p1 ||
 ///
+/// By default the hypotheses are tried one after another, a fixed
+/// number of them.  RandomSampleConsensus can also spread them over
+/// several threads, stop once the best fit is very probably found,
+/// reject a hypothesis after checking a few points, and draw its
+/// samples from the best matches first (PROSAC).  See its setters.
+///
 
 #ifndef __VW_MATH_RANSAC_H__
 #define __VW_MATH_RANSAC_H__
 
 #include <vw/Math/Vector.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <boost/random/linear_congruential.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
 
 namespace vw {
 namespace math {
@@ -101,6 +118,9 @@ namespace math {
     const FittingFuncT& m_fitting_func;
     const ErrorFuncT& m_error_func;
     double m_inlier_threshold;
+    size_t m_num_threads, m_preemptive_points;
+    double m_confidence;
+    bool m_guided_sampling;
 
     // Returns the number of inliers for a given threshold.
     template <class ContainerT1, class ContainerT2>
@@ -115,23 +135,175 @@ namespace math {
       return result;
     }
 
-    /// \cond INTERNAL
-    // Utility Function: Pick N UNIQUE, random integers in the range [0, size]
-    inline void _vw_get_n_unique_integers(size_t size, size_t n, int* samples) const {
-      VW_ASSERT(size >= n, ArgumentErr() << "Not enough samples (" << n << " / " << size << ")\n");
-
-      for (size_t i=0; i<n; ++i) {
-        bool done = false;
-        while (!done) {
-          samples[i] = int( (double(std::rand()) / double(RAND_MAX)) * size );
-          done = true;
-          for (size_t j = 0; j < i; j++)
-            if (samples[i] == samples[j])
-              done = false;
+
+    // The hypotheses being tried, which any number of workers take in
+    // turn.  The best fit so far, and the number of hypotheses that
+    // will be tried, change as they finish.
+    template <class ContainerT1, class ContainerT2>
+    class Search : private boost::noncopyable {
+      typedef typename FittingFuncT::result_type result_type;
+      RandomSampleConsensus const& m_ransac;
+      std::vector<ContainerT1> const& m_p1;
+      std::vector<ContainerT2> const& m_p2;
+      size_t m_sample_size, m_limit, m_max_limit, m_next;
+      // For guided sampling, the hypothesis by which the samples are
+      // drawn from each number of the best matches.
+      std::vector<double> m_pool_schedule;
+      Mutex m_mutex;
+      std::string m_error;
+
+      // Draws count unique integers in [0, range) into samples, from
+      // offset on.
+      static void draw_unique( boost::rand48& gen, size_t range, size_t count,
+                               std::vector<size_t>& samples, size_t offset ) {
+        for ( size_t i = offset; i < offset + count; ++i ) {
+          bool done = false;
+          while ( !done ) {
+            samples[i] = size_t( gen() ) % range;
+            done = true;
+            for ( size_t j = offset; j < i; ++j )
+              if ( samples[i] == samples[j] )
+                done = false;
+          }
+        }
+      }
+
+      // With guided sampling, the t'th sample is the newest of the
+      // matches in the pool and the rest from the matches before it;
+      // the pool grows until it holds every match (Chum and Matas,
+      // "Matching with PROSAC", 2005).
+      void draw_sample( size_t t, boost::rand48& gen, std::vector<size_t>& samples ) const {
+        const size_t n = m_sample_size, total = m_p1.size();
+        size_t pool = total;
+        if ( !m_pool_schedule.empty() )
+          pool = n + size_t( std::lower_bound( m_pool_schedule.begin(), m_pool_schedule.end(),
+                                               double(t + 1) ) - m_pool_schedule.begin() );
+        if ( pool < total ) {
+          samples[0] = pool - 1;
+          draw_unique( gen, pool - 1, n - 1, samples, 1 );
+        } else {
+          draw_unique( gen, total, n, samples, 0 );
+        }
+      }
+
+      // The T(d,d) test: d random points must all be inliers before
+      // every point is checked.
+      bool passes_preemptive_test( result_type const& H, boost::rand48& gen ) const {
+        for ( size_t i = 0; i < m_ransac.m_preemptive_points; ++i ) {
+          size_t k = size_t( gen() ) % m_p1.size();
+          if ( !( m_ransac.m_error_func( H, m_p1[k], m_p2[k] ) < m_ransac.m_inlier_threshold ) )
+            return false;
+        }
+        return true;
+      }
+
+    public:
+      uint32 inliers_max;
+      result_type H_max;
+
+      Search( RandomSampleConsensus const& ransac, std::vector<ContainerT1> const& p1,
+              std::vector<ContainerT2> const& p2, size_t iterations ) :
+        m_ransac(ransac), m_p1(p1), m_p2(p2),
+        m_sample_size(ransac.m_fitting_func.min_elements_needed_for_fit(p1[0])),
+        m_limit(iterations), m_max_limit(iterations), m_next(0), inliers_max(0) {
+        if ( m_ransac.m_guided_sampling && p1.size() > m_sample_size ) {
+          // T_n is the expected number of the samples, of iterations
+          // drawn uniformly from all the matches, that lie among the
+          // best n; each new match is added once that many are drawn.
+          const size_t n = m_sample_size, total = p1.size();
+          double t_n = double(iterations);
+          for ( size_t i = 0; i < n; ++i )
+            t_n *= double(n - i) / double(total - i);
+          m_pool_schedule.resize( total - n );
+          double t_prime = 1;
+          for ( size_t pool = n; pool < total; ++pool ) {
+            m_pool_schedule[pool - n] = t_prime;
+            double t_next = t_n * double(pool + 1) / double(pool + 1 - n);
+            t_prime += std::ceil( t_next - t_n );
+            t_n = t_next;
+          }
+        }
+      }
+
+      // Tries hypotheses until there are no more to try.
+      void run( uint32 seed ) {
+        boost::rand48 gen( seed );
+        const size_t n = m_sample_size;
+        std::vector<ContainerT1> try1(n);
+        std::vector<ContainerT2> try2(n);
+        std::vector<size_t> samples(n);
+        while ( true ) {
+          size_t t;
+          {
+            Mutex::Lock lock( m_mutex );
+            if ( m_next >= m_limit )
+              return;
+            t = m_next++;
+          }
+          draw_sample( t, gen, samples );
+          for ( size_t i = 0; i < n; ++i ) {
+            try1[i] = m_p1[samples[i]];
+            try2[i] = m_p2[samples[i]];
+          }
+
+          // Compute the fit using these samples, and its consensus
+          result_type H = m_ransac.m_fitting_func(try1, try2);
+          if ( !passes_preemptive_test( H, gen ) )
+            continue;
+          unsigned n_inliers = m_ransac.num_inliers(H, m_p1, m_p2);
+
+          // Keep best consensus
+          Mutex::Lock lock( m_mutex );
+          if ( n_inliers > inliers_max ) {
+            inliers_max = n_inliers;
+            H_max = H;
+            update_limit();
+          }
         }
       }
-    }
-    /// \endcond
+
+      // With a confidence set, as few hypotheses are tried as make it
+      // that likely that one was drawn from the inliers of the best
+      // fit alone (and passed the preemptive test).
+      void update_limit() {
+        if ( m_ransac.m_confidence <= 0 )
+          return;
+        const double w = double(inliers_max) / double(m_p1.size());
+        const double good = std::pow( w, double(m_sample_size + m_ransac.m_preemptive_points) );
+        if ( good >= 1 ) {
+          m_limit = m_next;
+        } else if ( good > 0 ) {
+          double k = std::ceil( std::log( 1 - m_ransac.m_confidence ) / std::log( 1 - good ) );
+          if ( k < double(m_max_limit) )
+            m_limit = std::min( m_limit, size_t(k) );
+        }
+      }
+
+      // Stops the search, keeping the reason to report.
+      void abort( std::string const& error ) {
+        Mutex::Lock lock( m_mutex );
+        if ( m_error.empty() )
+          m_error = error;
+        m_limit = 0;
+      }
+      std::string const& error() const { return m_error; }
+      size_t tried() const { return std::min( m_next, m_limit ); }
+    };
+
+    template <class ContainerT1, class ContainerT2>
+    class SearchTask : public Task, private boost::noncopyable {
+      Search<ContainerT1, ContainerT2>& m_search;
+      uint32 m_seed;
+    public:
+      SearchTask( Search<ContainerT1, ContainerT2>& search, uint32 seed ) : m_search(search), m_seed(seed) {}
+      void operator()() {
+        try {
+          m_search.run( m_seed );
+        } catch ( std::exception const& e ) {
+          m_search.abort( e.what() );
+        }
+      }
+    };
 
   public:
 
@@ -164,7 +336,35 @@ namespace math {
     }
 
     RandomSampleConsensus(FittingFuncT const& fitting_func, ErrorFuncT const& error_func, double inlier_threshold)
-      : m_fitting_func(fitting_func), m_error_func(error_func), m_inlier_threshold(inlier_threshold) {}
+      : m_fitting_func(fitting_func), m_error_func(error_func), m_inlier_threshold(inlier_threshold),
+        m_num_threads(1), m_preemptive_points(0), m_confidence(0), m_guided_sampling(false) {}
+
+    /// Spreads the hypotheses over this many threads, or the default
+    /// number of threads if zero.  The fitting and error functors are
+    /// then called from several threads at once, and must allow it.
+    void set_num_threads(size_t threads) { m_num_threads = threads; }
+
+    /// Stops once a hypothesis drawn from the inliers of the best fit
+    /// so far would have been tried with this probability, 0.99 say.
+    /// The number of iterations is then only a limit.  Zero, the
+    /// default, tries them all.
+    void set_confidence(double confidence) {
+      VW_ASSERT( confidence >= 0 && confidence < 1,
+                 ArgumentErr() << "RANSAC: confidence must be in [0,1)." );
+      m_confidence = confidence;
+    }
+
+    /// Checks each hypothesis against this many random points before
+    /// counting all its inliers, and rejects it if any of them is an
+    /// outlier (the T(d,d) test of Matas and Chum, "Randomized RANSAC
+    /// with T(d,d) test", 2002).  One is usually best.  Zero, the
+    /// default, counts the inliers of every hypothesis.
+    void set_preemptive_test(size_t points) { m_preemptive_points = points; }
+
+    /// Draws the first samples from the best matches, and then from
+    /// more and more of them (PROSAC).  p1 and p2 must be ordered best
+    /// match first, as match_interest_points() returns them.
+    void set_guided_sampling(bool guided) { m_guided_sampling = guided; }
 
     template <class ContainerT1, class ContainerT2>
     typename FittingFuncT::result_type operator()(std::vector<ContainerT1> const& p1,
@@ -178,9 +378,7 @@ namespace math {
       VW_ASSERT( p1.size() >= m_fitting_func.min_elements_needed_for_fit(p1[0]),
                  RANSACErr() << "RANSAC Error.  Not enough potential matches for this fitting funtor. ("<<p1.size() << "/" << m_fitting_func.min_elements_needed_for_fit(p1[0]) << ")\n");
 
-      uint32 inliers_max = 0;
       typename FittingFuncT::result_type H;
-      typename FittingFuncT::result_type H_max;
 
       /////////////////////////////////////////
       // First part:
@@ -200,30 +398,25 @@ namespace math {
       size_t n = m_fitting_func.min_elements_needed_for_fit(p1[0]);
       std::vector<ContainerT1> try1(n);
       std::vector<ContainerT2> try2(n);
-      boost::scoped_array<int32> random_indices(new int32[n]);
-
-      for (int32 iteration=0; iteration < ransac_iterations; ++iteration) {
-        // Get four points at random, taking care not
-        // to select the same point twice.
-        _vw_get_n_unique_integers(p1.size(), n, random_indices.get());
-
-        for (size_t i=0; i < n; ++i) {
-          try1[i] = p1[random_indices[i]];
-          try2[i] = p2[random_indices[i]];
-        }
-
-        // Compute the fit using these samples
-        H = m_fitting_func(try1, try2);
-
-        // Compute consensuss
-        unsigned n_inliers = num_inliers(H, p1, p2);
 
-        // Keep best consensus
-        if (n_inliers > inliers_max) {
-          inliers_max = n_inliers;
-          H_max = H;
+      Search<ContainerT1, ContainerT2> search( *this, p1, p2, ransac_iterations );
+      const size_t threads = m_num_threads ? m_num_threads : vw_settings().default_num_threads();
+      if ( threads <= 1 ) {
+        search.run( std::rand() );
+      } else {
+        FifoWorkQueue queue( threads );
+        for ( size_t i = 0; i < threads; ++i ) {
+          boost::shared_ptr<Task> task( new SearchTask<ContainerT1, ContainerT2>( search, std::rand() ) );
+          queue.add_task( task );
         }
+        queue.join_all();
+        if ( !search.error().empty() )
+          vw_throw( RANSACErr() << "RANSAC fitting failed: " << search.error() );
       }
+      uint32 inliers_max = search.inliers_max;
+      typename FittingFuncT::result_type const& H_max = search.H_max;
+      VW_OUT(DebugMessage, "interest_point") << "RANSAC tried " << search.tried() << " of "
+                                             << ransac_iterations << " hypotheses.\n";
 
       if (inliers_max < m_fitting_func.min_elements_needed_for_fit(p1[0])) {
         vw_throw( RANSACErr() << "RANSAC was unable to find a fit that matched the supplied data." );
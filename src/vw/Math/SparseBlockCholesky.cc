@@ -0,0 +1,250 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Math/SparseBlockCholesky.h>
+
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/minimum_degree_ordering.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+namespace vw {
+namespace math {
+
+  namespace {
+    const size_t none = size_t(-1);
+  }
+
+  void SparseBlockCholesky::analyze( size_t block_size,
+                                     std::vector<std::vector<size_t> > const& lower_pattern ) {
+    VW_ASSERT( block_size > 0, ArgumentErr() << "SparseBlockCholesky: blocks must have a size." );
+    m_block_size = block_size;
+    const size_t n = lower_pattern.size();
+
+    // The graph of the blocks, with each edge once.
+    std::vector<std::set<size_t> > adjacent( n );
+    for ( size_t j = 0; j < n; j++ )
+      for ( size_t k = 0; k < lower_pattern[j].size(); k++ ) {
+        size_t i = lower_pattern[j][k];
+        VW_ASSERT( i < n && i != j,
+                   ArgumentErr() << "SparseBlockCholesky: block (" << i << "," << j << ") is not below the diagonal." );
+        adjacent[i].insert( j );
+        adjacent[j].insert( i );
+      }
+
+    // Ordering.  The minimum degree ordering wants every edge both
+    // ways, and fails on a complete graph, which any order fills alike.
+    m_ordering.resize( n );
+    m_inverse_ordering.resize( n );
+    size_t edges = 0;
+    for ( size_t j = 0; j < n; j++ )
+      edges += adjacent[j].size();
+    if ( edges == n * (n - 1) ) {
+      for ( size_t j = 0; j < n; j++ )
+        m_ordering[j] = m_inverse_ordering[j] = j;
+    } else {
+      typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::directedS> Graph;
+      Graph graph( n );
+      for ( size_t j = 0; j < n; j++ )
+        for ( std::set<size_t>::const_iterator i = adjacent[j].begin(); i != adjacent[j].end(); ++i )
+          boost::add_edge( j, *i, graph );
+      std::vector<int> inverse( n ), ordering( n ), degree( n, 0 ), supernode_sizes( n, 1 );
+      boost::property_map<Graph, boost::vertex_index_t>::type id = boost::get( boost::vertex_index, graph );
+      boost::minimum_degree_ordering( graph,
+                                      boost::make_iterator_property_map( &degree[0], id, degree[0] ),
+                                      &inverse[0], &ordering[0],
+                                      boost::make_iterator_property_map( &supernode_sizes[0], id, supernode_sizes[0] ),
+                                      0, id );
+      std::copy( ordering.begin(), ordering.end(), m_ordering.begin() );
+      std::copy( inverse.begin(), inverse.end(), m_inverse_ordering.begin() );
+    }
+
+    // The pattern of the factor, by columns of the reordered matrix.
+    // Column j has the rows of its own in the matrix, and those of its
+    // children in the elimination tree but for itself.
+    std::vector<std::vector<size_t> > structure( n ), children( n );
+    std::vector<size_t> parent( n, none );
+    for ( size_t j = 0; j < n; j++ ) {
+      std::vector<size_t>& rows = structure[j];
+      std::set<size_t> const& original = adjacent[m_ordering[j]];
+      for ( std::set<size_t>::const_iterator i = original.begin(); i != original.end(); ++i )
+        if ( m_inverse_ordering[*i] > j )
+          rows.push_back( m_inverse_ordering[*i] );
+      for ( size_t c = 0; c < children[j].size(); c++ ) {
+        std::vector<size_t> const& child = structure[children[j][c]];
+        for ( size_t k = 0; k < child.size(); k++ )
+          if ( child[k] != j )
+            rows.push_back( child[k] );
+      }
+      std::sort( rows.begin(), rows.end() );
+      rows.erase( std::unique( rows.begin(), rows.end() ), rows.end() );
+      if ( !rows.empty() ) {
+        parent[j] = rows.front();
+        children[rows.front()].push_back( j );
+      }
+    }
+
+    // Fundamental supernodes: a column joins the one before when it is
+    // that column's only parent and has that column's rows less itself.
+    m_first.clear();
+    m_rows.clear();
+    m_block_supernode.resize( n );
+    for ( size_t j = 0; j < n; j++ ) {
+      bool joins = j > 0 && parent[j-1] == j && children[j].size() == 1 &&
+        structure[j-1].size() == structure[j].size() + 1;
+      if ( !joins ) {
+        if ( !m_first.empty() )
+          m_rows.push_back( structure[j-1] );
+        m_first.push_back( j );
+      }
+      m_block_supernode[j] = m_first.size() - 1;
+      if ( j > 0 )
+        std::vector<size_t>().swap( structure[j-1] );
+    }
+    if ( n > 0 )
+      m_rows.push_back( structure[n-1] );
+    m_first.push_back( n );
+
+    m_offset.resize( num_supernodes() + 1 );
+    m_offset[0] = 0;
+    for ( size_t s = 0; s < num_supernodes(); s++ )
+      m_offset[s+1] = m_offset[s] + panel_rows(s) * panel_width(s);
+    m_values.assign( m_offset.back(), 0.0 );
+  }
+
+  size_t SparseBlockCholesky::factor_blocks() const {
+    size_t count = 0;
+    for ( size_t s = 0; s < num_supernodes(); s++ ) {
+      size_t width = m_first[s+1] - m_first[s];
+      count += width * (width + 1) / 2 + width * m_rows[s].size();
+    }
+    return count;
+  }
+
+  void SparseBlockCholesky::clear() {
+    std::fill( m_values.begin(), m_values.end(), 0.0 );
+  }
+
+  double* SparseBlockCholesky::block( size_t i, size_t j, size_t& stride ) {
+    size_t s = m_block_supernode[j];
+    size_t row;
+    if ( i < m_first[s+1] ) {
+      row = i - m_first[s];
+    } else {
+      std::vector<size_t>::const_iterator it =
+        std::lower_bound( m_rows[s].begin(), m_rows[s].end(), i );
+      VW_ASSERT( it != m_rows[s].end() && *it == i,
+                 ArgumentErr() << "SparseBlockCholesky: block (" << m_ordering[i] << ","
+                 << m_ordering[j] << ") is not in the pattern." );
+      row = m_first[s+1] - m_first[s] + ( it - m_rows[s].begin() );
+    }
+    stride = panel_rows(s);
+    return &m_values[ m_offset[s] + ( j - m_first[s] ) * m_block_size * stride + row * m_block_size ];
+  }
+
+  bool SparseBlockCholesky::factor() {
+    const size_t bs = m_block_size;
+    for ( size_t s = 0; s < num_supernodes(); s++ ) {
+      double* panel = &m_values[m_offset[s]];
+      const size_t ld = panel_rows(s), width = panel_width(s);
+
+      // Factor the panel column by column; each column is the whole
+      // height of the panel, the diagonal block and the rows below it.
+      for ( size_t k = 0; k < width; k++ ) {
+        double* column = panel + k*ld;
+        for ( size_t m = 0; m < k; m++ ) {
+          double const* prior = panel + m*ld;
+          const double f = prior[k];
+          if ( f != 0 )
+            for ( size_t r = k; r < ld; r++ )
+              column[r] -= prior[r] * f;
+        }
+        if ( !( column[k] > 0 ) )
+          return false;
+        const double d = std::sqrt( column[k] );
+        column[k] = d;
+        for ( size_t r = k+1; r < ld; r++ )
+          column[r] /= d;
+      }
+
+      // Subtract the product of the rows below the diagonal block and
+      // their transpose from the supernodes those rows belong to.
+      std::vector<size_t> const& rows = m_rows[s];
+      for ( size_t bj = 0; bj < rows.size(); bj++ ) {
+        for ( size_t bi = bj; bi < rows.size(); bi++ ) {
+          size_t stride;
+          double* target = block( rows[bi], rows[bj], stride );
+          for ( size_t c = 0; c < bs; c++ ) {
+            double* dst = target + c*stride;
+            for ( size_t m = 0; m < width; m++ ) {
+              double const* src = panel + m*ld + width;
+              const double f = src[bj*bs + c];
+              if ( f == 0 )
+                continue;
+              src += bi*bs;
+              for ( size_t r = 0; r < bs; r++ )
+                dst[r] -= src[r] * f;
+            }
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  Vector<double> SparseBlockCholesky::solve( Vector<double> const& b ) const {
+    VW_ASSERT( b.size() == rows(), ArgumentErr() << "SparseBlockCholesky: the vector must have "
+               << rows() << " elements." );
+    const size_t bs = m_block_size;
+    Vector<double> y( rows() );
+    for ( size_t j = 0; j < num_blocks(); j++ )
+      for ( size_t r = 0; r < bs; r++ )
+        y[j*bs + r] = b[m_ordering[j]*bs + r];
+
+    // Forward substitution, L y' = y
+    for ( size_t s = 0; s < num_supernodes(); s++ ) {
+      double const* panel = &m_values[m_offset[s]];
+      const size_t ld = panel_rows(s), width = panel_width(s), first = m_first[s]*bs;
+      std::vector<size_t> const& rows = m_rows[s];
+      for ( size_t k = 0; k < width; k++ ) {
+        double const* column = panel + k*ld;
+        const double yk = y[first + k] /= column[k];
+        for ( size_t r = k+1; r < width; r++ )
+          y[first + r] -= column[r] * yk;
+        for ( size_t bi = 0; bi < rows.size(); bi++ )
+          for ( size_t r = 0; r < bs; r++ )
+            y[rows[bi]*bs + r] -= column[width + bi*bs + r] * yk;
+      }
+    }
+
+    // Back substitution, L^T x = y'
+    for ( size_t s = num_supernodes(); s-- > 0; ) {
+      double const* panel = &m_values[m_offset[s]];
+      const size_t ld = panel_rows(s), width = panel_width(s), first = m_first[s]*bs;
+      std::vector<size_t> const& rows = m_rows[s];
+      for ( size_t k = width; k-- > 0; ) {
+        double const* column = panel + k*ld;
+        double sum = y[first + k];
+        for ( size_t r = k+1; r < width; r++ )
+          sum -= column[r] * y[first + r];
+        for ( size_t bi = 0; bi < rows.size(); bi++ )
+          for ( size_t r = 0; r < bs; r++ )
+            sum -= column[width + bi*bs + r] * y[rows[bi]*bs + r];
+        y[first + k] = sum / column[k];
+      }
+    }
+
+    Vector<double> x( rows() );
+    for ( size_t j = 0; j < num_blocks(); j++ )
+      for ( size_t r = 0; r < bs; r++ )
+        x[m_ordering[j]*bs + r] = y[j*bs + r];
+    return x;
+  }
+
+}} // namespace vw::math
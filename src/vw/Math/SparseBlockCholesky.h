@@ -0,0 +1,116 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file SparseBlockCholesky.h
+///
+/// A supernodal Cholesky factorization of a sparse symmetric positive
+/// definite matrix made of square blocks of one size, such as the
+/// reduced camera system of bundle adjustment.
+///
+/// analyze() works out everything that depends only on which blocks
+/// are nonzero: a minimum degree ordering of the blocks, the
+/// elimination tree, the pattern of the factor and its supernodes,
+/// runs of columns whose factor shares one pattern.  Each supernode is
+/// kept as one dense column major panel, so factor() works on long
+/// dense columns rather than single elements.  A matrix whose values
+/// change but whose pattern does not, as from one Levenberg-Marquardt
+/// iteration to the next, is analyzed once and factored many times.
+///
+#ifndef __VW_MATH_SPARSE_BLOCK_CHOLESKY_H__
+#define __VW_MATH_SPARSE_BLOCK_CHOLESKY_H__
+
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+
+#include <vector>
+
+namespace vw {
+namespace math {
+
+  class SparseBlockCholesky {
+    size_t m_block_size;
+    std::vector<size_t> m_ordering, m_inverse_ordering;
+
+    // The supernodes, in elimination order.  Supernode s is the
+    // columns of blocks [m_first[s], m_first[s+1]) of the reordered
+    // matrix, and m_rows[s] lists the blocks below them that the
+    // factor has in those columns.
+    std::vector<size_t> m_first, m_block_supernode;
+    std::vector<std::vector<size_t> > m_rows;
+    std::vector<size_t> m_offset;
+    std::vector<double> m_values;
+
+    size_t panel_width( size_t s ) const { return (m_first[s+1] - m_first[s]) * m_block_size; }
+    size_t panel_rows( size_t s ) const { return panel_width(s) + m_rows[s].size() * m_block_size; }
+
+    // The top left element of the block at (i,j), i >= j, of the
+    // reordered matrix, and the distance from one of its columns to
+    // the next.
+    double* block( size_t i, size_t j, size_t& stride );
+
+  public:
+    SparseBlockCholesky() : m_block_size(0) {}
+
+    /// Analyzes the pattern; see analyze().
+    SparseBlockCholesky( size_t block_size, std::vector<std::vector<size_t> > const& lower_pattern ) :
+      m_block_size(0) {
+      analyze( block_size, lower_pattern );
+    }
+
+    /// Works out the ordering and the pattern of the factor of a matrix
+    /// of lower_pattern.size() blocks, each block_size square.
+    /// lower_pattern[j] lists the blocks i > j of block column j that
+    /// are nonzero; the diagonal blocks always are.  Every value is set
+    /// to zero.
+    void analyze( size_t block_size, std::vector<std::vector<size_t> > const& lower_pattern );
+
+    size_t block_size() const { return m_block_size; }
+    size_t num_blocks() const { return m_ordering.size(); }
+    size_t rows() const { return num_blocks() * m_block_size; }
+    size_t cols() const { return rows(); }
+
+    /// The blocks in the order they are eliminated.
+    std::vector<size_t> const& ordering() const { return m_ordering; }
+
+    size_t num_supernodes() const { return m_rows.size(); }
+
+    /// The number of blocks in the lower triangle of the factor,
+    /// diagonal included: those of the matrix and the fill.
+    size_t factor_blocks() const;
+
+    /// Sets every value back to zero, keeping the pattern.
+    void clear();
+
+    /// Sets the block at (i,j), which must be in the pattern.  Only the
+    /// lower triangle of a diagonal block is read.
+    template <class MatrixT>
+    void set_block( size_t i, size_t j, MatrixBase<MatrixT> const& value ) {
+      MatrixT const& m = value.impl();
+      VW_ASSERT( m.rows() == m_block_size && m.cols() == m_block_size,
+                 ArgumentErr() << "SparseBlockCholesky: blocks must be " << m_block_size << " square." );
+      size_t ni = m_inverse_ordering[i], nj = m_inverse_ordering[j];
+      bool transposed = ni < nj;
+      if ( transposed )
+        std::swap( ni, nj );
+      size_t stride;
+      double* dst = block( ni, nj, stride );
+      for ( size_t c = 0; c < m_block_size; c++ )
+        for ( size_t r = 0; r < m_block_size; r++ )
+          dst[c*stride + r] = transposed ? m(c,r) : m(r,c);
+    }
+
+    /// Factors the matrix set, in place of its values.  Returns false,
+    /// leaving the factor incomplete, if it is not positive definite.
+    bool factor();
+
+    /// Solves Ax = b with the factor of A.
+    Vector<double> solve( Vector<double> const& b ) const;
+  };
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_SPARSE_BLOCK_CHOLESKY_H__
@@ -51,3 +51,42 @@ TEST( ConjugateGradient, ConjugateGradient ) {
   EXPECT_NEAR(result[0], 0.1962, 1e-3);
   EXPECT_NEAR(result[1], 0.4846, 1e-3);
 }
+
+// Multiplies by a tridiagonal matrix without forming it.
+struct TridiagonalOperator {
+  Vector<double> operator()( Vector<double> const& x ) const {
+    Vector<double> y( x.size() );
+    for ( size_t i = 0; i < x.size(); i++ ) {
+      y[i] = 4 * (i+1) * x[i];
+      if ( i > 0 ) y[i] -= x[i-1];
+      if ( i+1 < x.size() ) y[i] -= x[i+1];
+    }
+    return y;
+  }
+};
+
+// Divides by the diagonal of the tridiagonal matrix.
+struct JacobiPreconditioner {
+  Vector<double> operator()( Vector<double> const& r ) const {
+    Vector<double> z( r.size() );
+    for ( size_t i = 0; i < r.size(); i++ )
+      z[i] = r[i] / ( 4 * (i+1) );
+    return z;
+  }
+};
+
+TEST( ConjugateGradient, Preconditioned ) {
+  const size_t n = 50;
+  Vector<double> b( n ), x( n );
+  for ( size_t i = 0; i < n; i++ )
+    b[i] = double(i % 7) - 3;
+
+  TridiagonalOperator op;
+  size_t iterations = preconditioned_conjugate_gradient( op, JacobiPreconditioner(), b, x, n, 1e-12 );
+  EXPECT_LE( iterations, n );
+  Vector<double> r = b - op(x);
+  EXPECT_LT( norm_2(r), 1e-10 * norm_2(b) );
+
+  // Starting from the solution takes no iterations.
+  EXPECT_EQ( 0u, preconditioned_conjugate_gradient( op, JacobiPreconditioner(), b, x, n, 1e-6 ) );
+}
@@ -0,0 +1,57 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+#include <vw/Math/Dual.h>
+#include <vw/Math/Vector.h>
+
+using namespace vw;
+using namespace vw::math;
+
+// Something of everything, to check against finite differences.
+template <class T>
+T test_function( T const& x, T const& y ) {
+  return sqrt( x*x + y*y ) * sin( x ) / ( 2.0 + cos( y ) ) + atan2( y, x )
+    - exp( x / 4 ) * log( y ) + pow( x, 3.0 ) - 1 / y + tan( x / 3 ) * atan( y );
+}
+
+TEST( Dual, Function ) {
+  const double x = 0.7, y = 1.3, h = 1e-6;
+  Dual<2> r = test_function( Dual<2>( x, 0 ), Dual<2>( y, 1 ) );
+  EXPECT_NEAR( test_function( x, y ), r.value(), 1e-12 );
+  EXPECT_NEAR( ( test_function( x+h, y ) - test_function( x-h, y ) ) / (2*h), r.derivative(0), 1e-6 );
+  EXPECT_NEAR( ( test_function( x, y+h ) - test_function( x, y-h ) ) / (2*h), r.derivative(1), 1e-6 );
+}
+
+TEST( Dual, Arithmetic ) {
+  Dual<1> x( 2.0, 0 );
+  EXPECT_EQ( 1, ( x + 1 ).derivative(0) );
+  EXPECT_EQ( -1, ( 1 - x ).derivative(0) );
+  EXPECT_EQ( 3, ( 3 * x ).derivative(0) );
+  EXPECT_EQ( -0.25, ( 1 / x ).derivative(0) );
+  EXPECT_EQ( 4, ( x * x ).derivative(0) );
+  EXPECT_EQ( 2, fabs( -x ).value() );
+  EXPECT_EQ( 1, fabs( -x ).derivative(0) );
+  EXPECT_TRUE( x > 1 );
+  EXPECT_TRUE( x == Dual<1>( 2.0 ) );
+}
+
+TEST( Dual, Vector ) {
+  // The gradient of the norm is the unit vector.
+  Vector<Dual<3>, 3> v;
+  v(0) = Dual<3>( 1.0, 0 );
+  v(1) = Dual<3>( 2.0, 1 );
+  v(2) = Dual<3>( 2.0, 2 );
+  Dual<3> n = sqrt( dot_prod( v, v ) );
+  EXPECT_NEAR( 3, n.value(), 1e-12 );
+  EXPECT_NEAR( 1.0/3, n.derivative(0), 1e-12 );
+  EXPECT_NEAR( 2.0/3, n.derivative(2), 1e-12 );
+
+  Vector<Dual<3>, 3> w = v * 2.0 - v;
+  EXPECT_EQ( 1, w(1).derivative(1) );
+}
@@ -0,0 +1,92 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <vw/Math/FlatKDTree.h>
+#include <test/Helpers.h>
+
+#include <boost/random/linear_congruential.hpp>
+
+#include <algorithm>
+#include <utility>
+
+using namespace vw;
+using namespace vw::math;
+
+// The knn nearest rows of points to query, by brute force
+static std::vector<std::pair<double,int> > brute_force( Matrix<double> const& points,
+                                                        Vector<double> const& query, size_t knn ) {
+  std::vector<std::pair<double,int> > all;
+  for ( size_t i = 0; i < points.rows(); i++ )
+    all.push_back( std::make_pair( norm_2_sqr( select_row(points,i) - query ), int(i) ) );
+  std::sort( all.begin(), all.end() );
+  all.resize( std::min( knn, all.size() ) );
+  return all;
+}
+
+TEST(FlatKDTree, BruteForce) {
+  boost::rand48 gen(10);
+  Matrix<double> points( 2000, 3 ), queries( 300, 3 );
+  for ( size_t i = 0; i < points.rows(); i++ )
+    for ( size_t d = 0; d < 3; d++ )
+      // Some repeated keys, which fall on the splits
+      points(i,d) = double( gen() % 50 ) + ( d == 2 ? double(gen() % 1000) / 1000 : 0 );
+  for ( size_t i = 0; i < queries.rows(); i++ )
+    for ( size_t d = 0; d < 3; d++ )
+      queries(i,d) = double( gen() % 5000 ) / 100;
+
+  FlatKDTree<double> tree( points, 8, 4 );
+  EXPECT_EQ( 2000u, tree.size1() );
+  EXPECT_EQ( 3u, tree.size2() );
+  EXPECT_EQ( 8u, tree.depth() );
+
+  Matrix<int> indices;
+  Matrix<double> dists;
+  tree.knn_search( queries, indices, dists, 5, 4 );
+  ASSERT_EQ( 300u, indices.rows() );
+  ASSERT_EQ( 5u, indices.cols() );
+  for ( size_t i = 0; i < queries.rows(); i++ ) {
+    std::vector<std::pair<double,int> > expected = brute_force( points, select_row(queries,i), 5 );
+    for ( size_t k = 0; k < 5; k++ ) {
+      // Ties may come in either order, so compare distances
+      EXPECT_DOUBLE_EQ( expected[k].first, dists(i,k) );
+      EXPECT_DOUBLE_EQ( expected[k].first,
+                        norm_2_sqr( select_row(points,indices(i,k)) - select_row(queries,i) ) );
+    }
+  }
+
+  // One query at a time, and a tree built in one thread, agree
+  FlatKDTree<double> serial( points, 8, 1 );
+  Vector<int> one_index;
+  Vector<double> one_dist;
+  for ( size_t i = 0; i < queries.rows(); i++ ) {
+    serial.knn_search( select_row(queries,i), one_index, one_dist, 5 );
+    EXPECT_VECTOR_DOUBLE_EQ( select_row(dists,i), one_dist );
+  }
+}
+
+TEST(FlatKDTree, FewPoints) {
+  Matrix<float> points( 2, 2 );
+  points(0,0) = 1; points(0,1) = 1;
+  points(1,0) = 4; points(1,1) = 5;
+  FlatKDTree<float> tree( points );
+  EXPECT_EQ( 0u, tree.depth() );
+
+  Vector<int> indices;
+  Vector<float> dists;
+  tree.knn_search( Vector2f(0,0), indices, dists, 3 );
+  ASSERT_EQ( 3u, indices.size() );
+  EXPECT_EQ( 0, indices[0] );
+  EXPECT_EQ( 1, indices[1] );
+  EXPECT_EQ( -1, indices[2] );
+  EXPECT_FLOAT_EQ( 2, dists[0] );
+  EXPECT_FLOAT_EQ( 41, dists[1] );
+
+  FlatKDTree<float> empty( Matrix<float>(0,2) );
+  empty.knn_search( Vector2f(0,0), indices, dists, 1 );
+  EXPECT_EQ( -1, indices[0] );
+}
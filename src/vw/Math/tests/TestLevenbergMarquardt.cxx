@@ -86,3 +86,55 @@ TEST(LevenbergMarquardt, levenberg_marquardt) {
   EXPECT_EQ(vw::math::optimization::eConvergedRelTolerance, status);
   EXPECT_VECTOR_NEAR( expected_best, best, 1e-5 );
 }
+
+// A fixed-size model with its own jacobian: fitting a*exp(b*t) to
+// samples at t = 0..3
+struct ExponentialModel : public LeastSquaresModelBase<ExponentialModel> {
+  typedef Vector2 domain_type;
+  typedef Vector4 result_type;
+  typedef Matrix<double,4,2> jacobian_type;
+
+  inline result_type operator()( domain_type const& x ) const {
+    result_type h;
+    for ( size_t t = 0; t < 4; t++ )
+      h(t) = x(0) * exp( x(1) * t );
+    return h;
+  }
+
+  inline jacobian_type jacobian( domain_type const& x ) const {
+    jacobian_type J;
+    for ( size_t t = 0; t < 4; t++ ) {
+      J(t,0) = exp( x(1) * t );
+      J(t,1) = x(0) * t * exp( x(1) * t );
+    }
+    return J;
+  }
+};
+
+TEST(LevenbergMarquardt, levenberg_marquardt_batch) {
+  const size_t problems = 100;
+  std::vector<ExponentialModel> models( problems );
+  std::vector<Vector2> seeds( problems, Vector2( 1, 0 ) ), expected( problems );
+  std::vector<Vector4> observations( problems );
+  for ( size_t k = 0; k < problems; k++ ) {
+    expected[k] = Vector2( 1 + 0.02*k, 0.3 - 0.005*k );
+    observations[k] = models[k]( expected[k] );
+  }
+
+  std::vector<int> status;
+  levenberg_marquardt_batch( models, seeds, observations, status, 1e-16, 1e-16, 100, 4 );
+  ASSERT_EQ( problems, status.size() );
+  for ( size_t k = 0; k < problems; k++ ) {
+    EXPECT_NE( vw::math::optimization::eDidNotConverge, status[k] );
+    EXPECT_VECTOR_NEAR( expected[k], seeds[k], 1e-8 );
+  }
+
+  // The same problems in one thread
+  std::vector<Vector2> serial( problems, Vector2( 1, 0 ) );
+  std::vector<int> serial_status;
+  levenberg_marquardt_batch( models, serial, observations, serial_status, 1e-16, 1e-16, 100, 1 );
+  for ( size_t k = 0; k < problems; k++ ) {
+    EXPECT_EQ( status[k], serial_status[k] );
+    EXPECT_VECTOR_DOUBLE_EQ( seeds[k], serial[k] );
+  }
+}
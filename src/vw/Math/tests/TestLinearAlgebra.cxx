@@ -680,6 +680,36 @@ TEST(LinearAlgebra, SymmetricStatic) {
   EXPECT_MATRIX_NEAR( B, A*X, 1e-3 );
 }
 
+TEST(LinearAlgebra, SymmetricSmall) {
+  // The fixed-size cholesky agrees with LAPACK's
+  Matrix<double,6,6> A_;
+  for ( size_t i = 0; i < 6; i++ )
+    for ( size_t j = 0; j < 6; j++ )
+      A_(i,j) = ( i == j ? 4 : 0 ) + double((i+2*j) % 3) - 1;
+  Matrix<double,6,6> A = transpose(A_)*A_;
+  Vector<double,6> b;
+  for ( size_t i = 0; i < 6; i++ )
+    b(i) = double(i) - 2.5;
+
+  Matrix<double,6,6> Lt = A;
+  Vector<double,6> x = b;
+  solve_symmetric_nocopy(Lt,x);
+  EXPECT_VECTOR_NEAR( b, A*x, 1e-10 );
+
+  Matrix<double> dLt = A;
+  Vector<double> dx = b;
+  solve_symmetric_nocopy(dLt,dx);
+  EXPECT_VECTOR_NEAR( dx, x, 1e-10 );
+  EXPECT_MATRIX_NEAR( dLt, Lt, 1e-10 );
+
+  Vector<double,6> y = solve_symmetric(A,b);
+  EXPECT_VECTOR_NEAR( x, y, 1e-12 );
+
+  Matrix2x2 indefinite(1,2,2,1);
+  Vector2 c(1,1);
+  EXPECT_THROW( solve_symmetric_nocopy(indefinite,c), ArgumentErr );
+}
+
 TEST(LinearAlgebra, RankAndNullspace) {
   // Square Matrix
   Matrix<double> magic(3,3);
@@ -8,8 +8,10 @@
 // TestMatrix.h
 #include <gtest/gtest.h>
 #include <vw/Math/Matrix.h>
+#include <test/Helpers.h>
 
 using namespace vw;
+using namespace vw::test;
 
 TEST(Matrix, Static) {
   // Default constructor
@@ -388,15 +390,45 @@ TEST(Matrix, Products) {
   EXPECT_EQ( 15, r7(1,0) );
   EXPECT_EQ( 22, r7(1,1) );
 
-  // Matrix*Matrix self-assignment (no temporary)
+  // Matrix*Matrix self-assignment (no temporary).  Small fixed-size
+  // products are evaluated at once, so they are not aliased.
   Matrix2x2f r8 = m;
   r8 = no_tmp( r8*r8 );
   ASSERT_EQ( 2u, r8.rows() );
   ASSERT_EQ( 2u, r8.cols() );
   EXPECT_EQ( 7, r8(0,0) );
-  EXPECT_EQ( 22, r8(0,1) );
-  EXPECT_EQ( 33, r8(1,0) );
-  EXPECT_EQ( 742, r8(1,1) );
+  EXPECT_EQ( 10, r8(0,1) );
+  EXPECT_EQ( 15, r8(1,0) );
+  EXPECT_EQ( 22, r8(1,1) );
+}
+
+TEST(Matrix, SmallProducts) {
+  Matrix<double,6,3> a;
+  Matrix<double,3,6> b;
+  Vector<double,3> v;
+  for ( size_t i = 0; i < 6; i++ )
+    for ( size_t j = 0; j < 3; j++ ) {
+      a(i,j) = double(i+1) / (j+2);
+      b(j,i) = double(j) - 2*i;
+      v(j) = j + 0.5;
+    }
+  Matrix<double> da = a, db = b;
+  Vector<double> dv = v;
+
+  Matrix<double,6,6> ab = a*b;
+  EXPECT_MATRIX_NEAR( Matrix<double>(da*db), ab, 1e-12 );
+  Matrix<double,3,3> ata = transpose(a)*a;
+  EXPECT_MATRIX_NEAR( Matrix<double>(transpose(da)*da), ata, 1e-12 );
+  Vector<double,6> av = a*v;
+  EXPECT_VECTOR_NEAR( Vector<double>(da*dv), av, 1e-12 );
+  Vector<double,3> atav = transpose(a)*av;
+  EXPECT_VECTOR_NEAR( Vector<double>(transpose(da)*(da*dv)), atav, 1e-12 );
+
+  // Too large for the fixed-size products
+  Matrix<double,7,7> big;
+  big.set_identity();
+  Matrix<double,7,7> big2 = big*big;
+  EXPECT_MATRIX_NEAR( big, big2, 1e-12 );
 }
 
 TEST(Matrix, Transpose) {
@@ -455,6 +487,18 @@ TEST(Matrix, Inverse) {
   EXPECT_FLOAT_EQ(   3.0f / -15.0f , i2(2,0) );
   EXPECT_FLOAT_EQ(   6.0f / -15.0f , i2(2,1) );
   EXPECT_FLOAT_EQ(  -3.0f / -15.0f , i2(2,2) );
+
+  // Small fixed-size inverses agree with the dynamic-size one
+  Matrix<double,6,6> m3;
+  for ( size_t i = 0; i < 6; i++ )
+    for ( size_t j = 0; j < 6; j++ )
+      m3(i,j) = ( i == j ? 20 : 0 ) + double((i*j) % 5) - double(j);
+  Matrix<double,6,6> i3 = inverse(m3);
+  EXPECT_MATRIX_NEAR( inverse(Matrix<double>(m3)), i3, 1e-12 );
+  EXPECT_MATRIX_NEAR( math::identity_matrix<6>(), m3*i3, 1e-12 );
+
+  Matrix3x3 singular(1,2,3,2,4,6,0,1,1);
+  EXPECT_THROW( inverse(singular), MathErr );
 }
 
 TEST(Matrix, IndexingIterator) {
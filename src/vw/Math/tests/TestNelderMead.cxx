@@ -54,3 +54,15 @@ TEST(NelderMead, CCostFunction) {
   EXPECT_NEAR( 0.1962, result[0], DELTA );
   EXPECT_NEAR( 0.4846, result[1], DELTA );
 }
+
+TEST(NelderMead, Parallel) {
+  Vector2 initial_guess(2,2);
+  int status;
+  Vector2 serial = nelder_mead( QuadraticFunction(), initial_guess, status );
+  Vector2 result = nelder_mead( QuadraticFunction(), initial_guess, status, false, 1, 1e-16, 1000, 4 );
+  EXPECT_NEAR( 0.1962, result[0], DELTA );
+  EXPECT_NEAR( 0.4846, result[1], DELTA );
+  // Only the evaluations are spread across threads
+  EXPECT_EQ( serial[0], result[0] );
+  EXPECT_EQ( serial[1], result[1] );
+}
@@ -85,3 +85,12 @@ TEST(ParticleSwarmOptimization, sinus_function) {
   EXPECT_NEAR( pi2, std::fabs(modulo(result(2), M_PI)), 1e-1 );
   EXPECT_NEAR( pi2, std::fabs(modulo(result(3), M_PI)), 1e-1 );
 }
+
+TEST(ParticleSwarmOptimization, parallel) {
+  Vector2 min(-2, -2);
+  Vector2 max(2, 2);
+
+  QuadraticFunction::domain_type result =
+    particle_swarm_optimization( QuadraticFunction(), min, max, false, 1, 100, 1000, 0.9, 2, 2, 4.0, 4 );
+  EXPECT_VECTOR_NEAR( Vector2(0.1962, 0.4846), result, 1e-2 );
+}
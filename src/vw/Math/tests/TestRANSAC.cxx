@@ -0,0 +1,96 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+#include <vw/Math/Geometry.h>
+#include <vw/Math/RANSAC.h>
+
+using namespace vw;
+using namespace vw::math;
+
+class RANSACTest : public ::testing::Test {
+protected:
+  std::vector<Vector3> p1, p2;
+  Matrix3x3 H;
+  size_t num_inliers;
+
+  // A similarity relating the first 70 of 100 matches, the rest
+  // unrelated.  With outliers_first the outliers come first.
+  void make_matches( bool outliers_first ) {
+    H = Matrix3x3( 0.8, -0.6, 10,
+                   0.6,  0.8, -5,
+                   0,    0,    1 ) * 1.5;
+    H(2,2) = 1;
+    num_inliers = 70;
+    std::srand( 7 );
+    for ( size_t i = 0; i < 100; ++i ) {
+      Vector3 a( std::rand() % 500, std::rand() % 500, 1 ), b;
+      bool inlier = outliers_first ? i >= 100 - num_inliers : i < num_inliers;
+      if ( inlier )
+        b = H * a;
+      else
+        b = Vector3( std::rand() % 500, std::rand() % 500, 1 );
+      p1.push_back( a );
+      p2.push_back( b );
+    }
+  }
+
+  template <class RansacT>
+  void check( RansacT& ransac ) {
+    Matrix<double> fit = ransac( p1, p2 );
+    EXPECT_MATRIX_NEAR( H, fit, 1e-6 );
+    EXPECT_EQ( num_inliers, ransac.inlier_indices( fit, p1, p2 ).size() );
+  }
+};
+
+TEST_F( RANSACTest, Sequential ) {
+  make_matches( false );
+  SimilarityFittingFunctor fit;
+  InterestPointErrorMetric error;
+  RandomSampleConsensus<SimilarityFittingFunctor, InterestPointErrorMetric> ransac( fit, error, 1 );
+  check( ransac );
+}
+
+TEST_F( RANSACTest, Threaded ) {
+  make_matches( false );
+  SimilarityFittingFunctor fit;
+  InterestPointErrorMetric error;
+  RandomSampleConsensus<SimilarityFittingFunctor, InterestPointErrorMetric> ransac( fit, error, 1 );
+  ransac.set_num_threads( 4 );
+  ransac.set_confidence( 0.999 );
+  check( ransac );
+}
+
+TEST_F( RANSACTest, Preemptive ) {
+  make_matches( true );
+  SimilarityFittingFunctor fit;
+  InterestPointErrorMetric error;
+  RandomSampleConsensus<SimilarityFittingFunctor, InterestPointErrorMetric> ransac( fit, error, 1 );
+  ransac.set_preemptive_test( 1 );
+  ransac.set_confidence( 0.999 );
+  check( ransac );
+}
+
+TEST_F( RANSACTest, GuidedSampling ) {
+  make_matches( false );
+  SimilarityFittingFunctor fit;
+  InterestPointErrorMetric error;
+  RandomSampleConsensus<SimilarityFittingFunctor, InterestPointErrorMetric> ransac( fit, error, 1 );
+  ransac.set_guided_sampling( true );
+  ransac.set_confidence( 0.99 );
+  ransac.set_num_threads( 2 );
+  check( ransac );
+
+  // Outliers ranked best still leave the inliers to be found.
+  p1.clear();
+  p2.clear();
+  make_matches( true );
+  check( ransac );
+}
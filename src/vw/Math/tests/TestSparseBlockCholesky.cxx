@@ -0,0 +1,134 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+#include <vw/Math/SparseBlockCholesky.h>
+
+#include <cstdlib>
+
+using namespace vw;
+using namespace vw::math;
+
+// Fills a diagonally dominant, so positive definite, matrix of the
+// pattern into both the factorization and a dense copy.
+static void fill_matrix( SparseBlockCholesky& chol,
+                         std::vector<std::vector<size_t> > const& pattern,
+                         Matrix<double>& dense ) {
+  const size_t bs = chol.block_size();
+  dense.set_size( chol.rows(), chol.cols() );
+  dense.set_zero();
+  chol.clear();
+  for ( size_t j = 0; j < pattern.size(); j++ )
+    for ( size_t k = 0; k < pattern[j].size(); k++ ) {
+      size_t i = pattern[j][k];
+      Matrix<double> b( bs, bs );
+      for ( size_t r = 0; r < bs; r++ )
+        for ( size_t c = 0; c < bs; c++ )
+          b(r,c) = double( std::rand() % 200 ) / 100 - 1;
+      chol.set_block( i, j, b );
+      submatrix( dense, i*bs, j*bs, bs, bs ) = b;
+      submatrix( dense, j*bs, i*bs, bs, bs ) = transpose( b );
+    }
+  for ( size_t j = 0; j < pattern.size(); j++ ) {
+    Matrix<double> b( bs, bs );
+    for ( size_t r = 0; r < bs; r++ )
+      for ( size_t c = 0; c <= r; c++ )
+        b(r,c) = b(c,r) = double( std::rand() % 200 ) / 100 - 1;
+    for ( size_t r = 0; r < bs; r++ )
+      b(r,r) += 4 * bs * ( pattern.size() + 1 );
+    chol.set_block( j, j, b );
+    submatrix( dense, j*bs, j*bs, bs, bs ) = b;
+  }
+}
+
+TEST( SparseBlockCholesky, Solve ) {
+  std::srand( 3 );
+  const size_t n = 20, bs = 3;
+  std::vector<std::vector<size_t> > pattern( n );
+  for ( size_t j = 0; j < n; j++ )
+    for ( size_t i = j+1; i < n; i++ )
+      if ( std::rand() % 5 == 0 )
+        pattern[j].push_back( i );
+
+  SparseBlockCholesky chol( bs, pattern );
+  EXPECT_EQ( n*bs, chol.rows() );
+  EXPECT_LT( chol.num_supernodes(), n+1 );
+
+  // The pattern is analyzed once and factored with different values.
+  for ( size_t trial = 0; trial < 2; trial++ ) {
+    Matrix<double> dense;
+    fill_matrix( chol, pattern, dense );
+    ASSERT_TRUE( chol.factor() );
+
+    Vector<double> b( n*bs );
+    for ( size_t i = 0; i < b.size(); i++ )
+      b[i] = std::rand() % 100;
+    Vector<double> x = chol.solve( b );
+    EXPECT_VECTOR_NEAR( b, dense * x, 1e-8 );
+  }
+}
+
+TEST( SparseBlockCholesky, Ordering ) {
+  // A hub connected to every other block fills in completely unless
+  // the hub is eliminated last.
+  const size_t n = 10;
+  std::vector<std::vector<size_t> > pattern( n );
+  for ( size_t i = 1; i < n; i++ )
+    pattern[0].push_back( i );
+
+  SparseBlockCholesky chol( 2, pattern );
+  EXPECT_EQ( 0u, chol.ordering().back() );
+  EXPECT_EQ( 2*n - 1, chol.factor_blocks() );
+
+  Matrix<double> dense;
+  fill_matrix( chol, pattern, dense );
+  ASSERT_TRUE( chol.factor() );
+  Vector<double> b( 2*n );
+  b[0] = 1;
+  b[2*n-1] = 2;
+  EXPECT_VECTOR_NEAR( b, dense * chol.solve( b ), 1e-8 );
+}
+
+TEST( SparseBlockCholesky, Dense ) {
+  std::srand( 5 );
+  const size_t n = 4;
+  std::vector<std::vector<size_t> > pattern( n );
+  for ( size_t j = 0; j < n; j++ )
+    for ( size_t i = j+1; i < n; i++ )
+      pattern[j].push_back( i );
+
+  SparseBlockCholesky chol( 2, pattern );
+  EXPECT_EQ( 1u, chol.num_supernodes() );
+  EXPECT_EQ( n*(n+1)/2, chol.factor_blocks() );
+
+  Matrix<double> dense;
+  fill_matrix( chol, pattern, dense );
+  ASSERT_TRUE( chol.factor() );
+  Vector<double> b( 2*n );
+  for ( size_t i = 0; i < b.size(); i++ )
+    b[i] = double(i) - 3;
+  EXPECT_VECTOR_NEAR( b, dense * chol.solve( b ), 1e-8 );
+}
+
+static Matrix<double> scalar_block( double value ) {
+  Matrix<double> m( 1, 1 );
+  m(0,0) = value;
+  return m;
+}
+
+TEST( SparseBlockCholesky, NotPositiveDefinite ) {
+  std::vector<std::vector<size_t> > pattern( 2 );
+  pattern[0].push_back( 1 );
+  SparseBlockCholesky chol( 1, pattern );
+  chol.set_block( 0, 0, scalar_block( 1 ) );
+  chol.set_block( 1, 0, scalar_block( 2 ) );
+  chol.set_block( 1, 1, scalar_block( 1 ) );
+  EXPECT_FALSE( chol.factor() );
+
+  EXPECT_THROW( chol.set_block( 1, 1, Matrix<double>( 2, 2 ) ), ArgumentErr );
+}
@@ -21,5 +21,6 @@
 #include <vw/Mosaic/GigapanQuadTreeConfig.h>
 #include <vw/Mosaic/ToastQuadTreeConfig.h>
 #include <vw/Mosaic/ImageComposite.h>
+#include <vw/Mosaic/TilePack.h>
 
 #endif // __VW_MOSAIC_H__
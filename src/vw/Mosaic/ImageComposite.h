@@ -13,11 +13,16 @@
 #define __VW_MOSAIC_IMAGECOMPOSITE_H__
 
 #include <iostream>
+#include <sstream>
+#include <string>
 #include <vector>
 #include <list>
+#include <map>
+#include <algorithm>
 
 #include <vw/Core/Cache.h>
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Thread.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/ImageMath.h>
@@ -27,6 +32,7 @@
 #include <vw/Image/Filter.h>
 #include <vw/Image/SparseImageCheck.h>
 #include <vw/FileIO/DiskImageResource.h>
+#include <vw/Mosaic/MaskCache.h>
 
 namespace vw {
 namespace mosaic {
@@ -120,6 +126,56 @@ namespace mosaic {
   };
 
 
+  // *******************************************************************
+  // QuantizedPositionedImage
+  // *******************************************************************
+
+  // A PositionedImage stored as 16-bit integers, in steps of 1/32767
+  // of the largest magnitude of any channel in it.  This keeps the
+  // band-pass levels of a blending pyramid, whose values are small
+  // differences, in half the memory of float pixels.  It only
+  // supports adding itself to a full-precision image.
+  template <class PixelT>
+  class QuantizedPositionedImage {
+    typedef typename PixelChannelType<PixelT>::type channel_type;
+    ImageView<int16> m_data; // One plane per channel
+    double m_step;
+
+  public:
+    BBox2i bbox;
+
+    QuantizedPositionedImage( PositionedImage<PixelT> const& source ) : m_step(1), bbox(source.bbox) {
+      const int32 channels = PixelNumChannels<PixelT>::value;
+      ImageView<PixelT> const& image = source.image;
+      double max_abs = 0;
+      for( int32 j=0; j<image.rows(); ++j )
+        for( int32 i=0; i<image.cols(); ++i )
+          for( int32 c=0; c<channels; ++c )
+            max_abs = std::max( max_abs, fabs( double( compound_select_channel<channel_type const&>( image(i,j), c ) ) ) );
+      if( max_abs > 0 ) m_step = max_abs / 32767;
+      m_data.set_size( image.cols(), image.rows(), channels );
+      for( int32 j=0; j<image.rows(); ++j )
+        for( int32 i=0; i<image.cols(); ++i )
+          for( int32 c=0; c<channels; ++c )
+            m_data(i,j,c) = int16( floor( double( compound_select_channel<channel_type const&>( image(i,j), c ) ) / m_step + 0.5 ) );
+    }
+
+    // Adds the image to the destination, whose origin is at (ox,oy).
+    void addto( ImageView<PixelT> const& dest, int ox, int oy ) const {
+      const int32 channels = PixelNumChannels<PixelT>::value;
+      BBox2i sum_bbox = bbox;
+      sum_bbox.crop( BBox2i( Vector2i(ox,oy), Vector2i(ox+dest.cols(),oy+dest.rows()) ) );
+      for( int32 y=sum_bbox.min().y(); y<sum_bbox.max().y(); ++y )
+        for( int32 x=sum_bbox.min().x(); x<sum_bbox.max().x(); ++x ) {
+          PixelT &pixel = dest( x-ox, y-oy );
+          for( int32 c=0; c<channels; ++c )
+            compound_select_channel<channel_type&>( pixel, c ) +=
+              channel_type( m_data( x-bbox.min().x(), y-bbox.min().y(), c ) * m_step );
+        }
+    }
+  };
+
+
   // *******************************************************************
   // ImageComposite
   // *******************************************************************
@@ -131,9 +187,40 @@ namespace mosaic {
     typedef typename PixelChannelType<PixelT>::type channel_type;
 
   private:
+    // The levels of one source's blending pyramid.  A compact pyramid
+    // keeps its band-pass levels quantized, and only its low-pass
+    // base, which holds the actual pixel values, at full precision; so
+    // the quantized levels always come first.
     struct Pyramid {
+      std::vector<QuantizedPositionedImage<pixel_type> > compact_images;
+      std::vector<QuantizedPositionedImage<channel_type> > compact_masks;
       std::vector<PositionedImage<pixel_type> > images;
       std::vector<PositionedImage<channel_type> > masks;
+
+      void push_back( PositionedImage<pixel_type> const& image, PositionedImage<channel_type> const& mask, bool compact ) {
+        if( compact ) {
+          VW_ASSERT( images.empty(), LogicErr() << "ImageComposite: quantized pyramid levels must come first." );
+          compact_images.push_back( QuantizedPositionedImage<pixel_type>( image ) );
+          compact_masks.push_back( QuantizedPositionedImage<channel_type>( mask ) );
+        }
+        else {
+          images.push_back( image );
+          masks.push_back( mask );
+        }
+      }
+
+      // Adds one level to the blend and mask sums, whose origin is at
+      // the given point of that level.
+      void addto( int level, ImageView<pixel_type> const& sum, ImageView<channel_type> const& msum, Vector2i const& origin ) const {
+        if( size_t(level) < compact_images.size() ) {
+          compact_images[level].addto( sum, origin.x(), origin.y() );
+          compact_masks[level].addto( msum, origin.x(), origin.y() );
+        }
+        else {
+          images[level-compact_images.size()].addto( sum, origin.x(), origin.y() );
+          masks[level-compact_images.size()].addto( msum, origin.x(), origin.y() );
+        }
+      }
     };
 
     class SourceGenerator {
@@ -151,15 +238,27 @@ namespace mosaic {
 
     class GrassfireGenerator {
       ImageViewRef<pixel_type> m_source;
+      boost::shared_ptr<MaskCache> m_mask_cache;
+      std::string m_key;
     public:
       typedef ImageView<float32> value_type;
-      GrassfireGenerator( ImageViewRef<pixel_type> const& source ) : m_source(source) {}
+      GrassfireGenerator( ImageViewRef<pixel_type> const& source,
+                          boost::shared_ptr<MaskCache> const& mask_cache = boost::shared_ptr<MaskCache>(),
+                          std::string const& key = std::string() )
+        : m_source(source), m_mask_cache(mask_cache), m_key(key) {}
       size_t size() const {
         return m_source.cols() * m_source.rows() * sizeof(float32);
       }
       boost::shared_ptr<value_type> generate() const {
-        ImageView<float32> alpha = channel_cast<float32>( select_alpha_channel( copy( m_source ) ) );
-        return boost::shared_ptr<value_type>( new value_type( grassfire( alpha ) ) );
+        boost::shared_ptr<value_type> result( new value_type );
+        bool cached = m_mask_cache && ! m_key.empty();
+        if( cached && m_mask_cache->read( m_key, *result ) &&
+            result->cols() == m_source.cols() && result->rows() == m_source.rows() )
+          return result;
+        // Computed tile by tile, so the source is never copied whole.
+        *result = channel_cast<float32>( block_grassfire( select_alpha_channel( m_source ) ) );
+        if( cached ) m_mask_cache->write( m_key, *result );
+        return result;
       }
     };
 
@@ -188,36 +287,211 @@ namespace mosaic {
       typedef Pyramid value_type;
       PyramidGenerator( ImageComposite& composite, size_t index ) : m_composite(composite), m_index(index) {}
       size_t size() const {
-        return size_t( double(m_composite.sources[m_index].size()) * 1.66 ); // 1.66 = (5/4)*(4/3)
+        return size_t( double(m_composite.sources[m_index].size()) * 1.66 * m_composite.pyramid_storage_ratio() ); // 1.66 = (5/4)*(4/3)
       }
       boost::shared_ptr<value_type> generate() const;
     };
 
     friend class PyramidGenerator;
 
+    // Generates the part of one source's pyramid that falls in one
+    // block of the mosaic, for streaming blends.
+    class BlockPyramidGenerator {
+    public:
+      ImageComposite const& m_composite;
+      uint32 m_index;
+      Vector2i m_block;
+    public:
+      typedef Pyramid value_type;
+      BlockPyramidGenerator( ImageComposite const& composite, uint32 index, Vector2i const& block )
+        : m_composite(composite), m_index(index), m_block(block) {}
+      size_t size() const {
+        return size_t( double(m_composite.m_block_size) * m_composite.m_block_size * 1.66 * sizeof(pixel_type) * m_composite.pyramid_storage_ratio() ); // 1.66 = (5/4)*(4/3)
+      }
+      boost::shared_ptr<value_type> generate() const {
+        return m_composite.block_pyramid( m_index, m_block );
+      }
+    };
+
+    friend class BlockPyramidGenerator;
+
+    // A uniform grid of cells over the source bounding boxes, listing
+    // the sources that overlap each cell.  Finding the sources that
+    // overlap a patch then costs time in proportion to the sources
+    // near it, rather than to all of them.
+    class SourceGrid {
+      BBox2i m_bbox;
+      int32 m_cell_size, m_cols, m_rows;
+      std::vector<std::vector<uint32> > m_cells;
+
+      // The (inclusive) range of cells that a bounding box covers,
+      // clamped to the grid.
+      void cell_range( BBox2i const& bbox, int32& x0, int32& y0, int32& x1, int32& y1 ) const {
+        x0 = clamp( (bbox.min().x() - m_bbox.min().x()) / m_cell_size, m_cols );
+        y0 = clamp( (bbox.min().y() - m_bbox.min().y()) / m_cell_size, m_rows );
+        x1 = clamp( (bbox.max().x() - 1 - m_bbox.min().x()) / m_cell_size, m_cols );
+        y1 = clamp( (bbox.max().y() - 1 - m_bbox.min().y()) / m_cell_size, m_rows );
+      }
+      static int32 clamp( int32 cell, int32 cells ) {
+        return std::max( 0, std::min( cell, cells-1 ) );
+      }
+
+    public:
+      SourceGrid() : m_cell_size(0), m_cols(0), m_rows(0) {}
+
+      // Cells are about the size of an average source, grown as
+      // needed to keep the grid to a few cells per source.
+      void build( std::vector<BBox2i> const& bboxes, BBox2i const& bbox ) {
+        m_cells.clear();
+        if( bboxes.empty() || bbox.empty() ) return;
+        double size = 0;
+        for( size_t i=0; i<bboxes.size(); ++i )
+          size += std::max( bboxes[i].width(), bboxes[i].height() );
+        m_bbox = bbox;
+        m_cell_size = std::max( 1, int32( size / bboxes.size() ) );
+        while( true ) {
+          m_cols = (bbox.width() - 1) / m_cell_size + 1;
+          m_rows = (bbox.height() - 1) / m_cell_size + 1;
+          if( double(m_cols) * m_rows <= 4.0 * bboxes.size() + 16 ) break;
+          m_cell_size *= 2;
+        }
+        m_cells.resize( m_cols * m_rows );
+        for( size_t p=0; p<bboxes.size(); ++p ) {
+          if( bboxes[p].empty() ) continue;
+          int32 x0, y0, x1, y1;
+          cell_range( bboxes[p], x0, y0, x1, y1 );
+          for( int32 y=y0; y<=y1; ++y )
+            for( int32 x=x0; x<=x1; ++x )
+              m_cells[y*m_cols+x].push_back( uint32(p) );
+        }
+      }
+
+      // Lists the sources whose bounding boxes intersect the given
+      // one, in the order they were inserted.  Until the grid is
+      // built, every source is checked.
+      void find( BBox2i const& bbox, std::vector<BBox2i> const& bboxes, std::vector<uint32>& sources ) const {
+        sources.clear();
+        if( m_cells.empty() ) {
+          for( size_t p=0; p<bboxes.size(); ++p )
+            if( bbox.intersects( bboxes[p] ) ) sources.push_back( uint32(p) );
+          return;
+        }
+        if( bbox.empty() ) return;
+        int32 x0, y0, x1, y1;
+        cell_range( bbox, x0, y0, x1, y1 );
+        for( int32 y=y0; y<=y1; ++y )
+          for( int32 x=x0; x<=x1; ++x ) {
+            std::vector<uint32> const& cell = m_cells[y*m_cols+x];
+            for( size_t i=0; i<cell.size(); ++i )
+              if( bbox.intersects( bboxes[cell[i]] ) ) sources.push_back( cell[i] );
+          }
+        if( x1 > x0 || y1 > y0 ) {
+          std::sort( sources.begin(), sources.end() );
+          sources.erase( std::unique( sources.begin(), sources.end() ), sources.end() );
+        }
+      }
+    };
+
     std::vector<BBox2i > bboxes;
     BBox2i view_bbox, data_bbox;
     int mindim, levels;
     bool m_draft_mode;
     bool m_fill_holes;
     bool m_reuse_masks;
+    boost::shared_ptr<MaskCache> m_mask_cache;
+    std::vector<std::string> m_source_ids;
+    bool m_streaming;
+    bool m_compact_pyramids;
+    int32 m_block_size;
     Cache& m_cache;
     std::vector<ImageViewRef<pixel_type> > sourcerefs;
     std::vector<Cache::Handle<SourceGenerator> > sources;
     std::vector<Cache::Handle<AlphaGenerator> > alphas;
     std::vector<Cache::Handle<PyramidGenerator> > pyramids;
+    SourceGrid m_grid;
+
+    // The block pyramids requested so far, keyed by source and block.
+    // Their generators refer back to this composite, so a copy starts
+    // with none of its own.
+    typedef std::pair<uint32, std::pair<int32,int32> > block_key;
+    struct BlockPyramids {
+      Mutex mutex;
+      std::map<block_key, Cache::Handle<BlockPyramidGenerator> > handles;
+      BlockPyramids() {}
+      BlockPyramids( BlockPyramids const& ) {}
+      BlockPyramids& operator=( BlockPyramids const& ) {
+        Mutex::Lock lock( mutex );
+        handles.clear();
+        return *this;
+      }
+    };
+    mutable BlockPyramids m_block_pyramids;
 
     void generate_masks( ProgressCallback const& progress_callback ) const;
+    std::string grassfire_key( uint32 index ) const;
+    std::string seam_key( uint32 index ) const;
 
     ImageView<pixel_type> blend_patch( BBox2i const& patch_bbox ) const;
+    boost::shared_ptr<Pyramid> block_pyramid( uint32 index, Vector2i const& block ) const;
+    boost::shared_ptr<Pyramid> find_block_pyramid( uint32 index, Vector2i const& block ) const;
+    ImageView<int32> clamped_grassfire( uint32 index, BBox2i const& bbox, int32 halo ) const;
+
+    // Whether the band-pass levels of the pyramids are quantized,
+    // which is only worth doing for channels wider than 16 bits.
+    bool quantize_pyramids() const {
+      return m_compact_pyramids && sizeof(channel_type) > sizeof(int16);
+    }
+
+    // The memory a pyramid takes relative to one of full precision,
+    // ignoring the small low-pass base.
+    double pyramid_storage_ratio() const {
+      return quantize_pyramids() ? double(sizeof(int16)) / sizeof(channel_type) : 1.0;
+    }
+
+    // The margin of source pixels that a block pyramid is computed
+    // from, beyond the block itself, so that the filtering at every
+    // level is unaffected by where the block was cut.
+    int32 block_halo() const { return 4 << levels; }
+
+    // The number of pyramid levels to blend with, given the smallest
+    // dimension of any source.
+    int pyramid_levels( int min_dimension ) const {
+      int result = (int) floorf( logf( float(min_dimension)/2.0f ) / logf(2.0f) ) - 1;
+      if( m_streaming ) {
+        // Keep the halo that block pyramids are computed with to at
+        // most half a block.
+        int max_levels = 0;
+        while( (8 << (max_levels+1)) <= m_block_size ) ++max_levels;
+        result = std::min( result, max_levels );
+      }
+      if( result < 1 ) result = 1;
+      return result;
+    }
+
+    template <class PixT>
+    static PositionedImage<PixT> crop_positioned( PositionedImage<PixT> const& image, BBox2i bbox ) {
+      bbox.crop( image.bbox );
+      if( bbox.empty() ) return PositionedImage<PixT>( image.cols(), image.rows(), ImageView<PixT>(), BBox2i(0,0,0,0) );
+      return PositionedImage<PixT>( image.cols(), image.rows(), crop( image.image, bbox - image.bbox.min() ), bbox );
+    }
+
+    static int32 floor_div( int32 a, int32 b ) {
+      return (a >= 0) ? a/b : -((-a-1)/b) - 1;
+    }
     ImageView<pixel_type> draft_patch( BBox2i const& patch_bbox ) const;
 
   public:
     typedef pixel_type result_type;
 
-    ImageComposite() : m_draft_mode(false), m_fill_holes(false), m_reuse_masks(false), m_cache(vw_system_cache()) {}
+    ImageComposite() : m_draft_mode(false), m_fill_holes(false), m_reuse_masks(false),
+                       m_streaming(false), m_compact_pyramids(false), m_block_size(512), m_cache(vw_system_cache()) {}
 
-    void insert( ImageViewRef<pixel_type> const& image, int x, int y );
+    /// Adds a source to the composite.  The optional source_id
+    /// identifies the source's contents, for instance by its file
+    /// name, modification time, and whatever transform was applied
+    /// to it, such that sources with the same id have the same
+    /// pixels.  Only the masks of sources with an id are cached.
+    void insert( ImageViewRef<pixel_type> const& image, int x, int y, std::string const& source_id = std::string() );
 
     void prepare( const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() );
     void prepare( BBox2i const& total_bbox, const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() );
@@ -233,6 +507,41 @@ namespace mosaic {
 
     void set_reuse_masks( bool reuse_masks ) { m_reuse_masks = reuse_masks; }
 
+    /// Keep the grassfire and seam masks of the sources in the given
+    /// directory, and use the ones already there, so that later runs
+    /// over some of the same sources need not compute them again.
+    /// Masks are keyed by the ids given to insert() and by where the
+    /// sources lie relative to one another.  An empty directory, the
+    /// default, disables the cache.
+    void set_mask_cache( std::string const& directory ) {
+      if( directory.empty() ) m_mask_cache.reset();
+      else m_mask_cache.reset( new MaskCache( directory ) );
+    }
+
+    /// Blend a block at a time instead of precomputing masks and
+    /// pyramids of whole source images.  Each source's masks and
+    /// pyramid are computed, and cached, only for the blocks of the
+    /// mosaic that a patch needs, so memory use does not grow with the
+    /// size of the sources.  In exchange, the pyramid has at most
+    /// log2(block_size)-3 levels, and the seams between sources are
+    /// only placed exactly where they are within block_size/2 pixels
+    /// of a source's transparent edge.  block_size must be a power of
+    /// two, and must be set before prepare().
+    void set_streaming( bool streaming, int32 block_size = 512 ) {
+      VW_ASSERT( block_size >= 16 && (block_size & (block_size-1)) == 0,
+                 ArgumentErr() << "ImageComposite: streaming block size must be a power of two of at least 16." );
+      m_streaming = streaming;
+      m_block_size = block_size;
+    }
+
+    /// Store the band-pass levels of the blending pyramids as 16-bit
+    /// integers instead of at the full precision of the pixel type,
+    /// which halves the memory blending takes with float pixels.  The
+    /// levels are quantized relative to their largest value, so the
+    /// error is far below what 8- or 16-bit output can show, though
+    /// float elevation data may prefer full precision.
+    void set_compact_pyramids( bool compact ) { m_compact_pyramids = compact; }
+
     int32 cols() const {
       return view_bbox.width();
     }
@@ -253,6 +562,35 @@ namespace mosaic {
       return 1;
     }
 
+    /// The number of source images inserted so far.
+    size_t num_sources() const { return sourcerefs.size(); }
+
+    /// The region of the prepared mosaic that the sources inserted
+    /// from the given index onward can affect, including the margin
+    /// over which they are blended into their neighbors.  Outside it,
+    /// the mosaic is the same as it was without them, so an existing
+    /// rendering of it only needs to be regenerated within it.  If
+    /// the new sources are small enough to reduce the number of
+    /// pyramid levels, the whole mosaic changes.
+    BBox2i changed_bbox( size_t first_source ) const {
+      BBox2i changed;
+      for( size_t p=first_source; p<bboxes.size(); ++p )
+        changed.grow( bboxes[p] );
+      if( changed.empty() ) return BBox2i();
+      if( ! m_draft_mode ) {
+        int old_mindim = 0;
+        for( size_t p=0; p<first_source; ++p ) {
+          int dim = std::min( bboxes[p].width(), bboxes[p].height() );
+          if( p == 0 || dim < old_mindim ) old_mindim = dim;
+        }
+        if( first_source > 0 && pyramid_levels( old_mindim ) != levels )
+          return BBox2i( 0, 0, cols(), rows() );
+        changed.expand( block_halo() );
+      }
+      changed.crop( BBox2i( 0, 0, cols(), rows() ) );
+      return changed;
+    }
+
     pixel_type operator()( int x, int y, int p=0 ) const {
       // FIXME: This is horribly slow, and totally untested for
       // multi-band blending.  We should do something faster for draft
@@ -275,7 +613,10 @@ namespace mosaic {
     }
 
     bool sparse_check( BBox2i const& bbox ) const {
-      for (unsigned int i = 0; i < bboxes.size(); ++i) {
+      std::vector<uint32> overlapping;
+      m_grid.find( bbox, bboxes, overlapping );
+      for (unsigned int n = 0; n < overlapping.size(); ++n) {
+        uint32 i = overlapping[n];
         BBox2i src_bbox = bboxes[i];
         src_bbox.crop(bbox);
         if( ! src_bbox.empty() ) {
@@ -314,9 +655,19 @@ void vw::mosaic::ImageComposite<PixelT>::generate_masks( vw::ProgressCallback co
   vw_out(DebugMessage, "mosaic") << "Generating masks..." << std::endl;
   std::vector<Cache::Handle<GrassfireGenerator> > grassfires;
   for( unsigned i=0; i<sources.size(); ++i )
-    grassfires.push_back( m_cache.insert( GrassfireGenerator( sourcerefs[i] ) ) );
+    grassfires.push_back( m_cache.insert( GrassfireGenerator( sourcerefs[i], m_mask_cache, grassfire_key(i) ) ) );
   for( unsigned p1=0; p1<sources.size(); ++p1 ) {
-    ImageView<float> mask = copy( *(grassfires[p1]) );
+    std::ostringstream filename;
+    filename << "mask." << p1 << ".png";
+    std::string key = seam_key( p1 );
+    ImageView<float> mask;
+    if( m_mask_cache && ! key.empty() && m_mask_cache->read( key, mask ) &&
+        mask.cols() == bboxes[p1].width() && mask.rows() == bboxes[p1].height() ) {
+      write_image( filename.str(), mask );
+      progress_callback.report_fractional_progress( double((p1+1)*(sources.size()+1)), double((sources.size()+1)*sources.size()) );
+      continue;
+    }
+    mask = copy( *(grassfires[p1]) );
     for( unsigned p2=0; p2<sources.size(); ++p2 ) {
       if( p1 == p2 ) continue;
       int ox = bboxes[p2].min().x() - bboxes[p1].min().x();
@@ -342,14 +693,43 @@ void vw::mosaic::ImageComposite<PixelT>::generate_masks( vw::ProgressCallback co
       progress_callback.report_fractional_progress( double(p1*(sources.size()+1)+p2+1), double((sources.size()+1)*sources.size()) );
     }
     mask = threshold( mask );
-    std::ostringstream filename;
-    filename << "mask." << p1 << ".png";
+    if( m_mask_cache && ! key.empty() ) m_mask_cache->write( key, mask );
     write_image( filename.str(), mask );
     progress_callback.report_fractional_progress( double((p1+1)*(sources.size()+1)), double((sources.size()+1)*sources.size()) );
   }
   // report_finished() called by prepare(), so don't call it here
 }
 
+// The cache key of a source's grassfire, or an empty string if the
+// source has no id.
+template <class PixelT>
+std::string vw::mosaic::ImageComposite<PixelT>::grassfire_key( uint32 index ) const {
+  if( index >= m_source_ids.size() || m_source_ids[index].empty() ) return std::string();
+  std::ostringstream key;
+  key << "grassfire\n" << m_source_ids[index] << "\n"
+      << bboxes[index].width() << "x" << bboxes[index].height();
+  return key.str();
+}
+
+// The cache key of a source's seam mask, which depends on every
+// source that overlaps it, where it lies relative to them, and which
+// of them takes precedence on ties.
+template <class PixelT>
+std::string vw::mosaic::ImageComposite<PixelT>::seam_key( uint32 index ) const {
+  std::string own = grassfire_key( index );
+  if( own.empty() ) return own;
+  std::ostringstream key;
+  key << "seam\n" << own;
+  for( uint32 p=0; p<bboxes.size(); ++p ) {
+    if( p == index || ! bboxes[p].intersects( bboxes[index] ) ) continue;
+    std::string other = grassfire_key( p );
+    if( other.empty() ) return other;
+    Vector2i offset = bboxes[p].min() - bboxes[index].min();
+    key << "\n" << other << "\n" << offset.x() << "," << offset.y() << ( p > index ? " after" : " before" );
+  }
+  return key.str();
+}
+
 
 template <class PixelT>
 boost::shared_ptr<typename vw::mosaic::ImageComposite<PixelT>::Pyramid> vw::mosaic::ImageComposite<PixelT>::PyramidGenerator::generate() const {
@@ -382,16 +762,113 @@ boost::shared_ptr<typename vw::mosaic::ImageComposite<PixelT>::Pyramid> vw::mosa
       image_low = next_image_low;
     }
     diff *= mask;
-    ptr->images.push_back( diff );
-    ptr->masks.push_back( mask );
+    ptr->push_back( diff, mask, m_composite.quantize_pyramids() && l < m_composite.levels-1 );
+  }
+  return ptr;
+}
+
+
+template <class PixelT>
+boost::shared_ptr<typename vw::mosaic::ImageComposite<PixelT>::Pyramid> vw::mosaic::ImageComposite<PixelT>::find_block_pyramid( uint32 index, Vector2i const& block ) const {
+  Cache::Handle<BlockPyramidGenerator> handle;
+  {
+    Mutex::Lock lock( m_block_pyramids.mutex );
+    block_key key( index, std::make_pair( block.x(), block.y() ) );
+    typename std::map<block_key, Cache::Handle<BlockPyramidGenerator> >::iterator it = m_block_pyramids.handles.find( key );
+    if( it == m_block_pyramids.handles.end() )
+      it = m_block_pyramids.handles.insert( std::make_pair( key, m_cache.insert( BlockPyramidGenerator( *this, index, block ) ) ) ).first;
+    handle = it->second;
+  }
+  return handle;
+}
+
+// The grassfire distance of a source over the part of bbox that it
+// covers.  It is computed from a margin of halo pixels around bbox
+// and so is clamped to halo, which is as far as it is exact.
+template <class PixelT>
+vw::ImageView<vw::int32> vw::mosaic::ImageComposite<PixelT>::clamped_grassfire( uint32 index, BBox2i const& bbox, int32 halo ) const {
+  BBox2i fire_bbox = bbox;
+  fire_bbox.expand( halo );
+  fire_bbox.crop( bboxes[index] );
+  BBox2i section = bbox;
+  section.crop( bboxes[index] );
+  ImageView<int32> fire = grassfire( select_alpha_channel( crop( sourcerefs[index], fire_bbox - bboxes[index].min() ) ) );
+  ImageView<int32> result = crop( fire, section - fire_bbox.min() );
+  for( int32 j=0; j<result.rows(); ++j )
+    for( int32 i=0; i<result.cols(); ++i )
+      result(i,j) = std::min( result(i,j), halo );
+  return result;
+}
+
+// Computes one source's pyramid in one block of the mosaic, from the
+// source pixels within block_halo() of the block.  The mask follows
+// the same rule as generate_masks(), using grassfire distances
+// clamped to the halo.  Each level is cropped to the block's share of
+// that level, so that neighbouring blocks do not overlap.
+template <class PixelT>
+boost::shared_ptr<typename vw::mosaic::ImageComposite<PixelT>::Pyramid> vw::mosaic::ImageComposite<PixelT>::block_pyramid( uint32 index, Vector2i const& block ) const {
+  vw_out(DebugMessage, "mosaic") << "ImageComposite generating pyramid " << index << " block " << block << std::endl;
+  BBox2i block_bbox( block * m_block_size, (block + Vector2i(1,1)) * m_block_size );
+  int32 halo = block_halo();
+  BBox2i region = block_bbox;
+  region.expand( halo );
+  region.crop( bboxes[index] );
+
+  // The seam mask over the region
+  ImageView<int32> fire = clamped_grassfire( index, region, halo );
+  ImageView<channel_type> mask_image( region.width(), region.height() );
+  std::vector<uint32> overlapping;
+  m_grid.find( region, bboxes, overlapping );
+  for( int32 j=0; j<region.height(); ++j )
+    for( int32 i=0; i<region.width(); ++i )
+      if( fire(i,j) > 0 ) mask_image(i,j) = ChannelRange<channel_type>::max();
+  for( unsigned n=0; n<overlapping.size(); ++n ) {
+    uint32 q = overlapping[n];
+    if( q == index ) continue;
+    BBox2i section = region;
+    section.crop( bboxes[q] );
+    ImageView<int32> other = clamped_grassfire( q, region, halo );
+    Vector2i offset = section.min() - region.min();
+    for( int32 j=0; j<section.height(); ++j )
+      for( int32 i=0; i<section.width(); ++i ) {
+        int32 mine = fire(offset.x()+i,offset.y()+j), theirs = other(i,j);
+        if( theirs > mine || ( theirs == mine && q > index ) )
+          mask_image(offset.x()+i,offset.y()+j) = 0;
+      }
+  }
+
+  ImageView<pixel_type> source = crop( sourcerefs[index], region - bboxes[index].min() );
+  if( m_fill_holes ) source /= select_alpha_channel(source);
+
+  // The same construction as PyramidGenerator::generate()
+  PositionedImage<pixel_type> image_high( view_bbox.width(), view_bbox.height(), source, region );
+  PositionedImage<pixel_type> image_low = image_high.reduce();
+  PositionedImage<channel_type> mask( view_bbox.width(), view_bbox.height(), mask_image, region );
+
+  boost::shared_ptr<Pyramid> ptr( new Pyramid );
+  for( int l=0; l<levels; ++l ) {
+    PositionedImage<pixel_type> diff = image_high;
+    if( l > 0 ) mask = mask.reduce();
+    if( l < levels-1 ) {
+      PositionedImage<pixel_type> next_image_low = image_low.reduce();
+      image_low.unpremultiply();
+      diff.subtract_expanded( image_low );
+      image_high = image_low;
+      image_low = next_image_low;
+    }
+    diff *= mask;
+
+    BBox2i share( block_bbox.min() / (1<<l), block_bbox.max() / (1<<l) );
+    ptr->push_back( crop_positioned( diff, share ), crop_positioned( mask, share ), quantize_pyramids() && l < levels-1 );
   }
   return ptr;
 }
 
 
 template <class PixelT>
-void vw::mosaic::ImageComposite<PixelT>::insert( ImageViewRef<pixel_type> const& image, int x, int y ) {
+void vw::mosaic::ImageComposite<PixelT>::insert( ImageViewRef<pixel_type> const& image, int x, int y, std::string const& source_id ) {
   sourcerefs.push_back( image );
+  m_source_ids.push_back( source_id );
   sources.push_back( m_cache.insert( SourceGenerator( image ) ) );
   alphas.push_back( m_cache.insert( AlphaGenerator( *this, pyramids.size() ) ) );
   pyramids.push_back( m_cache.insert( PyramidGenerator( *this, pyramids.size() ) ) );
@@ -418,11 +895,11 @@ void vw::mosaic::ImageComposite<PixelT>::prepare( vw::ProgressCallback const& pr
   for( unsigned i=0; i<sources.size(); ++i )
     bboxes[i] -= view_bbox.min();
   data_bbox -= view_bbox.min();
+  m_grid.build( bboxes, data_bbox );
 
-  levels = (int) floorf( logf( float(mindim)/2.0f ) / logf(2.0f) ) - 1;
-  if( levels < 1 ) levels = 1;
+  levels = pyramid_levels( mindim );
 
-  if( !m_draft_mode && !m_reuse_masks ) {
+  if( !m_draft_mode && !m_reuse_masks && !m_streaming ) {
     generate_masks( progress_callback );
   }
   progress_callback.report_finished();
@@ -480,23 +957,45 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::blend_patch( BBox2i co
     padded_bbox.max().y() = 2*padded_bbox.max().y();
   }
 
-  // Make a list of the images whose bounding boxes permit them to
-  // impact the patch, prioritizing ones that are already in memory.
-  std::list<unsigned> image_list;
-  for( unsigned p=0; p<sources.size(); ++p ) {
-    if( ! padded_bbox.intersects( bboxes[p] ) ) continue;
-    if( ! pyramids[p].valid() ) image_list.push_back( p );
-    else image_list.push_front( p );
+  std::vector<uint32> overlapping;
+  if( m_streaming ) {
+    // Add the pyramid blocks of each source that overlap the patch at
+    // any level.  The pyramid levels of a block only cover the block,
+    // so each contribution is added exactly once.
+    BBox2i cover;
+    for( int l=0; l<levels; ++l )
+      cover.grow( BBox2i( bbox_pyr[l].min() * (1<<l), bbox_pyr[l].max() * (1<<l) ) );
+    int32 bx0 = floor_div( cover.min().x(), m_block_size ), bx1 = floor_div( cover.max().x()-1, m_block_size );
+    int32 by0 = floor_div( cover.min().y(), m_block_size ), by1 = floor_div( cover.max().y()-1, m_block_size );
+    for( int32 by=by0; by<=by1; ++by ) {
+      for( int32 bx=bx0; bx<=bx1; ++bx ) {
+        m_grid.find( BBox2i( bx*m_block_size, by*m_block_size, m_block_size, m_block_size ), bboxes, overlapping );
+        for( unsigned n=0; n<overlapping.size(); ++n ) {
+          boost::shared_ptr<Pyramid> pyr = find_block_pyramid( overlapping[n], Vector2i(bx,by) );
+          for( int l=0; l<levels; ++l )
+            pyr->addto( l, sum_pyr[l], msum_pyr[l], bbox_pyr[l].min() );
+        }
+      }
+    }
   }
+  else {
+    // Make a list of the images whose bounding boxes permit them to
+    // impact the patch, prioritizing ones that are already in memory.
+    m_grid.find( padded_bbox, bboxes, overlapping );
+    std::list<unsigned> image_list;
+    for( unsigned n=0; n<overlapping.size(); ++n ) {
+      unsigned p = overlapping[n];
+      if( ! pyramids[p].valid() ) image_list.push_back( p );
+      else image_list.push_front( p );
+    }
 
-  // Add each source image pyramid to the blend pyramid.
-  std::list<unsigned>::iterator ili=image_list.begin(), ilend=image_list.end();
-  for( ; ili!=ilend; ++ili ) {
-    unsigned p = *ili;
-    boost::shared_ptr<Pyramid> pyr = pyramids[p];
-    for( int l=0; l<levels; ++l ) {
-      pyr->images[l].addto( sum_pyr[l], bbox_pyr[l].min().x(), bbox_pyr[l].min().y() );
-      pyr->masks[l].addto( msum_pyr[l], bbox_pyr[l].min().x(), bbox_pyr[l].min().y() );
+    // Add each source image pyramid to the blend pyramid.
+    std::list<unsigned>::iterator ili=image_list.begin(), ilend=image_list.end();
+    for( ; ili!=ilend; ++ili ) {
+      unsigned p = *ili;
+      boost::shared_ptr<Pyramid> pyr = pyramids[p];
+      for( int l=0; l<levels; ++l )
+        pyr->addto( l, sum_pyr[l], msum_pyr[l], bbox_pyr[l].min() );
     }
   }
 
@@ -521,19 +1020,29 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::blend_patch( BBox2i co
 
     // Trim to the maximal source alpha, reloading images if needed
     ImageView<channel_type> alpha( patch_bbox.width(), patch_bbox.height() );
-    for( unsigned p=0; p<sources.size(); ++p ) {
-      if( ! patch_bbox.intersects( bboxes[p] ) ) continue;
-
-      ImageView<channel_type> source_alpha = *alphas[p];
+    m_grid.find( patch_bbox, bboxes, overlapping );
+    for( unsigned n=0; n<overlapping.size(); ++n ) {
+      unsigned p = overlapping[n];
 
       BBox2i overlap = patch_bbox;
       overlap.crop( bboxes[p] );
+
+      // Streaming blends read only the part of the source alpha that
+      // they need, so as not to load whole sources.
+      ImageView<channel_type> source_alpha;
+      Vector2i origin = bboxes[p].min();
+      if( m_streaming ) {
+        source_alpha = select_alpha_channel( crop( sourcerefs[p], overlap - bboxes[p].min() ) );
+        origin = overlap.min();
+      }
+      else source_alpha = *alphas[p];
+
       for( int j=0; j<overlap.height(); ++j ) {
         for( int i=0; i<overlap.width(); ++i ) {
-          if( source_alpha( overlap.min().x()+i-bboxes[p].min().x(), overlap.min().y()+j-bboxes[p].min().y() ) >
+          if( source_alpha( overlap.min().x()+i-origin.x(), overlap.min().y()+j-origin.y() ) >
               alpha( overlap.min().x()+i-patch_bbox.min().x(), overlap.min().y()+j-patch_bbox.min().y() ) ) {
             alpha( overlap.min().x()+i-patch_bbox.min().x(), overlap.min().y()+j-patch_bbox.min().y() ) =
-              source_alpha( overlap.min().x()+i-bboxes[p].min().x(), overlap.min().y()+j-bboxes[p].min().y() );
+              source_alpha( overlap.min().x()+i-origin.x(), overlap.min().y()+j-origin.y() );
           }
         }
       }
@@ -556,8 +1065,10 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::draft_patch( BBox2i co
   ImageView<pixel_type> composite(patch_bbox.width(),patch_bbox.height());
 
   // Add each image to the composite.
-  for( unsigned p=0; p<sources.size(); ++p ) {
-    if( ! patch_bbox.intersects( bboxes[p] ) ) continue;
+  std::vector<uint32> overlapping;
+  m_grid.find( patch_bbox, bboxes, overlapping );
+  for( unsigned n=0; n<overlapping.size(); ++n ) {
+    unsigned p = overlapping[n];
     BBox2i bbox = patch_bbox;
     bbox.crop( bboxes[p] );
     PositionedImage<pixel_type> image( view_bbox.width(), view_bbox.height(), crop(sourcerefs[p],bbox-bboxes[p].min()), bbox );
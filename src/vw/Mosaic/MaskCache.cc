@@ -0,0 +1,100 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Mosaic/MaskCache.h>
+#include <vw/FileIO/TemporaryFile.h>
+#include <vw/Core/Log.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+namespace fs = boost::filesystem;
+
+namespace {
+  const char mask_cache_magic[8] = { 'V','W','M','A','S','K','1','\0' };
+}
+
+namespace vw {
+namespace mosaic {
+
+  MaskCache::MaskCache( std::string const& directory ) : m_directory( directory ) {}
+
+  std::string MaskCache::hash( std::string const& key ) {
+    uint64 h = 14695981039346656037ULL;
+    for( size_t i=0; i<key.size(); ++i ) {
+      h ^= uint64( (unsigned char)key[i] );
+      h *= 1099511628211ULL;
+    }
+    std::ostringstream oss;
+    oss << std::hex << std::setw(16) << std::setfill('0') << h;
+    return oss.str();
+  }
+
+  std::string MaskCache::filename( std::string const& key ) const {
+    return ( fs::path( m_directory ) / ( hash( key ) + ".mask" ) ).string();
+  }
+
+  bool MaskCache::read( std::string const& key, ImageView<float32> &mask ) const {
+    std::ifstream f( filename( key ).c_str(), std::ios::binary );
+    if( ! f ) return false;
+
+    char magic[sizeof(mask_cache_magic)];
+    uint32 key_size = 0;
+    f.read( magic, sizeof(magic) );
+    f.read( (char*)&key_size, sizeof(key_size) );
+    if( ! f || memcmp( magic, mask_cache_magic, sizeof(magic) ) != 0 || key_size != key.size() )
+      return false;
+    std::string stored_key( key_size, '\0' );
+    if( key_size ) f.read( &stored_key[0], key_size );
+    if( ! f || stored_key != key ) return false;
+
+    int32 cols = 0, rows = 0;
+    f.read( (char*)&cols, sizeof(cols) );
+    f.read( (char*)&rows, sizeof(rows) );
+    if( ! f || cols < 0 || rows < 0 ) return false;
+    ImageView<float32> result( cols, rows );
+    if( cols && rows ) f.read( (char*)&result(0,0), sizeof(float32)*cols*rows );
+    if( ! f ) return false;
+    mask = result;
+    return true;
+  }
+
+  void MaskCache::write( std::string const& key, ImageView<float32> const& mask ) const {
+    std::string final_name = filename( key );
+    std::string temp_name;
+    try {
+      fs::create_directories( fs::path( m_directory ) );
+      TemporaryFile f( m_directory, false, hash( key ) + ".", ".tmp", std::ios::out | std::ios::binary );
+      temp_name = f.filename();
+      uint32 key_size = uint32( key.size() );
+      int32 cols = mask.cols(), rows = mask.rows();
+      f.write( mask_cache_magic, sizeof(mask_cache_magic) );
+      f.write( (char const*)&key_size, sizeof(key_size) );
+      f.write( key.data(), key.size() );
+      f.write( (char const*)&cols, sizeof(cols) );
+      f.write( (char const*)&rows, sizeof(rows) );
+      if( cols && rows ) f.write( (char const*)&mask(0,0), sizeof(float32)*cols*rows );
+      f.flush();
+      if( ! f ) vw_throw( IOErr() << "could not write " << temp_name );
+    }
+    catch( std::exception const& e ) {
+      vw_out(WarningMessage, "mosaic") << "Could not cache mask in " << m_directory << ": " << e.what() << std::endl;
+      if( ! temp_name.empty() ) std::remove( temp_name.c_str() );
+      return;
+    }
+    if( std::rename( temp_name.c_str(), final_name.c_str() ) != 0 ) {
+      vw_out(WarningMessage, "mosaic") << "Could not cache mask as " << final_name << std::endl;
+      std::remove( temp_name.c_str() );
+    }
+  }
+
+}} // namespace vw::mosaic
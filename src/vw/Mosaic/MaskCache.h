@@ -0,0 +1,54 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file MaskCache.h
+///
+/// An on-disk cache of the masks that ImageComposite blends with, so
+/// that they outlive a single run.
+///
+#ifndef __VW_MOSAIC_MASKCACHE_H__
+#define __VW_MOSAIC_MASKCACHE_H__
+
+#include <string>
+
+#include <vw/Image/ImageView.h>
+
+namespace vw {
+namespace mosaic {
+
+  /// Stores float masks in a directory, one file per key.  A key
+  /// should describe everything the mask was computed from, such as
+  /// the identity of the source files and the parameters used; the
+  /// file is named after a hash of it, and the key itself is stored
+  /// alongside the mask and checked on reading.  Files are written
+  /// under a temporary name and then renamed, so that concurrent runs
+  /// sharing a cache never see a partial mask.
+  class MaskCache {
+    std::string m_directory;
+
+    std::string filename( std::string const& key ) const;
+  public:
+    MaskCache( std::string const& directory );
+
+    std::string const& directory() const { return m_directory; }
+
+    /// Reads the mask stored under key, returning false if there is
+    /// none or it cannot be read.
+    bool read( std::string const& key, ImageView<float32> &mask ) const;
+
+    /// Stores the mask under key, replacing any already there.
+    /// Failing to write is not an error, since the mask can always be
+    /// computed again.
+    void write( std::string const& key, ImageView<float32> const& mask ) const;
+
+    /// A 64-bit FNV-1a hash of the key, in hexadecimal.
+    static std::string hash( std::string const& key );
+  };
+
+}} // namespace vw::mosaic
+
+#endif // __VW_MOSAIC_MASKCACHE_H__
@@ -9,6 +9,7 @@
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/convenience.hpp>
+#include <boost/filesystem/operations.hpp>
 namespace fs = boost::filesystem;
 
 #include <vw/FileIO/DiskImageResource.h>
@@ -67,6 +68,20 @@ namespace mosaic {
     return boost::shared_ptr<DstImageResource>( DiskImageResource::create( info.filepath+info.filetype, format ) );
   }
 
+  boost::shared_ptr<SrcImageResource> QuadTreeGenerator::default_tile_source_func::operator()( QuadTreeGenerator const& qtree, TileInfo const& info ) {
+    std::vector<std::string> filetypes;
+    if( qtree.get_file_type() == "auto" ) {
+      filetypes.push_back( ".png" );
+      filetypes.push_back( ".jpg" );
+    }
+    else filetypes.push_back( info.filetype );
+    for( unsigned i=0; i<filetypes.size(); ++i ) {
+      if( fs::exists( info.filepath + filetypes[i] ) )
+        return boost::shared_ptr<SrcImageResource>( DiskImageResource::open( info.filepath + filetypes[i] ) );
+    }
+    return boost::shared_ptr<SrcImageResource>();
+  }
+
   void QuadTreeGenerator::generate( const ProgressCallback &progress_callback ) {
     ScopedWatch sw("QuadTreeGenerator::generate");
     int32 tree_levels = get_tree_levels();
@@ -74,6 +89,8 @@ namespace mosaic {
     vw_out(DebugMessage, "mosaic") << "Using tile size: " << m_tile_size << " pixels" << std::endl;
     vw_out(DebugMessage, "mosaic") << "Generating tile files of type: " << m_file_type << std::endl;
     vw_out(DebugMessage, "mosaic") << "Generating quadtree with " << tree_levels << " levels." << std::endl;
+    if( ! m_dirty_bbox.empty() )
+      vw_out(DebugMessage, "mosaic") << "Regenerating only the tiles overlapping " << m_dirty_bbox << std::endl;
 
     BBox2i region_bbox = BBox2i(0,0,m_tile_size,m_tile_size) * (1<<(tree_levels-1));
     m_processor->generate( region_bbox, progress_callback );
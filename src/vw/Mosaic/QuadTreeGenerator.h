@@ -13,6 +13,7 @@
 #define __VW_MOSAIC_QUADTREEGENERATOR_H__
 
 #include <vector>
+#include <deque>
 #include <map>
 #include <string>
 #include <fstream>
@@ -20,13 +21,18 @@
 #include <boost/function.hpp>
 
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Settings.h>
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/SparseImageCheck.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
+#include <vw/Image/ImageIO.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/Filter.h>
+#include <vw/FileIO/DiskImageView.h>
 
 
 namespace vw {
@@ -54,6 +60,7 @@ namespace mosaic {
     typedef boost::function<std::string(QuadTreeGenerator const&, std::string const&)> image_path_func_type;
     typedef boost::function<std::vector<std::pair<std::string,BBox2i> >(QuadTreeGenerator const&, std::string const&, BBox2i const&)> branch_func_type;
     typedef boost::function<boost::shared_ptr<DstImageResource>(QuadTreeGenerator const&, TileInfo const&, ImageFormat const&)> tile_resource_func_type;
+    typedef boost::function<boost::shared_ptr<SrcImageResource>(QuadTreeGenerator const&, TileInfo const&)> tile_source_func_type;
     typedef boost::function<void(QuadTreeGenerator const&, TileInfo const&)> metadata_func_type;
     typedef boost::function<bool(BBox2i const&)> sparse_image_check_type;
 
@@ -74,11 +81,14 @@ namespace mosaic {
         m_crop_bbox(),
         m_crop_images( false ),
         m_cull_images( false ),
+        m_parallel( false ),
+        m_dirty_bbox(),
         m_dimensions( image.impl().cols(), image.impl().rows() ),
         m_processor( new Processor<typename ImageT::pixel_type>( this, image.impl() ) ),
         m_image_path_func( simple_image_path() ),
         m_branch_func( default_branch_func() ),
         m_tile_resource_func( default_tile_resource_func() ),
+        m_tile_source_func( default_tile_source_func() ),
         m_metadata_func(),
         m_sparse_image_check( SparseImageCheck<ImageT>(image.impl()) )
     {}
@@ -152,6 +162,31 @@ namespace mosaic {
       m_cull_images = cull;
     }
 
+    bool get_parallel() const {
+      return m_parallel;
+    }
+
+    /// Generate the tiles in vw_thread_pool() rather than one at a
+    /// time.  The hooks are still called one at a time, but not
+    /// necessarily from the calling thread or in tree order.
+    void set_parallel( bool parallel ) {
+      m_parallel = parallel;
+    }
+
+    BBox2i const& get_dirty_bbox() const {
+      return m_dirty_bbox;
+    }
+
+    /// Regenerate only the tiles that overlap the given region of the
+    /// source, together with their ancestors, and leave the rest of
+    /// an existing tree as it is.  The tiles of the unchanged branches
+    /// that the ancestors are composed from are read back through the
+    /// tile source function.  An empty bbox, the default, regenerates
+    /// the whole tree.  Not supported together with cropped images.
+    void set_dirty_bbox( BBox2i const& bbox ) {
+      m_dirty_bbox = bbox;
+    }
+
     void set_image_path_func( image_path_func_type image_path_func ) {
       m_image_path_func = image_path_func;
     }
@@ -172,10 +207,22 @@ namespace mosaic {
       m_tile_resource_func = tile_resource_func;
     }
 
+    tile_resource_func_type const& get_tile_resource_func() const {
+      return m_tile_resource_func;
+    }
+
     boost::shared_ptr<DstImageResource> tile_resource(TileInfo const& info, ImageFormat const& format) const {
       return m_tile_resource_func( *this, info, format );
     }
 
+    void set_tile_source_func( tile_source_func_type const& tile_source_func ) {
+      m_tile_source_func = tile_source_func;
+    }
+
+    boost::shared_ptr<SrcImageResource> tile_source( TileInfo const& info ) const {
+      return m_tile_source_func( *this, info );
+    }
+
     void set_metadata_func( metadata_func_type metadata_func ) {
       m_metadata_func = metadata_func;
     }
@@ -219,30 +266,202 @@ namespace mosaic {
       boost::shared_ptr<DstImageResource> operator()( QuadTreeGenerator const& qtree, TileInfo const& info, ImageFormat const& format );
     };
 
+    // The default tile source function, opens the tile previously
+    // written by the default resource function, or returns an empty
+    // pointer if there is none
+    struct default_tile_source_func {
+      boost::shared_ptr<SrcImageResource> operator()( QuadTreeGenerator const& qtree, TileInfo const& info );
+    };
+
   protected:
     template <class PixelT>
     class Processor : public ProcessorBase {
       ImageViewRef<PixelT> m_source;
+      std::vector<ImageViewRef<PixelT> > m_overviews; // Level l+1 of the source, if it has them
+      Mutex m_hook_mutex; // Serializes calls to the generator's hooks
+
+      // State shared by the tasks of one parallel generate().  The
+      // first failure is recorded here and rethrown by generate(),
+      // and the tasks still waiting to run return without doing
+      // anything.
+      struct ParallelState {
+        Mutex mutex;
+        size_t frames, max_frames;
+        bool failed, aborted;
+        std::string error;
+        ParallelState( size_t max_frames ) : frames(0), max_frames(max_frames), failed(false), aborted(false) {}
+        bool has_failed() {
+          Mutex::Lock lock(mutex);
+          return failed;
+        }
+        void fail( bool was_aborted, std::string const& what ) {
+          Mutex::Lock lock(mutex);
+          if( failed ) return;
+          failed = true;
+          aborted = was_aborted;
+          error = what;
+        }
+      };
+
+      // Generates one branch of the tree in the thread pool, keeping
+      // the resulting tile for its parent.
+      class BranchTask : public Task {
+        Processor &m_processor;
+        std::string m_name;
+        BBox2i m_region_bbox;
+        SubProgressCallback m_progress_callback;
+        ParallelState &m_state;
+        ImageView<PixelT> m_image;
+        bool m_opaque;
+      public:
+        BranchTask( Processor &processor, std::string const& name, BBox2i const& region_bbox,
+                    SubProgressCallback const& progress_callback, ParallelState &state )
+          : m_processor(processor), m_name(name), m_region_bbox(region_bbox),
+            m_progress_callback(progress_callback), m_state(state), m_opaque(false) {}
+
+        virtual void operator()() {
+          if( m_state.has_failed() ) return;
+          try {
+            m_image = m_processor.generate_branch_parallel( m_name, m_region_bbox, m_progress_callback, m_state, m_opaque );
+          }
+          catch( Aborted const& e ) {
+            m_state.fail( true, e.what() );
+          }
+          catch( Exception const& e ) {
+            m_state.fail( false, e.name() + ": " + e.desc() );
+          }
+          catch( std::exception const& e ) {
+            m_state.fail( false, e.what() );
+          }
+        }
 
-    public:
-      template <class ImageT>
-      Processor( QuadTreeGenerator *qtree, ImageT const& source )
-        : ProcessorBase( qtree ), m_source( source )
-      {}
+        ImageView<PixelT> const& image() const { return m_image; }
+        bool opaque() const { return m_opaque; }
+      };
+
+      // Writes one tile and its metadata in vw_thread_pool(), so that
+      // the serial generate() can go on to the next tile meanwhile.
+      // The resource is created beforehand, under the hook lock, and
+      // any failure is recorded for generate() to rethrow.
+      class WriteTask : public Task {
+        Processor &m_processor;
+        TileInfo m_info;
+        ImageView<PixelT> m_image;
+        boost::shared_ptr<DstImageResource> m_resource;
+        size_t m_bytes;
+        bool m_failed;
+        std::string m_error;
+      public:
+        WriteTask( Processor &processor, TileInfo const& info, ImageView<PixelT> const& image,
+                   boost::shared_ptr<DstImageResource> const& resource, size_t bytes )
+          : m_processor(processor), m_info(info), m_image(image), m_resource(resource),
+            m_bytes(bytes), m_failed(false) {}
+
+        virtual void operator()() {
+          try {
+            {
+              ScopedWatch sw("QuadTreeGenerator::write_tile");
+              write_image( *m_resource, m_image );
+              m_resource.reset();
+            }
+            m_image.reset();
+            m_processor.write_metadata( m_info );
+          }
+          catch( Exception const& e ) {
+            m_failed = true;
+            m_error = e.name() + ": " + e.desc();
+          }
+          catch( std::exception const& e ) {
+            m_failed = true;
+            m_error = e.what();
+          }
+          m_resource.reset();
+          m_image.reset();
+        }
 
-      void generate( BBox2i const& region_bbox, const ProgressCallback &progress_callback ) {
-        generate_branch( "", region_bbox, progress_callback );
+        size_t bytes() const { return m_bytes; }
+        bool failed() const { return m_failed; }
+        std::string const& error() const { return m_error; }
+      };
+
+      // The tile writes queued by the serial generate(), oldest first,
+      // and the memory held by their tiles.
+      bool m_write_behind;
+      std::deque<boost::shared_ptr<WriteTask> > m_writes;
+      size_t m_write_bytes;
+
+      // Waits for the oldest queued writes until no more than
+      // max_bytes of tiles remain queued, rethrowing the first
+      // failure.  Waiting on the pool runs other tasks meanwhile, so
+      // this is safe even from a pool thread.
+      void finish_writes( size_t max_bytes ) {
+        while( ! m_writes.empty() && m_write_bytes > max_bytes ) {
+          boost::shared_ptr<WriteTask> task = m_writes.front();
+          m_writes.pop_front();
+          vw_thread_pool().wait( task );
+          m_write_bytes -= task->bytes();
+          if( task->failed() ) {
+            Exception e;
+            e.set( task->error() );
+            vw_throw( e );
+          }
+        }
       }
 
-      ImageView<PixelT> generate_branch( std::string const& name, BBox2i const& region_bbox, const ProgressCallback &progress_callback ) {
-        progress_callback.report_progress(0);
-        progress_callback.abort_if_requested();
+      // Waits for every queued write, ignoring failures, before
+      // generate() leaves because of another error.
+      void abandon_writes() {
+        for( size_t i=0; i<m_writes.size(); ++i ) vw_thread_pool().wait( m_writes[i] );
+        m_writes.clear();
+        m_write_bytes = 0;
+      }
 
-        ImageView<PixelT> image;
-        TileInfo info;
-        info.name = name;
-        info.region_bbox = region_bbox;
+      void write_metadata( TileInfo const& info ) {
+        Mutex::Lock lock(m_hook_mutex);
+        if( qtree->m_metadata_func ) qtree->m_metadata_func( *qtree, info );
+      }
 
+      // Whether write_tile() has any use for knowing that a tile is
+      // opaque, which otherwise is not worth working out.
+      bool need_opacity() const {
+        return qtree->m_file_type == "auto" || qtree->m_crop_images || qtree->m_cull_images;
+      }
+
+      // The opacity of a tile that was not composed from its children.
+      bool tile_opacity( ImageView<PixelT> const& image ) const {
+        if( ! PixelHasAlpha<PixelT>::value ) return true;
+        return need_opacity() && image && is_opaque( image );
+      }
+
+      // Subsamples a child tile into its place in the parent, and
+      // returns the area of the parent it made opaque.  A parent
+      // covered entirely by opaque children is opaque itself, so
+      // composing the tree works out the opacity of every tile from
+      // that of the leaves.  Box filters with power-of-two factors
+      // average opaque pixels exactly; the part of the parent made
+      // from any other child is checked directly, which stops at the
+      // first transparent pixel.
+      int64 compose_child( ImageView<PixelT> &image, TileInfo const& info, Vector2i const& scale,
+                           BBox2i const& child_region, ImageView<PixelT> const& child, bool child_opaque ) {
+        BBox2i dst_bbox = elem_quot( child_region - info.region_bbox.min(), scale );
+        Vector2i factor = elem_quot( qtree->m_tile_size, dst_bbox.size() );
+        crop(image,dst_bbox) = box_subsample( child, factor );
+        int64 area = int64(dst_bbox.width()) * dst_bbox.height();
+        if( child_opaque && ! ( factor.x() & (factor.x()-1) ) && ! ( factor.y() & (factor.y()-1) ) ) return area;
+        if( need_opacity() && is_opaque( crop(image,dst_bbox) ) ) return area;
+        return 0;
+      }
+
+      bool composed_opacity( int64 opaque_area ) const {
+        if( ! PixelHasAlpha<PixelT>::value ) return true;
+        return opaque_area == int64(qtree->m_tile_size) * qtree->m_tile_size;
+      }
+
+      // Fills in the tile's bounding boxes.  Returns false if there is
+      // no data to generate the tile from, or if the tile is outside
+      // the dirty region, in which case image is set to the blank or
+      // existing tile to use, if any.
+      bool begin_tile( TileInfo &info, ImageView<PixelT> &image ) {
         BBox2i crop_bbox(Vector2i(), qtree->get_dimensions());
         if( ! qtree->get_crop_bbox().empty() ) crop_bbox.crop( qtree->get_crop_bbox() );
         info.image_bbox = info.region_bbox;
@@ -251,44 +470,117 @@ namespace mosaic {
         if( info.image_bbox.empty() ) {
           if( ! (qtree->get_crop_images() || qtree->get_cull_images()) )
             image.set_size( qtree->get_tile_size(), qtree->get_tile_size() );
-          return image;
+          return false;
         }
 
-        if( qtree->m_sparse_image_check && ! qtree->m_sparse_image_check(info.region_bbox) ) return image;
+        if( ! qtree->m_dirty_bbox.empty() && ! info.region_bbox.intersects( qtree->m_dirty_bbox ) ) {
+          image = existing_tile( info );
+          return false;
+        }
 
-        Vector2i scale = info.region_bbox.size() / qtree->m_tile_size;
+        Mutex::Lock lock(m_hook_mutex);
+        return ! qtree->m_sparse_image_check || qtree->m_sparse_image_check(info.region_bbox);
+      }
 
-        std::vector<std::pair<std::string, BBox2i> > children = qtree->m_branch_func(*qtree,info.name,info.region_bbox);
-        if( children.empty() ) {
-          image = crop( m_source, info.image_bbox );
-          if( info.image_bbox != info.region_bbox ) {
-            image = edge_extend( image, info.region_bbox - info.image_bbox.min(), ZeroEdgeExtension() );
+      // Reads back a tile that was written by an earlier run.  A
+      // missing tile was empty, or culled.
+      ImageView<PixelT> existing_tile( TileInfo &info ) {
+        boost::shared_ptr<SrcImageResource> r;
+        {
+          Mutex::Lock lock(m_hook_mutex);
+          info.filepath = qtree->m_image_path_func( *qtree, info.name );
+          if( qtree->m_file_type != "auto" ) info.filetype = "." + qtree->m_file_type;
+          r = qtree->m_tile_source_func( *qtree, info );
+        }
+        ImageView<PixelT> image;
+        if( ! r ) return image;
+        read_image( image, *r );
+        VW_ASSERT( image.cols() == qtree->m_tile_size && image.rows() == qtree->m_tile_size,
+                   IOErr() << "QuadTreeGenerator: existing tile " << info.filepath << info.filetype
+                   << " is not " << qtree->m_tile_size << " pixels square." );
+        return image;
+      }
+
+      std::vector<std::pair<std::string, BBox2i> > branches( TileInfo const& info ) {
+        Mutex::Lock lock(m_hook_mutex);
+        return qtree->m_branch_func(*qtree,info.name,info.region_bbox);
+      }
+
+      // Sources on disk with reduced-resolution levels provide them,
+      // so that coarse leaves are read from those rather than from
+      // the full image.
+      template <class ImageT>
+      void add_overviews( ImageT const& ) {}
+
+      void add_overviews( DiskImageView<PixelT> const& source ) {
+        for( int32 level = 1; level <= source.overview_levels(); ++level )
+          m_overviews.push_back( source.overview( level ) );
+      }
+
+      static int32 ceil_div( int32 a, int32 b ) {
+        return (a >= 0) ? (a + b - 1) / b : -((-a) / b);
+      }
+
+      // The deepest overview that a leaf at this scale can be
+      // sampled from directly, or 0 if there is none.
+      int32 overview_level( TileInfo const& info, Vector2i const& scale ) const {
+        int32 level = 0;
+        while( level < int32(m_overviews.size()) ) {
+          int32 factor = 2 << level;
+          if( scale.x() % factor || scale.y() % factor ||
+              info.region_bbox.min().x() % factor || info.region_bbox.min().y() % factor )
+            break;
+          ++level;
+        }
+        return level;
+      }
+
+      ImageView<PixelT> leaf_tile( TileInfo const& info, Vector2i const& scale ) const {
+        int32 level = overview_level( info, scale );
+        if( level > 0 ) {
+          // The same pixels as the full-resolution path would sample,
+          // in the coordinates of the overview.
+          int32 factor = 1 << level;
+          ImageViewRef<PixelT> const& overview = m_overviews[level-1];
+          BBox2i region( info.region_bbox.min() / factor, info.region_bbox.min() / factor + info.region_bbox.size() / factor );
+          BBox2i bbox( region.min() + Vector2i( ceil_div( info.image_bbox.min().x() - info.region_bbox.min().x(), factor ),
+                                                ceil_div( info.image_bbox.min().y() - info.region_bbox.min().y(), factor ) ),
+                       region.min() + Vector2i( ceil_div( info.image_bbox.max().x() - info.region_bbox.min().x(), factor ),
+                                                ceil_div( info.image_bbox.max().y() - info.region_bbox.min().y(), factor ) ) );
+          bbox.crop( BBox2i( 0, 0, overview.cols(), overview.rows() ) );
+          ImageView<PixelT> image;
+          if( bbox.empty() ) image.set_size( region.width(), region.height() );
+          else {
+            image = crop( overview, bbox );
+            if( bbox != region ) image = edge_extend( image, region - bbox.min(), ZeroEdgeExtension() );
           }
-          if( info.region_bbox.width() != qtree->m_tile_size || info.region_bbox.height() != qtree->m_tile_size ) {
-            image = subsample( image, scale.x(), scale.y() );
+          if( scale.x() != factor || scale.y() != factor ) {
+            image = subsample( image, scale.x() / factor, scale.y() / factor );
           }
+          return image;
         }
-        else {
-          image.set_size(qtree->m_tile_size,qtree->m_tile_size);
-          double total_area = (double) info.image_bbox.width() * info.image_bbox.height();
-          for( unsigned i=0; i<children.size(); ++i ) {
-            BBox2i image_bbox = children[i].second;
-            image_bbox.crop( info.image_bbox );
-            if( image_bbox.empty() ) continue;
-            double child_area = (double) image_bbox.width() * image_bbox.height();
-            double progress = progress_callback.progress();
-            SubProgressCallback spc( progress_callback, progress, progress + child_area/total_area );
-            ImageView<PixelT> child = generate_branch(children[i].first, children[i].second, spc);
-            if( ! child ) continue;
-            BBox2i dst_bbox = elem_quot( children[i].second - info.region_bbox.min(), scale );
-            crop(image,dst_bbox) = box_subsample( child, elem_quot(qtree->m_tile_size,dst_bbox.size()) );
-          }
+
+        ImageView<PixelT> image = crop( m_source, info.image_bbox );
+        if( info.image_bbox != info.region_bbox ) {
+          image = edge_extend( image, info.region_bbox - info.image_bbox.min(), ZeroEdgeExtension() );
+        }
+        if( info.region_bbox.width() != qtree->m_tile_size || info.region_bbox.height() != qtree->m_tile_size ) {
+          image = subsample( image, scale.x(), scale.y() );
         }
+        return image;
+      }
 
+      // Crops or culls the tile as configured, writes it, and writes
+      // its metadata.  Only the hooks are serialized; the tiles
+      // themselves are encoded and written concurrently, by the
+      // branch tasks in parallel mode or by queued write tasks in
+      // serial mode.  An opaque tile needs no scan to find its data
+      // or its file type.
+      void write_tile( TileInfo &info, ImageView<PixelT> const& image, Vector2i const& scale, bool opaque ) {
         ImageView<PixelT> cropped_image = image;
         if( qtree->m_crop_images || qtree->m_cull_images ) {
           BBox2i data_bbox = elem_quot( info.image_bbox-info.region_bbox.min(), scale );
-          if( PixelHasAlpha<PixelT>::value )
+          if( PixelHasAlpha<PixelT>::value && ! opaque )
             data_bbox.crop( nonzero_data_bounding_box( image ) );
           if( data_bbox.width() != qtree->m_tile_size || data_bbox.height() != qtree->m_tile_size ) {
             if( data_bbox.empty() ) cropped_image.reset();
@@ -296,28 +588,224 @@ namespace mosaic {
               cropped_image = crop( image, data_bbox );
             }
             info.image_bbox = elem_prod(data_bbox,scale) + info.region_bbox.min();
+            opaque = is_opaque( cropped_image );
           }
         }
 
         if( qtree->m_file_type == "auto" ) {
-          if( is_opaque( cropped_image ) ) info.filetype += ".jpg";
+          if( opaque ) info.filetype += ".jpg";
           else info.filetype += ".png";
         }
         else {
           info.filetype = "." + qtree->m_file_type;
         }
 
-        info.filepath = qtree->m_image_path_func( *qtree, info.name );
+        boost::shared_ptr<DstImageResource> r;
+        {
+          Mutex::Lock lock(m_hook_mutex);
+          info.filepath = qtree->m_image_path_func( *qtree, info.name );
+          if( cropped_image ) r = qtree->m_tile_resource_func( *qtree, info, cropped_image.format() );
+        }
+        if( cropped_image && m_write_behind ) {
+          size_t bytes = size_t(cropped_image.cols()) * cropped_image.rows() * cropped_image.planes() * sizeof(PixelT);
+          size_t max_bytes = vw_settings().write_pool_memory();
+          finish_writes( max_bytes - (std::min)( bytes, max_bytes ) );
+          boost::shared_ptr<WriteTask> task( new WriteTask( *this, info, cropped_image, r, bytes ) );
+          m_writes.push_back( task );
+          m_write_bytes += bytes;
+          vw_thread_pool().add_task( task );
+          return;
+        }
         if( cropped_image ) {
           ScopedWatch sw("QuadTreeGenerator::write_tile");
-          boost::shared_ptr<DstImageResource> r = qtree->m_tile_resource_func( *qtree, info, cropped_image.format() );
           write_image( *r, cropped_image );
+          r.reset();
         }
-        if( qtree->m_metadata_func ) qtree->m_metadata_func( *qtree, info );
+        write_metadata( info );
+      }
+
+    public:
+      template <class ImageT>
+      Processor( QuadTreeGenerator *qtree, ImageT const& source )
+        : ProcessorBase( qtree ), m_source( source ), m_write_behind( false ), m_write_bytes( 0 )
+      {
+        add_overviews( source );
+      }
+
+      void generate( BBox2i const& region_bbox, const ProgressCallback &progress_callback ) {
+        VW_ASSERT( qtree->m_dirty_bbox.empty() || ! qtree->m_crop_images,
+                   NoImplErr() << "QuadTreeGenerator: cannot update a tree of cropped images." );
+        if( ! qtree->get_parallel() ) {
+          bool opaque;
+          m_write_behind = true;
+          try {
+            generate_branch( "", region_bbox, progress_callback, opaque );
+            finish_writes( 0 );
+          }
+          catch( ... ) {
+            abandon_writes();
+            m_write_behind = false;
+            throw;
+          }
+          m_write_behind = false;
+          return;
+        }
+
+        // Every branch being composed holds at most four child tiles
+        // and its own, so capping the number of such branches bounds
+        // the tiles in memory.  Past the cap, branches generate their
+        // children themselves instead of queueing them.
+        size_t tile_bytes = size_t(qtree->m_tile_size) * qtree->m_tile_size * m_source.planes() * sizeof(PixelT);
+        size_t max_frames = (std::max)( size_t(vw_settings().default_num_threads()) * qtree->get_tree_levels(),
+                                        vw_settings().write_pool_memory() / (5*tile_bytes + 1) );
+        ParallelState state( max_frames );
+        progress_callback.report_progress(0);
+        // Every tile ticks the progress, from many threads at once
+        AtomicProgressCallback tile_progress( progress_callback );
+        boost::shared_ptr<BranchTask> root( new BranchTask( *this, "", region_bbox,
+                                                            SubProgressCallback( tile_progress, 0.0, 1.0 ), state ) );
+        vw_thread_pool().add_task( root );
+        vw_thread_pool().wait( root );
+        tile_progress.flush();
+
+        if( state.aborted ) vw_throw( Aborted() << state.error );
+        if( state.failed ) {
+          Exception e;
+          e.set( state.error );
+          vw_throw( e );
+        }
+      }
+
+      ImageView<PixelT> generate_branch( std::string const& name, BBox2i const& region_bbox,
+                                         const ProgressCallback &progress_callback, bool &opaque ) {
+        progress_callback.report_progress(0);
+        progress_callback.abort_if_requested();
+
+        ImageView<PixelT> image;
+        TileInfo info;
+        info.name = name;
+        info.region_bbox = region_bbox;
+
+        if( ! begin_tile( info, image ) ) {
+          opaque = tile_opacity( image );
+          return image;
+        }
+
+        Vector2i scale = info.region_bbox.size() / qtree->m_tile_size;
+
+        std::vector<std::pair<std::string, BBox2i> > children = branches( info );
+        if( children.empty() ) {
+          image = leaf_tile( info, scale );
+          opaque = tile_opacity( image );
+        }
+        else {
+          image.set_size(qtree->m_tile_size,qtree->m_tile_size);
+          double total_area = (double) info.image_bbox.width() * info.image_bbox.height();
+          int64 opaque_area = 0;
+          for( unsigned i=0; i<children.size(); ++i ) {
+            BBox2i image_bbox = children[i].second;
+            image_bbox.crop( info.image_bbox );
+            if( image_bbox.empty() ) continue;
+            // Let a cache-backed source start on the next full-resolution
+            // tile while this one is generated.
+            if( i+1 < children.size() && children[i+1].second.size() == Vector2i(qtree->m_tile_size,qtree->m_tile_size) ) {
+              BBox2i next_bbox = children[i+1].second;
+              next_bbox.crop( info.image_bbox );
+              if( ! next_bbox.empty() ) prefetch( m_source, next_bbox );
+            }
+            double child_area = (double) image_bbox.width() * image_bbox.height();
+            double progress = progress_callback.progress();
+            SubProgressCallback spc( progress_callback, progress, progress + child_area/total_area );
+            bool child_opaque;
+            ImageView<PixelT> child = generate_branch(children[i].first, children[i].second, spc, child_opaque);
+            if( ! child ) continue;
+            opaque_area += compose_child( image, info, scale, children[i].second, child, child_opaque );
+          }
+          opaque = composed_opacity( opaque_area );
+        }
+
+        write_tile( info, image, scale, opaque );
 
         progress_callback.report_progress(1);
         return image;
       }
+
+      // The parallel counterpart of generate_branch().  Each child is
+      // generated by a task in vw_thread_pool(), and the parent waits
+      // on all four before subsampling them, running other queued
+      // tiles in the meantime.  Progress is reported incrementally,
+      // as each part of the tree is finished, since the children of a
+      // branch finish in no particular order.
+      ImageView<PixelT> generate_branch_parallel( std::string const& name, BBox2i const& region_bbox,
+                                                  const ProgressCallback &progress_callback, ParallelState &state,
+                                                  bool &opaque ) {
+        progress_callback.abort_if_requested();
+
+        ImageView<PixelT> image;
+        TileInfo info;
+        info.name = name;
+        info.region_bbox = region_bbox;
+
+        if( ! begin_tile( info, image ) ) {
+          opaque = tile_opacity( image );
+          progress_callback.report_incremental_progress(1);
+          return image;
+        }
+
+        Vector2i scale = info.region_bbox.size() / qtree->m_tile_size;
+        double reported = 0;
+
+        std::vector<std::pair<std::string, BBox2i> > children = branches( info );
+        if( children.empty() ) {
+          image = leaf_tile( info, scale );
+          opaque = tile_opacity( image );
+        }
+        else {
+          bool queue_children;
+          {
+            Mutex::Lock lock(state.mutex);
+            queue_children = state.frames < state.max_frames;
+            if( queue_children ) state.frames++;
+          }
+
+          image.set_size(qtree->m_tile_size,qtree->m_tile_size);
+          double total_area = (double) info.image_bbox.width() * info.image_bbox.height();
+          std::vector<boost::shared_ptr<BranchTask> > tasks( children.size() );
+          for( unsigned i=0; i<children.size(); ++i ) {
+            BBox2i image_bbox = children[i].second;
+            image_bbox.crop( info.image_bbox );
+            if( image_bbox.empty() ) continue;
+            double child_area = (double) image_bbox.width() * image_bbox.height();
+            SubProgressCallback spc( progress_callback, reported, reported + child_area/total_area );
+            reported += child_area/total_area;
+            tasks[i].reset( new BranchTask( *this, children[i].first, children[i].second, spc, state ) );
+            if( queue_children ) vw_thread_pool().add_task( tasks[i] );
+            else (*tasks[i])();
+          }
+
+          // The tasks refer to this frame, so they must all finish
+          // before we leave it, even if one of them failed.
+          if( queue_children ) {
+            for( unsigned i=0; i<tasks.size(); ++i )
+              if( tasks[i] ) vw_thread_pool().wait( tasks[i] );
+            Mutex::Lock lock(state.mutex);
+            state.frames--;
+          }
+          if( state.has_failed() ) return ImageView<PixelT>();
+
+          int64 opaque_area = 0;
+          for( unsigned i=0; i<tasks.size(); ++i ) {
+            if( ! tasks[i] || ! tasks[i]->image() ) continue;
+            opaque_area += compose_child( image, info, scale, children[i].second, tasks[i]->image(), tasks[i]->opaque() );
+          }
+          opaque = composed_opacity( opaque_area );
+        }
+
+        write_tile( info, image, scale, opaque );
+
+        progress_callback.report_incremental_progress( (std::max)( 0.0, 1.0 - reported ) );
+        return image;
+      }
     };
 
     template<class> friend class Processor;
@@ -328,12 +816,15 @@ namespace mosaic {
     BBox2i m_crop_bbox;
     bool m_crop_images;
     bool m_cull_images;
+    bool m_parallel;
+    BBox2i m_dirty_bbox;
     Vector2i m_dimensions;
     boost::shared_ptr<ProcessorBase> m_processor;
 
     image_path_func_type m_image_path_func;
     branch_func_type m_branch_func;
     tile_resource_func_type m_tile_resource_func;
+    tile_source_func_type m_tile_source_func;
     metadata_func_type m_metadata_func;
     sparse_image_check_type m_sparse_image_check;
   };
@@ -0,0 +1,310 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Mosaic/TilePack.h>
+#include <vw/FileIO/DiskImageResource.h>
+#include <vw/FileIO/TemporaryFile.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Log.h>
+
+#include <cstring>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+namespace fs = boost::filesystem;
+
+// A pack file is a sequence of blocks, each starting with a four-byte
+// tag.  A tile record is "VWTR", the uint32 name size, the uint64 data
+// size, the name and the data.  An index is "VWTI", the uint64 size of
+// the whole block, the uint64 number of entries, each of them the
+// uint32 name size, the name, and the uint64 offset and size of the
+// data, and finally the uint64 offset of the block and the pack magic.
+// The last index in the file, if it ends the file, is the current one.
+namespace {
+  const char record_tag[4] = { 'V','W','T','R' };
+  const char index_tag[4] = { 'V','W','T','I' };
+  const char pack_magic[8] = { 'V','W','P','A','C','K','1','\0' };
+
+  typedef std::map<std::string, std::pair<vw::uint64,vw::uint64> > PackIndex;
+
+  template <class T>
+  bool read_value( std::istream &f, T &value ) {
+    f.read( (char*)&value, sizeof(value) );
+    return bool(f);
+  }
+
+  template <class T>
+  void write_value( std::ostream &f, T const& value ) {
+    f.write( (char const*)&value, sizeof(value) );
+  }
+
+  bool read_string( std::istream &f, vw::uint32 size, std::string &s ) {
+    s.assign( size, '\0' );
+    if( size ) f.read( &s[0], size );
+    return bool(f);
+  }
+
+  // Reads the index block at the given offset.
+  bool read_index( std::istream &f, vw::uint64 offset, vw::uint64 file_size, PackIndex &index ) {
+    char tag[4];
+    vw::uint64 block_size = 0, count = 0;
+    f.clear();
+    f.seekg( offset );
+    f.read( tag, sizeof(tag) );
+    if( ! f || memcmp( tag, index_tag, sizeof(tag) ) != 0 ) return false;
+    if( ! read_value( f, block_size ) || ! read_value( f, count ) ) return false;
+    if( offset + block_size != file_size ) return false;
+    PackIndex result;
+    for( vw::uint64 i=0; i<count; ++i ) {
+      vw::uint32 name_size = 0;
+      vw::uint64 data_offset = 0, data_size = 0;
+      std::string name;
+      if( ! read_value( f, name_size ) || name_size > block_size ) return false;
+      if( ! read_string( f, name_size, name ) ) return false;
+      if( ! read_value( f, data_offset ) || ! read_value( f, data_size ) ) return false;
+      if( data_offset + data_size > offset ) return false;
+      result[name] = std::make_pair( data_offset, data_size );
+    }
+    index.swap( result );
+    return true;
+  }
+
+  // Reads the index of a pack file, from the index at its end if
+  // there is one, or else by scanning its records.  Returns false if
+  // the scan stopped short of the end of the file.
+  bool load_index( std::istream &f, PackIndex &index ) {
+    index.clear();
+    f.clear();
+    f.seekg( 0, std::ios::end );
+    vw::uint64 file_size = f.tellg();
+    if( file_size == 0 ) return true;
+
+    if( file_size >= sizeof(vw::uint64) + sizeof(pack_magic) ) {
+      char magic[sizeof(pack_magic)];
+      vw::uint64 offset = 0;
+      f.seekg( file_size - sizeof(vw::uint64) - sizeof(pack_magic) );
+      if( read_value( f, offset ) && f.read( magic, sizeof(magic) ) &&
+          memcmp( magic, pack_magic, sizeof(magic) ) == 0 && offset < file_size &&
+          read_index( f, offset, file_size, index ) )
+        return true;
+    }
+
+    vw::vw_out(vw::WarningMessage, "mosaic") << "Pack file has no index; scanning its tiles." << std::endl;
+    f.clear();
+    f.seekg( 0 );
+    vw::uint64 pos = 0;
+    while( pos < file_size ) {
+      char tag[4];
+      f.read( tag, sizeof(tag) );
+      if( ! f ) return false;
+      if( memcmp( tag, record_tag, sizeof(tag) ) == 0 ) {
+        vw::uint32 name_size = 0;
+        vw::uint64 data_size = 0;
+        std::string name;
+        if( ! read_value( f, name_size ) || ! read_value( f, data_size ) ) return false;
+        if( ! read_string( f, name_size, name ) ) return false;
+        vw::uint64 data_offset = pos + sizeof(tag) + sizeof(name_size) + sizeof(data_size) + name_size;
+        if( data_offset + data_size > file_size ) return false;
+        index[name] = std::make_pair( data_offset, data_size );
+        pos = data_offset + data_size;
+      }
+      else if( memcmp( tag, index_tag, sizeof(tag) ) == 0 ) {
+        vw::uint64 block_size = 0;
+        if( ! read_value( f, block_size ) || block_size == 0 || pos + block_size > file_size ) return false;
+        pos += block_size;
+      }
+      else return false;
+      f.seekg( pos );
+    }
+    return true;
+  }
+
+  // A tile being written to a temporary file by the wrapped resource
+  // function, which is moved into the pack once it is complete.  It
+  // accepts the tile in one write, so that it knows when that is.
+  class PackedTileResource : public vw::DstImageResource {
+    boost::shared_ptr<vw::mosaic::TilePackWriter> m_pack;
+    std::string m_name;
+    boost::shared_ptr<vw::TemporaryFile> m_file;
+    boost::shared_ptr<vw::DstImageResource> m_resource;
+    vw::ImageFormat m_format;
+  public:
+    PackedTileResource( boost::shared_ptr<vw::mosaic::TilePackWriter> const& pack, std::string const& name,
+                        boost::shared_ptr<vw::TemporaryFile> const& file,
+                        boost::shared_ptr<vw::DstImageResource> const& resource, vw::ImageFormat const& format )
+      : m_pack(pack), m_name(name), m_file(file), m_resource(resource), m_format(format) {}
+
+    virtual void write( vw::ImageBuffer const& buf, vw::BBox2i const& bbox ) {
+      VW_ASSERT( m_resource, vw::LogicErr() << "PackedTileResource: tile " << m_name << " was already written." );
+      VW_ASSERT( bbox == vw::BBox2i( 0, 0, m_format.cols, m_format.rows ),
+                 vw::LogicErr() << "PackedTileResource: tiles must be written in one piece." );
+      m_resource->write( buf, bbox );
+      m_resource->flush();
+      m_resource.reset();
+
+      std::ifstream f( m_file->filename().c_str(), std::ios::binary );
+      std::string data( (std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>() );
+      if( f.bad() ) vw_throw( vw::IOErr() << "Could not read back tile " << m_name << " from " << m_file->filename() );
+      m_pack->append( m_name, data );
+      m_file.reset();
+    }
+    virtual bool has_block_write() const { return false; }
+    virtual bool has_nodata_write() const { return false; }
+    virtual void flush() {}
+  };
+
+  // A tile read back from a pack, through a temporary file so that
+  // the usual driver can decode it.
+  class UnpackedTileResource : public vw::SrcImageResource {
+    boost::shared_ptr<vw::TemporaryFile> m_file;
+    boost::shared_ptr<vw::DiskImageResource> m_resource;
+  public:
+    UnpackedTileResource( boost::shared_ptr<vw::TemporaryFile> const& file )
+      : m_file(file), m_resource( vw::DiskImageResource::open( file->filename() ) ) {}
+    virtual vw::ImageFormat format() const { return m_resource->format(); }
+    virtual void read( vw::ImageBuffer const& buf, vw::BBox2i const& bbox ) const { m_resource->read( buf, bbox ); }
+    virtual bool has_block_read() const { return m_resource->has_block_read(); }
+    virtual vw::Vector2i block_read_size() const { return m_resource->block_read_size(); }
+    virtual bool has_nodata_read() const { return false; }
+  };
+}
+
+namespace vw {
+namespace mosaic {
+
+  TilePackWriter::TilePackWriter( std::string const& filename, bool append )
+    : m_filename( filename ), m_end( 0 ), m_closed( false )
+  {
+    if( append && fs::exists( filename ) ) {
+      std::ifstream f( filename.c_str(), std::ios::binary );
+      if( ! f ) vw_throw( IOErr() << "TilePackWriter: could not open " << filename );
+      if( ! load_index( f, m_index ) )
+        vw_throw( IOErr() << "TilePackWriter: " << filename << " is damaged and cannot be appended to." );
+      f.clear();
+      f.seekg( 0, std::ios::end );
+      m_end = f.tellg();
+      m_file.open( filename.c_str(), std::ios::binary | std::ios::out | std::ios::app );
+    }
+    else {
+      m_file.open( filename.c_str(), std::ios::binary | std::ios::out | std::ios::trunc );
+    }
+    if( ! m_file ) vw_throw( IOErr() << "TilePackWriter: could not open " << filename << " for writing." );
+  }
+
+  TilePackWriter::~TilePackWriter() {
+    if( m_closed ) return;
+    try {
+      close();
+    }
+    catch( std::exception const& e ) {
+      vw_out(ErrorMessage, "mosaic") << "Could not close pack file " << m_filename << ": " << e.what() << std::endl;
+    }
+  }
+
+  void TilePackWriter::append( std::string const& name, std::string const& data ) {
+    Mutex::Lock lock( m_mutex );
+    VW_ASSERT( ! m_closed, LogicErr() << "TilePackWriter: " << m_filename << " is closed." );
+    uint32 name_size = uint32( name.size() );
+    uint64 data_size = data.size();
+    m_file.write( record_tag, sizeof(record_tag) );
+    write_value( m_file, name_size );
+    write_value( m_file, data_size );
+    m_file.write( name.data(), name.size() );
+    m_file.write( data.data(), data.size() );
+    if( ! m_file ) vw_throw( IOErr() << "TilePackWriter: could not write to " << m_filename );
+    uint64 data_offset = m_end + sizeof(record_tag) + sizeof(name_size) + sizeof(data_size) + name_size;
+    m_index[name] = std::make_pair( data_offset, data_size );
+    m_end = data_offset + data_size;
+  }
+
+  void TilePackWriter::close() {
+    Mutex::Lock lock( m_mutex );
+    if( m_closed ) return;
+    m_closed = true;
+
+    uint64 block_size = sizeof(index_tag) + 2*sizeof(uint64) + sizeof(uint64) + sizeof(pack_magic);
+    for( PackIndex::const_iterator i = m_index.begin(); i != m_index.end(); ++i )
+      block_size += sizeof(uint32) + i->first.size() + 2*sizeof(uint64);
+    uint64 count = m_index.size();
+    m_file.write( index_tag, sizeof(index_tag) );
+    write_value( m_file, block_size );
+    write_value( m_file, count );
+    for( PackIndex::const_iterator i = m_index.begin(); i != m_index.end(); ++i ) {
+      write_value( m_file, uint32( i->first.size() ) );
+      m_file.write( i->first.data(), i->first.size() );
+      write_value( m_file, i->second.first );
+      write_value( m_file, i->second.second );
+    }
+    write_value( m_file, m_end );
+    m_file.write( pack_magic, sizeof(pack_magic) );
+    m_file.close();
+    if( ! m_file ) vw_throw( IOErr() << "TilePackWriter: could not write the index of " << m_filename );
+    m_end += block_size;
+  }
+
+  TilePackReader::TilePackReader( std::string const& filename )
+    : m_filename( filename ), m_file( filename.c_str(), std::ios::binary )
+  {
+    if( ! m_file ) vw_throw( IOErr() << "TilePackReader: could not open " << filename );
+    if( ! load_index( m_file, m_index ) )
+      vw_out(WarningMessage, "mosaic") << "Pack file " << filename << " is damaged; only "
+                                       << m_index.size() << " tiles could be recovered." << std::endl;
+  }
+
+  bool TilePackReader::read( std::string const& name, std::string &data ) const {
+    PackIndex::const_iterator entry = m_index.find( name );
+    if( entry == m_index.end() ) return false;
+    Mutex::Lock lock( m_mutex );
+    m_file.clear();
+    m_file.seekg( entry->second.first );
+    std::string result( entry->second.second, '\0' );
+    if( ! result.empty() ) m_file.read( &result[0], result.size() );
+    if( ! m_file ) vw_throw( IOErr() << "TilePackReader: could not read tile " << name << " from " << m_filename );
+    data.swap( result );
+    return true;
+  }
+
+  std::string tile_pack_name( QuadTreeGenerator const& qtree, QuadTreeGenerator::TileInfo const& info ) {
+    std::string const& root = qtree.get_name();
+    std::string name = info.filepath;
+    if( ! root.empty() && name.compare( 0, root.size(), root ) == 0 && name.size() > root.size() &&
+        ( name[root.size()] == '/' || name[root.size()] == '\\' ) )
+      name = name.substr( root.size() + 1 );
+    return name + info.filetype;
+  }
+
+  boost::shared_ptr<DstImageResource> packed_tile_resource_func::operator()( QuadTreeGenerator const& qtree, QuadTreeGenerator::TileInfo const& info, ImageFormat const& format ) const {
+    boost::shared_ptr<TemporaryFile> file( new TemporaryFile( vw_settings().tmp_directory(), true, "tile", info.filetype ) );
+    QuadTreeGenerator::TileInfo temp_info = info;
+    temp_info.filepath = file->filename().substr( 0, file->filename().size() - info.filetype.size() );
+    boost::shared_ptr<DstImageResource> resource = func( qtree, temp_info, format );
+    return boost::shared_ptr<DstImageResource>( new PackedTileResource( pack, tile_pack_name( qtree, info ), file, resource, format ) );
+  }
+
+  boost::shared_ptr<SrcImageResource> packed_tile_source_func::operator()( QuadTreeGenerator const& qtree, QuadTreeGenerator::TileInfo const& info ) const {
+    std::vector<std::string> filetypes;
+    if( qtree.get_file_type() == "auto" ) {
+      filetypes.push_back( ".png" );
+      filetypes.push_back( ".jpg" );
+    }
+    else filetypes.push_back( info.filetype );
+    for( unsigned i=0; i<filetypes.size(); ++i ) {
+      QuadTreeGenerator::TileInfo tile = info;
+      tile.filetype = filetypes[i];
+      std::string data;
+      if( ! pack->read( tile_pack_name( qtree, tile ), data ) ) continue;
+      boost::shared_ptr<TemporaryFile> file( new TemporaryFile( vw_settings().tmp_directory(), true, "tile", filetypes[i] ) );
+      file->write( data.data(), data.size() );
+      file->flush();
+      if( ! *file ) vw_throw( IOErr() << "Could not unpack tile " << tile_pack_name( qtree, tile ) << " to " << file->filename() );
+      return boost::shared_ptr<SrcImageResource>( new UnpackedTileResource( file ) );
+    }
+    return boost::shared_ptr<SrcImageResource>();
+  }
+
+}} // namespace vw::mosaic
@@ -0,0 +1,106 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file TilePack.h
+///
+/// Pack files, which hold the tiles of a quadtree in one large file
+/// with an index instead of one small file per tile.
+///
+#ifndef __VW_MOSAIC_TILEPACK_H__
+#define __VW_MOSAIC_TILEPACK_H__
+
+#include <map>
+#include <string>
+#include <fstream>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vw/Core/Thread.h>
+#include <vw/Mosaic/QuadTreeGenerator.h>
+
+namespace vw {
+namespace mosaic {
+
+  /// Appends named tiles, already encoded, to a pack file.  Each
+  /// record carries its name and size, so the file can be scanned
+  /// even if it was never closed; closing it appends an index of the
+  /// latest record for each name, which readers look for at the end
+  /// of the file.  Appending a name again supersedes the earlier
+  /// record, which stays in the file.  Appends may come from several
+  /// threads at once.
+  class TilePackWriter {
+    std::string m_filename;
+    std::ofstream m_file;
+    uint64 m_end;
+    std::map<std::string, std::pair<uint64,uint64> > m_index;
+    Mutex m_mutex;
+    bool m_closed;
+
+  public:
+    /// Creates the pack file, or with append set, adds to the one
+    /// already there, if any.
+    TilePackWriter( std::string const& filename, bool append = false );
+
+    /// Closes the pack, writing the index, if close() was not called.
+    ~TilePackWriter();
+
+    std::string const& filename() const { return m_filename; }
+
+    void append( std::string const& name, std::string const& data );
+
+    /// Writes the index and closes the file.
+    void close();
+  };
+
+  /// Reads tiles from a pack file, using its index if it has one, or
+  /// else scanning its records.  Reads may come from several threads
+  /// at once.
+  class TilePackReader {
+    std::string m_filename;
+    mutable std::ifstream m_file;
+    std::map<std::string, std::pair<uint64,uint64> > m_index;
+    mutable Mutex m_mutex;
+
+  public:
+    TilePackReader( std::string const& filename );
+
+    std::string const& filename() const { return m_filename; }
+    size_t size() const { return m_index.size(); }
+    bool contains( std::string const& name ) const { return m_index.count( name ) != 0; }
+
+    /// Reads the named tile, returning false if there is none.
+    bool read( std::string const& name, std::string &data ) const;
+  };
+
+  /// The name a tile is stored under in a pack: its path within the
+  /// tree, with the file type.
+  std::string tile_pack_name( QuadTreeGenerator const& qtree, QuadTreeGenerator::TileInfo const& info );
+
+  /// Wraps a QuadTreeGenerator tile resource function so that the
+  /// tiles it writes go into a pack.  Each tile is written by the
+  /// wrapped function to a temporary file, so the configuration's own
+  /// encoders are still used, and then moved into the pack.
+  struct packed_tile_resource_func {
+    boost::shared_ptr<TilePackWriter> pack;
+    QuadTreeGenerator::tile_resource_func_type func;
+    packed_tile_resource_func( boost::shared_ptr<TilePackWriter> const& pack,
+                               QuadTreeGenerator::tile_resource_func_type const& func )
+      : pack(pack), func(func) {}
+    boost::shared_ptr<DstImageResource> operator()( QuadTreeGenerator const& qtree, QuadTreeGenerator::TileInfo const& info, ImageFormat const& format ) const;
+  };
+
+  /// A QuadTreeGenerator tile source function that reads the tiles
+  /// written by packed_tile_resource_func back from the pack.
+  struct packed_tile_source_func {
+    boost::shared_ptr<TilePackReader> pack;
+    packed_tile_source_func( boost::shared_ptr<TilePackReader> const& pack ) : pack(pack) {}
+    boost::shared_ptr<SrcImageResource> operator()( QuadTreeGenerator const& qtree, QuadTreeGenerator::TileInfo const& info ) const;
+  };
+
+}} // namespace vw::mosaic
+
+#endif // __VW_MOSAIC_TILEPACK_H__
@@ -16,12 +16,21 @@
 /// TOAST projection, and requires that it be a square image with
 /// dimensions 255*2^n+1.  See Cartography/ToastTransform.h.
 ///
+/// The levels are generated from the leaves up, since each branch tile
+/// is filtered from the child tiles around it as well as its own.  If
+/// the QuadTreeGenerator is set to generate in parallel, the tiles of
+/// each level are generated by tasks that each take a branch of the
+/// tree, sharing one cache of the child tiles they read back.
+///
 #ifndef __VW_MOSAIC_TOASTQUADTREECONFIG_H__
 #define __VW_MOSAIC_TOASTQUADTREECONFIG_H__
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/convenience.hpp>
 
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Mosaic/QuadTreeGenerator.h>
 
 namespace vw {
@@ -39,6 +48,91 @@ namespace mosaic {
     };
     typedef std::list<CacheEntry> cache_t;
     cache_t m_cache;
+    Mutex m_cache_mutex;
+
+    // State shared by the tasks of one level.  The first failure is
+    // recorded here and rethrown by generate(), and the tasks still
+    // waiting to run return without doing anything.
+    struct ParallelState {
+      Mutex mutex;
+      bool failed, aborted;
+      std::string error;
+      ParallelState() : failed(false), aborted(false) {}
+      bool has_failed() {
+        Mutex::Lock lock(mutex);
+        return failed;
+      }
+      void fail( bool was_aborted, std::string const& what ) {
+        Mutex::Lock lock(mutex);
+        if( failed ) return;
+        failed = true;
+        aborted = was_aborted;
+        error = what;
+      }
+    };
+
+    // Generates the tiles of one level within one branch of the tree.
+    class BranchTask : public Task {
+      ToastProcessor &m_processor;
+      int32 m_branch_level, m_level, m_x, m_y;
+      ProgressCallback const& m_progress_callback;
+      double m_progress;
+      ParallelState &m_state;
+    public:
+      BranchTask( ToastProcessor &processor, int32 branch_level, int32 level, int32 x, int32 y,
+                  ProgressCallback const& progress_callback, double progress, ParallelState &state )
+        : m_processor(processor), m_branch_level(branch_level), m_level(level), m_x(x), m_y(y),
+          m_progress_callback(progress_callback), m_progress(progress), m_state(state) {}
+
+      virtual void operator()() {
+        if( m_state.has_failed() ) return;
+        try {
+          m_progress_callback.abort_if_requested();
+          m_processor.generate_branch( m_branch_level, m_level, m_x, m_y, ProgressCallback::dummy_instance() );
+          m_progress_callback.report_incremental_progress( m_progress );
+        }
+        catch( Aborted const& e ) {
+          m_state.fail( true, e.what() );
+        }
+        catch( Exception const& e ) {
+          m_state.fail( false, e.name() + ": " + e.desc() );
+        }
+        catch( std::exception const& e ) {
+          m_state.fail( false, e.what() );
+        }
+      }
+    };
+
+    // Generates one level of the tree in parallel, as a task for each
+    // branch at a level deep enough to give every thread several.
+    void generate_level_parallel( int32 branch_level, const ProgressCallback &progress_callback ) {
+      int32 threads = vw_settings().default_num_threads();
+      int32 level = 0;
+      while( level < branch_level && (int64(1) << (2*level)) < 16*int64(threads) ) ++level;
+      int32 num_branches = 1 << level;
+
+      ParallelState state;
+      progress_callback.report_progress(0);
+      AtomicProgressCallback tile_progress( progress_callback );
+      double progress = 1.0 / (double(num_branches) * num_branches);
+      {
+        FifoWorkQueue queue( threads );
+        for( int32 y=0; y<num_branches; ++y )
+          for( int32 x=0; x<num_branches; ++x )
+            queue.add_task( boost::shared_ptr<Task>( new BranchTask( *this, branch_level, level, x, y,
+                                                                     tile_progress, progress, state ) ) );
+        queue.join_all();
+      }
+      tile_progress.flush();
+
+      if( state.aborted ) vw_throw( Aborted() << state.error );
+      if( state.failed ) {
+        Exception e;
+        e.set( state.error );
+        vw_throw( e );
+      }
+      progress_callback.report_progress(1);
+    }
 
   public:
     template <class ImageT>
@@ -51,7 +145,10 @@ namespace mosaic {
       for( int32 level = qtree->get_tree_levels()-1; level>=0; --level ) {
         double progress = progress_callback.progress();
         SubProgressCallback spc(progress_callback, progress, 1-(1-progress)/4);
-        generate_branch( level, 0, 0, 0, spc );
+        if( qtree->get_parallel() )
+          generate_level_parallel( level, spc );
+        else
+          generate_branch( level, 0, 0, 0, spc );
       }
       progress_callback.report_progress(1);
     }
@@ -142,7 +239,8 @@ namespace mosaic {
 
     // Read a previously-written tile in from disk.  Cache the most
     // recently accessed tiles, since each will be used roughly four
-    // times.
+    // times.  The cache is shared by all the tasks of a parallel
+    // level, and tiles are read outside its lock.
     ImageView<PixelT> load_tile( int32 level, int32 x, int32 y ) {
       int32 num_tiles = 1 << level;
       if( x==-1 ) {
@@ -179,12 +277,13 @@ namespace mosaic {
       }
 
       // Check the cache
-      for( typename cache_t::iterator i=m_cache.begin(); i!=m_cache.end(); ++i ) {
-        if( i->level==level && i->x==x && i->y==y ) {
-          CacheEntry e = *i;
-          m_cache.erase(i);
-          m_cache.push_front(e);
-          return e.tile;
+      {
+        Mutex::Lock lock(m_cache_mutex);
+        for( typename cache_t::iterator i=m_cache.begin(); i!=m_cache.end(); ++i ) {
+          if( i->level==level && i->x==x && i->y==y ) {
+            m_cache.splice(m_cache.begin(), m_cache, i);
+            return i->tile;
+          }
         }
       }
 
@@ -200,6 +299,7 @@ namespace mosaic {
 
       // Save it in the cache.  The cache size of 1024 tiles was chosen
       // somewhat arbitrarily.
+      Mutex::Lock lock(m_cache_mutex);
       if( m_cache.size() >= 1024 )
         m_cache.pop_back();
       CacheEntry e;
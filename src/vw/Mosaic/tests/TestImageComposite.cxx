@@ -39,3 +39,141 @@ TEST(TestImageComposite, Basic) {
       EXPECT_EQ(2, c(col, row)) << "at (" << col << "," << row << ")";
   }
 }
+
+TEST(TestImageComposite, ManySources) {
+  // A sparse, irregular scatter of overlapping sources, checked
+  // against a brute-force search over all of them.
+  ImageComposite<uint32> c;
+  c.set_draft_mode(true);
+  std::vector<BBox2i> boxes;
+  for (uint32 k = 0; k < 200; ++k) {
+    int32 x = (k * 37) % 500, y = (k * 53) % 300;
+    c.insert(make(k+1), x, y);
+    boxes.push_back(BBox2i(x, y, 8, 8));
+  }
+  c.prepare();
+  for (int32 y = 0; y < c.rows(); y += 10) {
+    for (int32 x = 0; x < c.cols(); x += 10) {
+      BBox2i patch(x, y, 10, 10);
+      ImageView<uint32> draft = c.generate_patch(patch);
+      bool any = false;
+      for (int32 j = 0; j < patch.height(); ++j)
+        for (int32 i = 0; i < patch.width(); ++i) {
+          Vector2i p = patch.min() + Vector2i(i, j);
+          uint32 expected = 0;
+          for (uint32 k = 0; k < boxes.size(); ++k)
+            if (boxes[k].contains(p)) expected = k+1;
+          any = any || expected;
+          EXPECT_EQ(expected, draft(i, j)) << "at (" << patch.min().x()+i << "," << patch.min().y()+j << ")";
+        }
+      EXPECT_EQ(any, c.sparse_check(patch)) << "in " << patch;
+    }
+  }
+}
+
+static ImageView<PixelRGBA<float32> > make_ramp(int32 cols, int32 rows, float32 offset) {
+  ImageView<PixelRGBA<float32> > img(cols, rows);
+  for (int32 j = 0; j < rows; ++j)
+    for (int32 i = 0; i < cols; ++i)
+      img(i, j) = PixelRGBA<float32>(offset + 0.001f*i, offset + 0.002f*j, 0.5f, 1.0f);
+  return img;
+}
+
+TEST(TestImageComposite, StreamingBlend) {
+  // A lone source comes back unchanged, whichever blocks the patches
+  // happen to straddle.
+  ImageView<PixelRGBA<float32> > source = make_ramp(300, 200, 0.1f);
+  ImageComposite<PixelRGBA<float32> > c;
+  c.set_streaming(true, 64);
+  c.insert(source, 10, 20);
+  c.prepare();
+  ASSERT_EQ(300, c.cols());
+  ASSERT_EQ(200, c.rows());
+
+  ImageView<PixelRGBA<float32> > result(c.cols(), c.rows());
+  for (int32 y = 0; y < c.rows(); y += 50)
+    for (int32 x = 0; x < c.cols(); x += 70) {
+      BBox2i patch(x, y, std::min(70, c.cols()-x), std::min(50, c.rows()-y));
+      crop(result, patch) = c.generate_patch(patch);
+    }
+  for (int32 j = 0; j < c.rows(); ++j)
+    for (int32 i = 0; i < c.cols(); ++i)
+      for (int32 p = 0; p < 4; ++p)
+        ASSERT_NEAR(source(i,j)[p], result(i,j)[p], 1e-4) << "at (" << i << "," << j << ")";
+}
+
+TEST(TestImageComposite, StreamingSeam) {
+  // Two overlapping sources blend into one another across the seam,
+  // and far from it each keeps its own values.
+  ImageComposite<PixelRGBA<float32> > c;
+  c.set_streaming(true, 64);
+  c.insert(make_ramp(200, 100, 0.1f), 0, 0);
+  c.insert(make_ramp(200, 100, 0.3f), 100, 0);
+  c.prepare();
+  ASSERT_EQ(300, c.cols());
+
+  ImageView<PixelRGBA<float32> > result = c.generate_patch(BBox2i(0, 0, c.cols(), c.rows()));
+  for (int32 j = 0; j < c.rows(); ++j) {
+    EXPECT_NEAR(0.1f + 0.002f*j, result(10, j)[1], 1e-4);
+    EXPECT_NEAR(0.3f + 0.002f*j, result(290, j)[1], 1e-4);
+    for (int32 i = 0; i < c.cols(); ++i) {
+      EXPECT_NEAR(1.0f, result(i, j)[3], 1e-4);
+      EXPECT_GE(result(i, j)[1], 0.1f + 0.002f*j - 1e-4);
+      EXPECT_LE(result(i, j)[1], 0.3f + 0.002f*j + 1e-4);
+    }
+  }
+}
+
+TEST(TestImageComposite, CompactPyramids) {
+  // Quantizing the band-pass levels barely changes the blend.
+  ImageComposite<PixelRGBA<float32> > full, compact;
+  full.set_streaming(true, 64);
+  compact.set_streaming(true, 64);
+  compact.set_compact_pyramids(true);
+  full.insert(make_ramp(200, 100, 0.1f), 0, 0);
+  full.insert(make_ramp(200, 100, 0.3f), 100, 0);
+  compact.insert(make_ramp(200, 100, 0.1f), 0, 0);
+  compact.insert(make_ramp(200, 100, 0.3f), 100, 0);
+  full.prepare();
+  compact.prepare();
+
+  BBox2i bbox(0, 0, full.cols(), full.rows());
+  ImageView<PixelRGBA<float32> > full_result = full.generate_patch(bbox);
+  ImageView<PixelRGBA<float32> > compact_result = compact.generate_patch(bbox);
+  for (int32 j = 0; j < full.rows(); ++j)
+    for (int32 i = 0; i < full.cols(); ++i)
+      for (int32 p = 0; p < 4; ++p)
+        ASSERT_NEAR(full_result(i,j)[p], compact_result(i,j)[p], 1e-3) << "at (" << i << "," << j << ")";
+}
+
+TEST(TestImageComposite, ChangedBBox) {
+  // Adding a source leaves the blend unchanged outside its changed
+  // region.
+  ImageComposite<PixelRGBA<float32> > before, after;
+  before.set_streaming(true, 64);
+  after.set_streaming(true, 64);
+  before.insert(make_ramp(200, 100, 0.1f), 0, 0);
+  before.insert(make_ramp(200, 100, 0.2f), 400, 0);
+  after.insert(make_ramp(200, 100, 0.1f), 0, 0);
+  after.insert(make_ramp(200, 100, 0.2f), 400, 0);
+  after.insert(make_ramp(200, 100, 0.3f), 150, 0);
+  before.prepare();
+  after.prepare();
+  ASSERT_EQ(3u, after.num_sources());
+  ASSERT_EQ(before.cols(), after.cols());
+
+  BBox2i changed = after.changed_bbox(2);
+  EXPECT_TRUE(changed.contains(BBox2i(150, 0, 200, 100)));
+  EXPECT_LT(changed.width(), after.cols());
+  EXPECT_TRUE(after.changed_bbox(3).empty());
+
+  BBox2i all(0, 0, after.cols(), after.rows());
+  ImageView<PixelRGBA<float32> > old_result = before.generate_patch(all);
+  ImageView<PixelRGBA<float32> > new_result = after.generate_patch(all);
+  for (int32 j = 0; j < after.rows(); ++j)
+    for (int32 i = 0; i < after.cols(); ++i) {
+      if (changed.contains(Vector2i(i, j))) continue;
+      for (int32 p = 0; p < 4; ++p)
+        ASSERT_NEAR(old_result(i,j)[p], new_result(i,j)[p], 1e-5) << "at (" << i << "," << j << ")";
+    }
+}
@@ -0,0 +1,74 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <vw/Mosaic/MaskCache.h>
+
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::mosaic;
+using namespace vw::test;
+
+static ImageView<float32> make_mask( int32 cols, int32 rows ) {
+  ImageView<float32> mask( cols, rows );
+  for( int32 j = 0; j < rows; ++j )
+    for( int32 i = 0; i < cols; ++i )
+      mask(i,j) = float32( i*3 + j ) / 7;
+  return mask;
+}
+
+TEST( MaskCache, RoundTrip ) {
+  UnlinkName dir( "maskcache" );
+  MaskCache cache( dir );
+  ImageView<float32> mask = make_mask( 13, 9 ), result;
+
+  EXPECT_FALSE( cache.read( "source a", result ) );
+  cache.write( "source a", mask );
+  ASSERT_TRUE( cache.read( "source a", result ) );
+  ASSERT_EQ( mask.cols(), result.cols() );
+  ASSERT_EQ( mask.rows(), result.rows() );
+  for( int32 j = 0; j < mask.rows(); ++j )
+    for( int32 i = 0; i < mask.cols(); ++i )
+      EXPECT_EQ( mask(i,j), result(i,j) );
+
+  // A second cache over the same directory sees the mask too
+  EXPECT_TRUE( MaskCache( dir ).read( "source a", result ) );
+  EXPECT_FALSE( cache.read( "source b", result ) );
+
+  // Writing again replaces the mask
+  cache.write( "source a", make_mask( 4, 5 ) );
+  ASSERT_TRUE( cache.read( "source a", result ) );
+  EXPECT_EQ( 4, result.cols() );
+  EXPECT_EQ( 5, result.rows() );
+}
+
+TEST( MaskCache, Damaged ) {
+  UnlinkName dir( "maskcache_damaged" );
+  MaskCache cache( dir );
+  cache.write( "source", make_mask( 10, 10 ) );
+
+  // Truncate the file, and the mask is no longer found
+  std::string filename = std::string(dir) + "/" + MaskCache::hash( "source" ) + ".mask";
+  {
+    std::ifstream in( filename.c_str(), std::ios::binary );
+    std::string contents( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
+    ASSERT_GT( contents.size(), 100u );
+    std::ofstream out( filename.c_str(), std::ios::binary | std::ios::trunc );
+    out.write( contents.data(), contents.size() - 10 );
+  }
+  ImageView<float32> result;
+  EXPECT_FALSE( cache.read( "source", result ) );
+  EXPECT_FALSE( result );
+}
+
+TEST( MaskCache, Hash ) {
+  EXPECT_EQ( "cbf29ce484222325", MaskCache::hash( "" ) );
+  EXPECT_EQ( 16u, MaskCache::hash( "a" ).size() );
+  EXPECT_NE( MaskCache::hash( "a" ), MaskCache::hash( "b" ) );
+}
@@ -0,0 +1,310 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <vw/Mosaic/QuadTreeGenerator.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/Image/ViewImageResource.h>
+#include <vw/Image/UtilityViews.h>
+#include <vw/FileIO/DiskImageView.h>
+
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::mosaic;
+using namespace vw::test;
+
+typedef std::map<std::string, ImageView<float> > TileMap;
+
+// Keeps the written tiles in memory, keyed by tile name
+class MemoryTile : public DstImageResource {
+  TileMap &m_tiles;
+  Mutex &m_mutex;
+  std::string m_name;
+public:
+  MemoryTile( TileMap &tiles, Mutex &mutex, std::string const& name )
+    : m_tiles(tiles), m_mutex(mutex), m_name(name) {}
+  virtual void write( ImageBuffer const& buf, BBox2i const& bbox ) {
+    ImageView<float> tile( bbox.width(), bbox.height() );
+    convert( tile.buffer(), buf );
+    Mutex::Lock lock( m_mutex );
+    m_tiles[m_name] = tile;
+  }
+  virtual bool has_block_write() const { return false; }
+  virtual bool has_nodata_write() const { return false; }
+  virtual void flush() {}
+};
+
+struct MemoryTileFunc {
+  TileMap *tiles;
+  Mutex *mutex;
+  std::string fail;
+  MemoryTileFunc( TileMap &tiles, Mutex &mutex, std::string const& fail = "none" )
+    : tiles(&tiles), mutex(&mutex), fail(fail) {}
+  boost::shared_ptr<DstImageResource> operator()( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info, ImageFormat const& ) const {
+    if( info.name == fail ) vw_throw( IOErr() << "cannot write tile " << info.name );
+    return boost::shared_ptr<DstImageResource>( new MemoryTile( *tiles, *mutex, info.name ) );
+  }
+};
+
+static ImageView<float> make_source() {
+  ImageView<float> source( 300, 200 );
+  for( int32 j = 0; j < source.rows(); ++j )
+    for( int32 i = 0; i < source.cols(); ++i )
+      source(i,j) = float( (i*7 + j*13) % 101 );
+  return source;
+}
+
+static TileMap generate( ImageView<float> const& source, bool parallel ) {
+  TileMap tiles;
+  Mutex mutex;
+  QuadTreeGenerator qtree( source );
+  qtree.set_tile_size( 32 );
+  qtree.set_parallel( parallel );
+  qtree.set_tile_resource_func( MemoryTileFunc( tiles, mutex ) );
+  qtree.generate();
+  return tiles;
+}
+
+TEST( QuadTreeGenerator, Parallel ) {
+  ImageView<float> source = make_source();
+  TileMap serial = generate( source, false );
+  TileMap parallel = generate( source, true );
+
+  // Five levels, of which only the tiles that overlap the image are
+  // written.
+  ASSERT_EQ( 1u + 2 + 6 + 20 + 70, serial.size() );
+  ASSERT_EQ( serial.size(), parallel.size() );
+  for( TileMap::const_iterator s = serial.begin(), p = parallel.begin(); s != serial.end(); ++s, ++p ) {
+    ASSERT_EQ( s->first, p->first );
+    ASSERT_EQ( s->second.cols(), p->second.cols() );
+    ASSERT_EQ( s->second.rows(), p->second.rows() );
+    for( int32 j = 0; j < s->second.rows(); ++j )
+      for( int32 i = 0; i < s->second.cols(); ++i )
+        EXPECT_EQ( s->second(i,j), p->second(i,j) ) << "in tile " << s->first << " at " << i << "," << j;
+  }
+}
+
+TEST( QuadTreeGenerator, ParallelFailure ) {
+  ImageView<float> source = make_source();
+  TileMap tiles;
+  Mutex mutex;
+  QuadTreeGenerator qtree( source );
+  qtree.set_tile_size( 32 );
+  qtree.set_parallel( true );
+  qtree.set_tile_resource_func( MemoryTileFunc( tiles, mutex, "012" ) );
+  EXPECT_THROW( qtree.generate(), Exception );
+  EXPECT_EQ( 0u, tiles.count( "" ) );
+}
+
+struct MemoryTileSource {
+  TileMap const *tiles;
+  MemoryTileSource( TileMap const& tiles ) : tiles(&tiles) {}
+  boost::shared_ptr<SrcImageResource> operator()( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info ) const {
+    TileMap::const_iterator tile = tiles->find( info.name );
+    if( tile == tiles->end() ) return boost::shared_ptr<SrcImageResource>();
+    return boost::shared_ptr<SrcImageResource>( new ViewImageResource( tile->second ) );
+  }
+};
+
+TEST( QuadTreeGenerator, Update ) {
+  ImageView<float> source = make_source();
+  TileMap original = generate( source, false );
+
+  BBox2i changed( 100, 40, 20, 20 );
+  crop( source, changed ) = constant_view( 200.0f, changed.width(), changed.height() );
+  TileMap expected = generate( source, false );
+
+  for( int parallel = 0; parallel < 2; ++parallel ) {
+    TileMap written;
+    Mutex mutex;
+    QuadTreeGenerator qtree( source );
+    qtree.set_tile_size( 32 );
+    qtree.set_parallel( parallel );
+    qtree.set_dirty_bbox( changed );
+    qtree.set_tile_resource_func( MemoryTileFunc( written, mutex ) );
+    qtree.set_tile_source_func( MemoryTileSource( original ) );
+    qtree.generate();
+
+    // Only the leaves under the change and their ancestors, one per
+    // level, are rewritten.
+    EXPECT_EQ( 5u, written.size() );
+    for( TileMap::const_iterator e = expected.begin(); e != expected.end(); ++e ) {
+      TileMap::const_iterator tile = written.find( e->first );
+      if( tile == written.end() ) tile = original.find( e->first );
+      ASSERT_TRUE( tile != original.end() );
+      ASSERT_EQ( e->second.cols(), tile->second.cols() );
+      for( int32 j = 0; j < e->second.rows(); ++j )
+        for( int32 i = 0; i < e->second.cols(); ++i )
+          EXPECT_EQ( e->second(i,j), tile->second(i,j) ) << "in tile " << e->first << " at " << i << "," << j;
+    }
+  }
+}
+
+// An image "on disk" that counts the pixels read from it at full and
+// at reduced resolution.  Its overviews sample every 2^level-th pixel,
+// as the full-resolution path of the generator does.
+class CountingResource : public DiskImageResource {
+  ImageView<float> m_image;
+  int32 m_levels;
+public:
+  mutable size_t full_pixels, reduced_pixels;
+  CountingResource( ImageView<float> const& image, int32 levels )
+    : DiskImageResource( "counting" ), m_image( image ), m_levels( levels ), full_pixels( 0 ), reduced_pixels( 0 ) {
+    m_format = m_image.format();
+  }
+  virtual std::string type() { return "counting"; }
+  virtual void read( ImageBuffer const& buf, BBox2i const& bbox ) const {
+    full_pixels += bbox.width() * bbox.height();
+    ImageView<float> region = crop( m_image, bbox );
+    convert( buf, region.buffer() );
+  }
+  virtual int32 overview_levels() const { return m_levels; }
+  virtual void read_reduced( ImageBuffer const& buf, BBox2i const& bbox, int32 level ) const {
+    reduced_pixels += bbox.width() * bbox.height();
+    int32 factor = 1 << level;
+    ImageView<float> reduced( bbox.width(), bbox.height() );
+    for( int32 j = 0; j < bbox.height(); ++j )
+      for( int32 i = 0; i < bbox.width(); ++i )
+        reduced(i,j) = m_image( (bbox.min().x()+i)*factor, (bbox.min().y()+j)*factor );
+    convert( buf, reduced.buffer() );
+  }
+  virtual bool has_block_read() const { return true; }
+  virtual Vector2i block_read_size() const { return Vector2i( 64, 64 ); }
+  virtual bool has_nodata_read() const { return false; }
+  virtual void write( ImageBuffer const&, BBox2i const& ) { vw_throw( NoImplErr() ); }
+  virtual bool has_block_write() const { return false; }
+  virtual bool has_nodata_write() const { return false; }
+};
+
+// Branches only down to tiles of four times the tile size, so the
+// leaves are all coarse.
+struct CoarseBranchFunc {
+  std::vector<std::pair<std::string,BBox2i> > operator()( QuadTreeGenerator const& qtree, std::string const& name, BBox2i const& region ) const {
+    if( region.width() <= 4 * qtree.get_tile_size() ) return std::vector<std::pair<std::string,BBox2i> >();
+    return QuadTreeGenerator::default_branch_func()( qtree, name, region );
+  }
+};
+
+static TileMap generate_coarse( CountingResource &resource ) {
+  TileMap tiles;
+  Mutex mutex;
+  DiskImageView<float> view( resource, 0 );
+  QuadTreeGenerator qtree( view );
+  qtree.set_tile_size( 32 );
+  qtree.set_crop_bbox( BBox2i( 5, 3, 290, 190 ) );
+  qtree.set_branch_func( CoarseBranchFunc() );
+  qtree.set_tile_resource_func( MemoryTileFunc( tiles, mutex ) );
+  qtree.generate();
+  return tiles;
+}
+
+TEST( QuadTreeGenerator, Overviews ) {
+  ImageView<float> source = make_source();
+  CountingResource plain( source, 0 ), reduced( source, 1 );
+  TileMap expected = generate_coarse( plain );
+  TileMap result = generate_coarse( reduced );
+
+  // The leaves are read from the overview instead of the full image,
+  // but come out the same.
+  EXPECT_GE( plain.full_pixels, 290u * 190u );
+  EXPECT_EQ( 0u, reduced.full_pixels );
+  EXPECT_GT( reduced.reduced_pixels, 0u );
+  ASSERT_EQ( expected.size(), result.size() );
+  for( TileMap::const_iterator e = expected.begin(), r = result.begin(); e != expected.end(); ++e, ++r ) {
+    ASSERT_EQ( e->first, r->first );
+    for( int32 j = 0; j < e->second.rows(); ++j )
+      for( int32 i = 0; i < e->second.cols(); ++i )
+        EXPECT_EQ( e->second(i,j), r->second(i,j) ) << "in tile " << e->first << " at " << i << "," << j;
+  }
+}
+
+// Records the file type chosen for each tile, and how many tiles were
+// actually written.
+struct TileTypes {
+  Mutex mutex;
+  std::map<std::string, std::pair<std::string,BBox2i> > types;
+  size_t written;
+  TileTypes() : written(0) {}
+};
+
+class CountingTile : public DstImageResource {
+  TileTypes &m_types;
+public:
+  CountingTile( TileTypes &types ) : m_types(types) {}
+  virtual void write( ImageBuffer const&, BBox2i const& ) {
+    Mutex::Lock lock( m_types.mutex );
+    m_types.written++;
+  }
+  virtual bool has_block_write() const { return false; }
+  virtual bool has_nodata_write() const { return false; }
+  virtual void flush() {}
+};
+
+struct TypeTileFunc {
+  TileTypes *types;
+  TypeTileFunc( TileTypes &types ) : types(&types) {}
+  boost::shared_ptr<DstImageResource> operator()( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info, ImageFormat const& ) const {
+    Mutex::Lock lock( types->mutex );
+    types->types[info.name] = std::make_pair( info.filetype, info.region_bbox );
+    return boost::shared_ptr<DstImageResource>( new CountingTile( *types ) );
+  }
+};
+
+TEST( QuadTreeGenerator, AutoFileType ) {
+  ImageView<PixelGrayA<float> > source( 300, 200 );
+  for( int32 j = 0; j < source.rows(); ++j )
+    for( int32 i = 0; i < source.cols(); ++i )
+      source(i,j) = PixelGrayA<float>( float( (i*7 + j*13) % 101 ) / 101, i < 40 ? 0.0f : 1.0f );
+
+  // A tile is opaque exactly when it lies within the opaque part of
+  // the image, whether its opacity came from the leaves or a scan.
+  BBox2i opaque_bbox( 40, 0, 260, 200 );
+  for( int parallel = 0; parallel < 2; ++parallel ) {
+    TileTypes types;
+    QuadTreeGenerator qtree( source );
+    qtree.set_tile_size( 32 );
+    qtree.set_file_type( "auto" );
+    qtree.set_parallel( parallel );
+    qtree.set_tile_resource_func( TypeTileFunc( types ) );
+    qtree.generate();
+
+    ASSERT_EQ( 1u + 2 + 6 + 20 + 70, types.types.size() );
+    EXPECT_EQ( types.types.size(), types.written );
+    size_t jpegs = 0;
+    for( std::map<std::string, std::pair<std::string,BBox2i> >::const_iterator t = types.types.begin(); t != types.types.end(); ++t ) {
+      bool opaque = opaque_bbox.contains( t->second.second );
+      EXPECT_EQ( opaque ? ".jpg" : ".png", t->second.first ) << "for tile " << t->first;
+      if( opaque ) jpegs++;
+    }
+    EXPECT_GT( jpegs, 0u );
+  }
+}
+
+class FailingTile : public DstImageResource {
+public:
+  virtual void write( ImageBuffer const&, BBox2i const& ) { vw_throw( IOErr() << "disk full" ); }
+  virtual bool has_block_write() const { return false; }
+  virtual bool has_nodata_write() const { return false; }
+  virtual void flush() {}
+};
+
+struct FailingTileFunc {
+  boost::shared_ptr<DstImageResource> operator()( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const&, ImageFormat const& ) const {
+    return boost::shared_ptr<DstImageResource>( new FailingTile() );
+  }
+};
+
+TEST( QuadTreeGenerator, SerialWriteFailure ) {
+  // Serial mode writes tiles in the background, but still reports
+  // their failures.
+  ImageView<float> source = make_source();
+  QuadTreeGenerator qtree( source );
+  qtree.set_tile_size( 32 );
+  qtree.set_tile_resource_func( FailingTileFunc() );
+  EXPECT_THROW( qtree.generate(), Exception );
+}
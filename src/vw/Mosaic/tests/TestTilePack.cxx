@@ -0,0 +1,130 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <vw/Mosaic/TilePack.h>
+
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::mosaic;
+using namespace vw::test;
+
+static std::string read_file( std::string const& filename ) {
+  std::ifstream f( filename.c_str(), std::ios::binary );
+  return std::string( (std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>() );
+}
+
+TEST( TilePack, RoundTrip ) {
+  UnlinkName filename( "tiles.vwpack" );
+  std::string binary( "a\0b\xff", 4 );
+  {
+    TilePackWriter pack( filename );
+    pack.append( "r0.png", "first" );
+    pack.append( "r01.jpg", binary );
+    pack.append( "empty", "" );
+  }
+
+  TilePackReader pack( filename );
+  std::string data;
+  EXPECT_EQ( 3u, pack.size() );
+  ASSERT_TRUE( pack.read( "r0.png", data ) );
+  EXPECT_EQ( "first", data );
+  ASSERT_TRUE( pack.read( "r01.jpg", data ) );
+  EXPECT_EQ( binary, data );
+  ASSERT_TRUE( pack.read( "empty", data ) );
+  EXPECT_EQ( "", data );
+  EXPECT_FALSE( pack.read( "r1.png", data ) );
+}
+
+TEST( TilePack, Append ) {
+  UnlinkName filename( "tiles_append.vwpack" );
+  {
+    TilePackWriter pack( filename );
+    pack.append( "a", "old a" );
+    pack.append( "b", "b" );
+  }
+  {
+    TilePackWriter pack( filename, true );
+    pack.append( "a", "new a" );
+    pack.append( "c", "c" );
+  }
+
+  // The later record wins, and the earlier ones are still found
+  // when scanning past the first index.
+  std::string data;
+  for( int damaged = 0; damaged < 2; ++damaged ) {
+    if( damaged ) {
+      std::string contents = read_file( filename );
+      std::ofstream out( std::string(filename).c_str(), std::ios::binary | std::ios::trunc );
+      out.write( contents.data(), contents.size() - 1 );
+    }
+    TilePackReader pack( filename );
+    EXPECT_EQ( 3u, pack.size() );
+    ASSERT_TRUE( pack.read( "a", data ) );
+    EXPECT_EQ( "new a", data );
+    ASSERT_TRUE( pack.read( "b", data ) );
+    EXPECT_EQ( "b", data );
+    ASSERT_TRUE( pack.read( "c", data ) );
+    EXPECT_EQ( "c", data );
+  }
+}
+
+// Writes the raw pixels of a tile to the file the generator names.
+class RawTile : public DstImageResource {
+  std::string m_filename;
+public:
+  RawTile( std::string const& filename ) : m_filename(filename) {}
+  virtual void write( ImageBuffer const& buf, BBox2i const& bbox ) {
+    ImageView<float> tile( bbox.width(), bbox.height() );
+    convert( tile.buffer(), buf );
+    std::ofstream f( m_filename.c_str(), std::ios::binary );
+    f.write( (char const*)&tile(0,0), sizeof(float)*tile.cols()*tile.rows() );
+  }
+  virtual bool has_block_write() const { return false; }
+  virtual bool has_nodata_write() const { return false; }
+  virtual void flush() {}
+};
+
+struct RawTileFunc {
+  boost::shared_ptr<DstImageResource> operator()( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info, ImageFormat const& ) const {
+    return boost::shared_ptr<DstImageResource>( new RawTile( info.filepath + info.filetype ) );
+  }
+};
+
+TEST( TilePack, QuadTree ) {
+  UnlinkName filename( "qtree.vwpack" );
+  ImageView<float> source( 100, 60 );
+  for( int32 j = 0; j < source.rows(); ++j )
+    for( int32 i = 0; i < source.cols(); ++i )
+      source(i,j) = float( i + 100*j );
+
+  for( int parallel = 0; parallel < 2; ++parallel ) {
+    boost::shared_ptr<TilePackWriter> writer( new TilePackWriter( filename ) );
+    QuadTreeGenerator qtree( source, "tree" );
+    qtree.set_tile_size( 32 );
+    qtree.set_file_type( "raw" );
+    qtree.set_parallel( parallel );
+    qtree.set_tile_resource_func( packed_tile_resource_func( writer, RawTileFunc() ) );
+    qtree.generate();
+    writer->close();
+
+    // Three levels, the tiles overlapping the image
+    TilePackReader pack( filename );
+    EXPECT_EQ( 1u + 2 + 8, pack.size() );
+    QuadTreeGenerator::TileInfo info;
+    info.filepath = qtree.image_path( "02" );
+    info.filetype = ".raw";
+    std::string data;
+    ASSERT_TRUE( pack.read( tile_pack_name( qtree, info ), data ) );
+    ASSERT_EQ( 32*32*sizeof(float), data.size() );
+    float const* pixels = (float const*)data.data();
+    EXPECT_EQ( source(0,32), pixels[0] );
+    EXPECT_EQ( source(31,59), pixels[27*32+31] );
+  }
+}
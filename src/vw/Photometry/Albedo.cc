@@ -7,6 +7,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <numeric>
 
 #include <vw/Core.h>
 #include <vw/Image.h>
@@ -21,6 +22,7 @@ using namespace vw::cartography;
 #include <vw/Photometry/Reconstruct.h>
 #include <vw/Photometry/ReconstructError.h>
 #include <vw/Photometry/Reflectance.h>
+#include <vw/Photometry/Tiles.h>
 #include <vw/Photometry/Weights.h>
 
 using namespace vw::photometry;
@@ -532,199 +534,303 @@ void vw::photometry::UpdateImageMosaic(ModelParams input_img_params,
 //Below are the functions for albedo reconstruction
 //-------------------------------------------------------------------------------
 
-//initializes the albedo mosaic
-//TO DO: build the version that does the blockwise processing to deal with large scale images
-void
-vw::photometry::InitAlbedoMosaic(ModelParams input_img_params,
-                                 std::vector<ModelParams> overlap_img_params,
-                                 GlobalParams globalParams) {
-    int horBlockSize = 500;
-    int verBlockSize = 500;
-    
-    int i, l, k;
-    std::string input_img_file = input_img_params.inputFilename;
-    std::string reflectance_file = input_img_params.reliefFilename;
-    std::string shadow_file = input_img_params.shadowFilename;
-    std::string output_img_file = input_img_params.outputFilename;
-
-
-    DiskImageView<PixelMask<PixelGray<uint8> > >  input_img(input_img_file);
-    GeoReference input_img_geo;
-    read_georeference(input_img_geo, input_img_file);
-
-    DiskImageView<PixelMask<PixelGray<uint8> > >  shadowImage(shadow_file);
-
-    ImageView<PixelMask<PixelGray<float> > > output_img (input_img.cols(), input_img.rows());
-    ImageView<PixelGray<int> > numSamples(input_img.cols(), input_img.rows());
-    ImageView<PixelGray<float> > norm(input_img.cols(), input_img.rows());
-
- 
-    DiskImageView<PixelMask<PixelGray<float> > > reflectance_image(reflectance_file);
-    GeoReference reflectance_geo;
-    read_georeference(reflectance_geo, reflectance_file);
-
-    ImageViewRef<PixelMask<PixelGray<float> > >  interp_reflectance_image = interpolate(edge_extend(reflectance_image.impl(),
-											ConstantEdgeExtension()),
-									    BilinearInterpolation());
-
-
-    int numHorBlocks = input_img.cols()/horBlockSize + 1;
-    int numVerBlocks = input_img.rows()/verBlockSize + 1;
-
-    int x,y;
-    //initialize  output_img, and numSamples
-    for (k = 0 ; k < input_img.rows(); ++k) {
-        for (l = 0; l < input_img.cols(); ++l) {
-
-           numSamples(l, k) = 0;
-           Vector2 input_image_pix(l,k);
-
-           if ( is_valid(input_img(l,k)) && ( shadowImage(l, k) == 0)) { //valid image point
-
-              //compute the local reflectance
-            
-              Vector2 lon_lat = input_img_geo.pixel_to_lonlat(input_image_pix);
-              Vector2 reflectance_pix = reflectance_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_image_pix));
-
-              float x = reflectance_pix[0];
-              float y = reflectance_pix[1];
-             
-              //check for valid reflectance coordinates
-              if ((x>=0) && (x < reflectance_image.cols()) && (y>=0) && (y< reflectance_image.rows())){ //valid reflectance point  
-               
-		if (is_valid(interp_reflectance_image(x,y))){
-                 
-                  float input_img_reflectance = interp_reflectance_image(x,y);
-                  if (input_img_reflectance != 0.0){
-                      if (globalParams.useWeights == 0){
-                          output_img(l, k) = (float)input_img(l,k)/(input_img_params.exposureTime*input_img_reflectance);
-                          numSamples(l, k) = 1;
-                      }
-                      else{
-                         float weight = ComputeLineWeights(input_image_pix, input_img_params.centerLine, input_img_params.maxDistArray);
-                         output_img(l, k) = ((float)input_img(l,k)*weight)/(input_img_params.exposureTime*input_img_reflectance);
-                         norm(l, k) = weight;
-                         numSamples(l, k) = 1;
-                      }
-                  }
-                }
-             }
+// The albedo passes run as independent jobs, one per tile of the output
+// albedo. A job reads only its tile of the input image, and only the
+// parts of the reflectance, DEM and overlapping images under it, and
+// skips the overlapping images that don't reach it at all. The georeference
+// conversions are done for a whole tile at once.
+namespace {
+
+  typedef PixelMask<PixelGray<uint8> > img_pixel;
+  typedef PixelMask<PixelGray<float> > albedo_pixel;
+
+  // Initializes a tile of the albedo mosaic to the mean, over the input
+  // image and the images overlapping it, of the intensity over the
+  // exposure time and the reflectance.
+  class InitAlbedoTile {
+    GeoImage<img_pixel> const& m_input;
+    DiskImageView<img_pixel> const& m_shadow;
+    GeoImage<albedo_pixel> const& m_reflectance;
+    OverlapImages const& m_overlaps;
+    ModelParams const& m_params;
+    GlobalParams const& m_global;
+    ImageView<albedo_pixel>& m_output;
+    std::vector<int>& m_num_valid;
+
+  public:
+    InitAlbedoTile(GeoImage<img_pixel> const& input, DiskImageView<img_pixel> const& shadow,
+                   GeoImage<albedo_pixel> const& reflectance, OverlapImages const& overlaps,
+                   ModelParams const& params, GlobalParams const& global,
+                   ImageView<albedo_pixel>& output, std::vector<int>& num_valid)
+      : m_input(input), m_shadow(shadow), m_reflectance(reflectance), m_overlaps(overlaps),
+        m_params(params), m_global(global), m_output(output), m_num_valid(num_valid) {}
+
+    void operator()(size_t index, BBox2i const& bbox) const {
+      const int32 cols = bbox.width(), rows = bbox.height();
+
+      ImageView<img_pixel> input_img = crop(m_input.image, bbox);
+      ImageView<img_pixel> shadowImage = crop(m_shadow, bbox);
+      ImageView<albedo_pixel> output_img(cols, rows);
+      ImageView<PixelGray<int> > numSamples(cols, rows);
+      ImageView<PixelGray<float> > norm(cols, rows);
+
+      std::vector<Vector2> pixels = grid_pixels(bbox), lon_lats, reflectance_pixels;
+      m_input.geo.pixels_to_lonlats(pixels, lon_lats);
+      m_reflectance.geo.lonlats_to_pixels(lon_lats, reflectance_pixels);
+
+      ImageRegion<albedo_pixel> reflectance_region(m_reflectance.image, reflectance_pixels);
+      if (reflectance_region.empty())
+        return;
+
+      //the local reflectance, where it is valid
+      std::vector<float> reflectance(pixels.size(), 0.0);
+      std::vector<bool> has_reflectance(pixels.size(), false);
+      for (size_t i = 0; i < pixels.size(); ++i) {
+        Vector2 const& pix = reflectance_pixels[i];
+        if (in_bounds(pix, m_reflectance.image)) {
+          albedo_pixel value = reflectance_region(pix[0], pix[1]);
+          if (is_valid(value)) {
+            reflectance[i] = value;
+            has_reflectance[i] = true;
           }
-       }
-    }
-
-    for (i = 0; i < (int)overlap_img_params.size(); i++){
-      
-      printf("overlap_img = %s\n", overlap_img_params[i].inputFilename.c_str());
-
-      DiskImageView<PixelMask<PixelGray<uint8> > >  overlap_img(overlap_img_params[i].inputFilename);
-      GeoReference overlap_geo;
-      read_georeference(overlap_geo, overlap_img_params[i].inputFilename);
-
-      ImageViewRef<PixelMask<PixelGray<uint8> > >  interp_overlap_img = interpolate(edge_extend(overlap_img.impl(),
-                                                                                    ConstantEdgeExtension()),
-                                                                                    BilinearInterpolation());
-
-
-      
-      DiskImageView<PixelMask<PixelGray<uint8> > >  overlapShadowImage(overlap_img_params[i].shadowFilename);
-
-      ImageViewRef<PixelMask<PixelGray<uint8> > >  interpOverlapShadowImage = interpolate(edge_extend(overlapShadowImage.impl(),
-												      ConstantEdgeExtension()),
-											  BilinearInterpolation());
-      
-      for (k = 0 ; k < input_img.rows(); ++k) {
-        for (l = 0; l < input_img.cols(); ++l) {
-
-          Vector2 input_img_pix(l,k);
-
-          if ( is_valid(input_img(l,k)) ) {
-
-              //get the corresponding reflectance value
-              Vector2 lon_lat = input_img_geo.pixel_to_lonlat(input_img_pix);
-	     
-              Vector2 reflectance_pix = reflectance_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_pix));
-              float x = reflectance_pix[0];
-              float y = reflectance_pix[1];
-
-              //check for valid reflectance_image coordinates
-              if ((x>=0) && (x < reflectance_image.cols()) && (y>=0) && (y< reflectance_image.rows())){
-	
-                if (is_valid(interp_reflectance_image(x,y))){
-                 
-                  //check for overlap between the output image and the input DEM image
-                  Vector2 overlap_pix = overlap_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_pix));
-                  float overlap_x = overlap_pix[0];
-                  float overlap_y = overlap_pix[1];
+        }
+      }
 
-                  //image dependent part of the code  - START
-                  PixelMask<PixelGray<uint8> > overlap_img_pixel = interp_overlap_img(overlap_x, overlap_y);
+      //initialize output_img, and numSamples
+      for (int32 k = 0, i = 0; k < rows; ++k) {
+        for (int32 l = 0; l < cols; ++l, ++i) {
+          numSamples(l, k) = 0;
+          if ( is_valid(input_img(l,k)) && ( shadowImage(l, k) == 0) && has_reflectance[i] && reflectance[i] != 0.0) {
+            if (m_global.useWeights == 0){
+              output_img(l, k) = (float)input_img(l,k)/(m_params.exposureTime*reflectance[i]);
+              numSamples(l, k) = 1;
+            }
+            else{
+              float weight = ComputeLineWeights(pixels[i], m_params.centerLine, m_params.maxDistArray);
+              output_img(l, k) = ((float)input_img(l,k)*weight)/(m_params.exposureTime*reflectance[i]);
+              norm(l, k) = weight;
+              numSamples(l, k) = 1;
+            }
+          }
+        }
+      }
 
-                  //check for valid overlap_img coordinates
-                  //TO DO: remove shadow pixels in the overlap_img.
-                  if ((overlap_x>=0) && (overlap_x < overlap_img.cols()) && (overlap_y >= 0) && (overlap_y< overlap_img.rows()) && (interpOverlapShadowImage(x, y) == 0)){
+      for (size_t j = 0; j < m_overlaps.size(); j++){
+        OverlapImage const& overlap = *m_overlaps[j];
+
+        std::vector<Vector2> overlap_pixels;
+        overlap.image.geo.lonlats_to_pixels(lon_lats, overlap_pixels);
+        ImageRegion<img_pixel> overlap_region(overlap.image.image, overlap_pixels);
+        if (overlap_region.empty())
+          continue;
+        ImageRegion<img_pixel> overlap_shadow_region(overlap.shadow, overlap_pixels);
+
+        for (int32 k = 0, i = 0; k < rows; ++k) {
+          for (int32 l = 0; l < cols; ++l, ++i) {
+            Vector2 const& overlap_pix = overlap_pixels[i];
+
+            if ( !is_valid(input_img(l,k)) || !has_reflectance[i] || reflectance[i] == 0.0 )
+              continue;
+            if ( !in_bounds(overlap_pix, overlap.image.image) || !(overlap_shadow_region(overlap_pix[0], overlap_pix[1]) == 0) )
+              continue;
+
+            img_pixel overlap_img_pixel = overlap_region(overlap_pix[0], overlap_pix[1]);
+            if ( !is_valid(overlap_img_pixel) )
+              continue;
+
+            //common area between input_img and overlap_img
+            if (m_global.useWeights == 0){
+              output_img(l, k) = (float)output_img(l, k) + (float)overlap_img_pixel/(overlap.params.exposureTime*reflectance[i]);
+              numSamples(l, k) = numSamples(l,k) + 1;
+            }
+            else{
+              float weight = ComputeLineWeights(overlap_pix, overlap.params.centerLine, overlap.params.maxDistArray);
+              output_img(l, k) = (float)output_img(l, k) + ((float)overlap_img_pixel*weight)/(overlap.params.exposureTime*reflectance[i]);
+              numSamples(l, k) = numSamples(l,k) + 1;
+              norm(l,k) = norm(l,k) + weight;
+            }
+          }
+        }
+      }
 
-                    if ( is_valid(overlap_img_pixel) ) { //common area between input_img and overlap_img
+      //compute the mean albedo value
+      for (int32 k = 0; k < rows; ++k) {
+        for (int32 l = 0; l < cols; ++l) {
+          if ( (is_valid(input_img(l,k))) && (numSamples(l, k)!=0) ) {
+            output_img(l,k).validate();
+            if (m_global.useWeights == 0){
+              output_img(l, k) = output_img(l, k)/numSamples(l,k);
+            }
+            else{
+              output_img(l, k) = output_img(l, k)/norm(l,k);
+            }
+            m_num_valid[index]++;
+          }
+        }
+      }
 
-                      float overlap_img_reflectance = interp_reflectance_image(x,y);
+      crop(m_output, bbox) = output_img;
+    }
+  };
+
+  // Updates a tile of the albedo mosaic by one Gauss-Newton step, over the
+  // input image and the images overlapping it.
+  class UpdateAlbedoTile {
+    ReconstructImages const& m_images;
+    DiskImageView<img_pixel> const& m_albedo;
+    ModelParams const& m_params;
+    GlobalParams const& m_global;
+    ImageView<albedo_pixel>& m_output;
+
+  public:
+    UpdateAlbedoTile(ReconstructImages const& images, DiskImageView<img_pixel> const& albedo,
+                     ModelParams const& params, GlobalParams const& global,
+                     ImageView<albedo_pixel>& output)
+      : m_images(images), m_albedo(albedo), m_params(params), m_global(global), m_output(output) {}
+
+    void operator()(size_t /*index*/, BBox2i const& bbox) const {
+      const int32 cols = bbox.width(), rows = bbox.height();
+
+      ImageView<img_pixel> input_img = crop(m_images.input.image, bbox);
+      ImageView<img_pixel> shadowImage = crop(m_images.shadow, bbox);
+      ImageView<img_pixel> output_img_r = crop(m_albedo, bbox);
+      ImageView<albedo_pixel> output_img(cols, rows);
+
+      ImageView<PixelGray<float> > nominator(cols, rows);
+      ImageView<PixelGray<float> > denominator(cols, rows);
+
+      std::vector<Vector2> lon_lats;
+      std::vector<SurfacePoint> points = image_surface(m_images.input.geo, m_images.dem,
+                                                       m_global.noDEMDataValue, bbox, lon_lats);
+
+      //initialize the nominator and denomitor images
+      for (int32 k = 0, i = 0; k < rows; ++k) {
+        for (int32 l = 0; l < cols; ++l, ++i) {
+          nominator(l, k) = 0;
+          denominator(l, k) = 0;
+
+          //reject invalid pixels and pixels that are in shadow.
+          if ( !is_valid(input_img(l,k)) || !( shadowImage(l, k) == 0) || !points[i].valid )
+            continue;
+
+          //This part is the only image depedent part - START
+          float input_img_reflectance = ComputeReflectance(points[i].normal, points[i].xyz, m_params, m_global);
+          if (input_img_reflectance > 0){
+            float input_img_error = ComputeError((float)input_img(l,k), m_params.exposureTime,
+                                                 (float)output_img_r(l, k), input_img_reflectance);
+            float input_albedo_grad = ComputeGradient_Albedo(m_params.exposureTime, input_img_reflectance);
+
+            if (m_global.useWeights == 0){
+              nominator(l, k) = input_albedo_grad*input_img_error;
+              denominator(l, k) = input_albedo_grad*input_albedo_grad;
+            }
+            else{
+              Vector2 input_image_pix(bbox.min().x()+l, bbox.min().y()+k);
+              float weight = ComputeLineWeights(input_image_pix, m_params.centerLine, m_params.maxDistArray);
+              nominator(l, k)   = input_albedo_grad*input_img_error*weight;
+              denominator(l, k) = input_albedo_grad*input_albedo_grad*weight;
+            }
 
-                      if (overlap_img_reflectance != 0.0){
-                          if (globalParams.useWeights == 0){
-                              output_img(l, k) = (float)output_img(l, k) + (float)overlap_img_pixel/(overlap_img_params[i].exposureTime*overlap_img_reflectance);
-                              numSamples(l, k) = numSamples(l,k) + 1;
-                          }
-                          else{
-                             float weight = ComputeLineWeights(overlap_pix, overlap_img_params[i].centerLine, overlap_img_params[i].maxDistArray);
-                             output_img(l, k) = (float)output_img(l, k) + ((float)overlap_img_pixel*weight)/(overlap_img_params[i].exposureTime*overlap_img_reflectance);
-                             numSamples(l, k) = numSamples(l,k) + 1;
-                             norm(l,k) = norm(l,k) + weight;
-                          }
-                      }
+            // marks the pixel as one to update
+            output_img(l, k) = 0;
+          }
+          //This part is the only image depedent part - END
+        }
+      }
 
-                    }//if
-                  }//if
+      //update from the overlapping images
+      for (size_t j = 0; j < m_images.overlaps.size(); j++){
+        OverlapImage const& overlap = *m_images.overlaps[j];
+
+        std::vector<Vector2> overlap_pixels, overlap_samples;
+        overlap.image.geo.lonlats_to_pixels(lon_lats, overlap_pixels);
+        overlap_samples = truncate_pixels(overlap_pixels);
+        ImageRegion<img_pixel> overlap_region(overlap.image.image, overlap_samples);
+        if (overlap_region.empty())
+          continue;
+        ImageRegion<img_pixel> overlap_shadow_region(overlap.shadow, overlap_samples);
+
+        for (int32 k = 0, i = 0; k < rows; ++k) {
+          for (int32 l = 0; l < cols; ++l, ++i) {
+            if ( !is_valid(input_img(l,k)) || !points[i].valid )
+              continue;
+
+            //check for valid overlap_img coordinates
+            Vector2 const& overlap_pix = overlap_samples[i];
+            if ( !in_bounds(overlap_pix, overlap.image.image) || !(overlap_shadow_region(overlap_pix[0], overlap_pix[1]) == 0) )
+              continue;
+
+            img_pixel overlap_img_pixel = overlap_region(overlap_pix[0], overlap_pix[1]);
+            if ( !is_valid(overlap_img_pixel) )
+              continue;
+
+            //common area between input_img and overlap_img
+            float overlap_img_reflectance = ComputeReflectance(points[i].normal, points[i].xyz, overlap.params, m_global);
+            if (overlap_img_reflectance > 0){
+              float overlap_img_error = ComputeError((float)overlap_img_pixel, overlap.params.exposureTime,
+                                                     (float)output_img_r(l, k), overlap_img_reflectance);
+              float overlap_albedo_grad = ComputeGradient_Albedo(overlap.params.exposureTime, overlap_img_reflectance);
+              if (m_global.useWeights == 0){
+                nominator(l, k) = nominator(l, k) + overlap_albedo_grad*overlap_img_error;
+                denominator(l, k) = denominator(l, k) + overlap_albedo_grad*overlap_albedo_grad;
+              }
+              else{
+                float weight = ComputeLineWeights(overlap_pixels[i], overlap.params.centerLine, overlap.params.maxDistArray);
+                nominator(l, k)   = nominator(l,k) + overlap_albedo_grad*overlap_img_error*weight;
+                denominator(l, k) = denominator(l,k) + overlap_albedo_grad*overlap_albedo_grad*weight;
+              }
+            }
+          }
+        }
+      }
 
-                  //image dependent part of the code  - END
-               }
-             }
+      //finalize the output image
+      for (int32 k = 0; k < rows; ++k) {
+        for (int32 l = 0; l < cols; ++l) {
+          if ( is_valid(output_img(l,k)) && ((float)denominator(l, k) != 0) ) {
+            float delta = (float)nominator(l, k)/(float)denominator(l, k);
+            output_img(l,k) = (float)output_img_r(l, k) + delta;
+            output_img(l,k).validate();
+          }
+          else {
+            output_img(l,k).invalidate();
           }
         }
       }
+
+      crop(m_output, bbox) = output_img;
     }
+  };
 
-    //compute the mean albedo value
-    int numValid = 0;
-    for (k = 0 ; k < input_img.rows(); ++k) {
-       for (l = 0; l < input_img.cols(); ++l) {
+} // namespace
 
-         //output_img(l,k).invalidate();
+//initializes the albedo mosaic
+void
+vw::photometry::InitAlbedoMosaic(ModelParams input_img_params,
+                                 std::vector<ModelParams> overlap_img_params,
+                                 GlobalParams globalParams) {
 
-         if ( (is_valid(input_img(l,k))) && (numSamples(l, k)!=0) ) {
+    GeoImage<img_pixel> input_img(input_img_params.inputFilename);
+    DiskImageView<img_pixel> shadowImage(input_img_params.shadowFilename);
+    GeoImage<albedo_pixel> reflectance_image(input_img_params.reliefFilename);
+    OverlapImages overlaps = open_overlap_images(overlap_img_params);
 
-              output_img(l,k).validate();
+    ImageView<albedo_pixel> output_img(input_img.image.cols(), input_img.image.rows());
 
-              if (globalParams.useWeights == 0){
-                  output_img(l, k) = output_img(l, k)/numSamples(l,k);
-              }
-              else{
-		output_img(l, k) = output_img(l, k)/norm(l,k);
-              }
-	      numValid++;
-         }
+    std::vector<BBox2i> tiles = image_tiles(output_img.cols(), output_img.rows());
+    std::vector<int> num_valid(tiles.size(), 0);
+    run_tile_jobs(tiles, InitAlbedoTile(input_img, shadowImage, reflectance_image, overlaps,
+                                        input_img_params, globalParams, output_img, num_valid));
 
-      }
-    }
+    int numValid = std::accumulate(num_valid.begin(), num_valid.end(), 0);
+    printf("numValid = %d, total = %d\n", numValid, output_img.rows()*output_img.cols());
 
-    printf("numValid = %d, total = %d\n", numValid, input_img.rows()*input_img.cols());
-    
     //TODO: compute the albedo variance (standard deviation)
-   
-   
+
     //write in the albedo image
-    write_georeferenced_image(output_img_file,
+    write_georeferenced_image(input_img_params.outputFilename,
                               channel_cast<uint8>(clamp(output_img,0.0,255.0)),
-                              input_img_geo, TerminalProgressCallback("{Core}","Processing:"));
-    
+                              input_img.geo, TerminalProgressCallback("{Core}","Processing:"));
 }
 
 
@@ -735,276 +841,32 @@ void
 vw::photometry::UpdateAlbedoMosaic(ModelParams input_img_params,
                                    std::vector<ModelParams> overlap_img_params,
                                    GlobalParams globalParams) {
-    int i, l, k;
-
-    std::string input_img_file = input_img_params.inputFilename;
-    std::string DEM_file = input_img_params.meanDEMFilename;
-    std::string shadow_file = input_img_params.shadowFilename;
-    std::string output_img_file = input_img_params.reliefFilename;
+    ReconstructImages images(input_img_params, overlap_img_params);
+    UpdateAlbedoMosaic(images, input_img_params, globalParams);
+}
 
-  
-    DiskImageView<PixelMask<PixelGray<uint8> > >  input_img(input_img_file);
-    GeoReference input_img_geo;
-    read_georeference(input_img_geo, input_img_file);
+void
+vw::photometry::UpdateAlbedoMosaic(ReconstructImages const& images,
+                                   ModelParams input_img_params,
+                                   GlobalParams globalParams) {
 
-    DiskImageView<PixelGray<float> >  input_dem_image(DEM_file);
-    GeoReference input_dem_geo;
-    read_georeference(input_dem_geo, DEM_file);
+    std::string output_img_file = input_img_params.reliefFilename;
 
     //TO DO: read the reflectance image instead.
- 
-    DiskImageView<PixelMask<PixelGray<uint8> > >  shadowImage(shadow_file);
-
-    DiskImageView<PixelMask<PixelGray<uint8> > > output_img_r(output_img_file);
+    DiskImageView<img_pixel> output_img_r(output_img_file);
 
+    VW_ASSERT(output_img_r.cols() == images.input.image.cols() && output_img_r.rows() == images.input.image.rows(),
+              ArgumentErr() << "UpdateAlbedoMosaic: the albedo and the image differ in size");
 
-    ImageView<PixelMask<PixelGray<float> > > output_img (output_img_r.cols(), output_img_r.rows());
-
-    ImageView<PixelGray<float> > nominator(input_img.cols(), input_img.rows());
-    ImageView<PixelGray<float> > denominator(input_img.cols(), input_img.rows());
-
-    Vector3 xyz;
-    Vector3 xyz_prior;
-    int x, y;
-
-    ImageViewRef<PixelGray<float> >  interp_dem_image = interpolate(edge_extend(input_dem_image.impl(),
-                                                                                ConstantEdgeExtension()),
-                                                                                BilinearInterpolation());
-
-    //initialize the nominator and denomitor images
-    for (k = 0 ; k < input_img.rows(); ++k) {
-        for (l = 0; l < input_img.cols(); ++l) {
-
-           nominator(l, k) = 0;
-           denominator(l, k) = 0;
-
-           Vector2 input_image_pix(l,k);
-
-           //reject invalid pixels and pixels that are in shadow.
-           if ( is_valid(input_img(l,k)) && ( shadowImage(l, k) == 0)) {
-
-              //get the corresponding DEM value
-
-              Vector2 lon_lat = input_img_geo.pixel_to_lonlat(input_image_pix);
-              Vector2 input_dem_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_image_pix));
-
-              x = (int)input_dem_pix[0];
-              y = (int)input_dem_pix[1];
-
-
-              //check for valid DEM coordinates
-              if ((x>=0) && (x < input_dem_image.cols()) && (y>=0) && (y< input_dem_image.rows())){
-
-                //Vector3 longlat3(lon_lat(0),lon_lat(1),(input_dem_image)(x, y));
-                Vector3 longlat3(lon_lat(0),lon_lat(1),(interp_dem_image)(x, y));
-                Vector3 xyz = input_img_geo.datum().geodetic_to_cartesian(longlat3);//3D coordinates in the img coordinates
-
-
-                Vector2 input_img_left_pix;
-                input_img_left_pix(0) = l-1;
-                input_img_left_pix(1) = k;
-
-                Vector2 input_img_top_pix;
-                input_img_top_pix(0) = l;
-                input_img_top_pix(1) = k-1;
-
-                //check for valid DEM pixel value and valid left and top coordinates
-                //if ((input_dem_left_pix(0) >= 0) && (input_dem_top_pix(1) >= 0) && (input_dem_image(x,y) != -10000)){
-                if ((input_img_left_pix(0) >= 0) && (input_img_top_pix(1) >= 0) && (input_dem_image(x,y) != globalParams.noDEMDataValue)){
-
-                  //determine the 3D coordinates of the pixel left of the current pixel
-                  Vector2 input_dem_left_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_left_pix));
-                  Vector2 lon_lat_left = input_img_geo.pixel_to_lonlat(input_img_left_pix);
-                  Vector3 longlat3_left(lon_lat_left(0),lon_lat_left(1),(interp_dem_image)(input_dem_left_pix(0), input_dem_left_pix(1)));
-
-                  //Vector3 xyz_left = input_dem_geo.datum().geodetic_to_cartesian(longlat3_left);
-                  Vector3 xyz_left = input_img_geo.datum().geodetic_to_cartesian(longlat3_left);
-
-                  //determine the 3D coordinates of the pixel top of the current pixel
-                  Vector2 input_dem_top_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_top_pix));
-                  Vector2 lon_lat_top = input_img_geo.pixel_to_lonlat(input_img_top_pix);
-                  Vector3 longlat3_top(lon_lat_top(0),lon_lat_top(1),(interp_dem_image)(input_dem_top_pix(0), input_dem_top_pix(1)));
-                  Vector3 xyz_top = input_img_geo.datum().geodetic_to_cartesian(longlat3_top);
-
-                  //Vector3 normal = computeNormalFrom3DPoints(xyz, xyz_left, xyz_top);
-                  Vector3 normal = computeNormalFrom3DPointsGeneral(xyz, xyz_left, xyz_top);
-
-                  //This part is the only image depedent part - START
-                  float input_img_reflectance;
-                  input_img_reflectance = ComputeReflectance(normal, xyz, input_img_params, globalParams);
-
-                  if (input_img_reflectance > 0){
-                     float input_img_error = ComputeError((float)input_img(l,k), input_img_params.exposureTime,
-                                                                 (float)output_img_r(l, k),  input_img_reflectance);
-
-//                     float input_img_error = ComputeError_Albedo((float)input_img(l,k), input_img_params.exposureTime,
-//                                                                 (float)output_img_r(l, k),  input_img_reflectance, xyz, xyz_prior);
-
-                     float input_albedo_grad = ComputeGradient_Albedo(input_img_params.exposureTime, input_img_reflectance);
-
-
-                     if (globalParams.useWeights == 0){
-                         nominator(l, k) = input_albedo_grad*input_img_error;
-                         denominator(l, k) = input_albedo_grad*input_albedo_grad;
-                         }
-                     else{
-                         float weight = ComputeLineWeights(input_image_pix, input_img_params.centerLine, input_img_params.maxDistArray);
-                         nominator(l, k)   = input_albedo_grad*input_img_error*weight;
-                         denominator(l, k) = input_albedo_grad*input_albedo_grad*weight;
-                     }
-
-                     output_img(l, k) = 0;//(float)(output_img_r(l, k));
-                  }
-
-                  //This part is the only image depedent part - END
-                }
-              }
-           }
-        }
-    }
-
-
-    //update from the overlapping images
-    for (i = 0; i < (int)overlap_img_params.size(); i++){
-
-      printf("overlap_img = %s\n", overlap_img_params[i].inputFilename.c_str());
-
-      DiskImageView<PixelMask<PixelGray<uint8> > >  overlap_img(overlap_img_params[i].inputFilename);
-      GeoReference overlap_geo;
-     
-      read_georeference(overlap_geo, overlap_img_params[i].inputFilename);
-
-      DiskImageView<PixelMask<PixelGray<uint8> > >  overlapShadowImage(overlap_img_params[i].shadowFilename);
-
-      ImageViewRef<PixelMask<PixelGray<uint8> > >  interp_overlap_img = interpolate(edge_extend(overlap_img.impl(),
-                                                                                    ConstantEdgeExtension()),
-                                                                                    BilinearInterpolation());
-
-      ImageViewRef<PixelMask<PixelGray<uint8> > >  interpOverlapShadowImage = interpolate(edge_extend(overlapShadowImage.impl(),
-                                                                                           ConstantEdgeExtension()),
-                                                                                           BilinearInterpolation());
-
-      for (k = 0 ; k < input_img.rows(); ++k) {
-        for (l = 0; l < input_img.cols(); ++l) {
-
-         Vector2 input_img_pix(l,k);
-
-         if ( is_valid(input_img(l,k)) ) {
-
-              //get the corresponding DEM value
-              Vector2 lon_lat = input_img_geo.pixel_to_lonlat(input_img_pix);
-              Vector2 input_dem_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_pix));
-
-              x = (int)input_dem_pix[0];
-              y = (int)input_dem_pix[1];
-
-              //check for valid DEM coordinates
-              if ((x>=0) && (x < input_dem_image.cols()) && (y>=0) && (y< input_dem_image.rows())){
-
-                //get the top and left DEM value
-                Vector3 longlat3(lon_lat(0),lon_lat(1),(interp_dem_image)(x, y));
-                Vector3 xyz = input_img_geo.datum().geodetic_to_cartesian(longlat3);
-
-                Vector2 input_img_left_pix;
-                input_img_left_pix(0) = l-1;
-                input_img_left_pix(1) = k;
-
-                Vector2 input_img_top_pix;
-                input_img_top_pix(0) = l;
-                input_img_top_pix(1) = k-1;
-
-                //check for valid DEM pixel value and valid left and top coordinates
-                if ((input_img_left_pix(0) >= 0) && (input_img_top_pix(1) >= 0) && (input_dem_image(x,y) != globalParams.noDEMDataValue)){
-
-
-                  //determine the 3D coordinates of the pixel left of the current pixel
-                  Vector2 input_dem_left_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_left_pix));
-                  Vector2 lon_lat_left = input_img_geo.pixel_to_lonlat(input_img_left_pix);
-                  Vector3 longlat3_left(lon_lat_left(0),lon_lat_left(1),(interp_dem_image)(input_dem_left_pix(0), input_dem_left_pix(1)));
-                  Vector3 xyz_left = input_img_geo.datum().geodetic_to_cartesian(longlat3_left);
-
-
-                  Vector2 input_dem_top_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_top_pix));
-                  Vector2 lon_lat_top = input_img_geo.pixel_to_lonlat(input_img_top_pix);
-                  Vector3 longlat3_top(lon_lat_top(0),lon_lat_top(1),(interp_dem_image)(input_dem_top_pix(0), input_dem_top_pix(1)));
-                  Vector3 xyz_top = input_img_geo.datum().geodetic_to_cartesian(longlat3_top);
-
-                  //Vector3 normal = computeNormalFrom3DPoints(xyz, xyz_left, xyz_top);
-                  Vector3 normal = computeNormalFrom3DPointsGeneral(xyz, xyz_left, xyz_top);
-
-                  //check for overlap between the output image and the input DEM image
-                  Vector2 overlap_pix = overlap_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_pix));
-                  x = (int)overlap_pix[0];
-                  y = (int)overlap_pix[1];
-
-                  //image dependent part of the code  - START
-                  PixelMask<PixelGray<uint8> > overlap_img_pixel = interp_overlap_img(x, y);
-
-                  //check for valid overlap_img coordinates
-                  //TO DO: remove shadow pixels in the overlap_img.
-                  if ((x>=0) && (x < overlap_img.cols()) && (y>=0) && (y< overlap_img.rows()) && interpOverlapShadowImage(x, y) == 0){
-
-                    if ( is_valid(overlap_img_pixel) ) { //common area between input_img and overlap_img
-
-                      float overlap_img_reflectance;
-                      overlap_img_reflectance = ComputeReflectance(normal, xyz, overlap_img_params[i], globalParams);
-                      if (overlap_img_reflectance > 0){
-                         float overlap_img_error = ComputeError((float)overlap_img_pixel, overlap_img_params[i].exposureTime,
-                                                                       (float)output_img_r(l, k), overlap_img_reflectance);
-//                         float overlap_img_error = ComputeError_Albedo((float)overlap_img_pixel, overlap_img_params[i].exposureTime,
-//                                                                       (float)output_img_r(l, k), overlap_img_reflectance, xyz, xyz_prior);
-
-                         float overlap_albedo_grad = ComputeGradient_Albedo(overlap_img_params[i].exposureTime, overlap_img_reflectance);
-                         if (globalParams.useWeights == 0){
-                             nominator(l, k) = nominator(l, k) + overlap_albedo_grad*overlap_img_error;
-                             denominator(l, k) = denominator(l, k) + overlap_albedo_grad*overlap_albedo_grad;
-                         }
-                         else{
-
-                           //float weight = ComputeWeights(overlap_pix, overlap_img_params[i].center2D, overlap_img_params[i].maxDistance);
-                            float weight = ComputeLineWeights(overlap_pix, overlap_img_params[i].centerLine, overlap_img_params[i].maxDistArray);
-                            nominator(l, k)   = nominator(l,k) + overlap_albedo_grad*overlap_img_error*weight;
-                            denominator(l, k) = denominator(l,k) + overlap_albedo_grad*overlap_albedo_grad*weight;
-                         }
-                      }
-                    }//if
-                  }//if
-
-                  //image dependent part of the code  - START
-               }
-            }
-          }
-        }// for l
-      } // for k
-    } //for i
-
-
-    //finalize the output image
-    for (k = 0 ; k < output_img.rows(); ++k) {
-       for (l = 0; l < output_img.cols(); ++l) {
-           
-           output_img(l,k).invalidate();
-           
-           if ( is_valid(output_img(l,k)) ) {
-             if ((float)denominator(l, k) != 0){
-                float delta = (float)nominator(l, k)/(float)denominator(l, k);
-                //printf("k = %d, l = %d, output_img = %f, delta = %f\n", k, l, (float)output_img(l,k), delta);
-                output_img(l,k) = (float)output_img_r(l, k) + delta;
-                output_img(l,k).validate();
-             }
-           }
-
-       }
-    }
-
+    ImageView<albedo_pixel> output_img(output_img_r.cols(), output_img_r.rows());
 
+    run_tile_jobs(image_tiles(output_img.cols(), output_img.rows()),
+                  UpdateAlbedoTile(images, output_img_r, input_img_params, globalParams, output_img));
 
     //write the output (albedo) image
-     write_georeferenced_image(output_img_file,
+    write_georeferenced_image(output_img_file,
                               channel_cast<uint8>(clamp(output_img,0.0,255.0)),
-                              input_img_geo, TerminalProgressCallback("photometry","Processing:"));
-
-
+                              images.input.geo, TerminalProgressCallback("photometry","Processing:"));
 }
 //input_files[i], input_files[i-1], output_files[i], output_files[i-1]
 //writes the current albedo of the current image in the area of overlap with the previous mage
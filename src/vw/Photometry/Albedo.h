@@ -44,6 +44,15 @@ namespace photometry {
                           std::vector<ModelParams> overlap_img_params,
                           GlobalParams globalParams);
 
+  struct ReconstructImages;
+
+  /// UpdateAlbedoMosaic over images already open, to share them with the
+  /// passes run after it over the same input image, such as
+  /// ComputeReconstructionErrorMap.
+  void UpdateAlbedoMosaic(ReconstructImages const& images,
+                          ModelParams input_img_params,
+                          GlobalParams globalParams);
+
   //josh - moved to ReconstructError.h
   //reconstruction error functions
 //  void ComputeReconstructionErrorMap(ModelParams input_img_params,
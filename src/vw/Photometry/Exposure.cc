@@ -22,6 +22,7 @@ using namespace vw::cartography;
 #include <vw/Photometry/Misc.h>
 #include <vw/Photometry/Weights.h>
 #include <vw/Photometry/Exposure.h>
+#include <vw/Photometry/Tiles.h>
 using namespace vw::photometry;
 
 //determines the best guess for the exposure time from the reflectance model
@@ -121,148 +122,184 @@ void vw::photometry::ReadExposureInfoFromFile(ModelParams *modelParams)
 }
 
 
-//computes the exposure time for image mosaicing (no reflectance model)
-void vw::photometry::ComputeExposure(ModelParams *currModelParams,
-                                     GlobalParams /*globalParams*/) {
-
-  std::string curr_input_file = currModelParams->inputFilename;
-  std::string curr_albedo_file = currModelParams->outputFilename;
-
-  DiskImageView<PixelMask<PixelGray<uint8> > > curr_image(curr_input_file);
-  DiskImageView<PixelMask<PixelGray<uint8> > > curr_albedo(curr_albedo_file);
-
-  GeoReference curr_geo;
-  read_georeference(curr_geo, curr_input_file);
+// The exposure passes sum the Gauss-Newton terms of each tile of the
+// image in a job of its own; the sums are added up in tile order, so the
+// result does not depend on how the jobs were scheduled.
+namespace {
 
-  float currReflectance;
+  typedef PixelMask<PixelGray<uint8> > img_pixel;
 
-  printf("init exposure time = %f, file = %s\n", currModelParams->exposureTime, curr_input_file.c_str());
+  // The terms of the exposure time update for a tile of an image mosaic
+  class ExposureTile {
+    DiskImageView<img_pixel> const& m_image;
+    DiskImageView<img_pixel> const& m_albedo;
+    ModelParams const& m_params;
+    std::vector<Vector2f>& m_sums;
 
-  float delta_nominator = 0.0;
-  float delta_denominator = 0.0;
+  public:
+    ExposureTile(DiskImageView<img_pixel> const& image, DiskImageView<img_pixel> const& albedo,
+                 ModelParams const& params, std::vector<Vector2f>& sums)
+      : m_image(image), m_albedo(albedo), m_params(params), m_sums(sums) {}
 
-  for (int k=0; k < (int)curr_image.rows(); ++k) {
-    for (int l=0; l < (int)curr_image.cols(); ++l) {
+    void operator()(size_t index, BBox2i const& bbox) const {
+      ImageView<img_pixel> curr_image = crop(m_image, bbox);
+      ImageView<img_pixel> curr_albedo = crop(m_albedo, bbox);
 
-      Vector2 curr_sample_pix(l,k);
+      float delta_nominator = 0.0;
+      float delta_denominator = 0.0;
 
-      if ( is_valid(curr_image(l,k)) ) {
-
-        currReflectance = 1;
-        float error = ComputeError((float)curr_image(l,k), currModelParams->exposureTime,
-                                            (float)curr_albedo(l,k), currReflectance);
-//        float error = ComputeError_Exposure((float)curr_image(l,k), currModelParams->exposureTime,
-//                                            (float)curr_albedo(l,k), currReflectance);
-        float gradient = ComputeGradient_Exposure( (float)curr_albedo(l,k), currReflectance);
-
-        delta_nominator = delta_nominator + error*gradient;
-        delta_denominator = delta_denominator + gradient*gradient;
+      for (int k=0; k < bbox.height(); ++k) {
+        for (int l=0; l < bbox.width(); ++l) {
+          if ( is_valid(curr_image(l,k)) ) {
+            float currReflectance = 1;
+            float error = ComputeError((float)curr_image(l,k), m_params.exposureTime,
+                                       (float)curr_albedo(l,k), currReflectance);
+            float gradient = ComputeGradient_Exposure( (float)curr_albedo(l,k), currReflectance);
 
+            delta_nominator = delta_nominator + error*gradient;
+            delta_denominator = delta_denominator + gradient*gradient;
+          }
+        }
       }
+      m_sums[index] = Vector2f(delta_nominator, delta_denominator);
     }
-  }
-
-  float delta = delta_nominator/delta_denominator;
-  currModelParams->exposureTime = currModelParams->exposureTime+delta;
-  printf("updated exposure time = %f\n", currModelParams->exposureTime);
-}
-
-void vw::photometry::ComputeExposureAlbedo(ModelParams *currModelParams,
-                                           GlobalParams globalParams) {
-
-  std::string curr_input_file = currModelParams->inputFilename;
-  std::string curr_albedo_file = currModelParams->outputFilename;
-  std::string DEM_file = currModelParams->meanDEMFilename;
-
-  DiskImageView<PixelMask<PixelGray<uint8> > > curr_image(curr_input_file);
-  DiskImageView<PixelMask<PixelGray<uint8> > > curr_albedo(curr_albedo_file);
-
-  GeoReference curr_geo;
-  read_georeference(curr_geo, curr_input_file);
-
-  float currReflectance;
-
-  //read the DEM file
-  DiskImageView<PixelGray<float> >  dem_image(DEM_file);
-  GeoReference curr_dem_geo;
-  read_georeference(curr_dem_geo, DEM_file);
-
-  printf("init exposure time = %f, file = %s\n", currModelParams->exposureTime, curr_input_file.c_str());
+  };
+
+  // The terms of the exposure time update for a tile of an image, under
+  // the reflectance model
+  class ExposureAlbedoTile {
+    GeoImage<img_pixel> const& m_image;
+    DiskImageView<img_pixel> const& m_albedo;
+    GeoImage<PixelGray<float> > const& m_dem;
+    ModelParams const& m_params;
+    GlobalParams const& m_global;
+    std::vector<Vector2f>& m_sums;
+
+  public:
+    ExposureAlbedoTile(GeoImage<img_pixel> const& image, DiskImageView<img_pixel> const& albedo,
+                       GeoImage<PixelGray<float> > const& dem, ModelParams const& params,
+                       GlobalParams const& global, std::vector<Vector2f>& sums)
+      : m_image(image), m_albedo(albedo), m_dem(dem), m_params(params), m_global(global), m_sums(sums) {}
+
+    void operator()(size_t index, BBox2i const& bbox) const {
+      m_sums[index] = Vector2f();
+
+      ImageView<img_pixel> curr_image = crop(m_image.image, bbox);
+      ImageView<img_pixel> curr_albedo = crop(m_albedo, bbox);
+
+      std::vector<Vector2> pixels = grid_pixels(bbox), lon_lats, dem_pixels;
+      m_image.geo.pixels_to_lonlats(pixels, lon_lats);
+      m_dem.geo.lonlats_to_pixels(lon_lats, dem_pixels);
+      dem_pixels = truncate_pixels(dem_pixels);
+
+      // each pixel needs its DEM pixel and the ones left of and above it
+      std::vector<Vector2> samples = dem_pixels;
+      for (size_t i = 0; i < dem_pixels.size(); ++i)
+        samples.push_back(dem_pixels[i] - Vector2(1,1));
+      ImageRegion<PixelGray<float> > dem_image(m_dem.image, samples);
+      if (dem_image.empty())
+        return;
+
+      //the pixels with valid DEM coordinates, DEM pixel value and left and top coordinates
+      std::vector<int32> used;
+      std::vector<Vector2> dem_left_pixels, dem_top_pixels;
+      for (int k=0, i=0; k < bbox.height(); ++k) {
+        for (int l=0; l < bbox.width(); ++l, ++i) {
+          const int x = (int)dem_pixels[i][0], y = (int)dem_pixels[i][1];
+          if ( is_valid(curr_image(l,k)) && in_bounds(dem_pixels[i], m_dem.image) &&
+               (x-1 >= 0) && (y-1 >= 0) && (dem_image.at(x,y) != m_global.noDEMDataValue/*-10000*/) ) {
+            used.push_back(i);
+            dem_left_pixels.push_back(Vector2(x-1,y));
+            dem_top_pixels.push_back(Vector2(x,y-1));
+          }
+        }
+      }
 
-  float delta_nominator = 0.0;
-  float delta_denominator = 0.0;
+      std::vector<Vector2> lon_lats_left, lon_lats_top;
+      m_dem.geo.pixels_to_lonlats(dem_left_pixels, lon_lats_left);
+      m_dem.geo.pixels_to_lonlats(dem_top_pixels, lon_lats_top);
 
-  for (int k=0; k < (int)curr_image.rows(); ++k) {
-    for (int l=0; l < (int)curr_image.cols(); ++l) {
+      cartography::Datum const& datum = m_image.geo.datum();
+      float delta_nominator = 0.0;
+      float delta_denominator = 0.0;
 
-      Vector2 curr_sample_pix(l,k);
+      for (size_t j = 0; j < used.size(); ++j) {
+        const int32 i = used[j], l = i % bbox.width(), k = i / bbox.width();
+        const int x = (int)dem_pixels[i][0], y = (int)dem_pixels[i][1];
 
-      if ( is_valid(curr_image(l,k)) ) {
+        Vector3 longlat3(lon_lats[i](0),lon_lats[i](1),dem_image.at(x, y));
+        Vector3 xyz = datum.geodetic_to_cartesian(longlat3);
 
-        Vector2 lon_lat = curr_geo.pixel_to_lonlat(curr_sample_pix);
-        Vector2 sample_pix_dem = curr_dem_geo.lonlat_to_pixel(curr_geo.pixel_to_lonlat(curr_sample_pix));
+        Vector3 longlat3_left(lon_lats_left[j](0),lon_lats_left[j](1),dem_image.at(x-1, y));
+        Vector3 xyz_left = datum.geodetic_to_cartesian(longlat3_left);
 
-        int x = (int)sample_pix_dem[0];
-        int y = (int)sample_pix_dem[1];
+        Vector3 longlat3_top(lon_lats_top[j](0),lon_lats_top[j](1),dem_image.at(x, y-1));
+        Vector3 xyz_top = datum.geodetic_to_cartesian(longlat3_top);
 
-        //check for valid DEM coordinates
-        if ((x>=0) && (x < dem_image.cols()) && (y>=0) && (y< dem_image.rows())){
+        Vector3 normal = computeNormalFrom3DPointsGeneral(xyz, xyz_left, xyz_top);
 
-          Vector3 longlat3(lon_lat(0),lon_lat(1),(dem_image)(x, y));
-          Vector3 xyz = curr_geo.datum().geodetic_to_cartesian(longlat3);
+        float currReflectance = ComputeReflectance(normal, xyz, m_params, m_global);
+        float error = ComputeError((float)curr_image(l,k), m_params.exposureTime,
+                                   (float)curr_albedo(l,k), currReflectance);
+        float gradient = ComputeGradient_Exposure(m_params.exposureTime, (float)curr_albedo(l,k));
 
-          Vector2 sample_pix_dem_left;
-          sample_pix_dem_left(0) = x-1;
-          sample_pix_dem_left(1) = y;
+        if (m_global.useWeights == 0){
+          delta_nominator = delta_nominator + error*gradient;
+          delta_denominator = delta_denominator + gradient*gradient;
+        }
+        else{
+          float weight = ComputeLineWeights(pixels[i], m_params.centerLine, m_params.maxDistArray);
+          delta_nominator = delta_nominator + error*gradient*weight;
+          delta_denominator = delta_denominator + gradient*gradient*weight;
+        }
+      }
+      m_sums[index] = Vector2f(delta_nominator, delta_denominator);
+    }
+  };
 
-          Vector2 sample_pix_dem_top;
-          sample_pix_dem_top(0) = x;
-          sample_pix_dem_top(1) = y-1;
+  Vector2f sum_tiles(std::vector<Vector2f> const& sums) {
+    Vector2f total;
+    for (size_t i = 0; i < sums.size(); ++i)
+      total += sums[i];
+    return total;
+  }
 
+} // namespace
 
-          //check for valid DEM pixel value and valid left and top coordinates
-          if ((sample_pix_dem_left(0) >= 0) && (sample_pix_dem_top(1) >= 0) && (dem_image(x,y) != globalParams.noDEMDataValue/*-10000*/)){
+//computes the exposure time for image mosaicing (no reflectance model)
+void vw::photometry::ComputeExposure(ModelParams *currModelParams,
+                                     GlobalParams /*globalParams*/) {
 
-            Vector2 lon_lat_left = curr_dem_geo.pixel_to_lonlat(sample_pix_dem_left);
-            Vector3 longlat3_left(lon_lat_left(0),lon_lat_left(1),(dem_image)(sample_pix_dem_left(0), sample_pix_dem_left(1)));
-            Vector3 xyz_left = curr_geo.datum().geodetic_to_cartesian(longlat3_left);
+  DiskImageView<img_pixel> curr_image(currModelParams->inputFilename);
+  DiskImageView<img_pixel> curr_albedo(currModelParams->outputFilename);
 
-            Vector2 lon_lat_top= curr_dem_geo.pixel_to_lonlat(sample_pix_dem_top);
-            Vector3 longlat3_top(lon_lat_top(0),lon_lat_top(1),(dem_image)(sample_pix_dem_top(0), sample_pix_dem_top(1)));
-            Vector3 xyz_top = curr_geo.datum().geodetic_to_cartesian(longlat3_top);
+  printf("init exposure time = %f, file = %s\n", currModelParams->exposureTime, currModelParams->inputFilename.c_str());
 
-            //Vector3 normal = computeNormalFrom3DPoints(xyz, xyz_left, xyz_top);
-            Vector3 normal = computeNormalFrom3DPointsGeneral(xyz, xyz_left, xyz_top);
+  std::vector<BBox2i> tiles = image_tiles(curr_image.cols(), curr_image.rows());
+  std::vector<Vector2f> sums(tiles.size());
+  run_tile_jobs(tiles, ExposureTile(curr_image, curr_albedo, *currModelParams, sums));
+  Vector2f total = sum_tiles(sums);
 
-            currReflectance = ComputeReflectance(normal, xyz, *currModelParams, globalParams);
-            float error = ComputeError((float)curr_image(l,k), currModelParams->exposureTime,
-                                                (float)curr_albedo(l,k), currReflectance);
-//            float error = ComputeError_Exposure((float)curr_image(l,k), currModelParams->exposureTime,
-//                                                (float)curr_albedo(l,k), currReflectance, xyz, xyz);
+  float delta = total[0]/total[1];
+  currModelParams->exposureTime = currModelParams->exposureTime+delta;
+  printf("updated exposure time = %f\n", currModelParams->exposureTime);
+}
 
-            float gradient = ComputeGradient_Exposure(currModelParams->exposureTime, (float)curr_albedo(l,k));
+void vw::photometry::ComputeExposureAlbedo(ModelParams *currModelParams,
+                                           GlobalParams globalParams) {
 
-            if (globalParams.useWeights == 0){
-              delta_nominator = delta_nominator + error*gradient;
-              delta_denominator = delta_denominator + gradient*gradient;
+  GeoImage<img_pixel> curr_image(currModelParams->inputFilename);
+  DiskImageView<img_pixel> curr_albedo(currModelParams->outputFilename);
+  GeoImage<PixelGray<float> > dem_image(currModelParams->meanDEMFilename);
 
-            }
-            else{
-              //float weight = ComputeWeights(curr_sample_pix, currModelParams->center2D, currModelParams->maxDistance);
-              float weight = ComputeLineWeights(curr_sample_pix, currModelParams->centerLine, currModelParams->maxDistArray);
-              delta_nominator = delta_nominator + error*gradient*weight;
-              delta_denominator = delta_denominator + gradient*gradient*weight;
-            }
+  printf("init exposure time = %f, file = %s\n", currModelParams->exposureTime, currModelParams->inputFilename.c_str());
 
-            //delta_nominator = delta_nominator + error*gradient;
-            //delta_denominator = delta_denominator + gradient*gradient;
-          }
-        }
-      }
-    }
-  }
+  std::vector<BBox2i> tiles = image_tiles(curr_image.image.cols(), curr_image.image.rows());
+  std::vector<Vector2f> sums(tiles.size());
+  run_tile_jobs(tiles, ExposureAlbedoTile(curr_image, curr_albedo, dem_image, *currModelParams, globalParams, sums));
+  Vector2f total = sum_tiles(sums);
 
-  float delta = delta_nominator/delta_denominator;
+  float delta = total[0]/total[1];
   printf("delta = %f\n", delta);
   currModelParams->exposureTime = currModelParams->exposureTime+delta;
   printf("updated exposure time = %f\n", currModelParams->exposureTime);
@@ -21,6 +21,7 @@ using namespace vw::cartography;
 #include <vw/Photometry/Reconstruct.h>
 #include <vw/Photometry/ReconstructError.h>
 #include <vw/Photometry/Reflectance.h>
+#include <vw/Photometry/Tiles.h>
 #include <vw/Photometry/Weights.h>
 
 using namespace vw::photometry;
@@ -36,228 +37,160 @@ vw::photometry::ComputeError(float intensity, float T,
   return error;
 }
 
-void
-vw::photometry::ComputeReconstructionErrorMap(ModelParams input_img_params,
-    std::vector<ModelParams> overlap_img_params,
-    GlobalParams globalParams,
-    float *avgError, int *totalNumSamples) {
-
-  int i, l, k;
-  std::string input_img_file = input_img_params.inputFilename;
-  std::string DEM_file = input_img_params.meanDEMFilename;
-  std::string shadow_file = input_img_params.shadowFilename;
-  std::string albedo_file = input_img_params.outputFilename;
-  std::string error_img_file = input_img_params.errorFilename;
-
-  DiskImageView<PixelMask<PixelGray<uint8> > > input_img(input_img_file);
-  GeoReference input_img_geo;
-  read_georeference(input_img_geo, input_img_file);
-
-  DiskImageView<PixelGray<float> > input_dem_image(DEM_file);
-  GeoReference input_dem_geo;
-  read_georeference(input_dem_geo, DEM_file);
-
-  DiskImageView<PixelMask<PixelGray<uint8> > > shadowImage(shadow_file);
-
-  DiskImageView<PixelMask<PixelGray<uint8> > > albedo (albedo_file);
-
-  ImageView<PixelMask<PixelGray<float> > > error_img (input_img.cols(), input_img.rows());
+// The error map is computed a block at a time, the georeference
+// conversions and the surface for the whole block at once, reading only
+// the parts of the DEM and of the overlapping images under the block.
+ImageView<ReconstructionErrorView::pixel_type>
+vw::photometry::ReconstructionErrorView::error_block(BBox2i const& bbox,
+                                                     ImageView<PixelGray<int> >* samples) const {
+  typedef PixelMask<PixelGray<uint8> > img_pixel;
+  const int32 cols = bbox.width(), rows = bbox.height();
 
-  ImageView<PixelGray<int> > numSamples(input_img.cols(), input_img.rows());
+  ImageView<img_pixel> input_img = crop(m_images->input.image, bbox);
+  ImageView<img_pixel> shadowImage = crop(m_images->shadow, bbox);
+  ImageView<img_pixel> albedo = crop(m_albedo, bbox);
 
-  Vector3 xyz;
-  Vector3 xyz_prior;
-  int x, y;
+  ImageView<pixel_type> error_img(cols, rows);
+  ImageView<PixelGray<float> > sqError(cols, rows);
+  ImageView<PixelGray<int> > numSamples(cols, rows);
 
-  ImageViewRef<PixelGray<float> > interp_dem_image = interpolate(edge_extend(input_dem_image.impl(),
-        ConstantEdgeExtension()),
-      BilinearInterpolation());
+  std::vector<Vector2> lon_lats;
+  std::vector<SurfacePoint> points = image_surface(m_images->input.geo, m_images->dem,
+                                                   m_global.noDEMDataValue, bbox, lon_lats);
 
-  //initialize the nominator and denomitor images
-  for (k = 0 ; k < input_img.rows(); ++k) {
-    for (l = 0; l < input_img.cols(); ++l) {
-
-      Vector2 input_image_pix(l,k);
-      numSamples(l,k) = 0;
+  for (int32 k = 0, i = 0; k < rows; ++k) {
+    for (int32 l = 0; l < cols; ++l, ++i) {
+      sqError(l, k) = 0;
+      numSamples(l, k) = 0;
 
       //reject invalid pixels and pixels that are in shadow.
-      if ( is_valid(input_img(l,k)) && ( shadowImage(l, k) == 0)) {
-
-        //get the corresponding DEM value
-
-        Vector2 lon_lat = input_img_geo.pixel_to_lonlat(input_image_pix);
-        Vector2 input_dem_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_image_pix));
-
-        x = (int)input_dem_pix[0];
-        y = (int)input_dem_pix[1];
-
-
-        //check for valid DEM coordinates
-        if ((x>=0) && (x < input_dem_image.cols()) && (y>=0) && (y< input_dem_image.rows())){
-
-          //Vector3 longlat3(lon_lat(0),lon_lat(1),(input_dem_image)(x, y));
-          Vector3 longlat3(lon_lat(0),lon_lat(1),(interp_dem_image)(x, y));
-          Vector3 xyz = input_img_geo.datum().geodetic_to_cartesian(longlat3);//3D coordinates in the img coordinates
-
-
-          Vector2 input_img_left_pix;
-          input_img_left_pix(0) = l-1;
-          input_img_left_pix(1) = k;
-
-          Vector2 input_img_top_pix;
-          input_img_top_pix(0) = l;
-          input_img_top_pix(1) = k-1;
-
-          //check for valid DEM pixel value and valid left and top coordinates
-          //if ((input_dem_left_pix(0) >= 0) && (input_dem_top_pix(1) >= 0) && (input_dem_image(x,y) != -10000)){
-          if ((input_img_left_pix(0) >= 0) && (input_img_top_pix(1) >= 0) && (input_dem_image(x,y) != -10000)){
-
-            //determine the 3D coordinates of the pixel left of the current pixel
-            Vector2 input_dem_left_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_left_pix));
-            Vector2 lon_lat_left = input_img_geo.pixel_to_lonlat(input_img_left_pix);
-            Vector3 longlat3_left(lon_lat_left(0),lon_lat_left(1),(interp_dem_image)(input_dem_left_pix(0), input_dem_left_pix(1)));
-
-            //Vector3 xyz_left = input_dem_geo.datum().geodetic_to_cartesian(longlat3_left);
-            Vector3 xyz_left = input_img_geo.datum().geodetic_to_cartesian(longlat3_left);
-
-            //determine the 3D coordinates of the pixel top of the current pixel
-            Vector2 input_dem_top_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_top_pix));
-            Vector2 lon_lat_top = input_img_geo.pixel_to_lonlat(input_img_top_pix);
-            Vector3 longlat3_top(lon_lat_top(0),lon_lat_top(1),(interp_dem_image)(input_dem_top_pix(0), input_dem_top_pix(1)));
-            Vector3 xyz_top = input_img_geo.datum().geodetic_to_cartesian(longlat3_top);
-
-            //Vector3 normal = computeNormalFrom3DPoints(xyz, xyz_left, xyz_top);
-            Vector3 normal = computeNormalFrom3DPointsGeneral(xyz, xyz_left, xyz_top);
+      if ( !is_valid(input_img(l,k)) || !( shadowImage(l, k) == 0) || !points[i].valid )
+        continue;
+
+      //This part is the only image depedent part - START
+      float input_img_reflectance = ComputeReflectance(points[i].normal, points[i].xyz, m_params, m_global);
+      if (input_img_reflectance > 0){
+        float input_img_error = ComputeError((float)input_img(l,k), m_params.exposureTime,
+                                             (float)albedo(l, k), input_img_reflectance);
+        sqError(l, k) = input_img_error*input_img_error;
+        numSamples(l, k) = 1;
+      }
+      //This part is the only image depedent part - END
+    }
+  }
 
-            //This part is the only image depedent part - START
-            float input_img_reflectance;
-            input_img_reflectance = ComputeReflectance(normal, xyz, input_img_params, globalParams);
+  //update from the overlapping images
+  for (size_t j = 0; j < m_images->overlaps.size(); j++){
+    OverlapImage const& overlap = *m_images->overlaps[j];
+
+    std::vector<Vector2> overlap_pixels;
+    overlap.image.geo.lonlats_to_pixels(lon_lats, overlap_pixels);
+    overlap_pixels = truncate_pixels(overlap_pixels);
+    ImageRegion<img_pixel> overlap_region(overlap.image.image, overlap_pixels);
+    if (overlap_region.empty())
+      continue;
+    ImageRegion<img_pixel> overlap_shadow_region(overlap.shadow, overlap_pixels);
+
+    for (int32 k = 0, i = 0; k < rows; ++k) {
+      for (int32 l = 0; l < cols; ++l, ++i) {
+        if ( !is_valid(input_img(l,k)) || !points[i].valid )
+          continue;
+
+        //check for valid overlap_img coordinates
+        //remove shadow pixels in the overlap_img.
+        Vector2 const& overlap_pix = overlap_pixels[i];
+        if ( !in_bounds(overlap_pix, overlap.image.image) || !(overlap_shadow_region(overlap_pix[0], overlap_pix[1]) == 0) )
+          continue;
+
+        img_pixel overlap_img_pixel = overlap_region(overlap_pix[0], overlap_pix[1]);
+        if ( !is_valid(overlap_img_pixel) )
+          continue;
+
+        //common area between input_img and overlap_img
+        float overlap_img_reflectance = ComputeReflectance(points[i].normal, points[i].xyz, overlap.params, m_global);
+        if (overlap_img_reflectance > 0){
+          float overlap_img_error = ComputeError((float)overlap_img_pixel, overlap.params.exposureTime,
+                                                 (float)albedo(l, k), overlap_img_reflectance);
+          sqError(l, k) = sqError(l, k) + overlap_img_error*overlap_img_error;
+          numSamples(l, k) = numSamples(l, k) + 1;
+        }
+      }
+    }
+  }
 
-            if (input_img_reflectance > 0){
-              float input_img_error = ComputeError((float)input_img(l,k),
-                  input_img_params.exposureTime, (float)albedo(l, k), input_img_reflectance);//, xyz, xyz_prior);
+  //finalize the output image; computes the standard deviation
+  for (int32 k = 0; k < rows; ++k) {
+    for (int32 l = 0; l < cols; ++l) {
+      if ( numSamples(l,k) ) {
+        error_img(l, k) = (float)sqrt(sqError(l, k)/numSamples(l, k));
+      }
+    }
+  }
 
-              error_img(l, k) = input_img_error*input_img_error;
-              numSamples(l,k) = numSamples(l,k)+1;
-            }
+  if (samples)
+    *samples = numSamples;
+  return error_img;
+}
 
-            //This part is the only image depedent part - END
+namespace {
+  // Computes a tile of the error map, with the sum of its errors and its
+  // number of valid pixels.
+  class ErrorMapTile {
+    ReconstructionErrorView const& m_view;
+    ImageView<ReconstructionErrorView::pixel_type>& m_output;
+    std::vector<float>& m_error_sum;
+    std::vector<int>& m_num_valid;
+
+  public:
+    ErrorMapTile(ReconstructionErrorView const& view,
+                 ImageView<ReconstructionErrorView::pixel_type>& output,
+                 std::vector<float>& error_sum, std::vector<int>& num_valid)
+      : m_view(view), m_output(output), m_error_sum(error_sum), m_num_valid(num_valid) {}
+
+    void operator()(size_t index, BBox2i const& bbox) const {
+      ImageView<PixelGray<int> > numSamples;
+      ImageView<ReconstructionErrorView::pixel_type> error_img = m_view.error_block(bbox, &numSamples);
+      for (int32 k = 0; k < error_img.rows(); ++k) {
+        for (int32 l = 0; l < error_img.cols(); ++l) {
+          if ( numSamples(l,k) ) {
+            m_num_valid[index]++;
+            m_error_sum[index] += error_img(l,k);
           }
         }
       }
-    }//l
-  }//k
-
-
-  //update from the overlapping images
-  for (i = 0; i < (int)overlap_img_params.size(); i++){
-
-    DiskImageView<PixelMask<PixelGray<uint8> > > overlap_img(overlap_img_params[i].inputFilename);
-    GeoReference overlap_geo;
-    read_georeference(overlap_geo, overlap_img_params[i].inputFilename);
-
-    DiskImageView<PixelMask<PixelGray<uint8> > > overlapShadowImage(/*overlapShadowFileArray[i]*/overlap_img_params[i].shadowFilename);
-
-
-    ImageViewRef<PixelMask<PixelGray<uint8> > > interp_overlap_img = interpolate(edge_extend(overlap_img.impl(),
-          ConstantEdgeExtension()),
-        BilinearInterpolation());
-
-    ImageViewRef<PixelMask<PixelGray<uint8> > > interpOverlapShadowImage = interpolate(edge_extend(overlapShadowImage.impl(),
-          ConstantEdgeExtension()),
-        BilinearInterpolation());
-
-    for (k = 0 ; k < input_img.rows(); ++k) {
-      for (l = 0; l < input_img.cols(); ++l) {
-
-        Vector2 input_img_pix(l,k);
-
-        if ( is_valid(input_img(l,k)) ) {
-
-          //get the corresponding DEM value
-          Vector2 lon_lat = input_img_geo.pixel_to_lonlat(input_img_pix);
-          Vector2 input_dem_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_pix));
-
-          x = (int)input_dem_pix[0];
-          y = (int)input_dem_pix[1];
-
-          //check for valid DEM coordinates
-          if ((x>=0) && (x < input_dem_image.cols()) && (y>=0) && (y< input_dem_image.rows())){
-
-            //get the top and left DEM value
-            Vector3 longlat3(lon_lat(0),lon_lat(1),(interp_dem_image)(x, y));
-            Vector3 xyz = input_img_geo.datum().geodetic_to_cartesian(longlat3);
-
-            Vector2 input_img_left_pix;
-            input_img_left_pix(0) = l-1;
-            input_img_left_pix(1) = k;
-
-            Vector2 input_img_top_pix;
-            input_img_top_pix(0) = l;
-            input_img_top_pix(1) = k-1;
-
-            //check for valid DEM pixel value and valid left and top coordinates
-            if ((input_img_left_pix(0) >= 0) && (input_img_top_pix(1) >= 0) && (input_dem_image(x,y) != -10000)){
-
-
-              //determine the 3D coordinates of the pixel left of the current pixel
-              Vector2 input_dem_left_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_left_pix));
-              Vector2 lon_lat_left = input_img_geo.pixel_to_lonlat(input_img_left_pix);
-              Vector3 longlat3_left(lon_lat_left(0),lon_lat_left(1),(interp_dem_image)(input_dem_left_pix(0), input_dem_left_pix(1)));
-              Vector3 xyz_left = input_img_geo.datum().geodetic_to_cartesian(longlat3_left);
-
-
-              Vector2 input_dem_top_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_top_pix));
-              Vector2 lon_lat_top = input_img_geo.pixel_to_lonlat(input_img_top_pix);
-              Vector3 longlat3_top(lon_lat_top(0),lon_lat_top(1),(interp_dem_image)(input_dem_top_pix(0), input_dem_top_pix(1)));
-              Vector3 xyz_top = input_img_geo.datum().geodetic_to_cartesian(longlat3_top);
-
-              //Vector3 normal = computeNormalFrom3DPoints(xyz, xyz_left, xyz_top);
-              Vector3 normal = computeNormalFrom3DPointsGeneral(xyz, xyz_left, xyz_top);
-
-              //check for overlap between the output image and the input DEM image
-              Vector2 overlap_pix = overlap_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_pix));
-              x = (int)overlap_pix[0];
-              y = (int)overlap_pix[1];
-
-              //image dependent part of the code - START
-              PixelMask<PixelGray<uint8> > overlap_img_pixel = interp_overlap_img(x, y);
+      crop(m_output, bbox) = error_img;
+    }
+  };
+}
 
-              //check for valid overlap_img coordinates
-              //remove shadow pixels in the overlap_img.
-              if ((x>=0) && (x < overlap_img.cols()) && (y>=0) && (y< overlap_img.rows()) && interpOverlapShadowImage(x, y) == 0){
+void
+vw::photometry::ComputeReconstructionErrorMap(ModelParams input_img_params,
+    std::vector<ModelParams> overlap_img_params,
+    GlobalParams globalParams,
+    float *avgError, int *totalNumSamples) {
+  boost::shared_ptr<ReconstructImages> images(new ReconstructImages(input_img_params, overlap_img_params));
+  ComputeReconstructionErrorMap(images, input_img_params, globalParams, avgError, totalNumSamples);
+}
 
-                if ( is_valid(overlap_img_pixel) ) { //common area between input_img and overlap_img
+void
+vw::photometry::ComputeReconstructionErrorMap(boost::shared_ptr<ReconstructImages> images,
+    ModelParams input_img_params,
+    GlobalParams globalParams,
+    float *avgError, int *totalNumSamples) {
 
-                  float overlap_img_reflectance;
-                  overlap_img_reflectance = ComputeReflectance(normal, xyz, overlap_img_params[i], globalParams);
-                  if (overlap_img_reflectance > 0){
-                    float overlap_img_error = ComputeError((float)overlap_img_pixel, overlap_img_params[i].exposureTime, (float)albedo(l,k), overlap_img_reflectance);//, xyz, xyz_prior);
+  ReconstructionErrorView view(images, input_img_params, globalParams);
+  ImageView<ReconstructionErrorView::pixel_type> error_img(view.cols(), view.rows());
 
-                    error_img(l, k) = error_img(l,k) + overlap_img_error*overlap_img_error;
-                    numSamples(l, k) = numSamples(l,k) + 1;
-                  }
-                }//if
-              }//if
-              //image dependent part of the code - START
-            }
-          }
-        }
-      }// for l
-    } // for k
-  } //for i
+  std::vector<BBox2i> tiles = image_tiles(error_img.cols(), error_img.rows());
+  std::vector<float> error_sum(tiles.size(), 0);
+  std::vector<int> num_valid(tiles.size(), 0);
+  run_tile_jobs(tiles, ErrorMapTile(view, error_img, error_sum, num_valid));
 
   float l_avgError = 0;
   int l_totalNumSamples = 0;
-  //finalize the output image; computes the standard deviation
-  for (k = 0 ; k < error_img.rows(); ++k) {
-    for (l = 0; l < error_img.cols(); ++l) {
-      if ( numSamples(l,k) ) {
-        error_img(l, k) = (float)sqrt(error_img(l, k)/numSamples(l, k));
-        l_totalNumSamples++;
-        l_avgError = l_avgError + error_img(l,k);
-      }
-    }
+  for (size_t i = 0; i < tiles.size(); i++){
+    l_avgError = l_avgError + error_sum[i];
+    l_totalNumSamples = l_totalNumSamples + num_valid[i];
   }
 
   l_avgError = l_avgError/l_totalNumSamples;
@@ -265,7 +198,7 @@ vw::photometry::ComputeReconstructionErrorMap(ModelParams input_img_params,
   *avgError = l_avgError;
   *totalNumSamples = l_totalNumSamples;
   //write the output (standard deviation of the reconstructed albedo) image
-  write_georeferenced_image(error_img_file,
+  write_georeferenced_image(input_img_params.errorFilename,
       channel_cast<uint8>(clamp(error_img,0.0,255.0)),
-      input_img_geo, TerminalProgressCallback("photometry}","Processing:"));
+      images->input.geo, TerminalProgressCallback("photometry}","Processing:"));
 }
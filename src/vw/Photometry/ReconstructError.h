@@ -12,7 +12,13 @@
 
 #include <string>
 #include <vector>
-//#include <vw/Photometry/Reconstruct.h>
+#include <boost/shared_ptr.hpp>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelAccessors.h>
+#include <vw/Photometry/Reconstruct.h>
+#include <vw/Photometry/Tiles.h>
 
 namespace vw {
 namespace photometry {
@@ -21,12 +27,71 @@ namespace photometry {
                           float albedo, float reflectance);
                           //Vector3 /*xyz*/, Vector3 /*xyz_prior*/)
 
+  /// The reconstruction error map of an input image: at each pixel, the
+  /// RMS difference between the input image and the images overlapping
+  /// it and their reconstruction from the albedo, exposure times and
+  /// reflectance, over the samples out of shadow.  Pixels without
+  /// samples are invalid.
+  ///
+  /// It reads the images it is given rather than opening them, and
+  /// rasterizes a whole block at once, so it can be written with
+  /// block_write_image, or the images shared with the albedo passes.
+  class ReconstructionErrorView : public ImageViewBase<ReconstructionErrorView> {
+    boost::shared_ptr<ReconstructImages> m_images;
+    DiskImageView<PixelMask<PixelGray<uint8> > > m_albedo;
+    ModelParams m_params;
+    GlobalParams m_global;
+
+  public:
+    typedef PixelMask<PixelGray<float> > pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<ReconstructionErrorView> pixel_accessor;
+
+    ReconstructionErrorView(boost::shared_ptr<ReconstructImages> images,
+                            ModelParams const& input_img_params,
+                            GlobalParams const& globalParams)
+      : m_images(images), m_albedo(input_img_params.outputFilename),
+        m_params(input_img_params), m_global(globalParams) {}
+
+    inline int32 cols() const { return m_images->input.image.cols(); }
+    inline int32 rows() const { return m_images->input.image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      return error_block(BBox2i(i, j, 1, 1))(0, 0);
+    }
+
+    /// The error over bbox, and, if given, the number of samples at each
+    /// of its pixels.
+    ImageView<pixel_type> error_block(BBox2i const& bbox,
+                                      ImageView<PixelGray<int> >* numSamples = 0) const;
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      return crop( error_block(bbox), -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+    }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+    /// \endcond
+  };
+
   //reconstruction error functions
   void ComputeReconstructionErrorMap(ModelParams input_img_params,
                                      std::vector<ModelParams> overlap_img_params,
                                      GlobalParams globalParams,
                                      float *avgError, int *totalNumSamples);
 
+  /// ComputeReconstructionErrorMap over images already open, such as
+  /// those the albedo pass over the same input image has just read.
+  void ComputeReconstructionErrorMap(boost::shared_ptr<ReconstructImages> images,
+                                     ModelParams input_img_params,
+                                     GlobalParams globalParams,
+                                     float *avgError, int *totalNumSamples);
+
 }} // end vw::photometry
 
 #endif//__VW_PHOTOMETRY_RECONSTRUCTERROR_H__
@@ -11,6 +11,7 @@
 #pragma warning(disable:4996)
 #endif
 
+#include <algorithm>
 #include <string>
 #include <fstream>
 #include <vector>
@@ -316,8 +317,8 @@ vw::photometry::computeLunarLambertianReflectanceFromNormal(Vector3 sunPos, Vect
 
 float
 vw::photometry::ComputeReflectance(Vector3 normal, Vector3 xyz,
-                                   ModelParams input_img_params,
-                                   GlobalParams globalParams) {
+                                   ModelParams const& input_img_params,
+                                   GlobalParams const& globalParams) {
   float input_img_reflectance;
 
   switch ( globalParams.reflectanceType )
@@ -343,6 +344,85 @@ vw::photometry::ComputeReflectance(Vector3 normal, Vector3 xyz,
 
 }
 
+vw::photometry::ReflectanceGeometry::ReflectanceGeometry(ModelParams const& img_params, size_t size)
+  : m_sun_position(img_params.sunPosition), m_view_position(img_params.spacecraftPosition),
+    m_normal(3*size), m_normal_length(size), m_sun(3*size), m_view(3*size), m_valid(size) {}
+
+void
+vw::photometry::ReflectanceGeometry::set(size_t i, Vector3 const& xyz, Vector3 const& normal) {
+  double length = norm_2(normal);
+  if (length == 0) {
+    m_valid[i] = 0;
+    return;
+  }
+  Vector3 sunDirection = normalize(m_sun_position-xyz);
+  Vector3 viewDirection = normalize(m_view_position-xyz);
+  for (size_t j = 0; j < 3; ++j) {
+    m_normal[3*i+j] = normal[j]/length;
+    m_sun[3*i+j] = sunDirection[j];
+    m_view[3*i+j] = viewDirection[j];
+  }
+  m_normal_length[i] = length;
+  m_valid[i] = 1;
+}
+
+//evaluates the reflectance models over the arrays of a geometry in one pass
+//each, following computeLunarLambertianReflectanceFromNormal and
+//computeLambertianReflectanceFromNormal
+void
+vw::photometry::ComputeReflectance(ReflectanceGeometry const& geometry,
+                                   GlobalParams const& globalParams,
+                                   std::vector<float>& reflectance) {
+  const size_t size = geometry.size();
+  reflectance.assign(size, 0);
+  if (size == 0)
+    return;
+
+  const float* n = &geometry.m_normal[0];
+  const float* s = &geometry.m_sun[0];
+  const float* v = &geometry.m_view[0];
+  const uint8* valid = &geometry.m_valid[0];
+
+  switch ( globalParams.reflectanceType )
+    {
+    case LUNAR_LAMBERT:
+      {
+        //Alfred McEwen's model
+        const float A = -0.019;
+        const float B =  0.000242;//0.242*1e-3;
+        const float C = -0.00000146;//-1.46*1e-6;
+
+        for (size_t i = 0; i < size; ++i, n += 3, s += 3, v += 3) {
+          if (!valid[i])
+            continue;
+          float mu_0 = s[0]*n[0] + s[1]*n[1] + s[2]*n[2];
+          if (mu_0 < 0.0)
+            continue;
+          float mu = std::max(v[0]*n[0] + v[1]*n[1] + v[2]*n[2], 0.0f);
+          // the float directions may put cos_alpha just past +/-1
+          float cos_alpha = std::min(std::max(s[0]*v[0] + s[1]*v[1] + s[2]*v[2], -1.0f), 1.0f);
+          float deg_alpha = acos(cos_alpha)*180.0/M_PI;
+          float L = 1.0 + A*deg_alpha + B*deg_alpha*deg_alpha + C*deg_alpha*deg_alpha*deg_alpha;
+          if (mu_0 + mu != 0)
+            reflectance[i] = std::max(2*L*mu_0/(mu_0+mu) + (1-L)*mu_0, 0.0f);
+        }
+      }
+      break;
+    case LAMBERT:
+      for (size_t i = 0; i < size; ++i, n += 3, s += 3) {
+        if (valid[i])
+          reflectance[i] = s[0]*n[0] + s[1]*n[1] + s[2]*n[2];
+      }
+      break;
+
+    default:
+      for (size_t i = 0; i < size; ++i) {
+        if (valid[i])
+          reflectance[i] = 1;
+      }
+    }
+}
+
 float vw::photometry::computeImageReflectanceNoWrite(ModelParams input_img_params,
                                                      GlobalParams globalParams,
                                                      ImageView<PixelMask<PixelGray<float> > >& output_img) {
@@ -437,15 +517,20 @@ float vw::photometry::computeImageReflectanceNoWrite(ModelParams input_img_param
 
   // compute reflectance
   output_img.set_size(input_img.cols(), input_img.rows());
+  ReflectanceGeometry geometry(input_img_params, size_t(output_img.cols())*output_img.rows());
   for (int y=0; y < (int)output_img.rows(); y++) {
     for (int x=0; x < (int)output_img.cols(); x++) {
-      Vector3 normal = surface_normal(x, y);
-      if (normal == Vector3()) {
-        continue;
+      geometry.set(size_t(y)*output_img.cols() + x, dem_xyz(x, y), surface_normal(x, y));
+    }
+  }
+  std::vector<float> reflectance;
+  ComputeReflectance(geometry, globalParams, reflectance);
+  for (int y=0; y < (int)output_img.rows(); y++) {
+    for (int x=0; x < (int)output_img.cols(); x++) {
+      size_t i = size_t(y)*output_img.cols() + x;
+      if (geometry.valid(i)) {
+        output_img(x, y) = reflectance[i];
       }
-      Vector3 xyz = dem_xyz(x, y);
-      
-      output_img(x, y) = ComputeReflectance(normal, xyz, input_img_params, globalParams);
     }
   }
 
@@ -17,6 +17,7 @@
 #endif
 
 #include <string>
+#include <vector>
 #include <vw/Math/Vector.h>
 
 #include <vw/Photometry/Reconstruct.h>
@@ -38,12 +39,11 @@ namespace photometry {
   };
   
   template <class ImageT>
-    UnaryPerPixelView<BinaryPerPixelView<PerPixelIndexView<VectorIndexFunctor>, ImageT, cartography::DemToPointImageFunctor<typename ImageT::pixel_type> >, LLAtoXYZFunctor>
+    UnaryPerPixelView<cartography::DemToPointImageView<ImageT>, LLAtoXYZFunctor>
     dem_to_point_cloud( ImageViewBase<ImageT> const& image,
                         cartography::GeoReference const& georef ) {
-    typedef cartography::DemToPointImageFunctor<typename ImageT::pixel_type> func1_type;
     typedef LLAtoXYZFunctor func2_type;
-    typedef BinaryPerPixelView<PerPixelIndexView<VectorIndexFunctor>, ImageT, func1_type> inner_view;
+    typedef cartography::DemToPointImageView<ImageT> inner_view;
     return UnaryPerPixelView<inner_view,func2_type>(dem_to_point_image( image.impl(), georef ), func2_type(georef.datum()) );
   }
 
@@ -70,14 +70,60 @@ namespace photometry {
   float computeImageReflectance(ModelParams input_img_params,
                                 GlobalParams globalParams);
   float ComputeReflectance(Vector3 normal, Vector3 xyz,
-                           ModelParams input_img_params,
-                           GlobalParams globalParams);
+                           ModelParams const& input_img_params,
+                           GlobalParams const& globalParams);
   float computeImageReflectance(ModelParams input_img_params,
                                 ModelParams overlap_img_params,
                                 GlobalParams globalParams);
   float computeImageReflectanceNoWrite(ModelParams input_img_params,
                                        GlobalParams globalParams,
                                        ImageView<PixelMask<PixelGray<float> > >& output_img);
+
+  /// The geometry the reflectance models need at the points of a DEM
+  /// tile, as seen in one image: the unit surface normal and the unit
+  /// directions to the sun and to the spacecraft, kept as float arrays
+  /// of x,y,z triples.  It is computed once per tile, and only the
+  /// points whose heights change need to be set again.
+  ///
+  /// The surface positions themselves are not kept: a float does not
+  /// hold lunar coordinates to better than a few decimetres.
+  class ReflectanceGeometry {
+    Vector3 m_sun_position, m_view_position;
+    std::vector<float> m_normal, m_normal_length, m_sun, m_view;
+    std::vector<uint8> m_valid;
+
+    static Vector3 triple(std::vector<float> const& v, size_t i) {
+      return Vector3(v[3*i], v[3*i+1], v[3*i+2]);
+    }
+
+    friend void ComputeReflectance(ReflectanceGeometry const& geometry,
+                                   GlobalParams const& globalParams,
+                                   std::vector<float>& reflectance);
+  public:
+    /// The geometry of size points, all invalid, for the image with
+    /// the given sun and spacecraft positions.
+    ReflectanceGeometry(ModelParams const& img_params, size_t size);
+
+    size_t size() const { return m_valid.size(); }
+
+    /// Set point i from its position and its (not necessarily unit)
+    /// surface normal.  A zero normal leaves the point invalid.
+    void set(size_t i, Vector3 const& xyz, Vector3 const& normal);
+    void invalidate(size_t i) { m_valid[i] = 0; }
+    bool valid(size_t i) const { return m_valid[i] != 0; }
+
+    Vector3 normal(size_t i) const { return triple(m_normal, i); }
+    /// The length of the normal point i was set with.
+    float normal_length(size_t i) const { return m_normal_length[i]; }
+    Vector3 sun_direction(size_t i) const { return triple(m_sun, i); }
+    Vector3 view_direction(size_t i) const { return triple(m_view, i); }
+  };
+
+  /// The reflectance at every point of the geometry at once, as
+  /// ComputeReflectance gives it point by point; invalid points get 0.
+  void ComputeReflectance(ReflectanceGeometry const& geometry,
+                          GlobalParams const& globalParams,
+                          std::vector<float>& reflectance);
   
 }}
 
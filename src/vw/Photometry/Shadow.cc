@@ -28,38 +28,16 @@ using namespace vw::cartography;
 #include <math.h>
 #include <vw/Photometry/Shadow.h>
 #include <vw/Photometry/Reconstruct.h>
+#include <vw/Photometry/Tiles.h>
 using namespace vw::photometry;
 
 void vw::photometry::ComputeSaveShadowMap( ModelParams input_img_params,
                                            GlobalParams globalParams) {
-  std::string shadowMapFile = input_img_params.shadowFilename;
-  std::string origfile = input_img_params.inputFilename;
-  DiskImageView<PixelMask<PixelGray<uint8> > > originalImage(origfile);
-  ImageView<PixelMask<PixelGray<uint8> > > shadowImage(originalImage.cols(), originalImage.rows());
+  GeoImage<PixelMask<PixelGray<uint8> > > originalImage(input_img_params.inputFilename);
 
-  GeoReference originalGeo;
-  read_georeference(originalGeo, origfile);
-
-  for (int k=0; k < (int)originalImage.rows(); ++k) {
-    for (int l=0; l < (int)originalImage.cols(); ++l) {
-
-
-      Vector2 sample_pix(l,k);
-
-      if ( is_valid(originalImage(l,k)) ) {
-        shadowImage(l, k) = 0;
-        //printf("shadowThresh = %d\n", globalParams.shadowThresh);
-        if (originalImage(l, k) < globalParams.shadowThresh){
-          shadowImage(l, k) = 255;
-        }
-      }
-
-    }
-  }
-
-  write_georeferenced_image(shadowMapFile,
-                            channel_cast<uint8>(shadowImage),
-                            originalGeo, TerminalProgressCallback("photometry","Processing:"));
+  block_write_georeferenced_image(input_img_params.shadowFilename,
+                                  channel_cast<uint8>(shadow_map(originalImage.image, globalParams.shadowThresh)),
+                                  originalImage.geo, TerminalProgressCallback("photometry","Processing:"));
 }
 
 
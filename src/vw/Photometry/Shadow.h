@@ -17,11 +17,38 @@
 #endif
 
 #include <string>
+#include <vw/Image/PerPixelViews.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/PixelTypes.h>
 #include <vw/Photometry/Reconstruct.h>
 
 namespace vw {
 namespace photometry {
 
+  /// Marks the pixels darker than the shadow threshold with 255 and the
+  /// others with 0; invalid pixels stay invalid.
+  class ShadowFunctor : public ReturnFixedType<PixelMask<PixelGray<uint8> > > {
+    float m_thresh;
+  public:
+    ShadowFunctor(float thresh) : m_thresh(thresh) {}
+
+    template <class PixelT>
+    PixelMask<PixelGray<uint8> > operator()(PixelT const& pix) const {
+      PixelMask<PixelGray<uint8> > result;
+      if ( is_valid(pix) )
+        result = PixelMask<PixelGray<uint8> >( (pix < m_thresh) ? 255 : 0 );
+      return result;
+    }
+  };
+
+  /// The shadow map of an image, computed lazily pixel by pixel, so that
+  /// it can be written block by block in parallel.
+  template <class ImageT>
+  UnaryPerPixelView<ImageT, ShadowFunctor>
+  shadow_map( ImageViewBase<ImageT> const& image, float thresh ) {
+    return UnaryPerPixelView<ImageT, ShadowFunctor>( image.impl(), ShadowFunctor(thresh) );
+  }
+
   void ComputeSaveShadowMap( ModelParams input_img_params,
                              GlobalParams globalParams);
   void AddShadows(std::string input_img_file,
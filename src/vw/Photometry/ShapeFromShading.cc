@@ -94,53 +94,42 @@ float ComputeCosDerivative(Vector3 normal, Vector3 direction, Vector3 normalDeri
   return cosEDeriv;
 }
 
-float ComputeReliefDerivative(Vector3 xyz,Vector3 xyzLEFT,Vector3 xyzTOP, Vector3 normal, ModelParams inputImgParams, int flag)
+//computes the derivatives of the relief at point i of the block geometry wrt the
+//heights of the point itself (0), of the point left of it (1) and of the point on
+//top of it (2)
+Vector3 ComputeReliefDerivatives(ReflectanceGeometry const& geometry, size_t i,
+                                 Vector3 xyz, Vector3 xyzLEFT, Vector3 xyzTOP)
 {
-  float reliefDeriv;
-  Vector3 sunPos = inputImgParams.sunPosition;
-  Vector3 viewPos = inputImgParams.spacecraftPosition;
-
-  Vector3 normalDerivative = ComputeNormalDerivative(flag, xyz, xyzTOP, xyzLEFT);
+  //the model works on the normal as computed from the block, not the unit one
+  Vector3 normal = geometry.normal(i)*geometry.normal_length(i);
 
   //compute /mu_0 = cosine of the angle between the light direction and the surface normal.
-  // sun coordinates relative to the xyz point on the Moon surface
-  Vector3 sunDirection = normalize(sunPos-xyz);
+  Vector3 sunDirection = geometry.sun_direction(i);
   float mu_0 = dot_prod(sunDirection,normal);
 
   //compute  /mu = cosine of the angle between the viewer direction and the surface normal.
-  // viewer coordinates relative to the xyz point on the Moon surface
-  Vector3 viewDirection = normalize(viewPos-xyz);
+  Vector3 viewDirection = geometry.view_direction(i);
   float mu = dot_prod(viewDirection,normal);
 
-
-  float cosEDeriv = ComputeCosDerivative(normal, viewDirection, normalDerivative);
-  float cosIDeriv = ComputeCosDerivative(normal, sunDirection, normalDerivative);
-
-
   //Alfred McEwen's model
   float A = -0.019*180/3.141592;
   float B =  0.000242*180/3.141592*180/3.141592;//0.242*1e-3;
   float C = -0.00000146*180/3.141592*180/3.141592*180/3.141592;//-1.46*1e-6;
 
-  float cos_alpha = dot_prod(sunDirection,viewDirection);
-
-  if ((cos_alpha > 1)||(cos_alpha< -1)){
-    printf("cos_alpha error\n");
-  }
-
+  float cos_alpha = std::min(std::max(dot_prod(sunDirection,viewDirection), -1.0), 1.0);
   float rad_alpha = acos(cos_alpha);
   float L = 1.0 + A*rad_alpha + B*rad_alpha*rad_alpha + C*rad_alpha*rad_alpha*rad_alpha;
 
-  //reliefDeriv = (mu+mu_0) ? (1-L)*cosIDeriv + L*(cosIDeriv*(mu+mu_0)+(cosEDeriv+cosIDeriv)*mu)/((mu+mu_0)*(mu+mu_0)) : 0;
-  reliefDeriv = (mu+mu_0) ? (1-L)*cosIDeriv + 2*L*(cosIDeriv*(mu+mu_0)+(cosEDeriv+cosIDeriv)*mu)/((mu+mu_0)*(mu+mu_0)) : 0;
-  /*
-  if (mu_0<0 || mu<0) {
-    std::cout << " sun direction " << sunDirection << " view direction " << viewDirection << " normal " << normal << std::endl;
-    std::cout << " cos_alpha " << cos_alpha << " incident " << mu_0 << " emission " << mu << " L = " << L << " reliefDeriv = " << reliefDeriv << std::endl;
-  } else {
+  Vector3 reliefDeriv;
+  if (mu+mu_0 == 0)
+    return reliefDeriv;
 
+  for (int flag = 0; flag < 3; flag++){
+    Vector3 normalDerivative = ComputeNormalDerivative(flag, xyz, xyzTOP, xyzLEFT);
+    float cosEDeriv = ComputeCosDerivative(normal, viewDirection, normalDerivative);
+    float cosIDeriv = ComputeCosDerivative(normal, sunDirection, normalDerivative);
+    reliefDeriv(flag) = (1-L)*cosIDeriv + 2*L*(cosIDeriv*(mu+mu_0)+(cosEDeriv+cosIDeriv)*mu)/((mu+mu_0)*(mu+mu_0));
   }
-  */
   return reliefDeriv;
 }
 
@@ -160,7 +149,7 @@ ComputeBlockGeometry(ImageViewBase<ViewT> const& dem, GeoReference const &demGeo
     ImageViewBase<ViewT1> const& drg, GeoReference const &drgGeo,
     int kb, int lb, ModelParams modelParams, GlobalParams globalParams,
     vector<Vector3> &xyzArray, vector<Vector3> &xyzLEFTArray, vector<Vector3> &xyzTOPArray,
-    vector<Vector3> &normalArray)
+    vector<ReflectanceGeometry> &geometryArray)
 {
 
   //GeoTransform trans(demGeo, drgGeo);
@@ -184,10 +173,15 @@ ComputeBlockGeometry(ImageViewBase<ViewT> const& dem, GeoReference const &demGeo
       int jj = lb*(horBlockSize)+l; //col index for the entire image
       //printf("ii = %d, jj = %d, width = %d, height = %d\n", ii, jj, dem.impl().cols(), dem.impl().rows());
 
-      if ((ii < drg.impl().rows()) && (jj < drg.impl().cols())){
+      //local index in the vector that describes the block image; assumes row-wise concatenation.
+      int l_index = k*eHorBlockSize+l;
 
-        //local index in the vector that describes the block image; assumes row-wise concatenation.
-        int l_index = k*eHorBlockSize+l;
+      //points without a normal are left out of the Jacobian
+      for (size_t m = 0; m < geometryArray.size(); m++){
+        geometryArray[m].invalidate(l_index);
+      }
+
+      if ((ii < drg.impl().rows()) && (jj < drg.impl().cols())){
 
         if ( is_valid(drg.impl()(jj,ii)) ) {
 
@@ -239,9 +233,10 @@ ComputeBlockGeometry(ImageViewBase<ViewT> const& dem, GeoReference const &demGeo
             Vector3 xyz_top = demGeo.datum().geodetic_to_cartesian(longlat3_top);
             xyzTOPArray[l_index] = xyz_top;
 
-            normalArray[l_index] = cross_prod(xyz_top-xyzArray[l_index], xyz_left-xyzArray[l_index]);
-            //std::cout << "xyz_top: " << xyz_top << "xyz_left: " << xyz_left << "xyzArray[l_index] " << xyzArray[l_index] << "normalArray: " << normalArray[l_index] << std::endl;
-            //std::cout<<"k = "<< k <<",l = "<< l <<", normalArray: " << normalArray[l_index] << std::endl;
+            Vector3 normal = cross_prod(xyz_top-xyzArray[l_index], xyz_left-xyzArray[l_index]);
+            for (size_t m = 0; m < geometryArray.size(); m++){
+              geometryArray[m].set(l_index, xyzArray[l_index], normal);
+            }
 
           }
         }
@@ -271,7 +266,7 @@ ComputeBlockJacobian(ImageViewBase<ViewT1> const& inputImage, GeoReference const
     ImageViewBase<ViewT2> const& shadowImage, ImageViewBase<ViewT1> const& albedoImage,
     int kb, int lb, ModelParams inputImgParams, GlobalParams globalParams,
     vector<Vector3> const &xyzArray, vector<Vector3> const &xyzLEFTArray,
-    vector<Vector3> const &xyzTOPArray, vector<Vector3> const &normalArray,
+    vector<Vector3> const &xyzTOPArray, ReflectanceGeometry const &geometry,
     Matrix<float, numJacobianRows, numJacobianCols>  &jacobianArray,
     Vector<float, numJacobianRows>  &errorVectorArray,
     Matrix<float, numJacobianRows, numJacobianRows>  &weightsArray)
@@ -280,6 +275,9 @@ ComputeBlockJacobian(ImageViewBase<ViewT1> const& inputImage, GeoReference const
   int r, c;
 
   cout<<"Compute Block Jacobian" <<endl;
+  vector<float> reliefArray;
+  ComputeReflectance(geometry, globalParams, reliefArray);
+
   for (r = 0; r < numJacobianRows-1; r++){//last row is always zero
 
     int k = r/(horBlockSize+1); //row index in the extended block
@@ -294,36 +292,29 @@ ComputeBlockJacobian(ImageViewBase<ViewT1> const& inputImage, GeoReference const
       Vector2 input_img_pix(jj,ii);
 
       //update from the main image
-      if (is_valid(inputImage.impl()(jj,ii)) && (shadowImage.impl()(jj, ii) == 0)){
+      if (is_valid(inputImage.impl()(jj,ii)) && (shadowImage.impl()(jj, ii) == 0) && geometry.valid(r)){
+
+        Vector3 recDer = ComputeReliefDerivatives(geometry, r, xyzArray[r],
+            xyzLEFTArray[r], xyzTOPArray[r])
+          *(float)albedoImage.impl()(jj,ii)*inputImgParams.exposureTime;
 
         c = k*horBlockSize + l;//same point
         //not computed for the last row and last column of the extended block
         if ((k < verBlockSize) && (l < horBlockSize)){
 
-          float recDer = ComputeReliefDerivative(xyzArray[r], xyzLEFTArray[r],
-              xyzTOPArray[r], normalArray[r],
-              inputImgParams, 0)
-            *(float)albedoImage.impl()(jj,ii)*inputImgParams.exposureTime;
-          jacobianArray(r, c) = recDer;
+          jacobianArray(r, c) = recDer(0);
         }
 
         c = k*horBlockSize + l-1;//left point
         //not computed for the first column and last row
         if ((c >= 0) && (l > 0) && ( k < verBlockSize)){
-          float recDerLEFT = ComputeReliefDerivative(xyzArray[r], xyzLEFTArray[r],
-              xyzTOPArray[r], normalArray[r],
-              inputImgParams, 1)
-            *(float)albedoImage.impl()(jj,ii)*inputImgParams.exposureTime;
-          jacobianArray(r, c) = recDerLEFT;
+          jacobianArray(r, c) = recDer(1);
         }
 
         c = (k-1)*horBlockSize + l;//top point
         //not computed for the first row and last column of the extended block
         if ((c >= 0) && (k > 0) && (l < horBlockSize)){
-          float recDerTOP = ComputeReliefDerivative(xyzArray[r], xyzLEFTArray[r],
-              xyzTOPArray[r], normalArray[r], inputImgParams, 2)
-            *(float)albedoImage.impl()(jj,ii)*inputImgParams.exposureTime;
-          jacobianArray(r, c) = recDerTOP;
+          jacobianArray(r, c) = recDer(2);
         }
 
 
@@ -343,7 +334,7 @@ ComputeBlockJacobian(ImageViewBase<ViewT1> const& inputImage, GeoReference const
         }
         else{
 
-          float relief = ComputeReflectance(normalize(normalArray[r]), xyzArray[r], inputImgParams, globalParams);
+          float relief = reliefArray[r];
           float recErr = ComputeError((float)inputImage.impl()(jj, ii), inputImgParams.exposureTime, (float)albedoImage.impl()(jj, ii), relief);
           //float recErr = ComputeReconstructError((float)inputImage.impl()(jj, ii), inputImgParams.exposureTime, (float)albedoImage.impl()(jj, ii), relief);
           errorVectorArray(r) = recErr;
@@ -365,7 +356,7 @@ ComputeBlockJacobianOverlap(ImageViewBase<ViewT1> const& inputImage, GeoReferenc
     ImageViewBase<ViewT1> const& albedoImage, int kb, int lb,
     ModelParams inputImgParams,  ModelParams overlapImgParams, GlobalParams globalParams,
     vector<Vector3> const &xyzArray, vector<Vector3> const &xyzLEFTArray,
-    vector<Vector3> const &xyzTOPArray, vector<Vector3> const &normalArray,
+    vector<Vector3> const &xyzTOPArray, ReflectanceGeometry const &geometry,
     Matrix<float, numJacobianRows, numJacobianCols> &jacobianArray,
     Vector<float, numJacobianRows> &errorVectorArray,
     Matrix<float, numJacobianRows, numJacobianRows>  &weightsArray)
@@ -373,6 +364,8 @@ ComputeBlockJacobianOverlap(ImageViewBase<ViewT1> const& inputImage, GeoReferenc
 
   cout<<"Compute Overlap Block Jacobian" <<endl;
   int r, c;
+  vector<float> reliefArray;
+  ComputeReflectance(geometry, globalParams, reliefArray);
 
   ImageViewRef<PixelMask<PixelGray<uint8> > >  interpOverlapImage = interpolate(edge_extend(overlapImage.impl(),ConstantEdgeExtension()),
       BilinearInterpolation());
@@ -398,36 +391,29 @@ ComputeBlockJacobianOverlap(ImageViewBase<ViewT1> const& inputImage, GeoReferenc
       float y = overlap_pix[1];
 
       //compute and update Jacobian for non shadow pixels
-      if ((x>=0) && (x < overlapImage.impl().cols()) && (y>=0) && (y< interpOverlapImage.impl().rows()) && (interpOverlapShadowImage.impl()(x, y) == 0)){
+      if ((x>=0) && (x < overlapImage.impl().cols()) && (y>=0) && (y< interpOverlapImage.impl().rows()) && (interpOverlapShadowImage.impl()(x, y) == 0) && geometry.valid(r)){
+
+        Vector3 recDer = ComputeReliefDerivatives(geometry, r, xyzArray[r],
+            xyzLEFTArray[r], xyzTOPArray[r])
+          *(float)albedoImage.impl()(jj,ii)*overlapImgParams.exposureTime;
 
         c = k*horBlockSize + l;//same point
         //not computed for the last row and last column of the extended block
         if ((k < verBlockSize) && (l < horBlockSize)){
 
-          float recDer = ComputeReliefDerivative(xyzArray[r], xyzLEFTArray[r],
-              xyzTOPArray[r], normalArray[r],
-              overlapImgParams, 0)
-            *(float)albedoImage.impl()(jj,ii)*overlapImgParams.exposureTime;
-          jacobianArray(r,c) = recDer;
+          jacobianArray(r, c) = recDer(0);
         }
 
         c = k*horBlockSize + l-1;//left point
         //not computed for the first column and last row
         if ((c >= 0) && (l > 0) && ( k < verBlockSize)){
-          float recDerLEFT = ComputeReliefDerivative(xyzArray[r], xyzLEFTArray[r],
-              xyzTOPArray[r], normalArray[r],
-              overlapImgParams, 1)
-            *(float)albedoImage.impl()(jj,ii)*overlapImgParams.exposureTime;
-          jacobianArray(r,c) = recDerLEFT;
+          jacobianArray(r, c) = recDer(1);
         }
 
         c = (k-1)*horBlockSize + l;//top point
         //not computed for the first row and last column of the extended block
         if ((c >= 0) && (k > 0) && (l < horBlockSize)){
-          float recDerTOP = ComputeReliefDerivative(xyzArray[r], xyzLEFTArray[r],
-              xyzTOPArray[r], normalArray[r], overlapImgParams, 2)
-            *(float)albedoImage.impl()(jj,ii)*overlapImgParams.exposureTime;
-          jacobianArray(r,c) = recDerTOP;
+          jacobianArray(r, c) = recDer(2);
 
         }
 
@@ -449,7 +435,7 @@ ComputeBlockJacobianOverlap(ImageViewBase<ViewT1> const& inputImage, GeoReferenc
           errorVectorArray(r) = 0;
         }
         else{
-          float relief = ComputeReflectance(normalize(normalArray[r]), xyzArray[r], overlapImgParams, globalParams);
+          float relief = reliefArray[r];
           float recErr = ComputeError((float)interpOverlapImage.impl()(x, y), overlapImgParams.exposureTime, (float)albedoImage.impl()(jj, ii), relief);
           //float recErr = ComputeReconstructError((float)interpOverlapImage.impl()(x, y), overlapImgParams.exposureTime, (float)albedoImage.impl()(jj, ii), relief);
           errorVectorArray(r) = recErr;
@@ -522,17 +508,23 @@ void vw::photometry::UpdateHeightMap(ModelParams inputImgParams, std::vector<Mod
   int numVerBlocks = meanDEM.rows()/verBlockSize + 1;
   printf("numVerBlocks = %d, numHorBlocks = %d\n", numVerBlocks, numHorBlocks);
 
-  vector<Vector3> normalArray;
   vector<Vector3> xyzArray;
   vector<Vector3> xyzTOPArray;
   vector<Vector3> xyzLEFTArray;
   vector<float> reliefArray;
 
-  normalArray.resize((verBlockSize+1)*(horBlockSize+1));
   xyzArray.resize((verBlockSize+1)*(horBlockSize+1));
   xyzTOPArray.resize((verBlockSize+1)*(horBlockSize+1));
   xyzLEFTArray.resize((verBlockSize+1)*(horBlockSize+1));
 
+  //the block geometry as seen in each image; it is computed once per block
+  //and shared by the Jacobians of all the images
+  vector<ReflectanceGeometry> geometryArray;
+  geometryArray.push_back(ReflectanceGeometry(inputImgParams, numJacobianRows));
+  for (int m = 0; m < numOverlapImages; m++){
+    geometryArray.push_back(ReflectanceGeometry(overlapImgParams[m], numJacobianRows));
+  }
+
   //josh - create image for error in terms of height and initialize to zero
   ImageView<PixelMask<PixelGray<float> > > errorHeight(meanDEM.cols(), meanDEM.rows());
   for (int k = 0; k < meanDEM.rows(); ++k){
@@ -594,16 +586,15 @@ void vw::photometry::UpdateHeightMap(ModelParams inputImgParams, std::vector<Mod
         }
       }
 
-      //TO DO: reset xyzArray, xyzLEFT and xyzTOP
       ComputeBlockGeometry(interp_dem_image, DEM_geo,
           inputImage, inputImg_geo, kb, lb,
           inputImgParams, globalParams,
           xyzArray, xyzLEFTArray,
-          xyzTOPArray, normalArray);
+          xyzTOPArray, geometryArray);
 
       ComputeBlockJacobian(inputImage, inputImg_geo, shadowImage, albedoImage,
           kb, lb, inputImgParams, globalParams,
-          xyzArray, xyzLEFTArray, xyzTOPArray,normalArray,
+          xyzArray, xyzLEFTArray, xyzTOPArray,geometryArray[0],
           jacobianArray[0], errorVectorArray[0], weightsArray[0]);
 
       //printJacobian(jacobianArray[0], "mujapenas.txt");
@@ -652,7 +643,7 @@ void vw::photometry::UpdateHeightMap(ModelParams inputImgParams, std::vector<Mod
             shadowImage, overlapShadowImage,
             albedoImage, kb, lb,
             inputImgParams, overlapImgParams[m], globalParams,
-            xyzArray, xyzLEFTArray, xyzTOPArray,normalArray,
+            xyzArray, xyzLEFTArray, xyzTOPArray,geometryArray[m+1],
             jacobianArray[m+1], errorVectorArray[m+1], weightsArray[m+1]);
 
       }
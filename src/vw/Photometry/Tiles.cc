@@ -0,0 +1,142 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <algorithm>
+#include <cstdio>
+
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image.h>
+#include <vw/Cartography.h>
+#include <vw/Photometry/Tiles.h>
+#include <vw/Photometry/Reflectance.h>
+
+using namespace vw;
+using namespace vw::photometry;
+
+namespace {
+  class TileJobTask : public Task {
+    TileJob m_job;
+    size_t m_index;
+    BBox2i m_bbox;
+  public:
+    TileJobTask(TileJob const& job, size_t index, BBox2i const& bbox)
+      : m_job(job), m_index(index), m_bbox(bbox) {}
+    void operator()() { m_job(m_index, m_bbox); }
+  };
+}
+
+std::vector<Vector2>
+vw::photometry::grid_pixels(BBox2i const& bbox) {
+  std::vector<Vector2> pixels;
+  pixels.reserve(bbox.width()*bbox.height());
+  for (int32 k = bbox.min().y(); k < bbox.max().y(); ++k)
+    for (int32 l = bbox.min().x(); l < bbox.max().x(); ++l)
+      pixels.push_back(Vector2(l,k));
+  return pixels;
+}
+
+std::vector<Vector2>
+vw::photometry::truncate_pixels(std::vector<Vector2> const& pixels) {
+  std::vector<Vector2> result(pixels.size());
+  for (size_t i = 0; i < pixels.size(); ++i)
+    result[i] = Vector2((int)pixels[i][0], (int)pixels[i][1]);
+  return result;
+}
+
+vw::photometry::OverlapImages
+vw::photometry::open_overlap_images(std::vector<ModelParams> const& overlap_img_params) {
+  OverlapImages overlaps;
+  for (size_t i = 0; i < overlap_img_params.size(); i++){
+    printf("overlap_img = %s\n", overlap_img_params[i].inputFilename.c_str());
+    overlaps.push_back(boost::shared_ptr<OverlapImage>(new OverlapImage(overlap_img_params[i])));
+  }
+  return overlaps;
+}
+
+std::vector<SurfacePoint>
+vw::photometry::image_surface(cartography::GeoReference const& input_geo,
+                              GeoImage<PixelGray<float> > const& dem,
+                              int nodata, BBox2i const& bbox,
+                              std::vector<Vector2>& lon_lats) {
+  const int32 cols = bbox.width(), rows = bbox.height();
+
+  // the tile with the row above it and the column left of it
+  BBox2i grid(bbox.min() - Vector2i(1,1), bbox.max());
+  std::vector<Vector2> pixels = grid_pixels(grid), grid_lon_lats, dem_pixels;
+  input_geo.pixels_to_lonlats(pixels, grid_lon_lats);
+  dem.geo.lonlats_to_pixels(grid_lon_lats, dem_pixels);
+
+  std::vector<Vector2> samples = dem_pixels;
+  lon_lats.resize(cols*rows);
+  std::vector<Vector2> dem_centers(cols*rows);
+  for (int32 k = 0, i = 0; k < rows; ++k) {
+    for (int32 l = 0; l < cols; ++l, ++i) {
+      const int32 c = (k+1)*(cols+1) + (l+1);
+      lon_lats[i] = grid_lon_lats[c];
+      dem_centers[i] = Vector2((int)dem_pixels[c][0], (int)dem_pixels[c][1]);
+      samples.push_back(dem_centers[i]);
+    }
+  }
+
+  std::vector<SurfacePoint> points(cols*rows);
+  // the left and top neighbours are sampled wherever they fall
+  ImageRegion<PixelGray<float> > dem_region(dem.image, samples, true);
+  if (dem_region.empty())
+    return points;
+
+  cartography::Datum const& datum = input_geo.datum();
+  for (int32 k = 0, i = 0; k < rows; ++k) {
+    for (int32 l = 0; l < cols; ++l, ++i) {
+      const int32 c = (k+1)*(cols+1) + (l+1), left = c-1, top = c-(cols+1);
+      Vector2 const& dem_pix = dem_centers[i];
+
+      //check for valid DEM coordinates
+      if (!in_bounds(dem_pix, dem.image))
+        continue;
+
+      //check for valid DEM pixel value and valid left and top coordinates
+      const int32 x = (int)dem_pix[0], y = (int)dem_pix[1];
+      if ((bbox.min().x()+l-1 < 0) || (bbox.min().y()+k-1 < 0) || (dem_region.at(x,y) == nodata))
+        continue;
+
+      Vector3 longlat3(lon_lats[i](0),lon_lats[i](1),dem_region(x, y));
+      points[i].xyz = datum.geodetic_to_cartesian(longlat3);//3D coordinates in the img coordinates
+
+      //determine the 3D coordinates of the pixel left of the current pixel
+      Vector3 longlat3_left(grid_lon_lats[left](0),grid_lon_lats[left](1),dem_region(dem_pixels[left](0), dem_pixels[left](1)));
+      Vector3 xyz_left = datum.geodetic_to_cartesian(longlat3_left);
+
+      //determine the 3D coordinates of the pixel top of the current pixel
+      Vector3 longlat3_top(grid_lon_lats[top](0),grid_lon_lats[top](1),dem_region(dem_pixels[top](0), dem_pixels[top](1)));
+      Vector3 xyz_top = datum.geodetic_to_cartesian(longlat3_top);
+
+      points[i].normal = computeNormalFrom3DPointsGeneral(points[i].xyz, xyz_left, xyz_top);
+      points[i].valid = true;
+    }
+  }
+  return points;
+}
+
+std::vector<BBox2i>
+vw::photometry::image_tiles(int32 cols, int32 rows, int32 tile_size) {
+  if (tile_size <= 0)
+    tile_size = vw_settings().default_tile_size();
+  std::vector<BBox2i> tiles;
+  for (int32 y = 0; y < rows; y += tile_size)
+    for (int32 x = 0; x < cols; x += tile_size)
+      tiles.push_back(BBox2i(x, y, std::min(tile_size, cols - x), std::min(tile_size, rows - y)));
+  return tiles;
+}
+
+void
+vw::photometry::run_tile_jobs(std::vector<BBox2i> const& tiles, TileJob const& job) {
+  FifoWorkQueue queue(vw_settings().default_num_threads());
+  for (size_t i = 0; i < tiles.size(); ++i)
+    queue.add_task(boost::shared_ptr<Task>(new TileJobTask(job, i, tiles[i])));
+  queue.join_all();
+}
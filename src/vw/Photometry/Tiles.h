@@ -0,0 +1,172 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Tiles.h
+///
+/// Helpers for running the photometry passes as independent jobs, one
+/// per tile of the output, in parallel, and for sharing the images they
+/// read between passes.
+
+#ifndef __VW_PHOTOMETRY_TILES_H__
+#define __VW_PHOTOMETRY_TILES_H__
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <vw/Math/BBox.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Interpolation.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/FileIO/DiskImageView.h>
+#include <vw/Cartography/GeoReference.h>
+#include <vw/Photometry/Reconstruct.h>
+
+namespace vw {
+namespace photometry {
+
+  /// An image and its georeference.  A pass opens each of its images
+  /// once and shares it between all of its tile jobs, which read it
+  /// through the DiskImageView's block cache.
+  template <class PixelT>
+  struct GeoImage {
+    DiskImageView<PixelT> image;
+    cartography::GeoReference geo;
+
+    GeoImage(std::string const& filename) : image(filename) {
+      cartography::read_georeference(geo, filename);
+    }
+  };
+
+  /// An image overlapping the input image of a pass, with its shadow
+  /// mask.
+  struct OverlapImage {
+    GeoImage<PixelMask<PixelGray<uint8> > > image;
+    DiskImageView<PixelMask<PixelGray<uint8> > > shadow;
+    ModelParams params;
+
+    OverlapImage(ModelParams const& params)
+      : image(params.inputFilename), shadow(params.shadowFilename), params(params) {}
+  };
+
+  typedef std::vector<boost::shared_ptr<OverlapImage> > OverlapImages;
+
+  OverlapImages open_overlap_images(std::vector<ModelParams> const& overlap_img_params);
+
+  /// The images a pass over an input image reads: the image, its shadow
+  /// mask, the DEM under it and the images overlapping it.  Passes run
+  /// one after the other over the same input image can share one set,
+  /// so that each file is opened, and its blocks cached, only once.
+  struct ReconstructImages {
+    GeoImage<PixelMask<PixelGray<uint8> > > input;
+    DiskImageView<PixelMask<PixelGray<uint8> > > shadow;
+    GeoImage<PixelGray<float> > dem;
+    OverlapImages overlaps;
+
+    ReconstructImages(ModelParams const& input_img_params,
+                      std::vector<ModelParams> const& overlap_img_params)
+      : input(input_img_params.inputFilename), shadow(input_img_params.shadowFilename),
+        dem(input_img_params.meanDEMFilename), overlaps(open_overlap_images(overlap_img_params)) {}
+  };
+
+  /// The part of an image a tile job samples, read into memory: the
+  /// pixels that bilinear interpolation at the given positions needs.
+  /// Sampling it gives exactly what sampling the whole image, edge
+  /// extended with ConstantEdgeExtension, would give, at those
+  /// positions only.
+  ///
+  /// Positions outside the image are left out, as the passes check the
+  /// bounds before sampling, unless clamp is set, for the samples that
+  /// rely on the edge extension instead.
+  template <class PixelT>
+  class ImageRegion {
+    typedef InterpolationView<EdgeExtensionView<ImageView<PixelT>, ConstantEdgeExtension>,
+                              BilinearInterpolation> interp_type;
+    ImageView<PixelT> m_pixels;
+    BBox2i m_bbox;
+    boost::shared_ptr<interp_type> m_interp;
+
+  public:
+    template <class ViewT>
+    ImageRegion(ImageViewBase<ViewT> const& image, std::vector<Vector2> const& positions,
+                bool clamp = false) {
+      const int32 cols = image.impl().cols(), rows = image.impl().rows();
+      for (size_t i = 0; i < positions.size(); ++i) {
+        int32 x = int32(floor(positions[i].x())), y = int32(floor(positions[i].y()));
+        if (!clamp && (x < 0 || x >= cols || y < 0 || y >= rows))
+          continue;
+        m_bbox.grow(Vector2i(std::min(std::max(x, 0), cols-1), std::min(std::max(y, 0), rows-1)));
+        m_bbox.grow(Vector2i(std::min(std::max(x+2, 1), cols), std::min(std::max(y+2, 1), rows)));
+      }
+      if (m_bbox.empty())
+        return;
+      m_pixels = crop(image.impl(), m_bbox);
+      m_interp.reset(new interp_type(interpolate(m_pixels, BilinearInterpolation(),
+                                                 ConstantEdgeExtension())));
+    }
+
+    /// Whether none of the positions fell inside the image.
+    bool empty() const { return m_bbox.empty(); }
+
+    /// The pixel at (x,y), in the coordinates of the whole image.
+    PixelT const& at(int32 x, int32 y) const {
+      return m_pixels(x - m_bbox.min().x(), y - m_bbox.min().y());
+    }
+
+    /// The image interpolated at (x,y), in the coordinates of the whole
+    /// image.
+    PixelT operator()(double x, double y) const {
+      return (*m_interp)(x - m_bbox.min().x(), y - m_bbox.min().y());
+    }
+  };
+
+  /// The pixel positions in bbox, row by row.
+  std::vector<Vector2> grid_pixels(BBox2i const& bbox);
+
+  /// The positions truncated to whole pixels, as the passes look up
+  /// images at integer positions.
+  std::vector<Vector2> truncate_pixels(std::vector<Vector2> const& pixels);
+
+  /// Whether the position is inside the image.
+  template <class ViewT>
+  bool in_bounds(Vector2 const& pix, ImageViewBase<ViewT> const& image) {
+    return (pix[0] >= 0) && (pix[0] < image.impl().cols()) && (pix[1] >= 0) && (pix[1] < image.impl().rows());
+  }
+
+  /// The geometry of the surface under a pixel of an input image.
+  struct SurfacePoint {
+    bool valid;
+    Vector3 xyz, normal;
+    SurfacePoint() : valid(false) {}
+  };
+
+  /// The surface under each pixel of bbox in the input image, row by
+  /// row, from the DEM heights under the pixel and under its left and
+  /// top neighbours.  Pixels without a DEM value or without neighbours
+  /// are left invalid.  The lon/lat of each pixel goes in lon_lats.
+  std::vector<SurfacePoint> image_surface(cartography::GeoReference const& input_geo,
+                                          GeoImage<PixelGray<float> > const& dem,
+                                          int nodata, BBox2i const& bbox,
+                                          std::vector<Vector2>& lon_lats);
+
+  /// A tile job: it gets its index among the tiles and its bbox.
+  typedef boost::function<void (size_t, BBox2i const&)> TileJob;
+
+  /// The tiles of a cols x rows image, row by row, of the default tile
+  /// size unless one is given.
+  std::vector<BBox2i> image_tiles(int32 cols, int32 rows, int32 tile_size = 0);
+
+  /// Run the job on every tile, on vw_settings().default_num_threads()
+  /// threads, and wait for them all.
+  void run_tile_jobs(std::vector<BBox2i> const& tiles, TileJob const& job);
+
+}} // end vw::photometry
+
+#endif//__VW_PHOTOMETRY_TILES_H__
@@ -14,11 +14,20 @@
 #include <vw/Core/Log.h>
 #include <vw/Core/Debugging.h>
 
-#include <fstream>
 #include <string>
+#include <algorithm>
+#include <limits>
+#include <cerrno>
+#include <cstring>
 #include <boost/shared_array.hpp>
 #include <boost/scoped_array.hpp>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #define WHEREAMI (vw::vw_out(VerboseDebugMessage, "platefile.blob") << VW_CURRENT_FUNCTION << ": ")
 
 #if 0
@@ -36,22 +45,31 @@ namespace vw {
 namespace platefile {
   using detail::BlobRecord;
 
-void ReadBlob::check_fail(const char* c1, const char* c2) const {
-  if (m_fstream->fail()) {
-    m_fstream->clear();
-    vw_throw(BlobIoErr() << "BlobIoErr occured on blob " << m_blob_filename << " while " << c1 << " " << c2);
-  }
+void ReadBlob::io_fail(const char* c1, const char* c2) const {
+  vw_throw(BlobIoErr() << "BlobIoErr occured on blob " << m_blob_filename << " while " << c1 << " " << c2 << ": " << strerror(errno));
 }
 
-void ReadBlob::read_at(uint64 offset64, char* dst, uint64 size, const char* context) const {
-  if (m_fstream->eof())
-    m_fstream->clear();
+void ReadBlob::read_at(uint64 offset, char* dst, uint64 size, const char* context) const {
+  if (m_map && offset <= m_map_size && size <= m_map_size - offset) {
+    memcpy(dst, m_map + offset, boost::numeric_cast<size_t>(size));
+    return;
+  }
 
-  std::streamoff offset = boost::numeric_cast<std::streamoff>(offset64);
-  m_fstream->seekg(offset, std::ios_base::beg);
-  check_fail(context, "while seeking");
-  m_fstream->read(dst, boost::numeric_cast<std::streamsize>(size));
-  check_fail(context, "while reading data");
+  while (size > 0) {
+    ssize_t ret = ::pread(m_fd, dst, boost::numeric_cast<size_t>(size), boost::numeric_cast<off_t>(offset));
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+      io_fail(context, "while reading data");
+    }
+    if (ret == 0) {
+      errno = EIO;
+      io_fail(context, "(unexpected end of file)");
+    }
+    dst    += ret;
+    offset += ret;
+    size   -= ret;
+  }
 }
 
 uint32 tile_header_offset(const uint32& base_offset, const BlobRecord& blob_record, const BlobRecordSizeType& blob_record_size) {
@@ -74,8 +92,7 @@ BlobRecord ReadBlob::read_blob_record(const uint32& base_offset, BlobRecordSizeT
   read_at(base_offset, (char*)&blob_record_size, sizeof(BlobRecordSizeType), "reading blob record size");
 
   boost::shared_array<uint8> blob_rec_data(new uint8[blob_record_size]);
-  m_fstream->read(reinterpret_cast<char*>(blob_rec_data.get()), blob_record_size);
-  check_fail("reading a blob record");
+  read_at(uint64(base_offset) + sizeof(BlobRecordSizeType), reinterpret_cast<char*>(blob_rec_data.get()), blob_record_size, "reading a blob record");
 
   BlobRecord blob_record;
   bool worked = blob_record.ParseFromArray(blob_rec_data.get(),  boost::numeric_cast<int>(blob_record_size));
@@ -92,7 +109,7 @@ TileHeader ReadBlob::read_tile_header(const uint32& base_offset, const BlobRecor
 
   TileHeader header;
   bool worked = header.ParseFromArray(data.get(), boost::numeric_cast<int>(size));
-  VW_ASSERT(worked, BlobIoErr() << "read_tile_record() failed in " << m_blob_filename << " at offset " << m_fstream->tellg());
+  VW_ASSERT(worked, BlobIoErr() << "read_tile_record() failed in " << m_blob_filename << " at offset " << offset);
   return header;
 }
 
@@ -176,24 +193,43 @@ uint64 ReadBlob::data_size(uint64 base_offset) const {
 }
 
 ReadBlob::ReadBlob(const std::string& filename, bool skip_init)
-  : m_blob_filename(filename)
+  : m_blob_filename(filename), m_end_of_file_ptr(0), m_fd(-1), m_map(0), m_map_size(0)
 {
   if (!skip_init)
-    init();
+    init(PreadMode);
 }
 
-ReadBlob::ReadBlob(const std::string& filename)
-  : m_blob_filename(filename)
-{ init(); }
+ReadBlob::ReadBlob(const std::string& filename, ReadMode mode)
+  : m_blob_filename(filename), m_end_of_file_ptr(0), m_fd(-1), m_map(0), m_map_size(0)
+{ init(mode); }
+
+void ReadBlob::init(ReadMode mode) {
+  m_fd = ::open(m_blob_filename.c_str(), O_RDONLY);
+  VW_ASSERT(m_fd >= 0, BlobIoErr() << "Could not open blob file " << m_blob_filename << ": " << strerror(errno));
+  try {
+    m_end_of_file_ptr = read_end_of_file_ptr();
+  } catch (...) {
+    ::close(m_fd);
+    throw;
+  }
 
-void ReadBlob::init() {
-  m_fstream.reset(new std::fstream(m_blob_filename.c_str(), std::ios::in | std::ios::binary));
-  VW_ASSERT(m_fstream->is_open(), BlobIoErr() << "Could not open blob file " << m_blob_filename);
-  m_end_of_file_ptr = read_end_of_file_ptr();
+  if (mode == MmapMode && m_end_of_file_ptr > 0) {
+    void* map = ::mmap(0, boost::numeric_cast<size_t>(m_end_of_file_ptr), PROT_READ, MAP_SHARED, m_fd, 0);
+    if (map == MAP_FAILED)
+      vw_out(DebugMessage, "platefile.blob") << "Could not map " << m_blob_filename << " (" << strerror(errno) << "), reading it with pread instead" << std::endl;
+    else {
+      m_map = reinterpret_cast<const uint8*>(map);
+      m_map_size = m_end_of_file_ptr;
+    }
+  }
   WHEREAMI << m_blob_filename << std::endl;
 }
 
 ReadBlob::~ReadBlob() {
+  if (m_map)
+    ::munmap(const_cast<uint8*>(m_map), boost::numeric_cast<size_t>(m_map_size));
+  if (m_fd >= 0)
+    ::close(m_fd);
   WHEREAMI << m_blob_filename << "\n";
 }
 
@@ -223,24 +259,29 @@ void Blob::write_end_of_file_ptr(uint64 ptr) {
   data[1] = ptr;
   data[2] = ptr;
 
-  if (m_fstream->eof())
-    m_fstream->clear();
   // The end of file ptr is stored at the beginning of the blob file.
-  m_fstream->seekp(0, std::ios_base::beg);
-  check_fail("Failed to seek to beginning of blob for EOF ptr write");
-  m_fstream->write(reinterpret_cast<char*>(&data), 3*sizeof(uint64));
-  check_fail("Failed to write end of file ptr");
+  write_at(0, reinterpret_cast<char*>(&data), 3*sizeof(uint64), "writing end of file ptr");
+}
+
+void Blob::write_at(uint64 offset, const char* src, uint64 size, const char* context) {
+  while (size > 0) {
+    ssize_t ret = ::pwrite(m_fd, src, boost::numeric_cast<size_t>(size), boost::numeric_cast<off_t>(offset));
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+      io_fail(context);
+    }
+    src    += ret;
+    offset += ret;
+    size   -= ret;
+  }
 }
 
 uint64 ReadBlob::read_end_of_file_ptr() const {
   uint64 data[3];
 
   // The end of file ptr is stored at the beginning of the blob file.
-  if (m_fstream->eof())
-    m_fstream->clear();
-  m_fstream->seekg(0, std::ios_base::beg);
-  m_fstream->read(reinterpret_cast<char*>(data), 3*sizeof(uint64));
-  check_fail("Failed to read end of file ptr");
+  read_at(0, reinterpret_cast<char*>(data), 3*sizeof(uint64), "reading end of file ptr");
 
   // Make sure the read ptr is valid by comparing the three
   // entries.
@@ -258,33 +299,33 @@ uint64 ReadBlob::read_end_of_file_ptr() const {
     return data[1];
   else {
     vw_out(ErrorMessage) << "end of file ptr in blobfile " << m_blob_filename << " is inconsistent. This file may be corrupt. Proceed with caution.\n";
-    if (m_fstream->eof())
-      m_fstream->seekg(0, std::ios_base::end);
-    return m_fstream->tellg();
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0)
+      io_fail("finding the size of the blob");
+    return st.st_size;
   }
 }
 
 // Constructor stores the blob filename for reading & writing
-Blob::Blob(const std::string& filename_)
-  : ReadBlob(filename_, true), m_write_count(0)
+Blob::Blob(const std::string& filename_, uint64 combine_size)
+  : ReadBlob(filename_, true), m_buffer_offset(std::numeric_limits<uint64>::max()), m_combine_size(combine_size)
 {
-  m_fstream.reset(new std::fstream(m_blob_filename.c_str(), std::ios::in | std::ios::out | std::ios::binary));
+  // (Until the end of file ptr is known, every read goes to the file.)
+  m_fd = ::open(m_blob_filename.c_str(), O_RDWR|O_CREAT, 0666);
+  VW_ASSERT(m_fd >= 0, BlobIoErr() << "Could not open blob file " << m_blob_filename << ": " << strerror(errno));
 
-  // If the file is not open, then that means that we need to create it.
-  // (Note: the C++ standard does not let you create a file when you specify
-  // std::ios::in., hence the gymnastics here.)
-  if (!m_fstream->is_open()) {
-    m_fstream->clear();
-    m_fstream->open(m_blob_filename.c_str(), std::ios::out|std::ios::binary);
-    VW_ASSERT(m_fstream->is_open(), BlobIoErr() << "Could not create blob file " << m_blob_filename);
+  // A blob we just created is empty, and needs its end of file ptr before
+  // anything can read it.
+  struct stat st;
+  if (::fstat(m_fd, &st) != 0)
+    io_fail("finding the size of the blob");
 
+  if (st.st_size == 0) {
     m_end_of_file_ptr = 3 * sizeof(uint64);
-    flush();
-    m_fstream->close();
-    m_fstream->open(m_blob_filename.c_str(), std::ios::out|std::ios::in|std::ios::binary);
-    VW_ASSERT(m_fstream->is_open(), BlobIoErr() << "Could not create blob file " << m_blob_filename);
+    write_end_of_file_ptr(m_end_of_file_ptr);
   }
   m_end_of_file_ptr = read_end_of_file_ptr();
+  m_buffer_offset = m_end_of_file_ptr;
   WHEREAMI << m_blob_filename << std::endl;
 }
 
@@ -294,23 +335,43 @@ Blob::~Blob() {
   WHEREAMI << m_blob_filename << "\n";
 }
 
+void Blob::write_buffer() {
+  if (m_buffer.empty())
+    return;
+  write_at(m_buffer_offset, reinterpret_cast<const char*>(&m_buffer[0]), m_buffer.size(), "writing buffered tiles");
+  m_buffer_offset += m_buffer.size();
+  m_buffer.clear();
+}
+
 void Blob::flush() {
+  this->write_buffer();
   this->write_end_of_file_ptr(m_end_of_file_ptr);
-  m_fstream->flush();
   WHEREAMI << m_blob_filename << "\n";
 }
 
+void Blob::read_at(uint64 offset, char* dst, uint64 size, const char* context) const {
+  // Anything before the buffer is already in the file
+  if (offset < m_buffer_offset) {
+    uint64 in_file = std::min(size, m_buffer_offset - offset);
+    ReadBlob::read_at(offset, dst, in_file, context);
+    offset += in_file;
+    dst    += in_file;
+    size   -= in_file;
+  }
+  if (size == 0)
+    return;
+
+  VW_ASSERT(offset - m_buffer_offset <= m_buffer.size() && size <= m_buffer.size() - (offset - m_buffer_offset),
+            BlobIoErr() << "BlobIoErr occured on blob " << m_blob_filename << " while " << context << " (read past the end of the blob)");
+  memcpy(dst, &m_buffer[offset - m_buffer_offset], boost::numeric_cast<size_t>(size));
+}
 
 uint64 Blob::write(TileHeader const& header, const uint8* data, uint64 data_size) {
   VW_ASSERT(m_end_of_file_ptr >= 24, LogicErr() << "What? This shouldn't happen.");
 
   // Store the current offset of the end of the file.  We'll
   // return that at the end of this function.
-  std::streamoff base_offset = boost::numeric_cast<std::streamoff>(m_end_of_file_ptr);
-  if (m_fstream->eof())
-    m_fstream->clear();
-  m_fstream->seekp(base_offset, std::ios_base::beg);
-  check_fail("seeking to write a tile header");
+  uint64 base_offset = m_end_of_file_ptr;
 
   // Create the blob record and write it to the blob file.
   BlobRecord blob_record;
@@ -320,36 +381,30 @@ uint64 Blob::write(TileHeader const& header, const uint8* data, uint64 data_size
   blob_record.set_data_size(data_size);
 
   // Write the actual blob record size first.  This will help us
-  // read and deserialize this protobuffer later on.
+  // read and deserialize this protobuffer later on.  The size, the
+  // record, the tile header and the data are appended to the buffer,
+  // which follows the end of the blob.
   BlobRecordSizeType blob_record_size = boost::numeric_cast<BlobRecordSizeType>(blob_record.ByteSize());
-  m_fstream->write(reinterpret_cast<char*>(&blob_record_size), sizeof(BlobRecordSizeType));
-  check_fail("writing a blob record size");
-  blob_record.SerializeToOstream(m_fstream.get());
-  check_fail("writing a blob record");
-
-  // Serialize the header.
-  header.SerializeToOstream(m_fstream.get());
-  check_fail("writing a tile header");
+  size_t metadata_size = sizeof(BlobRecordSizeType) + blob_record_size + header.ByteSize();
 
-  // And write the data.
-  m_fstream->write(reinterpret_cast<const char*>(data), boost::numeric_cast<size_t>(data_size));
-  check_fail("writing tile data");
+  size_t start = m_buffer.size();
+  m_buffer.resize(start + metadata_size + boost::numeric_cast<size_t>(data_size));
+  uint8* dst = &m_buffer[start];
+  memcpy(dst, &blob_record_size, sizeof(BlobRecordSizeType));
+  blob_record.SerializeWithCachedSizesToArray(dst + sizeof(BlobRecordSizeType));
+  header.SerializeWithCachedSizesToArray(dst + sizeof(BlobRecordSizeType) + blob_record_size);
+  if (data_size)
+    memcpy(dst + metadata_size, data, boost::numeric_cast<size_t>(data_size));
 
-  // Write the data at the end of the file and return the offset
-  // of the beginning of this data file.
   vw_out(VerboseDebugMessage, "platefile::blob") << "Blob::write() -- wrote " << data_size << " bytes to " << m_blob_filename << "\n";
 
   // Update the in-memory copy of the end-of-file pointer
-  m_end_of_file_ptr = m_fstream->tellg();
-
-  // The write_count is used to keep track of when we last wrote
-  // the end_of_file_ptr to disk.  We don't want to write this too
-  // often since this will slow down IO, so we only write it every
-  // 10 writes (or when the blob is deconstructed...).
-  ++m_write_count;
-  if (m_write_count % 10 == 0) {
-    this->write_end_of_file_ptr(m_end_of_file_ptr);
-  }
+  m_end_of_file_ptr = base_offset + metadata_size + data_size;
+
+  // Once enough has built up, send it all to the file and move the end of
+  // file ptr on disk past it.
+  if (m_buffer.size() >= m_combine_size)
+    this->flush();
 
   // Return the base_offset
   return base_offset;
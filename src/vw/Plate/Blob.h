@@ -42,6 +42,7 @@
 #include <boost/shared_array.hpp>
 #include <fstream>
 #include <string>
+#include <vector>
 
 namespace vw {
 namespace platefile {
@@ -54,14 +55,26 @@ namespace platefile {
     TileData data;
   };
 
+  /// Reads tiles from a blob file. Every read is positioned (pread(2), or
+  /// a copy out of the mapping in MmapMode) and nothing about the file
+  /// position is kept, so one ReadBlob can be shared by any number of
+  /// threads without locking.
   class ReadBlob : boost::noncopyable {
+    public:
+      /// PreadMode reads with pread(2). MmapMode maps the valid part of
+      /// the blob when it is opened and copies tiles out of the mapping;
+      /// only use it for blobs nobody will truncate while they're open.
+      enum ReadMode { PreadMode, MmapMode };
+
     protected:
       std::string m_blob_filename;
       uint64 m_end_of_file_ptr;
-      boost::shared_ptr<std::fstream> m_fstream;
+      int m_fd;
+      const uint8* m_map;
+      uint64 m_map_size;
 
-      void read_at(uint64 offset, char* dst, uint64 size, const char* context) const;
-      void check_fail(const char* context, const char* context2 = "") const;
+      virtual void read_at(uint64 offset, char* dst, uint64 size, const char* context) const;
+      void io_fail(const char* context, const char* context2 = "") const;
 
       typedef vw::uint16 BlobRecordSizeType;
       /// Returns the metadata (i.e. BlobRecord) for a blob entry.
@@ -71,7 +84,7 @@ namespace platefile {
 
       uint64 read_end_of_file_ptr() const;
 
-      void init();
+      void init(ReadMode mode);
 
       // protected constructor so WriteBlob can do its own initialization
       ReadBlob(const std::string& filename, bool skip_init);
@@ -94,8 +107,8 @@ namespace platefile {
 
       typedef iterator const_iterator;
 
-      explicit ReadBlob(const std::string& filename);
-      ~ReadBlob();
+      explicit ReadBlob(const std::string& filename, ReadMode mode = PreadMode);
+      virtual ~ReadBlob();
 
       /// Returns the size of the blob in bytes.  Note: only counts
       /// valid entries.  (Invalid data may exist beyond the end of the
@@ -134,23 +147,41 @@ namespace platefile {
       uint64 data_size(uint64 base_offset) const;
   };
 
+  /// Appends tiles to a blob file. With a combine_size, tiles are
+  /// combined in memory and go out to the file in one write once that
+  /// many bytes have built up, or on flush(). The end of file ptr only
+  /// moves when they do, so other readers of the blob never see a tile
+  /// whose data isn't there yet. A Blob itself reads tiles back whether
+  /// they've gone out or not. Without one, each tile goes out as it is
+  /// written.
   class Blob : public ReadBlob {
     private:
-      uint64 m_write_count;
+      std::vector<uint8> m_buffer;
+      uint64 m_buffer_offset;
+      uint64 m_combine_size;
       void write_end_of_file_ptr(uint64 ptr);
+      void write_at(uint64 offset, const char* src, uint64 size, const char* context);
+      void write_buffer();
+
+    protected:
+      virtual void read_at(uint64 offset, char* dst, uint64 size, const char* context) const;
+
     public:
-      explicit Blob(const std::string& filename);
+      explicit Blob(const std::string& filename, uint64 combine_size = 0);
 
-      /// The destructor flushes any unwritten journal entries and
-      /// closes the blob and journal files.
+      /// The destructor flushes any buffered tiles and writes the end
+      /// of file ptr.
       ~Blob();
 
       /// Write a tile to the blob file. You must supply the header
-      /// (e.g. a serialized TileHeader protobuffer) and the data as
-      /// shared_arrays.  Returns the base_offset where the data was
-      /// written to the blob file.
+      /// (e.g. a serialized TileHeader protobuffer) and the data.
+      /// Returns the base_offset where the data was (or, if it is still
+      /// buffered, will be) written to the blob file.
       vw::uint64 write(TileHeader const& header, const uint8* data, uint64 data_size);
 
+      /// Bytes of tiles written but not yet sent to the file.
+      uint64 buffered_size() const { return m_buffer.size(); }
+
       // Flush all pending changes
       void flush();
   };
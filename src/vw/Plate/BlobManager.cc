@@ -13,6 +13,7 @@
 #include <vw/Core/Exception.h>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/Stopwatch.h>
 
 #include <boost/format.hpp>
 #include <boost/filesystem/operations.hpp>
@@ -24,6 +25,11 @@ namespace fs = boost::filesystem;
 
 namespace {
   static const vw::uint64 BLOB_MAX_SIZE = 1717986920; // 1.6 GB
+
+  // An owned blob that has sat unlocked this long may go to another
+  // writer, if there's no free blob for it; its owner has likely gone.
+  static const vw::uint64 BLOB_IDLE_OWNER_TIMEOUT = 10 * 60 * 1000000ULL; // 10 minutes
+
   static const boost::format blob_tmpl("%s/plate_%u.blob");
 }
 
@@ -36,10 +42,15 @@ const uint64 BlobManager::BLOB_MIN_WRITABLE_SCORE = 2;
 
 uint64 BlobManager::BlobKey::score() const {
   if (locked)          return 1;
-  if (size > BLOB_MAX_SIZE) return 0;
+  if (full())          return 0;
+  if (!owner.empty())  return 1;
   return size + BLOB_MIN_WRITABLE_SCORE;
 }
 
+bool BlobManager::BlobKey::full() const {
+  return size > BLOB_MAX_SIZE;
+}
+
 bool BlobManager::BlobKey::can_write() const {
   return score() >= BLOB_MIN_WRITABLE_SCORE;
 }
@@ -62,22 +73,74 @@ uint64 BlobManager::blob_size(uint32 blob_id) const {
   return i->size;
 }
 
-uint32 BlobManager::request_lock() {
-  WHEREAMI << std::endl;
+uint32 BlobManager::request_lock(const std::string& writer) {
+  WHEREAMI << writer << std::endl;
   Mutex::Lock lock(m_mutex);
-  blob_by_score_t& lookup = m_blobs.get<1>();
 
+  // A writer with a blob of its own gets it back until it fills up. If the
+  // writer is using it right now (two writes at once), this write gets a
+  // blob of its own without taking ownership of it.
+  std::string owner = writer;
+  if (!writer.empty()) {
+    affinity_t::iterator a = m_affinity.find(writer);
+    if (a != m_affinity.end()) {
+      blob_by_id_t& by_id = m_blobs.get<0>();
+      blob_by_id_t::iterator i = by_id.find(a->second);
+      if (i != by_id.end() && i->owner == writer && i->locked)
+        owner.clear();
+      else {
+        if (i != by_id.end() && i->owner == writer) {
+          if (!i->full()) {
+            by_id.modify(i, BlobKey::SetLock(writer));
+            return i->id;
+          }
+          by_id.modify(i, BlobKey::ClearOwner());
+        }
+        m_affinity.erase(a);
+      }
+    }
+  }
+
+  // Otherwise, the fullest blob nobody owns, one left idle by its owner,
+  // or a new one
+  uint32 blob_id;
+  blob_by_score_t& lookup = m_blobs.get<1>();
   blob_by_score_t::iterator i = lookup.begin();
-  if (i == lookup.end() || !i->can_write())
-    return locked_add_blob();
+  if (i != lookup.end() && i->can_write()) {
+    VW_ASSERT(!i->locked, LogicErr() << "Tried to lock an already-locked blob");
+    blob_id = i->id;
+    lookup.modify(i, BlobKey::SetLock(owner));
+  }
+  else if (!locked_take_idle(owner, blob_id))
+    blob_id = locked_add_blob(owner);
 
-  VW_ASSERT(!i->locked, LogicErr() << "Tried to lock an already-locked blob");
-  lookup.modify(i, BlobKey::SetLock(true));
+  if (!owner.empty())
+    m_affinity[owner] = blob_id;
+  return blob_id;
+}
+
+bool BlobManager::locked_take_idle(const std::string& owner, uint32& blob_id) {
+  uint64 now = Stopwatch::microtime();
+  blob_by_id_t& by_id = m_blobs.get<0>();
+  blob_by_id_t::iterator best = by_id.end();
 
-  return i->id;
+  for (blob_by_id_t::iterator i = by_id.begin(); i != by_id.end(); ++i) {
+    if (i->locked || i->full() || i->owner.empty() || now - i->released < BLOB_IDLE_OWNER_TIMEOUT)
+      continue;
+    if (best == by_id.end() || i->size > best->size)
+      best = i;
+  }
+  if (best == by_id.end())
+    return false;
+
+  WHEREAMI << "taking idle blob " << best->id << " from " << best->owner << std::endl;
+  m_affinity.erase(best->owner);
+  blob_id = best->id;
+  by_id.modify(best, BlobKey::SetLock(owner));
+  return true;
 }
 
-uint32 BlobManager::locked_add_blob() {
+uint32 BlobManager::locked_add_blob(const std::string& owner) {
   WHEREAMI << std::endl;
 
   uint32 next_id = 0;
@@ -87,26 +150,29 @@ uint32 BlobManager::locked_add_blob() {
   if (i != lookup.rend())
     next_id = i->id + 1;
 
-  std::pair<blob_tracker_t::iterator, bool> ret = m_blobs.insert(BlobKey(0, next_id, true));
+  std::pair<blob_tracker_t::iterator, bool> ret = m_blobs.insert(BlobKey(0, next_id, true, owner));
   VW_ASSERT(ret.second, LogicErr() << "Failed to add blob " << next_id);
   return next_id;
 }
 
 void BlobManager::release_lock(uint32 blob_id) {
   WHEREAMI << "release " << blob_id << std::endl;
-  Mutex::Lock lock(m_mutex);
-  blob_by_id_t& lookup = m_blobs.get<0>();
-  blob_by_id_t::iterator i = lookup.find(blob_id);
-  VW_ASSERT(i != lookup.end(), ArgumentErr() << "No such blob id " << blob_id);
-  VW_ASSERT(i->locked, LogicErr() << "Tried to unlock already-unlocked blob");
 
+  // The blob is still ours, so nobody else is writing it and its size can
+  // be found before taking the lock.
   std::string fn = name_from_id(blob_id);
 
   uint64 size = 0;
   if (fs::exists(fn))
     size = fs::file_size(fn);
 
-  lookup.modify(i, BlobKey::SetUnlockSize(size));
+  Mutex::Lock lock(m_mutex);
+  blob_by_id_t& lookup = m_blobs.get<0>();
+  blob_by_id_t::iterator i = lookup.find(blob_id);
+  VW_ASSERT(i != lookup.end(), ArgumentErr() << "No such blob id " << blob_id);
+  VW_ASSERT(i->locked, LogicErr() << "Tried to unlock already-unlocked blob");
+
+  lookup.modify(i, BlobKey::SetUnlockSize(size, Stopwatch::microtime()));
 }
 
 BlobManager::BlobManager(const std::string& directory)
@@ -15,6 +15,8 @@
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 #include <boost/multi_index/member.hpp>
+#include <map>
+#include <string>
 
 namespace vw {
 namespace platefile {
@@ -25,6 +27,12 @@ namespace platefile {
   // locking/unlocking of blobs, and can load balance blobs writes by
   // alternating which blob is offered up for writing data.
   //
+  // A writer that gives its name when it asks for a lock owns the blob it
+  // gets: it keeps getting the same blob back until the blob fills up, and
+  // nobody else is offered the blob in the meantime (unless the owner has
+  // left it alone for a long while). Many writers then each keep appending
+  // to their own blob instead of trading blobs between them.
+  //
   // The BlobManager is thread safe.
   class BlobManager {
 
@@ -33,22 +41,32 @@ namespace platefile {
       uint64 size;
       uint32 id;
       bool locked;
+      std::string owner;  // the writer this blob is kept for, if any
+      uint64 released;    // when it was last unlocked (Stopwatch::microtime)
 
-      BlobKey(uint64 size, uint32 id, bool locked) : size(size), id(id), locked(locked) {}
+      BlobKey(uint64 size, uint32 id, bool locked, const std::string& owner = std::string())
+        : size(size), id(id), locked(locked), owner(owner), released(0) {}
 
+      // The score orders blobs for writers without one of their own; blobs
+      // that are owned score as if they were locked.
       uint64 score() const;
       bool can_write() const;
+      bool full() const;
 
       struct SetLock {
-        bool lock;
-        SetLock(bool lock) : lock(lock) {}
-        void operator()(BlobKey& k) {k.locked = lock;}
+        std::string owner;
+        SetLock(const std::string& owner) : owner(owner) {}
+        void operator()(BlobKey& k) {k.locked = true; k.owner = owner;}
       };
 
       struct SetUnlockSize {
-        uint64 size;
-        SetUnlockSize(uint64 size) : size(size) {}
-        void operator()(BlobKey& k) {k.size = size; k.locked = false;}
+        uint64 size, now;
+        SetUnlockSize(uint64 size, uint64 now) : size(size), now(now) {}
+        void operator()(BlobKey& k) {k.size = size; k.locked = false; k.released = now;}
+      };
+
+      struct ClearOwner {
+        void operator()(BlobKey& k) {k.owner.clear();}
       };
     };
 
@@ -63,11 +81,15 @@ namespace platefile {
     typedef blob_tracker_t::nth_index<0>::type blob_by_id_t;
     typedef blob_tracker_t::nth_index<1>::type blob_by_score_t;
 
+    typedef std::map<std::string, uint32> affinity_t;
+
     mutable vw::Mutex m_mutex;
     std::string m_directory;
     blob_tracker_t m_blobs;
+    affinity_t m_affinity;
 
-    uint32 locked_add_blob();
+    uint32 locked_add_blob(const std::string& owner);
+    bool locked_take_idle(const std::string& owner, uint32& blob_id);
 
   public:
 
@@ -81,8 +103,10 @@ namespace platefile {
     BlobManager(const std::string& directory);
 
     // Request a blob to write to that has sufficient space. Returns the blob
-    // index of a locked blob that you have sole access to write to.
-    uint32 request_lock();
+    // index of a locked blob that you have sole access to write to. A
+    // writer that names itself gets the blob it had last time, if that
+    // still has space.
+    uint32 request_lock(const std::string& writer = std::string());
 
     // Given a blob id, return the filename of the corresponding blob
     std::string name_from_id(uint32 blob_id) const;
@@ -81,10 +81,20 @@ class Datastore {
     // not guaranteed, either.
     virtual TileSearch& populate(TileSearch& hdrs) = 0;
 
+    // Start loading, in the background, whatever head() and populate() will
+    // need for this region of a level (for a Blobstore, its index pages), so
+    // reads there soon after don't wait for it. This is only a hint; by
+    // default it does nothing.
+    virtual void prefetch(uint32 /*level*/, const BBox2u& /*region*/) {}
+
     // TILE WRITE
     virtual WriteState* write_request(const Transaction& id) VW_WARN_UNUSED = 0;
     virtual void write_update(WriteState& state, uint32 level, uint32 row, uint32 col, const std::string& filetype, const uint8* data, uint64 size) = 0;
     virtual void write_complete(WriteState& id) = 0;
+    // Make the tiles written so far with this state visible to readers,
+    // if the datastore holds them back to write them together. By default
+    // they already are.
+    virtual void commit(WriteState& /*state*/) {}
     virtual void flush() = 0;
 
 
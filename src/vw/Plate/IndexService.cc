@@ -54,6 +54,7 @@ IndexServiceImpl::IndexServiceRecord* IndexServiceImpl::add_index( std::string p
   rec.short_plate_filename = plate_filename;
   rec.full_plate_filename = m_root_directory + "/" + plate_filename;
   rec.index = index;
+  rec.mutex.reset(new mutex_t());
 
   uint32 id = index->index_header().platefile_id();
   VW_ASSERT(m_indices.count(id) == 0,
@@ -110,6 +111,7 @@ void IndexServiceImpl::sync() {
   read_lock_t rolock(m_mutex);
   BOOST_FOREACH(index_list_type::value_type& i, m_indices) {
     vw_out() << "\t--> Syncing index for " << i.second.short_plate_filename << " to disk.\n";
+    write_lock_t platelock(*i.second.mutex);
     i.second.index->sync();
   }
 }
@@ -123,12 +125,17 @@ void IndexServiceImpl::sync() {
   detail::RequireCall call(done);\
   locktype thelock(m_mutex);
 
+// Lock one platefile's index, for reading or for changing it
+#define PLATE_LOCK(locktype, rec) \
+  locktype platelock(*(rec).mutex);
+
 METHOD_IMPL(OpenRequest, IndexOpenRequest, IndexOpenReply) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord *r = find_name(request->plate_name());
 
   if (!r)
     vw_throw(InvalidPlatefileErr() << "No platefile matching this platename found: " << request->plate_name());
+  PLATE_LOCK(read_lock_t, *r);
 
   response->set_short_plate_filename( r->short_plate_filename );
   response->set_full_plate_filename( r->full_plate_filename );
@@ -177,6 +184,7 @@ METHOD_IMPL(CreateRequest, IndexCreateRequest, IndexOpenReply) {
 METHOD_IMPL(InfoRequest, IndexInfoRequest, IndexInfoReply) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
+  PLATE_LOCK(read_lock_t, rec);
 
   response->set_short_plate_filename(rec.short_plate_filename);
   response->set_full_plate_filename(rec.full_plate_filename);
@@ -188,6 +196,7 @@ METHOD_IMPL(ListRequest, IndexListRequest, IndexListReply) {
   for (index_list_type::const_iterator i = m_indices.begin(), end = m_indices.end(); i != end; ++i) {
 
     IndexServiceRecord rec = i->second;
+    PLATE_LOCK(read_lock_t, rec);
 
 #define should_filter_out(field) \
     request->has_ ## field() && rec.index->index_header().has_ ## field() && request->field() != rec.index->index_header().field()
@@ -212,18 +221,42 @@ METHOD_IMPL(ListRequest, IndexListRequest, IndexListReply) {
 METHOD_IMPL(PageRequest, IndexPageRequest, IndexPageReply) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
+  PLATE_LOCK(read_lock_t, rec);
 
   boost::shared_ptr<IndexPage> page =
     rec.index->page_request(request->col(), request->row(), request->level());
 
   std::ostringstream ostr;
-  page->serialize(ostr);
+  page->serialize(ostr, request->page_version());
   response->set_page_bytes(ostr.str().c_str(), ostr.str().size());
 }
 
+METHOD_IMPL(MultiPageRequest, IndexMultiPageRequest, IndexMultiPageReply) {
+  METHOD_BOILERPLATE(read_lock_t);
+
+  BOOST_FOREACH(const IndexPageRequest& page_request, request->page_requests()) {
+    IndexServiceRecord rec = find_id_throw(page_request.platefile_id());
+    PLATE_LOCK(read_lock_t, rec);
+    IndexPageReply* reply = response->add_pages();
+
+    boost::shared_ptr<IndexPage> page;
+    try {
+      page = rec.index->page_request(page_request.col(), page_request.row(), page_request.level());
+    } catch (const TileNotFoundErr&) {
+      reply->set_page_bytes("");
+      continue;
+    }
+
+    std::ostringstream ostr;
+    page->serialize(ostr, page_request.page_version());
+    reply->set_page_bytes(ostr.str().c_str(), ostr.str().size());
+  }
+}
+
 METHOD_IMPL(ReadRequest, IndexReadRequest, IndexReadReply) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
+  PLATE_LOCK(read_lock_t, rec);
 
   *(response->mutable_index_record()) =
     rec.index->read_request(request->col(), request->row(), request->level(),
@@ -233,36 +266,49 @@ METHOD_IMPL(ReadRequest, IndexReadRequest, IndexReadReply) {
 METHOD_IMPL(WriteRequest, IndexWriteRequest, IndexWriteReply) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
+  PLATE_LOCK(write_lock_t, rec);
 
-  uint32 blob_id = rec.index->write_request();
+  uint32 blob_id = rec.index->write_request(request->writer());
   response->set_blob_id(blob_id);
 }
 
 METHOD_IMPL_NOREPLY(WriteUpdate, IndexWriteUpdate) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
+  PLATE_LOCK(write_lock_t, rec);
   rec.index->write_update(request->header(), request->record());
 }
 
 METHOD_IMPL_NOREPLY(MultiWriteUpdate, IndexMultiWriteUpdate) {
   METHOD_BOILERPLATE(read_lock_t);
-  // MultiWrite updates are packetized.  We iterate over them here.
-  for (int i = 0; i < request->write_updates().size(); ++i) {
-    IndexWriteUpdate update = request->write_updates().Get(i);
-    IndexServiceRecord rec = find_id_throw(update.platefile_id());
-    rec.index->write_update(update.header(), update.record());
+  // MultiWrite updates are packetized, and a bulk writer's hold a whole
+  // manifest.  Each run of updates to one plate goes to its index
+  // together, which merges them into its pages a page at a time.
+  const int size = request->write_updates().size();
+  for (int i = 0; i < size;) {
+    const int32 platefile_id = request->write_updates(i).platefile_id();
+    std::vector<Index::WriteUpdate> updates;
+    for (; i < size && request->write_updates(i).platefile_id() == platefile_id; ++i) {
+      const IndexWriteUpdate& update = request->write_updates(i);
+      updates.push_back(std::make_pair(update.header(), update.record()));
+    }
+    IndexServiceRecord rec = find_id_throw(platefile_id);
+    PLATE_LOCK(write_lock_t, rec);
+    rec.index->write_updates(updates);
   }
 }
 
 METHOD_IMPL_NOREPLY(WriteComplete, IndexWriteComplete) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
+  PLATE_LOCK(write_lock_t, rec);
   rec.index->write_complete(request->blob_id());
 }
 
 METHOD_IMPL(TransactionRequest, IndexTransactionRequest, IndexTransactionReply) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
+  PLATE_LOCK(write_lock_t, rec);
   Transaction transaction_id =
     rec.index->transaction_request(request->description(), request->transaction_id_override());
   response->set_transaction_id(transaction_id);
@@ -271,18 +317,21 @@ METHOD_IMPL(TransactionRequest, IndexTransactionRequest, IndexTransactionReply)
 METHOD_IMPL_NOREPLY(TransactionComplete, IndexTransactionComplete) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
+  PLATE_LOCK(write_lock_t, rec);
   rec.index->transaction_complete(request->transaction_id(), request->update_read_cursor());
 }
 
 METHOD_IMPL_NOREPLY(TransactionFailed, IndexTransactionFailed) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
+  PLATE_LOCK(write_lock_t, rec);
   rec.index->transaction_failed(request->transaction_id());
 }
 
 METHOD_IMPL(TransactionCursor, IndexTransactionCursorRequest, IndexTransactionCursorReply) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
+  PLATE_LOCK(read_lock_t, rec);
   Transaction transaction_id = rec.index->transaction_cursor();
   response->set_transaction_id(transaction_id);
 }
@@ -290,12 +339,14 @@ METHOD_IMPL(TransactionCursor, IndexTransactionCursorRequest, IndexTransactionCu
 METHOD_IMPL(NumLevelsRequest, IndexNumLevelsRequest, IndexNumLevelsReply) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
+  PLATE_LOCK(read_lock_t, rec);
   response->set_num_levels(rec.index->num_levels());
 }
 
 METHOD_IMPL_NOREPLY(LogRequest, IndexLogRequest) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
+  PLATE_LOCK(write_lock_t, rec);
   rec.index->log() << request->message();
 }
 
@@ -19,20 +19,25 @@ namespace platefile {
     class Index;
   }
 
+  // The service may be called from several threads at once. m_mutex guards
+  // the list of platefiles, and each platefile has a mutex of its own:
+  // requests that read a platefile's index run together, and the ones that
+  // change it run one at a time.
   class IndexServiceImpl : public IndexService {
 
+    typedef boost::shared_mutex mutex_t;
+    typedef boost::shared_lock<mutex_t> read_lock_t;
+    typedef boost::unique_lock<mutex_t> write_lock_t;
+
     struct IndexServiceRecord {
       std::string short_plate_filename;
       std::string full_plate_filename;
       boost::shared_ptr<detail::Index> index;
+      boost::shared_ptr<mutex_t> mutex;
     };
 
     std::string m_root_directory;
 
-    typedef boost::shared_mutex mutex_t;
-    typedef boost::shared_lock<mutex_t> read_lock_t;
-    typedef boost::unique_lock<mutex_t> write_lock_t;
-
     typedef std::map<int32, IndexServiceRecord> index_list_type;
     index_list_type m_indices;
     mutable mutex_t m_mutex;
@@ -76,6 +81,12 @@ namespace platefile {
                              IndexPageReply* response,
                              ::google::protobuf::Closure* done);
 
+    // Like PageRequest, but for many pages at once.
+    virtual void MultiPageRequest(::google::protobuf::RpcController* controller,
+                                  const IndexMultiPageRequest* request,
+                                  IndexMultiPageReply* response,
+                                  ::google::protobuf::Closure* done);
+
     virtual void ReadRequest(::google::protobuf::RpcController* controller,
                              const IndexReadRequest* request,
                              IndexReadReply* response,
@@ -11,6 +11,7 @@
 #include <vw/Core/Settings.h>
 #include <vw/Core/Debugging.h>
 #include <boost/iostreams/tee.hpp>
+#include <boost/foreach.hpp>
 
 using namespace vw::platefile;
 using namespace vw;
@@ -32,14 +33,14 @@ namespace {
 }
 
 ReadOnlyPlateFile::ReadOnlyPlateFile(const Url& url)
-  : m_data(Datastore::open(url))
+  : m_data(Datastore::open(url)), m_tile_cache(0)
 {
   vw_out(DebugMessage, "platefile") << "Re-opened plate file: \"" << url.string() << "\"\n";
 }
 
 ReadOnlyPlateFile::ReadOnlyPlateFile(const Url& url, std::string type, std::string description, uint32 tile_size, std::string tile_filetype,
                      PixelFormatEnum pixel_format, ChannelTypeEnum channel_type)
-  : m_data(Datastore::open(url, make_hdr(type, description, tile_size, tile_filetype, pixel_format, channel_type)))
+  : m_data(Datastore::open(url, make_hdr(type, description, tile_size, tile_filetype, pixel_format, channel_type))), m_tile_cache(0)
 {
   vw_out(DebugMessage, "platefile") << "Constructed new platefile: " << url.string() << "\n";
 }
@@ -63,7 +64,12 @@ ChannelTypeEnum ReadOnlyPlateFile::channel_type() const { return m_data->channel
 
 uint32 ReadOnlyPlateFile::num_levels() const { return m_data->num_levels(); }
 
-void PlateFile::sync() const { m_data->flush(); }
+void PlateFile::sync() const {
+  // Tiles written so far are visible to searches after a sync
+  if (m_write_state)
+    m_data->commit(*m_write_state);
+  m_data->flush();
+}
 
 void PlateFile::log(std::string message) { m_data->audit_log()() << message; }
 
@@ -98,6 +104,16 @@ ReadOnlyPlateFile::read(int col, int row, int level, TransactionOrNeg transactio
   return std::make_pair(hits.begin()->hdr, hits.begin()->data);
 }
 
+TileHeader
+ReadOnlyPlateFile::locate(int col, int row, int level, TransactionOrNeg transaction_id, bool exact_transaction_match) const {
+  TransactionRange range(exact_transaction_match ? transaction_id : 0, transaction_id);
+  Datastore::TileSearch hits;
+  m_data->head(hits, level, row, col, range, 1);
+  if (hits.size() == 0)
+    vw_throw(TileNotFoundErr() << "No tiles found.");
+  return hits.begin()->hdr;
+}
+
 Datastore::TileSearch&
 ReadOnlyPlateFile::batch_read(Datastore::TileSearch& hdrs) const {
   return m_data->populate(hdrs);
@@ -135,6 +151,11 @@ void PlateFile::write_complete() {
   VW_ASSERT(m_write_state, LogicErr() << "Must start a transaction before completing it");
   m_data->write_complete(*m_write_state);
   m_write_state.reset();
+  if (m_tile_cache) {
+    BOOST_FOREACH(const TileHeader& hdr, m_written)
+      m_tile_cache->forget(m_data->id(), hdr.level(), hdr.col(), hdr.row(), *m_transaction);
+  }
+  m_written.clear();
 }
 
 void PlateFile::write_update(const uint8* data, uint64 data_size, int col, int row, int level, const std::string& type_) {
@@ -149,6 +170,14 @@ void PlateFile::write_update(const uint8* data, uint64 data_size, int col, int r
     vw_throw(NoImplErr() << "write_update() does not support filetype 'auto'");
 
   m_data->write_update(*m_write_state, level, row, col, type, data, data_size);
+  if (m_tile_cache) {
+    m_tile_cache->forget(m_data->id(), level, col, row, *m_transaction);
+    TileHeader hdr;
+    hdr.set_col(col);
+    hdr.set_row(row);
+    hdr.set_level(level);
+    m_written.push_back(hdr);
+  }
 }
 
 std::list<TileHeader>
@@ -160,6 +189,15 @@ ReadOnlyPlateFile::search_by_region(int level, vw::BBox2i const& region, const T
   return tiles;
 }
 
+void ReadOnlyPlateFile::prefetch(int level, vw::BBox2i const& region) const {
+  if (level < 0)
+    return;
+  BBox2i r(region);
+  r.crop(BBox2i(0, 0, 1 << level, 1 << level));
+  if (!r.empty())
+    m_data->prefetch(level, r);
+}
+
 std::list<TileHeader>
 ReadOnlyPlateFile::search_by_location(int col, int row, int level, const TransactionRange& range) {
   Datastore::TileSearch r;
@@ -99,6 +99,7 @@
 #include <vw/Plate/Blob.h>
 #include <vw/Plate/Exception.h>
 #include <vw/Plate/HTTPUtils.h>
+#include <vw/Plate/TileCache.h>
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/FileIO/MemoryImageResource.h>
 
@@ -113,6 +114,11 @@ namespace platefile {
   class ReadOnlyPlateFile {
     protected:
       boost::shared_ptr<Datastore> m_data;
+      TileCache* m_tile_cache;
+
+      /// The header of the tile read() would read.
+      TileHeader locate(int col, int row, int level, TransactionOrNeg transaction_id, bool exact_transaction_match) const;
+
       ReadOnlyPlateFile(const Url& url, std::string type, std::string description, uint32 tile_size, std::string tile_filetype, PixelFormatEnum pixel_format, ChannelTypeEnum channel_type);
 
     public:
@@ -128,6 +134,13 @@ namespace platefile {
       ChannelTypeEnum channel_type() const;
       uint32 num_levels() const;
 
+      /// Keep the tiles decoded by read(view, ...) in the cache, usually
+      /// plate_tile_cache() to share them with the process's other plate
+      /// readers, or no cache if NULL (the default).  Tiles written
+      /// through this PlateFile are dropped from it.
+      void set_tile_cache(TileCache* cache) { m_tile_cache = cache; }
+      TileCache* tile_cache() const { return m_tile_cache; }
+
       /// Read data directly to a file on disk. You supply a base name
       /// (without the file's image extension).  The image extension
       /// will be appended automatically for you based on the filetype
@@ -157,6 +170,11 @@ namespace platefile {
       template <class ViewT>
       TileHeader read(ViewT &view, int col, int row, int level,
                       TransactionOrNeg transaction_id, bool exact_transaction_match = false) const {
+        if (m_tile_cache) {
+          TileHeader hdr = this->locate(col, row, level, transaction_id, exact_transaction_match);
+          view = m_tile_cache->get<typename ViewT::pixel_type>(m_data, hdr);
+          return hdr;
+        }
 
         std::pair<TileHeader, TileData> ret = this->read(col, row, level, transaction_id, exact_transaction_match);
         boost::scoped_ptr<SrcImageResource> r(SrcMemoryImageResource::open(ret.first.filetype(), &ret.second->operator[](0), ret.second->size()));
@@ -170,6 +188,16 @@ namespace platefile {
       /// Note: the region is EXCLUSIVE: i.e. BBox2i(0,0,1,1) does not include the point (1,1)
       std::list<TileHeader> search_by_region(int level, vw::BBox2i const& region, const TransactionRange& range) const;
 
+      /// Start loading the index pages for a region of a level in the
+      /// background, and return at once, so that searches and reads
+      /// there soon after find them already loaded.  Readers sweeping a
+      /// plate in order can prefetch the next region while working on
+      /// this one.  Only as many pages as the index caches are loaded
+      /// at a time, so prefetch a region about the size of the next
+      /// unit of work.  This is meant for reading plates that are not
+      /// being written through the same PlateFile.
+      void prefetch(int level, vw::BBox2i const& region) const;
+
       /// Read one ore more images at a specified location in the
       /// platefile by specifying a range of transaction ids of
       /// interest.  This range is inclusive at both ends.
@@ -180,6 +208,10 @@ namespace platefile {
   class PlateFile : public ReadOnlyPlateFile {
       boost::shared_ptr<Transaction> m_transaction;
       boost::shared_ptr<WriteState> m_write_state;
+      // Tiles written since write_request(), to drop from the tile cache
+      // again once the index has them: a reader may have cached the old
+      // tile in between.
+      std::vector<TileHeader> m_written;
     public:
       PlateFile(const Url& url);
 
@@ -187,6 +219,8 @@ namespace platefile {
                 uint32 tile_size, std::string tile_filetype,
                 PixelFormatEnum pixel_format, ChannelTypeEnum channel_type);
 
+      /// Save the index, first making the tiles written so far in the
+      /// current write visible to searches.
       void sync() const;
 
       std::ostream& audit_log();
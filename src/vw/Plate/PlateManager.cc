@@ -11,6 +11,9 @@
 #include <vw/Plate/PolarStereoPlateManager.h>
 #include <vw/Plate/ToastPlateManager.h>
 #include <vw/Plate/detail/MipmapHelpers.h>
+#include <vw/Plate/detail/TilePool.h>
+
+#include <boost/noncopyable.hpp>
 
 using namespace vw;
 using namespace vw::platefile;
@@ -210,13 +213,68 @@ uint32 approximate_total_tiles(const BBox2i& region, uint32 bottom_tile_count) {
   return bottom_tile_count / (1-r);
 }
 
+template <typename PixelT>
+class DecodeTileTask : public Task, private boost::noncopyable {
+    d::TilePool& m_pool;
+    Tile m_tile;
+    ImageView<PixelT>& m_image;
+  public:
+    DecodeTileTask(d::TilePool& pool, const Tile& tile, ImageView<PixelT>& image)
+      : m_pool(pool), m_tile(tile), m_image(image) {}
+
+    void operator()() {
+      try {
+        boost::scoped_ptr<SrcImageResource> r(SrcMemoryImageResource::open(m_tile.hdr.filetype(), &m_tile.data->operator[](0), m_tile.data->size()));
+        read_image(m_image, *r);
+      } catch (const std::exception& e) {
+        m_pool.failed(e.what());
+      }
+    }
+};
+
+template <typename PixelT>
+class BuildTileTask : public Task, private boost::noncopyable {
+    typedef ImageView<PixelT> image_t;
+    d::TilePool& m_pool;
+    d::rowcol_t m_tile;
+    uint32 m_level;
+    bool m_preblur;
+    image_t m_children[4];
+    boost::shared_ptr<image_t> m_image;
+    const d::RememberCallback& m_pc;
+  public:
+    BuildTileTask(d::TilePool& pool, const d::rowcol_t& tile, uint32 level, bool preblur,
+                  const std::map<uint32, image_t>& children, boost::shared_ptr<image_t> image,
+                  const d::RememberCallback& pc)
+      : m_pool(pool), m_tile(tile), m_level(level), m_preblur(preblur), m_image(image), m_pc(pc) {
+      typedef typename std::map<uint32, image_t>::value_type child_t;
+      BOOST_FOREACH(const child_t& c, children)
+        m_children[c.first] = c.second;
+    }
+
+    void operator()() {
+      try {
+        mipmap_one_tile(*m_image, m_pool.tile_size, m_children[0], m_children[1], m_children[2], m_children[3], m_preblur);
+        m_pool.write(*m_image, d::thecol(m_tile), d::therow(m_tile), m_level, m_pc);
+      } catch (const std::exception& e) {
+        m_pool.failed(e.what());
+      }
+    }
+};
+
 template <typename PixelT>
 void cache_consume_tiles(PlateFile& plate, Datastore::TileSearch& headers, tile_cache_t<PixelT>& cache) {
-  BOOST_FOREACH(const Tile& t, plate.batch_read(headers)) {
-    ImageView<PixelT>& image = cache[d::rowcol_t(t.hdr.row(), t.hdr.col())];
-    boost::scoped_ptr<SrcImageResource> r(SrcMemoryImageResource::open(t.hdr.filetype(), &t.data->operator[](0), t.data->size()));
-    read_image(image, *r);
-  }
+  // Like the cache itself, keep only the last tile read for each location
+  std::map<d::rowcol_t, Tile> tiles;
+  BOOST_FOREACH(const Tile& t, plate.batch_read(headers))
+    tiles[d::rowcol_t(t.hdr.row(), t.hdr.col())] = t;
+
+  // The cache entries are made here, so the tasks only fill them in
+  d::TilePool pool(plate);
+  typedef std::map<d::rowcol_t, Tile>::value_type tile_t;
+  BOOST_FOREACH(const tile_t& t, tiles)
+    pool.add(new DecodeTileTask<PixelT>(pool, t.second, cache[t.first]));
+  pool.join();
   headers.clear();
 }
 
@@ -226,6 +284,8 @@ void build_tiles(PlateFile& plate, const CompositeT& output_hdrs, const tile_cac
   typedef typename CompositeT::mapped_type VectorT;
   typedef typename     VectorT::value_type HeaderT;
 
+  d::TilePool pool(plate);
+
   // build the new tiles
   BOOST_FOREACH(const typename CompositeT::value_type& v, output_hdrs) {
     const d::rowcol_t& parent = v.first;
@@ -247,10 +307,9 @@ void build_tiles(PlateFile& plate, const CompositeT& output_hdrs, const tile_cac
     else
       new_image.reset(new image_t());
 
-    mipmap_one_tile(*new_image, plate.default_tile_size(), c[0], c[1], c[2], c[3], preblur);
-    plate.write_update(*new_image, d::thecol(parent), d::therow(parent), level);
-    pc.tick();
+    pool.add(new BuildTileTask<PixelT>(pool, parent, level, preblur, c, new_image, pc));
   }
+  pool.join();
 }
 }
 
@@ -370,6 +429,52 @@ void PlateManager<PixelT>::mipmap(uint32 starting_level, BBox2i const& starting_
   progress_callback.report_finished();
 }
 
+template <class PixelT>
+void PlateManager<PixelT>::mipmap(uint32 starting_level, TileLocations const& changed,
+                                  TransactionOrNeg read_transaction_id,
+                                  bool preblur,
+                                  const ProgressCallback &progress_callback,
+                                  uint32 stopping_level ) const
+{
+  typedef TileLocations::value_type loc_t;
+  TileLocations dirty(changed);
+
+  for (int32 output_level = starting_level-1; output_level >= int32(stopping_level) && !dirty.empty(); --output_level)
+  {
+    // The parents of the changed tiles, which are all that need rebuilding
+    TileLocations parents;
+    BBox2i region;
+    BOOST_FOREACH(const loc_t& t, dirty) {
+      parents.insert(std::make_pair(t.first/2, t.second/2));
+      region.grow(Vector2i(t.first/2*2,   t.second/2*2));
+      region.grow(Vector2i(t.first/2*2+2, t.second/2*2+2));
+    }
+
+    // Fetch all their children, changed or not, since each parent is built
+    // from all four
+    std::list<TileHeader> hdrs = m_platefile->search_by_region(output_level+1, region, read_transaction_id);
+    std::list<TileHeader>::iterator i = hdrs.begin();
+    while (i != hdrs.end()) {
+      if (parents.count(std::make_pair(int32(i->col()/2), int32(i->row()/2))))
+        ++i;
+      else
+        i = hdrs.erase(i);
+    }
+
+    vw_out(VerboseDebugMessage, "platefile") << "\nDIRTY_MIPMAP, level " << output_level << ", " << dirty.size() << " changed tiles, " << parents.size() << " parents" << std::endl;
+
+    // A parent is only written if it has a child to build it from
+    dirty.clear();
+    BOOST_FOREACH(const TileHeader& hdr, hdrs)
+      dirty.insert(std::make_pair(int32(hdr.col()/2), int32(hdr.row()/2)));
+
+    if (!hdrs.empty())
+      slow_mipmap(output_level, hdrs, preblur, d::RememberCallback(progress_callback, float(1)/starting_level, hdrs.size()));
+  }
+
+  progress_callback.report_finished();
+}
+
 template <class PixelT>
 PlateManager<PixelT>*
 PlateManager<PixelT>::make( std::string const& mode,
@@ -399,6 +504,13 @@ namespace platefile {
                                 const ProgressCallback &progress_callback,     \
                                 uint32 stopping_level ) const;                 \
   template void                                                                \
+  PlateManager<PIXELT >::mipmap(uint32 starting_level,                         \
+                                TileLocations const& changed,                  \
+                                TransactionOrNeg transaction_id,               \
+                                bool preblur,                                  \
+                                const ProgressCallback &progress_callback,     \
+                                uint32 stopping_level ) const;                 \
+  template void                                                                \
   PlateManager<PIXELT >::affected_tiles(BBox2i const& image_size,              \
                                         TransformRef const& tx, int tile_size, \
                                         int level, std::list<TileInfo>& tiles ) const; \
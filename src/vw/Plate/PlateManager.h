@@ -14,6 +14,7 @@
 #include <vw/Image/Transform.h>
 #include <vw/Image/Filter.h>
 #include <boost/foreach.hpp>
+#include <set>
 
 namespace vw {
 
@@ -36,6 +37,9 @@ namespace platefile {
     TileInfo(int i, int j, BBox2i const& bbox) : i(i), j(j), bbox(bbox) {}
   };
 
+  // A set of tile locations at one level of the pyramid, as (col, row)
+  typedef std::set<std::pair<int32, int32> > TileLocations;
+
   // Functor for clamping alpha to channel range
   struct ClampAlpha : UnaryReturnSameType {
     template <class T>
@@ -84,6 +88,11 @@ namespace platefile {
     // output_transaction_id -- to use when writing
     virtual void mipmap(uint32 starting_level, BBox2i const& bbox, TransactionOrNeg input_transaction_id, bool preblur, const ProgressCallback &progress_callback = ProgressCallback::dummy_instance(), uint32 stopping_level=0) const;
 
+    // Like mipmap() above, but only regenerates the ancestors of the given
+    // tiles at starting_level (the ones that changed), instead of every tile
+    // over a region. Parents none of whose children exist are skipped.
+    void mipmap(uint32 starting_level, TileLocations const& changed, TransactionOrNeg input_transaction_id, bool preblur, const ProgressCallback &progress_callback = ProgressCallback::dummy_instance(), uint32 stopping_level=0) const;
+
     // Provides user a georeference for a particular level of the pyramid
     virtual cartography::GeoReference georeference( int level ) const = 0;
 
@@ -131,27 +140,30 @@ namespace platefile {
       // the two operations below.
       m_platefile->write_request();
 
-      // Add each tile
+      // Add each tile, keeping track of the ones that weren't empty
+      TileLocations written;
       progress.report_progress(0);
       BOOST_FOREACH( TileInfo const& tile, tiles ) {
         typedef WritePlateFileTask<ImageViewRef<typename ViewT::pixel_type> > Job;
 
-        boost::scoped_ptr<Task> task(
+        boost::scoped_ptr<Job> task(
           new Job(m_platefile,
                   tile, pyramid_level,
                   trans_view, false, boost::numeric_cast<int>(tiles_size), progress));
         (*task)();
+        if (task->written())
+          written.insert(std::make_pair(tile.i, tile.j));
       }
       progress.report_finished();
 
       // Sync the index
       m_platefile->sync();
 
-      // Mipmap the tiles.
-      if (pyramid_level > 0) {
+      // Mipmap the tiles that were written.
+      if (pyramid_level > 0 && !written.empty()) {
         std::ostringstream mipmap_str;
         mipmap_str << "\t--> Mipmapping from level " << pyramid_level << ": ";
-        this->mipmap(pyramid_level, BBox2i(affected_bbox.min(), affected_bbox.max()+Vector2i(1,1)), m_platefile->transaction_id(),
+        this->mipmap(pyramid_level, written, m_platefile->transaction_id(),
                      (!tweak_settings_for_terrain), // mipmap preblur = !tweak_settings_for_terrain
                      TerminalProgressCallback( "plate", mipmap_str.str()));
       }
@@ -178,6 +190,7 @@ namespace platefile {
     ViewT const& m_view;
     bool m_verbose;
     SubProgressCallback m_progress;
+    bool m_written;
 
   public:
     WritePlateFileTask(boost::shared_ptr<PlateFile> platefile,
@@ -186,9 +199,14 @@ namespace platefile {
                        bool verbose, int total_num_blocks,
                        const ProgressCallback &progress_callback = ProgressCallback::dummy_instance()) : m_platefile(platefile),
       m_tile_info(tile_info), m_level(level), m_view(view.impl()),
-      m_verbose(verbose), m_progress(progress_callback,0.0,1.0/float(total_num_blocks)) {}
+      m_verbose(verbose), m_progress(progress_callback,0.0,1.0/float(total_num_blocks)),
+      m_written(false) {}
 
     virtual ~WritePlateFileTask() {}
+
+    // Whether the tile had any data, and so was written to the platefile
+    bool written() const { return m_written; }
+
     virtual void operator() () {
       vw_out(DebugMessage, "platefile") << "\t    Generating tile: [ "
                                         << m_tile_info.i << " " << m_tile_info.j
@@ -243,6 +261,7 @@ namespace platefile {
       }
 
       //      m_platefile->write_complete();
+      m_written = true;
       m_progress.report_incremental_progress(1.0);
     }
   };
@@ -18,7 +18,8 @@ namespace vw {
 namespace platefile {
 
   /// An image view for accessing tiles from a plate file.  Tiles are
-  /// cached by this view to increase read speeds.
+  /// cached to increase read speeds: the view's plate file keeps them
+  /// in plate_tile_cache(), shared with the process's other readers.
   template <class PixelT>
   class PlateView : public ImageViewBase<PlateView<PixelT> > {
     boost::shared_ptr<ReadOnlyPlateFile> m_platefile;
@@ -34,13 +35,19 @@ namespace platefile {
       : m_platefile( new PlateFile(url) ),
         m_current_level(m_platefile->num_levels()-1),
         m_transaction_id(-1)
-    { }
+    {
+      m_platefile->set_tile_cache(&plate_tile_cache());
+    }
 
+    /// Turns on the plate's tile cache, if it has none.
     PlateView(boost::shared_ptr<PlateFile> plate)
       : m_platefile( plate ),
         m_current_level(m_platefile->num_levels()-1),
         m_transaction_id(-1)
-    { }
+    {
+      if (!m_platefile->tile_cache())
+        m_platefile->set_tile_cache(&plate_tile_cache());
+    }
 
     // Standard ImageView interface methods
     int32 cols() const {
@@ -65,13 +72,24 @@ namespace platefile {
 
     int num_levels() const { return m_platefile->num_levels(); }
 
-    std::list<TileHeader>
-    search_for_tiles( BBox2i image_bbox ) const {
+    // The tiles at the current level covering a region of the view
+    BBox2i tile_region( BBox2i image_bbox ) const {
       const float tile_size = m_platefile->default_tile_size();
       BBox2i query_region;
       query_region.min() = floor(Vector2f(image_bbox.min())/tile_size);
       query_region.max() = ceil(Vector2f(image_bbox.max())/tile_size);
-      return m_platefile->search_by_region(m_current_level, query_region, TransactionRange(m_transaction_id));
+      return query_region;
+    }
+
+    std::list<TileHeader>
+    search_for_tiles( BBox2i image_bbox ) const {
+      return m_platefile->search_by_region(m_current_level, tile_region(image_bbox), TransactionRange(m_transaction_id));
+    }
+
+    /// Start loading the index for a region of the view in the
+    /// background, ahead of rasterizing it.
+    void prefetch( BBox2i image_bbox ) const {
+      m_platefile->prefetch(m_current_level, tile_region(image_bbox));
     }
 
     inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
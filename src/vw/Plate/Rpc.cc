@@ -12,8 +12,11 @@
 #include <vw/Plate/Rpc.pb.h>
 #include <vw/Core/Log.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/Stopwatch.h>
 #include <google/protobuf/descriptor.h>
 #include <boost/scoped_ptr.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
 
 using namespace vw;
 using namespace vw::platefile;
@@ -29,6 +32,19 @@ void RpcBase::SetFailed(const std::string& /*reason*/) NOIMPL
 bool RpcBase::IsCanceled() const NOIMPL
 void RpcBase::NotifyOnCancel(::google::protobuf::Closure* /*callback*/) NOIMPL
 
+namespace {
+  // The stats key of the latency bucket a call of the method falls in
+  std::string latency_key(const std::string& method, uint64 us) {
+    static const uint64 MAX_MS = 1024;
+    uint64 ms = 1;
+    while (ms < MAX_MS && ms * 1000 < us)
+      ms *= 2;
+    if (ms * 1000 < us)
+      return (boost::format("latency.%s.gt%04dms") % method % MAX_MS).str();
+    return (boost::format("latency.%s.le%04dms") % method % ms).str();
+  }
+}
+
 class RpcServerBase::Task {
     RpcBase* m_rpc;
     const Url m_url;
@@ -73,6 +89,10 @@ void ThreadMap::Locked::clear() {
   m_map.m_data.clear();
 }
 
+const ThreadMap::map_t& ThreadMap::Locked::data() const {
+  return m_map.m_data;
+}
+
 void ThreadMap::add(const std::string& key, vw::int64 val) {
   Mutex::Lock lock(m_mutex);
   m_data[key] += val;
@@ -91,40 +111,50 @@ void ThreadMap::clear() {
   m_data.clear();
 }
 
-void RpcServerBase::launch_thread(const Url& url) {
-  m_task.reset(new Task(this, url, m_stats));
-  Mutex::Lock lock(m_task->mutex());
-  m_thread.reset(new Thread(m_task));
-  m_task->cond().wait(m_task->mutex());
+void RpcServerBase::launch_threads(const Url& url) {
+  const uint32 threads = url.query().get<uint32>("threads", 1);
+  VW_ASSERT(threads > 0, ArgumentErr() << "An RPC server needs at least one thread");
+
+  // Each thread binds its own channel, since channels have thread affinity
+  for (uint32 i = 0; i < threads; ++i) {
+    boost::shared_ptr<Task> task(new Task(this, url, m_stats));
+    Mutex::Lock lock(task->mutex());
+    m_tasks.push_back(task);
+    m_threads.push_back(boost::shared_ptr<Thread>(new Thread(task)));
+    task->cond().wait(task->mutex());
+    if (task->error())
+      break;
+  }
 }
 
 RpcServerBase::RpcServerBase(const Url& url) {
-  launch_thread(url);
+  launch_threads(url);
 }
 
 RpcServerBase::~RpcServerBase() {
   stop();
-  m_thread.reset();
-  m_task.reset();
+  m_threads.clear();
+  m_tasks.clear();
 }
 
 void RpcServerBase::stop() {
-  if (m_task)
-    m_task->stop();
-  if (m_thread)
-    m_thread->join();
+  BOOST_FOREACH(const boost::shared_ptr<Task>& task, m_tasks)
+    task->stop();
+  BOOST_FOREACH(const boost::shared_ptr<Thread>& thread, m_threads)
+    thread->join();
 }
 
 const char* RpcServerBase::error() const {
-  if (!m_task)
+  if (m_tasks.empty())
     return "Server message task is gone!";
-  if (!m_task->error())
-    return 0;
-  return m_task->error_msg().c_str();
+  BOOST_FOREACH(const boost::shared_ptr<Task>& task, m_tasks)
+    if (task->error())
+      return task->error_msg().c_str();
+  return 0;
 }
 
 void RpcServerBase::bind(const Url& url) {
-  launch_thread(url);
+  launch_threads(url);
 }
 
 ThreadMap::Locked RpcServerBase::stats() {
@@ -208,7 +238,9 @@ bool RpcServerBase::Task::handle_one_request() {
     a_wrap.set_seq(q_wrap.seq());
 
   try {
+    uint64 start = Stopwatch::microtime();
     m_rpc->service()->CallMethod(method, m_rpc, q.get(), a.get(), null_callback());
+    m_stats.add(latency_key(method->name(), Stopwatch::microtime() - start));
     a_wrap.set_payload(a->SerializeAsString());
     a_wrap.mutable_error()->set_code(RpcErrorMsg::SUCCESS);
     m_stats.add("msgs");
@@ -241,11 +273,11 @@ bool RpcServerBase::Task::handle_one_request() {
 
 // TODO: Make the clientname settable here.
 RpcClientBase::RpcClientBase(const Url& u)
-  : m_chan(IChannel::make_conn(u, u.string())) {}
+  : m_chan(ChannelPool::global().lease(u, u.string())) {}
 
 // TODO: Make the clientname settable here.
 RpcClientBase::RpcClientBase(const Url& u, int32 timeout, uint32 retries)
-  : m_chan(IChannel::make_conn(u, u.string())) {
+  : m_chan(ChannelPool::global().lease(u, u.string())) {
   m_chan->set_timeout(timeout);
   m_chan->set_retries(retries);
 }
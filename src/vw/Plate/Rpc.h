@@ -24,8 +24,9 @@ namespace platefile {
   }
 
   class ThreadMap : private boost::noncopyable {
-    private:
+    public:
       typedef std::map<std::string, int64> map_t;
+    private:
       map_t m_data;
       mutable Mutex m_mutex;
       friend class Locked;
@@ -40,6 +41,8 @@ namespace platefile {
           void add(const std::string& key, int64 val = 1);
           int64 get(const std::string& key) const;
           void clear();
+          // Everything counted so far (valid while this stays locked)
+          const map_t& data() const;
       };
 
       void add(const std::string& key, int64 val = 1);
@@ -73,14 +76,22 @@ namespace platefile {
       bool debug() const;
   };
 
+  // Serves requests on the url with one thread, or with several if the url
+  // has a threads=N query (as far as the channel allows it; see
+  // IChannel::bind). The service must be thread safe to use more than one.
+  //
+  // The stats count the messages handled, the errors, and for each method a
+  // histogram of how long the calls took: latency.<Method>.le<N>ms counts the
+  // calls that took at most N ms (N is a power of two, up to 1024), and
+  // latency.<Method>.gt1024ms the rest.
   class RpcServerBase : public RpcBase {
     private:
       class Task;
-      boost::shared_ptr<Task> m_task;
-      boost::shared_ptr<Thread> m_thread;
+      std::vector<boost::shared_ptr<Task> > m_tasks;
+      std::vector<boost::shared_ptr<Thread> > m_threads;
       ThreadMap m_stats;
 
-      void launch_thread(const Url& u);
+      void launch_threads(const Url& u);
 
     public:
       RpcServerBase() {}
@@ -96,6 +107,9 @@ namespace platefile {
       ThreadMap::Locked stats();
   };
 
+  // Clients lease their channel from ChannelPool::global(), and give it back
+  // when they go away, so the next client of the same server on this thread
+  // doesn't have to connect again.
   class RpcClientBase : public RpcBase {
     private:
       boost::shared_ptr<IChannel> m_chan;
@@ -125,7 +139,12 @@ namespace platefile {
       RpcServer(const Url& url, ServiceT* service)
         : RpcServerBase(url), m_service(service) {}
 
-      void bind(const Url& url, boost::shared_ptr<ServiceT> service);
+      // Shares ownership of service, which is in place before any
+      // request can arrive
+      void bind(const Url& url, boost::shared_ptr<ServiceT> service) {
+        m_service = service;
+        RpcServerBase::bind(url);
+      }
 
       ::google::protobuf::Service* service() {return m_service.get();}
       ServiceT* impl() {return m_service.get();}
@@ -18,10 +18,16 @@
 #endif
 
 #include <vw/Plate/HTTPUtils.h>
+#include <vw/Plate/Exception.h>
 #include <vw/Core/Stopwatch.h>
 #include <google/protobuf/descriptor.h>
 #include <boost/numeric/conversion/cast.hpp>
 #include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <map>
 
 namespace pb = ::google::protobuf;
 
@@ -121,4 +127,168 @@ uint32 IChannel::checksum(const RpcWrapper& message) {
   return sum;
 }
 
+namespace {
+  // Forwards to the channel it wraps, keeping track of whether the channel is
+  // still fit to hand to another client.
+  class PooledChannel : public IChannel {
+      boost::scoped_ptr<IChannel> m_chan;
+      const int32  m_timeout;
+      const uint32 m_retries;
+      bool m_failed;
+      bool m_pending;
+      uint64 m_idle_since;
+    public:
+      PooledChannel(IChannel* chan)
+        : m_chan(chan), m_timeout(chan->timeout()), m_retries(chan->retries()),
+          m_failed(false), m_pending(false), m_idle_since(0) {}
+
+      void send_bytes(const uint8* message, size_t len) {
+        m_pending = true;
+        m_chan->send_bytes(message, len);
+      }
+
+      bool recv_bytes(std::vector<uint8>* bytes) {
+        if (!m_chan->recv_bytes(bytes))
+          return false;
+        m_pending = false;
+        return true;
+      }
+
+      void CallMethod(const pb::MethodDescriptor* method, pb::RpcController* controller,
+                      const pb::Message* request, pb::Message* response, pb::Closure* done) {
+        try {
+          m_chan->CallMethod(method, controller, request, response, done);
+        } catch (const PlatefileErr&) {
+          // The server answered; it just didn't like the question
+          throw;
+        } catch (...) {
+          m_failed = true;
+          throw;
+        }
+      }
+
+      void set_timeout(int32 val)  { m_chan->set_timeout(val); }
+      void set_retries(uint32 r)   { m_chan->set_retries(r); }
+      int32  timeout() const       { return m_chan->timeout(); }
+      uint32 retries() const       { return m_chan->retries(); }
+      std::string name() const     { return m_chan->name(); }
+
+      void conn(const Url& /*server*/) {
+        vw_throw(LogicErr() << "A pooled channel is already connected");
+      }
+      void bind(const Url& /*self*/) {
+        vw_throw(LogicErr() << "A pooled channel cannot be bound");
+      }
+
+      bool healthy() const { return !m_failed && !m_pending; }
+
+      // Make it as it was when it was connected, and start its idle clock
+      void idle(uint64 now) {
+        m_chan->set_timeout(m_timeout);
+        m_chan->set_retries(m_retries);
+        m_idle_since = now;
+      }
+      uint64 idle_since() const { return m_idle_since; }
+  };
+
+  bool pooled(const Url& u) {
+    return u.scheme() != "zmq+inproc" && u.query().get<uint32>("pool", 1) != 0;
+  }
+}
+
+struct ChannelPool::Impl {
+  typedef std::pair<uint64, std::string> key_t;
+  typedef boost::shared_ptr<PooledChannel> chan_t;
+  typedef std::multimap<key_t, chan_t> idle_t;
+
+  idle_t idle;
+  uint32 max_idle;
+  mutable Mutex mutex;
+
+  Impl() : max_idle(DEFAULT_MAX_IDLE) {}
+
+  // Move the channels idle for longer than max_idle into expired, which the
+  // caller should drop once it lets go of the mutex (closing a channel can
+  // take a while).
+  void expire_locked(uint64 now, std::vector<chan_t>& expired) {
+    const uint64 limit = uint64(max_idle) * 1000;
+    for (idle_t::iterator i = idle.begin(); i != idle.end();) {
+      if (now > i->second->idle_since() + limit) {
+        expired.push_back(i->second);
+        idle.erase(i++);
+      } else
+        ++i;
+    }
+  }
+
+  // The deleter of a leased channel
+  static void give_back(boost::weak_ptr<Impl> pool, key_t key, chan_t chan, IChannel* /*lease*/) {
+    boost::shared_ptr<Impl> self = pool.lock();
+    if (!self || !chan->healthy())
+      return;
+    std::vector<chan_t> expired;
+    const uint64 now = Stopwatch::microtime();
+    chan->idle(now);
+    Mutex::Lock lock(self->mutex);
+    self->expire_locked(now, expired);
+    self->idle.insert(std::make_pair(key, chan));
+  }
+};
+
+ChannelPool::ChannelPool() : m_impl(new Impl()) {}
+
+ChannelPool::~ChannelPool() {}
+
+ChannelPool& ChannelPool::global() {
+  static ChannelPool pool;
+  return pool;
+}
+
+boost::shared_ptr<IChannel> ChannelPool::lease(const Url& url, const std::string& clientname) {
+  if (!pooled(url))
+    return boost::shared_ptr<IChannel>(IChannel::make_conn(url, clientname));
+
+  const Impl::key_t key(Thread::id(), url.string() + " " + clientname);
+  Impl::chan_t chan;
+  std::vector<Impl::chan_t> expired;
+  {
+    Mutex::Lock lock(m_impl->mutex);
+    m_impl->expire_locked(Stopwatch::microtime(), expired);
+    Impl::idle_t::iterator i = m_impl->idle.find(key);
+    if (i != m_impl->idle.end()) {
+      chan = i->second;
+      m_impl->idle.erase(i);
+    }
+  }
+
+  if (!chan)
+    chan.reset(new PooledChannel(IChannel::make_conn(url, clientname)));
+
+  return boost::shared_ptr<IChannel>(chan.get(),
+      boost::bind(&Impl::give_back, boost::weak_ptr<Impl>(m_impl), key, chan, _1));
+}
+
+void ChannelPool::set_max_idle(uint32 ms) {
+  std::vector<Impl::chan_t> expired;
+  Mutex::Lock lock(m_impl->mutex);
+  m_impl->max_idle = ms;
+  m_impl->expire_locked(Stopwatch::microtime(), expired);
+}
+
+uint32 ChannelPool::max_idle() const {
+  Mutex::Lock lock(m_impl->mutex);
+  return m_impl->max_idle;
+}
+
+size_t ChannelPool::idle() const {
+  Mutex::Lock lock(m_impl->mutex);
+  return m_impl->idle.size();
+}
+
+void ChannelPool::clear() {
+  Impl::idle_t idle;
+  Mutex::Lock lock(m_impl->mutex);
+  idle.swap(m_impl->idle);
+}
+
 }} // namespace vw::platefile
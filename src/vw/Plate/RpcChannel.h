@@ -10,6 +10,8 @@
 
 #include <vw/Core/FundamentalTypes.h>
 #include <google/protobuf/service.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
 #include <vector>
 
 namespace vw {
@@ -71,6 +73,43 @@ class IChannel : public ::google::protobuf::RpcChannel {
     virtual void bind(const Url& self) = 0;
 };
 
+// Client channels that outlive their clients, so that the short-lived clients
+// of a server (every PlateFile opened on it, every job task) don't each pay
+// for connecting. A leased channel is the lessee's alone; when the last copy
+// of it goes away, it goes back to the pool with its timeout and retries as
+// they were, unless a call on it failed with anything but a PlatefileErr
+// (the channel may be out of step with the server then). Since channels have
+// thread affinity, a thread only gets back the channels it connected.
+//
+// Urls with a pool=0 query, and zmq+inproc urls (whose connections don't
+// survive their server going away), get a channel of their own instead.
+class ChannelPool : private boost::noncopyable {
+    struct Impl;
+    boost::shared_ptr<Impl> m_impl;
+  public:
+    ChannelPool();
+    ~ChannelPool();
+
+    // The pool RpcClients lease their channels from
+    static ChannelPool& global();
+
+    // An idle channel to the url, if this thread has one that hasn't been
+    // idle for too long, or else a new one.
+    boost::shared_ptr<IChannel> lease(const Url& url, const std::string& clientname);
+
+    // Idle channels are closed once they have been idle this long (in ms)
+    void set_max_idle(uint32 ms);
+    uint32 max_idle() const;
+
+    // The number of idle channels
+    size_t idle() const;
+
+    // Close every idle channel
+    void clear();
+
+    static const uint32 DEFAULT_MAX_IDLE = 60000; // ms
+};
+
 
 }} //  vw::platefile
 
@@ -7,6 +7,7 @@
 
 #include <vw/Plate/SnapshotManager.h>
 #include <vw/Plate/detail/MipmapHelpers.h>
+#include <vw/Plate/detail/TilePool.h>
 #include <vw/Plate/PlateFile.h>
 #include <vw/Plate/TileManipulation.h>
 #include <vw/Mosaic/ImageComposite.h>
@@ -14,6 +15,7 @@
 #include <vw/Image/UtilityViews.h>
 #include <boost/foreach.hpp>
 #include <boost/lambda/construct.hpp>
+#include <boost/noncopyable.hpp>
 
 namespace d = vw::platefile::detail;
 
@@ -23,47 +25,60 @@ namespace {
 
   // row, col at target level, tile headers from next level down (sorted in Tid order)
   typedef std::map<d::rowcol_t, std::vector<TileHeader> > composite_map_t;
-  // Cache of parsed images
-  template <typename PixelT>
-  struct tile_cache_t : public std::map<d::rowcoltid_t, ImageView<PixelT> > {};
 
+  // The snapshot of one tile, built up a layer at a time from the newest
+  // transaction down, until it's opaque or out of layers.
   template <typename PixelT>
-  void parse_image_and_store(const Tile& t, tile_cache_t<PixelT>& tile_cache) {
-    ImageView<PixelT>& image = tile_cache[d::rowcoltid_t(t.hdr.row(), t.hdr.col(), t.hdr.transaction_id())];
-    boost::scoped_ptr<SrcImageResource> r(SrcMemoryImageResource::open(t.hdr.filetype(), &t.data->operator[](0), t.data->size()));
-    read_image(image, *r);
-  }
-
+  struct layered_tile {
+    std::vector<TileHeader> layers; // newest first
+    size_t next;                    // the next layer to read
+    ImageView<PixelT> image;        // the composite of the layers so far
+    layered_tile() : next(0) {}
+  };
+
+  // Lays one layer under the composite of the layers above it, and writes
+  // the tile out once nothing below could show through.
   template <typename PixelT>
-  void mosaic_in_tid_order(ImageView<PixelT>& out, const size_t size, const tile_cache_t<PixelT>& tile_cache, std::vector<TileHeader>& tiles) {
-    typedef ImageView<PixelT> image_t;
-    typedef tile_cache_t<PixelT> cache_t;
-
-    // We arrange in descending order, so that when the higher level
-    // tiles fill the output completely, we'll stop inserting.
-    out = constant_view(PixelT(), size, size);
-    std::sort(tiles.begin(), tiles.end(), d::SortByTidDesc());
-    // Insert the images into the composite from lowest to highest tid
-    BOOST_FOREACH(const TileHeader& hdr, tiles) {
-      typename cache_t::const_iterator i = tile_cache.find(d::rowcoltid_t(d::therow(hdr), d::thecol(hdr), d::thetid(hdr)));
-      if (i == tile_cache.end()) {
-        vw_out(WarningMessage, "platefile.snapshot") << "Failed to load image for " << hdr << std::endl;
-        continue;
-      }
+  class CompositeLayerTask : public Task, private boost::noncopyable {
+      d::TilePool& m_pool;
+      Tile m_layer;
+      layered_tile<PixelT>& m_tile;
+      uint32 m_level;
+      const d::RememberCallback& m_pc;
+    public:
+      CompositeLayerTask(d::TilePool& pool, const Tile& layer, layered_tile<PixelT>& tile, uint32 level, const d::RememberCallback& pc)
+        : m_pool(pool), m_layer(layer), m_tile(tile), m_level(level), m_pc(pc) {}
+
+      void operator()() {
+        try {
+          ImageView<PixelT> layer;
+          boost::scoped_ptr<SrcImageResource> r(SrcMemoryImageResource::open(m_layer.hdr.filetype(), &m_layer.data->operator[](0), m_layer.data->size()));
+          read_image(layer, *r);
+
+          if (!m_tile.image)
+            m_tile.image = layer;
+          else {
+            // Insert the next lower tile and then lay the previous
+            // composite on top.
+            const int32 size = m_pool.tile_size;
+            mosaic::ImageComposite<PixelT> composite;
+            composite.set_draft_mode(true);
+            composite.insert(layer, 0, 0);
+            composite.insert(m_tile.image, 0, 0);
+            composite.prepare(BBox2i(0,0,size,size));
+            m_tile.image = composite;
+          }
 
-      // Insert the next lower tile and then lay the previous
-      // composite on top. If this new combination is opaque, we've
-      // finished the snapshot.
-      mosaic::ImageComposite<PixelT> composite;
-      composite.set_draft_mode(true);
-      composite.insert(i->second, 0, 0);
-      composite.insert( out, 0, 0 );
-      composite.prepare(BBox2i(0,0,size,size));
-      out = composite;
-      if ( is_opaque( out ) )
-        return;
-    }
-  }
+          // If this new combination is opaque, we've finished the snapshot.
+          if (is_opaque(m_tile.image))
+            m_tile.next = m_tile.layers.size();
+          if (m_tile.next == m_tile.layers.size())
+            m_pool.write(m_tile.image, m_layer.hdr.col(), m_layer.hdr.row(), m_level, m_pc);
+        } catch (const std::exception& e) {
+          m_pool.failed(e.what());
+        }
+      }
+  };
 }
 
 namespace vw {
@@ -71,6 +86,9 @@ namespace platefile {
 
 template <class PixelT>
 void SnapshotManager<PixelT>::snapshot(uint32 level, BBox2i const& tile_region, TransactionRange range, const ProgressCallback &progress) const {
+  typedef layered_tile<PixelT> tile_t;
+  typedef std::map<d::rowcol_t, tile_t> batch_t;
+
   // The byte size of an uncompressed image
   const uint64 TILE_BYTES  = m_write_plate->default_tile_size() * m_write_plate->default_tile_size() * uint32(PixelNumBytes<PixelT>::value);
   const uint64 CACHE_BYTES = vw_settings().system_cache_size();
@@ -81,6 +99,10 @@ void SnapshotManager<PixelT>::snapshot(uint32 level, BBox2i const& tile_region,
   if ( CACHE_TILES < 100 )
     vw_out(WarningMessage) << "You will lose a lot speed to thrashing if you can't cache at least 100 tiles (you can only store " << CACHE_TILES << ")\n";
 
+  // Each tile in a batch holds its composite and, while it's being
+  // decoded, one layer.
+  const size_t BATCH_TILES = CACHE_TILES / 2;
+
   // Divide up the region into moderately-sized chunks
   std::list<BBox2i> regions = bbox_tiles(tile_region, 1024, 1024);
   BOOST_FOREACH(const BBox2i& region, regions) {
@@ -100,68 +122,50 @@ void SnapshotManager<PixelT>::snapshot(uint32 level, BBox2i const& tile_region,
 
     d::RememberCallback pc(region_pc, 1, composite_map.size());
 
-    composite_map_t::const_iterator i = composite_map.begin(), end = composite_map.end();
-
-    do {
-      // queue up CACHE_TILES worth of tiles into composite_batch
-      size_t size = 0;
-      composite_map_t composite_batch;
-
-      composite_map_t::const_iterator i_before = i;
-      for (; i != end; ++i) {
-        if (size + i->second.size() <= CACHE_TILES) {
-          composite_batch.insert(*i);
-          size += i->second.size();
-        } else {
-          VW_ASSERT( i_before != i,
-                     LogicErr() << "Cache too small to perform composite. Stuck in infinite loop." );
-          break;
-        }
-      }
-      if (composite_batch.size() == 0)
-        continue;
-
-      Datastore::TileSearch tile_lookup;
-      tile_cache_t<PixelT> tile_cache;
-
-      BOOST_FOREACH(const composite_map_t::value_type& t, composite_batch) {
-        //std::cerr << "Batching tiles for " << t.first << ": ";
-        //std::transform(t.second.begin(), t.second.end(), std::ostream_iterator<uint32>(std::cerr, ", "), boost::bind(&TileHeader::transaction_id, _1));
-        //std::cerr << " (currently have " << tile_lookup.size() << "/" << CACHE_TILES << ")" << std::endl;
-        std::copy(t.second.begin(), t.second.end(), std::back_inserter(tile_lookup));
+    composite_map_t::iterator i = composite_map.begin(), end = composite_map.end();
+    while (i != end) {
+      batch_t batch;
+      for (; i != end && batch.size() < BATCH_TILES; ++i) {
+        tile_t& t = batch[i->first];
+        t.layers.swap(i->second);
+        // We arrange in descending order, so that when the higher level
+        // tiles fill the output completely, we'll stop reading.
+        std::sort(t.layers.begin(), t.layers.end(), d::SortByTidDesc());
       }
 
-      BOOST_FOREACH(const Tile& t, m_read_plate->batch_read(tile_lookup))
-        parse_image_and_store(t, tile_cache);
-      tile_lookup.clear();
-
-      BOOST_FOREACH(composite_map_t::value_type& t, composite_batch) {
+      // Read the tiles a layer at a time, newest first, only for the tiles
+      // that aren't finished yet.
+      while (true) {
+        Datastore::TileSearch tile_lookup;
+        BOOST_FOREACH(typename batch_t::value_type& t, batch)
+          if (t.second.next < t.second.layers.size())
+            tile_lookup.push_back(t.second.layers[t.second.next]);
+        if (tile_lookup.empty())
+          break;
 
-        // Early exit condition if there is only one tile
-        if (t.second.size() == 1 ) {
-          typename tile_cache_t<PixelT>::const_iterator i =
-            tile_cache.find(d::rowcoltid_t(d::therow(t.second[0]), d::thecol(t.second[0]), d::thetid(t.second[0])));
-          if ( i == tile_cache.end() ) {
-            vw_out(WarningMessage, "platefile.snapshot") << "Failed to load image for " << t.second[0] << std::endl;
-            continue;
-          }
-          m_write_plate->write_update(i->second, d::thecol(t.first), d::therow(t.first), level);
-          continue;
+        d::TilePool pool(*m_write_plate);
+        BOOST_FOREACH(const Tile& layer, m_read_plate->batch_read(tile_lookup)) {
+          tile_t& t = batch[d::rowcol_t(layer.hdr.row(), layer.hdr.col())];
+          ++t.next;
+          pool.add(new CompositeLayerTask<PixelT>(pool, layer, t, level, pc));
         }
-
-        // Perform an actual composite if there are multiple tiles to be inserted
-        ImageView<PixelT> tile;
-        mosaic_in_tid_order<PixelT>(tile, m_write_plate->default_tile_size(), tile_cache, t.second);
-        if (!tile) {
-          vw_out(WarningMessage, "platefile.snapshot") << "Empty tile list, skipping writing tile row=" << d::therow(t.first) << " col=" << d::thecol(t.first) << std::endl;
-          continue;
+        pool.join();
+
+        // Skip whatever layers couldn't be read
+        BOOST_FOREACH(const Tile& lookup, tile_lookup) {
+          const TileHeader& hdr = lookup.hdr;
+          tile_t& t = batch[d::rowcol_t(hdr.row(), hdr.col())];
+          if (t.next < t.layers.size() && d::thetid(t.layers[t.next]) == d::thetid(hdr)) {
+            vw_out(WarningMessage, "platefile.snapshot") << "Failed to load image for " << hdr << std::endl;
+            ++t.next;
+            if (t.next == t.layers.size() && t.image)
+              m_write_plate->write_update(t.image, hdr.col(), hdr.row(), level);
+            else if (t.next == t.layers.size())
+              vw_out(WarningMessage, "platefile.snapshot") << "Empty tile list, skipping writing tile row=" << hdr.row() << " col=" << hdr.col() << std::endl;
+          }
         }
-        m_write_plate->write_update(tile, d::thecol(t.first), d::therow(t.first), level);
-        pc.tick();
       }
-      composite_batch.clear();
-      size = 0;
-    } while (i != end);
+    }
     region_pc.report_finished();
   }
   progress.report_finished();
@@ -0,0 +1,81 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Plate/TileCache.h>
+#include <vw/Core/System.h>
+
+#include <cstring>
+
+using namespace vw;
+using namespace vw::platefile;
+
+bool TileCache::Key::operator<(const Key& k) const {
+  if (platefile_id != k.platefile_id) return platefile_id < k.platefile_id;
+  if (level != k.level)               return level < k.level;
+  if (col != k.col)                   return col < k.col;
+  if (row != k.row)                   return row < k.row;
+  if (transaction_id != k.transaction_id) return transaction_id < k.transaction_id;
+  return std::strcmp(pixel_type, k.pixel_type) < 0;
+}
+
+boost::shared_ptr<TileCache::LineBase> TileCache::find(Key const& key) {
+  Mutex::Lock lock(m_mutex);
+  table_by_key_t& by_key = m_table.get<1>();
+  table_by_key_t::iterator i = by_key.find(key);
+  if (i == by_key.end())
+    return boost::shared_ptr<LineBase>();
+
+  // A line whose plate was closed can't be regenerated, so a reader that
+  // opened the plate again makes a new one.
+  if (i->data.expired()) {
+    by_key.erase(i);
+    return boost::shared_ptr<LineBase>();
+  }
+
+  // Most recently used go to the front
+  m_table.relocate(m_table.begin(), m_table.project<0>(i));
+  return i->line;
+}
+
+void TileCache::insert(Key const& key, boost::shared_ptr<LineBase> line, boost::weak_ptr<Datastore> data) {
+  Mutex::Lock lock(m_mutex);
+  table_by_key_t& by_key = m_table.get<1>();
+  table_by_key_t::iterator i = by_key.find(key);
+  if (i != by_key.end())
+    by_key.erase(i);
+
+  m_table.push_front(Entry(key, line, data));
+  while (m_table.size() > m_max_tiles)
+    m_table.pop_back();
+}
+
+void TileCache::forget(uint32 platefile_id, uint32 level, uint32 col, uint32 row, Transaction transaction_id) {
+  Mutex::Lock lock(m_mutex);
+  table_by_key_t& by_key = m_table.get<1>();
+  // The empty pixel type sorts before any other
+  Key first(platefile_id, level, col, row, transaction_id);
+  table_by_key_t::iterator end = by_key.lower_bound(first);
+  while (end != by_key.end() && end->key.platefile_id == platefile_id && end->key.level == level &&
+         end->key.col == col && end->key.row == row && end->key.transaction_id == transaction_id)
+    ++end;
+  by_key.erase(by_key.lower_bound(first), end);
+}
+
+void TileCache::clear() {
+  Mutex::Lock lock(m_mutex);
+  m_table.clear();
+}
+
+size_t TileCache::size() const {
+  Mutex::Lock lock(m_mutex);
+  return m_table.size();
+}
+
+TileCache& vw::platefile::plate_tile_cache() {
+  static TileCache cache(vw_system_cache());
+  return cache;
+}
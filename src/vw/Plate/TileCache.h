@@ -0,0 +1,163 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file TileCache.h
+///
+/// Decoded tiles, shared by every plate reader in the process.
+///
+#ifndef __VW_PLATE_TILECACHE_H__
+#define __VW_PLATE_TILECACHE_H__
+
+#include <vw/Plate/Datastore.h>
+#include <vw/Plate/Exception.h>
+#include <vw/Core/Cache.h>
+#include <vw/Core/Thread.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/FileIO/MemoryImageResource.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/member.hpp>
+
+#include <typeinfo>
+
+namespace vw {
+namespace platefile {
+
+  /// Tiles decoded by the ReadOnlyPlateFiles that use it (see
+  /// ReadOnlyPlateFile::set_tile_cache()), so that a tile read again,
+  /// by the same reader or any other of the same plate, is not read
+  /// from its blob and decoded again.  A tile is known by its plate's
+  /// id, its location and transaction id, and the pixel type it was
+  /// decoded to.  The decoded images are lines of a vw::Cache, which
+  /// accounts for their size and evicts them along with its other
+  /// lines; the TileCache itself only keeps the table of their handles,
+  /// dropping the least recently used once it holds max_tiles of them.
+  class TileCache : private boost::noncopyable {
+    public:
+      struct Key {
+        uint32 platefile_id, level, col, row;
+        Transaction transaction_id;
+        const char* pixel_type;
+        Key(uint32 platefile_id, uint32 level, uint32 col, uint32 row, Transaction transaction_id, const char* pixel_type = "")
+          : platefile_id(platefile_id), level(level), col(col), row(row),
+            transaction_id(transaction_id), pixel_type(pixel_type) {}
+        bool operator<(const Key& k) const;
+      };
+
+    private:
+      struct LineBase {
+        virtual ~LineBase() {}
+      };
+
+      template <class PixelT>
+      class Generator {
+          boost::weak_ptr<Datastore> m_data;
+          TileHeader m_hdr;
+          size_t m_size;
+        public:
+          typedef ImageView<PixelT> value_type;
+          Generator(boost::shared_ptr<Datastore> const& data, TileHeader const& hdr)
+            : m_data(data), m_hdr(hdr),
+              m_size(size_t(data->tile_size()) * data->tile_size() * sizeof(PixelT)) {}
+
+          size_t size() const { return m_size; }
+
+          boost::shared_ptr<value_type> generate() const {
+            boost::shared_ptr<Datastore> data = m_data.lock();
+            if (!data)
+              vw_throw(TileNotFoundErr() << "TileCache: the plate of tile " << m_hdr << " has been closed.");
+
+            Datastore::TileSearch tiles(1, Tile(m_hdr));
+            data->populate(tiles);
+            if (tiles.empty())
+              vw_throw(TileNotFoundErr() << "TileCache: could not read tile " << m_hdr << ".");
+
+            const Tile& tile = tiles.front();
+            boost::scoped_ptr<SrcImageResource> r(SrcMemoryImageResource::open(tile.hdr.filetype(), &tile.data->operator[](0), tile.data->size()));
+            boost::shared_ptr<value_type> image(new value_type());
+            read_image(*image, *r);
+            return image;
+          }
+      };
+
+      template <class PixelT>
+      struct Line : public LineBase {
+        Cache::Handle<Generator<PixelT> > handle;
+        Line(Cache::Handle<Generator<PixelT> > const& handle) : handle(handle) {}
+      };
+
+      struct Entry {
+        Key key;
+        boost::shared_ptr<LineBase> line;
+        boost::weak_ptr<Datastore> data;
+        Entry(Key const& key, boost::shared_ptr<LineBase> line, boost::weak_ptr<Datastore> data)
+          : key(key), line(line), data(data) {}
+      };
+
+      typedef boost::multi_index_container<Entry,
+                boost::multi_index::indexed_by<
+                  boost::multi_index::sequenced<>,
+                  boost::multi_index::ordered_unique<boost::multi_index::member<Entry, Key, &Entry::key> > > > table_t;
+      typedef table_t::nth_index<0>::type table_by_age_t;
+      typedef table_t::nth_index<1>::type table_by_key_t;
+
+      Cache& m_cache;
+      size_t m_max_tiles;
+      table_t m_table;
+      mutable Mutex m_mutex;
+
+      /// The line for the tile, if there is one whose plate is still open.
+      boost::shared_ptr<LineBase> find(Key const& key);
+      void insert(Key const& key, boost::shared_ptr<LineBase> line, boost::weak_ptr<Datastore> data);
+
+    public:
+      TileCache(Cache& cache = vw_system_cache(), size_t max_tiles = 65536)
+        : m_cache(cache), m_max_tiles(max_tiles) {}
+
+      /// A copy of the tile, decoded, which the caller may change.  The
+      /// header must name a tile of the datastore exactly, as head()
+      /// returns them.
+      template <class PixelT>
+      ImageView<PixelT> get(boost::shared_ptr<Datastore> const& data, TileHeader const& hdr) {
+        Key key(data->id(), hdr.level(), hdr.col(), hdr.row(), hdr.transaction_id(), typeid(PixelT).name());
+
+        boost::shared_ptr<Line<PixelT> > line = boost::static_pointer_cast<Line<PixelT> >(this->find(key));
+        if (!line) {
+          line.reset(new Line<PixelT>(m_cache.insert(Generator<PixelT>(data, hdr))));
+          this->insert(key, line, data);
+        }
+
+        boost::shared_ptr<ImageView<PixelT> > image = line->handle;
+        return copy(*image);
+      }
+
+      /// Drop the tile, decoded to any pixel type, as when it has just
+      /// been written again.
+      void forget(uint32 platefile_id, uint32 level, uint32 col, uint32 row, Transaction transaction_id);
+
+      /// Drop every tile.
+      void clear();
+
+      /// The number of tiles in the table, whether or not the Cache
+      /// still holds their images.
+      size_t size() const;
+  };
+
+  /// The TileCache shared by the whole process, whose images are kept in
+  /// vw_system_cache().
+  TileCache& plate_tile_cache();
+
+}} // namespace vw::platefile
+
+#endif // __VW_PLATE_TILECACHE_H__
@@ -0,0 +1,257 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Plate/TileJob.h>
+#include <vw/Plate/Exception.h>
+#include <vw/Plate/FundamentalTypes.h>
+#include <vw/Plate/RpcChannel.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/Stopwatch.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+namespace fs = boost::filesystem;
+namespace pb = ::google::protobuf;
+
+using namespace vw;
+using namespace vw::platefile;
+
+// ----------------------------------------------------------------------------------
+//                                 THE SERVICE
+// ----------------------------------------------------------------------------------
+
+TileJobServiceImpl::TileJobServiceImpl( ImageFormat const& format, Vector2i tile_size, std::string const& tile_directory,
+                                        float job_timeout, int32 max_failures )
+  : m_format( format ), m_tile_directory( tile_directory ), m_done( 0 ),
+    m_job_timeout( uint64( job_timeout * 1e6 ) ), m_max_failures( max_failures )
+{
+  VW_ASSERT( tile_size.x() > 0 && tile_size.y() > 0,
+             ArgumentErr() << "TileJobService: Invalid tile size " << tile_size << "." );
+
+  // The jobs go from left to right, then top to bottom, so that the
+  // tiles can be put together in order.
+  for( int32 y = 0; y < int32(format.rows); y += tile_size.y() ) {
+    for( int32 x = 0; x < int32(format.cols); x += tile_size.x() ) {
+      Job job;
+      job.bbox = BBox2i( x, y, std::min( tile_size.x(), int32(format.cols) - x ),
+                         std::min( tile_size.y(), int32(format.rows) - y ) );
+      job.state = Job::PENDING;
+      job.assigned = 0;
+      job.attempts = job.failures = 0;
+      m_jobs.push_back( job );
+    }
+  }
+}
+
+size_t TileJobServiceImpl::num_done() const {
+  Mutex::Lock lock( m_mutex );
+  return m_done;
+}
+
+std::string TileJobServiceImpl::job_filename( size_t id ) const {
+  Mutex::Lock lock( m_mutex );
+  return m_jobs[id].filename;
+}
+
+bool TileJobServiceImpl::wait( uint32 milliseconds ) {
+  Mutex::Lock lock( m_mutex );
+  if( m_error.empty() && m_done < m_jobs.size() )
+    m_condition.timed_wait( lock, milliseconds );
+  if( !m_error.empty() )
+    vw_throw( IOErr() << "TileJobService: " << m_error );
+  return m_done == m_jobs.size();
+}
+
+#define METHOD_IMPL(Name, Input, Output) \
+  void TileJobServiceImpl::Name(pb::RpcController*, const Input* request, Output* response, pb::Closure* done)
+#define METHOD_IMPL_NOREPLY(Name, Input) \
+  void TileJobServiceImpl::Name(pb::RpcController*, const Input* request, RpcNullMsg*, pb::Closure* done)
+
+#define METHOD_BOILERPLATE \
+  detail::RequireCall call(done);\
+  Mutex::Lock thelock(m_mutex);
+
+METHOD_IMPL(JobRequest, TileJobRequest, TileJobReply) {
+  METHOD_BOILERPLATE;
+
+  if( request->cols() != int32(m_format.cols) || request->rows() != int32(m_format.rows) ||
+      request->planes() != int32(m_format.planes) ||
+      request->pixel_format() != m_format.pixel_format || request->channel_type() != m_format.channel_type )
+    vw_throw( PlatefileErr() << "Worker " << request->worker() << " rasterizes a " << request->cols() << "x"
+              << request->rows() << " image, not the " << m_format.cols << "x" << m_format.rows << " one being written." );
+
+  if( !m_error.empty() || m_done == m_jobs.size() ) {
+    response->set_finished( true );
+    return;
+  }
+
+  // A job that has been out too long is given to this worker instead.
+  uint64 now = Stopwatch::microtime();
+  for( size_t i = 0; i < m_jobs.size(); ++i ) {
+    Job& job = m_jobs[i];
+    if( job.state == Job::DONE ) continue;
+    if( job.state == Job::ASSIGNED ) {
+      if( now - job.assigned < m_job_timeout ) continue;
+      VW_OUT(WarningMessage, "plate.tilejob") << "Tile job " << i << " timed out. Handing it out again.\n";
+    }
+
+    job.state = Job::ASSIGNED;
+    job.assigned = now;
+    job.attempts++;
+    job.filename = m_tile_directory + "/" + str( boost::format("tile_%d_%d.vwt") % i % job.attempts );
+
+    response->set_job_id( int32(i) );
+    response->set_x( job.bbox.min().x() );
+    response->set_y( job.bbox.min().y() );
+    response->set_cols( job.bbox.width() );
+    response->set_rows( job.bbox.height() );
+    response->set_filename( job.filename );
+    VW_OUT(DebugMessage, "plate.tilejob") << "Tile job " << i << " at " << job.bbox << " to " << request->worker() << "\n";
+    return;
+  }
+}
+
+METHOD_IMPL_NOREPLY(JobComplete, TileJobComplete) {
+  METHOD_BOILERPLATE;
+  if( request->job_id() < 0 || size_t(request->job_id()) >= m_jobs.size() )
+    vw_throw( PlatefileErr() << "No tile job " << request->job_id() << "." );
+
+  // The first worker to finish a job handed out twice wins.
+  Job& job = m_jobs[request->job_id()];
+  if( job.state == Job::DONE ) return;
+  job.state = Job::DONE;
+  job.filename = request->filename();
+  m_done++;
+  m_condition.notify_all();
+}
+
+METHOD_IMPL_NOREPLY(JobFailed, TileJobFailed) {
+  METHOD_BOILERPLATE;
+  if( request->job_id() < 0 || size_t(request->job_id()) >= m_jobs.size() )
+    vw_throw( PlatefileErr() << "No tile job " << request->job_id() << "." );
+
+  Job& job = m_jobs[request->job_id()];
+  if( job.state == Job::DONE ) return;
+  VW_OUT(WarningMessage, "plate.tilejob") << "Tile job " << request->job_id() << " failed on "
+                                          << request->worker() << ": " << request->message() << "\n";
+  if( ++job.failures >= m_max_failures ) {
+    m_error = str( boost::format("Tile job %d failed %d times, last with: %s")
+                   % request->job_id() % job.failures % request->message() );
+    m_condition.notify_all();
+  }
+  else {
+    job.state = Job::PENDING;
+  }
+}
+
+#undef METHOD_IMPL
+#undef METHOD_IMPL_NOREPLY
+#undef METHOD_BOILERPLATE
+
+// ----------------------------------------------------------------------------------
+//                                 THE COORDINATOR
+// ----------------------------------------------------------------------------------
+
+TileJobCoordinator::TileJobCoordinator( Url const& url, std::string const& filename, ImageFormat const& format,
+                                        Vector2i tile_size, float job_timeout )
+  : m_filename( filename ), m_format( format ), m_tile_directory( filename + ".tiles" )
+{
+  m_resource.reset( DiskImageResource::create( filename, format ) );
+
+  // Each tile is written to the output whole, so it must be made of
+  // whole blocks of the output.
+  Vector2i block = write_block_size( *m_resource, format.cols, format.rows );
+  for( int i = 0; i < 2; ++i )
+    tile_size[i] = std::max( 1, (tile_size[i] + block[i] - 1) / block[i] ) * block[i];
+
+  fs::create_directories( m_tile_directory );
+  m_service.reset( new TileJobServiceImpl( format, tile_size, m_tile_directory, job_timeout ) );
+  m_server.bind( url, m_service );
+  if( const char* error = m_server.error() )
+    vw_throw( IOErr() << "TileJobCoordinator: Failed to serve on " << url.string() << ": " << error );
+  VW_OUT(InfoMessage, "plate.tilejob") << "Serving " << m_service->num_jobs() << " tile jobs for "
+                                       << filename << " on " << url.string() << "\n";
+}
+
+TileJobCoordinator::~TileJobCoordinator() {
+  m_server.stop();
+}
+
+void TileJobCoordinator::run( const ProgressCallback &progress_callback ) {
+  progress_callback.report_progress( 0 );
+  size_t jobs = m_service->num_jobs();
+  while( !m_service->wait( 1000 ) ) {
+    progress_callback.report_progress( double( m_service->num_done() ) / jobs );
+    if( progress_callback.abort_requested() )
+      vw_throw( Aborted() << "Aborted by ProgressCallback" );
+  }
+
+  // Put the tiles together, in order, in their own format.
+  for( size_t i = 0; i < jobs; ++i ) {
+    BBox2i bbox = m_service->job_bbox( i );
+    DiskImageResourceVWT tile( m_service->job_filename( i ) );
+    VW_ASSERT( tile.cols() == bbox.width() && tile.rows() == bbox.height(),
+               IOErr() << "TileJobCoordinator: " << tile.filename() << " is the wrong size." );
+    ImageFormat format = tile.format();
+    std::vector<uint8> data( format.byte_size() );
+    ImageBuffer buffer( format, &data[0] );
+    tile.read( buffer, BBox2i( 0, 0, bbox.width(), bbox.height() ) );
+    m_resource->write( buffer, bbox );
+  }
+  m_resource->flush();
+  m_resource.reset();
+
+  fs::remove_all( m_tile_directory );
+  progress_callback.report_finished();
+}
+
+// ----------------------------------------------------------------------------------
+//                                 THE WORKER
+// ----------------------------------------------------------------------------------
+
+TileJobClient::TileJobClient( Url const& url, ImageFormat const& format, std::string const& name )
+  : m_client( url ), m_name( name.empty() ? unique_name( "tile_worker" ) : name ), m_format( format )
+{}
+
+bool TileJobClient::next( TileJobReply& job ) {
+  TileJobRequest request;
+  request.set_worker( m_name );
+  request.set_cols( m_format.cols );
+  request.set_rows( m_format.rows );
+  request.set_planes( m_format.planes );
+  request.set_pixel_format( m_format.pixel_format );
+  request.set_channel_type( m_format.channel_type );
+
+  // While every tile is taken, one may yet be handed out again.
+  while( true ) {
+    job.Clear();
+    m_client.JobRequest( &m_client, &request, &job, null_callback() );
+    if( job.finished() )
+      return false;
+    if( job.job_id() >= 0 )
+      return true;
+    Thread::sleep_ms( 1000 );
+  }
+}
+
+void TileJobClient::complete( TileJobReply const& job ) {
+  TileJobComplete request;
+  RpcNullMsg response;
+  request.set_worker( m_name );
+  request.set_job_id( job.job_id() );
+  request.set_filename( job.filename() );
+  m_client.JobComplete( &m_client, &request, &response, null_callback() );
+}
+
+void TileJobClient::failed( TileJobReply const& job, std::string const& message ) {
+  TileJobFailed request;
+  RpcNullMsg response;
+  request.set_worker( m_name );
+  request.set_job_id( job.job_id() );
+  request.set_message( message );
+  m_client.JobFailed( &m_client, &request, &response, null_callback() );
+}
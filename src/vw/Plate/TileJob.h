@@ -0,0 +1,173 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file TileJob.h
+///
+/// Writing one image with the help of other machines.  A coordinator
+/// cuts the image into tiles and serves them as jobs over an RPC url.
+/// Workers on other nodes build the same view (from the same inputs,
+/// on a shared filesystem), ask the coordinator for tiles, and write
+/// each one they rasterize to a file of its own beside the output.
+/// When every tile is in, the coordinator copies them into the output
+/// and removes them.
+///
+/// The coordinator:
+///
+///   TileJobCoordinator coordinator( Url("zmq+tcp://*:5555"), "out.tif",
+///                                   image.format(), Vector2i(2048,2048) );
+///   coordinator.run( TerminalProgressCallback("plate", "Tiles:") );
+///
+/// and each worker:
+///
+///   tile_job_worker( Url("zmq+tcp://coordinator:5555"), image );
+///
+/// A job that is not finished within the job timeout (its worker may
+/// have died) is handed to the next worker that asks, and a job that
+/// fails too many times fails the whole image.
+///
+#ifndef __VW_PLATE_TILEJOB_H__
+#define __VW_PLATE_TILEJOB_H__
+
+#include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Thread.h>
+#include <vw/Image/ImageIO.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/FileIO/DiskImageResourceVWT.h>
+#include <vw/Plate/HTTPUtils.h>
+#include <vw/Plate/Rpc.h>
+#include <vw/Plate/TileJobService.pb.h>
+
+#include <boost/shared_ptr.hpp>
+
+namespace vw {
+namespace platefile {
+
+  // Hands out the tiles of one image.  The service may be called from
+  // several threads at once.
+  class TileJobServiceImpl : public TileJobService {
+    struct Job {
+      enum State { PENDING, ASSIGNED, DONE };
+      BBox2i bbox;
+      State state;
+      std::string filename;
+      uint64 assigned;
+      int32 attempts, failures;
+    };
+
+    ImageFormat m_format;
+    std::string m_tile_directory;
+    std::vector<Job> m_jobs;
+    size_t m_done;
+    std::string m_error;
+    uint64 m_job_timeout;
+    int32 m_max_failures;
+    mutable Mutex m_mutex;
+    Condition m_condition;
+
+  public:
+    /// Cuts an image of the given format into tiles of the given size,
+    /// to be written to files in tile_directory.  A job is handed out
+    /// again when it has been out for job_timeout seconds.
+    TileJobServiceImpl( ImageFormat const& format, Vector2i tile_size, std::string const& tile_directory,
+                        float job_timeout = 600, int32 max_failures = 3 );
+
+    size_t num_jobs() const { return m_jobs.size(); }
+    size_t num_done() const;
+    BBox2i job_bbox( size_t id ) const { return m_jobs[id].bbox; }
+    std::string job_filename( size_t id ) const;
+
+    /// Waits up to the given time for a job to finish or fail, and
+    /// returns whether every job is done.  Throws if a job failed for
+    /// good.
+    bool wait( uint32 milliseconds );
+
+    virtual void JobRequest(::google::protobuf::RpcController* controller,
+                            const TileJobRequest* request,
+                            TileJobReply* response,
+                            ::google::protobuf::Closure* done);
+
+    virtual void JobComplete(::google::protobuf::RpcController* controller,
+                             const TileJobComplete* request,
+                             RpcNullMsg* response,
+                             ::google::protobuf::Closure* done);
+
+    virtual void JobFailed(::google::protobuf::RpcController* controller,
+                           const TileJobFailed* request,
+                           RpcNullMsg* response,
+                           ::google::protobuf::Closure* done);
+  };
+
+  // Serves the tiles of an image, and puts the image together once the
+  // workers have written them.
+  class TileJobCoordinator : private boost::noncopyable {
+    std::string m_filename;
+    ImageFormat m_format;
+    std::string m_tile_directory;
+    boost::shared_ptr<DiskImageResource> m_resource;
+    boost::shared_ptr<TileJobServiceImpl> m_service;
+    RpcServer<TileJobServiceImpl> m_server;
+
+  public:
+    /// Serves jobs on the url for writing an image of the given format
+    /// to filename.  The tiles are rounded up to whole blocks of the
+    /// output, and are written to filename + ".tiles".
+    TileJobCoordinator( Url const& url, std::string const& filename, ImageFormat const& format,
+                        Vector2i tile_size, float job_timeout = 600 );
+    ~TileJobCoordinator();
+
+    TileJobServiceImpl& service() { return *m_service; }
+
+    /// Waits for the workers to write every tile, then copies the
+    /// tiles into the output and removes them.
+    void run( const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() );
+  };
+
+  // The worker's end of the conversation with a coordinator.
+  class TileJobClient : private boost::noncopyable {
+    RpcClient<TileJobService> m_client;
+    std::string m_name;
+    ImageFormat m_format;
+
+  public:
+    TileJobClient( Url const& url, ImageFormat const& format, std::string const& name = std::string() );
+
+    /// Gets the next job, waiting while every tile is taken.  Returns
+    /// false when there is nothing more to do.
+    bool next( TileJobReply& job );
+    void complete( TileJobReply const& job );
+    void failed( TileJobReply const& job, std::string const& message );
+  };
+
+  /// Rasterizes and writes tiles of the image for the coordinator at
+  /// the url until none are left.  Each tile is block-written, so it
+  /// uses the threads of this machine too.
+  template <class ImageT>
+  void tile_job_worker( Url const& url, ImageViewBase<ImageT> const& image,
+                        std::string const& name = std::string() ) {
+    TileJobClient client( url, image.format(), name );
+    TileJobReply job;
+    while( client.next( job ) ) {
+      BBox2i bbox( job.x(), job.y(), job.cols(), job.rows() );
+      try {
+        ImageFormat format = image.format();
+        format.cols = bbox.width();
+        format.rows = bbox.height();
+        DiskImageResourceVWT resource( job.filename(), format );
+        block_write_image( resource, crop( image.impl(), bbox ) );
+        resource.flush();
+      } catch( const Exception& e ) {
+        client.failed( job, e.what() );
+        continue;
+      }
+      client.complete( job );
+    }
+  }
+
+}} // namespace vw::platefile
+
+#endif // __VW_PLATE_TILEJOB_H__
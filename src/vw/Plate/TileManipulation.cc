@@ -25,3 +25,33 @@ std::list<vw::BBox2i> vw::platefile::bbox_tiles(vw::BBox2i const& bbox, int widt
   }
   return bboxes;
 }
+
+namespace {
+  // The grid line at or before v
+  vw::int32 grid_floor(vw::int32 v, vw::int32 step) {
+    return v - ((v % step) + step) % step;
+  }
+}
+
+std::list<vw::BBox2i> vw::platefile::aligned_bbox_tiles(vw::BBox2i const& bbox, int width, int height) {
+  std::list<vw::BBox2i> bboxes;
+
+  for (vw::int32 j = grid_floor(bbox.min().y(), height); j < bbox.max().y(); j += height) {
+    for (vw::int32 i = grid_floor(bbox.min().x(), width); i < bbox.max().x(); i += width) {
+      vw::BBox2i cell(i, j, width, height);
+      cell.crop(bbox);
+      bboxes.push_back(cell);
+    }
+  }
+  return bboxes;
+}
+
+std::list<vw::BBox2i> vw::platefile::shard_region(vw::BBox2i const& bbox, int page_size, size_t count, int min_size) {
+  int size = page_size;
+  std::list<vw::BBox2i> shards = aligned_bbox_tiles(bbox, size, size);
+  while (shards.size() < count && size > min_size && size % 2 == 0) {
+    size /= 2;
+    shards = aligned_bbox_tiles(bbox, size, size);
+  }
+  return shards;
+}
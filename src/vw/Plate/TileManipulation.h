@@ -15,6 +15,7 @@
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Filter.h>
 #include <vw/Math/BBox.h>
+#include <vw/Plate/detail/Downsample.h>
 #include <list>
 
 namespace vw {
@@ -26,8 +27,28 @@ namespace platefile {
   // tile the space of the larger bbox.
   std::list<vw::BBox2i> bbox_tiles(vw::BBox2i const& bbox, int width, int height);
 
+  // Like bbox_tiles, but the smaller bboxes are cut on a grid of
+  // width x height cells from the origin, so that none crosses a grid
+  // line.  Split on the index page size, each falls in one index page.
+  std::list<vw::BBox2i> aligned_bbox_tiles(vw::BBox2i const& bbox, int width, int height);
+
+  // Divides a region of a level into shards for parallel work: each is
+  // at most one index page, and they are halved (down to min_size on a
+  // side) until there are at least count of them.
+  std::list<vw::BBox2i> shard_region(vw::BBox2i const& bbox, int page_size, size_t count, int min_size = 4);
+
+  // Halves a tile of even size with the filter.
   template <class PixelT>
-  void mipmap_one_tile(ImageView<PixelT>& dest, uint32 tile_size, const ImageView<PixelT>& UL, const ImageView<PixelT>& UR, const ImageView<PixelT>& LL, const ImageView<PixelT>& LR, bool blur = true)
+  ImageView<PixelT> downsample_tile(const ImageView<PixelT>& src, DownsampleFilter filter = BOX_DOWNSAMPLE) {
+    ImageView<PixelT> dest;
+    detail::downsample_rows(dest, detail::ImageRows<PixelT>(src), filter);
+    return dest;
+  }
+
+  // Makes the parent of up to four tiles, any of which may be empty
+  // (transparent), filtering across the seams between them.
+  template <class PixelT>
+  void mipmap_one_tile(ImageView<PixelT>& dest, uint32 tile_size, const ImageView<PixelT>& UL, const ImageView<PixelT>& UR, const ImageView<PixelT>& LL, const ImageView<PixelT>& LR, DownsampleFilter filter)
   {
     VW_ASSERT(!UL || (UL.cols() == int32(tile_size) && UL.rows() == int32(tile_size)), LogicErr() << "Tiles must be the same size as tile_size");
     VW_ASSERT(!UR || (UR.cols() == int32(tile_size) && UR.rows() == int32(tile_size)), LogicErr() << "Tiles must be the same size as tile_size");
@@ -35,21 +56,16 @@ namespace platefile {
     VW_ASSERT(!LR || (LR.cols() == int32(tile_size) && LR.rows() == int32(tile_size)), LogicErr() << "Tiles must be the same size as tile_size");
     VW_ASSERT(UL || UR || LL || LR, LogicErr() << "Must compose at least one tile");
 
-    ImageView<PixelT> super(2*tile_size, 2*tile_size);
-
-    if (UL) crop(super, 0,         0,         tile_size, tile_size) = UL;
-    if (UR) crop(super, tile_size, 0,         tile_size, tile_size) = UR;
-    if (LL) crop(super, 0,         tile_size, tile_size, tile_size) = LL;
-    if (LR) crop(super, tile_size, tile_size, tile_size, tile_size) = LR;
-
-    // We subsample after blurring with a standard 2x2 box filter.
-    std::vector<float> kernel(2);
-    kernel[0] = kernel[1] = 0.5;
+    const ImageView<PixelT>* tiles[4] = { &UL, &UR, &LL, &LR };
+    detail::downsample_rows(dest, detail::QuadRows<PixelT>(tiles, tile_size), filter);
+  }
 
-    if (blur)
-      dest = subsample( separable_convolution_filter( super, kernel, kernel, 1, 1, ConstantEdgeExtension() ), 2);
-    else
-      dest = subsample( super, 2 );
+  // With blur, each 2x2 block of the children is averaged; without, the
+  // parent takes every other pixel.
+  template <class PixelT>
+  void mipmap_one_tile(ImageView<PixelT>& dest, uint32 tile_size, const ImageView<PixelT>& UL, const ImageView<PixelT>& UR, const ImageView<PixelT>& LL, const ImageView<PixelT>& LR, bool blur = true)
+  {
+    mipmap_one_tile(dest, tile_size, UL, UR, LL, LR, blur ? BOX_DOWNSAMPLE : POINT_DOWNSAMPLE);
   }
 
   // Resample image by reaching up a few levels and using the data there.
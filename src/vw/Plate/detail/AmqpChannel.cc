@@ -206,6 +206,10 @@ void AmqpChannel::conn(const Url& endpoint) {
 }
 
 void AmqpChannel::bind(const Url& endpoint) {
+  // The queue is declared exclusive, so only one channel can serve it
+  VW_ASSERT(endpoint.query().get<uint32>("threads", 1) == 1,
+            NoImplErr() << "AMQP urls can only be served by one thread");
+
   const std::string host = endpoint.hostname().empty() ? "localhost" : endpoint.hostname();
   const short port       = short(endpoint.port() == 0  ? 5672        : endpoint.port());
 
@@ -2,6 +2,7 @@
 #include <vw/Plate/detail/Index.h>
 #include <vw/Plate/Blob.h>
 #include <vw/Plate/Exception.h>
+#include <vw/Core/Stopwatch.h>
 #include <boost/foreach.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/format.hpp>
@@ -13,17 +14,30 @@ namespace io = boost::iostreams;
 
 namespace {
   static const size_t DEFAULT_BLOB_CACHE_SIZE = 8;
+
+  // Group commit: the index hears about written tiles once this many
+  // bytes of them have gone to the blob, this many are waiting, or the
+  // oldest has waited this long. The url can override them with
+  // commit_bytes, commit_tiles, and commit_ms.
+  static const vw::uint32 DEFAULT_COMMIT_BYTES = 1024 * 1024;
+  static const vw::uint32 DEFAULT_COMMIT_TILES = 256;
+  static const vw::uint32 DEFAULT_COMMIT_MS    = 1000;
   static const boost::format blob_tmpl("%s/plate_%u.blob");
 
   class BlobWriteState : public vw::platefile::WriteState {
     public:
-      BlobWriteState(const vw::platefile::Transaction& id) : transaction(id) {}
+      BlobWriteState(const vw::platefile::Transaction& id) : transaction(id), first_pending(0) {}
       virtual std::string what() const {
         return std::string("BlobWriteState[id = " + vw::stringify(blob_id) + "]");
       }
       vw::platefile::Transaction transaction;
       boost::shared_ptr<vw::platefile::Blob> blob;
       vw::uint32 blob_id;
+
+      // Index updates for tiles written since the last commit, and when
+      // the first of them was written (from Stopwatch::microtime)
+      std::vector<vw::platefile::detail::Index::WriteUpdate> pending;
+      vw::uint64 first_pending;
   };
 
 }
@@ -52,10 +66,16 @@ void Blobstore::init() {
 }
 
 Blobstore::Blobstore(const Url& u)
-  : m_index(Index::construct_open(u)) {init();}
+  : m_index(Index::construct_open(u)),
+    m_commit_bytes(u.query().get("commit_bytes", DEFAULT_COMMIT_BYTES)),
+    m_commit_tiles(u.query().get("commit_tiles", DEFAULT_COMMIT_TILES)),
+    m_commit_ms(u.query().get("commit_ms", DEFAULT_COMMIT_MS)) {init();}
 
 Blobstore::Blobstore(const Url& u, const IndexHeader& d)
-  : m_index(Index::construct_create(u, d)) {init();}
+  : m_index(Index::construct_create(u, d)),
+    m_commit_bytes(u.query().get("commit_bytes", DEFAULT_COMMIT_BYTES)),
+    m_commit_tiles(u.query().get("commit_tiles", DEFAULT_COMMIT_TILES)),
+    m_commit_ms(u.query().get("commit_ms", DEFAULT_COMMIT_MS)) {init();}
 
 boost::shared_ptr<ReadBlob> Blobstore::open_read_blob(uint32 blob_id) {
   Mutex::Lock lock(m_mutex);
@@ -92,7 +112,7 @@ boost::shared_ptr<Blob> Blobstore::open_write_blob(uint32 blob_id) {
   boost::format blob_name(blob_tmpl);
   const std::string fn = boost::str(blob_name % m_index->platefile_name() % blob_id);
   boost::shared_ptr<Blob>& blob = m_write_cache[blob_id];
-  blob.reset(new Blob(fn));
+  blob.reset(new Blob(fn, m_commit_bytes));
 
   // Expire the blob from the read cache, since we just opened it for write. It
   // will be opened from the write cache next time.
@@ -240,6 +260,10 @@ Datastore::TileSearch& Blobstore::populate(TileSearch& hdrs) {
   return hdrs;
 }
 
+void Blobstore::prefetch(uint32 level, const BBox2u& region) {
+  m_index->prefetch(level, region);
+}
+
 WriteState* Blobstore::write_request(const Transaction& id) {
   std::auto_ptr<BlobWriteState> state(new BlobWriteState(id));
 
@@ -264,22 +288,47 @@ void Blobstore::write_update(WriteState& state_, uint32 level, uint32 row, uint3
   header.set_transaction_id(state->transaction);
   header.set_filetype(filetype);
 
-  // 1. Write the data into the blob
+  // 1. Write the data into the blob (which may only buffer it)
   uint64 blob_offset = state->blob->write(header, data, size);
 
-  // 2. Update the index
+  // 2. Queue the index update; the index can't hear about the tile until
+  // its data is in the file
   IndexRecord write_record;
   write_record.set_blob_id(state->blob_id);
   write_record.set_blob_offset(blob_offset);
   write_record.set_filetype(header.filetype());
 
-  m_index->write_update(header, write_record);
+  if (state->pending.empty())
+    state->first_pending = Stopwatch::microtime();
+  state->pending.push_back(std::make_pair(header, write_record));
+
+  // 3. Commit once the blob has written its buffer out, or enough tiles
+  // (or time) have built up
+  if (state->blob->buffered_size() == 0
+      || state->pending.size() >= m_commit_tiles
+      || Stopwatch::microtime() - state->first_pending >= uint64(m_commit_ms) * 1000)
+    commit(*state);
+}
+
+void Blobstore::commit(WriteState& state_) {
+  BlobWriteState* state = dynamic_cast<BlobWriteState*>(&state_);
+  VW_ASSERT(state, LogicErr() << "Cannot pass write states between different implementations!");
+
+  if (state->pending.empty())
+    return;
+
+  state->blob->flush();
+  m_index->write_updates(state->pending);
+  state->pending.clear();
 }
 
 void Blobstore::write_complete(WriteState& state_) {
   BlobWriteState* state = dynamic_cast<BlobWriteState*>(&state_);
   VW_ASSERT(state, LogicErr() << "Cannot pass write states between different implementations!");
 
+  // Anything still waiting goes out first
+  commit(*state);
+
   // Fetch the size from the blob.
   uint64 new_blob_size = state->blob->size();
 
@@ -43,6 +43,9 @@ class Blobstore : public Datastore {
     write_cache_t m_write_cache;
     vw::Mutex m_mutex;
 
+    // Group commit thresholds
+    uint32 m_commit_bytes, m_commit_tiles, m_commit_ms;
+
     boost::shared_ptr<ReadBlob>  open_read_blob(uint32 blob_id);
     boost::shared_ptr<Blob>     open_write_blob(uint32 blob_id);
 
@@ -57,6 +60,7 @@ class Blobstore : public Datastore {
     virtual TileSearch&     head(TileSearch& buf, uint32 level, uint32 row, uint32 col, TransactionRange range, uint32 limit = 0);
     virtual TileSearch&     head(TileSearch& buf, uint32 level,   const BBox2u& region, TransactionRange range, uint32 limit = 0);
     virtual TileSearch& populate(TileSearch& hdrs);
+    virtual void prefetch(uint32 level, const BBox2u& region);
 
     //virtual Url map_to_url(uint32 level, uint32 row, uint32 col, Transaction id, std::string filetype);
     //virtual Url map_to_url(const TileHeader& t);
@@ -64,6 +68,9 @@ class Blobstore : public Datastore {
     virtual WriteState* write_request(const Transaction& id);
     virtual void write_update(WriteState& state, uint32 level, uint32 row, uint32 col, const std::string& filetype, const uint8* data, uint64 size);
     virtual void write_complete(WriteState& id);
+    /// Write out a write state's buffered tiles and send the index its
+    /// pending updates together.
+    virtual void commit(WriteState& state);
     virtual void flush();
 
     // These functions are variant, and may cause network IO.
@@ -0,0 +1,163 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+#ifndef __VW_PLATE_DETAIL_DOWNSAMPLE_H__
+#define __VW_PLATE_DETAIL_DOWNSAMPLE_H__
+
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypeInfo.h>
+#include <boost/type_traits/is_integral.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace vw { namespace platefile {
+
+  // How mipmapping halves a tile: by taking every other pixel, by
+  // averaging each 2x2 block, or by weighting the 4x4 block around it
+  // 1-3-3-1 on each axis, which aliases less.  Tiles with alpha are
+  // premultiplied, so each channel is filtered on its own.
+  enum DownsampleFilter { POINT_DOWNSAMPLE, BOX_DOWNSAMPLE, TENT_DOWNSAMPLE };
+
+namespace detail {
+
+  // The kernels below work on the tiles' pixel buffers, a row at a time:
+  // the taps from each source row are summed into a row of accumulators,
+  // then pairs of columns into the destination. The inner loops run over
+  // contiguous channels, and the integer channels sum in integers, so
+  // the compiler can vectorize them.
+
+  template <class ChannelT> struct DownsampleAccum { typedef double type; };
+  template <> struct DownsampleAccum<uint8>  { typedef uint32 type; };
+  template <> struct DownsampleAccum<uint16> { typedef uint32 type; };
+  template <> struct DownsampleAccum<int8>   { typedef int32 type; };
+  template <> struct DownsampleAccum<int16>  { typedef int32 type; };
+  template <> struct DownsampleAccum<float>  { typedef float type; };
+
+  // sum / 2^shift, rounded to nearest for integer channels
+  template <class ChannelT>
+  inline ChannelT downsample_finish(uint32 sum, int shift) {
+    return ChannelT((sum + (1u << (shift - 1))) >> shift);
+  }
+  template <class ChannelT>
+  inline ChannelT downsample_finish(int32 sum, int shift) {
+    return ChannelT((sum + (1 << (shift - 1))) >> shift);
+  }
+  template <class ChannelT>
+  inline ChannelT downsample_finish(float sum, int shift) {
+    return ChannelT(sum * (1.0f / float(1 << shift)));
+  }
+  template <class ChannelT>
+  inline ChannelT downsample_finish(double sum, int shift) {
+    double v = sum / double(1 << shift);
+    return ChannelT(boost::is_integral<ChannelT>::value ? std::floor(v + 0.5) : v);
+  }
+
+  // The rows of one image
+  template <class PixelT>
+  class ImageRows {
+      const ImageView<PixelT>& m_image;
+    public:
+      typedef typename PixelChannelType<PixelT>::type channel_type;
+      ImageRows(const ImageView<PixelT>& image) : m_image(image) {}
+      int32 cols() const { return m_image.cols(); }
+      int32 rows() const { return m_image.rows(); }
+      int32 segments() const { return 1; }
+      const channel_type* operator()(int32 row, int32) const {
+        return reinterpret_cast<const channel_type*>(&m_image(0, row));
+      }
+  };
+
+  // The rows of the image made of four tiles, [UL, UR, LL, LR], each a
+  // segment of its rows. Missing tiles are transparent.
+  template <class PixelT>
+  class QuadRows {
+      const ImageView<PixelT>* const* m_tiles;
+      int32 m_size;
+    public:
+      typedef typename PixelChannelType<PixelT>::type channel_type;
+      QuadRows(const ImageView<PixelT>* const* tiles, int32 size) : m_tiles(tiles), m_size(size) {}
+      int32 cols() const { return 2 * m_size; }
+      int32 rows() const { return 2 * m_size; }
+      int32 segments() const { return 2; }
+      const channel_type* operator()(int32 row, int32 segment) const {
+        const ImageView<PixelT>& tile = *m_tiles[2 * (row >= m_size) + segment];
+        if (!tile)
+          return 0;
+        return reinterpret_cast<const channel_type*>(&tile(0, row % m_size));
+      }
+  };
+
+  // Halves the source rows into dest, clamping the taps at its edges.
+  template <class PixelT, class RowsT>
+  void downsample_rows(ImageView<PixelT>& dest, RowsT const& src, DownsampleFilter filter) {
+    typedef typename PixelChannelType<PixelT>::type channel_t;
+    typedef typename DownsampleAccum<channel_t>::type accum_t;
+    const int32 channels = PixelNumChannels<PixelT>::value;
+
+    const int32 cols = src.cols(), rows = src.rows();
+    VW_ASSERT(cols % 2 == 0 && rows % 2 == 0,
+              ArgumentErr() << "downsample: " << cols << "x" << rows << " source is not of even size.");
+    const int32 segments = src.segments();
+    const int32 seg_len = cols / segments * channels;
+    dest.set_size(cols / 2, rows / 2);
+    channel_t* out = reinterpret_cast<channel_t*>(dest.data());
+
+    if (filter == POINT_DOWNSAMPLE) {
+      for (int32 j = 0; j < rows / 2; ++j) {
+        for (int32 s = 0; s < segments; ++s) {
+          const channel_t* p = src(2 * j, s);
+          channel_t* o = out + s * seg_len / 2;
+          for (int32 i = 0; i < seg_len / 2; i += channels)
+            for (int32 c = 0; c < channels; ++c)
+              o[i + c] = p ? p[2 * i + c] : channel_t();
+        }
+        out += cols / 2 * channels;
+      }
+      return;
+    }
+
+    static const accum_t box[] = {1, 1}, tent[] = {1, 3, 3, 1};
+    const accum_t* weights = filter == BOX_DOWNSAMPLE ? box : tent;
+    // Taps run from 2x + first
+    const int32 taps = filter == BOX_DOWNSAMPLE ? 2 : 4;
+    const int32 first = filter == BOX_DOWNSAMPLE ? 0 : -1;
+    const int shift = filter == BOX_DOWNSAMPLE ? 2 : 6;
+
+    std::vector<accum_t> acc(cols * channels);
+    for (int32 j = 0; j < rows / 2; ++j) {
+      std::fill(acc.begin(), acc.end(), accum_t());
+      for (int32 k = 0; k < taps; ++k) {
+        const int32 row = std::min(std::max(2 * j + first + k, 0), rows - 1);
+        const accum_t w = weights[k];
+        for (int32 s = 0; s < segments; ++s) {
+          const channel_t* p = src(row, s);
+          if (!p)
+            continue;
+          accum_t* a = &acc[s * seg_len];
+          for (int32 i = 0; i < seg_len; ++i)
+            a[i] += w * accum_t(p[i]);
+        }
+      }
+
+      for (int32 x = 0; x < cols / 2; ++x) {
+        for (int32 c = 0; c < channels; ++c) {
+          accum_t sum = accum_t();
+          for (int32 k = 0; k < taps; ++k) {
+            const int32 col = std::min(std::max(2 * x + first + k, 0), cols - 1);
+            sum += weights[k] * acc[col * channels + c];
+          }
+          out[x * channels + c] = downsample_finish<channel_t>(sum, shift);
+        }
+      }
+      out += cols / 2 * channels;
+    }
+  }
+
+}}} // namespace vw::platefile::detail
+
+#endif
@@ -15,6 +15,8 @@
 #include <vw/Math/BBox.h>
 #include <boost/shared_ptr.hpp>
 #include <list>
+#include <vector>
+#include <utility>
 
 #define VW_PLATE_INDEX_VERSION 3
 
@@ -79,13 +81,22 @@ namespace detail {
     virtual IndexRecord read_request(uint32 col, uint32 row, uint32 depth, TransactionOrNeg transaction_id, bool exact_transaction_match = false) = 0;
 
     /// Writing, pt. 1: Locks a blob and returns the blob id that can
-    /// be used to write a tile.
-    virtual uint32 write_request() = 0;
+    /// be used to write a tile. A writer that names itself keeps getting
+    /// the same blob back until it fills up.
+    virtual uint32 write_request(std::string const& writer = std::string()) = 0;
 
     /// Writing, pt. 2: Supply information to update the index and
     /// unlock the blob id.
     virtual void write_update(TileHeader const& header, IndexRecord const& record) = 0;
 
+    /// Writing, pt. 2, for several tiles at once. The default calls
+    /// write_update() for each; a remote index sends them together.
+    typedef std::pair<TileHeader, IndexRecord> WriteUpdate;
+    virtual void write_updates(std::vector<WriteUpdate> const& updates) {
+      for (size_t i = 0; i < updates.size(); ++i)
+        this->write_update(updates[i].first, updates[i].second);
+    }
+
     /// Writing, pt. 3: Signal the completion of the write operation.
     virtual void write_complete(uint32 blob_id) = 0;
 
@@ -109,6 +120,12 @@ namespace detail {
                                                      TransactionOrNeg start_transaction_id,
                                                      TransactionOrNeg end_transaction_id) const = 0;
 
+    /// Start loading whatever the index needs to look up tiles in this
+    /// region of a level, without waiting for it, so that lookups there
+    /// soon after are fast.  This is only a hint: by default it does
+    /// nothing.
+    virtual void prefetch(uint32 /*level*/, vw::BBox2i const& /*region*/) const {}
+
     virtual IndexHeader index_header() const = 0;
 
     virtual uint32 platefile_id() const = 0;
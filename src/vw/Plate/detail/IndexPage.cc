@@ -10,10 +10,19 @@
 #include <vw/Math/Vector.h>
 #include <vw/Math/BBox.h>
 #include <vw/Core/Debugging.h>
+#include <vw/config.h>
 
 #include <boost/shared_array.hpp>
 #include <boost/foreach.hpp>
 
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+#include <zlib.h>
+#endif
+
 #define WHEREAMI (vw::vw_out(VerboseDebugMessage, "platefile.index") << VW_CURRENT_FUNCTION << ": ")
 using namespace vw;
 using namespace vw::platefile;
@@ -38,38 +47,191 @@ IndexPage::~IndexPage() {
   WHEREAMI << "[" << m_base_col << " " << m_base_row << " @ " << m_level << "]\n";
 }
 
-void IndexPage::serialize(std::ostream& ostr) {
-  WHEREAMI << "[" << m_base_col << " " << m_base_row << " @ " << m_level << "]\n";
+namespace {
+  // A packed page starts with this in place of its width, which no
+  // page in the older format can have.
+  const uint32 PACKED_PAGE_MARKER = 0xffffffff;
+  // Fixed width fields
+  const uint32 PACKED_PAGE_VERSION = 2;
+  // Varints, each field of an entry a delta from the entry before it
+  const uint32 COMPACT_PAGE_VERSION = 3;
+  // A compact page, deflated after the page size
+  const uint32 DEFLATED_PAGE_VERSION = 4;
+
+  // Compact pages smaller than this aren't worth deflating
+  const size_t DEFLATE_MIN_BYTES = 256;
+  // No page's body comes anywhere near this
+  const uint64 MAX_INFLATED_BYTES = 1u << 30;
+
+  // Orders the entries of a slot, which run from the least recent
+  // transaction to the most recent.
+  struct OlderThan {
+    bool operator()(PackedIndexRecord const& elt, TransactionOrNeg const& t) const {
+      return t > elt.transaction_id;
+    }
+    bool operator()(TransactionOrNeg const& t, PackedIndexRecord const& elt) const {
+      return t < elt.transaction_id;
+    }
+    bool operator()(PackedIndexRecord const& elt, uint32 t) const {
+      return elt.transaction_id < t;
+    }
+  };
 
-  // Part 1: Write out the page size
-  ostr.write(reinterpret_cast<char*>(&m_page_width), sizeof(m_page_width));
-  ostr.write(reinterpret_cast<char*>(&m_page_height), sizeof(m_page_height));
+  template <class T>
+  void write_value(std::ostream& ostr, T value) {
+    ostr.write(reinterpret_cast<char*>(&value), sizeof(value));
+  }
 
-  // Part 2: Write the sparsetable metadata
-  m_sparse_table.write_metadata(&ostr);
+  template <class T>
+  void read_value(std::istream& istr, T& value, const char* what) {
+    istr.read(reinterpret_cast<char*>(&value), sizeof(value));
+    VW_ASSERT(istr.good(), IOErr() << "while reading " << what << ".");
+  }
 
-  // Part 3: Write sparse entries
-  for (nonempty_iterator it = m_sparse_table.nonempty_begin(); it != m_sparse_table.nonempty_end(); ++it) {
+  // Seven bits at a time, least significant first, with the high bit
+  // set on all but the last byte.
+  void write_varint(std::ostream& ostr, uint64 value) {
+    while (value >= 0x80) {
+      ostr.put(char(value | 0x80));
+      value >>= 7;
+    }
+    ostr.put(char(value));
+  }
 
-    // Iterate over transaction_id list.
-    uint32 transaction_list_size = boost::numeric_cast<uint32>(it->size());
-    ostr.write(reinterpret_cast<char*>(&transaction_list_size), sizeof(transaction_list_size));
+  uint64 read_varint(std::istream& istr, const char* what) {
+    uint64 value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      int c = istr.get();
+      VW_ASSERT(c != EOF, IOErr() << "while reading " << what << ".");
+      value |= uint64(c & 0x7f) << shift;
+      if (!(c & 0x80))
+        return value;
+    }
+    vw_throw(IOErr() << "while reading " << what << ": varint is too long.");
+    return 0; // never reached
+  }
 
-    multi_value_type::iterator transaction_iter = (*it).begin();
-    while (transaction_iter != (*it).end()) {
+  // Small deltas of either sign become small varints.
+  void write_delta(std::ostream& ostr, int64 delta) {
+    write_varint(ostr, (uint64(delta) << 1) ^ uint64(delta >> 63));
+  }
 
-      // Save the transaction id
-      uint32 t_id = (*transaction_iter).first;
-      ostr.write(reinterpret_cast<char*>(&t_id), sizeof(t_id));
+  int64 read_delta(std::istream& istr, const char* what) {
+    uint64 v = read_varint(istr, what);
+    return int64(v >> 1) ^ -int64(v & 1);
+  }
+}
 
-      // Save the size of each protobuf, and then serialize it to disk.
-      uint16 protobuf_size = boost::numeric_cast<uint16>(transaction_iter->second.ByteSize());
-      boost::shared_array<uint8> protobuf_bytes( new uint8[protobuf_size] );
-      (*transaction_iter).second.SerializeToArray(protobuf_bytes.get(), protobuf_size);
-      ostr.write(reinterpret_cast<char*>(&protobuf_size), sizeof(protobuf_size));
-      ostr.write(reinterpret_cast<char*>(protobuf_bytes.get()), protobuf_size);
+uint32 IndexPage::newest_version() {
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+  return DEFLATED_PAGE_VERSION;
+#else
+  return COMPACT_PAGE_VERSION;
+#endif
+}
 
-      ++transaction_iter;
+void IndexPage::serialize(std::ostream& ostr, uint32 version) {
+  WHEREAMI << "[" << m_base_col << " " << m_base_row << " @ " << m_level << "] version " << version << "\n";
+
+  VW_ASSERT(version >= PACKED_PAGE_VERSION,
+            ArgumentErr() << "IndexPage::serialize(): cannot write index page version " << version << ".");
+  // A reader newer than us gets the newest we have
+  version = std::min(version, newest_version());
+
+  if (version == PACKED_PAGE_VERSION) {
+    serialize_packed(ostr);
+    return;
+  }
+
+  std::ostringstream body(std::ios::binary);
+  serialize_compact(body);
+  const std::string& bytes = body.str();
+
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+  if (version == DEFLATED_PAGE_VERSION && bytes.size() >= DEFLATE_MIN_BYTES) {
+    uLongf size = compressBound(bytes.size());
+    std::vector<Bytef> deflated(size);
+    if (compress2(&deflated[0], &size, reinterpret_cast<const Bytef*>(bytes.data()), bytes.size(), Z_BEST_SPEED) != Z_OK)
+      vw_throw(IOErr() << "IndexPage::serialize(): failed to deflate index page.");
+    if (size < bytes.size()) {
+      write_value(ostr, PACKED_PAGE_MARKER);
+      write_value(ostr, DEFLATED_PAGE_VERSION);
+      write_value(ostr, m_page_width);
+      write_value(ostr, m_page_height);
+      write_varint(ostr, bytes.size());
+      ostr.write(reinterpret_cast<const char*>(&deflated[0]), size);
+      return;
+    }
+  }
+#endif
+
+  write_value(ostr, PACKED_PAGE_MARKER);
+  write_value(ostr, COMPACT_PAGE_VERSION);
+  write_value(ostr, m_page_width);
+  write_value(ostr, m_page_height);
+  ostr.write(bytes.data(), bytes.size());
+}
+
+void IndexPage::serialize_packed(std::ostream& ostr) {
+  // Part 1: Write out the format version and the page size
+  write_value(ostr, PACKED_PAGE_MARKER);
+  write_value(ostr, PACKED_PAGE_VERSION);
+  write_value(ostr, m_page_width);
+  write_value(ostr, m_page_height);
+
+  // Part 2: Write the filetype table
+  write_value(ostr, boost::numeric_cast<uint16>(m_filetypes.size()));
+  BOOST_FOREACH(const std::string& filetype, m_filetypes) {
+    write_value(ostr, boost::numeric_cast<uint16>(filetype.size()));
+    ostr.write(filetype.data(), filetype.size());
+  }
+
+  // Part 3: Write the sparsetable metadata
+  m_sparse_table.write_metadata(&ostr);
+
+  // Part 4: Write sparse entries
+  for (nonempty_iterator it = m_sparse_table.nonempty_begin(); it != m_sparse_table.nonempty_end(); ++it) {
+    write_value(ostr, boost::numeric_cast<uint32>(it->size()));
+    // Most recent first
+    BOOST_FOREACH(const PackedIndexRecord& elt, std::make_pair(it->rbegin(), it->rend())) {
+      write_value(ostr, elt.transaction_id);
+      write_value(ostr, elt.blob_id);
+      write_value(ostr, elt.blob_offset);
+      write_value(ostr, elt.filetype);
+    }
+  }
+}
+
+// Everything after the page size.  Tiles written together sit next to
+// each other in a page and in their blob, so the position of each
+// nonempty slot is written as the gap since the one before it, and each
+// field of an entry as its difference from the entry before it.
+void IndexPage::serialize_compact(std::ostream& ostr) {
+  // Part 1: The filetype table
+  write_varint(ostr, m_filetypes.size());
+  BOOST_FOREACH(const std::string& filetype, m_filetypes) {
+    write_varint(ostr, filetype.size());
+    ostr.write(filetype.data(), filetype.size());
+  }
+
+  // Part 2: The nonempty slots, each with its entries
+  write_varint(ostr, m_sparse_table.num_nonempty());
+  PackedIndexRecord prev = PackedIndexRecord();
+  uint64 next = 0;
+  for (uint64 pos = 0; pos < m_sparse_table.size(); ++pos) {
+    if (!m_sparse_table.test(pos))
+      continue;
+    slot_type const& entries = m_sparse_table.get(pos);
+    write_varint(ostr, pos - next);
+    next = pos + 1;
+    write_varint(ostr, entries.size());
+    BOOST_FOREACH(const PackedIndexRecord& elt, std::make_pair(entries.rbegin(), entries.rend())) {
+      write_delta(ostr, int64(elt.transaction_id) - int64(prev.transaction_id));
+      write_delta(ostr, int64(elt.blob_id) - int64(prev.blob_id));
+      write_delta(ostr, int64(elt.blob_offset - prev.blob_offset));
+      // Leaves 0 for NO_FILETYPE
+      write_varint(ostr, uint16(elt.filetype + 1));
+      prev = elt;
     }
   }
 }
@@ -80,8 +242,139 @@ void IndexPage::deserialize(std::istream& istr) {
 
   VW_ASSERT(istr.good(), IOErr() << "while beginning to deserialize.");
 
+  // Part 1: Read the format version and the page size
+  uint32 marker;
+  read_value(istr, marker, "page size");
+  if (marker != PACKED_PAGE_MARKER) {
+    m_page_width = marker;
+    deserialize_legacy(istr);
+    return;
+  }
+  uint32 version;
+  read_value(istr, version, "page version");
+  if (version < PACKED_PAGE_VERSION || version > newest_version())
+    vw_throw(IOErr() << "unknown index page version " << version << ".");
+  read_value(istr, m_page_width, "page size");
+  read_value(istr, m_page_height, "page size");
+
+  if (version == PACKED_PAGE_VERSION)
+    deserialize_packed(istr);
+  else if (version == COMPACT_PAGE_VERSION)
+    deserialize_compact(istr);
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+  else {
+    uint64 size = read_varint(istr, "inflated page size");
+    VW_ASSERT(size <= MAX_INFLATED_BYTES, IOErr() << "while reading inflated page size: " << size << " is too large.");
+    std::string deflated((std::istreambuf_iterator<char>(istr)), std::istreambuf_iterator<char>());
+    std::string bytes(size, '\0');
+    uLongf inflated = size;
+    if (size && uncompress(reinterpret_cast<Bytef*>(&bytes[0]), &inflated,
+                           reinterpret_cast<const Bytef*>(deflated.data()), deflated.size()) != Z_OK)
+      vw_throw(IOErr() << "while inflating index page.");
+    VW_ASSERT(inflated == size, IOErr() << "while inflating index page: expected " << size << " bytes, got " << inflated << ".");
+    std::istringstream body(bytes, std::ios::binary);
+    deserialize_compact(body);
+    if (body.peek() != EOF)
+      vw_out(WarningMessage, "platefile.index") << "Unparsed data remaining in index page.\n";
+    return;
+  }
+#endif
+
+  if (istr.peek() != EOF)
+    vw_out(WarningMessage, "platefile.index") << "Unparsed data remaining in index page.\n";
+}
+
+void IndexPage::deserialize_packed(std::istream& istr) {
+  // Part 2: Read the filetype table
+  uint16 filetype_count;
+  read_value(istr, filetype_count, "filetype count");
+  m_filetypes.resize(filetype_count);
+  BOOST_FOREACH(std::string& filetype, m_filetypes) {
+    uint16 filetype_size;
+    read_value(istr, filetype_size, "filetype size");
+    filetype.resize(filetype_size);
+    if (filetype_size)
+      istr.read(&filetype[0], filetype_size);
+    VW_ASSERT(istr.good(), IOErr() << "while reading a filetype.");
+  }
+
+  // Part 3: Read the sparsetable metadata
+  if (!m_sparse_table.read_metadata(&istr))
+    vw_throw(IOErr() << "while reading sparse table metadata.");
+
+  VW_ASSERT(istr.good(), IOErr() << "after reading sparse table metadata.");
+
+  // make sure we initialize everything before we continue
+  BOOST_FOREACH(slot_type& x, std::make_pair(m_sparse_table.nonempty_begin(), m_sparse_table.nonempty_end()))
+    new (&x) slot_type();
+
+  // Part 4: Read sparse entries
+  BOOST_FOREACH(slot_type& x, std::make_pair(m_sparse_table.nonempty_begin(), m_sparse_table.nonempty_end())) {
+    uint32 transaction_list_size;
+    read_value(istr, transaction_list_size, "transaction list size");
+    x.resize(transaction_list_size);
+    BOOST_FOREACH(PackedIndexRecord& elt, std::make_pair(x.rbegin(), x.rend())) {
+      read_value(istr, elt.transaction_id, "a transaction id");
+      read_value(istr, elt.blob_id, "a blob id");
+      read_value(istr, elt.blob_offset, "a blob offset");
+      read_value(istr, elt.filetype, "a filetype index");
+      if (elt.filetype != PackedIndexRecord::NO_FILETYPE && elt.filetype >= m_filetypes.size())
+        vw_throw(IOErr() << "while reading a filetype index: " << elt.filetype << " is out of range.");
+    }
+  }
+}
+
+void IndexPage::deserialize_compact(std::istream& istr) {
+  // Part 1: Read the filetype table
+  uint64 filetype_count = read_varint(istr, "filetype count");
+  VW_ASSERT(filetype_count <= PackedIndexRecord::NO_FILETYPE,
+            IOErr() << "while reading filetype count: " << filetype_count << " is too many.");
+  m_filetypes.resize(filetype_count);
+  BOOST_FOREACH(std::string& filetype, m_filetypes) {
+    uint64 filetype_size = read_varint(istr, "filetype size");
+    VW_ASSERT(filetype_size <= 0xffff, IOErr() << "while reading filetype size: " << filetype_size << " is too long.");
+    filetype.resize(filetype_size);
+    if (filetype_size)
+      istr.read(&filetype[0], filetype_size);
+    VW_ASSERT(istr.good(), IOErr() << "while reading a filetype.");
+  }
+
+  // Part 2: Read the nonempty slots
+  m_sparse_table.clear();
+  m_sparse_table.resize(uint64(m_page_width) * m_page_height);
+  uint64 slot_count = read_varint(istr, "slot count");
+  VW_ASSERT(slot_count <= m_sparse_table.size(),
+            IOErr() << "while reading slot count: " << slot_count << " is more than the page holds.");
+  PackedIndexRecord prev = PackedIndexRecord();
+  uint64 next = 0;
+  for (uint64 i = 0; i < slot_count; ++i) {
+    uint64 pos = next + read_varint(istr, "a slot position");
+    VW_ASSERT(pos < m_sparse_table.size(),
+              IOErr() << "while reading a slot position: " << pos << " is out of range.");
+    next = pos + 1;
+    uint64 transaction_list_size = read_varint(istr, "transaction list size");
+    VW_ASSERT(transaction_list_size <= 0xffffffff,
+              IOErr() << "while reading transaction list size: " << transaction_list_size << " is too large.");
+    slot_type& x = m_sparse_table.set(pos, slot_type());
+    x.resize(transaction_list_size);
+    BOOST_FOREACH(PackedIndexRecord& elt, std::make_pair(x.rbegin(), x.rend())) {
+      elt.transaction_id = uint32(prev.transaction_id + read_delta(istr, "a transaction id"));
+      elt.blob_id = int32(prev.blob_id + read_delta(istr, "a blob id"));
+      elt.blob_offset = prev.blob_offset + uint64(read_delta(istr, "a blob offset"));
+      elt.filetype = uint16(read_varint(istr, "a filetype index") - 1);
+      if (elt.filetype != PackedIndexRecord::NO_FILETYPE && elt.filetype >= m_filetypes.size())
+        vw_throw(IOErr() << "while reading a filetype index: " << elt.filetype << " is out of range.");
+      prev = elt;
+    }
+  }
+}
+
+// Reads the rest of a page written before slots were packed, in which
+// each entry is a serialized IndexRecord.  The page width has already
+// been read.
+void IndexPage::deserialize_legacy(std::istream& istr) {
+
   // Part 1: Read the page size
-  istr.read(reinterpret_cast<char*>(&m_page_width), sizeof(m_page_width));
   istr.read(reinterpret_cast<char*>(&m_page_height), sizeof(m_page_height));
 
   VW_ASSERT(istr.good(), IOErr() << "while reading page size.");
@@ -93,13 +386,13 @@ void IndexPage::deserialize(std::istream& istr) {
   VW_ASSERT(istr.good(), IOErr() << "after reading sparse table metadata.");
 
   // make sure we initialize everything before we continue
-  BOOST_FOREACH(multi_value_type& x, std::make_pair(m_sparse_table.nonempty_begin(), m_sparse_table.nonempty_end()))
-    new (&x) multi_value_type();
+  BOOST_FOREACH(slot_type& x, std::make_pair(m_sparse_table.nonempty_begin(), m_sparse_table.nonempty_end()))
+    new (&x) slot_type();
 
   size_t count = 0, total = m_sparse_table.num_nonempty();
 
   // Part 3: Read sparse entries
-  BOOST_FOREACH(multi_value_type& x, std::make_pair(m_sparse_table.nonempty_begin(), m_sparse_table.nonempty_end())) {
+  BOOST_FOREACH(slot_type& x, std::make_pair(m_sparse_table.nonempty_begin(), m_sparse_table.nonempty_end())) {
     if (count++ % 4000 == 0)
       WHEREAMI << "reading tile slot " << count << " of " << total << std::endl;
     // Iterate over transaction_id list.
@@ -108,6 +401,7 @@ void IndexPage::deserialize(std::istream& istr) {
 
     VW_ASSERT(istr.good(), IOErr() << "while reading transaction list size.");
 
+    x.reserve(transaction_list_size);
     for (uint32 tid = 0; tid < transaction_list_size; ++tid) {
 
       // Read the transaction id
@@ -129,14 +423,68 @@ void IndexPage::deserialize(std::istream& istr) {
       if (!rec.ParseFromArray(protobuf_bytes.get(), protobuf_size))
         vw_throw(IOErr() << "while parsing a message.");
 
-      x.push_back(value_type(t_id, rec));
+      PackedIndexRecord elt;
+      elt.transaction_id = t_id;
+      elt.blob_id = rec.blob_id();
+      elt.blob_offset = rec.blob_offset();
+      elt.filetype = intern_filetype(rec);
+      x.push_back(elt);
     }
+    // Written most recent first
+    std::reverse(x.begin(), x.end());
   }
 
   if (istr.peek() != EOF)
     vw_out(WarningMessage, "platefile.index") << "Unparsed data remaining in index page.\n";
 }
 
+uint16 IndexPage::intern_filetype(IndexRecord const& record) {
+  if (!record.has_filetype())
+    return PackedIndexRecord::NO_FILETYPE;
+  // Pages hold only a handful of distinct filetypes.
+  for (size_t i = 0; i < m_filetypes.size(); ++i)
+    if (m_filetypes[i] == record.filetype())
+      return boost::numeric_cast<uint16>(i);
+  VW_ASSERT(m_filetypes.size() < PackedIndexRecord::NO_FILETYPE,
+            LogicErr() << "Too many filetypes in one index page.");
+  m_filetypes.push_back(record.filetype());
+  return boost::numeric_cast<uint16>(m_filetypes.size() - 1);
+}
+
+IndexRecord IndexPage::unpack(PackedIndexRecord const& elt) const {
+  IndexRecord rec;
+  rec.set_blob_id(elt.blob_id);
+  rec.set_blob_offset(elt.blob_offset);
+  if (elt.filetype != PackedIndexRecord::NO_FILETYPE)
+    rec.set_filetype(m_filetypes[elt.filetype]);
+  return rec;
+}
+
+IndexPage::slot_type::const_iterator
+IndexPage::find_at_or_before(slot_type const& entries, TransactionOrNeg transaction_id) {
+  if (entries.empty())
+    return entries.end();
+  // Most reads are of the latest entry
+  if (!(transaction_id < entries.back().transaction_id))
+    return entries.end() - 1;
+  slot_type::const_iterator it = std::upper_bound(entries.begin(), entries.end(), transaction_id, OlderThan());
+  return it == entries.begin() ? entries.end() : it - 1;
+}
+
+IndexPage::slot_range
+IndexPage::find_range(slot_type const& entries, TransactionOrNeg begin_transaction_id, TransactionOrNeg end_transaction_id) {
+  if (entries.empty())
+    return slot_range(entries.rbegin(), entries.rend());
+  if (begin_transaction_id.newest() && end_transaction_id.newest())
+    return slot_range(entries.rbegin(), entries.rbegin() + 1);
+
+  slot_type::const_iterator last = entries.end();
+  if (end_transaction_id < entries.back().transaction_id)
+    last = std::upper_bound(entries.begin(), entries.end(), end_transaction_id, OlderThan());
+  slot_type::const_iterator first = std::lower_bound(entries.begin(), last, begin_transaction_id, OlderThan());
+  return slot_range(slot_type::const_reverse_iterator(last), slot_type::const_reverse_iterator(first));
+}
+
 // ----------------------- ACCESSORS  ----------------------
 
 void IndexPage::set(TileHeader const& header, IndexRecord const& record) {
@@ -144,39 +492,34 @@ void IndexPage::set(TileHeader const& header, IndexRecord const& record) {
   uint32 page_col = header.col() % m_page_width;
   uint32 page_row = header.row() % m_page_height;
 
-  value_type p(header.transaction_id(), record);
+  PackedIndexRecord p;
+  p.transaction_id = header.transaction_id();
+  p.blob_id = record.blob_id();
+  p.blob_offset = record.blob_offset();
+  p.filetype = intern_filetype(record);
+
   uint32 elmnt = page_row*m_page_width + page_col;
   if (m_sparse_table.test(elmnt)) {
 
-    // Add to existing entry.
-    multi_value_type *entries = m_sparse_table[elmnt].operator&();
-
-    // We need to keep this list sorted in decreasing order of
-    // transaction ID, do a simple insertion sort here.
-    multi_value_type::iterator it = entries->begin();
-    while (it != entries->end() && (*it).first >= header.transaction_id() ) {
-
-      // Handle the case where we replace an entry
-      if ( (*it).first == header.transaction_id() ) {
-        (*it).second = record;
-        return;
-      }
-
-      // Otherwise, we search forward in the list.
-      ++it;
+    // Add to existing entry, keeping the entries sorted in increasing
+    // order of transaction ID.  The new entry is usually the latest.
+    slot_type *entries = m_sparse_table[elmnt].operator&();
+    if (entries->empty() || entries->back().transaction_id < p.transaction_id) {
+      entries->push_back(p);
+      return;
     }
+    slot_type::iterator it = std::lower_bound(entries->begin(), entries->end(), p.transaction_id, OlderThan());
 
-    // If we reach this point, we are either at the end of the list,
-    // or we have found the correct position.  Either way, we call
-    // insert().
-    entries->insert(it, p);
+    // Handle the case where we replace an entry
+    if (it != entries->end() && it->transaction_id == p.transaction_id)
+      *it = p;
+    else
+      entries->insert(it, p);
 
   } else {
 
     // Create a new entry
-    multi_value_type l;
-    l.push_front(p);
-    m_sparse_table[elmnt] = l;
+    m_sparse_table[elmnt] = slot_type(1, p);
 
   }
 }
@@ -200,38 +543,22 @@ IndexRecord IndexPage::get(uint32 col, uint32 row, TransactionOrNeg transaction_
   uint32 page_col = col % m_page_width;
   uint32 page_row = row % m_page_height;
 
-  // Interate over entries.
-  multi_value_type const& entries = m_sparse_table[page_row*m_page_width + page_col];
-  multi_value_type::const_iterator it = entries.begin();
+  slot_type const& entries = m_sparse_table[page_row*m_page_width + page_col];
 
-  if ( it == entries.end() )
+  if ( entries.empty() )
     vw_throw(TileNotFoundErr() << "No Tiles exist at this location.");
 
   // A transaction ID of -1 indicates that we should return the most
-  // recent tile (which is the first entry in the list, since it is
-  // sorted from most recent to least recent), regardless of its
-  // transaction id.
+  // recent tile (which is the last entry, since they are sorted from
+  // least recent to most recent), regardless of its transaction id.
   if (transaction_id_neg.newest())
-    return (*it).second;
+    return unpack(entries.back());
 
   Transaction transaction_id = transaction_id_neg.promote();
 
-  // Otherwise, we search through the entries in the list, looking for
-  // the requested t_id.  Note: this search is O(n), so it can be slow
-  // if there are a lot of entries and the entry you are looking for
-  // is near the end.  However, most pages will contain very few
-  // entries, and for those with many entries (i.e. tiles near the
-  // root of the mosaic), you will rarely search for old tiles.
-  while (it != entries.end()) {
-    if (exact_match) {
-      if ((*it).first == transaction_id)
-        return (*it).second;
-    } else {
-      if ((*it).first <= transaction_id)
-        return (*it).second;
-    }
-    ++it;
-  }
+  slot_type::const_iterator it = find_at_or_before(entries, transaction_id);
+  if (it != entries.end() && (!exact_match || it->transaction_id == transaction_id))
+    return unpack(*it);
 
   // If we reach this point, then there are no entries before
   // the given transaction_id, so we return an empty (and invalid) record.
@@ -247,45 +574,19 @@ IndexPage::multi_get(uint32 col, uint32 row,
   uint32 page_col = col % m_page_width;
   uint32 page_row = row % m_page_height;
 
-  // Interate over entries.
-  multi_value_type const& entries = m_sparse_table[page_row*m_page_width + page_col];
-  multi_value_type::const_iterator it = entries.begin();
+  slot_type const& entries = m_sparse_table[page_row*m_page_width + page_col];
 
-  if ( it == entries.end() )
+  if ( entries.empty() )
     vw_throw(TileNotFoundErr() << "No Tiles exist at this location.");
-  if ( begin_transaction_id <= 1 && end_transaction_id == detail::MAX_TRANSACTION )
-    return entries;
 
   multi_value_type result;
-  if ( begin_transaction_id.newest() && end_transaction_id.newest() ) {
-    // Pull only the top most transaction
-    result.push_back( *it );
-    return result;
-  } else {
-    // Pull only items that our in our transaction range
-    BOOST_FOREACH(const value_type& elt, entries ) {
-      if ( elt.first < begin_transaction_id )
-        break;
-      if ( elt.first <= end_transaction_id)
-        result.push_back(elt);
-    }
-  }
+  slot_range range = find_range(entries, begin_transaction_id, end_transaction_id);
+  for (slot_type::const_reverse_iterator it = range.first; it != range.second; ++it)
+    result.push_back(value_type(it->transaction_id, unpack(*it)));
 
   return result;
 }
 
-void IndexPage::append_if_in_region( std::list<TileHeader> &results,
-                                     multi_value_type const& candidates,
-                                     uint32 col, uint32 row, BBox2i const& region) const {
-
-  BOOST_FOREACH(const value_type& t, candidates) {
-    Vector2i loc( m_base_col + col, m_base_row + row);
-    if ( region.contains( loc ) )
-      results.push_back(hdr_from_index(col, row, t));
-  }
-  // Check to see if the tile is in the specified region.
-}
-
 /// Returns a list of valid tiles in this IndexPage.  Returns a list
 /// of TileHeaders with col/row/level and transaction_id of the most
 /// recent tile at each valid location.  Note: there may be other
@@ -310,36 +611,17 @@ IndexPage::search_by_region(BBox2i const& region,
   std::list<TileHeader> results;
   for (uint32 row = 0; row < m_page_height; ++row) {
     for (uint32 col = 0; col < m_page_width; ++col) {
-      if (m_sparse_table.test(row*m_page_width + col)) {
-
-        // Iterate over entries.
-        multi_value_type const& entries = m_sparse_table[row*m_page_width + col];
-        multi_value_type candidates;
-
-        if (start_transaction_id.newest() && end_transaction_id.newest()) {
-          // If the user has specified a transaction range of [-1, -1],
-          // then we only return the last valid tile.
-          if (entries.size() > 0)
-            candidates.push_back( *(entries.begin()) );
-        } else {
-          // Search through the entries in the list, looking entries
-          // that match the requested transaction_id range.  Note: this
-          // search is O(n), so it can be slow if there are a lot of
-          // entries and the entry you are looking for is near the end.
-          // However, most pages will contain very few entries, and for
-          // those with many entries (i.e. tiles near the root of the
-          // mosaic), you will most likely be searching for recently
-          // added tiles, which are sorted to the beginning.
-          BOOST_FOREACH(const value_type& elt, entries) {
-            if (elt.first < start_transaction_id)
-              break;
-            if (elt.first <= end_transaction_id)
-              candidates.push_back(elt);
-          }
-        }
-
-        append_if_in_region( results, candidates, col, row, region );
-      }
+      if (!m_sparse_table.test(row*m_page_width + col))
+        continue;
+
+      // Check to see if the tile is in the specified region.
+      if (!region.contains( Vector2i(m_base_col + col, m_base_row + row) ))
+        continue;
+
+      slot_type const& entries = m_sparse_table[row*m_page_width + col];
+      slot_range range = find_range(entries, start_transaction_id, end_transaction_id);
+      for (slot_type::const_reverse_iterator it = range.first; it != range.second; ++it)
+        results.push_back(hdr_from_index(col, row, *it));
     }
   }
 
@@ -365,20 +647,24 @@ IndexPage::search_by_location(uint32 col, uint32 row,
   if (!m_sparse_table.test(page_row*m_page_width + page_col))
     return results;
 
-  multi_value_type const& entries = m_sparse_table[page_row*m_page_width + page_col];
-  if (entries.size() == 0)
-    return results;
-
-  if (start_transaction_id.newest() && end_transaction_id.newest())
-    results.push_back(hdr_from_index(page_col, page_row, *entries.begin()));
-  else {
-    BOOST_FOREACH(const value_type& elt, entries) {
-      if (elt.first < start_transaction_id)
-        break;
-      if (elt.first <= end_transaction_id)
-        results.push_back(hdr_from_index(page_col, page_row, elt));
-    }
-  }
+  slot_type const& entries = m_sparse_table[page_row*m_page_width + page_col];
+  slot_range range = find_range(entries, start_transaction_id, end_transaction_id);
+  for (slot_type::const_reverse_iterator it = range.first; it != range.second; ++it)
+    results.push_back(hdr_from_index(page_col, page_row, *it));
 
   return results;
 }
+
+// ----------------------------------------------------------------------
+//                       INDEX PAGE GENERATOR
+// ----------------------------------------------------------------------
+
+std::vector<boost::shared_ptr<IndexPage> >
+PageGeneratorFactory::generate_pages(uint32 level, std::vector<Vector2i> const& bases,
+                                     uint32 page_width, uint32 page_height) {
+  std::vector<boost::shared_ptr<IndexPage> > pages;
+  pages.reserve(bases.size());
+  BOOST_FOREACH(const Vector2i& base, bases)
+    pages.push_back(this->create(level, base.x(), base.y(), page_width, page_height)->generate());
+  return pages;
+}
@@ -17,6 +17,7 @@
 #include <boost/shared_ptr.hpp>
 #include <string>
 #include <list>
+#include <vector>
 
 namespace vw {
 namespace platefile {
@@ -26,30 +27,66 @@ namespace detail {
   //                            INDEX PAGE
   // ----------------------------------------------------------------------
 
+  /// One entry in the history of a tile: an IndexRecord and its
+  /// transaction id, with the filetype replaced by its index in the
+  /// page's table of filetypes.
+  struct PackedIndexRecord {
+    uint64 blob_offset;
+    uint32 transaction_id;
+    int32 blob_id;
+    uint16 filetype;
+
+    /// The filetype index of a record without a filetype.
+    static const uint16 NO_FILETYPE = 0xffff;
+  };
+
   class IndexPage {
 
   public:
     typedef std::pair<uint32, IndexRecord> value_type;
     typedef std::list<value_type> multi_value_type;
-    typedef google::sparsetable<multi_value_type>::nonempty_iterator nonempty_iterator;
+
+    /// The history of one tile, sorted from least recent to most
+    /// recent transaction id, so that the latest entry is found, and a
+    /// newer one added, at the back.
+    typedef std::vector<PackedIndexRecord> slot_type;
+    /// Entries of a slot from most recent to least recent.
+    typedef std::pair<slot_type::const_reverse_iterator, slot_type::const_reverse_iterator> slot_range;
+    typedef google::sparsetable<slot_type>::nonempty_iterator nonempty_iterator;
 
   protected:
     uint32 m_level, m_base_col, m_base_row;
     uint32 m_page_width, m_page_height;
-    google::sparsetable<multi_value_type> m_sparse_table;
+    google::sparsetable<slot_type> m_sparse_table;
+    std::vector<std::string> m_filetypes;
+
+    uint16 intern_filetype(IndexRecord const& record);
+
+    /// The most recent entry in the slot whose transaction id is no
+    /// greater than the given one, or end() if there is none.  The
+    /// latest entry is checked first, and the rest found by binary
+    /// search.
+    static slot_type::const_iterator find_at_or_before(slot_type const& entries, TransactionOrNeg transaction_id);
 
-    void append_if_in_region( std::list<TileHeader> &results,
-                              multi_value_type const& candidates,
-                              uint32 col, uint32 row, BBox2i const& region) const;
+    /// The entries in the slot in the transaction id range, or just
+    /// the most recent one if both ends of the range are negative.
+    /// Both ends are found by binary search.
+    static slot_range find_range(slot_type const& entries, TransactionOrNeg begin_transaction_id, TransactionOrNeg end_transaction_id);
 
-    TileHeader hdr_from_index(uint32 rel_col, uint32 rel_row, const value_type& elt) const {
+    void serialize_packed(std::ostream& ostr);
+    void serialize_compact(std::ostream& ostr);
+    void deserialize_packed(std::istream& istr);
+    void deserialize_compact(std::istream& istr);
+    void deserialize_legacy(std::istream& istr);
+
+    TileHeader hdr_from_index(uint32 rel_col, uint32 rel_row, const PackedIndexRecord& elt) const {
       TileHeader hdr;
       hdr.set_col( m_base_col + rel_col );
       hdr.set_row( m_base_row + rel_row );
       hdr.set_level(m_level);
-      hdr.set_transaction_id(elt.first);
-      if (elt.second.has_filetype())
-        hdr.set_filetype(elt.second.filetype());
+      hdr.set_transaction_id(elt.transaction_id);
+      if (elt.filetype != PackedIndexRecord::NO_FILETYPE)
+        hdr.set_filetype(m_filetypes[elt.filetype]);
       return hdr;
     }
 
@@ -64,10 +101,22 @@ namespace detail {
     /// Save any unsaved changes to disk.
     virtual void sync() = 0;
 
+    /// The newest page format this build reads and writes: 3 for
+    /// varint, delta encoded entries, or 4 for those deflated when
+    /// built with zlib.  Version 2 has fixed width entries.
+    static uint32 newest_version();
+
     // For reading/writing to/from disk or a network byte stream.
-    void serialize(std::ostream& ostr);
+    // Pages are written in the given format, or the newest this build
+    // has if the given one is newer, so that a reader can ask for one
+    // it understands.  Every format since the one used before slots were
+    // packed is read.
+    void serialize(std::ostream& ostr, uint32 version = newest_version());
     void deserialize(std::istream& istr);
 
+    /// Expand a packed entry of this page back into an IndexRecord.
+    IndexRecord unpack(PackedIndexRecord const& elt) const;
+
     // ----------------------- ITERATORS  ----------------------
 
     nonempty_iterator begin() { return m_sparse_table.nonempty_begin(); }
@@ -153,6 +202,14 @@ namespace detail {
     virtual boost::shared_ptr<PageGeneratorBase>
       create(uint32 level, uint32 base_col, uint32 base_row,
              uint32 page_width, uint32 page_height) = 0;
+
+    /// Generate the pages at several (base col, base row) locations of
+    /// a level at once.  Factories whose pages come from far away
+    /// override this to fetch them together; by default each page is
+    /// generated in turn.
+    virtual std::vector<boost::shared_ptr<IndexPage> >
+      generate_pages(uint32 level, std::vector<Vector2i> const& bases,
+                     uint32 page_width, uint32 page_height);
     // Who is this factory manufacturing pages for? (human-readable)
     virtual std::string who() const = 0;
   };
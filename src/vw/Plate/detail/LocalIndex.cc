@@ -405,8 +405,8 @@ Transaction LocalIndex::transaction_request(std::string transaction_description,
 // -----------------------    I/O      ----------------------
 
 /// Writing, pt. 1: Reserve a blob lock
-uint32 LocalIndex::write_request() {
-  return m_blob_manager->request_lock();
+uint32 LocalIndex::write_request(std::string const& writer) {
+  return m_blob_manager->request_lock(writer);
 }
 
 /// Writing, pt. 1: Reserve a blob lock
@@ -426,6 +426,15 @@ void LocalIndex::write_update(TileHeader const& header, IndexRecord const& recor
   }
 }
 
+void LocalIndex::write_updates(std::vector<WriteUpdate> const& updates) {
+  size_t starting_size = m_levels.size();
+  PagedIndex::write_updates(updates);
+  if (m_levels.size() != starting_size) {
+    m_header.set_num_levels(boost::numeric_cast<uint32>(m_levels.size()));
+    this->save_index_file();
+  }
+}
+
 /// Writing, pt. 3: Signal the completion
 void LocalIndex::write_complete(uint32 blob_id) {
   m_blob_manager->release_lock(blob_id);
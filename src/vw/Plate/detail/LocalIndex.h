@@ -127,11 +127,12 @@ namespace detail {
 
     // Writing, pt. 1: Locks a blob and returns the blob id that can
     // be used to write a tile.
-    virtual uint32 write_request();
+    virtual uint32 write_request(std::string const& writer = std::string());
 
     // Writing, pt. 2: Supply information to update the index and
     // unlock the blob id.
     virtual void write_update(TileHeader const& header, IndexRecord const& record);
+    virtual void write_updates(std::vector<WriteUpdate> const& updates);
 
     /// Writing, pt. 3: Signal the completion
     virtual void write_complete(uint32 blob_id);
@@ -10,6 +10,9 @@
 #include <vw/Core/Debugging.h>
 
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+
+#include <algorithm>
 
 using namespace vw;
 using namespace vw::platefile;
@@ -25,19 +28,20 @@ using namespace vw::platefile::detail;
 IndexLevel::IndexLevel(boost::shared_ptr<PageGeneratorFactory> page_gen_factory,
                        uint32 level, uint32 page_width, uint32 page_height, uint32 cache_size)
   : m_page_gen_factory(page_gen_factory), m_level(level),
-    m_page_width(page_width), m_page_height(page_height), m_cache(cache_size) {
+    m_page_width(page_width), m_page_height(page_height),
+    m_cache_size(std::max<uint32>(cache_size, 1)), m_clock_hand(0),
+    m_misses(0), m_evictions(0) {
 
   uint32 tiles_per_side = 1 << level;
   m_horizontal_pages = static_cast<uint32>(ceil(float(tiles_per_side) / float(page_width)));
   m_vertical_pages   = static_cast<uint32>(ceil(float(tiles_per_side) / float(page_height)));
 
-  // Create space for cache handles.  The actual generators are not
-  // created until they are needed (because they take enough memory
-  // that it's not efficient to allocate the generators ahead of
-  // time).  Actual allocation is done automatically by calling
-  // load_cache_handle().
+  // Create empty slots for the pages.  The pages themselves are not
+  // loaded until they are needed, by load_page().  The slots are
+  // never resized, so readers can use them without a lock.
   uint32 pages = m_horizontal_pages * m_vertical_pages;
-  m_cache_handles.resize(pages);
+  m_pages.resize(pages);
+  m_referenced.resize(pages, 0);
 }
 
 uint32 IndexLevel::page_id(uint32 col, uint32 row) const {
@@ -69,42 +73,116 @@ namespace {
 boost::shared_ptr<IndexPage> IndexLevel::load_page(uint32 col, uint32 row) const {
   size_t idx = boost::numeric_cast<size_t>(this->page_id(col,row));
 
-  Mutex::Lock lock(m_cache_mutex);
-  // We may need to actually create the page's cache handle if it
-  // hasn't been created already.
-  if ( !m_cache_handles[idx].attached() ) {
-    // the args to create here are the base col and row, so (col / m_page_width) * m_page_width
-    boost::shared_ptr<PageGeneratorBase> generator =
-      m_page_gen_factory->create(m_level, floorto(col, m_page_width), floorto(row, m_page_height), m_page_width, m_page_height);
-      m_cache_handles[idx] = m_cache.insert( generator );
+  // The common case: the page is resident.
+  boost::shared_ptr<IndexPage> page = boost::atomic_load(&m_pages[idx]);
+  if (page) {
+    if (!m_referenced[idx])
+      m_referenced[idx] = 1;
+    return page;
   }
-  return m_cache_handles[idx];
+
+  Mutex::Lock lock(m_load_mutex);
+  // Another thread may have loaded the page while we waited.
+  page = boost::atomic_load(&m_pages[idx]);
+  if (page)
+    return page;
+
+  ++m_misses;
+  while (m_resident.size() >= m_cache_size)
+    evict_page();
+
+  // the args to create here are the base col and row, so (col / m_page_width) * m_page_width
+  boost::shared_ptr<PageGeneratorBase> generator =
+    m_page_gen_factory->create(m_level, floorto(col, m_page_width), floorto(row, m_page_height), m_page_width, m_page_height);
+  page = generator->generate();
+  m_referenced[idx] = 1;
+  boost::atomic_store(&m_pages[idx], page);
+  m_resident.push_back(boost::numeric_cast<uint32>(idx));
+  return page;
 }
 
+// Drops the first resident page that has not been used since the
+// clock hand last passed it, saving it first so that loading it again
+// sees its changes even while an earlier reader still holds it.
+// Called with the load lock held.
+void IndexLevel::evict_page() const {
+  for (;;) {
+    if (m_clock_hand >= m_resident.size())
+      m_clock_hand = 0;
+    uint32 idx = m_resident[m_clock_hand];
+    if (m_referenced[idx]) {
+      m_referenced[idx] = 0;
+      ++m_clock_hand;
+      continue;
+    }
+    boost::shared_ptr<IndexPage> page = boost::atomic_exchange(&m_pages[idx], boost::shared_ptr<IndexPage>());
+    if (page)
+      page->sync();
+    m_resident[m_clock_hand] = m_resident.back();
+    m_resident.pop_back();
+    ++m_evictions;
+    return;
+  }
+}
+
+void IndexLevel::prefetch_pages(std::vector<Vector2i> const& tiles, PageGeneratorFactory& factory) const {
+  Mutex::Lock lock(m_load_mutex);
+
+  std::vector<uint32> missing;
+  std::vector<Vector2i> bases;
+  BOOST_FOREACH(const Vector2i& tile, tiles) {
+    uint32 idx = this->page_id(tile.x(), tile.y());
+    if (boost::atomic_load(&m_pages[idx])) {
+      m_referenced[idx] = 1;
+      continue;
+    }
+    if (std::find(missing.begin(), missing.end(), idx) != missing.end())
+      continue;
+    missing.push_back(idx);
+    bases.push_back(Vector2i(floorto(uint32(tile.x()), m_page_width), floorto(uint32(tile.y()), m_page_height)));
+  }
+  if (missing.empty())
+    return;
+
+  m_misses += missing.size();
+  while (!m_resident.empty() && m_resident.size() + missing.size() > m_cache_size)
+    evict_page();
+
+  std::vector<boost::shared_ptr<IndexPage> > pages =
+    factory.generate_pages(m_level, bases, m_page_width, m_page_height);
+  VW_ASSERT(pages.size() == missing.size(),
+            LogicErr() << "IndexLevel: generated " << pages.size() << " pages of " << missing.size() << ".");
+  for (size_t i = 0; i < missing.size(); ++i) {
+    m_referenced[missing[i]] = 1;
+    boost::atomic_store(&m_pages[missing[i]], pages[i]);
+    m_resident.push_back(missing[i]);
+  }
+}
 
 IndexLevel::~IndexLevel() {
-  Mutex::Lock lock(m_cache_mutex);
+  Mutex::Lock lock(m_load_mutex);
 
-  // Make sure the handles drop out of cache
-  BOOST_FOREACH( handle_t& h, m_cache_handles )
-    h.reset();
+  // Make sure the pages are released
+  BOOST_FOREACH( uint32 idx, m_resident )
+    boost::atomic_store(&m_pages[idx], boost::shared_ptr<IndexPage>());
+  m_resident.clear();
 }
 
 void IndexLevel::sync() {
-  Mutex::Lock lock(m_cache_mutex);
+  Mutex::Lock lock(m_load_mutex);
 
   vw_out(VerboseDebugMessage, "platefile.cache")
     << "Page cache for " << m_page_gen_factory->who() << "@" << m_level << " reports "
-    << "hits["   << m_cache.hits()
-    << "] misses[" << m_cache.misses()
-    << "] evictions[" << m_cache.evictions() << "] since last sync." << std::endl;
+    << "misses[" << m_misses
+    << "] evictions[" << m_evictions << "] since last sync." << std::endl;
 
-  m_cache.clear_stats();
+  m_misses = m_evictions = 0;
 
   // Write the index pages to disk by calling their sync() methods.
-  BOOST_FOREACH( handle_t& h, m_cache_handles ) {
-    if (h.attached() && h.valid())
-      h->sync();
+  BOOST_FOREACH( uint32 idx, m_resident ) {
+    boost::shared_ptr<IndexPage> page = boost::atomic_load(&m_pages[idx]);
+    if (page)
+      page->sync();
   }
 }
 
@@ -120,18 +198,30 @@ void IndexLevel::set(TileHeader const& header, IndexRecord const& rec) {
   page->set(header, rec);
 }
 
+void IndexLevel::set(std::vector<Index::WriteUpdate> const& updates) {
+  // Sorting on (page, position) keeps the updates to each node in order
+  std::vector<std::pair<uint32, size_t> > order;
+  order.reserve(updates.size());
+  for (size_t i = 0; i < updates.size(); ++i)
+    order.push_back(std::make_pair(page_id(updates[i].first.col(), updates[i].first.row()), i));
+  std::sort(order.begin(), order.end());
+
+  boost::shared_ptr<IndexPage> page;
+  for (size_t i = 0; i < order.size(); ++i) {
+    const Index::WriteUpdate& update = updates[order[i].second];
+    if (!page || order[i].first != order[i-1].first)
+      page = load_page(update.first.col(), update.first.row());
+    page->set(update.first, update.second);
+  }
+}
+
 namespace {
   uint32 round_to(uint32 val, uint32 stride) {
     return (val / stride) * stride;
   }
 }
 
-/// Returns a list of valid tiles at this level.
-std::list<TileHeader>
-IndexLevel::search_by_region(BBox2i const& region,
-                             TransactionOrNeg start_transaction_id,
-                             TransactionOrNeg end_transaction_id) const {
-
+std::vector<Vector2i> IndexLevel::region_pages(BBox2i const& region) const {
   // Start by computing the search range in pages based on the requested region.
   uint32 min_level_col = round_to(region.min().x(), m_page_width);
   uint32 min_level_row = round_to(region.min().y(), m_page_height);
@@ -141,11 +231,45 @@ IndexLevel::search_by_region(BBox2i const& region,
 
   WHEREAMI << "[" << min_level_col << " " << min_level_row << "]" << " to [" << max_level_col << " " << max_level_row << "]\n";
 
-  // Iterate over the pages that overlap with the region of interest.
+  std::vector<Vector2i> locations;
+  for (uint32 level_row = min_level_row; level_row < max_level_row; level_row += m_page_height)
+    for (uint32 level_col = min_level_col; level_col < max_level_col; level_col += m_page_width)
+      locations.push_back(Vector2i(level_col, level_row));
+  return locations;
+}
+
+void IndexLevel::prefetch_region(BBox2i const& region, PageGeneratorFactory& factory) const {
+  BBox2i r(region);
+  r.crop(BBox2i(0, 0, 1 << m_level, 1 << m_level));
+  if (r.empty())
+    return;
+
+  std::vector<Vector2i> locations = region_pages(r);
+  if (locations.size() > m_cache_size)
+    locations.resize(m_cache_size);
+  prefetch_pages(locations, factory);
+}
+
+/// Returns a list of valid tiles at this level.
+std::list<TileHeader>
+IndexLevel::search_by_region(BBox2i const& region,
+                             TransactionOrNeg start_transaction_id,
+                             TransactionOrNeg end_transaction_id) const {
+
+  // The pages that overlap with the region of interest.
+  std::vector<Vector2i> locations = region_pages(region);
+
+  // Iterate over them, loading as many at a time as the cache holds,
+  // since loading remote pages one by one is bound by round trips.
   std::list<TileHeader> result;
-  for (uint32 level_row = min_level_row; level_row < max_level_row; level_row += m_page_height) {
-    for (uint32 level_col = min_level_col; level_col < max_level_col; level_col += m_page_width) {
-      boost::shared_ptr<IndexPage> page = load_page(level_col, level_row);
+  for (size_t first = 0; first < locations.size(); first += m_cache_size) {
+    std::vector<Vector2i> batch(locations.begin() + first,
+                                locations.begin() + std::min<size_t>(first + m_cache_size, locations.size()));
+    if (batch.size() > 1)
+      prefetch_pages(batch, *m_page_gen_factory);
+
+    BOOST_FOREACH(const Vector2i& location, batch) {
+      boost::shared_ptr<IndexPage> page = load_page(location.x(), location.y());
 
       // Accumulate valid tiles that overlap with region from this IndexPage.
       std::list<TileHeader> sub_result = page->search_by_region(region, start_transaction_id, end_transaction_id);
@@ -166,6 +290,79 @@ IndexLevel::search_by_location(uint32 col, uint32 row,
 }
 
 
+// --------------------------------------------------------------------
+//                            INDEX PREFETCHER
+// --------------------------------------------------------------------
+
+struct IndexPrefetcher::Worker {
+  IndexPrefetcher& p;
+  Worker(IndexPrefetcher& p) : p(p) {}
+
+  void operator()() {
+    boost::shared_ptr<PageGeneratorFactory> factory;
+    try {
+      factory = p.m_make_factory();
+    } catch (const Exception& e) {
+      vw_out(WarningMessage, "platefile") << "Index prefetch disabled: " << e.what() << std::endl;
+    }
+
+    Mutex::Lock lock(p.m_mutex);
+    for (;;) {
+      while (p.m_queue.empty() && !p.m_stop) {
+        p.m_busy = false;
+        p.m_cond.notify_all();
+        p.m_cond.wait(lock);
+      }
+      if (p.m_stop)
+        break;
+
+      queue_t::value_type job = p.m_queue.front();
+      p.m_queue.pop_front();
+      p.m_busy = true;
+      if (!factory)
+        continue;
+
+      lock.unlock();
+      try {
+        job.first->prefetch_region(job.second, *factory);
+      } catch (const Exception& e) {
+        vw_out(DebugMessage, "platefile") << "Index prefetch of " << job.second << " failed: " << e.what() << std::endl;
+      }
+      lock.lock();
+    }
+    p.m_busy = false;
+    p.m_cond.notify_all();
+  }
+};
+
+IndexPrefetcher::IndexPrefetcher(FactoryMaker const& make_factory)
+  : m_make_factory(make_factory), m_busy(false), m_stop(false) {
+  m_thread.reset(new Thread(boost::shared_ptr<Worker>(new Worker(*this))));
+}
+
+IndexPrefetcher::~IndexPrefetcher() {
+  {
+    Mutex::Lock lock(m_mutex);
+    m_stop = true;
+    m_queue.clear();
+    m_cond.notify_all();
+  }
+  m_thread->join();
+}
+
+void IndexPrefetcher::add(boost::shared_ptr<IndexLevel> level, BBox2i const& region) {
+  Mutex::Lock lock(m_mutex);
+  m_queue.push_back(std::make_pair(level, region));
+  m_busy = true;
+  m_cond.notify_all();
+}
+
+void IndexPrefetcher::join() {
+  Mutex::Lock lock(m_mutex);
+  while (m_busy)
+    m_cond.wait(lock);
+}
+
 // --------------------------------------------------------------------
 //                             PAGED INDEX
 // --------------------------------------------------------------------
@@ -181,6 +378,32 @@ PagedIndex::PagedIndex(uint32 page_width, uint32 page_height, uint32 default_cac
   : m_page_width(page_width), m_page_height(page_height),
     m_default_cache_size(default_cache_size) {}
 
+namespace {
+  boost::shared_ptr<PageGeneratorFactory> same_factory(boost::shared_ptr<PageGeneratorFactory> factory) {
+    return factory;
+  }
+}
+
+IndexPrefetcher::FactoryMaker PagedIndex::prefetch_factory() const {
+  return boost::bind(&same_factory, m_page_gen_factory);
+}
+
+void PagedIndex::prefetch(uint32 level, BBox2i const& region) const {
+  if (level >= m_levels.size())
+    return;
+
+  Mutex::Lock lock(m_prefetch_mutex);
+  if (!m_prefetcher)
+    m_prefetcher.reset(new IndexPrefetcher(this->prefetch_factory()));
+  m_prefetcher->add(m_levels[level], region);
+}
+
+void PagedIndex::prefetch_join() const {
+  Mutex::Lock lock(m_prefetch_mutex);
+  if (m_prefetcher)
+    m_prefetcher->join();
+}
+
 void PagedIndex::sync() {
   for (unsigned i = 0; i < m_levels.size(); ++i) {
     m_levels[i]->sync();
@@ -218,13 +441,32 @@ void PagedIndex::write_update(TileHeader const& header, IndexRecord const& recor
   // levels to save the requested data.  If not, we grow the levels
   // vector to the correct size.
 
-  for (uint32 level = m_levels.size(); level <= header.level(); ++level) {
+  grow_levels(header.level());
+  m_levels[header.level()]->set(header, record);
+}
+
+void PagedIndex::write_updates(std::vector<WriteUpdate> const& updates) {
+  std::vector<std::vector<WriteUpdate> > by_level;
+  BOOST_FOREACH(const WriteUpdate& update, updates) {
+    if (update.first.level() >= by_level.size())
+      by_level.resize(update.first.level() + 1);
+    by_level[update.first.level()].push_back(update);
+  }
+  if (by_level.empty())
+    return;
+
+  grow_levels(boost::numeric_cast<uint32>(by_level.size() - 1));
+  for (size_t level = 0; level < by_level.size(); ++level)
+    if (!by_level[level].empty())
+      m_levels[level]->set(by_level[level]);
+}
+
+void PagedIndex::grow_levels(uint32 level) {
+  for (uint32 i = m_levels.size(); i <= level; ++i) {
     boost::shared_ptr<IndexLevel> new_level(
-        new IndexLevel(m_page_gen_factory, level, m_page_width, m_page_height, m_default_cache_size) );
+        new IndexLevel(m_page_gen_factory, i, m_page_width, m_page_height, m_default_cache_size) );
     m_levels.push_back(new_level);
   }
-
-  m_levels[header.level()]->set(header, record);
 }
 
 
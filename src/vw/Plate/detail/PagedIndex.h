@@ -9,10 +9,13 @@
 #define __VW_PLATEFILE_PAGED_INDEX_H__
 
 #include <vw/Plate/FundamentalTypes.h>
-#include <vw/Core/Cache.h>
+#include <vw/Core/Thread.h>
 #include <vw/Plate/detail/Index.h>
 #include <vw/Plate/detail/IndexPage.h>
 
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+
 #include <vector>
 #include <list>
 
@@ -26,19 +29,38 @@ namespace detail {
   // --------------------------------------------------------------------
   //                             INDEX LEVEL
   // --------------------------------------------------------------------
+  //
+  // Resident pages are published in per-page slots that are read and
+  // swapped atomically, so finding a resident page takes no lock, and
+  // a page that is evicted while a reader holds it stays valid until
+  // the reader lets it go.  Only loading a page takes the level's
+  // lock.  At most cache_size pages are kept resident, evicted in
+  // clock order.
   class IndexLevel {
 
-    typedef Cache::Handle<boost::shared_ptr<PageGeneratorBase> > handle_t;
-
     boost::shared_ptr<PageGeneratorFactory> m_page_gen_factory;
     uint32 m_level;
     uint32 m_page_width, m_page_height;
     uint32 m_horizontal_pages, m_vertical_pages;
-    mutable std::vector<handle_t> m_cache_handles;
-    mutable vw::Cache m_cache;
-    mutable Mutex m_cache_mutex;
+    uint32 m_cache_size;
+    mutable std::vector<boost::shared_ptr<IndexPage> > m_pages;
+    mutable std::vector<uint8> m_referenced; // only a hint for eviction, so races on it are harmless
+    mutable std::vector<uint32> m_resident;
+    mutable size_t m_clock_hand;
+    mutable uint64 m_misses, m_evictions;
+    mutable Mutex m_load_mutex;
 
     boost::shared_ptr<IndexPage> load_page(uint32 col, uint32 row) const;
+    void evict_page() const;
+
+    /// The (base col, base row) of each page overlapping the region, in
+    /// raster order.
+    std::vector<Vector2i> region_pages(BBox2i const& region) const;
+
+    /// Load the pages holding the given tiles that are not resident,
+    /// together, using the given factory.  At most cache_size tiles
+    /// should be given.
+    void prefetch_pages(std::vector<Vector2i> const& tiles, PageGeneratorFactory& factory) const;
 
   public:
     typedef IndexPage::multi_value_type multi_value_type;
@@ -63,6 +85,18 @@ namespace detail {
     /// Set the value of an index node at this level.
     void set(TileHeader const& hdr, IndexRecord const& rec);
 
+    /// Set many index nodes at this level, a page at a time, so that each
+    /// page they fall in is loaded once even when there are more of them
+    /// than the cache holds.  Updates to the same node are applied in the
+    /// order given.
+    void set(std::vector<Index::WriteUpdate> const& updates);
+
+    /// Load the pages overlapping the region that are not resident,
+    /// using the given factory, which need not be the level's own.  No
+    /// more than cache_size pages are loaded, the first in raster
+    /// order, since any more would only push each other out.
+    void prefetch_region(BBox2i const& region, PageGeneratorFactory& factory) const;
+
     /// Returns a list of valid tiles at this level.
     std::list<TileHeader> search_by_region(BBox2i const& region,
                                            TransactionOrNeg start_transaction_id,
@@ -73,12 +107,52 @@ namespace detail {
                                              TransactionOrNeg start_transaction_id, TransactionOrNeg end_transaction_id) const;
   };
 
+  // --------------------------------------------------------------------
+  //                            INDEX PREFETCHER
+  // --------------------------------------------------------------------
+  //
+  // Loads the pages asked for by PagedIndex::prefetch() on a thread of
+  // its own, one region at a time, so that the caller does not wait on
+  // them.  The thread makes its page factory when it starts, because
+  // some factories (those with an RPC client) may only be used on the
+  // thread that made them.  Failures are logged and dropped: a later
+  // lookup simply loads the page itself.
+  class IndexPrefetcher {
+  public:
+    typedef boost::function<boost::shared_ptr<PageGeneratorFactory>()> FactoryMaker;
+
+  private:
+    struct Worker;
+    typedef std::list<std::pair<boost::shared_ptr<IndexLevel>, BBox2i> > queue_t;
+
+    FactoryMaker m_make_factory;
+    queue_t m_queue;
+    bool m_busy, m_stop;
+    Mutex m_mutex;
+    Condition m_cond;
+    boost::scoped_ptr<Thread> m_thread;
+
+  public:
+    IndexPrefetcher(FactoryMaker const& make_factory);
+
+    /// Stops the thread, dropping any regions not yet started.
+    ~IndexPrefetcher();
+
+    void add(boost::shared_ptr<IndexLevel> level, BBox2i const& region);
+
+    /// Wait until every region added so far has been loaded.
+    void join();
+  };
+
   // --------------------------------------------------------------------
   //                             PAGED INDEX
   // --------------------------------------------------------------------
 
   class PagedIndex : public Index {
 
+    mutable Mutex m_prefetch_mutex;
+    mutable boost::scoped_ptr<IndexPrefetcher> m_prefetcher;
+
   protected:
 
     boost::shared_ptr<PageGeneratorFactory> m_page_gen_factory;
@@ -90,6 +164,13 @@ namespace detail {
       m_page_gen_factory = page_gen_factory;
     }
 
+    /// Make sure there are levels up to this one.
+    void grow_levels(uint32 level);
+
+    /// How the prefetch thread gets the factory it loads pages with.  By
+    /// default it shares the index's own.
+    virtual IndexPrefetcher::FactoryMaker prefetch_factory() const;
+
   public:
     typedef IndexLevel::multi_value_type multi_value_type;
 
@@ -139,6 +220,10 @@ namespace detail {
     // unlock the blob id.
     virtual void write_update(TileHeader const& header, IndexRecord const& record);
 
+    /// Writing, pt. 2, for several tiles: they are sorted out by level and
+    /// page, and each page is updated in one pass.
+    virtual void write_updates(std::vector<WriteUpdate> const& updates);
+
     // ----------------------- PROPERTIES  ----------------------
 
     /// Returns a list of valid tiles that match this level, region, and
@@ -157,6 +242,12 @@ namespace detail {
                                                      TransactionOrNeg start_transaction_id,
                                                      TransactionOrNeg end_transaction_id) const;
 
+    /// Queue the pages overlapping the region to be loaded in the
+    /// background.  Regions are loaded in the order they were asked for.
+    virtual void prefetch(uint32 level, BBox2i const& region) const;
+
+    /// Wait for the regions queued by prefetch() so far to be loaded.
+    void prefetch_join() const;
   };
 
 }}}
@@ -12,6 +12,8 @@
 #include <vw/Plate/Exception.h>
 
 #include <boost/iostreams/stream.hpp>
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
 namespace io = boost::iostreams;
 
 using namespace vw;
@@ -22,6 +24,34 @@ using namespace vw::platefile::detail;
 #include <boost/lexical_cast.hpp>
 #include <unistd.h>
 
+namespace {
+  // Updates sent at once by an index that isn't a bulk writer
+  static const vw::uint32 DEFAULT_FLUSH_TILES = 50;
+  // The largest manifest a bulk writer sends, unless the url says
+  // otherwise with bulk_tiles
+  static const vw::uint32 DEFAULT_BULK_TILES = 65536;
+
+  bool is_bulk(const Url& url) {
+    return url.query().get<vw::uint32>("bulk", 0) != 0;
+  }
+
+  size_t flush_tiles(const Url& url) {
+    return is_bulk(url) ? url.query().get<vw::uint32>("bulk_tiles", DEFAULT_BULK_TILES) : DEFAULT_FLUSH_TILES;
+  }
+}
+
+// Names a remote index as a writer (by host, process and the index
+// itself), so each keeps its own blob on the index_server.
+std::string writer_name(const void* index) {
+  char host[256];
+  if (gethostname(host, sizeof(host)) != 0)
+    host[0] = '\0';
+  host[sizeof(host)-1] = '\0';
+  std::ostringstream name;
+  name << host << ":" << getpid() << ":" << index;
+  return name.str();
+}
+
 std::string split_url(Url& url) {
   Url::split_t sp = url.path_split();
   VW_ASSERT(sp.size() > 0, ArgumentErr() << "Expected a platefile url (bad path)");
@@ -50,12 +80,62 @@ class RemoteIndex::LogRequestSink : public io::sink {
 };
 
 
+// ----------------------------------------------------------------------
+//                          REMOTE WRITE QUEUE
+// ----------------------------------------------------------------------
+
+RemoteWriteQueue::RemoteWriteQueue(boost::shared_ptr<IndexClient> client, size_t flush_size)
+  : m_client(client), m_request(new IndexMultiWriteUpdate()), m_flush_size(flush_size), m_held(0) {}
+
+void RemoteWriteQueue::push(IndexWriteUpdate const& update) {
+  Mutex::Lock lock(m_mutex);
+  *(m_request->mutable_write_updates()->Add()) = update;
+  if (m_held == 0 && size_t(m_request->write_updates_size()) >= m_flush_size)
+    flush_locked();
+}
+
+void RemoteWriteQueue::hold() {
+  Mutex::Lock lock(m_mutex);
+  ++m_held;
+}
+
+void RemoteWriteQueue::release() {
+  Mutex::Lock lock(m_mutex);
+  VW_ASSERT(m_held > 0, LogicErr() << "RemoteWriteQueue released more often than it was held");
+  --m_held;
+  if (m_held == 0 && size_t(m_request->write_updates_size()) >= m_flush_size)
+    flush_locked();
+}
+
+void RemoteWriteQueue::flush() {
+  Mutex::Lock lock(m_mutex);
+  flush_locked();
+}
+
+void RemoteWriteQueue::flush_locked() {
+  if (m_request->write_updates_size() == 0)
+    return;
+
+  // Clear the queue first, so a failed send doesn't send the same updates
+  // again next time.
+  boost::shared_ptr<IndexMultiWriteUpdate> request(new IndexMultiWriteUpdate());
+  request.swap(m_request);
+
+  RpcNullMsg response;
+  m_client->MultiWriteUpdate(m_client.get(), request.get(), &response, null_callback());
+}
+
+// ----------------------------------------------------------------------
+//                          REMOTE INDEX PAGE
+// ----------------------------------------------------------------------
+
 RemoteIndexPage::RemoteIndexPage(int platefile_id,
                                  boost::shared_ptr<IndexClient> client,
+                                 boost::shared_ptr<RemoteWriteQueue> write_queue,
                                  uint32 level, uint32 base_col, uint32 base_row,
                                  uint32 page_width, uint32 page_height)
   : IndexPage(level, base_col, base_row, page_width, page_height),
-    m_platefile_id(platefile_id), m_client(client)
+    m_platefile_id(platefile_id), m_client(client), m_write_queue(write_queue)
 {
   // Use the PageRequest RPC to fetch the remote page from the index
   // server.
@@ -64,6 +144,7 @@ RemoteIndexPage::RemoteIndexPage(int platefile_id,
   request.set_col(base_col);
   request.set_row(base_row);
   request.set_level(level);
+  request.set_page_version(IndexPage::newest_version());
   IndexPageReply response;
   try {
     m_client->PageRequest(m_client.get(), &request, &response, null_callback());
@@ -82,6 +163,21 @@ RemoteIndexPage::RemoteIndexPage(int platefile_id,
   }
 }
 
+RemoteIndexPage::RemoteIndexPage(int platefile_id,
+                                 boost::shared_ptr<IndexClient> client,
+                                 boost::shared_ptr<RemoteWriteQueue> write_queue,
+                                 uint32 level, uint32 base_col, uint32 base_row,
+                                 uint32 page_width, uint32 page_height,
+                                 std::string const& page_bytes)
+  : IndexPage(level, base_col, base_row, page_width, page_height),
+    m_platefile_id(platefile_id), m_client(client), m_write_queue(write_queue)
+{
+  if (!page_bytes.empty()) {
+    std::istringstream istr(page_bytes, std::ios::binary);
+    this->deserialize(istr);
+  }
+}
+
 RemoteIndexPage::~RemoteIndexPage() {
   this->sync();
 }
@@ -92,39 +188,18 @@ void RemoteIndexPage::set(TileHeader const& header, IndexRecord const& record) {
   // First call up to the parent class and let the original code run.
   IndexPage::set(header, record);
 
-  // Save this write request to the queue, and flush the queue if it
-  // has gotten too full.  (We send an update to the index_server
-  // every 50 writes!)
+  // Save this write request to the index's queue, which goes to the
+  // index_server once it has gotten too full.  (We send an update to
+  // the index_server every 50 writes!)
   IndexWriteUpdate request;
   request.set_platefile_id(m_platefile_id);
   *(request.mutable_header()) = header;
   *(request.mutable_record()) = record;
-  m_write_queue.push(request);
-  static const unsigned write_queue_size = 50; // arbitrary, but probably good.
-  if (m_write_queue.size() >= write_queue_size)
-    this->flush_write_queue();
-}
-
-void RemoteIndexPage::flush_write_queue() {
-  if (m_write_queue.size() > 0) {
-
-    // For debugging:
-    //    std::cout << "Call to the new flush_write_queue() with "
-    //              << m_write_queue.size() << " entries.\n";
-
-    IndexMultiWriteUpdate request;
-    while (m_write_queue.size() > 0) {
-      *(request.mutable_write_updates()->Add()) = m_write_queue.front();
-      m_write_queue.pop();
-    }
-    RpcNullMsg response;
-    m_client->MultiWriteUpdate(m_client.get(), &request, &response, null_callback());
-
-  }
+  m_write_queue->push(request);
 }
 
 void RemoteIndexPage::sync() {
-  this->flush_write_queue();
+  m_write_queue->flush();
 }
 
 // ----------------------------------------------------------------------
@@ -133,16 +208,17 @@ void RemoteIndexPage::sync() {
 
 RemotePageGenerator::RemotePageGenerator( int platefile_id,
                                           boost::shared_ptr<IndexClient> client,
+                                          boost::shared_ptr<RemoteWriteQueue> write_queue,
                                           uint32 level, uint32 base_col, uint32 base_row,
                                           uint32 page_width, uint32 page_height)
-  : m_platefile_id(platefile_id), m_client(client), m_level(level),
+  : m_platefile_id(platefile_id), m_client(client), m_write_queue(write_queue), m_level(level),
     m_base_col(base_col), m_base_row(base_row),
     m_page_width(page_width), m_page_height(page_height) {}
 
 boost::shared_ptr<IndexPage>
 RemotePageGenerator::generate() const {
   return boost::shared_ptr<IndexPage>(
-      new RemoteIndexPage(m_platefile_id, m_client, m_level,
+      new RemoteIndexPage(m_platefile_id, m_client, m_write_queue, m_level,
                           m_base_col, m_base_row, m_page_width, m_page_height) );
 }
 
@@ -153,13 +229,40 @@ RemotePageGeneratorFactory::create(uint32 level, uint32 base_col, uint32 base_ro
 
   // Create the proper type of page generator.
   boost::shared_ptr<PageGeneratorBase> page_gen(
-    new RemotePageGenerator(m_platefile_id, m_client,
+    new RemotePageGenerator(m_platefile_id, m_client, m_write_queue,
                             level, base_col, base_row,
                             page_width, page_height) );
 
   return page_gen;
 }
 
+std::vector<boost::shared_ptr<IndexPage> >
+RemotePageGeneratorFactory::generate_pages(uint32 level, std::vector<Vector2i> const& bases,
+                                           uint32 page_width, uint32 page_height) {
+  IndexMultiPageRequest request;
+  BOOST_FOREACH(const Vector2i& base, bases) {
+    IndexPageRequest* page_request = request.add_page_requests();
+    page_request->set_platefile_id(m_platefile_id);
+    page_request->set_col(base.x());
+    page_request->set_row(base.y());
+    page_request->set_level(level);
+    page_request->set_page_version(IndexPage::newest_version());
+  }
+
+  IndexMultiPageReply response;
+  m_client->MultiPageRequest(m_client.get(), &request, &response, null_callback());
+  VW_ASSERT(response.pages_size() == int(bases.size()),
+            NetworkErr() << "MultiPageRequest returned " << response.pages_size() << " pages of " << bases.size() << ".");
+
+  std::vector<boost::shared_ptr<IndexPage> > pages;
+  pages.reserve(bases.size());
+  for (size_t i = 0; i < bases.size(); ++i)
+    pages.push_back(boost::shared_ptr<IndexPage>(
+        new RemoteIndexPage(m_platefile_id, m_client, m_write_queue, level, bases[i].x(), bases[i].y(),
+                            page_width, page_height, response.pages(i).page_bytes()) ));
+  return pages;
+}
+
 std::string RemotePageGeneratorFactory::who() const {
   VW_ASSERT(m_platefile_id != -1,
             LogicErr() << "Error: RemotePageGeneratorFactory has not yet been initialized.");
@@ -170,12 +273,27 @@ std::string RemotePageGeneratorFactory::who() const {
 //                             REMOTE INDEX
 // ----------------------------------------------------------------------
 
+namespace {
+  boost::shared_ptr<PageGeneratorFactory>
+  make_prefetch_factory(int platefile_id, Url url, boost::shared_ptr<RemoteWriteQueue> write_queue) {
+    boost::shared_ptr<IndexClient> client(new IndexClient(url));
+    return boost::shared_ptr<PageGeneratorFactory>(
+        new RemotePageGeneratorFactory(platefile_id, client, write_queue));
+  }
+}
+
+IndexPrefetcher::FactoryMaker RemoteIndex::prefetch_factory() const {
+  return boost::bind(&make_prefetch_factory, m_platefile_id, m_url, m_write_queue);
+}
+
 
 // Constructor (for opening an existing Index)
 // expecting a url in the form of scheme://hostname:port/path/to/server/platefile.plate
 RemoteIndex::RemoteIndex(const Url& url_)
   : m_url(url_), m_short_plate_filename(split_url(m_url)),
+    m_bulk(is_bulk(m_url)),
     m_client(new IndexClient(m_url)),
+    m_write_queue(new RemoteWriteQueue(m_client, flush_tiles(m_url))),
     m_logger(new io::stream<LogRequestSink>(LogRequestSink(this)))
 {
   // TODO: some way to set client_name from here?
@@ -189,12 +307,13 @@ RemoteIndex::RemoteIndex(const Url& url_)
 
   m_index_header = response.index_header();
   m_platefile_id = m_index_header.platefile_id();
+  m_writer = writer_name(this);
   m_short_plate_filename = response.short_plate_filename();
   m_full_plate_filename = response.full_plate_filename();
 
   // Properly initialize the PageGenFactory and set it.
   boost::shared_ptr<PageGeneratorFactory> factory(
-      new RemotePageGeneratorFactory(m_platefile_id, m_client));
+      new RemotePageGeneratorFactory(m_platefile_id, m_client, m_write_queue));
 
   this->set_page_generator_factory(factory);
   this->set_default_cache_size(m_url.query().get("cache_size", 100u));
@@ -213,7 +332,9 @@ RemoteIndex::RemoteIndex(const Url& url_)
 RemoteIndex::RemoteIndex(const Url& url_, IndexHeader index_header_info)
   : m_url(url_), m_short_plate_filename(split_url(m_url)),
     m_index_header(index_header_info),
+    m_bulk(is_bulk(m_url)),
     m_client(new IndexClient(m_url)),
+    m_write_queue(new RemoteWriteQueue(m_client, flush_tiles(m_url))),
     m_logger(new io::stream<LogRequestSink>(LogRequestSink(this)))
 {
   // TODO: some way to set client_name from here?
@@ -229,12 +350,13 @@ RemoteIndex::RemoteIndex(const Url& url_, IndexHeader index_header_info)
 
   m_index_header = response.index_header();
   m_platefile_id = m_index_header.platefile_id();
+  m_writer = writer_name(this);
   m_short_plate_filename = response.short_plate_filename();
   m_full_plate_filename = response.full_plate_filename();
 
   // Properly initialize the PageGenFactory and set it.
   boost::shared_ptr<PageGeneratorFactory> factory(
-      new RemotePageGeneratorFactory(m_platefile_id, m_client));
+      new RemotePageGeneratorFactory(m_platefile_id, m_client, m_write_queue));
 
   this->set_page_generator_factory(factory);
   this->set_default_cache_size(m_url.query().get("cache_size", 100u));
@@ -255,9 +377,10 @@ RemoteIndex::~RemoteIndex() {}
 
 // Writing, pt. 1: Locks a blob and returns the blob id that can
 // be used to write a tile.
-uint32 RemoteIndex::write_request() {
+uint32 RemoteIndex::write_request(std::string const& writer) {
   IndexWriteRequest request;
   request.set_platefile_id(m_platefile_id);
+  request.set_writer(writer.empty() ? m_writer : writer);
 
   IndexWriteReply response;
   m_client->WriteRequest(m_client.get(), &request, &response, null_callback());
@@ -269,6 +392,24 @@ std::ostream& RemoteIndex::log() {
   return *m_logger;
 }
 
+void RemoteIndex::write_updates(std::vector<WriteUpdate> const& updates) {
+  m_write_queue->hold();
+  try {
+    PagedIndex::write_updates(updates);
+  } catch (...) {
+    m_write_queue->release();
+    throw;
+  }
+  m_write_queue->release();
+  if (!m_bulk)
+    m_write_queue->flush();
+}
+
+void RemoteIndex::sync() {
+  PagedIndex::sync();
+  m_write_queue->flush();
+}
+
 /// Writing, pt. 3: Signal the completion
 void RemoteIndex::write_complete(uint32 blob_id) {
 
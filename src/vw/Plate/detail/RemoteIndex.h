@@ -11,7 +11,6 @@
 #include <vw/Plate/detail/PagedIndex.h>
 #include <vw/Plate/detail/IndexPage.h>
 #include <vw/Plate/HTTPUtils.h>
-#include <queue>
 
 namespace vw {
 namespace platefile {
@@ -21,11 +20,47 @@ namespace platefile {
 
   class IndexService;
   class IndexWriteUpdate;
+  class IndexMultiWriteUpdate;
 
   typedef RpcClient<IndexService> IndexClient;
 
 namespace detail {
 
+  // ----------------------------------------------------------------------
+  //                          REMOTE WRITE QUEUE
+  // ----------------------------------------------------------------------
+
+  /// Write updates waiting to go to the index_server. All the pages of a
+  /// RemoteIndex share one, so updates to tiles on different pages still
+  /// go out together in one MultiWriteUpdate.  A bulk writer uses one with
+  /// a large flush_size, so that each goes out as a manifest of many
+  /// blob appends, which the index_server merges into its pages at once.
+  class RemoteWriteQueue {
+    boost::shared_ptr<IndexClient> m_client;
+    boost::shared_ptr<IndexMultiWriteUpdate> m_request;
+    size_t m_flush_size;
+    int m_held;
+    Mutex m_mutex;
+
+    void flush_locked();
+
+  public:
+    RemoteWriteQueue(boost::shared_ptr<IndexClient> client, size_t flush_size = 50);
+
+    /// Queue an update, sending the queue once it reaches flush_size
+    /// (unless it is held).
+    void push(IndexWriteUpdate const& update);
+
+    /// Hold the queue so it only goes out on flush(), however large it
+    /// gets, until a matching release(), which sends it if it has reached
+    /// flush_size.
+    void hold();
+    void release();
+
+    /// Send everything queued.
+    void flush();
+  };
+
   // ----------------------------------------------------------------------
   //                         LOCAL INDEX PAGE
   // ----------------------------------------------------------------------
@@ -35,16 +70,25 @@ namespace detail {
     boost::shared_ptr<IndexClient> m_client;
 
     // For packetizing write requests.
-    std::queue<IndexWriteUpdate> m_write_queue;
-    void flush_write_queue();
+    boost::shared_ptr<RemoteWriteQueue> m_write_queue;
 
   public:
 
     RemoteIndexPage(int platefile_id,
                     boost::shared_ptr<IndexClient> client,
+                    boost::shared_ptr<RemoteWriteQueue> write_queue,
                     uint32 level, uint32 base_col, uint32 base_row,
                     uint32 page_width, uint32 page_height);
 
+    /// Make the page from bytes already fetched from the server, which
+    /// are empty if the server has no such page.
+    RemoteIndexPage(int platefile_id,
+                    boost::shared_ptr<IndexClient> client,
+                    boost::shared_ptr<RemoteWriteQueue> write_queue,
+                    uint32 level, uint32 base_col, uint32 base_row,
+                    uint32 page_width, uint32 page_height,
+                    std::string const& page_bytes);
+
     virtual ~RemoteIndexPage();
 
     /// Set the value of an entry in the RemoteIndexPage.
@@ -61,12 +105,14 @@ namespace detail {
   class RemotePageGenerator : public PageGeneratorBase {
     int m_platefile_id;
     boost::shared_ptr<IndexClient> m_client;
+    boost::shared_ptr<RemoteWriteQueue> m_write_queue;
     uint32 m_level, m_base_col, m_base_row;
     uint32 m_page_width, m_page_height;
 
   public:
     RemotePageGenerator( int platefile_id,
                          boost::shared_ptr<IndexClient> client,
+                         boost::shared_ptr<RemoteWriteQueue> write_queue,
                          uint32 level, uint32 base_col, uint32 base_row,
                          uint32 page_width, uint32 page_height );
     virtual ~RemotePageGenerator() {}
@@ -81,15 +127,22 @@ namespace detail {
   class RemotePageGeneratorFactory : public PageGeneratorFactory {
     int m_platefile_id;
     boost::shared_ptr<IndexClient> m_client;
+    boost::shared_ptr<RemoteWriteQueue> m_write_queue;
 
   public:
-    RemotePageGeneratorFactory(int platefile_id, boost::shared_ptr<IndexClient> client)
-      : m_platefile_id(platefile_id), m_client(client) {}
+    RemotePageGeneratorFactory(int platefile_id, boost::shared_ptr<IndexClient> client,
+                               boost::shared_ptr<RemoteWriteQueue> write_queue)
+      : m_platefile_id(platefile_id), m_client(client), m_write_queue(write_queue) {}
     virtual ~RemotePageGeneratorFactory() {}
 
     virtual boost::shared_ptr<PageGeneratorBase>
     create(uint32 level, uint32 base_col, uint32 base_row, uint32 page_width, uint32 page_height);
 
+    /// Fetch the pages with one MultiPageRequest.
+    virtual std::vector<boost::shared_ptr<IndexPage> >
+    generate_pages(uint32 level, std::vector<Vector2i> const& bases,
+                   uint32 page_width, uint32 page_height);
+
     virtual std::string who() const;
   };
 
@@ -104,8 +157,16 @@ namespace detail {
     std::string m_full_plate_filename;
     mutable IndexHeader m_index_header;
 
+    // Who this index writes as, unless write_request() is told otherwise
+    std::string m_writer;
+
+    // Whether updates are only sent, as manifests, on sync(), on
+    // write_complete(), and once bulk_tiles of them are waiting
+    bool m_bulk;
+
     // Remote connection
     boost::shared_ptr<IndexClient> m_client;
+    boost::shared_ptr<RemoteWriteQueue> m_write_queue;
 
     // Log streamer
     struct LogRequestSink;
@@ -114,8 +175,15 @@ namespace detail {
 
     void update_header() const;
 
+  protected:
+    /// The prefetch thread fetches pages with an IndexClient of its own,
+    /// since a client may only be used on the thread that made it.
+    virtual IndexPrefetcher::FactoryMaker prefetch_factory() const;
+
   public:
-    /// Constructor (for opening an existing index)
+    /// Constructor (for opening an existing index).  With bulk=1 in the
+    /// url's query, the index holds its updates back in bulk (see
+    /// m_bulk); bulk_tiles sets how many it holds at most.
     RemoteIndex(const Url& url);
 
     /// Constructor (for creating a new index)
@@ -126,7 +194,15 @@ namespace detail {
 
     // Writing, pt. 1: Locks a blob and returns the blob id that can
     // be used to write a tile.
-    virtual uint32 write_request();
+    virtual uint32 write_request(std::string const& writer = std::string());
+
+    /// Writing, pt. 2, for several tiles: they go to the index_server
+    /// in one MultiWriteUpdate, or for a bulk writer, with the next
+    /// manifest.
+    virtual void write_updates(std::vector<WriteUpdate> const& updates);
+
+    /// Send the index_server whatever is waiting, and sync the pages.
+    virtual void sync();
 
     /// Writing, pt. 3: Signal the completion
     virtual void write_complete(uint32 blob_id);
@@ -0,0 +1,184 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+#ifndef __VW_PLATE_DETAIL_TILEPOOL_H__
+#define __VW_PLATE_DETAIL_TILEPOOL_H__
+
+#include <vw/Plate/PlateFile.h>
+#include <vw/Plate/detail/MipmapHelpers.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/Algorithms.h>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/foreach.hpp>
+
+#include <list>
+
+namespace vw { namespace platefile { namespace detail {
+
+// Runs per-tile work (decoding, mipmapping, compositing, copying) on a
+// thread pool for a plate being written. The tasks encode the tiles they
+// make, and the thread waiting in join() writes them: a plate's index
+// connection may only be used by the thread that opened it. The writes are
+// batched into the plate's blob appends as usual. Tasks that get too far
+// ahead of the writer wait for it, and the first failure is kept to be
+// rethrown once they are all done.
+class TilePool {
+  public:
+    PlateFile& plate;
+    const uint32 tile_size;
+    const std::string filetype;
+
+  private:
+    struct Pending {
+      TileData data;
+      uint32 col, row, level;
+      std::string type;
+      const RememberCallback* pc;
+    };
+
+    // Runs a task, and lets the pool know when it's done
+    class Tracked : public Task {
+        TilePool& m_pool;
+        boost::scoped_ptr<Task> m_task;
+      public:
+        Tracked(TilePool& pool, Task* task) : m_pool(pool), m_task(task) {}
+        void operator()() {
+          try {
+            (*m_task)();
+          } catch (const std::exception& e) {
+            m_pool.failed(e.what());
+          }
+          m_pool.finished();
+        }
+    };
+
+    // The most encoded tiles waiting for the writer
+    static const size_t MAX_PENDING = 256;
+
+    Mutex m_mutex;
+    Condition m_cond;
+    std::list<Pending> m_pending;
+    size_t m_added, m_done;
+    std::string m_error;
+    // Last, so that it waits for the tasks before the rest goes away
+    FifoWorkQueue m_queue;
+
+    void finished() {
+      Mutex::Lock lock(m_mutex);
+      ++m_done;
+      m_cond.notify_all();
+    }
+
+    void push(TileData data, uint32 col, uint32 row, uint32 level, const std::string& type, const RememberCallback* pc) {
+      Mutex::Lock lock(m_mutex);
+      while (m_pending.size() >= MAX_PENDING && m_error.empty())
+        m_cond.wait(lock);
+      // Nothing more will be written
+      if (!m_error.empty())
+        return;
+      Pending p;
+      p.data = data;
+      p.col = col; p.row = row; p.level = level;
+      p.type = type;
+      p.pc = pc;
+      m_pending.push_back(p);
+      m_cond.notify_all();
+    }
+
+    template <class ViewT>
+    TileData encode(ImageViewBase<ViewT> const& view, std::string& type) const {
+      type = filetype;
+      if (type == "auto")
+        type = is_opaque(view.impl()) ? "jpg" : "png";
+      boost::scoped_ptr<DstMemoryImageResource> r(DstMemoryImageResource::create(type, view.format()));
+      write_image(*r, view);
+      return TileData(new std::vector<uint8>(r->data(), r->data() + r->size()));
+    }
+
+  public:
+    TilePool(PlateFile& plate, int num_threads = vw_settings().default_num_threads())
+      : plate(plate), tile_size(plate.default_tile_size()), filetype(plate.default_file_type()),
+        m_added(0), m_done(0), m_queue(num_threads) {}
+
+    // Takes ownership of the task
+    void add(Task* task) {
+      {
+        Mutex::Lock lock(m_mutex);
+        ++m_added;
+      }
+      m_queue.add_task(boost::shared_ptr<Task>(new Tracked(*this, task)));
+    }
+
+    // Write the tiles as the tasks finish them, until every task is done,
+    // and rethrow the first failure. Progress is the fraction of the tasks
+    // done.
+    void join(const ProgressCallback& progress = ProgressCallback::dummy_instance()) {
+      while (true) {
+        std::list<Pending> batch;
+        {
+          Mutex::Lock lock(m_mutex);
+          while (m_pending.empty() && m_done < m_added)
+            m_cond.wait(lock);
+          if (m_pending.empty())
+            break;
+          batch.swap(m_pending);
+          m_cond.notify_all();
+          progress.report_fractional_progress(m_done, m_added);
+        }
+
+        BOOST_FOREACH(const Pending& p, batch) {
+          try {
+            plate.write_update(&p.data->operator[](0), p.data->size(), p.col, p.row, p.level, p.type);
+          } catch (const std::exception& e) {
+            // Drop whatever is left, and let the waiting tasks go
+            failed(e.what());
+            break;
+          }
+          if (p.pc)
+            p.pc->tick();
+        }
+      }
+      m_queue.join_all();
+      progress.report_finished();
+      if (!m_error.empty())
+        vw_throw(IOErr() << "Tile processing failed: " << m_error);
+    }
+
+    void failed(const std::string& error) {
+      Mutex::Lock lock(m_mutex);
+      if (m_error.empty())
+        m_error = error;
+      m_pending.clear();
+      m_cond.notify_all();
+    }
+
+    // Encodes the tile the same way PlateFile::write_update would, and
+    // hands it to the writer, which ticks pc once it's written.
+    template <class ViewT>
+    void write(ImageViewBase<ViewT> const& view, uint32 col, uint32 row, uint32 level, const RememberCallback& pc) {
+      std::string type;
+      TileData data = encode(view, type);
+      push(data, col, row, level, type, &pc);
+    }
+
+    template <class ViewT>
+    void write(ImageViewBase<ViewT> const& view, uint32 col, uint32 row, uint32 level) {
+      std::string type;
+      TileData data = encode(view, type);
+      push(data, col, row, level, type, 0);
+    }
+
+    // Hands an already encoded tile to the writer, as when copying tiles
+    // between plates.
+    void write(TileData data, uint32 col, uint32 row, uint32 level, const std::string& type) {
+      push(data, col, row, level, type, 0);
+    }
+};
+
+}}} // namespace vw::platefile::detail
+
+#endif
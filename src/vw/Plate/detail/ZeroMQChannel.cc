@@ -11,11 +11,15 @@
 #include <vw/Core/Stopwatch.h>
 #include <vw/Core/Log.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/Thread.h>
 
 #include <boost/algorithm/string/trim.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/weak_ptr.hpp>
 #include <google/protobuf/descriptor.h>
 #include <zmq.hpp>
 #include <cerrno>
+#include <map>
 
 using namespace vw;
 using namespace vw::platefile;
@@ -40,6 +44,124 @@ namespace {
   }
 }
 
+namespace vw { namespace platefile { namespace detail {
+
+// Forwards the requests to a bound url to the REP sockets of the channels
+// that share it, and their replies back. This is a ZMQ_QUEUE device, but
+// one that stops when the last channel lets go of it. The sockets belong
+// to the device's own thread.
+class ZeroMQQueue : private boost::noncopyable {
+    class Task {
+        ZeroMQQueue& m_queue;
+      public:
+        Task(ZeroMQQueue& queue) : m_queue(queue) {}
+        void operator()() { m_queue.run(); }
+    };
+
+    boost::shared_ptr<zmq::context_t> m_ctx;
+    const std::string m_front, m_back;
+    volatile bool m_go;
+    bool m_started;
+    std::string m_error;
+    Mutex m_mutex;
+    Condition m_cond;
+    boost::scoped_ptr<Thread> m_thread;
+
+    static void forward(zmq::socket_t& from, zmq::socket_t& to) {
+      int64_t more;
+      size_t more_size = sizeof(more);
+      do {
+        zmq::message_t msg;
+        from.recv(&msg);
+        from.getsockopt(ZMQ_RCVMORE, &more, &more_size);
+        to.send(msg, more ? ZMQ_SNDMORE : 0);
+      } while (more);
+    }
+
+    void run() {
+      boost::scoped_ptr<zmq::socket_t> front, back;
+      {
+        Mutex::Lock lock(m_mutex);
+        try {
+          front.reset(new zmq::socket_t(*m_ctx, ZMQ_XREP));
+          back.reset(new zmq::socket_t(*m_ctx, ZMQ_XREQ));
+          if (zmq_bind(*front, m_front.c_str()) != 0 || zmq_bind(*back, m_back.c_str()) != 0)
+            m_error = std::string("Failed to bind to ") + m_front + ": " + zmq_strerror(zmq_errno());
+        } catch (const std::exception& e) {
+          m_error = e.what();
+        }
+        m_started = true;
+        m_cond.notify_all();
+        if (!m_error.empty())
+          return;
+      }
+
+      zmq::pollitem_t items[2];
+      items[0].socket = *front;
+      items[1].socket = *back;
+      for (size_t i = 0; i < 2; ++i) {
+        items[i].events = ZMQ_POLLIN;
+        items[i].fd = -1;
+      }
+
+      try {
+        while (m_go) {
+          items[0].revents = items[1].revents = 0;
+          // zeromq timeouts are in us; wake up now and then to check m_go
+          if (::zmq_poll(items, 2, 100000) <= 0)
+            continue;
+          if (items[0].revents & ZMQ_POLLIN)
+            forward(*front, *back);
+          if (items[1].revents & ZMQ_POLLIN)
+            forward(*back, *front);
+        }
+      } catch (const std::exception& e) {
+        vw_out(ErrorMessage, "plate.zmq") << "ZeroMQ queue for " << m_front << " stopped: " << e.what() << std::endl;
+      }
+    }
+
+  public:
+    ZeroMQQueue(boost::shared_ptr<zmq::context_t> ctx, const std::string& front)
+      : m_ctx(ctx), m_front(front), m_back("inproc://" + unique_name("zmq-queue")), m_go(true), m_started(false) {
+      Mutex::Lock lock(m_mutex);
+      m_thread.reset(new Thread(Task(*this)));
+      while (!m_started)
+        m_cond.wait(lock);
+      if (!m_error.empty()) {
+        lock.unlock();
+        m_thread->join();
+        vw_throw(ZeroMQErr() << m_error);
+      }
+    }
+
+    ~ZeroMQQueue() {
+      m_go = false;
+      m_thread->join();
+    }
+
+    // Where the channels sharing the url should connect their REP sockets
+    const std::string& backend() const { return m_back; }
+};
+
+}}} // namespace vw::platefile::detail
+
+namespace {
+  typedef vw::platefile::detail::ZeroMQQueue ZeroMQQueue;
+  vw::Mutex zmq_queues_mutex;
+  std::map<std::string, boost::weak_ptr<ZeroMQQueue> > zmq_queues;
+
+  // The queue serving the url, which is started if there's none yet
+  boost::shared_ptr<ZeroMQQueue> get_queue(boost::shared_ptr<zmq::context_t> ctx, const std::string& url) {
+    vw::Mutex::Lock lock(zmq_queues_mutex);
+    boost::shared_ptr<ZeroMQQueue> queue = zmq_queues[url].lock();
+    if (!queue) {
+      queue.reset(new ZeroMQQueue(ctx, url));
+      zmq_queues[url] = queue;
+    }
+    return queue;
+  }
+}
+
 #define THREAD_CHECK() \
   VW_ASSERT(m_id == Thread::id(), LogicErr() << "ZeroMQChannel created on thread " <<  m_id << " and used on thread " << Thread::id() << ". function: " << VW_CURRENT_FUNCTION)
 
@@ -196,6 +318,7 @@ void ZeroMQChannel::conn(const Url& endpoint_) {
 
 void ZeroMQChannel::bind(const Url& endpoint_) {
   Url endpoint(endpoint_);
+  const bool shared = endpoint.query().get<uint32>("threads", 1) > 1;
   this->init_endpoint(endpoint);
 
   // remove trailing / on the path, if it's there
@@ -204,6 +327,13 @@ void ZeroMQChannel::bind(const Url& endpoint_) {
 
   m_sock.reset(new zmq::socket_t(*m_ctx, ZMQ_REP));
 
+  if (shared) {
+    m_queue = get_queue(m_ctx, url);
+    if (zmq_connect(*m_sock, m_queue->backend().c_str()) != 0)
+      vw_throw(ZeroMQErr() << "Failed to connect to the queue for " << url.c_str() << ": " << zmq_strerror(zmq_errno()));
+    return;
+  }
+
   // We use the c interface rather than the c++ one here to avoid having to
   // catch an exception and rethrow
   if (zmq_bind(*m_sock, url.c_str()) != 0)
@@ -24,10 +24,16 @@ namespace platefile {
   // To recover from this, you may need to reconnect
   VW_DEFINE_EXCEPTION(ZeroMQErr, NetworkErr);
 
+  namespace detail {
+    class ZeroMQQueue;
+  }
+
   class ZeroMQChannel: public IChannel,
                        private boost::noncopyable
   {
       boost::shared_ptr<zmq::context_t> m_ctx;
+      // The queue a shared bind gets requests from; it must outlive m_sock
+      boost::shared_ptr<detail::ZeroMQQueue> m_queue;
       boost::shared_ptr<zmq::socket_t>  m_sock;
       std::string m_human_name;
       uint64 m_id;
@@ -60,6 +66,10 @@ namespace platefile {
 
       // url format:
       // zmq://x -> maps directly to zmq urls
+      //
+      // A bind url with a threads=N query (N > 1) may be bound by several
+      // channels in this process at once: the first one to bind it starts a
+      // queue that hands each request to whichever of them is free.
       void conn(const Url& server);
       void bind(const Url& self);
   };
@@ -57,16 +57,12 @@ void run(const Options& opt) {
   std::cout << "Loaded page at col=" << opt.col << " row=" << opt.row << " level=" << opt.level << std::endl
             << "Page contains " << page->sparse_size() << " entries." << std::endl;
 
-    //typedef std::pair<uint32, IndexRecord> value_type;
-    //typedef std::list<value_type> multi_value_type;
-    //typedef google::sparsetable<multi_value_type>::nonempty_iterator nonempty_iterator;
-
-  BOOST_FOREACH(const detail::IndexPage::multi_value_type& slot, std::make_pair(page->begin(), page->end())) {
+  BOOST_FOREACH(const detail::IndexPage::slot_type& slot, std::make_pair(page->begin(), page->end())) {
     std::cout << "Loaded page slot with " << slot.size() << " entries" << std::endl;
-    BOOST_FOREACH(const detail::IndexPage::value_type& elt, slot) {
-      std::cout << "TID=" << elt.first << " BLOB=" << elt.second.blob_id() << " OFFSET=" << elt.second.blob_offset() << std::endl;
+    BOOST_FOREACH(const detail::PackedIndexRecord& elt, std::make_pair(slot.rbegin(), slot.rend())) {
+      std::cout << "TID=" << elt.transaction_id << " BLOB=" << elt.blob_id << " OFFSET=" << elt.blob_offset << std::endl;
       if (opt.verify)
-        dump_tile(opt.plate, elt.second.blob_id(), elt.second.blob_offset());
+        dump_tile(opt.plate, elt.blob_id, elt.blob_offset);
     }
   }
 }
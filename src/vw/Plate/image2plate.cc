@@ -69,6 +69,7 @@ struct Options {
   optional<float> north, south, east, west;
   bool manual;
   bool global;
+  bool bulk;
 
   Options() :
     filetype("png"),
@@ -83,7 +84,8 @@ struct Options {
     debug(false),
     help(false),
     manual(false),
-    global(false)
+    global(false),
+    bulk(false)
     {}
 
 
@@ -175,6 +177,7 @@ bool handle_options( int argc, char *argv[], Options& opt ) {
     ("east",                  po::value(&opt.east),              "The easternmost longitude in projection units")
     ("west",                  po::value(&opt.west),              "The westernmost longitude in projection units")
     ("global",                po::bool_switch(&opt.global),      "Override image size to global (in lonlat)")
+    ("bulk",                  po::bool_switch(&opt.bulk),        "Send a remote index the tiles' locations in large manifests, rather than as they are written.")
     ("debug",                 po::bool_switch(&opt.debug),       "Display helpful debugging messages.")
     ("help,h",                po::bool_switch(&opt.help),        "Display this help message");
 
@@ -239,8 +242,12 @@ void run(const Options& opt) {
       filetype = "tif";
     }
 
-    std::cout << "\nOpening plate file: " << opt.url.get() << std::endl;
-    platefile.reset( new PlateFile(opt.url.get(), opt.mode, "", opt.tile_size, filetype, pixel_format, channel_type) );
+    Url url = opt.url.get();
+    if (opt.bulk && !url.query().has("bulk"))
+      url.query().set("bulk", "1");
+
+    std::cout << "\nOpening plate file: " << url << std::endl;
+    platefile.reset( new PlateFile(url, opt.mode, "", opt.tile_size, filetype, pixel_format, channel_type) );
   }
 
   BOOST_FOREACH(const std::string& filename, opt.image_files) {
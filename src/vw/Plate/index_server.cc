@@ -12,6 +12,8 @@
 #include <vw/Core/Log.h>
 #include <signal.h>
 #include <boost/format.hpp>
+#include <boost/foreach.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 
 #include <google/protobuf/descriptor.h>
 
@@ -41,6 +43,7 @@ struct Options {
   Url url;
   std::string root;
   float sync_interval;
+  uint32 threads;
   bool debug;
   bool help;
 };
@@ -51,6 +54,7 @@ void process_args(Options& opt, int argc, char *argv[]) {
   po::options_description general_options("Runs a master index manager.\n\nGeneral Options:");
   general_options.add_options()
     ("url",             po::value(&opt.url),                               "Url to listen on")
+    ("threads,t",       po::value(&opt.threads)->default_value(1),         "Number of threads to handle requests with.")
     ("debug",           po::bool_switch(&opt.debug)->default_value(false), "Allow server to die.")
     ("help,h",          po::bool_switch(&opt.help)->default_value(false),  "Display this help message")
     ("sync-interval,s", po::value(&opt.sync_interval)->default_value(60.),
@@ -86,6 +90,18 @@ void process_args(Options& opt, int argc, char *argv[]) {
     vw_throw(Usage() << usage.str()
                      << "\n\nMust specify a url to listen on");
   }
+
+  if (opt.threads > 1)
+    opt.url.query().set("threads", vw::stringify(opt.threads));
+}
+
+// Print the per-method latency histograms counted so far
+void print_latencies(const ThreadMap::map_t& latencies) {
+  if (latencies.empty())
+    return;
+  vw_out(InfoMessage) << "\nRequest latencies:\n";
+  BOOST_FOREACH(const ThreadMap::map_t::value_type& v, latencies)
+    vw_out(InfoMessage) << "\t" << v.first.substr(8) << ": " << v.second << "\n";
 }
 
 int main(int argc, char** argv) {
@@ -114,6 +130,7 @@ int main(int argc, char** argv) {
   uint64 next_sync = t0 + sync_interval_us;
 
   size_t win = 0, lose = 0, draw = 0, total = 0;
+  ThreadMap::map_t latencies;
   boost::format status("qps[%7.1f]   total[%9u]   server_err[%9u]   client_err[%9u]\r");
 
   while(process_messages) {
@@ -131,6 +148,7 @@ int main(int argc, char** argv) {
       uint64 s1 = Stopwatch::microtime();
       next_sync = s1 + sync_interval_us;
       vw_out(InfoMessage) << "Sync complete (took " << float(s1-s0) / 1e6  << " seconds).\n";
+      print_latencies(latencies);
       force_sync = false;
     }
 
@@ -142,6 +160,9 @@ int main(int argc, char** argv) {
       win_dt = stats.get("msgs");
       lose_dt  = stats.get("server_error");
       draw_dt  = stats.get("client_error");
+      BOOST_FOREACH(const ThreadMap::map_t::value_type& v, stats.data())
+        if (boost::starts_with(v.first, "latency."))
+          latencies[v.first] += v.second;
       stats.clear();
     }
     total_dt = win_dt + lose_dt + draw_dt;
@@ -163,6 +184,7 @@ int main(int argc, char** argv) {
   vw_out(InfoMessage) << "\nShutting down the index service safely.\n";
   server.stop();
   server.impl()->sync();
+  print_latencies(latencies);
 
   return 0;
 }
@@ -37,6 +37,8 @@ typedef struct {
   int index_tries;
   int unknown_resync;
   int use_blob_cache;
+  int blob_cache_size;  // how many blobs (and their descriptors) to keep open
+  int index_cache_size; // how many index pages to keep per level
   apr_array_header_t *rules; // This holds rule_entries
   apr_table_t *alias;        // key is name, value is id, an int stored as a const char*
 } plate_config;
@@ -14,6 +14,7 @@
 #include <vw/Core/Settings.h>
 #include <vw/Plate/detail/Index.h>
 #include <vw/Plate/Blob.h>
+#include <vw/Plate/Exception.h>
 #include <vw/Plate/Rpc.h>
 #include <vw/Plate/IndexService.pb.h>
 
@@ -21,6 +22,11 @@
 #include <boost/foreach.hpp>
 #include <string>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
 using std::string;
 
 namespace vw {
@@ -167,7 +173,7 @@ int PlateModule::operator()(const ApacheRequest& r) const {
   if (r.url.empty())
     return DECLINED;
 
-  static const Handler Handlers[] = {handle_image, handle_wtml};
+  static const Handler Handlers[] = {handle_image, handle_tiles, handle_wtml};
 
   BOOST_FOREACH(const Handler h, Handlers) {
     int ret = h(r);
@@ -184,30 +190,54 @@ int PlateModule::status(const ApacheRequest& r, int /*flags*/) const {
   BOOST_FOREACH(const IndexCache::value_type& c, get_index_cache())
     out << c.second.shortname << ": " << c.first << "<br>";
 
-  out << "BlobCacheSize: " << get_blob_cache().size() << "<br>";
+  out << "BlobCacheSize: " << get_blob_cache().size() << " of " << m_conf->blob_cache_size << "<br>";
 
   return OK;
 }
 
-const boost::shared_ptr<ReadBlob> PlateModule::get_blob(int platefile_id, const string& plate_filename, uint32 blob_id) const {
+PlateModule::OpenBlob::OpenBlob(const string& filename, int platefile_id)
+  : blob(new ReadBlob(filename)), fd(-1), platefile_id(platefile_id)
+{
+  fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    vw_throw(BlobIoErr() << "Could not open blob file " << filename << ": " << strerror(errno));
+}
+
+PlateModule::OpenBlob::~OpenBlob() {
+  if (fd >= 0)
+    ::close(fd);
+}
+
+const boost::shared_ptr<PlateModule::OpenBlob> PlateModule::get_blob(int platefile_id, const string& plate_filename, uint32 blob_id) const {
   std::ostringstream ostr;
   ostr << plate_filename << "/plate_" << blob_id << ".blob";
   const string& filename = ostr.str();
 
-  if (m_conf->use_blob_cache) {
+  if (!m_conf->use_blob_cache)
+    return boost::shared_ptr<OpenBlob>( new OpenBlob(filename, platefile_id) );
 
-    BlobCache::const_iterator blob = blob_cache.find(filename);
+  BlobCache::iterator i = blob_cache.find(filename);
 
+  if (i != blob_cache.end()) {
     // Check the platefile id to make sure the blob wasn't deleted and recreated
     // with a different platefile
-    if (blob != blob_cache.end() && blob->second.platefile_id == platefile_id)
-      return blob->second.blob;
+    if (i->second.blob->platefile_id == platefile_id) {
+      blob_lru.splice(blob_lru.begin(), blob_lru, i->second.lru);
+      return i->second.blob;
+    }
+    blob_lru.erase(i->second.lru);
+    blob_cache.erase(i);
   }
 
-  boost::shared_ptr<ReadBlob> ret( new ReadBlob(filename) );
+  boost::shared_ptr<OpenBlob> ret( new OpenBlob(filename, platefile_id) );
+
+  while (!blob_lru.empty() && blob_cache.size() >= size_t(m_conf->blob_cache_size)) {
+    blob_cache.erase(blob_lru.back());
+    blob_lru.pop_back();
+  }
 
-  if (m_conf->use_blob_cache)
-    blob_cache.insert(std::make_pair(filename, BlobCacheEntry(ret, platefile_id)));
+  blob_lru.push_front(filename);
+  blob_cache.insert(std::make_pair(filename, BlobCacheEntry(ret, blob_lru.begin())));
 
   return ret;
 }
@@ -224,7 +254,7 @@ void PlateModule::sync_index_cache() const {
   m_client->ListRequest(m_client.get(), &request, &id_list, null_callback());
 
   Url base_url = get_base_url();
-  base_url.query().set("cache_size", "1");
+  base_url.query().set("cache_size", boost::lexical_cast<string>(m_conf->index_cache_size));
   Url::split_t path = base_url.path_split();
   path.push_back("");
 
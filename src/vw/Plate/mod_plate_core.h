@@ -15,7 +15,9 @@
 #include <vw/Core/Log.h>
 #include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
 #include <string>
+#include <list>
 #include <map>
 
 
@@ -52,11 +54,26 @@ class PlateModule {
       int read_cursor;
     };
 
-    struct BlobCacheEntry {
+    /// A blob opened for serving. Along with the ReadBlob (used to find
+    /// where a tile's data lies), it holds a plain read-only descriptor on
+    /// the same file, which the handlers hand to sendfile. The descriptor
+    /// is closed when the last reference goes away.
+    struct OpenBlob : private boost::noncopyable {
       boost::shared_ptr<ReadBlob> blob;
+      int fd;
       int platefile_id;
-      BlobCacheEntry(boost::shared_ptr<ReadBlob> b, int id) :
-        blob(b), platefile_id(id) {}
+      OpenBlob(const std::string& filename, int platefile_id);
+      ~OpenBlob();
+    };
+
+    /// The blob cache is an LRU: the list holds the filenames, most
+    /// recently used first, and each map entry remembers its place in it.
+    typedef std::list<std::string> BlobLru;
+    struct BlobCacheEntry {
+      boost::shared_ptr<OpenBlob> blob;
+      BlobLru::iterator lru;
+      BlobCacheEntry(boost::shared_ptr<OpenBlob> b, BlobLru::iterator i) :
+        blob(b), lru(i) {}
     };
 
     typedef std::map<int32, IndexCacheEntry> IndexCache;
@@ -67,7 +84,10 @@ class PlateModule {
 
     const IndexCacheEntry& get_index(const std::string& id_str) const;
 
-    const boost::shared_ptr<ReadBlob> get_blob(int platefile_id, const std::string& plate_filename, uint32 blob_id) const;
+    /// Returns the open blob, from the cache if it's there (and still
+    /// belongs to the same platefile). Opening a blob that isn't cached
+    /// closes the least recently used one if the cache is full.
+    const boost::shared_ptr<OpenBlob> get_blob(int platefile_id, const std::string& plate_filename, uint32 blob_id) const;
     void sync_index_cache() const;
 
     std::ostream& logger(MessageLevel level, bool child_id = true) const;
@@ -81,6 +101,7 @@ class PlateModule {
     boost::shared_ptr<IndexClient> m_client;
 
     mutable BlobCache  blob_cache;
+    mutable BlobLru    blob_lru;
     mutable IndexCache index_cache;
     bool m_connected;
     // We don't manage the data, and I think apache might modify it behind the scenes.
@@ -20,16 +20,149 @@
 #include <http_log.h>
 #include <mod_status.h>
 #include <ap_mpm.h>
+#include <apr_portable.h>
+#include <apr_strings.h>
 
 #include <boost/regex.hpp>
 #include <boost/foreach.hpp>
 
+#include <list>
+#include <sstream>
+
 using namespace vw;
 using namespace vw::platefile;
 using namespace vw::platefile::detail;
 
 using std::string;
 
+namespace {
+
+  // A batch is one request's worth of tiles: a viewer's screen, not a level.
+  const int MAX_BATCH_TILES = 256;
+
+  // Separates the tiles in a batch. Each part carries its length too, but
+  // multipart parsers only look for this, so it has to be unlikely to turn up
+  // in tile data.
+  const char BATCH_BOUNDARY[] = "vw_plate_tiles_3c9d51e0a27f4b86";
+
+  // The transaction to read tiles at, from the request's transaction_id and
+  // exact args. Without a transaction_id, it's the index's read cursor.
+  void read_transaction(const ApacheRequest& r, const PlateModule::IndexCacheEntry& index,
+                        int& transaction_id, bool& exact) {
+    transaction_id = r.args.get("transaction_id", int(-1));
+    exact = r.args.get("exact", false);
+
+    VW_ASSERT(transaction_id >= -1, BadRequest() << "Illegal transaction_id");
+
+    if (transaction_id == -1) {
+      transaction_id = index.index->transaction_cursor();
+      exact = false;
+    }
+  }
+
+  // Finds the most recent tile in region that the transaction can see.
+  // There's one header per tile, in the index's order.
+  std::list<TileHeader> search_tiles(const PlateModule::IndexCacheEntry& index, int level,
+                                     const BBox2i& region, int transaction_id, bool exact) {
+    mod_plate().logger(VerboseDebugMessage) << "Sending search_by_region for region[" << region
+                                            << "] with transaction[" << transaction_id << "] and exact[" << exact << "]" << std::endl;
+
+    std::list<TileHeader> found;
+    try {
+      found = index.index->search_by_region(level, region, exact ? transaction_id : 0, transaction_id);
+    } catch (const vw::Exception &e) {
+      vw_throw(ServerError() << "Could not read plate index: " << e.what());
+    }
+
+    // The search returns every version in the range, newest first, so keep
+    // the first at each location.
+    std::list<TileHeader> tiles;
+    BOOST_FOREACH(const TileHeader& hdr, found) {
+      if (!tiles.empty() && tiles.back().col() == hdr.col() && tiles.back().row() == hdr.row())
+        continue;
+      tiles.push_back(hdr);
+    }
+    return tiles;
+  }
+
+  const char* tile_content_type(const string& filetype) {
+    if (filetype == "png")
+      return "image/png";
+    else if (filetype == "jpg")
+      return "image/jpeg";
+    else if (filetype == "tif")
+      return "image/tiff";
+    return "application/octet-stream";
+  }
+
+  // A tile never changes once written; a later transaction writes a new one.
+  // So the platefile and the tile's transaction make a strong validator.
+  string tile_etag(int platefile_id, const TileHeader& hdr) {
+    std::ostringstream etag;
+    etag << "\"" << platefile_id << "-" << hdr.transaction_id() << "\"";
+    return etag.str();
+  }
+
+  void set_cache_control(const ApacheRequest& r, int level) {
+    if (r.args.get("nocache", 0u) == 1) {
+      apr_table_set(r.writer()->headers_out, "Cache-Control", "no-cache");
+    }
+    else {
+      if (level <= 7)
+        apr_table_set(r.writer()->headers_out, "Cache-Control", "max-age=604800");
+      else
+        apr_table_set(r.writer()->headers_out, "Cache-Control", "max-age=1200");
+    }
+  }
+
+  // Finds the blob holding a tile and where in it the tile's bytes lie.
+  boost::shared_ptr<PlateModule::OpenBlob> locate_tile(int platefile_id, const PlateModule::IndexCacheEntry& index,
+                                                       const IndexRecord& idx_record, uint64& offset, uint64& size) {
+    boost::shared_ptr<PlateModule::OpenBlob> blob;
+    try {
+      mod_plate().logger(VerboseDebugMessage) << "Fetching blob" << std::endl;
+      // Grab an open blob from the blob cache by filename
+      blob = mod_plate().get_blob(platefile_id, index.filename, idx_record.blob_id());
+
+      mod_plate().logger(VerboseDebugMessage) << "Fetching data location from blob" << std::endl;
+      // And calculate the sendfile(2) parameters
+      string filename;
+      blob->blob->read_sendfile(idx_record.blob_offset(), filename, offset, size);
+
+    } catch (const vw::Exception& e) {
+      vw_throw(ServerError() << "Could not load blob data: " << e.what());
+    }
+    return blob;
+  }
+
+  void send_tile(const ApacheRequest& r, const PlateModule::OpenBlob& blob, uint64 offset, uint64 size) {
+    // Wrap the cached descriptor for apache. apr_os_file_put doesn't register a
+    // cleanup, so the descriptor stays open for the next request; the blob
+    // cache owns it.
+    apr_file_t *fd = 0;
+    apr_os_file_t os_fd = blob.fd;
+    if (apr_os_file_put(&fd, &os_fd, APR_READ|APR_FOPEN_SENDFILE_ENABLED, r.writer()->pool) != APR_SUCCESS)
+      vw_throw(ServerError() << "Could not wrap blob descriptor for " << blob.blob->filename());
+
+    // Use sendfile (if available) to send the proper tile data
+    size_t sent;
+    apr_status_t ap_ret;
+
+    if ((ap_ret = ap_send_fd(fd, r.writer(), offset, size, &sent)) != APR_SUCCESS) {
+      char buf[256];
+      apr_strerror(ap_ret, buf, 256);
+      vw_throw(ServerError() << "ap_send_fd failed: " << buf);
+    }
+    else if (sent != size)
+      vw_throw(ServerError() << "ap_send_fd: short write (expected to send " << size << " bytes, but only sent " << sent);
+
+    // The descriptor may be closed by a later request if its blob falls out of
+    // the cache, so don't let apache hold on to the file bucket past this one.
+    ap_rflush(r.writer());
+  }
+
+} // anonymous namespace
+
 int vw::platefile::handle_image(const ApacheRequest& r) {
   static const boost::regex match_regex("/(\\w+)/(\\d+)/(\\d+)/(\\d+)\\.(\\w+)$");
 
@@ -59,24 +192,22 @@ int vw::platefile::handle_image(const ApacheRequest& r) {
 
   // --------------  Access Plate Index -----------------
 
+  // Search for the tile rather than reading it straight away, to learn which
+  // transaction wrote it. The read after that hits the page the search loaded.
+  TileHeader hdr;
   IndexRecord idx_record;
-  try {
-    int transaction_id = r.args.get("transaction_id", int(-1));
-    bool exact = r.args.get("exact", false);
+  int transaction_id;
+  bool exact;
+  read_transaction(r, index, transaction_id, exact);
 
-    VW_ASSERT(transaction_id >= -1, BadRequest() << "Illegal transaction_id");
+  std::list<TileHeader> tiles = search_tiles(index, level, BBox2i(col, row, 1, 1), transaction_id, exact);
+  if (tiles.empty())
+    vw_throw(TileNotFoundErr() << "No tile at level " << level << " col " << col << " row " << row
+                               << " for transaction " << transaction_id);
+  hdr = tiles.front();
 
-    if (transaction_id == -1) {
-      transaction_id = index.index->transaction_cursor();
-      exact = false;
-    }
-
-    mod_plate().logger(VerboseDebugMessage) << "Sending tile read_request with transaction[" << transaction_id << "] and exact[" << exact << "]" << std::endl;;
-    idx_record = index.index->read_request(col,row,level,transaction_id,exact);
-  } catch(const TileNotFoundErr &) {
-    throw;
-  } catch (const BadRequest &) {
-    throw;
+  try {
+    idx_record = index.index->read_request(col,row,level,hdr.transaction_id(),true);
   } catch(const vw::Exception &e) {
     vw_throw(ServerError() << "Could not read plate index: " << e.what());
   }
@@ -86,23 +217,25 @@ int vw::platefile::handle_image(const ApacheRequest& r) {
   mod_plate().logger(VerboseDebugMessage) << "Figuring out mime content type from filetype " << idx_record.filetype() << std::endl;
   // Okay, we've gotten this far without error. Set content type now, so HTTP
   // HEAD returns the correct file type
-  if (idx_record.filetype() == "png")
-    ap_set_content_type(r.writer(), "image/png");
-  else if (idx_record.filetype() == "jpg")
-    ap_set_content_type(r.writer(), "image/jpeg");
-  else if (idx_record.filetype() == "tif")
-    ap_set_content_type(r.writer(), "image/tiff");
-  else
-    ap_set_content_type(r.writer(), "application/octet-stream");
-
-  if (r.args.get("nocache", 0u) == 1) {
-    apr_table_set(r.writer()->headers_out, "Cache-Control", "no-cache");
-  }
-  else {
-    if (level <= 7)
-      apr_table_set(r.writer()->headers_out, "Cache-Control", "max-age=604800");
-    else
-      apr_table_set(r.writer()->headers_out, "Cache-Control", "max-age=1200");
+  ap_set_content_type(r.writer(), tile_content_type(idx_record.filetype()));
+
+  set_cache_control(r, level);
+
+  // Range requests are answered in terms of the tile's bytes, not the blob's.
+  apr_table_set(r.writer()->headers_out, "Accept-Ranges", "bytes");
+
+  // Validators, so clients and caches can revalidate without refetching. The
+  // index keeps no times, so Last-Modified is the transaction id in seconds
+  // past the epoch: it only orders the tile's versions, as If-Modified-Since
+  // needs.
+  apr_table_set(r.writer()->headers_out, "ETag", tile_etag(id, hdr).c_str());
+  ap_update_mtime(r.writer(), apr_time_from_sec(hdr.transaction_id()));
+  ap_set_last_modified(r.writer());
+
+  int condition = ap_meets_conditions(r.writer());
+  if (condition != OK) {
+    mod_plate().logger(VerboseDebugMessage) << "Tile unchanged, status " << condition << std::endl;
+    return condition;
   }
 
   // This is as far as we can go without making the request heavyweight. Bail
@@ -111,41 +244,116 @@ int vw::platefile::handle_image(const ApacheRequest& r) {
     return OK;
 
   // These are the sendfile(2) parameters
-  string filename;
   vw::uint64 offset, size;
+  boost::shared_ptr<PlateModule::OpenBlob> blob = locate_tile(id, index, idx_record, offset, size);
+
+  // Narrow the parameters to the requested range, if there's one we can honour
+  const char* range_header = apr_table_get(r.writer()->headers_in, "Range");
+  if (range_header) {
+    uint64 first, last;
+    switch (parse_byte_range(safe_string_convert(range_header), size, first, last)) {
+      case RangeSatisfiable:
+        apr_table_set(r.writer()->headers_out, "Content-Range",
+            apr_psprintf(r.writer()->pool, "bytes %" APR_UINT64_T_FMT "-%" APR_UINT64_T_FMT "/%" APR_UINT64_T_FMT,
+                         apr_uint64_t(first), apr_uint64_t(last), apr_uint64_t(size)));
+        r.writer()->status = HTTP_PARTIAL_CONTENT;
+        offset += first;
+        size = last - first + 1;
+        break;
+      case RangeUnsatisfiable:
+        apr_table_set(r.writer()->headers_out, "Content-Range",
+            apr_psprintf(r.writer()->pool, "bytes */%" APR_UINT64_T_FMT, apr_uint64_t(size)));
+        return HTTP_RANGE_NOT_SATISFIABLE;
+      case RangeIgnored:
+        // Serve the whole tile. Drop the header so apache's byterange filter
+        // doesn't try to apply it again.
+        apr_table_unset(r.writer()->headers_in, "Range");
+        break;
+    }
+  }
 
-  try {
-    mod_plate().logger(VerboseDebugMessage) << "Fetching blob" << std::endl;
-    // Grab a blob from the blob cache by filename
-    boost::shared_ptr<ReadBlob> blob = mod_plate().get_blob(id, index.filename, idx_record.blob_id());
+  ap_set_content_length(r.writer(), size);
+  send_tile(r, *blob, offset, size);
 
-    mod_plate().logger(VerboseDebugMessage) << "Fetching data from blob" << std::endl;
-    // And calculate the sendfile(2) parameters
-    blob->read_sendfile(idx_record.blob_offset(), filename, offset, size);
+  return OK;
+}
 
-  } catch (const vw::Exception& e) {
-    vw_throw(ServerError() << "Could not load blob data: " << e.what());
-  }
+int vw::platefile::handle_tiles(const ApacheRequest& r) {
+  static const boost::regex match_regex("/(\\w+)/(\\d+)/(\\d+)/(\\d+)/(\\d+)x(\\d+)\\.tiles$");
+
+  boost::smatch match;
+  if (!boost::regex_search(r.url, match, match_regex))
+    return DECLINED;
 
-  apr_file_t *fd = 0;
-  // Open the blob as an apache file with raii (so it goes away when we return)
-  raii file_opener(
-      boost::bind(apr_file_open, &fd, filename.c_str(), APR_READ|APR_FOPEN_SENDFILE_ENABLED, 0, r.writer()->pool),
-      boost::bind(apr_file_close, boost::ref(fd)));
+  mod_plate_mutable().connect_index();
 
-  ap_set_content_length(r.writer(), size);
+  const string& sid = match[1];
+
+  int level  = boost::lexical_cast<int>(match[2]),
+      col    = boost::lexical_cast<int>(match[3]),
+      row    = boost::lexical_cast<int>(match[4]),
+      width  = boost::lexical_cast<int>(match[5]),
+      height = boost::lexical_cast<int>(match[6]);
+
+  VW_ASSERT(width > 0 && height > 0 && width <= MAX_BATCH_TILES && height <= MAX_BATCH_TILES
+            && width * height <= MAX_BATCH_TILES,
+            BadRequest() << "Illegal batch size " << width << "x" << height
+                         << " (at most " << MAX_BATCH_TILES << " tiles)");
+
+  mod_plate().logger(DebugMessage) << "Request Tiles: id["  << sid
+                                   << "] level["  << level
+                                   << "] col["    << col
+                                   << "] row["    << row
+                                   << "] size["   << width << "x" << height << "]" << std::endl;
+
+  const PlateModule::IndexCacheEntry& index = mod_plate().get_index(sid);
+
+  int id = index.index->index_header().platefile_id();
+
+  int transaction_id;
+  bool exact;
+  read_transaction(r, index, transaction_id, exact);
+
+  // One search for the whole region; it loads the pages the reads below need.
+  std::list<TileHeader> tiles = search_tiles(index, level, BBox2i(col, row, width, height), transaction_id, exact);
+
+  ap_set_content_type(r.writer(), apr_psprintf(r.writer()->pool, "multipart/mixed; boundary=%s", BATCH_BOUNDARY));
+  set_cache_control(r, level);
+
+  if (r.header_only())
+    return OK;
 
-  // Use sendfile (if available) to send the proper tile data
-  size_t sent;
-  apr_status_t ap_ret;
+  // Each tile's part names the url it would be served from alone, so clients
+  // can tell which tiles came back (missing ones are just left out).
+  const string prefix = r.url.substr(0, match.position(3));
 
-  if ((ap_ret = ap_send_fd(fd, r.writer(), offset, size, &sent) != APR_SUCCESS)) {
-    char buf[256];
-    apr_strerror(ap_ret, buf, 256);
-    vw_throw(ServerError() << "ap_send_fd failed: " << buf);
+  BOOST_FOREACH(const TileHeader& hdr, tiles) {
+    IndexRecord idx_record;
+    try {
+      idx_record = index.index->read_request(hdr.col(), hdr.row(), hdr.level(), hdr.transaction_id(), true);
+    } catch (const vw::Exception &e) {
+      vw_throw(ServerError() << "Could not read plate index: " << e.what());
+    }
+
+    vw::uint64 offset, size;
+    boost::shared_ptr<PlateModule::OpenBlob> blob = locate_tile(id, index, idx_record, offset, size);
+
+    ap_rprintf(r.writer(),
+        "--%s\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Location: %s%u/%u.%s\r\n"
+        "ETag: %s\r\n"
+        "Content-Length: %" APR_UINT64_T_FMT "\r\n"
+        "\r\n",
+        BATCH_BOUNDARY, tile_content_type(idx_record.filetype()),
+        prefix.c_str(), hdr.col(), hdr.row(), idx_record.filetype().c_str(),
+        tile_etag(id, hdr).c_str(), apr_uint64_t(size));
+    send_tile(r, *blob, offset, size);
+    ap_rputs("\r\n", r.writer());
   }
-  else if (sent != size)
-    vw_throw(ServerError() << "ap_send_fd: short write (expected to send " << size << " bytes, but only sent " << sent);
+  ap_rprintf(r.writer(), "--%s--\r\n", BATCH_BOUNDARY);
+
+  mod_plate().logger(DebugMessage) << "Served " << tiles.size() << " tiles" << std::endl;
 
   return OK;
 }
@@ -17,6 +17,7 @@ class QueryMap;
 class ApacheRequest;
 
 int handle_image(const ApacheRequest& r);
+int handle_tiles(const ApacheRequest& r);
 int  handle_wtml(const ApacheRequest& r);
 
 }} // namespace vw::platefile
@@ -16,6 +16,8 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/lexical_cast.hpp>
 #include <vector>
 #include <map>
 
@@ -108,6 +110,60 @@ void WTMLImageSet::serializeToOstream(std::ostream& o) const {
   o << "</ImageSet>" << std::endl;
 }
 
+RangeResult parse_byte_range(const string& header, uint64 length, uint64& first, uint64& last) {
+  static const string unit("bytes=");
+
+  if (header.compare(0, unit.size(), unit) != 0)
+    return RangeIgnored;
+
+  string spec = header.substr(unit.size());
+  boost::trim(spec);
+
+  if (spec.empty() || spec.find(',') != string::npos)
+    return RangeIgnored;
+
+  size_t dash = spec.find('-');
+  if (dash == string::npos)
+    return RangeIgnored;
+
+  string lo = spec.substr(0, dash), hi = spec.substr(dash+1);
+  boost::trim(lo);
+  boost::trim(hi);
+
+  if (!lo.empty() && lo.find_first_not_of("0123456789") != string::npos)
+    return RangeIgnored;
+  if (!hi.empty() && hi.find_first_not_of("0123456789") != string::npos)
+    return RangeIgnored;
+
+  try {
+    if (lo.empty()) {
+      // bytes=-N: the last N bytes
+      if (hi.empty())
+        return RangeIgnored;
+      uint64 suffix = boost::lexical_cast<uint64>(hi);
+      if (suffix == 0 || length == 0)
+        return RangeUnsatisfiable;
+      first = suffix >= length ? 0 : length - suffix;
+      last  = length - 1;
+      return RangeSatisfiable;
+    }
+
+    first = boost::lexical_cast<uint64>(lo);
+    last  = hi.empty() ? length - 1 : boost::lexical_cast<uint64>(hi);
+  } catch (const boost::bad_lexical_cast&) {
+    // Too big to be a real offset
+    return RangeIgnored;
+  }
+
+  if (!hi.empty() && last < first)
+    return RangeIgnored;
+  if (first >= length)
+    return RangeUnsatisfiable;
+  if (last >= length)
+    last = length - 1;
+  return RangeSatisfiable;
+}
+
 ApacheRequest::ApacheRequest(request_rec* r)
   : r(r), url(safe_string_convert(r->path_info)), args(QueryMap(safe_string_convert(r->args))) {
 
@@ -9,6 +9,7 @@
 #define __VW_PLATE_MOD_PLATE_UTILS_H__
 
 #include <vw/Core/Exception.h>
+#include <vw/Core/FundamentalTypes.h>
 #include <vw/Plate/HTTPUtils.h>
 
 #include <boost/iostreams/stream.hpp>
@@ -52,6 +53,15 @@ struct raii {
   ~raii() {m_leave();}
 };
 
+// How a Range header applies to a body. Only a single byte range is
+// honoured; anything else (several ranges, other units, bad syntax) is
+// RangeIgnored, and the client should get the whole body.
+enum RangeResult { RangeIgnored, RangeSatisfiable, RangeUnsatisfiable };
+
+// Parses a Range header value against a body of the given length. On
+// RangeSatisfiable, [first, last] is the inclusive byte range to send.
+RangeResult parse_byte_range(const std::string& header, uint64 length, uint64& first, uint64& last);
+
 class WTMLImageSet : public std::map<std::string, std::string> {
   typedef std::map<std::string, std::string> map_t;
   typedef std::set<std::string> child_t;
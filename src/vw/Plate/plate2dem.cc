@@ -136,11 +136,14 @@ void do_tiles(boost::shared_ptr<PlateFile> platefile, Options& opt) {
   std::vector<BBox2i> crop_bboxes = image_blocks(crop(plate_view_ref, output_bbox),
                                                  opt.tile_size, opt.tile_size);
 
-  BOOST_FOREACH( BBox2i crop_box, crop_bboxes ) {
+  for ( size_t i = 0; i < crop_bboxes.size(); ++i ) {
     // The crop bboxes start at (0,0), and we want them to start at
     // the upper left corner of the output_bbox.
-    crop_box.min() += output_bbox.min();
-    crop_box.max() += output_bbox.min();
+    BBox2i crop_box = crop_bboxes[i] + output_bbox.min();
+
+    // Warm the index for the next tile while this one is generated
+    if ( i + 1 < crop_bboxes.size() )
+      plate_view.prefetch( (crop_bboxes[i+1] + output_bbox.min()) / scale_change );
 
     { // Checking to see if this section is transparent
       std::list<TileHeader> theaders =
@@ -16,6 +16,7 @@ using namespace vw;
 using namespace vw::platefile;
 
 #include <boost/shared_ptr.hpp>
+#include <boost/next_prior.hpp>
 #include <boost/program_options.hpp>
 #include <boost/filesystem/operations.hpp>
 namespace po = boost::program_options;
@@ -124,6 +125,11 @@ void do_level(int level, BBox2i tile_region, boost::shared_ptr<PlateFile> platef
   for ( std::list<BBox2i>::iterator region_iter = tile_workunits.begin();
         region_iter != tile_workunits.end(); ++region_iter) {
 
+    // Warm the index for the next workunit while this one is exported.
+    std::list<BBox2i>::iterator next_iter = boost::next(region_iter);
+    if (next_iter != tile_workunits.end())
+      platefile->prefetch(level, *next_iter);
+
     // Fetch the list of valid tiles in this particular workunit.
     std::list<TileHeader> tile_records = platefile->search_by_region(level, *region_iter, TransactionRange(transaction_id));
 
@@ -0,0 +1,450 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// Benchmarks for the plate subsystem, run against fixed synthetic
+// datasets so that runs on different builds and machines compare.  Each
+// result is printed to stdout as one JSON object per line.
+
+#include <vw/Plate/detail/Index.h>
+#include <vw/Plate/Datastore.h>
+#include <vw/Plate/PlateFile.h>
+#include <vw/Plate/PlateManager.h>
+#include <vw/Plate/TileManipulation.h>
+#include <vw/Plate/HTTPUtils.h>
+#include <vw/Plate/Exception.h>
+#include <vw/FileIO/TemporaryFile.h>
+#include <vw/Core/Stopwatch.h>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/foreach.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <set>
+
+using namespace vw;
+using namespace vw::platefile;
+namespace d = vw::platefile::detail;
+
+struct Options {
+  Url base;
+  Url mod_plate;
+  std::set<std::string> benches;
+  std::string label;
+  uint32 level, tiles, tile_bytes, reads, searches, mipmap_level, requests, seed;
+};
+
+// One line of output
+class Result {
+    std::vector<std::pair<std::string, std::string> > m_fields;
+  public:
+    Result(const Options& opt, const std::string& bench) {
+      str("benchmark", bench);
+      if (!opt.label.empty())
+        str("label", opt.label);
+    }
+    Result& str(const std::string& key, const std::string& value) {
+      std::string v(value);
+      boost::replace_all(v, "\\", "\\\\");
+      boost::replace_all(v, "\"", "\\\"");
+      m_fields.push_back(std::make_pair(key, "\"" + v + "\""));
+      return *this;
+    }
+    template <class T>
+    Result& num(const std::string& key, T value) {
+      std::ostringstream ostr;
+      ostr << value;
+      m_fields.push_back(std::make_pair(key, ostr.str()));
+      return *this;
+    }
+    // count things done in seconds, as a rate of unit
+    Result& rate(uint64 count, uint64 usec, const std::string& unit) {
+      double seconds = std::max<uint64>(usec, 1) / 1e6;
+      return num("count", count).num("seconds", seconds).num("rate", count / seconds).str("unit", unit);
+    }
+    // Percentiles of the samples, in microseconds
+    Result& latency(std::vector<uint64> samples) {
+      if (samples.empty())
+        return *this;
+      std::sort(samples.begin(), samples.end());
+      uint64 total = 0;
+      BOOST_FOREACH(uint64 s, samples)
+        total += s;
+      return num("mean_us", double(total) / samples.size())
+            .num("p50_us", samples[samples.size() * 50 / 100])
+            .num("p90_us", samples[samples.size() * 90 / 100])
+            .num("p99_us", samples[samples.size() * 99 / 100])
+            .num("max_us", samples.back());
+    }
+    ~Result() {
+      std::cout << "{";
+      for (size_t i = 0; i < m_fields.size(); ++i)
+        std::cout << (i ? ", " : "") << "\"" << m_fields[i].first << "\": " << m_fields[i].second;
+      std::cout << "}" << std::endl;
+    }
+};
+
+// The same numbers on every run
+class Random {
+    uint32 m_state;
+  public:
+    Random(uint32 seed) : m_state(seed ? seed : 1) {}
+    uint32 operator()() {
+      m_state ^= m_state << 13;
+      m_state ^= m_state >> 17;
+      m_state ^= m_state << 5;
+      return m_state;
+    }
+    uint32 operator()(uint32 n) { return (*this)() % n; }
+};
+
+// The dataset: opt.tiles tiles of opt.tile_bytes at opt.level, in
+// row-major order over a square from the origin
+struct Dataset {
+  uint32 level, tiles, side, tile_bytes;
+  std::vector<uint8> payload;
+
+  Dataset(const Options& opt)
+    : level(opt.level), tiles(opt.tiles), tile_bytes(opt.tile_bytes), payload(opt.tile_bytes) {
+    side = 1;
+    while (side * side < tiles)
+      ++side;
+    VW_ASSERT(side <= (1u << level), ArgumentErr() << opt.tiles << " tiles do not fit in level " << level << ".");
+    Random random(opt.seed);
+    BOOST_FOREACH(uint8& b, payload)
+      b = uint8(random());
+  }
+  uint32 col(uint32 i) const { return i % side; }
+  uint32 row(uint32 i) const { return i / side; }
+  // The rows that have tiles
+  uint32 rows() const { return (tiles + side - 1) / side; }
+};
+
+IndexHeader bench_header(uint32 tile_size, PixelFormatEnum pixel_format) {
+  IndexHeader hdr;
+  hdr.set_type("equi");
+  hdr.set_description("plate_bench");
+  hdr.set_tile_size(tile_size);
+  hdr.set_tile_filetype("png");
+  hdr.set_pixel_format(pixel_format);
+  hdr.set_channel_type(VW_CHANNEL_UINT8);
+  return hdr;
+}
+
+// ----------------------- INDEX ----------------------
+
+void bench_index(const Options& opt) {
+  const Dataset data(opt);
+  const PlatefileUrl url(opt.base, "bench_index.plate");
+
+  if (opt.benches.count("index_write")) {
+    boost::shared_ptr<d::Index> index = d::Index::construct_create(url, bench_header(256, VW_PIXEL_RGBA));
+    uint64 t0 = Stopwatch::microtime();
+    Transaction tid = index->transaction_request("plate_bench", -1);
+    uint32 blob_id = index->write_request();
+    for (uint32 i = 0; i < data.tiles; ++i) {
+      TileHeader hdr;
+      hdr.set_col(data.col(i));
+      hdr.set_row(data.row(i));
+      hdr.set_level(data.level);
+      hdr.set_transaction_id(tid);
+      hdr.set_filetype("png");
+      d::IndexRecord rec;
+      rec.set_blob_id(blob_id);
+      rec.set_blob_offset(uint64(i) * data.tile_bytes);
+      rec.set_filetype("png");
+      index->write_update(hdr, rec);
+    }
+    index->write_complete(blob_id);
+    index->transaction_complete(tid, true);
+    index->sync();
+    Result(opt, "index_write").str("index", url.scheme()).num("level", data.level)
+      .rate(data.tiles, Stopwatch::microtime() - t0, "tiles/s");
+  }
+
+  // Each opens the index again, so that its pages are read cold
+  if (opt.benches.count("index_read")) {
+    boost::shared_ptr<d::Index> index = d::Index::construct_open(url);
+    Random random(opt.seed);
+    std::vector<uint64> samples;
+    samples.reserve(opt.reads);
+    uint64 t0 = Stopwatch::microtime();
+    for (uint32 i = 0; i < opt.reads; ++i) {
+      uint32 n = random(data.tiles);
+      uint64 s0 = Stopwatch::microtime();
+      index->read_request(data.col(n), data.row(n), data.level, -1);
+      samples.push_back(Stopwatch::microtime() - s0);
+    }
+    Result(opt, "index_read").str("index", url.scheme()).num("level", data.level)
+      .rate(opt.reads, Stopwatch::microtime() - t0, "reads/s").latency(samples);
+  }
+
+  if (opt.benches.count("search")) {
+    boost::shared_ptr<d::Index> index = d::Index::construct_open(url);
+    for (uint32 size = 1; size <= data.side; size *= 4) {
+      Random random(opt.seed + size);
+      std::vector<uint64> samples;
+      uint64 found = 0, t0 = Stopwatch::microtime();
+      for (uint32 i = 0; i < opt.searches; ++i) {
+        BBox2i region(random(data.side - size + 1), random(data.rows() - std::min(size, data.rows()) + 1), size, size);
+        uint64 s0 = Stopwatch::microtime();
+        found += index->search_by_region(data.level, region, 0, d::MAX_TRANSACTION).size();
+        samples.push_back(Stopwatch::microtime() - s0);
+      }
+      Result(opt, "search").str("index", url.scheme()).num("level", data.level).num("region", size)
+        .num("tiles", found).rate(opt.searches, Stopwatch::microtime() - t0, "searches/s").latency(samples);
+    }
+  }
+}
+
+// ----------------------- BLOBS ----------------------
+
+void bench_blobs(const Options& opt) {
+  const Dataset data(opt);
+  const PlatefileUrl url(opt.base, "bench_blob.plate");
+
+  if (opt.benches.count("blob_write")) {
+    boost::scoped_ptr<Datastore> store(Datastore::open(url, bench_header(256, VW_PIXEL_RGBA)));
+    uint64 t0 = Stopwatch::microtime();
+    Transaction tid = store->transaction_begin("plate_bench", -1);
+    boost::scoped_ptr<WriteState> state(store->write_request(tid));
+    for (uint32 i = 0; i < data.tiles; ++i)
+      store->write_update(*state, data.level, data.row(i), data.col(i), "png", &data.payload[0], data.tile_bytes);
+    store->write_complete(*state);
+    store->transaction_end(tid, true);
+    store->flush();
+    uint64 usec = Stopwatch::microtime() - t0;
+    Result(opt, "blob_write").str("index", url.scheme()).num("tile_bytes", data.tile_bytes)
+      .num("mb_per_s", double(data.tiles) * data.tile_bytes / usec)
+      .rate(data.tiles, usec, "tiles/s");
+  }
+
+  if (opt.benches.count("blob_read")) {
+    boost::scoped_ptr<Datastore> store(Datastore::open(url));
+    Random random(opt.seed);
+    std::vector<uint64> samples;
+    samples.reserve(opt.reads);
+    uint64 bytes = 0, t0 = Stopwatch::microtime();
+    for (uint32 i = 0; i < opt.reads; ++i) {
+      uint32 n = random(data.tiles);
+      Datastore::TileSearch tiles;
+      uint64 s0 = Stopwatch::microtime();
+      store->get(tiles, data.level, data.row(n), data.col(n), TransactionRange(-1, -1), 1);
+      samples.push_back(Stopwatch::microtime() - s0);
+      VW_ASSERT(tiles.size() == 1, TileNotFoundErr() << "blob_read: no tile at " << data.col(n) << "," << data.row(n) << ".");
+      bytes += tiles.front().data->size();
+    }
+    uint64 usec = Stopwatch::microtime() - t0;
+    Result(opt, "blob_read").str("index", url.scheme()).num("tile_bytes", data.tile_bytes)
+      .num("mb_per_s", double(bytes) / usec)
+      .rate(opt.reads, usec, "tiles/s").latency(samples);
+  }
+}
+
+// ----------------------- MIPMAP ----------------------
+
+typedef PixelRGBA<uint8> MipmapPixel;
+
+ImageView<MipmapPixel> synthetic_tile(uint32 size, uint32 col, uint32 row, Random& random) {
+  ImageView<MipmapPixel> tile(size, size);
+  for (uint32 y = 0; y < size; ++y)
+    for (uint32 x = 0; x < size; ++x) {
+      uint8 noise = uint8(random() & 0x1f);
+      tile(x, y) = MipmapPixel(uint8(x + col), uint8(y + row), noise, 255);
+    }
+  return tile;
+}
+
+void bench_mipmap(const Options& opt) {
+  const uint32 tile_size = 256, kernel_tiles = 2000;
+
+  if (opt.benches.count("mipmap_kernel")) {
+    Random random(opt.seed);
+    ImageView<MipmapPixel> children[4];
+    for (uint32 i = 0; i < 4; ++i)
+      children[i] = synthetic_tile(tile_size, i % 2, i / 2, random);
+    const DownsampleFilter filters[] = { POINT_DOWNSAMPLE, BOX_DOWNSAMPLE, TENT_DOWNSAMPLE };
+    const char* names[] = { "point", "box", "tent" };
+    for (uint32 f = 0; f < 3; ++f) {
+      ImageView<MipmapPixel> parent;
+      uint64 t0 = Stopwatch::microtime();
+      for (uint32 i = 0; i < kernel_tiles; ++i)
+        mipmap_one_tile(parent, tile_size, children[0], children[1], children[2], children[3], filters[f]);
+      Result(opt, "mipmap_kernel").str("filter", names[f]).num("tile_size", tile_size)
+        .rate(kernel_tiles, Stopwatch::microtime() - t0, "tiles/s");
+    }
+  }
+
+  if (opt.benches.count("mipmap")) {
+    const PlatefileUrl url(opt.base, "bench_mipmap.plate");
+    const uint32 side = 1u << opt.mipmap_level;
+    boost::shared_ptr<PlateFile> plate(new PlateFile(url, "equi", "plate_bench", tile_size, "png", VW_PIXEL_RGBA, VW_CHANNEL_UINT8));
+    Random random(opt.seed);
+    Transaction tid = plate->transaction_begin("plate_bench", -1);
+    plate->write_request();
+    for (uint32 row = 0; row < side; ++row)
+      for (uint32 col = 0; col < side; ++col)
+        plate->write_update(synthetic_tile(tile_size, col, row, random), col, row, opt.mipmap_level);
+    plate->write_complete();
+    plate->transaction_end(true);
+
+    boost::scoped_ptr<PlateManager<MipmapPixel> > pm(PlateManager<MipmapPixel>::make("equi", plate));
+    uint64 t0 = Stopwatch::microtime();
+    plate->transaction_resume(tid);
+    plate->write_request();
+    pm->mipmap(opt.mipmap_level, BBox2i(0, 0, side, side), tid, true);
+    plate->write_complete();
+    plate->transaction_end(true);
+    // A parent for every 4 tiles, up to the root
+    uint64 parents = 0;
+    for (uint32 level = 0; level < opt.mipmap_level; ++level)
+      parents += uint64(1) << (2 * level);
+    Result(opt, "mipmap").str("index", url.scheme()).num("level", opt.mipmap_level).num("tile_size", tile_size)
+      .rate(parents, Stopwatch::microtime() - t0, "tiles/s");
+  }
+}
+
+// ----------------------- MOD_PLATE ----------------------
+
+// GETs the path with HTTP/1.0, and returns the status.
+int http_get(const std::string& host, const std::string& port, const std::string& path, uint64& bytes) {
+  addrinfo hints, *addrs;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  int err = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &addrs);
+  if (err)
+    vw_throw(NetworkErr() << "Could not look up " << host << ": " << gai_strerror(err));
+
+  int fd = -1;
+  for (addrinfo* a = addrs; a && fd < 0; a = a->ai_next) {
+    fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd >= 0 && ::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+  ::freeaddrinfo(addrs);
+  if (fd < 0)
+    vw_throw(NetworkErr() << "Could not connect to " << host << ":" << port << ": " << ::strerror(errno));
+
+  std::string request = "GET " + path + " HTTP/1.0\r\nHost: " + host + "\r\n\r\n";
+  if (::send(fd, request.data(), request.size(), 0) != ssize_t(request.size())) {
+    ::close(fd);
+    vw_throw(NetworkErr() << "Could not send a request to " << host << ":" << port << ": " << ::strerror(errno));
+  }
+
+  std::string response;
+  char buf[65536];
+  ssize_t n;
+  while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0)
+    response.append(buf, n);
+  ::close(fd);
+  bytes += response.size();
+
+  // HTTP/1.x 200 OK
+  size_t space = response.find(' ');
+  if (space == std::string::npos)
+    vw_throw(NetworkErr() << "Bad response from " << host << ":" << port << ".");
+  return std::atoi(response.c_str() + space + 1);
+}
+
+// Tiles of the mipmap dataset, requested from a mod_plate serving it at
+// opt.mod_plate, as http://host/<prefix>/<platefile id>.
+void bench_mod_plate(const Options& opt) {
+  const uint32 side = 1u << opt.mipmap_level;
+  const std::string host = opt.mod_plate.hostname();
+  const std::string port = boost::lexical_cast<std::string>(opt.mod_plate.port() ? opt.mod_plate.port() : 80);
+  Random random(opt.seed);
+  std::vector<uint64> samples;
+  samples.reserve(opt.requests);
+  uint64 bytes = 0, errors = 0, t0 = Stopwatch::microtime();
+  for (uint32 i = 0; i < opt.requests; ++i) {
+    std::ostringstream path;
+    path << opt.mod_plate.path() << "/" << opt.mipmap_level << "/" << random(side) << "/" << random(side) << ".png";
+    uint64 s0 = Stopwatch::microtime();
+    if (http_get(host, port, path.str(), bytes) != 200)
+      ++errors;
+    samples.push_back(Stopwatch::microtime() - s0);
+  }
+  uint64 usec = Stopwatch::microtime() - t0;
+  Result(opt, "mod_plate").num("level", opt.mipmap_level).num("errors", errors)
+    .num("mb_per_s", double(bytes) / usec)
+    .rate(opt.requests, usec, "requests/s").latency(samples);
+}
+
+int main(int argc, char** argv) {
+  Options opt;
+  std::string benches;
+
+  po::options_description general_options("Benchmarks the plate index, blobs, mipmapping and mod_plate");
+  general_options.add_options()
+    ("base",         po::value(&opt.base), "Create the benchmark plates under this url: a directory, or an index server. Defaults to a temporary directory. It should not hold plates from an earlier run.")
+    ("bench",        po::value(&benches)->default_value("index_write,index_read,search,blob_write,blob_read,mipmap_kernel,mipmap"),
+                     "Comma separated benchmarks to run. The read benchmarks use the plates the write ones made. mod_plate also needs --mod-plate.")
+    ("label",        po::value(&opt.label), "Added to every result, to tell runs apart.")
+    ("level",        po::value(&opt.level)->default_value(10), "Level of the index and blob datasets.")
+    ("tiles",        po::value(&opt.tiles)->default_value(65536), "Tiles in the index and blob datasets.")
+    ("tile-bytes",   po::value(&opt.tile_bytes)->default_value(16384), "Bytes in each tile of the blob dataset.")
+    ("reads",        po::value(&opt.reads)->default_value(20000), "Random reads of the index and blob datasets.")
+    ("searches",     po::value(&opt.searches)->default_value(200), "Region searches of each size.")
+    ("mipmap-level", po::value(&opt.mipmap_level)->default_value(5), "Level of the mipmap dataset, which is full.")
+    ("mod-plate",    po::value(&opt.mod_plate), "Url of a mod_plate serving the mipmap dataset, http://host/<prefix>/<platefile id>.")
+    ("requests",     po::value(&opt.requests)->default_value(2000), "Requests of mod_plate.")
+    ("seed",         po::value(&opt.seed)->default_value(1), "Seed of the synthetic data and the random reads.")
+    ("help,h",       "Display this help message");
+
+  po::variables_map vm;
+  po::store( po::command_line_parser( argc, argv ).options(general_options).run(), vm );
+  po::notify( vm );
+
+  std::ostringstream usage;
+  usage << "Usage: " << argv[0] << " [options]\n\n";
+  usage << general_options << std::endl;
+
+  if( vm.count("help") ) {
+    std::cout << usage.str();
+    return 1;
+  }
+
+  std::vector<std::string> names;
+  boost::split(names, benches, boost::is_any_of(","), boost::token_compress_on);
+  opt.benches.insert(names.begin(), names.end());
+
+  boost::scoped_ptr<TemporaryDir> tmp;
+  if (!vm.count("base")) {
+    tmp.reset(new TemporaryDir("", true, "plate_bench"));
+    opt.base = Url(tmp->filename());
+  }
+
+  try {
+    bench_index(opt);
+    bench_blobs(opt);
+    bench_mipmap(opt);
+    if (opt.benches.count("mod_plate")) {
+      VW_ASSERT(vm.count("mod-plate"), ArgumentErr() << "The mod_plate benchmark needs --mod-plate.");
+      bench_mod_plate(opt);
+    }
+  } catch (const vw::Exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -6,6 +6,7 @@
 
 #include <vw/Plate/PlateFile.h>
 #include <vw/Plate/detail/MipmapHelpers.h>
+#include <vw/Plate/detail/TilePool.h>
 #include <vw/Plate/TileManipulation.h>
 using namespace vw;
 using namespace vw::platefile;
@@ -15,6 +16,7 @@ namespace d = vw::platefile::detail;
 #include <boost/lexical_cast.hpp>
 #include <boost/program_options.hpp>
 #include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
 namespace po = boost::program_options;
 
 class CopyParameters {
@@ -75,46 +77,68 @@ public:
   }
 };
 
+// Copies the tiles of one shard of a level. Each shard reads through its
+// own plate, since a remote plate's connection may only be used by the
+// thread that opened it; the tiles go back to the pool to be written.
+class CopyShardTask : public Task, private boost::noncopyable {
+    d::TilePool& m_pool;
+    Url m_url;
+    int m_level;
+    BBox2i m_region;
+    TransactionOrNeg m_tid;
+    size_t m_batch_tiles;
+  public:
+    CopyShardTask(d::TilePool& pool, const Url& url, int level, const BBox2i& region,
+                  TransactionOrNeg tid, size_t batch_tiles)
+      : m_pool(pool), m_url(url), m_level(level), m_region(region), m_tid(tid), m_batch_tiles(batch_tiles) {}
+
+    void operator()() {
+      ReadOnlyPlateFile input_plate(m_url);
+      std::list<TileHeader> hdrs = input_plate.search_by_region( m_level, m_region, m_tid );
+      while (!hdrs.empty()) {
+        Datastore::TileSearch tile_lookup;
+        while (!hdrs.empty() && tile_lookup.size() < m_batch_tiles) {
+          tile_lookup.push_back(hdrs.front());
+          hdrs.pop_front();
+        }
+        // Load tiles from input and hand them to the output without
+        // decoding the imagery.
+        BOOST_FOREACH( const Tile& t, input_plate.batch_read(tile_lookup) )
+          m_pool.write( t.data, t.hdr.col(), t.hdr.row(), m_level, t.hdr.filetype() );
+      }
+    }
+};
+
 template <class PixelT>
 void copy_job( int level, BBox2i const& region,
                TransactionOrNeg input_tid,
                boost::shared_ptr<ReadOnlyPlateFile> input_plate,
+               const Url& input_url,
                boost::shared_ptr<PlateFile> output_plate,
                const ProgressCallback &progress ) {
+  const uint32 threads = vw_settings().default_num_threads();
   const uint64 TILE_BYTES  = input_plate->default_tile_size() * input_plate->default_tile_size() * uint32(PixelNumBytes<PixelT>::value);
   const uint64 CACHE_BYTES = vw_settings().system_cache_size();
-  const uint64 CACHE_TILES = CACHE_BYTES / TILE_BYTES;
+  // Every shard in flight holds a batch of tiles
+  const uint64 CACHE_TILES = CACHE_BYTES / TILE_BYTES / threads;
   VW_ASSERT( CACHE_TILES > 1, LogicErr() << "Cache too small to process any tiles in snapshot." );
   // This is an arbitrary value, to hopefully catch
   // pathlogically-small cache sizes
   if ( CACHE_TILES < 100 )
-    vw_out(WarningMessage) << "You will lose a lot speed to thrashing if you can't cache at least 100 tiles (you can only store " << CACHE_TILES << ")\n";
-
-  std::list<BBox2i> sub_regions = bbox_tiles(region, 512, 512);
-  float inc_amt = 1./float(sub_regions.size());
-  progress.report_progress(0);
-  BOOST_FOREACH( const BBox2i& sub_region, sub_regions ) {
-    std::list<TileHeader> hdrs = input_plate->search_by_region( level, sub_region, input_tid );
-    size_t hdrs_size = hdrs.size();
-    for ( size_t i = 0; i < hdrs_size; i += CACHE_TILES ) {
-      std::list<TileHeader>::const_iterator hdrs_start = hdrs.begin(), hdrs_stop = hdrs.begin();
-      std::advance(hdrs_start, i);
-      std::advance(hdrs_stop, i + ((i+CACHE_TILES < hdrs_size) ? CACHE_TILES : hdrs_size - i ) );
-      Datastore::TileSearch tile_lookup;
-      std::copy( hdrs_start, hdrs_stop, std::back_inserter(tile_lookup));
-      // Load tiles from input and immediately write to output with
-      // out decoding the imagery.
-      BOOST_FOREACH( const Tile& t, input_plate->batch_read(tile_lookup) ) {
-        output_plate->write_update( &t.data->operator[](0), t.data->size(), t.hdr.col(), t.hdr.row(), level, t.hdr.filetype() );
-      }
-    }
-    progress.report_incremental_progress(inc_amt);
-  }
-  progress.report_finished();
+    vw_out(WarningMessage) << "You will lose a lot speed to thrashing if you can't cache at least 100 tiles per thread (you can only store " << CACHE_TILES << ")\n";
+
+  // The shards follow the index pages, so no two read the same page
+  BBox2i level_region = region;
+  level_region.crop(d::move_down(BBox2i(0,0,1,1), level));
+  d::TilePool pool(*output_plate, threads);
+  BOOST_FOREACH( const BBox2i& shard, shard_region(level_region, 256, threads) )
+    pool.add(new CopyShardTask(pool, input_url, level, shard, input_tid, CACHE_TILES));
+  pool.join(progress);
 }
 
 template <class PixelT>
 void do_copy(boost::shared_ptr<ReadOnlyPlateFile> input_plate,
+             const Url& input_url,
              boost::shared_ptr<PlateFile> output_plate,
              CopyParameters& copy_parameters ) {
   if (copy_parameters.level != -1 ) {
@@ -127,7 +151,7 @@ void do_copy(boost::shared_ptr<ReadOnlyPlateFile> input_plate,
 
     copy_job<PixelT>(copy_parameters.level, copy_parameters.region,
                      copy_parameters.transaction_input_id,
-                     input_plate, output_plate,
+                     input_plate, input_url, output_plate,
                      TerminalProgressCallback("plate.tools.platecopy",""));
 
     output_plate->write_complete();
@@ -139,14 +163,16 @@ void do_copy(boost::shared_ptr<ReadOnlyPlateFile> input_plate,
     // If no region was specified, then copy the entire transaction
     output_plate->transaction_begin("Full copy (requested t_if: " + vw::stringify(copy_parameters.transaction_output_id) + ")",
                                     copy_parameters.transaction_output_id );
+    output_plate->write_request();
 
     for ( int32 level = 0; level < input_plate->num_levels(); level++ ) {
       copy_job<PixelT>(level, d::move_down(BBox2i(0,0,1,1), level),
                        copy_parameters.transaction_input_id,
-                       input_plate, output_plate,
+                       input_plate, input_url, output_plate,
                        TerminalProgressCallback("plate.tools.platecopy","Level: " + stringify(level)));
     }
 
+    output_plate->write_complete();
     output_plate->transaction_end(true);
   }
 }
@@ -157,6 +183,7 @@ int main( int argc, char *argv[] ) {
   std::string start_description;
   std::string region_string;
   TransactionOrNeg transaction_input_id = -1, transaction_output_id = -1;
+  uint32 num_threads = 0;
 
   po::options_description general_options("Copies transactions from one plate to another.");
   general_options.add_options()
@@ -165,6 +192,7 @@ int main( int argc, char *argv[] ) {
     ("transaction-output,t",  po::value(&transaction_output_id), "Transaction ID to write to output plate")
     ("transaction-input,i", po::value(&transaction_input_id), "Transaction ID to read from input plate")
     ("region", po::value(&region_string), "where arg = <ul_x>, <ul_y>:<lr_x>, <lr_y>@<level> - Limit the snapshot to the region bounded by these upper left (ul) and lower right (lr) coordinates at the level specified.")
+    ("num-threads", po::value(&num_threads), "Number of threads to copy with. Zero (the default) uses the visionworkbench default number of threads.")
     ("help,h", "Display this help message");
 
   po::options_description hidden_options("");
@@ -199,6 +227,9 @@ int main( int argc, char *argv[] ) {
     return 1;
   }
 
+  if ( num_threads > 0 )
+    vw_settings().set_default_num_threads(num_threads);
+
   try {
     boost::shared_ptr<ReadOnlyPlateFile> input_plate;
     boost::shared_ptr<PlateFile> output_plate;
@@ -232,11 +263,11 @@ int main( int argc, char *argv[] ) {
     case VW_PIXEL_GRAYA:
       switch(input_plate->channel_type()) {
       case VW_CHANNEL_UINT8:
-        do_copy<PixelGrayA<uint8> >(input_plate, output_plate, copy_params); break;
+        do_copy<PixelGrayA<uint8> >(input_plate, input_url, output_plate, copy_params); break;
       case VW_CHANNEL_INT16:
-        do_copy<PixelGrayA<int16> >(input_plate, output_plate, copy_params); break;
+        do_copy<PixelGrayA<int16> >(input_plate, input_url, output_plate, copy_params); break;
       case VW_CHANNEL_FLOAT32:
-        do_copy<PixelGrayA<float32> >(input_plate, output_plate, copy_params); break;
+        do_copy<PixelGrayA<float32> >(input_plate, input_url, output_plate, copy_params); break;
       default:
         vw_throw(ArgumentErr() << "Plate contains a channel type not supported by platecopy.\n");
         return 1;
@@ -245,7 +276,7 @@ int main( int argc, char *argv[] ) {
     case VW_PIXEL_RGBA:
       switch(input_plate->channel_type()) {
       case VW_CHANNEL_UINT8:
-        do_copy<PixelRGBA<uint8> >(input_plate, output_plate, copy_params); break;
+        do_copy<PixelRGBA<uint8> >(input_plate, input_url, output_plate, copy_params); break;
       default:
         vw_throw(ArgumentErr() << "Plate contains a channel type not supported by platecopy.\n");
         return 1;
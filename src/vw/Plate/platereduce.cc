@@ -8,10 +8,13 @@
 #include <vw/Image.h>
 #include <vw/Plate/PlateFile.h>
 #include <vw/Plate/TileManipulation.h>
+#include <vw/Plate/detail/TilePool.h>
 using namespace vw;
 using namespace vw::platefile;
+namespace d = vw::platefile::detail;
 
 #include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
 
@@ -276,6 +279,7 @@ struct Options {
 
   // For spawning multiple jobs
   int32 job_id, num_jobs;
+  uint32 num_threads;
 };
 
 void handle_arguments(int argc, char *argv[], Options& opt) {
@@ -283,6 +287,7 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
   general_options.add_options()
     ("job_id,j", po::value(&opt.job_id)->default_value(0), "")
     ("num_jobs,n", po::value(&opt.num_jobs)->default_value(1), "")
+    ("num-threads", po::value(&opt.num_threads)->default_value(0), "Number of threads for each job. Zero uses the visionworkbench default number of threads.")
     ("begin_transaction", po::value(&opt.start_trans_id)->default_value(0), "Input starting transaction ID range.")
     ("end_transaction", po::value(&opt.end_trans_id), "Input ending transaction ID range.")
     ("level,l", po::value(&opt.level)->default_value(-1), "Level inside the plate in which to process. -1 will error out and show the number of levels available.")
@@ -316,10 +321,59 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
 
   if ( vm.count("help") || vm.count("input-file") != 1 || opt.transaction_id.newest())
     vw_throw( ArgumentErr() << usage.str() << general_options );
+
+  if ( opt.num_threads > 0 )
+    vw_settings().set_default_num_threads(opt.num_threads);
 }
 
 // --- Meta Application of Above Functions ----------
 
+// Reduces the tiles of one shard. Each shard reads through its own plate,
+// since a remote plate's connection may only be used by the thread that
+// opened it; the results go back to the pool to be written.
+template <typename ReduceT, class PixelT>
+class ReduceShardTask : public Task, private boost::noncopyable {
+  d::TilePool& m_pool;
+  const Options& m_opt;
+  BBox2i m_shard;
+  ReduceT m_reduce;
+public:
+  ReduceShardTask( d::TilePool& pool, const Options& opt, const BBox2i& shard, const ReduceT& reduce )
+    : m_pool(pool), m_opt(opt), m_shard(shard), m_reduce(reduce) {}
+
+  void operator()() {
+    ReadOnlyPlateFile platefile(m_opt.url);
+    platefile.set_tile_cache( &plate_tile_cache() );
+
+    // One search for the whole shard, then sorted out by location
+    typedef std::map<d::rowcol_t, std::list<TileHeader> > location_map;
+    location_map locations;
+    BOOST_FOREACH( const TileHeader& tile,
+                   platefile.search_by_region(m_opt.level, m_shard,
+                                              TransactionRange(m_opt.start_trans_id, m_opt.end_trans_id)) )
+      locations[d::rowcol_t(tile.row(), tile.col())].push_back(tile);
+
+    BOOST_FOREACH( const typename location_map::value_type& location, locations ) {
+      const std::list<TileHeader>& tile_records = location.second;
+
+      // Loading images
+      std::list<ImageView<PixelT> > tiles;
+      BOOST_FOREACH( const TileHeader& tile, tile_records ) {
+        ImageView<PixelT> new_tile;
+        platefile.read( new_tile, tile.col(), tile.row(), m_opt.level,
+                        tile.transaction_id(), true );
+        tiles.push_back(new_tile);
+      }
+
+      // Calling function
+      ImageView<PixelT> result;
+      m_reduce(tiles, tile_records, result);
+
+      m_pool.write(result, d::thecol(location.first), d::therow(location.first), m_opt.level);
+    }
+  }
+};
+
 // apply_reduce
 template <typename ReduceT, class PixelT>
 void apply_reduce( boost::shared_ptr<PlateFile> platefile,
@@ -327,44 +381,10 @@ void apply_reduce( boost::shared_ptr<PlateFile> platefile,
                    Options& opt, ReduceBase<ReduceT>& reduce) {
 
   TerminalProgressCallback tpc("plate.platereduce", "Processing");
-  double inc_tpc = 1.0/float(workunits.size());
-  BOOST_FOREACH( const BBox2i& workunit, workunits) {
-    tpc.report_incremental_progress(inc_tpc);
-    for ( int ix = 0; ix < workunit.width(); ix++ ) {
-      for ( int iy = 0; iy < workunit.height(); iy++ ) {
-        Vector2i location(ix,iy);
-        location += workunit.min();
-
-        // Polling for Tiles
-        std::list<TileHeader> tile_records;
-        tile_records = platefile->search_by_location(location[0],
-                                                     location[1],
-                                                     opt.level,
-                                                     TransactionRange(opt.start_trans_id, opt.end_trans_id));
-
-        // No Tiles? No Problem!
-        if (tile_records.empty())
-          continue;
-
-        // Loading images
-        std::list<ImageView<PixelT> > tiles;
-        BOOST_FOREACH( const TileHeader& tile, tile_records ) {
-          ImageView<PixelT> new_tile;
-          platefile->read( new_tile, location[0],
-                           location[1], opt.level,
-                           tile.transaction_id(), true );
-          tiles.push_back(new_tile);
-        }
-
-        // Calling function
-        ImageView<PixelT> result;
-        reduce(tiles, tile_records, result);
-
-        platefile->write_update(result, location[0], location[1], opt.level);
-      }
-    }
-  }
-  tpc.report_finished();
+  d::TilePool pool(*platefile);
+  BOOST_FOREACH( const BBox2i& workunit, workunits)
+    pool.add(new ReduceShardTask<ReduceT, PixelT>(pool, opt, workunit, reduce.impl()));
+  pool.join(tpc);
 }
 
 // Function that runs the apply_reduce over the plate file
@@ -372,6 +392,7 @@ template <typename ReduceT>
 void do_run( Options& opt, ReduceBase<ReduceT>& reduce ) {
   boost::shared_ptr<PlateFile> platefile =
     boost::shared_ptr<PlateFile>( new PlateFile(opt.url) );
+  platefile->set_tile_cache( &plate_tile_cache() );
 
   if ( !opt.start_description.empty() ) {
     platefile->transaction_begin(opt.start_description, opt.transaction_id );
@@ -395,10 +416,11 @@ void do_run( Options& opt, ReduceBase<ReduceT>& reduce ) {
               << platefile->num_levels() << " levels internally.\n" );
   }
 
-  // This is arbitrary, just needed to divide up jobs
+  // Shards don't cross index pages, and are made small enough that there
+  // are enough to keep every thread of every job busy.
   int32 region_size = 1 << opt.level;
   BBox2i full_region(0,0,region_size,region_size);
-  std::list<BBox2i> workunits = bbox_tiles(full_region,4,4);
+  std::list<BBox2i> workunits = shard_region(full_region, 256, opt.num_jobs * vw_settings().default_num_threads());
   std::list<BBox2i> mworkunits;
   int32 count = 0;
   BOOST_FOREACH(const BBox2i& c, workunits) {
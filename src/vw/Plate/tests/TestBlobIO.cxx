@@ -12,6 +12,8 @@
 #include <vw/Plate/BlobManager.h>
 #include <vw/Plate/Rpc.pb.h>
 
+#include <vw/Core/Thread.h>
+
 #include <boost/filesystem/operations.hpp>
 namespace fs = boost::filesystem;
 
@@ -110,6 +112,100 @@ TEST_F(BlobIOTest, WriteThenRead) {
   }
 }
 
+TEST_F(BlobIOTest, MmapRead) {
+  std::vector<int64> offsets;
+  {
+    Blob blob(blob_path);
+    for (int i = 0; i < 5; ++i)
+      offsets.push_back(blob.write(hdr, test_data, data_size));
+  }
+
+  ReadBlob blob(blob_path, ReadBlob::MmapMode);
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    TileData verify_data = blob.read_data(offsets[i]);
+    EXPECT_RANGE_EQ(test_data+0, test_data+data_size, verify_data->begin(), verify_data->end());
+    EXPECT_EQ(hdr.filetype(), blob.read_header(offsets[i]).filetype());
+  }
+}
+
+TEST_F(BlobIOTest, WriteCombining) {
+  Blob blob(blob_path, 5 * 40);
+  std::vector<int64> offsets;
+  for (int i = 0; i < 3; ++i)
+    offsets.push_back(blob.write(hdr, test_data, data_size));
+
+  // Still buffered: only the writer can see them
+  EXPECT_LT(0u, blob.buffered_size());
+  EXPECT_EQ(24u, ReadBlob(blob_path).size());
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    TileData verify_data = blob.read_data(offsets[i]);
+    EXPECT_RANGE_EQ(test_data+0, test_data+data_size, verify_data->begin(), verify_data->end());
+  }
+
+  // Filling the buffer sends it all out at once
+  while (blob.buffered_size() > 0)
+    offsets.push_back(blob.write(hdr, test_data, data_size));
+  {
+    ReadBlob reader(blob_path);
+    EXPECT_EQ(blob.size(), reader.size());
+    for (size_t i = 0; i < offsets.size(); ++i) {
+      TileData verify_data = reader.read_data(offsets[i]);
+      EXPECT_RANGE_EQ(test_data+0, test_data+data_size, verify_data->begin(), verify_data->end());
+    }
+  }
+
+  offsets.push_back(blob.write(hdr, test_data, data_size));
+  blob.flush();
+  EXPECT_EQ(0u, blob.buffered_size());
+  TileData verify_data = ReadBlob(blob_path).read_data(offsets.back());
+  EXPECT_RANGE_EQ(test_data+0, test_data+data_size, verify_data->begin(), verify_data->end());
+}
+
+namespace {
+  // Reads every tile of a blob, checking each against its column.
+  struct ReadTiles {
+    ReadBlob& blob;
+    const std::vector<int64>& offsets;
+    bool ok;
+    ReadTiles(ReadBlob& blob, const std::vector<int64>& offsets) : blob(blob), offsets(offsets), ok(true) {}
+    void operator()() {
+      for (int pass = 0; pass < 20; ++pass)
+        for (size_t i = 0; i < offsets.size(); ++i) {
+          size_t j = (i * 7 + pass) % offsets.size();
+          TileData data = blob.read_data(offsets[j]);
+          if (blob.read_header(offsets[j]).col() != int32(j) || data->size() != j + 1 || (*data)[j] != uint8(j))
+            ok = false;
+        }
+    }
+  };
+}
+
+TEST_F(BlobIOTest, ConcurrentReads) {
+  std::vector<int64> offsets;
+  {
+    Blob blob(blob_path);
+    std::vector<uint8> data;
+    for (int32 i = 0; i < 50; ++i) {
+      data.push_back(uint8(i));
+      hdr.set_col(i);
+      offsets.push_back(blob.write(hdr, &data[0], data.size()));
+    }
+  }
+
+  // One blob, shared by all the readers
+  ReadBlob blob(blob_path);
+  std::vector<boost::shared_ptr<ReadTiles> > readers;
+  std::vector<boost::shared_ptr<Thread> > threads;
+  for (int i = 0; i < 4; ++i) {
+    readers.push_back( boost::shared_ptr<ReadTiles>( new ReadTiles(blob, offsets) ) );
+    threads.push_back( boost::shared_ptr<Thread>( new Thread(readers.back()) ) );
+  }
+  for (int i = 0; i < 4; ++i) {
+    threads[i]->join();
+    EXPECT_TRUE( readers[i]->ok );
+  }
+}
+
 #if 0
 // This test needs to be updated with some test material (and it should use the
 // fixture, and not use hard-coded paths)
@@ -117,3 +117,49 @@ TEST_F(BlobManagerTest, Scan) {
   EXPECT_EQ(4, bm->blob_size(id2));
   EXPECT_EQ(6, bm->blob_size(id3));
 }
+
+TEST_F(BlobManagerTest, Affinity) {
+  // Each named writer gets a blob of its own, and keeps it
+  uint32 a = bm->request_lock("a");
+  uint32 b = bm->request_lock("b");
+  EXPECT_NE(a, b);
+  bm->release_lock(a);
+  bm->release_lock(b);
+
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(a, bm->request_lock("a"));
+    EXPECT_EQ(b, bm->request_lock("b"));
+    bm->release_lock(a);
+    bm->release_lock(b);
+  }
+
+  // Nobody else is offered an owned blob
+  uint32 anon = bm->request_lock();
+  EXPECT_NE(a, anon);
+  EXPECT_NE(b, anon);
+  bm->release_lock(anon);
+
+  // Two writes at once from one writer can't share its blob
+  uint32 a1 = bm->request_lock("a");
+  uint32 a2 = bm->request_lock("a");
+  EXPECT_EQ(a, a1);
+  EXPECT_NE(a1, a2);
+  bm->release_lock(a1);
+  bm->release_lock(a2);
+  EXPECT_EQ(a, bm->request_lock("a"));
+  bm->release_lock(a);
+
+  // Once its blob is full, the writer moves on, and the full blob is left alone
+  EXPECT_EQ(a, bm->request_lock("a"));
+  write_to_blob(a, "abcdefg", 7);
+  ASSERT_NO_FATAL_FAILURE();
+  fs::resize_file(bm->name_from_id(a), 1717986921);
+  bm->release_lock(a);
+  uint32 next = bm->request_lock("a");
+  EXPECT_NE(a, next);
+  EXPECT_NE(b, next);
+  bm->release_lock(next);
+  EXPECT_EQ(next, bm->request_lock("a"));
+  bm->release_lock(next);
+  EXPECT_NE(a, bm->request_lock());
+}
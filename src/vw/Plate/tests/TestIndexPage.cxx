@@ -9,6 +9,11 @@
 #include <test/Helpers.h>
 #include <vw/Plate/detail/LocalIndex.h>
 #include <vw/Plate/Exception.h>
+#include <vw/Plate/google/sparsetable>
+#include <boost/foreach.hpp>
+#include <fstream>
+#include <sstream>
+#include <map>
 
 using namespace std;
 using namespace vw;
@@ -158,3 +163,219 @@ TEST_F(IndexPageTest, Serialization) {
   EXPECT_EQ( rec[2].blob_id(),     out_rec.blob_id() );
   EXPECT_EQ( rec[2].blob_offset(), out_rec.blob_offset() );
 }
+
+TEST_F(IndexPageTest, TransactionRange) {
+  TileHeader hdr;
+  hdr.set_col(7);
+  hdr.set_row(9);
+
+  // Insert transactions 10, 20, ... 200, out of order
+  for (uint32 i = 0; i < 20; ++i) {
+    uint32 t = ((i * 7) % 20 + 1) * 10;
+    IndexRecord rec;
+    rec.set_blob_id(t);
+    rec.set_blob_offset(t * 2);
+    rec.set_filetype(t % 20 == 0 ? "png" : "jpg");
+    hdr.set_transaction_id(t);
+    page->set(hdr, rec);
+  }
+  EXPECT_EQ(1, page->sparse_size());
+
+  EXPECT_EQ(200, page->get(7, 9, -1).blob_id());
+  EXPECT_EQ(50,  page->get(7, 9, 55).blob_id());
+  EXPECT_EQ(50,  page->get(7, 9, 50, true).blob_id());
+  EXPECT_EQ(200, page->get(7, 9, 1000).blob_id());
+  EXPECT_THROW( page->get(7, 9, 55, true), TileNotFoundErr );
+  EXPECT_THROW( page->get(7, 9, 5), TileNotFoundErr );
+
+  IndexPage::multi_value_type entries = page->multi_get(7, 9, 35, 80);
+  ASSERT_EQ(5u, entries.size());
+  uint32 expected = 80;
+  BOOST_FOREACH(const IndexPage::value_type& elt, entries) {
+    EXPECT_EQ(expected, elt.first);
+    EXPECT_EQ(int32(expected), elt.second.blob_id());
+    EXPECT_EQ(expected * 2, elt.second.blob_offset());
+    EXPECT_EQ(expected % 20 == 0 ? "png" : "jpg", elt.second.filetype());
+    expected -= 10;
+  }
+  EXPECT_EQ(20u, page->multi_get(7, 9, 0, MAX_TRANSACTION).size());
+  EXPECT_EQ(1u,  page->multi_get(7, 9, -1, -1).size());
+  EXPECT_EQ(0u,  page->multi_get(7, 9, 201, 300).size());
+
+  std::list<TileHeader> headers = page->search_by_location(7, 9, 190, 200);
+  ASSERT_EQ(2u, headers.size());
+  EXPECT_EQ(200u, headers.front().transaction_id());
+  EXPECT_EQ("png", headers.front().filetype());
+  EXPECT_EQ(190u, headers.back().transaction_id());
+  EXPECT_EQ("jpg", headers.back().filetype());
+
+  EXPECT_EQ(3u, page->search_by_region(BBox2i(0, 0, 10, 10), 10, 30).size());
+  EXPECT_EQ(0u, page->search_by_region(BBox2i(0, 0, 5, 5), 10, 30).size());
+
+  // Replacing a transaction keeps one entry for it
+  IndexRecord rec;
+  rec.set_blob_id(5);
+  rec.set_blob_offset(6);
+  hdr.set_transaction_id(100);
+  page->set(hdr, rec);
+  EXPECT_EQ(20u, page->multi_get(7, 9, 0, MAX_TRANSACTION).size());
+  EXPECT_EQ(5, page->get(7, 9, 100, true).blob_id());
+  EXPECT_FALSE(page->get(7, 9, 100, true).has_filetype());
+}
+
+TEST_F(IndexPageTest, LongHistory) {
+  // A tile written every day, with one day written late
+  TileHeader hdr;
+  hdr.set_col(2);
+  hdr.set_row(3);
+  for (uint32 t = 1; t <= 1000; ++t) {
+    if (t == 500)
+      continue;
+    IndexRecord rec;
+    rec.set_blob_id(t);
+    rec.set_blob_offset(t * 10);
+    hdr.set_transaction_id(t);
+    page->set(hdr, rec);
+  }
+  IndexRecord rec;
+  rec.set_blob_id(500);
+  rec.set_blob_offset(5000);
+  hdr.set_transaction_id(500);
+  page->set(hdr, rec);
+
+  EXPECT_EQ(1000, page->get(2, 3, -1).blob_id());
+  EXPECT_EQ(1000, page->get(2, 3, 2000).blob_id());
+  EXPECT_EQ(500,  page->get(2, 3, 500, true).blob_id());
+  EXPECT_EQ(1,    page->get(2, 3, 1).blob_id());
+  EXPECT_THROW( page->get(2, 3, 0), TileNotFoundErr );
+
+  IndexPage::multi_value_type entries = page->multi_get(2, 3, 498, 502);
+  ASSERT_EQ(5u, entries.size());
+  EXPECT_EQ(502u, entries.front().first);
+  EXPECT_EQ(498u, entries.back().first);
+  EXPECT_EQ(1000u, page->multi_get(2, 3, 0, -1).size());
+  EXPECT_EQ(0u, page->multi_get(2, 3, 1001, 2000).size());
+
+  // Pages keep the most recent entry first
+  page->sync();
+  boost::shared_ptr<LocalIndexPage> page2(new LocalIndexPage(page_path,0,0,0,1024,1024));
+  std::list<TileHeader> headers = page2->search_by_location(2, 3, 0, 3000);
+  ASSERT_EQ(1000u, headers.size());
+  EXPECT_EQ(1000u, headers.front().transaction_id());
+  EXPECT_EQ(1u, headers.back().transaction_id());
+}
+
+TEST_F(IndexPageTest, FiletypeSerialization) {
+  TileHeader hdr;
+  IndexRecord rec[2];
+  hdr.set_col(1);
+  hdr.set_row(1);
+  hdr.set_transaction_id(3);
+  rec[0].set_blob_id(1);
+  rec[0].set_blob_offset(2);
+  rec[0].set_filetype("tif");
+  page->set(hdr, rec[0]);
+  hdr.set_col(2);
+  rec[1].set_blob_id(4);
+  rec[1].set_blob_offset(5);
+  page->set(hdr, rec[1]);
+  page->sync();
+
+  boost::shared_ptr<LocalIndexPage> page2(new LocalIndexPage(page_path,0,0,0,1024,1024));
+  EXPECT_EQ(2, page2->sparse_size());
+  IndexRecord out_rec = page2->get(1, 1, 3);
+  EXPECT_EQ(1, out_rec.blob_id());
+  EXPECT_EQ("tif", out_rec.filetype());
+  out_rec = page2->get(2, 1, 3);
+  EXPECT_EQ(4, out_rec.blob_id());
+  EXPECT_FALSE(out_rec.has_filetype());
+}
+
+TEST_F(IndexPageTest, LegacyFormat) {
+  // Write a page in the format that stored a serialized IndexRecord
+  // per entry, with two entries at one location.
+  page.reset();
+  {
+    std::ofstream ostr(page_path.c_str(), std::ios::binary);
+    uint32 width = 1024, height = 1024;
+    ostr.write(reinterpret_cast<char*>(&width), sizeof(width));
+    ostr.write(reinterpret_cast<char*>(&height), sizeof(height));
+    google::sparsetable<char> table(width*height);
+    table.set(5*width + 3, 'x');
+    table.write_metadata(&ostr);
+
+    uint32 count = 2;
+    ostr.write(reinterpret_cast<char*>(&count), sizeof(count));
+    for (uint32 t = 2; t > 0; --t) {
+      IndexRecord rec;
+      rec.set_blob_id(1000 + t);
+      rec.set_blob_offset(2000 + t);
+      rec.set_filetype("png");
+      std::string bytes = rec.SerializeAsString();
+      uint16 size = uint16(bytes.size());
+      ostr.write(reinterpret_cast<char*>(&t), sizeof(t));
+      ostr.write(reinterpret_cast<char*>(&size), sizeof(size));
+      ostr.write(bytes.data(), bytes.size());
+    }
+  }
+
+  page.reset(new LocalIndexPage(page_path,0,0,0,1024,1024));
+  EXPECT_EQ(1, page->sparse_size());
+  EXPECT_EQ(1002, page->get(3, 5, -1).blob_id());
+  IndexRecord out_rec = page->get(3, 5, 1);
+  EXPECT_EQ(1001, out_rec.blob_id());
+  EXPECT_EQ(2001u, out_rec.blob_offset());
+  EXPECT_EQ("png", out_rec.filetype());
+}
+
+TEST_F(IndexPageTest, Versions) {
+  // Tiles written together, one blob after another, with a few
+  // rewritten in a later transaction
+  TileHeader hdr;
+  for (uint32 i = 0; i < 2000; ++i) {
+    IndexRecord rec;
+    rec.set_blob_id(i / 500);
+    rec.set_blob_offset((uint64(1) << 33) + (i % 500) * 4150);
+    if (i % 3)
+      rec.set_filetype(i % 3 == 1 ? "png" : "jpg");
+    hdr.set_col(i % 1024);
+    hdr.set_row(i / 1024);
+    hdr.set_transaction_id(i % 7 ? 2 : 5);
+    page->set(hdr, rec);
+  }
+
+  IndexPage& p = *page;
+  std::map<uint32, size_t> sizes;
+  for (uint32 version = 2; version <= IndexPage::newest_version(); ++version) {
+    std::ostringstream ostr(std::ios::binary);
+    p.serialize(ostr, version);
+    sizes[version] = ostr.str().size();
+
+    boost::shared_ptr<IndexPage> page2(new LocalIndexPage(UnlinkName("IndexPage2"),0,0,0,1024,1024));
+    std::istringstream istr(ostr.str(), std::ios::binary);
+    page2->deserialize(istr);
+    ASSERT_EQ(p.sparse_size(), page2->sparse_size());
+    for (uint32 i = 0; i < 2000; ++i) {
+      IndexPage::multi_value_type a = p.multi_get(i % 1024, i / 1024, 0, MAX_TRANSACTION),
+                                  b = page2->multi_get(i % 1024, i / 1024, 0, MAX_TRANSACTION);
+      ASSERT_EQ(a.size(), b.size());
+      for (IndexPage::multi_value_type::const_iterator x = a.begin(), y = b.begin(); x != a.end(); ++x, ++y) {
+        EXPECT_EQ(x->first, y->first);
+        EXPECT_EQ(x->second.SerializeAsString(), y->second.SerializeAsString());
+      }
+    }
+  }
+
+  // The compact format is a fraction of the fixed width one
+  EXPECT_LT(sizes[3] * 3, sizes[2]);
+  if (IndexPage::newest_version() >= 4)
+    EXPECT_LT(sizes[4], sizes[3]);
+
+  // Asking for a newer format than there is gets the newest
+  std::ostringstream ostr(std::ios::binary);
+  p.serialize(ostr, 100);
+  EXPECT_EQ(sizes[IndexPage::newest_version()], ostr.str().size());
+
+  // Nothing writes the format before version 2
+  EXPECT_THROW( p.serialize(ostr, 1), ArgumentErr );
+}
@@ -137,6 +137,165 @@ TEST(LocalIndex, BasicAccess) {
   }
 }
 
+namespace {
+  // Reads every tile of a 16x16 level, several times over.
+  struct ReadLevel {
+    boost::shared_ptr<IndexLevel> level;
+    bool ok;
+    ReadLevel(boost::shared_ptr<IndexLevel> level) : level(level), ok(true) {}
+    void operator()() {
+      for (int pass = 0; pass < 5; ++pass)
+        for (int32 row = 0; row < 16; row += 3)
+          for (int32 col = 0; col < 16; col += 3)
+            if (level->get(col, row, -1).blob_id() != row*16 + col)
+              ok = false;
+    }
+  };
+}
+
+TEST(LocalIndex, PageEviction) {
+  UnlinkName file("index_eviction");
+  boost::shared_ptr<LocalPageGeneratorFactory> page_gen_factory( new LocalPageGeneratorFactory(file) );
+
+  // Sixteen 4x4 pages, at most two of them resident at once
+  boost::shared_ptr<IndexLevel> level( new IndexLevel(page_gen_factory, 4, 4, 4, 2) );
+  TileHeader hdr;
+  hdr.set_level(4);
+  hdr.set_transaction_id(1);
+  for (int32 row = 0; row < 16; row += 3)
+    for (int32 col = 0; col < 16; col += 3) {
+      IndexRecord rec;
+      rec.set_blob_id(row*16 + col);
+      rec.set_blob_offset(0);
+      hdr.set_col(col);
+      hdr.set_row(row);
+      level->set(hdr, rec);
+    }
+
+  // Evicted pages were saved, and are loaded again when needed
+  std::vector<boost::shared_ptr<ReadLevel> > readers;
+  std::vector<boost::shared_ptr<Thread> > threads;
+  for (int i = 0; i < 4; ++i) {
+    readers.push_back( boost::shared_ptr<ReadLevel>( new ReadLevel(level) ) );
+    threads.push_back( boost::shared_ptr<Thread>( new Thread(readers.back()) ) );
+  }
+  for (int i = 0; i < 4; ++i) {
+    threads[i]->join();
+    EXPECT_TRUE( readers[i]->ok );
+  }
+  EXPECT_THROW( level->get(1, 1, -1), TileNotFoundErr );
+}
+
+namespace {
+  // Counts the batches that pages are generated in, and the pages
+  // generated one at a time.
+  class CountingPageGeneratorFactory : public LocalPageGeneratorFactory {
+  public:
+    std::vector<size_t> batches;
+    size_t singles;
+    CountingPageGeneratorFactory(std::string plate_filename) : LocalPageGeneratorFactory(plate_filename), singles(0) {}
+    virtual boost::shared_ptr<PageGeneratorBase> create(uint32 level, uint32 base_col, uint32 base_row,
+                                                        uint32 page_width, uint32 page_height) {
+      ++singles;
+      return LocalPageGeneratorFactory::create(level, base_col, base_row, page_width, page_height);
+    }
+    virtual std::vector<boost::shared_ptr<IndexPage> >
+    generate_pages(uint32 level, std::vector<Vector2i> const& bases, uint32 page_width, uint32 page_height) {
+      batches.push_back(bases.size());
+      return LocalPageGeneratorFactory::generate_pages(level, bases, page_width, page_height);
+    }
+  };
+}
+
+TEST(LocalIndex, BatchedRegionSearch) {
+  UnlinkName file("index_batched");
+  boost::shared_ptr<CountingPageGeneratorFactory> page_gen_factory( new CountingPageGeneratorFactory(file) );
+  {
+    // One tile in each of sixteen 4x4 pages
+    IndexLevel level(page_gen_factory, 4, 4, 4, 100);
+    TileHeader hdr;
+    hdr.set_level(4);
+    hdr.set_transaction_id(1);
+    for (int32 row = 1; row < 16; row += 4)
+      for (int32 col = 1; col < 16; col += 4) {
+        IndexRecord rec;
+        rec.set_blob_id(row*16 + col);
+        rec.set_blob_offset(0);
+        hdr.set_col(col);
+        hdr.set_row(row);
+        level.set(hdr, rec);
+      }
+  }
+  page_gen_factory->batches.clear();
+
+  // The pages a search covers are loaded together, as many at a time
+  // as the cache holds.
+  IndexLevel level(page_gen_factory, 4, 4, 4, 6);
+  std::list<TileHeader> hdrs = level.search_by_region(BBox2i(0, 0, 12, 16), 0, 1);
+  EXPECT_EQ(12u, hdrs.size());
+  ASSERT_EQ(2u, page_gen_factory->batches.size());
+  EXPECT_EQ(6u, page_gen_factory->batches[0]);
+  EXPECT_EQ(6u, page_gen_factory->batches[1]);
+
+  // Resident pages are not loaded again
+  page_gen_factory->batches.clear();
+  EXPECT_EQ(6u, level.search_by_region(BBox2i(0, 8, 12, 8), 0, 1).size());
+  EXPECT_EQ(0u, page_gen_factory->batches.size());
+}
+
+TEST(LocalIndex, PrefetchRegion) {
+  UnlinkName file("index_prefetch");
+  boost::shared_ptr<CountingPageGeneratorFactory> page_gen_factory( new CountingPageGeneratorFactory(file) );
+  IndexLevel level(page_gen_factory, 4, 4, 4, 6);
+
+  // The region is clipped to the level, and no more pages than the cache
+  // holds are loaded
+  level.prefetch_region(BBox2i(-4, -4, 100, 12), *page_gen_factory);
+  ASSERT_EQ(1u, page_gen_factory->batches.size());
+  EXPECT_EQ(6u, page_gen_factory->batches[0]);
+
+  page_gen_factory->batches.clear();
+  level.search_by_region(BBox2i(0, 0, 16, 4), 0, 1);
+  level.search_by_region(BBox2i(0, 4, 8, 4), 0, 1);
+  EXPECT_EQ(0u, page_gen_factory->batches.size());
+
+  level.prefetch_region(BBox2i(20, 20, 4, 4), *page_gen_factory);
+  EXPECT_EQ(0u, page_gen_factory->batches.size());
+}
+
+TEST(LocalIndex, WriteUpdatesByPage) {
+  UnlinkName file("index_updates");
+  boost::shared_ptr<CountingPageGeneratorFactory> page_gen_factory( new CountingPageGeneratorFactory(file) );
+  IndexLevel level(page_gen_factory, 4, 4, 4, 2);
+
+  // Back and forth across four pages, more than the cache holds, and
+  // the first tile twice
+  std::vector<Index::WriteUpdate> updates;
+  TileHeader hdr;
+  hdr.set_level(4);
+  hdr.set_transaction_id(1);
+  IndexRecord rec;
+  rec.set_blob_offset(0);
+  for (int32 i = 0; i < 16; ++i) {
+    int32 page = i % 4;
+    hdr.set_col((page % 2) * 8 + i / 4);
+    hdr.set_row((page / 2) * 8);
+    rec.set_blob_id(i);
+    updates.push_back(std::make_pair(hdr, rec));
+  }
+  hdr.set_col(0);
+  hdr.set_row(0);
+  rec.set_blob_id(100);
+  updates.push_back(std::make_pair(hdr, rec));
+
+  // Each page is loaded once, and the last update to a tile wins
+  level.set(updates);
+  EXPECT_EQ(4u, page_gen_factory->singles);
+  EXPECT_EQ(100, level.get(0, 0, -1).blob_id());
+  EXPECT_EQ(7,   level.get(9, 8, -1).blob_id());
+  EXPECT_EQ(14,  level.get(3, 8, -1).blob_id());
+}
+
 TEST(LocalIndex, IndexRecord) {
 
   UnlinkName name("foo.bar");
@@ -360,3 +519,16 @@ TEST_F(LocalIndexTiles, ValidTiles) {
   tiles = index->search_by_region(1, BBox2i(0,0,2,2), tid.minimum(), tid.maximum());
   EXPECT_EQ(4, tiles.size());
 }
+
+TEST_F(LocalIndexTiles, Prefetch) {
+  IndexRecord rec;
+  for (int i = 0; i < 5; ++i)
+    index_write(hdrs[i], rec);
+
+  index->prefetch(1, BBox2i(0,0,2,2));
+  index->prefetch(1, BBox2i(-5,-5,100,100));
+  index->prefetch(40, BBox2i(0,0,2,2));
+  index->prefetch_join();
+
+  EXPECT_EQ(4, index->search_by_region(1, BBox2i(0,0,2,2), 0, -1).size());
+}
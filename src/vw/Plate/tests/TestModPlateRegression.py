@@ -124,6 +124,27 @@ class TestPlate(unittest.TestCase):
         r = tile_get(self.Url, level=0, col=0, row=0)
         self.good_request(r)
         self.content_type(r, self.Url)
+    def test_revalidate(self):
+        url = self.Url.replace('{1}', '0').replace('{2}', '0').replace('{3}', '0')
+        r = timed_get(url)
+        self.good_request(r)
+        etag = r.headers['ETag']
+        self.assertTrue(etag)
+        self.assertTrue(r.headers['Last-Modified'])
+        try:
+            urllib2.urlopen(urllib2.Request(url, headers={'If-None-Match': etag}))
+            self.fail('expected 304 for an unchanged tile')
+        except urllib2.HTTPError, e:
+            self.assertEqual(304, e.code)
+    def test_batch(self):
+        url = self.Url.replace('{1}', '1').replace('{2}/{3}', '0/0/2x2')
+        url = url[:url.rfind('.')] + '.tiles'
+        r = timed_get(url)
+        self.good_request(r)
+        self.assertTrue(r.headers['Content-Type'].startswith('multipart/mixed'))
+        self.assertTrue(0 < r.data.count('Content-Location:') <= 4)
+        r = timed_get(url.replace('2x2', '17x17'))
+        self.assertEqual(400, r.code)
     def test_out_of_range(self):
         r = tile_get(self.Url, level=self.NumLevels, col=0, row=0)
         self.assertEqual(404, r.code)
@@ -114,6 +114,27 @@ TEST_P(RpcTest, Basic) {
   EXPECT_EQ(0, server->stats().get("client_error"));
 }
 
+TEST_P(RpcTest, Latency) {
+  ASSERT_NO_FATAL_FAILURE(make_things(1));
+
+  DoubleMessage q, a;
+  for (uint32 i = 0; i < 100; ++i) {
+    q.set_num(i);
+    ASSERT_NO_THROW(clients[0]->DoubleRequest(clients[0].get(), &q, &a, null_callback()));
+  }
+
+  // Every call lands in exactly one bucket
+  int64 count = 0;
+  {
+    ThreadMap::Locked stats = server->stats();
+    BOOST_FOREACH(const ThreadMap::map_t::value_type& v, stats.data()) {
+      if (v.first.compare(0, 22, "latency.DoubleRequest.") == 0)
+        count += v.second;
+    }
+  }
+  EXPECT_EQ(100, count);
+}
+
 TEST_P(RpcTest, Err) {
   ASSERT_NO_FATAL_FAILURE(make_things(1));
 
@@ -218,6 +239,37 @@ TEST_P(RpcTest, MultiThreadTorture) {
   EXPECT_EQ(0, server->stats().get("server_error"));
 }
 
+TEST(TestRpc, HAS_ZEROMQ(ThreadedServer)) {
+  static const uint64 THREAD_COUNT = 8;
+  typedef boost::shared_ptr<ClientTask> task_t;
+  typedef boost::shared_ptr<Thread> thread_t;
+
+  Url u("zmq+ipc://" TEST_OBJDIR "/unittest3?threads=4");
+  Server server;
+  ASSERT_NO_THROW(server.reset(new RpcServer<TestService>(u, new TestServiceImpl())));
+  ASSERT_FALSE(server->error());
+
+  TestClient::Factory f = TestClient::make_factory(u, TIMEOUT, 0);
+  Mutex m;
+  Condition c;
+  vector<task_t>   tasks(THREAD_COUNT);
+  vector<thread_t> threads(THREAD_COUNT);
+  for (uint64 i = 0; i < THREAD_COUNT; ++i) {
+    tasks[i]   = task_t(new ClientTask(f, m, c));
+    threads[i] = thread_t(new Thread(tasks[i]));
+  }
+
+  Thread::sleep_ms(100);
+  c.notify_all();
+
+  BOOST_FOREACH(thread_t& t, threads)
+    t->join();
+
+  EXPECT_EQ(THREAD_COUNT * ClientTask::MSG_COUNT, server->stats().get("msgs"));
+  EXPECT_EQ(0, server->stats().get("client_error"));
+  EXPECT_EQ(0, server->stats().get("server_error"));
+}
+
 Url amqp_url(string hostname = "", short port = -1) {
   if (hostname.empty())
     hostname = getenv2("AMQP_TEST_HOSTNAME", "localhost");
@@ -19,6 +19,12 @@ using namespace vw;
 using namespace vw::platefile;
 using namespace vw::test;
 
+#if defined(VW_HAVE_PKG_ZEROMQ) && (VW_HAVE_PKG_ZEROMQ==1)
+#define HAS_ZEROMQ(x) x
+#else
+#define HAS_ZEROMQ(x) DISABLED_ ## x
+#endif
+
 TEST(TestRpcChannel, Checksum) {
   RpcWrapper msg;
   msg.set_method("ab");
@@ -254,3 +260,58 @@ TEST_F(TestUrls, Illegal) {
   EXPECT_THROW(client("zmq+ipc:///"), ArgumentErr);
 #endif
 }
+
+TEST(ChannelPool, HAS_ZEROMQ(Reuse)) {
+  ChannelPool pool;
+  const Url u("zmq+ipc://" TEST_OBJDIR "/unittest_pool");
+
+  IChannel* first;
+  {
+    Chan c = pool.lease(u, "unittest_client");
+    first = c.get();
+    c->set_timeout(5);
+  }
+  EXPECT_EQ(1u, pool.idle());
+
+  // The same channel comes back, as it was when it was connected
+  Chan c = pool.lease(u, "unittest_client");
+  EXPECT_EQ(first, c.get());
+  EXPECT_EQ(int32(IChannel::DEFAULT_TIMEOUT), c->timeout());
+  EXPECT_EQ(0u, pool.idle());
+
+  // A lease is exclusive
+  Chan d = pool.lease(u, "unittest_client");
+  EXPECT_NE(c.get(), d.get());
+
+  c.reset();
+  d.reset();
+  EXPECT_EQ(2u, pool.idle());
+  pool.clear();
+  EXPECT_EQ(0u, pool.idle());
+}
+
+TEST(ChannelPool, HAS_ZEROMQ(Unhealthy)) {
+  ChannelPool pool;
+  const Url u("zmq+ipc://" TEST_OBJDIR "/unittest_pool");
+
+  // Still waiting for a reply: out of step with the server
+  {
+    static const uint8 msg[] = "13";
+    Chan c = pool.lease(u, "unittest_client");
+    c->send_bytes(msg, sizeof(msg));
+  }
+  EXPECT_EQ(0u, pool.idle());
+
+  // Idle for too long
+  pool.lease(u, "unittest_client");
+  EXPECT_EQ(1u, pool.idle());
+  Thread::sleep_ms(5);
+  pool.set_max_idle(1);
+  EXPECT_EQ(0u, pool.idle());
+}
+
+TEST(ChannelPool, HAS_ZEROMQ(Private)) {
+  ChannelPool pool;
+  pool.lease(Url("zmq+ipc://" TEST_OBJDIR "/unittest_pool?pool=0"), "unittest_client");
+  EXPECT_EQ(0u, pool.idle());
+}
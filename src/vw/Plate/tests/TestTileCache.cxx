@@ -0,0 +1,111 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Plate/PlateFile.h>
+#include <vw/Plate/TileCache.h>
+
+using namespace vw;
+using namespace vw::platefile;
+using namespace vw::test;
+
+class TileCacheTest : public ::testing::Test {
+protected:
+  typedef PixelGray<uint8> PixelT;
+
+  virtual void SetUp() {
+    platename = UnlinkName("tilecache.plate");
+    platefile.reset( new PlateFile( Url(platename), "equi", "", 16, "png",
+                                    VW_PIXEL_GRAY, VW_CHANNEL_UINT8) );
+    platefile->set_tile_cache(&cache);
+    tid = platefile->transaction_begin("tile cache", -1);
+    platefile->write_request();
+    write(0, 0, 7);
+    write(1, 0, 8);
+    platefile->write_complete();
+    platefile->transaction_end(true);
+    platefile->sync();
+  }
+
+  virtual void TearDown() {
+    platefile.reset();
+  }
+
+  void write(int32 col, int32 row, uint8 value) {
+    ImageView<PixelT> tile(16, 16);
+    fill(tile, PixelT(value));
+    platefile->write_update(tile, col, row, 1);
+  }
+
+  TileCache cache;
+  UnlinkName platename;
+  boost::shared_ptr<PlateFile> platefile;
+  uint32 tid;
+};
+
+TEST_F( TileCacheTest, SharedAcrossReaders ) {
+  ReadOnlyPlateFile reader1( (Url(platename)) ), reader2( (Url(platename)) );
+  reader1.set_tile_cache(&cache);
+  reader2.set_tile_cache(&cache);
+
+  ImageView<PixelT> tile;
+  reader1.read(tile, 0, 0, 1, -1);
+  EXPECT_EQ( 7, tile(3,3).v() );
+  EXPECT_EQ( 1u, cache.size() );
+
+  // The other reader finds the same tile, and each gets its own copy
+  fill(tile, PixelT(0));
+  reader2.read(tile, 0, 0, 1, -1);
+  EXPECT_EQ( 7, tile(3,3).v() );
+  EXPECT_EQ( 1u, cache.size() );
+
+  reader2.read(tile, 1, 0, 1, -1);
+  EXPECT_EQ( 8, tile(3,3).v() );
+  EXPECT_EQ( 2u, cache.size() );
+
+  // Another pixel type is another tile
+  ImageView<PixelGray<float> > float_tile;
+  reader1.read(float_tile, 0, 0, 1, -1);
+  EXPECT_EQ( 3u, cache.size() );
+
+  EXPECT_THROW( reader1.read(tile, 0, 1, 1, -1), TileNotFoundErr );
+}
+
+TEST_F( TileCacheTest, Rewrite ) {
+  ImageView<PixelT> tile;
+  platefile->read(tile, 0, 0, 1, -1);
+  EXPECT_EQ( 7, tile(0,0).v() );
+  EXPECT_EQ( 1u, cache.size() );
+
+  // Writing the tile again drops it
+  platefile->transaction_resume(tid);
+  platefile->write_request();
+  write(0, 0, 9);
+  EXPECT_EQ( 0u, cache.size() );
+  platefile->write_complete();
+  platefile->read(tile, 0, 0, 1, -1);
+  EXPECT_EQ( 9, tile(0,0).v() );
+}
+
+TEST_F( TileCacheTest, ClosedReader ) {
+  ImageView<PixelT> tile;
+  {
+    ReadOnlyPlateFile reader( (Url(platename)) );
+    reader.set_tile_cache(&cache);
+    reader.read(tile, 1, 0, 1, -1);
+  }
+  EXPECT_EQ( 1u, cache.size() );
+
+  // A tile read by a reader that has gone is read again
+  ReadOnlyPlateFile reader( (Url(platename)) );
+  reader.set_tile_cache(&cache);
+  fill(tile, PixelT(0));
+  reader.read(tile, 1, 0, 1, -1);
+  EXPECT_EQ( 8, tile(0,0).v() );
+  EXPECT_EQ( 1u, cache.size() );
+}
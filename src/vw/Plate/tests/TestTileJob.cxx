@@ -0,0 +1,155 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+#include <vw/Plate/TileJob.h>
+#include <vw/Plate/Exception.h>
+#include <vw/Image/UtilityViews.h>
+#include <vw/FileIO/DiskImageResource.h>
+#include <vw/FileIO/DiskImageView.h>
+#include <boost/filesystem/operations.hpp>
+
+using namespace vw;
+using namespace vw::platefile;
+using namespace vw::test;
+
+#if defined(VW_HAVE_PKG_ZEROMQ) && (VW_HAVE_PKG_ZEROMQ==1)
+#define HAS_ZEROMQ(x) x
+#else
+#define HAS_ZEROMQ(x) DISABLED_ ## x
+#endif
+
+namespace {
+  TileJobRequest request_for( ImageFormat const& format ) {
+    TileJobRequest request;
+    request.set_worker( "test" );
+    request.set_cols( format.cols );
+    request.set_rows( format.rows );
+    request.set_planes( format.planes );
+    request.set_pixel_format( format.pixel_format );
+    request.set_channel_type( format.channel_type );
+    return request;
+  }
+
+  TileJobReply request_job( TileJobServiceImpl& service, TileJobRequest const& request ) {
+    TileJobReply job;
+    service.JobRequest( 0, &request, &job, null_callback() );
+    return job;
+  }
+
+  void complete_job( TileJobServiceImpl& service, TileJobReply const& job ) {
+    TileJobComplete request;
+    RpcNullMsg response;
+    request.set_worker( "test" );
+    request.set_job_id( job.job_id() );
+    request.set_filename( job.filename() );
+    service.JobComplete( 0, &request, &response, null_callback() );
+  }
+
+  void fail_job( TileJobServiceImpl& service, TileJobReply const& job ) {
+    TileJobFailed request;
+    RpcNullMsg response;
+    request.set_worker( "test" );
+    request.set_job_id( job.job_id() );
+    request.set_message( "expected failure" );
+    service.JobFailed( 0, &request, &response, null_callback() );
+  }
+}
+
+TEST(TileJob, HandsOutTiles) {
+  ImageFormat format = ImageView<float>(50,30).format();
+  TileJobServiceImpl service( format, Vector2i(32,16), "tiles" );
+  ASSERT_EQ( 4u, service.num_jobs() );
+  EXPECT_EQ( BBox2i(32,0,18,16), service.job_bbox(1) );
+  EXPECT_EQ( BBox2i(0,16,32,14), service.job_bbox(2) );
+
+  // The jobs come in order, then there are none free for a while.
+  TileJobRequest request = request_for( format );
+  std::vector<TileJobReply> jobs;
+  for( int32 i = 0; i < 4; ++i ) {
+    jobs.push_back( request_job( service, request ) );
+    ASSERT_EQ( i, jobs.back().job_id() );
+    EXPECT_FALSE( jobs.back().finished() );
+  }
+  EXPECT_EQ( 18, jobs[1].cols() );
+  EXPECT_EQ( 16, jobs[1].rows() );
+  EXPECT_EQ( 32, jobs[1].x() );
+  EXPECT_EQ( "tiles/tile_1_1.vwt", jobs[1].filename() );
+  TileJobReply none = request_job( service, request );
+  EXPECT_EQ( -1, none.job_id() );
+  EXPECT_FALSE( none.finished() );
+
+  // Once every job is done, the workers are sent home.
+  for( int32 i = 0; i < 4; ++i ) {
+    EXPECT_FALSE( service.wait( 0 ) );
+    complete_job( service, jobs[i] );
+  }
+  EXPECT_TRUE( service.wait( 0 ) );
+  EXPECT_EQ( 4u, service.num_done() );
+  EXPECT_EQ( "tiles/tile_3_1.vwt", service.job_filename(3) );
+  EXPECT_TRUE( request_job( service, request ).finished() );
+}
+
+TEST(TileJob, WrongImage) {
+  ImageFormat format = ImageView<float>(50,30).format();
+  TileJobServiceImpl service( format, Vector2i(32,16), "tiles" );
+  EXPECT_THROW( request_job( service, request_for( ImageView<float>(50,31).format() ) ), PlatefileErr );
+  EXPECT_THROW( request_job( service, request_for( ImageView<uint8>(50,30).format() ) ), PlatefileErr );
+}
+
+TEST(TileJob, Retries) {
+  ImageFormat format = ImageView<float>(16,16).format();
+  TileJobServiceImpl service( format, Vector2i(16,16), "tiles", 0.05f, 2 );
+  TileJobRequest request = request_for( format );
+
+  // A job that is out too long is handed out again, under a new name.
+  TileJobReply first = request_job( service, request );
+  ASSERT_EQ( 0, first.job_id() );
+  EXPECT_EQ( -1, request_job( service, request ).job_id() );
+  Thread::sleep_ms( 100 );
+  TileJobReply second = request_job( service, request );
+  ASSERT_EQ( 0, second.job_id() );
+  EXPECT_NE( first.filename(), second.filename() );
+
+  // The first worker to finish wins.
+  complete_job( service, first );
+  complete_job( service, second );
+  EXPECT_TRUE( service.wait( 0 ) );
+  EXPECT_EQ( first.filename(), service.job_filename(0) );
+
+  // A job that keeps failing fails the image.
+  TileJobServiceImpl failing( format, Vector2i(16,16), "tiles", 600, 2 );
+  fail_job( failing, request_job( failing, request ) );
+  EXPECT_FALSE( failing.wait( 0 ) );
+  fail_job( failing, request_job( failing, request ) );
+  EXPECT_THROW( failing.wait( 0 ), IOErr );
+  EXPECT_TRUE( request_job( failing, request ).finished() );
+}
+
+TEST(TileJob, HAS_ZEROMQ(Distributed)) {
+  UnlinkName fn("tilejob.vwt");
+  ImageView<float> image(70,45);
+  for( int32 j=0; j<image.rows(); ++j )
+    for( int32 i=0; i<image.cols(); ++i )
+      image(i,j) = float( i + 100*j );
+
+  Url url("zmq+ipc://" TEST_OBJDIR "/tilejob");
+  TileJobCoordinator coordinator( url, fn, image.format(), Vector2i(32,32) );
+  EXPECT_EQ( 6u, coordinator.service().num_jobs() );
+
+  // Two workers, as there would be on two machines.
+  boost::shared_ptr<Thread> other( new Thread( boost::bind( &tile_job_worker<ImageView<float> >,
+                                                            url, boost::cref(image), "other" ) ) );
+  tile_job_worker( url, image, "self" );
+  coordinator.run();
+  other->join();
+
+  DiskImageView<float> result( fn );
+  EXPECT_VW_EQ( image, result );
+  EXPECT_FALSE( boost::filesystem::exists( fn + ".tiles" ) );
+}
@@ -65,3 +65,117 @@ TEST_F(BlobManagerTest, Tiles) {
 TEST_F(BlobManagerTest, Weird) {
   bbox_does_tile_area(BBox2i(7,17,31,13), 7, 5, 15);
 }
+
+TEST(TileManipulation, AlignedTiles) {
+  const BBox2i region(7,17,31,13);
+  list<BBox2i> tiles = aligned_bbox_tiles(region, 8, 8);
+  EXPECT_EQ(10u, tiles.size());
+
+  BBox2i total_bbox;
+  BOOST_FOREACH( const BBox2i& bbox, tiles ) {
+    SCOPED_TRACE(Message() << "Box[" << bbox << "]");
+    // Each lies within one cell of the grid
+    EXPECT_EQ(bbox.min().x() / 8, (bbox.max().x() - 1) / 8);
+    EXPECT_EQ(bbox.min().y() / 8, (bbox.max().y() - 1) / 8);
+    total_bbox.grow(bbox);
+  }
+  EXPECT_EQ(region, total_bbox);
+}
+
+TEST(TileManipulation, ShardRegion) {
+  // Big regions are split on the pages
+  list<BBox2i> shards = shard_region(BBox2i(0,0,1024,512), 256, 1);
+  EXPECT_EQ(8u, shards.size());
+  EXPECT_EQ(BBox2i(0,0,256,256), shards.front());
+
+  // Small ones are split further to make enough shards
+  shards = shard_region(BBox2i(0,0,16,16), 256, 4);
+  EXPECT_EQ(4u, shards.size());
+  EXPECT_EQ(BBox2i(8,8,8,8), shards.back());
+
+  // But not below the smallest size
+  shards = shard_region(BBox2i(0,0,4,4), 256, 8);
+  EXPECT_EQ(1u, shards.size());
+}
+
+namespace {
+  template <class PixelT>
+  ImageView<PixelT> random_tile(int32 size, uint32 seed) {
+    typedef typename PixelChannelType<PixelT>::type channel_t;
+    ImageView<PixelT> tile(size, size);
+    channel_t* p = reinterpret_cast<channel_t*>(tile.data());
+    for (int32 i = 0; i < size * size * int32(PixelNumChannels<PixelT>::value); ++i) {
+      seed = seed * 1103515245 + 12345;
+      p[i] = channel_t((seed >> 16) % 251);
+    }
+    return tile;
+  }
+
+  template <class PixelT>
+  ImageView<PixelT> compose(int32 size, const ImageView<PixelT>* tiles) {
+    ImageView<PixelT> super(2*size, 2*size);
+    for (int32 i = 0; i < 4; ++i)
+      if (tiles[i])
+        crop(super, (i % 2) * size, (i / 2) * size, size, size) = tiles[i];
+    return super;
+  }
+}
+
+TEST(TileManipulation, MipmapBox) {
+  typedef PixelRGBA<uint8> PixelT;
+  ImageView<PixelT> tiles[4];
+  for (uint32 i = 0; i < 4; ++i)
+    tiles[i] = random_tile<PixelT>(16, i + 1);
+  ImageView<PixelT> super = compose(16, tiles);
+
+  // The same as the 2x2 box filter from the generic views, but for rounding
+  std::vector<float> kernel(2, 0.5);
+  ImageView<PixelRGBA<float> > expected =
+    subsample(separable_convolution_filter(channel_cast<float>(super), kernel, kernel, 1, 1, ConstantEdgeExtension()), 2);
+  ImageView<PixelT> parent;
+  mipmap_one_tile(parent, 16, tiles[0], tiles[1], tiles[2], tiles[3]);
+  ASSERT_EQ(16, parent.cols());
+  ASSERT_EQ(16, parent.rows());
+  for (int32 y = 0; y < 16; ++y)
+    for (int32 x = 0; x < 16; ++x)
+      for (int32 c = 0; c < 4; ++c)
+        EXPECT_NEAR(expected(x, y)[c], parent(x, y)[c], 0.5);
+
+  // Without blur, every other pixel
+  mipmap_one_tile(parent, 16, tiles[0], tiles[1], tiles[2], tiles[3], false);
+  EXPECT_PIXEL_EQ(super(6, 30), parent(3, 15));
+  EXPECT_PIXEL_EQ(super(30, 0), parent(15, 0));
+
+  // A missing tile is transparent
+  mipmap_one_tile(parent, 16, tiles[0], ImageView<PixelT>(), tiles[2], tiles[3]);
+  EXPECT_PIXEL_EQ(PixelT(), parent(12, 3));
+  EXPECT_PIXEL_EQ(downsample_tile(tiles[0])(3, 3), parent(3, 3));
+}
+
+TEST(TileManipulation, MipmapTent) {
+  typedef PixelGrayA<uint16> PixelT;
+  ImageView<PixelT> tiles[4];
+  tiles[0] = random_tile<PixelT>(8, 3);
+  tiles[3] = random_tile<PixelT>(8, 4);
+
+  // The one-shot kernel filters across the seams as if composed first
+  ImageView<PixelT> parent, expected = downsample_tile(compose(8, tiles), TENT_DOWNSAMPLE);
+  mipmap_one_tile(parent, 8, tiles[0], tiles[1], tiles[2], tiles[3], TENT_DOWNSAMPLE);
+  for (int32 y = 0; y < 8; ++y)
+    for (int32 x = 0; x < 8; ++x)
+      EXPECT_PIXEL_EQ(expected(x, y), parent(x, y));
+
+  // 1-3-3-1 on each axis, clamped at the edges
+  ImageView<PixelGray<float> > ramp(8, 4);
+  for (int32 y = 0; y < 4; ++y)
+    for (int32 x = 0; x < 8; ++x)
+      ramp(x, y) = PixelGray<float>(float(x));
+  ImageView<PixelGray<float> > half = downsample_tile(ramp, TENT_DOWNSAMPLE);
+  ASSERT_EQ(4, half.cols());
+  ASSERT_EQ(2, half.rows());
+  EXPECT_FLOAT_EQ(0.625, half(0, 1).v());
+  EXPECT_FLOAT_EQ(2.5,   half(1, 0).v());
+  EXPECT_FLOAT_EQ(6.375, half(3, 1).v());
+
+  EXPECT_THROW( downsample_tile(ImageView<PixelT>(3, 4)), ArgumentErr );
+}
@@ -9,6 +9,8 @@
 import core
 from core import ErrorMessage, WarningMessage, InfoMessage, DebugMessage, VerboseDebugMessage
 from core import set_debug_level
+from core import default_num_threads, set_default_num_threads, default_tile_size, set_default_tile_size
+from core import system_cache_size, set_system_cache_size
 from core import PythonProgressCallback as ProgressCallback, TerminalProgressCallback
 
 # Math
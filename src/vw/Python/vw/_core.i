@@ -13,6 +13,7 @@
 #include <vw/Core/Log.h>
 #include <vw/Core/Debugging.h>
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Settings.h>
 %}
 
 namespace vw {
@@ -27,6 +28,23 @@ namespace vw {
 
   void set_debug_level( int level );
 
+} // namespace vw
+
+// The settings that govern how Vision Workbench rasterizes, which
+// otherwise come from ~/.vwrc.
+%inline %{
+namespace vw {
+  int default_num_threads() { return vw_settings().default_num_threads(); }
+  void set_default_num_threads( int num ) { vw_settings().set_default_num_threads( num ); }
+  int default_tile_size() { return vw_settings().default_tile_size(); }
+  void set_default_tile_size( int size ) { vw_settings().set_default_tile_size( size ); }
+  size_t system_cache_size() { return vw_settings().system_cache_size(); }
+  void set_system_cache_size( size_t size ) { vw_settings().set_system_cache_size( size ); }
+} // namespace vw
+%}
+
+namespace vw {
+
   /// The base class for progress monitoring.
   class ProgressCallback {
   public:
@@ -91,6 +109,7 @@ namespace vw {
       if( progress == m_last_reported ) return;
       m_last_reported = progress;
       if( ! m_progress_func ) return;
+      ScopedGIL gil;
       PyEval_CallFunction( m_progress_func.get(), "(d)", progress );
       if( PyErr_Occurred() ) vw_throw( vw::Exception() );
     }
@@ -116,12 +135,14 @@ namespace vw {
     void report_finished() const {
       ProgressCallback::report_finished();
       if( ! m_finished_func ) return;
+      ScopedGIL gil;
       PyEval_CallFunction( m_finished_func.get(), "()" );
       if( PyErr_Occurred() ) vw_throw( vw::Exception() );
     }
     void report_aborted(std::string why="") const {
       ProgressCallback::report_aborted(why);
       if( ! m_aborted_func ) return;
+      ScopedGIL gil;
       PyEval_CallFunction( m_aborted_func.get(), "(s)", why.c_str() );
       if( PyErr_Occurred() ) vw_throw( vw::Exception() );
     }
@@ -7,6 +7,7 @@
 
 %module fileio
 %include "std_string.i"
+%include "vwutil.i"
 %import "_image.i"
 
 %{
@@ -61,12 +62,17 @@ namespace vw {
   };
 }
 
+HANDLE_VW_EXCEPTIONS_NOGIL(_read_image)
+HANDLE_VW_EXCEPTIONS_NOGIL(_write_image)
+
 %inline %{
   template <class PixelT> void _read_image( vw::ImageView<PixelT>& image, vw::DiskImageResource& resource ) {
     vw::read_image( image, resource );
   }
+  // The image is rasterized in blocks, on several threads, as it is written.
   template <class PixelT> void _write_image( std::string const& filename, vw::ImageViewRef<PixelT> const& image ) {
-    vw::write_image( filename, image );
+    vw::int32 tile_size = vw::vw_settings().default_tile_size();
+    vw::write_image( filename, vw::block_rasterize( image, vw::Vector2i(tile_size,tile_size) ) );
   }
 %}
 
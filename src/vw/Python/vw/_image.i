@@ -11,12 +11,22 @@
 %import "_pixel.i"
 
 %{
+#define SWIG_FILE_WITH_INIT
 #include <vw/Image.h>
 %}
 
+%include "numpy.i"
+%include "vwutil.i"
+
+%init %{
+  import_array();
+%}
+
 %template(vector_float32) std::vector<vw::float32>;
 
 %pythoncode {
+  import numpy
+
   def isimage(im):
     try:
       im.pixel_type
@@ -63,8 +73,67 @@
       image.set_plane(val, pos.index)
     else:
       image.set_pixel(val, *pos)
+
+  def Image_array_interface(image):
+    '''Describes the image's pixels to NumPy, so that numpy.asarray()
+    aliases them instead of copying.  The array keeps the image alive,
+    but resizing the image leaves the array pointing at freed memory.'''
+    shape = (image.rows, image.cols)
+    if image.planes > 1: shape = (image.planes,) + shape
+    if image.channels > 1: shape = shape + (image.channels,)
+    return { 'version' : 3,
+             'shape'   : shape,
+             'typestr' : numpy.dtype(image.channel_type).str,
+             'data'    : (image._data_address(), False) }
 }
 
+%{
+  // The NumPy type of each channel type the bindings instantiate.
+  template <class ChannelT> struct NumPyChannelType {};
+  template <> struct NumPyChannelType<vw::uint8>   { static const int value = NPY_UINT8; };
+  template <> struct NumPyChannelType<vw::int16>   { static const int value = NPY_INT16; };
+  template <> struct NumPyChannelType<vw::uint16>  { static const int value = NPY_UINT16; };
+  template <> struct NumPyChannelType<vw::float32> { static const int value = NPY_FLOAT32; };
+%}
+
+%inline %{
+  // Wraps the memory of a C-contiguous NumPy array of shape
+  // [planes,] rows, cols [, channels] in an image without copying it.
+  // The image holds a reference to the array until the last view of
+  // its memory is gone.
+  template <class PixelT>
+  vw::ImageView<PixelT> _image_from_array( PyObject *object ) {
+    typedef typename vw::CompoundChannelType<PixelT>::type channel_type;
+    const int channels = vw::CompoundNumChannels<PixelT>::value;
+    if( ! PyArray_Check(object) )
+      vw_throw( vw::ArgumentErr() << "Expected a NumPy array." );
+    PyArrayObject *array = (PyArrayObject*)object;
+    if( PyArray_TYPE(array) != NumPyChannelType<channel_type>::value )
+      vw_throw( vw::ArgumentErr() << "The array's dtype does not match the image's channel type." );
+    if( ! PyArray_ISCARRAY(array) )
+      vw_throw( vw::ArgumentErr() << "The array must be C-contiguous, aligned and writeable; numpy.ascontiguousarray() makes a copy that is." );
+    int ndim = PyArray_NDIM(array);
+    if( channels > 1 ) {
+      if( ndim < 3 || PyArray_DIM(array,ndim-1) != channels )
+        vw_throw( vw::ArgumentErr() << "The array's last dimension must hold the " << channels << " channels of each pixel." );
+      --ndim;
+    }
+    if( ndim != 2 && ndim != 3 )
+      vw_throw( vw::ArgumentErr() << "The array must be shaped [planes,] rows, cols [, channels]." );
+    vw::int32 planes = (ndim == 3) ? PyArray_DIM(array,0) : 1;
+    vw::int32 rows = PyArray_DIM(array,ndim-2), cols = PyArray_DIM(array,ndim-1);
+    boost::shared_array<PixelT> data( (PixelT*)PyArray_DATA(array), DecrefDeleter(object,true) );
+    return vw::ImageView<PixelT>( data, cols, rows, planes );
+  }
+%}
+
+HANDLE_VW_EXCEPTIONS(_image_from_array)
+
+// Rasterizing lazy views is where scripts spend their time, so it
+// runs in blocks on vw_settings().default_num_threads() threads,
+// without the interpreter lock.
+HANDLE_VW_EXCEPTIONS_NOGIL(vw::ImageViewRef::rasterize)
+
 namespace vw {
   class ImageFormat {
   public:
@@ -105,10 +174,12 @@ namespace vw {
       ImageView get_plane( int index ) { return select_plane(*self,index); }
       void set_plane( ImageView const& val, int index ) { select_plane(*self,index) = val; }
       void set_plane( PixelT const& val, int index ) { fill( select_plane(*self,index), val ); }
+      size_t _data_address() { return (size_t)self->data(); }
     }
     %pythoncode {
       __getitem__ = Image_getitem
       __setitem__ = Image_setitem
+      __array_interface__ = property(Image_array_interface)
       cols = property(get_cols)
       rows = property(get_rows)
       planes = property(get_planes)
@@ -127,7 +198,10 @@ namespace vw {
       int get_rows() const { return self->rows(); }
       int get_planes() const { return self->planes(); }
       int get_channels() const { return self->channels(); }
-      ImageView<PixelT> rasterize() const { return vw::copy(*self); }
+      ImageView<PixelT> rasterize() const {
+        vw::int32 tile_size = vw::vw_settings().default_tile_size();
+        return vw::block_rasterize( *self, vw::Vector2i(tile_size,tile_size) );
+      }
       pixel_type get_pixel( int x, int y, int p=0 ) { return self->operator()(x,y,p); }
       ImageView<pixel_type> get_region( int x, int y, int cols, int rows ) { return crop(*self,x,y,cols,rows); }
       ImageView<pixel_type> get_col( int index ) { return select_col(*self,index); }
@@ -149,6 +223,23 @@ namespace vw {
 %pythoncode {
   _pixel_image_table = dict()
 
+  def _array_pixel_format(array):
+    if array.ndim == 3 and 2 <= array.shape[2] <= 4:
+      return ( pixel.PixelGrayA, pixel.PixelRGB, pixel.PixelRGBA )[array.shape[2]-2]
+    return pixel.PixelScalar
+
+  def from_array( array, ptype=None, pformat=None ):
+    '''Returns an image sharing the memory of a C-contiguous NumPy
+    array shaped [planes,] rows, cols [, channels], without copying.
+    The channel type is the array's dtype, and the pixel format
+    defaults to PixelGrayA, PixelRGB or PixelRGBA for 3D arrays whose
+    last dimension is 2, 3 or 4, and to scalars otherwise.  Single
+    channel pixels have no channel dimension.'''
+    if ptype is None:
+      if pformat is None: pformat = _array_pixel_format(array)
+      ptype = pformat[array.dtype.type]
+    return _pixel_image_table[ptype].from_array(array)
+
   class Image(object):
     '''The standard Vision Workbench image class.'''
 
@@ -160,6 +251,11 @@ namespace vw {
           # we could cast here, but the easy way would create a cyclic dependency
           raise NotImplementedError, 'Incompatible pixel type'
         self.__dict__['impl'] = image.ref().rasterize()
+      elif isinstance(cols, numpy.ndarray):
+        # shares the array's memory; see from_array()
+        if ctype is not None and ctype != cols.dtype.type:
+          raise NotImplementedError, 'Incompatible channel type'
+        self.__dict__['impl'] = from_array(cols,ptype,pformat)
       else:
         ptype = pixel._compute_pixel_type(pixel.PixelRGB_float32,ptype,pformat,ctype)
         self.__dict__['impl'] = _pixel_image_table[ptype](cols,rows,planes)
@@ -193,6 +289,10 @@ namespace vw {
       return ImageViewRef_##pname(self)
     ImageView_##pname.ref = _ImageView_##pname##_ref
   }
+  %template(_ImageView_##pname##_from_array) _image_from_array<ptype >;
+  %pythoncode {
+    ImageView_##pname.from_array = staticmethod(_ImageView_##pname##_from_array)
+  }
 %enddef
 
 %instantiate_for_pixel_types(instantiate_image_types)
@@ -6,12 +6,16 @@
 
 
 %module imagealgo
+%include "vwutil.i"
 %import "_image.i"
 
 %{
 #include <vw/Image.h>
 %}
 
+HANDLE_VW_EXCEPTIONS_NOGIL(_fill)
+HANDLE_VW_EXCEPTIONS_NOGIL(_is_opaque)
+
 %inline %{
   template <class ImageT> void _fill( ImageT const& image, typename ImageT::pixel_type value ) {
     return fill( image, value );
@@ -28,14 +28,61 @@
 }
 %enddef
 
+// Like HANDLE_VW_EXCEPTIONS, but lets go of the interpreter lock while
+// the function runs, so other Python threads keep running while Vision
+// Workbench rasterizes.  Only use it on functions that neither touch
+// Python objects nor call back into Python without taking the lock
+// (see ScopedReleaseGIL).
+%define HANDLE_VW_EXCEPTIONS_NOGIL(function)
+%exception function {
+  try {
+    ScopedReleaseGIL release_gil;
+    $action
+  }
+  catch (const vw::Exception& e) {
+    if( ! PyErr_Occurred() ) {
+      PyErr_Format( PyExc_RuntimeError, "Vision Workbench exception: %s", e.what() );
+    }
+    goto fail;
+  }
+}
+%enddef
+
+%init %{
+  // Python 2 only creates the interpreter lock once asked to.
+  PyEval_InitThreads();
+%}
+
 %{
 
+// Releases the interpreter lock for as long as it is in scope.  Code
+// running meanwhile, on this thread or any other, must hold a
+// PyGILState_Ensure() of its own while it touches Python objects.
+class ScopedReleaseGIL {
+  PyThreadState *m_state;
+public:
+  ScopedReleaseGIL() : m_state( PyEval_SaveThread() ) {}
+  ~ScopedReleaseGIL() { PyEval_RestoreThread( m_state ); }
+};
+
+// Holds the interpreter lock for as long as it is in scope, from any
+// thread, whether or not the thread already holds it.
+class ScopedGIL {
+  PyGILState_STATE m_state;
+public:
+  ScopedGIL() : m_state( PyGILState_Ensure() ) {}
+  ~ScopedGIL() { PyGILState_Release( m_state ); }
+};
+
+
 // A deleter object for use with boost::shared_ptr that keeps track
 // of the Python object corresponding to whatever C++ object it's
 // used with, and decrements the Python object's refcount instead
 // of deleting the C++ object directly.  If the optional second
 // argument to the constructor is true, we grab a new referece to
-// the object; otherwise, we steal the caller's reference.
+// the object; otherwise, we steal the caller's reference.  The
+// last owner may be let go of on a worker thread, e.g. an image
+// aliasing a NumPy array, so the deleter takes the GIL itself.
 class DecrefDeleter {
   PyObject *m_obj;
 public:
@@ -43,6 +90,7 @@ public:
     if( incref ) Py_INCREF(obj);
   }
   template <class T> void operator()(T) {
+    ScopedGIL gil;
     Py_DECREF(m_obj);
   }
 };
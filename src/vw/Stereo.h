@@ -16,6 +16,8 @@
 #include <vw/Stereo/StereoModel.h>
 #include <vw/Stereo/StereoView.h>
 #include <vw/Stereo/OptimizedCorrelator.h>
+#include <vw/Stereo/CostVolumeCorrelator.h>
+#include <vw/Stereo/SemiGlobalCorrelator.h>
 #include <vw/Stereo/ReferenceCorrelator.h>
 #include <vw/Stereo/PyramidCorrelator.h>
 #include <vw/Stereo/CorrelatorView.h>
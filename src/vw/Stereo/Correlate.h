@@ -12,15 +12,20 @@
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/ImageMath.h>
+#include <vw/Image/BlockProcessor.h>
 #include <vw/Math/LinearAlgebra.h>
 #include <limits.h>
 
 namespace vw {
 namespace stereo {
 
+  // CENSUS_CORRELATOR compares the census transforms of the images
+  // (see census_transform() in OptimizedCorrelator.h) by their
+  // Hamming distance.
   enum CorrelatorType { ABS_DIFF_CORRELATOR = 0,
                         SQR_DIFF_CORRELATOR = 1,
-                        NORM_XCORR_CORRELATOR = 2 };
+                        NORM_XCORR_CORRELATOR = 2,
+                        CENSUS_CORRELATOR = 3 };
 
   /// Given a type, these traits classes help to determine a suitable
   /// working type for accumulation operations in the correlator
@@ -51,6 +56,65 @@ namespace stereo {
 
 VW_DEFINE_EXCEPTION(CorrelatorErr, vw::Exception);
 
+  /// The census transform of an image.  Bit n of a pixel's code is
+  /// set when the n-th pixel of the window around it, in row major
+  /// order and skipping the pixel itself, is less than the pixel.
+  /// Pixels past the edges repeat the edge pixels.  Census costs
+  /// depend only on the order of the pixel values, so the images need
+  /// neither preprocessing nor conversion to float.  The window must
+  /// have odd sides and no more pixels than CodeT has bits, plus one.
+  template <class CodeT, class ViewT>
+  ImageView<CodeT> census_transform( ImageViewBase<ViewT> const& view, Vector2i const& window ) {
+    VW_ASSERT( window.x() % 2 == 1 && window.y() % 2 == 1 && window.x() > 0 && window.y() > 0,
+               ArgumentErr() << "census_transform: the window sides must be odd." );
+    VW_ASSERT( window.x() * window.y() - 1 <= int32(8*sizeof(CodeT)),
+               ArgumentErr() << "census_transform: a " << window.x() << "x" << window.y()
+               << " window does not fit in " << 8*sizeof(CodeT) << " bits." );
+    typedef typename ViewT::pixel_type pixel_type;
+    ImageView<pixel_type> image = view.impl();
+    const int32 cols = image.cols(), rows = image.rows();
+    const int32 half_x = window.x()/2, half_y = window.y()/2;
+    ImageView<CodeT> result( cols, rows );
+    for ( int32 y = 0; y < rows; ++y )
+      for ( int32 x = 0; x < cols; ++x ) {
+        const pixel_type center = image(x,y);
+        CodeT code = 0, bit = 1;
+        for ( int32 j = -half_y; j <= half_y; ++j ) {
+          const int32 yy = std::min( std::max( y+j, 0 ), rows-1 );
+          for ( int32 i = -half_x; i <= half_x; ++i ) {
+            if ( i == 0 && j == 0 ) continue;
+            const int32 xx = std::min( std::max( x+i, 0 ), cols-1 );
+            if ( image(xx,yy) < center )
+              code |= bit;
+            bit <<= 1;
+          }
+        }
+        result(x,y) = code;
+      }
+    return result;
+  }
+
+  /// The 5x5 census transform, 24 bits to a pixel.
+  template <class ViewT>
+  ImageView<uint32> census_transform( ImageViewBase<ViewT> const& view ) {
+    return census_transform<uint32>( view, Vector2i(5,5) );
+  }
+
+  /// The number of bits that differ between two census codes.
+  inline int32 census_distance( uint32 a, uint32 b ) {
+    uint32 v = a ^ b;
+    v = v - ((v >> 1) & 0x55555555u);
+    v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+    return int32( (((v + (v >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24 );
+  }
+
+  inline int32 census_distance( uint64 a, uint64 b ) {
+    uint64 v = a ^ b;
+    v = v - ((v >> 1) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+    return int32( (((v + (v >> 4)) & 0x0F0F0F0F0F0F0F0Full) * 0x0101010101010101ull) >> 56 );
+  }
+
   // Sign of the Laplacian of the Gaussian pre-processing
   //
   // Default gaussian blur standard deviation is 1.5 pixels.
@@ -108,6 +172,33 @@ VW_DEFINE_EXCEPTION(CorrelatorErr, vw::Exception);
     static bool use_bit_image() { return false; }
   };
 
+  // Census transform pre-processing
+  //
+  // Replaces each pixel with its bit-packed census descriptor (see
+  // census_transform()), which OptimizedCorrelator compares by Hamming
+  // distance.  The default window is 5x5 for 32-bit descriptors and
+  // 9x7 for 64-bit ones.
+  template <class CodeT = uint32>
+  class CensusStereoPreprocessingFilter {
+    Vector2i m_window;
+
+  public:
+    typedef ImageView<CodeT> result_type;
+
+    CensusStereoPreprocessingFilter() :
+      m_window( sizeof(CodeT) > 4 ? Vector2i(9,7) : Vector2i(5,5) ) {}
+    CensusStereoPreprocessingFilter(Vector2i const& window) : m_window(window) {}
+
+    Vector2i const& window() const { return m_window; }
+
+    template <class ViewT>
+    result_type operator()(ImageViewBase<ViewT> const& view) const {
+      return census_transform<CodeT>(view, m_window);
+    }
+
+    static bool use_bit_image() { return false; }
+  };
+
   // No pre-processing
   class NullStereoPreprocessingFilter {
   public:
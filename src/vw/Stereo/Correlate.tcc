@@ -488,10 +488,375 @@ subpixel_correlation_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map
   } // Y increment
 }
 
+namespace detail {
+
+  /// Refines the disparities of the pixels in a block of rows for
+  /// subpixel_optimized_affine_2d_EM.  The window of each pixel is
+  /// gathered once into contiguous buffers, padded to a whole number of
+  /// lanes, so that the weighted least squares sums of every EM step
+  /// run as independent lanes the compiler can vectorize.  Window
+  /// weights come from the validity of the input disparities, not the
+  /// ones being refined, so blocks can be refined in any order.
+  template <class ChannelT>
+  class AffineEMSubpixelFunc {
+    typedef Vector<float,6> Vector6f;
+    typedef Matrix<float,6,6> Matrix6x6f;
+
+    // The number of window pixels accumulated at once.
+    static const int32 LANES = 8;
+
+    // The sums of the normal equations, in the order they are
+    // accumulated below: six for the right hand side and the eighteen
+    // distinct entries of the symmetric matrix.
+    enum { NUM_SUMS = 24 };
+
+    ImageView<PixelMask<Vector2f> > &m_disparity_map;
+    ImageView<PixelMask<Vector2f> > const& m_input;
+    ImageView<ChannelT> const &m_left_image, &m_right_image;
+    ImageView<float> const &m_x_deriv, &m_y_deriv, &m_weight_template;
+    int32 m_kern_width, m_kern_height;
+
+    // Samples image at (x,y) with bilinear interpolation, returning
+    // zero outside the image, as interpolate(image,
+    // BilinearInterpolation(), ZeroEdgeExtension()) does.
+    inline ChannelT sample( float x, float y ) const {
+      int32 x0 = math::impl::_floor(x), y0 = math::impl::_floor(y);
+      float fx = x - float(x0), fy = y - float(y0);
+      int32 cols = m_right_image.cols(), rows = m_right_image.rows();
+      float p00, p10, p01, p11;
+      if ( x0 >= 0 && y0 >= 0 && x0+1 < cols && y0+1 < rows ) {
+        const ChannelT* p = &m_right_image(x0,y0);
+        p00 = p[0]; p10 = p[1]; p01 = p[cols]; p11 = p[cols+1];
+      } else {
+        p00 = ( x0   >= 0 && x0   < cols && y0   >= 0 && y0   < rows ) ? float(m_right_image(x0,  y0  )) : 0.0f;
+        p10 = ( x0+1 >= 0 && x0+1 < cols && y0   >= 0 && y0   < rows ) ? float(m_right_image(x0+1,y0  )) : 0.0f;
+        p01 = ( x0   >= 0 && x0   < cols && y0+1 >= 0 && y0+1 < rows ) ? float(m_right_image(x0,  y0+1)) : 0.0f;
+        p11 = ( x0+1 >= 0 && x0+1 < cols && y0+1 >= 0 && y0+1 < rows ) ? float(m_right_image(x0+1,y0+1)) : 0.0f;
+      }
+      float result = ( p00*(1-fx) + p10*fx )*(1-fy) + ( p01*(1-fx) + p11*fx )*fy;
+      return channel_cast_round_if_int<ChannelT>(result);
+    }
+
+  public:
+    AffineEMSubpixelFunc( ImageView<PixelMask<Vector2f> > &disparity_map,
+                          ImageView<PixelMask<Vector2f> > const& input,
+                          ImageView<ChannelT> const& left_image,
+                          ImageView<ChannelT> const& right_image,
+                          ImageView<float> const& x_deriv,
+                          ImageView<float> const& y_deriv,
+                          ImageView<float> const& weight_template,
+                          int32 kern_width, int32 kern_height ) :
+      m_disparity_map(disparity_map), m_input(input),
+      m_left_image(left_image), m_right_image(right_image),
+      m_x_deriv(x_deriv), m_y_deriv(y_deriv), m_weight_template(weight_template),
+      m_kern_width(kern_width), m_kern_height(kern_height) {}
+
+    void operator()( BBox2i const& bbox ) const {
+      // Fixed consts
+      const unsigned M_MAX_EM_ITER = 2;
+      const unsigned M_MAX_ITER = 10;
+
+      // This is the maximum number of pixels that the solution can be
+      // adjusted by affine subpixel refinement.
+      const float AFFINE_SUBPIXEL_MAX_TRANSLATION = m_kern_width/2;
+
+      const int32 kern_half_height = m_kern_height/2;
+      const int32 kern_half_width = m_kern_width/2;
+      const int32 kern_pixels = m_kern_height * m_kern_width;
+      const int32 weight_threshold = kern_pixels/2;
+      const int32 padded_pixels = ((kern_pixels + LANES - 1) / LANES) * LANES;
+
+      // The window of the current pixel, one entry per window pixel
+      // in row major order.  The padding entries have zero weight.
+      std::vector<float> ii(padded_pixels, 0), jj(padded_pixels, 0);
+      std::vector<float> ii_sqr(padded_pixels, 0), ii_jj(padded_pixels, 0), jj_sqr(padded_pixels, 0);
+      std::vector<float> left(padded_pixels, 0), I_x(padded_pixels, 0), I_y(padded_pixels, 0);
+      std::vector<float> weight(padded_pixels, 0), I_e(padded_pixels, 0);
+      for ( int32 jw = 0, k = 0; jw < m_kern_height; ++jw )
+        for ( int32 iw = 0; iw < m_kern_width; ++iw, ++k ) {
+          ii[k] = iw - kern_half_width;
+          jj[k] = jw - kern_half_height;
+          ii_sqr[k] = ii[k]*ii[k];
+          ii_jj[k] = ii[k]*jj[k];
+          jj_sqr[k] = jj[k]*jj[k];
+        }
+
+      for ( int32 y = bbox.min().y(); y < bbox.max().y(); ++y ) {
+        for ( int32 x = bbox.min().x(); x < bbox.max().x(); ++x ) {
+
+          // Skip over pixels for which we have no initial disparity estimate
+          if ( !is_valid(m_input(x,y)) )
+            continue;
+
+          // Gather the window, and sum the spatial weights of the
+          // pixels that have an initial disparity.
+          int32 good_pixels = 0;
+          float weight_sum = 0;
+          for ( int32 jw = 0, k = 0; jw < m_kern_height; ++jw ) {
+            int32 yw = y + jw - kern_half_height;
+            for ( int32 iw = 0; iw < m_kern_width; ++iw, ++k ) {
+              int32 xw = x + iw - kern_half_width;
+              left[k] = m_left_image(xw,yw);
+              I_x[k] = m_x_deriv(xw,yw);
+              I_y[k] = m_y_deriv(xw,yw);
+              if ( is_valid(m_input(xw,yw)) ) {
+                weight_sum += m_weight_template(iw,jw);
+                ++good_pixels;
+              }
+            }
+          }
+
+          // Skip over pixels for which there are very few good matches
+          // in the neighborhood.
+          if ( good_pixels < weight_threshold || weight_sum == 0 ) {
+            invalidate(m_disparity_map(x,y));
+            continue;
+          }
+
+          // Every pixel of the window gets the same weight: the
+          // normalized spatial weight of its first pixel, or zero if
+          // that pixel has no initial disparity, which leaves this
+          // disparity as it is.  This is the weighting the solver has
+          // always used; weighting each pixel by its own spatial
+          // weight gives clearly worse results in TestSubPixel.
+          const float window_weight =
+            is_valid(m_input(x-kern_half_width,y-kern_half_height)) ?
+            m_weight_template(0,0) / weight_sum : 0.0f;
+
+          // Initialize our affine transform with the identity.  The
+          // entries of d are laid out in row major order:
+          //
+          //   | d(0) d(1) d(2) |
+          //   | d(3) d(4) d(5) |
+          //   |  0    0    1   |
+          //
+          Vector6f d;
+          d(0) = 1.0; d(1) = 0.0; d(2) = 0.0;
+          d(3) = 0.0; d(4) = 1.0; d(5) = 0.0;
+
+          const float x_base = x + m_input(x,y)[0];
+          const float y_base = y + m_input(x,y)[1];
+
+          float curr_sum_I_e_val = 0.0;
+          float prev_sum_I_e_val = 0.0;
+
+          // Iterate until a solution is found or the max number of
+          // iterations is reached.
+          for ( unsigned iter = 0; iter < M_MAX_ITER; ++iter ) {
+            // First we check to see if our current subpixel translation
+            // is less than one half of the window width.  If not, then
+            // we are probably having trouble converging and we abort
+            // this pixel!!
+            if ( norm_2( Vector2f(d[2],d[5]) ) > AFFINE_SUBPIXEL_MAX_TRANSLATION )
+              break;
+
+            Matrix6x6f rhs;
+            Vector6f lhs, prev_lhs;
+
+            //set init params - START
+            float var2_plane = 1e-3;
+            float mean_noise = 0.0;
+            float var2_noise = 1e-2;
+            float w_plane = 0.8;
+            float w_noise = 0.2;
+            //set init params - END
+
+            Vector6f d_em = d;
+
+            for ( unsigned em_iter = 0; em_iter < M_MAX_EM_ITER; em_iter++ ) {
+              float noise_norm_factor = 1.0/sqrt(2*M_PI*var2_noise);
+              float plane_norm_factor = 1.0/sqrt(2*M_PI*var2_plane);
+              float noise_exp_factor = -1.0/(2*var2_noise);
+              float plane_exp_factor = -1.0/(2*var2_plane);
+
+              float in_curr_sum_I_e_val = 0.0;
+              float mean_noise_tmp  = 0.0;
+              float sum_gamma_noise = 0.0;
+              float sum_gamma_plane = 0.0;
+
+              // Counts pixels skipped on evaluation.
+              int32 skip = 0;
+
+              // Expectation, which leaves the weight of each pixel in
+              // the least squares fit and its error.
+              for ( int32 k = 0; k < kern_pixels; ++k ) {
+                // First we compute the pixel offset for the right image
+                // and the error for the current pixel.
+                float xx = x_base + d[0] * ii[k] + d[1] * jj[k] + d[2];
+                float yy = y_base + d[3] * ii[k] + d[4] * jj[k] + d[5];
+                float delta_x = d_em[0] * ii[k] + d_em[1] * jj[k] + d_em[2];
+                float delta_y = d_em[3] * ii[k] + d_em[4] * jj[k] + d_em[5];
+
+                ChannelT interpreted_px = sample(xx,yy);
+                float I_e_val = interpreted_px - left[k];
+                in_curr_sum_I_e_val += I_e_val;
+                float temp_plane = I_e_val - delta_x*I_x[k] - delta_y*I_y[k];
+                float temp_noise = interpreted_px - mean_noise;
+                float plane_prob_exp = // precompute to avoid underflow
+                  temp_plane*temp_plane*plane_exp_factor;
+                float plane_prob =
+                  (plane_prob_exp < -75) ? 0.0f : plane_norm_factor * std::exp(plane_prob_exp);
+                float noise_prob_exp =
+                  temp_noise*temp_noise*noise_exp_factor;
+                float noise_prob =
+                  (noise_prob_exp < -75) ? 0.0f : noise_norm_factor * std::exp(noise_prob_exp);
+
+                float inv_sum = 1.0f/(plane_prob*w_plane + noise_prob*w_noise);
+                float gamma_plane = plane_prob*w_plane*inv_sum;
+                float gamma_noise = noise_prob*w_noise*inv_sum;
+
+                mean_noise_tmp += interpreted_px * gamma_noise;
+                sum_gamma_plane += gamma_plane;
+                sum_gamma_noise += gamma_noise;
+
+                weight[k] = gamma_plane*window_weight;
+                I_e[k] = I_e_val;
+                if ( weight[k] < 1e-26 ) { // avoid underflow
+                  weight[k] = 0;
+                  skip++;
+                }
+              }
+
+              // Checking for early termination
+              if ( skip == kern_pixels )
+                break;
+
+              // Maximization: the error value combined with the
+              // derivatives, summed into the normal equations.
+              float sums[NUM_SUMS][LANES];
+              std::fill( &sums[0][0], &sums[0][0] + NUM_SUMS*LANES, 0.0f );
+              for ( int32 k = 0; k < padded_pixels; k += LANES ) {
+                for ( int32 l = 0; l < LANES; ++l ) {
+                  const int32 q = k + l;
+                  float I_x_val = weight[q] * I_x[q];
+                  float I_y_val = weight[q] * I_y[q];
+                  float I_x_e = I_x_val * I_e[q];
+                  float I_y_e = I_y_val * I_e[q];
+                  float I_x_sqr = I_x_val * I_x[q];
+                  float I_y_sqr = I_y_val * I_y[q];
+                  float I_x_I_y = I_x_val * I_y[q];
+
+                  // Left hand side
+                  sums[ 0][l] += ii[q] * I_x_e;
+                  sums[ 1][l] += jj[q] * I_x_e;
+                  sums[ 2][l] +=         I_x_e;
+                  sums[ 3][l] += ii[q] * I_y_e;
+                  sums[ 4][l] += jj[q] * I_y_e;
+                  sums[ 5][l] +=         I_y_e;
+
+                  // Right Hand Side UL
+                  sums[ 6][l] += ii_sqr[q] * I_x_sqr;
+                  sums[ 7][l] += ii_jj[q]  * I_x_sqr;
+                  sums[ 8][l] += ii[q]     * I_x_sqr;
+                  sums[ 9][l] += jj_sqr[q] * I_x_sqr;
+                  sums[10][l] += jj[q]     * I_x_sqr;
+                  sums[11][l] +=             I_x_sqr;
+
+                  // Right Hand Side UR
+                  sums[12][l] += ii_sqr[q] * I_x_I_y;
+                  sums[13][l] += ii_jj[q]  * I_x_I_y;
+                  sums[14][l] += ii[q]     * I_x_I_y;
+                  sums[15][l] += jj_sqr[q] * I_x_I_y;
+                  sums[16][l] += jj[q]     * I_x_I_y;
+                  sums[17][l] +=             I_x_I_y;
+
+                  // Right Hand Side LR
+                  sums[18][l] += ii_sqr[q] * I_y_sqr;
+                  sums[19][l] += ii_jj[q]  * I_y_sqr;
+                  sums[20][l] += ii[q]     * I_y_sqr;
+                  sums[21][l] += jj_sqr[q] * I_y_sqr;
+                  sums[22][l] += jj[q]     * I_y_sqr;
+                  sums[23][l] +=             I_y_sqr;
+                }
+              }
+              float total[NUM_SUMS];
+              for ( int32 s = 0; s < NUM_SUMS; ++s ) {
+                total[s] = 0;
+                for ( int32 l = 0; l < LANES; ++l )
+                  total[s] += sums[s][l];
+              }
+
+              for ( int32 s = 0; s < 6; ++s )
+                lhs(s) = -total[s];
+              rhs(0,0) = total[ 6]; rhs(0,1) = total[ 7]; rhs(0,2) = total[ 8];
+              rhs(1,1) = total[ 9]; rhs(1,2) = total[10]; rhs(2,2) = total[11];
+              rhs(0,3) = total[12]; rhs(0,4) = total[13]; rhs(0,5) = total[14];
+              rhs(1,4) = total[15]; rhs(1,5) = total[16]; rhs(2,5) = total[17];
+              rhs(3,3) = total[18]; rhs(3,4) = total[19]; rhs(3,5) = total[20];
+              rhs(4,4) = total[21]; rhs(4,5) = total[22]; rhs(5,5) = total[23];
+
+              // Fill in symmetric entries
+              rhs(1,0) = rhs(0,1);
+              rhs(2,0) = rhs(0,2);
+              rhs(2,1) = rhs(1,2);
+              rhs(3,0) = rhs(0,3);
+              rhs(1,3) = rhs(3,1) = rhs(4,0) = rhs(0,4);
+              rhs(2,3) = rhs(3,2) = rhs(5,0) = rhs(0,5);
+              rhs(4,1) = rhs(1,4);
+              rhs(2,4) = rhs(4,2) = rhs(5,1) = rhs(1,5);
+              rhs(5,2) = rhs(2,5);
+              rhs(4,3) = rhs(3,4);
+              rhs(5,3) = rhs(3,5);
+              rhs(5,4) = rhs(4,5);
+
+              // Solves lhs = rhs * x, and stores the result in-place in lhs.
+              const math::f77_int n = 6;
+              const math::f77_int nrhs = 1;
+              math::f77_int info;
+              math::posv('L',n,nrhs,&(rhs(0,0)), n, &(lhs(0)), n, &info);
+
+              //normalize the mean of the noise
+              mean_noise = mean_noise_tmp/sum_gamma_noise;
+
+              w_plane = sum_gamma_plane/(float)(kern_pixels);
+              w_noise = sum_gamma_noise/(float)(kern_pixels);
+
+              //Termination
+              float conv_error = norm_2(prev_lhs - lhs);
+              d_em = d + lhs;
+              if (in_curr_sum_I_e_val < 0)
+                in_curr_sum_I_e_val = - in_curr_sum_I_e_val;
+
+              curr_sum_I_e_val = in_curr_sum_I_e_val;
+              prev_lhs = lhs;
+
+              // Termination condition
+              if ((conv_error < 1E-3) && (em_iter > 0))
+                break;
+
+            } // for em_iter end
+
+            d += lhs;
+            if (curr_sum_I_e_val < 0)
+              curr_sum_I_e_val = - curr_sum_I_e_val;
+
+            // Termination conditions: the error grew, or the last
+            // step no longer moves the solution.
+            if ((prev_sum_I_e_val < curr_sum_I_e_val) && (iter > 0))
+              break;
+            if ( norm_2(lhs) < 1E-3 )
+              break;
+            prev_sum_I_e_val = curr_sum_I_e_val;
+          }
+
+          if ( norm_2( Vector2f(d[2],d[5]) ) >
+               AFFINE_SUBPIXEL_MAX_TRANSLATION ||
+               std::isnan(d[2]) || std::isnan(d[5]) )
+            invalidate(m_disparity_map(x,y));
+          else
+            remove_mask(m_disparity_map(x,y)) += Vector2f(d[2],d[5]);
+        } // X increment
+      } // Y increment
+    }
+  };
+
+} // namespace detail
+
 // Speed at all cost implementation
 //
 // In this version we don't keep around future research ideas
-// since they are slow.
+// since they are slow.  The pixels are refined in blocks of rows on
+// vw_thread_pool(), see detail::AffineEMSubpixelFunc.
 template<class ChannelT> void
 subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
                                 ImageView<ChannelT> const& left_image,
@@ -501,323 +866,48 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
                                 bool do_horizontal_subpixel,
                                 bool do_vertical_subpixel,
                                 bool /*verbose*/ ) {
-  typedef Vector<float,6> Vector6f;
-  typedef Matrix<float,6,6> Matrix6x6f;
-  typedef typename ImageView<float>::pixel_accessor ImageViewFAcc;
-  typedef typename CropView<ImageView<float> >::pixel_accessor CropViewFAcc;
-  typedef typename CropView<ImageView<ChannelT> >::pixel_accessor CropViewTAcc;
 
   // Bail out if no subpixel computation has been requested
   if (!do_horizontal_subpixel && !do_vertical_subpixel) return;
 
   // Fixed consts
-  const unsigned M_MAX_EM_ITER = 2;
   const float two_sigma_sqr = 2.0*pow(float(kern_width)/5.0,2.0);
+  const int32 rows_per_block = 16;
 
   VW_ASSERT( disparity_map.cols() == left_image.cols() &&
              disparity_map.rows() == left_image.rows(),
              ArgumentErr() << "subpixel_correlation: left image and "
              << "disparity map do not have the same dimensions.");
 
-  // Interpolated Input Images
-  InterpolationView<EdgeExtensionView<ImageView<ChannelT>, ZeroEdgeExtension>, BilinearInterpolation> right_interp_image =
-          interpolate(right_image, BilinearInterpolation(), ZeroEdgeExtension());
-
-  // This is the maximum number of pixels that the solution can be
-  // adjusted by affine subpixel refinement.
-  float AFFINE_SUBPIXEL_MAX_TRANSLATION = kern_width/2;
-
   const int32 kern_half_height = kern_height/2;
   const int32 kern_half_width = kern_width/2;
-  const int32 kern_pixels = kern_height * kern_width;
-  const int32 weight_threshold = kern_pixels/2;
 
+  // Iterate over all of the pixels in the disparity map except for
+  // the outer edges.
+  BBox2i pixels( Vector2i( std::max(region_of_interest.min().x()-1,kern_half_width),
+                           std::max(region_of_interest.min().y()-1,kern_half_height) ),
+                 Vector2i( std::min(left_image.cols()-kern_half_width,
+                                    region_of_interest.max().x()+1),
+                           std::min(left_image.rows()-kern_half_height,
+                                    region_of_interest.max().y()+1) ) );
+  if ( pixels.min().x() >= pixels.max().x() ||
+       pixels.min().y() >= pixels.max().y() )
+    return;
+
+  // The derivative images are computed once and shared by every
+  // window that overlaps them.
   ImageView<float> x_deriv = derivative_filter(left_image, 1, 0);
   ImageView<float> y_deriv = derivative_filter(left_image, 0, 1);
   ImageView<float> weight_template =
     detail::compute_spatial_weight_image(kern_width, kern_height, two_sigma_sqr);
-
-  // Workspace images are allocated up here out of the tight inner
-  // loop.  We rasterize into these directly in the code below.
-  ImageView<float> w(kern_width, kern_height);
-
-  // Iterate over all of the pixels in the disparity map except for
-  // the outer edges.
-  for ( int32 y = std::max(region_of_interest.min().y()-1,kern_half_height);
-        y < std::min(left_image.rows()-kern_half_height,
-                     region_of_interest.max().y()+1); ++y) {
-
-    for (int32 x=std::max(region_of_interest.min().x()-1,kern_half_width);
-         x < std::min(left_image.cols()-kern_half_width,
-                      region_of_interest.max().x()+1); ++x) {
-
-      BBox2i current_window(x-kern_half_width, y-kern_half_height,
-                            kern_width, kern_height);
-
-      // Skip over pixels for which we have no initial disparity estimate
-      if ( !is_valid(disparity_map(x,y)) )
-        continue;
-
-      // Define and initialize the model params
-      // Initialize our affine transform with the identity.  The
-      // entries of d are laid out in row major order:
-      //
-      //   | d(0) d(1) d(2) |
-      //   | d(3) d(4) d(5) |
-      //   |  0    0    1   |
-      //
-      Vector6f d;
-      d(0) = 1.0; d(1) = 0.0; d(2) = 0.0;
-      d(3) = 0.0; d(4) = 1.0; d(5) = 0.0;
-
-      // Compute the derivative image patches
-      CropView<ImageView<ChannelT> > left_image_patch = crop(left_image, current_window);
-      CropView<ImageView<float> > I_x = crop(x_deriv, current_window);
-      CropView<ImageView<float> > I_y = crop(y_deriv, current_window);
-
-      // Compute the base weight image
-      int32 good_pixels =
-        adjust_weight_image(w, crop(disparity_map, current_window),
-                                            weight_template);
-
-      // Skip over pixels for which there are very few good matches
-      // in the neighborhood.
-      if (good_pixels < weight_threshold) {
-        invalidate(disparity_map(x,y));
-        continue;
-      }
-
-      float curr_sum_I_e_val = 0.0;
-      float prev_sum_I_e_val = 0.0;
-
-      // Iterate until a solution is found or the max number of
-      // iterations is reached.
-      for (unsigned iter = 0; iter < 10; ++iter) {
-        // First we check to see if our current subpixel translation
-        // is less than one half of the window width.  If not, then
-        // we are probably having trouble converging and we abort
-        // this pixel!!
-        if (norm_2( Vector2f(d[2],d[5]) ) > AFFINE_SUBPIXEL_MAX_TRANSLATION)
-          break;
-
-        float x_base = x + disparity_map(x,y)[0];
-        float y_base = y + disparity_map(x,y)[1];
-
-        Matrix6x6f rhs;
-        Vector6f lhs, prev_lhs;
-
-        //set init params - START
-        float var2_plane = 1e-3;
-        float mean_noise = 0.0;
-        float var2_noise = 1e-2;
-        float w_plane = 0.8;
-        float w_noise = 0.2;
-        //set init params - END
-
-        float in_curr_sum_I_e_val = 0.0;
-        float in_prev_sum_I_e_val = 1000000.0;
-        Vector6f d_em;
-        d_em = d;
-
-        for (unsigned em_iter=0; em_iter < M_MAX_EM_ITER; em_iter++){
-          float noise_norm_factor = 1.0/sqrt(2*M_PI*var2_noise);
-          float plane_norm_factor = 1.0/sqrt(2*M_PI*var2_plane);
-
-          //reset lhs and rhs
-          std::fill( lhs.begin(), lhs.end(), 0.0f );
-          std::fill( rhs.begin(), rhs.end(), 0.0f );
-
-          in_curr_sum_I_e_val = 0.0;
-          float mean_noise_tmp  = 0.0;
-          float sum_gamma_noise = 0.0;
-          float sum_gamma_plane = 0.0;
-
-          // Set up pixel accessors
-          CropViewFAcc I_x_row = I_x.origin(), I_y_row = I_y.origin();
-          CropViewTAcc left_image_patch_row = left_image_patch.origin();
-          ImageViewFAcc w_row = w.origin();
-
-          // Counts pixels skipped on evaluation.
-          int32 skip = 0;
-
-          // Perform loop that does Expectation and Maximization in one go
-          for (int32 jj = -kern_half_height; jj <= kern_half_height; ++jj) {
-            ImageViewFAcc w_ptr = w_row;
-            CropViewFAcc I_x_ptr = I_x_row, I_y_ptr = I_y_row;
-            CropViewTAcc left_image_patch_ptr = left_image_patch_row;
-            float xx_partial = x_base + d[1] * jj + d[2];
-            float yy_partial = y_base + d[4] * jj + d[5];
-            float delta_x_partial = d_em[1] * jj + d_em[2];
-            float delta_y_partial = d_em[4] * jj + d_em[5];
-
-            for (int32 ii = -kern_half_width; ii <= kern_half_width; ++ii) {
-              // First we compute the pixel offset for the right image
-              // and the error for the current pixel.
-              float xx = d[0] * ii + xx_partial;
-              float yy = d[3] * ii + yy_partial;
-              float delta_x = d_em[0] * ii + delta_x_partial;
-              float delta_y = d_em[3] * ii + delta_y_partial;
-
-              /// Expectation
-              ChannelT interpreted_px = right_interp_image(xx,yy);
-              float I_e_val = interpreted_px - (*left_image_patch_ptr);
-              in_curr_sum_I_e_val += I_e_val;
-              float temp_plane = I_e_val - delta_x*(*I_x_ptr) -
-                delta_y*(*I_y_ptr);
-              float temp_noise = interpreted_px - mean_noise;
-              float plane_prob_exp = // precompute to avoid underflow
-                -1*(temp_plane*temp_plane)/(2*var2_plane);
-              float plane_prob =
-                (plane_prob_exp < -75) ? 0.0f : plane_norm_factor *
-                exp(plane_prob_exp);
-              float noise_prob_exp =
-                -1*(temp_noise*temp_noise)/(2*var2_noise);
-              float noise_prob =
-                (noise_prob_exp < -75) ? 0.0f : noise_norm_factor *
-                exp(noise_prob_exp);
-
-              float sum = plane_prob*w_plane + noise_prob*w_noise;
-              float gamma_plane = plane_prob*w_plane/sum;
-              float gamma_noise = noise_prob*w_noise/sum;
-              // End Expectation
-
-              // Maximization (computing the d_em vector)
-              mean_noise_tmp +=
-                interpreted_px * gamma_noise;
-              sum_gamma_plane += gamma_plane;
-              sum_gamma_noise += gamma_noise;
-
-              // We combine the error value with the derivative and
-              // add this to the update equation.
-              float weight  = gamma_plane*(*w_ptr);
-              if ( weight < 1e-26 ) {
-                 // avoid underflow
-                I_x_ptr.next_col();
-                I_y_ptr.next_col();
-                left_image_patch_ptr.next_col();
-                skip++;
-                continue;
-              }
-              float I_x_val = weight * (*I_x_ptr);
-              float I_y_val = weight * (*I_y_ptr);
-              float I_x_sqr = I_x_val * (*I_x_ptr);
-              float I_y_sqr = I_y_val * (*I_y_ptr);
-              float I_x_I_y = I_x_val * (*I_y_ptr);
-
-              // Left hand side
-              lhs(0) -= ii * I_x_val * I_e_val;
-              lhs(1) -= jj * I_x_val * I_e_val;
-              lhs(2) -=      I_x_val * I_e_val;
-              lhs(3) -= ii * I_y_val * I_e_val;
-              lhs(4) -= jj * I_y_val * I_e_val;
-              lhs(5) -=      I_y_val * I_e_val;
-
-              float multipliers[3];
-              multipliers[0] = ii*ii;
-              multipliers[1] = ii*jj;
-              multipliers[2] = jj*jj;
-
-              // Right Hand Side UL
-              rhs(0,0) += multipliers[0] * I_x_sqr;
-              rhs(0,1) += multipliers[1] * I_x_sqr;
-              rhs(0,2) += ii    * I_x_sqr;
-              rhs(1,1) += multipliers[2] * I_x_sqr;
-              rhs(1,2) += jj    * I_x_sqr;
-              rhs(2,2) +=         I_x_sqr;
-
-              // Right Hand Side UR
-              rhs(0,3) += multipliers[0] * I_x_I_y;
-              rhs(0,4) += multipliers[1] * I_x_I_y;
-              rhs(0,5) += ii    * I_x_I_y;
-              rhs(1,4) += multipliers[2] * I_x_I_y;
-              rhs(1,5) += jj    * I_x_I_y;
-              rhs(2,5) +=         I_x_I_y;
-
-              // Right Hand Side LR
-              rhs(3,3) += multipliers[0] * I_y_sqr;
-              rhs(3,4) += multipliers[1] * I_y_sqr;
-              rhs(3,5) += ii    * I_y_sqr;
-              rhs(4,4) += multipliers[2] * I_y_sqr;
-              rhs(4,5) += jj    * I_y_sqr;
-              rhs(5,5) +=         I_y_sqr;
-              // End Maximization
-
-              I_x_ptr.next_col();
-              I_y_ptr.next_col();
-              left_image_patch_ptr.next_col();
-            }
-            I_x_row.next_row();
-            I_y_row.next_row();
-            left_image_patch_row.next_row();
-          }
-
-          // Checking for early termination
-          if ( skip == kern_pixels )
-            break;
-
-          // Fill in symmetric entries
-          rhs(1,0) = rhs(0,1);
-          rhs(2,0) = rhs(0,2);
-          rhs(2,1) = rhs(1,2);
-          rhs(3,0) = rhs(0,3);
-          rhs(1,3) = rhs(3,1) = rhs(4,0) = rhs(0,4);
-          rhs(2,3) = rhs(3,2) = rhs(5,0) = rhs(0,5);
-          rhs(4,1) = rhs(1,4);
-          rhs(2,4) = rhs(4,2) = rhs(5,1) = rhs(1,5);
-          rhs(5,2) = rhs(2,5);
-          rhs(4,3) = rhs(3,4);
-          rhs(5,3) = rhs(3,5);
-          rhs(5,4) = rhs(4,5);
-
-          // Solves lhs = rhs * x, and stores the result in-place in lhs.
-          const math::f77_int n = 6;
-          const math::f77_int nrhs = 1;
-          math::f77_int info;
-          math::posv('L',n,nrhs,&(rhs(0,0)), n, &(lhs(0)), n, &info);
-
-          //normalize the mean of the noise
-          mean_noise = mean_noise_tmp/sum_gamma_noise;
-
-          w_plane = sum_gamma_plane/(float)(kern_pixels);
-          w_noise = sum_gamma_noise/(float)(kern_pixels);
-
-          //Termination
-          float conv_error = norm_2(prev_lhs - lhs);
-          d_em = d + lhs;
-          if (in_curr_sum_I_e_val < 0)
-            in_curr_sum_I_e_val = - in_curr_sum_I_e_val;
-
-          curr_sum_I_e_val = in_curr_sum_I_e_val;
-          prev_lhs = lhs;
-
-          // Termination condition
-          if ((conv_error < 1E-3) && (em_iter > 0))
-            break;
-          else
-            in_prev_sum_I_e_val = in_curr_sum_I_e_val;
-
-        } // for em_iter end
-
-        d += lhs;
-        if (curr_sum_I_e_val < 0)
-          curr_sum_I_e_val = - curr_sum_I_e_val;
-
-        // Termination condition
-        if ((prev_sum_I_e_val < curr_sum_I_e_val) && (iter > 0))
-          break;
-        else
-          prev_sum_I_e_val = curr_sum_I_e_val;
-
-      }
-
-      if ( norm_2( Vector2f(d[2],d[5]) ) >
-           AFFINE_SUBPIXEL_MAX_TRANSLATION ||
-           std::isnan(d[2]) || std::isnan(d[5]) )
-        invalidate(disparity_map(x,y));
-      else
-        remove_mask(disparity_map(x,y)) += Vector2f(d[2],d[5]);
-    } // X increment
-  } // Y increment
+  ImageView<PixelMask<Vector2f> > input = copy(disparity_map);
+
+  detail::AffineEMSubpixelFunc<ChannelT> func( disparity_map, input, left_image, right_image,
+                                               x_deriv, y_deriv, weight_template,
+                                               kern_width, kern_height );
+  BlockProcessor<detail::AffineEMSubpixelFunc<ChannelT> >
+    process( func, Vector2i(pixels.width(), rows_per_block) );
+  process( pixels );
 }
 
 template<class ChannelT> void
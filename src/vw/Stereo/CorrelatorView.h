@@ -11,6 +11,10 @@
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Stereo/Correlate.h>
 #include <vw/Stereo/PyramidCorrelator.h>
+#include <vw/Stereo/SemiGlobalCorrelator.h>
+#include <vw/Stereo/CostVolumeCorrelator.h>
+#include <vw/Stereo/OpenCLCorrelator.h>
+#include <vw/Stereo/PreprocessedPyramid.h>
 #include <vw/Stereo/DisparityMap.h>
 
 #include <ostream>
@@ -28,6 +32,8 @@ namespace stereo {
 
     // Settings
     BBox2i m_search_range;
+    ImageView<BBox2i> m_search_range_seed;
+    Vector2i m_seed_region_size;
     Vector2i m_kernel_size;
     float m_cross_corr_threshold;
     float m_corr_score_threshold;
@@ -35,11 +41,43 @@ namespace stereo {
     stereo::CorrelatorType m_correlator_type;
     std::string m_debug_prefix;
     bool m_do_pyramid_correlator;
+    bool m_do_semi_global;
+    int32 m_penalty1, m_penalty2;
+    bool m_do_integer_correlation;
+    bool m_single_pass_cross_check;
+    bool m_do_opencl, m_opencl_subpixel;
 
     // Precalculated constants
     int32 m_num_pyramid_levels;
     Vector2i m_kernpad;         // Padding used around a render box
 
+    // Preprocessed pyramids of the whole images, shared by the blocks
+    typedef PreprocessedPyramid<typename PixelChannelType<ImagePixelT>::type, PreProcFuncT> pyramid_type;
+    boost::shared_ptr<pyramid_type> m_left_pyramid, m_right_pyramid;
+
+    void update_kernpad() {
+      if ( m_do_semi_global )
+        m_kernpad = m_kernel_size/2 + Vector2i(1,1)*SemiGlobalCorrelator::context_size();
+      else
+        m_kernpad = m_kernel_size*pow(2,m_num_pyramid_levels-1)/2;
+    }
+
+    // The search range for the pixels of bbox: the union of the seed's
+    // ranges over the regions bbox touches, or the whole search range
+    // if there is no seed.  BBox2i() if there is nothing to search.
+    BBox2i tile_search_range(BBox2i const& bbox) const {
+      if ( m_search_range_seed.cols() == 0 )
+        return m_search_range;
+      BBox2i range;
+      int32 i_end = std::min( (bbox.max().x() - 1) / m_seed_region_size.x(), m_search_range_seed.cols() - 1 );
+      int32 j_end = std::min( (bbox.max().y() - 1) / m_seed_region_size.y(), m_search_range_seed.rows() - 1 );
+      for ( int32 j = std::max( bbox.min().y() / m_seed_region_size.y(), 0 ); j <= j_end; ++j )
+        for ( int32 i = std::max( bbox.min().x() / m_seed_region_size.x(), 0 ); i <= i_end; ++i )
+          if ( m_search_range_seed(i,j) != BBox2i() )
+            range.grow( m_search_range_seed(i,j) );
+      return range;
+    }
+
   public:
     typedef PixelMask<Vector2f> pixel_type;
     typedef pixel_type result_type;
@@ -52,7 +90,10 @@ namespace stereo {
                    bool do_pyramid_correlator = true ) :
       m_left_image(left_image.impl()), m_right_image(right_image.impl()),
       m_left_mask(left_mask.impl()), m_right_mask(right_mask.impl()),
-      m_preproc_func(preproc_func), m_do_pyramid_correlator(do_pyramid_correlator) {
+      m_preproc_func(preproc_func), m_do_pyramid_correlator(do_pyramid_correlator),
+      m_do_semi_global(false), m_penalty1(8), m_penalty2(96),
+      m_do_integer_correlation(false), m_single_pass_cross_check(false),
+      m_do_opencl(false), m_opencl_subpixel(false) {
 
         // Basic assertions
         VW_ASSERT((left_image.impl().cols() == right_image.impl().cols()) &&
@@ -83,16 +124,37 @@ namespace stereo {
         m_num_pyramid_levels = 4;
         if ( !m_do_pyramid_correlator )
           m_num_pyramid_levels = 1;
-        m_kernpad = m_kernel_size*pow(2,m_num_pyramid_levels-1)/2;
+        update_kernpad();
+        set_pyramid_cache( m_do_pyramid_correlator );
       }
 
       // Basic accessor functions
       void set_search_range(BBox2i range) { m_search_range = range; }
       BBox2i search_range() const { return m_search_range; }
 
+      /// Search each block only over the disparities a coarser pass
+      /// found near it.  Each pixel of seed holds the search range of a
+      /// region_size block of the left image, in full resolution
+      /// disparities, or BBox2i() where nothing should be searched (see
+      /// search_range_seed() in DisparityMap.h).  A block is searched
+      /// over the union of the ranges of the regions it touches.  An
+      /// empty seed goes back to the one search range for all blocks.
+      void set_search_range_seed(ImageView<BBox2i> const& seed, Vector2i const& region_size) {
+        if ( seed.cols() != 0 ) {
+          VW_ASSERT( region_size.x() > 0 && region_size.y() > 0,
+                     ArgumentErr() << "CorrelatorView::set_search_range_seed(): region size must be positive.\n" );
+          VW_ASSERT( seed.cols()*region_size.x() >= cols() && seed.rows()*region_size.y() >= rows(),
+                     ArgumentErr() << "CorrelatorView::set_search_range_seed(): seed does not cover the image.\n" );
+        }
+        m_search_range_seed = seed;
+        m_seed_region_size = region_size;
+      }
+      ImageView<BBox2i> const& search_range_seed() const { return m_search_range_seed; }
+      Vector2i seed_region_size() const { return m_seed_region_size; }
+
       void set_kernel_size(Vector2i size) {
         m_kernel_size = size;
-        m_kernpad = m_kernel_size*pow(2,m_num_pyramid_levels-1)/2;
+        update_kernpad();
       }
       Vector2i kernel_size() const { return m_kernel_size; }
 
@@ -103,12 +165,78 @@ namespace stereo {
       int32 cost_blur() const { return m_cost_blur; }
       stereo::CorrelatorType correlator_type() const { return m_correlator_type; }
 
+      /// Use semi-global matching (see SemiGlobalCorrelator.h) in place
+      /// of the pyramid or optimized correlator.  It works best with a
+      /// small kernel, and the cost blur is not used.
+      void set_semi_global_options(bool enable, int32 penalty1 = 8, int32 penalty2 = 96) {
+        m_do_semi_global = enable;
+        m_penalty1 = penalty1;
+        m_penalty2 = penalty2;
+        update_kernpad();
+      }
+      bool semi_global() const { return m_do_semi_global; }
+      int32 penalty1() const { return m_penalty1; }
+      int32 penalty2() const { return m_penalty2; }
+
+      /// Correlate the images in their own channel type with
+      /// CostVolumeCorrelator, in place of the optimized correlator.
+      /// The preprocessing filter is not applied, so this is meant for
+      /// uint8 and uint16 images with the census cost, which needs no
+      /// preprocessing, or the absolute difference cost; both are
+      /// summed in integers.  The pyramid and semi-global correlators
+      /// are not affected.
+      void set_integer_correlation(bool enable) { m_do_integer_correlation = enable; }
+      bool integer_correlation() const { return m_do_integer_correlation; }
+
+      /// Find the right to left disparities for the cross check from
+      /// the left to right costs instead of correlating each block a
+      /// second time (see OptimizedCorrelator).  This applies to the
+      /// pyramid and optimized correlators.
+      void set_single_pass_cross_check(bool enable) { m_single_pass_cross_check = enable; }
+      bool single_pass_cross_check() const { return m_single_pass_cross_check; }
+
+      /// Correlate on an OpenCL device with OpenCLCorrelator, in place
+      /// of the optimized correlator, optionally refining the
+      /// disparities to subpixel precision there too.  This needs
+      /// Vision Workbench built with OpenCL.  The pyramid, semi-global
+      /// and integer correlators are not affected.
+      void set_opencl_correlation(bool enable, bool subpixel = false) {
+#if defined(VW_HAVE_PKG_OPENCL) && VW_HAVE_PKG_OPENCL==1
+        VW_ASSERT( !enable || OpenCLCorrelator::available(),
+                   NoImplErr() << "CorrelatorView: no OpenCL device is available." );
+#else
+        if ( enable )
+          vw_throw( NoImplErr() << "CorrelatorView: Vision Workbench was built without OpenCL." );
+#endif
+        m_do_opencl = enable;
+        m_opencl_subpixel = subpixel;
+      }
+      bool opencl_correlation() const { return m_do_opencl; }
+      bool opencl_subpixel() const { return m_opencl_subpixel; }
+
       void set_cross_corr_threshold(float threshold) { m_cross_corr_threshold = threshold; }
       float cross_corr_threshold() const { return m_cross_corr_threshold; }
 
       void set_corr_score_threshold(float threshold) { m_corr_score_threshold = threshold; }
       float corr_score_threshold() const { return m_corr_score_threshold; }
 
+      /// Have the pyramid correlator read each block's pyramid out of
+      /// pyramids of the whole images, preprocessed and cached a block
+      /// at a time in vw_system_cache() (see PreprocessedPyramid.h),
+      /// instead of building and preprocessing a pyramid of each
+      /// block's padded crop.  This is on by default for the pyramid
+      /// correlator.
+      void set_pyramid_cache(bool enable) {
+        if ( enable && m_do_pyramid_correlator ) {
+          m_left_pyramid.reset( new pyramid_type(m_left_image, m_preproc_func, m_num_pyramid_levels) );
+          m_right_pyramid.reset( new pyramid_type(m_right_image, m_preproc_func, m_num_pyramid_levels) );
+        } else {
+          m_left_pyramid.reset();
+          m_right_pyramid.reset();
+        }
+      }
+      bool pyramid_cache() const { return bool(m_left_pyramid); }
+
       /// Turn on debugging output.  The debug_file_prefix string is
       /// used as a prefix for all debug image files.
       void set_debug_mode(std::string const& debug_file_prefix) { m_debug_prefix = debug_file_prefix; }
@@ -130,12 +258,20 @@ namespace stereo {
       inline prerasterize_type prerasterize(BBox2i bbox) const {
         vw_out(DebugMessage, "stereo") << "CorrelatorView: rasterizing image block " << bbox << ".\n";
 
+        // With a seed, blocks that had no valid disparities in the
+        // coarse pass have nothing to search.
+        BBox2i search_range = tile_search_range(bbox);
+        if ( search_range == BBox2i() )
+          return CropView<ImageView<pixel_type> >( ImageView<pixel_type>(bbox.width(), bbox.height()),
+                                                   BBox2i(-bbox.min().x(), -bbox.min().y(),
+                                                          bbox.width(), bbox.height()) );
+
         // The area in the right image that we'll be searching is
         // determined by the bbox of the left image plus the search
         // range.
         BBox2i left_crop_bbox(bbox);
-        BBox2i right_crop_bbox( bbox.min() + m_search_range.min(),
-                                bbox.max() + m_search_range.max() );
+        BBox2i right_crop_bbox( bbox.min() + search_range.min(),
+                                bbox.max() + search_range.max() );
 
         // The correlator requires the images to be the same size. The
         // search bbox will always be larger than the given left image
@@ -151,9 +287,32 @@ namespace stereo {
         left_crop_bbox.min() -= m_kernpad;
         left_crop_bbox.max() += m_kernpad;
 
+        // The disparities the correlator finds are relative to the
+        // offset of the right crop from the left.  Read from the shared
+        // pyramids, each level of a crop must line up with the pixels of
+        // that level of the whole image, so both crops are grown to
+        // start and end on multiples of the coarsest level's scale.
+        bool use_pyramid_cache = m_left_pyramid && !m_do_semi_global;
+        Vector2i disparity_offset = search_range.min();
+        if ( use_pyramid_cache ) {
+          int32 scale = 1 << (m_num_pyramid_levels-1);
+          Vector2i left_min, right_min, size;
+          for ( int32 i = 0; i < 2; ++i ) {
+            left_min[i] = int32(floor(double(left_crop_bbox.min()[i]) / scale)) * scale;
+            right_min[i] = int32(floor(double(right_crop_bbox.min()[i]) / scale)) * scale;
+            size[i] = std::max(left_crop_bbox.max()[i] - left_min[i], right_crop_bbox.max()[i] - right_min[i]);
+            size[i] = (size[i] + scale - 1) / scale * scale;
+          }
+          left_crop_bbox = BBox2i(left_min, left_min + size);
+          right_crop_bbox = BBox2i(right_min, right_min + size);
+          disparity_offset = right_min - left_min;
+        }
+        BBox2i local_range(search_range.min() - disparity_offset,
+                           search_range.max() - disparity_offset);
+
         // Log some helpful debugging info
         vw_out(DebugMessage, "stereo") << "\t search_range:    "
-                                       << m_search_range << std::endl;
+                                       << search_range << std::endl;
         vw_out(DebugMessage, "stereo") << "\t left_crop_bbox:  "
                                        << left_crop_bbox << std::endl;
         vw_out(DebugMessage, "stereo") << "\t right_crop_bbox: "
@@ -161,10 +320,19 @@ namespace stereo {
 
         // We crop the images to the expanded bounding box and edge
         // extend in case the new bbox extends past the image bounds.
-        ImageView<ImagePixelT> cropped_left_image =
-          crop(edge_extend(m_left_image, ZeroEdgeExtension()), left_crop_bbox);
-        ImageView<ImagePixelT> cropped_right_image =
-          crop(edge_extend(m_right_image, ZeroEdgeExtension()), right_crop_bbox);
+        // With the shared pyramids the images are cropped level by level
+        // below instead.
+        typedef typename PixelChannelType<ImagePixelT>::type channel_type;
+        bool use_integer = m_do_integer_correlation && !m_do_semi_global && !m_do_pyramid_correlator;
+        ImageView<ImagePixelT> cropped_left_image, cropped_right_image;
+        ImageView<channel_type> native_left_image, native_right_image;
+        if ( use_integer ) {
+          native_left_image = pixel_cast<channel_type>(crop(edge_extend(m_left_image, ZeroEdgeExtension()), left_crop_bbox));
+          native_right_image = pixel_cast<channel_type>(crop(edge_extend(m_right_image, ZeroEdgeExtension()), right_crop_bbox));
+        } else if ( !use_pyramid_cache ) {
+          cropped_left_image = crop(edge_extend(m_left_image, ZeroEdgeExtension()), left_crop_bbox);
+          cropped_right_image = crop(edge_extend(m_right_image, ZeroEdgeExtension()), right_crop_bbox);
+        }
         ImageView<MaskPixelT> cropped_left_mask =
           crop(edge_extend(m_left_mask, ZeroEdgeExtension()), left_crop_bbox);
         ImageView<MaskPixelT> cropped_right_mask =
@@ -178,12 +346,23 @@ namespace stereo {
              sum_of_pixel_values(cropped_right_mask) != 0 ) {
           // We have all of the settings adjusted.  Now we just have to
           // run the correlator.
-          if ( m_do_pyramid_correlator ) {
-            PyramidCorrelator correlator(BBox2(0,0,m_search_range.width(),
-                                               m_search_range.height()),
+          if ( m_do_semi_global ) {
+            SemiGlobalCorrelator correlator(BBox2(local_range.min().x(), local_range.min().y(),
+                                                  local_range.width(), local_range.height()),
+                                            m_kernel_size[0], m_cross_corr_threshold,
+                                            m_penalty1, m_penalty2, m_correlator_type );
+            disparity_map = disparity_mask(correlator( cropped_left_image,
+                                                       cropped_right_image,
+                                                       m_preproc_func ),
+                                           cropped_left_mask,
+                                           cropped_right_mask );
+          } else if ( m_do_pyramid_correlator ) {
+            PyramidCorrelator correlator(BBox2(local_range.min().x(), local_range.min().y(),
+                                               local_range.width(), local_range.height()),
                                          Vector2i(m_kernel_size[0], m_kernel_size[1]),
                                          m_cross_corr_threshold, m_corr_score_threshold,
                                          m_cost_blur, m_correlator_type, m_num_pyramid_levels);
+            correlator.set_single_pass_cross_check(m_single_pass_cross_check);
 
             // For debugging: this saves the disparity map at various
             // pyramid levels to disk.
@@ -194,15 +373,53 @@ namespace stereo {
               correlator.set_debug_mode(m_debug_prefix + ostr.str());
             }
 
-            disparity_map = correlator( cropped_left_image, cropped_right_image,
-                                        cropped_left_mask, cropped_right_mask,
-                                        m_preproc_func);
+            if ( use_pyramid_cache ) {
+              typedef typename pyramid_type::pixel_type level_pixel_type;
+              std::vector<ImageView<level_pixel_type> > left_levels(m_num_pyramid_levels),
+                right_levels(m_num_pyramid_levels);
+              for ( int32 n = 0; n < m_num_pyramid_levels; ++n ) {
+                left_levels[n] = crop(edge_extend(m_left_pyramid->level(n), ZeroEdgeExtension()),
+                                      BBox2i(left_crop_bbox.min()/(1<<n), left_crop_bbox.max()/(1<<n)));
+                right_levels[n] = crop(edge_extend(m_right_pyramid->level(n), ZeroEdgeExtension()),
+                                       BBox2i(right_crop_bbox.min()/(1<<n), right_crop_bbox.max()/(1<<n)));
+              }
+              disparity_map = correlator( left_levels, right_levels,
+                                          cropped_left_mask, cropped_right_mask );
+            } else {
+              disparity_map = correlator( cropped_left_image, cropped_right_image,
+                                          cropped_left_mask, cropped_right_mask,
+                                          m_preproc_func);
+            }
+          } else if ( use_integer ) {
+            CostVolumeCorrelator correlator(BBox2(local_range.min().x(), local_range.min().y(),
+                                                  local_range.width(), local_range.height()),
+                                            m_kernel_size[0],
+                                            m_cross_corr_threshold, m_corr_score_threshold,
+                                            m_cost_blur, m_correlator_type );
+            disparity_map = disparity_mask(correlator( native_left_image,
+                                                       native_right_image ),
+                                           cropped_left_mask,
+                                           cropped_right_mask );
+#if defined(VW_HAVE_PKG_OPENCL) && VW_HAVE_PKG_OPENCL==1
+          } else if ( m_do_opencl ) {
+            OpenCLCorrelator correlator(BBox2(local_range.min().x(), local_range.min().y(),
+                                              local_range.width(), local_range.height()),
+                                        m_kernel_size[0], m_cross_corr_threshold,
+                                        m_cost_blur, m_correlator_type );
+            correlator.set_subpixel(m_opencl_subpixel);
+            disparity_map = disparity_mask(correlator( cropped_left_image,
+                                                       cropped_right_image,
+                                                       m_preproc_func ),
+                                           cropped_left_mask,
+                                           cropped_right_mask );
+#endif
           } else {
-            OptimizedCorrelator correlator(BBox2(0,0,m_search_range.width(),
-                                                 m_search_range.height()),
+            OptimizedCorrelator correlator(BBox2(local_range.min().x(), local_range.min().y(),
+                                                 local_range.width(), local_range.height()),
                                            m_kernel_size[0],
                                            m_cross_corr_threshold, m_corr_score_threshold,
                                            m_cost_blur, m_correlator_type );
+            correlator.set_single_pass_cross_check(m_single_pass_cross_check);
             disparity_map = disparity_mask(correlator( cropped_left_image,
                                                        cropped_right_image,
                                                        m_preproc_func ),
@@ -214,15 +431,15 @@ namespace stereo {
         // Adjust the disparities to be relative to the uncropped
         // image pixel locations
         // This should just be a straight forward add
-        disparity_map += pixel_type(m_search_range.min());
+        disparity_map += pixel_type(disparity_offset);
 
         // This may seem confusing, but we must crop here so that the
         // good pixel data is placed into the coordinates specified by
         // the bbox.  This allows rasterize to touch those pixels
         // using the coordinates inside the bbox.  The pixels outside
         // those coordinates are invalid, and they never get accessed.
-        return CropView<ImageView<pixel_type> > (disparity_map, BBox2i(m_kernpad[0]-bbox.min().x(),
-                                                                       m_kernpad[1]-bbox.min().y(),
+        return CropView<ImageView<pixel_type> > (disparity_map, BBox2i(-left_crop_bbox.min().x(),
+                                                                       -left_crop_bbox.min().y(),
                                                                        bbox.width(), bbox.height()));
       }
 
@@ -238,10 +455,19 @@ namespace stereo {
   std::ostream& operator<<( std::ostream& os, CorrelatorView<ImagePixelT,MaskPixelT,PreProcFuncT> const& view ) {
     os << "------------------------- CorrelatorView ----------------------\n";
     os << "\tsearch range: " << view.search_range() << "\n";
+    if ( view.search_range_seed().cols() != 0 )
+      os << "\tsearch range seed: " << view.search_range_seed().cols() << "x"
+         << view.search_range_seed().rows() << " regions of " << view.seed_region_size() << "\n";
     os << "\tkernel size : " << view.kernel_size() << "\n";
     os << "\txcorr thresh: " << view.cross_corr_threshold() << "\n";
     os << "\tcost blur: " << view.cost_blur() << "\n";
     os << "\tcorrelator type: " << view.correlator_type() << "\n";
+    if ( view.semi_global() )
+      os << "\tsemi-global penalties: " << view.penalty1() << " " << view.penalty2() << "\n";
+    if ( view.integer_correlation() )
+      os << "\tinteger correlation\n";
+    if ( view.single_pass_cross_check() )
+      os << "\tsingle pass cross check\n";
     os << "\tcorrscore rejection thresh: " << view.corr_score_threshold() << "\n";
     os << "---------------------------------------------------------------\n";
     return os;
@@ -0,0 +1,523 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Stereo/CostVolumeCorrelator.h>
+#include <vw/Image/SummedAreaTable.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+// Functions compiled for AVX2 with the target attribute need GCC 4.9
+#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define VW_COST_VOLUME_AVX2 1
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+#endif
+
+using namespace vw;
+using namespace vw::stereo;
+
+namespace {
+
+  // The number of disparities evaluated at once: the lanes of a
+  // vector.  The costs of a pixel are stored LANES to a pixel, the
+  // cost of disparity dx0+l in lane l.
+  const int32 LANES = 8;
+
+  struct AbsCost {
+    static inline float apply( float l, float r ) { return std::fabs( l - r ); }
+    static inline int32 apply( int32 l, int32 r ) { return std::abs( l - r ); }
+  };
+
+  struct SqCost {
+    static inline float apply( float l, float r ) { float d = l - r; return d * d; }
+  };
+
+  struct ProdCost {
+    static inline float apply( float l, float r ) { return l * r; }
+  };
+
+  // Census codes have 24 bits, so they pass through the int32 that
+  // the costs are summed in unchanged.
+  struct CensusDistanceCost {
+    static inline int32 apply( int32 l, int32 r ) { return census_distance( uint32(l), uint32(r) ); }
+  };
+
+  // ---------------------------------------------------------------
+  // The generic loops.  The vector loops do the same arithmetic in
+  // the same order, so both give the same answer.
+  // ---------------------------------------------------------------
+
+  // Adds (or subtracts) the costs of a row of left pixels to the
+  // column sums: colsum[LANES*x+l] += cost( left[x], right[x+l] ).
+  template <class CostT, bool SubtractV, class ChannelT, class SumT>
+  void accumulate_scalar( SumT* colsum, ChannelT const* left, ChannelT const* right, int32 n ) {
+    for( int32 x = 0; x < n; ++x, colsum += LANES )
+      for( int32 l = 0; l < LANES; ++l ) {
+        SumT c = CostT::apply( SumT( left[x] ), SumT( right[x+l] ) );
+        colsum[l] = SubtractV ? colsum[l] - c : colsum[l] + c;
+      }
+  }
+
+  // Slides a window of k column sums along the row, giving the window
+  // sums of the count windows that start at 0 to count-1.
+  template <class SumT>
+  void window_sums_scalar( SumT const* colsum, int32 k, float* win, int32 count ) {
+    SumT s[LANES];
+    for( int32 l = 0; l < LANES; ++l ) s[l] = 0;
+    for( int32 x = 0; x < k; ++x )
+      for( int32 l = 0; l < LANES; ++l ) s[l] += colsum[LANES*x+l];
+    for( int32 x = 0; x < count; ++x ) {
+      for( int32 l = 0; l < LANES; ++l ) {
+        win[LANES*x+l] = float( s[l] );
+        s[l] = s[l] + colsum[LANES*(x+k)+l] - colsum[LANES*x+l];
+      }
+    }
+  }
+
+  // Turns window sums of left*right into NormXCorrCost's cost.
+  void ncc_scalar( float* win, int32 count, float scale,
+                   float const* left_mean, float const* left_precision,
+                   float const* right_mean, float const* right_precision ) {
+    for( int32 x = 0; x < count; ++x )
+      for( int32 l = 0; l < LANES; ++l ) {
+        float d = win[LANES*x+l] * scale - left_mean[x] * right_mean[x+l];
+        win[LANES*x+l] = 1 - std::fabs( d * d * left_precision[x] * right_precision[x+l] );
+      }
+  }
+
+  // Winner take all over the first lanes of each pixel's costs, in
+  // the order of the disparities, as stereo::correlate() does.
+  void select_scalar( float const* win, int32 count, int32 lanes, int32 dx0, int32 dy,
+                      float* best, float* worst, int32* hdisp, int32* vdisp ) {
+    for( int32 x = 0; x < count; ++x, win += LANES )
+      for( int32 l = 0; l < lanes; ++l ) {
+        if( win[l] < best[x] ) {
+          best[x] = win[l];
+          hdisp[x] = dx0 + l;
+          vdisp[x] = dy;
+        }
+        if( win[l] > worst[x] )
+          worst[x] = win[l];
+      }
+  }
+
+#if VW_COST_VOLUME_AVX2
+
+  // ---------------------------------------------------------------
+  // AVX2: the eight disparities of a pixel in one register.  No FMA,
+  // so the rounding matches the generic loops.
+  // ---------------------------------------------------------------
+
+#define VW_AVX2 __attribute__((target("avx2")))
+
+  struct AbsCostAvx2 {
+    VW_AVX2 static inline __m256 apply( __m256 l, __m256 r ) {
+      return _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), _mm256_sub_ps( l, r ) );
+    }
+    VW_AVX2 static inline __m256i apply( __m256i l, __m256i r ) {
+      return _mm256_abs_epi32( _mm256_sub_epi32( l, r ) );
+    }
+  };
+
+  struct SqCostAvx2 {
+    VW_AVX2 static inline __m256 apply( __m256 l, __m256 r ) {
+      __m256 d = _mm256_sub_ps( l, r );
+      return _mm256_mul_ps( d, d );
+    }
+  };
+
+  struct ProdCostAvx2 {
+    VW_AVX2 static inline __m256 apply( __m256 l, __m256 r ) { return _mm256_mul_ps( l, r ); }
+  };
+
+  // The bits set in each 32-bit lane of l ^ r: a table lookup of the
+  // count of each nibble, then the four bytes of each lane summed.
+  struct CensusDistanceCostAvx2 {
+    VW_AVX2 static inline __m256i apply( __m256i l, __m256i r ) {
+      const __m256i table = _mm256_setr_epi8( 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                              0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 );
+      const __m256i nibble = _mm256_set1_epi8( 0x0f );
+      __m256i v = _mm256_xor_si256( l, r );
+      __m256i bytes = _mm256_add_epi8( _mm256_shuffle_epi8( table, _mm256_and_si256( v, nibble ) ),
+                                       _mm256_shuffle_epi8( table, _mm256_and_si256( _mm256_srli_epi16( v, 4 ), nibble ) ) );
+      return _mm256_madd_epi16( _mm256_maddubs_epi16( bytes, _mm256_set1_epi8( 1 ) ), _mm256_set1_epi16( 1 ) );
+    }
+  };
+
+  template <class CostT> struct Avx2Cost {};
+  template <> struct Avx2Cost<AbsCost>  { typedef AbsCostAvx2 type; };
+  template <> struct Avx2Cost<SqCost>   { typedef SqCostAvx2 type; };
+  template <> struct Avx2Cost<ProdCost> { typedef ProdCostAvx2 type; };
+  template <> struct Avx2Cost<CensusDistanceCost> { typedef CensusDistanceCostAvx2 type; };
+
+  VW_AVX2 inline __m256i load8_epi32( uint8 const* s ) {
+    return _mm256_cvtepu8_epi32( _mm_loadl_epi64( (__m128i const*)s ) );
+  }
+
+  VW_AVX2 inline __m256i load8_epi32( uint16 const* s ) {
+    return _mm256_cvtepu16_epi32( _mm_loadu_si128( (__m128i const*)s ) );
+  }
+
+  VW_AVX2 inline __m256i load8_epi32( uint32 const* s ) {
+    return _mm256_loadu_si256( (__m256i const*)s );
+  }
+
+  template <class CostT, bool SubtractV>
+  VW_AVX2 void accumulate_avx2( float* colsum, float const* left, float const* right, int32 n ) {
+    typedef typename Avx2Cost<CostT>::type cost_type;
+    for( int32 x = 0; x < n; ++x, colsum += LANES ) {
+      __m256 c = cost_type::apply( _mm256_set1_ps( left[x] ), _mm256_loadu_ps( right+x ) );
+      __m256 s = _mm256_loadu_ps( colsum );
+      _mm256_storeu_ps( colsum, SubtractV ? _mm256_sub_ps( s, c ) : _mm256_add_ps( s, c ) );
+    }
+  }
+
+  template <class CostT, bool SubtractV, class ChannelT>
+  VW_AVX2 void accumulate_avx2( int32* colsum, ChannelT const* left, ChannelT const* right, int32 n ) {
+    typedef typename Avx2Cost<CostT>::type cost_type;
+    for( int32 x = 0; x < n; ++x, colsum += LANES ) {
+      __m256i c = cost_type::apply( _mm256_set1_epi32( left[x] ), load8_epi32( right+x ) );
+      __m256i s = _mm256_loadu_si256( (__m256i const*)colsum );
+      _mm256_storeu_si256( (__m256i*)colsum, SubtractV ? _mm256_sub_epi32( s, c ) : _mm256_add_epi32( s, c ) );
+    }
+  }
+
+  VW_AVX2 void window_sums_avx2( float const* colsum, int32 k, float* win, int32 count ) {
+    __m256 s = _mm256_setzero_ps();
+    for( int32 x = 0; x < k; ++x )
+      s = _mm256_add_ps( s, _mm256_loadu_ps( colsum + LANES*x ) );
+    for( int32 x = 0; x < count; ++x ) {
+      _mm256_storeu_ps( win + LANES*x, s );
+      s = _mm256_sub_ps( _mm256_add_ps( s, _mm256_loadu_ps( colsum + LANES*(x+k) ) ),
+                         _mm256_loadu_ps( colsum + LANES*x ) );
+    }
+  }
+
+  VW_AVX2 void window_sums_avx2( int32 const* colsum, int32 k, float* win, int32 count ) {
+    __m256i s = _mm256_setzero_si256();
+    for( int32 x = 0; x < k; ++x )
+      s = _mm256_add_epi32( s, _mm256_loadu_si256( (__m256i const*)(colsum + LANES*x) ) );
+    for( int32 x = 0; x < count; ++x ) {
+      _mm256_storeu_ps( win + LANES*x, _mm256_cvtepi32_ps( s ) );
+      s = _mm256_sub_epi32( _mm256_add_epi32( s, _mm256_loadu_si256( (__m256i const*)(colsum + LANES*(x+k)) ) ),
+                            _mm256_loadu_si256( (__m256i const*)(colsum + LANES*x) ) );
+    }
+  }
+
+  VW_AVX2 void ncc_avx2( float* win, int32 count, float scale,
+                         float const* left_mean, float const* left_precision,
+                         float const* right_mean, float const* right_precision ) {
+    __m256 vscale = _mm256_set1_ps( scale ), one = _mm256_set1_ps( 1.0f ), sign = _mm256_set1_ps( -0.0f );
+    for( int32 x = 0; x < count; ++x ) {
+      __m256 d = _mm256_sub_ps( _mm256_mul_ps( _mm256_loadu_ps( win + LANES*x ), vscale ),
+                                _mm256_mul_ps( _mm256_set1_ps( left_mean[x] ), _mm256_loadu_ps( right_mean+x ) ) );
+      __m256 c = _mm256_mul_ps( _mm256_mul_ps( _mm256_mul_ps( d, d ), _mm256_set1_ps( left_precision[x] ) ),
+                                _mm256_loadu_ps( right_precision+x ) );
+      _mm256_storeu_ps( win + LANES*x, _mm256_sub_ps( one, _mm256_andnot_ps( sign, c ) ) );
+    }
+  }
+
+  VW_AVX2 inline float hmin( __m256 v ) {
+    __m128 m = _mm_min_ps( _mm256_castps256_ps128( v ), _mm256_extractf128_ps( v, 1 ) );
+    m = _mm_min_ps( m, _mm_movehl_ps( m, m ) );
+    m = _mm_min_ss( m, _mm_shuffle_ps( m, m, 1 ) );
+    return _mm_cvtss_f32( m );
+  }
+
+  VW_AVX2 inline float hmax( __m256 v ) {
+    __m128 m = _mm_max_ps( _mm256_castps256_ps128( v ), _mm256_extractf128_ps( v, 1 ) );
+    m = _mm_max_ps( m, _mm_movehl_ps( m, m ) );
+    m = _mm_max_ss( m, _mm_shuffle_ps( m, m, 1 ) );
+    return _mm_cvtss_f32( m );
+  }
+
+  // The lanes past the last disparity, and costs that are NaN, never
+  // win, as NaN never compares less in the generic loop.  The first
+  // of the lanes holding the lowest cost is the lowest disparity.
+  VW_AVX2 void select_avx2( float const* win, int32 count, int32 lanes, int32 dx0, int32 dy,
+                            float* best, float* worst, int32* hdisp, int32* vdisp ) {
+    __m256 in_range = _mm256_castsi256_ps( _mm256_cmpgt_epi32( _mm256_set1_epi32( lanes ),
+                                                               _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ) ) );
+    __m256 highest = _mm256_set1_ps( ScalarTypeLimits<float>::highest() );
+    __m256 lowest = _mm256_set1_ps( ScalarTypeLimits<float>::lowest() );
+    for( int32 x = 0; x < count; ++x, win += LANES ) {
+      __m256 v = _mm256_loadu_ps( win );
+      __m256 ok = _mm256_and_ps( in_range, _mm256_cmp_ps( v, v, _CMP_ORD_Q ) );
+      __m256 vmin = _mm256_blendv_ps( highest, v, ok );
+      float m = hmin( vmin );
+      if( m < best[x] ) {
+        int mask = _mm256_movemask_ps( _mm256_and_ps( ok, _mm256_cmp_ps( vmin, _mm256_set1_ps( m ), _CMP_EQ_OQ ) ) );
+        best[x] = m;
+        hdisp[x] = dx0 + __builtin_ctz( mask );
+        vdisp[x] = dy;
+      }
+      float w = hmax( _mm256_blendv_ps( lowest, v, ok ) );
+      if( w > worst[x] )
+        worst[x] = w;
+    }
+  }
+
+#undef VW_AVX2
+
+  // AVX2 needs the CPU and an OS that saves the YMM registers on a
+  // context switch.
+  bool cpu_has_avx2() {
+    unsigned eax, ebx, ecx, edx;
+    if( ! __get_cpuid( 1, &eax, &ebx, &ecx, &edx ) ) return false;
+    const unsigned osxsave = 1u << 27, avx = 1u << 28;
+    if( (ecx & (osxsave | avx)) != (osxsave | avx) ) return false;
+    unsigned xcr0_lo, xcr0_hi;
+    __asm__ volatile( "xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0) );
+    if( (xcr0_lo & 6) != 6 ) return false;
+    if( __get_cpuid_max( 0, 0 ) < 7 ) return false;
+    __cpuid_count( 7, 0, eax, ebx, ecx, edx );
+    return ( ebx & (1u << 5) ) != 0;
+  }
+
+#endif // VW_COST_VOLUME_AVX2
+
+  // A function-local static is not thread-safe to initialize in C++03,
+  // but every thread computes the same value, so a race is harmless.
+  bool use_avx2() {
+#if VW_COST_VOLUME_AVX2
+    static bool result = cpu_has_avx2();
+    return result;
+#else
+    return false;
+#endif
+  }
+
+  template <class CostT, bool SubtractV, class ChannelT, class SumT>
+  inline void accumulate( SumT* colsum, ChannelT const* left, ChannelT const* right, int32 n ) {
+#if VW_COST_VOLUME_AVX2
+    if( use_avx2() ) { accumulate_avx2<CostT, SubtractV>( colsum, left, right, n ); return; }
+#endif
+    accumulate_scalar<CostT, SubtractV>( colsum, left, right, n );
+  }
+
+  template <class SumT>
+  inline void window_sums( SumT const* colsum, int32 k, float* win, int32 count ) {
+#if VW_COST_VOLUME_AVX2
+    if( use_avx2() ) { window_sums_avx2( colsum, k, win, count ); return; }
+#endif
+    window_sums_scalar( colsum, k, win, count );
+  }
+
+  inline void ncc( float* win, int32 count, float scale,
+                   float const* left_mean, float const* left_precision,
+                   float const* right_mean, float const* right_precision ) {
+#if VW_COST_VOLUME_AVX2
+    if( use_avx2() ) { ncc_avx2( win, count, scale, left_mean, left_precision, right_mean, right_precision ); return; }
+#endif
+    ncc_scalar( win, count, scale, left_mean, left_precision, right_mean, right_precision );
+  }
+
+  inline void select_best( float const* win, int32 count, int32 lanes, int32 dx0, int32 dy,
+                      float* best, float* worst, int32* hdisp, int32* vdisp ) {
+#if VW_COST_VOLUME_AVX2
+    if( use_avx2() ) { select_avx2( win, count, lanes, dx0, dy, best, worst, hdisp, vdisp ); return; }
+#endif
+    select_scalar( win, count, lanes, dx0, dy, best, worst, hdisp, vdisp );
+  }
+
+  // ---------------------------------------------------------------
+  // The cost volume
+  // ---------------------------------------------------------------
+
+  // The window means and precisions (inverse variances) that
+  // NormXCorrCost uses, at the window centers that its box filter
+  // fills, into arrays with the given row stride and offset.  The
+  // other entries stay zero.
+  void window_statistics( ImageView<float> const& image, int32 k,
+                          std::vector<float>& mean, std::vector<float>& precision,
+                          int32 stride, int32 offset ) {
+    SummedAreaTable<double> table( image, true );
+    double scale = 1.0 / (double(k) * k);
+    int32 half = k / 2;
+    for( int32 y = 0; y < image.rows() - k; ++y ) {
+      double const* top = &table.sums()(0, y), *bottom = &table.sums()(0, y + k);
+      double const* sq_top = &table.squares()(0, y), *sq_bottom = &table.squares()(0, y + k);
+      for( int32 x = 0; x < image.cols() - k; ++x ) {
+        float m = float( (bottom[x + k] - bottom[x] - top[x + k] + top[x]) * scale );
+        float sq = float( (sq_bottom[x + k] - sq_bottom[x] - sq_top[x + k] + sq_top[x]) * scale );
+        size_t i = offset + size_t(y + half) * stride + x + half;
+        mean[i] = m;
+        precision[i] = 1 / (sq - m * m);
+      }
+    }
+  }
+
+  template <class CostT, class ChannelT, class SumT>
+  ImageView<PixelMask<Vector2f> >
+  correlate_volume( ImageView<ChannelT> const& left, ImageView<ChannelT> const& right,
+                    BBox2i const& search_window, int32 kernel_size, bool normalized,
+                    ProgressCallback const& progress ) {
+    VW_ASSERT( left.cols() == right.cols() && left.rows() == right.rows(),
+               ArgumentErr() << "cost_volume_correlate: left and right images not the same size" );
+    VW_ASSERT( kernel_size > 0, ArgumentErr() << "cost_volume_correlate: the kernel size must be positive" );
+    const int32 width = left.cols(), height = left.rows();
+    const int32 k = kernel_size, half = kernel_size / 2;
+
+    // The region of the left image that StereoCostFunction correlates.
+    BBox2i bbox((search_window.max().x() < 0) ? (-search_window.max().x()) : 0,
+                (search_window.max().y() < 0) ? (-search_window.max().y()) : 0,
+                (search_window.min().x() < 0) ? width - abs(search_window.max().x()) : width - abs(search_window.min().x()),
+                (search_window.min().y() < 0) ? height - abs(search_window.max().y()) : height - abs(search_window.min().y()));
+
+    ImageView<PixelMask<Vector2f> > result( width, height );
+    for( int32 y = 0; y < height; ++y )
+      for( int32 x = 0; x < width; ++x )
+        invalidate( result(x,y) );
+
+    // The windows that StereoCostFunction's box filter fills.
+    const int32 count_x = bbox.width() - k, count_y = bbox.height() - k;
+    if( count_x <= 0 || count_y <= 0 ) {
+      progress.report_finished();
+      return result;
+    }
+
+    // The right image, zero-extended far enough for every disparity
+    // and the lanes past the last one.
+    const int32 pad_x = std::max( abs(search_window.min().x()), abs(search_window.max().x()) + LANES );
+    const int32 pad_y = std::max( abs(search_window.min().y()), abs(search_window.max().y()) );
+    ImageView<ChannelT> padded( width + 2*pad_x, height + 2*pad_y );
+    fill( padded, ChannelT() );
+    crop( padded, pad_x, pad_y, width, height ) = right;
+
+    std::vector<float> left_mean, left_precision, right_mean, right_precision;
+    if( normalized ) {
+      left_mean.resize( size_t(width) * height, 0 );
+      left_precision.resize( left_mean.size(), 0 );
+      window_statistics( ImageView<float>( channel_cast<float>( left ) ), k, left_mean, left_precision, width, 0 );
+      right_mean.resize( size_t(padded.cols()) * padded.rows(), 0 );
+      right_precision.resize( right_mean.size(), 0 );
+      window_statistics( ImageView<float>( channel_cast<float>( right ) ), k, right_mean, right_precision,
+                         padded.cols(), pad_y * padded.cols() + pad_x );
+    }
+    const float scale = float( 1.0 / (double(k) * k) );
+
+    std::vector<float> best( size_t(count_x) * count_y, ScalarTypeLimits<float>::highest() );
+    std::vector<float> worst( best.size(), ScalarTypeLimits<float>::lowest() );
+    std::vector<int32> hdisp( best.size(), 0 ), vdisp( best.size(), 0 );
+    std::vector<SumT> colsum( size_t(bbox.width()) * LANES );
+    std::vector<float> win( size_t(count_x) * LANES );
+
+    const int32 groups = (search_window.width() + LANES) / LANES;
+    int32 current_iteration = 0;
+    int32 total_iterations = (search_window.height() + 1) * groups;
+
+    for( int32 dy = search_window.min().y(); dy <= search_window.max().y(); ++dy ) {
+      for( int32 dx0 = search_window.min().x(); dx0 <= search_window.max().x(); dx0 += LANES ) {
+        const int32 lanes = std::min( LANES, search_window.max().x() - dx0 + 1 );
+        std::fill( colsum.begin(), colsum.end(), SumT(0) );
+
+        // Rows of the bbox, and the right rows they are compared with
+        ChannelT const* left_row = &left( bbox.min().x(), bbox.min().y() );
+        ChannelT const* right_row = &padded( bbox.min().x() + dx0 + pad_x, bbox.min().y() + dy + pad_y );
+        const ssize_t left_stride = left.cols(), right_stride = padded.cols();
+        for( int32 y = 0; y < k; ++y )
+          accumulate<CostT, false>( &colsum[0], left_row + y*left_stride, right_row + y*right_stride, bbox.width() );
+
+        for( int32 wy = 0; wy < count_y; ++wy ) {
+          if( wy > 0 ) {
+            accumulate<CostT, false>( &colsum[0], left_row + (wy+k-1)*left_stride, right_row + (wy+k-1)*right_stride, bbox.width() );
+            accumulate<CostT, true>( &colsum[0], left_row + (wy-1)*left_stride, right_row + (wy-1)*right_stride, bbox.width() );
+          }
+          window_sums( &colsum[0], k, &win[0], count_x );
+          if( normalized ) {
+            int32 cx = bbox.min().x() + half, cy = bbox.min().y() + wy + half;
+            size_t l = size_t(cy) * width + cx;
+            size_t r = size_t(cy + dy + pad_y) * padded.cols() + cx + dx0 + pad_x;
+            ncc( &win[0], count_x, scale, &left_mean[l], &left_precision[l], &right_mean[r], &right_precision[r] );
+          }
+          size_t row = size_t(wy) * count_x;
+          select_best( &win[0], count_x, lanes, dx0, dy, &best[row], &worst[row], &hdisp[row], &vdisp[row] );
+        }
+
+        progress.report_fractional_progress(++current_iteration, total_iterations);
+        progress.abort_if_requested();
+      }
+    }
+
+    for( int32 wy = 0; wy < count_y; ++wy )
+      for( int32 wx = 0; wx < count_x; ++wx ) {
+        size_t i = size_t(wy) * count_x + wx;
+        if( best[i] == ScalarTypeLimits<float>::highest() || best[i] == worst[i] )
+          continue;
+        PixelMask<Vector2f>& px = result( bbox.min().x() + half + wx, bbox.min().y() + half + wy );
+        px[0] = hdisp[i];
+        px[1] = vdisp[i];
+        validate( px );
+      }
+    progress.report_finished();
+    return result;
+  }
+
+  // Correlates the census transforms of two images.
+  template <class ChannelT>
+  ImageView<PixelMask<Vector2f> >
+  correlate_census( ImageView<ChannelT> const& left, ImageView<ChannelT> const& right,
+                    BBox2i const& search_window, int32 kernel_size,
+                    ProgressCallback const& progress ) {
+    return correlate_volume<CensusDistanceCost, uint32, int32>( census_transform( left ), census_transform( right ),
+                                                        search_window, kernel_size, false, progress );
+  }
+
+} // namespace
+
+ImageView<PixelMask<Vector2f> >
+vw::stereo::cost_volume_correlate( ImageView<float> const& left, ImageView<float> const& right,
+                                   BBox2i const& search_window, int32 kernel_size,
+                                   CorrelatorType type, ProgressCallback const& progress ) {
+  switch( type ) {
+  case ABS_DIFF_CORRELATOR:
+    return correlate_volume<AbsCost, float, float>( left, right, search_window, kernel_size, false, progress );
+  case SQR_DIFF_CORRELATOR:
+    return correlate_volume<SqCost, float, float>( left, right, search_window, kernel_size, false, progress );
+  case NORM_XCORR_CORRELATOR:
+    return correlate_volume<ProdCost, float, float>( left, right, search_window, kernel_size, true, progress );
+  case CENSUS_CORRELATOR:
+    return correlate_census( left, right, search_window, kernel_size, progress );
+  default:
+    vw_throw( ArgumentErr() << "cost_volume_correlate: unknown correlator type " << type << "." );
+  }
+  return ImageView<PixelMask<Vector2f> >();
+}
+
+ImageView<PixelMask<Vector2f> >
+vw::stereo::cost_volume_correlate( ImageView<uint8> const& left, ImageView<uint8> const& right,
+                                   BBox2i const& search_window, int32 kernel_size,
+                                   CorrelatorType type, ProgressCallback const& progress ) {
+  if( type == ABS_DIFF_CORRELATOR )
+    return correlate_volume<AbsCost, uint8, int32>( left, right, search_window, kernel_size, false, progress );
+  if( type == CENSUS_CORRELATOR )
+    return correlate_census( left, right, search_window, kernel_size, progress );
+  return cost_volume_correlate( ImageView<float>( channel_cast<float>( left ) ),
+                                ImageView<float>( channel_cast<float>( right ) ),
+                                search_window, kernel_size, type, progress );
+}
+
+ImageView<PixelMask<Vector2f> >
+vw::stereo::cost_volume_correlate( ImageView<uint16> const& left, ImageView<uint16> const& right,
+                                   BBox2i const& search_window, int32 kernel_size,
+                                   CorrelatorType type, ProgressCallback const& progress ) {
+  if( type == ABS_DIFF_CORRELATOR )
+    return correlate_volume<AbsCost, uint16, int32>( left, right, search_window, kernel_size, false, progress );
+  if( type == CENSUS_CORRELATOR )
+    return correlate_census( left, right, search_window, kernel_size, progress );
+  return cost_volume_correlate( ImageView<float>( channel_cast<float>( left ) ),
+                                ImageView<float>( channel_cast<float>( right ) ),
+                                search_window, kernel_size, type, progress );
+}
+
+const char* vw::stereo::cost_volume_isa() {
+  return use_avx2() ? "avx2" : "none";
+}
@@ -0,0 +1,183 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file CostVolumeCorrelator.h
+///
+/// A correlator that gives the same disparities as OptimizedCorrelator,
+/// but that works through the cost volume eight disparities at a time.
+///
+/// OptimizedCorrelator computes the cost image of each disparity in
+/// turn through a virtual StereoCostFunction, box filtering it with a
+/// summed-area table, and then compares the costs pixel by pixel.
+/// cost_volume_correlate() instead keeps, for each pixel of the row
+/// being filtered, a vector of the costs of eight horizontal
+/// disparities: a left pixel against the eight right pixels next to
+/// each other that it is compared with.  The box filter slides over
+/// those vectors, a row of windows and a column of windows at a time,
+/// and the best of the eight is picked with vector compares.  This
+/// uses AVX2 when the CPU has it, chosen at run time, and a plain loop
+/// otherwise.  Byte and 16-bit images are compared with integer sums
+/// for the absolute difference cost.  The census cost is always summed
+/// in integers, from the census transforms of the images in their own
+/// pixel type, so byte and 16-bit images can be correlated without
+/// ever being converted to float.
+///
+/// The cost functions are those of OptimizedCorrelator, over the same
+/// pixels, and ties go to the same disparity.  For integer-valued
+/// pixels the absolute and squared difference costs are exact in both,
+/// so the disparities are the same.  Normalized cross correlation is
+/// computed in float here, so it may differ where costs nearly tie, and
+/// right windows that run off the image score as uncorrelated.
+///
+#ifndef __VW_STEREO_COSTVOLUMECORRELATOR_H__
+#define __VW_STEREO_COSTVOLUMECORRELATOR_H__
+
+#include <vw/Core/ProgressCallback.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Stereo/Correlate.h>
+#include <vw/Stereo/OptimizedCorrelator.h>
+
+namespace vw {
+namespace stereo {
+
+  /// Finds the disparity within the search window of each pixel of the
+  /// left image that has the lowest cost, with the costs summed over a
+  /// kernel_size square window, as stereo::correlate() does with the
+  /// cost function of the given type.  Pixels whose costs are all the
+  /// same are invalid, as are those too near the edges for a window.
+  ImageView<PixelMask<Vector2f> >
+  cost_volume_correlate( ImageView<float> const& left, ImageView<float> const& right,
+                         BBox2i const& search_window, int32 kernel_size,
+                         CorrelatorType type = ABS_DIFF_CORRELATOR,
+                         ProgressCallback const& progress = ProgressCallback::dummy_instance() );
+
+  /// The same, comparing the pixels with integer sums for the absolute
+  /// difference and census costs.  Other costs are computed in float.
+  ImageView<PixelMask<Vector2f> >
+  cost_volume_correlate( ImageView<uint8> const& left, ImageView<uint8> const& right,
+                         BBox2i const& search_window, int32 kernel_size,
+                         CorrelatorType type = ABS_DIFF_CORRELATOR,
+                         ProgressCallback const& progress = ProgressCallback::dummy_instance() );
+
+  ImageView<PixelMask<Vector2f> >
+  cost_volume_correlate( ImageView<uint16> const& left, ImageView<uint16> const& right,
+                         BBox2i const& search_window, int32 kernel_size,
+                         CorrelatorType type = ABS_DIFF_CORRELATOR,
+                         ProgressCallback const& progress = ProgressCallback::dummy_instance() );
+
+  /// The same for images of other pixel types, which are converted to
+  /// float first.
+  template <class View1T, class View2T>
+  ImageView<PixelMask<Vector2f> >
+  cost_volume_correlate( ImageViewBase<View1T> const& left, ImageViewBase<View2T> const& right,
+                         BBox2i const& search_window, int32 kernel_size,
+                         CorrelatorType type = ABS_DIFF_CORRELATOR,
+                         ProgressCallback const& progress = ProgressCallback::dummy_instance() ) {
+    ImageView<float> left_float = channel_cast<float>( left.impl() );
+    ImageView<float> right_float = channel_cast<float>( right.impl() );
+    return cost_volume_correlate( left_float, right_float, search_window, kernel_size, type, progress );
+  }
+
+  /// The instruction set cost_volume_correlate() uses on this machine:
+  /// "avx2" or "none".
+  const char* cost_volume_isa();
+
+  /// A drop-in replacement for OptimizedCorrelator that correlates
+  /// with cost_volume_correlate().  Blurring the costs (cost_blur > 1)
+  /// is left to OptimizedCorrelator.
+  class CostVolumeCorrelator {
+
+    BBox2i m_search_window;
+    int32 m_kern_size;
+    float m_cross_correlation_threshold;
+    float m_corrscore_rejection_threshold;
+    int32 m_cost_blur;
+    stereo::CorrelatorType m_correlator_type;
+
+  public:
+
+    // See Correlate.h for CorrelatorType options.
+    CostVolumeCorrelator(BBox2i const& search_window,
+                         int32 const& kernel_size,
+                         float const& cross_correlation_threshold,
+                         float const& corrscore_rejection_threshold,
+                         int32 const& cost_blur = 1,
+                         stereo::CorrelatorType correlator_type = ABS_DIFF_CORRELATOR ) :
+      m_search_window(search_window),
+      m_kern_size(kernel_size),
+      m_cross_correlation_threshold(cross_correlation_threshold),
+      m_corrscore_rejection_threshold(corrscore_rejection_threshold),
+      m_cost_blur(cost_blur),
+      m_correlator_type(correlator_type) {}
+
+    template <class ViewT, class PreProcFilterT>
+    ImageView<PixelMask<Vector2f> > operator()(ImageViewBase<ViewT> const& image0,
+                                               ImageViewBase<ViewT> const& image1,
+                                               PreProcFilterT const& preproc_filter) {
+      if (m_cost_blur > 1) {
+        OptimizedCorrelator correlator(m_search_window, m_kern_size,
+                                       m_cross_correlation_threshold,
+                                       m_corrscore_rejection_threshold,
+                                       m_cost_blur, m_correlator_type);
+        return correlator(image0, image1, preproc_filter);
+      }
+
+      // Check to make sure that image0 and image1 have equal dimensions
+      if ((image0.impl().cols() != image1.impl().cols()) ||
+          (image0.impl().rows() != image1.impl().rows())) {
+        vw_throw( ArgumentErr() << "Primary and secondary image dimensions do not agree!" );
+      }
+
+      // Check to make sure that the images are single channel/single plane
+      if (!(image0.channels() == 1 && image0.impl().planes() == 1 &&
+            image1.channels() == 1 && image1.impl().planes() == 1)) {
+        vw_throw( ArgumentErr() << "Both images must be single channel/single plane images!" );
+      }
+
+      typedef typename PreProcFilterT::result_type preproc_type;
+      preproc_type left_image = preproc_filter(image0);
+      preproc_type right_image = preproc_filter(image1);
+      return (*this)(left_image, right_image);
+    }
+
+    /// Correlates the images as they are, without preprocessing, in
+    /// their own channel type: uint8 and uint16 images are compared
+    /// with integer sums for the absolute difference and census costs.
+    template <class ChannelT>
+    ImageView<PixelMask<Vector2f> > operator()(ImageView<ChannelT> const& image0,
+                                               ImageView<ChannelT> const& image1) {
+      if (m_cost_blur > 1) {
+        OptimizedCorrelator correlator(m_search_window, m_kern_size,
+                                       m_cross_correlation_threshold,
+                                       m_corrscore_rejection_threshold,
+                                       m_cost_blur, m_correlator_type);
+        return correlator(image0, image1, NullStereoPreprocessingFilter());
+      }
+
+      VW_ASSERT( image0.cols() == image1.cols() && image0.rows() == image1.rows(),
+                 ArgumentErr() << "Primary and secondary image dimensions do not agree!" );
+
+      BBox2i r2l_window(-m_search_window.max().x(), -m_search_window.max().y(),
+                        m_search_window.width(), m_search_window.height());
+
+      ImageView<PixelMask<Vector2f> > result_l2r =
+        cost_volume_correlate(image0, image1, m_search_window, m_kern_size, m_correlator_type);
+      ImageView<PixelMask<Vector2f> > result_r2l =
+        cost_volume_correlate(image1, image0, r2l_window, m_kern_size, m_correlator_type);
+
+      // Cross check the left and right disparity maps
+      cross_corr_consistency_check(result_l2r, result_r2l, m_cross_correlation_threshold, false);
+
+      return result_l2r;
+    }
+  };
+
+}}   // namespace vw::stereo
+
+#endif // __VW_STEREO_COSTVOLUMECORRELATOR_H__
@@ -9,6 +9,7 @@
 #define __VW_STEREO_DISPARITY_MAP_H__
 
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Thread.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/PerPixelViews.h>
@@ -18,6 +19,9 @@
 #include <vw/Image/Transform.h>
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/Statistics.h>
+#include <vw/Image/BlockProcessor.h>
+
+#include <fstream>
 
 // For the PixelDisparity math.
 #include <boost/operators.hpp>
@@ -49,6 +53,171 @@ namespace stereo {
                   accumulator.maximum());
   }
 
+  /// \cond INTERNAL
+  // Grows a shared range by the valid disparities of each block, on
+  // the pixels whose coordinates are multiples of the stride.  Once the
+  // range covers the limit the remaining blocks are skipped.
+  template <class ViewT>
+  class DisparityRangeFunc {
+    typedef typename ViewT::pixel_type pixel_type;
+
+    struct State {
+      Mutex mutex;
+      BBox2f range;
+      bool done;
+      State() : done(false) {}
+    };
+
+    ViewT const& m_view;
+    int32 m_stride;
+    BBox2f m_limit;
+    bool m_has_limit;
+    boost::shared_ptr<State> m_state;
+
+    int32 first_sample( int32 begin ) const {
+      return ( begin + m_stride - 1 ) / m_stride * m_stride;
+    }
+
+  public:
+    DisparityRangeFunc( ViewT const& view, int32 stride, BBox2f const& limit )
+      : m_view(view), m_stride(stride), m_limit(limit),
+        m_has_limit( limit.min().x() <= limit.max().x() && limit.min().y() <= limit.max().y() ),
+        m_state( new State ) {}
+
+    void operator()( BBox2i const& bbox ) const {
+      {
+        Mutex::Lock lock(m_state->mutex);
+        if ( m_state->done )
+          return;
+      }
+      ImageView<pixel_type> block = crop( m_view, bbox );
+      BBox2f range;
+      for ( int32 j = first_sample(bbox.min().y()); j < bbox.max().y(); j += m_stride )
+        for ( int32 i = first_sample(bbox.min().x()); i < bbox.max().x(); i += m_stride ) {
+          pixel_type const& pixel = block( i - bbox.min().x(), j - bbox.min().y() );
+          if ( is_valid( pixel ) )
+            range.grow( Vector2f( remove_mask( pixel ) ) );
+        }
+      if ( range.min().x() > range.max().x() )
+        return;
+      Mutex::Lock lock(m_state->mutex);
+      m_state->range.grow( range );
+      if ( m_has_limit && m_state->range.contains( m_limit ) )
+        m_state->done = true;
+    }
+
+    BBox2f range() const {
+      if ( m_state->range.min().x() > m_state->range.max().x() )
+        return BBox2f(0,0,0,0);
+      return m_state->range;
+    }
+  };
+  /// \endcond
+
+  /// The range of disparity values present in the disparity map,
+  /// found a block at a time on up to threads threads (0 for the
+  /// default number).  Each block is rasterized on its own, so a
+  /// procedural view (a CorrelatorView, say) is never rasterized in
+  /// full.  With a stride greater than one only every stride'th pixel
+  /// in each direction is sampled.  If limit is given, usually the
+  /// search range, the estimate stops as soon as the range covers it.
+  ///
+  /// For a quick bound, pass a low resolution level of the disparity
+  /// (from a pyramid correlation, say) and scale the result.
+  template <class ViewT>
+  BBox2f get_disparity_range(ImageViewBase<ViewT> const& disparity_map, Vector2i const& block_size,
+                             int32 stride = 1, BBox2f const& limit = BBox2f(), int32 threads = 0 ) {
+    VW_ASSERT( stride > 0 && block_size.x() > 0 && block_size.y() > 0,
+               ArgumentErr() << "get_disparity_range: block size and stride must be positive." );
+    DisparityRangeFunc<ViewT> func( disparity_map.impl(), stride, limit );
+    BlockProcessor<DisparityRangeFunc<ViewT> > process( func, block_size, threads );
+    process( bounding_box( disparity_map.impl() ) );
+    return func.range();
+  }
+
+  //  write_disparity_range() / read_disparity_range()
+  //
+  /// Keep a disparity range next to the disparity map it was found
+  /// from, so later stages need not scan the map again.  The range is
+  /// written, with the size of the map, to the text file
+  /// disparity_filename + ".range".  Reading returns false if there
+  /// is no such file or it was written for a map of another size.
+  inline std::string disparity_range_filename( std::string const& disparity_filename ) {
+    return disparity_filename + ".range";
+  }
+
+  inline void write_disparity_range( std::string const& disparity_filename,
+                                     Vector2i const& size, BBox2f const& range ) {
+    std::ofstream out( disparity_range_filename( disparity_filename ).c_str() );
+    if ( !out )
+      vw_throw( IOErr() << "write_disparity_range: could not open " << disparity_range_filename( disparity_filename ) );
+    out.precision( 9 );
+    out << size.x() << " " << size.y() << "\n"
+        << range.min().x() << " " << range.min().y() << " "
+        << range.max().x() << " " << range.max().y() << "\n";
+  }
+
+  inline bool read_disparity_range( std::string const& disparity_filename,
+                                    Vector2i const& size, BBox2f& range ) {
+    std::ifstream in( disparity_range_filename( disparity_filename ).c_str() );
+    Vector2i file_size;
+    Vector2f min, max;
+    if ( !( in >> file_size[0] >> file_size[1] >> min[0] >> min[1] >> max[0] >> max[1] ) )
+      return false;
+    if ( file_size != size )
+      return false;
+    range = BBox2f( min, max );
+    return true;
+  }
+
+  /// The range of the disparity map written to disparity_filename:
+  /// read from its range file if there is one for a map of this size,
+  /// and otherwise found with get_disparity_range() and written there.
+  template <class ViewT>
+  BBox2f cached_disparity_range( ImageViewBase<ViewT> const& disparity_map,
+                                 std::string const& disparity_filename,
+                                 Vector2i const& block_size = Vector2i(256,256),
+                                 int32 stride = 1 ) {
+    Vector2i size( disparity_map.impl().cols(), disparity_map.impl().rows() );
+    BBox2f range;
+    if ( read_disparity_range( disparity_filename, size, range ) )
+      return range;
+    range = get_disparity_range( disparity_map, block_size, stride );
+    write_disparity_range( disparity_filename, size, range );
+    return range;
+  }
+
+  //  search_range_seed()
+  //
+  /// Per-region search ranges for CorrelatorView::set_search_range_seed()
+  /// from a disparity map computed at 1/scale of the full resolution.
+  /// Each pixel of the result covers region_size by region_size pixels
+  /// of the coarse map, and holds the range of their valid disparities,
+  /// scaled to full resolution and grown by margin on every side.
+  /// Regions without a valid disparity hold BBox2i().
+  template <class ViewT>
+  ImageView<BBox2i> search_range_seed(ImageViewBase<ViewT> const& coarse_disparity,
+                                      int32 scale, int32 region_size, int32 margin) {
+    VW_ASSERT( scale > 0 && region_size > 0 && margin >= 0,
+               ArgumentErr() << "search_range_seed: scale and region size must be positive and margin must not be negative." );
+    ViewT const& disparity = coarse_disparity.impl();
+    ImageView<BBox2i> seed( (disparity.cols() + region_size - 1) / region_size,
+                            (disparity.rows() + region_size - 1) / region_size );
+    for ( int32 j = 0; j < disparity.rows(); ++j )
+      for ( int32 i = 0; i < disparity.cols(); ++i )
+        if ( is_valid( disparity(i,j) ) ) {
+          Vector2 d = Vector2( remove_mask( disparity(i,j) ) ) * scale;
+          BBox2i& range = seed( i / region_size, j / region_size );
+          range.grow( Vector2i( int32(floor(d[0])), int32(floor(d[1])) ) );
+          range.grow( Vector2i( int32(ceil(d[0])), int32(ceil(d[1])) ) );
+        }
+    for ( int32 j = 0; j < seed.rows(); ++j )
+      for ( int32 i = 0; i < seed.cols(); ++i )
+        if ( seed(i,j) != BBox2i() )
+          seed(i,j).expand( margin );
+    return seed;
+  }
+
   //  missing_pixel_image()
   //
   /// Produce a colorized image depicting which pixels in the disparity
@@ -263,6 +432,7 @@ namespace stereo {
     // RemoveOutliersFunc object and the original.
     struct RemoveOutliersState {
       int32 rejected_points, total_points;
+      Mutex mutex;
     };
 
     int32 m_half_h_kernel, m_half_v_kernel;
@@ -288,6 +458,14 @@ namespace stereo {
     int32 rejected_points() const { return m_state->rejected_points; }
     int32 total_points() const { return m_state->total_points; }
 
+    /// Adds the counts of a block of pixels, which may be cleaned on
+    /// any thread.
+    void add_points(int32 rejected, int32 total) const {
+      Mutex::Lock lock(m_state->mutex);
+      m_state->rejected_points += rejected;
+      m_state->total_points += total;
+    }
+
     BBox2i work_area() const { return BBox2i(Vector2i(-m_half_h_kernel, -m_half_v_kernel),
                                              Vector2i(m_half_h_kernel, m_half_v_kernel)); }
 
@@ -333,17 +511,122 @@ namespace stereo {
     return os;
   }
 
+  /// The view returned by remove_outliers(), with the pixels of
+  /// RemoveOutliersFunc.  Each block is cleaned from one rasterized
+  /// copy of its neighbourhood, so a chain of these views (as in
+  /// disparity_clean_up()) computes each stage once per block, rather
+  /// than once for every pixel of the next stage's kernel.  A running
+  /// count of the valid pixels in the kernel, kept as the kernel slides
+  /// along the rows, rejects pixels with too few valid neighbours
+  /// without looking at them, and the neighbours of the others are
+  /// only compared until the outcome is known.
+  template <class ViewT>
+  class RemoveOutliersView : public ImageViewBase<RemoveOutliersView<ViewT> > {
+  public:
+    typedef typename ViewT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<RemoveOutliersView> pixel_accessor;
+
+  private:
+    ViewT m_view;
+    RemoveOutliersFunc<pixel_type> m_func;
+
+  public:
+    RemoveOutliersView( ViewT const& view, RemoveOutliersFunc<pixel_type> const& func ) :
+      m_view(view), m_func(func) {}
+
+    inline int32 cols() const { return m_view.cols(); }
+    inline int32 rows() const { return m_view.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+    inline result_type operator()( int32 i, int32 j, int32 p=0 ) const {
+      return prerasterize( BBox2i(i,j,1,1) )(i,j,p);
+    }
+
+    ViewT const& child() const { return m_view; }
+    RemoveOutliersFunc<pixel_type> const& func() const { return m_func; }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      const int32 half_h = m_func.half_h_kernel(), half_v = m_func.half_v_kernel();
+      const int32 kernel_cols = 2*half_h+1, kernel_rows = 2*half_v+1;
+      const int32 total = kernel_cols * kernel_rows;
+      const float pixel_threshold = m_func.pixel_threshold();
+
+      BBox2i padded( bbox.min() - Vector2i(half_h, half_v), bbox.max() + Vector2i(half_h, half_v) );
+      ImageView<pixel_type> src = crop( edge_extend( m_view, ZeroEdgeExtension() ), padded );
+      ImageView<pixel_type> result( bbox.width(), bbox.height() );
+
+      // The fewest matches a pixel can have and stay, by the same
+      // float comparison as RemoveOutliersFunc.
+      int32 needed = 0;
+      while ( needed <= total && (float)needed/(float)total < m_func.rejection_threshold() )
+        ++needed;
+
+      // The number of valid pixels in each column of the kernel.
+      std::vector<int32> column_valid( src.cols(), 0 );
+      for ( int32 y = 0; y < kernel_rows - 1; ++y )
+        for ( int32 x = 0; x < src.cols(); ++x )
+          if ( is_valid( src(x,y) ) ) column_valid[x]++;
+
+      int32 rejected = 0;
+      for ( int32 y = 0; y < result.rows(); ++y ) {
+        // Slide the columns down to cover rows y to y+kernel_rows-1.
+        for ( int32 x = 0; x < src.cols(); ++x ) {
+          if ( is_valid( src(x,y+kernel_rows-1) ) ) column_valid[x]++;
+          if ( y > 0 && is_valid( src(x,y-1) ) ) column_valid[x]--;
+        }
+        int32 window_valid = 0;
+        for ( int32 x = 0; x < kernel_cols - 1; ++x )
+          window_valid += column_valid[x];
+
+        for ( int32 x = 0; x < result.cols(); ++x ) {
+          window_valid += column_valid[x+kernel_cols-1];
+          pixel_type const& center = src(x+half_h, y+half_v);
+          result(x,y) = center;
+          if ( is_valid(center) ) {
+            int32 matched = 0;
+            if ( window_valid >= needed ) {
+              for ( int32 yk = 0; yk < kernel_rows && matched < needed; ++yk ) {
+                pixel_type const* neighbor = &src(x, y+yk);
+                for ( int32 xk = 0; xk < kernel_cols; ++xk, ++neighbor )
+                  if ( is_valid(*neighbor) &&
+                       fabs(center[0]-(*neighbor)[0]) <= pixel_threshold &&
+                       fabs(center[1]-(*neighbor)[1]) <= pixel_threshold )
+                    matched++;
+              }
+            }
+            if ( matched < needed ) {
+              rejected++;
+              result(x,y) = pixel_type();  //Return invalid pixel
+            }
+          }
+          window_valid -= column_valid[x];
+        }
+      }
+      m_func.add_points( rejected, result.cols() * result.rows() );
+
+      return prerasterize_type( result, BBox2i( -bbox.min().x(), -bbox.min().y(), cols(), rows() ) );
+    }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+    /// \endcond
+  };
+
   template <class ViewT>
-  UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ZeroEdgeExtension>, RemoveOutliersFunc<typename ViewT::pixel_type> >
+  RemoveOutliersView<ViewT>
   remove_outliers(ImageViewBase<ViewT> const& disparity_map,
                   int32 half_h_kernel, int32 half_v_kernel,
                   double pixel_threshold,
                   double rejection_threshold) {
     typedef RemoveOutliersFunc<typename ViewT::pixel_type> func_type;
-    typedef UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ZeroEdgeExtension>, func_type > view_type;
-    return view_type(edge_extend(disparity_map.impl(), ZeroEdgeExtension()),
-                     func_type(half_h_kernel, half_v_kernel,
-                               pixel_threshold, rejection_threshold));
+    return RemoveOutliersView<ViewT>(disparity_map.impl(),
+                                     func_type(half_h_kernel, half_v_kernel,
+                                               pixel_threshold, rejection_threshold));
   }
 
 
@@ -359,10 +642,7 @@ namespace stereo {
   /// that must "match" the center pixel if that pixel is to be
   /// considered an inlier. ([0..1.0]).
   template <class ViewT>
-  inline UnaryPerPixelAccessorView< EdgeExtensionView< UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ZeroEdgeExtension>,
-                                                                                 RemoveOutliersFunc<typename ViewT::pixel_type> >,
-                                                       ZeroEdgeExtension>,
-                                    RemoveOutliersFunc<typename ViewT::pixel_type> >
+  inline RemoveOutliersView<RemoveOutliersView<ViewT> >
   disparity_clean_up(ImageViewBase<ViewT> const& disparity_map,
                      int32 h_half_kernel, int32 v_half_kernel,
                      double pixel_threshold, double rejection_threshold) {
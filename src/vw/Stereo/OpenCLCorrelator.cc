@@ -0,0 +1,681 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Stereo/OpenCLCorrelator.h>
+
+#if defined(VW_HAVE_PKG_OPENCL) && VW_HAVE_PKG_OPENCL==1
+
+#include <vw/Core/Thread.h>
+#include <vw/Core/Log.h>
+
+#include <cfloat>
+#include <cstdlib>
+#include <vector>
+
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+using namespace vw;
+using namespace vw::stereo;
+
+namespace {
+
+  // ---------------------------------------------------------------
+  // The device program.  The costs of a disparity are computed over
+  // the area of the left image whose right pixels stay inside the
+  // image for the whole search window (see StereoCostFunction), a
+  // bw x bh buffer whose origin is at (ox, oy) in the image.
+  // ---------------------------------------------------------------
+
+  const char* correlator_source =
+    "__kernel void init_scores(__global float* best, __global float* worst,\n"
+    "                          __global int2* disp, int n) {\n"
+    "  int i = get_global_id(0);\n"
+    "  if (i >= n) return;\n"
+    "  best[i] = FLT_MAX;\n"
+    "  worst[i] = -FLT_MAX;\n"
+    "  disp[i] = (int2)(0, 0);\n"
+    "}\n"
+    "\n"
+    "__kernel void init_neighbors(__global float* neighbors, int n) {\n"
+    "  int i = get_global_id(0);\n"
+    "  if (i >= n) return;\n"
+    "  neighbors[i] = NAN;\n"
+    "}\n"
+    "\n"
+    // mode 0: absolute difference, 1: squared difference, 2: the
+    // product, which box filters to the cross term of the NCC
+    "__kernel void pixel_costs(__global const float* left, __global const float* right,\n"
+    "                          __global float* cost, int cols, int rows, int ox, int oy,\n"
+    "                          int bw, int bh, int dx, int dy, int mode) {\n"
+    "  int x = get_global_id(0), y = get_global_id(1);\n"
+    "  if (x >= bw || y >= bh) return;\n"
+    "  float l = left[(oy+y)*cols + ox+x];\n"
+    "  int rx = ox+x+dx, ry = oy+y+dy;\n"
+    "  float r = (rx >= 0 && rx < cols && ry >= 0 && ry < rows) ? right[ry*cols + rx] : 0.0f;\n"
+    "  float c;\n"
+    "  if (mode == 0) c = fabs(l - r);\n"
+    "  else if (mode == 1) c = (l - r)*(l - r);\n"
+    "  else c = l*r;\n"
+    "  cost[y*bw + x] = c;\n"
+    "}\n"
+    "\n"
+    "__kernel void hamming_costs(__global const ulong* left, __global const ulong* right,\n"
+    "                            __global float* cost, int cols, int rows, int ox, int oy,\n"
+    "                            int bw, int bh, int dx, int dy) {\n"
+    "  int x = get_global_id(0), y = get_global_id(1);\n"
+    "  if (x >= bw || y >= bh) return;\n"
+    "  ulong l = left[(oy+y)*cols + ox+x];\n"
+    "  int rx = ox+x+dx, ry = oy+y+dy;\n"
+    "  ulong r = (rx >= 0 && rx < cols && ry >= 0 && ry < rows) ? right[ry*cols + rx] : 0;\n"
+    "  ulong v = l ^ r;\n"
+    "  v = v - ((v >> 1) & 0x5555555555555555UL);\n"
+    "  v = (v & 0x3333333333333333UL) + ((v >> 2) & 0x3333333333333333UL);\n"
+    "  cost[y*bw + x] = (float)((((v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FUL) * 0x0101010101010101UL) >> 56);\n"
+    "}\n"
+    "\n"
+    // The mean over the k wide window around each pixel, or 0 for the
+    // pixels too close to the edge for a whole window
+    "__kernel void box_rows(__global const float* in, __global float* out, int w, int h, int k) {\n"
+    "  int x = get_global_id(0), y = get_global_id(1);\n"
+    "  if (x >= w || y >= h) return;\n"
+    "  int x0 = x - k/2;\n"
+    "  float sum = 0.0f;\n"
+    "  if (x0 >= 0 && x0 + k < w) {\n"
+    "    for (int i = 0; i < k; i++) sum += in[y*w + x0 + i];\n"
+    "    sum /= k;\n"
+    "  }\n"
+    "  out[y*w + x] = sum;\n"
+    "}\n"
+    "\n"
+    "__kernel void box_cols(__global const float* in, __global float* out, int w, int h, int k) {\n"
+    "  int x = get_global_id(0), y = get_global_id(1);\n"
+    "  if (x >= w || y >= h) return;\n"
+    "  int y0 = y - k/2;\n"
+    "  float sum = 0.0f;\n"
+    "  if (y0 >= 0 && y0 + k < h) {\n"
+    "    for (int j = 0; j < k; j++) sum += in[(y0 + j)*w + x];\n"
+    "    sum /= k;\n"
+    "  }\n"
+    "  out[y*w + x] = sum;\n"
+    "}\n"
+    "\n"
+    // The mean and precision (1/variance) of the window around each
+    // pixel of the image, for the NCC
+    "__kernel void moments(__global const float* image, __global float* mean,\n"
+    "                      __global float* precision, int cols, int rows, int k) {\n"
+    "  int x = get_global_id(0), y = get_global_id(1);\n"
+    "  if (x >= cols || y >= rows) return;\n"
+    "  int x0 = x - k/2, y0 = y - k/2;\n"
+    "  float m = 0.0f, p = 0.0f;\n"
+    "  if (x0 >= 0 && x0 + k < cols && y0 >= 0 && y0 + k < rows) {\n"
+    "    float sum = 0.0f, sum2 = 0.0f;\n"
+    "    for (int j = 0; j < k; j++)\n"
+    "      for (int i = 0; i < k; i++) {\n"
+    "        float v = image[(y0 + j)*cols + x0 + i];\n"
+    "        sum += v;\n"
+    "        sum2 += v*v;\n"
+    "      }\n"
+    "    m = sum / (k*k);\n"
+    "    p = 1.0f / (sum2 / (k*k) - m*m);\n"
+    "  }\n"
+    "  mean[y*cols + x] = m;\n"
+    "  precision[y*cols + x] = p;\n"
+    "}\n"
+    "\n"
+    // Turns the box filtered products into the NCC cost of
+    // NormXCorrCost: near 0 where the windows correlate, 1 where not
+    "__kernel void ncc_costs(__global float* cost, __global const float* lmean,\n"
+    "                        __global const float* lprecision, __global const float* rmean,\n"
+    "                        __global const float* rprecision, int cols, int rows, int ox, int oy,\n"
+    "                        int bw, int bh, int dx, int dy, int k) {\n"
+    "  int x = get_global_id(0), y = get_global_id(1);\n"
+    "  if (x >= bw || y >= bh) return;\n"
+    "  int x0 = x - k/2, y0 = y - k/2;\n"
+    "  if (x0 < 0 || x0 + k >= bw || y0 < 0 || y0 + k >= bh) {\n"
+    "    cost[y*bw + x] = 0.0f;\n"
+    "    return;\n"
+    "  }\n"
+    "  int li = (oy+y)*cols + ox+x, ri = (oy+y+dy)*cols + ox+x+dx;\n"
+    "  float cov = cost[y*bw + x] - lmean[li]*rmean[ri];\n"
+    "  cost[y*bw + x] = 1.0f - fabs(cov*cov*lprecision[li]*rprecision[ri]);\n"
+    "}\n"
+    "\n"
+    "__kernel void update_best(__global const float* cost, __global float* best,\n"
+    "                          __global float* worst, __global int2* disp, int n, int dx, int dy) {\n"
+    "  int i = get_global_id(0);\n"
+    "  if (i >= n) return;\n"
+    "  float c = cost[i];\n"
+    "  if (c < best[i]) {\n"
+    "    best[i] = c;\n"
+    "    disp[i] = (int2)(dx, dy);\n"
+    "  }\n"
+    "  if (c > worst[i]) worst[i] = c;\n"
+    "}\n"
+    "\n"
+    // The costs of the 3x3 disparities around each pixel's best, in
+    // the order of subpixel_correlation_parabola(): column major, the
+    // best in the middle
+    "__kernel void gather_neighbors(__global const float* cost, __global const int2* disp,\n"
+    "                               __global float* neighbors, int n, int dx, int dy) {\n"
+    "  int i = get_global_id(0);\n"
+    "  if (i >= n) return;\n"
+    "  int ix = dx - disp[i].x + 1, iy = dy - disp[i].y + 1;\n"
+    "  if (ix < 0 || ix > 2 || iy < 0 || iy > 2) return;\n"
+    "  neighbors[9*i + 3*ix + iy] = cost[i];\n"
+    "}\n"
+    "\n"
+    "__constant float pinvA[54] = {\n"
+    "   1.0f/6,  1.0f/6,  1.0f/6, -1.0f/3, -1.0f/3, -1.0f/3,  1.0f/6,  1.0f/6,  1.0f/6,\n"
+    "   1.0f/6, -1.0f/3,  1.0f/6,  1.0f/6, -1.0f/3,  1.0f/6,  1.0f/6, -1.0f/3,  1.0f/6,\n"
+    "   1.0f/4,    0.0f, -1.0f/4,    0.0f,    0.0f,    0.0f, -1.0f/4,    0.0f,  1.0f/4,\n"
+    "  -1.0f/6, -1.0f/6, -1.0f/6,    0.0f,    0.0f,    0.0f,  1.0f/6,  1.0f/6,  1.0f/6,\n"
+    "  -1.0f/6,    0.0f,  1.0f/6, -1.0f/6,    0.0f,  1.0f/6, -1.0f/6,    0.0f,  1.0f/6,\n"
+    "  -1.0f/9,  2.0f/9, -1.0f/9,  2.0f/9,  5.0f/9,  2.0f/9, -1.0f/9,  2.0f/9, -1.0f/9 };\n"
+    "\n"
+    "float find_minimum(float lt, float mid, float rt) {\n"
+    "  float a = (rt + lt)*0.5f - mid;\n"
+    "  float b = (rt - lt)*0.5f;\n"
+    "  return -b/(2.0f*a);\n"
+    "}\n"
+    "\n"
+    // The subpixel offset of each pixel's best disparity, NAN where the
+    // fit fails
+    "__kernel void subpixel_parabola(__global const float* neighbors, __global float2* offsets,\n"
+    "                                int n, int horizontal, int vertical) {\n"
+    "  int i = get_global_id(0);\n"
+    "  if (i >= n) return;\n"
+    "  __global const float* p = neighbors + 9*i;\n"
+    "  float mid = p[4];\n"
+    "  float2 offset = (float2)(NAN, NAN);\n"
+    "  if (horizontal && !vertical) {\n"
+    "    float lt = p[1], rt = p[7];\n"
+    "    if ((mid <= lt && mid < rt) || (mid <= rt && mid < lt))\n"
+    "      offset = (float2)(find_minimum(lt, mid, rt), 0.0f);\n"
+    "  } else if (vertical && !horizontal) {\n"
+    "    float up = p[3], dn = p[5];\n"
+    "    if ((mid <= up && mid < dn) || (mid <= dn && mid < up))\n"
+    "      offset = (float2)(0.0f, find_minimum(up, mid, dn));\n"
+    "  } else if (horizontal && vertical) {\n"
+    "    bool same = true, missing = false;\n"
+    "    for (int j = 0; j < 9; j++) {\n"
+    "      same = same && p[j] == p[0];\n"
+    "      missing = missing || isnan(p[j]);\n"
+    "    }\n"
+    "    if (!missing && same) {\n"
+    "      offset = (float2)(0.0f, 0.0f);\n"
+    "    } else if (!missing) {\n"
+    "      float c[6];\n"
+    "      for (int r = 0; r < 6; r++) {\n"
+    "        c[r] = 0.0f;\n"
+    "        for (int j = 0; j < 9; j++) c[r] += pinvA[9*r + j]*p[j];\n"
+    "      }\n"
+    "      float denom = 4*c[0]*c[1] - c[2]*c[2];\n"
+    "      offset = (float2)((c[2]*c[4] - 2*c[1]*c[3]) / denom, (c[2]*c[3] - 2*c[0]*c[4]) / denom);\n"
+    "      if (!(length(offset) < 5.0f)) offset = (float2)(NAN, NAN);\n"
+    "    }\n"
+    "  } else {\n"
+    "    offset = (float2)(0.0f, 0.0f);\n"
+    "  }\n"
+    "  offsets[i] = offset;\n"
+    "}\n";
+
+  // ---------------------------------------------------------------
+  // The device, context and built program, shared by all correlators
+  // ---------------------------------------------------------------
+
+  struct CorrelatorDevice {
+    bool ok;
+    cl_device_id device;
+    cl_context context;
+    cl_program program;
+    CorrelatorDevice() : ok(false), device(0), context(0), program(0) {}
+  };
+
+  vw::RunOnce device_once = VW_RUNONCE_INIT;
+  CorrelatorDevice* device_ptr = 0;
+
+  // Picks the first GPU of any platform, or failing that the first
+  // device of any kind.
+  void init_device() {
+    device_ptr = new CorrelatorDevice();
+    CorrelatorDevice& dev = *device_ptr;
+
+    cl_uint num_platforms = 0;
+    if (clGetPlatformIDs(0, NULL, &num_platforms) != CL_SUCCESS || num_platforms == 0) {
+      vw_out(DebugMessage, "stereo") << "OpenCLCorrelator: no OpenCL platforms found.\n";
+      return;
+    }
+    std::vector<cl_platform_id> platforms(num_platforms);
+    clGetPlatformIDs(num_platforms, &platforms[0], NULL);
+    bool found = false;
+    for (int pass = 0; pass < 2 && !found; ++pass) {
+      cl_device_type type = pass == 0 ? CL_DEVICE_TYPE_GPU : CL_DEVICE_TYPE_ALL;
+      for (cl_uint p = 0; p < num_platforms && !found; ++p)
+        found = clGetDeviceIDs(platforms[p], type, 1, &dev.device, NULL) == CL_SUCCESS;
+    }
+    if (!found) {
+      vw_out(DebugMessage, "stereo") << "OpenCLCorrelator: no OpenCL devices found.\n";
+      return;
+    }
+
+    cl_int err;
+    dev.context = clCreateContext(NULL, 1, &dev.device, NULL, NULL, &err);
+    if (err != CL_SUCCESS) {
+      vw_out(WarningMessage, "stereo") << "OpenCLCorrelator: failed to create a context (error " << err << ").\n";
+      return;
+    }
+    dev.program = clCreateProgramWithSource(dev.context, 1, &correlator_source, NULL, &err);
+    if (err == CL_SUCCESS)
+      err = clBuildProgram(dev.program, 1, &dev.device, NULL, NULL, NULL);
+    if (err != CL_SUCCESS) {
+      size_t log_size = 0;
+      clGetProgramBuildInfo(dev.program, dev.device, CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size);
+      std::vector<char> build_log(log_size + 1, 0);
+      if (log_size)
+        clGetProgramBuildInfo(dev.program, dev.device, CL_PROGRAM_BUILD_LOG, log_size, &build_log[0], NULL);
+      vw_out(WarningMessage, "stereo") << "OpenCLCorrelator: failed to build the device program:\n"
+                                       << &build_log[0] << "\n";
+      return;
+    }
+
+    char name[256] = "";
+    clGetDeviceInfo(dev.device, CL_DEVICE_NAME, sizeof(name) - 1, name, NULL);
+    vw_out(DebugMessage, "stereo") << "OpenCLCorrelator: correlating on " << name << ".\n";
+    dev.ok = true;
+  }
+
+  CorrelatorDevice& correlator_device() {
+    device_once.run( init_device );
+    return *device_ptr;
+  }
+
+  void check_cl(cl_int err, const char* what) {
+    if (err != CL_SUCCESS)
+      vw_throw( IOErr() << "OpenCLCorrelator: " << what << " failed (error " << err << ")." );
+  }
+
+  // A device buffer, released with its owner
+  class DeviceBuffer {
+    cl_mem m_mem;
+    DeviceBuffer(DeviceBuffer const&);
+    DeviceBuffer& operator=(DeviceBuffer const&);
+  public:
+    DeviceBuffer() : m_mem(0) {}
+    ~DeviceBuffer() { if (m_mem) clReleaseMemObject(m_mem); }
+    void allocate(size_t bytes) {
+      cl_int err;
+      if (m_mem) clReleaseMemObject(m_mem);
+      m_mem = clCreateBuffer(correlator_device().context, CL_MEM_READ_WRITE, bytes, NULL, &err);
+      check_cl(err, "allocating a device buffer");
+    }
+    cl_mem const& mem() const { return m_mem; }
+  };
+
+  // The kernels of one pass, created from the shared program: kernel
+  // arguments are per kernel object, so passes cannot share them.
+  class Kernel {
+    cl_kernel m_kernel;
+    cl_uint m_arg;
+    Kernel(Kernel const&);
+    Kernel& operator=(Kernel const&);
+  public:
+    Kernel(const char* name) : m_kernel(0), m_arg(0) {
+      cl_int err;
+      m_kernel = clCreateKernel(correlator_device().program, name, &err);
+      check_cl(err, name);
+    }
+    ~Kernel() { if (m_kernel) clReleaseKernel(m_kernel); }
+
+    Kernel& operator<<(DeviceBuffer const& buffer) {
+      clSetKernelArg(m_kernel, m_arg++, sizeof(cl_mem), &buffer.mem());
+      return *this;
+    }
+    Kernel& operator<<(cl_mem const& mem) {
+      clSetKernelArg(m_kernel, m_arg++, sizeof(cl_mem), &mem);
+      return *this;
+    }
+    Kernel& operator<<(cl_int value) {
+      clSetKernelArg(m_kernel, m_arg++, sizeof(cl_int), &value);
+      return *this;
+    }
+
+    // Sets the arguments from the first on again
+    Kernel& args() { m_arg = 0; return *this; }
+
+    void run(cl_command_queue queue, size_t width, size_t height = 1,
+             std::vector<cl_event> const& wait = std::vector<cl_event>()) {
+      size_t global[2] = { width, height };
+      check_cl(clEnqueueNDRangeKernel(queue, m_kernel, height > 1 ? 2 : 1, NULL, global, NULL,
+                                      cl_uint(wait.size()), wait.empty() ? NULL : &wait[0], NULL),
+               "running a kernel");
+    }
+  };
+
+  // The area of left pixels that have costs for every disparity in the
+  // search window, as StereoCostFunction computes it.
+  BBox2i cost_bbox(int32 width, int32 height, BBox2i const& search_window) {
+    return BBox2i((search_window.max().x() < 0) ? (-search_window.max().x()) : 0,
+                  (search_window.max().y() < 0) ? (-search_window.max().y()) : 0,
+                  (search_window.min().x() < 0) ? width - abs(search_window.max().x()) : width - abs(search_window.min().x()),
+                  (search_window.min().y() < 0) ? height - abs(search_window.max().y()) : height - abs(search_window.min().y()));
+  }
+
+} // namespace
+
+
+// ---------------------------------------------------------------
+// A tile: both images on the device, and a pass of the search in
+// each direction, each on its own command queue.
+// ---------------------------------------------------------------
+
+class vw::stereo::OpenCLCorrelator::Tile {
+public:
+  struct Pass {
+    cl_command_queue queue;
+    BBox2i window, bbox;
+    DeviceBuffer cost, temp, best, worst, disp, neighbors, offsets;
+    DeviceBuffer left_mean, left_precision, right_mean, right_precision;
+    Kernel init_scores, pixel_costs, hamming_costs, box_rows, box_cols, moments, ncc_costs, update_best;
+    Kernel init_neighbors, gather_neighbors, subpixel_parabola;
+    std::vector<float> host_best, host_worst;
+    std::vector<cl_int> host_disp;
+
+    Pass() : queue(0), init_scores("init_scores"), pixel_costs("pixel_costs"),
+             hamming_costs("hamming_costs"), box_rows("box_rows"), box_cols("box_cols"),
+             moments("moments"), ncc_costs("ncc_costs"), update_best("update_best"),
+             init_neighbors("init_neighbors"), gather_neighbors("gather_neighbors"),
+             subpixel_parabola("subpixel_parabola") {
+      cl_int err;
+      queue = clCreateCommandQueue(correlator_device().context, correlator_device().device, 0, &err);
+      check_cl(err, "creating a command queue");
+    }
+    ~Pass() { if (queue) clReleaseCommandQueue(queue); }
+  };
+
+  int32 cols, rows;
+  bool codes;                              // the images are census codes
+  DeviceBuffer image[2];
+  ImageView<float> host_image[2];          // kept until the uploads finish
+  ImageView<uint64> host_codes[2];
+  std::vector<cl_event> uploaded;
+  Pass pass[2];                            // left to right, right to left
+
+  Tile(int32 cols, int32 rows) : cols(cols), rows(rows), codes(false) {}
+
+  // Enqueues the cost pipeline of one disparity
+  void enqueue_costs(Pass& pass, cl_mem left, cl_mem right, int32 dx, int32 dy, int32 kern_size,
+                     int32 cost_blur, CorrelatorType type, std::vector<cl_event> const& wait);
+  // Enqueues the search of a pass over its window, from image side
+  void enqueue_search(Pass& pass, int side, int32 kern_size, int32 cost_blur, CorrelatorType type);
+  ImageView<PixelMask<Vector2f> > best_disparities(Pass const& pass) const;
+  std::vector<float> subpixel_offsets(Pass& pass, ImageView<PixelMask<Vector2f> > const& disparity,
+                                      int32 kern_size, int32 cost_blur, CorrelatorType type);
+
+  ~Tile() {
+    for (size_t i = 0; i < uploaded.size(); ++i)
+      clReleaseEvent(uploaded[i]);
+  }
+};
+
+// Enqueues the cost pipeline of one disparity, leaving the costs in
+// pass.cost: the pixel costs, their box filter over the kernel, the
+// NCC of the box filtered products, and the box filter over the blur.
+void OpenCLCorrelator::Tile::enqueue_costs(Pass& pass, cl_mem left, cl_mem right,
+                                           int32 dx, int32 dy, int32 kern_size, int32 cost_blur,
+                                           CorrelatorType type, std::vector<cl_event> const& wait) {
+  const cl_int bw = pass.bbox.width(), bh = pass.bbox.height();
+  const cl_int ox = pass.bbox.min().x(), oy = pass.bbox.min().y();
+  if (codes) {
+    pass.hamming_costs.args() << left << right << pass.cost << cl_int(cols) << cl_int(rows)
+                              << ox << oy << bw << bh << cl_int(dx) << cl_int(dy);
+    pass.hamming_costs.run(pass.queue, bw, bh, wait);
+  } else {
+    cl_int mode = type == SQR_DIFF_CORRELATOR ? 1 : type == NORM_XCORR_CORRELATOR ? 2 : 0;
+    pass.pixel_costs.args() << left << right << pass.cost << cl_int(cols) << cl_int(rows)
+                            << ox << oy << bw << bh << cl_int(dx) << cl_int(dy) << mode;
+    pass.pixel_costs.run(pass.queue, bw, bh, wait);
+  }
+  pass.box_rows.args() << pass.cost << pass.temp << bw << bh << cl_int(kern_size);
+  pass.box_rows.run(pass.queue, bw, bh);
+  pass.box_cols.args() << pass.temp << pass.cost << bw << bh << cl_int(kern_size);
+  pass.box_cols.run(pass.queue, bw, bh);
+  if (!codes && type == NORM_XCORR_CORRELATOR) {
+    pass.ncc_costs.args() << pass.cost << pass.left_mean << pass.left_precision
+                          << pass.right_mean << pass.right_precision << cl_int(cols) << cl_int(rows)
+                          << ox << oy << bw << bh << cl_int(dx) << cl_int(dy) << cl_int(kern_size);
+    pass.ncc_costs.run(pass.queue, bw, bh);
+  }
+  if (cost_blur > 1) {
+    pass.box_rows.args() << pass.cost << pass.temp << bw << bh << cl_int(cost_blur);
+    pass.box_rows.run(pass.queue, bw, bh);
+    pass.box_cols.args() << pass.temp << pass.cost << bw << bh << cl_int(cost_blur);
+    pass.box_cols.run(pass.queue, bw, bh);
+  }
+}
+
+// Enqueues the whole search of a pass, and the read back of its
+// results, without waiting for any of it.
+void OpenCLCorrelator::Tile::enqueue_search(Pass& pass, int side, int32 kern_size,
+                                            int32 cost_blur, CorrelatorType type) {
+  const cl_int n = pass.bbox.width() * pass.bbox.height();
+  cl_mem left = image[side].mem(), right = image[1 - side].mem();
+  pass.cost.allocate(sizeof(float) * n);
+  pass.temp.allocate(sizeof(float) * n);
+  pass.best.allocate(sizeof(float) * n);
+  pass.worst.allocate(sizeof(float) * n);
+  pass.disp.allocate(2 * sizeof(cl_int) * n);
+
+  // Nothing runs before both images are on the device
+  pass.init_scores.args() << pass.best << pass.worst << pass.disp << n;
+  pass.init_scores.run(pass.queue, n, 1, uploaded);
+  if (!codes && type == NORM_XCORR_CORRELATOR) {
+    const size_t image_size = sizeof(float) * cols * rows;
+    pass.left_mean.allocate(image_size);
+    pass.left_precision.allocate(image_size);
+    pass.right_mean.allocate(image_size);
+    pass.right_precision.allocate(image_size);
+    pass.moments.args() << left << pass.left_mean << pass.left_precision
+                        << cl_int(cols) << cl_int(rows) << cl_int(kern_size);
+    pass.moments.run(pass.queue, cols, rows);
+    pass.moments.args() << right << pass.right_mean << pass.right_precision
+                        << cl_int(cols) << cl_int(rows) << cl_int(kern_size);
+    pass.moments.run(pass.queue, cols, rows);
+  }
+
+  for (int32 dy = pass.window.min().y(); dy <= pass.window.max().y(); dy++) {
+    for (int32 dx = pass.window.min().x(); dx <= pass.window.max().x(); dx++) {
+      enqueue_costs(pass, left, right, dx, dy, kern_size, cost_blur, type, std::vector<cl_event>());
+      pass.update_best.args() << pass.cost << pass.best << pass.worst << pass.disp
+                              << n << cl_int(dx) << cl_int(dy);
+      pass.update_best.run(pass.queue, n);
+    }
+  }
+
+  pass.host_best.resize(n);
+  pass.host_worst.resize(n);
+  pass.host_disp.resize(2 * n);
+  check_cl(clEnqueueReadBuffer(pass.queue, pass.best.mem(), CL_FALSE, 0, sizeof(float) * n,
+                               &pass.host_best[0], 0, NULL, NULL), "reading back the costs");
+  check_cl(clEnqueueReadBuffer(pass.queue, pass.worst.mem(), CL_FALSE, 0, sizeof(float) * n,
+                               &pass.host_worst[0], 0, NULL, NULL), "reading back the costs");
+  check_cl(clEnqueueReadBuffer(pass.queue, pass.disp.mem(), CL_FALSE, 0, 2 * sizeof(cl_int) * n,
+                               &pass.host_disp[0], 0, NULL, NULL), "reading back the disparities");
+  clFlush(pass.queue);
+}
+
+// Converts the best scores of a finished pass to disparities; pixels
+// whose costs were all the same, or that had none, are invalid.
+ImageView<PixelMask<Vector2f> >
+OpenCLCorrelator::Tile::best_disparities(Pass const& pass) const {
+  ImageView<PixelMask<Vector2f> > result(cols, rows);
+  const int32 bw = pass.bbox.width();
+  for (int32 y = 0; y < pass.bbox.height(); ++y) {
+    for (int32 x = 0; x < bw; ++x) {
+      const int32 i = y * bw + x;
+      PixelMask<Vector2f>& pixel = result(pass.bbox.min().x() + x, pass.bbox.min().y() + y);
+      if (pass.host_best[i] == FLT_MAX || pass.host_best[i] == pass.host_worst[i])
+        continue;
+      pixel[0] = pass.host_disp[2*i];
+      pixel[1] = pass.host_disp[2*i+1];
+      validate(pixel);
+    }
+  }
+  return result;
+}
+
+// The subpixel offsets of the best disparities of the left to right
+// pass, NAN where the fit failed.  The costs around each pixel's best
+// are recomputed in a second sweep over just the disparities next to
+// some valid pixel's best.
+std::vector<float>
+OpenCLCorrelator::Tile::subpixel_offsets(Pass& pass, ImageView<PixelMask<Vector2f> > const& disparity,
+                                         int32 kern_size, int32 cost_blur, CorrelatorType type) {
+  const cl_int n = pass.bbox.width() * pass.bbox.height();
+  const int32 ww = pass.window.width() + 1, wh = pass.window.height() + 1;
+  std::vector<bool> needed(ww * wh, false);
+  for (int32 i = 0; i < n; ++i) {
+    if (!is_valid(disparity(pass.bbox.min().x() + i % pass.bbox.width(),
+                            pass.bbox.min().y() + i / pass.bbox.width())))
+      continue;
+    const int32 bx = pass.host_disp[2*i] - pass.window.min().x();
+    const int32 by = pass.host_disp[2*i+1] - pass.window.min().y();
+    for (int32 j = std::max(by - 1, 0); j <= std::min(by + 1, wh - 1); ++j)
+      for (int32 k = std::max(bx - 1, 0); k <= std::min(bx + 1, ww - 1); ++k)
+        needed[j * ww + k] = true;
+  }
+
+  pass.neighbors.allocate(9 * sizeof(float) * n);
+  pass.offsets.allocate(2 * sizeof(float) * n);
+  pass.init_neighbors.args() << pass.neighbors << cl_int(9 * n);
+  pass.init_neighbors.run(pass.queue, 9 * n);
+  cl_mem left = image[0].mem(), right = image[1].mem();
+  for (int32 j = 0; j < wh; ++j) {
+    for (int32 k = 0; k < ww; ++k) {
+      if (!needed[j * ww + k])
+        continue;
+      const int32 dx = pass.window.min().x() + k, dy = pass.window.min().y() + j;
+      enqueue_costs(pass, left, right, dx, dy, kern_size, cost_blur, type, std::vector<cl_event>());
+      pass.gather_neighbors.args() << pass.cost << pass.disp << pass.neighbors
+                                   << n << cl_int(dx) << cl_int(dy);
+      pass.gather_neighbors.run(pass.queue, n);
+    }
+  }
+  pass.subpixel_parabola.args() << pass.neighbors << pass.offsets << n
+                                << cl_int(pass.window.width() > 0) << cl_int(pass.window.height() > 0);
+  pass.subpixel_parabola.run(pass.queue, n);
+
+  std::vector<float> offsets(2 * n);
+  check_cl(clEnqueueReadBuffer(pass.queue, pass.offsets.mem(), CL_TRUE, 0, 2 * sizeof(float) * n,
+                               &offsets[0], 0, NULL, NULL), "reading back the subpixel offsets");
+  return offsets;
+}
+
+bool OpenCLCorrelator::available() {
+  return correlator_device().ok;
+}
+
+boost::shared_ptr<OpenCLCorrelator::Tile>
+OpenCLCorrelator::begin_tile(int32 cols, int32 rows) const {
+  if (!available())
+    vw_throw( NoImplErr() << "OpenCLCorrelator: no OpenCL device is available." );
+  return boost::shared_ptr<Tile>(new Tile(cols, rows));
+}
+
+void OpenCLCorrelator::upload(Tile& tile, int side, ImageView<float> const& image) const {
+  // The census cost compares census codes, which are quicker to make
+  // here, while the other image is on its way, than on the device
+  if (m_correlator_type == CENSUS_CORRELATOR) {
+    upload(tile, side, census_transform(image));
+    return;
+  }
+  tile.host_image[side] = image;
+  tile.image[side].allocate(sizeof(float) * image.cols() * image.rows());
+  cl_event event;
+  check_cl(clEnqueueWriteBuffer(tile.pass[side].queue, tile.image[side].mem(), CL_FALSE, 0,
+                                sizeof(float) * image.cols() * image.rows(), &tile.host_image[side](0,0),
+                                0, NULL, &event),
+           "uploading an image");
+  tile.uploaded.push_back(event);
+  clFlush(tile.pass[side].queue);
+}
+
+void OpenCLCorrelator::upload(Tile& tile, int side, ImageView<uint32> const& image) const {
+  ImageView<uint64> codes(image.cols(), image.rows());
+  for (int32 y = 0; y < image.rows(); ++y)
+    for (int32 x = 0; x < image.cols(); ++x)
+      codes(x,y) = image(x,y);
+  upload(tile, side, codes);
+}
+
+void OpenCLCorrelator::upload(Tile& tile, int side, ImageView<uint64> const& image) const {
+  tile.codes = true;
+  tile.host_codes[side] = image;
+  tile.image[side].allocate(sizeof(uint64) * image.cols() * image.rows());
+  cl_event event;
+  check_cl(clEnqueueWriteBuffer(tile.pass[side].queue, tile.image[side].mem(), CL_FALSE, 0,
+                                sizeof(uint64) * image.cols() * image.rows(), &tile.host_codes[side](0,0),
+                                0, NULL, &event),
+           "uploading an image");
+  tile.uploaded.push_back(event);
+  clFlush(tile.pass[side].queue);
+}
+
+ImageView<PixelMask<Vector2f> >
+OpenCLCorrelator::finish_tile(Tile& tile) const {
+  VW_ASSERT( tile.uploaded.size() == 2, LogicErr() << "OpenCLCorrelator: both images must be uploaded." );
+
+  Tile::Pass& l2r = tile.pass[0];
+  Tile::Pass& r2l = tile.pass[1];
+  l2r.window = m_search_window;
+  r2l.window = BBox2i(-m_search_window.max().x(), -m_search_window.max().y(),
+                      m_search_window.width(), m_search_window.height());
+  l2r.bbox = cost_bbox(tile.cols, tile.rows, l2r.window);
+  r2l.bbox = cost_bbox(tile.cols, tile.rows, r2l.window);
+  if (l2r.bbox.empty() || r2l.bbox.empty())
+    return ImageView<PixelMask<Vector2f> >(tile.cols, tile.rows);
+
+  // Both passes run on the device at once
+  tile.enqueue_search(l2r, 0, m_kern_size, m_cost_blur, m_correlator_type);
+  tile.enqueue_search(r2l, 1, m_kern_size, m_cost_blur, m_correlator_type);
+
+  check_cl(clFinish(l2r.queue), "correlating");
+  ImageView<PixelMask<Vector2f> > result_l2r = tile.best_disparities(l2r);
+
+  // The subpixel sweep goes on while the right to left pass finishes
+  std::vector<float> offsets;
+  if (m_subpixel)
+    offsets = tile.subpixel_offsets(l2r, result_l2r, m_kern_size, m_cost_blur, m_correlator_type);
+
+  check_cl(clFinish(r2l.queue), "correlating");
+  ImageView<PixelMask<Vector2f> > result_r2l = tile.best_disparities(r2l);
+  cross_corr_consistency_check(result_l2r, result_r2l, m_cross_correlation_threshold, false);
+
+  if (m_subpixel) {
+    const int32 bw = l2r.bbox.width();
+    for (int32 y = 0; y < l2r.bbox.height(); ++y) {
+      for (int32 x = 0; x < bw; ++x) {
+        PixelMask<Vector2f>& pixel = result_l2r(l2r.bbox.min().x() + x, l2r.bbox.min().y() + y);
+        if (!is_valid(pixel))
+          continue;
+        const float ox = offsets[2*(y*bw + x)], oy = offsets[2*(y*bw + x)+1];
+        if (ox != ox || oy != oy) {
+          invalidate(pixel);
+        } else {
+          pixel[0] += ox;
+          pixel[1] += oy;
+        }
+      }
+    }
+  }
+  return result_l2r;
+}
+
+#endif // VW_HAVE_PKG_OPENCL
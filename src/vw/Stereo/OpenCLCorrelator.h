@@ -0,0 +1,141 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file OpenCLCorrelator.h
+///
+/// The cost volume search of OptimizedCorrelator, run on an OpenCL
+/// device.  It is only built when Vision Workbench is configured with
+/// OpenCL (VW_HAVE_PKG_OPENCL).
+///
+/// For each disparity in the search window the device computes the
+/// cost of every pixel, box filters it over the kernel (and again
+/// over the cost blur), and keeps the best and worst cost of each
+/// pixel and the disparity of the best, as correlate() does in
+/// OptimizedCorrelator.cc.  The left to right and right to left
+/// passes run on separate command queues, so the device works on both
+/// at once, and are cross checked on the host.
+///
+/// With subpixel refinement on, a second sweep over only the
+/// disparities next to some pixel's best gathers the costs around
+/// each pixel's best, and a parabola (a parabolic surface for 2D
+/// search windows) is fit through them on the device, as
+/// subpixel_correlation_parabola() does on the host.
+///
+/// The images are uploaded without blocking: the right image of a
+/// tile is preprocessed on the host while the left one is on its way,
+/// and, as each call has its own command queues on the shared
+/// context, the threads rasterizing other tiles prepare theirs while
+/// the device correlates this one.
+///
+/// The box filter leaves out the pixels within half a kernel of the
+/// edges of the compared area, as OptimizedCorrelator does, but costs
+/// are summed in float on the device, so disparities may differ where
+/// two costs nearly tie.
+///
+#ifndef __VW_STEREO_OPENCLCORRELATOR_H__
+#define __VW_STEREO_OPENCLCORRELATOR_H__
+
+#include <vw/config.h>
+
+#if defined(VW_HAVE_PKG_OPENCL) && VW_HAVE_PKG_OPENCL==1
+
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Math/BBox.h>
+#include <vw/Stereo/Correlate.h>
+
+#include <boost/shared_ptr.hpp>
+
+namespace vw {
+namespace stereo {
+
+  class OpenCLCorrelator {
+
+    BBox2i m_search_window;
+    int32 m_kern_size;
+    float m_cross_correlation_threshold;
+    int32 m_cost_blur;
+    stereo::CorrelatorType m_correlator_type;
+    bool m_subpixel;
+
+    // The device buffers and command queues of one call, defined in
+    // OpenCLCorrelator.cc to keep the OpenCL headers out of this one.
+    class Tile;
+    boost::shared_ptr<Tile> begin_tile(int32 cols, int32 rows) const;
+
+    // Start uploading an image of the tile without waiting for it:
+    // side 0 is the left image and 1 the right.  The tile keeps the
+    // image until the upload is done.
+    void upload(Tile& tile, int side, ImageView<float> const& image) const;
+    void upload(Tile& tile, int side, ImageView<uint32> const& image) const;
+    void upload(Tile& tile, int side, ImageView<uint64> const& image) const;
+    void upload(Tile& tile, int side, ImageView<uint8> const& image) const {
+      upload(tile, side, ImageView<float>(pixel_cast<float>(image)));
+    }
+
+    ImageView<PixelMask<Vector2f> > finish_tile(Tile& tile) const;
+
+  public:
+
+    /// Whether an OpenCL device was found to correlate on.
+    static bool available();
+
+    // See Correlate.h for CorrelatorType options.
+    OpenCLCorrelator(BBox2i const& search_window,
+                     int32 const& kernel_size,
+                     float const& cross_correlation_threshold,
+                     int32 const& cost_blur = 1,
+                     stereo::CorrelatorType correlator_type = ABS_DIFF_CORRELATOR) :
+      m_search_window(search_window),
+      m_kern_size(kernel_size),
+      m_cross_correlation_threshold(cross_correlation_threshold),
+      m_cost_blur(cost_blur),
+      m_correlator_type(correlator_type),
+      m_subpixel(false) {}
+
+    /// Refine the disparities to subpixel precision with parabola fits
+    /// on the device.  Off by default, which gives integer disparities
+    /// as OptimizedCorrelator does.
+    void set_subpixel(bool enable) { m_subpixel = enable; }
+    bool subpixel() const { return m_subpixel; }
+
+    /// Images preprocessed into census descriptors (see
+    /// CensusStereoPreprocessingFilter) are compared by Hamming
+    /// distance; otherwise the correlator type picks the cost.
+    template <class ViewT, class PreProcFilterT>
+    ImageView<PixelMask<Vector2f> > operator()(ImageViewBase<ViewT> const& image0,
+                                               ImageViewBase<ViewT> const& image1,
+                                               PreProcFilterT const& preproc_filter) const {
+      if ((image0.impl().cols() != image1.impl().cols()) ||
+          (image0.impl().rows() != image1.impl().rows())) {
+        vw_throw( ArgumentErr() << "Primary and secondary image dimensions do not agree!" );
+      }
+      if (!(image0.channels() == 1 && image0.impl().planes() == 1 &&
+            image1.channels() == 1 && image1.impl().planes() == 1)) {
+        vw_throw( ArgumentErr() << "Both images must be single channel/single plane images!" );
+      }
+
+      typedef typename PreProcFilterT::result_type preproc_type;
+      boost::shared_ptr<Tile> tile = begin_tile(image0.impl().cols(), image0.impl().rows());
+      {
+        preproc_type left_image = preproc_filter(image0);
+        upload(*tile, 0, left_image);
+      }
+      {
+        preproc_type right_image = preproc_filter(image1);
+        upload(*tile, 1, right_image);
+      }
+      return finish_tile(*tile);
+    }
+  };
+
+}}   // namespace vw::stereo
+
+#endif // VW_HAVE_PKG_OPENCL
+
+#endif // __VW_STEREO_OPENCLCORRELATOR_H__
@@ -49,6 +49,11 @@ sq_difference(ImageViewBase<Image1T> const& image1, ImageViewBase<Image2T> const
   return BinaryPerPixelView<Image1T, Image2T, SqDifferenceFunctor>(image1.impl(), image2.impl(), SqDifferenceFunctor());
 }
 
+struct CensusDistanceFunctor : ReturnFixedType<float> {
+  template <class CodeT>
+  inline float operator()(CodeT arg1, CodeT arg2) const { return float(census_distance(arg1, arg2)); }
+};
+
 // ---------------------------------------------------------------------------
 //                           COST FUNCTIONS
 // ---------------------------------------------------------------------------
@@ -96,75 +101,152 @@ ImageView<float> NormXCorrCost::calculate(int32 dx, int32 dy) {
 }
 
 
+namespace vw {
+namespace stereo {
+
+template <class CodeT>
+ImageView<float> HammingCost<CodeT>::calculate(int32 dx, int32 dy) {
+  typedef ZeroEdgeExtension EdgeT;
+  typedef CropView<EdgeExtensionView<ImageView<CodeT>, EdgeT > > OverCropT;
+
+  BBox2i right_bbox = this->bbox() + Vector2i(dx, dy);
+  OverCropT left_window(edge_extend(m_left, EdgeT()), this->bbox());
+  OverCropT right_window(edge_extend(m_right, EdgeT()), right_bbox);
+  return this->box_filter(per_pixel_filter(left_window, right_window, CensusDistanceFunctor()));
+}
+
+template class HammingCost<uint32>;
+template class HammingCost<uint64>;
+
+}} // namespace vw::stereo
+
+
 // ---------------------------------------------------------------------------
 //                           CORRELATE()
 // ---------------------------------------------------------------------------
-ImageView<PixelMask<Vector2f> > vw::stereo::correlate(boost::shared_ptr<StereoCostFunction> const& cost_function,
-                                                      BBox2i const& search_window,
-                                                      ProgressCallback const& progress) {
-
-  const int32 width = cost_function->cols();
-  const int32 height = cost_function->rows();
-
-  ImageView<DisparityScore<float> > result_buf(width, height);
-  ImageView<float> cost_buf(width, height);
-
-  int32 current_iteration = 0;
-  int32 total_iterations = (search_window.width() + 1) * (search_window.height() + 1);
-
-  BBox2i left_bbox = cost_function->bbox();
-  const int32 left_box_width = left_bbox.width();   // To avoid fuction call deep for loop
-  const int32 left_box_height = left_bbox.height();
-  for (int32 dy = search_window.min().y(); dy <= search_window.max().y(); dy++) {
-    for (int32 dx = search_window.min().x(); dx <= search_window.max().x(); dx++) {
-      CropView<ImageView<DisparityScore<float> > > result_buf_window(result_buf, left_bbox);
-      CropView<ImageView<float> > cost_buf_window(cost_buf, left_bbox);
-
-      // Calculate cost function
-      cost_buf_window = cost_function->calculate(dx,dy);
-
-      CropView<ImageView<DisparityScore<float> > >::pixel_accessor result_row_acc = result_buf_window.origin();
-      CropView<ImageView<float> >::pixel_accessor cost_buf_row_acc = cost_buf_window.origin();
-      for (int32 y = 0; y < left_box_height; y++) {
-        CropView<ImageView<DisparityScore<float> > >::pixel_accessor result_col_acc = result_row_acc;
-        CropView<ImageView<float> >::pixel_accessor cost_buf_col_acc = cost_buf_row_acc;
-        for (int32 x = 0; x < left_box_width; x++) {
-          if (*cost_buf_col_acc < (*result_col_acc).best) {
-            (*result_col_acc).best = *cost_buf_col_acc;
-            (*result_col_acc).hdisp = dx;
-            (*result_col_acc).vdisp = dy;
-          }
-          if (*cost_buf_col_acc > (*result_col_acc).worst) {
-            (*result_col_acc).worst = *cost_buf_col_acc;
-          }
-          result_col_acc.next_col();
-          cost_buf_col_acc.next_col();
+namespace {
+
+  // Converts the best scores to disparities; pixels whose costs were
+  // all the same, or that had none, are invalid.
+  ImageView<PixelMask<Vector2f> > best_disparities(ImageView<DisparityScore<float> > const& result_buf) {
+    ImageView<PixelMask<Vector2f> > result(result_buf.cols(), result_buf.rows());
+    for (int32 x = 0; x < result_buf.cols(); x++) {
+      for (int32 y = 0; y < result_buf.rows(); y++) {
+        if (result_buf(x, y).best == ScalarTypeLimits<float>::highest() ||
+            result_buf(x, y).best == result_buf(x, y).worst) {
+          invalidate(result(x,y));
+        } else {
+          result(x, y)[0] = result_buf(x,y).hdisp;
+          result(x, y)[1] = result_buf(x,y).vdisp;
+          validate( result(x,y) );
         }
-        result_row_acc.next_row();
-        cost_buf_row_acc.next_row();
       }
-
-      progress.report_fractional_progress(++current_iteration, total_iterations);
-      progress.abort_if_requested();
     }
+    return result;
   }
 
-  // convert from the local result buffer to the return format
-  ImageView<PixelMask<Vector2f> > result(width, height);
-
-  for (int32 x = 0; x < width; x++) {
-    for (int32 y = 0; y < height; y++) {
-      if (result_buf(x, y).best == ScalarTypeLimits<float>::highest() ||
-          result_buf(x, y).best == result_buf(x, y).worst) {
-        invalidate(result(x,y));
-      } else {
-        result(x, y)[0] = result_buf(x,y).hdisp;
-        result(x, y)[1] = result_buf(x,y).vdisp;
-        validate( result(x,y) );
+  // Finds the best disparity of each left pixel and, when right_buf is
+  // given, of each right pixel from the same costs.
+  ImageView<PixelMask<Vector2f> > correlate_costs(boost::shared_ptr<StereoCostFunction> const& cost_function,
+                                                  BBox2i const& search_window,
+                                                  ImageView<DisparityScore<float> >* right_buf,
+                                                  ProgressCallback const& progress) {
+    const int32 width = cost_function->cols();
+    const int32 height = cost_function->rows();
+
+    ImageView<DisparityScore<float> > result_buf(width, height);
+    ImageView<float> cost_buf(width, height);
+
+    int32 current_iteration = 0;
+    int32 total_iterations = (search_window.width() + 1) * (search_window.height() + 1);
+
+    BBox2i left_bbox = cost_function->bbox();
+    const int32 left_box_width = left_bbox.width();   // To avoid fuction call deep for loop
+    const int32 left_box_height = left_bbox.height();
+
+    // Only the pixels a whole sample away from the edges of the box
+    // have costs (the box filter stops a pixel short on the far side);
+    // the right pixels take theirs from these.
+    const int32 margin = cost_function->sample_size() / 2;
+
+    for (int32 dy = search_window.min().y(); dy <= search_window.max().y(); dy++) {
+      for (int32 dx = search_window.min().x(); dx <= search_window.max().x(); dx++) {
+        CropView<ImageView<DisparityScore<float> > > result_buf_window(result_buf, left_bbox);
+        CropView<ImageView<float> > cost_buf_window(cost_buf, left_bbox);
+
+        // Calculate cost function
+        cost_buf_window = cost_function->calculate(dx,dy);
+
+        CropView<ImageView<DisparityScore<float> > >::pixel_accessor result_row_acc = result_buf_window.origin();
+        CropView<ImageView<float> >::pixel_accessor cost_buf_row_acc = cost_buf_window.origin();
+        for (int32 y = 0; y < left_box_height; y++) {
+          CropView<ImageView<DisparityScore<float> > >::pixel_accessor result_col_acc = result_row_acc;
+          CropView<ImageView<float> >::pixel_accessor cost_buf_col_acc = cost_buf_row_acc;
+          for (int32 x = 0; x < left_box_width; x++) {
+            if (*cost_buf_col_acc < (*result_col_acc).best) {
+              (*result_col_acc).best = *cost_buf_col_acc;
+              (*result_col_acc).hdisp = dx;
+              (*result_col_acc).vdisp = dy;
+            }
+            if (*cost_buf_col_acc > (*result_col_acc).worst) {
+              (*result_col_acc).worst = *cost_buf_col_acc;
+            }
+            result_col_acc.next_col();
+            cost_buf_col_acc.next_col();
+          }
+          result_row_acc.next_row();
+          cost_buf_row_acc.next_row();
+        }
+
+        if (right_buf) {
+          // The right pixel (x+dx, y+dy) matches the left pixel (x, y)
+          // at the disparity (-dx, -dy).  Correlating right to left
+          // would visit the disparities in the opposite order, so ties
+          // go to the last of them here.
+          const int32 y_begin = std::max(left_bbox.min().y() + margin, -dy);
+          const int32 y_end = std::min(left_bbox.max().y() - margin - 1, height - dy);
+          const int32 x_begin = std::max(left_bbox.min().x() + margin, -dx);
+          const int32 x_end = std::min(left_bbox.max().x() - margin - 1, width - dx);
+          for (int32 y = y_begin; y < y_end; y++) {
+            float const* cost = &cost_buf(0, y);
+            DisparityScore<float>* right = &(*right_buf)(0, y + dy) + dx;
+            for (int32 x = x_begin; x < x_end; x++) {
+              if (cost[x] <= right[x].best) {
+                right[x].best = cost[x];
+                right[x].hdisp = -dx;
+                right[x].vdisp = -dy;
+              }
+              if (cost[x] > right[x].worst)
+                right[x].worst = cost[x];
+            }
+          }
+        }
+
+        progress.report_fractional_progress(++current_iteration, total_iterations);
+        progress.abort_if_requested();
       }
     }
+
+    // convert from the local result buffer to the return format
+    ImageView<PixelMask<Vector2f> > result = best_disparities(result_buf);
+    progress.report_finished();
+    return result;
   }
-  progress.report_finished();
-  return result;
+
+} // namespace
+
+ImageView<PixelMask<Vector2f> > vw::stereo::correlate(boost::shared_ptr<StereoCostFunction> const& cost_function,
+                                                      BBox2i const& search_window,
+                                                      ProgressCallback const& progress) {
+  return correlate_costs(cost_function, search_window, NULL, progress);
 }
 
+ImageView<PixelMask<Vector2f> > vw::stereo::correlate(boost::shared_ptr<StereoCostFunction> const& cost_function,
+                                                      BBox2i const& search_window,
+                                                      ImageView<PixelMask<Vector2f> >& right_disparity,
+                                                      ProgressCallback const& progress) {
+  ImageView<DisparityScore<float> > right_buf(cost_function->cols(), cost_function->rows());
+  ImageView<PixelMask<Vector2f> > result = correlate_costs(cost_function, search_window, &right_buf, progress);
+  right_disparity = best_disparities(right_buf);
+  return result;
+}
@@ -9,6 +9,7 @@
 #define __VW_STEREO_OPTIMIZED_CORRELATOR__
 
 #include <vw/Image/ImageMath.h>
+#include <vw/Image/SummedAreaTable.h>
 #include <vw/Stereo/DisparityMap.h>
 #include <vw/Stereo/Correlate.h>
 
@@ -60,63 +61,31 @@ namespace stereo {
                                          // pixel?
   protected:
 
-    // Efficient box filter implemenation.  This filter is called
-    // repeatedly, but we allocate the image buffers only once (in the
+    // Box filter implementation.  This filter is called repeatedly,
+    // but we allocate the result buffer only once (in the
     // constructor, above).
     template <class BoxViewT>
     ImageView<float> box_filter(ImageViewBase<BoxViewT> const& img) {
       VW_ASSERT(img.impl().cols() == m_dst.cols() && img.impl().rows() == m_dst.rows(),
                 ArgumentErr() << "StereoCostFunction::box_filter() : image size (" << img.impl().cols() << " " << img.impl().rows() << ") does not match box filter size (" << m_dst.cols() << " " << m_dst.rows() << ").");
+      return box_filter(SummedAreaTable<double>(img));
+    }
 
-      // Explicitly rasterize our input
-      typedef typename BoxViewT::pixel_type PixelT;
-      ImageView<PixelT> input(img.impl());
-      typedef typename ImageView<typename BoxViewT::pixel_type>::pixel_accessor AccT;
-      typedef typename ImageView<float>::pixel_accessor DAccT;
-
-      boost::scoped_array<float> cSum( new float[input.cols()] );
-      const float* cSumBack = &cSum[input.cols()];
-
-      {
-        AccT input_col = input.origin();
-        for ( float* cfront = &cSum[0];
-              cfront < cSumBack; cfront++ ) {
-          AccT input_e = input_col;
-          *cfront = *input_e;;
-          for (int32 ky = 1; ky < m_kernel_size; ky++) {
-            input_e.next_row();
-            *cfront += *input_e;
-          }
-          input_col.next_col();
-        }
-      }
-
-      for (int32 y = 0; y < input.rows() - m_kernel_size; y++) {
-        // Seed the row sum
-        float rsum = 0;
-        rsum = std::accumulate(&cSum[0],&cSum[m_kernel_size],rsum);
-
-        DAccT dst_iter = m_dst.origin().advance(m_half_kernel,y + m_half_kernel);
-        float* cback  = &cSum[0];
-        for ( float* cfront = &cSum[m_kernel_size];
-              cfront < cSumBack; cfront++ ) {
-          *dst_iter = rsum * m_kernel_size_i2;
-          dst_iter.next_col();
-          rsum += *cfront - *cback;
-          cback++;
-        }
-
-        // Update the column sum
-        AccT front = input.origin().advance(0,y+m_kernel_size);
-        AccT back  = input.origin().advance(0,y);
-        for ( float* cfront = &cSum[0];
-              cfront < cSumBack; cfront++ ) {
-          *cfront += *front - *back;
-          front.next_col();
-          back.next_col();
-        }
+    // The same, reading the window sums (or the sums of squares) from
+    // a summed-area table that has already been built, so that one
+    // table serves for both the mean and the variance of an image.
+    ImageView<float> box_filter(SummedAreaTable<double> const& table, bool squares = false) {
+      VW_ASSERT(table.cols() == m_dst.cols() && table.rows() == m_dst.rows(),
+                ArgumentErr() << "StereoCostFunction::box_filter() : table size (" << table.cols() << " " << table.rows() << ") does not match box filter size (" << m_dst.cols() << " " << m_dst.rows() << ").");
+      ImageView<double> const& sums = squares ? table.squares() : table.sums();
+      double scale = 1.0 / (double(m_kernel_size) * m_kernel_size);
+      for (int32 y = 0; y < table.rows() - m_kernel_size; y++) {
+        double const* top = &sums(0, y);
+        double const* bottom = &sums(0, y + m_kernel_size);
+        float* dst = &m_dst(m_half_kernel, y + m_half_kernel);
+        for (int32 x = 0; x < table.cols() - m_kernel_size; x++)
+          dst[x] = float((bottom[x + m_kernel_size] - bottom[x] - top[x + m_kernel_size] + top[x]) * scale);
       }
-
       return m_dst;
     }
   };
@@ -184,13 +153,41 @@ namespace stereo {
       VW_ASSERT(m_left.cols() == m_right.cols(), ArgumentErr() << "Left and right images not the same width");
       VW_ASSERT(m_left.rows() == m_right.rows(), ArgumentErr() << "Left and right images not the same height");
 
-      m_left_mean = copy(this->box_filter(m_left));
+      SummedAreaTable<double> left_table(m_left, true);
+      m_left_mean = copy(this->box_filter(left_table));
       m_left_precision =
-        1/(this->box_filter(square(m_left)) - square(m_left_mean));
+        1/(this->box_filter(left_table, true) - square(m_left_mean));
 
-      m_right_mean = copy(this->box_filter(m_right));
+      SummedAreaTable<double> right_table(m_right, true);
+      m_right_mean = copy(this->box_filter(right_table));
       m_right_precision =
-        1/(this->box_filter(square(m_right)) - square(m_right_mean));
+        1/(this->box_filter(right_table, true) - square(m_right_mean));
+    }
+
+    virtual ImageView<float> calculate(int32 dx, int32 dy);
+
+    virtual int32 cols() const { return m_left.cols(); }
+    virtual int32 rows() const { return m_left.rows(); }
+    virtual int32 sample_size() const { return this->kernel_size(); }
+  };
+
+  /// Compares images of census descriptors, such as those of
+  /// CensusStereoPreprocessingFilter, by the mean Hamming distance over
+  /// the kernel.
+  template <class CodeT>
+  class HammingCost : public StereoCostFunction {
+    ImageView<CodeT> m_left, m_right;
+
+  public:
+    HammingCost(ImageView<CodeT> const& left,
+                ImageView<CodeT> const& right,
+                BBox2i const& search_window,
+                int32 kern_size) : StereoCostFunction(left.cols(), left.rows(),
+                                                      search_window, kern_size),
+                                   m_left(left),
+                                   m_right(right) {
+      VW_ASSERT(m_left.cols() == m_right.cols(), ArgumentErr() << "Left and right images not the same width");
+      VW_ASSERT(m_left.rows() == m_right.rows(), ArgumentErr() << "Left and right images not the same height");
     }
 
     virtual ImageView<float> calculate(int32 dx, int32 dy);
@@ -200,6 +197,19 @@ namespace stereo {
     virtual int32 sample_size() const { return this->kernel_size(); }
   };
 
+  /// The Hamming cost of the 5x5 census transforms of two images.
+  class CensusCost : public HammingCost<uint32> {
+  public:
+    template <class ViewT>
+    CensusCost(ImageViewBase<ViewT> const& left,
+               ImageViewBase<ViewT> const& right,
+               BBox2i const& search_window,
+               int32 kern_size) : HammingCost<uint32>(census_transform(left), census_transform(right),
+                                                      search_window, kern_size) {}
+
+    virtual int32 sample_size() const { return this->kernel_size() + 4; }
+  };
+
   class BlurCost : public StereoCostFunction {
     boost::shared_ptr<StereoCostFunction> m_base_cost;
     int32 m_blur_size;
@@ -226,6 +236,18 @@ namespace stereo {
                                             BBox2i const& search_window,
                                             ProgressCallback const& progress = ProgressCallback::dummy_instance() );
 
+  /// The same, also finding the right to left disparities from the
+  /// same costs, so no second correlation is needed.  A right pixel
+  /// gets the negative of the disparity with the lowest cost among the
+  /// left pixels that match it.  The window costs compare the same two
+  /// windows either way, so this finds nearly the disparities that
+  /// correlating right to left would, differing only near the edges
+  /// and where the costs are blurred.
+  ImageView<PixelMask<Vector2f> > correlate(boost::shared_ptr<StereoCostFunction> const& cost_function,
+                                            BBox2i const& search_window,
+                                            ImageView<PixelMask<Vector2f> >& right_disparity,
+                                            ProgressCallback const& progress = ProgressCallback::dummy_instance() );
+
   class OptimizedCorrelator {
 
     BBox2i m_search_window;
@@ -234,6 +256,7 @@ namespace stereo {
     float m_corrscore_rejection_threshold;
     int32 m_cost_blur;
     stereo::CorrelatorType m_correlator_type;
+    bool m_single_pass_cross_check;
 
   public:
 
@@ -249,8 +272,64 @@ namespace stereo {
       m_cross_correlation_threshold(cross_correlation_threshold),
       m_corrscore_rejection_threshold(corrscore_rejection_threshold),
       m_cost_blur(cost_blur),
-      m_correlator_type(correlator_type) {}
+      m_correlator_type(correlator_type),
+      m_single_pass_cross_check(false) {}
+
+    /// Find the right to left disparities for the cross check from the
+    /// left to right costs, rather than correlating a second time (see
+    /// correlate() above).  This halves the work, at the price of
+    /// slightly different right to left disparities near the image
+    /// edges and with cost blur.
+    void set_single_pass_cross_check(bool enable) { m_single_pass_cross_check = enable; }
+    bool single_pass_cross_check() const { return m_single_pass_cross_check; }
+
+  private:
+    template <class ImageT>
+    boost::shared_ptr<StereoCostFunction> make_cost(ImageT const& left_image, ImageT const& right_image,
+                                                    BBox2i const& search_window) const {
+      boost::shared_ptr<StereoCostFunction> cost;
+      if (m_correlator_type == ABS_DIFF_CORRELATOR) {
+        cost.reset(new AbsDifferenceCost(left_image, right_image, search_window, m_kern_size));
+      } else if (m_correlator_type == SQR_DIFF_CORRELATOR) {
+        cost.reset(new SqDifferenceCost(left_image, right_image, search_window, m_kern_size));
+      } else if (m_correlator_type == NORM_XCORR_CORRELATOR) {
+        cost.reset(new NormXCorrCost(left_image, right_image, search_window, m_kern_size));
+      } else if (m_correlator_type == CENSUS_CORRELATOR) {
+        cost.reset(new CensusCost(left_image, right_image, search_window, m_kern_size));
+      } else {
+        vw_throw(ArgumentErr() << "OptimizedCorrelator: unknown correlator type " << m_correlator_type << ".");
+      }
+      if (m_cost_blur > 1)
+        cost.reset(new BlurCost(cost, search_window, m_cost_blur));
+      return cost;
+    }
 
+    // Census descriptors are compared by their Hamming distance,
+    // whatever the correlator type.
+    template <class CodeT>
+    boost::shared_ptr<StereoCostFunction> make_hamming_cost(ImageView<CodeT> const& left_image,
+                                                            ImageView<CodeT> const& right_image,
+                                                            BBox2i const& search_window) const {
+      boost::shared_ptr<StereoCostFunction> cost(new HammingCost<CodeT>(left_image, right_image, search_window, m_kern_size));
+      if (m_cost_blur > 1)
+        cost.reset(new BlurCost(cost, search_window, m_cost_blur));
+      return cost;
+    }
+    boost::shared_ptr<StereoCostFunction> make_cost(ImageView<uint32> const& left_image,
+                                                    ImageView<uint32> const& right_image,
+                                                    BBox2i const& search_window) const {
+      return make_hamming_cost(left_image, right_image, search_window);
+    }
+    boost::shared_ptr<StereoCostFunction> make_cost(ImageView<uint64> const& left_image,
+                                                    ImageView<uint64> const& right_image,
+                                                    BBox2i const& search_window) const {
+      return make_hamming_cost(left_image, right_image, search_window);
+    }
+
+  public:
+    /// Images preprocessed into census descriptors (see
+    /// CensusStereoPreprocessingFilter) are compared by Hamming
+    /// distance; otherwise the correlator type picks the cost.
     template <class ViewT, class PreProcFilterT>
     ImageView<PixelMask<Vector2f> > operator()(ImageViewBase<ViewT> const& image0,
                                                ImageViewBase<ViewT> const& image1,
@@ -275,31 +354,15 @@ namespace stereo {
       BBox2i r2l_window(-m_search_window.max().x(), -m_search_window.max().y(),
                         m_search_window.width(), m_search_window.height());
 
-      boost::shared_ptr<StereoCostFunction> l2r_cost, r2l_cost;
-
-      if (m_correlator_type == ABS_DIFF_CORRELATOR) {
-        l2r_cost.reset(new AbsDifferenceCost(left_image, right_image, m_search_window, m_kern_size));
-        r2l_cost.reset(new AbsDifferenceCost(right_image, left_image, r2l_window, m_kern_size));
-      } else if (m_correlator_type == SQR_DIFF_CORRELATOR) {
-        l2r_cost.reset(new SqDifferenceCost(left_image, right_image, m_search_window, m_kern_size));
-        r2l_cost.reset(new SqDifferenceCost(right_image, left_image, r2l_window, m_kern_size));
-      } else if (m_correlator_type == NORM_XCORR_CORRELATOR) {
-        l2r_cost.reset(new NormXCorrCost(left_image, right_image, m_search_window, m_kern_size));
-        r2l_cost.reset(new NormXCorrCost(right_image, left_image, r2l_window, m_kern_size));
+      ImageView<PixelMask<Vector2f> > result_l2r, result_r2l;
+      if (m_single_pass_cross_check) {
+        result_l2r = stereo::correlate(make_cost(left_image, right_image, m_search_window),
+                                       m_search_window, result_r2l);
       } else {
-        vw_throw(ArgumentErr() << "OptimizedCorrelator: unknown correlator type " << m_correlator_type << ".");
+        result_l2r = stereo::correlate(make_cost(left_image, right_image, m_search_window), m_search_window);
+        result_r2l = stereo::correlate(make_cost(right_image, left_image, r2l_window), r2l_window);
       }
 
-      boost::shared_ptr<StereoCostFunction> l2r_cost_and_blur = l2r_cost;
-      boost::shared_ptr<StereoCostFunction> r2l_cost_and_blur = r2l_cost;
-      if (m_cost_blur > 1) {
-        l2r_cost_and_blur.reset(new BlurCost(l2r_cost, m_search_window, m_cost_blur));
-        r2l_cost_and_blur.reset(new BlurCost(r2l_cost, r2l_window, m_cost_blur));
-      }
-
-      ImageView<PixelMask<Vector2f> > result_l2r = stereo::correlate(l2r_cost_and_blur, m_search_window);
-      ImageView<PixelMask<Vector2f> > result_r2l = stereo::correlate(r2l_cost_and_blur, r2l_window);
-
       // Cross check the left and right disparity maps
       cross_corr_consistency_check(result_l2r, result_r2l, m_cross_correlation_threshold, false);
 
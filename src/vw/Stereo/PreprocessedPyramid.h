@@ -0,0 +1,116 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file PreprocessedPyramid.h
+///
+/// Image pyramids built the way PyramidCorrelator builds them, with
+/// each level run through a stereo preprocessing filter, that are
+/// computed a block at a time and kept in the system cache.  The tiles
+/// of a CorrelatorView overlap by their padding, so building the
+/// pyramid of each tile's crop filters much of the image several
+/// times.  Reading the tiles out of one shared pyramid filters each
+/// block once.
+///
+#ifndef __VW_STEREO_PREPROCESSEDPYRAMID_H__
+#define __VW_STEREO_PREPROCESSEDPYRAMID_H__
+
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/Manipulation.h>
+
+#include <vector>
+
+namespace vw {
+namespace stereo {
+
+  /// A view of an image run through a stereo preprocessing filter.
+  /// Each block is filtered from a crop of the image grown by padding
+  /// on every side, which must cover the filter's support for the
+  /// result to match filtering the whole image.
+  template <class ImageT, class PreProcFuncT>
+  class StereoPreprocessingView : public ImageViewBase<StereoPreprocessingView<ImageT, PreProcFuncT> > {
+    ImageT m_image;
+    PreProcFuncT m_preproc_func;
+    int32 m_padding;
+
+  public:
+    typedef typename PreProcFuncT::result_type::pixel_type pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<StereoPreprocessingView> pixel_accessor;
+
+    StereoPreprocessingView( ImageT const& image, PreProcFuncT const& preproc_func, int32 padding )
+      : m_image(image), m_preproc_func(preproc_func), m_padding(padding) {}
+
+    inline int32 cols() const { return m_image.cols(); }
+    inline int32 rows() const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+    inline result_type operator()( int32 i, int32 j, int32 p = 0 ) const {
+      return prerasterize( BBox2i(i,j,1,1) )(i,j,p);
+    }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      BBox2i padded = bbox;
+      padded.expand( m_padding );
+      ImageView<pixel_type> filtered =
+        m_preproc_func( crop( edge_extend( m_image, ConstantEdgeExtension() ), padded ) );
+      return prerasterize_type( filtered, BBox2i( -padded.min().x(), -padded.min().y(), cols(), rows() ) );
+    }
+
+    template <class DestT>
+    inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+    /// \endcond
+  };
+
+  /// The preprocessed levels of an image pyramid, level 0 the image
+  /// itself and each after it smoothed and subsampled by two, as in
+  /// PyramidCorrelator.  Both the smoothed and the preprocessed levels
+  /// are cached in vw_system_cache() in blocks of block_size.  Copies
+  /// share the same levels.
+  template <class ChannelT, class PreProcFuncT>
+  class PreprocessedPyramid {
+  public:
+    typedef typename PreProcFuncT::result_type::pixel_type pixel_type;
+
+  private:
+    std::vector<ImageViewRef<pixel_type> > m_levels;
+
+  public:
+    template <class ImageT>
+    PreprocessedPyramid( ImageViewBase<ImageT> const& image, PreProcFuncT const& preproc_func,
+                         int32 levels, Vector2i const& block_size = Vector2i(256,256),
+                         int32 padding = 16 ) {
+      // Blocks are generated on the thread that asks for them; the
+      // tiles reading them are already spread over threads.
+      ImageViewRef<ChannelT> level = pixel_cast<ChannelT>( image.impl() );
+      for ( int32 n = 0; n < levels; ++n ) {
+        if ( n > 0 )
+          level = block_cache( pixel_cast<ChannelT>( subsample( gaussian_filter( level, 1.2 ), 2 ) ),
+                               block_size, 1 );
+        m_levels.push_back( block_cache( StereoPreprocessingView<ImageViewRef<ChannelT>, PreProcFuncT>( level, preproc_func, padding ),
+                                         block_size, 1 ) );
+      }
+    }
+
+    int32 levels() const { return int32(m_levels.size()); }
+
+    /// The preprocessed level n, the whole image.
+    ImageViewRef<pixel_type> const& level( int32 n ) const { return m_levels[n]; }
+  };
+
+}} // namespace vw::stereo
+
+#endif // __VW_STEREO_PREPROCESSEDPYRAMID_H__
@@ -13,11 +13,27 @@
 #include <vw/Image/MaskViews.h>
 #include <vw/Image/Transform.h>
 #include <vw/Image/Filter.h>
+#include <vw/Image/BlockRasterize.h>
 #include <vw/Stereo/DisparityMap.h>
 #include <vw/Stereo/OptimizedCorrelator.h>
 
 namespace vw {
 namespace stereo {
+
+  // Passes images that are already preprocessed through in their own
+  // pixel type, so that census descriptors stay descriptors.
+  template <class ChannelT>
+  class PreprocessedStereoFilter {
+  public:
+    typedef ImageView<ChannelT> result_type;
+
+    template <class ViewT>
+    result_type operator()(ImageViewBase<ViewT> const& view) const {
+      return view.impl();
+    }
+    static bool use_bit_image() { return false; }
+  };
+
   class PyramidCorrelator {
 
     BBox2f m_initial_search_range;
@@ -26,6 +42,7 @@ namespace stereo {
     float m_corrscore_rejection_threshold;
     int32 m_cost_blur;
     stereo::CorrelatorType m_correlator_type;
+    bool m_single_pass_cross_check;
     size_t m_pyramid_levels;
     int32 m_min_subregion_dim;
     typedef PixelMask<Vector2f> PixelDisp;
@@ -57,6 +74,24 @@ namespace stereo {
       }
     }
 
+    // The masks of each level of a pyramid, from the mask of level 0,
+    // with the pixels near the edges masked off too.
+    template <class MaskViewT, class ChannelT>
+    void build_mask_pyramid(ImageViewBase<MaskViewT> const& mask,
+                            std::vector<ImageView<ChannelT> > const& pyramid,
+                            std::vector<ImageView<uint8> > & masks) {
+      masks.resize(pyramid.size());
+      masks[0] = pixel_cast<uint8>(mask.impl());
+      for (size_t n = 1; n < pyramid.size(); ++n) {
+        subsample_mask_by_two(masks[n-1],masks[n]);
+        masks[n] = crop(edge_extend(masks[n]), bounding_box(pyramid[n]));
+      }
+
+      int32 mask_padding = std::max(m_kernel_size[0], m_kernel_size[1])/2;
+      for (size_t n = 0; n < pyramid.size(); ++n)
+        masks[n] = apply_mask(edge_mask(masks[n], 0, mask_padding),0);
+    }
+
     // Iterate over the nominal blocks, creating output blocks for correlation
     BBox2f compute_matching_blocks(BBox2i const& nominal_block,
                                    BBox2f const& search_range,
@@ -211,12 +246,14 @@ namespace stereo {
         float rm_min_matches_percent = 0.5;
         float rm_threshold = 3.0;
 
+        // The clean up is done in blocks, spread over the threads.
         ImageView<PixelDisp> disparity_map_clean =
-          disparity_mask(disparity_clean_up(new_disparity_map,
-                                            rm_half_kernel, rm_half_kernel,
-                                            rm_threshold,
-                                            rm_min_matches_percent),
-                         left_masks[n], right_masks[n]);
+          block_rasterize(disparity_mask(disparity_clean_up(new_disparity_map,
+                                                            rm_half_kernel, rm_half_kernel,
+                                                            rm_threshold,
+                                                            rm_min_matches_percent),
+                                         left_masks[n], right_masks[n]),
+                          Vector2i(256,256));
 
         if (n == ssize_t(m_pyramid_levels) - 1) {
           // At the highest level of the pyramid, use the cleaned version
@@ -266,6 +303,7 @@ namespace stereo {
                                               m_cross_correlation_threshold,
                                               m_corrscore_rejection_threshold,
                                               m_cost_blur, m_correlator_type);
+      correlator.set_single_pass_cross_check( m_single_pass_cross_check );
       return correlator( left_image.impl(),
                          right_image.impl(),
                          preproc_filter ) + PixelDisp(offset);
@@ -290,6 +328,7 @@ namespace stereo {
       m_corrscore_rejection_threshold(corrscore_rejection_threshold),
       m_cost_blur(cost_blur),
       m_correlator_type(correlator_type),
+      m_single_pass_cross_check(false),
       m_pyramid_levels(pyramid_levels) {
       m_debug_prefix = "";
       m_min_subregion_dim = 128;
@@ -299,6 +338,11 @@ namespace stereo {
     /// used as a prefix for all debug image files.
     void set_debug_mode(std::string const& debug_file_prefix) { m_debug_prefix = debug_file_prefix; }
 
+    /// Cross check each level with right to left disparities found
+    /// from the left to right costs.  See OptimizedCorrelator.
+    void set_single_pass_cross_check(bool enable) { m_single_pass_cross_check = enable; }
+    bool single_pass_cross_check() const { return m_single_pass_cross_check; }
+
     template <class ViewT, class MaskViewT, class PreProcFilterT>
     ImageView<PixelDisp > operator() (ImageViewBase<ViewT> const& left_image,
                                       ImageViewBase<ViewT> const& right_image,
@@ -331,35 +375,55 @@ namespace stereo {
 
       // Build the image pyramid
       std::vector<ImageView<channel_type> > left_pyramid(m_pyramid_levels), right_pyramid(m_pyramid_levels);
-      std::vector<ImageView<uint8> > left_masks(m_pyramid_levels), right_masks(m_pyramid_levels);
+      std::vector<ImageView<uint8> > left_masks, right_masks;
 
       left_pyramid[0] =  pixel_cast<channel_type>(left_image);
       right_pyramid[0] = pixel_cast<channel_type>(right_image);
-      left_masks[0] =    pixel_cast<uint8>(left_mask);
-      right_masks[0] =   pixel_cast<uint8>(right_mask);
 
       // Produce the image pyramid
       for (size_t n = 1; n < m_pyramid_levels; ++n) {
         left_pyramid[n] =  subsample(gaussian_filter(left_pyramid[n-1],1.2),2);
         right_pyramid[n] = subsample(gaussian_filter(right_pyramid[n-1],1.2),2);
-        subsample_mask_by_two(left_masks[n-1],left_masks[n]);
-        subsample_mask_by_two(right_masks[n-1],right_masks[n]);
-        left_masks[n] = crop(edge_extend(left_masks[n]),
-                             bounding_box(left_pyramid[n]));
-        right_masks[n] = crop(edge_extend(right_masks[n]),
-                              bounding_box(right_pyramid[n]));
-      }
-
-      int32 mask_padding = std::max(m_kernel_size[0], m_kernel_size[1])/2;
-      for (size_t n = 0; n < m_pyramid_levels; ++n) {
-        left_masks[n] = apply_mask(edge_mask(left_masks[n], 0, mask_padding),0);
-        right_masks[n] = apply_mask(edge_mask(right_masks[n], 0, mask_padding),0);
       }
+      build_mask_pyramid(left_mask, left_pyramid, left_masks);
+      build_mask_pyramid(right_mask, right_pyramid, right_masks);
 
       return do_correlation(left_pyramid, right_pyramid,
                             left_masks, right_masks, preproc_filter);
     }
 
+    /// The same for images whose pyramids have already been built and
+    /// preprocessed (see PreprocessedPyramid.h), finest level first.
+    /// Each level must be half the size of the one before, and the
+    /// masks are those of level 0.
+    template <class ChannelT, class MaskViewT>
+    ImageView<PixelDisp > operator() (std::vector<ImageView<ChannelT> > const& left_pyramid,
+                                      std::vector<ImageView<ChannelT> > const& right_pyramid,
+                                      ImageViewBase<MaskViewT> const& left_mask,
+                                      ImageViewBase<MaskViewT> const& right_mask) {
+
+      VW_ASSERT(left_pyramid.size() == m_pyramid_levels &&
+                right_pyramid.size() == m_pyramid_levels,
+                ArgumentErr() << "Correlator(): the pyramids do not have " << m_pyramid_levels << " levels.");
+
+      VW_ASSERT(left_pyramid[0].cols() == right_pyramid[0].cols() &&
+                left_pyramid[0].rows() == right_pyramid[0].rows(),
+                ArgumentErr() << "Correlator(): input image dimensions do not match.");
+
+      VW_ASSERT(left_pyramid[0].cols() == left_mask.impl().cols() &&
+                left_pyramid[0].rows() == left_mask.impl().rows() &&
+                left_pyramid[0].cols() == right_mask.impl().cols() &&
+                left_pyramid[0].rows() == right_mask.impl().rows(),
+                ArgumentErr() << "Correlator(): input image and mask dimensions do not match.");
+
+      std::vector<ImageView<uint8> > left_masks, right_masks;
+      build_mask_pyramid(left_mask, left_pyramid, left_masks);
+      build_mask_pyramid(right_mask, right_pyramid, right_masks);
+
+      return do_correlation(left_pyramid, right_pyramid,
+                            left_masks, right_masks, PreprocessedStereoFilter<ChannelT>());
+    }
+
   };
 
 }} // namespace vw::stereo
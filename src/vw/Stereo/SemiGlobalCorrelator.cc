@@ -0,0 +1,306 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Stereo/SemiGlobalCorrelator.h>
+#include <vw/Image/Statistics.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace vw;
+using namespace vw::stereo;
+
+namespace {
+
+  // The quantized costs run from 0 to MAX_COST.  A path cost is at most
+  // MAX_COST + penalty2, and eight of them must fit in a uint16.
+  const int32 MAX_COST = 1023;
+  const int32 MAX_PENALTY = 65535 / 8 - MAX_COST;
+
+  inline uint16 quantize( float cost, float scale ) {
+    float q = cost * scale;
+    if ( !(q < MAX_COST) ) return MAX_COST;   // Also catches NaN
+    if ( q <= 0 ) return 0;
+    return uint16( q + 0.5f );
+  }
+
+  // One step along a path: the cost of each disparity at a pixel given
+  // the path's costs at the pixel before it.  The disparities are laid
+  // out in rows of label_cols, x fastest.
+  void path_step( uint16 const* prev, uint16 const* cost, uint16* path,
+                  uint16* row_min, uint16* neighbor_min,
+                  int32 label_cols, int32 label_rows,
+                  int32 penalty1, int32 penalty2 ) {
+    const int32 labels = label_cols * label_rows;
+    int32 best = prev[0];
+    for ( int32 i = 1; i < labels; ++i )
+      best = std::min( best, int32(prev[i]) );
+
+    // The least cost of each disparity and its neighbours, taken along
+    // the rows of disparities and then down their columns.
+    for ( int32 r = 0; r < label_rows; ++r ) {
+      uint16 const* p = prev + r * label_cols;
+      uint16* m = row_min + r * label_cols;
+      if ( label_cols == 1 ) {
+        m[0] = p[0];
+        continue;
+      }
+      m[0] = std::min( p[0], p[1] );
+      for ( int32 c = 1; c < label_cols - 1; ++c )
+        m[c] = std::min( std::min( p[c-1], p[c] ), p[c+1] );
+      m[label_cols-1] = std::min( p[label_cols-2], p[label_cols-1] );
+    }
+    for ( int32 r = 0; r < label_rows; ++r ) {
+      uint16 const* above = row_min + std::max( r - 1, 0 ) * label_cols;
+      uint16 const* center = row_min + r * label_cols;
+      uint16 const* below = row_min + std::min( r + 1, label_rows - 1 ) * label_cols;
+      uint16* m = neighbor_min + r * label_cols;
+      for ( int32 c = 0; c < label_cols; ++c )
+        m[c] = std::min( std::min( above[c], center[c] ), below[c] );
+    }
+
+    const int32 jump = best + penalty2;
+    for ( int32 i = 0; i < labels; ++i ) {
+      int32 smooth = std::min( std::min( int32(prev[i]), int32(neighbor_min[i]) + penalty1 ), jump );
+      path[i] = uint16( cost[i] + smooth - best );
+    }
+  }
+
+  // Adds the costs along every path in the direction (dx,dy) to the sums.
+  void aggregate_path( std::vector<uint16> const& costs, std::vector<uint16>& sums,
+                       int32 width, int32 height, int32 label_cols, int32 label_rows,
+                       int32 dx, int32 dy, int32 penalty1, int32 penalty2 ) {
+    const int32 labels = label_cols * label_rows;
+    std::vector<uint16> prev_row( size_t(width) * labels ), cur_row( size_t(width) * labels );
+    std::vector<uint16> row_min( labels ), neighbor_min( labels );
+
+    const int32 y_begin = dy < 0 ? height - 1 : 0;
+    const int32 y_end   = dy < 0 ? -1 : height;
+    const int32 y_step  = dy < 0 ? -1 : 1;
+    const int32 x_begin = dx < 0 ? width - 1 : 0;
+    const int32 x_end   = dx < 0 ? -1 : width;
+    const int32 x_step  = dx < 0 ? -1 : 1;
+
+    for ( int32 y = y_begin; y != y_end; y += y_step ) {
+      for ( int32 x = x_begin; x != x_end; x += x_step ) {
+        size_t offset = ( size_t(y) * width + x ) * labels;
+        uint16 const* cost = &costs[offset];
+        uint16* path = &cur_row[size_t(x) * labels];
+
+        // The pixel before this one on the path, if it is in the image.
+        uint16 const* prev = 0;
+        int32 px = x - dx;
+        if ( px >= 0 && px < width ) {
+          if ( dy == 0 )
+            prev = &cur_row[size_t(px) * labels];
+          else if ( y != y_begin )
+            prev = &prev_row[size_t(px) * labels];
+        }
+
+        if ( prev )
+          path_step( prev, cost, path, &row_min[0], &neighbor_min[0],
+                     label_cols, label_rows, penalty1, penalty2 );
+        else
+          std::copy( cost, cost + labels, path );
+
+        uint16* sum = &sums[offset];
+        for ( int32 i = 0; i < labels; ++i )
+          sum[i] += path[i];
+      }
+      prev_row.swap( cur_row );
+    }
+  }
+
+  // The largest window cost two images allow with the given cost.
+  float cost_scale( ImageView<float> const& left, ImageView<float> const& right,
+                    CorrelatorType type ) {
+    if ( type == NORM_XCORR_CORRELATOR )
+      return 1.0;
+    if ( type == CENSUS_CORRELATOR )
+      return 24.0; // The bits of a census code
+    float left_min, left_max, right_min, right_max;
+    min_max_channel_values( left, left_min, left_max );
+    min_max_channel_values( right, right_min, right_max );
+    float range = std::max( left_max, right_max ) - std::min( left_min, right_min );
+    if ( !(range > 0) )
+      return 1.0;
+    return type == SQR_DIFF_CORRELATOR ? range * range : range;
+  }
+
+} // namespace
+
+ImageView<PixelMask<Vector2f> >
+vw::stereo::semi_global_correlate( boost::shared_ptr<StereoCostFunction> const& cost_function,
+                                   BBox2i const& search_window, float cost_scale,
+                                   int32 penalty1, int32 penalty2,
+                                   ImageView<PixelMask<Vector2f> >& right_disparity,
+                                   ProgressCallback const& progress ) {
+  VW_ASSERT( penalty1 >= 0 && penalty1 <= penalty2 && penalty2 <= MAX_PENALTY,
+             ArgumentErr() << "semi_global_correlate: the penalties must satisfy 0 <= penalty1 <= penalty2 <= "
+             << MAX_PENALTY << "." );
+  VW_ASSERT( cost_scale > 0, ArgumentErr() << "semi_global_correlate: the cost scale must be positive." );
+
+  const int32 cols = cost_function->cols();
+  const int32 rows = cost_function->rows();
+  ImageView<PixelMask<Vector2f> > result( cols, rows );
+  right_disparity.set_size( cols, rows );
+  fill( right_disparity, PixelMask<Vector2f>() );
+
+  // Only the pixels whose windows lie inside the cost function's box
+  // have costs.
+  BBox2i const& bbox = cost_function->bbox();
+  const int32 kernel = cost_function->kernel_size();
+  const int32 half_kernel = kernel / 2;
+  const BBox2i region( bbox.min().x() + half_kernel, bbox.min().y() + half_kernel,
+                       bbox.width() - kernel, bbox.height() - kernel );
+  if ( region.width() <= 0 || region.height() <= 0 ) {
+    progress.report_finished();
+    return result;
+  }
+
+  const int32 width = region.width();
+  const int32 height = region.height();
+  const int32 label_cols = search_window.width() + 1;
+  const int32 label_rows = search_window.height() + 1;
+  const int32 labels = label_cols * label_rows;
+
+  int32 current_iteration = 0;
+  const int32 total_iterations = labels + 8;
+
+  // The cost volume, with the disparities of a pixel next to each other.
+  std::vector<uint16> costs( size_t(width) * height * labels );
+  const float scale = MAX_COST / cost_scale;
+  for ( int32 dy = search_window.min().y(); dy <= search_window.max().y(); ++dy ) {
+    for ( int32 dx = search_window.min().x(); dx <= search_window.max().x(); ++dx ) {
+      const int32 label = ( dy - search_window.min().y() ) * label_cols + ( dx - search_window.min().x() );
+      ImageView<float> cost = cost_function->calculate( dx, dy );
+      for ( int32 y = 0; y < height; ++y ) {
+        float const* src = &cost( half_kernel, y + half_kernel );
+        uint16* dst = &costs[size_t(y) * width * labels + label];
+        for ( int32 x = 0; x < width; ++x, dst += labels )
+          *dst = quantize( src[x], scale );
+      }
+      progress.report_fractional_progress( ++current_iteration, total_iterations );
+      progress.abort_if_requested();
+    }
+  }
+
+  static const int32 directions[8][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 },
+                                          { 1, 1 }, { -1, 1 }, { 1, -1 }, { -1, -1 } };
+  std::vector<uint16> sums( costs.size(), 0 );
+  for ( int32 d = 0; d < 8; ++d ) {
+    aggregate_path( costs, sums, width, height, label_cols, label_rows,
+                    directions[d][0], directions[d][1], penalty1, penalty2 );
+    progress.report_fractional_progress( ++current_iteration, total_iterations );
+    progress.abort_if_requested();
+  }
+  std::vector<uint16>().swap( costs );
+
+  // The lowest sum of each left pixel.  Ties go to the first disparity,
+  // y outer and x inner, as in stereo::correlate().
+  for ( int32 y = 0; y < height; ++y ) {
+    for ( int32 x = 0; x < width; ++x ) {
+      uint16 const* sum = &sums[( size_t(y) * width + x ) * labels];
+      int32 best = 0;
+      uint16 worst = sum[0];
+      for ( int32 i = 1; i < labels; ++i ) {
+        if ( sum[i] < sum[best] ) best = i;
+        if ( sum[i] > worst ) worst = sum[i];
+      }
+      if ( sum[best] == worst )
+        continue;
+      result( region.min().x() + x, region.min().y() + y ) =
+        PixelMask<Vector2f>( Vector2f( search_window.min().x() + best % label_cols,
+                                       search_window.min().y() + best / label_cols ) );
+    }
+  }
+
+  // The lowest sum of each right pixel, over the left pixels that see it.
+  for ( int32 v = 0; v < rows; ++v ) {
+    for ( int32 u = 0; u < cols; ++u ) {
+      int32 best = -1;
+      uint16 best_sum = 0, worst_sum = 0;
+      for ( int32 i = 0; i < labels; ++i ) {
+        int32 x = u - ( search_window.min().x() + i % label_cols ) - region.min().x();
+        int32 y = v - ( search_window.min().y() + i / label_cols ) - region.min().y();
+        if ( x < 0 || y < 0 || x >= width || y >= height )
+          continue;
+        uint16 s = sums[( size_t(y) * width + x ) * labels + i];
+        if ( best < 0 || s < best_sum ) {
+          if ( best < 0 ) worst_sum = s;
+          best = i;
+          best_sum = s;
+        }
+        if ( s > worst_sum ) worst_sum = s;
+      }
+      if ( best < 0 || best_sum == worst_sum )
+        continue;
+      right_disparity( u, v ) =
+        PixelMask<Vector2f>( Vector2f( -( search_window.min().x() + best % label_cols ),
+                                       -( search_window.min().y() + best / label_cols ) ) );
+    }
+  }
+
+  progress.report_finished();
+  return result;
+}
+
+ImageView<PixelMask<Vector2f> >
+SemiGlobalCorrelator::correlate( ImageView<float> const& left_image,
+                                 ImageView<float> const& right_image ) const {
+  const int32 cols = left_image.cols();
+  const int32 rows = left_image.rows();
+  const float scale = cost_scale( left_image, right_image, m_correlator_type );
+
+  // Strips of rows small enough for the memory limit.  Each is cut out
+  // with enough rows around it that its own pixels have the same costs
+  // as in the whole image, and some more so that its paths have room.
+  const size_t labels = size_t( m_search_window.width() + 1 ) * ( m_search_window.height() + 1 );
+  const int32 pad = m_kern_size / 2 + std::max( abs( m_search_window.min().y() ),
+                                                abs( m_search_window.max().y() ) )
+    + context_size();
+  const size_t row_bytes = std::max( size_t(cols) * labels * 2 * sizeof(uint16), size_t(1) );
+  int32 strip_rows = rows;
+  if ( size_t(rows) * row_bytes > m_memory_limit )
+    strip_rows = std::max( int32( m_memory_limit / row_bytes ) - 2 * pad, 1 );
+
+  ImageView<PixelMask<Vector2f> > result_l2r( cols, rows ), result_r2l( cols, rows );
+  for ( int32 y0 = 0; y0 < rows; y0 += strip_rows ) {
+    const int32 y1 = std::min( y0 + strip_rows, rows );
+    const int32 top = ( strip_rows == rows ) ? 0 : std::max( y0 - pad, 0 );
+    const int32 bottom = ( strip_rows == rows ) ? rows : std::min( y1 + pad, rows );
+    const BBox2i strip( 0, top, cols, bottom - top );
+    ImageView<float> left_strip = crop( left_image, strip );
+    ImageView<float> right_strip = crop( right_image, strip );
+
+    boost::shared_ptr<StereoCostFunction> cost;
+    if (m_correlator_type == ABS_DIFF_CORRELATOR) {
+      cost.reset(new AbsDifferenceCost(left_strip, right_strip, m_search_window, m_kern_size));
+    } else if (m_correlator_type == SQR_DIFF_CORRELATOR) {
+      cost.reset(new SqDifferenceCost(left_strip, right_strip, m_search_window, m_kern_size));
+    } else if (m_correlator_type == NORM_XCORR_CORRELATOR) {
+      cost.reset(new NormXCorrCost(left_strip, right_strip, m_search_window, m_kern_size));
+    } else if (m_correlator_type == CENSUS_CORRELATOR) {
+      cost.reset(new CensusCost(left_strip, right_strip, m_search_window, m_kern_size));
+    } else {
+      vw_throw(ArgumentErr() << "SemiGlobalCorrelator: unknown correlator type " << m_correlator_type << ".");
+    }
+
+    ImageView<PixelMask<Vector2f> > strip_r2l;
+    ImageView<PixelMask<Vector2f> > strip_l2r =
+      semi_global_correlate( cost, m_search_window, scale, m_penalty1, m_penalty2, strip_r2l );
+
+    const BBox2i own( 0, y0 - top, cols, y1 - y0 );
+    crop( result_l2r, BBox2i( 0, y0, cols, y1 - y0 ) ) = crop( strip_l2r, own );
+    crop( result_r2l, BBox2i( 0, y0, cols, y1 - y0 ) ) = crop( strip_r2l, own );
+  }
+
+  // Cross check the left and right disparity maps
+  cross_corr_consistency_check(result_l2r, result_r2l, m_cross_correlation_threshold, false);
+
+  return result_l2r;
+}
@@ -0,0 +1,120 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file SemiGlobalCorrelator.h
+///
+/// Semi-global matching (SGM) for the two dimensional search windows
+/// of the other correlators.
+///
+/// The cost of each disparity is the window cost of OptimizedCorrelator,
+/// usually over a small kernel, quantized to 0 - 1023.  These costs are
+/// then smoothed along eight paths through the image: along each path
+/// a pixel's cost for a disparity is its own cost plus the least of its
+/// predecessor's cost for the same disparity, for a neighbouring
+/// disparity (one apart in x, y or both) plus penalty1, and for any
+/// disparity plus penalty2.  The disparity with the lowest sum over
+/// the eight paths wins.  The right to left disparities are read from
+/// the same sums, so only one cost volume is computed.
+///
+/// The costs and the sums are both stored in uint16, four bytes for each
+/// pixel and disparity.  SemiGlobalCorrelator splits larger images into
+/// overlapping strips of rows that fit a memory limit.
+///
+#ifndef __VW_STEREO_SEMIGLOBALCORRELATOR_H__
+#define __VW_STEREO_SEMIGLOBALCORRELATOR_H__
+
+#include <vw/Core/ProgressCallback.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Stereo/Correlate.h>
+#include <vw/Stereo/OptimizedCorrelator.h>
+
+namespace vw {
+namespace stereo {
+
+  /// Finds the disparity of each pixel of the left image with semi-global
+  /// matching over the costs of cost_function, which are divided by
+  /// cost_scale (the largest cost expected) before they are quantized.
+  /// The right to left disparities are returned in right_disparity.
+  /// Pixels whose sums are all the same are invalid, as are those too
+  /// near the edges for a window.  The penalties must satisfy
+  /// 0 <= penalty1 <= penalty2 <= 7168.
+  ImageView<PixelMask<Vector2f> >
+  semi_global_correlate( boost::shared_ptr<StereoCostFunction> const& cost_function,
+                         BBox2i const& search_window, float cost_scale,
+                         int32 penalty1, int32 penalty2,
+                         ImageView<PixelMask<Vector2f> >& right_disparity,
+                         ProgressCallback const& progress = ProgressCallback::dummy_instance() );
+
+  /// A correlator with the interface of OptimizedCorrelator that uses
+  /// semi_global_correlate() and then cross checks the left to right
+  /// and right to left disparities.
+  class SemiGlobalCorrelator {
+
+    BBox2i m_search_window;
+    int32 m_kern_size;
+    float m_cross_correlation_threshold;
+    int32 m_penalty1, m_penalty2;
+    stereo::CorrelatorType m_correlator_type;
+    size_t m_memory_limit;
+
+    ImageView<PixelMask<Vector2f> > correlate( ImageView<float> const& left_image,
+                                               ImageView<float> const& right_image ) const;
+
+  public:
+
+    // See Correlate.h for CorrelatorType options.  The penalties are
+    // in units of the quantized costs, where 1023 is the cost of the
+    // largest difference the images allow.
+    SemiGlobalCorrelator(BBox2i const& search_window,
+                         int32 const& kernel_size,
+                         float const& cross_correlation_threshold,
+                         int32 penalty1 = 8, int32 penalty2 = 96,
+                         stereo::CorrelatorType correlator_type = ABS_DIFF_CORRELATOR ) :
+      m_search_window(search_window),
+      m_kern_size(kernel_size),
+      m_cross_correlation_threshold(cross_correlation_threshold),
+      m_penalty1(penalty1), m_penalty2(penalty2),
+      m_correlator_type(correlator_type),
+      m_memory_limit(size_t(512) << 20) {}
+
+    /// The most memory, in bytes, the costs and sums of one strip of
+    /// rows may take.  The default is 512 MB.
+    void set_memory_limit(size_t bytes) { m_memory_limit = bytes; }
+    size_t memory_limit() const { return m_memory_limit; }
+
+    /// The number of rows of context kept on each side of a strip, so
+    /// that the paths through its edges have somewhere to start.
+    static int32 context_size() { return 16; }
+
+    template <class ViewT, class PreProcFilterT>
+    ImageView<PixelMask<Vector2f> > operator()(ImageViewBase<ViewT> const& image0,
+                                               ImageViewBase<ViewT> const& image1,
+                                               PreProcFilterT const& preproc_filter) {
+
+      // Check to make sure that image0 and image1 have equal dimensions
+      if ((image0.impl().cols() != image1.impl().cols()) ||
+          (image0.impl().rows() != image1.impl().rows())) {
+        vw_throw( ArgumentErr() << "Primary and secondary image dimensions do not agree!" );
+      }
+
+      // Check to make sure that the images are single channel/single plane
+      if (!(image0.channels() == 1 && image0.impl().planes() == 1 &&
+            image1.channels() == 1 && image1.impl().planes() == 1)) {
+        vw_throw( ArgumentErr() << "Both images must be single channel/single plane images!" );
+      }
+
+      ImageView<float> left_image = channel_cast<float>(preproc_filter(image0));
+      ImageView<float> right_image = channel_cast<float>(preproc_filter(image1));
+      return correlate(left_image, right_image);
+    }
+  };
+
+}}   // namespace vw::stereo
+
+#endif // __VW_STEREO_SEMIGLOBALCORRELATOR_H__
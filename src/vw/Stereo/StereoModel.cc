@@ -96,40 +96,15 @@ Vector3 StereoModel::operator()(Vector2 const& pix1,
     Vector3 vecFromA = m_camera1->pixel_to_vector(pix1);
     Vector3 vecFromB = m_camera2->pixel_to_vector(pix2);
 
-    // If vecFromA and vecFromB are nearly parallel, there will be
-    // very large numerical uncertainty about where to place the
-    // point.  We set a threshold here to reject points that are
-    // on nearly parallel rays.  The threshold of 1e-4 corresponds
-    // to a convergence of less than theta = 0.81 degrees, so if
-    // the two rays are within 0.81 degrees of being parallel, we
-    // reject this point.
-    //
-    // This threshold was chosen empirically for now, but should
-    // probably be revisited once a more rigorous analysis has
-    // been completed. -mbroxton (11-MAR-07)
-    if ( (1-dot_prod(vecFromA, vecFromB) < 1e-4 && !m_least_squares) ||
-         (1-dot_prod(vecFromA, vecFromB) < 1e-5 && m_least_squares) ) {
+    if ( nearly_parallel(vecFromA, vecFromB) ) {
       error = 0;
       return Vector3();
     }
 
     Vector3 originA = m_camera1->camera_center(pix1);
     Vector3 originB = m_camera2->camera_center(pix2);
-    Vector3 result =
-      triangulate_point(originA, vecFromA,
-                        originB, vecFromB,
-                        error);
-
-    if ( m_least_squares )
-      refine_point(pix1, pix2, result);
-
-    // Reflect points that fall behind one of the two cameras
-    if ( dot_prod(result - originA, vecFromA) < 0 ||
-         dot_prod(result - originB, vecFromB) < 0 ) {
-      result = -result + 2*originA;
-    }
-
-    return result;
+    return triangulate_rays(pix1, pix2, originA, vecFromA,
+                            originB, vecFromB, error);
 
   } catch (const camera::PixelToRayErr& /*e*/) {
     error = 0;
@@ -137,6 +112,77 @@ Vector3 StereoModel::operator()(Vector2 const& pix1,
   }
 }
 
+void StereoModel::operator()(std::vector<Vector2> const& pixels1,
+                             std::vector<Vector2> const& pixels2,
+                             std::vector<Vector3>& points,
+                             std::vector<double>& errors ) const {
+  VW_ASSERT( pixels1.size() == pixels2.size(),
+             ArgumentErr() << "StereoModel: the two lists of pixels are not the same length." );
+
+  // Pixels without rays come back with zero pointing vectors.
+  std::vector<Vector3> originsA, vecsFromA, originsB, vecsFromB;
+  m_camera1->pixels_to_rays(pixels1, originsA, vecsFromA);
+  m_camera2->pixels_to_rays(pixels2, originsB, vecsFromB);
+
+  points.resize(pixels1.size());
+  errors.resize(pixels1.size());
+  for (size_t i = 0; i < pixels1.size(); ++i) {
+    if ( vecsFromA[i] == Vector3() || vecsFromB[i] == Vector3() ||
+         nearly_parallel(vecsFromA[i], vecsFromB[i]) ) {
+      errors[i] = 0;
+      points[i] = Vector3();
+      continue;
+    }
+
+    try {
+      points[i] = triangulate_rays(pixels1[i], pixels2[i],
+                                   originsA[i], vecsFromA[i],
+                                   originsB[i], vecsFromB[i], errors[i]);
+    } catch (const camera::PixelToRayErr& /*e*/) {
+      errors[i] = 0;
+      points[i] = Vector3();
+    }
+  }
+}
+
+bool StereoModel::nearly_parallel(Vector3 const& vecFromA,
+                                  Vector3 const& vecFromB) const {
+  // If vecFromA and vecFromB are nearly parallel, there will be
+  // very large numerical uncertainty about where to place the
+  // point.  We set a threshold here to reject points that are
+  // on nearly parallel rays.  The threshold of 1e-4 corresponds
+  // to a convergence of less than theta = 0.81 degrees, so if
+  // the two rays are within 0.81 degrees of being parallel, we
+  // reject this point.
+  //
+  // This threshold was chosen empirically for now, but should
+  // probably be revisited once a more rigorous analysis has
+  // been completed. -mbroxton (11-MAR-07)
+  return (1-dot_prod(vecFromA, vecFromB) < 1e-4 && !m_least_squares) ||
+         (1-dot_prod(vecFromA, vecFromB) < 1e-5 && m_least_squares);
+}
+
+Vector3 StereoModel::triangulate_rays(Vector2 const& pix1, Vector2 const& pix2,
+                                      Vector3 const& originA, Vector3 const& vecFromA,
+                                      Vector3 const& originB, Vector3 const& vecFromB,
+                                      double& error) const {
+  Vector3 result =
+    triangulate_point(originA, vecFromA,
+                      originB, vecFromB,
+                      error);
+
+  if ( m_least_squares )
+    refine_point(pix1, pix2, result);
+
+  // Reflect points that fall behind one of the two cameras
+  if ( dot_prod(result - originA, vecFromA) < 0 ||
+       dot_prod(result - originB, vecFromB) < 0 ) {
+    result = -result + 2*originA;
+  }
+
+  return result;
+}
+
 double StereoModel::convergence_angle(Vector2 const& pix1, Vector2 const& pix2) const {
   return acos(dot_prod(m_camera1->pixel_to_vector(pix1),
                        m_camera2->pixel_to_vector(pix2)));
@@ -10,6 +10,8 @@
 
 #include <vw/Stereo/DisparityMap.h>
 
+#include <vector>
+
 namespace vw {
 
 // forward declaration
@@ -54,6 +56,16 @@ namespace stereo {
     /// intersection.
     Vector3 operator()(Vector2 const& pix1, Vector2 const& pix2, double& error ) const;
 
+    /// Apply a stereo model to many pairs of image coordinates at
+    /// once, giving the same points and errors as the method above.
+    /// Each camera is asked for all of its rays in one call (see
+    /// CameraModel::pixels_to_rays()), so camera models can share
+    /// per-line state between the pixels.
+    void operator()(std::vector<Vector2> const& pixels1,
+                    std::vector<Vector2> const& pixels2,
+                    std::vector<Vector3>& points,
+                    std::vector<double>& errors ) const;
+
     /// Returns the dot product of the two rays emanating from camera
     /// 1 and camera 2 through pix1 and pix2 respectively.  This can
     /// effectively be interpreted as the angle (in radians) between
@@ -76,6 +88,17 @@ namespace stereo {
                               Vector3 const& vecFromB,
                               double& error) const;
 
+    /// Whether two rays are too close to parallel to triangulate.
+    bool nearly_parallel(Vector3 const& vecFromA,
+                         Vector3 const& vecFromB) const;
+
+    /// Triangulates the rays through pix1 and pix2, refining the
+    /// point if asked to and reflecting points behind the cameras.
+    Vector3 triangulate_rays(Vector2 const& pix1, Vector2 const& pix2,
+                             Vector3 const& originA, Vector3 const& vecFromA,
+                             Vector3 const& originB, Vector3 const& vecFromB,
+                             double& error) const;
+
     void refine_point( Vector2 const& pix1,
                        Vector2 const& pix2,
                        Vector3& point ) const;
@@ -9,9 +9,12 @@
 #define __VW_STEREO_STEREOVIEW_H__
 
 #include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Stereo/StereoModel.h>
 #include <vw/Camera/CameraModel.h>
 #include <limits>
+#include <vector>
 
 namespace vw {
 
@@ -34,26 +37,25 @@ namespace stereo {
       static const bool value = (1 != CompoundNumChannels<typename UnmaskedPixelType<PixelT>::type>::value);
     };
 
+    // The pixel of the second image that a disparity matches with the
+    // pixel at index of the first.
     template <class T>
-    inline typename boost::enable_if<IsScalar<T>,Vector3>::type
-    StereoModelHelper( StereoModel const& model, Vector2 const& index,
-                       T const& disparity, double& error ) const {
-      return model( index, Vector2( index[0] + disparity, index[1] ), error );
+    static inline typename boost::enable_if<IsScalar<T>,Vector2>::type
+    RightPixelHelper( Vector2 const& index, T const& disparity ) {
+      return Vector2( index[0] + disparity, index[1] );
     }
 
     template <class T>
-    inline typename boost::enable_if_c<IsCompound<T>::value && (CompoundNumChannels<typename UnmaskedPixelType<T>::type>::value == 1),Vector3>::type
-    StereoModelHelper( StereoModel const& model, Vector2 const& index,
-                       T const& disparity, double& error ) const {
-      return model( index, Vector2( index[0] + disparity, index[1] ), error );
+    static inline typename boost::enable_if_c<IsCompound<T>::value && (CompoundNumChannels<typename UnmaskedPixelType<T>::type>::value == 1),Vector2>::type
+    RightPixelHelper( Vector2 const& index, T const& disparity ) {
+      return Vector2( index[0] + disparity, index[1] );
     }
 
     template <class T>
-    inline typename boost::enable_if_c<IsCompound<T>::value && (CompoundNumChannels<typename UnmaskedPixelType<T>::type>::value != 1),Vector3>::type
-    StereoModelHelper( StereoModel const& model, Vector2 const& index,
-                       T const& disparity, double& error ) const {
-      return model( index, Vector2( index[0] + disparity[0],
-                                    index[1] + disparity[1] ), error );
+    static inline typename boost::enable_if_c<IsCompound<T>::value && (CompoundNumChannels<typename UnmaskedPixelType<T>::type>::value != 1),Vector2>::type
+    RightPixelHelper( Vector2 const& index, T const& disparity ) {
+      return Vector2( index[0] + disparity[0],
+                      index[1] + disparity[1] );
     }
 
   public:
@@ -83,8 +85,8 @@ namespace stereo {
     inline result_type operator()( size_t i, size_t j, size_t p=0 ) const {
       double error;
       if ( is_valid(m_disparity_map(i,j,p)) )
-        return StereoModelHelper( m_stereo_model, Vector2(i,j),
-                                  m_disparity_map(i,j,p), error );
+        return m_stereo_model( Vector2(i,j),
+                               RightPixelHelper( Vector2(i,j), m_disparity_map(i,j,p) ), error );
       // For missing pixels in the disparity map, we return a null 3D position.
       return Vector3();
     }
@@ -97,8 +99,8 @@ namespace stereo {
     inline double error( int32 i, int32 j, int32 p=0 ) const {
       double error = 1e-10;
       if ( is_valid(m_disparity_map(i,j,p)) )
-        StereoModelHelper( m_stereo_model, Vector2(i,j),
-                           m_disparity_map(i,j,p), error );
+        m_stereo_model( Vector2(i,j),
+                        RightPixelHelper( Vector2(i,j), m_disparity_map(i,j,p) ), error );
       if ( error < 0 )
         return 0;
       return error;
@@ -107,8 +109,36 @@ namespace stereo {
     DisparityImageT const& disparity_map() const { return m_disparity_map; }
 
     /// \cond INTERNAL
-    typedef StereoView<typename DisparityImageT::prerasterize_type> prerasterize_type;
-    inline prerasterize_type prerasterize( BBox2i const& bbox ) const { return prerasterize_type( m_disparity_map.prerasterize(bbox), m_stereo_model ); }
+    // Blocks are triangulated all at once with the batched StereoModel
+    // method, so the camera models can share work between pixels.
+    typedef CropView<ImageView<Vector3> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<dpixel_type> disparity = crop( m_disparity_map.prerasterize(bbox), bbox );
+
+      std::vector<Vector2> pixels1, pixels2;
+      pixels1.reserve( bbox.width() * bbox.height() );
+      pixels2.reserve( bbox.width() * bbox.height() );
+      for ( int32 j = 0; j < disparity.rows(); ++j )
+        for ( int32 i = 0; i < disparity.cols(); ++i )
+          if ( is_valid(disparity(i,j)) ) {
+            Vector2 index( bbox.min().x() + i, bbox.min().y() + j );
+            pixels1.push_back( index );
+            pixels2.push_back( RightPixelHelper( index, disparity(i,j) ) );
+          }
+
+      std::vector<Vector3> points;
+      std::vector<double> errors;
+      m_stereo_model( pixels1, pixels2, points, errors );
+
+      // For missing pixels in the disparity map, we return a null 3D position.
+      ImageView<Vector3> result( disparity.cols(), disparity.rows() );
+      size_t n = 0;
+      for ( int32 j = 0; j < disparity.rows(); ++j )
+        for ( int32 i = 0; i < disparity.cols(); ++i )
+          if ( is_valid(disparity(i,j)) )
+            result(i,j) = points[n++];
+      return prerasterize_type( result, BBox2i( -bbox.min().x(), -bbox.min().y(), cols(), rows() ) );
+    }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
     /// \endcond
   };
@@ -0,0 +1,255 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// BenchStereo.cxx
+//
+// End-to-end benchmarks for the correlators and subpixel refinement,
+// on a synthetic stereo pair: blurred noise, and the same shifted by a
+// known, fractional disparity.  Run by "make benchmark", not by "make
+// check".  Each stage prints a CSV line: its name, the fastest of its
+// runs in seconds, the high-water marks of the image buffers and of
+// the resident set during the stage in megabytes, and the accuracy of
+// its disparities away from the image edges: the fraction that are
+// valid, their mean error in pixels, and the fraction of those off by
+// more than a pixel.
+//
+//   BenchStereo [--size <pixels>] [--texture <sigma>] [--disparity <pixels>]
+//               [--kernel <pixels>] [--repeat <n>] [--filter <substring>]
+//
+// The texture is the sigma of the blur applied to the noise; larger
+// values make a smoother pair that is harder to correlate.
+
+#include <vw/Core/MemoryGovernor.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/Statistics.h>
+#include <vw/Image/Transform.h>
+#include <vw/Image/UtilityViews.h>
+#include <vw/Stereo/Correlate.h>
+#include <vw/Stereo/OptimizedCorrelator.h>
+#include <vw/Stereo/PyramidCorrelator.h>
+#include <vw/Stereo/SubpixelView.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include <sys/resource.h>
+#include <boost/random/linear_congruential.hpp>
+
+using namespace vw;
+using namespace vw::stereo;
+
+namespace {
+
+  struct Options {
+    int32 size, kernel, repeat;
+    float texture, disparity;
+    std::string filter;
+    Options() : size(512), kernel(9), repeat(1), texture(1.5), disparity(10.4) {}
+  };
+
+  typedef ImageView<PixelMask<Vector2f> > disparity_type;
+
+  // The resident set high-water mark, in megabytes.  On Linux it can
+  // be reset between stages; elsewhere it is that of the whole run.
+  void reset_rss_peak() {
+    std::ofstream clear_refs( "/proc/self/clear_refs" );
+    clear_refs << "5";
+  }
+
+  double rss_peak_mb() {
+    std::ifstream status( "/proc/self/status" );
+    std::string line;
+    while( std::getline( status, line ) )
+      if( line.compare( 0, 6, "VmHWM:" ) == 0 )
+        return std::atof( line.c_str() + 6 ) / 1024;
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+#if defined(__APPLE__)
+    return usage.ru_maxrss / ( 1024.0 * 1024.0 );
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+  }
+
+  template <class FilterT>
+  class Optimized {
+    ImageView<uint8> m_left, m_right;
+    BBox2i m_search;
+    int32 m_kernel;
+    CorrelatorType m_type;
+    FilterT m_filter;
+    bool m_single_pass;
+  public:
+    Optimized( ImageView<uint8> const& left, ImageView<uint8> const& right, BBox2i const& search,
+               int32 kernel, CorrelatorType type, FilterT const& filter, bool single_pass = false )
+      : m_left(left), m_right(right), m_search(search), m_kernel(kernel), m_type(type),
+        m_filter(filter), m_single_pass(single_pass) {}
+    disparity_type operator()() const {
+      OptimizedCorrelator correlator( m_search, m_kernel, 1, 1, 1, m_type );
+      correlator.set_single_pass_cross_check( m_single_pass );
+      return correlator( m_left, m_right, m_filter );
+    }
+  };
+
+  template <class FilterT>
+  Optimized<FilterT> optimized( ImageView<uint8> const& left, ImageView<uint8> const& right, BBox2i const& search,
+                                int32 kernel, CorrelatorType type, FilterT const& filter, bool single_pass = false ) {
+    return Optimized<FilterT>( left, right, search, kernel, type, filter, single_pass );
+  }
+
+  class Pyramid {
+    ImageView<uint8> m_left, m_right, m_mask;
+    BBox2i m_search;
+    int32 m_kernel;
+    CorrelatorType m_type;
+  public:
+    Pyramid( ImageView<uint8> const& left, ImageView<uint8> const& right, ImageView<uint8> const& mask,
+             BBox2i const& search, int32 kernel, CorrelatorType type )
+      : m_left(left), m_right(right), m_mask(mask), m_search(search), m_kernel(kernel), m_type(type) {}
+    disparity_type operator()() const {
+      PyramidCorrelator correlator( BBox2f( m_search ), Vector2i( m_kernel, m_kernel ), 1, 1, 1, m_type );
+      return correlator( m_left, m_right, m_mask, m_mask, LogStereoPreprocessingFilter() );
+    }
+  };
+
+  class Subpixel {
+    disparity_type m_disparity;
+    ImageView<float32> m_left, m_right;
+    int32 m_kernel, m_mode;
+  public:
+    Subpixel( disparity_type const& disparity, ImageView<float32> const& left, ImageView<float32> const& right,
+              int32 kernel, int32 mode )
+      : m_disparity(disparity), m_left(left), m_right(right), m_kernel(kernel), m_mode(mode) {}
+    disparity_type operator()() const {
+      return subpixel_refine( m_disparity, m_left, m_right, m_kernel, m_kernel,
+                              true, true, m_mode, LogStereoPreprocessingFilter() );
+    }
+  };
+
+  // Runs a stage opt.repeat times and reports the fastest run, the
+  // memory high-water marks of all of them, and the accuracy of the
+  // last.  Returns the disparities, for later stages to start from.
+  template <class FuncT>
+  disparity_type run( Options const& opt, std::string const& name, FuncT const& func ) {
+    disparity_type result;
+    if( !opt.filter.empty() && name.find( opt.filter ) == std::string::npos )
+      return result;
+
+    vw_memory_governor().reset_peaks();
+    reset_rss_peak();
+    double best = std::numeric_limits<double>::max();
+    for( int32 i = 0; i < opt.repeat; ++i ) {
+      result = disparity_type();
+      uint64 start = Stopwatch::microtime();
+      result = func();
+      best = std::min( best, ( Stopwatch::microtime() - start ) * 1e-6 );
+    }
+    double buffer_peak = vw_memory_governor().stats().peak_transient / ( 1024.0 * 1024.0 );
+    double rss_peak = rss_peak_mb();
+
+    // Pixels near the edges see the zeros shifted in, so only the
+    // interior is scored.
+    int32 margin = opt.kernel + int32( std::ceil( opt.disparity ) ) + 2;
+    int64 total = 0, valid = 0, bad = 0;
+    double error = 0;
+    for( int32 j = margin; j < result.rows() - margin; ++j )
+      for( int32 i = margin; i < result.cols() - margin; ++i ) {
+        total++;
+        if( !is_valid( result(i,j) ) )
+          continue;
+        valid++;
+        Vector2f d = result(i,j).child();
+        double e = std::sqrt( ( d[0] - opt.disparity ) * ( d[0] - opt.disparity ) + d[1] * d[1] );
+        error += e;
+        if( e > 1 )
+          bad++;
+      }
+    std::cout << name << "," << best << "," << buffer_peak << "," << rss_peak << ","
+              << ( total ? double( valid ) / total : 0 ) << ","
+              << ( valid ? error / valid : 0 ) << ","
+              << ( valid ? double( bad ) / valid : 0 ) << std::endl;
+    return result;
+  }
+}
+
+int main( int argc, char *argv[] ) {
+  Options opt;
+  for( int i = 1; i < argc; ++i ) {
+    if( std::strcmp( argv[i], "--size" ) == 0 && i+1 < argc )
+      opt.size = std::atoi( argv[++i] );
+    else if( std::strcmp( argv[i], "--texture" ) == 0 && i+1 < argc )
+      opt.texture = float( std::atof( argv[++i] ) );
+    else if( std::strcmp( argv[i], "--disparity" ) == 0 && i+1 < argc )
+      opt.disparity = float( std::atof( argv[++i] ) );
+    else if( std::strcmp( argv[i], "--kernel" ) == 0 && i+1 < argc )
+      opt.kernel = std::atoi( argv[++i] );
+    else if( std::strcmp( argv[i], "--repeat" ) == 0 && i+1 < argc )
+      opt.repeat = std::atoi( argv[++i] );
+    else if( std::strcmp( argv[i], "--filter" ) == 0 && i+1 < argc )
+      opt.filter = argv[++i];
+    else {
+      std::cerr << "Usage: " << argv[0] << " [--size <pixels>] [--texture <sigma>] [--disparity <pixels>]\n"
+                << "         [--kernel <pixels>] [--repeat <n>] [--filter <substring>]" << std::endl;
+      return 1;
+    }
+  }
+  if( opt.size < 4 * opt.kernel || opt.kernel < 3 || opt.repeat < 1 || opt.texture <= 0 || opt.disparity < 0 ) {
+    std::cerr << "Bad options: the size must be at least four kernels, the kernel at least 3, "
+              << "the repeat count positive, the texture positive and the disparity not negative." << std::endl;
+    return 1;
+  }
+
+  vw_memory_governor().set_tracking( true );
+
+  // The right image is the left one moved by the disparity, so the
+  // true disparity is the same at every pixel.
+  boost::rand48 gen(10);
+  ImageView<float32> texture = gaussian_filter( channel_cast<float32>( uniform_noise_view( gen, opt.size, opt.size ) ),
+                                                opt.texture );
+  ImageView<float32> left_f = normalize( texture );
+  ImageView<float32> right_f = transform( left_f, TranslateTransform( opt.disparity, 0 ),
+                                          ZeroEdgeExtension(), BicubicInterpolation() );
+  ImageView<uint8> left = channel_cast_rescale<uint8>( clamp( left_f ) );
+  ImageView<uint8> right = channel_cast_rescale<uint8>( clamp( right_f ) );
+  ImageView<uint8> mask( opt.size, opt.size );
+  fill( mask, uint8(255) );
+  left_f = channel_cast_rescale<float32>( left );
+  right_f = channel_cast_rescale<float32>( right );
+
+  BBox2i search( -4, -4, int32( std::ceil( opt.disparity ) ) + 9, 9 );
+
+  std::cout << "stage,seconds,buffer_peak_mb,rss_peak_mb,valid_fraction,mean_error,bad_1px" << std::endl;
+
+  LogStereoPreprocessingFilter log;
+  disparity_type start = run( opt, "optimized/abs_diff", optimized( left, right, search, opt.kernel, ABS_DIFF_CORRELATOR, log ) );
+  run( opt, "optimized/abs_diff_single_pass", optimized( left, right, search, opt.kernel, ABS_DIFF_CORRELATOR, log, true ) );
+  run( opt, "optimized/sqr_diff", optimized( left, right, search, opt.kernel, SQR_DIFF_CORRELATOR, log ) );
+  run( opt, "optimized/census", optimized( left, right, search, opt.kernel, CENSUS_CORRELATOR,
+                                           CensusStereoPreprocessingFilter<>() ) );
+  disparity_type pyramid = run( opt, "pyramid/abs_diff", Pyramid( left, right, mask, search, opt.kernel, ABS_DIFF_CORRELATOR ) );
+  run( opt, "pyramid/sqr_diff", Pyramid( left, right, mask, search, opt.kernel, SQR_DIFF_CORRELATOR ) );
+
+  // Subpixel refinement starts from whichever integer disparities
+  // were found.
+  if( start.cols() == 0 )
+    start = pyramid;
+  if( start.cols() == 0 )
+    start = optimized( left, right, search, opt.kernel, ABS_DIFF_CORRELATOR, log )();
+  run( opt, "subpixel/none", Subpixel( start, left_f, right_f, opt.kernel, 0 ) );
+  run( opt, "subpixel/parabola", Subpixel( start, left_f, right_f, opt.kernel, 1 ) );
+  run( opt, "subpixel/bayes_em", Subpixel( start, left_f, right_f, opt.kernel, 2 ) );
+
+  return 0;
+}
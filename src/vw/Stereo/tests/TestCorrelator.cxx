@@ -143,3 +143,154 @@ TEST_F( BasicCorrelationTest, BlurPreprocess ) {
                stereo::NORM_XCORR_CORRELATOR );
   check_error( disparity_map, 0.79 );
 }
+
+TEST_F( BasicCorrelationTest, CensusPreprocess ) {
+  // The descriptors are compared by Hamming distance whatever the
+  // correlator type.
+  ImageView<PixelMask<Vector2f> > disparity_map =
+    correlate( image1, image2, mask, CensusStereoPreprocessingFilter<>(),
+               stereo::ABS_DIFF_CORRELATOR );
+  check_error( disparity_map, 0.95 );
+
+  disparity_map =
+    correlate( image1, image2, mask, CensusStereoPreprocessingFilter<uint64>(),
+               stereo::NORM_XCORR_CORRELATOR );
+  check_error( disparity_map, 0.9 );
+}
+
+TEST( CensusFilter, Descriptors ) {
+  ImageView<uint8> image(9,7);
+  fill( image, 10 );
+  image(0,0) = 0;
+  image(8,6) = 0;
+  CensusStereoPreprocessingFilter<uint64> filter;
+  EXPECT_EQ( Vector2i(9,7), filter.window() );
+  ImageView<uint64> codes = filter( image );
+  // The first and last of the 62 neighbours are darker.
+  EXPECT_EQ( (uint64(1) << 61) | 1, codes(4,3) );
+  EXPECT_EQ( 62, census_distance( uint64(0), (uint64(1) << 62) - 1 ) );
+
+  EXPECT_THROW( census_transform<uint32>( image, Vector2i(7,7) ), ArgumentErr );
+  EXPECT_THROW( census_transform<uint32>( image, Vector2i(4,5) ), ArgumentErr );
+}
+
+TEST_F( BasicCorrelationTest, IntegerCorrelation ) {
+  typedef NullStereoPreprocessingFilter FilterT;
+  CorrelatorView<uint8,PixelMask<uint8>,FilterT> corr( image1, image2, mask, mask, FilterT(), false );
+  corr.set_search_range( BBox2i(0,0,6,6) );
+  corr.set_kernel_size( Vector2i(7,7) );
+  corr.set_integer_correlation( true );
+  EXPECT_TRUE( corr.integer_correlation() );
+
+  corr.set_correlator_options( 1, stereo::ABS_DIFF_CORRELATOR );
+  ImageView<PixelMask<Vector2f> > disparity_map = corr;
+  check_error( disparity_map, 0.95 );
+
+  corr.set_correlator_options( 1, stereo::CENSUS_CORRELATOR );
+  disparity_map = corr;
+  check_error( disparity_map, 0.95 );
+}
+
+TEST_F( BasicCorrelationTest, SinglePassCrossCheck ) {
+  ImageView<float> left = channel_cast<float>(image1), right = channel_cast<float>(image2);
+  BBox2i window(0,0,6,6), r2l_window(-6,-6,6,6);
+  ImageView<PixelMask<Vector2f> > r2l;
+  ImageView<PixelMask<Vector2f> > l2r =
+    stereo::correlate( boost::shared_ptr<StereoCostFunction>( new AbsDifferenceCost( left, right, window, 7 ) ),
+                       window, r2l );
+  ImageView<PixelMask<Vector2f> > expected_l2r =
+    stereo::correlate( boost::shared_ptr<StereoCostFunction>( new AbsDifferenceCost( left, right, window, 7 ) ),
+                       window );
+  ImageView<PixelMask<Vector2f> > expected_r2l =
+    stereo::correlate( boost::shared_ptr<StereoCostFunction>( new AbsDifferenceCost( right, left, r2l_window, 7 ) ),
+                       r2l_window );
+  ASSERT_EQ( r2l.cols(), expected_r2l.cols() );
+  ASSERT_EQ( r2l.rows(), expected_r2l.rows() );
+
+  // The left to right disparities are unchanged, and the right to
+  // left ones agree away from the edges, where the right pixels do
+  // not see every disparity of the search window.
+  BBox2i interior(10,10,30,30);
+  int same = 0, valid = 0;
+  for (int j = 0; j < l2r.rows(); ++j)
+    for (int i = 0; i < l2r.cols(); ++i) {
+      EXPECT_EQ( is_valid( l2r(i,j) ), is_valid( expected_l2r(i,j) ) );
+      if ( is_valid( l2r(i,j) ) )
+        EXPECT_EQ( l2r(i,j).child(), expected_l2r(i,j).child() );
+      if ( interior.contains( Vector2i(i,j) ) && is_valid( expected_r2l(i,j) ) ) {
+        valid++;
+        if ( is_valid( r2l(i,j) ) && r2l(i,j).child() == expected_r2l(i,j).child() )
+          same++;
+      }
+    }
+  ASSERT_GT( valid, 0 );
+  EXPECT_GT( float(same)/float(valid), 0.98 );
+
+  typedef NullStereoPreprocessingFilter FilterT;
+  CorrelatorView<uint8,PixelMask<uint8>,FilterT> corr = correlate( image1, image2, mask, FilterT() );
+  corr.set_single_pass_cross_check( true );
+  EXPECT_TRUE( corr.single_pass_cross_check() );
+  ImageView<PixelMask<Vector2f> > disparity_map = corr;
+  check_error( disparity_map, 0.95 );
+}
+
+TEST_F( BasicCorrelationTest, SearchRangeSeed ) {
+  typedef NullStereoPreprocessingFilter FilterT;
+  CorrelatorView<uint8,PixelMask<uint8>,FilterT> corr( image1, image2, mask, mask, FilterT(), false );
+  corr.set_search_range( BBox2i(-20,-20,40,40) );
+  corr.set_kernel_size( Vector2i(7,7) );
+
+  // The left half is searched near the true disparity, and the right
+  // half not at all.
+  ImageView<BBox2i> seed(2,1);
+  seed(0,0) = BBox2i(1,1,4,4);
+  corr.set_search_range_seed( seed, Vector2i(25,50) );
+  EXPECT_EQ( 2, corr.search_range_seed().cols() );
+
+  ImageView<PixelMask<Vector2f> > disparity_map = crop( corr, BBox2i(0,0,25,50) );
+  check_error( disparity_map, 0.95 );
+  ImageView<PixelMask<Vector2f> > empty = crop( corr, BBox2i(25,0,25,50) );
+  for (int j = 0; j < empty.rows(); ++j)
+    for (int i = 0; i < empty.cols(); ++i)
+      EXPECT_FALSE( is_valid( empty(i,j) ) );
+
+  EXPECT_THROW( corr.set_search_range_seed( seed, Vector2i(10,10) ), ArgumentErr );
+}
+
+TEST( PyramidCorrelation, SharedPyramid ) {
+  boost::rand48 gen(10);
+  // Texture at every level of the pyramid.
+  ImageView<uint8> image1 =
+    channel_cast<uint8>(normalize(gaussian_filter(channel_cast<float>(uniform_noise_view( gen, 320, 320 )), 2.0), 0, 255));
+  ImageView<uint8> image2 = transform(image1, TranslateTransform(3,3),
+                                      ZeroEdgeExtension(), NearestPixelInterpolation());
+  ImageView<PixelMask<uint8> > mask(320,320);
+  fill(mask,PixelMask<uint8>(255));
+
+  typedef LogStereoPreprocessingFilter FilterT;
+  CorrelatorView<uint8,PixelMask<uint8>,FilterT> corr( image1, image2, mask, mask, FilterT() );
+  corr.set_search_range( BBox2i(-8,-8,16,16) );
+  corr.set_kernel_size( Vector2i(7,7) );
+  EXPECT_TRUE( corr.pyramid_cache() );
+
+  // Several blocks, each read out of the shared pyramids.
+  ImageView<PixelMask<Vector2f> > cached = block_rasterize( corr, Vector2i(192,192), 1 );
+  corr.set_pyramid_cache( false );
+  EXPECT_FALSE( corr.pyramid_cache() );
+  ImageView<PixelMask<Vector2f> > uncached = block_rasterize( corr, Vector2i(192,192), 1 );
+
+  int count_cached = 0, count_uncached = 0, count_valid = 0;
+  for (int j = 0; j < cached.rows(); ++j)
+    for (int i = 0; i < cached.cols(); ++i) {
+      if ( is_valid( uncached(i,j) ) ) {
+        count_valid++;
+        if ( uncached(i,j).child() == Vector2f(3,3) )
+          count_uncached++;
+      }
+      if ( is_valid( cached(i,j) ) && cached(i,j).child() == Vector2f(3,3) )
+        count_cached++;
+    }
+  ASSERT_GT( count_valid, 0 );
+  EXPECT_GT( float(count_uncached)/float(count_valid), 0.9 );
+  EXPECT_GT( float(count_cached), 0.98*count_uncached );
+}
@@ -0,0 +1,148 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// TestCostVolumeCorrelator.h
+#include <gtest/gtest.h>
+
+#include <vw/Image/UtilityViews.h>
+#include <vw/Image/Transform.h>
+#include <vw/Stereo/CostVolumeCorrelator.h>
+
+#include <boost/random/linear_congruential.hpp>
+#include <boost/make_shared.hpp>
+
+using namespace vw;
+using namespace vw::stereo;
+
+class CostVolumeTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    boost::rand48 gen(10);
+    image1 = 255*uniform_noise_view( gen, 60, 45 );
+    image2 = transform(image1, TranslateTransform(3,2),
+                       ZeroEdgeExtension(), NearestPixelInterpolation());
+    left = channel_cast<float>(image1);
+    right = channel_cast<float>(image2);
+  }
+
+  // The disparities OptimizedCorrelator finds with the given cost.
+  ImageView<PixelMask<Vector2f> > reference( boost::shared_ptr<StereoCostFunction> cost,
+                                             BBox2i const& search_window ) {
+    return stereo::correlate( cost, search_window );
+  }
+
+  void expect_same( ImageView<PixelMask<Vector2f> > const& expected,
+                    ImageView<PixelMask<Vector2f> > const& actual ) {
+    ASSERT_EQ( expected.cols(), actual.cols() );
+    ASSERT_EQ( expected.rows(), actual.rows() );
+    int32 valid = 0;
+    for( int32 j = 0; j < expected.rows(); ++j )
+      for( int32 i = 0; i < expected.cols(); ++i ) {
+        ASSERT_EQ( is_valid(expected(i,j)), is_valid(actual(i,j)) ) << "at " << i << "," << j;
+        if( is_valid(expected(i,j)) ) {
+          ++valid;
+          EXPECT_EQ( expected(i,j).child(), actual(i,j).child() ) << "at " << i << "," << j;
+        }
+      }
+    EXPECT_GT( valid, 0 );
+  }
+
+  ImageView<uint8> image1, image2;
+  ImageView<float> left, right;
+};
+
+TEST_F( CostVolumeTest, AbsDifference ) {
+  // Twelve disparities across, so one group of lanes is partial.
+  BBox2i window(-3,-2,11,4);
+  ImageView<PixelMask<Vector2f> > expected =
+    reference( boost::make_shared<AbsDifferenceCost>( left, right, window, 7 ), window );
+  expect_same( expected, cost_volume_correlate( left, right, window, 7, ABS_DIFF_CORRELATOR ) );
+  expect_same( expected, cost_volume_correlate( image1, image2, window, 7, ABS_DIFF_CORRELATOR ) );
+
+  ImageView<uint16> wide1 = channel_cast<uint16>(image1*uint16(200));
+  ImageView<uint16> wide2 = channel_cast<uint16>(image2*uint16(200));
+  expect_same( expected, cost_volume_correlate( wide1, wide2, window, 7, ABS_DIFF_CORRELATOR ) );
+}
+
+TEST_F( CostVolumeTest, SqDifference ) {
+  BBox2i window(0,0,6,6);
+  ImageView<PixelMask<Vector2f> > expected =
+    reference( boost::make_shared<SqDifferenceCost>( left, right, window, 5 ), window );
+  expect_same( expected, cost_volume_correlate( left, right, window, 5, SQR_DIFF_CORRELATOR ) );
+}
+
+TEST_F( CostVolumeTest, NormXCorr ) {
+  // Computed in float rather than double, so near ties may go the
+  // other way.
+  BBox2i window(0,0,6,6);
+  ImageView<PixelMask<Vector2f> > expected =
+    reference( boost::make_shared<NormXCorrCost>( left, right, window, 7 ), window );
+  ImageView<PixelMask<Vector2f> > result =
+    cost_volume_correlate( left, right, window, 7, NORM_XCORR_CORRELATOR );
+  int32 valid = 0, same = 0, correct = 0;
+  for( int32 j = 0; j < result.rows(); ++j )
+    for( int32 i = 0; i < result.cols(); ++i ) {
+      if( !is_valid(expected(i,j)) ) continue;
+      ++valid;
+      if( is_valid(result(i,j)) && result(i,j).child() == expected(i,j).child() )
+        ++same;
+      if( is_valid(result(i,j)) && result(i,j).child() == Vector2f(3,2) )
+        ++correct;
+    }
+  ASSERT_GT( valid, 0 );
+  EXPECT_GT( float(same)/float(valid), 0.99 );
+  EXPECT_GT( float(correct)/float(valid), 0.85 );
+}
+
+TEST_F( CostVolumeTest, Census ) {
+  // The census transform only compares pixels, so scaling the images
+  // leaves the costs alone.
+  BBox2i window(-3,-2,11,4);
+  ImageView<PixelMask<Vector2f> > expected =
+    reference( boost::make_shared<CensusCost>( left, right, window, 5 ), window );
+  expect_same( expected, cost_volume_correlate( left, right, window, 5, CENSUS_CORRELATOR ) );
+  expect_same( expected, cost_volume_correlate( image1, image2, window, 5, CENSUS_CORRELATOR ) );
+
+  ImageView<uint16> wide1 = channel_cast<uint16>(image1*uint16(200));
+  ImageView<uint16> wide2 = channel_cast<uint16>(image2*uint16(200));
+  expect_same( expected, cost_volume_correlate( wide1, wide2, window, 5, CENSUS_CORRELATOR ) );
+}
+
+TEST( Census, Transform ) {
+  ImageView<uint8> image(5,5);
+  fill( image, 10 );
+  image(0,0) = 0;
+  image(4,4) = 20;
+  ImageView<uint32> census = census_transform( image );
+  // Only the top left corner, the first bit, is darker.
+  EXPECT_EQ( 1u, census(2,2) );
+  EXPECT_EQ( 0, census_distance( census(2,2), census(2,2) ) );
+  EXPECT_EQ( 24, census_distance( 0u, 0xffffffu ) );
+  EXPECT_EQ( 4, census_distance( 0x13u, 0x08u ) );
+}
+
+TEST_F( CostVolumeTest, Correlator ) {
+  // The same disparities as OptimizedCorrelator, cross-checked.
+  BBox2i window(0,0,6,6);
+  OptimizedCorrelator optimized( window, 7, 1, -1, 1, ABS_DIFF_CORRELATOR );
+  CostVolumeCorrelator cost_volume( window, 7, 1, -1, 1, ABS_DIFF_CORRELATOR );
+  expect_same( optimized( image1, image2, NullStereoPreprocessingFilter() ),
+               cost_volume( image1, image2, NullStereoPreprocessingFilter() ) );
+  expect_same( optimized( image1, image2, SlogStereoPreprocessingFilter() ),
+               cost_volume( image1, image2, SlogStereoPreprocessingFilter() ) );
+
+  // Without preprocessing, in the images' own channel type.
+  OptimizedCorrelator census_optimized( window, 5, 1, -1, 1, CENSUS_CORRELATOR );
+  CostVolumeCorrelator census_cost_volume( window, 5, 1, -1, 1, CENSUS_CORRELATOR );
+  expect_same( census_optimized( image1, image2, NullStereoPreprocessingFilter() ),
+               census_cost_volume( image1, image2 ) );
+}
+
+TEST_F( CostVolumeTest, Isa ) {
+  std::string isa = cost_volume_isa();
+  EXPECT_TRUE( isa == "avx2" || isa == "none" );
+}
@@ -13,10 +13,16 @@
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/Transform.h>
+#include <vw/Image/BlockRasterize.h>
 #include <test/Helpers.h>
 
+#include <boost/random/linear_congruential.hpp>
+#include <boost/random/uniform_int.hpp>
+#include <boost/random/variate_generator.hpp>
+
 using namespace vw;
 using namespace vw::stereo;
+using namespace vw::test;
 
 typedef PixelMask<Vector2f> PixelDisp;
 
@@ -206,3 +212,149 @@ TEST( DisparityMap, GetDisparityRange ) {
   EXPECT_VECTOR_EQ( Vector2f(), range.min() );
   EXPECT_VECTOR_EQ( Vector2f(), range.max() );
 }
+
+TEST( DisparityMap, BlockDisparityRange ) {
+  boost::rand48 gen(5);
+  boost::variate_generator<boost::rand48&, boost::uniform_int<> > random( gen, boost::uniform_int<>(-20,20) );
+  ImageView<PixelDisp> disparity(70,50);
+  for ( int32 j = 0; j < disparity.rows(); ++j )
+    for ( int32 i = 0; i < disparity.cols(); ++i ) {
+      disparity(i,j) = PixelDisp( Vector2f( random(), random() ) / 2 );
+      if ( random() > 10 )
+        disparity(i,j).invalidate();
+    }
+  disparity(3,7) = PixelDisp( Vector2f( -40, 30 ) );
+  disparity(3,7).invalidate();
+
+  BBox2f expected = get_disparity_range( disparity );
+  BBox2f range = get_disparity_range( disparity, Vector2i(16,16), 1, BBox2f(), 4 );
+  EXPECT_VECTOR_EQ( expected.min(), range.min() );
+  EXPECT_VECTOR_EQ( expected.max(), range.max() );
+
+  // Sampling every other pixel only sees the even coordinates.
+  ImageView<PixelDisp> even = disparity;
+  for ( int32 j = 0; j < even.rows(); ++j )
+    for ( int32 i = 0; i < even.cols(); ++i )
+      if ( i % 2 || j % 2 )
+        even(i,j).invalidate();
+  expected = get_disparity_range( even );
+  range = get_disparity_range( disparity, Vector2i(15,15), 2 );
+  EXPECT_VECTOR_EQ( expected.min(), range.min() );
+  EXPECT_VECTOR_EQ( expected.max(), range.max() );
+
+  // Once the range covers the limit the rest of the map is skipped.
+  range = get_disparity_range( disparity, Vector2i(10,10), 1, BBox2f(-1,-1,2,2), 1 );
+  EXPECT_TRUE( range.contains( BBox2f(-1,-1,2,2) ) );
+  EXPECT_TRUE( get_disparity_range( disparity ).contains( range ) );
+
+  ImageView<PixelDisp> invalid(20,20);
+  range = get_disparity_range( invalid, Vector2i(8,8) );
+  EXPECT_VECTOR_EQ( Vector2f(), range.min() );
+  EXPECT_VECTOR_EQ( Vector2f(), range.max() );
+}
+
+TEST( DisparityMap, CachedDisparityRange ) {
+  ImageView<PixelDisp> disparity(4,1);
+  disparity(0,0) = PixelDisp(Vector2f(2,2));
+  disparity(1,0) = PixelDisp(Vector2f(3,5));
+
+  UnlinkName filename("disparity.tif");
+  UnlinkName range_filename("disparity.tif.range");
+  BBox2f range;
+  EXPECT_FALSE( read_disparity_range( filename, Vector2i(4,1), range ) );
+  range = cached_disparity_range( disparity, filename );
+  EXPECT_VECTOR_EQ( Vector2f(2,2), range.min() );
+  EXPECT_VECTOR_EQ( Vector2f(3,5), range.max() );
+
+  // The second time the range comes from the file.
+  disparity(2,0) = PixelDisp(Vector2f(10,10));
+  range = cached_disparity_range( disparity, filename );
+  EXPECT_VECTOR_EQ( Vector2f(3,5), range.max() );
+  EXPECT_FALSE( read_disparity_range( filename, Vector2i(5,1), range ) );
+}
+
+TEST( DisparityMap, SearchRangeSeed ) {
+  ImageView<PixelDisp> disparity(3,2);
+  disparity(0,0) = PixelDisp(Vector2f(1,0));
+  disparity(1,1) = PixelDisp(Vector2f(2,-1.5));
+  disparity(2,0) = PixelDisp(Vector2f(5,5));
+  disparity(2,0).invalidate();
+
+  // Two coarse pixels per region, at a quarter of full resolution.
+  ImageView<BBox2i> seed = search_range_seed(disparity, 4, 2, 1);
+  ASSERT_EQ( 2, seed.cols() );
+  ASSERT_EQ( 1, seed.rows() );
+  EXPECT_VECTOR_EQ( Vector2i(3,-7), seed(0,0).min() );
+  EXPECT_VECTOR_EQ( Vector2i(9,1), seed(0,0).max() );
+  EXPECT_TRUE( seed(1,0) == BBox2i() );
+}
+
+namespace {
+  // remove_outliers() a pixel at a time, as RemoveOutliersFunc does it.
+  template <class ViewT>
+  ImageView<PixelDisp> remove_outliers_per_pixel( ImageViewBase<ViewT> const& view,
+                                                  int32 half_h_kernel, int32 half_v_kernel,
+                                                  float pixel_threshold, float rejection_threshold ) {
+    typedef RemoveOutliersFunc<PixelDisp> func_type;
+    return UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ZeroEdgeExtension>, func_type>
+      ( edge_extend(view.impl(), ZeroEdgeExtension()),
+        func_type(half_h_kernel, half_v_kernel, pixel_threshold, rejection_threshold) );
+  }
+
+  void expect_same( ImageView<PixelDisp> const& expected, ImageView<PixelDisp> const& actual ) {
+    ASSERT_EQ( expected.cols(), actual.cols() );
+    ASSERT_EQ( expected.rows(), actual.rows() );
+    for ( int32 j = 0; j < expected.rows(); ++j )
+      for ( int32 i = 0; i < expected.cols(); ++i ) {
+        ASSERT_EQ( is_valid(expected(i,j)), is_valid(actual(i,j)) ) << "at " << i << "," << j;
+        if ( is_valid(expected(i,j)) )
+          EXPECT_VECTOR_DOUBLE_EQ( expected(i,j).child(), actual(i,j).child() );
+      }
+  }
+}
+
+TEST( DisparityMap, RemoveOutliers ) {
+  // Smooth disparities with scattered outliers and holes.
+  boost::rand48 gen(5);
+  boost::variate_generator<boost::rand48&, boost::uniform_int<> > noise( gen, boost::uniform_int<>(0,99) );
+  ImageView<PixelDisp> map(61,47);
+  for ( int32 j = 0; j < map.rows(); ++j )
+    for ( int32 i = 0; i < map.cols(); ++i ) {
+      int32 r = noise();
+      if ( r < 15 )
+        continue;
+      map(i,j) = PixelDisp( Vector2f( 0.1*i + (r < 30 ? 6 : 0), 0.05*j - (r % 4) ) );
+    }
+
+  int32 invalid_before = 0;
+  for ( int32 j = 0; j < map.rows(); ++j )
+    for ( int32 i = 0; i < map.cols(); ++i )
+      if ( !is_valid(map(i,j)) ) invalid_before++;
+
+  expect_same( remove_outliers_per_pixel( map, 5, 5, 3.0, 0.5 ),
+               remove_outliers( map, 5, 5, 3.0, 0.5 ) );
+  expect_same( remove_outliers_per_pixel( map, 1, 3, 1.0, 0.75 ),
+               remove_outliers( map, 1, 3, 1.0, 0.75 ) );
+  expect_same( remove_outliers_per_pixel( map, 2, 2, 0.5, 0.0 ),
+               remove_outliers( map, 2, 2, 0.5, 0.0 ) );
+  expect_same( remove_outliers_per_pixel( map, 2, 2, 0.5, 1.5 ),
+               remove_outliers( map, 2, 2, 0.5, 1.5 ) );
+
+  ImageView<PixelDisp> expected =
+    remove_outliers_per_pixel( remove_outliers_per_pixel( map, 5, 5, 3.0, 0.5 ), 1, 1, 1.0, 0.75 );
+  RemoveOutliersView<RemoveOutliersView<ImageView<PixelDisp> > > clean =
+    disparity_clean_up( map, 5, 5, 3.0, 0.5 );
+  ImageView<PixelDisp> serial = clean;
+  expect_same( expected, serial );
+  EXPECT_EQ( map.cols()*map.rows(), clean.func().total_points() );
+  int32 invalid_after = 0;
+  for ( int32 j = 0; j < map.rows(); ++j )
+    for ( int32 i = 0; i < map.cols(); ++i )
+      if ( !is_valid(serial(i,j)) ) invalid_after++;
+  EXPECT_GT( invalid_after, invalid_before );
+  EXPECT_EQ( invalid_after - invalid_before,
+             clean.func().rejected_points() + clean.child().func().rejected_points() );
+
+  // In blocks, on several threads.
+  expect_same( expected, block_rasterize( disparity_clean_up( map, 5, 5, 3.0, 0.5 ), Vector2i(16,16), 4 ) );
+}
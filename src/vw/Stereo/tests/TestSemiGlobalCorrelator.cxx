@@ -0,0 +1,116 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// TestSemiGlobalCorrelator.h
+#include <gtest/gtest.h>
+
+#include <vw/Image/UtilityViews.h>
+#include <vw/Image/Transform.h>
+#include <vw/Stereo/CorrelatorView.h>
+#include <vw/Stereo/SemiGlobalCorrelator.h>
+
+#include <boost/random/linear_congruential.hpp>
+
+using namespace vw;
+using namespace vw::stereo;
+
+class SemiGlobalTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    boost::rand48 gen(10);
+    image1 = 255*uniform_noise_view( gen, 60, 50 );
+    image2 = transform(image1, TranslateTransform(3,2),
+                       ZeroEdgeExtension(), NearestPixelInterpolation());
+  }
+
+  template <class ViewT>
+  float fraction_correct( ImageViewBase<ViewT> const& input ) {
+    ViewT const& disparity_map = input.impl();
+    int count_correct = 0;
+    int count_valid = 0;
+    for (int j = 0; j < disparity_map.rows(); ++j)
+      for (int i = 0; i < disparity_map.cols(); ++i)
+        if ( is_valid( disparity_map(i,j) ) ) {
+          count_valid++;
+          if ( disparity_map(i,j).child() == Vector2f(3,2) )
+            count_correct++;
+        }
+    EXPECT_GT( count_valid, 0 );
+    return float(count_correct)/float(count_valid);
+  }
+
+  ImageView<uint8> image1, image2;
+};
+
+TEST_F( SemiGlobalTest, Translation ) {
+  // A kernel too small for a window correlator on its own.
+  SemiGlobalCorrelator correlator( BBox2i(0,0,6,6), 3, 1 );
+  EXPECT_GT( fraction_correct( correlator( image1, image2, NullStereoPreprocessingFilter() ) ), 0.97 );
+
+  SemiGlobalCorrelator ncc( BBox2i(0,0,6,6), 5, 1, 8, 96, NORM_XCORR_CORRELATOR );
+  EXPECT_GT( fraction_correct( ncc( image1, image2, NullStereoPreprocessingFilter() ) ), 0.95 );
+}
+
+TEST_F( SemiGlobalTest, RightToLeft ) {
+  ImageView<float> left = channel_cast<float>(image1), right = channel_cast<float>(image2);
+  BBox2i window(0,0,6,6);
+  ImageView<PixelMask<Vector2f> > r2l;
+  ImageView<PixelMask<Vector2f> > l2r =
+    semi_global_correlate( boost::shared_ptr<StereoCostFunction>( new AbsDifferenceCost( left, right, window, 3 ) ),
+                           window, 255, 8, 96, r2l );
+  ASSERT_EQ( l2r.cols(), r2l.cols() );
+  ASSERT_EQ( l2r.rows(), r2l.rows() );
+  EXPECT_GT( fraction_correct( l2r ), 0.97 );
+
+  int count_correct = 0, count_valid = 0;
+  for (int j = 0; j < r2l.rows(); ++j)
+    for (int i = 0; i < r2l.cols(); ++i)
+      if ( is_valid( r2l(i,j) ) ) {
+        count_valid++;
+        if ( r2l(i,j).child() == Vector2f(-3,-2) )
+          count_correct++;
+      }
+  ASSERT_GT( count_valid, 0 );
+  EXPECT_GT( float(count_correct)/float(count_valid), 0.9 );
+
+  EXPECT_THROW( semi_global_correlate( boost::shared_ptr<StereoCostFunction>( new AbsDifferenceCost( left, right, window, 3 ) ),
+                                       window, 255, 96, 8, r2l ), ArgumentErr );
+}
+
+TEST_F( SemiGlobalTest, Strips ) {
+  SemiGlobalCorrelator whole( BBox2i(0,0,6,6), 3, 1 );
+  SemiGlobalCorrelator strips( BBox2i(0,0,6,6), 3, 1 );
+  // Room for 80 rows at a time, which with the rows around each strip
+  // splits the 50 rows in two.
+  strips.set_memory_limit( 60 * 49 * 4 * 80 );
+  ImageView<PixelMask<Vector2f> > expected = whole( image1, image2, NullStereoPreprocessingFilter() );
+  ImageView<PixelMask<Vector2f> > result = strips( image1, image2, NullStereoPreprocessingFilter() );
+
+  int same = 0, valid = 0;
+  for (int j = 0; j < expected.rows(); ++j)
+    for (int i = 0; i < expected.cols(); ++i)
+      if ( is_valid( expected(i,j) ) ) {
+        valid++;
+        if ( is_valid( result(i,j) ) && result(i,j).child() == expected(i,j).child() )
+          same++;
+      }
+  ASSERT_GT( valid, 0 );
+  EXPECT_GT( float(same)/float(valid), 0.98 );
+}
+
+TEST_F( SemiGlobalTest, CorrelatorView ) {
+  ImageView<PixelMask<uint8> > mask(60,50);
+  fill(mask,PixelMask<uint8>(255));
+  typedef NullStereoPreprocessingFilter FilterT;
+  CorrelatorView<uint8,PixelMask<uint8>,FilterT> corr( image1, image2, mask, mask, FilterT(), false );
+  corr.set_search_range( BBox2i(0,0,6,6) );
+  corr.set_kernel_size( Vector2i(3,3) );
+  corr.set_semi_global_options( true );
+  EXPECT_TRUE( corr.semi_global() );
+  ImageView<PixelMask<Vector2f> > disparity_map = corr;
+  EXPECT_GT( fraction_correct( disparity_map ), 0.95 );
+}
@@ -12,6 +12,7 @@
 #include <vw/Stereo/StereoModel.h>
 #include <vw/Stereo/StereoView.h>
 #include <vw/Camera/PinholeModel.h>
+#include <vw/Camera/LinearPushbroomModel.h>
 #include <vw/Camera/CameraModel.h>
 #include <vw/Math/EulerAngles.h>
 
@@ -215,3 +216,42 @@ TEST( StereoView, Float ) {
   EXPECT_VECTOR_NEAR( lpc(2,0), Vector3(0.769,0,0.769), 1e-2 );
 
 }
+
+TEST( StereoView, Blocks ) {
+  // Two pushbroom cameras looking down from either side, so each line
+  // has its own camera position.
+  Quaternion<double> pose(0,0,0,1);
+  LinearPushbroomModel cam1( 10.0, 40, 30, -15, 1.0, 0.01, 0.01,
+                             Vector3(0,0,1), Vector3(0,1,0), pose,
+                             Vector3(0,0,1), Vector3(1,0,0) );
+  LinearPushbroomModel cam2( 10.0, 40, 30, -15, 1.0, 0.01, 0.01,
+                             Vector3(0,0,1), Vector3(0,1,0), pose,
+                             Vector3(0,0.5,1), Vector3(1,0,0) );
+
+  // Some invalid pixels, and some that match pixels off the second
+  // image.
+  ImageView<PixelMask<Vector2f> > disparity(30,40);
+  for ( int32 j = 0; j < disparity.rows(); ++j )
+    for ( int32 i = 0; i < disparity.cols(); ++i )
+      if ( (i + j) % 7 != 0 )
+        disparity(i,j) = PixelMask<Vector2f>( Vector2f( -4 - 0.1*i, j < 5 ? -6.5 : 0.25 ) );
+
+  // The blocks are triangulated together, the view's pixels one at a
+  // time.
+  StereoView<ImageView<PixelMask<Vector2f> > > view( disparity, &cam1, &cam2 );
+  ImageView<Vector3> points = view;
+  ImageView<Vector3> block = crop( view, BBox2i(3,2,20,30) );
+  int32 nonzero = 0, zero = 0;
+  for ( int32 j = 0; j < disparity.rows(); ++j )
+    for ( int32 i = 0; i < disparity.cols(); ++i ) {
+      EXPECT_VECTOR_DOUBLE_EQ( view(i,j), points(i,j) );
+      if ( points(i,j) != Vector3() )
+        ++nonzero;
+      else
+        ++zero;
+      if ( i >= 3 && i < 23 && j >= 2 && j < 32 )
+        EXPECT_VECTOR_DOUBLE_EQ( view(i,j), block(i-3,j-2) );
+    }
+  EXPECT_GT( nonzero, 0 );
+  EXPECT_GT( zero, 30*40/7 );
+}
@@ -26,6 +26,8 @@
 // Qt
 #include <QtGui>
 
+#include <cstring>
+
 // Vision Workbench
 #include <vw/Image.h>
 #include <vw/FileIO.h>
@@ -34,6 +36,12 @@
 using namespace vw;
 using namespace vw::gui;
 
+// The number of pixel buffer objects that tiles are staged in for
+// upload, and the most tiles uploaded per frame.  Tiles arriving in a
+// burst are spread over several frames instead of stalling one.
+const int VW_GUI_NUM_UPLOAD_BUFFERS = 4;
+const size_t VW_GUI_MAX_UPLOADS_PER_FRAME = 8;
+
 const std::string g_FRAGMENT_PROGRAM =
 "uniform sampler2D tex;                             \n"
 "                                                   \n"
@@ -185,6 +193,7 @@ GlPreviewWidget::GlPreviewWidget(QWidget *parent, std::string filename, QGLForma
   m_gamma = 1.0;
   m_current_transaction_id = transaction_id;
   m_exact_transaction_id_match = false;
+  m_next_upload_buffer = 0;
 
   // Set mouse tracking
   this->setMouseTracking(true);
@@ -202,6 +211,10 @@ GlPreviewWidget::GlPreviewWidget(QWidget *parent, std::string filename, QGLForma
 
 GlPreviewWidget::~GlPreviewWidget() {
   m_gl_texture_cache.reset();
+  if (!m_upload_buffers.empty()) {
+    makeCurrent();
+    glDeleteBuffers(m_upload_buffers.size(), &m_upload_buffers[0]);
+  }
 }
 
 void GlPreviewWidget::size_to_fit() {
@@ -314,9 +327,37 @@ GLuint GlPreviewWidget::allocate_texture(boost::shared_ptr<SrcImageResource> til
              << " Unsupported channel type (" << tile->channel_type() << ").");
   }
 
-  glTexImage2D(GL_TEXTURE_2D, 0, texture_pixel_type,
-               tile->cols(), tile->rows(), 0,
-               source_pixel_type, source_channel_type, tile->native_ptr().get() );
+  // Stage the tile in the next pixel buffer object of the ring, so
+  // that glTexImage2D copies it to the card asynchronously rather than
+  // blocking on the transfer from system memory.  Respecifying the
+  // buffer's storage first lets the driver hand back fresh memory if
+  // the buffer's previous upload is still in flight.
+  boost::shared_array<const uint8> tile_data = tile->native_ptr();
+  bool uploaded = false;
+  if (!m_upload_buffers.empty()) {
+    size_t tile_bytes = size_t(tile->cols()) * tile->rows() * tile->channels() *
+                        channel_size(tile->channel_type());
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, m_upload_buffers[m_next_upload_buffer]);
+    m_next_upload_buffer = (m_next_upload_buffer + 1) % m_upload_buffers.size();
+    glBufferData(GL_PIXEL_UNPACK_BUFFER_ARB, tile_bytes, 0, GL_STREAM_DRAW);
+    void* staging = glMapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY);
+    if (staging) {
+      memcpy(staging, tile_data.get(), tile_bytes);
+      if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB)) {
+        glTexImage2D(GL_TEXTURE_2D, 0, texture_pixel_type,
+                     tile->cols(), tile->rows(), 0,
+                     source_pixel_type, source_channel_type, 0 );
+        uploaded = true;
+      }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+  }
+
+  // Fall back on a direct upload if the buffer could not be mapped.
+  if (!uploaded)
+    glTexImage2D(GL_TEXTURE_2D, 0, texture_pixel_type,
+                 tile->cols(), tile->rows(), 0,
+                 source_pixel_type, source_channel_type, tile_data.get() );
 
   glBindTexture(GL_TEXTURE_2D, 0);
   glDisable( GL_TEXTURE_2D );
@@ -349,6 +390,10 @@ void GlPreviewWidget::initializeGL() {
   glLinkProgram(m_glsl_program);
   print_program_info_log(m_glsl_program);
 
+  // Create the ring of pixel buffer objects used to upload tiles.
+  m_upload_buffers.resize(VW_GUI_NUM_UPLOAD_BUFFERS);
+  glGenBuffers(m_upload_buffers.size(), &m_upload_buffers[0]);
+
   // Now that GL is setup, we can start the Qt Timer
   m_timer = new QTimer(this);
   connect(m_timer, SIGNAL(timeout()), this, SLOT(timer_callback()));
@@ -373,8 +418,9 @@ void GlPreviewWidget::drawImage() {
 
   // Before we draw this frame, we will check to see whether there are
   // any new texture to upload or delete from the texture cache.  If
-  // there are, we perform at least one of these operations.
-  this->process_allocation_requests();
+  // there are, we perform at least one of these operations, and at
+  // most VW_GUI_MAX_UPLOADS_PER_FRAME uploads.
+  this->process_allocation_requests(VW_GUI_MAX_UPLOADS_PER_FRAME);
 
   // Activate our GLSL fragment program and set up the uniform
   // variables in the shader
@@ -437,6 +483,11 @@ void GlPreviewWidget::drawImage() {
   if (level > max_level) level = max_level;
   m_current_level = level;
 
+  // Start a new frame of texture requests, so that the tiles nearest
+  // the center of the view are fetched first and those that have
+  // scrolled out of view are not fetched at all.
+  m_gl_texture_cache->set_viewport(m_current_viewport);
+
   std::list<TileLocator> tiles = bbox_to_tiles(tile_size, m_current_viewport, level, max_level, m_current_transaction_id, m_exact_transaction_id_match);
   std::list<TileLocator>::iterator tile_iter = tiles.begin();
 
@@ -542,6 +593,20 @@ void GlPreviewWidget::drawImage() {
   }
   //  std::cout << "\n";
 
+  // Prefetch the ring of tiles just outside the view, so that they
+  // are ready when the view pans onto them.  They are further from
+  // the center of the view than the visible tiles, so they are
+  // fetched after them.
+  BBox2 prefetch_bbox = m_current_viewport;
+  prefetch_bbox.expand( tile_size[0] * (1 << (max_level - level)) );
+  std::list<TileLocator> prefetch_tiles = bbox_to_tiles(tile_size, prefetch_bbox, level, max_level, m_current_transaction_id, m_exact_transaction_id_match);
+  for (tile_iter = prefetch_tiles.begin(); tile_iter != prefetch_tiles.end(); ++tile_iter) {
+    BBox2i texture_bbox = tile_to_bbox(tile_size, tile_iter->col, tile_iter->row, tile_iter->level, max_level);
+    if (tile_iter->is_valid() && !texture_bbox.intersects(m_current_viewport) &&
+        texture_bbox.intersects(image_bbox))
+      m_gl_texture_cache->get_texture_id(*tile_iter, this);
+  }
+
   // Restore the previous OpenGL state so that we don't trample on the
   // QPainter elements of the window.
   glMatrixMode(GL_MODELVIEW);
@@ -33,6 +33,7 @@
 // STL
 #include <string>
 #include <list>
+#include <vector>
 
 #include <vw/gui/TextureCache.h>
 
@@ -148,6 +149,11 @@ namespace gui {
     // Timers and updates
     QTimer *m_timer;
 
+    // The ring of pixel buffer objects that tiles are staged in for
+    // upload, and the one to use next.
+    std::vector<GLuint> m_upload_buffers;
+    size_t m_next_upload_buffer;
+
     // Image tiles and the texture cache
     boost::shared_ptr<TileGenerator> m_tile_generator;
     boost::shared_ptr<GlTextureCache> m_gl_texture_cache;
@@ -10,22 +10,189 @@
 #include <vw/Image/ViewImageResource.h>
 #include <vw/Core/Debugging.h>
 
+#include <sstream>
+#include <boost/filesystem/operations.hpp>
+
+namespace fs = boost::filesystem;
+
 namespace vw { namespace gui {
 
-ImageTileGenerator::ImageTileGenerator(std::string filename) :
-  m_rsrc( DiskImageResource::open(filename) ) {
+// --------------------------------------------------------------
+//                     OverviewBuildTask
+// --------------------------------------------------------------
+
+// Opens or builds the overview sidecars of an image, from the finest
+// to the coarsest, each from the one before it, and hands each to the
+// generator as soon as it is ready.
+class OverviewBuildTask {
+  ImageTileGenerator &m_generator;
+  bool m_terminate;
+
+  // Opens the sidecar if it is newer than the image and has the
+  // expected format.
+  boost::shared_ptr<SrcImageResource> open_overview(std::string const& path, ImageFormat const& fmt) {
+    boost::shared_ptr<SrcImageResource> rsrc;
+    if (!fs::exists(path) || fs::last_write_time(path) < fs::last_write_time(m_generator.m_filename))
+      return rsrc;
+    try {
+      rsrc.reset( DiskImageResource::open(path) );
+    } catch (const vw::Exception&) {
+      return boost::shared_ptr<SrcImageResource>();
+    }
+    ImageFormat ovr_fmt = rsrc->format();
+    if (ovr_fmt.cols != fmt.cols || ovr_fmt.rows != fmt.rows ||
+        ovr_fmt.pixel_format != fmt.pixel_format || ovr_fmt.channel_type != fmt.channel_type)
+      rsrc.reset();
+    return rsrc;
+  }
+
+  // Writes the source subsampled by 2 to path, one tile at a time.
+  // Returns false if the build was stopped.
+  bool build_overview(std::string const& path, ImageFormat const& fmt,
+                      boost::shared_ptr<ImageTileGenerator::PyramidLevel> source) {
+    const Vector2i tile_size = m_generator.tile_size();
+    const size_t pixel_size = num_channels(fmt.pixel_format) * channel_size(fmt.channel_type);
+    const int32 src_cols = source->rsrc->cols(), src_rows = source->rsrc->rows();
+
+    // Write to a temporary file first, so that an interrupted build
+    // does not leave a sidecar that looks complete.
+    std::string tmp_path = fs::path(path).replace_extension(".tmp.tif").string();
+    boost::shared_ptr<DiskImageResource> dst( DiskImageResource::create(tmp_path, fmt) );
+    if (dst->has_block_write())
+      dst->set_block_write_size(tile_size);
+
+    std::vector<uint8> src_data, dst_data;
+    for (int32 j = 0; j < int32(fmt.rows); j += tile_size.y()) {
+      for (int32 i = 0; i < int32(fmt.cols); i += tile_size.x()) {
+        if (m_terminate) {
+          dst.reset();
+          fs::remove(tmp_path);
+          return false;
+        }
+
+        BBox2i dst_bbox(i, j, std::min(tile_size.x(), int32(fmt.cols)-i),
+                        std::min(tile_size.y(), int32(fmt.rows)-j));
+        BBox2i src_bbox(2*i, 2*j, std::min(2*tile_size.x(), src_cols-2*i),
+                        std::min(2*tile_size.y(), src_rows-2*j));
+
+        ImageFormat src_fmt = fmt;
+        src_fmt.cols = src_bbox.width();
+        src_fmt.rows = src_bbox.height();
+        src_data.resize(src_fmt.byte_size());
+        {
+          Mutex::Lock lock(source->mutex);
+          source->rsrc->read(ImageBuffer(src_fmt, &src_data[0]), src_bbox);
+        }
+
+        // Keep the even pixels of the even rows.
+        ImageFormat dst_fmt = fmt;
+        dst_fmt.cols = dst_bbox.width();
+        dst_fmt.rows = dst_bbox.height();
+        dst_data.resize(dst_fmt.byte_size());
+        for (int32 y = 0; y < dst_bbox.height(); ++y)
+          for (int32 x = 0; x < dst_bbox.width(); ++x)
+            std::copy(&src_data[(size_t(2*y)*src_fmt.cols + 2*x)*pixel_size],
+                      &src_data[(size_t(2*y)*src_fmt.cols + 2*x)*pixel_size] + pixel_size,
+                      &dst_data[(size_t(y)*dst_fmt.cols + x)*pixel_size]);
+        dst->write(ImageBuffer(dst_fmt, &dst_data[0]), dst_bbox);
+      }
+    }
+    dst->flush();
+    dst.reset();
+    fs::rename(tmp_path, path);
+    return true;
+  }
+
+public:
+  OverviewBuildTask(ImageTileGenerator &generator) : m_generator(generator), m_terminate(false) {}
+
+  void operator()() {
+    ImageFormat fmt = m_generator.m_rsrc->format();
+    if (fmt.planes != 1)
+      return;
+
+    try {
+      for (size_t k = 1; k < m_generator.m_pyramid.size(); ++k) {
+        boost::shared_ptr<ImageTileGenerator::PyramidLevel> source = m_generator.pyramid_level(k-1);
+        fmt.cols = 1 + (source->rsrc->cols()-1)/2;
+        fmt.rows = 1 + (source->rsrc->rows()-1)/2;
+
+        std::string path = ImageTileGenerator::overview_filename(m_generator.m_filename, k);
+        boost::shared_ptr<SrcImageResource> rsrc = open_overview(path, fmt);
+        if (!rsrc) {
+          vw_out(DebugMessage, "gui") << "ImageTileGenerator: building overview " << path << "\n";
+          if (!build_overview(path, fmt, source))
+            return;
+          rsrc.reset( DiskImageResource::open(path) );
+        }
+
+        Mutex::Lock lock(m_generator.m_pyramid_mutex);
+        m_generator.m_pyramid[k].reset( new ImageTileGenerator::PyramidLevel(rsrc, k) );
+      }
+    } catch (const std::exception& e) {
+      // The coarse tiles are then subsampled from the finest level
+      // available, as they would be without overviews.
+      vw_out(WarningMessage, "gui") << "ImageTileGenerator: could not build the overviews of "
+                                    << m_generator.m_filename << ": " << e.what() << "\n";
+    }
+  }
+
+  void kill() { m_terminate = true; }
+};
+
+// --------------------------------------------------------------
+//                     ImageTileGenerator
+// --------------------------------------------------------------
+
+ImageTileGenerator::ImageTileGenerator(std::string filename, bool build_overviews) :
+  m_filename(filename), m_rsrc( DiskImageResource::open(filename) ) {
   vw_out() << "\t--> Loading image: " << filename << ".\n";
+
+  m_pyramid.resize(this->num_levels());
+  m_pyramid[0].reset( new PyramidLevel(m_rsrc, 0) );
+
+  if (build_overviews && m_pyramid.size() > 1) {
+    m_build_task.reset( new OverviewBuildTask(*this) );
+    m_build_thread.reset( new Thread(m_build_task) );
+  }
 }
 
+ImageTileGenerator::~ImageTileGenerator() {
+  if (m_build_thread) {
+    m_build_task->kill();
+    m_build_thread->join();
+  }
+}
+
+std::string ImageTileGenerator::overview_filename(std::string const& filename, int reduction) {
+  std::ostringstream ostr;
+  ostr << filename << ".ovr" << reduction << ".tif";
+  return ostr.str();
+}
 
-// This little template makes the code below much cleaner.
+// The finest level of the pyramid that is ready, among those up to the
+// given reduction.
+boost::shared_ptr<ImageTileGenerator::PyramidLevel> ImageTileGenerator::pyramid_level(int reduction) {
+  Mutex::Lock lock(m_pyramid_mutex);
+  for (int k = reduction; k > 0; --k)
+    if (k < int(m_pyramid.size()) && m_pyramid[k])
+      return m_pyramid[k];
+  return m_pyramid[0];
+}
+
+// This little template makes the code below much cleaner.  It reads
+// the bbox from the pyramid level, and subsamples it by the given
+// factor.
 template <class PixelT>
 boost::shared_ptr<SrcImageResource> do_image_tilegen(boost::shared_ptr<SrcImageResource> rsrc,
-                                                      BBox2i tile_bbox,
-                                                      int level, int num_levels) {
+                                                      Mutex& rsrc_mutex, BBox2i tile_bbox,
+                                                      int subsample_factor) {
   ImageView<PixelT> tile(tile_bbox.width(), tile_bbox.height());
-  rsrc->read(tile.buffer(), tile_bbox);
-  ImageView<PixelT> reduced_tile = subsample(tile, (1 << ((num_levels-1) - level)));
+  {
+    Mutex::Lock lock(rsrc_mutex);
+    rsrc->read(tile.buffer(), tile_bbox);
+  }
+  ImageView<PixelT> reduced_tile = subsample(tile, subsample_factor);
   return boost::shared_ptr<SrcImageResource>( new ViewImageResource(reduced_tile) );
 }
 
@@ -49,20 +216,31 @@ boost::shared_ptr<SrcImageResource> ImageTileGenerator::generate_tile(TileLocato
   // by cropping the tile to the image dimensions.
   tile_bbox.crop(image_bbox);
 
+  // Read the tile from the finest overview that is ready, scaling its
+  // bounding box down to that overview, and subsample the rest of the
+  // way.
+  int reduction = (this->num_levels()-1) - tile_info.level;
+  boost::shared_ptr<PyramidLevel> source = this->pyramid_level(reduction);
+  const int32 scale = 1 << source->reduction;
+  BBox2i source_bbox(Vector2i(tile_bbox.min().x() / scale, tile_bbox.min().y() / scale),
+                     Vector2i((tile_bbox.max().x() + scale-1) / scale, (tile_bbox.max().y() + scale-1) / scale));
+  source_bbox.crop(BBox2i(0, 0, source->rsrc->cols(), source->rsrc->rows()));
+  const int subsample_factor = 1 << (reduction - source->reduction);
+
   switch (this->pixel_format()) {
   case VW_PIXEL_GRAY:
     if (this->channel_type() == VW_CHANNEL_UINT8) {
-      return do_image_tilegen<PixelGray<uint8> >(m_rsrc, tile_bbox,
-                                                 tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGray<uint8> >(source->rsrc, source->mutex,
+                                                 source_bbox, subsample_factor);
     } else if (this->channel_type() == VW_CHANNEL_INT16) {
-      return do_image_tilegen<PixelGray<int16> >(m_rsrc, tile_bbox,
-                                                 tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGray<int16> >(source->rsrc, source->mutex,
+                                                 source_bbox, subsample_factor);
     } else if (this->channel_type() == VW_CHANNEL_UINT16) {
-      return do_image_tilegen<PixelGray<uint16> >(m_rsrc, tile_bbox,
-                                                  tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGray<uint16> >(source->rsrc, source->mutex,
+                                                 source_bbox, subsample_factor);
     } else if (this->channel_type() == VW_CHANNEL_FLOAT32) {
-      return do_image_tilegen<PixelGray<float> >(m_rsrc, tile_bbox,
-                                                  tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGray<float> >(source->rsrc, source->mutex,
+                                                 source_bbox, subsample_factor);
     } else {
       std::cout << "This platefile has a channel type that is not yet support by vwv.\n";
       std::cout << "Exiting...\n\n";
@@ -72,17 +250,17 @@ boost::shared_ptr<SrcImageResource> ImageTileGenerator::generate_tile(TileLocato
 
   case VW_PIXEL_GRAYA:
     if (this->channel_type() == VW_CHANNEL_UINT8) {
-      return do_image_tilegen<PixelGrayA<uint8> >(m_rsrc, tile_bbox,
-                                                  tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGrayA<uint8> >(source->rsrc, source->mutex,
+                                                 source_bbox, subsample_factor);
     } else if (this->channel_type() == VW_CHANNEL_INT16) {
-      return do_image_tilegen<PixelGrayA<int16> >(m_rsrc, tile_bbox,
-                                                  tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGrayA<int16> >(source->rsrc, source->mutex,
+                                                 source_bbox, subsample_factor);
     } else if (this->channel_type() == VW_CHANNEL_UINT16) {
-      return do_image_tilegen<PixelGrayA<uint16> >(m_rsrc, tile_bbox,
-                                                   tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGrayA<uint16> >(source->rsrc, source->mutex,
+                                                 source_bbox, subsample_factor);
     } else if (this->channel_type() == VW_CHANNEL_FLOAT32) {
-      return do_image_tilegen<PixelGrayA<float> >(m_rsrc, tile_bbox,
-                                                  tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGrayA<float> >(source->rsrc, source->mutex,
+                                                 source_bbox, subsample_factor);
     } else {
       std::cout << "This image has a channel type that is not yet support by vwv.\n";
       std::cout << "Exiting...\n\n";
@@ -93,11 +271,11 @@ boost::shared_ptr<SrcImageResource> ImageTileGenerator::generate_tile(TileLocato
 
   case VW_PIXEL_RGB:
     if (this->channel_type() == VW_CHANNEL_UINT8) {
-      return do_image_tilegen<PixelRGB<uint8> >(m_rsrc, tile_bbox,
-                                                tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelRGB<uint8> >(source->rsrc, source->mutex,
+                                                 source_bbox, subsample_factor);
     } else if (this->channel_type() == VW_CHANNEL_UINT16) {
-      return do_image_tilegen<PixelRGB<uint16> >(m_rsrc, tile_bbox,
-                                                tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelRGB<uint16> >(source->rsrc, source->mutex,
+                                                 source_bbox, subsample_factor);
     } else {
       std::cout << "This image has a channel type that is not yet support by vwv.\n";
       std::cout << "Exiting...\n\n";
@@ -108,11 +286,11 @@ boost::shared_ptr<SrcImageResource> ImageTileGenerator::generate_tile(TileLocato
 
   case VW_PIXEL_RGBA:
     if (this->channel_type() == VW_CHANNEL_UINT8) {
-      return do_image_tilegen<PixelRGBA<uint8> >(m_rsrc, tile_bbox,
-                                                 tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelRGBA<uint8> >(source->rsrc, source->mutex,
+                                                 source_bbox, subsample_factor);
     } else if (this->channel_type() == VW_CHANNEL_UINT16) {
-      return do_image_tilegen<PixelRGBA<uint16> >(m_rsrc, tile_bbox,
-                                                  tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelRGBA<uint16> >(source->rsrc, source->mutex,
+                                                 source_bbox, subsample_factor);
     } else {
       std::cout << "This image has a channel type that is not yet support by vwv.\n";
       std::cout << "Exiting...\n\n";
@@ -9,16 +9,53 @@
 #define __VW_GUI_IMAGETILEGENERATOR_H__
 
 #include <vw/gui/TileGenerator.h>
+#include <vw/Core/Thread.h>
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
 
 namespace vw {
 namespace gui {
 
+  class OverviewBuildTask;
+
+  /// Serves the tiles of an image file.  The coarse levels are served
+  /// from an overview pyramid: the image subsampled by 2, 4, 8, ...,
+  /// each stored as a tiled sidecar file next to the image (see
+  /// overview_filename()).  A background thread builds the sidecars
+  /// that are missing or older than the image when the image is
+  /// opened; until a level is ready, its tiles are subsampled from the
+  /// finest level that is.
   class ImageTileGenerator : public TileGenerator {
+
+    // A level of the pyramid.  Reads from its resource are serialized,
+    // as tiles are fetched from several threads.
+    struct PyramidLevel {
+      boost::shared_ptr<SrcImageResource> rsrc;
+      int reduction;
+      Mutex mutex;
+      PyramidLevel(boost::shared_ptr<SrcImageResource> rsrc, int reduction)
+        : rsrc(rsrc), reduction(reduction) {}
+    };
+
+    std::string m_filename;
     boost::shared_ptr<SrcImageResource> m_rsrc;
 
+    // Level k holds the image subsampled by 2^k, or nothing until it
+    // is ready.  Level 0 is the image itself.
+    std::vector<boost::shared_ptr<PyramidLevel> > m_pyramid;
+    Mutex m_pyramid_mutex;
+
+    boost::shared_ptr<OverviewBuildTask> m_build_task;
+    boost::shared_ptr<Thread> m_build_thread;
+
+    boost::shared_ptr<PyramidLevel> pyramid_level(int reduction);
+    friend class OverviewBuildTask;
+
   public:
-    ImageTileGenerator(std::string filename);
-    virtual ~ImageTileGenerator() {}
+    ImageTileGenerator(std::string filename, bool build_overviews = true);
+    virtual ~ImageTileGenerator();
     virtual PixelRGBA<float> sample(int x, int y, int level, int transaction_id);
 
     virtual boost::shared_ptr<SrcImageResource> generate_tile(TileLocator const& tile_info);
@@ -30,6 +67,9 @@ namespace gui {
     virtual ChannelTypeEnum channel_type() const;
     virtual Vector2i tile_size() const;
     virtual int32 num_levels() const;
+
+    /// The sidecar file holding the image subsampled by 2^reduction.
+    static std::string overview_filename(std::string const& filename, int reduction);
   };
 
 
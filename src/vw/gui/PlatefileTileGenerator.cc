@@ -14,6 +14,7 @@ namespace vw { namespace gui {
 
 PlatefileTileGenerator::PlatefileTileGenerator(const std::string& platefile_name) :
   m_platefile(new vw::platefile::PlateFile(platefile_name)) {
+  m_platefile->set_tile_cache(&vw::platefile::plate_tile_cache());
   m_num_levels = m_platefile->num_levels();
   std::cout << "\t--> Loading platefile \"" << platefile_name << "\" with " << m_num_levels << " levels.\n";
 }
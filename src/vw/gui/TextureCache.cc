@@ -6,6 +6,10 @@
 
 
 #include <vw/gui/TextureCache.h>
+#include <vw/Core/Settings.h>
+
+#include <cstdlib>
+
 using namespace vw;
 using namespace vw::gui;
 
@@ -16,6 +20,7 @@ using namespace vw::gui;
 struct vw::gui::TextureRequest {
   virtual ~TextureRequest() {}
   virtual void process_request() = 0;
+  virtual bool is_allocation() const { return false; }
 };
 
 // Allocate Texture Request
@@ -30,6 +35,8 @@ public:
     m_record(texture_record), m_tile(tile), m_parent(parent) {}
   virtual ~AllocateTextureRequest() {}
 
+  virtual bool is_allocation() const { return true; }
+
   virtual void process_request() {
     m_record->texture_id = m_parent->allocate_texture(m_tile);
   }
@@ -66,13 +73,21 @@ void CachedTextureRenderer::request_deallocation(boost::shared_ptr<TextureRecord
   m_requests.push_back( boost::shared_ptr<TextureRequest>(new DeallocateTextureRequest(texture_record, this)) );
 }
 
-void CachedTextureRenderer::process_allocation_requests() {
+void CachedTextureRenderer::process_allocation_requests(size_t max_allocations) {
   vw::Mutex::Lock lock(m_request_mutex);
 
   boost::shared_ptr<TextureRequest> r;
+  size_t num_allocations = 0;
 
+  // The requests stay in order, as a deallocation may follow the
+  // allocation of the same texture.
   while (!m_requests.empty()) {
     r = m_requests.front();
+    if (r->is_allocation()) {
+      if (max_allocations && num_allocations == max_allocations)
+        break;
+      ++num_allocations;
+    }
     m_requests.pop_front();
     r->process_request();
   }
@@ -84,45 +99,28 @@ void CachedTextureRenderer::process_allocation_requests() {
 
 class vw::gui::TextureFetchTask {
   bool terminate;
-  vw::Mutex &m_request_mutex;
-  std::list<boost::shared_ptr<TextureRecord> > &m_requests;
+  GlTextureCache &m_cache;
 
 public:
-  TextureFetchTask(vw::Mutex &request_queue_mutex,
-                   std::list<boost::shared_ptr<TextureRecord> > &request_queue) :
-    terminate(false), m_request_mutex(request_queue_mutex), m_requests(request_queue) {}
+  TextureFetchTask(GlTextureCache &cache) : terminate(false), m_cache(cache) {}
 
   void operator()() {
     while (!terminate) {
 
-      // Drain the request queue
-      bool found = false;
-      boost::shared_ptr<TextureRecord> r;
-      {
-        vw::Mutex::Lock lock(m_request_mutex);
-        if (!m_requests.empty()) {
-          r = m_requests.front();
-          m_requests.pop_front();
-          found = true;
-        }
-      }
-
-      if (found) {
-
-        // Force the texture to regenerate.  Doing so will cause the
-        // image tile to be loaded into memory, and then a texture
-        // allocation request to be generated to be handled later by
-        // the OpenGL thread.  This may cause one or more texture
-        // deallocation requests to be produced as well if cache tile
-        // need to be deallocated to make room for the new tile.
-        (*(r->handle)).texture_id();
-
-      } else {
-
-        // If there were no requests, sleep for a short time.
-        vw::Thread::sleep_ms(100);
-
-      }
+      // Take the most urgent request, waiting a short time for one if
+      // there are none.
+      boost::shared_ptr<TextureRecord> r = m_cache.next_request(100);
+      if (!r)
+        continue;
+
+      // Force the texture to regenerate.  Doing so will cause the
+      // image tile to be loaded into memory, and then a texture
+      // allocation request to be generated to be handled later by
+      // the OpenGL thread.  This may cause one or more texture
+      // deallocation requests to be produced as well if cache tile
+      // need to be deallocated to make room for the new tile.
+      (*(r->handle)).texture_id();
+      m_cache.finish_request(r);
     }
   }
 
@@ -134,8 +132,9 @@ public:
 //                     GlTextureCache
 // --------------------------------------------------------------
 
-vw::gui::GlTextureCache::GlTextureCache(boost::shared_ptr<TileGenerator> tile_generator) :
-  m_tile_generator(tile_generator) {
+vw::gui::GlTextureCache::GlTextureCache(boost::shared_ptr<TileGenerator> tile_generator,
+                                        int num_fetch_threads) :
+  m_viewport_center(0, 0), m_frame(0), m_tile_generator(tile_generator) {
 
   // Create the texture cache
   int gl_texture_cache_size = 256 * 1024 * 1024; // Use 128-MB of
@@ -143,36 +142,116 @@ vw::gui::GlTextureCache::GlTextureCache(boost::shared_ptr<TileGenerator> tile_ge
 
   m_gl_texture_cache_ptr = new vw::Cache( gl_texture_cache_size );
 
-  // Start the texture fetch thread
-  m_texture_fetch_task.reset(new TextureFetchTask(m_request_mutex, m_requests));
-  m_texture_fetch_thread = new vw::Thread( m_texture_fetch_task );
-
   // Create the texture record tree for storing cache handles and
   // other useful texture-related metadata.
   m_texture_records.reset( new gui::TreeNode<boost::shared_ptr<TextureRecord> >() );
   m_previous_level = 0;
+
+  // Start the texture fetch threads
+  if (num_fetch_threads <= 0)
+    num_fetch_threads = vw_settings().default_num_threads();
+  for (int i = 0; i < num_fetch_threads; ++i) {
+    m_texture_fetch_tasks.push_back( boost::shared_ptr<TextureFetchTask>(new TextureFetchTask(*this)) );
+    m_texture_fetch_threads.push_back( boost::shared_ptr<vw::Thread>(new vw::Thread( m_texture_fetch_tasks.back() )) );
+  }
 }
 
 vw::gui::GlTextureCache::~GlTextureCache() {
-  // Stop the Texture Fetch thread
-  m_texture_fetch_task->kill();
-  m_texture_fetch_thread->join();
-  delete m_texture_fetch_thread;
+  // Stop the Texture Fetch threads
+  for (size_t i = 0; i < m_texture_fetch_tasks.size(); ++i)
+    m_texture_fetch_tasks[i]->kill();
+  m_request_cond.notify_all();
+  for (size_t i = 0; i < m_texture_fetch_threads.size(); ++i)
+    m_texture_fetch_threads[i]->join();
+  m_texture_fetch_threads.clear();
 
   // Free up remaining texture handles, and then the cache itself.
   m_requests.clear();
+  m_request_queue.clear();
   delete m_gl_texture_cache_ptr;
 }
 
 void vw::gui::GlTextureCache::clear() {
   Mutex::Lock lock(m_request_mutex);
   m_requests.clear();
+  m_request_queue.clear();
 
   // Delete all of the existing texture records
   m_texture_records.reset( new gui::TreeNode<boost::shared_ptr<TextureRecord> >() );
   m_previous_level = 0;
 }
 
+void vw::gui::GlTextureCache::set_viewport(BBox2i const& viewport) {
+  Mutex::Lock lock(m_request_mutex);
+  m_viewport_center = (Vector2(viewport.min()) + Vector2(viewport.max())) / 2.0;
+  ++m_frame;
+}
+
+// Queue a request for the record's texture, or bring an already
+// queued one up to date with the current frame.
+void vw::gui::GlTextureCache::request_texture(boost::shared_ptr<TextureRecord> const& rec,
+                                              vw::gui::TileLocator const& tile_info) {
+  BBox2i tile_bbox = tile_to_bbox(m_tile_generator->tile_size(), tile_info.col, tile_info.row,
+                                  tile_info.level, m_tile_generator->num_levels()-1);
+
+  Mutex::Lock lock(m_request_mutex);
+  RequestPriority priority;
+  priority.level_distance = abs(tile_info.level - m_previous_level);
+  priority.center_distance = tile_bbox.empty() ? 0 :
+    norm_2((Vector2(tile_bbox.min()) + Vector2(tile_bbox.max())) / 2.0 - m_viewport_center) / tile_bbox.width();
+  priority.record = rec.get();
+
+  std::map<TextureRecord*, PendingRequest>::iterator it = m_requests.find(rec.get());
+  if (it == m_requests.end()) {
+    PendingRequest& request = m_requests[rec.get()];
+    request.record = rec;
+    request.priority = priority;
+    request.frame = m_frame;
+    request.in_flight = false;
+    m_request_queue.insert(priority);
+    m_request_cond.notify_one();
+    return;
+  }
+
+  PendingRequest& request = it->second;
+  request.frame = m_frame;
+  if (!request.in_flight) {
+    m_request_queue.erase(request.priority);
+    m_request_queue.insert(priority);
+  }
+  request.priority = priority;
+}
+
+boost::shared_ptr<TextureRecord> vw::gui::GlTextureCache::next_request(unsigned long timeout_ms) {
+  Mutex::Lock lock(m_request_mutex);
+  if (m_request_queue.empty())
+    m_request_cond.timed_wait(lock, timeout_ms);
+
+  while (!m_request_queue.empty()) {
+    std::map<TextureRecord*, PendingRequest>::iterator it = m_requests.find(m_request_queue.begin()->record);
+    m_request_queue.erase(m_request_queue.begin());
+    PendingRequest& request = it->second;
+
+    // Drop requests that were not made in this frame or the previous
+    // one: their tiles are no longer in view.
+    if (request.frame + 1 < m_frame) {
+      m_requests.erase(it);
+      continue;
+    }
+
+    request.in_flight = true;
+    return request.record;
+  }
+  return boost::shared_ptr<TextureRecord>();
+}
+
+void vw::gui::GlTextureCache::finish_request(boost::shared_ptr<TextureRecord> const& rec) {
+  Mutex::Lock lock(m_request_mutex);
+  std::map<TextureRecord*, PendingRequest>::iterator it = m_requests.find(rec.get());
+  if (it != m_requests.end() && it->second.record == rec)
+    m_requests.erase(it);
+}
+
 GLuint vw::gui::GlTextureCache::get_texture_id(vw::gui::TileLocator const& tile_info,
                                                CachedTextureRenderer* requestor) {
   // Bail early if the tile_info request is totally invalid.
@@ -181,10 +260,18 @@ GLuint vw::gui::GlTextureCache::get_texture_id(vw::gui::TileLocator const& tile_
 
   // We purge the outgoing request queue whenever there is a change
   // in LOD so that we can immediately begin serving tiles at the
-  // new level of detail.
+  // new level of detail.  Requests already being served are left to
+  // finish.
   if (tile_info.level != m_previous_level) {
     Mutex::Lock lock(m_request_mutex);
-    m_requests.clear();
+    std::map<TextureRecord*, PendingRequest>::iterator it = m_requests.begin();
+    while (it != m_requests.end()) {
+      if (it->second.in_flight)
+        ++it;
+      else
+        m_requests.erase(it++);
+    }
+    m_request_queue.clear();
     m_previous_level = tile_info.level;
   }
 
@@ -209,8 +296,7 @@ GLuint vw::gui::GlTextureCache::get_texture_id(vw::gui::TileLocator const& tile_
     // request to regenerate the texture.  It will get rendered in the
     // future after it has been loaded.
     if (rec->texture_id == 0) {
-      Mutex::Lock lock(m_request_mutex);
-      m_requests.push_back( rec );
+      request_texture( rec, tile_info );
       return 0;
     }
 
@@ -235,8 +321,7 @@ GLuint vw::gui::GlTextureCache::get_texture_id(vw::gui::TileLocator const& tile_
     m_texture_records->insert( new_record_ptr, tile_info.col, tile_info.row,
                                tile_info.level, tile_info.transaction_id );
 
-    Mutex::Lock lock(m_request_mutex);
-    m_requests.push_back( new_record_ptr );
+    request_texture( new_record_ptr, tile_info );
     return 0;
 
   }
@@ -34,6 +34,10 @@
 #include <vw/gui/TileGenerator.h>
 #include <vw/gui/Tree.h>
 
+#include <map>
+#include <set>
+#include <vector>
+
 namespace vw {
 namespace gui {
 
@@ -69,7 +73,9 @@ namespace gui {
 
     virtual void request_deallocation(boost::shared_ptr<TextureRecordBase> texture_record);
 
-    virtual void process_allocation_requests();
+    // Process the pending requests in order, stopping before the
+    // allocation beyond max_allocations, if it is not 0.
+    virtual void process_allocation_requests(size_t max_allocations = 0);
   };
 
   // --------------------------------------------------------------
@@ -172,10 +178,45 @@ namespace gui {
     // new level of detail.  We keep track of the previous LOD here.
     int m_previous_level;
 
-    // Communication to/from the texture caching thread is handled using
-    // a pair of request queues.  These queues are locked with a mutex.
-    std::list<boost::shared_ptr<TextureRecord> > m_requests;
+    // The center of the viewport of the frame being drawn, and a
+    // count of the frames drawn so far.  Requests are stamped with the
+    // frame they were last made in, and the fetch threads drop those
+    // that have not been made again since the previous frame: their
+    // tiles have scrolled out of view.
+    Vector2 m_viewport_center;
+    uint64 m_frame;
+
+    // A request's place in the queue: tiles at the current level of
+    // detail first, then the tiles closest to the viewport center (in
+    // tiles).
+    struct RequestPriority {
+      int level_distance;
+      double center_distance;
+      TextureRecord* record;
+      bool operator<(RequestPriority const& other) const {
+        if (level_distance != other.level_distance)
+          return level_distance < other.level_distance;
+        if (center_distance != other.center_distance)
+          return center_distance < other.center_distance;
+        return record < other.record;
+      }
+    };
+
+    struct PendingRequest {
+      boost::shared_ptr<TextureRecord> record;
+      RequestPriority priority;
+      uint64 frame;
+      bool in_flight;
+    };
+
+    // Communication to the texture fetch threads is handled using a
+    // priority queue of requests, indexed by record so that a tile
+    // requested again only has its priority and frame updated.  These
+    // are locked with a mutex.
+    std::map<TextureRecord*, PendingRequest> m_requests;
+    std::set<RequestPriority> m_request_queue;
     vw::Mutex m_request_mutex;
+    vw::Condition m_request_cond;
 
     // We store texure records in a quad tree structure.  For now we are
     // going to use the tree structure provided by the plate module,
@@ -183,16 +224,20 @@ namespace gui {
     // module someday.
     boost::shared_ptr<gui::TreeNode<boost::shared_ptr<TextureRecord> > > m_texture_records;
     vw::Cache* m_gl_texture_cache_ptr;
-    boost::shared_ptr<TextureFetchTask> m_texture_fetch_task;
-    vw::Thread *m_texture_fetch_thread;
+    std::vector<boost::shared_ptr<TextureFetchTask> > m_texture_fetch_tasks;
+    std::vector<boost::shared_ptr<vw::Thread> > m_texture_fetch_threads;
 
     // Shared ptr to the texture generator
     boost::shared_ptr<TileGenerator> m_tile_generator;
 
+    void request_texture(boost::shared_ptr<TextureRecord> const& rec,
+                         vw::gui::TileLocator const& tile_info);
+
   public:
 
-    // Constructor/destructor
-    GlTextureCache(boost::shared_ptr<TileGenerator> tile_generator);
+    // Constructor/destructor.  Tiles are fetched by num_fetch_threads
+    // threads, or by vw_settings().default_num_threads() if it is 0.
+    GlTextureCache(boost::shared_ptr<TileGenerator> tile_generator, int num_fetch_threads = 0);
     ~GlTextureCache();
 
     // Get a handle on the generator being used to produce tiles.
@@ -203,13 +248,27 @@ namespace gui {
     // Clear all entries from the texture cache.
     void clear();
 
+    // Start a new frame, viewing the given bounding box (in pixels of
+    // the highest resolution level).  The texture requests of this
+    // frame are prioritized by their distance from its center, and the
+    // requests that aren't repeated are cancelled.
+    void set_viewport(BBox2i const& viewport);
+
     // Fetch a texture from the cache.  This is a non-blocking call that
     // will immediately return the GL texture id of the texture *if it
     // is available*.  If the texture is not available, this function
     // will add it to the queue to be rendered by the texture fetch
-    // thread and return 0 immediately.
+    // threads and return 0 immediately.
     GLuint get_texture_id(vw::gui::TileLocator const& tile_info,
                           CachedTextureRenderer* requestor);
+
+    // Used by the texture fetch threads: waits up to timeout_ms for the
+    // most urgent request and marks it in flight, dropping stale
+    // requests along the way.  Returns an empty pointer on timeout.
+    boost::shared_ptr<TextureRecord> next_request(unsigned long timeout_ms);
+
+    // Used by the texture fetch threads once a request is served.
+    void finish_request(boost::shared_ptr<TextureRecord> const& rec);
   };
 
 }} // namespace vw::gui
@@ -8,8 +8,18 @@
 #include <vw/tools/Common.h>
 #include <vw/FileIO/DiskImageResource.h>
 #include <boost/scoped_ptr.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <sstream>
+namespace fs = boost::filesystem;
 
 vw::ImageFormat vw::tools::taste_image(const std::string& filename) {
   boost::scoped_ptr<vw::SrcImageResource> src(vw::DiskImageResource::open(filename));
   return src->format();
 }
+
+std::string vw::tools::file_identity(const std::string& filename) {
+  fs::path path = fs::system_complete( fs::path(filename) );
+  std::ostringstream id;
+  id << path.string() << " " << fs::file_size(path) << " " << fs::last_write_time(path);
+  return id.str();
+}
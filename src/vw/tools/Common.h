@@ -26,6 +26,11 @@ namespace tools {
 
   ImageFormat taste_image(const std::string& filename);
 
+  // Identifies the current contents of a file, by its absolute path,
+  // size and modification time, for keying cached results derived
+  // from it.
+  std::string file_identity(const std::string& filename);
+
 namespace detail {
 
 template <typename T>
@@ -24,13 +24,15 @@ using namespace vw;
 
 int main( int argc, char *argv[] ) {
 
-  std::string input_file_name, output_file_name;
+  std::string input_file_name, output_file_name, pattern_name, method_name;
 
   po::options_description desc("Options");
   desc.add_options()
     ("help,h", "Display this help message")
     ("input-file", po::value<std::string>(&input_file_name), "Explicitly specify the input file")
-    ("output-file,o", po::value<std::string>(&output_file_name)->default_value("output.png"), "Specify the output file");
+    ("output-file,o", po::value<std::string>(&output_file_name)->default_value("output.png"), "Specify the output file")
+    ("pattern", po::value<std::string>(&pattern_name)->default_value("rggb"), "The colors of the top left 2x2 samples: rggb, grbg, gbrg or bggr")
+    ("method", po::value<std::string>(&method_name)->default_value("bilinear"), "Interpolation: bilinear or malvar");
   po::positional_options_description p;
   p.add("input-file", 1);
 
@@ -56,12 +58,31 @@ int main( int argc, char *argv[] ) {
     return 1;
   }
 
+  camera::BayerPattern pattern;
+  if( pattern_name == "rggb" ) pattern = camera::BAYER_RGGB;
+  else if( pattern_name == "grbg" ) pattern = camera::BAYER_GRBG;
+  else if( pattern_name == "gbrg" ) pattern = camera::BAYER_GBRG;
+  else if( pattern_name == "bggr" ) pattern = camera::BAYER_BGGR;
+  else {
+    std::cout << "Error: Unknown Bayer pattern \"" << pattern_name << "\"!" << std::endl;
+    std::cout << desc << std::endl;
+    return 1;
+  }
+
+  camera::DemosaicMethod method;
+  if( method_name == "bilinear" ) method = camera::DEMOSAIC_BILINEAR;
+  else if( method_name == "malvar" ) method = camera::DEMOSAIC_MALVAR;
+  else {
+    std::cout << "Error: Unknown demosaicing method \"" << method_name << "\"!" << std::endl;
+    std::cout << desc << std::endl;
+    return 1;
+  }
+
   try {
     ImageView<PixelGray<float> > image;
     read_image( image, input_file_name );
 
-    ImageView<PixelRGB<float> > result = camera::inverse_bayer_filter(image);
-    write_image( output_file_name, result );
+    write_image( output_file_name, camera::bayer_demosaic( image, pattern, method ) );
   }
   catch (const Exception& e) {
     std::cerr << "Error: " << e.what() << std::endl;
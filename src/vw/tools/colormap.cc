@@ -26,6 +26,7 @@ namespace po = boost::program_options;
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/ImageMath.h>
 #include <vw/Image/ImageViewRef.h>
+#include <vw/Image/LookupTable.h>
 #include <vw/Image/PerPixelViews.h>
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/MaskViews.h>
@@ -88,6 +89,36 @@ UnaryPerPixelView<ViewT, ColormapFunc> colormap(ImageViewBase<ViewT> const& view
   return UnaryPerPixelView<ViewT, ColormapFunc>(view.impl(), ColormapFunc(map));
 }
 
+// Integer DEMs without alpha have few enough heights to color them all
+// up front, and look the colors up.
+template <class PixelT>
+ImageViewRef<PixelMask<PixelRGB<uint8> > >
+colorize( DiskImageView<PixelT> const& disk_dem_file, ImageViewRef<PixelMask<PixelGray<float> > > const& /*dem*/,
+          Options const& opt, true_type /*tabulate*/ ) {
+  typedef typename CompoundChannelType<PixelT>::type channel_type;
+  typedef PixelMask<PixelRGB<uint8> > result_type;
+  ChannelNormalizeFunctor<PixelGray<float> > normalize_func( opt.min_val, opt.max_val, 0, 1.0 );
+  ColormapFunc colormap_func( opt.lut_map );
+  bool has_nodata = opt.nodata_value != std::numeric_limits<float>::max();
+
+  LookupTable<channel_type, result_type> table;
+  for ( size_t i = 0; i < LookupTable<channel_type, result_type>::table_size; ++i ) {
+    channel_type value = channel_type( typename LookupTable<channel_type, result_type>::index_type(i) );
+    if ( has_nodata && float(value) == opt.nodata_value )
+      table.set( value, result_type() );
+    else
+      table.set( value, colormap_func( PixelGray<float>( normalize_func( float(value) ) ) ) );
+  }
+  return apply_lookup_table( disk_dem_file, table );
+}
+
+template <class PixelT>
+ImageViewRef<PixelMask<PixelRGB<uint8> > >
+colorize( DiskImageView<PixelT> const& /*disk_dem_file*/, ImageViewRef<PixelMask<PixelGray<float> > > const& dem,
+          Options const& opt, false_type /*tabulate*/ ) {
+  return colormap(normalize(dem,opt.min_val,opt.max_val,0,1.0), opt.lut_map);
+}
+
 // -------------------------------------------------------------------------------------
 
 template <class PixelT>
@@ -152,8 +183,10 @@ void do_colorized_dem(Options& opt) {
   delete disk_dem_rsrc;
 
   // Apply colormap
+  typedef boost::mpl::integral_c<bool, boost::is_integral<typename CompoundChannelType<PixelT>::type>::value &&
+                                       !PixelHasAlpha<PixelT>::value> tabulate;
   ImageViewRef<PixelMask<PixelRGB<uint8> > > colorized_image =
-    colormap(normalize(dem,opt.min_val,opt.max_val,0,1.0), opt.lut_map);
+    colorize( disk_dem_file, dem, opt, tabulate() );
 
   if (!opt.shaded_relief_file_name.empty()) {
     vw_out() << "\t--> Incorporating hillshading from: "
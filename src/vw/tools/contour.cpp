@@ -18,9 +18,16 @@
 #include <map>
 #include <algorithm>
 #include <utility>
+#include <vector>
 #include <vw/Image.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <cmath>
 
+#include <boost/functional/hash.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
 #include "contour.h"
 
 #define xsect(p1,p2) (h[p2]*xh[p1]-h[p1]*xh[p2])/(h[p2]-h[p1])
@@ -463,3 +470,372 @@ void conrec(vw::ImageView<float>& dem, PointContourSet& cset,
 }
 
 
+/*
+ * Tiled contouring
+ */
+
+namespace {
+
+// The point where a contour at some level crosses the edge between two
+// pixels: the horizontal edge from (x,y) to (x+1,y), or the vertical
+// one from (x,y) to (x,y+1).  The two cells on either side of the edge
+// both find it, at exactly the same coordinates.
+struct CrossingKey {
+    int level;
+    vw::int32 x, y;
+    bool vertical;
+
+    CrossingKey() : level(0), x(0), y(0), vertical(false) {}
+    CrossingKey(int level_, vw::int32 x_, vw::int32 y_, bool vertical_)
+        : level(level_), x(x_), y(y_), vertical(vertical_) {}
+
+    bool operator==(CrossingKey const& k) const {
+        return level == k.level && x == k.x && y == k.y && vertical == k.vertical;
+    }
+};
+
+std::size_t hash_value(CrossingKey const& k) {
+    std::size_t seed = 0;
+    boost::hash_combine(seed, k.level);
+    boost::hash_combine(seed, k.x);
+    boost::hash_combine(seed, k.y);
+    boost::hash_combine(seed, k.vertical);
+    return seed;
+}
+
+// A piece of a contour, from one crossing to another.  next[e] is the
+// tile with the cell on the far side of end e's edge, which may hold
+// the continuation, or -1 once nothing more can be joined there.
+struct Fragment {
+    int level;
+    PointContour points;
+    CrossingKey ends[2];
+    int next[2];
+    bool closed;
+
+    Fragment() : level(0), closed(false) { next[0] = next[1] = -1; }
+    bool finished() const { return closed || (next[0] < 0 && next[1] < 0); }
+    void reverse() {
+        points.reverse();
+        std::swap(ends[0], ends[1]);
+        std::swap(next[0], next[1]);
+    }
+};
+
+typedef boost::shared_ptr<Fragment> FragmentPtr;
+
+// Joins fragments by the open ends they share.
+class FragmentJoiner {
+    typedef boost::unordered_map<CrossingKey, FragmentPtr> map_type;
+    map_type m_open;
+
+    // Joins f onto g at key, an end of both.  The crossing itself is
+    // kept only once.
+    static void append(Fragment& g, CrossingKey const& key, Fragment& f) {
+        if (g.ends[1] == key) {
+            if (!(f.ends[0] == key)) f.reverse();
+            g.points.splice(g.points.end(), f.points, ++f.points.begin(), f.points.end());
+            g.ends[1] = f.ends[1];
+            g.next[1] = f.next[1];
+        } else {
+            if (!(f.ends[1] == key)) f.reverse();
+            g.points.splice(g.points.begin(), f.points, f.points.begin(), --f.points.end());
+            g.ends[0] = f.ends[0];
+            g.next[0] = f.next[0];
+        }
+    }
+
+public:
+    // Adds a fragment, joining it to any that are waiting at its open
+    // ends, and returns the fragment it is now part of.
+    FragmentPtr add(FragmentPtr f) {
+        for (;;) {
+            map_type::iterator it = m_open.end();
+            for (int e = 0; e < 2 && it == m_open.end(); e++) {
+                if (f->next[e] < 0) continue;
+                map_type::iterator found = m_open.find(f->ends[e]);
+                if (found != m_open.end() && found->second != f) it = found;
+            }
+            if (it == m_open.end()) break;
+
+            FragmentPtr g = it->second;
+            CrossingKey key = it->first;
+            m_open.erase(it);
+            append(*g, key, *f);
+            if (g->ends[0] == g->ends[1]) {
+                m_open.erase(g->ends[0]);
+                g->closed = true;
+                g->next[0] = g->next[1] = -1;
+                return g;
+            }
+            // f may already have been waiting at its other end.
+            for (int e = 0; e < 2; e++) {
+                map_type::iterator other = m_open.find(g->ends[e]);
+                if (other != m_open.end() && other->second == f) other->second = g;
+            }
+            f = g;
+        }
+        for (int e = 0; e < 2; e++)
+            if (f->next[e] >= 0) m_open[f->ends[e]] = f;
+        return f;
+    }
+
+    // Gives up on joining anything at key, and returns the fragment
+    // that was waiting there, if any.
+    FragmentPtr close_end(CrossingKey const& key) {
+        map_type::iterator it = m_open.find(key);
+        if (it == m_open.end()) return FragmentPtr();
+        FragmentPtr f = it->second;
+        m_open.erase(it);
+        f->next[f->ends[0] == key ? 0 : 1] = -1;
+        return f;
+    }
+
+    bool waiting(CrossingKey const& key) const { return m_open.find(key) != m_open.end(); }
+
+    // Removes and returns every fragment with an open end.
+    void take_open(std::vector<FragmentPtr>& fragments) {
+        for (map_type::iterator it = m_open.begin(); it != m_open.end(); ++it) {
+            FragmentPtr f = it->second;
+            // A fragment open at both ends is listed twice; take it
+            // at its front.
+            if (f->next[0] >= 0 && f->next[1] >= 0 && !(it->first == f->ends[0])) continue;
+            fragments.push_back(f);
+        }
+        m_open.clear();
+    }
+};
+
+// The DEM's cells, the squares between four pixels, in tiles.
+struct TileLayout {
+    vw::int32 cell_cols, cell_rows, tile_size, tiles_x, tiles_y;
+
+    TileLayout(vw::int32 cols, vw::int32 rows, vw::int32 size)
+        : cell_cols(std::max(cols - 1, 0)), cell_rows(std::max(rows - 1, 0)), tile_size(size),
+          tiles_x((cell_cols + size - 1) / size), tiles_y((cell_rows + size - 1) / size) {}
+
+    int tiles() const { return tiles_x * tiles_y; }
+
+    vw::BBox2i cells(int tile) const {
+        vw::BBox2i bbox(tile % tiles_x * tile_size, tile / tiles_x * tile_size, tile_size, tile_size);
+        bbox.crop(vw::BBox2i(0, 0, cell_cols, cell_rows));
+        return bbox;
+    }
+
+    // The tile of the cell on the other side of key's edge from cell
+    // (cx,cy), or -1 if that is outside the DEM.
+    int across(CrossingKey const& key, vw::int32 cx, vw::int32 cy) const {
+        vw::int32 ox = cx, oy = cy;
+        if (key.vertical) ox = (key.x == cx) ? cx - 1 : cx + 1;
+        else              oy = (key.y == cy) ? cy - 1 : cy + 1;
+        if (ox < 0 || oy < 0 || ox >= cell_cols || oy >= cell_rows) return -1;
+        return (oy / tile_size) * tiles_x + ox / tile_size;
+    }
+};
+
+// Contours the cells of one tile.  z holds the pixels from origin on.
+// Fragments that are finished, and those that may continue in another
+// tile, are added to fragments.
+void contour_tile(vw::ImageView<float> const& z, vw::Vector2i const& origin,
+                  TileLayout const& layout, int tile, int cint, float nodataval,
+                  std::vector<FragmentPtr>& fragments) {
+    FragmentJoiner joiner;
+    vw::BBox2i cells = layout.cells(tile);
+
+    for (vw::int32 cy = cells.min().y(); cy < cells.max().y(); cy++) {
+        for (vw::int32 cx = cells.min().x(); cx < cells.max().x(); cx++) {
+            // Corners clockwise from the top left, and the edges
+            // clockwise from the top: edge e runs from corner e to
+            // corner (e+1)%4.
+            double v[4];
+            v[0] = z(cx - origin.x(),     cy - origin.y());
+            v[1] = z(cx - origin.x() + 1, cy - origin.y());
+            v[2] = z(cx - origin.x() + 1, cy - origin.y() + 1);
+            v[3] = z(cx - origin.x(),     cy - origin.y() + 1);
+            if (v[0] == nodataval || v[1] == nodataval || v[2] == nodataval || v[3] == nodataval)
+                continue;
+
+            double zmin = std::min(std::min(v[0], v[1]), std::min(v[2], v[3]));
+            double zmax = std::max(std::max(v[0], v[1]), std::max(v[2], v[3]));
+            int kmin = int(std::floor(zmin / cint)) + 1;
+            int kmax = int(std::floor(zmax / cint));
+
+            for (int k = kmin; k <= kmax; k++) {
+                int level = k * cint;
+                int bits = 0;
+                for (int m = 0; m < 4; m++)
+                    if (v[m] >= level) bits |= 1 << m;
+
+                // Crossings are interpolated from the left or top end
+                // of the edge, so both cells find the same point.
+                ContourPoint p[4];
+                CrossingKey key[4];
+                if ((bits & 1) != ((bits >> 1) & 1)) {
+                    p[0] = ContourPoint(cx + (level - v[0]) / (v[1] - v[0]), cy);
+                    key[0] = CrossingKey(level, cx, cy, false);
+                }
+                if (((bits >> 1) & 1) != ((bits >> 2) & 1)) {
+                    p[1] = ContourPoint(cx + 1, cy + (level - v[1]) / (v[2] - v[1]));
+                    key[1] = CrossingKey(level, cx + 1, cy, true);
+                }
+                if (((bits >> 3) & 1) != ((bits >> 2) & 1)) {
+                    p[2] = ContourPoint(cx + (level - v[3]) / (v[2] - v[3]), cy + 1);
+                    key[2] = CrossingKey(level, cx, cy + 1, false);
+                }
+                if ((bits & 1) != ((bits >> 3) & 1)) {
+                    p[3] = ContourPoint(cx, cy + (level - v[0]) / (v[3] - v[0]));
+                    key[3] = CrossingKey(level, cx, cy, true);
+                }
+
+                // Pairs of edges to join.  At a saddle the corners
+                // cut off are those on the other side of the centre.
+                int pairs[2][2];
+                int npairs = 1;
+                if (bits == 5 || bits == 10) {
+                    bool centre_above = (v[0] + v[1] + v[2] + v[3]) / 4 >= level;
+                    bool cut_odd = (bits == 5) == centre_above;
+                    npairs = 2;
+                    if (cut_odd) {
+                        pairs[0][0] = 0; pairs[0][1] = 1; pairs[1][0] = 2; pairs[1][1] = 3;
+                    } else {
+                        pairs[0][0] = 3; pairs[0][1] = 0; pairs[1][0] = 1; pairs[1][1] = 2;
+                    }
+                } else {
+                    int n = 0;
+                    for (int e = 0; e < 4; e++) {
+                        int a = (bits >> e) & 1, b = (bits >> ((e + 1) % 4)) & 1;
+                        if (a != b) pairs[0][n++] = e;
+                    }
+                }
+
+                for (int s = 0; s < npairs; s++) {
+                    FragmentPtr f(new Fragment);
+                    f->level = level;
+                    for (int e = 0; e < 2; e++) {
+                        int edge = pairs[s][e];
+                        f->points.push_back(p[edge]);
+                        f->ends[e] = key[edge];
+                        f->next[e] = layout.across(key[edge], cx, cy);
+                    }
+                    f = joiner.add(f);
+                    if (f->finished()) fragments.push_back(f);
+                }
+            }
+        }
+    }
+
+    // What is still open inside the tile borders a nodata cell.
+    std::vector<FragmentPtr> open;
+    joiner.take_open(open);
+    for (size_t i = 0; i < open.size(); i++) {
+        for (int e = 0; e < 2; e++)
+            if (open[i]->next[e] == tile) open[i]->next[e] = -1;
+        fragments.push_back(open[i]);
+    }
+}
+
+// Joins the fragments of finished tiles, and hands contours to the sink
+// as soon as nothing more can be added to them.
+class ContourStitcher {
+    FragmentJoiner m_joiner;
+    std::vector<bool> m_done;
+    std::vector<std::vector<CrossingKey> > m_waiting;
+    ContourSink m_sink;
+    vw::Mutex m_mutex;
+    size_t m_count;
+
+    void emit(FragmentPtr const& f) {
+        // Contours through a pixel exactly at their level cross both
+        // of its edges at the pixel itself.
+        f->points.unique();
+        m_sink(f->level, f->points);
+        m_count++;
+    }
+
+public:
+    ContourStitcher(int tiles, ContourSink const& sink)
+        : m_done(tiles, false), m_waiting(tiles), m_sink(sink), m_count(0) {}
+
+    size_t count() const { return m_count; }
+
+    void add_tile(int tile, std::vector<FragmentPtr> const& fragments) {
+        vw::Mutex::Lock lock(m_mutex);
+        m_done[tile] = true;
+
+        for (size_t i = 0; i < fragments.size(); i++) {
+            FragmentPtr f = fragments[i];
+            // A finished tile with nothing waiting at this end has
+            // nothing to join to it.
+            for (int e = 0; e < 2; e++)
+                if (f->next[e] >= 0 && m_done[f->next[e]] && !m_joiner.waiting(f->ends[e]))
+                    f->next[e] = -1;
+            if (f->finished()) {
+                emit(f);
+                continue;
+            }
+            f = m_joiner.add(f);
+            if (f->finished()) {
+                emit(f);
+                continue;
+            }
+            for (int e = 0; e < 2; e++)
+                if (f->next[e] >= 0 && !m_done[f->next[e]])
+                    m_waiting[f->next[e]].push_back(f->ends[e]);
+        }
+
+        // Whatever was waiting for this tile and was not joined, never
+        // will be.
+        std::vector<CrossingKey> waiting;
+        waiting.swap(m_waiting[tile]);
+        for (size_t i = 0; i < waiting.size(); i++) {
+            FragmentPtr f = m_joiner.close_end(waiting[i]);
+            if (f && f->finished()) emit(f);
+        }
+    }
+};
+
+class ContourTileTask : public vw::Task {
+    vw::ImageViewRef<float> m_dem;
+    TileLayout const& m_layout;
+    int m_tile, m_cint;
+    float m_nodataval;
+    ContourStitcher& m_stitcher;
+
+public:
+    ContourTileTask(vw::ImageViewRef<float> const& dem, TileLayout const& layout, int tile,
+                    int cint, float nodataval, ContourStitcher& stitcher)
+        : m_dem(dem), m_layout(layout), m_tile(tile), m_cint(cint), m_nodataval(nodataval),
+          m_stitcher(stitcher) {}
+
+    virtual void operator()() {
+        vw::BBox2i cells = m_layout.cells(m_tile);
+        vw::BBox2i pixels(cells.min(), cells.max() + vw::Vector2i(1, 1));
+        vw::ImageView<float> z = vw::crop(m_dem, pixels);
+        std::vector<FragmentPtr> fragments;
+        contour_tile(z, pixels.min(), m_layout, m_tile, m_cint, m_nodataval, fragments);
+        m_stitcher.add_tile(m_tile, fragments);
+    }
+};
+
+} // namespace
+
+void contour_tiled(vw::ImageViewRef<float> const& dem, int cint, float nodataval,
+                   int tile_size, int num_threads, ContourSink const& sink) {
+    VW_ASSERT(cint > 0 && tile_size > 0,
+              vw::ArgumentErr() << "contour_tiled: The contour interval and tile size must be positive.");
+    if (num_threads < 1) num_threads = vw::vw_settings().default_num_threads();
+
+    TileLayout layout(dem.cols(), dem.rows(), tile_size);
+    ContourStitcher stitcher(layout.tiles(), sink);
+
+    vw::vw_out(vw::InfoMessage, "console") << "Contouring in " << layout.tiles() << " tiles\n";
+    {
+        vw::FifoWorkQueue queue(num_threads);
+        for (int tile = 0; tile < layout.tiles(); tile++)
+            queue.add_task(boost::shared_ptr<vw::Task>(
+                new ContourTileTask(dem, layout, tile, cint, nodataval, stitcher)));
+        queue.join_all();
+    }
+    vw::vw_out(vw::DebugMessage, "console")
+        << "\tFound " << stitcher.count() << " contours" << std::endl;
+}
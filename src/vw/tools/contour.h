@@ -12,7 +12,9 @@
 #include <deque>
 #include <algorithm>
 #include <utility>
+#include <boost/function.hpp>
 #include <vw/Image.h>
+#include <vw/Image/ImageViewRef.h>
 
 /*
  * Point/Vector types and operators
@@ -61,4 +63,25 @@ void chord_length_parameterize(PointContour c,
 void conrec(vw::ImageView<float>& dem, PointContourSet& cset,
             int cint, float nodataval, std::list<ContourSegment>& seglist);
 
+/*
+ * Tiled contouring
+ *
+ * contour_tiled() contours a DEM by marching squares, a tile of
+ * tile_size x tile_size cells at a time, on num_threads threads.  Only
+ * the tiles being worked on are read into memory.  Pieces of contours
+ * that reach a tile boundary are joined to their continuations in the
+ * neighbouring tiles through a hash table of the points where they
+ * cross it.  Each contour is handed to the sink as soon as it is
+ * finished: when it closes, or when both of its ends reach the edge of
+ * the DEM or a nodata pixel.  The sink is never called by two threads
+ * at once.
+ *
+ * Cells with a nodata corner are skipped.  Saddle cells are resolved by
+ * the mean of their corners.
+ */
+typedef boost::function<void (int level, PointContour const& contour)> ContourSink;
+
+void contour_tiled(vw::ImageViewRef<float> const& dem, int cint, float nodataval,
+                   int tile_size, int num_threads, ContourSink const& sink);
+
 
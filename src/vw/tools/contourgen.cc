@@ -20,9 +20,11 @@
 
 //#include <boost/algorithm/minmax_element.hpp>
 #include <boost/program_options.hpp>
+#include <boost/bind.hpp>
 
 #include <vw/Core/Log.h>
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Settings.h>
 #include <vw/Image.h>
 #include <vw/FileIO.h>
 
@@ -218,14 +220,31 @@ void draw_point_contours(PointContourSet cset,
     }
 }
 
-void draw_Bezier_contours(BezierContourSet bcset, Cairo::RefPtr<Cairo::Context> cr, float nodataval) {
-    vw::vw_out(vw::InfoMessage) << "Writing Bezier contours to output surface\n";
-    BezierContourSet::iterator bcset_iter;
+void set_Bezier_contour_style(Cairo::RefPtr<Cairo::Context> cr) {
     double line_width, tmp;
     line_width = 2.0; tmp = 0.0;
     //cr->device_to_user_distance(line_width, tmp);
     cr->set_line_width(line_width);
     cr->set_source_rgb(0.0, 0.0, 1.0);
+}
+
+void draw_Bezier_contour(BezierContour const& contour, Cairo::RefPtr<Cairo::Context> cr) {
+    if (contour.empty()) return;
+    BezierContour::const_iterator c_iter = contour.begin();
+    cr->begin_new_path();
+    cr->move_to((*c_iter)[0][0], (*c_iter)[0][1]);
+    while (++c_iter != contour.end()) {
+        cr->curve_to((*c_iter)[1][0], (*c_iter)[1][1],
+                     (*c_iter)[2][0], (*c_iter)[2][1],
+                     (*c_iter)[3][0], (*c_iter)[3][1]);
+    }
+    cr->stroke();
+}
+
+void draw_Bezier_contours(BezierContourSet bcset, Cairo::RefPtr<Cairo::Context> cr, float nodataval) {
+    vw::vw_out(vw::InfoMessage) << "Writing Bezier contours to output surface\n";
+    BezierContourSet::iterator bcset_iter;
+    set_Bezier_contour_style(cr);
 
     int level = int(nodataval);
     for (bcset_iter = bcset.begin(); bcset_iter != bcset.end(); bcset_iter++) {
@@ -234,19 +253,31 @@ void draw_Bezier_contours(BezierContourSet bcset, Cairo::RefPtr<Cairo::Context>
             level = newlevel;
         }
 
-        BezierContour contour = (*bcset_iter).second;
-        BezierContour::iterator c_iter = contour.begin();
-        cr->begin_new_path();
-        cr->move_to((*c_iter)[0][0], (*c_iter)[0][1]);
-        while (++c_iter != contour.end()) {
-            cr->curve_to((*c_iter)[1][0], (*c_iter)[1][1],
-                         (*c_iter)[2][0], (*c_iter)[2][1],
-                         (*c_iter)[3][0], (*c_iter)[3][1]);
-        }
-        cr->stroke();
+        draw_Bezier_contour((*bcset_iter).second, cr);
+    }
+}
+
+// Contour sinks for contour_tiled(), which write each contour out as
+// soon as it is found.
+
+// Writes a contour as the segments between its points, in the format of
+// write_points_to_file().
+void write_contour_segments(std::ofstream* ofs, int level, PointContour const& c) {
+    PointContour::const_iterator a = c.begin(), b = c.begin();
+    if (b == c.end()) return;
+    for (++b; b != c.end(); ++a, ++b) {
+        *ofs << std::setprecision(8) << std::fixed
+             << (*a)[0] << "\t" << (*a)[1] << "\t" << (*b)[0] << "\t"
+             << (*b)[1] << "\t" << level << std::endl;
     }
 }
 
+// Fits Bezier curves to a contour and draws them.
+void draw_contour(Cairo::RefPtr<Cairo::Context> cr, float error, int level, PointContour const& c) {
+    PointContour points(c);
+    draw_Bezier_contour(FitCurve(points, error), cr);
+}
+
 
 
 void write_points_to_file(std::string file_out, SegmentList segment_list, int rows, int cols) {
@@ -287,6 +318,11 @@ int main(int argc, char *argv[])
             "set \"NO DATA\" value")
         ("contour-interval,c", po::value<int>()->default_value(100),
             "set contour interval")
+        ("tile-size,t", po::value<int>()->default_value(256),
+            "contour DEMs in tiles of this many pixels square")
+        ("threads", po::value<int>()->default_value(0),
+            "number of threads to contour with (0 for the default)")
+        ("conrec", "contour the whole DEM in memory with CONREC, as before tiling")
     ;
 
     po::options_description hidden("Hidden options");
@@ -333,6 +369,9 @@ int main(int argc, char *argv[])
     std::string output_type = vm["output-type"].as<std::string>();
     float nodataval = vm["no-data-value"].as<float>();
     int cint = vm["contour-interval"].as<int>();
+    int tile_size = vm["tile-size"].as<int>();
+    int num_threads = vm["threads"].as<int>();
+    bool use_conrec = vm.count("conrec") != 0;
 
     vw::vw_log().console_log().rule_set().clear();
     vw::vw_log().console_log().rule_set().add_rule(vw::WarningMessage, "console");
@@ -371,6 +410,38 @@ int main(int argc, char *argv[])
     int rows, cols;
     float error = 1.0e-3;
 
+    if (input_type == "tiff" && !use_conrec) {
+        if (cint <= 0 || tile_size <= 0) {
+            vw::vw_out(vw::ErrorMessage)
+                << "ERROR: The contour interval and tile size must be positive." << std::endl;
+            return 1;
+        }
+        if (num_threads <= 0)
+            num_threads = vw::vw_settings().default_num_threads();
+
+        // Contour the DEM a tile at a time, writing out each contour as
+        // it is finished, so that neither the DEM nor its contours need
+        // fit in memory.
+        vw::DiskImageView<float> disk_dem(file_in);
+        rows = disk_dem.rows();
+        cols = disk_dem.cols();
+
+        if (output_type == "text") {
+            std::ofstream ofs(file_out.c_str());
+            ofs << rows << "\t" << cols << std::endl;
+            contour_tiled(disk_dem, cint, nodataval, tile_size, num_threads,
+                          boost::bind(&write_contour_segments, &ofs, _1, _2));
+        } else {
+            Cairo::RefPtr<Cairo::Context> cr =
+                create_output_surface(output_type, cols, rows, image_file, file_out);
+            set_Bezier_contour_style(cr);
+            contour_tiled(disk_dem, cint, nodataval, tile_size, num_threads,
+                          boost::bind(&draw_contour, cr, error, _1, _2));
+            write_output_file(cr, output_type, file_out);
+        }
+        return 0;
+    }
+
     if (input_type == "tiff") {
         // 1. Load DEM from file
         dem = load_dem_from_file(file_in);
@@ -51,6 +51,7 @@ int main( int argc, char *argv[] ) {
       ("right", po::value(&right_file_name), "Explicitly specify the \"right\" input file")
       ("slog", po::value(&slog)->default_value(1.0), "Apply SLOG filter with the given sigma, or 0 to disable")
       ("log", po::value(&log)->default_value(0.0), "Apply LOG filter with the given sigma, or 0 to disable")
+      ("census", "Replace the pixels with census descriptors compared by Hamming distance, in place of the SLOG and LOG filters (not with --reference)")
       ("h-corr-min", po::value(&h_corr_min)->default_value(0), "Minimum horizontal disparity")
       ("h-corr-max", po::value(&h_corr_max)->default_value(0), "Maximum horizontal disparity")
       ("v-corr-min", po::value(&v_corr_min)->default_value(5), "Minimum vertical disparity")
@@ -60,7 +61,7 @@ int main( int argc, char *argv[] ) {
       ("lrthresh", po::value(&lrthresh)->default_value(2), "Left/right correspondence threshold")
       ("csthresh", po::value(&corrscore_thresh)->default_value(1.0), "Correlation score rejection threshold (1.0 is Off <--> 2.0 is Aggressive outlier rejection")
       ("cost-blur", po::value(&cost_blur)->default_value(1), "Kernel size for bluring the cost image")
-      ("correlator-type", po::value(&correlator_type)->default_value(0), "0 - Abs difference; 1 - Sq Difference; 2 - NormXCorr")
+      ("correlator-type", po::value(&correlator_type)->default_value(0), "0 - Abs difference; 1 - Sq Difference; 2 - NormXCorr; 3 - Census")
       ("hsubpix", "Enable horizontal sub-pixel correlation")
       ("vsubpix", "Enable vertical sub-pixel correlation")
       ("affine-subpix", "Enable affine adaptive sub-pixel correlation (slower, but more accurate)")
@@ -128,6 +129,8 @@ int main( int argc, char *argv[] ) {
       corr_type = SQR_DIFF_CORRELATOR;
     else if (correlator_type == 2)
       corr_type = NORM_XCORR_CORRELATOR;
+    else if (correlator_type == 3)
+      corr_type = CENSUS_CORRELATOR;
 
     ImageView<PixelMask<Vector2f> > disparity_map;
     if (vm.count("reference")) {
@@ -153,7 +156,9 @@ int main( int argc, char *argv[] ) {
       correlator.set_debug_mode("debug");
       {
         vw::Timer corr_timer("Correlation Time");
-        if (log > 0)
+        if (vm.count("census"))
+          disparity_map = correlator( left, right, left_mask, right_mask, stereo::CensusStereoPreprocessingFilter<>());
+        else if (log > 0)
           disparity_map = correlator( left, right, left_mask, right_mask, stereo::LogStereoPreprocessingFilter(log));
         else
           disparity_map = correlator( left, right, left_mask, right_mask, stereo::SlogStereoPreprocessingFilter(slog));
@@ -168,7 +173,9 @@ int main( int argc, char *argv[] ) {
                                                   corr_type);
       {
         vw::Timer corr_timer("Correlation Time");
-        if (log > 0)
+        if (vm.count("census"))
+          disparity_map = correlator( left, right, stereo::CensusStereoPreprocessingFilter<>());
+        else if (log > 0)
           disparity_map = correlator( left, right, stereo::LogStereoPreprocessingFilter(log));
         else
           disparity_map = correlator( left, right, stereo::SlogStereoPreprocessingFilter(slog));
@@ -180,7 +187,7 @@ int main( int argc, char *argv[] ) {
       result = transform_disparities(disparity_map, HomographyTransform(alignment) );
 
     // Write disparity debug images
-    BBox2 disp_range = get_disparity_range(result);
+    BBox2 disp_range = get_disparity_range(result, Vector2i(256,256));
     std::cout << "Found disparity range: " << disp_range << "\n";
     ImageViewRef<float32> horizontal = apply_mask(copy_mask(clamp(normalize(select_channel(result,0), disp_range.min().x(), disp_range.max().x(),0,1)),result));
     ImageViewRef<float32> vertical = apply_mask(copy_mask(clamp(normalize(select_channel(result,1), disp_range.min().y(), disp_range.max().y(),0,1)),result));
@@ -19,11 +19,18 @@ std::string mosaic_name;
 std::string output_file_type;
 std::string channel_type_str;
 bool draft;
+bool compact_pyramids;
 unsigned int tilesize;
 bool tile_output = false;
 unsigned int patch_size, patch_overlap;
 float nodata_value;
 bool has_nodata_value = false;
+unsigned int update_count;
+bool update = false;
+std::string mask_cache;
+unsigned int part_size = 0;
+unsigned int node_index = 0, node_count = 1;
+bool stitch = false;
 
 using namespace vw;
 using namespace vw::math;
@@ -48,7 +55,14 @@ int main( int argc, char *argv[] ) {
       ("tiled-tiff", po::value(&tilesize)->default_value(0), "Output a tiled TIFF image, with given tile size (0 disables, TIFF only)")
       ("patch-size", po::value(&patch_size)->default_value(256), "Patch size for tiled output, in pixels")
       ("patch-overlap", po::value(&patch_overlap)->default_value(0), "Patch overlap for tiled output, in pixels")
+      ("update", po::value(&update_count), "Rewrite only the output tiles that the input files after the first N affect (tile output only)")
       ("draft", "Draft mode (no blending)")
+      ("compact-pyramids", "Keep the blending pyramids at 16-bit precision to save memory")
+      ("mask-cache", po::value(&mask_cache), "Directory in which to keep the blending masks of the input images between runs")
+      ("part-size", po::value(&part_size)->default_value(0), "Output the blended image as separate parts of this size in pixels, which can be generated on several nodes and then stitched (0 disables)")
+      ("node-index", po::value(&node_index)->default_value(0), "Generate only every node-count'th part or tile, starting with this one")
+      ("node-count", po::value(&node_count)->default_value(1), "The number of nodes that the parts or tiles are divided among")
+      ("stitch", "Stitch the parts written with --part-size into a single blended image")
       ("ignore-alpha", "Ignore the alpha channel of the input images, and don't write an alpha channel in output.")
       ("nodata-value", po::value(&nodata_value), "Pixel value to use for nodata in input and output (when there's no alpha channel)")
       ("channel-type", po::value(&channel_type_str), "Images' channel type. One of [uint8, uint16, int16, float].")
@@ -89,6 +103,7 @@ int main( int argc, char *argv[] ) {
     if( vm.count("draft") ) {
       draft = true;
     }
+    compact_pyramids = vm.count("compact-pyramids") != 0;
 
     if( vm.count("input-files") < 1 ) {
       std::cerr << "Error: Must specify at least one input file!" << std::endl << std::endl;
@@ -125,6 +140,40 @@ int main( int argc, char *argv[] ) {
 
     if(vm.count("nodata-value")) has_nodata_value = true;
 
+    if(vm.count("update")) {
+      if(!tile_output) {
+        std::cerr << "Error: Only tile output can be updated." << std::endl;
+        std::cerr << "\tThe option --update requires --tile-output." << std::endl;
+        return 1;
+      }
+      update = true;
+    }
+
+    if(vm.count("stitch")) stitch = true;
+
+    if( node_count == 0 || node_index >= node_count ) {
+      std::cerr << "Error: The node index must be less than the node count!  (You specified "
+                << node_index << " of " << node_count << ".)" << std::endl;
+      return 1;
+    }
+
+    if( (part_size > 0 || stitch) && tile_output ) {
+      std::cerr << "Error: Cannot output both blended image parts and individual tiles." << std::endl;
+      std::cerr << "\tThe options --part-size and --stitch conflict with --tile-output." << std::endl;
+      return 1;
+    }
+
+    if( stitch && part_size == 0 ) {
+      std::cerr << "Error: The option --stitch requires the --part-size the parts were written with." << std::endl;
+      return 1;
+    }
+
+    if( node_count > 1 && part_size == 0 && !tile_output ) {
+      std::cerr << "Error: Only parts or tiles can be divided among nodes." << std::endl;
+      std::cerr << "\tThe option --node-count requires --part-size or --tile-output." << std::endl;
+      return 1;
+    }
+
     ImageFormat fmt = tools::taste_image(image_files[0]);
 
     if (vm.count("channel-type")) {
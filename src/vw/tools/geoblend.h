@@ -16,8 +16,14 @@
 #include <vw/Image/Filter.h>
 #include <vw/FileIO/DiskImageResourceGDAL.h>
 
+#include <iomanip>
+#include <sstream>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
+namespace fs = boost::filesystem;
 
 // Global Variables from the command line.
 extern std::vector<std::string> image_files;
@@ -25,11 +31,18 @@ extern std::string mosaic_name;
 extern std::string output_file_type;
 extern std::string channel_type_str;
 extern bool draft;
+extern bool compact_pyramids;
 extern unsigned int tilesize;
 extern bool tile_output;
 extern unsigned int patch_size, patch_overlap;
 extern float nodata_value;
 extern bool has_nodata_value;
+extern unsigned int update_count;
+extern bool update;
+extern std::string mask_cache;
+extern unsigned int part_size;
+extern unsigned int node_index, node_count;
+extern bool stitch;
 
 namespace vw {
 
@@ -94,6 +107,94 @@ namespace vw {
     return vw::per_pixel_filter(view.impl(), MaskToNodataFunctor<typename ViewT::pixel_type>(nodata_value));
   }
 
+  // A view of the parts of a blended image, each read from its own
+  // file, as written by a partitioned geoblend.  The parts must cover
+  // the image without overlapping.
+  template <class PixelT>
+  class PartsView : public ImageViewBase<PartsView<PixelT> > {
+    int32 m_cols, m_rows;
+    std::vector<std::pair<BBox2i, DiskImageView<PixelT> > > m_parts;
+
+  public:
+    typedef PixelT pixel_type;
+    typedef PixelT result_type;
+    typedef ProceduralPixelAccessor<PartsView> pixel_accessor;
+
+    PartsView( int32 cols, int32 rows ) : m_cols(cols), m_rows(rows) {}
+
+    void add( BBox2i const& bbox, std::string const& filename ) {
+      DiskImageView<PixelT> part( filename );
+      VW_ASSERT( part.cols() == bbox.width() && part.rows() == bbox.height(),
+                 IOErr() << "Part " << filename << " is " << part.cols() << "x" << part.rows()
+                 << " pixels, but should be " << bbox.width() << "x" << bbox.height() << "." );
+      m_parts.push_back( std::make_pair( bbox, part ) );
+    }
+
+    int32 cols() const { return m_cols; }
+    int32 rows() const { return m_rows; }
+    int32 planes() const { return 1; }
+
+    pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+    pixel_type operator()( int32 x, int32 y, int32 p=0 ) const {
+      return prerasterize( BBox2i(x,y,1,1) )(x,y,p);
+    }
+
+    typedef CropView<ImageView<PixelT> > prerasterize_type;
+    prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<PixelT> buf( bbox.width(), bbox.height() );
+      for( size_t i=0; i<m_parts.size(); ++i ) {
+        BBox2i section = m_parts[i].first;
+        section.crop( bbox );
+        if( section.empty() ) continue;
+        crop( buf, section - bbox.min() ) = crop( m_parts[i].second, section - m_parts[i].first.min() );
+      }
+      return prerasterize_type( buf, BBox2i(-bbox.min().x(),-bbox.min().y(),cols(),rows()) );
+    }
+    template <class DestT> void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+  };
+
+  // The parts that a partitioned geoblend divides an image into, in
+  // row-major order.
+  inline std::vector<BBox2i> image_parts( int32 cols, int32 rows, int32 size ) {
+    std::vector<BBox2i> parts;
+    for( int32 y=0; y < rows; y += size )
+      for( int32 x=0; x < cols; x += size )
+        parts.push_back( BBox2i( x, y, std::min(size, cols-x), std::min(size, rows-y) ) );
+    return parts;
+  }
+
+  inline std::string part_filename( BBox2i const& part ) {
+    std::ostringstream filename;
+    filename << mosaic_name << ".part." << part.min().x() << '.' << part.min().y() << '.' << output_file_type;
+    return filename.str();
+  }
+
+  // The georeference of the part of an image starting at the given
+  // pixel.
+  inline cartography::GeoReference offset_georef( cartography::GeoReference const& georef, Vector2i const& origin ) {
+    cartography::GeoReference result = georef;
+    Vector2 upper_left = georef.pixel_to_point( Vector2( origin ) );
+    Matrix3x3 transform = result.transform();
+    transform(0,2) = upper_left[0];
+    transform(1,2) = upper_left[1];
+    result.set_transform( transform );
+    return result;
+  }
+
+  template <class PixelT>
+  void write_blend( std::string const& filename, ImageViewRef<PixelT> const& image,
+                    cartography::GeoReference const& georef, ProgressCallback const& progress ) {
+    boost::scoped_ptr<DiskImageResourceGDAL> resource;
+    if(tilesize > 0)
+      resource.reset( new DiskImageResourceGDAL( filename, image.format(), Vector2i(tilesize, tilesize) ) );
+    else
+      resource.reset( new DiskImageResourceGDAL( filename, image.format() ) );
+    write_georeference( *resource, georef );
+    write_image( *resource, image, progress );
+  }
+
   // do_blend()
   //
   // This performs the actual work of geoblend
@@ -107,6 +208,13 @@ namespace vw {
 
     vw::mosaic::ImageComposite<float_pixel_type> composite;
     if( draft ) composite.set_draft_mode( true );
+    if( compact_pyramids ) composite.set_compact_pyramids( true );
+    composite.set_mask_cache( mask_cache );
+    // A partitioned blend computes the blend of each part from only
+    // the blocks of the sources near it, so that a node does not have
+    // to prepare every source in full.  Stitching reads the parts and
+    // blends nothing.
+    if( part_size > 0 ) composite.set_streaming( true );
 
     double smallest_x_scale = vw::ScalarTypeLimits<float>::highest();
     double smallest_y_scale = vw::ScalarTypeLimits<float>::highest();
@@ -173,8 +281,10 @@ namespace vw {
     tpc.set_progress_text( "Status (assembling): " );
     SubProgressCallback assembling_pc( tpc, 0.05, 0.1 );
     // Second pass: add files to the image composite.
+    size_t first_new_source = 0;
     for(unsigned i = 0; i < image_files.size(); ++i) {
       assembling_pc.report_fractional_progress(i, image_files.size() );
+      if( update && i == update_count ) first_new_source = composite.num_sources();
       cartography::GeoReference input_georef;
       read_georeference(input_georef, image_files[i]);
       DiskImageView<PixelT> source_disk_image( image_files[i] );
@@ -183,16 +293,26 @@ namespace vw {
       BBox2 output_bbox = trans.forward_bbox( BBox2(0,0,source_disk_image.cols(),source_disk_image.rows()) );
       vw_out(vw::VerboseDebugMessage) << "output_bbox = " << output_bbox << std::endl;
 
+      // The mask of a source depends on the file, how it was
+      // resampled, and which pixels are nodata.
+      std::ostringstream source_id;
+      if( ! mask_cache.empty() ) {
+        source_id << std::setprecision(17);
+        source_id << tools::file_identity( image_files[i] ) << "\n" << input_georef.transform()
+                  << " to " << output_georef.transform() << " " << output_georef.proj4_str();
+        if( has_nodata_value ) source_id << "\nnodata " << nodata_value;
+      }
+
       // I've hardwired this to use nearest pixel interpolation for now
       // until we have a chance to sit down and develop a better
       // strategy for intepolating and filtering in the presence of
       // missing pixels in DEMs. -mbroxton
       if (has_nodata_value) {
         ImageViewRef<alpha_pixel_type> masked_source = crop( transform( nodata_to_mask(source_disk_image, (typename PixelChannelType<PixelT>::type)(nodata_value) ), trans, ZeroEdgeExtension(), NearestPixelInterpolation() ), output_bbox );
-        composite.insert( channel_cast_rescale<float32>(masked_source), (int)output_bbox.min().x(), (int)output_bbox.min().y() );
+        composite.insert( channel_cast_rescale<float32>(masked_source), (int)output_bbox.min().x(), (int)output_bbox.min().y(), source_id.str() );
       } else {
         ImageViewRef<alpha_pixel_type> masked_source = crop( transform( pixel_cast<alpha_pixel_type>(source_disk_image), trans, ZeroEdgeExtension(), NearestPixelInterpolation() ), output_bbox );
-        composite.insert( channel_cast_rescale<float32>(masked_source), (int)output_bbox.min().x(), (int)output_bbox.min().y() );
+        composite.insert( channel_cast_rescale<float32>(masked_source), (int)output_bbox.min().x(), (int)output_bbox.min().y(), source_id.str() );
       }
 
     }
@@ -212,11 +332,25 @@ namespace vw {
       const int tile_height = composite.rows() / dim;
       vw_out(vw::VerboseDebugMessage) << "Outputting composite in " << tile_width * tile_height << " tiles." << std::endl;
 
+      // When updating, the tiles that the new files do not affect are
+      // left as they are.  The existing tiles must have been made from
+      // the same earlier files, and the new ones must lie within them.
+      BBox2i dirty_bbox( 0, 0, composite.cols(), composite.rows() );
+      if( update ) {
+        dirty_bbox = ( update_count < image_files.size() ) ? composite.changed_bbox( first_new_source ) : BBox2i();
+        vw_out(vw::VerboseDebugMessage) << "Updating the tiles overlapping " << dirty_bbox << std::endl;
+      }
+
+      // Tiles are divided among the nodes in the order they are
+      // visited.
+      unsigned tile_index = 0;
       for(int i=0; i < composite.rows(); i += dim) {
         for(int j=0; j < composite.cols(); j += dim) {
+          if( tile_index++ % node_count != node_index ) continue;
           BBox2i tile_bbox(j, i, dim, dim);
           if(tile_bbox.max().x() >= composite.cols()) tile_bbox.max().x() = composite.cols();
           if(tile_bbox.max().y() >= composite.rows()) tile_bbox.max().y() = composite.cols();
+          if( dirty_bbox.empty() || ! tile_bbox.intersects( dirty_bbox ) ) continue;
           ImageView<PixelT> tile_view = crop(channel_cast_rescale<typename PixelChannelType<PixelT>::type>(composite), tile_bbox);
           cartography::GeoReference tile_georef = output_georef;
 
@@ -244,7 +378,6 @@ namespace vw {
                                       << "\t\tBBox: " << output_georef.bounding_box(composite) << " [ W: " << output_georef.bounding_box(composite).width() << " H: " << output_georef.bounding_box(composite).height() << " ]" << std::endl << std::endl;
 
       std::string mosaic_filename = mosaic_name+".blend."+output_file_type;
-      DiskImageResourceGDAL *out_resource;
       ImageViewRef<PixelT> out_image;
 
       // Specify the output image resource.
@@ -254,16 +387,34 @@ namespace vw {
         out_image = pixel_cast<PixelT>( channel_cast_rescale<typename PixelChannelType<PixelT>::type>(composite) );
       }
 
-      // Set up tiled TIFF output, if it's specified.
-      if(tilesize > 0)
-        out_resource = new DiskImageResourceGDAL( mosaic_filename, out_image.format(), Vector2i(tilesize, tilesize) );
-      else
-        out_resource = new DiskImageResourceGDAL( mosaic_filename, out_image.format() );
-
-      // Finally, write.
-      write_georeference(*out_resource, output_georef);
-      write_image(*out_resource, out_image, blending_pc);
-      delete out_resource;
+      std::vector<BBox2i> parts;
+      if( part_size > 0 ) parts = image_parts( composite.cols(), composite.rows(), part_size );
+
+      if( stitch ) {
+        // Every pixel of the parts is final, since each part was
+        // blended from the whole of its surroundings, so stitching is
+        // only a copy.
+        PartsView<PixelT> stitched( composite.cols(), composite.rows() );
+        for( size_t n=0; n < parts.size(); ++n ) {
+          VW_ASSERT( fs::exists( part_filename( parts[n] ) ),
+                     IOErr() << "Missing part " << part_filename( parts[n] ) << "; was every node run?" );
+          stitched.add( parts[n], part_filename( parts[n] ) );
+        }
+        write_blend( mosaic_filename, ImageViewRef<PixelT>( stitched ), output_georef, blending_pc );
+      } else if( part_size > 0 ) {
+        // Each node writes its share of the parts, in turn.
+        size_t count = 0;
+        for( size_t n=node_index; n < parts.size(); n += node_count ) ++count;
+        vw_out(vw::VerboseDebugMessage) << "Outputting " << count << " of " << parts.size() << " parts." << std::endl;
+        size_t done = 0;
+        for( size_t n=node_index; n < parts.size(); n += node_count, ++done ) {
+          SubProgressCallback part_pc( blending_pc, double(done)/count, double(done+1)/count );
+          write_blend( part_filename( parts[n] ), ImageViewRef<PixelT>( crop( out_image, parts[n] ) ),
+                       offset_georef( output_georef, parts[n].min() ), part_pc );
+        }
+      } else {
+        write_blend( mosaic_filename, out_image, output_georef, blending_pc );
+      }
     }
     blending_pc.report_finished();
 
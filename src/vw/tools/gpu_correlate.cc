@@ -352,7 +352,8 @@ int main(int argc, char *argv[]) {
   * max_dx (int, 100) \n  * min_dy (int, 0) \n  * max_dy (int, 0) \n  * error_threshold (float, 1.0)\n\
   * output_image_dx (string, \'./Output_DX.png\') - Normalized from [mix_dx to max_dx]\n\
   * output_image_dy (string, '') - Normalized from [mix_dy to max_dy]\n\
-  * output_image_error (string, '') - Normalized from [0 to highest possible error score]\n");
+  * output_image_error (string, '') - Normalized from [0 to highest possible error score]\n\
+  * shader_cache_dir (string, '') - Directory to cache compiled shaders in between runs\n");
     return -1;
   }
   string left_path = argv[1];
@@ -366,6 +367,7 @@ int main(int argc, char *argv[]) {
   string output_path_dx = (argc >= 10) ? argv[9] : "Output_DX.png";
   string output_path_dy = (argc >= 11) ? argv[10] : "";
   string output_path_score = (argc >= 12) ? argv[11] : "";
+  string shader_cache_dir = (argc >= 13) ? argv[12] : "";
 
   printf("  * left_image = \'%s\'\n  * right_image = \'%s\'\n  * kernal_size = %i\n  * min_dx = %i \n\
   * max_dx = %i \n  * min_dy = %i \n  * max_dy = %i \n  * error_threshold = %f\n\
@@ -377,6 +379,8 @@ int main(int argc, char *argv[]) {
   gpu_init("Log_VWGPU.txt");
   set_shader_language_choice(SHADER_LANGUAGE_CHOICE_GLSL);
   set_gpu_memory_recycling(true);
+  if(!shader_cache_dir.empty())
+    set_shader_assembly_cache_path(shader_cache_dir);
   // Read images
   ImageView<PixelGray<float> > left_image, right_image;
   read_image(left_image, left_path);
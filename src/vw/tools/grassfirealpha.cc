@@ -145,15 +145,19 @@ void grassfire_nodata( Options& opt,
   cartography::GeoReference georef;
   cartography::read_georeference(georef, input);
   DiskImageView<PixelT> input_image(input);
-  ImageView<int32> distance =
-    grassfire(notnodata(input_image,
-                        inter_type(opt.nodata)));
+  // The distances are computed tile by tile as they are needed, so
+  // neither the input nor the distances have to fit in memory.
+  int32 tile = vw_settings().default_tile_size();
+  ImageViewRef<int32> distance =
+    block_cache(block_grassfire(notnodata(input_image,
+                                          inter_type(opt.nodata))),
+                Vector2i(tile, tile));
 
   // Check to see if the user has specified a feather length.  If not,
   // then we send the feather_max to the max pixel value (which
   // results in a full grassfire blend all the way to the center of the image.)
   if (opt.feather_max < 1)
-    opt.feather_max = max_pixel_value( distance );
+    opt.feather_max = channel_statistics( distance ).maximum();
   vw_out() << "\t--> Distance range: [ " << opt.feather_min << " " << opt.feather_max << " ]\n";
 
   ImageViewRef<inter_type> norm_dist;
@@ -191,13 +195,16 @@ void grassfire_alpha( Options& opt,
   cartography::GeoReference georef;
   cartography::read_georeference(georef, input);
   DiskImageView<PixelT> input_image(input);
-  ImageView<int32> distance = grassfire(apply_mask(invert_mask(alpha_to_mask(input_image)),1));
+  int32 tile = vw_settings().default_tile_size();
+  ImageViewRef<int32> distance =
+    block_cache(block_grassfire(apply_mask(invert_mask(alpha_to_mask(input_image)),1)),
+                Vector2i(tile, tile));
 
   // Check to see if the user has specified a feather length.  If not,
   // then we send the feather_max to the max pixel value (which
   // results in a full grassfire blend all the way to the center of the image.)
   if (opt.feather_max < 1)
-    opt.feather_max = max_pixel_value( distance );
+    opt.feather_max = channel_statistics( distance ).maximum();
   vw_out() << "\t--> Distance range: [ " << opt.feather_min << " " << opt.feather_max << " ]\n";
 
   typedef typename CompoundChannelType<PixelT>::type inter_type;
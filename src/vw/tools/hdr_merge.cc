@@ -24,6 +24,7 @@
 #endif
 
 #include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
 namespace po = boost::program_options;
 
 #include <vw/Image.h>
@@ -111,7 +112,12 @@ int main( int argc, char *argv[] ) {
 
     TerminalProgressCallback tpc( "tools.hdr_merge", "Processing");
     // Create the HDR images and write the results to the file
-    write_image(output_filename, HighDynamicRangeView<PixelRGB<float> > (images, curves, brightness_values), tpc);
+    HighDynamicRangeView<PixelRGB<float> > hdr_image(images, curves, brightness_values);
+    boost::scoped_ptr<DiskImageResource> r(DiskImageResource::create(output_filename, hdr_image.format()));
+    if ( r->has_block_write() )
+      r->set_block_write_size( Vector2i( vw_settings().default_tile_size(),
+                                         vw_settings().default_tile_size() ) );
+    block_write_image( *r, hdr_image, tpc );
 
   } catch (const vw::Exception& e) {
     vw_out() << argv[0] << ": a Vision Workbench error occurred: \n\t"
@@ -16,6 +16,9 @@
 #endif
 
 #include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
 
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
@@ -27,10 +30,11 @@ namespace fs = boost::filesystem;
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/ImageViewRef.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/Filter.h>
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/MaskViews.h>
-#include <vw/Image/PerPixelAccessorViews.h>
+#include <vw/Image/EdgeExtension.h>
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/FileIO/DiskImageResourceGDAL.h>
 #include <vw/Cartography/GeoReference.h>
@@ -52,76 +56,99 @@ struct Options {
 
 // ----------------------------------------------------------------------------
 
-//  compute_normals()
+//  HillshadeView
 //
-// Compute a vector normal to the surface of a DEM for each given
-// pixel.  The normal is computed by forming a plane with three points
-// in the vicinity of the requested pixel, and then finding the vector
-// normal to that plane.  The user must specify the scale in the [u,v]
-// directions so that the direction of the vector in physical space
-// can be properly ascertained.  This is often contained in the (0,0)
-// and (1,1) entry of the georeference transform.
-class ComputeNormalsFunc : public ReturnFixedType<PixelMask<Vector3f> >
-{
+// Shades a DEM as lit from the given direction.  The normal of each
+// pixel is that of the plane through it and its neighbors to the
+// right and below, scaled by the pixel size in [u,v]; this is often
+// contained in the (0,0) and (1,1) entry of the georeference
+// transform.  The shade is the dot product of the normal with the
+// light, clamped to [0,1] and scaled to 8 bits.  A pixel is invalid
+// if any of the three DEM pixels is, and the DEM is extended past its
+// edges with its edge values.
+//
+// Blocks are shaded a row at a time from the raster block of the DEM
+// they need, in a loop the compiler can vectorize: the validity is
+// folded in arithmetically, and invalid heights are zeroed first so
+// that nodata values never reach the arithmetic.
+template <class ViewT>
+class HillshadeView : public ImageViewBase<HillshadeView<ViewT> > {
+  ViewT m_dem;
   float m_u_scale, m_v_scale;
+  Vector3f m_light;
 
 public:
-  ComputeNormalsFunc(float u_scale, float v_scale) :
-    m_u_scale(u_scale), m_v_scale(v_scale) {}
+  typedef PixelMask<PixelGray<uint8> > pixel_type;
+  typedef pixel_type result_type;
+  typedef ProceduralPixelAccessor<HillshadeView> pixel_accessor;
 
-  BBox2i work_area() const { return BBox2i(Vector2i(0, 0), Vector2i(1, 1)); }
+  HillshadeView( ViewT const& dem, float u_scale, float v_scale, Vector3f const& light )
+    : m_dem(dem), m_u_scale(u_scale), m_v_scale(v_scale), m_light(normalize(light)) {}
 
-  template <class PixelAccessorT>
-  PixelMask<Vector3f> operator() (PixelAccessorT const& accessor_loc) const {
-    PixelAccessorT acc = accessor_loc;
+  inline int32 cols() const { return m_dem.cols(); }
+  inline int32 rows() const { return m_dem.rows(); }
+  inline int32 planes() const { return 1; }
 
-    // Pick out the three altitude values.
-    if (is_transparent(*acc))
-      return PixelMask<Vector3f>();
-    float alt1 = *acc;
+  inline pixel_accessor origin() const { return pixel_accessor( *this ); }
 
-    acc.advance(1,0);
-    if (is_transparent(*acc))
-      return PixelMask<Vector3f>();
-    float alt2 = *acc;
-
-    acc.advance(-1,1);
-    if (is_transparent(*acc))
-      return PixelMask<Vector3f>();
-    float alt3 = *acc;
+  inline result_type operator()( int32 x, int32 y, int32 p=0 ) const {
+    ImageView<pixel_type> pixel( 1, 1 );
+    rasterize( pixel, BBox2i(x,y,1,1) );
+    return pixel(0,0,p);
+  }
 
-    // Form two orthogonal vectors in the plane containing the three
-    // altitude points
-    Vector3f n1(m_u_scale, 0, alt2-alt1);
-    Vector3f n2(0, m_v_scale, alt3-alt1);
+  typedef CropView<ImageView<pixel_type> > prerasterize_type;
+  inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+    ImageView<pixel_type> dest( bbox.width(), bbox.height() );
+    rasterize( dest, bbox );
+    return CropView<ImageView<pixel_type> >( dest, BBox2i(-bbox.min().x(),-bbox.min().y(),cols(),rows()) );
+  }
 
-    // Return the vector normal to the local plane.
-    return normalize(cross_prod(n1,n2));
+  template <class DestT>
+  void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+    ImageView<pixel_type> shaded( bbox.width(), bbox.height() );
+    rasterize( shaded, bbox );
+    vw::rasterize( shaded, dest, BBox2i(0,0,bbox.width(),bbox.height()) );
   }
-};
 
-template <class ViewT>
-UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ConstantEdgeExtension>, ComputeNormalsFunc> compute_normals(ImageViewBase<ViewT> const& image,
-                                                                                                              float u_scale, float v_scale) {
-  return UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ConstantEdgeExtension>, ComputeNormalsFunc>(edge_extend(image.impl(), ConstantEdgeExtension()),
-                                                                                                       ComputeNormalsFunc (u_scale, v_scale));
-}
+  void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const {
+    int32 width = bbox.width(), height = bbox.height();
+    ImageView<typename ViewT::pixel_type> dem =
+      crop( edge_extend( m_dem, ConstantEdgeExtension() ), BBox2i(bbox.min(), bbox.max()+Vector2i(1,1)) );
+    ImageView<float> alt( width+1, height+1 ), valid( width+1, height+1 );
+    for ( int32 y=0; y<=height; ++y )
+      for ( int32 x=0; x<=width; ++x ) {
+        valid(x,y) = is_valid( dem(x,y) ) ? 1.0f : 0.0f;
+        alt(x,y) = valid(x,y) * float( dem(x,y)[0] );
+      }
 
-class DotProdFunc : public ReturnFixedType<PixelMask<PixelGray<float> > > {
-  Vector3f m_vec;
-public:
-  DotProdFunc(Vector3f const& vec) : m_vec(normalize(vec)) {}
-  PixelMask<PixelGray<float> > operator() (PixelMask<Vector3f> const& pix) const {
-    if (is_transparent(pix))
-      return PixelMask<PixelGray<float> >();
-    else
-      return dot_prod(pix.child(),m_vec);
+    // The normal is (-v*dx, -u*dy, u*v) before normalizing.
+    const float nz = m_u_scale * m_v_scale;
+    const float lx = -m_v_scale * m_light[0], ly = -m_u_scale * m_light[1], lz = nz * m_light[2];
+    const float nz2 = nz * nz, u2 = m_u_scale * m_u_scale, v2 = m_v_scale * m_v_scale;
+    std::vector<float> shade( width ), mask( width );
+    for ( int32 y=0; y<height; ++y ) {
+      const float *a0 = &alt(0,y), *a1 = &alt(0,y+1);
+      const float *m0 = &valid(0,y), *m1 = &valid(0,y+1);
+      for ( int32 x=0; x<width; ++x ) {
+        float dx = a0[x+1] - a0[x], dy = a1[x] - a0[x];
+        float s = ( lx*dx + ly*dy + lz ) / std::sqrt( v2*dx*dx + u2*dy*dy + nz2 );
+        s = std::min( std::max( s, 0.0f ), 1.0f );
+        mask[x] = m0[x] * m0[x+1] * m1[x];
+        shade[x] = mask[x] * float( uint8( s * 255.0f ) );
+      }
+      pixel_type* out = &dest(0,y);
+      for ( int32 x=0; x<width; ++x ) {
+        out[x][0] = uint8( shade[x] );
+        out[x][1] = uint8( 255.0f * mask[x] );
+      }
+    }
   }
 };
 
 template <class ViewT>
-UnaryPerPixelView<ViewT, DotProdFunc> dot_prod(ImageViewBase<ViewT> const& view, Vector3f const& vec) {
-  return UnaryPerPixelView<ViewT, DotProdFunc>(view.impl(), DotProdFunc(vec));
+HillshadeView<ViewT> hillshade( ImageViewBase<ViewT> const& dem, float u_scale, float v_scale, Vector3f const& light ) {
+  return HillshadeView<ViewT>( dem.impl(), u_scale, v_scale, light );
 }
 
 // ----------------------------------------------------------------------------
@@ -177,8 +204,7 @@ void do_hillshade(Options& opt) {
   }
 
   // The final result is the dot product of the light source with the normals
-  ImageViewRef<PixelMask<PixelGray<uint8> > > shaded_image =
-    channel_cast_rescale<uint8>(clamp(dot_prod(compute_normals(dem, u_scale, v_scale), light)));
+  ImageViewRef<PixelMask<PixelGray<uint8> > > shaded_image = hillshade(dem, u_scale, v_scale, light);
 
   // Save the result
   vw_out() << "Writing shaded relief image: " << opt.output_file_name << "\n";
@@ -174,8 +174,11 @@ int handle_options(int argc, char *argv[], Options& opt) {
     ("max-lod-pixels"   , po::value(&opt.kml.max_lod_pixels)->default_value(1024), "Max LoD in pixels, or -1 for none (kml only)")
     ("draw-order-offset", po::value(&opt.kml.draw_order_offset)->default_value(0), "Offset for the <drawOrder> tag for this overlay (kml only)")
     ("multiband"        , po::bool_switch(&opt.multiband)                        , "Composite images using multi-band blending")
+    ("mask-cache"       , po::value(&opt.mask_cache)                             , "Directory in which to keep the blending masks of the input images between runs (multiband only)")
     ("aspect-ratio"     , po::value(&opt.aspect_ratio)                           , "Pixel aspect ratio (for polar overlays; should be a power of two)")
-    ("global-resolution", po::value(&opt.global_resolution)                      , "Override the global pixel resolution; should be a power of two");
+    ("global-resolution", po::value(&opt.global_resolution)                      , "Override the global pixel resolution; should be a power of two")
+    ("update"           , po::value(&opt.update)                                 , "Update an existing overlay that was made from the first N input files, regenerating only the tiles that the rest affect")
+    ("pack"             , po::bool_switch(&opt.pack)                             , "Write the tiles into one pack file, <output-name>.vwpack, instead of a file each (tms and gmap only)");
 
   po::options_description projection_options("Input Projection Options");
   projection_options.add_options()
@@ -13,6 +13,8 @@
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <iomanip>
+#include <sstream>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/path.hpp>
@@ -77,12 +79,14 @@ struct Options {
     normalize(false),
     terrain(false),
     manual(false),
-    global(false)
+    global(false),
+    pack(false)
   {}
 
   std::vector<std::string> input_files;
 
   std::string output_file_name;
+  std::string mask_cache;
   vw::tools::Tristate<std::string> output_file_type;
   vw::tools::Tristate<std::string> module_name;
   vw::tools::Tristate<double> nudge_x, nudge_y;
@@ -94,6 +98,7 @@ struct Options {
   vw::tools::Tristate<vw::uint32> global_resolution;
   vw::tools::Tristate<float>  nodata;
   vw::tools::Tristate<float>  north, south, east, west;
+  vw::tools::Tristate<vw::uint32> update;
 
   Channel channel_type;
   Mode mode;
@@ -104,6 +109,7 @@ struct Options {
   bool terrain;
   bool manual;
   bool global;
+  bool pack;
 
   struct {
     vw::uint32 draw_order_offset;
@@ -166,6 +172,12 @@ struct Options {
       break;
     }
 
+    // KML overlays refer to each tile by its file name, so they cannot
+    // be packed.
+    if (pack)
+      VW_ASSERT(mode == Mode::TMS || mode == Mode::GMAP,
+                vw::tools::Usage() << "Only tms and gmap overlays can be written to a pack file");
+
     if (jpeg_quality.set())
       vw::DiskImageResourceJPEG::set_default_quality( jpeg_quality );
     if (png_compression.set())
@@ -191,6 +203,7 @@ void do_normal_mosaic(const Options& opt, const vw::ProgressCallback *progress)
   using namespace vw;
   DiskImageView<PixelT> img(opt.input_files[0]);
   mosaic::QuadTreeGenerator quadtree(img, opt.output_file_name);
+  quadtree.set_parallel( true );
   quadtree.set_tile_size( opt.tile_size );
   quadtree.set_file_type( opt.output_file_type );
 
@@ -274,10 +287,14 @@ void do_mosaic(const Options& opt, const vw::ProgressCallback *progress) {
 
   // Configure the composite.
   mosaic::ImageComposite<PixelT> composite;
+  composite.set_mask_cache( opt.mask_cache );
 
   // Add the transformed image files to the composite.
+  size_t first_new_source = 0;
   for(size_t i=0; i < opt.input_files.size(); i++) {
     const std::string& filename = opt.input_files[i];
+    if( opt.update.set() && i == opt.update.value() )
+      first_new_source = composite.num_sources();
     const GeoReference& input_ref = georeferences[i];
 
     boost::shared_ptr<DiskImageResource> file( DiskImageResource::open(filename) );
@@ -318,6 +335,19 @@ void do_mosaic(const Options& opt, const vw::ProgressCallback *progress) {
     }
 
     BBox2i bbox = geotx.forward_bbox( BBox2i(0,0,source.cols(),source.rows()) );
+
+    // The mask of a source depends on the file, how its pixels were
+    // adjusted, and how it was resampled.
+    std::ostringstream source_id;
+    if( ! opt.mask_cache.empty() ) {
+      source_id << std::setprecision(17) << vw::tools::file_identity( filename )
+                << "\n" << input_ref.transform() << " " << input_ref.proj4_str()
+                << " to " << output_georef.transform() << " " << output_georef.proj4_str()
+                << "\nscale " << opt.pixel_scale.value() << " offset " << opt.pixel_offset.value();
+      if( opt.nodata.set() ) source_id << "\nnodata " << opt.nodata.value();
+      if( opt.normalize ) source_id << "\nnormalize";
+      if( global ) source_id << "\nglobal";
+    }
     if ( global ) {
       vw_out() << "\t--> Detected global overlay. Using cylindrical edge extension to hide the seam.\n";
       source = crop( transform( source, geotx, source.cols(), source.rows(), CylindricalEdgeExtension() ), bbox );
@@ -349,11 +379,11 @@ void do_mosaic(const Options& opt, const vw::ProgressCallback *progress) {
     // Images that wrap the date line must be added to the composite
     // on both sides.
     if( bbox.max().x() > total_resolution ) {
-      composite.insert( source, bbox.min().x()-total_resolution, bbox.min().y() );
+      composite.insert( source, bbox.min().x()-total_resolution, bbox.min().y(), source_id.str() );
     }
     // Images that are in the 180-360 range *only* go on the other side.
     if( bbox.min().x() < xresolution ) {
-      composite.insert( source, bbox.min().x(), bbox.min().y() );
+      composite.insert( source, bbox.min().x(), bbox.min().y(), source_id.str() );
     }
   }
 
@@ -388,6 +418,7 @@ void do_mosaic(const Options& opt, const vw::ProgressCallback *progress) {
             LogicErr() << "Composite image is empty. Georeference calculation is probably incorrect.");
 
   mosaic::QuadTreeGenerator quadtree( composite, opt.output_file_name );
+  quadtree.set_parallel( true );
 
   // This whole bit here is terrible. This functionality should be moved into
   // the Config base class somehow.
@@ -431,9 +462,38 @@ void do_mosaic(const Options& opt, const vw::ProgressCallback *progress) {
 
   quadtree.set_crop_bbox(data_bbox);
 
+  // When updating, the tree must have been generated from the same
+  // earlier input files, and the new ones must lie within it.
+  if( opt.update.set() ) {
+    BBox2i dirty_bbox;
+    if( opt.update.value() < opt.input_files.size() )
+      dirty_bbox = composite.changed_bbox( first_new_source );
+    if( dirty_bbox.empty() ) {
+      vw_out() << "No new input files affect the overlay." << std::endl;
+      return;
+    }
+    vw_out() << "Updating the tiles overlapping " << dirty_bbox << std::endl;
+    quadtree.set_dirty_bbox( dirty_bbox );
+  }
+
+  // Packed tiles are still encoded by the configuration, and an update
+  // reads the old ones back from the pack and appends the new ones.
+  boost::shared_ptr<mosaic::TilePackWriter> pack;
+  if( opt.pack ) {
+    std::string pack_name = opt.output_file_name + ".vwpack";
+    if( opt.update.set() ) {
+      boost::shared_ptr<mosaic::TilePackReader> old_pack( new mosaic::TilePackReader( pack_name ) );
+      quadtree.set_tile_source_func( mosaic::packed_tile_source_func( old_pack ) );
+    }
+    pack.reset( new mosaic::TilePackWriter( pack_name, opt.update.set() ) );
+    quadtree.set_tile_resource_func( mosaic::packed_tile_resource_func( pack, quadtree.get_tile_resource_func() ) );
+    vw_out() << "Writing tiles to " << pack_name << std::endl;
+  }
+
   // Generate the composite.
   vw_out() << "Generating " << opt.mode.string() << " overlay..." << std::endl;
   quadtree.generate(*progress);
+  if( pack ) pack->close();
 }
 
 #define PROTOTYPE_ALL_CHANNEL_TYPES( PIXELTYPE )        \
@@ -157,6 +157,7 @@ int main(int argc, char **argv) {
   ToastQuadTreeConfig tqtc;
   tqtc.configure( qtree, composite );
   qtree.set_file_type( output_file_type );
+  qtree.set_parallel( true );
   qtree.generate( TerminalProgressCallback( "tools.image2toast","") );
 
   return 0;
@@ -110,7 +110,7 @@ int main(int argc, char** argv) {
   std::vector<std::string> input_file_names;
   std::string interest_operator, descriptor_generator;
   float ip_gain;
-  uint32 max_points;
+  uint32 max_points, points_per_tile;
   int tile_size, num_threads;
   ImageView<double> integral;
 
@@ -124,6 +124,7 @@ int main(int argc, char** argv) {
     ("num-threads", po::value(&num_threads)->default_value(0), "Set the number of threads for interest point detection.  Setting the num_threads to zero causes ipfind to use the visionworkbench default number of threads.")
     ("tile-size,t", po::value(&tile_size), "Specify the tile size for processing interest points. (Useful when working with large images).")
     ("lowe,l", "Save the interest points in an ASCII data format that is compatible with the Lowe-SIFT toolchain.")
+    ("ip-set", "Also save the interest points as a memory-mappable interest point set file (.vwips), which ipmatch reads in preference to the .vwip file.")
     ("normalize", "Normalize the input, use for images that have non standard values such as ISIS cube files.")
     ("debug-image,d", "Write out debug images.")
 
@@ -131,6 +132,7 @@ int main(int argc, char** argv) {
     ("interest-operator", po::value(&interest_operator)->default_value("OBALoG"), "Choose an interest point metric from [LoG, Harris, OBALoG]")
     ("gain,g", po::value(&ip_gain)->default_value(1.0), "Increasing this number will increase the gain at which interest points are detected.")
     ("max-points", po::value(&max_points)->default_value(0), "Set the maximum number of interest points you want returned.  The most \"interesting\" points are selected.")
+    ("points-per-tile", po::value(&points_per_tile)->default_value(0), "Keep at most this many of the most \"interesting\" points of each tile, so each tile is thresholded on its own.  Zero keeps them all.")
     ("single-scale", "Turn off scale-invariant interest point detection.  This option only searches for interest points in the first octave of the scale space.")
 
     // Descriptor generator options
@@ -229,17 +231,18 @@ int main(int argc, char** argv) {
 
     // Detecting Interest Points
     InterestPointList ip;
+    boost::scoped_ptr<IntegralScaleSpace> scale_space;
     if ( interest_operator == "harris" ) {
       // Harris threshold is inversely proportional to gain.
       HarrisInterestOperator interest_operator(IDEAL_HARRIS_THRESHOLD/ip_gain);
       if (!vm.count("single-scale")) {
         ScaledInterestPointDetector<HarrisInterestOperator> detector(interest_operator,
                                                                      tile_max_points);
-        ip = detect_interest_points(image, detector);
+        ip = detect_interest_points(image, detector, points_per_tile);
       } else {
         InterestPointDetector<HarrisInterestOperator> detector(interest_operator,
                                                                tile_max_points);
-        ip = detect_interest_points(image, detector);
+        ip = detect_interest_points(image, detector, points_per_tile);
       }
     } else if ( interest_operator == "log") {
       // Use a scale-space Laplacian of Gaussian feature detector. The
@@ -249,18 +252,29 @@ int main(int argc, char** argv) {
       if (!vm.count("single-scale")) {
         ScaledInterestPointDetector<LogInterestOperator> detector(interest_operator,
                                                                   tile_max_points);
-        ip = detect_interest_points(image, detector);
+        ip = detect_interest_points(image, detector, points_per_tile);
       } else {
         InterestPointDetector<LogInterestOperator> detector(interest_operator,
                                                             tile_max_points);
-        ip = detect_interest_points(image, detector);
+        ip = detect_interest_points(image, detector, points_per_tile);
       }
     } else if ( interest_operator == "obalog") {
       // OBALoG threshold is inversely proportional to gain ..
       OBALoGInterestOperator interest_operator(IDEAL_OBALOG_THRESHOLD/ip_gain);
-      IntegralInterestPointDetector<OBALoGInterestOperator> detector( interest_operator,
-                                                                      tile_max_points );
-      ip = detect_interest_points(image, detector);
+      if ( descriptor_generator == "sgrad2" && number_tiles == 1 ) {
+        // An image of a single tile is detected whole anyway, so its
+        // integral image is made once for the detector and descriptors.
+        IntegralInterestPointDetector<OBALoGInterestOperator> detector( interest_operator,
+                                                                        max_points );
+        scale_space.reset( new IntegralScaleSpace( image ) );
+        ip = detect_interest_points(*scale_space, detector);
+        if ( points_per_tile > 0 )
+          cull_interest_points(ip, points_per_tile);
+      } else {
+        IntegralInterestPointDetector<OBALoGInterestOperator> detector( interest_operator,
+                                                                        tile_max_points );
+        ip = detect_interest_points(image, detector, points_per_tile);
+      }
     }
 
     // Removing Interest Points on nodata or within 1/px
@@ -302,8 +316,7 @@ int main(int argc, char** argv) {
 
     // Additional Culling for the entire image
     if ( max_points > 0  && ip.size() > max_points ) {
-      ip.sort();
-      ip.resize(max_points);
+      cull_interest_points(ip, max_points);
       vw_out() << "\t Culled to " << ip.size() << " points.\n";
     }
 
@@ -320,7 +333,10 @@ int main(int argc, char** argv) {
       descriptor(image, ip);
     } else if (descriptor_generator == "sgrad2") {
       SGrad2DescriptorGenerator descriptor;
-      descriptor(image, ip);
+      if ( scale_space )
+        descriptor(*scale_space, ip);
+      else
+        descriptor(image, ip);
     }
 
     // If ASCII output was requested, write it out.  Otherwise stick
@@ -329,6 +345,8 @@ int main(int argc, char** argv) {
       write_lowe_ascii_ip_file(file_prefix + ".key", ip);
     else
       write_binary_ip_file(file_prefix + ".vwip", ip);
+    if (vm.count("ip-set"))
+      write_binary_ip_set_file(file_prefix + ".vwips", InterestPointSet(ip.begin(), ip.end()));
 
     // Write Debug image
     if (vm.count("debug-image"))
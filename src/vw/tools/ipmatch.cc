@@ -25,8 +25,66 @@ using namespace vw::ip;
 namespace po = boost::program_options;
 
 #include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
 namespace fs = boost::filesystem;
 
+#include <boost/scoped_ptr.hpp>
+
+// Reads the interest points found for an image, from its interest
+// point set file if ipfind wrote one, or else its .vwip file.
+static std::vector<InterestPoint> read_ip_file(std::string const& image_file) {
+  std::string set_file = fs::path(image_file).replace_extension("vwips").string();
+  if ( fs::exists(set_file) ) {
+    InterestPointSet points;
+    read_binary_ip_set_file(set_file, points);
+    return points.points();
+  }
+  return read_binary_ip_file(fs::path(image_file).replace_extension("vwip").string());
+}
+
+// Builds the search tree over an image's points.  With cache_index the
+// tree is read from beside the image's interest point file, if it was
+// saved there after that file was written, and saved there otherwise.
+static DescriptorIndex* make_index(std::string const& image_file,
+                                   std::vector<InterestPoint> const& ip,
+                                   bool cache_index) {
+  InterestPointSet points( ip.begin(), ip.end() );
+  if ( !cache_index || points.empty() )
+    return new DescriptorIndex( points );
+  if ( !DescriptorIndex::can_save() ) {
+    vw_out(WarningMessage) << "Built without FLANN; search trees cannot be cached.\n";
+    return new DescriptorIndex( points );
+  }
+
+  fs::path ip_file = fs::path(image_file).replace_extension("vwips");
+  if ( !fs::exists(ip_file) )
+    ip_file = fs::path(image_file).replace_extension("vwip");
+  fs::path index_file = fs::path(image_file).replace_extension("flann");
+  if ( fs::exists(index_file) &&
+       fs::last_write_time(index_file) >= fs::last_write_time(ip_file) ) {
+    try {
+      return new DescriptorIndex( points, index_file.string() );
+    } catch ( IOErr const& e ) {
+      vw_out(WarningMessage) << "Rebuilding the search tree: " << e.what() << "\n";
+    }
+  }
+  DescriptorIndex* index = new DescriptorIndex( points );
+  index->save( index_file.string() );
+  return index;
+}
+
+// Tries the RANSAC hypotheses on every thread, stopping once the fit
+// is found with the given confidence.  Matches from the KDTree matcher
+// come the most distinct first, so the samples are drawn from those
+// first.
+template <class RansacT>
+static void configure_ransac(RansacT& ransac, double confidence, bool guided) {
+  ransac.set_num_threads(0);
+  ransac.set_confidence(confidence);
+  ransac.set_preemptive_test(1);
+  ransac.set_guided_sampling(guided);
+}
+
 // Draw the two images side by side with matching interest points
 // shown with lines.
 static void write_match_image(std::string const& out_file_name,
@@ -95,7 +153,7 @@ static void write_match_image(std::string const& out_file_name,
 
 int main(int argc, char** argv) {
   std::vector<std::string> input_file_names;
-  double matcher_threshold;
+  double matcher_threshold, ransac_confidence;
   std::string ransac_constraint;
   float inlier_threshold;
 
@@ -104,8 +162,10 @@ int main(int argc, char** argv) {
     ("help,h", "Display this help message")
     ("matcher-threshold,t", po::value(&matcher_threshold)->default_value(0.6), "Threshold for the interest point matcher.")
     ("non-kdtree", "Use an implementation of the interest matcher that is not reliant on a KDTree algorithm")
+    ("cache-index", "Keep each image's search tree in a .flann file beside its interest points, and reuse it on later runs.")
     ("ransac-constraint,r", po::value(&ransac_constraint)->default_value("similarity"), "RANSAC constraint type.  Choose one of: [similarity, homography, fundamental, or none].")
     ("inlier-threshold,i", po::value(&inlier_threshold)->default_value(10), "RANSAC inlier threshold.")
+    ("ransac-confidence", po::value(&ransac_confidence)->default_value(0.999), "Stop RANSAC once the fit is found with this probability.  Zero tries every hypothesis.")
     ("debug-image,d", "Write out debug images.");
 
   po::options_description hidden_options("");
@@ -144,23 +204,43 @@ int main(int argc, char** argv) {
     return 1;
   }
 
+  // Each file is read off disk once, and dropped once it has been
+  // matched against every file after it.  The search tree of the first
+  // file of each pair is built once and kept for all of its pairs.
+  std::vector<std::vector<InterestPoint> > ip_lists( input_file_names.size() );
+  std::vector<bool> ip_loaded( input_file_names.size(), false );
+
   // Iterate over combinations of the input files and find interest points in each.
   for (size_t i = 0; i < input_file_names.size(); ++i) {
+    boost::scoped_ptr<DescriptorIndex> index1;
     for (size_t j = i+1; j < input_file_names.size(); ++j) {
 
-      // Read each file off disk
-      std::vector<InterestPoint> ip1, ip2;
-      ip1 = read_binary_ip_file(fs::path(input_file_names[i]).replace_extension("vwip").string() );
-      ip2 = read_binary_ip_file(fs::path(input_file_names[j]).replace_extension("vwip").string() );
+      for ( size_t k = 0; k < 2; ++k ) {
+        size_t index = k ? j : i;
+        if ( !ip_loaded[index] ) {
+          ip_lists[index] = read_ip_file( input_file_names[index] );
+          ip_loaded[index] = true;
+        }
+      }
+      std::vector<InterestPoint> const& ip1 = ip_lists[i];
+      std::vector<InterestPoint> const& ip2 = ip_lists[j];
       vw_out() << "Matching between " << input_file_names[i] << " (" << ip1.size() << " points) and " << input_file_names[j] << " (" << ip2.size() << " points).\n";
 
       std::vector<InterestPoint> matched_ip1, matched_ip2;
 
       if ( !vm.count("non-kdtree") ) {
-        // Run interest point matcher that uses KDTree algorithm.
-        InterestPointMatcher<L2NormMetric,NullConstraint> matcher(matcher_threshold);
-        matcher(ip1, ip2, matched_ip1, matched_ip2, false,
-                TerminalProgressCallback( "tools.ipmatch","Matching:"));
+        // Run interest point matcher that uses KDTree algorithm, each
+        // point of ip2 matched into the tree of ip1.
+        if ( !index1 )
+          index1.reset( make_index( input_file_names[i], ip1, vm.count("cache-index") ) );
+        std::vector<std::pair<size_t,size_t> > matches;
+        match_interest_points( InterestPointSet( ip2.begin(), ip2.end() ), *index1, matches,
+                               matcher_threshold,
+                               TerminalProgressCallback( "tools.ipmatch","Matching:"));
+        for ( size_t k = 0; k < matches.size(); ++k ) {
+          matched_ip1.push_back( ip1[matches[k].second] );
+          matched_ip2.push_back( ip2[matches[k].first] );
+        }
       } else {
         // Run interest point matcher that does not use KDTree algorithm.
         InterestPointMatcherSimple<L2NormMetric,NullConstraint> matcher(matcher_threshold);
@@ -182,6 +262,7 @@ int main(int argc, char** argv) {
           math::RandomSampleConsensus<math::SimilarityFittingFunctor, math::InterestPointErrorMetric> ransac( math::SimilarityFittingFunctor(),
                                                                                                               math::InterestPointErrorMetric(),
                                                                                                               inlier_threshold ); // inlier_threshold
+          configure_ransac(ransac, ransac_confidence, !vm.count("non-kdtree"));
           Matrix<double> H(ransac(ransac_ip1,ransac_ip2));
           std::cout << "\t--> Similarity: " << H << "\n";
           indices = ransac.inlier_indices(H,ransac_ip1,ransac_ip2);
@@ -189,11 +270,13 @@ int main(int argc, char** argv) {
           math::RandomSampleConsensus<math::HomographyFittingFunctor, math::InterestPointErrorMetric> ransac( math::HomographyFittingFunctor(),
                                                                                                               math::InterestPointErrorMetric(),
                                                                                                               inlier_threshold ); // inlier_threshold
+          configure_ransac(ransac, ransac_confidence, !vm.count("non-kdtree"));
           Matrix<double> H(ransac(ransac_ip1,ransac_ip2));
           std::cout << "\t--> Homography: " << H << "\n";
           indices = ransac.inlier_indices(H,ransac_ip1,ransac_ip2);
         } else if (ransac_constraint == "fundamental") {
           math::RandomSampleConsensus<camera::FundamentalMatrix8PFittingFunctor, camera::FundamentalMatrixDistanceErrorMetric> ransac( camera::FundamentalMatrix8PFittingFunctor(), camera::FundamentalMatrixDistanceErrorMetric(), inlier_threshold );
+          configure_ransac(ransac, ransac_confidence, !vm.count("non-kdtree"));
           Matrix<double> F(ransac(ransac_ip1,ransac_ip2));
           std::cout << "\t--> Fundamental: " << F << "\n";
           indices = ransac.inlier_indices(F,ransac_ip1,ransac_ip2);
@@ -229,6 +312,7 @@ int main(int argc, char** argv) {
                           final_ip1, final_ip2);
       }
     }
+    ip_lists[i].clear();
   }
 
   return 0;
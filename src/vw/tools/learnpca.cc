@@ -6,6 +6,8 @@
 
 
 #include <iostream>
+#include <string>
+#include <vector>
 #include <vw/InterestPoint/LearnPCA.h>
 
 int main(int argc, char *argv[])
@@ -18,10 +20,8 @@ int main(int argc, char *argv[])
 
   LearnPCA lpca("pca_basis.exr", "pca_avg.exr");
 
-  for (int i = 1; i < argc; i++) {
-    vw::DiskImageView<vw::PixelRGB<vw::uint8> > disk_image(argv[i]);
-    lpca.processImage(disk_image);
-  }
+  std::vector<std::string> filenames(argv + 1, argv + argc);
+  lpca.processImages(filenames);
   lpca.runPCA();
 
   return 0;
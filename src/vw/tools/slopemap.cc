@@ -47,15 +47,22 @@ struct Options {
 
 //basic utilities
 
-Vector3 pixel_to_cart (Vector2 pos, double alt, GeoReference GR) {
+Vector3 pixel_to_cart (Vector2 pos, double alt, GeoReference const& GR) {
   Vector2 loc_longlat2=GR.point_to_lonlat(GR.pixel_to_point(pos));
   Vector3 loc_longlat3(loc_longlat2(0),loc_longlat2(1),alt);
   Vector3 loc_cartesian=GR.datum().geodetic_to_cartesian(loc_longlat3);
   return loc_cartesian;
 }
 
-template <class ImageT>
-Vector3 pixel_to_cart (Vector2 pos, DiskImageView<ImageT> img, GeoReference GR) {
+// The altitudes of a block of the DEM, addressed by their pixel
+// positions in the whole DEM.
+struct DEMBlock {
+  ImageView<double> alt;
+  Vector2i origin;
+  double operator() (int x, int y) const { return alt(x-origin.x(), y-origin.y()); }
+};
+
+Vector3 pixel_to_cart (Vector2 pos, DEMBlock const& img, GeoReference const& GR) {
   return pixel_to_cart(pos,img((int)pos[0],(int)pos[1]),GR);
 }
 
@@ -122,8 +129,7 @@ Vector2 gradient_aspect_from_dtheta_dphi(double rho, double theta, double phi, d
   return gradient_aspect_from_normals(center, plane_normal);
 }
 
-template <class ImageT>
-Vector2 uneven_grid (const ::Options& opt, int x, int y, DiskImageView<ImageT> img, GeoReference GR) {
+Vector2 uneven_grid (const ::Options& opt, int x, int y, DEMBlock const& img, GeoReference const& GR) {
 
   Vector3 center=pixel_to_cart(Vector2(x,y),img,GR);
   Vector3 center_normal=normalize(center);
@@ -209,8 +215,7 @@ Vector2 uneven_grid (const ::Options& opt, int x, int y, DiskImageView<ImageT> i
   return gradient_aspect_from_dx_dy(ans(0,1), ans(0,0));
 }
 
-template <class ImageT>
-Vector2 interpolate_plane (int x, int y, DiskImageView<ImageT> img, GeoReference GR) {
+Vector2 interpolate_plane (int x, int y, DEMBlock const& img, GeoReference const& GR) {
   Matrix<double> A(9,4);
   int i=0;
   int j=0;
@@ -244,6 +249,97 @@ Vector2 interpolate_plane (int x, int y, DiskImageView<ImageT> img, GeoReference
   return gradient_aspect_from_normals(center_normal, plane_normal);
 }
 
+//  SlopeView
+//
+// The aspect, gradient angle and pretty-image value of each pixel of
+// a DEM, computed a block at a time from the block of the DEM with a
+// border of one pixel around it.  The pixels on the edge of the DEM
+// are left zero.
+template <class ViewT>
+class SlopeView : public ImageViewBase<SlopeView<ViewT> > {
+  ViewT m_dem;
+  GeoReference m_georef;
+  ::Options m_opt;
+
+public:
+  typedef Vector3 pixel_type;
+  typedef pixel_type result_type;
+  typedef ProceduralPixelAccessor<SlopeView> pixel_accessor;
+
+  SlopeView( ViewT const& dem, GeoReference const& georef, ::Options const& opt )
+    : m_dem(dem), m_georef(georef), m_opt(opt) {}
+
+  inline int32 cols() const { return m_dem.cols(); }
+  inline int32 rows() const { return m_dem.rows(); }
+  inline int32 planes() const { return 1; }
+
+  inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+
+  inline result_type operator()( int32 x, int32 y, int32 p=0 ) const {
+    ImageView<pixel_type> pixel( 1, 1 );
+    rasterize( pixel, BBox2i(x,y,1,1) );
+    return pixel(0,0,p);
+  }
+
+  typedef CropView<ImageView<pixel_type> > prerasterize_type;
+  inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+    ImageView<pixel_type> dest( bbox.width(), bbox.height() );
+    rasterize( dest, bbox );
+    return CropView<ImageView<pixel_type> >( dest, BBox2i(-bbox.min().x(),-bbox.min().y(),cols(),rows()) );
+  }
+
+  template <class DestT>
+  void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+    ImageView<pixel_type> result( bbox.width(), bbox.height() );
+    rasterize( result, bbox );
+    vw::rasterize( result, dest, BBox2i(0,0,bbox.width(),bbox.height()) );
+  }
+
+  void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const {
+    BBox2i border = bbox;
+    border.expand( 1 );
+    border.crop( BBox2i(0,0,cols(),rows()) );
+    DEMBlock block;
+    block.origin = border.min();
+    block.alt.set_size( border.width(), border.height() );
+    ImageView<typename ViewT::pixel_type> dem = crop( m_dem, border );
+    for( int y=0; y<border.height(); y++ )
+      for( int x=0; x<border.width(); x++ )
+        block.alt(x,y) = dem(x,y)[0];
+
+    for( int y=bbox.min().y(); y<bbox.max().y(); y++ ) {
+      for( int x=bbox.min().x(); x<bbox.max().x(); x++ ) {
+        pixel_type& out = dest(x-bbox.min().x(), y-bbox.min().y());
+        if( x<1 || y<1 || x>=cols()-1 || y>=rows()-1 ) {
+          out = pixel_type();
+          continue;
+        }
+        //these are pretty similar...
+        Vector2 res;
+        if(m_opt.algorithm==PLANEFIT) res=interpolate_plane(x,y,block,m_georef);
+        else res=uneven_grid(m_opt,x,y,block,m_georef);
+        out = pixel_type(res(0),res(1),(res(1))+0.2*fabs(M_PI-res(0)));//(res(1)/M_PI*2)*fabs(M_PI-res(0)));
+      }
+    }
+  }
+};
+
+// Colors a pixel of a SlopeView: the hue is the aspect, the
+// saturation the gradient angle and the value the pretty-image value
+// rescaled from [value_min,value_max], all inverted.
+class PrettyFunc : public ReturnFixedType<PixelRGB<uint8> > {
+  double m_value_min, m_value_scale;
+public:
+  PrettyFunc(double value_min, double value_max) : m_value_min(value_min),
+    m_value_scale(value_max == value_min ? 0.0 : (0.6-0.3)/(value_max-value_min)) {}
+  PixelRGB<uint8> operator() (Vector3 const& pix) const {
+    PixelHSV<double> hsv( pix(0)/(2*M_PI),
+                          pix(1)/(M_PI/2)*(1-0.1)+0.1,
+                          (pix(2)-m_value_min)*m_value_scale+0.3 );
+    return PixelRGB<uint8>(255,255,255) - pixel_cast_rescale<PixelRGB<uint8> >(hsv);
+  }
+};
+
 template <class imageT>
 void do_slopemap (const ::Options &opt) { //not sure what the arguments are
 
@@ -252,45 +348,26 @@ void do_slopemap (const ::Options &opt) { //not sure what the arguments are
 
   DiskImageView<imageT> img(opt.input_file_name);
 
-  int x;
-  int y;
-
-  ImageView<double> gradient_angle;
-  ImageView<double> aspect;
-  ImageView<PixelHSV<double> > pretty;
+  // Each output reads the slopes through the cache, so that they are
+  // computed only once for all of them.
+  int32 tile_size = vw_settings().default_tile_size();
+  BlockRasterizeView<SlopeView<DiskImageView<imageT> > > slopes =
+    block_cache( SlopeView<DiskImageView<imageT> >(img, GR, opt), Vector2i(tile_size,tile_size) );
 
+  //save everything to file
   if(opt.output_gradient)
-    gradient_angle.set_size(img.cols(),img.rows());
+    block_write_georeferenced_image( opt.output_prefix + "_gradient.tif", select_channel(slopes,1), GR,
+                                     TerminalProgressCallback( "tools.slopemap", "Gradient:") );
   if(opt.output_aspect)
-    aspect.set_size(img.cols(),img.rows());
-  if(opt.output_pretty) pretty.set_size(img.cols(),img.rows());
-
-  for(x=1;x<img.cols()-1;x++) {
-    for(y=1;y<img.rows()-1;y++) {
-      Vector2 res;
-      //these are pretty similar...
-      if(opt.algorithm==PLANEFIT) res=interpolate_plane(x,y,img,GR);
-      else res=uneven_grid(opt, x,y,img,GR);
-
-      if(opt.output_aspect)   aspect(x,y) = res(0);
-      if(opt.output_gradient) gradient_angle(x,y) = res(1);
-      if(opt.output_pretty)   pretty(x,y) = PixelHSV<double>(res(0),res(1),(res(1))+0.2*fabs(M_PI-res(0)));//(res(1)/M_PI*2)*fabs(M_PI-res(0)));
-     }
-  }
-  ImageView<PixelRGB<uint8> > pretty2;
-
+    block_write_georeferenced_image( opt.output_prefix + "_aspect.tif", select_channel(slopes,0), GR,
+                                     TerminalProgressCallback( "tools.slopemap", "Aspect:") );
   if(opt.output_pretty) {
-    select_channel(pretty,0)=normalize(select_channel(pretty,0),0,2*M_PI,0,1);
-    select_channel(pretty,1)=normalize(select_channel(pretty,1),0,M_PI/2,0.1,1);
-    select_channel(pretty,2)=normalize(select_channel(pretty,2),0.3,0.6);
-
-    pretty2=pixel_cast_rescale<PixelRGB<uint8> >( copy(pretty) );
-    pretty2=PixelRGB<uint8>(255,255,255)-pretty2;
+    double value_min, value_max;
+    min_max_channel_values( select_channel(slopes,2), value_min, value_max );
+    ImageViewRef<PixelRGB<uint8> > pretty = per_pixel_filter( slopes, PrettyFunc(value_min, value_max) );
+    boost::scoped_ptr<DiskImageResource> r(DiskImageResource::create(opt.output_prefix + "_pretty.tif", pretty.format()));
+    block_write_image( *r, pretty, TerminalProgressCallback( "tools.slopemap", "Pretty:") );
   }
-  //save everything to file
-  if(opt.output_gradient) write_georeferenced_image( opt.output_prefix + "_gradient.tif" , gradient_angle, GR);
-  if(opt.output_aspect)   write_georeferenced_image( opt.output_prefix + "_aspect.tif"   , aspect, GR);
-  if(opt.output_pretty)   write_image( opt.output_prefix + "_pretty.tif"   , pretty2);
 }
 
 
@@ -0,0 +1,272 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file vwtune.cc
+///
+/// Finds the tile size and thread count that block processing runs
+/// fastest with on this machine, by timing a representative pipeline
+/// (a per-pixel function of the input, then a Gaussian filter) over
+/// a range of each, and saves them to the [general] section of the
+/// vwrc file as default_tile_size and default_num_threads.
+///
+/// The tile size is chosen first, with every thread working.  Then the
+/// fewest threads that come within a few percent of the fastest time
+/// are chosen, which leaves the rest of the machine free when adding
+/// threads hardly helps.
+
+#include <vw/Core/Settings.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/Thread.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/PerPixelViews.h>
+#include <vw/Image/UtilityViews.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/FileIO/DiskImageView.h>
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <limits>
+
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+using namespace vw;
+
+struct Options {
+  std::string input_file_name;
+  std::string config_file_name;
+  int32 size;
+  int32 repeat;
+  uint32 max_threads;
+  std::vector<int32> tile_sizes;
+  double tolerance;
+  bool dry_run;
+};
+
+// Costs about what resampling a pixel of an input image does.
+struct SyntheticFunctor {
+  typedef float32 result_type;
+  result_type operator()( double i, double j, int32 /*p*/ ) const {
+    return float32( std::sin( i * 0.01 ) * std::cos( j * 0.013 ) + std::sqrt( i * j + 1.0 ) * 1e-3 );
+  }
+};
+
+struct WaveFunctor : ReturnFixedType<float32> {
+  float32 operator()( float32 v ) const { return std::sin( v ) * v; }
+};
+
+// The best of opt.repeat runs, in seconds.
+template <class ViewT>
+double time_pipeline( ImageViewBase<ViewT> const& view, int32 tile, int32 threads, Options const& opt ) {
+  ImageView<float32> dest( view.impl().cols(), view.impl().rows() );
+  double best = std::numeric_limits<double>::max();
+  for( int32 i = 0; i < opt.repeat; ++i ) {
+    uint64 start = Stopwatch::microtime();
+    block_rasterize( view.impl(), Vector2i( tile, tile ), threads ).rasterize( dest, bounding_box( dest ) );
+    best = std::min( best, ( Stopwatch::microtime() - start ) * 1e-6 );
+  }
+  return best;
+}
+
+template <class ViewT>
+void tune( ImageViewBase<ViewT> const& view, Options const& opt,
+           int32& best_tile, uint32& best_threads ) {
+  vw_out() << "Tile size, with " << opt.max_threads << " threads:\n";
+  double best = std::numeric_limits<double>::max();
+  for( size_t i = 0; i < opt.tile_sizes.size(); ++i ) {
+    double t = time_pipeline( view, opt.tile_sizes[i], opt.max_threads, opt );
+    vw_out() << "  " << std::setw(6) << opt.tile_sizes[i] << "  " << std::fixed << std::setprecision(3) << t << " s\n";
+    if( t < best ) {
+      best = t;
+      best_tile = opt.tile_sizes[i];
+    }
+  }
+
+  std::vector<uint32> counts;
+  for( uint32 n = 1; n < opt.max_threads; n *= 2 )
+    counts.push_back( n );
+  counts.push_back( opt.max_threads );
+
+  vw_out() << "Threads, with " << best_tile << " pixel tiles:\n";
+  std::vector<double> times;
+  best = std::numeric_limits<double>::max();
+  for( size_t i = 0; i < counts.size(); ++i ) {
+    times.push_back( time_pipeline( view, best_tile, counts[i], opt ) );
+    vw_out() << "  " << std::setw(6) << counts[i] << "  " << std::fixed << std::setprecision(3) << times.back() << " s\n";
+    best = std::min( best, times.back() );
+  }
+  for( size_t i = 0; i < counts.size(); ++i )
+    if( times[i] <= best * ( 1 + opt.tolerance ) ) {
+      best_threads = counts[i];
+      break;
+    }
+}
+
+// Replaces or adds the given keys in the [general] section of a vwrc
+// file, leaving the rest of it as it was.
+void save_settings( std::string const& filename, std::vector<std::pair<std::string, std::string> > const& values ) {
+  std::vector<std::string> lines;
+  {
+    std::ifstream in( filename.c_str() );
+    std::string line;
+    while( std::getline( in, line ) )
+      lines.push_back( line );
+  }
+
+  std::vector<bool> written( values.size(), false );
+  std::string section;
+  int32 general_end = -1;
+  for( size_t i = 0; i < lines.size(); ++i ) {
+    std::string line = boost::algorithm::trim_copy( lines[i] );
+    if( !line.empty() && line[0] == '[' ) {
+      section = line;
+      continue;
+    }
+    if( section != "[general]" )
+      continue;
+    if( !line.empty() )
+      general_end = int32(i) + 1;
+    size_t eq = line.find( '=' );
+    if( eq == std::string::npos )
+      continue;
+    std::string key = boost::algorithm::trim_copy( line.substr( 0, eq ) );
+    for( size_t k = 0; k < values.size(); ++k )
+      if( key == values[k].first ) {
+        lines[i] = values[k].first + " = " + values[k].second;
+        written[k] = true;
+      }
+  }
+
+  std::vector<std::string> added;
+  for( size_t k = 0; k < values.size(); ++k )
+    if( !written[k] )
+      added.push_back( values[k].first + " = " + values[k].second );
+  if( general_end < 0 ) {
+    for( size_t i = 0; i < lines.size(); ++i )
+      if( boost::algorithm::trim_copy( lines[i] ) == "[general]" )
+        general_end = int32(i) + 1;
+  }
+  if( general_end < 0 ) {
+    if( !lines.empty() && !lines.back().empty() )
+      lines.push_back( "" );
+    lines.push_back( "[general]" );
+    general_end = int32(lines.size());
+  }
+  lines.insert( lines.begin() + general_end, added.begin(), added.end() );
+
+  std::ofstream out( filename.c_str() );
+  if( !out )
+    vw_throw( IOErr() << "Could not write " << filename << "." );
+  for( size_t i = 0; i < lines.size(); ++i )
+    out << lines[i] << "\n";
+}
+
+void handle_arguments( int argc, char *argv[], Options& opt ) {
+  std::string tile_sizes;
+  po::options_description general_options("");
+  general_options.add_options()
+    ("input-file,i", po::value(&opt.input_file_name),
+     "Time the pipeline on (a square from the top left of) this image, rather than on a synthetic one.")
+    ("config-file,c", po::value(&opt.config_file_name)->default_value(vw_settings().rc_filename()),
+     "The vwrc file to save the settings to.")
+    ("size", po::value(&opt.size)->default_value(4096), "The width and height of the image to time, in pixels.")
+    ("repeat", po::value(&opt.repeat)->default_value(3), "Time each setting this many times, and keep the fastest.")
+    ("max-threads", po::value(&opt.max_threads)->default_value(boost::thread::hardware_concurrency()),
+     "The most threads to try.")
+    ("tile-sizes", po::value(&tile_sizes)->default_value("128,256,512,1024"),
+     "The tile sizes to try, separated by commas.")
+    ("tolerance", po::value(&opt.tolerance)->default_value(0.05),
+     "Use the fewest threads that are within this fraction of the fastest time.")
+    ("dry-run,n", "Only print the settings, rather than saving them.")
+    ("help,h", "Display this help message");
+
+  po::variables_map vm;
+  try {
+    po::store( po::command_line_parser( argc, argv ).options(general_options).run(), vm );
+    po::notify( vm );
+  } catch (const po::error& e) {
+    vw_throw( ArgumentErr() << "Error parsing input:\n\t"
+              << e.what() << general_options );
+  }
+
+  std::ostringstream usage;
+  usage << "Usage: " << argv[0] << " [options]\n";
+
+  if ( vm.count("help") )
+    vw_throw( ArgumentErr() << usage.str() << general_options );
+
+  opt.dry_run = vm.count("dry-run");
+  if ( opt.max_threads < 1 )
+    opt.max_threads = 1;
+  if ( opt.repeat < 1 || opt.size < 1 )
+    vw_throw( ArgumentErr() << "The size and repeat count must be positive.\n"
+              << usage.str() << general_options );
+
+  std::istringstream sizes( tile_sizes );
+  std::string size;
+  while ( std::getline( sizes, size, ',' ) ) {
+    try {
+      opt.tile_sizes.push_back( boost::lexical_cast<int32>( boost::algorithm::trim_copy( size ) ) );
+    } catch ( const boost::bad_lexical_cast& ) {
+      vw_throw( ArgumentErr() << "Bad tile size \"" << size << "\".\n" << usage.str() << general_options );
+    }
+    if ( opt.tile_sizes.back() < 1 )
+      vw_throw( ArgumentErr() << "Bad tile size \"" << size << "\".\n" << usage.str() << general_options );
+  }
+  if ( opt.tile_sizes.empty() )
+    vw_throw( ArgumentErr() << "Missing tile sizes!\n" << usage.str() << general_options );
+  if ( !opt.dry_run && opt.config_file_name.empty() )
+    vw_throw( ArgumentErr() << "There is no vwrc file to save to; use --config-file or --dry-run.\n"
+              << usage.str() << general_options );
+}
+
+int main( int argc, char *argv[] ) {
+
+  Options opt;
+  try {
+    handle_arguments( argc, argv, opt );
+
+    // The thread pool is sized when it is first used, so it must have
+    // room for the most threads we try from the start.
+    vw_settings().set_default_num_threads( opt.max_threads );
+
+    int32 best_tile = opt.tile_sizes.front();
+    uint32 best_threads = opt.max_threads;
+    if ( opt.input_file_name.empty() ) {
+      PerPixelIndexView<SyntheticFunctor> source( SyntheticFunctor(), opt.size, opt.size );
+      tune( gaussian_filter( per_pixel_filter( source, WaveFunctor() ), 2.0 ), opt, best_tile, best_threads );
+    } else {
+      DiskImageView<float32> input( opt.input_file_name );
+      BBox2i bbox = bounding_box( input );
+      bbox.crop( BBox2i( 0, 0, opt.size, opt.size ) );
+      tune( gaussian_filter( per_pixel_filter( crop( input, bbox ), WaveFunctor() ), 2.0 ), opt, best_tile, best_threads );
+    }
+
+    vw_out() << "default_tile_size = " << best_tile << "\n"
+             << "default_num_threads = " << best_threads << "\n";
+    if ( !opt.dry_run ) {
+      std::vector<std::pair<std::string, std::string> > values;
+      values.push_back( std::make_pair( std::string("default_tile_size"), boost::lexical_cast<std::string>( best_tile ) ) );
+      values.push_back( std::make_pair( std::string("default_num_threads"), boost::lexical_cast<std::string>( best_threads ) ) );
+      save_settings( opt.config_file_name, values );
+      vw_out() << "Saved to " << opt.config_file_name << "\n";
+    }
+
+  } catch ( const ArgumentErr& e ) {
+    vw_out() << e.what() << std::endl;
+    return 1;
+  } catch ( const Exception& e ) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}